@@ -20,6 +20,11 @@
 #ifndef CERES_COST_FUNCTIONS_H
 #define CERES_COST_FUNCTIONS_H
 
+// STD
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 // EIGEN
 #include <Eigen/Dense>
 
@@ -272,6 +277,131 @@ private:
   double lambda;
 };
 
+/**
+* \class MahalanobisDistanceBatchResidual
+* \brief Mahalanobis distances between the points X and their neighborhoods
+*        encoded by the mean points C and the variance covariance matrices A,
+*        for all the matches at once and with analytic jacobians.
+*
+* Let's w = (rx, ry, rz, tx, ty, tz) be the estimated pose, and s the time of
+* a point in [0, 1]. The point is moved by the rotation R(w) and by the
+* translation linearly interpolated between T0 and (tx, ty, tz):
+* Y = R(w) * X + (1 - s) * T0 + s * T - C
+* Without times, s = 1 and this is the affine isometry of
+* MahalanobisDistanceAffineIsometryResidual. With times, this is the
+* linear distortion of MahalanobisDistanceLinearDistortionResidual, whose
+* rotation is also the one of the end of the frame.
+*
+* The residuals are evaluated by a single block, so the robust loss is
+* applied to each of them here: the residual is sqrt(rho(r^2)), which has
+* the same cost as the ceres::ArctanLoss of the per match blocks. The
+* matches are read from the given vectors, the cost function can thus be
+* kept from an ICP iteration to the next and only be given the new size.
+*/
+//-----------------------------------------------------------------------------
+class MahalanobisDistanceBatchResidual : public ceres::CostFunction
+{
+public:
+  MahalanobisDistanceBatchResidual(double argLossScale)
+  {
+    this->lossScale = argLossScale;
+    this->mutable_parameter_block_sizes()->push_back(6);
+    this->set_num_residuals(0);
+  }
+
+  // The vectors must outlive the evaluations, time may be null
+  void SetMatches(const std::vector<Eigen::Matrix3d>& argA,
+                  const std::vector<Eigen::Vector3d>& argC,
+                  const std::vector<Eigen::Vector3d>& argX,
+                  const std::vector<double>* argTime,
+                  const std::vector<double>& argLambda,
+                  const Eigen::Vector3d& argT0)
+  {
+    this->A = argA.data();
+    this->C = argC.data();
+    this->X = argX.data();
+    this->time = argTime ? argTime->data() : nullptr;
+    this->lambda = argLambda.data();
+    this->T0 = argT0;
+    this->set_num_residuals(static_cast<int>(argX.size()));
+  }
+
+  bool Evaluate(double const* const* parameters, double* residuals, double** jacobians) const override
+  {
+    const double* w = parameters[0];
+    double* jacobian = jacobians ? jacobians[0] : nullptr;
+
+    // store sin / cos values for this angle
+    const double crx = std::cos(w[0]); const double srx = std::sin(w[0]);
+    const double cry = std::cos(w[1]); const double sry = std::sin(w[1]);
+    const double crz = std::cos(w[2]); const double srz = std::sin(w[2]);
+
+    // R(w) = Rz(rz) * Ry(ry) * Rx(rx) and its derivatives, shared by all the matches
+    Eigen::Matrix3d Rx, Ry, Rz, dRx, dRy, dRz;
+    Rx << 1, 0, 0, 0, crx, -srx, 0, srx, crx;
+    Ry << cry, 0, sry, 0, 1, 0, -sry, 0, cry;
+    Rz << crz, -srz, 0, srz, crz, 0, 0, 0, 1;
+    dRx << 0, 0, 0, 0, -srx, -crx, 0, crx, -srx;
+    dRy << -sry, 0, cry, 0, 0, 0, -cry, 0, -sry;
+    dRz << -srz, -crz, 0, crz, -srz, 0, 0, 0, 0;
+    const Eigen::Matrix3d R = Rz * Ry * Rx;
+    const Eigen::Matrix3d dRdrx = Rz * Ry * dRx;
+    const Eigen::Matrix3d dRdry = Rz * dRy * Rx;
+    const Eigen::Matrix3d dRdrz = dRz * Ry * Rx;
+    const Eigen::Vector3d T1(w[3], w[4], w[5]);
+
+    for (int k = 0; k < this->num_residuals(); ++k)
+    {
+      const double s = this->time ? this->time[k] : 1.0;
+      const Eigen::Vector3d Y = R * this->X[k] + (1.0 - s) * this->T0 + s * T1 - this->C[k];
+      const Eigen::Vector3d AY = this->A[k] * Y;
+      const double squaredResidual = this->lambda[k] * Y.dot(AY);
+
+      // same threshold as the auto diff cost functions, under
+      // which the residual and its derivatives are null
+      if (squaredResidual < 1e-6)
+      {
+        residuals[k] = 0.0;
+        if (jacobian)
+        {
+          std::fill(jacobian + 6 * k, jacobian + 6 * k + 6, 0.0);
+        }
+        continue;
+      }
+
+      // rho(t) = a * atan(t / a) applied to t = r^2
+      const double scaledResidual = squaredResidual / this->lossScale;
+      const double rho = this->lossScale * std::atan(scaledResidual);
+      residuals[k] = std::sqrt(rho);
+      if (jacobian)
+      {
+        // d(sqrt(rho(t))) = rho'(t) / (2 sqrt(rho(t))) dt, with
+        // dt = lambda * Y' * (A + A') * dY
+        const double drho = 1.0 / (1.0 + scaledResidual * scaledResidual);
+        const Eigen::Vector3d dt = this->lambda[k] * (AY + this->A[k].transpose() * Y);
+        const Eigen::Vector3d g = drho / (2.0 * residuals[k]) * dt;
+        double* row = jacobian + 6 * k;
+        row[0] = g.dot(dRdrx * this->X[k]);
+        row[1] = g.dot(dRdry * this->X[k]);
+        row[2] = g.dot(dRdrz * this->X[k]);
+        row[3] = s * g(0);
+        row[4] = s * g(1);
+        row[5] = s * g(2);
+      }
+    }
+    return true;
+  }
+
+private:
+  const Eigen::Matrix3d* A = nullptr;
+  const Eigen::Vector3d* C = nullptr;
+  const Eigen::Vector3d* X = nullptr;
+  const double* time = nullptr;
+  const double* lambda = nullptr;
+  Eigen::Vector3d T0 = Eigen::Vector3d::Zero();
+  double lossScale;
+};
+
 /**
 * \class FrobeniusDistanceRotationCalibrationResidual
 * \brief Cost function to minimize to estimate the calibration rotation between two sensors
@@ -576,6 +706,83 @@ public:
 private:
   Eigen::Vector3d X, Y;
 };
+
+/**
+* \class RelativePoseResidual
+* \brief Cost function to minimize to estimate the poses of a pose graph.
+*        An edge of the graph measures the pose (Rm, Tm) of a node b in the
+*        referential of a node a, the residual is the difference between this
+*        measure and the relative pose of the nodes estimated so far:
+*
+*        Rab = Ra.t * Rb and Tab = Ra.t * (Tb - Ta)
+*
+*        The rotational error is the angle-axis vector of Rm.t * Rab and the
+*        translational one is Tab - Tm, they are weighted by the inverse of
+*        the standard deviations of the measure. The poses use the same
+*        Euler-Angle mapping R(rx, ry, rz) = Rz(rz) * Ry(ry) * Rx(rx)
+*/
+//-----------------------------------------------------------------------------
+struct RelativePoseResidual
+{
+public:
+  RelativePoseResidual(const Eigen::Matrix3d& argRm, const Eigen::Vector3d& argTm,
+                       double argRotationWeight, double argTranslationWeight)
+  {
+    this->Rm = argRm;
+    this->Tm = argTm;
+    this->RotationWeight = argRotationWeight;
+    this->TranslationWeight = argTranslationWeight;
+  }
+
+  template <typename T>
+  static Eigen::Matrix<T, 3, 3> Rotation(const T* const w)
+  {
+    // store sin / cos values for this angle
+    T crx = ceres::cos(w[0]); T srx = ceres::sin(w[0]);
+    T cry = ceres::cos(w[1]); T sry = ceres::sin(w[1]);
+    T crz = ceres::cos(w[2]); T srz = ceres::sin(w[2]);
+
+    Eigen::Matrix<T, 3, 3> R;
+    R << cry*crz, (srx*sry*crz-crx*srz), (crx*sry*crz+srx*srz),
+         cry*srz, (srx*sry*srz+crx*crz), (crx*sry*srz-srx*crz),
+            -sry,               srx*cry,               crx*cry;
+    return R;
+  }
+
+  template <typename T>
+  bool operator()(const T* const wa, const T* const wb, T* residual) const
+  {
+    Eigen::Matrix<T, 3, 3> Ra = Rotation(wa);
+    Eigen::Matrix<T, 3, 3> Rb = Rotation(wb);
+    Eigen::Matrix<T, 3, 1> Ta, Tb;
+    Ta << wa[3], wa[4], wa[5];
+    Tb << wb[3], wb[4], wb[5];
+
+    // Relative pose of b in a, compared to the measured one
+    Eigen::Matrix<T, 3, 3> dR = this->Rm.cast<T>().transpose() * Ra.transpose() * Rb;
+    Eigen::Matrix<T, 3, 1> dT = Ra.transpose() * (Tb - Ta) - this->Tm.cast<T>();
+
+    // ceres expects a column major matrix
+    T dRColumnMajor[9];
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j)
+        dRColumnMajor[3 * j + i] = dR(i, j);
+    T angleAxis[3];
+    ceres::RotationMatrixToAngleAxis(dRColumnMajor, angleAxis);
+
+    for (int i = 0; i < 3; ++i)
+    {
+      residual[i] = T(this->RotationWeight) * angleAxis[i];
+      residual[3 + i] = T(this->TranslationWeight) * dT(i);
+    }
+    return true;
+  }
+
+private:
+  Eigen::Matrix3d Rm;
+  Eigen::Vector3d Tm;
+  double RotationWeight, TranslationWeight;
+};
 }
 
 #endif // CERES_COST_FUNCTIONS_H
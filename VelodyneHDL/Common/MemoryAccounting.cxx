@@ -0,0 +1,264 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "MemoryAccounting.h"
+
+// STD
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace
+{
+std::atomic<unsigned long> Sizes[MemoryAccounting::NUMBER_OF_SUBSYSTEMS];
+std::atomic<unsigned long> PeakSizes[MemoryAccounting::NUMBER_OF_SUBSYSTEMS];
+
+const char* SubsystemNames[MemoryAccounting::NUMBER_OF_SUBSYSTEMS] = {
+  "Live frames", "Trailing frames", "Slam cache", "Slam maps",
+  "Accumulated points", "Reader frames", "Reader packets",
+  "Transformed frames", "Temporal cache", "Occupancy grids"
+};
+
+std::atomic<unsigned long> Budget(0);
+
+//! Part of the memory of the system kept available, so that it does not swap
+const unsigned long SystemReserveRatio = 10;
+
+//-----------------------------------------------------------------------------
+//! Releasable accounts, the mutex is also held by Enforce while it calls the releasers
+std::mutex& GetReleasersMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<MemoryAccounting::Account*>& GetReleasableAccounts()
+{
+  static std::vector<MemoryAccounting::Account*> accounts;
+  return accounts;
+}
+
+//-----------------------------------------------------------------------------
+void UpdatePeakSize(int subsystem, unsigned long size)
+{
+  unsigned long peak = PeakSizes[subsystem].load();
+  while (size > peak && !PeakSizes[subsystem].compare_exchange_weak(peak, size))
+  {
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool IsValid(int subsystem)
+{
+  return subsystem >= 0 && subsystem < MemoryAccounting::NUMBER_OF_SUBSYSTEMS;
+}
+}
+
+//-----------------------------------------------------------------------------
+const char* MemoryAccounting::GetSubsystemName(int subsystem)
+{
+  return IsValid(subsystem) ? SubsystemNames[subsystem] : "";
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryAccounting::GetSize(int subsystem)
+{
+  return IsValid(subsystem) ? Sizes[subsystem].load() : 0;
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryAccounting::GetPeakSize(int subsystem)
+{
+  return IsValid(subsystem) ? PeakSizes[subsystem].load() : 0;
+}
+
+//-----------------------------------------------------------------------------
+void MemoryAccounting::ResetPeakSizes()
+{
+  for (int subsystem = 0; subsystem < NUMBER_OF_SUBSYSTEMS; ++subsystem)
+  {
+    PeakSizes[subsystem].store(Sizes[subsystem].load());
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string MemoryAccounting::GetSummary()
+{
+  std::ostringstream summary;
+  summary << std::fixed << std::setprecision(1);
+  for (int subsystem = 0; subsystem < NUMBER_OF_SUBSYSTEMS; ++subsystem)
+  {
+    // the subsystems which have never held anything are not listed
+    if (GetPeakSize(subsystem) == 0)
+    {
+      continue;
+    }
+    summary << (summary.tellp() > 0 ? ", " : "") << SubsystemNames[subsystem] << " "
+            << GetSize(subsystem) / 1024.0 << " MiB (peak " << GetPeakSize(subsystem) / 1024.0
+            << " MiB)";
+  }
+  return summary.str();
+}
+
+//-----------------------------------------------------------------------------
+void MemoryAccounting::SetBudget(unsigned long kibibytes)
+{
+  Budget.store(kibibytes);
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryAccounting::GetBudget()
+{
+  return Budget.load();
+}
+
+//-----------------------------------------------------------------------------
+bool MemoryAccounting::GetSystemMemory(unsigned long& total, unsigned long& available)
+{
+#if defined(__linux__)
+  // MemAvailable counts the page cache which can be dropped, unlike MemFree
+  std::ifstream meminfo("/proc/meminfo");
+  std::string name;
+  unsigned long value = 0;
+  std::string unit;
+  bool hasTotal = false;
+  bool hasAvailable = false;
+  while (meminfo >> name >> value >> unit && !(hasTotal && hasAvailable))
+  {
+    if (name == "MemTotal:")
+    {
+      total = value;
+      hasTotal = true;
+    }
+    else if (name == "MemAvailable:")
+    {
+      available = value;
+      hasAvailable = true;
+    }
+  }
+  return hasTotal && hasAvailable;
+#elif defined(_WIN32)
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  if (!GlobalMemoryStatusEx(&status))
+  {
+    return false;
+  }
+  total = static_cast<unsigned long>(status.ullTotalPhys / 1024);
+  available = static_cast<unsigned long>(status.ullAvailPhys / 1024);
+  return true;
+#else
+  (void)total;
+  (void)available;
+  return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+unsigned long MemoryAccounting::Enforce()
+{
+  unsigned long size = 0;
+  for (int subsystem = 0; subsystem < NUMBER_OF_SUBSYSTEMS; ++subsystem)
+  {
+    size += GetSize(subsystem);
+  }
+  const unsigned long budget = GetBudget();
+  unsigned long excess = budget > 0 && size > budget ? size - budget : 0;
+  unsigned long total = 0;
+  unsigned long available = 0;
+  if (GetSystemMemory(total, available) && available < total / SystemReserveRatio)
+  {
+    excess = std::max(excess, total / SystemReserveRatio - available);
+  }
+  if (excess == 0)
+  {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(GetReleasersMutex());
+  std::vector<Account*> accounts = GetReleasableAccounts();
+  std::stable_sort(accounts.begin(), accounts.end(),
+    [](const Account* a, const Account* b) { return a->Priority < b->Priority; });
+  unsigned long released = 0;
+  for (Account* account : accounts)
+  {
+    if (released >= excess)
+    {
+      break;
+    }
+    const unsigned long previous = account->Get();
+    if (previous == 0)
+    {
+      continue;
+    }
+    account->Release(excess - released);
+    const unsigned long current = account->Get();
+    released += current < previous ? previous - current : 0;
+  }
+  return released;
+}
+
+//-----------------------------------------------------------------------------
+MemoryAccounting::Account::Account(Subsystem subsystem)
+  : Owner(subsystem)
+  , Size(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+MemoryAccounting::Account::~Account()
+{
+  this->SetReleaser(0, nullptr);
+  this->Set(0);
+}
+
+//-----------------------------------------------------------------------------
+void MemoryAccounting::Account::SetReleaser(int priority, const Releaser& releaser)
+{
+  std::lock_guard<std::mutex> lock(GetReleasersMutex());
+  std::vector<Account*>& accounts = GetReleasableAccounts();
+  accounts.erase(std::remove(accounts.begin(), accounts.end(), this), accounts.end());
+  this->Priority = priority;
+  this->Release = releaser;
+  if (releaser)
+  {
+    accounts.push_back(this);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void MemoryAccounting::Account::Set(unsigned long kibibytes)
+{
+  const unsigned long previous = this->Size.exchange(kibibytes);
+  if (kibibytes >= previous)
+  {
+    const unsigned long added = kibibytes - previous;
+    UpdatePeakSize(this->Owner, Sizes[this->Owner].fetch_add(added) + added);
+  }
+  else
+  {
+    Sizes[this->Owner].fetch_sub(previous - kibibytes);
+  }
+}
@@ -0,0 +1,152 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+// STD
+#include <atomic>
+#include <functional>
+#include <string>
+
+/**
+ * \class MemoryAccounting
+ * \brief Memory held by the subsystems keeping data from one frame to the next, summed over
+ *        all their instances, with the highest value reached since the last reset.
+ *
+ * The sizes are in kibibytes, like vtkDataObject::GetActualMemorySize. Each instance of a
+ * subsystem owns an Account and sets it each time the data it holds changes, the totals are
+ * updated without lock so that the decoding thread can set its account.
+ *
+ * The caches make their accounts releasable, so that the subsystems stay together within a
+ * budget and leave enough memory to the system not to swap: Enforce asks the caches whose data
+ * is the cheapest to produce again to drop their least recently used entries first.
+ */
+class MemoryAccounting
+{
+public:
+  enum Subsystem
+  {
+    //! Frames cached by the live streams
+    LIVE_FRAMES = 0,
+    //! Frames cached by the trailing frame filters
+    TRAILING_FRAMES,
+    //! Outputs of the slam kept to be given again when only the time changes
+    SLAM_CACHE,
+    //! Local maps of the slam
+    SLAM_MAPS,
+    //! Points accumulated by the point cloud accumulators
+    ACCUMULATED_POINTS,
+    //! Frames cached by the readers
+    READER_FRAMES,
+    //! Packets of the frames cached by the readers
+    READER_PACKETS,
+    //! Frames cached by the temporal transforms appliers
+    TRANSFORMED_FRAMES,
+    //! Outputs kept by the temporal caches
+    TEMPORAL_CACHE,
+    //! Voxels and elevations of the occupancy grids
+    OCCUPANCY_GRIDS,
+    NUMBER_OF_SUBSYSTEMS
+  };
+
+  //! Order in which Enforce releases the accounts, see Account::SetReleaser
+  enum ReleasePriority
+  {
+    //! Decoded again from the packets
+    DECODED_DATA_PRIORITY = 0,
+    //! Read again from the file
+    FILE_DATA_PRIORITY,
+    //! Lost, the sensor does not send it again
+    LIVE_DATA_PRIORITY
+  };
+
+  static const char* GetSubsystemName(int subsystem);
+
+  //! Memory currently held by a subsystem, in kibibytes
+  static unsigned long GetSize(int subsystem);
+
+  //! Highest memory held by a subsystem since the last ResetPeakSizes, in kibibytes
+  static unsigned long GetPeakSize(int subsystem);
+
+  //! Restart the peak sizes from the current sizes
+  static void ResetPeakSizes();
+
+  //! One line summary of the sizes and of the peak sizes, for the status bar
+  static std::string GetSummary();
+
+  /**
+   * @brief SetBudget set the memory the subsystems may hold together, see Enforce
+   * @param kibibytes budget, 0 to only keep the reserve of memory of the system
+   */
+  static void SetBudget(unsigned long kibibytes);
+  static unsigned long GetBudget();
+
+  /**
+   * @brief GetSystemMemory memory of the system, and the part of it which can be used without
+   * swapping (MemAvailable on Linux)
+   * @return false if the system does not tell
+   */
+  static bool GetSystemMemory(unsigned long& total, unsigned long& available);
+
+  /**
+   * @brief Enforce release the releasable accounts, by increasing priority, until the
+   * subsystems fit in the budget and the system has a tenth of its memory available. It must be
+   * called without holding a lock taken by a releaser, from the thread updating the pipeline.
+   * @return memory released, in kibibytes
+   */
+  static unsigned long Enforce();
+
+  /**
+   * \class Account
+   * \brief Memory held by an instance of a subsystem, removed from the total on destruction
+   */
+  class Account
+  {
+  public:
+    //! Drop the least recently used data to free the given memory, and set the account. It
+    //! returns without releasing anything rather than waiting for the data to be unused.
+    typedef std::function<void(unsigned long kibibytes)> Releaser;
+
+    explicit Account(Subsystem subsystem);
+    ~Account();
+
+    void Set(unsigned long kibibytes);
+    unsigned long Get() const { return this->Size.load(); }
+
+    /**
+     * @brief SetReleaser make the account releasable by Enforce, the releaser must stay valid
+     * until it is removed or the account destroyed
+     * @param priority see ReleasePriority, the lowest priorities are released first
+     * @param releaser nullptr to make the account not releasable
+     */
+    void SetReleaser(int priority, const Releaser& releaser);
+
+  private:
+    Account(const Account&) = delete;
+    Account& operator=(const Account&) = delete;
+
+    friend class MemoryAccounting;
+
+    const Subsystem Owner;
+    std::atomic<unsigned long> Size;
+    int Priority = 0;
+    Releaser Release;
+  };
+};
+
+#endif // MEMORY_ACCOUNTING_H
@@ -33,7 +33,20 @@
 #define __vtkPacketFileReader_h
 
 #include <pcap.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 // Some versions of libpcap do not have PCAP_NETMASK_UNKNOWN
 #if !defined(PCAP_NETMASK_UNKNOWN)
@@ -52,8 +65,125 @@ public:
   // 2-A packet filter is then compile to convert an high level filtering
   //  expression in a program that can be interpreted by the kernel-level filtering engine
   // 3- The compiled filter is then associate to the capture
-  bool Open(const std::string& filename)
+  // If useMemoryMapping is set, libpcap is not used: the file is mapped in memory and
+  // NextPacket returns pointers inside the mapping, which avoids a copy per packet and
+  // allows several readers to share the same pages.
+  // pcapng files are always read with the memory mapped backend, as not all the libpcap
+  // versions we ship can read them (WinPcap cannot).
+  // If destinationPort is set, only the UDP packets sent to this port are returned, this
+  // enables to skip the traffic of the other sensors and devices in a mixed capture without
+  // looking at it.
+  bool Open(const std::string& filename, bool useMemoryMapping = false,
+    unsigned short destinationPort = 0)
+  {
+    return this->Open(std::vector<std::string>(1, filename), useMemoryMapping, destinationPort);
+  }
+
+  // Open several files read one after the other as a single one, such as a capture split in
+  // several files by a logger. Only the first file is opened here, the next ones are opened
+  // when the reading reaches them, and only one file is open at a time. The file offsets are
+  // made of the index of the file and of the offset in this file, see MakeSequenceOffset.
+  bool Open(const std::vector<std::string>& filenames, bool useMemoryMapping = false,
+    unsigned short destinationPort = 0)
+  {
+    this->Close();
+    if (filenames.empty())
+    {
+      this->LastError = "No file to open.";
+      return false;
+    }
+    this->FileNames = filenames;
+    this->UseMemoryMapping = useMemoryMapping;
+    this->DestinationPort = destinationPort;
+    return this->OpenFile(0);
+  }
+
+  // In a sequence of files, the file offsets store the index of the file above
+  // FileIndexShift, so that the offsets of the first file, or of a single file, are unchanged
+  static const int FileIndexShift = 40;
+
+  static boost::uint64_t MakeSequenceOffset(size_t fileIndex, boost::uint64_t offsetInFile)
+  {
+    return (static_cast<boost::uint64_t>(fileIndex) << FileIndexShift) | offsetInFile;
+  }
+
+  static size_t GetFileIndex(boost::uint64_t sequenceOffset)
+  {
+    return static_cast<size_t>(sequenceOffset >> FileIndexShift);
+  }
+
+  static boost::uint64_t GetOffsetInFile(boost::uint64_t sequenceOffset)
+  {
+    return sequenceOffset & ((static_cast<boost::uint64_t>(1) << FileIndexShift) - 1);
+  }
+
+  bool IsOpen() { return (this->PCAPFile != 0 || this->MappedFile.is_open()); }
+
+  bool IsMemoryMapped() { return this->MappedFile.is_open(); }
+
+  void Close()
+  {
+    this->CloseFile();
+    this->FileNames.clear();
+    this->FileIndex = 0;
+  }
+
+  const std::string& GetLastError() { return this->LastError; }
+
+  // Name of the file of the sequence which is currently open
+  const std::string& GetFileName() { return this->FileName; }
+
+  const std::vector<std::string>& GetFileNames() { return this->FileNames; }
+
+  // IPv4 address, in host byte order, and UDP port of the sender of the last packet returned
+  // by NextPacket, so that the packets of several sensors of a capture can be told apart.
+  // Returns false for an IPv6 packet.
+  bool GetPacketSource(boost::uint32_t& address, unsigned short& port)
+  {
+    const unsigned char* ip = this->PacketIPHeader;
+    if (!ip || (ip[0] >> 4) != 4)
+    {
+      return false;
+    }
+    address = (static_cast<boost::uint32_t>(ip[12]) << 24) |
+      (static_cast<boost::uint32_t>(ip[13]) << 16) | (static_cast<boost::uint32_t>(ip[14]) << 8) |
+      ip[15];
+    const unsigned char* udp = ip + (ip[0] & 0xf) * 4;
+    port = static_cast<unsigned short>((udp[0] << 8) | udp[1]);
+    return true;
+  }
+
+  // Same as GetPacketSource for the receiver of the last packet
+  bool GetPacketDestination(boost::uint32_t& address, unsigned short& port)
+  {
+    const unsigned char* ip = this->PacketIPHeader;
+    if (!ip || (ip[0] >> 4) != 4)
+    {
+      return false;
+    }
+    address = (static_cast<boost::uint32_t>(ip[16]) << 24) |
+      (static_cast<boost::uint32_t>(ip[17]) << 16) | (static_cast<boost::uint32_t>(ip[18]) << 8) |
+      ip[19];
+    const unsigned char* udp = ip + (ip[0] & 0xf) * 4;
+    port = static_cast<unsigned short>((udp[2] << 8) | udp[3]);
+    return true;
+  }
+
+  // IP header of the last packet returned by NextPacket, after its link layer header
+  const unsigned char* GetPacketIPHeader() { return this->PacketIPHeader; }
+
+protected:
+  bool OpenFile(size_t fileIndex)
   {
+    this->CloseFile();
+    this->FileIndex = fileIndex;
+    const std::string& filename = this->FileNames[fileIndex];
+    const unsigned short destinationPort = this->DestinationPort;
+    if (this->UseMemoryMapping || IsPcapNgFile(filename))
+    {
+      return this->OpenMapped(filename);
+    }
+
     char errbuff[PCAP_ERRBUF_SIZE];
     pcap_t* pcapFile = pcap_open_offline(filename.c_str(), errbuff);
     if (!pcapFile)
@@ -63,16 +193,25 @@ public:
     }
 
     struct bpf_program filter;
+    std::string filterExpression = "udp";
+    if (destinationPort != 0)
+    {
+      filterExpression += " dst port " + std::to_string(destinationPort);
+    }
 
-    if (pcap_compile(pcapFile, &filter, "udp", 0, PCAP_NETMASK_UNKNOWN) == -1)
+    if (pcap_compile(pcapFile, &filter, filterExpression.c_str(), 0, PCAP_NETMASK_UNKNOWN) == -1)
     {
       this->LastError = pcap_geterr(pcapFile);
+      pcap_close(pcapFile);
       return false;
     }
 
-    if (pcap_setfilter(pcapFile, &filter) == -1)
+    const int returnValue = pcap_setfilter(pcapFile, &filter);
+    pcap_freecode(&filter);
+    if (returnValue == -1)
     {
       this->LastError = pcap_geterr(pcapFile);
+      pcap_close(pcapFile);
       return false;
     }
 
@@ -98,22 +237,24 @@ public:
     return true;
   }
 
-  bool IsOpen() { return (this->PCAPFile != 0); }
-
-  void Close()
+  void CloseFile()
   {
+    this->PacketIPHeader = nullptr;
     if (this->PCAPFile)
     {
       pcap_close(this->PCAPFile);
       this->PCAPFile = 0;
       this->FileName.clear();
     }
+    if (this->MappedFile.is_open())
+    {
+      this->MappedFile.close();
+      this->MappedOffset = 0;
+      this->FileName.clear();
+    }
   }
 
-  const std::string& GetLastError() { return this->LastError; }
-
-  const std::string& GetFileName() { return this->FileName; }
-
+public:
   void GetFilePosition(fpos_t* position)
   {
 #ifdef _MSC_VER
@@ -134,9 +275,178 @@ public:
 #endif
   }
 
+  // Byte offset of the next packet record from the beginning of the file.
+  // Contrary to fpos_t, it can be compared, stored on disk, and is shared by both backends.
+  boost::uint64_t GetFileOffset()
+  {
+    if (this->MappedFile.is_open())
+    {
+      return MakeSequenceOffset(this->FileIndex, this->MappedOffset);
+    }
+#ifdef _MSC_VER
+    // fpos_t is a plain 64 bits offset with MSVC
+    fpos_t position;
+    pcap_fgetpos(this->PCAPFile, &position);
+    return MakeSequenceOffset(this->FileIndex, static_cast<boost::uint64_t>(position));
+#else
+    return MakeSequenceOffset(
+      this->FileIndex, static_cast<boost::uint64_t>(ftello(pcap_file(this->PCAPFile))));
+#endif
+  }
+
+  // The file of the offset is opened if it is not the current one, or if the end of the
+  // sequence has been reached
+  void SetFileOffset(boost::uint64_t sequenceOffset)
+  {
+    const size_t fileIndex = GetFileIndex(sequenceOffset);
+    if ((fileIndex != this->FileIndex || !this->IsOpen()) &&
+      (fileIndex >= this->FileNames.size() || !this->OpenFile(fileIndex)))
+    {
+      return;
+    }
+    const boost::uint64_t offset = GetOffsetInFile(sequenceOffset);
+    if (this->MappedFile.is_open())
+    {
+      this->MappedOffset = static_cast<size_t>(offset);
+      return;
+    }
+#ifdef _MSC_VER
+    fpos_t position = static_cast<fpos_t>(offset);
+    pcap_fsetpos(this->PCAPFile, &position);
+#else
+    fseeko(pcap_file(this->PCAPFile), static_cast<off_t>(offset), SEEK_SET);
+#endif
+  }
+
+  // Ask the system to read a range of the current file in the background, so that the
+  // packets are already in memory when NextPacket gets there instead of being read one page
+  // fault at a time. The range is clamped to the current file. Returns false if the range is
+  // in another file or if the system cannot be advised (Windows).
+  bool WillNeed(boost::uint64_t beginSequenceOffset, boost::uint64_t endSequenceOffset)
+  {
+    if (!this->IsOpen() || GetFileIndex(beginSequenceOffset) != this->FileIndex)
+    {
+      return false;
+    }
+    const boost::uint64_t begin = GetOffsetInFile(beginSequenceOffset);
+    // 0 for the end of the file
+    boost::uint64_t end =
+      GetFileIndex(endSequenceOffset) == this->FileIndex ? GetOffsetInFile(endSequenceOffset) : 0;
+#if !defined(_WIN32)
+    if (this->MappedFile.is_open())
+    {
+      const boost::uint64_t fileSize = this->MappedFile.size();
+      end = end == 0 ? fileSize : std::min(end, fileSize);
+      if (begin >= end)
+      {
+        return false;
+      }
+      // the file is mapped from its beginning, which is aligned on a page
+      const boost::uint64_t pageSize = static_cast<boost::uint64_t>(sysconf(_SC_PAGESIZE));
+      const boost::uint64_t alignedBegin = begin - begin % pageSize;
+      void* address = const_cast<char*>(this->MappedFile.data()) + alignedBegin;
+      return madvise(address, static_cast<size_t>(end - alignedBegin), MADV_WILLNEED) == 0;
+    }
+#if defined(POSIX_FADV_WILLNEED)
+    if (end != 0 && begin >= end)
+    {
+      return false;
+    }
+    return posix_fadvise(fileno(pcap_file(this->PCAPFile)), static_cast<off_t>(begin),
+             static_cast<off_t>(end == 0 ? 0 : end - begin), POSIX_FADV_WILLNEED) == 0;
+#endif
+#endif
+    (void)end;
+    return false;
+  }
+
+  // Memory mapped backend only: size of the mapped file, the current one of a sequence
+  boost::uint64_t GetFileSize() { return this->MappedFile.is_open() ? this->MappedFile.size() : 0; }
+
+  // Memory mapped backend only: find the first record located at or after a given offset, so
+  // that the file can be split in several parts read independently. As pcap records have no
+  // marker, a position is accepted if it starts a chain of consistent record headers.
+  // For pcapng, only files with a single section can be split. Only the current file of a
+  // sequence is searched, the offsets are the ones in this file.
+  bool FindRecordBoundary(boost::uint64_t offset, boost::uint64_t& boundary)
+  {
+    const size_t globalHeaderSize = 24;
+    const size_t recordHeaderSize = 16;
+    const int chainLength = 16;
+    const size_t maxSearchLength = 1 << 20;
+    if (!this->MappedFile.is_open())
+    {
+      return false;
+    }
+    if (this->MappedPcapNg)
+    {
+      return this->FindPcapNgBlockBoundary(offset, boundary);
+    }
+
+    const unsigned char* file = reinterpret_cast<const unsigned char*>(this->MappedFile.data());
+    const size_t fileSize = this->MappedFile.size();
+    const size_t maxPacketSize = this->MappedSnapLength ? this->MappedSnapLength : 262144;
+    const boost::uint32_t maxFraction = this->MappedNanoSecond ? 1000000000 : 1000000;
+    size_t candidate = std::max(static_cast<size_t>(offset), globalHeaderSize);
+    for (; candidate < fileSize && candidate - offset < maxSearchLength; ++candidate)
+    {
+      size_t position = candidate;
+      int validRecords = 0;
+      while (validRecords < chainLength && position + recordHeaderSize <= fileSize)
+      {
+        const unsigned char* record = file + position;
+        const boost::uint32_t caplen = this->ReadMappedUInt32(record + 8);
+        const boost::uint32_t len = this->ReadMappedUInt32(record + 12);
+        const boost::uint32_t second = this->ReadMappedUInt32(record);
+        // records are not always sorted in time, but they are close to the first one
+        const boost::int64_t age = static_cast<boost::int64_t>(second) - this->MappedFirstSecond;
+        if (caplen == 0 || caplen > maxPacketSize || len < caplen ||
+          this->ReadMappedUInt32(record + 4) >= maxFraction || age < -86400 ||
+          age > 30 * 86400 || position + recordHeaderSize + caplen > fileSize)
+        {
+          break;
+        }
+        position += recordHeaderSize + caplen;
+        validRecords++;
+      }
+      if (validRecords == chainLength || (validRecords > 0 && position == fileSize))
+      {
+        boundary = candidate;
+        return true;
+      }
+    }
+    return false;
+  }
+
   bool NextPacket(const unsigned char*& data, unsigned int& dataLength, double& timeSinceStart,
     pcap_pkthdr** headerReference = NULL, unsigned int* dataHeaderLength = NULL)
   {
+    // at the end of a file, the reading goes on with the next file of the sequence
+    while (this->IsOpen())
+    {
+      if (this->NextFilePacket(
+            data, dataLength, timeSinceStart, headerReference, dataHeaderLength))
+      {
+        return true;
+      }
+      if (this->FileIndex + 1 >= this->FileNames.size() || !this->OpenFile(this->FileIndex + 1))
+      {
+        return false;
+      }
+    }
+    return false;
+  }
+
+protected:
+  bool NextFilePacket(const unsigned char*& data, unsigned int& dataLength,
+    double& timeSinceStart, pcap_pkthdr** headerReference, unsigned int* dataHeaderLength)
+  {
+    if (this->MappedFile.is_open())
+    {
+      return this->NextMappedPacket(
+        data, dataLength, timeSinceStart, headerReference, dataHeaderLength);
+    }
+
     if (!this->PCAPFile)
     {
       return false;
@@ -146,12 +456,13 @@ public:
     int returnValue = pcap_next_ex(this->PCAPFile, &header, &data);
     if (returnValue < 0)
     {
-      this->Close();
+      this->CloseFile();
       return false;
     }
 
     // Only return the payload.
     // We read the actual IP header length (v4 & v6) + assumes UDP
+    this->PacketIPHeader = data + FrameHeaderLength;
     const unsigned int ipHeaderLength = (data[FrameHeaderLength + 0] & 0xf) * 4;
     const unsigned int udpHeaderLength = 8;
     const unsigned int bytesToSkip = FrameHeaderLength + ipHeaderLength + udpHeaderLength;
@@ -170,17 +481,503 @@ public:
     return true;
   }
 
-protected:
   double GetElapsedTime(const struct timeval& end, const struct timeval& start)
   {
     return (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.00;
   }
 
+  static bool IsPcapNgFile(const std::string& filename)
+  {
+    std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+    unsigned char magic[4] = { 0, 0, 0, 0 };
+    stream.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    // the section header block type is a palindrome, it does not depend on the byte order
+    return stream.good() && magic[0] == 0x0a && magic[1] == 0x0d && magic[2] == 0x0d &&
+      magic[3] == 0x0a;
+  }
+
+  boost::uint16_t ReadMappedUInt16(const unsigned char* data)
+  {
+    boost::uint16_t value;
+    std::memcpy(&value, data, sizeof(value));
+    if (this->MappedSwapped)
+    {
+      value = static_cast<boost::uint16_t>((value << 8) | (value >> 8));
+    }
+    return value;
+  }
+
+  boost::uint64_t ReadMappedUInt64(const unsigned char* data)
+  {
+    boost::uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    if (this->MappedSwapped)
+    {
+      boost::uint64_t swapped = 0;
+      for (int i = 0; i < 8; ++i)
+      {
+        swapped = (swapped << 8) | ((value >> (8 * i)) & 0xff);
+      }
+      value = swapped;
+    }
+    return value;
+  }
+
+  boost::uint32_t ReadMappedUInt32(const unsigned char* data)
+  {
+    boost::uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    if (this->MappedSwapped)
+    {
+      value = ((value & 0xff) << 24) | ((value & 0xff00) << 8) | ((value & 0xff0000) >> 8) |
+        ((value & 0xff000000) >> 24);
+    }
+    return value;
+  }
+
+  // Map the file and parse the pcap global header ourself
+  // see https://wiki.wireshark.org/Development/LibpcapFileFormat
+  bool OpenMapped(const std::string& filename)
+  {
+    const size_t globalHeaderSize = 24;
+    try
+    {
+      this->MappedFile.open(filename);
+    }
+    catch (const std::exception& e)
+    {
+      this->LastError = e.what();
+      return false;
+    }
+    if (this->MappedFile.size() < globalHeaderSize)
+    {
+      this->LastError = "File is too small to be a pcap file.";
+      this->MappedFile.close();
+      return false;
+    }
+
+    const unsigned char* header = reinterpret_cast<const unsigned char*>(this->MappedFile.data());
+    boost::uint32_t magic;
+    std::memcpy(&magic, header, sizeof(magic));
+    this->MappedPcapNg = (magic == PcapNgSectionHeaderBlock);
+    if (this->MappedPcapNg)
+    {
+      if (!this->OpenMappedPcapNg())
+      {
+        this->MappedFile.close();
+        return false;
+      }
+      this->FileName = filename;
+      this->StartTime.tv_sec = this->StartTime.tv_usec = 0;
+      return true;
+    }
+
+    switch (magic)
+    {
+      case 0xa1b2c3d4: this->MappedSwapped = false; this->MappedNanoSecond = false; break;
+      case 0xd4c3b2a1: this->MappedSwapped = true;  this->MappedNanoSecond = false; break;
+      case 0xa1b23c4d: this->MappedSwapped = false; this->MappedNanoSecond = true;  break;
+      case 0x4d3cb2a1: this->MappedSwapped = true;  this->MappedNanoSecond = true;  break;
+      default:
+        this->LastError = "Unknown file format, only the pcap and pcapng formats can be mapped.";
+        this->MappedFile.close();
+        return false;
+    }
+
+    const unsigned int loopback_header_size = 4;
+    const unsigned int ethernet_header_size = 14;
+    switch (this->ReadMappedUInt32(header + 20))
+    {
+      case DLT_EN10MB:
+        this->FrameHeaderLength = ethernet_header_size;
+        break;
+      case DLT_NULL:
+        this->FrameHeaderLength = loopback_header_size;
+        break;
+      default:
+        this->LastError = "Unknown link type in pcap file. Cannot tell where the payload is.";
+        this->MappedFile.close();
+        return false;
+    }
+
+    this->MappedSnapLength = this->ReadMappedUInt32(header + 16);
+    this->MappedFirstSecond =
+      this->MappedFile.size() >= globalHeaderSize + 4 ? this->ReadMappedUInt32(header + 24) : 0;
+    this->FileName = filename;
+    this->MappedOffset = globalHeaderSize;
+    this->StartTime.tv_sec = this->StartTime.tv_usec = 0;
+    return true;
+  }
+
+  bool NextMappedPacket(const unsigned char*& data, unsigned int& dataLength,
+    double& timeSinceStart, pcap_pkthdr** headerReference, unsigned int* dataHeaderLength)
+  {
+    if (this->MappedPcapNg)
+    {
+      return this->NextMappedPcapNgPacket(
+        data, dataLength, timeSinceStart, headerReference, dataHeaderLength);
+    }
+
+    const size_t recordHeaderSize = 16;
+    const unsigned char* file = reinterpret_cast<const unsigned char*>(this->MappedFile.data());
+    const size_t fileSize = this->MappedFile.size();
+
+    while (this->MappedOffset + recordHeaderSize <= fileSize)
+    {
+      const unsigned char* record = file + this->MappedOffset;
+      const boost::uint32_t caplen = this->ReadMappedUInt32(record + 8);
+      if (this->MappedOffset + recordHeaderSize + caplen > fileSize)
+      {
+        // truncated last record
+        break;
+      }
+      this->MappedOffset += recordHeaderSize + caplen;
+
+      const boost::uint32_t fraction = this->ReadMappedUInt32(record + 4);
+      this->MappedHeader.ts.tv_sec = this->ReadMappedUInt32(record);
+      this->MappedHeader.ts.tv_usec = this->MappedNanoSecond ? fraction / 1000 : fraction;
+      if (this->SetMappedPacket(record + recordHeaderSize, caplen,
+            this->ReadMappedUInt32(record + 12), this->FrameHeaderLength, data, dataLength,
+            timeSinceStart, headerReference, dataHeaderLength))
+      {
+        return true;
+      }
+    }
+
+    this->CloseFile();
+    return false;
+  }
+
+  // Fill the NextPacket outputs with a captured packet, whose timestamp has already been set in
+  // MappedHeader. Only IPv4 UDP packets are kept, as the "udp [dst port N]" filter of the
+  // libpcap backend does
+  bool SetMappedPacket(const unsigned char* packet, boost::uint32_t caplen, boost::uint32_t len,
+    unsigned int frameHeaderLength, const unsigned char*& data, unsigned int& dataLength,
+    double& timeSinceStart, pcap_pkthdr** headerReference, unsigned int* dataHeaderLength)
+  {
+    const unsigned int ipv4MinHeaderLength = 20;
+    const unsigned int udpHeaderLength = 8;
+    const unsigned char udpProtocol = 17;
+    if (caplen < frameHeaderLength + ipv4MinHeaderLength + udpHeaderLength)
+    {
+      return false;
+    }
+    const unsigned char* ipHeader = packet + frameHeaderLength;
+    if ((ipHeader[0] >> 4) != 4 || ipHeader[9] != udpProtocol)
+    {
+      return false;
+    }
+    const unsigned int ipHeaderLength = (ipHeader[0] & 0xf) * 4;
+    const unsigned int bytesToSkip = frameHeaderLength + ipHeaderLength + udpHeaderLength;
+    if (caplen < bytesToSkip)
+    {
+      return false;
+    }
+    const unsigned char* udpHeader = ipHeader + ipHeaderLength;
+    if (this->DestinationPort != 0 &&
+      ((udpHeader[2] << 8) | udpHeader[3]) != this->DestinationPort)
+    {
+      return false;
+    }
+
+    this->PacketIPHeader = ipHeader;
+    this->MappedHeader.caplen = caplen;
+    this->MappedHeader.len = len;
+
+    dataLength = this->MappedHeader.len - bytesToSkip;
+    if (this->MappedHeader.len > this->MappedHeader.caplen)
+      dataLength = this->MappedHeader.caplen - bytesToSkip;
+    data = packet + bytesToSkip;
+    timeSinceStart = GetElapsedTime(this->MappedHeader.ts, this->StartTime);
+
+    if (headerReference != NULL && dataHeaderLength != NULL)
+    {
+      *headerReference = &this->MappedHeader;
+      *dataHeaderLength = bytesToSkip;
+    }
+    return true;
+  }
+
+  // pcapng support, see https://github.com/pcapng/pcapng
+  // Only the interfaces and the packets (enhanced and obsolete packet blocks) are read. Simple
+  // packet blocks are skipped as they have no timestamp.
+  static const boost::uint32_t PcapNgSectionHeaderBlock = 0x0a0d0d0a;
+  static const boost::uint32_t PcapNgInterfaceDescriptionBlock = 1;
+  static const boost::uint32_t PcapNgObsoletePacketBlock = 2;
+  static const boost::uint32_t PcapNgSimplePacketBlock = 3;
+  static const boost::uint32_t PcapNgEnhancedPacketBlock = 6;
+
+  // Parse the section header block located at MappedOffset: set the byte order of the section
+  // and forget the interfaces of the previous section
+  bool ReadPcapNgSectionHeader()
+  {
+    const size_t minBlockLength = 28;
+    if (this->MappedOffset + minBlockLength > this->MappedFile.size())
+    {
+      this->LastError = "Truncated pcapng section header.";
+      return false;
+    }
+    const unsigned char* block =
+      reinterpret_cast<const unsigned char*>(this->MappedFile.data()) + this->MappedOffset;
+    boost::uint32_t byteOrderMagic;
+    std::memcpy(&byteOrderMagic, block + 8, sizeof(byteOrderMagic));
+    switch (byteOrderMagic)
+    {
+      case 0x1a2b3c4d: this->MappedSwapped = false; break;
+      case 0x4d3c2b1a: this->MappedSwapped = true;  break;
+      default:
+        this->LastError = "Invalid byte order in pcapng section header.";
+        return false;
+    }
+    if (this->ReadMappedUInt16(block + 12) != 1)
+    {
+      this->LastError = "Unsupported pcapng version.";
+      return false;
+    }
+    this->MappedInterfaces.clear();
+    return true;
+  }
+
+  // Parse an interface description block, an interface whose packets cannot be read is still
+  // added as the packets refer to the interfaces by index
+  void AddPcapNgInterface(const unsigned char* block, boost::uint32_t blockLength)
+  {
+    const unsigned int loopback_header_size = 4;
+    const unsigned int ethernet_header_size = 14;
+    const boost::uint16_t endOfOptions = 0;
+    const boost::uint16_t timestampResolutionOption = 9;
+    const boost::uint16_t timestampOffsetOption = 14;
+
+    PcapNgInterface description;
+    switch (this->ReadMappedUInt16(block + 8))
+    {
+      case DLT_EN10MB:
+        description.FrameHeaderLength = ethernet_header_size;
+        break;
+      case DLT_NULL:
+        description.FrameHeaderLength = loopback_header_size;
+        break;
+      default:
+        description.FrameHeaderLength = 0;
+        break;
+    }
+
+    // options are located between the fixed fields and the trailing block length
+    size_t position = 16;
+    while (position + 4 <= blockLength - 4)
+    {
+      const boost::uint16_t code = this->ReadMappedUInt16(block + position);
+      const boost::uint16_t length = this->ReadMappedUInt16(block + position + 2);
+      const unsigned char* value = block + position + 4;
+      if (code == endOfOptions || position + 4 + length > blockLength - 4)
+      {
+        break;
+      }
+      if (code == timestampResolutionOption && length >= 1)
+      {
+        // the most significant bit tells if the resolution is a power of 2 or 10
+        const unsigned int exponent = value[0] & 0x7f;
+        const boost::uint64_t base = (value[0] & 0x80) ? 2 : 10;
+        description.UnitsPerSecond = 1;
+        for (unsigned int i = 0; i < exponent && description.UnitsPerSecond != 0; ++i)
+        {
+          const boost::uint64_t units = description.UnitsPerSecond * base;
+          // too fine to be represented
+          description.UnitsPerSecond = units / base == description.UnitsPerSecond ? units : 0;
+        }
+      }
+      else if (code == timestampOffsetOption && length >= 8)
+      {
+        description.SecondOffset = static_cast<boost::int64_t>(this->ReadMappedUInt64(value));
+      }
+      position += 4 + ((length + 3) & ~3u);
+    }
+    if (description.UnitsPerSecond == 0)
+    {
+      description.FrameHeaderLength = 0;
+    }
+    this->MappedInterfaces.push_back(description);
+  }
+
+  // Check that the block located at a given offset is consistent, its total length is stored
+  // at both ends
+  bool GetPcapNgBlockLength(size_t offset, boost::uint32_t& blockLength)
+  {
+    const size_t fileSize = this->MappedFile.size();
+    if (offset + 12 > fileSize)
+    {
+      return false;
+    }
+    const unsigned char* block =
+      reinterpret_cast<const unsigned char*>(this->MappedFile.data()) + offset;
+    blockLength = this->ReadMappedUInt32(block + 4);
+    return blockLength >= 12 && blockLength % 4 == 0 && offset + blockLength <= fileSize &&
+      this->ReadMappedUInt32(block + blockLength - 4) == blockLength;
+  }
+
+  // Parse the section header and the interfaces declared before the first packet, so that
+  // the file can be read from any packet block of the first section
+  bool OpenMappedPcapNg()
+  {
+    this->MappedOffset = 0;
+    if (!this->ReadPcapNgSectionHeader())
+    {
+      return false;
+    }
+
+    const unsigned char* file = reinterpret_cast<const unsigned char*>(this->MappedFile.data());
+    boost::uint32_t blockLength = 0;
+    if (!this->GetPcapNgBlockLength(0, blockLength))
+    {
+      this->LastError = "Truncated pcapng section header.";
+      return false;
+    }
+    this->MappedOffset = blockLength;
+    while (this->GetPcapNgBlockLength(this->MappedOffset, blockLength))
+    {
+      const unsigned char* block = file + this->MappedOffset;
+      const boost::uint32_t type = this->ReadMappedUInt32(block);
+      if (type == PcapNgInterfaceDescriptionBlock)
+      {
+        this->AddPcapNgInterface(block, blockLength);
+      }
+      else if (type == PcapNgSectionHeaderBlock || type == PcapNgObsoletePacketBlock ||
+        type == PcapNgSimplePacketBlock || type == PcapNgEnhancedPacketBlock)
+      {
+        break;
+      }
+      this->MappedOffset += blockLength;
+    }
+    return true;
+  }
+
+  bool NextMappedPcapNgPacket(const unsigned char*& data, unsigned int& dataLength,
+    double& timeSinceStart, pcap_pkthdr** headerReference, unsigned int* dataHeaderLength)
+  {
+    const size_t packetBlockFixedLength = 32;
+    const unsigned char* file = reinterpret_cast<const unsigned char*>(this->MappedFile.data());
+
+    while (this->MappedOffset + 12 <= this->MappedFile.size())
+    {
+      const unsigned char* block = file + this->MappedOffset;
+      boost::uint32_t type;
+      std::memcpy(&type, block, sizeof(type));
+      // a new section can change the byte order, which is needed to read the block length
+      if (type == PcapNgSectionHeaderBlock && !this->ReadPcapNgSectionHeader())
+      {
+        break;
+      }
+      type = this->ReadMappedUInt32(block);
+      boost::uint32_t blockLength = 0;
+      if (!this->GetPcapNgBlockLength(this->MappedOffset, blockLength))
+      {
+        // truncated or corrupted last block
+        break;
+      }
+      this->MappedOffset += blockLength;
+
+      if (type == PcapNgInterfaceDescriptionBlock)
+      {
+        this->AddPcapNgInterface(block, blockLength);
+        continue;
+      }
+      if ((type != PcapNgEnhancedPacketBlock && type != PcapNgObsoletePacketBlock) ||
+        blockLength < packetBlockFixedLength)
+      {
+        continue;
+      }
+
+      // both blocks have the same layout, except that the obsolete one also stores a drop
+      // count in the upper half of the interface id
+      const boost::uint32_t interfaceId = type == PcapNgEnhancedPacketBlock
+        ? this->ReadMappedUInt32(block + 8)
+        : this->ReadMappedUInt16(block + 8);
+      const boost::uint32_t caplen = this->ReadMappedUInt32(block + 20);
+      if (interfaceId >= this->MappedInterfaces.size() ||
+        this->MappedInterfaces[interfaceId].FrameHeaderLength == 0 ||
+        caplen > blockLength - packetBlockFixedLength)
+      {
+        continue;
+      }
+      const PcapNgInterface& description = this->MappedInterfaces[interfaceId];
+      const boost::uint64_t timestamp =
+        (static_cast<boost::uint64_t>(this->ReadMappedUInt32(block + 12)) << 32) |
+        this->ReadMappedUInt32(block + 16);
+      this->MappedHeader.ts.tv_sec =
+        static_cast<long>(timestamp / description.UnitsPerSecond + description.SecondOffset);
+      this->MappedHeader.ts.tv_usec = static_cast<long>(
+        static_cast<double>(timestamp % description.UnitsPerSecond) * 1e6 / description.UnitsPerSecond);
+      if (this->SetMappedPacket(block + 28, caplen, this->ReadMappedUInt32(block + 24),
+            description.FrameHeaderLength, data, dataLength, timeSinceStart, headerReference,
+            dataHeaderLength))
+      {
+        return true;
+      }
+    }
+
+    this->CloseFile();
+    return false;
+  }
+
+  // pcapng blocks are 32 bits aligned and store their length at both ends, which makes them
+  // easy to recognize
+  bool FindPcapNgBlockBoundary(boost::uint64_t offset, boost::uint64_t& boundary)
+  {
+    const int chainLength = 16;
+    const size_t maxSearchLength = 1 << 20;
+    const size_t fileSize = this->MappedFile.size();
+    size_t candidate = (static_cast<size_t>(offset) + 3) & ~static_cast<size_t>(3);
+    for (; candidate < fileSize && candidate - offset < maxSearchLength; candidate += 4)
+    {
+      size_t position = candidate;
+      int validBlocks = 0;
+      boost::uint32_t blockLength = 0;
+      while (validBlocks < chainLength && this->GetPcapNgBlockLength(position, blockLength))
+      {
+        position += blockLength;
+        validBlocks++;
+      }
+      if (validBlocks == chainLength || (validBlocks > 0 && position == fileSize))
+      {
+        boundary = candidate;
+        return true;
+      }
+    }
+    return false;
+  }
+
   pcap_t* PCAPFile;
+  //! current file, and files of the sequence
   std::string FileName;
+  std::vector<std::string> FileNames;
+  size_t FileIndex = 0;
+  bool UseMemoryMapping = false;
+  //! IP header of the last packet returned, see GetPacketSource
+  const unsigned char* PacketIPHeader = nullptr;
   std::string LastError;
   struct timeval StartTime;
   unsigned int FrameHeaderLength;
+  unsigned short DestinationPort = 0;
+
+  // memory mapped backend
+  boost::iostreams::mapped_file_source MappedFile;
+  size_t MappedOffset = 0;
+  bool MappedSwapped = false;
+  bool MappedNanoSecond = false;
+  boost::uint32_t MappedSnapLength = 0;
+  boost::int64_t MappedFirstSecond = 0;
+  pcap_pkthdr MappedHeader;
+
+  struct PcapNgInterface
+  {
+    //! 0 if the link type is not supported, the packets of this interface are then skipped
+    unsigned int FrameHeaderLength = 0;
+    //! timestamp resolution, microseconds by default
+    boost::uint64_t UnitsPerSecond = 1000000;
+    boost::int64_t SecondOffset = 0;
+  };
+  bool MappedPcapNg = false;
+  std::vector<PcapNgInterface> MappedInterfaces;
 };
 
 #endif
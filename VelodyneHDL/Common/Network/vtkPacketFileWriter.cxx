@@ -35,8 +35,40 @@ int gettimeofday(struct timeval* tp, void*)
 
 #endif
 
+#include <boost/cstdint.hpp>
+
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
 
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+namespace
+{
+// pcap file header, see https://wiki.wireshark.org/Development/LibpcapFileFormat
+struct FileHeader
+{
+  boost::uint32_t Magic;
+  boost::uint16_t VersionMajor;
+  boost::uint16_t VersionMinor;
+  boost::int32_t ThisZone;
+  boost::uint32_t SigFigs;
+  boost::uint32_t SnapLength;
+  boost::uint32_t LinkType;
+};
+
+// pcap record header as stored in the file, whatever the size of timeval on the platform
+struct FileRecordHeader
+{
+  boost::uint32_t Second;
+  boost::uint32_t MicroSecond;
+  boost::uint32_t CapturedLength;
+  boost::uint32_t Length;
+};
+}
+
 //--------------------------------------------------------------------------------
 const unsigned short vtkPacketFileWriter::LidarPacketHeader[21] = {
   // 14 bytes ethernet header
@@ -82,6 +114,9 @@ vtkPacketFileWriter::vtkPacketFileWriter()
 {
   this->PCAPFile = 0;
   this->PCAPDump = 0;
+  this->BufferedFile = 0;
+  this->BufferSize = 0;
+  this->BufferedFileLength = 0;
 }
 
 //--------------------------------------------------------------------------------
@@ -93,7 +128,30 @@ vtkPacketFileWriter::~vtkPacketFileWriter()
 //--------------------------------------------------------------------------------
 bool vtkPacketFileWriter::Open(const std::string& filename)
 {
-  this->PCAPFile = pcap_open_dead(DLT_EN10MB, 65535);
+  const int snapLength = 65535;
+  this->PCAPFile = pcap_open_dead(DLT_EN10MB, snapLength);
+  if (this->BufferSize > 0)
+  {
+    // the records are written by ourself, libpcap is only used to get the error messages
+    this->BufferedFile = fopen(filename.c_str(), "wb");
+    FileHeader header = { 0xa1b2c3d4, 2, 4, 0, 0, snapLength, DLT_EN10MB };
+    if (!this->BufferedFile || fwrite(&header, sizeof(header), 1, this->BufferedFile) != 1)
+    {
+      this->LastError = "Failed to open " + filename + " for writing";
+      if (this->BufferedFile)
+      {
+        fclose(this->BufferedFile);
+        this->BufferedFile = 0;
+      }
+      pcap_close(this->PCAPFile);
+      this->PCAPFile = 0;
+      return false;
+    }
+    this->BufferedFileLength = sizeof(header);
+    this->FileName = filename;
+    return true;
+  }
+
   this->PCAPDump = pcap_dump_open(this->PCAPFile, filename.c_str());
 
   if (!this->PCAPDump)
@@ -118,7 +176,16 @@ void vtkPacketFileWriter::Close()
 {
   if (this->PCAPFile)
   {
-    pcap_dump_close(this->PCAPDump);
+    if (this->BufferedFile)
+    {
+      this->Flush();
+      fclose(this->BufferedFile);
+      this->BufferedFile = 0;
+    }
+    else
+    {
+      pcap_dump_close(this->PCAPDump);
+    }
     pcap_close(this->PCAPFile);
     this->PCAPFile = 0;
     this->PCAPDump = 0;
@@ -141,6 +208,15 @@ const std::string& vtkPacketFileWriter::GetFileName()
 //--------------------------------------------------------------------------------
 // Write an UDP packet from the data (without providing a header, so we construct it)
 bool vtkPacketFileWriter::WritePacket(const unsigned char* data, unsigned int dataLength)
+{
+  struct timeval currentTime;
+  gettimeofday(&currentTime, NULL);
+  return this->WritePacket(data, dataLength, currentTime);
+}
+
+//--------------------------------------------------------------------------------
+bool vtkPacketFileWriter::WritePacket(
+  const unsigned char* data, unsigned int dataLength, const timeval& time)
 {
   if (!this->PCAPFile)
   {
@@ -161,12 +237,20 @@ bool vtkPacketFileWriter::WritePacket(const unsigned char* data, unsigned int da
   }
   header.caplen = dataLength + 42;
   header.len = dataLength + 42;
-  packetBuffer.resize(header.len);
+  header.ts = time;
 
-  struct timeval currentTime;
-  gettimeofday(&currentTime, NULL);
-  header.ts = currentTime;
+  if (this->BufferedFile)
+  {
+    unsigned char packetHeader[42];
+    memcpy(packetHeader, headerData, 42);
+    packetHeader[2 * 8] = ((dataLength + 28) & 0xFF00) >> 8;
+    packetHeader[2 * 8 + 1] = ((dataLength + 28) & 0x00FF) >> 0;
+    packetHeader[2 * 19] = ((dataLength + 8) & 0xFF00) >> 8;
+    packetHeader[2 * 19 + 1] = ((dataLength + 8) & 0x00FF) >> 0;
+    return this->BufferPacket(&header, packetHeader, 42, data, dataLength);
+  }
 
+  packetBuffer.resize(header.len);
   memcpy(&(packetBuffer[0]), headerData, 42);
   memcpy(&(packetBuffer[0]) + 42, data, dataLength);
   // There is no Ethernet-frame length field to fill
@@ -186,6 +270,100 @@ bool vtkPacketFileWriter::WritePacket(const unsigned char* data, unsigned int da
 // Write an packet from packetHeader and packetData (which includes the packet header)
 bool vtkPacketFileWriter::WritePacket(pcap_pkthdr* packetHeader, unsigned char* packetData)
 {
+  if (this->BufferedFile)
+  {
+    return this->BufferPacket(packetHeader, packetData, packetHeader->caplen, NULL, 0);
+  }
   pcap_dump((u_char*)this->PCAPDump, packetHeader, packetData);
   return true;
 }
+
+//--------------------------------------------------------------------------------
+void vtkPacketFileWriter::SetBufferSize(size_t bufferSize)
+{
+  this->BufferSize = bufferSize;
+}
+
+//--------------------------------------------------------------------------------
+size_t vtkPacketFileWriter::GetBufferSize()
+{
+  return this->BufferSize;
+}
+
+//--------------------------------------------------------------------------------
+bool vtkPacketFileWriter::BufferPacket(const pcap_pkthdr* packetHeader,
+  const unsigned char* header, unsigned int headerLength, const unsigned char* data,
+  unsigned int dataLength)
+{
+  if (!this->BufferedFile)
+  {
+    return false;
+  }
+
+  const size_t recordLength = sizeof(FileRecordHeader) + headerLength + dataLength;
+  if (this->Buffer.size() + recordLength > this->BufferSize && !this->Flush())
+  {
+    return false;
+  }
+  this->Buffer.reserve(this->BufferSize);
+
+  FileRecordHeader record;
+  record.Second = static_cast<boost::uint32_t>(packetHeader->ts.tv_sec);
+  record.MicroSecond = static_cast<boost::uint32_t>(packetHeader->ts.tv_usec);
+  record.CapturedLength = headerLength + dataLength;
+  record.Length = std::max(packetHeader->len, record.CapturedLength);
+
+  const unsigned char* recordData = reinterpret_cast<const unsigned char*>(&record);
+  this->Buffer.insert(this->Buffer.end(), recordData, recordData + sizeof(record));
+  this->Buffer.insert(this->Buffer.end(), header, header + headerLength);
+  if (dataLength > 0)
+  {
+    this->Buffer.insert(this->Buffer.end(), data, data + dataLength);
+  }
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+bool vtkPacketFileWriter::Flush()
+{
+  if (!this->BufferedFile)
+  {
+    return this->PCAPDump && pcap_dump_flush(this->PCAPDump) == 0;
+  }
+
+  bool success = true;
+  if (!this->Buffer.empty())
+  {
+    success = fwrite(&this->Buffer[0], 1, this->Buffer.size(), this->BufferedFile) ==
+      this->Buffer.size();
+    this->BufferedFileLength += this->Buffer.size();
+    this->Buffer.clear();
+  }
+  success = fflush(this->BufferedFile) == 0 && success;
+  if (!success)
+  {
+    this->LastError = "Failed to write packets to " + this->FileName;
+    return false;
+  }
+
+#if defined(__linux__)
+  // a recording is not read back soon, do not let it evict the rest of the page cache
+  posix_fadvise(fileno(this->BufferedFile), 0, 0, POSIX_FADV_DONTNEED);
+#endif
+  return true;
+}
+
+//--------------------------------------------------------------------------------
+boost::uint64_t vtkPacketFileWriter::GetFileOffset()
+{
+  if (this->BufferedFile)
+  {
+    return this->BufferedFileLength + this->Buffer.size();
+  }
+  if (!this->PCAPDump)
+  {
+    return 0;
+  }
+  const long offset = pcap_dump_ftell(this->PCAPDump);
+  return offset > 0 ? static_cast<boost::uint64_t>(offset) : 0;
+}
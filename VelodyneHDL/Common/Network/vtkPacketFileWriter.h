@@ -33,6 +33,8 @@
 #define __vtkPacketFileWriter_h
 
 #include <pcap.h>
+#include <boost/cstdint.hpp>
+#include <cstdio>
 #include <string>
 #include <vector>
 
@@ -61,14 +63,41 @@ public:
 
   bool WritePacket(const unsigned char* data, unsigned int dataLength);
 
+  // Same as above, stamping the packet with the given time instead of the current time
+  bool WritePacket(const unsigned char* data, unsigned int dataLength, const timeval& time);
+
   bool WritePacket(pcap_pkthdr* packetHeader, unsigned char* packetData);
 
+  // Coalesce the packets in a buffer of this size before writing them to the disk, so that
+  // there is a single large write instead of one per packet. 0, the default, writes each
+  // packet through libpcap as soon as it is given. This must be set before Open.
+  void SetBufferSize(size_t bufferSize);
+
+  size_t GetBufferSize();
+
+  // Write the buffered packets to the disk
+  bool Flush();
+
+  // Offset in the file of the next packet written, the buffered packets are counted
+  boost::uint64_t GetFileOffset();
+
 protected:
+  // Add a pcap record made of a header followed by some data to the buffer
+  bool BufferPacket(const pcap_pkthdr* packetHeader, const unsigned char* header,
+    unsigned int headerLength, const unsigned char* data, unsigned int dataLength);
+
   pcap_t* PCAPFile;
   pcap_dumper_t* PCAPDump;
+  // file written directly when the packets are buffered
+  FILE* BufferedFile;
 
   std::string FileName;
   std::string LastError;
+
+  size_t BufferSize;
+  std::vector<unsigned char> Buffer;
+  // length of BufferedFile, without the packets in Buffer
+  boost::uint64_t BufferedFileLength;
 };
 
 #endif
@@ -14,42 +14,112 @@
 
 #include "vvPacketSender.h"
 
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+#include <cstring>
+#include <limits>
+
 //-----------------------------------------------------------------------------
 vvPacketSender::vvPacketSender(
   std::string pcapfile, std::string destinationIp, int lidarPort, int positionPort)
-  : LIDARSocket(0)
+  : Socket(IOService)
+  , LIDAREndpoint(boost::asio::ip::address_v4::from_string(destinationIp), lidarPort)
+  , PositionEndpoint(boost::asio::ip::address_v4::from_string(destinationIp), positionPort)
+  , KeepDestinationPorts(false)
+  , StartTime(0)
+  , Done(false)
+  , PacketCount(0)
+{
+  this->Initialize(std::vector<std::string>(1, pcapfile));
+}
+
+//-----------------------------------------------------------------------------
+vvPacketSender::vvPacketSender(const std::vector<std::string>& pcapfiles,
+  std::string destinationIp, int lidarPort, int positionPort)
+  : Socket(IOService)
   , LIDAREndpoint(boost::asio::ip::address_v4::from_string(destinationIp), lidarPort)
-  , PositionSocket(0)
   , PositionEndpoint(boost::asio::ip::address_v4::from_string(destinationIp), positionPort)
-  , PacketReader(0)
+  , KeepDestinationPorts(false)
+  , StartTime(0)
   , Done(false)
   , PacketCount(0)
 {
-  this->PacketReader = new vtkPacketFileReader;
-  this->PacketReader->Open(pcapfile);
-  if (!this->PacketReader->IsOpen())
+  this->Initialize(pcapfiles);
+}
+
+//-----------------------------------------------------------------------------
+vvPacketSender::~vvPacketSender()
+{
+}
+
+//-----------------------------------------------------------------------------
+void vvPacketSender::Initialize(const std::vector<std::string>& pcapfiles)
+{
+  this->StartTime = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < pcapfiles.size(); ++i)
   {
-    throw std::runtime_error("Unable to open packet file");
+    std::unique_ptr<Input> input(new Input);
+    // the packets are read from the mapping, without libpcap
+    input->Reader.Open(pcapfiles[i], true);
+    if (!input->Reader.IsOpen())
+    {
+      throw std::runtime_error("Unable to open packet file");
+    }
+    if (this->ReadNextPacket(*input))
+    {
+      this->StartTime = std::min(this->StartTime, input->Time);
+      this->Inputs.push_back(std::move(input));
+    }
   }
+  this->Done = this->Inputs.empty();
 
-  this->LIDARSocket = new boost::asio::ip::udp::socket(this->IOService);
-  this->LIDARSocket->open(this->LIDAREndpoint.protocol());
-  this->LIDARSocket->set_option(boost::asio::ip::udp::socket::reuse_address(true));
+  this->Socket.open(this->LIDAREndpoint.protocol());
+  this->Socket.set_option(boost::asio::ip::udp::socket::reuse_address(true));
   // Allow to send the packet on the same machine
-  this->LIDARSocket->set_option(boost::asio::ip::multicast::enable_loopback(true));
+  this->Socket.set_option(boost::asio::ip::multicast::enable_loopback(true));
+}
 
-  this->PositionSocket = new boost::asio::ip::udp::socket(this->IOService);
-  this->PositionSocket->open(this->PositionEndpoint.protocol());
-  this->PositionSocket->set_option(boost::asio::ip::udp::socket::reuse_address(true));
-  // Allow to send the packet on the same machine
-  this->PositionSocket->set_option(boost::asio::ip::multicast::enable_loopback(true));
+//-----------------------------------------------------------------------------
+bool vvPacketSender::ReadNextPacket(Input& input)
+{
+  double timeSinceStart = 0;
+  pcap_pkthdr* header = 0;
+  unsigned int dataHeaderLength = 0;
+  if (!input.Reader.NextPacket(
+        input.Data, input.DataLength, timeSinceStart, &header, &dataHeaderLength))
+  {
+    input.Data = nullptr;
+    return false;
+  }
+  input.Time = header->ts.tv_sec + header->ts.tv_usec * 1e-6;
+  // the UDP header is just before the data
+  const unsigned char* udpHeader = input.Data - 8;
+  input.DestinationPort = static_cast<unsigned short>((udpHeader[2] << 8) | udpHeader[3]);
+  return true;
 }
 
 //-----------------------------------------------------------------------------
-vvPacketSender::~vvPacketSender()
+vvPacketSender::Input* vvPacketSender::GetNextInput() const
 {
-  delete this->LIDARSocket;
-  delete this->PositionSocket;
+  Input* next = nullptr;
+  for (size_t i = 0; i < this->Inputs.size(); ++i)
+  {
+    Input* input = this->Inputs[i].get();
+    if (input->Data && (!next || input->Time < next->Time))
+    {
+      next = input;
+    }
+  }
+  return next;
+}
+
+//-----------------------------------------------------------------------------
+double vvPacketSender::GetNextPacketTime() const
+{
+  const Input* next = this->GetNextInput();
+  return next ? next->Time - this->StartTime : std::numeric_limits<int>::max();
 }
 
 //-----------------------------------------------------------------------------
@@ -60,31 +130,82 @@ double vvPacketSender::pumpPacket()
     return std::numeric_limits<int>::max();
   }
 
-  // some return value
-  const unsigned char* data = 0;
-  unsigned int dataLength = 0;
-  double timeSinceStart = 0;
+  const double time = this->GetNextPacketTime();
+  this->pumpPackets(time);
+  return time;
+}
+
+//-----------------------------------------------------------------------------
+size_t vvPacketSender::pumpPackets(double untilTime)
+{
+  size_t numberOfPackets = 0;
+  size_t batchSize = 0;
+  Input* input = this->GetNextInput();
+  while (input && input->Time - this->StartTime <= untilTime)
+  {
+    this->BatchData[batchSize].assign(input->Data, input->Data + input->DataLength);
+    if (this->KeepDestinationPorts)
+    {
+      this->BatchEndpoint[batchSize] =
+        boost::asio::ip::udp::endpoint(this->LIDAREndpoint.address(), input->DestinationPort);
+    }
+    else
+    {
+      // Position packet
+      this->BatchEndpoint[batchSize] =
+        input->DataLength == 512 ? this->PositionEndpoint : this->LIDAREndpoint;
+    }
+    batchSize++;
+    if (batchSize == SEND_BATCH_SIZE)
+    {
+      this->SendBatch(batchSize);
+      numberOfPackets += batchSize;
+      batchSize = 0;
+    }
 
-  // Get the next packet
-  if (!this->PacketReader->NextPacket(data, dataLength, timeSinceStart))
+    this->ReadNextPacket(*input);
+    input = this->GetNextInput();
+  }
+  this->SendBatch(batchSize);
+  numberOfPackets += batchSize;
+
+  this->PacketCount += numberOfPackets;
+  this->Done = input == nullptr;
+  return numberOfPackets;
+}
+
+//-----------------------------------------------------------------------------
+void vvPacketSender::SendBatch(size_t count)
+{
+#ifdef __linux__
+  mmsghdr messages[SEND_BATCH_SIZE];
+  iovec buffers[SEND_BATCH_SIZE];
+  std::memset(messages, 0, sizeof(messages));
+  for (size_t i = 0; i < count; ++i)
   {
-    this->Done = true;
-    return timeSinceStart;
+    buffers[i].iov_base = this->BatchData[i].data();
+    buffers[i].iov_len = this->BatchData[i].size();
+    messages[i].msg_hdr.msg_name = this->BatchEndpoint[i].data();
+    messages[i].msg_hdr.msg_namelen = static_cast<socklen_t>(this->BatchEndpoint[i].size());
+    messages[i].msg_hdr.msg_iov = &buffers[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
   }
 
-  // Position packet
-  if ((dataLength == 512))
+  size_t sent = 0;
+  while (sent < count)
   {
-    this->PositionSocket->send_to(
-      boost::asio::buffer(data, dataLength), this->PositionEndpoint);
+    const int result = sendmmsg(this->Socket.native_handle(), messages + sent,
+      static_cast<unsigned int>(count - sent), 0);
+    // a packet which cannot be sent is skipped
+    sent += result > 0 ? result : 1;
   }
-  else // Lidar packet
+#else
+  for (size_t i = 0; i < count; ++i)
   {
-    this->LIDARSocket->send_to(
-      boost::asio::buffer(data, dataLength), this->LIDAREndpoint);
+    this->Socket.send_to(
+      boost::asio::buffer(this->BatchData[i]), this->BatchEndpoint[i]);
   }
-  this->PacketCount++;
-  return timeSinceStart;
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include <string>
+#include <memory>
+#include <vector>
 #include <vtkSystemIncludes.h>
 
 #include "vtkPacketFileReader.h"
@@ -22,19 +24,52 @@
 
 class vtkPacketFileReader;
 
+/*!< Maximum number of packets sent at once, with sendmmsg on Linux */
+#define SEND_BATCH_SIZE 64
+
+/**
+ * \class vvPacketSender
+ * \brief Replay one or several captures on the network. The captures are mapped in memory and
+ *        their packets are merged by timestamp, so that several sensors recorded in different
+ *        files can be replayed together. The packets are sent by batches, see pumpPackets, so
+ *        that the replay keeps up with high packet rates.
+ */
 class VTK_EXPORT vvPacketSender
 {
 public:
   vvPacketSender(std::string pcapfile, std::string destinationio = "127.0.0.1",
     int lidarport = 2368, int positionport = 8308);
+  vvPacketSender(const std::vector<std::string>& pcapfiles,
+    std::string destinationio = "127.0.0.1", int lidarport = 2368, int positionport = 8308);
   ~vvPacketSender();
 
   /**
-   * @brief pumpPacket
-   * @return the timestamp of the packet send
+   * @brief SetKeepDestinationPorts if set, each packet is sent to the port it was sent to in
+   * the capture, instead of the lidar port or the position port guessed from its size. This
+   * enables to replay several sensors at once.
+   */
+  void SetKeepDestinationPorts(bool keep) { this->KeepDestinationPorts = keep; }
+
+  /**
+   * @brief pumpPacket send the next packet, with the packets captured at the same time
+   * @return the timestamp of the packet send, since the first packet of the captures
    */
   double pumpPacket();
 
+  /**
+   * @brief pumpPackets send all the packets captured until a given time, by batches of
+   * SEND_BATCH_SIZE
+   * @param untilTime time since the first packet of the captures, in seconds
+   * @return the number of packets sent
+   */
+  size_t pumpPackets(double untilTime);
+
+  /**
+   * @brief GetNextPacketTime time of the next packet to send, since the first packet of the
+   * captures, in seconds
+   */
+  double GetNextPacketTime() const;
+
   /**
    * @copydoc Done
    */
@@ -46,15 +81,42 @@ public:
   size_t GetPacketCount() const;
 
 private:
-  boost::asio::ip::udp::socket* LIDARSocket;
-  boost::asio::ip::udp::endpoint LIDAREndpoint;
+  //! A capture, with its next packet which points in the mapped file
+  struct Input
+  {
+    vtkPacketFileReader Reader;
+    const unsigned char* Data = nullptr;
+    unsigned int DataLength = 0;
+    unsigned short DestinationPort = 0;
+    double Time = 0;
+  };
 
-  boost::asio::ip::udp::socket* PositionSocket;
-  boost::asio::ip::udp::endpoint PositionEndpoint;
+  void Initialize(const std::vector<std::string>& pcapfiles);
+
+  //! Read the next packet of an input, false at the end of the capture
+  bool ReadNextPacket(Input& input);
+
+  //! Input holding the oldest packet to send, null if all the packets have been sent
+  Input* GetNextInput() const;
+
+  //! Send the first count packets of the batch
+  void SendBatch(size_t count);
 
   boost::asio::io_service IOService;
+  boost::asio::ip::udp::socket Socket;
+  boost::asio::ip::udp::endpoint LIDAREndpoint;
+  boost::asio::ip::udp::endpoint PositionEndpoint;
+  bool KeepDestinationPorts;
+
+  std::vector<std::unique_ptr<Input> > Inputs;
+  //! Time of the first packet of the captures, since the epoch
+  double StartTime;
+
+  //! Packets of the batch being sent. They are copied as the reader unmaps the file once its
+  //! last packet is read.
+  std::vector<unsigned char> BatchData[SEND_BATCH_SIZE];
+  boost::asio::ip::udp::endpoint BatchEndpoint[SEND_BATCH_SIZE];
 
-  vtkPacketFileReader* PacketReader;
   //! Indicate if the end of the pcap file has been reach
   bool Done;
   //! Number of packet already send
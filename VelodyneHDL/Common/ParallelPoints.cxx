@@ -0,0 +1,100 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "ParallelPoints.h"
+
+// STD
+#include <algorithm>
+
+// BOOST
+#include <boost/thread/thread.hpp>
+
+//-----------------------------------------------------------------------------
+int GetNumberOfThreads(int numberOfThreads)
+{
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = static_cast<int>(boost::thread::hardware_concurrency());
+  }
+  return std::max(numberOfThreads, 1);
+}
+
+//-----------------------------------------------------------------------------
+int GetNumberOfPointRanges(int numberOfThreads, vtkIdType numberOfPoints)
+{
+  return std::max<int>(1, static_cast<int>(std::min<vtkIdType>(
+    GetNumberOfThreads(numberOfThreads), numberOfPoints / MinimumPointsPerRange)));
+}
+
+//-----------------------------------------------------------------------------
+void ParallelFor(
+  size_t count, int numberOfRanges, const std::function<void(size_t, size_t, size_t)>& function)
+{
+  numberOfRanges = static_cast<int>(std::max<size_t>(1, std::min<size_t>(numberOfRanges, count)));
+  const size_t rangeSize = (count + numberOfRanges - 1) / numberOfRanges;
+  boost::thread_group threads;
+  for (int range = 1; range < numberOfRanges; ++range)
+  {
+    threads.create_thread(std::bind(function, range, std::min(count, range * rangeSize),
+      std::min(count, (range + 1) * rangeSize)));
+  }
+  function(0, 0, std::min(count, rangeSize));
+  threads.join_all();
+}
+
+//-----------------------------------------------------------------------------
+PointCoordinates::PointCoordinates(vtkPoints* points)
+  : Array(points->GetData())
+{
+  if (this->Array->HasStandardMemoryLayout() && this->Array->GetNumberOfComponents() == 3)
+  {
+    if (this->Array->GetDataType() == VTK_FLOAT)
+    {
+      this->Floats = static_cast<const float*>(this->Array->GetVoidPointer(0));
+    }
+    else if (this->Array->GetDataType() == VTK_DOUBLE)
+    {
+      this->Doubles = static_cast<const double*>(this->Array->GetVoidPointer(0));
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+ArrayComponent::ArrayComponent(vtkDataArray* array, int component)
+  : Array(array)
+  , Component(component)
+{
+  if (!array || !array->HasStandardMemoryLayout())
+  {
+    return;
+  }
+  switch (array->GetDataType())
+  {
+    case VTK_UNSIGNED_CHAR:
+    case VTK_UNSIGNED_SHORT:
+    case VTK_UNSIGNED_INT:
+    case VTK_FLOAT:
+    case VTK_DOUBLE:
+      this->DataType = array->GetDataType();
+      this->NumberOfComponents = array->GetNumberOfComponents();
+      this->Data = array->GetVoidPointer(0);
+      break;
+    default:
+      break;
+  }
+}
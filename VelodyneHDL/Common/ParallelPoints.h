@@ -0,0 +1,158 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PARALLEL_POINTS_H
+#define PARALLEL_POINTS_H
+
+// VTK
+#include <vtkDataArray.h>
+#include <vtkPoints.h>
+#include <vtkType.h>
+
+// STD
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/**
+ * Helpers for the filters processing the points of a frame on several threads, see
+ * vtkProcessingSample for an example. The points are split in contiguous ranges, one per
+ * thread, each range having its own accumulator which the calling thread combines in the
+ * order of the ranges, so that the result does not depend on the scheduling. The arrays the
+ * filter does not change are passed to the output with ShallowCopy, without copying them.
+ */
+
+//! Points processed by a range at least, so that the threads are worth starting
+const vtkIdType MinimumPointsPerRange = 65536;
+
+//! The number of threads of a filter, one per core if it is 0 or less
+int GetNumberOfThreads(int numberOfThreads);
+
+//! Number of ranges the points are split in, at least MinimumPointsPerRange points per range
+int GetNumberOfPointRanges(int numberOfThreads, vtkIdType numberOfPoints);
+
+/**
+ * @brief ParallelFor split [0, count[ in ranges processed by several threads, the calling
+ * thread processing the first range. There are at most count ranges, and at least one.
+ * @param function gets the range index and the bounds of the range
+ */
+void ParallelFor(
+  size_t count, int numberOfRanges, const std::function<void(size_t, size_t, size_t)>& function);
+
+/**
+ * @brief ParallelReduce accumulate [0, count[ by ranges processed by several threads, each
+ * range in its own copy of identity, and combine the accumulators in the order of the ranges
+ * @param accumulate called as accumulate(accumulator, begin, end)
+ * @param combine called as combine(result, accumulator of the next range)
+ */
+template <typename Accumulator, typename Accumulate, typename Combine>
+Accumulator ParallelReduce(size_t count, int numberOfRanges, const Accumulator& identity,
+  const Accumulate& accumulate, const Combine& combine)
+{
+  numberOfRanges = numberOfRanges > 1 ? numberOfRanges : 1;
+  std::vector<Accumulator> accumulators(numberOfRanges, identity);
+  ParallelFor(count, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    accumulate(accumulators[range], begin, end);
+  });
+  Accumulator result = accumulators[0];
+  for (int range = 1; range < numberOfRanges; ++range)
+  {
+    combine(result, accumulators[range]);
+  }
+  return result;
+}
+
+/**
+ * \class PointCoordinates
+ * \brief Read the coordinates of the points from several threads without a virtual call per
+ *        point, the float and double arrays being read directly. Other arrays (ex:
+ *        vtkStridedFloatArray) are read with GetTuple.
+ */
+class PointCoordinates
+{
+public:
+  explicit PointCoordinates(vtkPoints* points);
+
+  void Get(vtkIdType pointIndex, double point[3]) const
+  {
+    if (this->Floats)
+    {
+      const float* coordinates = this->Floats + 3 * pointIndex;
+      point[0] = coordinates[0];
+      point[1] = coordinates[1];
+      point[2] = coordinates[2];
+    }
+    else if (this->Doubles)
+    {
+      const double* coordinates = this->Doubles + 3 * pointIndex;
+      point[0] = coordinates[0];
+      point[1] = coordinates[1];
+      point[2] = coordinates[2];
+    }
+    else
+    {
+      this->Array->GetTuple(pointIndex, point);
+    }
+  }
+
+private:
+  vtkDataArray* Array;
+  const float* Floats = nullptr;
+  const double* Doubles = nullptr;
+};
+
+/**
+ * \class ArrayComponent
+ * \brief Read a component of a point data array (ex: intensity, laser_id) from several
+ *        threads, the arrays of the types given by the interpreters being read directly.
+ *        A null array reads 0.
+ */
+class ArrayComponent
+{
+public:
+  explicit ArrayComponent(vtkDataArray* array, int component = 0);
+
+  double Get(vtkIdType index) const
+  {
+    const vtkIdType valueIndex = index * this->NumberOfComponents + this->Component;
+    switch (this->DataType)
+    {
+      case VTK_UNSIGNED_CHAR:
+        return static_cast<const unsigned char*>(this->Data)[valueIndex];
+      case VTK_UNSIGNED_SHORT:
+        return static_cast<const unsigned short*>(this->Data)[valueIndex];
+      case VTK_UNSIGNED_INT:
+        return static_cast<const unsigned int*>(this->Data)[valueIndex];
+      case VTK_FLOAT:
+        return static_cast<const float*>(this->Data)[valueIndex];
+      case VTK_DOUBLE:
+        return static_cast<const double*>(this->Data)[valueIndex];
+      default:
+        return this->Array ? this->Array->GetComponent(index, this->Component) : 0.;
+    }
+  }
+
+private:
+  vtkDataArray* Array;
+  int Component;
+  int NumberOfComponents = 1;
+  //! VTK_VOID if the values are not read directly
+  int DataType = VTK_VOID;
+  const void* Data = nullptr;
+};
+
+#endif // PARALLEL_POINTS_H
@@ -0,0 +1,357 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PointPickingTree.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// BOOST
+#include <boost/thread/thread.hpp>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+double Dot(const double a[3], const double b[3])
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+}
+
+//-----------------------------------------------------------------------------
+void PointPickingTree::Build(const float* coordinates, vtkIdType numberOfPoints,
+  int numberOfThreads)
+{
+  this->Depth = 0;
+  while ((numberOfPoints >> this->Depth) > LeafSize)
+  {
+    this->Depth++;
+  }
+  this->Nodes.assign((size_t(1) << (this->Depth + 1)) - 1, Node());
+
+  // the points are partitioned with their coordinates, instead of reading them through
+  // their index for each comparison
+  std::vector<Entry> entries(numberOfPoints);
+  for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    Entry& entry = entries[pointIndex];
+    std::copy(coordinates + 3 * pointIndex, coordinates + 3 * pointIndex + 3, entry.Coordinates);
+    entry.Id = pointIndex;
+  }
+
+  // the subtrees of the levels above parallelDepth are built by their own thread
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = static_cast<int>(boost::thread::hardware_concurrency());
+  }
+  int parallelDepth = 0;
+  while ((1 << parallelDepth) < numberOfThreads && parallelDepth < this->Depth)
+  {
+    parallelDepth++;
+  }
+  this->BuildNode(NodeRange{ 0, 0, numberOfPoints }, entries, parallelDepth);
+
+  this->Coordinates.resize(3 * static_cast<size_t>(numberOfPoints));
+  this->Ids.resize(numberOfPoints);
+  for (vtkIdType k = 0; k < numberOfPoints; ++k)
+  {
+    std::copy(entries[k].Coordinates, entries[k].Coordinates + 3, this->Coordinates.begin() + 3 * k);
+    this->Ids[k] = entries[k].Id;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PointPickingTree::BuildNode(const NodeRange& range, std::vector<Entry>& entries,
+  int parallelDepth)
+{
+  const size_t node = range.Index;
+  Node& bounds = this->Nodes[node];
+  std::fill(bounds.Min, bounds.Min + 3, std::numeric_limits<float>::max());
+  std::fill(bounds.Max, bounds.Max + 3, std::numeric_limits<float>::lowest());
+  for (vtkIdType k = range.Begin; k < range.End; ++k)
+  {
+    const float* point = entries[k].Coordinates;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      bounds.Min[axis] = std::min(bounds.Min[axis], point[axis]);
+      bounds.Max[axis] = std::max(bounds.Max[axis], point[axis]);
+    }
+  }
+  if (this->IsLeaf(node))
+  {
+    return;
+  }
+
+  // split at the median of the longest axis of the bounds of the points
+  int splitAxis = 0;
+  for (int axis = 1; axis < 3; ++axis)
+  {
+    if (bounds.Max[axis] - bounds.Min[axis] > bounds.Max[splitAxis] - bounds.Min[splitAxis])
+    {
+      splitAxis = axis;
+    }
+  }
+  const NodeRange left = range.Child(0);
+  const NodeRange right = range.Child(1);
+  std::nth_element(entries.begin() + left.Begin, entries.begin() + right.Begin,
+    entries.begin() + range.End, [splitAxis](const Entry& a, const Entry& b) {
+      return a.Coordinates[splitAxis] < b.Coordinates[splitAxis];
+    });
+
+  if (parallelDepth > 0)
+  {
+    boost::thread leftThread(
+      &PointPickingTree::BuildNode, this, left, boost::ref(entries), parallelDepth - 1);
+    this->BuildNode(right, entries, parallelDepth - 1);
+    leftThread.join();
+  }
+  else
+  {
+    this->BuildNode(left, entries, 0);
+    this->BuildNode(right, entries, 0);
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType PointPickingTree::Pick(const double origin[3], const double rayDirection[3],
+  double radius, double slope) const
+{
+  const double norm = std::sqrt(Dot(rayDirection, rayDirection));
+  if (this->Ids.empty() || norm == 0.)
+  {
+    return -1;
+  }
+  const double direction[3] = { rayDirection[0] / norm, rayDirection[1] / norm,
+    rayDirection[2] / norm };
+
+  vtkIdType picked = -1;
+  double pickedDistance = std::numeric_limits<double>::infinity();
+  std::vector<NodeRange> stack(1, NodeRange{ 0, 0, this->GetNumberOfPoints() });
+  while (!stack.empty())
+  {
+    const NodeRange range = stack.back();
+    const size_t node = range.Index;
+    stack.pop_back();
+    const Node& bounds = this->Nodes[node];
+
+    // the box grown by the radius of the cone at its farthest point must cross the ray,
+    // before the point already picked
+    double farthest = 0.;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      farthest += direction[axis] * ((direction[axis] > 0. ? bounds.Max[axis] : bounds.Min[axis])
+        - origin[axis]);
+    }
+    if (farthest < 0.)
+    {
+      continue;
+    }
+    const double margin = radius + slope * farthest;
+    double enter = 0.;
+    double exit = pickedDistance;
+    for (int axis = 0; axis < 3 && enter <= exit; ++axis)
+    {
+      const double min = bounds.Min[axis] - margin - origin[axis];
+      const double max = bounds.Max[axis] + margin - origin[axis];
+      if (direction[axis] == 0.)
+      {
+        if (min > 0. || max < 0.)
+        {
+          enter = exit + 1.;
+        }
+        continue;
+      }
+      double near = min / direction[axis];
+      double far = max / direction[axis];
+      if (near > far)
+      {
+        std::swap(near, far);
+      }
+      enter = std::max(enter, near);
+      exit = std::min(exit, far);
+    }
+    if (enter > exit)
+    {
+      continue;
+    }
+
+    if (!this->IsLeaf(node))
+    {
+      // the child closer to the origin is visited first
+      const size_t left = 2 * node + 1;
+      const size_t right = 2 * node + 2;
+      double leftCenter = 0., rightCenter = 0.;
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        leftCenter += direction[axis] * (this->Nodes[left].Min[axis] + this->Nodes[left].Max[axis]);
+        rightCenter += direction[axis] * (this->Nodes[right].Min[axis] + this->Nodes[right].Max[axis]);
+      }
+      stack.push_back(range.Child(leftCenter < rightCenter ? 1 : 0));
+      stack.push_back(range.Child(leftCenter < rightCenter ? 0 : 1));
+      continue;
+    }
+
+    const vtkIdType begin = range.Begin;
+    const vtkIdType end = range.End;
+    for (vtkIdType k = begin; k < end; ++k)
+    {
+      const float* point = &this->Coordinates[3 * k];
+      const double offset[3] = { point[0] - origin[0], point[1] - origin[1], point[2] - origin[2] };
+      const double distance = Dot(offset, direction);
+      if (distance < 0. || distance >= pickedDistance)
+      {
+        continue;
+      }
+      const double tolerance = radius + slope * distance;
+      if (Dot(offset, offset) - distance * distance <= tolerance * tolerance)
+      {
+        picked = this->Ids[k];
+        pickedDistance = distance;
+      }
+    }
+  }
+  return picked;
+}
+
+//-----------------------------------------------------------------------------
+void PointPickingTree::Select(const double* planes, int numberOfPlanes,
+  std::vector<vtkIdType>& ids) const
+{
+  ids.clear();
+  if (this->Ids.empty())
+  {
+    return;
+  }
+  std::vector<NodeRange> stack(1, NodeRange{ 0, 0, this->GetNumberOfPoints() });
+  while (!stack.empty())
+  {
+    const NodeRange range = stack.back();
+    const size_t node = range.Index;
+    stack.pop_back();
+    const Node& bounds = this->Nodes[node];
+
+    // the corner of the box the farthest along the normal of a plane is outside of it when
+    // the box is, the opposite corner is inside when the box is
+    bool isOutside = false;
+    bool isInside = true;
+    for (int plane = 0; plane < numberOfPlanes && !isOutside; ++plane)
+    {
+      const double* equation = planes + 4 * plane;
+      double farthest = equation[3];
+      double nearest = equation[3];
+      for (int axis = 0; axis < 3; ++axis)
+      {
+        farthest += equation[axis] * (equation[axis] > 0. ? bounds.Max[axis] : bounds.Min[axis]);
+        nearest += equation[axis] * (equation[axis] > 0. ? bounds.Min[axis] : bounds.Max[axis]);
+      }
+      isOutside = farthest < 0.;
+      isInside = isInside && nearest >= 0.;
+    }
+    if (isOutside)
+    {
+      continue;
+    }
+
+    const vtkIdType begin = range.Begin;
+    const vtkIdType end = range.End;
+    if (isInside)
+    {
+      ids.insert(ids.end(), this->Ids.begin() + begin, this->Ids.begin() + end);
+      continue;
+    }
+    if (!this->IsLeaf(node))
+    {
+      stack.push_back(range.Child(1));
+      stack.push_back(range.Child(0));
+      continue;
+    }
+    for (vtkIdType k = begin; k < end; ++k)
+    {
+      const float* point = &this->Coordinates[3 * k];
+      bool isSelected = true;
+      for (int plane = 0; plane < numberOfPlanes && isSelected; ++plane)
+      {
+        const double* equation = planes + 4 * plane;
+        isSelected = equation[0] * point[0] + equation[1] * point[1] + equation[2] * point[2] +
+          equation[3] >= 0.;
+      }
+      if (isSelected)
+      {
+        ids.push_back(this->Ids[k]);
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType PointPickingTree::FindClosestPoint(const double position[3],
+  double maximumDistance) const
+{
+  vtkIdType closest = -1;
+  double closestDistance2 = maximumDistance * maximumDistance;
+  std::vector<NodeRange> stack(1, NodeRange{ 0, 0, this->GetNumberOfPoints() });
+  while (!this->Ids.empty() && !stack.empty())
+  {
+    const NodeRange range = stack.back();
+    const size_t node = range.Index;
+    stack.pop_back();
+    const Node& bounds = this->Nodes[node];
+    double distance2 = 0.;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      const double outside = std::max(
+        std::max(bounds.Min[axis] - position[axis], position[axis] - bounds.Max[axis]), 0.);
+      distance2 += outside * outside;
+    }
+    if (distance2 > closestDistance2)
+    {
+      continue;
+    }
+
+    if (!this->IsLeaf(node))
+    {
+      // the child containing the position is visited first
+      const Node& leftBounds = this->Nodes[2 * node + 1];
+      const bool isLeftFirst = position[0] <= leftBounds.Max[0] &&
+        position[1] <= leftBounds.Max[1] && position[2] <= leftBounds.Max[2] &&
+        position[0] >= leftBounds.Min[0] && position[1] >= leftBounds.Min[1] &&
+        position[2] >= leftBounds.Min[2];
+      stack.push_back(range.Child(isLeftFirst ? 1 : 0));
+      stack.push_back(range.Child(isLeftFirst ? 0 : 1));
+      continue;
+    }
+
+    const vtkIdType begin = range.Begin;
+    const vtkIdType end = range.End;
+    for (vtkIdType k = begin; k < end; ++k)
+    {
+      const float* point = &this->Coordinates[3 * k];
+      const double offset[3] = { point[0] - position[0], point[1] - position[1],
+        point[2] - position[2] };
+      const double pointDistance2 = Dot(offset, offset);
+      if (pointDistance2 <= closestDistance2)
+      {
+        closest = this->Ids[k];
+        closestDistance2 = pointDistance2;
+      }
+    }
+  }
+  return closest;
+}
@@ -0,0 +1,123 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef POINT_PICKING_TREE_H
+#define POINT_PICKING_TREE_H
+
+// VTK
+#include <vtkType.h>
+
+// STD
+#include <cstddef>
+#include <vector>
+
+/**
+ * \class PointPickingTree
+ * \brief Bounding volume hierarchy over the points of a view, answering the picks along the
+ *        ray of a pixel, the selections of the points in a frustum and the closest point
+ *        queries without scanning all the points.
+ *
+ * The tree is a balanced binary tree stored implicitly, the children of the node k being the
+ * nodes 2k + 1 and 2k + 2: each node splits its points at the median of the longest axis of
+ * their bounds, down to leaves of about LeafSize points. The coordinates are copied in the
+ * order of the leaves, so that a leaf is read contiguously. The subtrees of the first levels
+ * are built by several threads.
+ */
+class PointPickingTree
+{
+public:
+  //! Maximum number of points of a leaf
+  static const vtkIdType LeafSize = 32;
+
+  /**
+   * @brief Build index the points
+   * @param coordinates x, y and z of each point
+   * @param numberOfThreads 0 uses one thread per core
+   */
+  void Build(const float* coordinates, vtkIdType numberOfPoints, int numberOfThreads = 0);
+
+  vtkIdType GetNumberOfPoints() const { return static_cast<vtkIdType>(this->Ids.size()); }
+
+  /**
+   * @brief Pick the point closest to the origin of a ray among the points in a cone around it,
+   * whose radius at a distance t along the ray is radius + slope * t. A perspective view picks
+   * with the slope of the angle of a few pixels, a parallel view with a radius.
+   * @param direction direction of the ray, it does not need to be normalized
+   * @return the point, -1 if no point is close to the ray
+   */
+  vtkIdType Pick(const double origin[3], const double direction[3], double radius,
+    double slope) const;
+
+  /**
+   * @brief Select the points inside a convex volume, as the frustum of a rubber band selection
+   * @param planes a, b, c and d of each plane, a point being inside when a x + b y + c z + d
+   * is positive for all the planes, as given by vtkCamera::GetFrustumPlanes
+   * @param ids[out] the points selected, in no particular order
+   */
+  void Select(const double* planes, int numberOfPlanes, std::vector<vtkIdType>& ids) const;
+
+  /**
+   * @brief FindClosestPoint find the closest point to a position
+   * @param maximumDistance the points farther than this are ignored
+   * @return the point, -1 if there is none
+   */
+  vtkIdType FindClosestPoint(const double position[3], double maximumDistance) const;
+
+private:
+  struct Node
+  {
+    float Min[3];
+    float Max[3];
+  };
+
+  //! A node and the range of its points in the order of the leaves, the first half of the
+  //! range being the points of its first child
+  struct NodeRange
+  {
+    size_t Index;
+    vtkIdType Begin;
+    vtkIdType End;
+
+    NodeRange Child(int side) const
+    {
+      const vtkIdType middle = this->Begin + (this->End - this->Begin) / 2;
+      return side == 0 ? NodeRange{ 2 * this->Index + 1, this->Begin, middle }
+                       : NodeRange{ 2 * this->Index + 2, middle, this->End };
+    }
+  };
+
+  bool IsLeaf(size_t node) const { return 2 * node + 1 >= this->Nodes.size(); }
+
+  //! A point being sorted by the build
+  struct Entry
+  {
+    float Coordinates[3];
+    vtkIdType Id;
+  };
+
+  void BuildNode(const NodeRange& range, std::vector<Entry>& entries, int parallelDepth);
+
+  //! Bounds of the nodes, the leaves being the last level
+  std::vector<Node> Nodes;
+  //! Coordinates of the points in the order of the leaves
+  std::vector<float> Coordinates;
+  //! Index of the points in the order of the leaves
+  std::vector<vtkIdType> Ids;
+  int Depth = 0;
+};
+
+#endif // POINT_PICKING_TREE_H
@@ -0,0 +1,151 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef POSE_GRID_H
+#define POSE_GRID_H
+
+#include "vtkVelodyneTransformInterpolator.h"
+
+#include <Eigen/Dense>
+#include <Eigen/StdVector>
+
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * \struct PoseGrid
+ * \brief Poses of a trajectory interpolated on a regular time grid, the pose at a given
+ *        time is blended from the two samples around it. With a single sample, it is the
+ *        pose of all the times. Interpolating the trajectory once per grid sample instead of
+ *        once per point makes transforming a frame point by point as fast as with a single
+ *        pose, for the linear and spline interpolations.
+ */
+struct PoseGrid
+{
+  typedef Eigen::Matrix<double, 3, 4> Pose;
+
+  double StartTime = 0.0;
+  double Step = 0.0;
+  std::vector<Pose, Eigen::aligned_allocator<Pose> > Poses;
+
+  //! Pose of a row-major 4x4 matrix
+  static void GetPose(const double* matrix, Pose& pose)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 4; ++j)
+      {
+        pose(i, j) = matrix[4 * i + j];
+      }
+    }
+  }
+
+  /**
+   * @brief Sample interpolate the poses of a time range with one call to the interpolator
+   * @param step maximum time between two samples, the number of samples is bounded to a
+   * million
+   */
+  void Sample(vtkVelodyneTransformInterpolator* interpolator, double tstart, double tend,
+              double step)
+  {
+    const size_t maximumNumberOfSamples = 1000000;
+    const double duration = tend - tstart;
+    const size_t numberOfSamples = duration > 0.0 && step > 0.0
+      ? std::min(static_cast<size_t>(std::ceil(duration / step)), maximumNumberOfSamples) + 1
+      : 1;
+    this->StartTime = tstart;
+    this->Step = numberOfSamples > 1 ? duration / (numberOfSamples - 1) : 0.0;
+    this->Poses.resize(numberOfSamples);
+    std::vector<double> times(numberOfSamples);
+    for (size_t k = 0; k < numberOfSamples; ++k)
+    {
+      times[k] = this->StartTime + k * this->Step;
+    }
+    std::vector<double> matrices(16 * numberOfSamples);
+    interpolator->InterpolateTransformMatrices(
+      times.data(), static_cast<vtkIdType>(numberOfSamples), matrices.data());
+    for (size_t k = 0; k < numberOfSamples; ++k)
+    {
+      GetPose(&matrices[16 * k], this->Poses[k]);
+    }
+  }
+
+  Pose At(double t) const
+  {
+    if (this->Poses.size() == 1)
+    {
+      return this->Poses[0];
+    }
+    const double s = std::min(std::max((t - this->StartTime) / this->Step, 0.0),
+                              static_cast<double>(this->Poses.size() - 1));
+    const size_t k = std::min(static_cast<size_t>(s), this->Poses.size() - 2);
+    const double alpha = s - k;
+    return (1.0 - alpha) * this->Poses[k] + alpha * this->Poses[k + 1];
+  }
+};
+
+/**
+ * @brief TransformPoints transform interleaved x, y, z points with the poses of a grid at
+ * their time, split in ranges transformed by several threads. The output may be the input.
+ * @param time functor returning the time of a point in seconds
+ * @param numberOfThreads 0 uses one thread per core
+ */
+template <typename TIn, typename TOut, typename TimeFunction>
+void TransformPoints(const TIn* input, TOut* output, vtkIdType numberOfPoints,
+                     const TimeFunction& time, const PoseGrid& grid, int numberOfThreads)
+{
+  //! Points transformed by a thread at least, below the threads cost more than they save
+  const vtkIdType minimumPointsPerThread = 16384;
+
+  auto transformRange = [&](vtkIdType begin, vtkIdType end) {
+    const bool isConstant = grid.Poses.size() == 1;
+    PoseGrid::Pose pose = grid.Poses[0];
+    for (vtkIdType i = begin; i < end; ++i)
+    {
+      if (!isConstant)
+      {
+        pose = grid.At(time(i));
+      }
+      const Eigen::Vector3d x(input[3 * i], input[3 * i + 1], input[3 * i + 2]);
+      const Eigen::Vector3d y = pose.leftCols<3>() * x + pose.col(3);
+      output[3 * i] = static_cast<TOut>(y(0));
+      output[3 * i + 1] = static_cast<TOut>(y(1));
+      output[3 * i + 2] = static_cast<TOut>(y(2));
+    }
+  };
+
+  vtkIdType numberOfRanges = numberOfThreads > 0
+    ? numberOfThreads
+    : std::max(1u, boost::thread::hardware_concurrency());
+  numberOfRanges = std::max<vtkIdType>(1, std::min(numberOfRanges, numberOfPoints / minimumPointsPerThread));
+  const vtkIdType rangeSize = (numberOfPoints + numberOfRanges - 1) / numberOfRanges;
+  boost::thread_group threads;
+  // the calling thread transforms the first range
+  for (vtkIdType range = 1; range < numberOfRanges; ++range)
+  {
+    const vtkIdType begin = range * rangeSize;
+    const vtkIdType end = std::min(numberOfPoints, begin + rangeSize);
+    threads.create_thread([&transformRange, begin, end]() { transformRange(begin, end); });
+  }
+  transformRange(0, std::min(numberOfPoints, rangeSize));
+  threads.join_all();
+}
+
+#endif // POSE_GRID_H
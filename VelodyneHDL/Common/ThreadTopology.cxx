@@ -0,0 +1,521 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#include "ThreadTopology.h"
+
+// BOOST
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+// VTK
+#include <vtkSetGet.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// STD
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+struct Placement
+{
+  std::vector<int> Cpus;
+  int Priority = 0;
+  int NumaNode = -1;
+  int PoolSize = 0;
+
+  bool IsDefault() const
+  {
+    return this->Cpus.empty() && this->Priority == 0 && this->NumaNode < 0 &&
+      this->PoolSize == 0;
+  }
+};
+
+struct Topology
+{
+  boost::mutex Mutex;
+  Placement Placements[ThreadTopology::NUMBER_OF_SUBSYSTEMS];
+};
+
+const char* SubsystemNames[ThreadTopology::NUMBER_OF_SUBSYSTEMS] = {
+  "receive", "decode", "record", "forward", "position", "render"
+};
+
+//-----------------------------------------------------------------------------
+Topology& GetTopology()
+{
+  static Topology topology;
+  return topology;
+}
+
+//-----------------------------------------------------------------------------
+bool IsValid(int subsystem)
+{
+  return subsystem >= 0 && subsystem < ThreadTopology::NUMBER_OF_SUBSYSTEMS;
+}
+
+//-----------------------------------------------------------------------------
+std::string Trim(const std::string& text)
+{
+  const size_t first = text.find_first_not_of(" \t");
+  if (first == std::string::npos)
+  {
+    return std::string();
+  }
+  return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+//-----------------------------------------------------------------------------
+std::vector<std::string> Split(const std::string& text, char separator)
+{
+  std::vector<std::string> parts;
+  std::istringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, separator))
+  {
+    parts.push_back(Trim(part));
+  }
+  return parts;
+}
+
+//-----------------------------------------------------------------------------
+bool ParseInteger(const std::string& text, int& value)
+{
+  if (text.empty())
+  {
+    return false;
+  }
+  char* end = nullptr;
+  const long parsed = std::strtol(text.c_str(), &end, 10);
+  value = static_cast<int>(parsed);
+  return *end == '\0';
+}
+
+#ifdef __linux__
+//! Cores the process has been allowed to run on when it started, for example by taskset,
+//! restored on the threads whose subsystem does not choose its cores, as the threads inherit
+//! the cores of the thread creating them
+struct ProcessCpus
+{
+  cpu_set_t Cpus;
+  ProcessCpus()
+  {
+    CPU_ZERO(&this->Cpus);
+    if (sched_getaffinity(0, sizeof(this->Cpus), &this->Cpus) != 0)
+    {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      {
+        CPU_SET(cpu, &this->Cpus);
+      }
+    }
+  }
+};
+const ProcessCpus InitialCpus;
+
+//-----------------------------------------------------------------------------
+//! Cores of a NUMA node, empty if the node does not exist
+std::vector<int> GetNumaNodeCpus(int node)
+{
+  std::ostringstream filename;
+  filename << "/sys/devices/system/node/node" << node << "/cpulist";
+  std::ifstream file(filename.str());
+  std::string line;
+  std::vector<int> cpus;
+  if (!std::getline(file, line) || !ThreadTopology::ParseCpuList(line, cpus))
+  {
+    cpus.clear();
+  }
+  return cpus;
+}
+#endif
+}
+
+//-----------------------------------------------------------------------------
+const char* ThreadTopology::GetSubsystemName(int subsystem)
+{
+  return IsValid(subsystem) ? SubsystemNames[subsystem] : "";
+}
+
+//-----------------------------------------------------------------------------
+bool ThreadTopology::SetCpus(int subsystem, const std::string& cpus)
+{
+  std::vector<int> list;
+  if (!IsValid(subsystem) || !ParseCpuList(cpus, list))
+  {
+    return false;
+  }
+  Topology& topology = GetTopology();
+  boost::lock_guard<boost::mutex> lock(topology.Mutex);
+  topology.Placements[subsystem].Cpus = list;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string ThreadTopology::GetCpus(int subsystem)
+{
+  if (!IsValid(subsystem))
+  {
+    return std::string();
+  }
+  Topology& topology = GetTopology();
+  boost::lock_guard<boost::mutex> lock(topology.Mutex);
+  return FormatCpuList(topology.Placements[subsystem].Cpus);
+}
+
+//-----------------------------------------------------------------------------
+void ThreadTopology::SetPriority(int subsystem, int priority)
+{
+  if (IsValid(subsystem))
+  {
+    Topology& topology = GetTopology();
+    boost::lock_guard<boost::mutex> lock(topology.Mutex);
+    topology.Placements[subsystem].Priority = std::min(std::max(priority, 0), 99);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int ThreadTopology::GetPriority(int subsystem)
+{
+  if (!IsValid(subsystem))
+  {
+    return 0;
+  }
+  Topology& topology = GetTopology();
+  boost::lock_guard<boost::mutex> lock(topology.Mutex);
+  return topology.Placements[subsystem].Priority;
+}
+
+//-----------------------------------------------------------------------------
+void ThreadTopology::SetNumaNode(int subsystem, int node)
+{
+  if (IsValid(subsystem))
+  {
+    Topology& topology = GetTopology();
+    boost::lock_guard<boost::mutex> lock(topology.Mutex);
+    topology.Placements[subsystem].NumaNode = std::max(node, -1);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int ThreadTopology::GetNumaNode(int subsystem)
+{
+  if (!IsValid(subsystem))
+  {
+    return -1;
+  }
+  Topology& topology = GetTopology();
+  boost::lock_guard<boost::mutex> lock(topology.Mutex);
+  return topology.Placements[subsystem].NumaNode;
+}
+
+//-----------------------------------------------------------------------------
+void ThreadTopology::SetPoolSize(int subsystem, int poolSize)
+{
+  if (IsValid(subsystem))
+  {
+    Topology& topology = GetTopology();
+    boost::lock_guard<boost::mutex> lock(topology.Mutex);
+    topology.Placements[subsystem].PoolSize = std::max(poolSize, 0);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int ThreadTopology::GetPoolSize(int subsystem)
+{
+  if (!IsValid(subsystem))
+  {
+    return 0;
+  }
+  Topology& topology = GetTopology();
+  boost::lock_guard<boost::mutex> lock(topology.Mutex);
+  return topology.Placements[subsystem].PoolSize;
+}
+
+//-----------------------------------------------------------------------------
+bool ThreadTopology::SetConfiguration(const std::string& configuration)
+{
+  Placement placements[NUMBER_OF_SUBSYSTEMS];
+  for (const std::string& entry : Split(configuration, ';'))
+  {
+    if (entry.empty())
+    {
+      continue;
+    }
+    const size_t colon = entry.find(':');
+    const std::string name = Trim(entry.substr(0, colon));
+    const char* const* found = std::find_if(SubsystemNames, SubsystemNames + NUMBER_OF_SUBSYSTEMS,
+      [&name](const char* subsystemName) { return name == subsystemName; });
+    if (found == SubsystemNames + NUMBER_OF_SUBSYSTEMS)
+    {
+      return false;
+    }
+    Placement& placement = placements[found - SubsystemNames];
+    if (colon == std::string::npos)
+    {
+      continue;
+    }
+
+    // the list of cores also contains commas, the parts without '=' continue the previous value
+    std::vector<std::pair<std::string, std::string> > settings;
+    for (const std::string& part : Split(entry.substr(colon + 1), ','))
+    {
+      const size_t equal = part.find('=');
+      if (equal != std::string::npos)
+      {
+        settings.push_back(std::make_pair(Trim(part.substr(0, equal)), part.substr(equal + 1)));
+      }
+      else if (!settings.empty() && !part.empty())
+      {
+        settings.back().second += "," + part;
+      }
+      else if (!part.empty())
+      {
+        return false;
+      }
+    }
+    for (const auto& setting : settings)
+    {
+      const std::string value = Trim(setting.second);
+      bool isValid = false;
+      if (setting.first == "cpus")
+      {
+        isValid = ParseCpuList(value, placement.Cpus);
+      }
+      else if (setting.first == "priority")
+      {
+        isValid = ParseInteger(value, placement.Priority) && placement.Priority >= 0 &&
+          placement.Priority <= 99;
+      }
+      else if (setting.first == "numa")
+      {
+        isValid = ParseInteger(value, placement.NumaNode) && placement.NumaNode >= -1;
+      }
+      else if (setting.first == "pool")
+      {
+        isValid = ParseInteger(value, placement.PoolSize) && placement.PoolSize >= 0;
+      }
+      if (!isValid)
+      {
+        return false;
+      }
+    }
+  }
+
+  Topology& topology = GetTopology();
+  boost::lock_guard<boost::mutex> lock(topology.Mutex);
+  std::copy(placements, placements + NUMBER_OF_SUBSYSTEMS, topology.Placements);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string ThreadTopology::GetConfiguration()
+{
+  Topology& topology = GetTopology();
+  boost::lock_guard<boost::mutex> lock(topology.Mutex);
+  std::ostringstream configuration;
+  for (int subsystem = 0; subsystem < NUMBER_OF_SUBSYSTEMS; ++subsystem)
+  {
+    const Placement& placement = topology.Placements[subsystem];
+    if (placement.IsDefault())
+    {
+      continue;
+    }
+    std::vector<std::string> settings;
+    if (!placement.Cpus.empty())
+    {
+      settings.push_back("cpus=" + FormatCpuList(placement.Cpus));
+    }
+    if (placement.Priority > 0)
+    {
+      settings.push_back("priority=" + std::to_string(placement.Priority));
+    }
+    if (placement.NumaNode >= 0)
+    {
+      settings.push_back("numa=" + std::to_string(placement.NumaNode));
+    }
+    if (placement.PoolSize > 0)
+    {
+      settings.push_back("pool=" + std::to_string(placement.PoolSize));
+    }
+    configuration << (configuration.tellp() > 0 ? ";" : "") << SubsystemNames[subsystem] << ":";
+    for (size_t i = 0; i < settings.size(); ++i)
+    {
+      configuration << (i == 0 ? "" : ",") << settings[i];
+    }
+  }
+  return configuration.str();
+}
+
+//-----------------------------------------------------------------------------
+bool ThreadTopology::ApplyToCurrentThread(int subsystem, int threadIndex)
+{
+  if (!IsValid(subsystem))
+  {
+    return false;
+  }
+  Placement placement;
+  {
+    Topology& topology = GetTopology();
+    boost::lock_guard<boost::mutex> lock(topology.Mutex);
+    placement = topology.Placements[subsystem];
+  }
+  const char* name = SubsystemNames[subsystem];
+
+#ifdef __linux__
+  bool isApplied = true;
+  std::vector<int> cpus = placement.Cpus;
+  if (placement.NumaNode >= 0)
+  {
+    const std::vector<int> nodeCpus = GetNumaNodeCpus(placement.NumaNode);
+    std::vector<int> common;
+    std::set_intersection(cpus.begin(), cpus.end(), nodeCpus.begin(), nodeCpus.end(),
+      std::back_inserter(common));
+    if (nodeCpus.empty() || (!cpus.empty() && common.empty()))
+    {
+      vtkGenericWarningMacro("The cores of the NUMA node " << placement.NumaNode
+                             << " cannot be used by the " << name << " threads");
+      isApplied = false;
+    }
+    else
+    {
+      cpus = cpus.empty() ? nodeCpus : common;
+    }
+  }
+
+  // the threads inherit the cores and the scheduling of the thread creating them, they are set
+  // even when the subsystem keeps the default ones
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  if (cpus.empty())
+  {
+    cpuSet = InitialCpus.Cpus;
+  }
+  else if (threadIndex >= 0)
+  {
+    CPU_SET(cpus[threadIndex % cpus.size()], &cpuSet);
+  }
+  else
+  {
+    for (int cpu : cpus)
+    {
+      CPU_SET(cpu, &cpuSet);
+    }
+  }
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+  {
+    vtkGenericWarningMacro("Failed to set the cores of the " << name << " thread");
+    isApplied = false;
+  }
+
+  sched_param parameters;
+  std::memset(&parameters, 0, sizeof(parameters));
+  int policy = SCHED_OTHER;
+  if (placement.Priority > 0)
+  {
+    policy = SCHED_FIFO;
+    parameters.sched_priority = std::min(std::max(placement.Priority,
+      sched_get_priority_min(SCHED_FIFO)), sched_get_priority_max(SCHED_FIFO));
+  }
+  int currentPolicy = SCHED_OTHER;
+  sched_param currentParameters;
+  pthread_getschedparam(pthread_self(), &currentPolicy, &currentParameters);
+  if (policy != currentPolicy || parameters.sched_priority != currentParameters.sched_priority)
+  {
+    const int error = pthread_setschedparam(pthread_self(), policy, &parameters);
+    if (error != 0)
+    {
+      vtkGenericWarningMacro("Failed to set the priority of the " << name << " thread: "
+                             << std::strerror(error));
+      isApplied = false;
+    }
+  }
+  return isApplied;
+#else
+  (void)threadIndex;
+  (void)name;
+  return placement.Cpus.empty() && placement.Priority == 0 && placement.NumaNode < 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+bool ThreadTopology::ParseCpuList(const std::string& text, std::vector<int>& cpus)
+{
+  std::vector<int> list;
+  if (!Trim(text).empty())
+  {
+    for (const std::string& range : Split(text, ','))
+    {
+      const size_t dash = range.find('-');
+      int first = 0, last = 0;
+      if (!ParseInteger(Trim(range.substr(0, dash)), first))
+      {
+        return false;
+      }
+      last = first;
+      if (dash != std::string::npos && !ParseInteger(Trim(range.substr(dash + 1)), last))
+      {
+        return false;
+      }
+#ifdef __linux__
+      const int maximumCpu = CPU_SETSIZE - 1;
+#else
+      const int maximumCpu = 1023;
+#endif
+      if (first < 0 || last < first || last > maximumCpu)
+      {
+        return false;
+      }
+      for (int cpu = first; cpu <= last; ++cpu)
+      {
+        list.push_back(cpu);
+      }
+    }
+  }
+  std::sort(list.begin(), list.end());
+  list.erase(std::unique(list.begin(), list.end()), list.end());
+  cpus.swap(list);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string ThreadTopology::FormatCpuList(const std::vector<int>& cpus)
+{
+  std::ostringstream text;
+  for (size_t i = 0; i < cpus.size();)
+  {
+    size_t last = i;
+    while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1)
+    {
+      last++;
+    }
+    text << (i == 0 ? "" : ",") << cpus[i];
+    if (last > i)
+    {
+      text << "-" << cpus[last];
+    }
+    i = last + 1;
+  }
+  return text.str();
+}
@@ -0,0 +1,117 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef THREAD_TOPOLOGY_H
+#define THREAD_TOPOLOGY_H
+
+// STD
+#include <string>
+#include <vector>
+
+/**
+ * \class ThreadTopology
+ * \brief Placement of the threads of the live pipeline: the cores they may run on, their
+ *        real-time priority, their NUMA node and the size of the pools, set for each subsystem
+ *        so that the receive and decode paths keep a steady latency when the rendering or the
+ *        recording load the machine.
+ *
+ * The placement is applied by each thread when it starts, so it is taken into account the next
+ * time a stream is started. It can be given as a single line, which is how it is saved in the
+ * settings:
+ *
+ *   receive:cpus=2-3,priority=50,pool=2;decode:cpus=4-7,numa=0;render:cpus=0-1
+ *
+ * The cores are a list of cores and ranges of cores, the priority is a SCHED_FIFO priority
+ * from 1 to 99 (0 keeps the normal scheduling), the NUMA node restricts the cores to the ones
+ * of the node so that the memory the thread allocates is taken from it. The placement is only
+ * applied on Linux, and the real-time priority needs the CAP_SYS_NICE capability or a rtprio
+ * limit, the thread keeps the normal scheduling otherwise.
+ */
+class ThreadTopology
+{
+public:
+  enum Subsystem
+  {
+    //! Threads reading the sockets, see NetworkIngestionEngine
+    RECEIVE = 0,
+    //! Thread decoding the live packets, and pools decoding the files in parallel
+    DECODE,
+    //! Thread writing the live packets to a pcap
+    RECORD,
+    //! Thread forwarding the live packets
+    FORWARD,
+    //! Thread decoding the live GPS/IMU packets
+    POSITION,
+    //! Thread of the user interface, which renders the views
+    RENDER,
+    NUMBER_OF_SUBSYSTEMS
+  };
+
+  //! Lower case name of the subsystem, as used in the configuration line
+  static const char* GetSubsystemName(int subsystem);
+
+  /**
+   * @brief SetCpus set the cores the threads of a subsystem may run on
+   * @param cpus list of cores and ranges of cores, for example "0,2-3", empty for all cores
+   * @return false if the list is not valid, the placement is then unchanged
+   */
+  static bool SetCpus(int subsystem, const std::string& cpus);
+  static std::string GetCpus(int subsystem);
+
+  //! SCHED_FIFO priority of the threads of a subsystem, 0 for the normal scheduling
+  static void SetPriority(int subsystem, int priority);
+  static int GetPriority(int subsystem);
+
+  //! NUMA node the threads of a subsystem run on, -1 for any node
+  static void SetNumaNode(int subsystem, int node);
+  static int GetNumaNode(int subsystem);
+
+  /**
+   * @brief SetPoolSize set the number of threads of the pools of a subsystem, used by the
+   * receive threads and by the parallel decoding of the files. 0 means one per core.
+   */
+  static void SetPoolSize(int subsystem, int poolSize);
+  static int GetPoolSize(int subsystem);
+
+  /**
+   * @brief SetConfiguration set the placement of all the subsystems from a configuration line,
+   * the subsystems it does not name get the default placement
+   * @return false if the line is not valid, the placement is then unchanged
+   */
+  static bool SetConfiguration(const std::string& configuration);
+
+  //! Configuration line of the subsystems whose placement is not the default one
+  static std::string GetConfiguration();
+
+  /**
+   * @brief ApplyToCurrentThread apply the placement of a subsystem to the calling thread
+   * @param threadIndex index of the thread in its pool, the thread is then pinned on a single
+   * core taken in turn from the cores of the subsystem. -1 lets the thread run on all of them.
+   * @return false if a part of the placement could not be applied
+   */
+  static bool ApplyToCurrentThread(int subsystem, int threadIndex = -1);
+
+  /**
+   * @brief ParseCpuList read a list of cores and ranges of cores
+   * @return false if the list is not valid
+   */
+  static bool ParseCpuList(const std::string& text, std::vector<int>& cpus);
+  static std::string FormatCpuList(const std::vector<int>& cpus);
+};
+
+#endif // THREAD_TOPOLOGY_H
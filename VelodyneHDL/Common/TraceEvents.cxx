@@ -0,0 +1,192 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "TraceEvents.h"
+
+// BOOST
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+// STD
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+
+std::atomic<bool> TraceEvents::Enabled(false);
+
+namespace
+{
+//-----------------------------------------------------------------------------
+struct Event
+{
+  const char* Name;
+  double Begin;
+  double End;
+};
+
+//-----------------------------------------------------------------------------
+// Scopes of a thread, its mutex is only contended while the trace is written
+struct ThreadBuffer
+{
+  boost::mutex Mutex;
+  std::vector<Event> Events;
+  int ThreadId = 0;
+};
+
+//-----------------------------------------------------------------------------
+struct Registry
+{
+  boost::mutex Mutex;
+  std::vector<std::shared_ptr<ThreadBuffer> > Buffers;
+  std::chrono::steady_clock::time_point Start = std::chrono::steady_clock::now();
+};
+
+//-----------------------------------------------------------------------------
+Registry& GetRegistry()
+{
+  static Registry registry;
+  return registry;
+}
+
+//-----------------------------------------------------------------------------
+ThreadBuffer& GetThreadBuffer()
+{
+  thread_local std::shared_ptr<ThreadBuffer> buffer;
+  if (!buffer)
+  {
+    buffer = std::make_shared<ThreadBuffer>();
+    Registry& registry = GetRegistry();
+    boost::lock_guard<boost::mutex> lock(registry.Mutex);
+    buffer->ThreadId = static_cast<int>(registry.Buffers.size()) + 1;
+    registry.Buffers.push_back(buffer);
+  }
+  return *buffer;
+}
+
+//-----------------------------------------------------------------------------
+void WriteString(std::ostream& stream, const char* text)
+{
+  stream << '"';
+  for (const char* c = text; *c; ++c)
+  {
+    if (*c == '"' || *c == '\\')
+    {
+      stream << '\\';
+    }
+    stream << *c;
+  }
+  stream << '"';
+}
+
+//-----------------------------------------------------------------------------
+// Enable the tracing when VELOVIEW_TRACE_FILE is set, and write the trace at exit
+struct EnvironmentTrace
+{
+  EnvironmentTrace()
+  {
+    // the registry is built first so that it is destroyed after the trace is written
+    GetRegistry();
+    const char* filename = std::getenv("VELOVIEW_TRACE_FILE");
+    if (filename && *filename)
+    {
+      this->FileName = filename;
+      TraceEvents::SetEnabled(true);
+    }
+  }
+  ~EnvironmentTrace()
+  {
+    if (!this->FileName.empty())
+    {
+      TraceEvents::Write(this->FileName);
+    }
+  }
+
+  std::string FileName;
+};
+
+EnvironmentTrace Environment;
+}
+
+//-----------------------------------------------------------------------------
+void TraceEvents::SetEnabled(bool enabled)
+{
+  Enabled.store(enabled);
+}
+
+//-----------------------------------------------------------------------------
+double TraceEvents::GetTime()
+{
+  return std::chrono::duration<double, std::micro>(
+    std::chrono::steady_clock::now() - GetRegistry().Start).count();
+}
+
+//-----------------------------------------------------------------------------
+void TraceEvents::Record(const char* name, double begin, double end)
+{
+  ThreadBuffer& buffer = GetThreadBuffer();
+  boost::lock_guard<boost::mutex> lock(buffer.Mutex);
+  buffer.Events.push_back({ name, begin, end });
+}
+
+//-----------------------------------------------------------------------------
+void TraceEvents::Clear()
+{
+  Registry& registry = GetRegistry();
+  boost::lock_guard<boost::mutex> lock(registry.Mutex);
+  for (const std::shared_ptr<ThreadBuffer>& buffer : registry.Buffers)
+  {
+    boost::lock_guard<boost::mutex> bufferLock(buffer->Mutex);
+    buffer->Events.clear();
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool TraceEvents::Write(const std::string& filename)
+{
+  std::ofstream stream(filename.c_str());
+  if (!stream.is_open())
+  {
+    return false;
+  }
+  stream << std::fixed << std::setprecision(3);
+  stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+
+  Registry& registry = GetRegistry();
+  boost::lock_guard<boost::mutex> lock(registry.Mutex);
+  bool first = true;
+  for (const std::shared_ptr<ThreadBuffer>& buffer : registry.Buffers)
+  {
+    // the events are copied so that the thread is not blocked while they are written
+    std::vector<Event> events;
+    {
+      boost::lock_guard<boost::mutex> bufferLock(buffer->Mutex);
+      events = buffer->Events;
+    }
+    for (const Event& event : events)
+    {
+      stream << (first ? "" : ",\n") << "{\"name\": ";
+      WriteString(stream, event.Name);
+      stream << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->ThreadId
+             << ", \"ts\": " << event.Begin << ", \"dur\": " << event.End - event.Begin << "}";
+      first = false;
+    }
+  }
+  stream << "\n]}\n";
+  return stream.good();
+}
@@ -0,0 +1,99 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef TRACE_EVENTS_H
+#define TRACE_EVENTS_H
+
+// STD
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * \class TraceEvents
+ * \brief Timeline of the scopes run by the threads of the plugin, written in the Chrome trace
+ *        event format so that it can be opened with Perfetto or chrome://tracing.
+ *
+ * The tracing is disabled by default, a disabled scope only reads an atomic flag. Each thread
+ * records its scopes in its own buffer, the buffers are only gathered by Write. When the
+ * environment variable VELOVIEW_TRACE_FILE is set, the tracing is enabled at startup and the
+ * trace is written to this file when the application exits.
+ *
+ * The names given to the scopes must outlive the trace, string literals are expected.
+ */
+class TraceEvents
+{
+public:
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled() { return Enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Write the scopes recorded so far
+   * @return false if the file could not be written
+   */
+  static bool Write(const std::string& filename);
+
+  //! Forget the scopes recorded so far
+  static void Clear();
+
+  //! Record a scope that has ended, the times are in microseconds since the trace started
+  static void Record(const char* name, double begin, double end);
+
+  //! Time in microseconds since the trace started
+  static double GetTime();
+
+  /**
+   * \class Scope
+   * \brief Record the time from its construction to its destruction, when the tracing is
+   *        enabled at its construction
+   */
+  class Scope
+  {
+  public:
+    explicit Scope(const char* name)
+      : Name(IsEnabled() ? name : nullptr)
+      , Begin(Name ? GetTime() : 0)
+    {
+    }
+    ~Scope()
+    {
+      if (this->Name)
+      {
+        Record(this->Name, this->Begin, GetTime());
+      }
+    }
+
+  private:
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    const char* Name;
+    double Begin;
+  };
+
+private:
+  static std::atomic<bool> Enabled;
+};
+
+#define VV_TRACE_CONCATENATE_(a, b) a##b
+#define VV_TRACE_CONCATENATE(a, b) VV_TRACE_CONCATENATE_(a, b)
+
+//! Record the rest of the enclosing block under a name
+#define VV_TRACE_SCOPE(name) \
+  TraceEvents::Scope VV_TRACE_CONCATENATE(traceScope, __LINE__)(name)
+
+#endif // TRACE_EVENTS_H
@@ -15,55 +15,113 @@
 // limitations under the License.
 //=========================================================================
 
+#ifndef EIGEN_FFT_CORRELATION_H
+#define EIGEN_FFT_CORRELATION_H
+
+// Eigen forwards the transforms to FFTW when it is available, which keeps its
+// plans per size like the embedded kissfft does
+#ifdef VELOVIEW_HAS_FFTW
+#define EIGEN_FFTW_DEFAULT
+#endif
 #include <unsupported/Eigen/FFT>
+
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <complex>
+#include <vector>
 
-// This function was desgined to have the same output as
-// scipy.signal.fftconvolve
-// Uses Eigen to do the FFT transforms (2 forward, 1 backward).
+/**
+ * \class FFTCorrelator
+ * \brief Convolutions and correlations of real signals by FFT. The FFT object
+ *        keeps its plans for each transform size, and the padded buffers are
+ *        kept too, so correlating many signals of similar lengths with the same
+ *        correlator does not allocate nor plan again. A correlator must not be
+ *        used by several threads at the same time.
+ */
 template<typename T>
-std::vector<T> fftconvolve(const std::vector<T>& a,
-                           const std::vector<T>& b)
+class FFTCorrelator
 {
-  assert(a.size() > 0 && b.size() > 0);
-  int outSize = a.size() + b.size() - 1;
-  int fshape = std::pow(2, std::ceil(std::log2(outSize)));
-
-  std::vector<T> a_padded = std::vector<T>(fshape, 0.0);
-  for (unsigned int i = 0; i < a.size(); i++)
+public:
+  // Same output as scipy.signal.fftconvolve
+  const std::vector<T>& Convolve(const std::vector<T>& a, const std::vector<T>& b)
   {
-    a_padded[i] = a[i];
+    return this->Compute(a, b, false);
   }
 
-  std::vector<T> b_padded = std::vector<T>(fshape, 0.0);
-  for (unsigned int i = 0; i < b.size(); i++)
+  // Same output as scipy.signal.correlate when mode='full' and method='fft'
+  const std::vector<T>& Correlate(const std::vector<T>& a, const std::vector<T>& b)
   {
-    b_padded[i] = b[i];
+    return this->Compute(a, b, true);
   }
 
-  Eigen::FFT<T> fft;
-  std::vector<std::complex<T>> a_fwd;
-  fft.fwd(a_fwd, a_padded);
-  std::vector<std::complex<T>> b_fwd;
-  fft.fwd(b_fwd, b_padded);
-
-  std::vector<std::complex<T>> prod =
-                  std::vector<std::complex<T>>(fshape);
-  for (int i = 0; i < fshape; i++)
+  // Shift between a and b in number of samples, the shift is in b. The maximum
+  // of the correlation is refined with a parabola through its neighbours.
+  // The signals must have the same sampling rate and should have the same mean.
+  T MaxCorrelationShift(const std::vector<T>& a, const std::vector<T>& b)
   {
-    prod[i] = a_fwd[i] * b_fwd[i];
+    const std::vector<T>& corr = this->Correlate(a, b);
+    const size_t k = std::distance(corr.begin(), std::max_element(corr.begin(), corr.end()));
+    T offset = 0;
+    if (k > 0 && k + 1 < corr.size())
+    {
+      const T curvature = corr[k - 1] - 2 * corr[k] + corr[k + 1];
+      if (curvature < 0)
+      {
+        offset = 0.5 * (corr[k - 1] - corr[k + 1]) / curvature;
+      }
+    }
+    return static_cast<T>(k) + offset - static_cast<T>(b.size()) + 1;
   }
 
-  std::vector<std::complex<T>> inv_fft;
-  fft.inv(inv_fft, prod);
-
-  std::vector<T> out = std::vector<T>(outSize);
-  for (int i = 0; i < outSize; i++)
+private:
+  const std::vector<T>& Compute(const std::vector<T>& a, const std::vector<T>& b, bool reverseB)
   {
-    out[i] = inv_fft[i].real();
+    assert(a.size() > 0 && b.size() > 0);
+    const size_t outSize = a.size() + b.size() - 1;
+    const size_t fshape = static_cast<size_t>(std::pow(2, std::ceil(std::log2(outSize))));
+
+    this->PaddedA.assign(fshape, 0.0);
+    std::copy(a.begin(), a.end(), this->PaddedA.begin());
+    this->PaddedB.assign(fshape, 0.0);
+    if (reverseB)
+    {
+      // real numbers so no need to conjugate
+      std::copy(b.rbegin(), b.rend(), this->PaddedB.begin());
+    }
+    else
+    {
+      std::copy(b.begin(), b.end(), this->PaddedB.begin());
+    }
+
+    this->FFT.fwd(this->ForwardA, this->PaddedA);
+    this->FFT.fwd(this->ForwardB, this->PaddedB);
+    for (size_t i = 0; i < fshape; i++)
+    {
+      this->ForwardA[i] *= this->ForwardB[i];
+    }
+    this->FFT.inv(this->PaddedA, this->ForwardA);
+
+    this->Output.assign(this->PaddedA.begin(), this->PaddedA.begin() + outSize);
+    return this->Output;
   }
 
-  return out;
+  Eigen::FFT<T> FFT;
+  std::vector<T> PaddedA;
+  std::vector<T> PaddedB;
+  std::vector<std::complex<T>> ForwardA;
+  std::vector<std::complex<T>> ForwardB;
+  std::vector<T> Output;
+};
+
+// This function was desgined to have the same output as
+// scipy.signal.fftconvolve
+// Uses Eigen to do the FFT transforms (2 forward, 1 backward).
+template<typename T>
+std::vector<T> fftconvolve(const std::vector<T>& a,
+                           const std::vector<T>& b)
+{
+  return FFTCorrelator<T>().Convolve(a, b);
 }
 
 
@@ -73,14 +131,7 @@ template<typename T>
 std::vector<T> fftcorrelate(const std::vector<T>& a,
                             const std::vector<T>& b)
 {
-  // reverse and conjugate
-  std::vector<T> b_reversed = std::vector<T>(b.size());
-  for (unsigned int i = 0; i < b.size(); i++)
-  {
-    // real number so no need to conjugate
-    b_reversed[i] = b[b.size() - 1 - i];
-  }
-  return fftconvolve(a, b_reversed);
+  return FFTCorrelator<T>().Correlate(a, b);
 }
 
 
@@ -97,3 +148,4 @@ int max_fftcorrelation(const std::vector<T>& a,
       - b.size() + 1;
 }
 
+#endif // EIGEN_FFT_CORRELATION_H
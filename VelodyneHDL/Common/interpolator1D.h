@@ -15,9 +15,13 @@
 // limitations under the License.
 //=========================================================================
 
+#ifndef INTERPOLATOR_1D_H
+#define INTERPOLATOR_1D_H
+
 #include <vector>
 #include <iterator>
 #include <algorithm>
+#include <cassert>
 #include <string>
 #include <fstream>
 
@@ -77,23 +81,86 @@ public:
     }
   }
 
-  T GetMinimumT()
+  // Sample the signal every period from start, in a single sweep. The signal
+  // is clamped to 0.0 outside its support, and shifted by valueShift inside.
+  std::vector<T> Resample(T start, T period, int steps, T valueShift = 0.0) const
+  {
+    std::vector<T> times(std::max(steps, 0));
+    for (int i = 0; i < steps; i++)
+    {
+      times[i] = start + i * period;
+    }
+    return this->GetSorted(times, valueShift);
+  }
+
+  // Evaluate the signal at increasing times like Get, merging the times with
+  // the samples in a single sweep instead of a binary search per time. The
+  // segments of a block of times are found first, then their values are
+  // interpolated in a loop without branches that the compiler vectorizes.
+  // The signal is clamped to 0.0 outside its support, and shifted by
+  // valueShift inside.
+  std::vector<T> GetSorted(const std::vector<T>& times, T valueShift = 0.0) const
+  {
+    std::vector<T> samples(times.size(), 0.0);
+    if (this->t.empty())
+    {
+      return samples;
+    }
+    const size_t BlockSize = 256;
+    T lower[BlockSize], upper[BlockSize], weight[BlockSize], shift[BlockSize];
+    size_t sup = 0;
+    for (size_t first = 0; first < times.size(); first += BlockSize)
+    {
+      const size_t count = std::min(BlockSize, times.size() - first);
+      for (size_t k = 0; k < count; k++)
+      {
+        const T time = times[first + k];
+        assert(first + k == 0 || times[first + k - 1] <= time);
+        lower[k] = upper[k] = weight[k] = shift[k] = 0.0;
+        if (time < this->t[0] || time > this->t[this->t.size() - 1])
+        {
+          continue;
+        }
+        while (this->t[sup] < time)
+        {
+          sup++;
+        }
+        shift[k] = valueShift;
+        upper[k] = this->x[sup];
+        if (sup == 0)
+        {
+          lower[k] = this->x[0];
+          continue;
+        }
+        lower[k] = this->x[sup - 1];
+        weight[k] = (time - this->t[sup - 1]) / (this->t[sup] - this->t[sup - 1]);
+      }
+      T* values = samples.data() + first;
+      for (size_t k = 0; k < count; k++)
+      {
+        values[k] = lower[k] + weight[k] * (upper[k] - lower[k]) + shift[k];
+      }
+    }
+    return samples;
+  }
+
+  T GetMinimumT() const
   {
     return this->t[0];
   }
 
 
-  T GetMaximumT()
+  T GetMaximumT() const
   {
     return this->t[this->t.size() - 1];
   }
 
-  T GetAveragePeriod()
+  T GetAveragePeriod() const
   {
     return (this->GetMaximumT() - this->GetMinimumT()) / (this->t.size() - 1);
   }
 
-  T Mean()
+  T Mean() const
   {
     if (this->x.size() == 0)
     {
@@ -123,3 +190,5 @@ private:
   std::vector<T> t;
   std::vector<T> x;
 };
+
+#endif // INTERPOLATOR_1D_H
@@ -1,6 +1,8 @@
 #include "vtkCarGeometricCalibration.h"
 
+#include <algorithm>
 #include <cmath>
+#include <functional>
 #include <numeric>
 #include <random>
 #include <iostream>
@@ -10,6 +12,7 @@
 
 #include <Eigen/Geometry>
 
+#include "ParallelPoints.h"
 #include "vtkConversions.h"
 #include "vtkEigenTools.h"
 
@@ -588,6 +591,7 @@ void estimateL2ChordalSVD(const std::vector<Eigen::Matrix3d>& rotations,
   {
     result = Eigen::Matrix3d::Identity();
     valid = false;
+    return;
   }
 
   Eigen::Matrix3d S = Eigen::Matrix3d::Zero();
@@ -613,20 +617,44 @@ void estimateL2ChordalSVD(const std::vector<Eigen::Matrix3d>& rotations,
   valid = true;
 }
 
+namespace
+{
+//! Hypotheses evaluated in parallel, the first valid one of a batch is kept.
+//! This does not depend on the number of threads so that neither does the result
+const int RansacBatchSize = 32;
+
+//-----------------------------------------------------------------------------
+// Draw sampleSize distinct indices of [0, count[, from a generator which only
+// depends on the seed and the hypothesis
+void DrawSample(unsigned int seed, unsigned int hypothesis, int count,
+                int sampleSize, std::vector<int>& sample)
+{
+  std::seed_seq sequence{ seed, hypothesis };
+  std::mt19937 generator(sequence);
+  sample.resize(count);
+  std::iota(sample.begin(), sample.end(), 0);
+  // partial Fisher-Yates shuffle
+  for (int i = 0; i < sampleSize; i++)
+  {
+    std::uniform_int_distribution<int> distribution(i, count - 1);
+    std::swap(sample[i], sample[distribution(generator)]);
+  }
+  sample.resize(sampleSize);
+}
+}
+
 void RansacRotation(const std::vector<Eigen::Matrix3d>& rotations,
                     ROTATION_ESTIMATOR estimator,
                     int maxIterations,
                     int sampleToEstimate,
                     int sampleToValidate,
                     float maxAngleToFit,
+                    unsigned int seed,
+                    int numberOfThreads,
                     Eigen::Matrix3d& result,
                     bool& valid,
                     int& samplesUsed)
 {
-  std::default_random_engine rng = std::default_random_engine();
-  std::vector<int> shuffled(rotations.size());
-  std::iota(std::begin(shuffled), std::end(shuffled), 0); //0 is the starting number
-
   if (estimator != ROTATION_ESTIMATOR::ESTIMATOR_L2_CHORDAL_SVD)
   {
     std::cerr << "Unknown estimator passed to RansacRotation" << std::endl;
@@ -634,68 +662,109 @@ void RansacRotation(const std::vector<Eigen::Matrix3d>& rotations,
     valid = false;
     return;
   }
-  for (int i = 0; i < maxIterations; i++)
+  const int numberOfRotations = static_cast<int>(rotations.size());
+  if (numberOfRotations == 0)
   {
-    // re-shuffle
-    std::shuffle(std::begin(shuffled), std::end(shuffled), rng);
-    std::vector<Eigen::Matrix3d> samples = std::vector<Eigen::Matrix3d>(sampleToEstimate);
-    for (int j = 0; j < sampleToEstimate; j++)
+    result = Eigen::Matrix3d::Identity();
+    valid = false;
+    return;
+  }
+  sampleToEstimate = std::min(sampleToEstimate, numberOfRotations);
+
+  // the angle between two rotations is below maxAngleToFit if the trace of
+  // their relative rotation is above 1 + 2 cos(maxAngleToFit), which is
+  // cheaper to test than extracting the angle
+  const double minimumTrace = 1.0 + 2.0 * std::cos(maxAngleToFit);
+  const int threads = GetNumberOfThreads(numberOfThreads);
+
+  std::vector<char> fits(RansacBatchSize);
+  for (int firstHypothesis = 0; firstHypothesis < maxIterations; firstHypothesis += RansacBatchSize)
+  {
+    const int count = std::min(RansacBatchSize, maxIterations - firstHypothesis);
+    auto evaluate = [&](size_t begin, size_t end) {
+      std::vector<int> sample;
+      std::vector<Eigen::Matrix3d> samples(sampleToEstimate);
+      for (size_t h = begin; h < end; ++h)
+      {
+        fits[h] = false;
+        DrawSample(seed, static_cast<unsigned int>(firstHypothesis + h), numberOfRotations,
+                   sampleToEstimate, sample);
+        for (int j = 0; j < sampleToEstimate; j++)
+        {
+          samples[j] = rotations[sample[j]];
+        }
+
+        Eigen::Matrix3d estimation;
+        bool estimationValid = false;
+        estimateL2ChordalSVD(samples, estimation, estimationValid);
+        if (!estimationValid)
+        {
+          continue;
+        }
+
+        // count how many rotations are close enough:
+        int samplesFitting = 0;
+        for (int j = 0; j < numberOfRotations; j++)
+        {
+          if ((estimation.array() * rotations[j].array()).sum() >= minimumTrace)
+          {
+            samplesFitting++;
+          }
+        }
+        fits[h] = samplesFitting >= sampleToValidate;
+      }
+    };
+    ParallelFor(count, threads,
+                [&](size_t, size_t begin, size_t end) { evaluate(begin, end); });
+
+    // the first valid hypothesis is kept, whatever the number of threads
+    const auto first = std::find(fits.begin(), fits.begin() + count, true);
+    if (first == fits.begin() + count)
     {
-      samples[j] = rotations[shuffled[j]];
+      continue;
     }
 
+    // do a final estimation, then return
+    std::vector<int> sample;
+    DrawSample(seed, static_cast<unsigned int>(firstHypothesis + std::distance(fits.begin(), first)),
+               numberOfRotations, sampleToEstimate, sample);
+    std::vector<Eigen::Matrix3d> samples(sampleToEstimate);
+    for (int j = 0; j < sampleToEstimate; j++)
+    {
+      samples[j] = rotations[sample[j]];
+    }
     Eigen::Matrix3d estimation;
     bool estimationValid = false;
     estimateL2ChordalSVD(samples, estimation, estimationValid);
-    if (!estimationValid)
-    {
-      continue;
-    }
-
-    // count how many rotations are close enough:
-    std::vector<Eigen::Matrix3d> samplesFitting = std::vector<Eigen::Matrix3d>();
+    std::vector<Eigen::Matrix3d> samplesFitting;
     samplesFitting.reserve(rotations.size());
-    for (unsigned int j = 0; j < rotations.size(); j++)
+    for (int j = 0; j < numberOfRotations; j++)
     {
-      double angle = Eigen::AngleAxisd(estimation.transpose() * rotations[j]).angle();
-      if (angle <= maxAngleToFit)
+      if ((estimation.array() * rotations[j].array()).sum() >= minimumTrace)
       {
         samplesFitting.push_back(rotations[j]);
       }
     }
-
-    if (static_cast<int>(samplesFitting.size()) >= sampleToValidate)
-    {
-      // do a final estimation, then return
-      samplesUsed = samplesFitting.size();
-      Eigen::Matrix3d estimation;
-      bool estimationValid = false;
-      estimateL2ChordalSVD(samplesFitting, estimation, estimationValid);
-      result = estimation;
-      valid = estimationValid;
-      return;
-    }
+    samplesUsed = samplesFitting.size();
+    estimateL2ChordalSVD(samplesFitting, estimation, estimationValid);
+    result = estimation;
+    valid = estimationValid;
+    return;
   }
 
   result = Eigen::Matrix3d::Identity();
   valid = false;
 }
 
-void ComputeCarCalibrationRotationScale(
+void ComputeCarCalibrationTurnFeatures(
         const vtkSmartPointer<vtkTemporalTransforms> reference,
         const vtkSmartPointer<vtkTemporalTransforms> aligned,
         double curveTreshold,
-        int ransacMaxIter,
-        double ransacMaxAngleToFit,
-        double ransacFittingRatio,
-        double ransacValidationRatio,
         DIRECTION_METHOD directionMethod,
         NORMAL_METHOD normalMethod,
         DIRECTION_OPTIMIZATION_METHOD normalBasedDirectionOptimisation,
         AVERAGE_ORIENTATION_METHOD orientationMethod,
-        Eigen::Matrix3d& result,
-        double& scale,
-        bool& validResult,
+        CarCalibrationTurnFeatures& features,
         bool verbose
         )
 {
@@ -716,8 +785,8 @@ void ComputeCarCalibrationRotationScale(
     std::cout << "Processing " << turns.size() << " turns" << std::endl;
   }
 
-  std::vector<Eigen::Matrix3d> rotations = std::vector<Eigen::Matrix3d>();
-  std::vector<double> scales;
+  features.Rotations.clear();
+  features.Scales.clear();
   for (unsigned int i = 0; i < turns.size(); i++)
   {
     if (turns[i][0] < alignedI->GetMinimumT()
@@ -741,8 +810,8 @@ void ComputeCarCalibrationRotationScale(
                     scaleBefore,
                     scaleAfter);
 
-    scales.push_back(scaleBefore);
-    scales.push_back(scaleAfter);
+    features.Scales.push_back(scaleBefore);
+    features.Scales.push_back(scaleAfter);
 
     Eigen::Vector3d yprBefore = (180.0 / vtkMath::Pi()) * RBefore.eulerAngles(2,1,0);
     Eigen::Vector3d yprAfter = (180.0 / vtkMath::Pi()) * RAfter.eulerAngles(2,1,0);
@@ -758,30 +827,63 @@ void ComputeCarCalibrationRotationScale(
 
     if (RBefore.allFinite())
     {
-      rotations.push_back((RBefore));
+      features.Rotations.push_back((RBefore));
     }
     if (RAfter.allFinite())
     {
-      rotations.push_back((RAfter));
+      features.Rotations.push_back((RAfter));
     }
   }
 
   if (verbose)
   {
-    // must be displayed before any call of median on the std::vector, else the
-    // order is changed
-    for (unsigned int i = 0; i < scales.size() / 2; i++)
+    for (unsigned int i = 0; i < features.Scales.size() / 2; i++)
     {
-      std::cout << "scale before: " << scales[2*i]
-                << ", scale after: " << scales[2*i+1] << std::endl;
+      std::cout << "scale before: " << features.Scales[2*i]
+                << ", scale after: " << features.Scales[2*i+1] << std::endl;
     }
   }
+}
 
+void ComputeCarCalibrationTurnFeatures(
+        const vtkSmartPointer<vtkTemporalTransforms> reference,
+        const vtkSmartPointer<vtkTemporalTransforms> aligned,
+        double curveTreshold,
+        CarCalibrationTurnFeatures& features,
+        bool verbose
+        )
+{
+  ComputeCarCalibrationTurnFeatures(reference, aligned, curveTreshold,
+        DIRECTION_METHOD::TWO_POINTS,
+        NORMAL_METHOD::CROSS_PRODUCT,
+        DIRECTION_OPTIMIZATION_METHOD::NONE,
+        AVERAGE_ORIENTATION_METHOD::SINGLE_POINT,
+        features, verbose);
+}
+
+void ComputeCarCalibrationRotationScale(
+        const CarCalibrationTurnFeatures& features,
+        int ransacMaxIter,
+        double ransacMaxAngleToFit,
+        double ransacFittingRatio,
+        double ransacValidationRatio,
+        Eigen::Matrix3d& result,
+        double& scale,
+        bool& validResult,
+        bool verbose,
+        unsigned int ransacSeed,
+        int numberOfThreads
+        )
+{
+  const std::vector<Eigen::Matrix3d>& rotations = features.Rotations;
+
+  // the median changes the order of the scales
+  std::vector<double> scales = features.Scales;
   scale = ComputeMedian(scales);
 
   if (verbose)
   {
-    std::cout << "median of scales is: " << ComputeMedian(scales) << std::endl;
+    std::cout << "median of scales is: " << scale << std::endl;
   }
 
 
@@ -794,6 +896,8 @@ void ComputeCarCalibrationRotationScale(
                  std::max(1, static_cast<int>(vtkMath::Round(ransacFittingRatio * static_cast<double>(rotations.size())))),
                  std::max(1, static_cast<int>(vtkMath::Round(ransacValidationRatio * static_cast<double>(rotations.size())))),
                  (vtkMath::Pi() / 180.0) * ransacMaxAngleToFit,
+                 ransacSeed,
+                 numberOfThreads,
                  R,
                  valid,
                  sampleUsed);
@@ -839,15 +943,13 @@ void ComputeCarCalibrationRotationScale(
         Eigen::Matrix3d& result,
         double& scale,
         bool& validResult,
-        bool verbose
+        bool verbose,
+        unsigned int ransacSeed
         )
 {
-  ComputeCarCalibrationRotationScale(reference, aligned, curveTreshold,
-        ransacMaxIter, ransacMaxAngleToFit,
+  CarCalibrationTurnFeatures features;
+  ComputeCarCalibrationTurnFeatures(reference, aligned, curveTreshold, features, verbose);
+  ComputeCarCalibrationRotationScale(features, ransacMaxIter, ransacMaxAngleToFit,
         ransacFittingRatio, ransacValidationRatio,
-        DIRECTION_METHOD::TWO_POINTS,
-        NORMAL_METHOD::CROSS_PRODUCT,
-        DIRECTION_OPTIMIZATION_METHOD::NONE,
-        AVERAGE_ORIENTATION_METHOD::SINGLE_POINT,
-        result, scale, validResult, verbose);
+        result, scale, validResult, verbose, ransacSeed);
 }
@@ -25,10 +25,15 @@
 // The trajectory should be produced in an urban environnement: straight lines
 // alternated with relatively sharp turns (though not necessary Manatthan like).
 
+#ifndef VTK_CAR_GEOMETRIC_CALIBRATION_H
+#define VTK_CAR_GEOMETRIC_CALIBRATION_H
+
 #include <vtkSmartPointer.h>
 #include <vtkVelodyneTransformInterpolator.h>
 #include <Eigen/SVD>
 
+#include <vector>
+
 #include "vvConfigure.h"
 #include "vtkTemporalTransforms.h"
 #include "statistics.h"
@@ -87,6 +92,30 @@ std::vector<std::vector<double>> ComputeTurns(
         std::string debugCSV = ""
         );
 
+/**
+* \brief Rotations and scales between the two sensors, measured before and
+* after each turn of the reference trajectory. They only depend on the pose
+* trajectories and on the curve treshold, so they can be computed once and
+* reused when sweeping the RANSAC parameters.
+**/
+struct CarCalibrationTurnFeatures
+{
+  std::vector<Eigen::Matrix3d> Rotations;
+  std::vector<double> Scales;
+};
+
+/**
+* \brief Detect the turns of the reference pose trajectory and measure the
+* rotation and scale between both trajectories on each of them.
+**/
+void VelodyneHDLPlugin_EXPORT ComputeCarCalibrationTurnFeatures(
+        const vtkSmartPointer<vtkTemporalTransforms> reference,
+        const vtkSmartPointer<vtkTemporalTransforms> aligned,
+        double curveTreshold,
+        CarCalibrationTurnFeatures& features,
+        bool verbose = false
+        );
+
 /**
 * \brief This function compute the rotation and scale part of the geometric
 * calibration between two sensors that were used to produce two pose
@@ -107,6 +136,8 @@ std::vector<std::vector<double>> ComputeTurns(
 * is sufficient to estimate a rotation.
 * \param ransacValidationRatio between 0 and 1, should be taken as big as
 * possible but I had to lower it down to 0.15 for some real life datasets.
+* \param ransacSeed seed of the random samples of the RANSAC, a given seed
+* always gives the same result.
 **/
 void VelodyneHDLPlugin_EXPORT ComputeCarCalibrationRotationScale(
         const vtkSmartPointer<vtkTemporalTransforms> reference,
@@ -119,5 +150,29 @@ void VelodyneHDLPlugin_EXPORT ComputeCarCalibrationRotationScale(
         Eigen::Matrix3d& result,
         double& scale,
         bool& validResult,
-        bool verbose = false
+        bool verbose = false,
+        unsigned int ransacSeed = 0
         );
+
+/**
+* \brief Same as above, from turn features computed beforehand. The RANSAC
+* hypotheses are evaluated in parallel, the samples of a hypothesis only
+* depend on ransacSeed and its index, so the result does not depend on the
+* number of threads.
+* \param numberOfThreads 0 uses one thread per core
+**/
+void VelodyneHDLPlugin_EXPORT ComputeCarCalibrationRotationScale(
+        const CarCalibrationTurnFeatures& features,
+        int ransacMaxIter,
+        double ransacMaxAngleToFit,
+        double ransacFittingRatio,
+        double ransacValidationRatio,
+        Eigen::Matrix3d& result,
+        double& scale,
+        bool& validResult,
+        bool verbose = false,
+        unsigned int ransacSeed = 0,
+        int numberOfThreads = 0
+        );
+
+#endif // VTK_CAR_GEOMETRIC_CALIBRATION_H
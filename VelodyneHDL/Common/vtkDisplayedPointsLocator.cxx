@@ -0,0 +1,228 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkDisplayedPointsLocator.h"
+#include "ParallelPoints.h"
+#include "PointPickingTree.h"
+#include "TraceEvents.h"
+
+#include <vtkCamera.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkRenderer.h>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// World position of a position of the view, at a depth between 0 (near plane) and 1 (far plane),
+// relative to an origin
+void DisplayToWorld(vtkRenderer* renderer, double x, double y, double depth,
+  const double origin[3], double world[3])
+{
+  renderer->SetDisplayPoint(x, y, depth);
+  renderer->DisplayToWorld();
+  double homogeneous[4];
+  renderer->GetWorldPoint(homogeneous);
+  const double w = homogeneous[3] != 0. ? homogeneous[3] : 1.;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    world[axis] = homogeneous[axis] / w - origin[axis];
+  }
+}
+}
+
+vtkStandardNewMacro(vtkDisplayedPointsLocator)
+
+//-----------------------------------------------------------------------------
+vtkDisplayedPointsLocator::vtkDisplayedPointsLocator()
+  : Tree(new PointPickingTree)
+  , Selection(vtkSmartPointer<vtkIdTypeArray>::New())
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkDisplayedPointsLocator::~vtkDisplayedPointsLocator() = default;
+
+//-----------------------------------------------------------------------------
+void vtkDisplayedPointsLocator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << endl;
+  os << indent << "Indexed points: " << this->Tree->GetNumberOfPoints() << endl;
+}
+
+//-----------------------------------------------------------------------------
+void vtkDisplayedPointsLocator::SetInputData(vtkPolyData* input)
+{
+  if (this->Input != input)
+  {
+    this->Input = input;
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkPolyData* vtkDisplayedPointsLocator::GetInput()
+{
+  return this->Input;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkDisplayedPointsLocator::UpdateTree()
+{
+  vtkPoints* points = this->Input ? this->Input->GetPoints() : nullptr;
+  if (!points)
+  {
+    this->Tree->Build(nullptr, 0);
+    this->TreePoints = nullptr;
+    return false;
+  }
+  if (points == this->TreePoints && points->GetMTime() == this->TreeTime)
+  {
+    return true;
+  }
+
+  VV_TRACE_SCOPE("vtkDisplayedPointsLocator::UpdateTree");
+  const vtkIdType numberOfPoints = points->GetNumberOfPoints();
+  std::vector<float> coordinates(3 * static_cast<size_t>(numberOfPoints));
+  double bounds[6];
+  points->GetBounds(bounds);
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    this->TreeOrigin[axis] = numberOfPoints > 0 ? (bounds[2 * axis] + bounds[2 * axis + 1]) / 2. : 0.;
+  }
+  const PointCoordinates reader(points);
+  ParallelFor(numberOfPoints, GetNumberOfPointRanges(this->NumberOfThreads, numberOfPoints),
+    [&](size_t, size_t begin, size_t end) {
+      double point[3];
+      for (size_t pointIndex = begin; pointIndex < end; ++pointIndex)
+      {
+        reader.Get(pointIndex, point);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+          coordinates[3 * pointIndex + axis] = static_cast<float>(point[axis] - this->TreeOrigin[axis]);
+        }
+      }
+    });
+  this->Tree->Build(coordinates.data(), numberOfPoints, this->NumberOfThreads);
+  this->TreePoints = points;
+  this->TreeTime = points->GetMTime();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkDisplayedPointsLocator::PickPoint(
+  vtkRenderer* renderer, double x, double y, double pixelTolerance)
+{
+  if (!renderer || !this->UpdateTree())
+  {
+    return -1;
+  }
+  double nearPoint[3], farPoint[3];
+  DisplayToWorld(renderer, x, y, 0., this->TreeOrigin, nearPoint);
+  DisplayToWorld(renderer, x, y, 1., this->TreeOrigin, farPoint);
+  double direction[3];
+  vtkMath::Subtract(farPoint, nearPoint, direction);
+
+  // the size of a pixel grows with the distance to the camera in a perspective view
+  vtkCamera* camera = renderer->GetActiveCamera();
+  const int* size = renderer->GetSize();
+  const double height = size[1] > 0 ? size[1] : 1.;
+  if (camera->GetParallelProjection())
+  {
+    const double pixelSize = 2. * camera->GetParallelScale() / height;
+    return this->Tree->Pick(nearPoint, direction, pixelTolerance * pixelSize, 0.);
+  }
+  const double pixelSlope =
+    2. * std::tan(vtkMath::RadiansFromDegrees(camera->GetViewAngle()) / 2.) / height;
+  double position[3];
+  camera->GetPosition(position);
+  vtkMath::Subtract(position, this->TreeOrigin, position);
+  return this->Tree->Pick(position, direction, 0., pixelTolerance * pixelSlope);
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkDisplayedPointsLocator::FindClosestPoint(
+  double x, double y, double z, double maximumDistance)
+{
+  if (!this->UpdateTree())
+  {
+    return -1;
+  }
+  const double position[3] = { x - this->TreeOrigin[0], y - this->TreeOrigin[1],
+    z - this->TreeOrigin[2] };
+  return this->Tree->FindClosestPoint(position, maximumDistance);
+}
+
+//-----------------------------------------------------------------------------
+vtkIdTypeArray* vtkDisplayedPointsLocator::SelectArea(
+  vtkRenderer* renderer, double x0, double y0, double x1, double y1)
+{
+  this->Selection->Reset();
+  if (!renderer || !this->UpdateTree())
+  {
+    return this->Selection;
+  }
+
+  // corners of the frustum on the near plane then on the far plane
+  const double xs[4] = { x0, x1, x1, x0 };
+  const double ys[4] = { y0, y0, y1, y1 };
+  double corners[8][3];
+  double center[3] = { 0., 0., 0. };
+  for (int corner = 0; corner < 8; ++corner)
+  {
+    DisplayToWorld(renderer, xs[corner % 4], ys[corner % 4], corner < 4 ? 0. : 1.,
+      this->TreeOrigin, corners[corner]);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      center[axis] += corners[corner][axis] / 8.;
+    }
+  }
+
+  // the sides, the near and the far planes, their normals pointing inside
+  const int faces[6][3] = { { 0, 1, 5 }, { 1, 2, 6 }, { 2, 3, 7 }, { 3, 0, 4 }, { 0, 2, 1 },
+    { 4, 5, 6 } };
+  double planes[6 * 4];
+  for (int face = 0; face < 6; ++face)
+  {
+    double u[3], v[3];
+    vtkMath::Subtract(corners[faces[face][1]], corners[faces[face][0]], u);
+    vtkMath::Subtract(corners[faces[face][2]], corners[faces[face][0]], v);
+    double* equation = planes + 4 * face;
+    vtkMath::Cross(u, v, equation);
+    equation[3] = -vtkMath::Dot(equation, corners[faces[face][0]]);
+    if (vtkMath::Dot(equation, center) + equation[3] < 0.)
+    {
+      for (int k = 0; k < 4; ++k)
+      {
+        equation[k] = -equation[k];
+      }
+    }
+  }
+
+  std::vector<vtkIdType> ids;
+  this->Tree->Select(planes, 6, ids);
+  this->Selection->SetNumberOfValues(static_cast<vtkIdType>(ids.size()));
+  std::copy(ids.begin(), ids.end(), this->Selection->GetPointer(0));
+  return this->Selection;
+}
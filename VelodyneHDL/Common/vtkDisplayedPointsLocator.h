@@ -0,0 +1,98 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_DISPLAYED_POINTS_LOCATOR_H
+#define VTK_DISPLAYED_POINTS_LOCATOR_H
+
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+#include <memory>
+
+class PointPickingTree;
+class vtkIdTypeArray;
+class vtkPoints;
+class vtkPolyData;
+class vtkRenderer;
+
+/**
+ * @brief The vtkDisplayedPointsLocator class answers the picks, the rubber band selections
+ * and the closest point queries on the points shown in a view, such as the trailing frames
+ * or a slam map, without rendering the view again or scanning all the points.
+ *
+ * The points are indexed by a PointPickingTree built at the first query after the points of
+ * the input have changed, and reused by the next queries until then. The positions given
+ * by the mouse are in display coordinates, the origin being the bottom left of the view.
+ */
+class VTK_EXPORT vtkDisplayedPointsLocator : public vtkObject
+{
+public:
+  static vtkDisplayedPointsLocator* New();
+  vtkTypeMacro(vtkDisplayedPointsLocator, vtkObject)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //! Points to query, the tree is built again when they change
+  void SetInputData(vtkPolyData* input);
+  vtkPolyData* GetInput();
+
+  //! Number of threads building the tree, 0 for one per core
+  vtkSetMacro(NumberOfThreads, int)
+  vtkGetMacro(NumberOfThreads, int)
+
+  /**
+   * @brief PickPoint pick the point closest to the camera among the points within a number of
+   * pixels of a position of the view
+   * @return the index of the point in the input, -1 if there is none
+   */
+  vtkIdType PickPoint(vtkRenderer* renderer, double x, double y, double pixelTolerance);
+
+  //! Index of the closest point to a position, -1 if no point is within maximumDistance
+  vtkIdType FindClosestPoint(double x, double y, double z, double maximumDistance);
+
+  /**
+   * @brief SelectArea select the points shown in a rectangle of the view, in the frustum of
+   * the camera going through it
+   * @return the indices of the points, the array is reused by the next selection
+   */
+  vtkIdTypeArray* SelectArea(vtkRenderer* renderer, double x0, double y0, double x1, double y1);
+
+protected:
+  vtkDisplayedPointsLocator();
+  ~vtkDisplayedPointsLocator() override;
+
+  //! Build the tree if the points have changed since the last build
+  bool UpdateTree();
+
+  vtkSmartPointer<vtkPolyData> Input;
+  int NumberOfThreads = 0;
+
+  std::unique_ptr<PointPickingTree> Tree;
+  //! points indexed by the tree, and their modification time at that moment
+  vtkPoints* TreePoints = nullptr;
+  vtkMTimeType TreeTime = 0;
+  //! center of the points, subtracted from the coordinates indexed as floats so that the
+  //! georeferenced points keep their precision
+  double TreeOrigin[3] = { 0., 0., 0. };
+
+  vtkSmartPointer<vtkIdTypeArray> Selection;
+
+private:
+  vtkDisplayedPointsLocator(const vtkDisplayedPointsLocator&) = delete;
+  void operator=(const vtkDisplayedPointsLocator&) = delete;
+};
+
+#endif // VTK_DISPLAYED_POINTS_LOCATOR_H
@@ -26,6 +26,7 @@
 
 // STD
 #include <stdlib.h>
+#include <algorithm>
 #include <ctime>
 
 // VTK
@@ -37,6 +38,9 @@
 // CERES
 #include <ceres/ceres.h>
 
+// BOOST
+#include <boost/thread/thread.hpp>
+
 //----------------------------------------------------------------------------
 std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(const std::string& sourceSensorFilename,
                                                                     const std::string& targetSensorFilename)
@@ -48,23 +52,34 @@ std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(const std::s
 }
 
 //----------------------------------------------------------------------------
-std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
-                                              vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
-                                              vtkSmartPointer<vtkTemporalTransforms> targetSensor)
+namespace
+{
+//----------------------------------------------------------------------------
+int GetNumberOfThreads(int numberOfThreads)
+{
+  return numberOfThreads > 0 ? numberOfThreads
+                             : std::max(1, static_cast<int>(boost::thread::hardware_concurrency()));
+}
+
+//----------------------------------------------------------------------------
+// Solve the calibration from the poses, starting from calibEstimation. The
+// constraints are timeScale times sparser in time than the default ones
+double SolveCalibrationFromPoses(vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                 vtkSmartPointer<vtkTemporalTransforms> targetSensor,
+                                 double timeScale,
+                                 int maxIterations,
+                                 int numberOfThreads,
+                                 AnglePositionVector& calibEstimation)
 {
   // Multi resolution time analysis parameters
   const double multipleScaleTimeBound = 5.0; // in seconds
-  const double deltaScaleTime = 0.2; // in seconds
-  const double timeStep = 0.4; // in seconds
+  // a few time deltas are kept below multipleScaleTimeBound for the sparse constraints
+  const double deltaScaleTime = std::min(0.2 * timeScale, 1.0); // in seconds
+  const double timeStep = 0.4 * timeScale; // in seconds
 
   Eigen::Matrix3d P1, P2, Q1, Q2;
   Eigen::Vector3d U1, U2, V1, V2;
 
-  // Parameters to estimate
-  // - Rotation euler angles from 0 to 2
-  // - Translation coordinates from 3 to 5
-  AnglePositionVector calibEstimation = AnglePositionVector::Zero();
-
   // Create the transforms interpolators
   vtkSmartPointer<vtkVelodyneTransformInterpolator> sourceSensorTransforms = sourceSensor->CreateInterpolator();
   vtkSmartPointer<vtkVelodyneTransformInterpolator> targetSensorTransforms = targetSensor->CreateInterpolator();
@@ -124,15 +139,112 @@ std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
   // Solve the optimization problem
   // Option of the solver
   ceres::Solver::Options options;
-  options.max_num_iterations = 75;
+  options.max_num_iterations = maxIterations;
+  options.linear_solver_type = ceres::DENSE_QR;
+  options.minimizer_progress_to_stdout = false;
+  options.num_threads = GetNumberOfThreads(numberOfThreads);
+  // Solve
+  ceres::Solver::Summary summary;
+  ceres::Solve(options, &problem, &summary);
+  std::cout << summary.BriefReport() << ", Number Blocks: " << summary.num_residuals << std::endl;
+
+  return summary.final_cost;
+}
+
+//----------------------------------------------------------------------------
+// Match the trajectories starting from transformParams. The constraints are
+// timeScale times sparser in time than the default ones
+double SolveIsometry(vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                     vtkSmartPointer<vtkTemporalTransforms> targetSensor,
+                     double timeScale,
+                     int maxIterations,
+                     int numberOfThreads,
+                     AnglePositionVector& transformParams)
+{
+  // Create the transforms interpolators
+  vtkSmartPointer<vtkVelodyneTransformInterpolator> sourceSensorTransforms = sourceSensor->CreateInterpolator();
+  vtkSmartPointer<vtkVelodyneTransformInterpolator> targetSensorTransforms = targetSensor->CreateInterpolator();
+  sourceSensorTransforms->SetInterpolationTypeToLinear();
+  targetSensorTransforms->SetInterpolationTypeToLinear();
+
+  // Time interval
+  double tmin = std::max(sourceSensorTransforms->GetMinimumT(), targetSensorTransforms->GetMinimumT());
+  double tmax = std::min(sourceSensorTransforms->GetMaximumT(), targetSensorTransforms->GetMaximumT());
+  const double deltaTime = 0.2 * timeScale; // 200ms
+
+  // usefull transform
+  auto currTransform = vtkSmartPointer<vtkTransform>::New();
+
+  ceres::Problem problem;
+  Eigen::Vector3d X, Y;
+
+  // Loop over the time
+  for (double time = tmin; time < tmax; time += deltaTime)
+  {
+    // Get the position of the sensor 1 for time
+    sourceSensorTransforms->InterpolateTransform(time, currTransform);
+    Y = GetPoseParamsFromTransform(currTransform).second;
+    // Get the position of the sensor 2 for time
+    targetSensorTransforms->InterpolateTransform(time, currTransform);
+    X = GetPoseParamsFromTransform(currTransform).second;
+
+    // Add the geometric contraint residual function
+    // to the non-linear least square problem
+    // add this geometric constraint non-linear least square residu to the global
+    // cost function that is the sum of all residuals functions
+    ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::EuclideanDistanceAffineIsometryResidual, 1, 6>
+              (new CostFunctions::EuclideanDistanceAffineIsometryResidual(X, Y));
+    problem.AddResidualBlock(cost_function, nullptr, transformParams.data());
+  }
+
+  // Solve the optimization problem
+  // Option of the solver
+  ceres::Solver::Options options;
+  options.max_num_iterations = maxIterations;
   options.linear_solver_type = ceres::DENSE_QR;
   options.minimizer_progress_to_stdout = false;
+  options.num_threads = GetNumberOfThreads(numberOfThreads);
   // Solve
   ceres::Solver::Summary summary;
   ceres::Solve(options, &problem, &summary);
   std::cout << summary.BriefReport() << ", Number Blocks: " << summary.num_residuals << std::endl;
 
-  return std::pair<double, AnglePositionVector>(summary.final_cost, calibEstimation);
+  return summary.final_cost;
+}
+}
+
+//----------------------------------------------------------------------------
+std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
+                                              vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                              vtkSmartPointer<vtkTemporalTransforms> targetSensor)
+{
+  return EstimateCalibrationFromPoses(sourceSensor, targetSensor, CalibrationSolverOptions());
+}
+
+//----------------------------------------------------------------------------
+std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
+                                              vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                              vtkSmartPointer<vtkTemporalTransforms> targetSensor,
+                                              const CalibrationSolverOptions& solverOptions)
+{
+  // Parameters to estimate
+  // - Rotation euler angles from 0 to 2
+  // - Translation coordinates from 3 to 5
+  AnglePositionVector calibEstimation = AnglePositionVector::Zero();
+  int maxIterations = 75;
+  if (solverOptions.CoarseSubsampling > 1)
+  {
+    // The constraints are sparser in time by the same factor than the poses,
+    // the refinement starts from this solution
+    SolveCalibrationFromPoses(sourceSensor->Subsample(solverOptions.CoarseSubsampling),
+                              targetSensor->Subsample(solverOptions.CoarseSubsampling),
+                              solverOptions.CoarseSubsampling, 75,
+                              solverOptions.NumberOfThreads, calibEstimation);
+    maxIterations = solverOptions.RefineMaxIterations;
+  }
+  double finalCost = SolveCalibrationFromPoses(sourceSensor, targetSensor, 1.0, maxIterations,
+                                               solverOptions.NumberOfThreads, calibEstimation);
+  return std::pair<double, AnglePositionVector>(finalCost, calibEstimation);
 }
 
 //----------------------------------------------------------------------------
@@ -194,18 +306,18 @@ vtkSmartPointer<vtkTemporalTransforms> ChangeConvention(vtkSmartPointer<vtkTempo
   // but using the current convention of angles signs, permutation and matrix multiplication order
   vtkSmartPointer<vtkTemporalTransforms> outputPoses = vtkSmartPointer<vtkTemporalTransforms>::New();
   outputPoses->DeepCopy(inputPoses);
-  vtkDoubleArray* xyzwArray = vtkDoubleArray::SafeDownCast(outputPoses->GetOrientationArray());
+  Eigen::Map<Eigen::Matrix4Xd> xyzwArray = outputPoses->GetAxisAngles();
 
   // Loop over the transforms points
-  for (unsigned int transformIndex = 0; transformIndex < outputPoses->GetNumberOfPoints(); transformIndex++)
+  for (vtkIdType transformIndex = 0; transformIndex < xyzwArray.cols(); transformIndex++)
   {
     // Get the angle-axis representation
-    double* xyzw = xyzwArray->GetTuple4(transformIndex);
+    auto xyzw = xyzwArray.col(transformIndex);
 
     // Compute the corresponding rotation and get the euler-angles with respect
     // to the convention:
     // R(rx, ry, rz) = Rz(rz)*Ry(ry)*Rx(rx)
-    Eigen::AngleAxisd angleAxis(xyzw[3], Eigen::Vector3d(xyzw[0], xyzw[1], xyzw[2]));
+    Eigen::AngleAxisd angleAxis(xyzw(3), xyzw.head<3>());
     Eigen::Matrix3d rotation = angleAxis.toRotationMatrix();
     Eigen::Vector3d eulerAngles = MatrixToRollPitchYaw(rotation);
 
@@ -222,14 +334,11 @@ vtkSmartPointer<vtkTemporalTransforms> ChangeConvention(vtkSmartPointer<vtkTempo
     Rot[2] = Eigen::Matrix3d(Eigen::AngleAxisd(rz, Eigen::Vector3d::UnitZ()));
     Eigen::Matrix3d newRotation = Rot[matrixOrder[0]] * Rot[matrixOrder[1]] * Rot[matrixOrder[2]];
 
-    // Get the axis angle representation of this new rotation
+    // Get the axis angle representation of this new rotation and replace it
     Eigen::AngleAxisd newAngleAxis(newRotation);
-    double newXyzw[4] = {newAngleAxis.axis()(0), newAngleAxis.axis()(1),
-                         newAngleAxis.axis()(2), newAngleAxis.angle()};
-
-    // Replace it
-    xyzwArray->SetTuple4(transformIndex, newXyzw[0], newXyzw[1], newXyzw[2], newXyzw[3]);
+    xyzw << newAngleAxis.axis(), newAngleAxis.angle();
   }
+  outputPoses->GetOrientationArray()->Modified();
 
   return outputPoses;
 }
@@ -312,55 +421,27 @@ void EstimateEulerAngleConvention(vtkSmartPointer<vtkTemporalTransforms> sourceS
 std::pair<double, AnglePositionVector> MatchTrajectoriesWithIsometry(vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
                                                                      vtkSmartPointer<vtkTemporalTransforms> targetSensor)
 {
-  // Create the transforms interpolators
-  vtkSmartPointer<vtkVelodyneTransformInterpolator> sourceSensorTransforms = sourceSensor->CreateInterpolator();
-  vtkSmartPointer<vtkVelodyneTransformInterpolator> targetSensorTransforms = targetSensor->CreateInterpolator();
-  sourceSensorTransforms->SetInterpolationTypeToLinear();
-  targetSensorTransforms->SetInterpolationTypeToLinear();
-
-  // Time interval
-  double tmin = std::max(sourceSensorTransforms->GetMinimumT(), targetSensorTransforms->GetMinimumT());
-  double tmax = std::min(sourceSensorTransforms->GetMaximumT(), targetSensorTransforms->GetMaximumT());
-  const double deltaTime = 0.2; // 200ms
-
-  // usefull transform
-  auto currTransform = vtkSmartPointer<vtkTransform>::New();
+  return MatchTrajectoriesWithIsometry(sourceSensor, targetSensor, CalibrationSolverOptions());
+}
 
-  ceres::Problem problem;
-  Eigen::Vector3d X, Y;
+//-----------------------------------------------------------------------------
+std::pair<double, AnglePositionVector> MatchTrajectoriesWithIsometry(vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                                                     vtkSmartPointer<vtkTemporalTransforms> targetSensor,
+                                                                     const CalibrationSolverOptions& solverOptions)
+{
   AnglePositionVector transformParams = AnglePositionVector::Zero();
-
-  // Loop over the time
-  for (double time = tmin; time < tmax; time += deltaTime)
+  int maxIterations = 75;
+  if (solverOptions.CoarseSubsampling > 1)
   {
-    // Get the position of the sensor 1 for time
-    sourceSensorTransforms->InterpolateTransform(time, currTransform);
-    Y = GetPoseParamsFromTransform(currTransform).second;
-    // Get the position of the sensor 2 for time
-    targetSensorTransforms->InterpolateTransform(time, currTransform);
-    X = GetPoseParamsFromTransform(currTransform).second;
-
-    // Add the geometric contraint residual function
-    // to the non-linear least square problem
-    // add this geometric constraint non-linear least square residu to the global
-    // cost function that is the sum of all residuals functions
-    ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::EuclideanDistanceAffineIsometryResidual, 1, 6>
-              (new CostFunctions::EuclideanDistanceAffineIsometryResidual(X, Y));
-    problem.AddResidualBlock(cost_function, nullptr, transformParams.data());
+    SolveIsometry(sourceSensor->Subsample(solverOptions.CoarseSubsampling),
+                  targetSensor->Subsample(solverOptions.CoarseSubsampling),
+                  solverOptions.CoarseSubsampling, 75,
+                  solverOptions.NumberOfThreads, transformParams);
+    maxIterations = solverOptions.RefineMaxIterations;
   }
-
-  // Solve the optimization problem
-  // Option of the solver
-  ceres::Solver::Options options;
-  options.max_num_iterations = 75;
-  options.linear_solver_type = ceres::DENSE_QR;
-  options.minimizer_progress_to_stdout = false;
-  // Solve
-  ceres::Solver::Summary summary;
-  ceres::Solve(options, &problem, &summary);
-  std::cout << summary.BriefReport() << ", Number Blocks: " << summary.num_residuals << std::endl;
-
-  return std::pair<double, AnglePositionVector>(summary.final_cost, transformParams);
+  double finalCost = SolveIsometry(sourceSensor, targetSensor, 1.0, maxIterations,
+                                   solverOptions.NumberOfThreads, transformParams);
+  return std::pair<double, AnglePositionVector>(finalCost, transformParams);
 }
 
 //-----------------------------------------------------------------------------
@@ -78,6 +78,24 @@
 
 typedef Eigen::Matrix<double, 6, 1> AnglePositionVector;
 
+/**
+* \struct CalibrationSolverOptions
+* \brief Options of the non-linear least square solvers of the calibration.
+*        With a CoarseSubsampling above 1, the problem is first solved on the
+*        trajectories keeping one pose every CoarseSubsampling, with constraints
+*        that many times sparser in time, then refined on the full trajectories
+*        starting from the coarse solution.
+*/
+struct CalibrationSolverOptions
+{
+  //! Subsampling of the poses of the coarse solve, 1 solves on the full trajectories only
+  int CoarseSubsampling = 1;
+  //! Maximum number of iterations of the refinement following the coarse solve
+  int RefineMaxIterations = 20;
+  //! Threads evaluating the residuals and jacobians, 0 uses one thread per core
+  int NumberOfThreads = 0;
+};
+
 /**
 * \function EstimaterEulerAngleConvention
 * \brief This function will find the correct
@@ -119,10 +137,15 @@ void EstimateEulerAngleConvention(const std::string& sourceSensorFilename,
 *
 * \@param targetSensor Poses trajectory of the first sensor
 * \@param sourceSensor Poses trajectory of the second sensor
+* \@param solverOptions coarse-to-fine and threading options of the solver
 */
 std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
                                             vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
                                             vtkSmartPointer<vtkTemporalTransforms> targetSensor);
+std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(
+                                            vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                            vtkSmartPointer<vtkTemporalTransforms> targetSensor,
+                                            const CalibrationSolverOptions& solverOptions);
 std::pair<double, AnglePositionVector> EstimateCalibrationFromPoses(const std::string& sourceSensorFilename,
                                                                     const std::string& targetSensorFilename);
 vtkSmartPointer<vtkTemporalTransforms> EstimateCalibrationFromPosesAndApply(
@@ -146,10 +169,15 @@ vtkSmartPointer<vtkTemporalTransforms> EstimateCalibrationFromPosesAndApply(
 *
 * \@param targetSensor Poses trajectory of the first sensor
 * \@param sourceSensor Poses trajectory of the second sensor
+* \@param solverOptions coarse-to-fine and threading options of the solver
 */
 std::pair<double, AnglePositionVector> MatchTrajectoriesWithIsometry(
                                                         vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
                                                         vtkSmartPointer<vtkTemporalTransforms> targetSensor);
+std::pair<double, AnglePositionVector> MatchTrajectoriesWithIsometry(
+                                                        vtkSmartPointer<vtkTemporalTransforms> sourceSensor,
+                                                        vtkSmartPointer<vtkTemporalTransforms> targetSensor,
+                                                        const CalibrationSolverOptions& solverOptions);
 std::pair<double, AnglePositionVector> MatchTrajectoriesWithIsometry(const std::string& sourceSensorFilename,
                                                                      const std::string& targetSensorFilename);
 vtkSmartPointer<vtkTemporalTransforms> MatchTrajectoriesWithIsometryAndApply(
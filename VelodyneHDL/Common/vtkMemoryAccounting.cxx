@@ -0,0 +1,88 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkMemoryAccounting.h"
+#include "MemoryAccounting.h"
+
+#include <vtkObjectFactory.h>
+
+vtkStandardNewMacro(vtkMemoryAccounting)
+
+//-----------------------------------------------------------------------------
+void vtkMemoryAccounting::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  for (int subsystem = 0; subsystem < GetNumberOfSubsystems(); ++subsystem)
+  {
+    os << indent << GetSubsystemName(subsystem) << ": " << GetSize(subsystem)
+       << " KiB (peak " << GetPeakSize(subsystem) << " KiB)" << endl;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkMemoryAccounting::GetNumberOfSubsystems()
+{
+  return MemoryAccounting::NUMBER_OF_SUBSYSTEMS;
+}
+
+//-----------------------------------------------------------------------------
+const char* vtkMemoryAccounting::GetSubsystemName(int subsystem)
+{
+  return MemoryAccounting::GetSubsystemName(subsystem);
+}
+
+//-----------------------------------------------------------------------------
+unsigned long vtkMemoryAccounting::GetSize(int subsystem)
+{
+  return MemoryAccounting::GetSize(subsystem);
+}
+
+//-----------------------------------------------------------------------------
+unsigned long vtkMemoryAccounting::GetPeakSize(int subsystem)
+{
+  return MemoryAccounting::GetPeakSize(subsystem);
+}
+
+//-----------------------------------------------------------------------------
+void vtkMemoryAccounting::ResetPeakSizes()
+{
+  MemoryAccounting::ResetPeakSizes();
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkMemoryAccounting::GetSummary()
+{
+  return MemoryAccounting::GetSummary();
+}
+
+//-----------------------------------------------------------------------------
+void vtkMemoryAccounting::SetBudget(unsigned long kibibytes)
+{
+  MemoryAccounting::SetBudget(kibibytes);
+}
+
+//-----------------------------------------------------------------------------
+unsigned long vtkMemoryAccounting::GetBudget()
+{
+  return MemoryAccounting::GetBudget();
+}
+
+//-----------------------------------------------------------------------------
+unsigned long vtkMemoryAccounting::Enforce()
+{
+  return MemoryAccounting::Enforce();
+}
@@ -0,0 +1,68 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_MEMORY_ACCOUNTING_H
+#define VTK_MEMORY_ACCOUNTING_H
+
+#include <vtkObject.h>
+
+#include <string>
+
+/**
+ * @brief The vtkMemoryAccounting class gives the sizes of MemoryAccounting to Python:
+ * the memory held by the live frames, the trailing frames, the slam cache and the slam maps,
+ * in kibibytes, with the peak sizes since the last ResetPeakSizes. It also sets the budget the
+ * caches are released to.
+ */
+class VTK_EXPORT vtkMemoryAccounting : public vtkObject
+{
+public:
+  static vtkMemoryAccounting* New();
+  vtkTypeMacro(vtkMemoryAccounting, vtkObject)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  static int GetNumberOfSubsystems();
+  static const char* GetSubsystemName(int subsystem);
+
+  //! Memory currently held by a subsystem, in kibibytes
+  static unsigned long GetSize(int subsystem);
+
+  //! Highest memory held by a subsystem since the last ResetPeakSizes, in kibibytes
+  static unsigned long GetPeakSize(int subsystem);
+
+  static void ResetPeakSizes();
+
+  //! One line summary of the sizes and of the peak sizes, for the status bar
+  static std::string GetSummary();
+
+  //! Memory the subsystems may hold together, in kibibytes, 0 for no budget
+  static void SetBudget(unsigned long kibibytes);
+  static unsigned long GetBudget();
+
+  //! Release the caches to fit in the budget and in the memory of the system, see
+  //! MemoryAccounting::Enforce
+  static unsigned long Enforce();
+
+protected:
+  vtkMemoryAccounting() = default;
+
+private:
+  vtkMemoryAccounting(const vtkMemoryAccounting&) = delete;
+  void operator=(const vtkMemoryAccounting&) = delete;
+};
+
+#endif // VTK_MEMORY_ACCOUNTING_H
@@ -16,10 +16,12 @@
 //=========================================================================
 
 #include "vtkPCLConversions.h"
+#include "vtkStridedFloatArray.h"
+#include "vtkLidarPointCloudFile.h"
+#include "LidarDecodingKernels.h"
 
 #include <vtkObjectFactory.h>
 #include <vtkPolyData.h>
-#include <vtkTimerLog.h>
 #include <vtkNew.h>
 #include <vtkIdList.h>
 #include <vtkCellArray.h>
@@ -31,7 +33,6 @@
 
 #include <pcl/io/pcd_io.h>
 
-#include <cassert>
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPCLConversions);
@@ -61,6 +62,30 @@ vtkSmartPointer<vtkPolyData> TemplatedPolyDataFromPCDFile(const std::string& fil
   return vtkPCLConversions::PolyDataFromPointCloud(cloud);
 }
 
+template <typename T>
+vtkSmartPointer<vtkPolyData> TemplatedPolyDataViewOfPointCloud(typename pcl::PointCloud<T>::ConstPtr cloud)
+{
+  if (!cloud->is_dense)
+    {
+    return vtkPCLConversions::PolyDataFromPointCloud(cloud);
+    }
+
+  // the pcl points are padded, x y z being the first values of each one
+  const vtkIdType nr_points = cloud->points.size();
+  vtkNew<vtkStridedFloatArray> coordinates;
+  coordinates->SetStridedArray(nr_points ? cloud->points[0].data : nullptr, nr_points, 3,
+                               sizeof(T) / sizeof(float),
+                               std::shared_ptr<const void>(cloud.get(), [cloud](const void*) {}));
+
+  vtkNew<vtkPoints> points;
+  points->SetData(coordinates.GetPointer());
+
+  vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+  polyData->SetPoints(points.GetPointer());
+  polyData->SetVerts(vtkPCLConversions::NewVertexCells(nr_points));
+  return polyData;
+}
+
 }
 
 
@@ -85,6 +110,12 @@ vtkSmartPointer<vtkPolyData> vtkPCLConversions::PolyDataFromPCDFile(const std::s
     return TemplatedPolyDataFromPCDFile<pcl::PointXYZRGB>(filename);
   }
   else {
+    // the binary files are mapped and read directly, with all their fields
+    vtkSmartPointer<vtkPolyData> polyData = vtkLidarPointCloudFile::Read(filename);
+    if (polyData)
+    {
+      return polyData;
+    }
     return TemplatedPolyDataFromPCDFile<pcl::PointXYZ>(filename);
   }
 }
@@ -278,34 +309,53 @@ vtkSmartPointer<vtkPolyData> vtkPCLConversions::PolyDataFromPointCloud(pcl::Poin
   return polyData;
 }
 
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkPCLConversions::PolyDataViewOfPointCloud(pcl::PointCloud<pcl::PointXYZINormal>::ConstPtr cloud)
+{
+  return TemplatedPolyDataViewOfPointCloud<pcl::PointXYZINormal>(cloud);
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkPCLConversions::PolyDataViewOfPointCloud(pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud)
+{
+  return TemplatedPolyDataViewOfPointCloud<pcl::PointXYZ>(cloud);
+}
+
 //----------------------------------------------------------------------------
 pcl::PointCloud<pcl::PointXYZ>::Ptr vtkPCLConversions::PointCloudFromPolyData(vtkPolyData* polyData)
+{
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
+  PointCloudFromPolyData(polyData, *cloud);
+  return cloud;
+}
+
+//----------------------------------------------------------------------------
+void vtkPCLConversions::PointCloudFromPolyData(vtkPolyData* polyData, pcl::PointCloud<pcl::PointXYZ>& cloud)
 {
   const vtkIdType numberOfPoints = polyData->GetNumberOfPoints();
 
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
-  cloud->width = numberOfPoints;
-  cloud->height = 1;
-  cloud->is_dense = true;
-  cloud->points.resize(numberOfPoints);
+  cloud.width = numberOfPoints;
+  cloud.height = 1;
+  cloud.is_dense = true;
+  cloud.points.resize(numberOfPoints);
 
   if (!numberOfPoints)
     {
-    return cloud;
+    return;
     }
 
-  vtkFloatArray* floatPoints = vtkFloatArray::SafeDownCast(polyData->GetPoints()->GetData());
-  vtkDoubleArray* doublePoints = vtkDoubleArray::SafeDownCast(polyData->GetPoints()->GetData());
-  assert(floatPoints || doublePoints);
+  vtkDataArray* coordinates = polyData->GetPoints()->GetData();
+  vtkFloatArray* floatPoints = vtkFloatArray::SafeDownCast(coordinates);
+  vtkDoubleArray* doublePoints = vtkDoubleArray::SafeDownCast(coordinates);
 
   if (floatPoints)
     {
     float* data = floatPoints->GetPointer(0);
     for (vtkIdType i = 0; i < numberOfPoints; ++i)
       {
-      cloud->points[i].x = data[i*3];
-      cloud->points[i].y = data[i*3+1];
-      cloud->points[i].z = data[i*3+2];
+      cloud.points[i].x = data[i*3];
+      cloud.points[i].y = data[i*3+1];
+      cloud.points[i].z = data[i*3+2];
       }
     }
   else if (doublePoints)
@@ -313,82 +363,28 @@ pcl::PointCloud<pcl::PointXYZ>::Ptr vtkPCLConversions::PointCloudFromPolyData(vt
     double* data = doublePoints->GetPointer(0);
     for (vtkIdType i = 0; i < numberOfPoints; ++i)
       {
-      cloud->points[i].x = data[i*3];
-      cloud->points[i].y = data[i*3+1];
-      cloud->points[i].z = data[i*3+2];
+      cloud.points[i].x = data[i*3];
+      cloud.points[i].y = data[i*3+1];
+      cloud.points[i].z = data[i*3+2];
       }
     }
-
-  return cloud;
-}
-
-//----------------------------------------------------------------------------
-vtkSmartPointer<vtkCellArray> vtkPCLConversions::NewVertexCells(vtkIdType numberOfVerts)
-{
-  vtkNew<vtkIdTypeArray> cells;
-  cells->SetNumberOfValues(numberOfVerts*2);
-  vtkIdType* ids = cells->GetPointer(0);
-  for (vtkIdType i = 0; i < numberOfVerts; ++i)
+  else
     {
-    ids[i*2] = 1;
-    ids[i*2+1] = i;
+    // any other layout, a view of a point cloud for example
+    for (vtkIdType i = 0; i < numberOfPoints; ++i)
+      {
+      cloud.points[i].x = coordinates->GetComponent(i, 0);
+      cloud.points[i].y = coordinates->GetComponent(i, 1);
+      cloud.points[i].z = coordinates->GetComponent(i, 2);
+      }
     }
-
-  vtkSmartPointer<vtkCellArray> cellArray = vtkSmartPointer<vtkCellArray>::New();
-  cellArray->SetCells(numberOfVerts, cells.GetPointer());
-  return cellArray;
 }
 
 //----------------------------------------------------------------------------
-void vtkPCLConversions::PerformPointCloudConversionBenchmark(vtkPolyData* polyData)
+vtkSmartPointer<vtkCellArray> vtkPCLConversions::NewVertexCells(vtkIdType numberOfVerts)
 {
-  if (!polyData)
-    {
-    return;
-    }
-
-  double start;
-  double elapsed;
-  unsigned long kilobytes;
-
-  const vtkIdType numberOfPoints = polyData->GetNumberOfPoints();
-  std::cout << "Number of input points: " << numberOfPoints << std::endl;
-
-  start = vtkTimerLog::GetUniversalTime();
-  pcl::PointCloud<pcl::PointXYZ>::Ptr tempCloud = PointCloudFromPolyData(polyData);
-  elapsed = vtkTimerLog::GetUniversalTime() - start;
-
-  std::cout << "Conversion to pcl::PointCloud took " << elapsed << " seconds. "
-            << numberOfPoints / elapsed << " points per second." << std::endl;
-
-
-  start = vtkTimerLog::GetUniversalTime();
-  vtkSmartPointer<vtkPolyData> tempPolyData = PolyDataFromPointCloud(tempCloud);
-  elapsed = vtkTimerLog::GetUniversalTime() - start;
-
-  std::cout << "Conversion to vtkPolyData took " << elapsed << " seconds. "
-            << numberOfPoints / elapsed << " points per second." << std::endl;
-
-
-  start = vtkTimerLog::GetUniversalTime();
-  vtkSmartPointer<vtkCellArray> tempCells = NewVertexCells(numberOfPoints);
-  elapsed = vtkTimerLog::GetUniversalTime() - start;
-
-  std::cout << "Constructing vertex cells took " << elapsed << " seconds. "
-            << numberOfPoints / elapsed << " points per second." << std::endl;
-
-
-  kilobytes = tempPolyData->GetActualMemorySize();
-  std::cout << "vtkPolyData uses " << kilobytes/1024.0 << " MB. "
-            << kilobytes*1024 / numberOfPoints << " bytes per point." << std::endl;
-
-  kilobytes = tempPolyData->GetPoints()->GetActualMemorySize();
-  std::cout << "vtkPolyData's points use " << kilobytes/1024.0 << " MB. "
-            << kilobytes*1024 / numberOfPoints << " bytes per point." << std::endl;
-
-  kilobytes = tempPolyData->GetVerts()->GetActualMemorySize();
-  std::cout << "vtkPolyData's cells use " << kilobytes/1024.0 << " MB. "
-            << kilobytes*1024 / numberOfPoints << " bytes per point." << std::endl;
+  // shared with the frames of the lidar interpreters
+  return ::NewVertexCells(numberOfVerts);
 }
 
 //----------------------------------------------------------------------------
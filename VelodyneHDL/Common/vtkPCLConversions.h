@@ -60,17 +60,30 @@ public:
   static vtkSmartPointer<vtkPolyData> PolyDataFromPointCloud(
     pcl::PointCloud<pcl::PointXYZRGBA>::ConstPtr cloud);
 
+  // Description:
+  // Give a vtkPolyData whose points are read in the memory of the cloud, which is
+  // kept alive by the points. The points are only copied if they are modified, or
+  // when the cloud is not dense since its invalid points must be skipped.
+  static vtkSmartPointer<vtkPolyData> PolyDataViewOfPointCloud(
+    pcl::PointCloud<pcl::PointXYZINormal>::ConstPtr cloud);
+
+  static vtkSmartPointer<vtkPolyData> PolyDataViewOfPointCloud(
+    pcl::PointCloud<pcl::PointXYZ>::ConstPtr cloud);
+
   static pcl::PointCloud<pcl::PointXYZ>::Ptr PointCloudFromPolyData(
     vtkPolyData* polyData);
 
+  // Description:
+  // Fill cloud with the points of polyData, reusing its memory.
+  static void PointCloudFromPolyData(vtkPolyData* polyData,
+    pcl::PointCloud<pcl::PointXYZ>& cloud);
+
   static vtkSmartPointer<vtkCellArray> NewVertexCells(vtkIdType numberOfVerts);
 
   static vtkSmartPointer<vtkIntArray> NewLabelsArray(pcl::IndicesConstPtr indices, vtkIdType length);
   static vtkSmartPointer<vtkIntArray> NewLabelsArray(pcl::PointIndices::ConstPtr indices, vtkIdType length);
   static vtkSmartPointer<vtkIntArray> NewLabelsArray(const std::vector<pcl::PointIndices>& indices, vtkIdType length);
 
-  static void PerformPointCloudConversionBenchmark(vtkPolyData* polyData);
-
 protected:
 
   vtkPCLConversions();
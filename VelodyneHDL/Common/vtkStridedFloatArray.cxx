@@ -0,0 +1,96 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vtkStridedFloatArray.h"
+
+#include <vtkObjectFactory.h>
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkStridedFloatArray)
+
+//-----------------------------------------------------------------------------
+vtkStridedFloatArray::vtkStridedFloatArray()
+{
+}
+
+//-----------------------------------------------------------------------------
+void vtkStridedFloatArray::SetStridedArray(const float* data, vtkIdType numberOfTuples,
+                                           int numberOfComponents, vtkIdType stride,
+                                           std::shared_ptr<const void> owner)
+{
+  std::vector<float>().swap(this->Storage);
+  this->Data = data;
+  this->Stride = stride;
+  this->Owner = owner;
+  this->NumberOfComponents = numberOfComponents;
+  this->Size = numberOfTuples * numberOfComponents;
+  this->MaxId = this->Size - 1;
+  this->DataChanged();
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void* vtkStridedFloatArray::GetVoidPointer(vtkIdType valueIdx)
+{
+  this->Detach();
+  return this->Storage.data() + valueIdx;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkStridedFloatArray::AllocateTuples(vtkIdType numberOfTuples)
+{
+  this->Owner.reset();
+  this->Storage.assign(numberOfTuples * this->NumberOfComponents, 0.f);
+  this->Data = this->Storage.data();
+  this->Stride = this->NumberOfComponents;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkStridedFloatArray::ReallocateTuples(vtkIdType numberOfTuples)
+{
+  this->Detach();
+  this->Storage.resize(numberOfTuples * this->NumberOfComponents);
+  this->Data = this->Storage.data();
+  this->Stride = this->NumberOfComponents;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void vtkStridedFloatArray::Detach()
+{
+  if (!this->Owner)
+  {
+    return;
+  }
+
+  // the array is packed, keeping its capacity
+  const int numberOfComponents = this->NumberOfComponents;
+  const vtkIdType numberOfTuples = this->Size / numberOfComponents;
+  std::vector<float> storage(this->Size);
+  for (vtkIdType tupleIdx = 0; tupleIdx < numberOfTuples; ++tupleIdx)
+  {
+    const float* values = this->Data + tupleIdx * this->Stride;
+    std::copy(values, values + numberOfComponents, storage.begin() + tupleIdx * numberOfComponents);
+  }
+
+  this->Storage.swap(storage);
+  this->Data = this->Storage.data();
+  this->Stride = numberOfComponents;
+  this->Owner.reset();
+  this->DataChanged();
+}
@@ -0,0 +1,120 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_STRIDED_FLOAT_ARRAY_H
+#define VTK_STRIDED_FLOAT_ARRAY_H
+
+#include <vtkGenericDataArray.h>
+
+// STD
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief vtkStridedFloatArray a float array reading its tuples in memory it does not
+ * own, the consecutive tuples being Stride values apart. This shows the coordinates of
+ * an array of structures (a pcl::PointCloud for example) without copying them.
+ *
+ * The shared memory is never written: the values are copied in a storage owned by the
+ * array the first time they are modified, or when a contiguous pointer is requested
+ * with GetVoidPointer
+ */
+class vtkStridedFloatArray : public vtkGenericDataArray<vtkStridedFloatArray, float>
+{
+  typedef vtkGenericDataArray<vtkStridedFloatArray, float> GenericDataArrayType;
+
+public:
+  vtkTypeMacro(vtkStridedFloatArray, GenericDataArrayType)
+  typedef Superclass::ValueType ValueType;
+
+  static vtkStridedFloatArray* New();
+
+  /**
+   * @brief SetStridedArray show numberOfTuples tuples of numberOfComponents values,
+   * the first one starting at data
+   * @param stride number of values between the starts of two consecutive tuples
+   * @param owner kept alive as long as the array reads data
+   */
+  void SetStridedArray(const float* data, vtkIdType numberOfTuples, int numberOfComponents,
+                       vtkIdType stride, std::shared_ptr<const void> owner);
+
+  //! Indicate if the values are read in the memory given to SetStridedArray
+  bool IsShared() const { return this->Owner != nullptr; }
+
+  ValueType GetValue(vtkIdType valueIdx) const
+  {
+    return this->GetTypedComponent(valueIdx / this->NumberOfComponents,
+                                   static_cast<int>(valueIdx % this->NumberOfComponents));
+  }
+
+  void SetValue(vtkIdType valueIdx, ValueType value)
+  {
+    this->SetTypedComponent(valueIdx / this->NumberOfComponents,
+                            static_cast<int>(valueIdx % this->NumberOfComponents), value);
+  }
+
+  void GetTypedTuple(vtkIdType tupleIdx, ValueType* tuple) const
+  {
+    const float* values = this->Data + tupleIdx * this->Stride;
+    std::copy(values, values + this->NumberOfComponents, tuple);
+  }
+
+  void SetTypedTuple(vtkIdType tupleIdx, const ValueType* tuple)
+  {
+    this->Detach();
+    std::copy(tuple, tuple + this->NumberOfComponents, this->Storage.begin() + tupleIdx * this->Stride);
+  }
+
+  ValueType GetTypedComponent(vtkIdType tupleIdx, int compIdx) const
+  {
+    return this->Data[tupleIdx * this->Stride + compIdx];
+  }
+
+  void SetTypedComponent(vtkIdType tupleIdx, int compIdx, ValueType value)
+  {
+    this->Detach();
+    this->Storage[tupleIdx * this->Stride + compIdx] = value;
+  }
+
+  //! Give the contiguous values, copying the shared ones first
+  void* GetVoidPointer(vtkIdType valueIdx) override;
+
+protected:
+  vtkStridedFloatArray();
+  ~vtkStridedFloatArray() override = default;
+
+  bool AllocateTuples(vtkIdType numberOfTuples);
+  bool ReallocateTuples(vtkIdType numberOfTuples);
+
+  //! Copy the shared values in Storage, so that they can be modified
+  void Detach();
+
+  //! First value of the first tuple, in Storage or in the shared memory
+  const float* Data = nullptr;
+  vtkIdType Stride = 1;
+  std::vector<float> Storage;
+  std::shared_ptr<const void> Owner;
+
+private:
+  vtkStridedFloatArray(const vtkStridedFloatArray&) = delete;
+  void operator=(const vtkStridedFloatArray&) = delete;
+
+  friend class vtkGenericDataArray<vtkStridedFloatArray, float>;
+};
+
+#endif // VTK_STRIDED_FLOAT_ARRAY_H
@@ -3,7 +3,6 @@
 #include "vtkConversions.h"
 
 #include <vtkCellData.h>
-#include <vtkPolyLine.h>
 #include <vtkTransform.h>
 
 #include <cmath>
@@ -11,6 +10,56 @@
 // Eigen
 #include <Eigen/Dense>
 
+#include <algorithm>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Return the array itself if it stores doubles, else a copy converted to doubles
+vtkSmartPointer<vtkDoubleArray> ToDoubleArray(vtkDataArray* array)
+{
+  vtkSmartPointer<vtkDoubleArray> doubleArray = vtkDoubleArray::SafeDownCast(array);
+  if (!doubleArray)
+  {
+    doubleArray = vtkSmartPointer<vtkDoubleArray>::New();
+    doubleArray->DeepCopy(array);
+    doubleArray->SetName(array->GetName());
+  }
+  return doubleArray;
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Matrix3d GetRotationMatrix(const Eigen::Ref<const Eigen::Vector4d>& xyzw)
+{
+  // the axis read from a file may not be exactly normalized
+  const double norm = xyzw.head<3>().norm();
+  if (norm == 0.0)
+  {
+    return Eigen::Matrix3d::Identity();
+  }
+  return Eigen::AngleAxisd(xyzw(3), xyzw.head<3>() / norm).toRotationMatrix();
+}
+
+//-----------------------------------------------------------------------------
+void SetAxisAngle(const Eigen::Matrix3d& R, Eigen::Ref<Eigen::Vector4d> xyzw)
+{
+  Eigen::AngleAxisd angleAxis(R);
+  xyzw << angleAxis.axis(), angleAxis.angle();
+}
+
+//-----------------------------------------------------------------------------
+// Row-major 4x4 matrix of a pose, as expected by vtkTransform::SetMatrix
+void GetPoseMatrix(const Eigen::Ref<const Eigen::Vector4d>& xyzw,
+                   const Eigen::Ref<const Eigen::Vector3d>& translation,
+                   double matrix[16])
+{
+  Eigen::Map<Eigen::Matrix<double, 4, 4, Eigen::RowMajor>> pose(matrix);
+  pose.setIdentity();
+  pose.topLeftCorner<3, 3>() = GetRotationMatrix(xyzw);
+  pose.topRightCorner<3, 1>() = translation;
+}
+}
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkTemporalTransforms)
 
@@ -18,6 +67,7 @@ vtkStandardNewMacro(vtkTemporalTransforms)
 vtkTemporalTransforms::vtkTemporalTransforms()
 {
   auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
 
   auto timeArray = vtkSmartPointer<vtkDoubleArray>::New();
   timeArray->SetName(this->TimeArrayName);
@@ -54,64 +104,83 @@ vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::CreateFromPolyData
   if (temporalTransforms->GetLines()->GetNumberOfCells() == 0)
   {
     // create the cell in the same time for visualization
-    auto polyLine = vtkSmartPointer<vtkPolyLine>::New();
-    polyLine->GetPointIds()->SetNumberOfIds(temporalTransforms->GetNumberOfPoints());
-    for (vtkIdType i = 0; i < temporalTransforms->GetNumberOfPoints(); i++)
-    {
-      polyLine->GetPointIds()->SetId(i,i);
-    }
-    auto cell = vtkSmartPointer<vtkCellArray>::New();
-    cell->InsertNextCell(polyLine);
-    temporalTransforms->SetLines(cell);
+    temporalTransforms->UpdatePolyLine();
   }
 
   return temporalTransforms;
 }
 
+//-----------------------------------------------------------------------------
 vtkSmartPointer<vtkTransform> vtkTemporalTransforms::GetTransform(unsigned int transformNumber)
 {
-  auto axisAngle = this->GetOrientationArray();
+  double matrix[16];
+  GetPoseMatrix(this->GetAxisAngles().col(transformNumber),
+                this->GetTranslations().col(transformNumber), matrix);
   auto transform = vtkSmartPointer<vtkTransform>::New();
-  transform->PostMultiply();
-  double x = axisAngle->GetTuple4(transformNumber)[0];
-  double y = axisAngle->GetTuple4(transformNumber)[1];
-  double z = axisAngle->GetTuple4(transformNumber)[2];
-  double w = axisAngle->GetTuple4(transformNumber)[3]
-      * 180 / vtkMath::Pi(); // vtk need degrees not radians
-  transform->RotateWXYZ(w, x, y, z);
-  transform->Translate(this->GetTranslationArray()->GetTuple(transformNumber));
-
+  transform->SetMatrix(matrix);
   return transform;
 }
 
+//-----------------------------------------------------------------------------
 vtkSmartPointer<vtkVelodyneTransformInterpolator> vtkTemporalTransforms::CreateInterpolator()
 {
   auto interpolator = vtkSmartPointer<vtkVelodyneTransformInterpolator>::New();
 
-  auto timestamp = this->GetTimeArray();
+  const auto times = this->GetTimes();
+  const auto axisAngles = this->GetAxisAngles();
+  const auto translations = this->GetTranslations();
 
-  for (unsigned int i = 0; i < this->GetNumberOfPoints(); i++)
+  // the interpolator copies the pose out of the transform, so a single one is used
+  auto transform = vtkSmartPointer<vtkTransform>::New();
+  double matrix[16];
+  for (vtkIdType i = 0; i < times.size(); i++)
   {
-    // get timestamp
-    double currentTimestamp = timestamp->GetTuple1(i);
-
-    // create the tranform
-    auto transform = this->GetTransform(i);
-
-    // add the tranform to the interpolator
-    if (!vtkMath::IsNan(currentTimestamp))
-    {
-      interpolator->AddTransform(currentTimestamp, transform);
-    }
-    else
+    if (vtkMath::IsNan(times(i)))
     {
       vtkErrorMacro(<< "Timestamp " << i << "is not a number")
+      continue;
     }
+    GetPoseMatrix(axisAngles.col(i), translations.col(i), matrix);
+    transform->SetMatrix(matrix);
+    interpolator->AddTransform(times(i), transform);
   }
   interpolator->Modified();
   return interpolator;
 }
 
+//-----------------------------------------------------------------------------
+Eigen::Map<Eigen::RowVectorXd> vtkTemporalTransforms::GetTimes()
+{
+  vtkSmartPointer<vtkDoubleArray> times = ToDoubleArray(this->GetTimeArray());
+  if (times != this->GetTimeArray())
+  {
+    this->SetTimeArray(times);
+  }
+  return Eigen::Map<Eigen::RowVectorXd>(times->GetPointer(0), times->GetNumberOfTuples());
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Map<Eigen::Matrix4Xd> vtkTemporalTransforms::GetAxisAngles()
+{
+  vtkSmartPointer<vtkDoubleArray> axisAngles = ToDoubleArray(this->GetOrientationArray());
+  if (axisAngles != this->GetOrientationArray())
+  {
+    this->SetOrientationArray(axisAngles);
+  }
+  return Eigen::Map<Eigen::Matrix4Xd>(axisAngles->GetPointer(0), 4, axisAngles->GetNumberOfTuples());
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Map<Eigen::Matrix3Xd> vtkTemporalTransforms::GetTranslations()
+{
+  vtkSmartPointer<vtkDoubleArray> translations = ToDoubleArray(this->GetTranslationArray());
+  if (translations != this->GetTranslationArray())
+  {
+    this->GetPoints()->SetData(translations);
+  }
+  return Eigen::Map<Eigen::Matrix3Xd>(translations->GetPointer(0), 3, translations->GetNumberOfTuples());
+}
+
 //-----------------------------------------------------------------------------
 void vtkTemporalTransforms::SetOrientationArray(vtkDoubleArray *array)
 {
@@ -137,15 +206,7 @@ void vtkTemporalTransforms::SetTranslationArray(vtkDataArray *array)
   this->GetPoints()->SetData(array);
 
   // create the cell in the same time for visualization
-  auto polyLine = vtkSmartPointer<vtkPolyLine>::New();
-  polyLine->GetPointIds()->SetNumberOfIds(this->GetNumberOfPoints());
-  for (vtkIdType i = 0; i < array->GetNumberOfTuples(); i++)
-  {
-    polyLine->GetPointIds()->SetId(i,i);
-  }
-  auto cell = vtkSmartPointer<vtkCellArray>::New();
-  cell->InsertNextCell(polyLine);
-  this->SetLines(cell);
+  this->UpdatePolyLine();
 }
 
 //-----------------------------------------------------------------------------
@@ -168,39 +229,7 @@ vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::IsometricTransform
 
   // First, compute the rotation and translation from H 4x4 matrix
   std::pair<Eigen::Vector3d, Eigen::Vector3d> transParams = GetPoseParamsFromTransform(H);
-  Eigen::Matrix3d R0 = RollPitchYawToMatrix(transParams.first);
-  Eigen::Vector3d T0 = transParams.second;
-
-  // We need to change the angle axis and position arrays
-  vtkDoubleArray* xyzwArray = vtkDoubleArray::SafeDownCast(this->GetOrientationArray());
-  vtkDoubleArray* xyzArray = vtkDoubleArray::SafeDownCast(this->GetTranslationArray());
-
-  // Loop over the transforms points
-  for (unsigned int transformIndex = 0; transformIndex < this->GetNumberOfPoints(); transformIndex++)
-  {
-    // Get the angle-axis representation
-    double* xyzw = xyzwArray->GetTuple4(transformIndex);
-    double* xyz = xyzArray->GetTuple3(transformIndex);
-
-    // Compute the corresponding rotation matrix that
-    // correspond to the angle axis representation
-    Eigen::Vector3d T(xyz[0], xyz[1], xyz[2]);
-    Eigen::AngleAxisd angleAxis(xyzw[3], Eigen::Vector3d(xyzw[0], xyzw[1], xyzw[2]));
-    Eigen::Matrix3d R = angleAxis.toRotationMatrix();
-
-    // Compute the new rotation and translation
-    R = R0 * R;
-    T = R0 * T + T0;
-
-    // Get the axis angle representation of this new rotation
-    Eigen::AngleAxisd newAngleAxis(R);
-    double newXyzw[4] = {newAngleAxis.axis()(0), newAngleAxis.axis()(1),
-                         newAngleAxis.axis()(2), newAngleAxis.angle()};
-
-    // Replace it
-    xyzwArray->SetTuple4(transformIndex, newXyzw[0], newXyzw[1], newXyzw[2], newXyzw[3]);
-    xyzArray->SetTuple3(transformIndex, T(0), T(1), T(2));
-  }
+  outputPoses->IsometricTransformInPlace(RollPitchYawToMatrix(transParams.first), transParams.second);
   return outputPoses;
 }
 
@@ -212,40 +241,40 @@ vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::CycloidicTransform
 
   // First, compute the rotation and translation from H 4x4 matrix
   std::pair<Eigen::Vector3d, Eigen::Vector3d> transParams = GetPoseParamsFromTransform(H);
-  Eigen::Matrix3d R0 = RollPitchYawToMatrix(transParams.first);
-  Eigen::Vector3d T0 = transParams.second;
+  outputPoses->CycloidicTransformInPlace(RollPitchYawToMatrix(transParams.first), transParams.second);
+  return outputPoses;
+}
 
-  // We need to change the angle axis and position arrays
-  vtkDoubleArray* xyzwArray = vtkDoubleArray::SafeDownCast(this->GetOrientationArray());
-  vtkDoubleArray* xyzArray = vtkDoubleArray::SafeDownCast(this->GetTranslationArray());
+//-----------------------------------------------------------------------------
+void vtkTemporalTransforms::IsometricTransformInPlace(const Eigen::Matrix3d& R0, const Eigen::Vector3d& T0)
+{
+  auto axisAngles = this->GetAxisAngles();
+  auto translations = this->GetTranslations();
+  for (vtkIdType i = 0; i < axisAngles.cols(); i++)
+  {
+    const Eigen::Matrix3d R = R0 * GetRotationMatrix(axisAngles.col(i));
+    translations.col(i) = R0 * translations.col(i) + T0;
+    SetAxisAngle(R, axisAngles.col(i));
+  }
+  this->GetOrientationArray()->Modified();
+  this->GetTranslationArray()->Modified();
+  this->Modified();
+}
 
-  // Loop over the transforms points
-  for (unsigned int transformIndex = 0; transformIndex < this->GetNumberOfPoints(); transformIndex++)
+//-----------------------------------------------------------------------------
+void vtkTemporalTransforms::CycloidicTransformInPlace(const Eigen::Matrix3d& R0, const Eigen::Vector3d& T0)
+{
+  auto axisAngles = this->GetAxisAngles();
+  auto translations = this->GetTranslations();
+  for (vtkIdType i = 0; i < axisAngles.cols(); i++)
   {
-    // Get the angle-axis representation
-    double* xyzw = xyzwArray->GetTuple4(transformIndex);
-    double* xyz = xyzArray->GetTuple3(transformIndex);
-
-    // Compute the corresponding rotation matrix that
-    // correspond to the angle axis representation
-    Eigen::Vector3d T(xyz[0], xyz[1], xyz[2]);
-    Eigen::AngleAxisd angleAxis(xyzw[3], Eigen::Vector3d(xyzw[0], xyzw[1], xyzw[2]));
-    Eigen::Matrix3d R = angleAxis.toRotationMatrix();
-
-    // Compute the new rotation and translation
-    T = R * T0 + T;
-    R = R * R0;
-
-    // Get the axis angle representation of this new rotation
-    Eigen::AngleAxisd newAngleAxis(R);
-    double newXyzw[4] = {newAngleAxis.axis()(0), newAngleAxis.axis()(1),
-                         newAngleAxis.axis()(2), newAngleAxis.angle()};
-
-    // Replace it
-    xyzwArray->SetTuple4(transformIndex, newXyzw[0], newXyzw[1], newXyzw[2], newXyzw[3]);
-    xyzArray->SetTuple3(transformIndex, T(0), T(1), T(2));
+    const Eigen::Matrix3d R = GetRotationMatrix(axisAngles.col(i));
+    translations.col(i) += R * T0;
+    SetAxisAngle(R * R0, axisAngles.col(i));
   }
-  return outputPoses;
+  this->GetOrientationArray()->Modified();
+  this->GetTranslationArray()->Modified();
+  this->Modified();
 }
 
 //-----------------------------------------------------------------------------
@@ -258,142 +287,121 @@ void vtkTemporalTransforms::PushBack(double time, const Eigen::AngleAxisd& orien
                                                 orientation.angle());
   this->GetTranslationArray()->InsertNextTuple(static_cast<const double*>(translation.data()));
 
-  // replace the cell by a line with one more point
-  auto polyLine = vtkSmartPointer<vtkPolyLine>::New();
-  polyLine->GetPointIds()->SetNumberOfIds(this->GetNumberOfPoints());
-  for (vtkIdType i = 0; i < this->GetNumberOfPoints(); i++)
+  // extend the line with the new point, instead of creating it again each time
+  const vtkIdType numberOfPoints = this->GetNumberOfPoints();
+  vtkCellArray* lines = this->GetLines();
+  if (numberOfPoints > 1 && lines->GetNumberOfCells() == 1 &&
+      lines->GetNumberOfConnectivityEntries() == numberOfPoints)
   {
-    polyLine->GetPointIds()->SetId(i,i);
+    lines->InsertCellPoint(numberOfPoints - 1);
+    lines->UpdateCellCount(numberOfPoints);
+    lines->Modified();
+    this->Modified();
+  }
+  else
+  {
+    this->UpdatePolyLine();
   }
-  auto cell = vtkSmartPointer<vtkCellArray>::New();
-  cell->InsertNextCell(polyLine);
-  this->SetLines(cell);
 }
 
+//-----------------------------------------------------------------------------
 vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::ExtractTimes(double tstart, double tend)
 {
-  auto extract = vtkSmartPointer<vtkTemporalTransforms>::New();
-
-  for (unsigned int i = 0; i < this->GetNumberOfPoints(); i++)
+  const auto times = this->GetTimes();
+  std::vector<vtkIdType> indices;
+  for (vtkIdType i = 0; i < times.size(); i++)
   {
-    // get timestamp
-    double currentTimestamp = this->GetTimeArray()->GetTuple1(i);
-    if (currentTimestamp < tstart || currentTimestamp > tend) {
-      continue;
+    if (times(i) >= tstart && times(i) <= tend)
+    {
+      indices.push_back(i);
     }
-
-    extract->GetTimeArray()->InsertNextTuple1(currentTimestamp);
-    double* aa = this->GetOrientationArray()->GetTuple4(i);
-    extract->GetOrientationArray()->InsertNextTuple(aa);
-    double* xyz = this->GetTranslationArray()->GetTuple3(i);
-    extract->GetTranslationArray()->InsertNextTuple(xyz);
   }
-
-  return extract;
+  return this->ExtractIndices(indices);
 }
 
+//-----------------------------------------------------------------------------
 vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::Subsample(int N)
 {
-
-  auto extract = vtkSmartPointer<vtkTemporalTransforms>::New();
-
-  for (unsigned int i = 0; i < this->GetNumberOfPoints(); i++)
+  N = std::max(N, 1);
+  std::vector<vtkIdType> indices;
+  indices.reserve(this->GetNumberOfPoints() / N + 1);
+  for (vtkIdType i = 0; i < this->GetNumberOfPoints(); i += N)
   {
-    if (i % N != 0)
-    {
-      continue;
-    }
-    // get timestamp
-    double currentTimestamp = this->GetTimeArray()->GetTuple1(i);
-    extract->GetTimeArray()->InsertNextTuple1(currentTimestamp);
-    double* aa = this->GetOrientationArray()->GetTuple4(i);
-    extract->GetOrientationArray()->InsertNextTuple(aa);
-    double* xyz = this->GetTranslationArray()->GetTuple3(i);
-    extract->GetTranslationArray()->InsertNextTuple(xyz);
+    indices.push_back(i);
   }
-
-  auto polyLine = vtkSmartPointer<vtkPolyLine>::New();
-  polyLine->GetPointIds()->SetNumberOfIds(extract->GetNumberOfPoints());
-  for (vtkIdType i = 0; i < extract->GetNumberOfPoints(); i++)
-  {
-    polyLine->GetPointIds()->SetId(i,i);
-  }
-  auto cell = vtkSmartPointer<vtkCellArray>::New();
-  cell->InsertNextCell(polyLine);
-  extract->SetLines(cell);
-
-  return extract;
+  return this->ExtractIndices(indices);
 }
 
+//-----------------------------------------------------------------------------
 vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::ApplyTimeshift(double shift)
 {
   auto timeshifted = vtkSmartPointer<vtkTemporalTransforms>::New();
-
-  for (unsigned int i = 0; i < this->GetNumberOfPoints(); i++)
-  {
-    double currentTimestamp = this->GetTimeArray()->GetTuple1(i);
-    timeshifted->GetTimeArray()->InsertNextTuple1(currentTimestamp + shift);
-    double* aa = this->GetOrientationArray()->GetTuple4(i);
-    timeshifted->GetOrientationArray()->InsertNextTuple(aa);
-    double* xyz = this->GetTranslationArray()->GetTuple3(i);
-    timeshifted->GetTranslationArray()->InsertNextTuple(xyz);
-  }
-
-  auto polyLine = vtkSmartPointer<vtkPolyLine>::New();
-  polyLine->GetPointIds()->SetNumberOfIds(timeshifted->GetNumberOfPoints());
-  for (vtkIdType i = 0; i < timeshifted->GetNumberOfPoints(); i++)
-  {
-    polyLine->GetPointIds()->SetId(i,i);
-  }
-  auto cell = vtkSmartPointer<vtkCellArray>::New();
-  cell->InsertNextCell(polyLine);
-  timeshifted->SetLines(cell);
-
-  bool isWellFormed = timeshifted->GetTimeArray() &&
-                      timeshifted->GetTranslationArray() &&
-                      timeshifted->GetOrientationArray();
-  if(!isWellFormed)
-  {
-    std::cout << "warning ! timeshifted not well formed" << std::endl;
-  }
-
+  timeshifted->DeepCopy(this);
+  timeshifted->ApplyTimeshiftInPlace(shift);
   return timeshifted;
 }
 
-
+//-----------------------------------------------------------------------------
 vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::ApplyScale(double scale)
 {
   auto scaled = vtkSmartPointer<vtkTemporalTransforms>::New();
+  scaled->DeepCopy(this);
+  scaled->ApplyScaleInPlace(scale);
+  return scaled;
+}
 
-  for (unsigned int i = 0; i < this->GetNumberOfPoints(); i++)
-  {
-    double currentTimestamp = this->GetTimeArray()->GetTuple1(i);
-    scaled->GetTimeArray()->InsertNextTuple1(currentTimestamp);
-    double* aa = this->GetOrientationArray()->GetTuple4(i);
-    scaled->GetOrientationArray()->InsertNextTuple(aa);
-    double* xyz = this->GetTranslationArray()->GetTuple3(i);
-    xyz[0] *= scale;
-    xyz[1] *= scale;
-    xyz[2] *= scale;
-    scaled->GetTranslationArray()->InsertNextTuple(xyz);
-  }
+//-----------------------------------------------------------------------------
+void vtkTemporalTransforms::ApplyTimeshiftInPlace(double shift)
+{
+  this->GetTimes().array() += shift;
+  this->GetTimeArray()->Modified();
+  this->Modified();
+}
 
-  auto polyLine = vtkSmartPointer<vtkPolyLine>::New();
-  polyLine->GetPointIds()->SetNumberOfIds(scaled->GetNumberOfPoints());
-  for (vtkIdType i = 0; i < scaled->GetNumberOfPoints(); i++)
+//-----------------------------------------------------------------------------
+void vtkTemporalTransforms::ApplyScaleInPlace(double scale)
+{
+  this->GetTranslations() *= scale;
+  this->GetTranslationArray()->Modified();
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransforms::ExtractIndices(const std::vector<vtkIdType>& indices)
+{
+  auto extract = vtkSmartPointer<vtkTemporalTransforms>::New();
+  const vtkIdType size = static_cast<vtkIdType>(indices.size());
+  extract->GetTimeArray()->SetNumberOfTuples(size);
+  extract->GetOrientationArray()->SetNumberOfTuples(size);
+  extract->GetPoints()->SetNumberOfPoints(size);
+
+  const auto times = this->GetTimes();
+  const auto axisAngles = this->GetAxisAngles();
+  const auto translations = this->GetTranslations();
+  auto extractTimes = extract->GetTimes();
+  auto extractAxisAngles = extract->GetAxisAngles();
+  auto extractTranslations = extract->GetTranslations();
+  for (vtkIdType i = 0; i < size; i++)
   {
-    polyLine->GetPointIds()->SetId(i,i);
+    extractTimes(i) = times(indices[i]);
+    extractAxisAngles.col(i) = axisAngles.col(indices[i]);
+    extractTranslations.col(i) = translations.col(indices[i]);
   }
-  auto cell = vtkSmartPointer<vtkCellArray>::New();
-  cell->InsertNextCell(polyLine);
-  scaled->SetLines(cell);
 
-  bool isWellFormed = scaled->GetTimeArray() && scaled->GetTranslationArray() &&
-                      scaled->GetOrientationArray();
-  if(!isWellFormed)
+  extract->UpdatePolyLine();
+  return extract;
+}
+
+//-----------------------------------------------------------------------------
+void vtkTemporalTransforms::UpdatePolyLine()
+{
+  const vtkIdType numberOfPoints = this->GetNumberOfPoints();
+  auto cell = vtkSmartPointer<vtkCellArray>::New();
+  cell->Allocate(numberOfPoints + 1);
+  cell->InsertNextCell(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; i++)
   {
-    std::cout << "warning ! scaled not well formed" << std::endl;
+    cell->InsertCellPoint(i);
   }
-
-  return scaled;
+  this->SetLines(cell);
 }
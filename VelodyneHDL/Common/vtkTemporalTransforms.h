@@ -9,6 +9,8 @@
 
 #include <Eigen/Geometry>
 
+#include <vector>
+
 /**
  * @brief The vtkTemporalTransforms class store some vtkTransform associated with time
  * as a polyData containing a polyline where each point correspond to timestamp
@@ -21,6 +23,10 @@
  *
  * It can be used to pass an vtkTransformInterpolator between 2 filter: a filter inherit from
  * vtkAlgorithm, and it can only take a vtkDataObject as input/output.
+ *
+ * The three arrays are stored as contiguous doubles, GetTimes, GetAxisAngles and
+ * GetTranslations give views on them without copy so that the calibration code can
+ * loop over the poses, and the *InPlace functions modify all the poses in one pass.
  */
 class VTK_EXPORT vtkTemporalTransforms : public vtkPolyData
 {
@@ -62,6 +68,24 @@ public:
   */
   vtkSmartPointer<vtkTemporalTransforms> CycloidicTransform(vtkSmartPointer<vtkTransform> H);
 
+  //@{
+  /// In place versions of IsometricTransform and CycloidicTransform, H = [R0 | T0]
+  void IsometricTransformInPlace(const Eigen::Matrix3d& R0, const Eigen::Vector3d& T0);
+  void CycloidicTransformInPlace(const Eigen::Matrix3d& R0, const Eigen::Vector3d& T0);
+  //@}
+
+  //@{
+  /**
+   * Views on the arrays without copy, the column i is the pose i. They stay valid
+   * as long as the number of poses does not change, and Modified() must be called
+   * after writing through them. An array which is not stored as double is converted
+   * once.
+   */
+  Eigen::Map<Eigen::RowVectorXd> GetTimes();
+  Eigen::Map<Eigen::Matrix4Xd> GetAxisAngles();
+  Eigen::Map<Eigen::Matrix3Xd> GetTranslations();
+  //@}
+
   //@{
   /// Get/Set the orientation array
   vtkDataArray* GetOrientationArray() { return this->GetPointData()->GetArray(OrientationArrayName); }
@@ -90,11 +114,23 @@ public:
   vtkSmartPointer<vtkTemporalTransforms> ApplyTimeshift(double shift);
   vtkSmartPointer<vtkTemporalTransforms> ApplyScale(double scale);
 
+  //@{
+  /// In place versions of ApplyTimeshift and ApplyScale
+  void ApplyTimeshiftInPlace(double shift);
+  void ApplyScaleInPlace(double scale);
+  //@}
+
 protected:
 
   vtkTemporalTransforms();
 
 private:
+  /// Copy the poses of some indices in a new object
+  vtkSmartPointer<vtkTemporalTransforms> ExtractIndices(const std::vector<vtkIdType>& indices);
+
+  /// Replace the cells by a polyline going through all the poses
+  void UpdatePolyLine();
+
   char const* OrientationArrayName = "Orientation(AxisAngle)";
   char const* TimeArrayName = "Time";
 
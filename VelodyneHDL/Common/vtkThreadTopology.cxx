@@ -0,0 +1,109 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#include "vtkThreadTopology.h"
+#include "ThreadTopology.h"
+
+#include <vtkObjectFactory.h>
+
+vtkStandardNewMacro(vtkThreadTopology)
+
+//-----------------------------------------------------------------------------
+void vtkThreadTopology::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Configuration: " << GetConfiguration() << endl;
+}
+
+//-----------------------------------------------------------------------------
+int vtkThreadTopology::GetNumberOfSubsystems()
+{
+  return ThreadTopology::NUMBER_OF_SUBSYSTEMS;
+}
+
+//-----------------------------------------------------------------------------
+const char* vtkThreadTopology::GetSubsystemName(int subsystem)
+{
+  return ThreadTopology::GetSubsystemName(subsystem);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkThreadTopology::SetCpus(int subsystem, const std::string& cpus)
+{
+  return ThreadTopology::SetCpus(subsystem, cpus);
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkThreadTopology::GetCpus(int subsystem)
+{
+  return ThreadTopology::GetCpus(subsystem);
+}
+
+//-----------------------------------------------------------------------------
+void vtkThreadTopology::SetPriority(int subsystem, int priority)
+{
+  ThreadTopology::SetPriority(subsystem, priority);
+}
+
+//-----------------------------------------------------------------------------
+int vtkThreadTopology::GetPriority(int subsystem)
+{
+  return ThreadTopology::GetPriority(subsystem);
+}
+
+//-----------------------------------------------------------------------------
+void vtkThreadTopology::SetNumaNode(int subsystem, int node)
+{
+  ThreadTopology::SetNumaNode(subsystem, node);
+}
+
+//-----------------------------------------------------------------------------
+int vtkThreadTopology::GetNumaNode(int subsystem)
+{
+  return ThreadTopology::GetNumaNode(subsystem);
+}
+
+//-----------------------------------------------------------------------------
+void vtkThreadTopology::SetPoolSize(int subsystem, int poolSize)
+{
+  ThreadTopology::SetPoolSize(subsystem, poolSize);
+}
+
+//-----------------------------------------------------------------------------
+int vtkThreadTopology::GetPoolSize(int subsystem)
+{
+  return ThreadTopology::GetPoolSize(subsystem);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkThreadTopology::SetConfiguration(const std::string& configuration)
+{
+  return ThreadTopology::SetConfiguration(configuration);
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkThreadTopology::GetConfiguration()
+{
+  return ThreadTopology::GetConfiguration();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkThreadTopology::ApplyToRenderThread()
+{
+  return ThreadTopology::ApplyToCurrentThread(ThreadTopology::RENDER);
+}
@@ -0,0 +1,72 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef VTK_THREAD_TOPOLOGY_H
+#define VTK_THREAD_TOPOLOGY_H
+
+#include <vtkObject.h>
+
+#include <string>
+
+/**
+ * @brief The vtkThreadTopology class gives the placement of the threads of the live pipeline
+ * to Python, see ThreadTopology. The placement is taken into account the next time a stream
+ * is started, except for the render thread which is the one calling ApplyToRenderThread.
+ */
+class VTK_EXPORT vtkThreadTopology : public vtkObject
+{
+public:
+  static vtkThreadTopology* New();
+  vtkTypeMacro(vtkThreadTopology, vtkObject)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  static int GetNumberOfSubsystems();
+  static const char* GetSubsystemName(int subsystem);
+
+  //! Cores of a subsystem, for example "0,2-3", empty for all cores
+  static bool SetCpus(int subsystem, const std::string& cpus);
+  static std::string GetCpus(int subsystem);
+
+  //! SCHED_FIFO priority of a subsystem, 0 for the normal scheduling
+  static void SetPriority(int subsystem, int priority);
+  static int GetPriority(int subsystem);
+
+  //! NUMA node of a subsystem, -1 for any node
+  static void SetNumaNode(int subsystem, int node);
+  static int GetNumaNode(int subsystem);
+
+  //! Number of threads of the pools of a subsystem, 0 for one per core
+  static void SetPoolSize(int subsystem, int poolSize);
+  static int GetPoolSize(int subsystem);
+
+  //! Placement of all the subsystems as a single line, as saved in the settings
+  static bool SetConfiguration(const std::string& configuration);
+  static std::string GetConfiguration();
+
+  //! Apply the placement of the render subsystem to the calling thread
+  static bool ApplyToRenderThread();
+
+protected:
+  vtkThreadTopology() = default;
+
+private:
+  vtkThreadTopology(const vtkThreadTopology&) = delete;
+  void operator=(const vtkThreadTopology&) = delete;
+};
+
+#endif // VTK_THREAD_TOPOLOGY_H
@@ -2,6 +2,9 @@
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <mutex>
 #include <vector>
 
 #include <vtkMath.h>
@@ -14,6 +17,8 @@
 #include <Eigen/SVD>
 #include <Eigen/Eigenvalues>
 
+#include <boost/thread/thread.hpp>
+
 #include "vtkConversions.h"
 #include "vtkVelodyneTransformInterpolator.h"
 #include "vtkTimeCalibration.h"
@@ -50,28 +55,111 @@ std::string ToString(CorrelationStrategy correlationStrategy)
   }
 }
 
-Interpolator1D<double> compute_speed_window(
+namespace
+{
+// Interpolate the row-major matrices of a trajectory at increasing times, in a
+// single sweep over its transforms instead of a binary search per time
+std::vector<double> InterpolateMatrices(
     const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform,
-    double window_width)
+    const std::vector<double>& times)
+{
+  std::vector<double> matrices(16 * times.size());
+  if (!times.empty())
+  {
+    transform->InterpolateTransformMatrices(times.data(), times.size(), matrices.data());
+  }
+  return matrices;
+}
+
+Eigen::Vector3d PositionFromMatrices(const std::vector<double>& matrices, size_t i)
+{
+  const double* m = matrices.data() + 16 * i;
+  return Eigen::Vector3d(m[3], m[7], m[11]);
+}
+
+Eigen::Matrix3d RotationFromMatrices(const std::vector<double>& matrices, size_t i)
 {
-  std::vector<double> times = std::vector<double>();
-  std::vector<double> speeds = std::vector<double>();
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> next = vtkSmartPointer<vtkTransform>::New();
+  const double* m = matrices.data() + 16 * i;
+  Eigen::Matrix3d rotation;
+  rotation << m[0], m[1], m[2],
+              m[4], m[5], m[6],
+              m[8], m[9], m[10];
+  return rotation;
+}
 
+// Centers of the windows sliding every period over the trajectory
+std::vector<double> SlidingWindowTimes(
+    const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform,
+    double window_width)
+{
+  std::vector<double> times;
   double minMidWindowTime = transform->GetMinimumT() + 0.5 * window_width;
   double maxMidWindowTime = transform->GetMaximumT() - 0.5 * window_width;
   double period = transform->GetPeriod();
   double time = minMidWindowTime;
   while (time < maxMidWindowTime)
   {
-    transform->InterpolateTransform(time - 0.5 * window_width, prev);
-    transform->InterpolateTransform(time + 0.5 * window_width, next);
-    speeds.push_back((PositionVectorFromTransform(next)
-			    - PositionVectorFromTransform(prev)).norm() / window_width);
     times.push_back(time);
     time = time + period;
   }
+  return times;
+}
+
+// Centers of the windows taken every period, half a window from the ends of
+// the trajectory
+std::vector<double> SteppedWindowTimes(
+    const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform,
+    double window_width)
+{
+  double tMin = transform->GetMinimumT() + 0.5 * window_width;
+  double tMax = transform->GetMaximumT() - 0.5 * window_width;
+  int steps = (tMax - tMin) / transform->GetPeriod() + 1;
+  std::vector<double> times = std::vector<double>(std::max(steps, 0));
+  for (int i = 0; i < steps; i++)
+  {
+    times[i] = tMin + i * transform->GetPeriod();
+  }
+  return times;
+}
+
+// Shift all the times by offset, which keeps them sorted
+std::vector<double> ShiftTimes(const std::vector<double>& times, double offset)
+{
+  std::vector<double> shifted(times.size());
+  for (size_t i = 0; i < times.size(); i++)
+  {
+    shifted[i] = times[i] + offset;
+  }
+  return shifted;
+}
+
+// Times of the transforms of the trajectory
+std::vector<double> TransformTimes(
+    const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform)
+{
+  std::vector<std::vector<double>> transforms = transform->GetTransformList();
+  std::vector<double> times(transforms.size());
+  for (size_t i = 0; i < transforms.size(); i++)
+  {
+    times[i] = transforms[i][0];
+  }
+  return times;
+}
+}
+
+Interpolator1D<double> compute_speed_window(
+    const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform,
+    double window_width)
+{
+  std::vector<double> times = SlidingWindowTimes(transform, window_width);
+  std::vector<double> prev = InterpolateMatrices(transform, ShiftTimes(times, -0.5 * window_width));
+  std::vector<double> next = InterpolateMatrices(transform, ShiftTimes(times, 0.5 * window_width));
+  std::vector<double> speeds = std::vector<double>(times.size());
+  for (size_t i = 0; i < times.size(); i++)
+  {
+    speeds[i] = (PositionFromMatrices(next, i)
+                 - PositionFromMatrices(prev, i)).norm() / window_width;
+  }
 
   return Interpolator1D<double>(times, speeds);
 }
@@ -80,27 +168,17 @@ Interpolator1D<double> compute_acc_window(
     const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform,
     double window_width)
 {
-  std::vector<double> times = std::vector<double>();
-  std::vector<double> accs = std::vector<double>();
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> next = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-
-  double minMidWindowTime = transform->GetMinimumT() + 0.5 * window_width;
-  double maxMidWindowTime = transform->GetMaximumT() - 0.5 * window_width;
-  double period = transform->GetPeriod();
-  double time = minMidWindowTime;
-  while (time < maxMidWindowTime)
+  std::vector<double> times = SlidingWindowTimes(transform, window_width);
+  std::vector<double> prev = InterpolateMatrices(transform, ShiftTimes(times, -0.5 * window_width));
+  std::vector<double> curr = InterpolateMatrices(transform, times);
+  std::vector<double> next = InterpolateMatrices(transform, ShiftTimes(times, 0.5 * window_width));
+  std::vector<double> accs = std::vector<double>(times.size());
+  for (size_t i = 0; i < times.size(); i++)
   {
-    transform->InterpolateTransform(time - 0.5 * window_width, prev);
-    transform->InterpolateTransform(time, curr);
-    transform->InterpolateTransform(time + 0.5 * window_width, next);
-    Eigen::Vector3d a = (PositionVectorFromTransform(next)
-		    + PositionVectorFromTransform(prev)
-		    - 2 * PositionVectorFromTransform(curr)) / (window_width * window_width);
-    accs.push_back(a.norm());
-    times.push_back(time);
-    time = time + period;
+    Eigen::Vector3d a = (PositionFromMatrices(next, i)
+                         + PositionFromMatrices(prev, i)
+                         - 2 * PositionFromMatrices(curr, i)) / (window_width * window_width);
+    accs[i] = a.norm();
   }
 
   return Interpolator1D<double>(times, accs);
@@ -110,31 +188,23 @@ Interpolator1D<double> compute_jerk_window(
     const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform,
     double window_width)
 {
-  std::vector<double> times = std::vector<double>();
-  std::vector<double> jerks = std::vector<double>();
-  vtkSmartPointer<vtkTransform> t1 = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> t2 = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> t3 = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> t4 = vtkSmartPointer<vtkTransform>::New();
-
-  double minMidWindowTime = transform->GetMinimumT() + 0.5 * window_width;
-  double maxMidWindowTime = transform->GetMaximumT() - 0.5 * window_width;
-  double period = transform->GetPeriod();
-  double time = minMidWindowTime;
-  while (time < maxMidWindowTime)
+  std::vector<double> times = SlidingWindowTimes(transform, window_width);
+  std::vector<double> t1 = InterpolateMatrices(transform, ShiftTimes(times, -0.5 * window_width));
+  std::vector<double> t2 = InterpolateMatrices(transform,
+    ShiftTimes(times, (- 0.5 + 1.0/3.0) * window_width));
+  std::vector<double> t3 = InterpolateMatrices(transform,
+    ShiftTimes(times, (- 0.5 + 2.0/3.0) * window_width));
+  std::vector<double> t4 = InterpolateMatrices(transform,
+    ShiftTimes(times, (- 0.5 + 3.0/3.0) * window_width));
+  std::vector<double> jerks = std::vector<double>(times.size());
+  for (size_t i = 0; i < times.size(); i++)
   {
-    transform->InterpolateTransform(time - 0.5 * window_width, t1);
-    transform->InterpolateTransform(time + (- 0.5 + 1.0/3.0) * window_width, t2);
-    transform->InterpolateTransform(time + (- 0.5 + 2.0/3.0) * window_width, t3);
-    transform->InterpolateTransform(time + (- 0.5 + 3.0/3.0) * window_width, t4);
-    Eigen::Vector3d j = (PositionVectorFromTransform(t4)
-		   - 3 * PositionVectorFromTransform(t3)
-		   + 3 * PositionVectorFromTransform(t2)
-		   - PositionVectorFromTransform(t1))
-	    / std::pow(window_width, 3.0);
-    jerks.push_back(j.norm());
-    times.push_back(time);
-    time = time + period;
+    Eigen::Vector3d j = (PositionFromMatrices(t4, i)
+                         - 3 * PositionFromMatrices(t3, i)
+                         + 3 * PositionFromMatrices(t2, i)
+                         - PositionFromMatrices(t1, i))
+                        / std::pow(window_width, 3.0);
+    jerks[i] = j.norm();
   }
 
   return Interpolator1D<double>(times, jerks);
@@ -143,24 +213,21 @@ Interpolator1D<double> compute_jerk_window(
 Interpolator1D<double> compute_dPos(
     const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform)
 {
-  std::vector<std::vector<double>> transforms = transform->GetTransformList();
-  std::vector<double> t = std::vector<double>(transforms.size() - 1);
-  std::vector<double> x = std::vector<double>(transforms.size() - 1);
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  for (unsigned int i = 0; i < transforms.size() - 1; i++)
+  std::vector<double> times = TransformTimes(transform);
+  std::vector<double> poses = InterpolateMatrices(transform, times);
+  std::vector<double> t = std::vector<double>(times.size() - 1);
+  std::vector<double> x = std::vector<double>(times.size() - 1);
+  for (unsigned int i = 0; i < times.size() - 1; i++)
   {
-    double t0 = transforms[i][0];
-    double t1 = transforms[i+1][0];
+    double t0 = times[i];
+    double t1 = times[i+1];
     t[i] = 0.5 * (t0 + t1);
-    transform->InterpolateTransform(t0, prev);
-    transform->InterpolateTransform(t1, curr);
     if (std::abs(t1 - t0) < 0.0001) {
       x[i] = 0.0;
     } else {
-      x[i] = (PositionVectorFromTransform(curr)
-		      - PositionVectorFromTransform(prev)).norm()
-	      / (t1 - t0);
+      x[i] = (PositionFromMatrices(poses, i + 1)
+              - PositionFromMatrices(poses, i)).norm()
+             / (t1 - t0);
     }
   }
   return Interpolator1D<double>(t, x);
@@ -169,20 +236,14 @@ Interpolator1D<double> compute_dPos(
 Interpolator1D<double> compute_length(
     const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform)
 {
-  std::vector<std::vector<double>> transforms = transform->GetTransformList();
-  std::vector<double> t = std::vector<double>(transforms.size());
-  std::vector<double> x = std::vector<double>(transforms.size());
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  t[0] = transforms[0][0];
+  std::vector<double> t = TransformTimes(transform);
+  std::vector<double> poses = InterpolateMatrices(transform, t);
+  std::vector<double> x = std::vector<double>(t.size());
   x[0] = 0.0;
-  for (unsigned int i = 1; i < transforms.size(); i++)
+  for (unsigned int i = 1; i < t.size(); i++)
   {
-    t[i] = transforms[i][0];
-    transform->InterpolateTransform(t[i-1], prev);
-    transform->InterpolateTransform(t[i], curr);
-    x[i] = x[i - 1] + (PositionVectorFromTransform(curr)
-		    - PositionVectorFromTransform(prev)).norm();
+    x[i] = x[i - 1] + (PositionFromMatrices(poses, i)
+                       - PositionFromMatrices(poses, i - 1)).norm();
   }
 
   return Interpolator1D<double>(t, x);
@@ -194,21 +255,16 @@ Interpolator1D<double> compute_derivated_length(
     double window_width)
 {
   Interpolator1D<double> length = compute_length(transform);
-  double tMin = transform->GetMinimumT() + 0.5 * window_width;
-  double tMax = transform->GetMaximumT() - 0.5 * window_width;
-  int steps = (tMax - tMin) / transform->GetPeriod() + 1;
-  std::vector<double> derivated_length = std::vector<double>(steps);
-  std::vector<double> times = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
+  std::vector<double> times = SteppedWindowTimes(transform, window_width);
+  // length is an interpolator so no need to check that the sample instants
+  // are not the same (they are not, even if the interpolation mode of
+  // this->Reference/Aligned is "NEAREST")
+  std::vector<double> next = length.GetSorted(ShiftTimes(times, 0.5 * window_width));
+  std::vector<double> prev = length.GetSorted(ShiftTimes(times, -0.5 * window_width));
+  std::vector<double> derivated_length = std::vector<double>(times.size());
+  for (size_t i = 0; i < times.size(); i++)
   {
-    double time = tMin + i * transform->GetPeriod();
-    times[i] = time;
-    // length is an interpolator so no need to check that the sample instants
-    // are not the same (they are not, even if the interpolation mode of
-    // this->Reference/Aligned is "NEAREST")
-    derivated_length[i] = (length.Get(time + 0.5 * window_width)
-                           - length.Get(time - 0.5 * window_width))
-                    / window_width;
+    derivated_length[i] = (next[i] - prev[i]) / window_width;
   }
 
   return Interpolator1D<double>(times, derivated_length);
@@ -217,19 +273,16 @@ Interpolator1D<double> compute_derivated_length(
 Interpolator1D<double> compute_dRot(
     const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform)
 {
-  std::vector<std::vector<double>> transforms = transform->GetTransformList();
-  std::vector<double> t = std::vector<double>(transforms.size() - 1);
-  std::vector<double> x = std::vector<double>(transforms.size() - 1);
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  for (int i = 0; i < static_cast<int>(transforms.size()) - 1; i++)
+  std::vector<double> times = TransformTimes(transform);
+  std::vector<double> poses = InterpolateMatrices(transform, times);
+  std::vector<double> t = std::vector<double>(times.size() - 1);
+  std::vector<double> x = std::vector<double>(times.size() - 1);
+  for (int i = 0; i < static_cast<int>(times.size()) - 1; i++)
   {
-    double t0 = transforms[i][0];
-    double t1 = transforms[i+1][0];
-    transform->InterpolateTransform(t0, prev);
-    transform->InterpolateTransform(t1, curr);
-    Eigen::AngleAxisd aa = Eigen::AngleAxisd(RotationMatrixFromTransform(curr)
-		    * RotationMatrixFromTransform(prev).transpose());
+    double t0 = times[i];
+    double t1 = times[i+1];
+    Eigen::AngleAxisd aa = Eigen::AngleAxisd(RotationFromMatrices(poses, i + 1)
+                                             * RotationFromMatrices(poses, i).transpose());
     t[i] = 0.5 * (t0 + t1);
     if (std::abs(t1 - t0) < 0.0001) {
       x[i] = 0.0;
@@ -245,25 +298,17 @@ Interpolator1D<double> compute_trajectory_angle(
     const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform,
     double window_width)
 {
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> next = vtkSmartPointer<vtkTransform>::New();
-  double tMin = transform->GetMinimumT() + 0.5 * window_width;
-  double tMax = transform->GetMaximumT() - 0.5 * window_width;
-  int steps = (tMax - tMin) / transform->GetPeriod() + 1;
-  std::vector<double> trajectory_angle = std::vector<double>(steps);
-  std::vector<double> times = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
+  std::vector<double> times = SteppedWindowTimes(transform, window_width);
+  std::vector<double> prev = InterpolateMatrices(transform, ShiftTimes(times, -0.5 * window_width));
+  std::vector<double> curr = InterpolateMatrices(transform, times);
+  std::vector<double> next = InterpolateMatrices(transform, ShiftTimes(times, 0.5 * window_width));
+  std::vector<double> trajectory_angle = std::vector<double>(times.size());
+  for (size_t i = 0; i < times.size(); i++)
   {
-    double time = tMin + i * transform->GetPeriod();
-    transform->InterpolateTransform(time - 0.5 * window_width, prev);
-    transform->InterpolateTransform(time, curr);
-    transform->InterpolateTransform(time + 0.5 * window_width, next);
-    times[i] = time;
-    trajectory_angle[i] = SignedAngle(PositionVectorFromTransform(curr)
-		    - PositionVectorFromTransform(prev),
-		    PositionVectorFromTransform(next)
-		    - PositionVectorFromTransform(curr));
+    trajectory_angle[i] = SignedAngle(PositionFromMatrices(curr, i)
+                                      - PositionFromMatrices(prev, i),
+                                      PositionFromMatrices(next, i)
+                                      - PositionFromMatrices(curr, i));
   }
 
   return Interpolator1D<double>(times, trajectory_angle);
@@ -273,20 +318,14 @@ Interpolator1D<double> compute_trajectory_angle(
 Interpolator1D<double> compute_orientation_arc(
     const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform)
 {
-  std::vector<std::vector<double>> transforms = transform->GetTransformList();
-  std::vector<double> t = std::vector<double>(transforms.size());
-  std::vector<double> x = std::vector<double>(transforms.size());
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> curr = vtkSmartPointer<vtkTransform>::New();
-  t[0] = transforms[0][0];
+  std::vector<double> t = TransformTimes(transform);
+  std::vector<double> poses = InterpolateMatrices(transform, t);
+  std::vector<double> x = std::vector<double>(t.size());
   x[0] = 0.0;
-  for (unsigned int i = 1; i < transforms.size(); i++)
+  for (unsigned int i = 1; i < t.size(); i++)
   {
-    t[i] = transforms[i][0];
-    transform->InterpolateTransform(t[i-1], prev);
-    transform->InterpolateTransform(t[i], curr);
-    Eigen::AngleAxisd aa = Eigen::AngleAxisd(RotationMatrixFromTransform(curr)
-		    * RotationMatrixFromTransform(prev).transpose());
+    Eigen::AngleAxisd aa = Eigen::AngleAxisd(RotationFromMatrices(poses, i)
+                                             * RotationFromMatrices(poses, i - 1).transpose());
     x[i] = x[i - 1] + std::abs(aa.angle());
   }
 
@@ -299,22 +338,16 @@ Interpolator1D<double> compute_derivated_orientation_arc(
     double window_width)
 {
   Interpolator1D<double> orientation_arc = compute_orientation_arc(transform);
-  double tMin = transform->GetMinimumT() + 0.5 * window_width;
-  double tMax = transform->GetMaximumT() - 0.5 * window_width;
-  int steps = (tMax - tMin) / transform->GetPeriod() + 1;
-  std::vector<double> derivated_orientation_arc = std::vector<double>(steps);
-  std::vector<double> times = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
+  std::vector<double> times = SteppedWindowTimes(transform, window_width);
+  // length is an interpolator so no need to check that the sample instants
+  // are not the same (they are not, even if the interpolation mode of
+  // this->Reference/Aligned is "NEAREST")
+  std::vector<double> next = orientation_arc.GetSorted(ShiftTimes(times, 0.5 * window_width));
+  std::vector<double> prev = orientation_arc.GetSorted(ShiftTimes(times, -0.5 * window_width));
+  std::vector<double> derivated_orientation_arc = std::vector<double>(times.size());
+  for (size_t i = 0; i < times.size(); i++)
   {
-    double time = tMin + i * transform->GetPeriod();
-    times[i] = time;
-    // length is an interpolator so no need to check that the sample instants
-    // are not the same (they are not, even if the interpolation mode of
-    // this->Reference/Aligned is "NEAREST")
-    derivated_orientation_arc[i] =
-                    (orientation_arc.Get(time + 0.5 * window_width)
-                     - orientation_arc.Get(time - 0.5 * window_width))
-                    / window_width;
+    derivated_orientation_arc[i] = (next[i] - prev[i]) / window_width;
   }
 
   return Interpolator1D<double>(times, derivated_orientation_arc);
@@ -326,138 +359,228 @@ Interpolator1D<double> compute_orientation_angle(
     const vtkSmartPointer<vtkVelodyneTransformInterpolator>& transform,
     double window_width)
 {
-  vtkSmartPointer<vtkTransform> prev = vtkSmartPointer<vtkTransform>::New();
-  vtkSmartPointer<vtkTransform> next = vtkSmartPointer<vtkTransform>::New();
-  double tMin = transform->GetMinimumT() + 0.5 * window_width;
-  double tMax = transform->GetMaximumT() - 0.5 * window_width;
-  int steps = (tMax - tMin) / transform->GetPeriod() + 1;
-  std::vector<double> orientation_angle = std::vector<double>(steps);
-  std::vector<double> times = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
+  std::vector<double> times = SteppedWindowTimes(transform, window_width);
+  std::vector<double> prev = InterpolateMatrices(transform, ShiftTimes(times, -0.5 * window_width));
+  std::vector<double> next = InterpolateMatrices(transform, ShiftTimes(times, 0.5 * window_width));
+  std::vector<double> orientation_angle = std::vector<double>(times.size());
+  for (size_t i = 0; i < times.size(); i++)
   {
-    double time = tMin + i * transform->GetPeriod();
-    transform->InterpolateTransform(time - 0.5 * window_width, prev);
-    transform->InterpolateTransform(time + 0.5 * window_width, next);
-    times[i] = time;
-    Eigen::AngleAxisd angleAxis(RotationMatrixFromTransform(next)
-		    * RotationMatrixFromTransform(prev).transpose());
+    Eigen::AngleAxisd angleAxis(RotationFromMatrices(next, i)
+                                * RotationFromMatrices(prev, i).transpose());
     orientation_angle[i] = angleAxis.angle();
   }
 
   return Interpolator1D<double>(times, orientation_angle);
 }
 
-double ComputeTimeShift(vtkSmartPointer<vtkTemporalTransforms> reference,
-                      vtkSmartPointer<vtkTemporalTransforms> aligned,
-                      CorrelationStrategy correlationStrategy,
-                      double time_window_width,
-                      bool substract_mean)
+namespace
+{
+// Reading the arrays of a trajectory to create its interpolator is not thread
+// safe, even for different interpolators
+std::mutex CreateInterpolatorMutex;
+
+// Compute the 1D signal of a trajectory with a correlation strategy, returns
+// false if the strategy is unknown
+bool ComputeSignal(const vtkSmartPointer<vtkVelodyneTransformInterpolator>& interpolator,
+                   CorrelationStrategy correlationStrategy,
+                   double time_window_width,
+                   Interpolator1D<double>& signal)
 {
-  vtkSmartPointer<vtkVelodyneTransformInterpolator> referenceInterpolator
-      = reference->CreateInterpolator();
-  referenceInterpolator->SetInterpolationTypeToLinear();
-  vtkSmartPointer<vtkVelodyneTransformInterpolator> alignedInterpolator
-      = aligned->CreateInterpolator();
-  alignedInterpolator->SetInterpolationTypeToLinear();
-  Interpolator1D<double> sig_reference;
-  Interpolator1D<double> sig_aligned;
-  // first, compute the signals using the chosen method
   switch (correlationStrategy)
   {
     case CorrelationStrategy::DPOS:
-      sig_reference = compute_dPos(referenceInterpolator);
-      sig_aligned = compute_dPos(alignedInterpolator);
-      break;
+      signal = compute_dPos(interpolator);
+      return true;
     case CorrelationStrategy::SPEED_WINDOW:
-      sig_reference = compute_speed_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_speed_window(alignedInterpolator,
-                                             time_window_width);
-      break;
+      signal = compute_speed_window(interpolator, time_window_width);
+      return true;
     case CorrelationStrategy::ACC_WINDOW:
-      sig_reference = compute_acc_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_acc_window(alignedInterpolator,
-                                             time_window_width);
-      break;
+      signal = compute_acc_window(interpolator, time_window_width);
+      return true;
     case CorrelationStrategy::JERK_WINDOW:
-      sig_reference = compute_jerk_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_jerk_window(alignedInterpolator,
-                                             time_window_width);
-      break;
+      signal = compute_jerk_window(interpolator, time_window_width);
+      return true;
     case CorrelationStrategy::LENGTH:
-      sig_reference = compute_length(referenceInterpolator);
-      sig_aligned = compute_length(alignedInterpolator);
-      break;
+      signal = compute_length(interpolator);
+      return true;
     case CorrelationStrategy::DERIVATED_LENGTH:
-      sig_reference = compute_derivated_length(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_derivated_length(alignedInterpolator,
-                                             time_window_width);
-      break;
+      signal = compute_derivated_length(interpolator, time_window_width);
+      return true;
     case CorrelationStrategy::DROT:
-      sig_reference = compute_dRot(referenceInterpolator);
-      sig_aligned = compute_dRot(alignedInterpolator);
-      break;
+      signal = compute_dRot(interpolator);
+      return true;
     case CorrelationStrategy::TRAJECTORY_ANGLE:
-      sig_reference = compute_trajectory_angle(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_trajectory_angle(alignedInterpolator,
-                                             time_window_width);
-      break;
+      signal = compute_trajectory_angle(interpolator, time_window_width);
+      return true;
     case CorrelationStrategy::ORIENTATION_ANGLE:
-      sig_reference = compute_orientation_angle(referenceInterpolator,
-                                                time_window_width);
-      sig_aligned = compute_orientation_angle(alignedInterpolator,
-                                              time_window_width);
-      break;
+      signal = compute_orientation_angle(interpolator, time_window_width);
+      return true;
     case CorrelationStrategy::DERIVATED_ORIENTATION_ARC:
-      sig_reference = compute_derivated_orientation_arc(
-                              referenceInterpolator,
-                              time_window_width);
-      sig_aligned = compute_derivated_orientation_arc(
-                              alignedInterpolator,
-                              time_window_width);
-      break;
+      signal = compute_derivated_orientation_arc(interpolator, time_window_width);
+      return true;
     default:
-      std::cerr << "unknown correlation strategy" << std::endl;
-      return 0.0;
+      return false;
   }
+}
 
-  if (substract_mean)
-  {
-    sig_reference.ApplyValueShift(- sig_reference.Mean());
-    sig_aligned.ApplyValueShift(- sig_aligned.Mean());
-  }
+// Compute the timeshift between two signals, the FFT plans of the correlator
+// are reused between the calls
+double ComputeTimeShift(const Interpolator1D<double>& sig_reference,
+                        const Interpolator1D<double>& sig_aligned,
+                        bool substract_mean,
+                        FFTCorrelator<double>& correlator)
+{
+  const double reference_shift = substract_mean ? - sig_reference.Mean() : 0.0;
+  const double aligned_shift = substract_mean ? - sig_aligned.Mean() : 0.0;
 
-  // We prefere the two signals to start at t = 0, so we time shift them,
-  // but before that we save the information that we would lose otherwise.
+  // We prefere the two signals to start at t = 0, so we resample them from
+  // their first time, but before that we save the information that we would
+  // lose otherwise.
   double pre_resample = sig_aligned.GetMinimumT() - sig_reference.GetMinimumT();
-  sig_aligned.ApplyTimeShift(- sig_aligned.GetMinimumT());
-  sig_reference.ApplyTimeShift(- sig_reference.GetMinimumT());
-
-  // by construction we now have tMin == 0.0;
-  double tMax = std::max(sig_reference.GetMaximumT(), sig_aligned.GetMaximumT());
+  double tMax = std::max(sig_reference.GetMaximumT() - sig_reference.GetMinimumT(),
+                         sig_aligned.GetMaximumT() - sig_aligned.GetMinimumT());
   double period = std::min(sig_reference.GetAveragePeriod(),
 		  sig_aligned.GetAveragePeriod());
   int steps = std::floor(tMax / period);
-  std::vector<double> reference_resampled = std::vector<double>(steps);
-  std::vector<double> aligned_resampled = std::vector<double>(steps);
-  for (int i = 0; i < steps; i++)
-  {
-    double time = 0.0 + i * period;
-    reference_resampled[i] = sig_reference.Get(time);
-    aligned_resampled[i] = sig_aligned.Get(time);
-  }
+  std::vector<double> reference_resampled = sig_reference.Resample(
+    sig_reference.GetMinimumT(), period, steps, reference_shift);
+  std::vector<double> aligned_resampled = sig_aligned.Resample(
+    sig_aligned.GetMinimumT(), period, steps, aligned_shift);
 
-  std::vector<double> test = fftcorrelate(reference_resampled, aligned_resampled);
-
-  int correlation = max_fftcorrelation(reference_resampled, aligned_resampled);
+  // the maximum of the correlation is refined below the sampling period
+  double correlation = correlator.MaxCorrelationShift(reference_resampled, aligned_resampled);
   double correction = correlation * period;
   double delta_t = pre_resample - correction;
   return delta_t;
 }
+}
+
+//-----------------------------------------------------------------------------
+CorrelationSignalCache::Signal CorrelationSignalCache::GetSignal(
+    vtkSmartPointer<vtkTemporalTransforms> trajectory,
+    CorrelationStrategy correlationStrategy,
+    double time_window_width)
+{
+  const Key key(trajectory.GetPointer(), correlationStrategy, time_window_width);
+  const vtkMTimeType mtime = trajectory->GetMTime();
+  {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    auto entry = this->Entries.find(key);
+    if (entry != this->Entries.end() && entry->second.MTime == mtime)
+    {
+      return entry->second.Value;
+    }
+  }
+
+  // the signals are computed out of the lock, so that the signals of several
+  // strategies are computed in parallel
+  vtkSmartPointer<vtkVelodyneTransformInterpolator> interpolator;
+  {
+    std::lock_guard<std::mutex> lock(CreateInterpolatorMutex);
+    interpolator = trajectory->CreateInterpolator();
+  }
+  interpolator->SetInterpolationTypeToLinear();
+  auto signal = std::make_shared<Interpolator1D<double>>();
+  if (!ComputeSignal(interpolator, correlationStrategy, time_window_width, *signal))
+  {
+    return Signal();
+  }
+
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  Entry& entry = this->Entries[key];
+  entry.Trajectory = trajectory;
+  entry.MTime = mtime;
+  entry.Value = signal;
+  return signal;
+}
+
+//-----------------------------------------------------------------------------
+void CorrelationSignalCache::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->Mutex);
+  this->Entries.clear();
+}
+
+double ComputeTimeShift(vtkSmartPointer<vtkTemporalTransforms> reference,
+                      vtkSmartPointer<vtkTemporalTransforms> aligned,
+                      CorrelationStrategy correlationStrategy,
+                      double time_window_width,
+                      bool substract_mean)
+{
+  CorrelationSignalCache cache;
+  return ComputeTimeShift(cache, reference, aligned, correlationStrategy,
+                          time_window_width, substract_mean);
+}
+
+double ComputeTimeShift(CorrelationSignalCache& cache,
+                      vtkSmartPointer<vtkTemporalTransforms> reference,
+                      vtkSmartPointer<vtkTemporalTransforms> aligned,
+                      CorrelationStrategy correlationStrategy,
+                      double time_window_width,
+                      bool substract_mean)
+{
+  // first, compute the signals using the chosen method
+  CorrelationSignalCache::Signal sig_reference =
+      cache.GetSignal(reference, correlationStrategy, time_window_width);
+  CorrelationSignalCache::Signal sig_aligned =
+      cache.GetSignal(aligned, correlationStrategy, time_window_width);
+  if (!sig_reference || !sig_aligned)
+  {
+    std::cerr << "unknown correlation strategy" << std::endl;
+    return 0.0;
+  }
+
+  FFTCorrelator<double> correlator;
+  return ComputeTimeShift(*sig_reference, *sig_aligned, substract_mean, correlator);
+}
+
+std::vector<double> ComputeTimeShifts(vtkSmartPointer<vtkTemporalTransforms> reference,
+                      vtkSmartPointer<vtkTemporalTransforms> aligned,
+                      const std::vector<TimeShiftMethod>& methods,
+                      bool substract_mean,
+                      CorrelationSignalCache* cache,
+                      int numberOfThreads)
+{
+  CorrelationSignalCache temporaryCache;
+  if (!cache)
+  {
+    cache = &temporaryCache;
+  }
+
+  // each thread takes the next method to evaluate, with its own correlator
+  std::vector<double> shifts(methods.size(), 0.0);
+  std::atomic<size_t> next(0);
+  auto evaluate = [&]() {
+    FFTCorrelator<double> correlator;
+    for (size_t i = next++; i < methods.size(); i = next++)
+    {
+      CorrelationSignalCache::Signal sig_reference =
+          cache->GetSignal(reference, methods[i].Strategy, methods[i].TimeWindowWidth);
+      CorrelationSignalCache::Signal sig_aligned =
+          cache->GetSignal(aligned, methods[i].Strategy, methods[i].TimeWindowWidth);
+      if (!sig_reference || !sig_aligned)
+      {
+        std::cerr << "unknown correlation strategy" << std::endl;
+        continue;
+      }
+      shifts[i] = ComputeTimeShift(*sig_reference, *sig_aligned, substract_mean, correlator);
+    }
+  };
+
+  size_t numberOfWorkers = numberOfThreads > 0
+    ? numberOfThreads
+    : std::max(1u, boost::thread::hardware_concurrency());
+  numberOfWorkers = std::max<size_t>(1, std::min(numberOfWorkers, methods.size()));
+  boost::thread_group threads;
+  // the calling thread is a worker too
+  for (size_t i = 1; i < numberOfWorkers; ++i)
+  {
+    threads.create_thread(evaluate);
+  }
+  evaluate();
+  threads.join_all();
+  return shifts;
+}
 
 void ShowTrajectoryInfo(vtkSmartPointer<vtkTemporalTransforms> reference, vtkSmartPointer<vtkTemporalTransforms> aligned)
 {
@@ -474,22 +597,32 @@ void ShowTrajectoryInfo(vtkSmartPointer<vtkTemporalTransforms> reference, vtkSma
 }
 
 void DemoAllTimesyncMethods(vtkSmartPointer<vtkTemporalTransforms> reference, vtkSmartPointer<vtkTemporalTransforms> aligned) {
-  vtkSmartPointer<vtkVelodyneTransformInterpolator> referenceI = reference->CreateInterpolator();
-  vtkSmartPointer<vtkVelodyneTransformInterpolator> alignedI = aligned->CreateInterpolator();
+  const std::vector<std::pair<std::string, TimeShiftMethod>> methods = {
+    { "dPos:                      ", { CorrelationStrategy::DPOS, 1.0 } },
+    { "speed window:              ", { CorrelationStrategy::SPEED_WINDOW, 1.0 } },
+    { "acceleration window:       ", { CorrelationStrategy::ACC_WINDOW, 3 } },
+    { "jerk window:               ", { CorrelationStrategy::JERK_WINDOW, 6 } },
+    { "derivated length:          ", { CorrelationStrategy::DERIVATED_LENGTH, 1.0 } },
+    { "dRot:                      ", { CorrelationStrategy::DROT, 1.0 } },
+    { "trajectory angle:          ", { CorrelationStrategy::TRAJECTORY_ANGLE, 10.0 } },
+    { "orientation angle:         ", { CorrelationStrategy::ORIENTATION_ANGLE, 1.0 } },
+    { "derivated orientation arc: ", { CorrelationStrategy::DERIVATED_ORIENTATION_ARC, 1.0 } },
+  };
+  std::vector<TimeShiftMethod> strategies;
+  for (const auto& method : methods)
+  {
+    strategies.push_back(method.second);
+  }
+  const std::vector<double> shifts = ComputeTimeShifts(reference, aligned, strategies);
 
   std::cout << std::fixed;
   std::cout << std::setprecision(4);
   ShowTrajectoryInfo(reference, aligned);
   std::cout << std::endl;
-  std::cout << "dPos:                      " << ComputeTimeShift(reference, aligned, CorrelationStrategy::DPOS, 1.0) << std::endl;
-  std::cout << "speed window:              " << ComputeTimeShift(reference, aligned, CorrelationStrategy::SPEED_WINDOW, 1.0) << std::endl;
-  std::cout << "acceleration window:       " << ComputeTimeShift(reference, aligned, CorrelationStrategy::ACC_WINDOW, 3) << std::endl;
-  std::cout << "jerk window:               " << ComputeTimeShift(reference, aligned, CorrelationStrategy::JERK_WINDOW, 6) << std::endl;
-  std::cout << "derivated length:          " << ComputeTimeShift(reference, aligned, CorrelationStrategy::DERIVATED_LENGTH, 1.0) << std::endl;
-  std::cout << "dRot:                      " << ComputeTimeShift(reference, aligned, CorrelationStrategy::DROT, 1.0) << std::endl;
-  std::cout << "trajectory angle:          " << ComputeTimeShift(reference, aligned, CorrelationStrategy::TRAJECTORY_ANGLE, 10.0) << std::endl;
-  std::cout << "orientation angle:         " << ComputeTimeShift(reference, aligned, CorrelationStrategy::ORIENTATION_ANGLE, 1.0) << std::endl;
-  std::cout << "derivated orientation arc: " << ComputeTimeShift(reference, aligned, CorrelationStrategy::DERIVATED_ORIENTATION_ARC, 1.0) << std::endl;
+  for (size_t i = 0; i < methods.size(); i++)
+  {
+    std::cout << methods[i].first << shifts[i] << std::endl;
+  }
 }
 
 
@@ -508,36 +641,13 @@ double ComputeScale(vtkSmartPointer<vtkTemporalTransforms> reference,
   switch (correlationStrategy)
   {
     case CorrelationStrategy::DPOS:
-      sig_reference = compute_dPos(referenceInterpolator);
-      sig_aligned = compute_dPos(alignedInterpolator);
-      break;
     case CorrelationStrategy::SPEED_WINDOW:
-      sig_reference = compute_speed_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_speed_window(alignedInterpolator,
-                                             time_window_width);
-      break;
     case CorrelationStrategy::ACC_WINDOW:
-      sig_reference = compute_acc_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_acc_window(alignedInterpolator,
-                                             time_window_width);
-      break;
     case CorrelationStrategy::JERK_WINDOW:
-      sig_reference = compute_jerk_window(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_jerk_window(alignedInterpolator,
-                                             time_window_width);
-      break;
     case CorrelationStrategy::LENGTH:
-      sig_reference = compute_length(referenceInterpolator);
-      sig_aligned = compute_length(alignedInterpolator);
-      break;
     case CorrelationStrategy::DERIVATED_LENGTH:
-      sig_reference = compute_derivated_length(referenceInterpolator,
-                                               time_window_width);
-      sig_aligned = compute_derivated_length(alignedInterpolator,
-                                             time_window_width);
+      ComputeSignal(referenceInterpolator, correlationStrategy, time_window_width, sig_reference);
+      ComputeSignal(alignedInterpolator, correlationStrategy, time_window_width, sig_aligned);
       break;
     default:
       std::cerr << "unsuported correlation strategy" << std::endl;
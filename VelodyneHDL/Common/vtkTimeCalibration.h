@@ -31,6 +31,15 @@
 #include "vvConfigure.h"
 #include "vtkTemporalTransforms.h"
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+template<typename T>
+class Interpolator1D;
+
 enum class CorrelationStrategy
 {
   DPOS,
@@ -47,6 +56,41 @@ enum class CorrelationStrategy
 
 std::string ToString(CorrelationStrategy strategy);
 
+/**
+ * \brief Cache of the 1D signals computed from pose trajectories by the
+ * correlation strategies, so that a trajectory synchronized with several other
+ * ones, or with several strategies, is processed once per strategy. A signal
+ * is computed again if its trajectory has been modified. It can be shared by
+ * several threads.
+ **/
+class VelodyneHDLPlugin_EXPORT CorrelationSignalCache
+{
+public:
+  typedef std::shared_ptr<const Interpolator1D<double>> Signal;
+
+  /**
+   * \brief Get the signal of a trajectory, computing it if it is not cached.
+   * Returns null if the strategy is unknown.
+   **/
+  Signal GetSignal(vtkSmartPointer<vtkTemporalTransforms> trajectory,
+                   CorrelationStrategy correlationStrategy,
+                   double time_window_width);
+
+  void Clear();
+
+private:
+  struct Entry
+  {
+    vtkSmartPointer<vtkTemporalTransforms> Trajectory; // keeps the key pointer valid
+    vtkMTimeType MTime;
+    Signal Value;
+  };
+  typedef std::tuple<vtkTemporalTransforms*, CorrelationStrategy, double> Key;
+
+  std::map<Key, Entry> Entries;
+  std::mutex Mutex;
+};
+
 /**
  * \brief Compute the timeshift in seconds between both pose trajectories.
  *
@@ -65,6 +109,40 @@ double VelodyneHDLPlugin_EXPORT ComputeTimeShift(vtkSmartPointer<vtkTemporalTran
                       double time_window_width,
                       bool substract_mean = true);
 
+/**
+ * \brief Same as ComputeTimeShift, using and filling a cache of the signals
+ * of the trajectories.
+ **/
+double VelodyneHDLPlugin_EXPORT ComputeTimeShift(CorrelationSignalCache& cache,
+                      vtkSmartPointer<vtkTemporalTransforms> reference,
+                      vtkSmartPointer<vtkTemporalTransforms> aligned,
+                      CorrelationStrategy correlationStrategy,
+                      double time_window_width,
+                      bool substract_mean = true);
+
+struct TimeShiftMethod
+{
+  CorrelationStrategy Strategy;
+  double TimeWindowWidth;
+};
+
+/**
+ * \brief Compute the timeshifts between both pose trajectories with several
+ * methods, evaluated in parallel. Each thread keeps its FFT plans between the
+ * methods it evaluates.
+ * \param cache cache of the signals, may be shared by several calls, a
+ * temporary one is used if null
+ * \param numberOfThreads 0 uses one thread per core
+ * \return the timeshift of each method, in the same order
+ **/
+std::vector<double> VelodyneHDLPlugin_EXPORT ComputeTimeShifts(
+                      vtkSmartPointer<vtkTemporalTransforms> reference,
+                      vtkSmartPointer<vtkTemporalTransforms> aligned,
+                      const std::vector<TimeShiftMethod>& methods,
+                      bool substract_mean = true,
+                      CorrelationSignalCache* cache = nullptr,
+                      int numberOfThreads = 0);
+
 void ShowTrajectoryInfo(vtkSmartPointer<vtkTemporalTransforms> reference,
                     vtkSmartPointer<vtkTemporalTransforms> aligned);
 
@@ -129,6 +129,7 @@ vtkVelodyneTransformInterpolator::vtkVelodyneTransformInterpolator()
   // Quaternion interpolation
   this->TransformList = new vtkTransformList;
   this->Initialized = 0;
+  this->LastSegment = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -521,6 +522,155 @@ void vtkVelodyneTransformInterpolator::InterpolateTransform(double t, vtkTransfo
   xform->Scale(S);
 }
 
+//----------------------------------------------------------------------------
+void vtkVelodyneTransformInterpolator::InterpolateRawTransform(double t, size_t& segment,
+                                                               double quaternion[4],
+                                                               double translation[3],
+                                                               double scale[3])
+{
+  vtkVeloViewQuaterniond q;
+  translation[0] = translation[1] = translation[2] = 0.0;
+  scale[0] = scale[1] = scale[2] = 1.0;
+  if (this->TransformList->empty())
+  {
+    q.ToIdentity();
+    q.Get(quaternion);
+    return;
+  }
+
+  this->InitializeInterpolation();
+  t = std::min(std::max(t, this->TransformList->front().Time), this->TransformList->back().Time);
+
+  // the spline and manual interpolations go through the interpolators, without
+  // building a transform
+  const std::vector<vtkQTransform>& transforms = this->TransformVector;
+  if (this->InterpolationType == INTERPOLATION_TYPE_SPLINE ||
+      this->InterpolationType == INTERPOLATION_TYPE_MANUAL)
+  {
+    this->PositionInterpolator->InterpolateTupleDichotomic(t, translation);
+    this->ScaleInterpolator->InterpolateTupleDichotomic(t, scale);
+    this->RotationInterpolator->InterpolateQuaternion(t, q);
+    q.Normalize();
+    q.Get(quaternion);
+    return;
+  }
+  if (transforms.size() < 2)
+  {
+    const vtkQTransform& transform = transforms.front();
+    std::copy(transform.P, transform.P + 3, translation);
+    std::copy(transform.S, transform.S + 3, scale);
+    transform.Q.Normalized().Get(quaternion);
+    return;
+  }
+
+  // find the segment [i, i + 1] containing t, trying the previous one and the
+  // next one before searching all of them
+  auto contains = [&transforms](size_t i, double time) {
+    return i + 1 < transforms.size() && transforms[i].Time <= time && time <= transforms[i + 1].Time;
+  };
+  if (!contains(segment, t))
+  {
+    if (contains(segment + 1, t))
+    {
+      ++segment;
+    }
+    else
+    {
+      vtkQTransform transform;
+      transform.Time = t;
+      auto upper = std::upper_bound(transforms.begin(), transforms.end(), transform, vtkQTransformComparator());
+      segment = std::min<size_t>(std::max<ptrdiff_t>(upper - transforms.begin() - 1, 0), transforms.size() - 2);
+    }
+  }
+  const vtkQTransform& previous = transforms[segment];
+  const vtkQTransform& next = transforms[segment + 1];
+
+  if (this->InterpolationType == INTERPOLATION_TYPE_LINEAR)
+  {
+    const double ratio = next.Time > previous.Time ? (t - previous.Time) / (next.Time - previous.Time) : 0.0;
+    for (int k = 0; k < 3; ++k)
+    {
+      translation[k] = (1.0 - ratio) * previous.P[k] + ratio * next.P[k];
+      scale[k] = (1.0 - ratio) * previous.S[k] + ratio * next.S[k];
+    }
+    q = previous.Q.Slerp(ratio, next.Q);
+    q.Normalize();
+    q.Get(quaternion);
+    return;
+  }
+
+  // nearest interpolations, selecting the same transform as InterpolateTransformNearest:
+  // the first transform whose time is not lower than t, or the one before it
+  size_t lowerBound = t > previous.Time ? segment + 1 : segment;
+  if (this->InterpolationType == INTERPOLATION_TYPE_NEAREST_LOW_BOUNDED)
+  {
+    lowerBound = lowerBound > 0 ? lowerBound - 1 : 0;
+  }
+  else if (lowerBound > 0 &&
+           t - transforms[lowerBound - 1].Time <= std::abs(transforms[lowerBound].Time - t))
+  {
+    --lowerBound;
+  }
+  const vtkQTransform& nearest = transforms[lowerBound];
+  std::copy(nearest.P, nearest.P + 3, translation);
+  std::copy(nearest.S, nearest.S + 3, scale);
+  nearest.Q.Normalized().Get(quaternion);
+}
+
+//----------------------------------------------------------------------------
+void vtkVelodyneTransformInterpolator::InterpolateTransform(double t, double quaternion[4],
+                                                            double translation[3])
+{
+  double scale[3];
+  this->InterpolateRawTransform(t, this->LastSegment, quaternion, translation, scale);
+}
+
+//----------------------------------------------------------------------------
+namespace
+{
+// Fill the row-major matrix translation * rotation * scale, the order in which
+// InterpolateTransform composes them
+void ComposeMatrix(const double quaternion[4], const double translation[3],
+                   const double scale[3], double matrix[16])
+{
+  vtkVeloViewQuaterniond q(quaternion);
+  double R[3][3];
+  q.ToMatrix3x3(R);
+  for (int i = 0; i < 3; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+    {
+      matrix[4 * i + j] = R[i][j] * scale[j];
+    }
+    matrix[4 * i + 3] = translation[i];
+  }
+  matrix[12] = matrix[13] = matrix[14] = 0.0;
+  matrix[15] = 1.0;
+}
+}
+
+//----------------------------------------------------------------------------
+void vtkVelodyneTransformInterpolator::InterpolateTransformMatrix(double t, double matrix[16])
+{
+  double quaternion[4], translation[3], scale[3];
+  this->InterpolateRawTransform(t, this->LastSegment, quaternion, translation, scale);
+  ComposeMatrix(quaternion, translation, scale, matrix);
+}
+
+//----------------------------------------------------------------------------
+void vtkVelodyneTransformInterpolator::InterpolateTransformMatrices(const double* times,
+                                                                    vtkIdType numberOfTimes,
+                                                                    double* matrices)
+{
+  size_t segment = 0;
+  double quaternion[4], translation[3], scale[3];
+  for (vtkIdType i = 0; i < numberOfTimes; ++i)
+  {
+    this->InterpolateRawTransform(times[i], segment, quaternion, translation, scale);
+    ComposeMatrix(quaternion, translation, scale, matrices + 16 * i);
+  }
+}
+
 //----------------------------------------------------------------------------
 void vtkVelodyneTransformInterpolator::InterpolateTransformNearest(double t,
                                                     vtkTransform *xform)
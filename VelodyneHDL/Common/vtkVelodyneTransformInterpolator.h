@@ -110,6 +110,22 @@ public:
   // (min,max) values, then t is clamped.
   void InterpolateTransform(double t, vtkTransform* xform);
 
+  // Description:
+  // Interpolate the transform at t like InterpolateTransform, without building
+  // any VTK object: the rotation is given as a unit quaternion (w, x, y, z),
+  // the scale being ignored, or the whole transform as a row-major 4x4 matrix.
+  // The segment of the previous call is tried first, so that increasing times
+  // are interpolated in constant time, the other ones by a binary search.
+  void InterpolateTransform(double t, double quaternion[4], double translation[3]);
+  void InterpolateTransformMatrix(double t, double matrix[16]);
+
+  // Description:
+  // Interpolate the row-major 4x4 matrices of an array of times in one call,
+  // matrices must hold 16 values per time. This does not change the segment
+  // of the previous call, so that several threads can use it once the
+  // interpolator has been initialized by a first call.
+  void InterpolateTransformMatrices(const double* times, vtkIdType numberOfTimes, double* matrices);
+
   // Description:
   // Return the transform list
   std::vector<std::vector<double> > GetTransformList();
@@ -180,6 +196,12 @@ protected:
   int InterpolationType;
   void InterpolateTransformNearest(double t, vtkTransform *xform);
 
+  // Interpolate the rotation, translation and scale at t, segment being the
+  // index of the transforms around the previous time, updated for t
+  void InterpolateRawTransform(double t, size_t& segment, double quaternion[4],
+                               double translation[3], double scale[3]);
+  size_t LastSegment;
+
   // Interpolators
   vtkVeloViewTupleInterpolator* PositionInterpolator;
   vtkVeloViewTupleInterpolator* ScaleInterpolator;
@@ -0,0 +1,153 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "BirdEyeViewWriter.h"
+
+// STD
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+
+// VTK
+#include <vtkImageData.h>
+#include <vtkPNGWriter.h>
+#include <vtkSmartPointer.h>
+
+// BOOST
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+
+namespace
+{
+//! Above this number of queued views, Enqueue waits for the writing thread
+const unsigned int MaxQueueDepth = 64;
+//! Maximum time a view waits before being written
+const boost::chrono::milliseconds FlushInterval(500);
+}
+
+//-----------------------------------------------------------------------------
+bool BirdEyeViewWriter::Start(int format, const std::string& radical, const std::string& extension)
+{
+  this->Stop();
+  this->OutputFormat = format;
+  this->Radical = radical;
+  this->Extension = extension;
+  if (format == Raw)
+  {
+    this->Stream.open((radical + ".bev").c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!this->Stream.is_open())
+    {
+      return false;
+    }
+  }
+
+  this->Views.reset(new SynchronizedQueue<BirdEyeViewPointer>);
+  this->Thread = boost::shared_ptr<boost::thread>(
+        new boost::thread(boost::bind(&BirdEyeViewWriter::ThreadLoop, this)));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void BirdEyeViewWriter::Stop()
+{
+  if (this->Thread)
+  {
+    this->Views->stopQueue();
+    this->Thread->join();
+    this->Thread.reset();
+    this->Views.reset();
+  }
+  if (this->Stream.is_open())
+  {
+    this->Stream.close();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void BirdEyeViewWriter::Enqueue(const BirdEyeViewPointer& view)
+{
+  if (!this->Views)
+  {
+    return;
+  }
+  while (this->Views->size() >= MaxQueueDepth)
+  {
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+  }
+  this->Views->enqueue(view);
+}
+
+//-----------------------------------------------------------------------------
+void BirdEyeViewWriter::ThreadLoop()
+{
+  // the views still queued when the writer is stopped are written too
+  std::vector<BirdEyeViewPointer> views;
+  bool isRunning = true;
+  while (isRunning)
+  {
+    isRunning = this->Views->dequeueAll(views, FlushInterval);
+    for (const BirdEyeViewPointer& view : views)
+    {
+      if (this->OutputFormat == Raw)
+      {
+        this->WriteRaw(*view);
+      }
+      else
+      {
+        this->WritePng(*view);
+      }
+    }
+    views.clear();
+    if (this->Stream.is_open())
+    {
+      this->Stream.flush();
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void BirdEyeViewWriter::WritePng(const BirdEyeView& view)
+{
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(view.Width, view.Height, 1);
+  image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  unsigned char* dataPointer = static_cast<unsigned char*>(image->GetScalarPointer());
+  const float* intensity = view.GetChannel(BirdEyeView::Intensity);
+  const size_t numberOfPixels = static_cast<size_t>(view.Width) * view.Height;
+  for (size_t pixel = 0; pixel < numberOfPixels; ++pixel)
+  {
+    dataPointer[pixel] = static_cast<unsigned char>(std::min(std::max(intensity[pixel], 0.f), 255.f));
+  }
+
+  std::stringstream ss;
+  ss << this->Radical << view.Index << "." << this->Extension;
+  vtkSmartPointer<vtkPNGWriter> writer = vtkSmartPointer<vtkPNGWriter>::New();
+  writer->SetFileName(ss.str().c_str());
+  writer->SetInputData(image);
+  writer->Write();
+}
+
+//-----------------------------------------------------------------------------
+void BirdEyeViewWriter::WriteRaw(const BirdEyeView& view)
+{
+  const std::uint32_t header[4] = { view.Index, view.Width, view.Height,
+                                      BirdEyeView::NumberOfChannels };
+  this->Stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+  this->Stream.write(reinterpret_cast<const char*>(view.Values.data()),
+                     view.Values.size() * sizeof(float));
+}
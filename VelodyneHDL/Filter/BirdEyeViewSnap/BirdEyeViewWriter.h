@@ -0,0 +1,115 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef BIRD_EYE_VIEW_WRITER_H
+#define BIRD_EYE_VIEW_WRITER_H
+
+// STD
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// BOOST
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "SynchronizedQueue.h"
+
+/**
+ * @brief BirdEyeView a rasterized view, whose channels are stored one after the
+ * other. The pixel (x, y) of a channel is at x + Width * y, like in a vtkImageData.
+ */
+struct BirdEyeView
+{
+  enum Channel
+  {
+    HeightMax = 0,
+    HeightMin = 1,
+    Density = 2,
+    Intensity = 3,
+    NumberOfChannels = 4
+  };
+
+  //! Index of the view, used to name the files
+  unsigned int Index = 0;
+  unsigned int Width = 0;
+  unsigned int Height = 0;
+  std::vector<float> Values;
+
+  float* GetChannel(int channel) { return this->Values.data() + channel * this->Width * this->Height; }
+  const float* GetChannel(int channel) const { return this->Values.data() + channel * this->Width * this->Height; }
+};
+
+typedef std::shared_ptr<const BirdEyeView> BirdEyeViewPointer;
+
+/**
+ * @brief BirdEyeViewWriter save bird eye views on a dedicated thread, so that the
+ * rasterization of the next frames does not wait for the disk.
+ * - Png writes the intensity channel of each view in its own file
+ * - Raw appends all the views to a single file, each view being a header of four
+ *   uint32 (index, width, height, number of channels) followed by its channels in
+ *   float32, which can be read as a batch of tensors
+ */
+class BirdEyeViewWriter
+{
+public:
+  enum Format
+  {
+    Png = 0,
+    Raw = 1
+  };
+
+  ~BirdEyeViewWriter() { this->Stop(); }
+
+  /**
+   * @brief Start the writing thread
+   * @param radical path of the files without extension, the index of the view is
+   * appended to it in Png format
+   */
+  bool Start(int format, const std::string& radical, const std::string& extension);
+
+  //! Write all the queued views and stop the writing thread
+  void Stop();
+
+  bool IsRunning() const { return static_cast<bool>(this->Thread); }
+
+  /**
+   * @brief Enqueue a view to write, waiting if too many views are queued already
+   * so that the memory used stays bounded when the disk cannot keep up
+   */
+  void Enqueue(const BirdEyeViewPointer& view);
+
+  int GetFormat() const { return this->OutputFormat; }
+  const std::string& GetRadical() const { return this->Radical; }
+
+private:
+  void ThreadLoop();
+
+  void WritePng(const BirdEyeView& view);
+
+  void WriteRaw(const BirdEyeView& view);
+
+  int OutputFormat = Png;
+  std::string Radical;
+  std::string Extension;
+  std::ofstream Stream;
+  boost::shared_ptr<boost::thread> Thread;
+  boost::shared_ptr<SynchronizedQueue<BirdEyeViewPointer> > Views;
+};
+
+#endif // BIRD_EYE_VIEW_WRITER_H
@@ -16,10 +16,18 @@
 
 // LOCAL
 #include "vtkBirdEyeViewSnap.h"
+#include "TraceEvents.h"
+#include "BirdEyeViewWriter.h"
+#include "ParallelPoints.h"
 
 // STD
+#include <algorithm>
+#include <array>
+#include <functional>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <numeric>
 #include <sstream>
 #include <cmath>
 
@@ -46,7 +54,6 @@
 #include <vtkUnsignedCharArray.h>
 #include <vtkUnsignedIntArray.h>
 #include <vtkUnsignedShortArray.h>
-#include <vtkPNGWriter.h>
 
 // BOOST
 #include <boost/algorithm/string.hpp>
@@ -75,6 +82,11 @@ vtkBirdEyeViewSnap::vtkBirdEyeViewSnap()
 //----------------------------------------------------------------------------
 vtkBirdEyeViewSnap::~vtkBirdEyeViewSnap()
 {
+  // the views still queued are written
+  if (this->Writer)
+  {
+    this->Writer->Stop();
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -87,78 +99,199 @@ void vtkBirdEyeViewSnap::PrintSelf(ostream& os, vtkIndent indent)
 int vtkBirdEyeViewSnap::RequestData(vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkBirdEyeViewSnap::RequestData");
   // Get the input
   vtkPolyData * input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  const vtkIdType numberOfPoints = input->GetNumberOfPoints();
 
   // Get the output
   vtkPolyData *output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
   output->ShallowCopy(input);
 
   // Check that the provided filename is valid
-  if (this->RadicalFileName == "NoRadical" ||
-      this->ExtensionFileName == "NoExtension")
+  if (this->OutputFormat != MemoryOnly &&
+      (this->RadicalFileName == "NoRadical" || this->ExtensionFileName == "NoExtension"))
   {
     vtkGenericWarningMacro("Filename has not been settled or is invalid");
     return 0;
   }
+  if (numberOfPoints == 0)
+  {
+    return 1;
+  }
 
-  // transform the input
-  Eigen::Matrix<double, 3, 1> point;
-  double vtkpoint[3];
-  for (unsigned int k = 0; k < input->GetNumberOfPoints(); ++k)
+  const int numberOfThreads = GetNumberOfThreads(this->NumberOfThreads);
+  const int numberOfPointRanges = GetNumberOfPointRanges(numberOfThreads, numberOfPoints);
+
+  // transform the input in new points, so that the input is not modified, each
+  // range of points computing its bounding box. The other arrays are shared with the input.
+  vtkNew<vtkPoints> points;
+  points->SetDataType(input->GetPoints()->GetDataType());
+  points->SetNumberOfPoints(numberOfPoints);
+  std::vector<double> transformed(3 * numberOfPoints);
+  const PointCoordinates coordinates(input->GetPoints());
+  std::array<double, 6> emptyBounds;
+  for (int i = 0; i < 3; ++i)
   {
-    input->GetPoint(k, vtkpoint);
-    point << vtkpoint[0], vtkpoint[1], vtkpoint[2];
-    point = this->Orientation * point;
-    vtkpoint[0] = point(0);
-    vtkpoint[1] = point(1);
-    vtkpoint[2] = point(2);
-    output->GetPoints()->SetPoint(k, vtkpoint);
+    emptyBounds[2 * i] = std::numeric_limits<double>::max();
+    emptyBounds[2 * i + 1] = std::numeric_limits<double>::lowest();
   }
+  const std::array<double, 6> bounds = ParallelReduce(numberOfPoints, numberOfPointRanges,
+    emptyBounds,
+    [&](std::array<double, 6>& rangeBounds, size_t begin, size_t end) {
+      double vtkpoint[3];
+      for (size_t k = begin; k < end; ++k)
+      {
+        coordinates.Get(k, vtkpoint);
+        Eigen::Map<Eigen::Vector3d> point(transformed.data() + 3 * k);
+        point = this->Orientation * Eigen::Vector3d(vtkpoint[0], vtkpoint[1], vtkpoint[2]);
+        points->SetPoint(k, point.data());
+        for (int i = 0; i < 3; ++i)
+        {
+          rangeBounds[2 * i] = std::min(rangeBounds[2 * i], point(i));
+          rangeBounds[2 * i + 1] = std::max(rangeBounds[2 * i + 1], point(i));
+        }
+      }
+    },
+    [](std::array<double, 6>& result, const std::array<double, 6>& rangeBounds) {
+      for (int i = 0; i < 3; ++i)
+      {
+        result[2 * i] = std::min(result[2 * i], rangeBounds[2 * i]);
+        result[2 * i + 1] = std::max(result[2 * i + 1], rangeBounds[2 * i + 1]);
+      }
+    });
+  output->SetPoints(points.GetPointer());
 
   // Create the bird eye view image
-  double bounds[6];
-  output->GetBounds(bounds);
-  unsigned int x, y;
-
-  unsigned int H = std::ceil((bounds[1] - bounds[0]) / this->pixelResX);
-  unsigned int W = std::ceil((bounds[3] - bounds[2]) / this->pixelResY);
-
-  // Image
-  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
-  image->SetDimensions(H, W, 1);
-  image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-  unsigned char* dataPointer = static_cast<unsigned char*>(image->GetScalarPointer());
-  std::fill(dataPointer, dataPointer + H * W, 0);
-
-  // Get the reflectivity array
-  vtkDataArray* intensity = output->GetPointData()->GetArray("intensity");
+  auto view = std::make_shared<BirdEyeView>();
+  view->Index = this->Count;
+  view->Width = std::max(1u, static_cast<unsigned int>(std::ceil((bounds[1] - bounds[0]) / this->pixelResX)));
+  view->Height = std::max(1u, static_cast<unsigned int>(std::ceil((bounds[3] - bounds[2]) / this->pixelResY)));
+  const size_t numberOfPixels = static_cast<size_t>(view->Width) * view->Height;
+  view->Values.assign(BirdEyeView::NumberOfChannels * numberOfPixels, 0.f);
+
+  // Pixel of each point, a flat bounding box gives a single column or row
+  const double scaleX = bounds[1] > bounds[0] ? (view->Width - 1) / (bounds[1] - bounds[0]) : 0.;
+  const double scaleY = bounds[3] > bounds[2] ? (view->Height - 1) / (bounds[3] - bounds[2]) : 0.;
+  std::vector<unsigned int> pointPixels(numberOfPoints);
+  ParallelFor(numberOfPoints, numberOfPointRanges, [&](size_t, size_t begin, size_t end) {
+    for (size_t k = begin; k < end; ++k)
+    {
+      const unsigned int x = std::floor((transformed[3 * k] - bounds[0]) * scaleX);
+      const unsigned int y = std::floor((transformed[3 * k + 1] - bounds[2]) * scaleY);
+      pointPixels[k] = x + view->Width * y;
+    }
+  });
+
+  // Gather the points of each pixel, the points of the pixel p being in
+  // [offsets[p], offsets[p + 1][
+  std::vector<size_t> offsets(numberOfPixels + 1, 0);
+  for (unsigned int pixel : pointPixels)
+  {
+    offsets[pixel + 1]++;
+  }
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<vtkIdType> pixelPoints(numberOfPoints);
+  {
+    std::vector<size_t> cursors(offsets.begin(), offsets.end() - 1);
+    for (vtkIdType k = 0; k < numberOfPoints; ++k)
+    {
+      pixelPoints[cursors[pointPixels[k]]++] = k;
+    }
+  }
 
-  for (unsigned int k = 0; k < output->GetNumberOfPoints(); ++k)
+  // fill the channels, each range of rows reducing the points of its pixels
+  vtkDataArray* intensityArray = output->GetPointData()->GetArray("intensity");
+  const ArrayComponent intensity(intensityArray);
+  float* heightMax = view->GetChannel(BirdEyeView::HeightMax);
+  float* heightMin = view->GetChannel(BirdEyeView::HeightMin);
+  float* density = view->GetChannel(BirdEyeView::Density);
+  float* intensityMax = view->GetChannel(BirdEyeView::Intensity);
+  const int numberOfRowRanges = std::min<int>(numberOfThreads, view->Height);
+  ParallelFor(view->Height, numberOfRowRanges, [&](size_t, size_t firstRow, size_t lastRow) {
+    for (size_t pixel = firstRow * view->Width; pixel < lastRow * view->Width; ++pixel)
+    {
+      if (offsets[pixel + 1] == offsets[pixel])
+      {
+        continue;
+      }
+      float zMax = std::numeric_limits<float>::lowest();
+      float zMin = std::numeric_limits<float>::max();
+      float value = 0.f;
+      for (size_t i = offsets[pixel]; i < offsets[pixel + 1]; ++i)
+      {
+        const vtkIdType k = pixelPoints[i];
+        const float z = static_cast<float>(transformed[3 * k + 2]);
+        zMax = std::max(zMax, z);
+        zMin = std::min(zMin, z);
+        if (intensityArray)
+        {
+          value = std::max(value, static_cast<float>(intensity.Get(k)));
+        }
+      }
+      heightMax[pixel] = zMax;
+      heightMin[pixel] = zMin;
+      density[pixel] = static_cast<float>(offsets[pixel + 1] - offsets[pixel]);
+      intensityMax[pixel] = value;
+    }
+  });
+
+  // Keep the image in memory, its arrays share the values of the view
+  const char* channelNames[BirdEyeView::NumberOfChannels] = { "height_max", "height_min", "density", "intensity" };
+  this->Image = vtkSmartPointer<vtkImageData>::New();
+  this->Image->SetDimensions(view->Width, view->Height, 1);
+  this->Image->SetSpacing(this->pixelResX, this->pixelResY, 1.);
+  this->Image->SetOrigin(bounds[0], bounds[2], 0.);
+  for (int channel = 0; channel < BirdEyeView::NumberOfChannels; ++channel)
   {
-    // Compute pixel coordinate
-    output->GetPoint(k, vtkpoint);
-    x = std::floor((vtkpoint[0] - bounds[0]) / (bounds[1] - bounds[0]) * (H - 1));
-    y = std::floor((vtkpoint[1] - bounds[2]) / (bounds[3] - bounds[2]) * (W - 1));
-
-    // set value
-    unsigned char value = intensity->GetVariantValue(k).ToUnsignedChar();
-    image->SetScalarComponentFromDouble(x, y, 0, 0, value);
+    vtkNew<vtkFloatArray> array;
+    array->SetName(channelNames[channel]);
+    array->SetArray(view->GetChannel(channel), static_cast<vtkIdType>(numberOfPixels), 1);
+    this->Image->GetPointData()->AddArray(array.GetPointer());
   }
+  this->Image->GetPointData()->SetActiveScalars("intensity");
+  this->View = view;
 
-  // Save the image
-  std::stringstream ss;
-  ss << this->RadicalFileName << this->Count << "." << ExtensionFileName;
-  vtkSmartPointer<vtkPNGWriter> writer = vtkSmartPointer<vtkPNGWriter>::New();
-  writer->SetFileName(ss.str().c_str());
-  writer->SetInputData(image);
-  writer->Write();
+  // Save the image on the writing thread
+  if (this->OutputFormat != MemoryOnly)
+  {
+    if (!this->Writer)
+    {
+      this->Writer.reset(new BirdEyeViewWriter);
+    }
+    if (!this->Writer->IsRunning() || this->Writer->GetFormat() != this->OutputFormat ||
+        this->Writer->GetRadical() != this->RadicalFileName)
+    {
+      if (!this->Writer->Start(this->OutputFormat, this->RadicalFileName, this->ExtensionFileName))
+      {
+        vtkGenericWarningMacro("Could not open the bird eye views file of " << this->RadicalFileName);
+        return 0;
+      }
+    }
+    this->Writer->Enqueue(view);
+  }
 
   this->Count++;
 
   return 1;
 }
 
+//-----------------------------------------------------------------------------
+void vtkBirdEyeViewSnap::SetOutputFormat(int format)
+{
+  if (format == this->OutputFormat)
+  {
+    return;
+  }
+  // the views of the previous format are written before the next ones
+  if (this->Writer)
+  {
+    this->Writer->Stop();
+  }
+  this->OutputFormat = format;
+  this->Modified();
+}
+
 //-----------------------------------------------------------------------------
 void vtkBirdEyeViewSnap::SetPlaneParam(double params[4])
 {
@@ -17,7 +17,11 @@
 #ifndef VTK_BIRD_EYE_VIEW_H
 #define VTK_BIRD_EYE_VIEW_H
 
+// STD
+#include <memory>
+
 // VTK
+#include <vtkImageData.h>
 #include <vtkPolyData.h>
 #include <vtkPolyDataAlgorithm.h>
 #include <vtkSmartPointer.h>
@@ -25,6 +29,15 @@
 // EIGEN
 #include <Eigen/Dense>
 
+class BirdEyeViewWriter;
+struct BirdEyeView;
+
+/**
+ * @brief vtkBirdEyeViewSnap rasterize the frames seen from above. The height max,
+ * height min, density and max intensity of the points of each pixel are kept in
+ * memory in the image given by GetImage, and the views are saved by a dedicated
+ * thread so that the next frames do not wait for the disk.
+ */
 class VTK_EXPORT vtkBirdEyeViewSnap : public vtkPolyDataAlgorithm
 {
 public:
@@ -45,6 +58,23 @@ public:
   // set the count value used to name files
   void SetCount(unsigned int count);
 
+  enum OutputFormatType
+  {
+    Png = 0,        /*!< intensity channel of each view in its own file */
+    Raw = 1,        /*!< all the channels of all the views in a single .bev file */
+    MemoryOnly = 2  /*!< the views are not saved */
+  };
+
+  vtkGetMacro(OutputFormat, int)
+  virtual void SetOutputFormat(int format);
+
+  vtkGetMacro(NumberOfThreads, int)
+  vtkSetMacro(NumberOfThreads, int)
+
+  // Last view, whose point data has the height_max, height_min, density
+  // and intensity arrays
+  vtkImageData* GetImage() { return this->Image; }
+
 protected:
   // constructor / destructor
   vtkBirdEyeViewSnap();
@@ -74,6 +104,17 @@ private:
   // size of a pixel in meters
   double pixelResX;
   double pixelResY;
+
+  int OutputFormat = Png;
+
+  // 0 uses one thread per core
+  int NumberOfThreads = 0;
+
+  // last view and the image sharing its values
+  std::shared_ptr<BirdEyeView> View;
+  vtkSmartPointer<vtkImageData> Image;
+
+  std::unique_ptr<BirdEyeViewWriter> Writer;
 };
 
 #endif // VTK_BIRD_EYE_VIEW_H
\ No newline at end of file
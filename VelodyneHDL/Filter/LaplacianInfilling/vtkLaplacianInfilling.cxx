@@ -16,18 +16,24 @@
 
 // LOCAL
 #include "vtkLaplacianInfilling.h"
+#include "TraceEvents.h"
 
 // STD
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <sstream>
 #include <cmath>
 
 // VTK
+#include <vtkDataArray.h>
 #include <vtkObjectFactory.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkXMLImageDataWriter.h>
 
@@ -37,6 +43,16 @@
 // Eigen
 #include <Eigen/Sparse>
 
+namespace
+{
+//-----------------------------------------------------------------------------
+// A pixel is known if it has a non null value
+bool IsKnown(double value)
+{
+  return std::abs(value) > std::numeric_limits<double>::epsilon();
+}
+}
+
 // Implementation of the New function
 vtkStandardNewMacro(vtkLaplacianInfilling)
 
@@ -44,17 +60,66 @@ vtkStandardNewMacro(vtkLaplacianInfilling)
 int vtkLaplacianInfilling::RequestData(vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkLaplacianInfilling::RequestData");
   // Get the input
   vtkImageData * inputImage = vtkImageData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkDataArray* inputScalars = inputImage->GetPointData()->GetScalars();
 
   // Get the output
   vtkImageData* outputImage = vtkImageData::GetData(outputVector->GetInformationObject(0));
   outputImage->ShallowCopy(inputImage);
+  if (!inputScalars)
+  {
+    return 1;
+  }
 
   int xBound = outputImage->GetDimensions()[0];
   int yBound = outputImage->GetDimensions()[1];
   int nParams = xBound * yBound;
 
+  // values of the pixels, the pixel (x, y) being at x + xBound * y
+  std::vector<double> values(nParams);
+  for (int flattenIndex = 0; flattenIndex < nParams; ++flattenIndex)
+  {
+    values[flattenIndex] = inputScalars->GetComponent(flattenIndex, 0);
+  }
+
+  std::vector<double> solution;
+  if (this->Solver == Direct)
+  {
+    this->SolveDirect(values, xBound, yBound, solution);
+  }
+  else
+  {
+    const bool isWarm = this->WarmStart && this->PreviousDimensions[0] == xBound &&
+      this->PreviousDimensions[1] == yBound;
+    solution = isWarm ? this->PreviousSolution : std::vector<double>(nParams, 0.);
+    this->SolveConjugateGradient(values, xBound, yBound, solution);
+    this->PreviousSolution = solution;
+    this->PreviousDimensions[0] = xBound;
+    this->PreviousDimensions[1] = yBound;
+  }
+
+  // the solution contains the Dirichlet solution function
+  // values i.e: 0-values pixel are filled with laplacian.
+  // The output has its own scalars, the input ones are shared
+  vtkSmartPointer<vtkDataArray> outputScalars = vtkSmartPointer<vtkDataArray>::Take(inputScalars->NewInstance());
+  outputScalars->DeepCopy(inputScalars);
+  for (int flattenIndex = 0; flattenIndex < nParams; ++flattenIndex)
+  {
+    outputScalars->SetComponent(flattenIndex, 0, solution[flattenIndex]);
+  }
+  outputImage->GetPointData()->SetScalars(outputScalars);
+
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLaplacianInfilling::SolveDirect(const std::vector<double>& values, int xBound, int yBound,
+                                        std::vector<double>& solution) const
+{
+  int nParams = xBound * yBound;
+
   Eigen::SparseMatrix<double> Laplacian(nParams, nParams);
   Eigen::VectorXd Y(nParams); // The values of the laplacian required
 
@@ -67,8 +132,8 @@ int vtkLaplacianInfilling::RequestData(vtkInformation *vtkNotUsed(request),
       int flattenIndex = x + xBound * y;
 
       // check if the current pixel has a value
-      double value = inputImage->GetScalarComponentAsDouble(x, y, 0, 0);
-      if ((std::abs(value) > std::numeric_limits<double>::epsilon()))
+      double value = values[flattenIndex];
+      if (IsKnown(value))
       {
         // we don't want this value to be modified
         // contraint: xi = yi
@@ -117,19 +182,135 @@ int vtkLaplacianInfilling::RequestData(vtkInformation *vtkNotUsed(request),
 
   // Solving:
   Eigen::SparseLU< Eigen::SparseMatrix<double> > solver(Laplacian);
-  Eigen::MatrixXd X = solver.solve(Y);
+  Eigen::VectorXd X = solver.solve(Y);
+  solution.assign(X.data(), X.data() + nParams);
+}
 
-  // X contains the Dirichlet solution function
-  // values i.e: 0-values pixel are filled with
-  // laplacian
-  for (int x = 0; x < xBound; ++x)
+//-----------------------------------------------------------------------------
+void vtkLaplacianInfilling::SolveConjugateGradient(const std::vector<double>& values, int xBound, int yBound,
+                                                   std::vector<double>& solution) const
+{
+  // Only the missing pixels are unknowns. For each one, the laplacian equation is
+  // n x - sum(unknown neighbors) = sum(known neighbors), n being its number of
+  // neighbors, whose matrix is symmetric and diagonally dominant
+  const int nParams = xBound * yBound;
+  std::vector<int> unknownIndex(nParams, -1);
+  std::vector<int> unknownPixels;
+  for (int flattenIndex = 0; flattenIndex < nParams; ++flattenIndex)
   {
-    for (int y = 0; y < yBound; ++y)
+    if (IsKnown(values[flattenIndex]))
+    {
+      solution[flattenIndex] = values[flattenIndex];
+    }
+    else
+    {
+      unknownIndex[flattenIndex] = static_cast<int>(unknownPixels.size());
+      unknownPixels.push_back(flattenIndex);
+    }
+  }
+  const size_t nUnknowns = unknownPixels.size();
+  if (nUnknowns == 0)
+  {
+    return;
+  }
+  if (nUnknowns == static_cast<size_t>(nParams))
+  {
+    std::fill(solution.begin(), solution.end(), 0.);
+    return;
+  }
+
+  // unknown neighbors of each unknown, -1 if none, and right hand side
+  std::vector<int> neighbors(4 * nUnknowns, -1);
+  std::vector<double> diagonal(nUnknowns), b(nUnknowns, 0.), x(nUnknowns);
+  for (size_t k = 0; k < nUnknowns; ++k)
+  {
+    const int flattenIndex = unknownPixels[k];
+    const int px = flattenIndex % xBound;
+    const int py = flattenIndex / xBound;
+    const int neighborPixels[4] = { px != 0 ? flattenIndex - 1 : -1,
+                                    px != xBound - 1 ? flattenIndex + 1 : -1,
+                                    py != 0 ? flattenIndex - xBound : -1,
+                                    py != yBound - 1 ? flattenIndex + xBound : -1 };
+    int validNeigh = 0;
+    for (int n = 0; n < 4; ++n)
     {
-      int flattendIndex = x + xBound * y;
-      outputImage->SetScalarComponentFromDouble(x, y, 0, 0, X(flattendIndex));
+      if (neighborPixels[n] < 0)
+      {
+        continue;
+      }
+      validNeigh++;
+      if (unknownIndex[neighborPixels[n]] >= 0)
+      {
+        neighbors[4 * k + n] = unknownIndex[neighborPixels[n]];
+      }
+      else
+      {
+        b[k] += values[neighborPixels[n]];
+      }
     }
+    diagonal[k] = std::max(validNeigh, 1);
+    x[k] = solution[flattenIndex];
   }
 
-  return 1;
+  auto multiply = [&](const std::vector<double>& v, std::vector<double>& result) {
+    for (size_t k = 0; k < nUnknowns; ++k)
+    {
+      double sum = diagonal[k] * v[k];
+      for (int n = 0; n < 4; ++n)
+      {
+        const int neighbor = neighbors[4 * k + n];
+        sum -= neighbor >= 0 ? v[neighbor] : 0.;
+      }
+      result[k] = sum;
+    }
+  };
+  auto dot = [&](const std::vector<double>& u, const std::vector<double>& v) {
+    double sum = 0;
+    for (size_t k = 0; k < nUnknowns; ++k)
+    {
+      sum += u[k] * v[k];
+    }
+    return sum;
+  };
+
+  // conjugate gradient, preconditioned by the diagonal
+  std::vector<double> r(nUnknowns), z(nUnknowns), p(nUnknowns), q(nUnknowns);
+  multiply(x, q);
+  for (size_t k = 0; k < nUnknowns; ++k)
+  {
+    r[k] = b[k] - q[k];
+    z[k] = r[k] / diagonal[k];
+  }
+  p = z;
+  double rz = dot(r, z);
+  const double stopNorm = this->Tolerance * std::sqrt(dot(b, b));
+  for (int iteration = 0; iteration < this->MaxIterations && std::sqrt(dot(r, r)) > stopNorm; ++iteration)
+  {
+    multiply(p, q);
+    const double pq = dot(p, q);
+    // a group of missing pixels without known neighbors has no unique solution
+    if (pq <= 0)
+    {
+      break;
+    }
+    const double alpha = rz / pq;
+    for (size_t k = 0; k < nUnknowns; ++k)
+    {
+      x[k] += alpha * p[k];
+      r[k] -= alpha * q[k];
+      z[k] = r[k] / diagonal[k];
+    }
+    const double rzNew = dot(r, z);
+    const double beta = rzNew / rz;
+    rz = rzNew;
+    for (size_t k = 0; k < nUnknowns; ++k)
+    {
+      p[k] = z[k] + beta * p[k];
+    }
+  }
+
+  for (size_t k = 0; k < nUnknowns; ++k)
+  {
+    solution[unknownPixels[k]] = x[k];
+  }
 }
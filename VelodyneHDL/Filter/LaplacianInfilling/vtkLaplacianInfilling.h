@@ -20,6 +20,9 @@
 // VTK
 #include <vtkImageAlgorithm.h>
 
+// STD
+#include <vector>
+
 /**
  * @brief vtkLaplacianInfilling fill missing data in an image
  *        solving the Dirichlet problem.
@@ -30,6 +33,26 @@ public:
   static vtkLaplacianInfilling *New();
   vtkTypeMacro(vtkLaplacianInfilling, vtkImageAlgorithm)
 
+  enum SolverType
+  {
+    //! Factorize the laplacian of all the pixels, this is the reference
+    Direct = 0,
+    //! Preconditioned conjugate gradient on the missing pixels, matrix free
+    ConjugateGradient = 1
+  };
+
+  vtkGetMacro(Solver, int)
+  vtkSetMacro(Solver, int)
+
+  vtkGetMacro(Tolerance, double)
+  vtkSetMacro(Tolerance, double)
+
+  vtkGetMacro(MaxIterations, int)
+  vtkSetMacro(MaxIterations, int)
+
+  vtkGetMacro(WarmStart, bool)
+  vtkSetMacro(WarmStart, bool)
+
 protected:
   vtkLaplacianInfilling() = default;
   ~vtkLaplacianInfilling() = default;
@@ -37,6 +60,28 @@ protected:
   int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
 private:
+  //! Fill the missing pixels with a direct solver of the whole image
+  void SolveDirect(const std::vector<double>& values, int xBound, int yBound, std::vector<double>& solution) const;
+  //! Fill the missing pixels with the conjugate gradient, starting from solution
+  void SolveConjugateGradient(const std::vector<double>& values, int xBound, int yBound, std::vector<double>& solution) const;
+
+  //! Solver of the Dirichlet problem
+  int Solver = ConjugateGradient;
+
+  //! Relative residual under which the conjugate gradient stops
+  double Tolerance = 1e-6;
+
+  //! Maximum number of iterations of the conjugate gradient
+  int MaxIterations = 1000;
+
+  //! Start the conjugate gradient from the solution of the previous image if it has
+  //! the same dimensions, the missing pixels of consecutive frames being close
+  bool WarmStart = true;
+
+  //! Previous solution, used by WarmStart
+  std::vector<double> PreviousSolution;
+  int PreviousDimensions[2] = {0, 0};
+
   vtkLaplacianInfilling(const vtkLaplacianInfilling&) = delete;
   void operator=(const vtkLaplacianInfilling&) = delete;
 };
@@ -15,16 +15,22 @@
 
 // LOCAL
 #include "vtkLidarRawSignalImage.h"
+#include "TraceEvents.h"
+#include "LidarDecodingKernels.h"
 
+#include <vtkFieldData.h>
 #include <vtkObjectFactory.h>
 #include <vtkImageData.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkIntArray.h>
 #include <vtkPointData.h>
 #include <vtkPolyData.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkTable.h>
 
+#include <cstring>
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkLidarRawSignalImage)
 
@@ -72,6 +78,7 @@ int vtkLidarRawSignalImage::FillInputPortInformation(int port, vtkInformation *i
 int vtkLidarRawSignalImage::RequestData(vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkLidarRawSignalImage::RequestData");
   // Get the inputs
   vtkPolyData * input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
   vtkTable* calibration = vtkTable::GetData(inputVector[1]->GetInformationObject(0));
@@ -103,6 +110,12 @@ int vtkLidarRawSignalImage::RequestData(vtkInformation *vtkNotUsed(request),
   unsigned char* dataPointer = static_cast<unsigned char*>(outputImage->GetScalarPointer());
   std::fill(dataPointer, dataPointer + this->Height * this->Width, 0);
 
+  // The interpreter may have written the returns in a range image while decoding
+  if (this->CopyRangeImage(input, dataPointer))
+  {
+    return VTK_OK;
+  }
+
   // Get the required array
   vtkDataArray* arrayToUse = this->GetInputArrayToProcess(0, inputVector);
   if (!arrayToUse)
@@ -147,6 +160,48 @@ int vtkLidarRawSignalImage::RequestData(vtkInformation *vtkNotUsed(request),
   return VTK_OK;
 }
 
+//-----------------------------------------------------------------------------
+bool vtkLidarRawSignalImage::CopyRangeImage(vtkPolyData* input, unsigned char* dataPointer)
+{
+  vtkFieldData* fieldData = input->GetFieldData();
+  vtkIntArray* dimensions = vtkIntArray::SafeDownCast(fieldData->GetArray(RangeImageBuilder::DimensionsName));
+  vtkInformation* arrayInfo = this->GetInputArrayInformation(0);
+  const char* arrayName = arrayInfo->Has(vtkDataObject::FIELD_NAME()) ?
+    arrayInfo->Get(vtkDataObject::FIELD_NAME()) : nullptr;
+  if (!dimensions || dimensions->GetNumberOfValues() != 2 || !arrayName ||
+      dimensions->GetValue(0) != this->Width || dimensions->GetValue(1) != this->Height)
+  {
+    return false;
+  }
+
+  // channel of the image holding the selected array, the rows and the columns
+  // of the image are the ones of the projection
+  const char* channelName = nullptr;
+  if (std::strcmp(arrayName, "distance_m") == 0)
+  {
+    channelName = RangeImageBuilder::RangeName;
+  }
+  else if (std::strcmp(arrayName, "intensity") == 0)
+  {
+    channelName = RangeImageBuilder::IntensityName;
+  }
+  else if (std::strcmp(arrayName, "adjustedtime") == 0)
+  {
+    channelName = RangeImageBuilder::TimeName;
+  }
+  vtkDataArray* channel = channelName ? fieldData->GetArray(channelName) : nullptr;
+  const vtkIdType numberOfPixels = static_cast<vtkIdType>(this->Width) * this->Height;
+  if (!channel || channel->GetNumberOfTuples() != numberOfPixels)
+  {
+    return false;
+  }
+  for (vtkIdType pixel = 0; pixel < numberOfPixels; ++pixel)
+  {
+    dataPointer[pixel] = static_cast<unsigned char>(channel->GetComponent(pixel, 0));
+  }
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 int vtkLidarRawSignalImage::RequestInformation(vtkInformation *vtkNotUsed(request),
                                                vtkInformationVector **vtkNotUsed(inputVector),
@@ -20,6 +20,7 @@
 
 #include <vtkImageAlgorithm.h>
 
+class vtkPolyData;
 class vtkTable;
 
 /**
@@ -27,6 +28,10 @@ class vtkTable;
  * of a point cloud to create a panorama image.
  *
  * @warning one image column corresponds to one laser.
+ *
+ * If the frames carry the range image written by the interpreter while
+ * decoding (see vtkLidarPacketInterpreter::RangeImageWidth) with the same
+ * width, the image of the selected array is copied from it instead.
  */
 class VTK_EXPORT vtkLidarRawSignalImage : public vtkImageAlgorithm
 {
@@ -69,6 +74,10 @@ protected:
   // using the input sensor calibration
   bool InitializationFromCalibration(vtkTable* calibration);
 
+  // Copy the channel of the range image written by the interpreter
+  // matching the selected array, if the frame has one of the same size
+  bool CopyRangeImage(vtkPolyData* input, unsigned char* dataPointer);
+
   // permutation to map laser index
   // from firing index to vertical
   // ordered index
@@ -0,0 +1,268 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "RangeImageDifference.h"
+#include "ParallelPoints.h"
+
+// VTK
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace
+{
+//! Azimuth unit of the sensors, in hundredths of degree
+const int AzimuthResolution = 36000;
+
+const float Infinity = std::numeric_limits<float>::infinity();
+
+//-----------------------------------------------------------------------------
+float GetRange(const double point[3])
+{
+  return static_cast<float>(
+    std::sqrt(point[0] * point[0] + point[1] * point[1] + point[2] * point[2]));
+}
+}
+
+//-----------------------------------------------------------------------------
+void RangeImageDifference::SetNumberOfColumns(int numberOfColumns)
+{
+  numberOfColumns = std::max(numberOfColumns, 1);
+  if (numberOfColumns != this->NumberOfColumns)
+  {
+    this->NumberOfColumns = numberOfColumns;
+    this->Reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void RangeImageDifference::Reset()
+{
+  const size_t numberOfPixels = static_cast<size_t>(this->NumberOfRows) * this->NumberOfColumns;
+  this->Ranges.assign(numberOfPixels, Infinity);
+  this->Points.assign(3 * numberOfPixels, 0.f);
+  this->Stamps.assign(numberOfPixels, 0);
+  this->Stamp = 0;
+  this->RowElevations.assign(this->NumberOfRows, std::numeric_limits<double>::quiet_NaN());
+  this->RowsBelow.resize(this->NumberOfRows);
+  this->RowsAbove.resize(this->NumberOfRows);
+  for (int row = 0; row < this->NumberOfRows; ++row)
+  {
+    this->RowsBelow[row] = row;
+    this->RowsAbove[row] = row;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void RangeImageDifference::MoveSensor(const double motion[16])
+{
+  const int width = this->NumberOfColumns;
+  const double columnAngle = 2. * vtkMath::Pi() / width;
+
+  // the lasers sorted by elevation, a return farther than half the mean gap between the
+  // lasers from the lowest and the highest ones leaves the image
+  std::vector<std::pair<double, int> > rows;
+  for (int row = 0; row < this->NumberOfRows; ++row)
+  {
+    if (!std::isnan(this->RowElevations[row]))
+    {
+      rows.push_back(std::make_pair(this->RowElevations[row], row));
+    }
+  }
+  if (rows.empty())
+  {
+    return;
+  }
+  std::sort(rows.begin(), rows.end());
+  const double margin =
+    rows.size() > 1 ? 0.5 * (rows.back().first - rows.front().first) / (rows.size() - 1) : 0.;
+
+  std::vector<float> ranges(this->Ranges.size(), Infinity);
+  std::vector<float> points(this->Points.size(), 0.f);
+  for (size_t pixel = 0; pixel < this->Ranges.size(); ++pixel)
+  {
+    if (this->Ranges[pixel] == Infinity)
+    {
+      continue;
+    }
+    const float* p = &this->Points[3 * pixel];
+    double q[3];
+    for (int i = 0; i < 3; ++i)
+    {
+      q[i] = motion[4 * i] * p[0] + motion[4 * i + 1] * p[1] + motion[4 * i + 2] * p[2] +
+        motion[4 * i + 3];
+    }
+
+    // the return keeps its laser, and moves by its change of azimuth so that the azimuth
+    // corrections of the lasers are kept
+    const double turn = std::atan2(p[0] * q[1] - p[1] * q[0], p[0] * q[0] + p[1] * q[1]);
+    const int shift =
+      static_cast<int>(std::lround((this->UseAzimuthArray ? -turn : turn) / columnAngle));
+    const int column = ((static_cast<int>(pixel % width) + shift) % width + width) % width;
+    const float range = GetRange(q);
+    const double elevation = std::asin(q[2] / range);
+    if (range <= 0.f || elevation < rows.front().first - margin ||
+      elevation > rows.back().first + margin)
+    {
+      continue;
+    }
+    auto above = std::lower_bound(rows.begin(), rows.end(), std::make_pair(elevation, -1));
+    if (above == rows.end() ||
+      (above != rows.begin() && elevation - (above - 1)->first < above->first - elevation))
+    {
+      --above;
+    }
+    const size_t target = static_cast<size_t>(above->second) * width + column;
+    if (range < ranges[target])
+    {
+      ranges[target] = range;
+      std::copy(q, q + 3, &points[3 * target]);
+    }
+  }
+  this->Ranges.swap(ranges);
+  this->Points.swap(points);
+}
+
+//-----------------------------------------------------------------------------
+bool RangeImageDifference::AddFrame(vtkPolyData* frame, unsigned char* motion, int numberOfThreads)
+{
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+  vtkDataArray* laserIdArray = frame->GetPointData()->GetArray("laser_id");
+  if (!laserIdArray)
+  {
+    return numberOfPoints == 0;
+  }
+  if (numberOfPoints == 0)
+  {
+    return true;
+  }
+
+  // a sensor with more lasers clears the image
+  vtkDataArray* azimuthArray = frame->GetPointData()->GetArray("azimuth");
+  const int numberOfRows = static_cast<int>(laserIdArray->GetRange(0)[1]) + 1;
+  if (numberOfRows > this->NumberOfRows || (azimuthArray != nullptr) != this->UseAzimuthArray)
+  {
+    this->NumberOfRows = std::max(numberOfRows, this->NumberOfRows);
+    this->UseAzimuthArray = azimuthArray != nullptr;
+    this->Reset();
+  }
+
+  const PointCoordinates coordinates(frame->GetPoints());
+  const ArrayComponent laserIds(laserIdArray);
+  const ArrayComponent azimuths(azimuthArray);
+  const int width = this->NumberOfColumns;
+  const double columnsPerRadian = width / (2. * vtkMath::Pi());
+  this->PixelOfPoint.resize(numberOfPoints);
+  int* pixelOfPoint = this->PixelOfPoint.data();
+  const float* previousRanges = this->Ranges.data();
+  const int* rowsBelow = this->RowsBelow.data();
+  const int* rowsAbove = this->RowsAbove.data();
+  const float rangeThreshold = static_cast<float>(this->RangeThreshold);
+  const float relativeRangeThreshold = static_cast<float>(this->RelativeRangeThreshold);
+
+  // each return is compared to the image of the previous frames, which is only read
+  ParallelFor(numberOfPoints, GetNumberOfPointRanges(numberOfThreads, numberOfPoints),
+    [&](size_t, size_t begin, size_t end) {
+      double point[3];
+      for (size_t k = begin; k < end; ++k)
+      {
+        coordinates.Get(k, point);
+        const float range = GetRange(point);
+        const int row = static_cast<int>(laserIds.Get(k));
+        if (range <= 0.f || row < 0)
+        {
+          pixelOfPoint[k] = -1;
+          motion[k] = 0;
+          continue;
+        }
+        int column = azimuthArray
+          ? static_cast<int>(azimuths.Get(k)) * width / AzimuthResolution
+          : static_cast<int>((std::atan2(point[1], point[0]) + vtkMath::Pi()) * columnsPerRadian);
+        column = std::min(std::max(column, 0), width - 1);
+        const int rowStart = row * width;
+        pixelOfPoint[k] = rowStart + column;
+
+        // the closest of the five ranges, an empty pixel being infinitely far
+        const float* ranges = previousRanges + rowStart;
+        const float difference = std::min(std::min(std::abs(range - ranges[column]),
+          std::min(std::abs(range - ranges[column > 0 ? column - 1 : width - 1]),
+            std::abs(range - ranges[column + 1 < width ? column + 1 : 0]))),
+          std::min(std::abs(range - previousRanges[rowsBelow[row] * width + column]),
+            std::abs(range - previousRanges[rowsAbove[row] * width + column])));
+        const float threshold = std::max(rangeThreshold, relativeRangeThreshold * range);
+        motion[k] = difference > threshold && difference != Infinity;
+      }
+    });
+
+  // the returns of this frame replace the returns of the previous frames in their pixels
+  if (++this->Stamp == 0)
+  {
+    std::fill(this->Stamps.begin(), this->Stamps.end(), 0);
+    this->Stamp = 1;
+  }
+  std::vector<double> elevationSums(this->NumberOfRows, 0.);
+  std::vector<vtkIdType> elevationCounts(this->NumberOfRows, 0);
+  double point[3];
+  for (vtkIdType k = 0; k < numberOfPoints; ++k)
+  {
+    const int pixel = pixelOfPoint[k];
+    if (pixel < 0)
+    {
+      continue;
+    }
+    coordinates.Get(k, point);
+    const float range = GetRange(point);
+    if (this->Stamps[pixel] != this->Stamp || range < this->Ranges[pixel])
+    {
+      this->Stamps[pixel] = this->Stamp;
+      this->Ranges[pixel] = range;
+      std::copy(point, point + 3, &this->Points[3 * pixel]);
+    }
+    const int row = pixel / width;
+    elevationSums[row] += std::asin(point[2] / range);
+    elevationCounts[row]++;
+  }
+
+  // the elevations of the lasers give their neighbors, and the rows where the returns
+  // move with the sensor
+  std::vector<std::pair<double, int> > rows;
+  for (int row = 0; row < this->NumberOfRows; ++row)
+  {
+    if (elevationCounts[row] > 0)
+    {
+      this->RowElevations[row] = elevationSums[row] / elevationCounts[row];
+    }
+    if (!std::isnan(this->RowElevations[row]))
+    {
+      rows.push_back(std::make_pair(this->RowElevations[row], row));
+    }
+  }
+  std::sort(rows.begin(), rows.end());
+  for (size_t i = 0; i < rows.size(); ++i)
+  {
+    this->RowsBelow[rows[i].second] = rows[i > 0 ? i - 1 : i].second;
+    this->RowsAbove[rows[i].second] = rows[i + 1 < rows.size() ? i + 1 : i].second;
+  }
+  return true;
+}
@@ -0,0 +1,104 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef RANGE_IMAGE_DIFFERENCE_H
+#define RANGE_IMAGE_DIFFERENCE_H
+
+// VTK
+#include <vtkPolyData.h>
+
+// STD
+#include <vector>
+
+/**
+ * \class RangeImageDifference
+ * \brief Change detection between consecutive lidar frames, much cheaper than the gaussian
+ *        mixtures of vtkSphericalMap. The last return seen in each pixel of the range image of
+ *        the sensor (laser_id, azimuth bin) is kept. A return is dynamic when its range differs
+ *        from the ranges of its pixel and of the two adjacent columns by more than
+ *        max(RangeThreshold, RelativeRangeThreshold * range). A return whose pixels have not
+ *        been seen yet is static.
+ *
+ *        The frames must be in the sensor reference frame. When the sensor moves, MoveSensor
+ *        expresses the image in the sensor reference frame of the next frame, each return
+ *        moving by its change of azimuth to another column, and to the row of the laser whose
+ *        elevation is the closest to its new elevation.
+ */
+class RangeImageDifference
+{
+public:
+  //! Number of azimuth bins of the image, the image is cleared when it changes
+  void SetNumberOfColumns(int numberOfColumns);
+  int GetNumberOfColumns() const { return this->NumberOfColumns; }
+
+  //! Smallest range difference of a dynamic return, in meters
+  double RangeThreshold = 0.5;
+
+  //! Smallest range difference of a dynamic return, relative to its range
+  double RelativeRangeThreshold = 0.05;
+
+  //! Forget the returns seen
+  void Reset();
+
+  /**
+   * @brief MoveSensor express the image in the sensor reference frame of the next frame
+   * @param motion row major transform from the sensor frame of the last frame added to the
+   * sensor frame of the next one
+   */
+  void MoveSensor(const double motion[16]);
+
+  /**
+   * @brief AddFrame flag the dynamic returns of a frame, or of a sector of a frame, then add its
+   * returns to the image
+   * @param frame lidar frame with a laser_id array, the azimuth array (in hundredths of degree)
+   * gives the columns when it is present
+   * @param motion[out] one value per point, 1 for a dynamic return
+   * @param numberOfThreads threads flagging the returns, one per core if it is 0 or less
+   * @return false if the frame has no laser_id array
+   */
+  bool AddFrame(vtkPolyData* frame, unsigned char* motion, int numberOfThreads = 0);
+
+private:
+  int NumberOfColumns = 2048;
+  int NumberOfRows = 0;
+
+  //! The columns are given by the azimuth array of the interpreters, which turns clockwise,
+  //! or by the coordinates, counterclockwise. The image is cleared when this changes.
+  bool UseAzimuthArray = false;
+
+  //! Range and coordinates of the closest return of each pixel of the last frame seen in the
+  //! pixel, the range is infinite if the pixel has no return
+  std::vector<float> Ranges;
+  std::vector<float> Points;
+
+  //! Mean elevation of the returns of each laser, in radians, NaN if the laser has no return
+  std::vector<double> RowElevations;
+
+  //! Laser just below and just above each laser, the laser itself if there is none
+  std::vector<int> RowsBelow;
+  std::vector<int> RowsAbove;
+
+  //! Frame which last wrote each pixel, so that the returns of a frame replace the returns of
+  //! the previous frames, and the closest return of the frame is kept
+  std::vector<unsigned int> Stamps;
+  unsigned int Stamp = 0;
+
+  //! Pixel of each point of the frame being added, -1 for the points without a return
+  std::vector<int> PixelOfPoint;
+};
+
+#endif // RANGE_IMAGE_DIFFERENCE_H
@@ -27,6 +27,9 @@
 =========================================================================*/
 
 #include "vtkMotionDetector.h"
+#include "TraceEvents.h"
+#include "vtkTemporalTransforms.h"
+#include "vtkVelodyneTransformInterpolator.h"
 
 #include <vtkDataSet.h>
 #include <vtkInformation.h>
@@ -44,6 +47,7 @@
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
 #include <vtkMath.h>
+#include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
@@ -62,6 +66,7 @@
 #include <vtkQuaternion.h>
 
 // STD
+#include <algorithm>
 #include <iostream>
 
 // Implementation of the New function
@@ -70,12 +75,16 @@ vtkStandardNewMacro(vtkMotionDetector)
 //----------------------------------------------------------------------------
 vtkMotionDetector::vtkMotionDetector()
 {
-  // One input port
-  this->SetNumberOfInputPorts(1);
+  // The frames and the optional trajectory
+  this->SetNumberOfInputPorts(2);
 
   // The accumulation of stabilized frames
   this->SetNumberOfOutputPorts(1);
 
+  // The gaussian mixtures by default
+  this->Mode = GAUSSIAN_MIXTURE;
+  this->InterpolatorTime = 0;
+
   // Initialize the intern parameters
   this->ResetAlgorithm();
 }
@@ -91,25 +100,138 @@ void vtkMotionDetector::ResetAlgorithm()
 {
   // reset the spherical map
   this->GaussianMap.ResetMap();
+
+  // reset the range image
+  this->RangeImage.Reset();
+  this->HasPreviousPose = false;
+}
+
+//----------------------------------------------------------------------------
+void vtkMotionDetector::SetMode(int mode)
+{
+  if (mode != this->Mode)
+  {
+    this->Mode = mode;
+    this->ResetAlgorithm();
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMotionDetector::SetRangeThreshold(double threshold)
+{
+  if (threshold != this->RangeImage.RangeThreshold)
+  {
+    this->RangeImage.RangeThreshold = threshold;
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMotionDetector::SetRelativeRangeThreshold(double threshold)
+{
+  if (threshold != this->RangeImage.RelativeRangeThreshold)
+  {
+    this->RangeImage.RelativeRangeThreshold = threshold;
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMotionDetector::SetNumberOfColumns(int numberOfColumns)
+{
+  if (numberOfColumns != this->RangeImage.GetNumberOfColumns())
+  {
+    this->RangeImage.SetNumberOfColumns(numberOfColumns);
+    this->Modified();
+  }
 }
 
 //-----------------------------------------------------------------------------
 void vtkMotionDetector::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "Mode: " << this->Mode << endl;
+  os << indent << "RangeThreshold: " << this->GetRangeThreshold() << endl;
+  os << indent << "RelativeRangeThreshold: " << this->GetRelativeRangeThreshold() << endl;
+  os << indent << "NumberOfColumns: " << this->GetNumberOfColumns() << endl;
+}
+
+//-----------------------------------------------------------------------------
+int vtkMotionDetector::FillInputPortInformation(int port, vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+  }
+  return 1;
 }
 
 //-----------------------------------------------------------------------------
 void vtkMotionDetector::AddFrame(vtkSmartPointer<vtkPolyData>& polydata)
 {
+  if (this->Mode == RANGE_DIFFERENCE)
+  {
+    // Compare the new points to the range image
+    vtkSmartPointer<vtkUnsignedCharArray> motion = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    motion->SetName("Motion");
+    motion->SetNumberOfTuples(polydata->GetNumberOfPoints());
+    if (this->RangeImage.AddFrame(polydata, motion->GetPointer(0)))
+    {
+      polydata->GetPointData()->AddArray(motion);
+    }
+    return;
+  }
+
   // Add the new points into the Gaussian Map
   this->GaussianMap.AddFrame(polydata);
 }
 
+//-----------------------------------------------------------------------------
+void vtkMotionDetector::MoveSensor(vtkInformationVector** inputVector)
+{
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation* trajectoryInfo = inputVector[1]->GetInformationObject(0);
+  if (!trajectoryInfo || !inInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    return;
+  }
+
+  vtkPolyData* trajectory = vtkPolyData::GetData(trajectoryInfo);
+  if (!this->Interpolator || trajectory->GetMTime() != this->InterpolatorTime)
+  {
+    this->Interpolator =
+      vtkTemporalTransforms::CreateFromPolyData(trajectory)->CreateInterpolator();
+    this->Interpolator->SetInterpolationTypeToLinear();
+    this->InterpolatorTime = trajectory->GetMTime();
+  }
+  if (this->Interpolator->GetNumberOfTransforms() == 0)
+  {
+    return;
+  }
+
+  // The pose of the frame, from the sensor to the world
+  double pose[16];
+  this->Interpolator->InterpolateTransformMatrix(
+    inInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()), pose);
+  if (this->HasPreviousPose)
+  {
+    // from the previous sensor frame to the world, then to the new sensor frame
+    double inverse[16], motion[16];
+    vtkMatrix4x4::Invert(pose, inverse);
+    vtkMatrix4x4::Multiply4x4(inverse, this->PreviousPose, motion);
+    this->RangeImage.MoveSensor(motion);
+  }
+  std::copy(pose, pose + 16, this->PreviousPose);
+  this->HasPreviousPose = true;
+}
+
 //-----------------------------------------------------------------------------
 int vtkMotionDetector::RequestData(vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkMotionDetector::RequestData");
   std::cout << "Motion Detector asked" << std::endl;
   // Get input data
   vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
@@ -118,6 +240,23 @@ int vtkMotionDetector::RequestData(vtkInformation *vtkNotUsed(request),
   vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
   output->ShallowCopy(input);
 
+  if (this->Mode == RANGE_DIFFERENCE)
+  {
+    // Compare the new points to the range image
+    // of the previous frames, seen from this frame
+    this->MoveSensor(inputVector);
+    vtkSmartPointer<vtkUnsignedCharArray> motion = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    motion->SetName("Motion");
+    motion->SetNumberOfTuples(output->GetNumberOfPoints());
+    if (!this->RangeImage.AddFrame(output, motion->GetPointer(0)))
+    {
+      vtkErrorMacro("The input has no laser_id array");
+      return 0;
+    }
+    output->GetPointData()->AddArray(motion);
+    return 1;
+  }
+
   // Add the new points into the Gaussian Map
   this->GaussianMap.AddFrame(output);
 
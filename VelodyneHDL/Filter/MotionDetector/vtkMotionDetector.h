@@ -30,6 +30,7 @@
 #define VTK_MOTION_DETECTOR_H
 
 // LOCAL
+#include "RangeImageDifference.h"
 #include "vtkSphericalMap.h"
 
 // STD
@@ -42,9 +43,18 @@
 #include <vtkPolyDataAlgorithm.h>
 #include <vtkSmartPointer.h>
 
+class vtkVelodyneTransformInterpolator;
+
 // EIGEN
 #include <Eigen/Dense>
 
+// Flag the points in motion of the lidar frames. The gaussian mixtures
+// of a spherical map give a Motion_Probability array, which is accurate
+// but costly. The range image difference compares each frame to the
+// previous ones and gives a Motion array (1 for a point in motion) in a
+// fraction of the time. The second input is an optional trajectory of
+// the sensor, used by the range image difference to follow the sensor,
+// the pose of a frame being interpolated at its time step.
 class VTK_EXPORT vtkMotionDetector : public vtkPolyDataAlgorithm
 {
 public:
@@ -52,6 +62,30 @@ public:
   vtkTypeMacro(vtkMotionDetector, vtkPolyDataAlgorithm)
   void PrintSelf(ostream& os, vtkIndent indent);
 
+  enum DetectionMode
+  {
+    GAUSSIAN_MIXTURE = 0,
+    RANGE_DIFFERENCE = 1
+  };
+
+  // Getter / Setter of the DetectionMode, the
+  // algorithm is reset when it changes
+  vtkGetMacro(Mode, int)
+  void SetMode(int mode);
+
+  // Getter / Setter of the smallest range difference
+  // of a point in motion, in meters and relative to
+  // its range. Used by the range image difference
+  double GetRangeThreshold() { return this->RangeImage.RangeThreshold; }
+  void SetRangeThreshold(double threshold);
+  double GetRelativeRangeThreshold() { return this->RangeImage.RelativeRangeThreshold; }
+  void SetRelativeRangeThreshold(double threshold);
+
+  // Getter / Setter of the number of azimuth bins
+  // of the range image
+  int GetNumberOfColumns() { return this->RangeImage.GetNumberOfColumns(); }
+  void SetNumberOfColumns(int numberOfColumns);
+
   // Add a frame to update the motion estimator
   void AddFrame(vtkSmartPointer<vtkPolyData>& polydata);
 
@@ -63,6 +97,8 @@ protected:
   vtkMotionDetector();
   ~vtkMotionDetector();
 
+  int FillInputPortInformation(int port, vtkInformation* info);
+
   int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *);
 
 private:
@@ -77,6 +113,25 @@ private:
   // Gaussian map correspond to the map of gaussian
   // distributions along the vertical and azimuth angles
   vtkSphericalMap GaussianMap;
+
+  // Detection mode, see DetectionMode
+  int Mode;
+
+  // Previous ranges seen in each direction,
+  // used by the range image difference
+  RangeImageDifference RangeImage;
+
+  // Express the range image in the sensor frame
+  // of the frame requested, using the trajectory
+  void MoveSensor(vtkInformationVector** inputVector);
+
+  // Poses of the trajectory, created again when
+  // the trajectory is modified, and the pose of
+  // the last frame added to the range image
+  vtkSmartPointer<vtkVelodyneTransformInterpolator> Interpolator;
+  vtkMTimeType InterpolatorTime;
+  double PreviousPose[16];
+  bool HasPreviousPose;
 };
 
 #endif // VTK_MOTION_DETECTOR_H
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "vtkSphericalMap.h"
+#include "LidarSectorAssembler.h"
 
 // VTK
 #include <vtkDataArray.h>
@@ -20,148 +21,25 @@
 #include <vtkUnsignedShortArray.h>
 #include <vtkPNGWriter.h>
 
-//----------------------------------------------------------------------------
-Gaussian::Gaussian()
-{
-  this->N = 0;
-  this->Sigma = 0.20; // 10 cm accuracy
-  this->MaxTTL = 25;
-  this->TTL = this->MaxTTL;
-}
-
-//----------------------------------------------------------------------------
-double Gaussian::operator()(double x)
-{
-  return 1.0 / (this->Sigma * sqrt(2 * vtkMath::Pi())) * exp(-std::pow(x - this->Mean, 2) / (2.0 * std::pow(this->Sigma, 2)));
-}
-
-//----------------------------------------------------------------------------
-void Gaussian::SetMean(double mean)
-{
-  this->Mean = mean;
-  this->N = 1;
-}
-
-//----------------------------------------------------------------------------
-double Gaussian::GetSigma()
-{
-  return this->Sigma;
-}
-
-//----------------------------------------------------------------------------
-void Gaussian::UpdateParam(double x)
-{
-  // update the mean
-  double oldMean = this->Mean;
-  this->Mean = (static_cast<double>(N) * this->Mean + x) / (static_cast<double>(N) + 1);
-
-  // update the standard deviation
-  this->Sigma = std::sqrt((this->N * std::pow(this->Sigma, 2) + (x - oldMean) * (x - this->Mean)) / (this->N + 1));
-
-  // reset the TTL to its maximum
-  this->TTL = this->MaxTTL;
-
-  // update the number of sample
-  this->N += 1;
-}
-
-//----------------------------------------------------------------------------
-bool Gaussian::UpdateTTL()
-{
-  this->TTL -= 1;
-  return (this->TTL >= 0);
-}
-
-//----------------------------------------------------------------------------
-GaussianMixture::GaussianMixture()
-{
-
-}
-
-//----------------------------------------------------------------------------
-double GaussianMixture::Evaluate(double x)
-{
-  if (this->Gaussians.size() == 0)
-  {
-    return 0.0;
-  }
-
-  double proba = 0;
-  for (std::list<Gaussian>::iterator it = this->Gaussians.begin(); it != this->Gaussians.end(); ++it)
-  {
-    // divide by the max
-    proba = std::max(proba, (*it)(x));
-  }
-
-  return proba;
-}
-
-//----------------------------------------------------------------------------
-double GaussianMixture::operator()(double x)
-{
-  return 1.0 / (this->sigma * sqrt(2 * vtkMath::Pi())) * exp(-std::pow(x - this->mean, 2) / (2.0 * std::pow(this->sigma, 2)));
-}
-
-//----------------------------------------------------------------------------
-void GaussianMixture::AddPoint(double x)
-{
-  double maxProba = 0.0;
-  std::list<Gaussian>::iterator itMaxProba;
-
-  // add the point to the right gaussian
-  for (std::list<Gaussian>::iterator it = this->Gaussians.begin(); it != this->Gaussians.end(); ++it)
-  {
-    double proba = (*it)(x);
-    if (proba > maxProba)
-    {
-      maxProba = proba;
-      itMaxProba = it;
-    }
-  }
-
-  double threshProb = 0.00135; // 3 sigma
-
-  // Create new gaussian
-  if (maxProba < threshProb)
-  {
-    // Create new gaussian, centered on x and with a starting
-    // sigma of 2cm (specific to velodyne sensors)
-    Gaussian newGaussian;
-    newGaussian.SetMean(x);
-    this->Gaussians.push_back(newGaussian);
-    return;
-  }
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
-  itMaxProba->UpdateParam(x);
-}
-
-//----------------------------------------------------------------------------
-void GaussianMixture::UpdateTTL()
-{
-  std::list<Gaussian>::iterator it = this->Gaussians.begin();
-  while (it != this->Gaussians.end())
-  {
-    // Get if the gaussian is still alive
-    bool stillAlive = it->UpdateTTL();
-
-    // erase the gaussian
-    if (!stillAlive)
-    {
-      // erase current iterator and get next on
-      it = this->Gaussians.erase(it);
-      // no need to increment iterator here
-    }
-    else
-    {
-      it++; // increment iterator here
-    }
-  }
-}
-
-//----------------------------------------------------------------------------
-unsigned int GaussianMixture::GetNumberOfPoints()
+namespace
 {
-  return this->Gaussians.size();
+//! Standard deviation of a new gaussian, 20 cm
+const float InitialVariance = 0.20f * 0.20f;
+//! Minimum variance of a gaussian, a depth which is always the same gives a null variance
+const float MinimumVariance = 1e-6f;
+//! Density under which a depth creates a new gaussian, 3 sigma
+const double ThresholdDensity = 0.00135;
+//! log(sqrt(2 pi)), removed from the log densities of the gaussians
+const double HalfLog2Pi = 0.5 * std::log(2.0 * vtkMath::Pi());
+//! Log density, without HalfLog2Pi, under which a depth creates a new gaussian
+const float ThresholdLogDensity = static_cast<float>(std::log(ThresholdDensity) + HalfLog2Pi);
+//! Azimuth unit of the sensors, in hundredths of degree
+const unsigned int AzimuthResolution = 36000;
 }
 
 //----------------------------------------------------------------------------
@@ -182,13 +60,12 @@ vtkSphericalMap::vtkSphericalMap()
   this->NPhi = 180;
   this->NTheta = static_cast<int>(std::floor(60.0 / (this->SensorRPM * 55.296 * 1e-6))); // around 904
 
-  // Base of R3
-  this->ez << 0, 0, 1;
-  this->ey << 0, 1, 0;
-  this->ex << 1, 0, 0;
+  // Gaussians removed after 25 frames without points
+  this->MaxTTL = 25;
 
-  // center
-  this->C << 0, 0, 0;
+  // The cells are computed from the coordinates
+  // until a frame has the sensor arrays
+  this->UseSensorBinning = false;
 
   // reset internal parameters
   this->ResetMap();
@@ -237,9 +114,15 @@ void vtkSphericalMap::ResetMap()
   this->dPhi = (this->PhiBounds[1] - this->PhiBounds[0]) / static_cast<double>(this->NPhi);
   this->dTheta = (this->ThetaBounds[1] - this->ThetaBounds[0]) / static_cast<double>(this->NTheta);
 
-  // reset the map
-  this->Map.clear();
-  this->Map.resize(this->NPhi * this->NTheta);
+  // reset the map, all the modes are empty
+  this->NSample = this->NPhi * this->NTheta;
+  const size_t numberOfModes = static_cast<size_t>(this->NSample) * MaximumNumberOfModes;
+  this->Means.assign(numberOfModes, 0.f);
+  this->Variances.assign(numberOfModes, 0.f);
+  this->InverseVariances.assign(numberOfModes, 0.f);
+  this->HalfLogVariances.assign(numberOfModes, std::numeric_limits<float>::infinity());
+  this->Counts.assign(numberOfModes, 0);
+  this->TTLs.assign(numberOfModes, -1);
 
   // reset internal parameters
   this->AddedFrames = 0;
@@ -250,62 +133,74 @@ void vtkSphericalMap::ResetMap()
 }
 
 //----------------------------------------------------------------------------
-Eigen::Matrix<double, 3, 1> vtkSphericalMap::GetSphericalCoordinates(const Eigen::Matrix<double, 3, 1>& X)
+void vtkSphericalMap::SetVariance(unsigned int mode, float variance)
+{
+  variance = std::max(variance, MinimumVariance);
+  this->Variances[mode] = variance;
+  this->InverseVariances[mode] = 1.f / variance;
+  this->HalfLogVariances[mode] = 0.5f * std::log(variance);
+}
+
+//----------------------------------------------------------------------------
+float vtkSphericalMap::UpdateCell(unsigned int cell, float depth)
 {
-  // Express the current point in the local
-  // reference frame designed by the internal
-  // base and origin
-  Eigen::Matrix<double, 3, 3> R;
-  R << this->ex(0), this->ey(0), this->ez(0),
-       this->ex(1), this->ey(1), this->ez(1),
-       this->ex(2), this->ey(2), this->ez(2);
-  Eigen::Matrix<double, 3, 1> CX = R.transpose() * (X - C);
-
-  // compute the vetor length
-  double r = CX.norm();
-
-  // If the vector is not null
-  // we normalized it
-  if (r > 1e-4)
+  const unsigned int first = cell * MaximumNumberOfModes;
+  const float* means = &this->Means[first];
+  const float* inverseVariances = &this->InverseVariances[first];
+  const float* halfLogVariances = &this->HalfLogVariances[first];
+
+  // log densities of the modes, without the constant term, -infinity for the empty modes
+  float logDensities[MaximumNumberOfModes];
+  for (unsigned int m = 0; m < MaximumNumberOfModes; ++m)
   {
-    CX.normalize();
+    const float d = depth - means[m];
+    logDensities[m] = -0.5f * d * d * inverseVariances[m] - halfLogVariances[m];
   }
+  unsigned int best = 0;
+  for (unsigned int m = 1; m < MaximumNumberOfModes; ++m)
+  {
+    best = logDensities[m] > logDensities[best] ? m : best;
+  }
+  const float density = std::exp(logDensities[best] - static_cast<float>(HalfLog2Pi));
 
-  // Project CX onto the (ex, ey) plane
-  Eigen::Matrix<double, 3, 1> projCX = CX.dot(this->ex) * this->ex + CX.dot(this->ey) * this->ey;
-  projCX.normalize();
-
-  // Compute Phi angle
-  double cosPhi = CX.dot(this->ez);
-  double sinPhi = CX.cross(this->ez).transpose() * CX.cross(this->ez).normalized();
-  double Phi = std::atan2(sinPhi, cosPhi);
-
-  // Compute theta angle
-  double cosTheta = projCX.dot(this->ex);
-  double sinTheta = projCX.cross(this->ex).dot(this->ey.cross(this->ex).normalized());
-  double Theta = std::atan2(sinTheta, cosTheta);
+  // the depth updates the most probable gaussian
+  if (logDensities[best] >= ThresholdLogDensity)
+  {
+    const unsigned int mode = first + best;
+    const float n = static_cast<float>(this->Counts[mode]);
+    const float oldMean = this->Means[mode];
+    this->Means[mode] = (n * oldMean + depth) / (n + 1.f);
+    this->SetVariance(mode, (n * this->Variances[mode] + (depth - oldMean) * (depth - this->Means[mode])) / (n + 1.f));
+    this->Counts[mode] += 1;
+    this->TTLs[mode] = this->MaxTTL;
+    return density;
+  }
 
-  Eigen::Matrix<double, 3, 1> sphericalCoords;
-  sphericalCoords << r, Theta, Phi;
-  return sphericalCoords;
+  // or creates a new one, centered on the depth, which replaces
+  // the gaussian updated the longest time ago if the cell is full
+  unsigned int mode = first;
+  for (unsigned int m = first + 1; m < first + MaximumNumberOfModes; ++m)
+  {
+    mode = this->TTLs[m] < this->TTLs[mode] ? m : mode;
+  }
+  this->Means[mode] = depth;
+  this->SetVariance(mode, InitialVariance);
+  this->Counts[mode] = 1;
+  this->TTLs[mode] = this->MaxTTL;
+  return density;
 }
 
 //----------------------------------------------------------------------------
 unsigned int vtkSphericalMap::GetNumberOfPoints()
 {
-  unsigned int nbrPoints = 0;
-  for (unsigned int k = 0; k < this->Map.size(); ++k)
-  {
-    nbrPoints += this->Map[k].GetNumberOfPoints();
-  }
-
-  return nbrPoints;
+  return static_cast<unsigned int>(
+    std::count_if(this->TTLs.begin(), this->TTLs.end(), [](int ttl) { return ttl >= 0; }));
 }
 
 //----------------------------------------------------------------------------
 void vtkSphericalMap::AddPoint(unsigned int idxTheta, unsigned int idxPhi, double valueDepth)
 {
-  if (idxTheta > this->NTheta || idxPhi > this->NPhi)
+  if (idxTheta >= this->NTheta || idxPhi >= this->NPhi)
   {
     std::cout << "Error, required values out of bounds" << std::endl;
     std::cout << "[" << idxTheta << "," << idxPhi << "] / [" << this->NTheta << "," << this->NPhi << "]" << std::endl;
@@ -313,72 +208,91 @@ void vtkSphericalMap::AddPoint(unsigned int idxTheta, unsigned int idxPhi, doubl
   }
 
   // fill the mixture gaussian
-  this->Map[idxTheta + this->NTheta * idxPhi].AddPoint(valueDepth);
+  this->UpdateCell(idxTheta + this->NTheta * idxPhi, static_cast<float>(valueDepth));
 }
 
 //----------------------------------------------------------------------------
- void vtkSphericalMap::AddFrame(vtkSmartPointer<vtkPolyData> polydata)
- {
-   vtkSmartPointer<vtkDoubleArray> Phi = vtkSmartPointer<vtkDoubleArray>::New();
-   vtkSmartPointer<vtkDoubleArray> Theta = vtkSmartPointer<vtkDoubleArray>::New();
-   vtkSmartPointer<vtkDoubleArray> Motion = vtkSmartPointer<vtkDoubleArray>::New();
-   Phi->SetName("Phi");
-   Theta->SetName("Theta");
-   Motion->SetName("Motion_Probability");
-
-   double point[3];
-   Eigen::Matrix<double, 3, 1> cartesianPoint;
-   Eigen::Matrix<double, 3, 1> sphericalPoint;
-
-   for (unsigned int k = 0; k < polydata->GetNumberOfPoints(); ++k)
-   {
-     // Get point and compute its spherical coordinates
-     polydata->GetPoint(k, point);
-     cartesianPoint << point[0], point[1], point[2];
-     sphericalPoint = this->GetSphericalCoordinates(cartesianPoint);
-
-     // Convert spherical coordinates to
-     // spherical map coordinates
-     unsigned int idxPhi = static_cast<int>(std::floor((sphericalPoint(2) - this->PhiBounds[0]) / this->dPhi));
-     unsigned int idxTheta = static_cast<int>(std::floor((sphericalPoint(1) - this->ThetaBounds[0]) / this->dTheta));
-
-     // Evaluate the mixture model on the current data
-     // it return the "probability" of the point to be
-     // a point in motion
-     double proba = this->Map[idxTheta + this->NTheta * idxPhi].Evaluate(sphericalPoint(0));
-
-     // Add the depth to the correct "pixel"
-     this->AddPoint(idxTheta, idxPhi, sphericalPoint(0));
-
-     double theta = this->ThetaBounds[0] + idxTheta * this->dTheta;
-     double phi = this->PhiBounds[0] + idxPhi * this->dPhi;
-     double r = sphericalPoint(0);
-
-     point[0] = r * std::sin(phi) * std::cos(theta);
-     point[1] = r * std::sin(phi) * std::sin(theta);
-     point[2] = r * std::cos(phi);
-     //polydata->GetPoints()->SetPoint(k, point);
-
-     Theta->InsertNextTuple1(sphericalPoint(1) * 180.0 / vtkMath::Pi());
-     Phi->InsertNextTuple1(sphericalPoint(2) * 180.0 / vtkMath::Pi());
-     Motion->InsertNextTuple1(proba);
-   }
-
-   // Time to live of the gaussians
-   this->UpdateTTL();
-
-   polydata->GetPointData()->AddArray(Phi);
-   polydata->GetPointData()->AddArray(Theta);
-   polydata->GetPointData()->AddArray(Motion);
-
-   this->AddedFrames += 1;
- }
-
- //----------------------------------------------------------------------------
- void vtkSphericalMap::UpdateTTL()
- {
-   for (unsigned int k = 0; k < this->Map.size(); ++k)
-   {
-     this->Map[k].UpdateTTL();
-   }
- }
+void vtkSphericalMap::AddFrame(vtkSmartPointer<vtkPolyData> polydata)
+{
+  const vtkIdType numberOfPoints = polydata->GetNumberOfPoints();
+  vtkSmartPointer<vtkDoubleArray> Motion = vtkSmartPointer<vtkDoubleArray>::New();
+  Motion->SetName("Motion_Probability");
+  Motion->SetNumberOfTuples(numberOfPoints);
+  double* motion = Motion->GetPointer(0);
+
+  // The lidar frames give the azimuth and the laser of each point, one
+  // row of the map by laser if there are enough rows
+  vtkUnsignedShortArray* azimuth =
+    vtkUnsignedShortArray::SafeDownCast(polydata->GetPointData()->GetArray("azimuth"));
+  vtkUnsignedCharArray* laserId =
+    vtkUnsignedCharArray::SafeDownCast(polydata->GetPointData()->GetArray("laser_id"));
+  const bool useSensorBinning = azimuth && laserId && (numberOfPoints == 0 ||
+    static_cast<unsigned int>(laserId->GetValueRange()[1]) < this->NPhi);
+  if (useSensorBinning != this->UseSensorBinning)
+  {
+    this->UseSensorBinning = useSensorBinning;
+    this->ResetMap();
+  }
+  const unsigned short* azimuthValues = useSensorBinning ? azimuth->GetPointer(0) : nullptr;
+  const unsigned char* laserIdValues = useSensorBinning ? laserId->GetPointer(0) : nullptr;
+
+  double point[3];
+  for (vtkIdType k = 0; k < numberOfPoints; ++k)
+  {
+    polydata->GetPoint(k, point);
+    const double rho2 = point[0] * point[0] + point[1] * point[1];
+    const double r = std::sqrt(rho2 + point[2] * point[2]);
+
+    // Convert the point to spherical map coordinates
+    unsigned int idxTheta, idxPhi;
+    if (useSensorBinning)
+    {
+      idxTheta = azimuthValues[k] * this->NTheta / AzimuthResolution;
+      idxPhi = laserIdValues[k];
+    }
+    else
+    {
+      const double theta = std::atan2(point[1], point[0]);
+      const double phi = std::atan2(std::sqrt(rho2), point[2]);
+      idxTheta = static_cast<unsigned int>(std::max(0.0, (theta - this->ThetaBounds[0]) / this->dTheta));
+      idxPhi = static_cast<unsigned int>(std::max(0.0, (phi - this->PhiBounds[0]) / this->dPhi));
+    }
+    idxTheta = std::min(idxTheta, this->NTheta - 1);
+    idxPhi = std::min(idxPhi, this->NPhi - 1);
+
+    // Evaluate the mixture model on the current data,
+    // it return the "probability" of the point to be
+    // a point in motion, and add the depth to the
+    // correct "pixel"
+    motion[k] = this->UpdateCell(idxTheta + this->NTheta * idxPhi, static_cast<float>(r));
+  }
+
+  polydata->GetPointData()->AddArray(Motion);
+
+  // The sectors of a live stream are added as they come, the time to live of the
+  // gaussians is counted in rotations so it is only updated by the last sector
+  if (LidarSectorAssembler::IsPartialFrame(polydata))
+  {
+    return;
+  }
+
+  // Time to live of the gaussians
+  this->UpdateTTL();
+
+  this->AddedFrames += 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkSphericalMap::UpdateTTL()
+{
+  for (size_t mode = 0; mode < this->TTLs.size(); ++mode)
+  {
+    // empty the gaussians which are too old
+    if (this->TTLs[mode] >= 0 && --this->TTLs[mode] < 0)
+    {
+      this->InverseVariances[mode] = 0.f;
+      this->HalfLogVariances[mode] = std::numeric_limits<float>::infinity();
+      this->Counts[mode] = 0;
+    }
+  }
+}
@@ -30,95 +30,25 @@
 #define VTK_SPHERICAL_MAP_H
 
 // VTK
-#include <vtkMath.h>
 #include <vtkPolyData.h>
-#include <vtkPolyDataAlgorithm.h>
 #include <vtkSmartPointer.h>
 
-// EIGEN
-#include <Eigen/Dense>
-
 // STD
+#include <string>
 #include <vector>
-#include <cmath>
-#include <list>
-
-class Gaussian
-{
-public:
-  Gaussian();
-  double operator()(double x);
-
-  // set the mean
-  void SetMean(double mean);
-
-  // update parameters using new value
-  void UpdateParam(double x);
-
-  // Update the time to live
-  // return false if ttl falls
-  // to zero value
-  bool UpdateTTL();
-
-  // return sigma value
-  double GetSigma();
-
-private:
-  // mean of the gaussian
-  double Mean;
-
-  // standard deviation of the gaussian
-  double Sigma;
-
-  // number of points
-  unsigned int N;
-
-  // Time to live of the gaussian
-  int TTL;
-
-  // Maximum number of the TTL
-  int MaxTTL;
-};
-
-class GaussianMixture
-{
-public:
-  // default constructor
-  GaussianMixture();
-
-  // Evaluation
-  double operator()(double x);
-
-  // Add a data
-  void AddPoint(double x);
-
-  // return the number of points
-  unsigned int GetNumberOfPoints();
-
-  // Update the time to live
-  // of the gaussians composing
-  // the gaussian mixture model
-  void UpdateTTL();
-
-  // Evaluate the probability
-  // of a point to be in motion
-  double Evaluate(double x);
-
-private:
-  // mean of the gaussian
-  double mean;
-
-  // standard deviation of the gaussian
-  double sigma;
-
-  // points in the distribution
-  std::list<Gaussian> Gaussians;
-};
-
 
+// Background model of the depth seen by the sensor in each direction. The
+// directions are binned in a (theta, phi) map, each cell holding a mixture
+// of at most MaximumNumberOfModes gaussians. The parameters of the gaussians
+// are stored per component in flat arrays, the modes of a cell being
+// contiguous, so that the modes of a cell are evaluated together without
+// branches. A gaussian which has not been updated for MaxTTL frames is removed
 class vtkSphericalMap
 {
 public:
+  //! Number of gaussians of a cell
+  static const unsigned int MaximumNumberOfModes = 4;
+
   // default constructor
   vtkSphericalMap();
 
@@ -135,13 +65,17 @@ public:
   void ResetMap();
 
   // Add a frame to map in the spherical map and
-  // update the map using the new input data
+  // update the map using the new input data.
+  // The sectors of a frame can be added one by one.
+  // The cells of the points are given by the azimuth
+  // and laser_id arrays of a lidar frame, or computed
+  // from the coordinates when these arrays are missing
   void AddFrame(vtkSmartPointer<vtkPolyData> polydata);
 
   // Add a point to the corresponding pixel
   void AddPoint(unsigned int idxTheta, unsigned int idxPhi, double valueDepth);
 
-  // Get the total number of Points stored
+  // Get the total number of gaussians stored
   unsigned int GetNumberOfPoints();
 
   // Update the TTL of the gaussians mixtures
@@ -184,22 +118,32 @@ private:
   // processed by the algorithm
   unsigned int AddedFrames;
 
-  // The spherical map
-  std::vector<GaussianMixture> Map;
+  // Indicate if the cells are given by the
+  // azimuth and laser_id arrays, the map is
+  // reset when this changes
+  bool UseSensorBinning;
+
+  // Gaussians of the map, the modes of the cell k
+  // are at [k * MaximumNumberOfModes, (k + 1) * MaximumNumberOfModes[.
+  // An empty mode has a negative TTL, an infinite
+  // HalfLogVariance and a null InverseVariance so
+  // that its log density is -infinity
+  std::vector<float> Means;
+  std::vector<float> Variances;
+  std::vector<float> InverseVariances;
+  std::vector<float> HalfLogVariances;
+  std::vector<unsigned int> Counts;
+  std::vector<int> TTLs;
 
-  // Base of R3 used. in some
-  // case it can be changed
-  Eigen::Matrix<double, 3, 1> ez;
-  Eigen::Matrix<double, 3, 1> ey;
-  Eigen::Matrix<double, 3, 1> ex;
+  // Maximum number of the TTL
+  int MaxTTL;
 
-  // Center of the coordinate system
-  // using the ex, ey, ez base
-  Eigen::Matrix<double, 3, 1> C;
+  // Update the mixture of a cell with a depth and
+  // return the density of the depth before the update
+  float UpdateCell(unsigned int cell, float depth);
 
-  // Convert cartesian coordinates of X point in its
-  // spherical coordinates
-  Eigen::Matrix<double, 3, 1> GetSphericalCoordinates(const Eigen::Matrix<double, 3, 1>& X);
+  // Set the parameters of a mode from its variance
+  void SetVariance(unsigned int mode, float variance);
 
   // export as images parameters
   bool ShouldExportAsImage;
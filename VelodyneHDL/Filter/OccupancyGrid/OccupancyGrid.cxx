@@ -0,0 +1,314 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "OccupancyGrid.h"
+#include "ParallelPoints.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+//! Update of a voxel by a frame
+enum Update : unsigned char
+{
+  NO_UPDATE = 0,
+  MISS = 1,
+  HIT = 2
+};
+
+//! Points of which a thread traces the rays at least
+const size_t MinimumPointsPerThread = 1024;
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::Resize(double resolution, int horizontalSize, int verticalSize)
+{
+  this->Resolution = resolution;
+  this->Size[0] = this->Size[1] = std::max(horizontalSize, 1);
+  this->Size[2] = std::max(verticalSize, 1);
+  const size_t numberOfColumns = static_cast<size_t>(this->Size[0]) * this->Size[1];
+  this->LogOdds.assign(numberOfColumns * this->Size[2], 0.f);
+  this->MinimumElevation.assign(numberOfColumns, std::numeric_limits<float>::quiet_NaN());
+  this->MaximumElevation.assign(numberOfColumns, std::numeric_limits<float>::quiet_NaN());
+  this->Updates.assign(this->LogOdds.size(), NO_UPDATE);
+  this->NumberOfUpdatedVoxels = 0;
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::Clear()
+{
+  std::fill(this->LogOdds.begin(), this->LogOdds.end(), 0.f);
+  std::fill(this->MinimumElevation.begin(), this->MinimumElevation.end(),
+            std::numeric_limits<float>::quiet_NaN());
+  std::fill(this->MaximumElevation.begin(), this->MaximumElevation.end(),
+            std::numeric_limits<float>::quiet_NaN());
+  this->NumberOfUpdatedVoxels = 0;
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::GetOrigin(double origin[3]) const
+{
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    origin[axis] = this->Position[axis] * this->Resolution;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::Recenter(const double position[3])
+{
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    const int first =
+      static_cast<int>(std::floor(position[axis] / this->Resolution)) - this->Size[axis] / 2;
+    if (first != this->Position[axis])
+    {
+      this->Shift(axis, first - this->Position[axis]);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::Shift(int axis, int steps)
+{
+  // once the whole grid is cleared, the remaining steps only move it, they are
+  // done first so that the slices cleared are the ones of the final grid
+  const int numberOfSlices = std::min(std::abs(steps), this->Size[axis]);
+  const int direction = steps < 0 ? -1 : 1;
+  this->Position[axis] += steps - direction * numberOfSlices;
+  const int u = (axis + 1) % 3, v = (axis + 2) % 3;
+  for (int n = 0; n < numberOfSlices; ++n)
+  {
+    this->Position[axis] += direction;
+    // the slice entering the grid is stored where the one leaving it was
+    int cell[3] = { 0, 0, 0 };
+    cell[axis] = direction < 0 ? 0 : this->Size[axis] - 1;
+    for (cell[u] = 0; cell[u] < this->Size[u]; ++cell[u])
+    {
+      for (cell[v] = 0; cell[v] < this->Size[v]; ++cell[v])
+      {
+        this->LogOdds[this->GetVoxelIndex(cell[0], cell[1], cell[2])] = 0.f;
+      }
+    }
+    // the columns only change with the horizontal axes
+    if (axis != 2)
+    {
+      int column[2] = { 0, 0 };
+      column[axis] = cell[axis];
+      for (column[1 - axis] = 0; column[1 - axis] < this->Size[1 - axis]; ++column[1 - axis])
+      {
+        const size_t index = this->GetColumnIndex(column[0], column[1]);
+        this->MinimumElevation[index] = std::numeric_limits<float>::quiet_NaN();
+        this->MaximumElevation[index] = std::numeric_limits<float>::quiet_NaN();
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::TraceRays(const double origin[3], const float* points, size_t begin,
+                              size_t end, std::vector<size_t>& misses,
+                              std::vector<long long>& hits) const
+{
+  // the rays are traversed voxel by voxel, in the unit of the cells relatively to the grid
+  double start[3];
+  int startVoxel[3];
+  bool startIsInside = true;
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    start[axis] = origin[axis] / this->Resolution - this->Position[axis];
+    startVoxel[axis] = static_cast<int>(std::floor(start[axis]));
+    startIsInside &= startVoxel[axis] >= 0 && startVoxel[axis] < this->Size[axis];
+  }
+
+  for (size_t p = begin; p < end; ++p)
+  {
+    int voxel[3], endVoxel[3], step[3];
+    double next[3], delta[3];
+    bool endIsInside = true;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      const double target = points[3 * p + axis] / this->Resolution - this->Position[axis];
+      endVoxel[axis] = static_cast<int>(std::floor(target));
+      endIsInside &= endVoxel[axis] >= 0 && endVoxel[axis] < this->Size[axis];
+      voxel[axis] = startVoxel[axis];
+      const double direction = target - start[axis];
+      step[axis] = direction > 0. ? 1 : -1;
+      // parameters along the ray, from 0 to 1, where it enters the next voxel of the axis
+      // and where it crosses a whole voxel of the axis
+      if (direction == 0.)
+      {
+        next[axis] = delta[axis] = std::numeric_limits<double>::infinity();
+      }
+      else
+      {
+        next[axis] = (voxel[axis] + (step[axis] > 0 ? 1 : 0) - start[axis]) / direction;
+        delta[axis] = std::abs(1. / direction);
+      }
+    }
+    hits[p] = endIsInside ?
+      static_cast<long long>(this->GetVoxelIndex(endVoxel[0], endVoxel[1], endVoxel[2])) : -1;
+
+    // a ray which starts out of the grid never enters it, the sensor being inside the grid
+    if (!startIsInside)
+    {
+      continue;
+    }
+    while (voxel[0] != endVoxel[0] || voxel[1] != endVoxel[1] || voxel[2] != endVoxel[2])
+    {
+      misses.push_back(this->GetVoxelIndex(voxel[0], voxel[1], voxel[2]));
+      const int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+      // the rounding errors must not make the ray go past its end
+      if (next[axis] > 1.)
+      {
+        break;
+      }
+      voxel[axis] += step[axis];
+      next[axis] += delta[axis];
+      // a ray leaving the grid never enters it again
+      if (voxel[axis] < 0 || voxel[axis] >= this->Size[axis])
+      {
+        break;
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::Insert(const double origin[3], const float* points, size_t numberOfPoints)
+{
+  this->NumberOfUpdatedVoxels = 0;
+  if (this->LogOdds.empty() || numberOfPoints == 0)
+  {
+    return;
+  }
+
+  // the rays are traced in parallel, each range listing the voxels it crosses
+  const int numberOfRanges = std::max(1, static_cast<int>(std::min<size_t>(
+    GetNumberOfThreads(this->NumberOfThreads), numberOfPoints / MinimumPointsPerThread)));
+  if (this->Hits.size() < numberOfPoints)
+  {
+    this->Hits.resize(numberOfPoints);
+  }
+  this->Misses.resize(numberOfRanges);
+  for (std::vector<size_t>& rangeMisses : this->Misses)
+  {
+    rangeMisses.clear();
+  }
+  std::vector<long long>& hits = this->Hits;
+  ParallelFor(numberOfPoints, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    this->TraceRays(origin, points, begin, end, this->Misses[range], hits);
+  });
+
+  // each voxel is updated once, a hit taking precedence over the misses
+  this->UpdatedVoxels.clear();
+  for (const std::vector<size_t>& rangeMisses : this->Misses)
+  {
+    for (size_t index : rangeMisses)
+    {
+      if (this->Updates[index] == NO_UPDATE)
+      {
+        this->Updates[index] = MISS;
+        this->UpdatedVoxels.push_back(index);
+      }
+    }
+  }
+  for (size_t p = 0; p < numberOfPoints; ++p)
+  {
+    if (hits[p] >= 0)
+    {
+      unsigned char& update = this->Updates[static_cast<size_t>(hits[p])];
+      if (update == NO_UPDATE)
+      {
+        this->UpdatedVoxels.push_back(static_cast<size_t>(hits[p]));
+      }
+      update = HIT;
+    }
+  }
+  for (size_t index : this->UpdatedVoxels)
+  {
+    const float change = this->Updates[index] == HIT ? this->HitLogOdds : this->MissLogOdds;
+    this->LogOdds[index] =
+      std::min(this->MaximumLogOdds, std::max(this->MinimumLogOdds, this->LogOdds[index] + change));
+    this->Updates[index] = NO_UPDATE;
+  }
+  this->NumberOfUpdatedVoxels = this->UpdatedVoxels.size();
+
+  // the elevations of the columns, from all the points above them
+  for (size_t p = 0; p < numberOfPoints; ++p)
+  {
+    const int i = static_cast<int>(std::floor(points[3 * p] / this->Resolution)) - this->Position[0];
+    const int j = static_cast<int>(std::floor(points[3 * p + 1] / this->Resolution)) - this->Position[1];
+    if (i < 0 || i >= this->Size[0] || j < 0 || j >= this->Size[1])
+    {
+      continue;
+    }
+    const size_t column = this->GetColumnIndex(i, j);
+    const float z = points[3 * p + 2];
+    // the comparisons with NaN are false, so an unknown column takes the first point
+    if (!(this->MinimumElevation[column] <= z))
+    {
+      this->MinimumElevation[column] = z;
+    }
+    if (!(this->MaximumElevation[column] >= z))
+    {
+      this->MaximumElevation[column] = z;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::GetOccupancy(float* probabilities) const
+{
+  for (int k = 0; k < this->Size[2]; ++k)
+  {
+    for (int j = 0; j < this->Size[1]; ++j)
+    {
+      for (int i = 0; i < this->Size[0]; ++i)
+      {
+        *probabilities++ = 1.f - 1.f / (1.f + std::exp(this->GetLogOdds(i, j, k)));
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void OccupancyGrid::GetElevations(float* minimum, float* maximum) const
+{
+  for (int j = 0; j < this->Size[1]; ++j)
+  {
+    for (int i = 0; i < this->Size[0]; ++i)
+    {
+      const size_t column = this->GetColumnIndex(i, j);
+      *minimum++ = this->MinimumElevation[column];
+      *maximum++ = this->MaximumElevation[column];
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+size_t OccupancyGrid::GetMemorySize() const
+{
+  return this->LogOdds.capacity() * sizeof(float) +
+    (this->MinimumElevation.capacity() + this->MaximumElevation.capacity()) * sizeof(float) +
+    this->Updates.capacity() + this->UpdatedVoxels.capacity() * sizeof(size_t) +
+    this->Hits.capacity() * sizeof(long long);
+}
@@ -0,0 +1,144 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+// STD
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief OccupancyGrid an occupancy grid of cubic cells following the sensor, made of a
+ * probabilistic 3D voxel grid and of a 2.5D elevation map of its columns. The frames are
+ * inserted incrementally: the ray from the sensor to each point frees the voxels it crosses
+ * and occupies the voxel of the point, each voxel being updated once per frame, the hits
+ * taking precedence. The occupancy of a voxel is kept as log odds, clamped so that it
+ * changes quickly when the scene does. The rays are traced by several threads.
+ *
+ * As the slam RollingGrid, the grid is circular: a cell of the world is stored at its world
+ * index modulo the size of the grid, so moving the grid only moves its position and clears
+ * the slices which enter it, in place of the ones which leave it.
+ */
+class OccupancyGrid
+{
+public:
+  //! Log odds added to a voxel containing a point, and to a voxel crossed by a ray
+  float HitLogOdds = 0.85f;
+  float MissLogOdds = -0.4f;
+  //! Bounds of the log odds of a voxel
+  float MinimumLogOdds = -2.f;
+  float MaximumLogOdds = 3.5f;
+  //! Number of threads tracing the rays, 0 uses one thread per core
+  int NumberOfThreads = 0;
+
+  /**
+   * @brief Resize clear the grid and set its geometry
+   * @param resolution size of the cells
+   * @param horizontalSize number of cells along x and y
+   * @param verticalSize number of cells along z
+   */
+  void Resize(double resolution, int horizontalSize, int verticalSize);
+
+  //! Forget the occupancy and the elevations, the grid position is kept
+  void Clear();
+
+  //! Move the grid so that position is at its center, the cells entering the grid are unknown
+  void Recenter(const double position[3]);
+
+  /**
+   * @brief Insert add a frame to the grid
+   * @param origin position of the sensor when the frame was acquired
+   * @param points coordinates of the points, interleaved
+   */
+  void Insert(const double origin[3], const float* points, size_t numberOfPoints);
+
+  double GetResolution() const { return this->Resolution; }
+  int GetSize(int axis) const { return this->Size[axis]; }
+
+  //! World position of the corner of the first cell of the grid
+  void GetOrigin(double origin[3]) const;
+
+  //! Log odds of the voxel i, j, k relatively to the grid position, 0 if unknown
+  float GetLogOdds(int i, int j, int k) const { return this->LogOdds[this->GetVoxelIndex(i, j, k)]; }
+
+  //! Lowest and highest point of the column i, j since it entered the grid, NaN if unknown
+  float GetMinimumElevation(int i, int j) const { return this->MinimumElevation[this->GetColumnIndex(i, j)]; }
+  float GetMaximumElevation(int i, int j) const { return this->MaximumElevation[this->GetColumnIndex(i, j)]; }
+
+  /**
+   * @brief GetOccupancy write the probability of occupancy of the voxels, 0.5 if unknown,
+   * in the order of the grid from its origin, x first
+   */
+  void GetOccupancy(float* probabilities) const;
+
+  //! Write the elevations of the columns in the order of the grid from its origin, x first
+  void GetElevations(float* minimum, float* maximum) const;
+
+  //! Number of voxels which have been updated by the last frame
+  size_t GetNumberOfUpdatedVoxels() const { return this->NumberOfUpdatedVoxels; }
+
+  //! Memory used by the grid, in bytes
+  size_t GetMemorySize() const;
+
+private:
+  //! index in the grid of the cell at position i, j, k relatively to the grid position
+  size_t GetVoxelIndex(int i, int j, int k) const
+  {
+    return this->GetColumnIndex(i, j) * this->Size[2] + this->Wrap(this->Position[2] + k, 2);
+  }
+  size_t GetColumnIndex(int i, int j) const
+  {
+    return static_cast<size_t>(this->Wrap(this->Position[0] + i, 0)) * this->Size[1] +
+      this->Wrap(this->Position[1] + j, 1);
+  }
+
+  //! world index modulo the size of the grid along an axis
+  int Wrap(int index, int axis) const
+  {
+    const int wrapped = index % this->Size[axis];
+    return wrapped < 0 ? wrapped + this->Size[axis] : wrapped;
+  }
+
+  //! move the grid along an axis, and clear the slices which enter it
+  void Shift(int axis, int steps);
+
+  //! Append to misses the voxels crossed by the rays to the points of [begin, end[, the
+  //! voxel of a point excluded, and set the voxel of each point in hits, -1 if out of the grid
+  void TraceRays(const double origin[3], const float* points, size_t begin, size_t end,
+                 std::vector<size_t>& misses, std::vector<long long>& hits) const;
+
+  double Resolution = 0.2;
+  int Size[3] = { 0, 0, 0 };
+  //! World index of the first cell of the grid
+  int Position[3] = { 0, 0, 0 };
+
+  std::vector<float> LogOdds;
+  std::vector<float> MinimumElevation;
+  std::vector<float> MaximumElevation;
+
+  //! Update of each voxel by the frame being inserted, and the voxels updated
+  std::vector<unsigned char> Updates;
+  std::vector<size_t> UpdatedVoxels;
+  size_t NumberOfUpdatedVoxels = 0;
+  //! Voxel hit by each point and voxels missed by the rays of each range, for the frame being
+  //! inserted. They are kept from a frame to the next, the hits only growing.
+  std::vector<long long> Hits;
+  std::vector<std::vector<size_t>> Misses;
+};
+
+#endif // OCCUPANCY_GRID_H
@@ -0,0 +1,270 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkOccupancyGrid.h"
+#include "TraceEvents.h"
+#include "vtkTemporalTransforms.h"
+#include "vtkVelodyneTransformInterpolator.h"
+
+// STD
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// VTK
+#include <vtkFloatArray.h>
+#include <vtkImageData.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+float LogOdds(double probability)
+{
+  return static_cast<float>(std::log(probability / (1. - probability)));
+}
+}
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkOccupancyGrid)
+
+//-----------------------------------------------------------------------------
+vtkOccupancyGrid::vtkOccupancyGrid()
+{
+  this->SetNumberOfInputPorts(2);
+  this->SetNumberOfOutputPorts(2);
+  this->Grid.Resize(this->Resolution, this->HorizontalSize, this->VerticalSize);
+  this->Reset();
+}
+
+//-----------------------------------------------------------------------------
+vtkOccupancyGrid::~vtkOccupancyGrid() = default;
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGrid::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Resolution: " << this->Resolution << std::endl;
+  os << indent << "HorizontalSize: " << this->HorizontalSize << std::endl;
+  os << indent << "VerticalSize: " << this->VerticalSize << std::endl;
+  os << indent << "HitProbability: " << this->HitProbability << std::endl;
+  os << indent << "MissProbability: " << this->MissProbability << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGrid::SetResolution(double resolution)
+{
+  if (this->Resolution != resolution && resolution > 0.)
+  {
+    this->Resolution = resolution;
+    this->Grid.Resize(this->Resolution, this->HorizontalSize, this->VerticalSize);
+    this->Reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGrid::SetHorizontalSize(int size)
+{
+  if (this->HorizontalSize != size && size > 0)
+  {
+    this->HorizontalSize = size;
+    this->Grid.Resize(this->Resolution, this->HorizontalSize, this->VerticalSize);
+    this->Reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGrid::SetVerticalSize(int size)
+{
+  if (this->VerticalSize != size && size > 0)
+  {
+    this->VerticalSize = size;
+    this->Grid.Resize(this->Resolution, this->HorizontalSize, this->VerticalSize);
+    this->Reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGrid::Reset()
+{
+  this->Grid.Clear();
+  this->LastInputMTime = 0;
+  this->LastInputTime = std::numeric_limits<double>::lowest();
+  this->Memory.Set(static_cast<unsigned long>(this->Grid.GetMemorySize() / 1024));
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkOccupancyGrid::FillInputPortInformation(int port, vtkInformation *info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  if (port == 1)
+  {
+    info->Set(vtkAlgorithm::INPUT_IS_OPTIONAL(), 1);
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkOccupancyGrid::FillOutputPortInformation(int vtkNotUsed(port), vtkInformation *info)
+{
+  info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkImageData");
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkOccupancyGrid::RequestInformation(vtkInformation *vtkNotUsed(request),
+                                         vtkInformationVector **vtkNotUsed(inputVector),
+                                         vtkInformationVector *outputVector)
+{
+  const double spacing[3] = { this->Resolution, this->Resolution, this->Resolution };
+  for (int port = 0; port < 2; ++port)
+  {
+    vtkInformation* outInfo = outputVector->GetInformationObject(port);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),
+                 0, this->HorizontalSize - 1,
+                 0, this->HorizontalSize - 1,
+                 0, port == 0 ? 0 : this->VerticalSize - 1);
+    outInfo->Set(vtkDataObject::SPACING(), spacing, 3);
+    vtkDataObject::SetPointDataActiveScalarInfo(outInfo, VTK_FLOAT, 1);
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkOccupancyGrid::GetSensorPosition(vtkInformationVector** inputVector, bool hasTime,
+                                         double time, double position[3])
+{
+  vtkPolyData* trajectory = inputVector[1]->GetNumberOfInformationObjects() > 0 ?
+    vtkPolyData::GetData(inputVector[1]->GetInformationObject(0)) : nullptr;
+  if (!trajectory || trajectory->GetNumberOfPoints() == 0 || !hasTime)
+  {
+    std::copy(this->SensorPosition, this->SensorPosition + 3, position);
+    return;
+  }
+
+  // the interpolator is only created again when the trajectory changes, as it grows with the slam
+  if (!this->Interpolator || trajectory->GetMTime() != this->InterpolatorMTime)
+  {
+    this->Interpolator = vtkTemporalTransforms::CreateFromPolyData(trajectory)->CreateInterpolator();
+    this->Interpolator->SetInterpolationTypeToLinear();
+    this->InterpolatorMTime = trajectory->GetMTime();
+  }
+  double matrix[16];
+  this->Interpolator->InterpolateTransformMatrix(time, matrix);
+  for (int i = 0; i < 3; ++i)
+  {
+    position[i] = matrix[4 * i + 3];
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkOccupancyGrid::RequestData(vtkInformation *vtkNotUsed(request),
+                                  vtkInformationVector **inputVector,
+                                  vtkInformationVector *outputVector)
+{
+  VV_TRACE_SCOPE("vtkOccupancyGrid::RequestData");
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkImageData* elevation = vtkImageData::GetData(outputVector->GetInformationObject(0));
+  vtkImageData* volume = vtkImageData::GetData(outputVector->GetInformationObject(1));
+
+  // Going back in time clears the grid, an input which has not
+  // changed since the last frame is not inserted again
+  const bool hasTime = input->GetInformation()->Has(vtkDataObject::DATA_TIME_STEP());
+  const double time = hasTime ? input->GetInformation()->Get(vtkDataObject::DATA_TIME_STEP()) : 0.;
+  if (hasTime && time < this->LastInputTime)
+  {
+    this->Reset();
+  }
+  if (input->GetMTime() != this->LastInputMTime || (hasTime && time != this->LastInputTime))
+  {
+    this->LastInputMTime = input->GetMTime();
+    this->LastInputTime = hasTime ? time : this->LastInputTime;
+
+    double sensor[3];
+    this->GetSensorPosition(inputVector, hasTime, time, sensor);
+    this->Grid.HitLogOdds = LogOdds(this->HitProbability);
+    this->Grid.MissLogOdds = LogOdds(this->MissProbability);
+    this->Grid.NumberOfThreads = this->NumberOfThreads;
+    this->Grid.Recenter(sensor);
+
+    // the rays are traced from float coordinates, copied when the points are not floats
+    vtkPoints* points = input->GetPoints();
+    if (points && points->GetNumberOfPoints() > 0)
+    {
+      const size_t numberOfPoints = static_cast<size_t>(points->GetNumberOfPoints());
+      vtkFloatArray* data = vtkFloatArray::SafeDownCast(points->GetData());
+      std::vector<float> copy;
+      if (!data)
+      {
+        copy.resize(3 * numberOfPoints);
+        double point[3];
+        for (size_t k = 0; k < numberOfPoints; ++k)
+        {
+          points->GetPoint(static_cast<vtkIdType>(k), point);
+          std::copy(point, point + 3, &copy[3 * k]);
+        }
+      }
+      this->Grid.Insert(sensor, data ? data->GetPointer(0) : copy.data(), numberOfPoints);
+    }
+    this->Memory.Set(static_cast<unsigned long>(this->Grid.GetMemorySize() / 1024));
+  }
+
+  // both outputs are the grid unrolled from its origin, which follows the sensor, their
+  // points being at the center of the cells
+  double origin[3];
+  this->Grid.GetOrigin(origin);
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    origin[axis] += 0.5 * this->Resolution;
+  }
+  double spacing[3] = { this->Resolution, this->Resolution, this->Resolution };
+  const int width = this->Grid.GetSize(0);
+  const int height = this->Grid.GetSize(2);
+
+  elevation->SetExtent(0, width - 1, 0, width - 1, 0, 0);
+  elevation->SetOrigin(origin[0], origin[1], 0.);
+  elevation->SetSpacing(spacing);
+  vtkSmartPointer<vtkFloatArray> minimum = vtkSmartPointer<vtkFloatArray>::New();
+  minimum->SetName("minimum_elevation");
+  minimum->SetNumberOfValues(static_cast<vtkIdType>(width) * width);
+  vtkSmartPointer<vtkFloatArray> maximum = vtkSmartPointer<vtkFloatArray>::New();
+  maximum->SetName("maximum_elevation");
+  maximum->SetNumberOfValues(static_cast<vtkIdType>(width) * width);
+  this->Grid.GetElevations(minimum->GetPointer(0), maximum->GetPointer(0));
+  elevation->GetPointData()->Initialize();
+  elevation->GetPointData()->SetScalars(maximum);
+  elevation->GetPointData()->AddArray(minimum);
+
+  volume->SetExtent(0, width - 1, 0, width - 1, 0, height - 1);
+  volume->SetOrigin(origin);
+  volume->SetSpacing(spacing);
+  vtkSmartPointer<vtkFloatArray> occupancy = vtkSmartPointer<vtkFloatArray>::New();
+  occupancy->SetName("occupancy");
+  occupancy->SetNumberOfValues(static_cast<vtkIdType>(width) * width * height);
+  this->Grid.GetOccupancy(occupancy->GetPointer(0));
+  volume->GetPointData()->Initialize();
+  volume->GetPointData()->SetScalars(occupancy);
+  return 1;
+}
@@ -0,0 +1,143 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_OCCUPANCY_GRID_H
+#define VTK_OCCUPANCY_GRID_H
+
+// LOCAL
+#include "MemoryAccounting.h"
+#include "OccupancyGrid.h"
+
+// VTK
+#include <vtkImageAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+class vtkVelodyneTransformInterpolator;
+
+/**
+ * @brief vtkOccupancyGrid maintains an occupancy grid around the sensor from the successive
+ * frames of its input, see OccupancyGrid. The first output is the 2.5D elevation map, an
+ * image of the lowest and highest point of each column, and the second one is the volume of
+ * the probability of occupancy of the voxels, 0.5 being unknown. Both follow the sensor.
+ *
+ * The position of the sensor is interpolated at the time of the frame in the optional
+ * trajectory, the frames then being in world coordinates, as given by the temporal
+ * transforms applier or the slam. Without trajectory, the frames are in the coordinates
+ * of the sensor, which is at SensorPosition. A frame is inserted each time the input changes,
+ * the grid is cleared when the time goes back.
+ */
+class VTK_EXPORT vtkOccupancyGrid : public vtkImageAlgorithm
+{
+public:
+  static vtkOccupancyGrid *New();
+  vtkTypeMacro(vtkOccupancyGrid, vtkImageAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Get the size of the cells
+  vtkGetMacro(Resolution, double)
+
+  /// Set the size of the cells, which clears the grid
+  void SetResolution(double resolution);
+
+  /// Get the number of cells along x and y
+  vtkGetMacro(HorizontalSize, int)
+
+  /// Set the number of cells along x and y, which clears the grid
+  void SetHorizontalSize(int size);
+
+  /// Get the number of cells along z
+  vtkGetMacro(VerticalSize, int)
+
+  /// Set the number of cells along z, which clears the grid
+  void SetVerticalSize(int size);
+
+  /// Get the probability of occupancy given by a point in a voxel
+  vtkGetMacro(HitProbability, double)
+
+  /// Set the probability of occupancy given by a point in a voxel, above 0.5
+  vtkSetClampMacro(HitProbability, double, 0.5, 0.99)
+
+  /// Get the probability of occupancy given by a ray crossing a voxel
+  vtkGetMacro(MissProbability, double)
+
+  /// Set the probability of occupancy given by a ray crossing a voxel, under 0.5
+  vtkSetClampMacro(MissProbability, double, 0.01, 0.5)
+
+  /// Get the position of the sensor in the frames, used without trajectory
+  vtkGetVector3Macro(SensorPosition, double)
+
+  /// Set the position of the sensor in the frames, used without trajectory
+  vtkSetVector3Macro(SensorPosition, double)
+
+  /// Get the number of threads tracing the rays
+  vtkGetMacro(NumberOfThreads, int)
+
+  /// Set the number of threads tracing the rays, 0 uses one thread per core
+  vtkSetMacro(NumberOfThreads, int)
+
+  /// Forget the occupancy and the elevations
+  void Reset();
+
+protected:
+  vtkOccupancyGrid();
+  ~vtkOccupancyGrid();
+
+  int FillInputPortInformation(int port, vtkInformation *info) override;
+  int FillOutputPortInformation(int port, vtkInformation *info) override;
+  int RequestInformation(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkOccupancyGrid(const vtkOccupancyGrid&) = delete;
+  void operator=(const vtkOccupancyGrid&) = delete;
+
+  /// Position of the sensor at the time of the frame, from the trajectory if there is one
+  void GetSensorPosition(vtkInformationVector** inputVector, bool hasTime, double time,
+                         double position[3]);
+
+  /// size of the cells
+  double Resolution = 0.2;
+
+  /// number of cells along x and y, and along z
+  int HorizontalSize = 200;
+  int VerticalSize = 30;
+
+  /// probabilities of occupancy given by a point in a voxel and by a ray crossing it
+  double HitProbability = 0.7;
+  double MissProbability = 0.4;
+
+  /// position of the sensor in the frames, used without trajectory
+  double SensorPosition[3] = { 0., 0., 0. };
+
+  /// number of threads tracing the rays
+  int NumberOfThreads = 0;
+
+  OccupancyGrid Grid;
+
+  //! Interpolator of the trajectory, created again when the trajectory changes
+  vtkSmartPointer<vtkVelodyneTransformInterpolator> Interpolator;
+  vtkMTimeType InterpolatorMTime = 0;
+
+  //! Input inserted last, which is not inserted again
+  vtkMTimeType LastInputMTime = 0;
+  double LastInputTime;
+
+  //! Memory used by the grid
+  MemoryAccounting::Account Memory{ MemoryAccounting::OCCUPANCY_GRIDS };
+};
+
+#endif // VTK_OCCUPANCY_GRID_H
@@ -27,17 +27,151 @@
 =========================================================================*/
 
 #include "vtkPlaneFitter.h"
+#include "ParallelPoints.h"
 
+#include "vtkDataArray.h"
 #include "vtkDoubleArray.h"
-#include "vtkNew.h"
+#include "vtkFloatArray.h"
 #include "vtkObjectFactory.h"
+#include "vtkPointData.h"
 #include "vtkPointSet.h"
-#include "vtkSmartPointer.h"
-#include "vtkThreshold.h"
-#include "vtkUnstructuredGrid.h"
+#include "vtkPoints.h"
 
 #include <Eigen/Dense>
 
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace
+{
+//! Points accumulated by a thread at least
+const vtkIdType MinimumPointsPerThread = 65536;
+
+//-----------------------------------------------------------------------------
+// Compensated sum, whose error does not grow with the number of values
+struct KahanSum
+{
+  double Sum = 0.;
+  double Compensation = 0.;
+
+  void Add(double value)
+  {
+    const double y = value - this->Compensation;
+    const double t = this->Sum + y;
+    this->Compensation = (t - this->Sum) - y;
+    this->Sum = t;
+  }
+
+  void Add(const KahanSum& other)
+  {
+    this->Add(other.Sum);
+    this->Add(-other.Compensation);
+  }
+
+  double Value() const { return this->Sum - this->Compensation; }
+};
+
+//-----------------------------------------------------------------------------
+// First and second order moments of points, shifted by a common point so that
+// the sums stay small
+struct Moments
+{
+  vtkIdType Count = 0;
+  KahanSum Sums[3];
+  //! xx, xy, xz, yy, yz, zz
+  KahanSum Products[6];
+
+  void Add(const double p[3])
+  {
+    this->Count++;
+    for (int i = 0; i < 3; ++i)
+    {
+      this->Sums[i].Add(p[i]);
+    }
+    this->Products[0].Add(p[0] * p[0]);
+    this->Products[1].Add(p[0] * p[1]);
+    this->Products[2].Add(p[0] * p[2]);
+    this->Products[3].Add(p[1] * p[1]);
+    this->Products[4].Add(p[1] * p[2]);
+    this->Products[5].Add(p[2] * p[2]);
+  }
+
+  void Add(const Moments& other)
+  {
+    this->Count += other.Count;
+    for (int i = 0; i < 3; ++i)
+    {
+      this->Sums[i].Add(other.Sums[i]);
+    }
+    for (int i = 0; i < 6; ++i)
+    {
+      this->Products[i].Add(other.Products[i]);
+    }
+  }
+
+  Eigen::Vector3d Mean() const
+  {
+    return Eigen::Vector3d(this->Sums[0].Value(), this->Sums[1].Value(), this->Sums[2].Value()) / this->Count;
+  }
+
+  //! Sum of the outer products of the points centered on their mean
+  Eigen::Matrix3d Scatter() const
+  {
+    Eigen::Matrix3d products;
+    products << this->Products[0].Value(), this->Products[1].Value(), this->Products[2].Value(),
+                this->Products[1].Value(), this->Products[3].Value(), this->Products[4].Value(),
+                this->Products[2].Value(), this->Products[4].Value(), this->Products[5].Value();
+    const Eigen::Vector3d mean = this->Mean();
+    return products - this->Count * mean * mean.transpose();
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Read the coordinates of a point, without virtual call for the float and double points
+class PointsReader
+{
+public:
+  explicit PointsReader(vtkDataArray* data)
+    : Data(data)
+    , Floats(vtkFloatArray::SafeDownCast(data))
+    , Doubles(vtkDoubleArray::SafeDownCast(data))
+  {
+  }
+
+  void Get(vtkIdType index, double p[3]) const
+  {
+    if (this->Floats)
+    {
+      const float* values = this->Floats->GetPointer(3 * index);
+      p[0] = values[0];
+      p[1] = values[1];
+      p[2] = values[2];
+    }
+    else if (this->Doubles)
+    {
+      const double* values = this->Doubles->GetPointer(3 * index);
+      p[0] = values[0];
+      p[1] = values[1];
+      p[2] = values[2];
+    }
+    else
+    {
+      this->Data->GetTuple(index, p);
+    }
+  }
+
+private:
+  vtkDataArray* Data;
+  vtkFloatArray* Floats;
+  vtkDoubleArray* Doubles;
+};
+}
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkPlaneFitter);
 
@@ -62,91 +196,92 @@ void vtkPlaneFitter::PlaneFit(vtkPointSet* pts, double origin[3], double normal[
   double& maxDist, double& stdDev, double channelMean[], double channelStdDev[],
   vtkIdType channelNpts[], unsigned int nchannels)
 {
-  using namespace Eigen;
-
-  vtkSmartPointer<vtkDoubleArray> ptdata = vtkSmartPointer<vtkDoubleArray>::New();
-  ptdata->DeepCopy(pts->GetPoints()->GetData());
-
-  const vtkIdType n = ptdata->GetNumberOfTuples();
+  const vtkIdType n = pts->GetNumberOfPoints();
   if (n < 1)
   {
     return;
   }
 
-  assert(ptdata->GetNumberOfComponents() == 3);
-  Map<MatrixXd> eigpointsraw(static_cast<double*>(ptdata->GetVoidPointer(0)),
-    ptdata->GetNumberOfComponents(), ptdata->GetNumberOfTuples());
-
-  MatrixXd eigpoints = eigpointsraw.transpose();
-
-  VectorXd mean(3);
-
-  mean = eigpoints.colwise().sum() / n;
-  assert(mean.size() == 3);
-
-  for (int i = 0; i < 3; ++i)
+  // The moments of each laser and of the points of the other lasers are accumulated
+  // by ranges of points in one pass over the arrays, the ranges being merged in order
+  const PointsReader points(pts->GetPoints()->GetData());
+  vtkDataArray* laserIds = pts->GetPointData()->GetArray("laser_id");
+  double shift[3];
+  points.Get(0, shift);
+
+  const int numberOfRanges = std::max<int>(1,
+    std::min<vtkIdType>(boost::thread::hardware_concurrency(), n / MinimumPointsPerThread));
+  std::vector<std::vector<Moments> > rangeMoments(numberOfRanges, std::vector<Moments>(nchannels + 1));
+  ParallelFor(n, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    std::vector<Moments>& moments = rangeMoments[range];
+    double p[3];
+    for (size_t index = begin; index < end; ++index)
+    {
+      points.Get(index, p);
+      for (int i = 0; i < 3; ++i)
+      {
+        p[i] -= shift[i];
+      }
+      const double laser = laserIds ? laserIds->GetTuple1(index) : -1.;
+      const bool isChannel = laser >= 0. && laser < nchannels;
+      moments[isChannel ? static_cast<unsigned int>(laser) : nchannels].Add(p);
+    }
+  });
+  std::vector<Moments> channelMoments(nchannels + 1);
+  Moments total;
+  for (const std::vector<Moments>& moments : rangeMoments)
   {
-    origin[i] = mean[i];
+    for (unsigned int i = 0; i <= nchannels; ++i)
+    {
+      channelMoments[i].Add(moments[i]);
+    }
+  }
+  for (const Moments& moments : channelMoments)
+  {
+    total.Add(moments);
   }
 
-  eigpoints.rowwise() -= mean.transpose();
-
-  JacobiSVD<MatrixXd> svd(eigpoints, ComputeThinU | ComputeThinV);
-
-  VectorXd enormal = svd.matrixV().col(2);
-  assert(enormal.size() == 3);
-  assert(std::fabs(enormal.norm() - 1.0) < 1.0e-8);
-
+  // the normal is the direction of least variance
+  const Eigen::Vector3d mean = total.Mean();
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(total.Scatter());
+  const Eigen::Vector3d enormal = solver.eigenvectors().col(0);
   for (int i = 0; i < 3; ++i)
   {
+    origin[i] = mean[i] + shift[i];
     normal[i] = enormal[i];
   }
+  stdDev = n > 1 ? std::sqrt(std::max(0., enormal.dot(total.Scatter() * enormal)) / (n - 1)) : 0.;
+
+  // the extreme distances to the plane need a second pass
+  std::vector<double> rangeMin(numberOfRanges, std::numeric_limits<double>::max());
+  std::vector<double> rangeMax(numberOfRanges, std::numeric_limits<double>::lowest());
+  ParallelFor(n, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    double p[3];
+    for (size_t index = begin; index < end; ++index)
+    {
+      points.Get(index, p);
+      const double distance = enormal[0] * (p[0] - origin[0]) + enormal[1] * (p[1] - origin[1]) +
+        enormal[2] * (p[2] - origin[2]);
+      rangeMin[range] = std::min(rangeMin[range], distance);
+      rangeMax[range] = std::max(rangeMax[range], distance);
+    }
+  });
+  minDist = *std::min_element(rangeMin.begin(), rangeMin.end());
+  maxDist = *std::max_element(rangeMax.begin(), rangeMax.end());
 
-  VectorXd distances = eigpoints * enormal;
-  assert(distances.size() == n);
-
-  minDist = distances.minCoeff();
-  maxDist = distances.maxCoeff();
-
-  stdDev = std::sqrt(distances.squaredNorm() / (n - 1));
-
+  // the distances of the points of a laser to the plane have the mean of their
+  // centroid, and the variance of their scatter along the normal
   for (unsigned int i = 0; i < nchannels; ++i)
   {
-    vtkNew<vtkThreshold> threshold;
-    threshold->ThresholdBetween(i, i);
-    threshold->SetInputData(pts);
-    threshold->SetInputArrayToProcess(0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS, "laser_id");
-    threshold->SetOutputPointsPrecision(vtkAlgorithm::DEFAULT_PRECISION);
-    threshold->Update();
-
-    channelNpts[i] = threshold->GetOutput()->GetNumberOfPoints();
-
-    vtkSmartPointer<vtkDoubleArray> threshdata = vtkSmartPointer<vtkDoubleArray>::New();
-    threshdata->DeepCopy(threshold->GetOutput()->GetPoints()->GetData());
-
-    const vtkIdType n = threshdata->GetNumberOfTuples();
-    if (n < 2)
+    const Moments& moments = channelMoments[i];
+    channelNpts[i] = moments.Count;
+    if (moments.Count < 2)
     {
       channelMean[i] = 0.0;
       channelStdDev[i] = 0.0;
       continue;
     }
-
-    assert(threshdata->GetNumberOfComponents() == 3);
-    assert(threshdata->GetNumberOfTuples() >= 2);
-    Map<MatrixXd> channelraw(static_cast<double*>(threshdata->GetVoidPointer(0)),
-      threshdata->GetNumberOfComponents(), threshdata->GetNumberOfTuples());
-
-    MatrixXd channelpts = channelraw.transpose();
-    channelpts.rowwise() -= mean.transpose();
-
-    VectorXd channelds = channelpts * enormal;
-
-    double cmean = channelds.sum() / channelds.size();
-    double cstddev =
-      std::sqrt((channelds.array() - cmean).matrix().squaredNorm() / (channelds.size() - 1));
-
-    channelMean[i] = cmean;
-    channelStdDev[i] = cstddev;
+    channelMean[i] = enormal.dot(moments.Mean() - mean);
+    channelStdDev[i] = std::sqrt(std::max(0., enormal.dot(moments.Scatter() * enormal)) / (moments.Count - 1));
   }
 }
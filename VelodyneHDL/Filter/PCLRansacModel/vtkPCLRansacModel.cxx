@@ -15,6 +15,9 @@
 
 // local includes
 #include "vtkPCLRansacModel.h"
+#include "TraceEvents.h"
+#include "MultiModelExtraction.h"
+#include "RansacEngine.h"
 #include "vtkPCLConversions.h"
 
 // vtk includes
@@ -23,6 +26,7 @@
 #include <vtkDataArray.h>
 #include <vtkDataSet.h>
 #include <vtkInformation.h>
+#include <vtkIntArray.h>
 #include <vtkInformationVector.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
@@ -40,16 +44,25 @@
 #include <pcl/sample_consensus/sac_model_cone.h>
 #include <pcl/sample_consensus/sac_model_cylinder.h>
 #include <pcl/sample_consensus/sac_model_sphere.h>
-#include <pcl/sample_consensus/sac_model_line.h>
-#include <pcl/sample_consensus/sac_model_plane.h>
+
+// std includes
+#include <algorithm>
 
 // Implementation of the New function
 vtkStandardNewMacro(vtkPCLRansacModel);
 
 //----------------------------------------------------------------------------
 vtkPCLRansacModel::vtkPCLRansacModel()
+  : NumberOfThreads(0)
+  , CellSize(5.)
+  , MaximumModelsPerCell(4)
+  , MinimumInliers(50)
+  , FitCylinders(true)
+  , MergeAngle(5.)
+  , NumberOfModels(0)
 {
-
+  this->CylinderRadiusRange[0] = 0.02;
+  this->CylinderRadiusRange[1] = 0.5;
 }
 
 //----------------------------------------------------------------------------
@@ -68,67 +81,126 @@ void vtkPCLRansacModel::PrintSelf(ostream& os, vtkIndent indent)
 int vtkPCLRansacModel::RequestData(vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkPCLRansacModel::RequestData");
 
   // Get the input
   vtkPolyData * input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
   
-  // Convert input data in pcl format
-  pcl::PointCloud<pcl::PointXYZ>::Ptr pointCloud = vtkPCLConversions::PointCloudFromPolyData(input);
-
   // inliers's index according to the model and threshold
   std::vector<int> inliers;
 
-  // instantiate the model
-  pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr RANSACModel;
-
-  switch (ModelType) {
-
-    case vtkPCLRansacModel::Circle2D:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelCircle2D<pcl::PointXYZ> (pointCloud));
-      break;
-
-    case vtkPCLRansacModel::Circle3D:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelCircle3D<pcl::PointXYZ> (pointCloud));
-      break;
-
-// The Cone Model and the Cylinder Model require to compute the normal, so this is not wrap
-//    case vtkPCLRansacModel::Cone:
-//      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-//            new pcl::SampleConsensusModelCone<pcl::PointXYZ, pcl::Normal> (pointCloud));
-//      break;
-
-//    case vtkPCLRansacModel::Cylinder:
-//      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-//            new pcl::SampleConsensusModelCylinder<pcl::PointXYZ, pcl::Normal> (pointCloud));
-//      break;
-
-    case vtkPCLRansacModel::Shpere:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelSphere<pcl::PointXYZ> (pointCloud));
-      break;
-
-    case vtkPCLRansacModel::Line:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelLine<pcl::PointXYZ> (pointCloud));
-      break;
-
-    case vtkPCLRansacModel::Plane:
-      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
-            new pcl::SampleConsensusModelLine<pcl::PointXYZ> (pointCloud));
-      break;
-
-    default:
-      cerr << "No model : " << ModelType << endl;
-      break;
-  }
+  // model of each point and its type, for the multi model extraction
+  vtkSmartPointer<vtkIntArray> modelArray;
+  vtkSmartPointer<vtkIntArray> typeArray;
 
-  // Instanciate and launch the random consensus
-  pcl::RandomSampleConsensus<pcl::PointXYZ> ransac (RANSACModel);
-  ransac.setDistanceThreshold (this->DistanceThreshold);
-  ransac.computeModel(); // compute ransac
-  ransac.getInliers(inliers); // get inlier list
+  // all the models are extracted in a single pass, the points being labelled with their model
+  if (this->ModelType == vtkPCLRansacModel::MultiModel)
+  {
+    MultiModelExtraction extraction;
+    extraction.Threshold = this->DistanceThreshold;
+    extraction.CellSize = this->CellSize;
+    extraction.MaximumModelsPerCell = static_cast<unsigned int>(std::max(this->MaximumModelsPerCell, 1));
+    extraction.MinimumInliers = static_cast<size_t>(std::max(this->MinimumInliers, 3));
+    extraction.FitCylinders = this->FitCylinders;
+    extraction.MinimumRadius = this->CylinderRadiusRange[0];
+    extraction.MaximumRadius = this->CylinderRadiusRange[1];
+    extraction.MergeAngle = this->MergeAngle;
+    extraction.MergeDistance = 2. * this->DistanceThreshold;
+    extraction.NumberOfThreads = this->NumberOfThreads;
+    MultiModelExtraction::Result result;
+    extraction.Run(RansacPoints(input->GetPoints()), result);
+    this->NumberOfModels = static_cast<int>(result.Models.size());
+
+    modelArray = vtkSmartPointer<vtkIntArray>::New();
+    modelArray->SetName("model");
+    modelArray->SetNumberOfValues(input->GetNumberOfPoints());
+    typeArray = vtkSmartPointer<vtkIntArray>::New();
+    typeArray->SetName("model_type");
+    typeArray->SetNumberOfValues(input->GetNumberOfPoints());
+    for (vtkIdType k = 0; k < input->GetNumberOfPoints(); ++k)
+    {
+      const int label = result.Labels[k];
+      modelArray->SetValue(k, label);
+      typeArray->SetValue(k, label < 0 ? -1 : result.Models[label].Type);
+      if (label >= 0)
+      {
+        inliers.push_back(static_cast<int>(k));
+      }
+    }
+  }
+  // the line and the plane are fitted by the ransac engine shared with vtkRansacPlaneModel
+  else if (this->ModelType == vtkPCLRansacModel::Line || this->ModelType == vtkPCLRansacModel::Plane)
+  {
+    RansacEngine engine;
+    engine.Threshold = this->DistanceThreshold;
+    engine.MaxIterations = 1000;
+    engine.NumberOfThreads = this->NumberOfThreads;
+    RansacLine line;
+    RansacPlane plane;
+    const RansacModel& model = this->ModelType == vtkPCLRansacModel::Line ?
+      static_cast<const RansacModel&>(line) : static_cast<const RansacModel&>(plane);
+    RansacPoints points(input->GetPoints());
+    RansacEngine::Result result;
+    if (engine.Run(model, points, result))
+    {
+      std::vector<unsigned char> isInlier;
+      engine.ComputeInliers(model, result.Parameters, points, isInlier);
+      for (size_t k = 0; k < isInlier.size(); ++k)
+      {
+        if (isInlier[k])
+        {
+          inliers.push_back(static_cast<int>(k));
+        }
+      }
+    }
+  }
+  else
+  {
+    // Convert input data in pcl format
+    pcl::PointCloud<pcl::PointXYZ>::Ptr pointCloud = vtkPCLConversions::PointCloudFromPolyData(input);
+
+    // instantiate the model
+    pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr RANSACModel;
+
+    switch (ModelType) {
+
+      case vtkPCLRansacModel::Circle2D:
+        RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
+              new pcl::SampleConsensusModelCircle2D<pcl::PointXYZ> (pointCloud));
+        break;
+
+      case vtkPCLRansacModel::Circle3D:
+        RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
+              new pcl::SampleConsensusModelCircle3D<pcl::PointXYZ> (pointCloud));
+        break;
+
+  // The Cone Model and the Cylinder Model require to compute the normal, so this is not wrap
+  //    case vtkPCLRansacModel::Cone:
+  //      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
+  //            new pcl::SampleConsensusModelCone<pcl::PointXYZ, pcl::Normal> (pointCloud));
+  //      break;
+
+  //    case vtkPCLRansacModel::Cylinder:
+  //      RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
+  //            new pcl::SampleConsensusModelCylinder<pcl::PointXYZ, pcl::Normal> (pointCloud));
+  //      break;
+
+      case vtkPCLRansacModel::Shpere:
+        RANSACModel = pcl::SampleConsensusModel<pcl::PointXYZ>::Ptr(
+              new pcl::SampleConsensusModelSphere<pcl::PointXYZ> (pointCloud));
+        break;
+
+      default:
+        cerr << "No model : " << ModelType << endl;
+        break;
+    }
+
+    // Instanciate and launch the random consensus
+    pcl::RandomSampleConsensus<pcl::PointXYZ> ransac (RANSACModel);
+    ransac.setDistanceThreshold (this->DistanceThreshold);
+    ransac.computeModel(); // compute ransac
+    ransac.getInliers(inliers); // get inlier list
+  }
   std::cout << "Inliers size : " << inliers.size() << std::endl;
   // Add inlier / outlier array information to vtkPolyData input
   vtkSmartPointer<vtkUnsignedIntArray> InlierOutlierArray = vtkSmartPointer<vtkUnsignedIntArray>::New();
@@ -152,6 +224,11 @@ int vtkPCLRansacModel::RequestData(vtkInformation *vtkNotUsed(request),
 
   // Add the array
   output->GetPointData()->AddArray(InlierOutlierArray);
+  if (modelArray)
+  {
+    output->GetPointData()->AddArray(modelArray);
+    output->GetPointData()->AddArray(typeArray);
+  }
 
   return 1;
 }
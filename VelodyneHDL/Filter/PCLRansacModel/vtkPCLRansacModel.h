@@ -39,7 +39,8 @@ class VTK_EXPORT vtkPCLRansacModel : public vtkPolyDataAlgorithm
     Cylinder,   // not implemented
     Shpere,
     Line,
-    Plane
+    Plane,
+    MultiModel  // planes and vertical cylinders, see MultiModelExtraction
   };
 
   vtkGetMacro(DistanceThreshold, double)
@@ -48,6 +49,30 @@ class VTK_EXPORT vtkPCLRansacModel : public vtkPolyDataAlgorithm
   vtkGetMacro(ModelType, int)
   vtkSetMacro(ModelType, int)
 
+  vtkGetMacro(NumberOfThreads, int)
+  vtkSetMacro(NumberOfThreads, int)
+
+  vtkGetMacro(CellSize, double)
+  vtkSetMacro(CellSize, double)
+
+  vtkGetMacro(MaximumModelsPerCell, int)
+  vtkSetMacro(MaximumModelsPerCell, int)
+
+  vtkGetMacro(MinimumInliers, int)
+  vtkSetMacro(MinimumInliers, int)
+
+  vtkGetMacro(FitCylinders, bool)
+  vtkSetMacro(FitCylinders, bool)
+
+  vtkGetVector2Macro(CylinderRadiusRange, double)
+  vtkSetVector2Macro(CylinderRadiusRange, double)
+
+  vtkGetMacro(MergeAngle, double)
+  vtkSetMacro(MergeAngle, double)
+
+  //! Number of models found by the last multi model extraction
+  vtkGetMacro(NumberOfModels, int)
+
 protected:
   // constructor / destructor
   vtkPCLRansacModel();
@@ -62,6 +87,29 @@ protected:
   //! Model to approximate
   int ModelType;
 
+  //! Number of threads fitting the line and plane models, 0 uses one thread per core
+  int NumberOfThreads;
+
+  //! Size of the cells fitted in parallel by the multi model extraction
+  double CellSize;
+
+  //! Maximum number of models fitted in a cell
+  int MaximumModelsPerCell;
+
+  //! Number of inliers under which a model of a cell is rejected
+  int MinimumInliers;
+
+  //! Indicate if the vertical cylinders, such as the poles, are extracted with the planes
+  bool FitCylinders;
+
+  //! Minimum and maximum radius of the cylinders
+  double CylinderRadiusRange[2];
+
+  //! Maximum angle between two planes of neighbouring cells which are merged, in degrees
+  double MergeAngle;
+
+  int NumberOfModels;
+
 
 private:
   // copy operators
@@ -0,0 +1,444 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "vtkPointCloudAccumulator.h"
+#include "TraceEvents.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+namespace
+{
+//! Part of the maximum number of points evicted at once, so that the eviction is not done for each frame
+const double EvictionMargin = 0.1;
+
+//! Part of the maximum distance the frames move before the far voxels are evicted again
+const double EvictionDistanceRatio = 0.1;
+
+//! Name of the array counting the points merged in each voxel
+const char* CountsArrayName = "number_of_points";
+
+//-----------------------------------------------------------------------------
+// 21 bits per axis, which covers hundreds of kilometers with decimetric voxels
+uint64_t GetVoxelKey(const double point[3], double leafSize)
+{
+  const uint64_t mask = (1 << 21) - 1;
+  uint64_t key = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    key = (key << 21) | (static_cast<uint64_t>(static_cast<int64_t>(std::floor(point[i] / leafSize))) & mask);
+  }
+  return key;
+}
+}
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkPointCloudAccumulator)
+
+//-----------------------------------------------------------------------------
+vtkPointCloudAccumulator::vtkPointCloudAccumulator()
+{
+  this->Reset();
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudAccumulator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LeafSize: " << this->LeafSize << std::endl;
+  os << indent << "MaximumNumberOfPoints: " << this->MaximumNumberOfPoints << std::endl;
+  os << indent << "MaximumDistance: " << this->MaximumDistance << std::endl;
+  os << indent << "Accumulated points: " << this->SlotKeys.size() << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudAccumulator::SetLeafSize(double size)
+{
+  if (this->LeafSize != size)
+  {
+    this->LeafSize = size;
+    this->Reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudAccumulator::Reset()
+{
+  this->Accumulated->Initialize();
+  this->Counts = nullptr;
+  this->AveragedArrays.clear();
+  this->VertexCells->Initialize();
+  std::unordered_map<uint64_t, vtkIdType>().swap(this->Slots);
+  std::vector<uint64_t>().swap(this->SlotKeys);
+  std::vector<unsigned int>().swap(this->SlotLastFrames);
+  this->NumberOfFrames = 0;
+  this->LastInputMTime = 0;
+  this->LastInputTime = std::numeric_limits<double>::lowest();
+  this->HasEvictionCenter = false;
+  this->Memory.Set(0);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkPointCloudAccumulator::RequestData(vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector, vtkInformationVector *outputVector)
+{
+  VV_TRACE_SCOPE("vtkPointCloudAccumulator::RequestData");
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+
+  if (this->LeafSize <= 0.)
+  {
+    vtkErrorMacro("The leaf size must be positive");
+    return 0;
+  }
+
+  // Going back in time restarts the accumulation, an input which has not
+  // changed since the last frame is not accumulated again
+  const bool hasTime = input->GetInformation()->Has(vtkDataObject::DATA_TIME_STEP());
+  const double time = hasTime ? input->GetInformation()->Get(vtkDataObject::DATA_TIME_STEP()) : 0.;
+  if (hasTime && time < this->LastInputTime)
+  {
+    this->Reset();
+  }
+  if (input->GetMTime() != this->LastInputMTime || (hasTime && time != this->LastInputTime))
+  {
+    this->LastInputMTime = input->GetMTime();
+    this->LastInputTime = hasTime ? time : this->LastInputTime;
+
+    double center[3];
+    this->Accumulate(input, center);
+    if (this->MaximumDistance > 0. && input->GetNumberOfPoints() > 0)
+    {
+      this->EvictFarVoxels(center);
+    }
+    if (this->MaximumNumberOfPoints > 0 &&
+      this->SlotKeys.size() > static_cast<size_t>(this->MaximumNumberOfPoints))
+    {
+      this->EvictOldVoxels();
+    }
+    this->UpdateVertices();
+
+    // the accumulated arrays are modified in place, the next filters must update
+    if (this->Accumulated->GetPoints())
+    {
+      this->Accumulated->GetPoints()->Modified();
+    }
+    vtkPointData* pointData = this->Accumulated->GetPointData();
+    for (int arrayIndex = 0; arrayIndex < pointData->GetNumberOfArrays(); ++arrayIndex)
+    {
+      pointData->GetArray(arrayIndex)->Modified();
+    }
+    this->Memory.Set(this->Accumulated->GetActualMemorySize() +
+      static_cast<unsigned long>(this->SlotKeys.size() *
+        (sizeof(uint64_t) + sizeof(unsigned int) + sizeof(std::pair<uint64_t, vtkIdType>) + 2 * sizeof(void*)) / 1024));
+  }
+
+  output->SetPoints(this->Accumulated->GetPoints());
+  output->GetPointData()->ShallowCopy(this->Accumulated->GetPointData());
+  vtkSmartPointer<vtkCellArray> verts = vtkSmartPointer<vtkCellArray>::New();
+  verts->SetCells(static_cast<vtkIdType>(this->SlotKeys.size()), this->VertexCells.GetPointer());
+  output->SetVerts(verts);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudAccumulator::InitializeArrays(vtkPolyData* frame)
+{
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
+  this->Accumulated->SetPoints(points);
+
+  vtkPointData* framePointData = frame->GetPointData();
+  vtkPointData* pointData = this->Accumulated->GetPointData();
+  for (int arrayIndex = 0; arrayIndex < framePointData->GetNumberOfArrays(); ++arrayIndex)
+  {
+    vtkDataArray* frameArray = framePointData->GetArray(arrayIndex);
+    if (!frameArray || !frameArray->GetName() || std::string(frameArray->GetName()) == CountsArrayName)
+    {
+      continue;
+    }
+    vtkSmartPointer<vtkDataArray> array;
+    array.TakeReference(frameArray->NewInstance());
+    array->SetName(frameArray->GetName());
+    array->SetNumberOfComponents(frameArray->GetNumberOfComponents());
+    pointData->AddArray(array);
+    const int type = frameArray->GetDataType();
+    this->AveragedArrays.push_back(type == VTK_FLOAT || type == VTK_DOUBLE);
+  }
+  if (framePointData->GetScalars() && framePointData->GetScalars()->GetName())
+  {
+    pointData->SetActiveScalars(framePointData->GetScalars()->GetName());
+  }
+
+  vtkSmartPointer<vtkIntArray> counts = vtkSmartPointer<vtkIntArray>::New();
+  counts->SetName(CountsArrayName);
+  pointData->AddArray(counts);
+  this->Counts = counts;
+  this->AveragedArrays.push_back(false);
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudAccumulator::Accumulate(vtkPolyData* frame, double center[3])
+{
+  center[0] = center[1] = center[2] = 0.;
+  if (!this->Accumulated->GetPoints())
+  {
+    this->InitializeArrays(frame);
+  }
+  this->NumberOfFrames++;
+
+  // arrays of the frame matching the accumulated ones, the others are left to 0
+  vtkPointData* pointData = this->Accumulated->GetPointData();
+  const int numberOfArrays = pointData->GetNumberOfArrays();
+  std::vector<vtkDataArray*> arrays(numberOfArrays);
+  std::vector<vtkDataArray*> frameArrays(numberOfArrays, nullptr);
+  int maximumNumberOfComponents = 1;
+  for (int arrayIndex = 0; arrayIndex < numberOfArrays; ++arrayIndex)
+  {
+    arrays[arrayIndex] = pointData->GetArray(arrayIndex);
+    vtkDataArray* frameArray = frame->GetPointData()->GetArray(arrays[arrayIndex]->GetName());
+    if (arrays[arrayIndex] != this->Counts && frameArray &&
+      frameArray->GetDataType() == arrays[arrayIndex]->GetDataType() &&
+      frameArray->GetNumberOfComponents() == arrays[arrayIndex]->GetNumberOfComponents())
+    {
+      frameArrays[arrayIndex] = frameArray;
+    }
+    maximumNumberOfComponents = std::max(maximumNumberOfComponents, arrays[arrayIndex]->GetNumberOfComponents());
+  }
+  const std::vector<double> zeros(maximumNumberOfComponents, 0.);
+
+  vtkDoubleArray* coordinates = vtkDoubleArray::SafeDownCast(this->Accumulated->GetPoints()->GetData());
+  vtkIdType numberOfFinitePoints = 0;
+  double point[3];
+  for (vtkIdType pointIndex = 0; pointIndex < frame->GetNumberOfPoints(); ++pointIndex)
+  {
+    frame->GetPoint(pointIndex, point);
+    if (!std::isfinite(point[0]) || !std::isfinite(point[1]) || !std::isfinite(point[2]))
+    {
+      continue;
+    }
+    numberOfFinitePoints++;
+    for (int i = 0; i < 3; ++i)
+    {
+      center[i] += point[i];
+    }
+
+    const auto inserted = this->Slots.emplace(GetVoxelKey(point, this->LeafSize),
+      static_cast<vtkIdType>(this->SlotKeys.size()));
+    const vtkIdType slot = inserted.first->second;
+    if (inserted.second)
+    {
+      // a new voxel, whose point is the first one
+      this->SlotKeys.push_back(inserted.first->first);
+      this->SlotLastFrames.push_back(this->NumberOfFrames);
+      coordinates->InsertNextTuple(point);
+      for (int arrayIndex = 0; arrayIndex < numberOfArrays; ++arrayIndex)
+      {
+        if (frameArrays[arrayIndex])
+        {
+          arrays[arrayIndex]->InsertNextTuple(pointIndex, frameArrays[arrayIndex]);
+        }
+        else
+        {
+          arrays[arrayIndex]->InsertNextTuple(zeros.data());
+        }
+      }
+      this->Counts->SetValue(slot, 1);
+      continue;
+    }
+
+    // the point of the voxel and its floating point arrays move to the mean of its points
+    this->SlotLastFrames[slot] = this->NumberOfFrames;
+    const int count = this->Counts->GetValue(slot) + 1;
+    this->Counts->SetValue(slot, count);
+    const double weight = 1. / count;
+    double* mean = coordinates->GetPointer(3 * slot);
+    for (int i = 0; i < 3; ++i)
+    {
+      mean[i] += weight * (point[i] - mean[i]);
+    }
+    for (int arrayIndex = 0; arrayIndex < numberOfArrays; ++arrayIndex)
+    {
+      vtkDataArray* frameArray = frameArrays[arrayIndex];
+      if (!frameArray)
+      {
+        continue;
+      }
+      if (!this->AveragedArrays[arrayIndex])
+      {
+        arrays[arrayIndex]->SetTuple(slot, pointIndex, frameArray);
+        continue;
+      }
+      for (int component = 0; component < frameArray->GetNumberOfComponents(); ++component)
+      {
+        const double value = arrays[arrayIndex]->GetComponent(slot, component);
+        arrays[arrayIndex]->SetComponent(slot, component,
+          value + weight * (frameArray->GetComponent(pointIndex, component) - value));
+      }
+    }
+  }
+
+  for (int i = 0; numberOfFinitePoints > 0 && i < 3; ++i)
+  {
+    center[i] /= numberOfFinitePoints;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudAccumulator::EvictFarVoxels(const double center[3])
+{
+  // the far voxels only change once the frames have moved enough
+  if (this->HasEvictionCenter)
+  {
+    double moved = 0.;
+    for (int i = 0; i < 3; ++i)
+    {
+      moved += (center[i] - this->LastEvictionCenter[i]) * (center[i] - this->LastEvictionCenter[i]);
+    }
+    const double step = EvictionDistanceRatio * this->MaximumDistance;
+    if (moved < step * step)
+    {
+      return;
+    }
+  }
+  std::copy(center, center + 3, this->LastEvictionCenter);
+  this->HasEvictionCenter = true;
+
+  const double maximumDistance2 = this->MaximumDistance * this->MaximumDistance;
+  const vtkIdType numberOfSlots = static_cast<vtkIdType>(this->SlotKeys.size());
+  std::vector<char> evicted(numberOfSlots, 0);
+  bool isEvicting = false;
+  double point[3];
+  for (vtkIdType slot = 0; slot < numberOfSlots; ++slot)
+  {
+    this->Accumulated->GetPoint(slot, point);
+    double distance2 = 0.;
+    for (int i = 0; i < 3; ++i)
+    {
+      distance2 += (point[i] - center[i]) * (point[i] - center[i]);
+    }
+    evicted[slot] = distance2 > maximumDistance2;
+    isEvicting = isEvicting || evicted[slot];
+  }
+  if (isEvicting)
+  {
+    this->Compact(evicted);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudAccumulator::EvictOldVoxels()
+{
+  // the voxels seen the longest time ago go first, in the order of their slots
+  const size_t numberOfSlots = this->SlotKeys.size();
+  const size_t target = static_cast<size_t>((1. - EvictionMargin) * this->MaximumNumberOfPoints);
+  const size_t numberOfEvicted = numberOfSlots - target;
+  std::vector<unsigned int> lastFrames = this->SlotLastFrames;
+  std::nth_element(lastFrames.begin(), lastFrames.begin() + (numberOfEvicted - 1), lastFrames.end());
+  const unsigned int threshold = lastFrames[numberOfEvicted - 1];
+  size_t numberAtThreshold = numberOfEvicted -
+    std::count_if(this->SlotLastFrames.begin(), this->SlotLastFrames.end(),
+      [threshold](unsigned int frame) { return frame < threshold; });
+
+  std::vector<char> evicted(numberOfSlots, 0);
+  for (size_t slot = 0; slot < numberOfSlots; ++slot)
+  {
+    const unsigned int frame = this->SlotLastFrames[slot];
+    if (frame < threshold || (frame == threshold && numberAtThreshold > 0))
+    {
+      evicted[slot] = 1;
+      numberAtThreshold -= frame == threshold ? 1 : 0;
+    }
+  }
+  this->Compact(evicted);
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudAccumulator::Compact(const std::vector<char>& evicted)
+{
+  vtkPoints* points = this->Accumulated->GetPoints();
+  vtkPointData* pointData = this->Accumulated->GetPointData();
+  vtkIdType kept = 0;
+  for (vtkIdType slot = 0; slot < static_cast<vtkIdType>(evicted.size()); ++slot)
+  {
+    if (evicted[slot])
+    {
+      this->Slots.erase(this->SlotKeys[slot]);
+      continue;
+    }
+    if (kept != slot)
+    {
+      this->SlotKeys[kept] = this->SlotKeys[slot];
+      this->SlotLastFrames[kept] = this->SlotLastFrames[slot];
+      this->Slots[this->SlotKeys[kept]] = kept;
+      points->SetPoint(kept, points->GetPoint(slot));
+      for (int arrayIndex = 0; arrayIndex < pointData->GetNumberOfArrays(); ++arrayIndex)
+      {
+        vtkDataArray* array = pointData->GetArray(arrayIndex);
+        array->SetTuple(kept, slot, array);
+      }
+    }
+    kept++;
+  }
+
+  // the kept voxels are at the beginning of the arrays, truncated once
+  this->SlotKeys.resize(kept);
+  this->SlotLastFrames.resize(kept);
+  points->GetData()->SetNumberOfTuples(kept);
+  for (int arrayIndex = 0; arrayIndex < pointData->GetNumberOfArrays(); ++arrayIndex)
+  {
+    pointData->GetArray(arrayIndex)->SetNumberOfTuples(kept);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudAccumulator::UpdateVertices()
+{
+  // a vertex cell per point, only the cells of the new points are added
+  const vtkIdType numberOfPoints = static_cast<vtkIdType>(this->SlotKeys.size());
+  const vtkIdType numberOfCells = this->VertexCells->GetNumberOfValues() / 2;
+  if (numberOfPoints <= numberOfCells)
+  {
+    this->VertexCells->SetNumberOfValues(2 * numberOfPoints);
+  }
+  for (vtkIdType i = numberOfCells; i < numberOfPoints; ++i)
+  {
+    this->VertexCells->InsertNextValue(1);
+    this->VertexCells->InsertNextValue(i);
+  }
+  this->VertexCells->Modified();
+}
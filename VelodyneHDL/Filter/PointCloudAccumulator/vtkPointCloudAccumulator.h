@@ -0,0 +1,142 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef VTK_POINT_CLOUD_ACCUMULATOR_H
+#define VTK_POINT_CLOUD_ACCUMULATOR_H
+
+// LOCAL
+#include "MemoryAccounting.h"
+
+// STD
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// VTK
+#include <vtkNew.h>
+#include <vtkPolyDataAlgorithm.h>
+
+class vtkIdTypeArray;
+class vtkIntArray;
+
+/**
+ * @brief vtkPointCloudAccumulator accumulates the successive frames of its input, already
+ * expressed in world coordinates, in a single cloud of bounded size. The frames are inserted
+ * in a hash of world-aligned voxels as they come: each voxel keeps one point, the mean of its
+ * points, with the mean of their floating point arrays, the last value of their other arrays
+ * and their number in the "number_of_points" array. The voxels not seen for the longest time
+ * are evicted once there are more than MaximumNumberOfPoints, and the voxels farther than
+ * MaximumDistance from the center of the last frame are evicted as the frames move.
+ * A frame is accumulated each time the input changes, the accumulation restarts when the
+ * time goes back.
+ */
+class VTK_EXPORT vtkPointCloudAccumulator : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkPointCloudAccumulator *New();
+  vtkTypeMacro(vtkPointCloudAccumulator, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Get the size of the voxels
+  vtkGetMacro(LeafSize, double)
+
+  /// Set the size of the voxels, which restarts the accumulation
+  void SetLeafSize(double size);
+
+  /// Get the maximum number of accumulated points, 0 for no limit
+  vtkGetMacro(MaximumNumberOfPoints, int)
+
+  /// Set the maximum number of accumulated points, 0 for no limit
+  vtkSetMacro(MaximumNumberOfPoints, int)
+
+  /// Get the distance to the last frame beyond which the points are evicted, 0 for no limit
+  vtkGetMacro(MaximumDistance, double)
+
+  /// Set the distance to the last frame beyond which the points are evicted, 0 for no limit
+  vtkSetMacro(MaximumDistance, double)
+
+  /// Forget the accumulated points
+  void Reset();
+
+protected:
+  vtkPointCloudAccumulator();
+  ~vtkPointCloudAccumulator() = default;
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkPointCloudAccumulator(const vtkPointCloudAccumulator&) = delete;
+  void operator=(const vtkPointCloudAccumulator&) = delete;
+
+  /// Insert the points of a frame in the voxels, center is the mean of its points
+  void Accumulate(vtkPolyData* frame, double center[3]);
+
+  /// Create the accumulated arrays from the arrays of the first frame
+  void InitializeArrays(vtkPolyData* frame);
+
+  /// Evict the voxels farther than MaximumDistance from center
+  void EvictFarVoxels(const double center[3]);
+
+  /// Evict the voxels not seen for the longest time, down to a margin under MaximumNumberOfPoints
+  void EvictOldVoxels();
+
+  /// Remove the evicted voxels, the others keep their order
+  void Compact(const std::vector<char>& evicted);
+
+  /// Vertices of the accumulated points, extended or truncated to their number
+  void UpdateVertices();
+
+  /// size of the voxels
+  double LeafSize = 0.2;
+
+  /// maximum number of accumulated points, 0 for no limit
+  int MaximumNumberOfPoints = 2000000;
+
+  /// distance to the last frame beyond which the points are evicted, 0 for no limit
+  double MaximumDistance = 0.;
+
+  //! Accumulated points and arrays, the point of each voxel being at its slot
+  vtkNew<vtkPolyData> Accumulated;
+  //! Number of points merged in each voxel, also an array of Accumulated
+  vtkIntArray* Counts = nullptr;
+  //! Arrays of Accumulated holding the mean of the points instead of the last value
+  std::vector<char> AveragedArrays;
+  //! Legacy vertex cells of the accumulated points, kept from one frame to the next
+  vtkNew<vtkIdTypeArray> VertexCells;
+
+  //! Slot of each voxel, and key and last frame seen of each slot
+  std::unordered_map<uint64_t, vtkIdType> Slots;
+  std::vector<uint64_t> SlotKeys;
+  std::vector<unsigned int> SlotLastFrames;
+
+  //! Number of frames accumulated since the last reset
+  unsigned int NumberOfFrames = 0;
+
+  //! Input accumulated last, which is not accumulated again
+  vtkMTimeType LastInputMTime = 0;
+  double LastInputTime;
+
+  //! Center of the frame at the last eviction of the far voxels
+  double LastEvictionCenter[3] = { 0., 0., 0. };
+  bool HasEvictionCenter = false;
+
+  //! Memory used by the accumulated points
+  MemoryAccounting::Account Memory{ MemoryAccounting::ACCUMULATED_POINTS };
+};
+
+#endif // VTK_POINT_CLOUD_ACCUMULATOR_H
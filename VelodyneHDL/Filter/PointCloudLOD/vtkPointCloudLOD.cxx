@@ -0,0 +1,480 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkPointCloudLOD.h"
+#include "ParallelPoints.h"
+#include "TraceEvents.h"
+
+// STD
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkCompositeDataIterator.h>
+#include <vtkCompositeDataSet.h>
+#include <vtkDataArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// BOOST
+
+namespace
+{
+//! Points processed by a thread at least
+const vtkIdType MinimumPointsPerThread = 65536;
+
+//! Nodes with at most this number of points keep all of them instead of being split
+const vtkIdType MaximumLeafPoints = 4096;
+
+//! Depth of the octree at most, in case of many duplicated points
+const int MaximumDepth = 20;
+
+//-----------------------------------------------------------------------------
+// Node of a nested octree, its points being contiguous in the order of the octree
+struct Node
+{
+  //! Corner and edge length of the cube of the node
+  double Origin[3];
+  double Size;
+  //! Distance between the points of the node, the size of the cells of its grid
+  double Spacing;
+  //! Points of the node in the order of the octree
+  vtkIdType Offset;
+  vtkIdType Count;
+  //! Children of the node, which are contiguous
+  int FirstChild;
+  int NumberOfChildren;
+};
+}
+
+//-----------------------------------------------------------------------------
+// Nested octree of a polydata, built again when the polydata is modified
+struct vtkPointCloudLOD::Octree
+{
+  vtkSmartPointer<vtkPolyData> Data;
+  vtkMTimeType BuildTime = 0;
+  int GridResolution = 0;
+  std::vector<Node> Nodes;
+  std::vector<vtkIdType> Order;
+
+  void Build(vtkPolyData* data, int gridResolution);
+};
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudLOD::Octree::Build(vtkPolyData* data, int gridResolution)
+{
+  this->Data = data;
+  this->BuildTime = data->GetMTime();
+  this->GridResolution = gridResolution;
+  this->Nodes.clear();
+  this->Order.clear();
+
+  // The root is the cube of the finite points
+  const vtkIdType numberOfPoints = data->GetNumberOfPoints();
+  std::vector<vtkIdType> rootPoints;
+  rootPoints.reserve(numberOfPoints);
+  double minimum[3] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                        std::numeric_limits<double>::max() };
+  double maximum[3] = { std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest(),
+                        std::numeric_limits<double>::lowest() };
+  double point[3];
+  for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    data->GetPoint(pointIndex, point);
+    if (!std::isfinite(point[0]) || !std::isfinite(point[1]) || !std::isfinite(point[2]))
+    {
+      continue;
+    }
+    rootPoints.push_back(pointIndex);
+    for (int i = 0; i < 3; ++i)
+    {
+      minimum[i] = std::min(minimum[i], point[i]);
+      maximum[i] = std::max(maximum[i], point[i]);
+    }
+  }
+  if (rootPoints.empty())
+  {
+    return;
+  }
+  this->Order.reserve(rootPoints.size());
+
+  // The cube is slightly larger than the points so that the last cells contain the maximum
+  const double size = std::max(1e-6, 1.001 * std::max(maximum[0] - minimum[0],
+    std::max(maximum[1] - minimum[1], maximum[2] - minimum[2])));
+  Node root;
+  std::copy(minimum, minimum + 3, root.Origin);
+  root.Size = size;
+  this->Nodes.push_back(root);
+
+  // The nodes are processed depth first, a node keeping the first point of each
+  // cell of its grid and giving the other ones to its children. The occupied cells
+  // are marked with the index of the node, so that the grid is never cleared
+  const int cellsPerNode = gridResolution * gridResolution * gridResolution;
+  std::vector<int> cellMarks(cellsPerNode, -1);
+  std::vector<std::vector<vtkIdType> > pendingPoints(1);
+  pendingPoints[0].swap(rootPoints);
+  std::vector<std::pair<int, int> > stack(1, std::make_pair(0, 0));
+  while (!stack.empty())
+  {
+    const int nodeIndex = stack.back().first;
+    const int depth = stack.back().second;
+    stack.pop_back();
+    std::vector<vtkIdType> nodePoints;
+    nodePoints.swap(pendingPoints[nodeIndex]);
+
+    Node node = this->Nodes[nodeIndex];
+    node.Spacing = node.Size / gridResolution;
+    node.Offset = static_cast<vtkIdType>(this->Order.size());
+    node.FirstChild = -1;
+    node.NumberOfChildren = 0;
+
+    if (static_cast<vtkIdType>(nodePoints.size()) <= MaximumLeafPoints || depth == MaximumDepth)
+    {
+      this->Order.insert(this->Order.end(), nodePoints.begin(), nodePoints.end());
+      node.Count = static_cast<vtkIdType>(nodePoints.size());
+      this->Nodes[nodeIndex] = node;
+      continue;
+    }
+
+    std::array<std::vector<vtkIdType>, 8> octants;
+    const double halfSize = 0.5 * node.Size;
+    for (vtkIdType pointIndex : nodePoints)
+    {
+      data->GetPoint(pointIndex, point);
+      int cell = 0;
+      int octant = 0;
+      for (int i = 2; i >= 0; --i)
+      {
+        const double local = point[i] - node.Origin[i];
+        const int index = std::min(gridResolution - 1, std::max(0,
+          static_cast<int>(local / node.Spacing)));
+        cell = cell * gridResolution + index;
+        octant = 2 * octant + (local >= halfSize ? 1 : 0);
+      }
+      if (cellMarks[cell] != nodeIndex)
+      {
+        cellMarks[cell] = nodeIndex;
+        this->Order.push_back(pointIndex);
+      }
+      else
+      {
+        octants[octant].push_back(pointIndex);
+      }
+    }
+    node.Count = static_cast<vtkIdType>(this->Order.size()) - node.Offset;
+
+    // The children are created together so that they are contiguous, and pushed
+    // in reverse order so that the first one is processed first
+    node.FirstChild = static_cast<int>(this->Nodes.size());
+    for (int octant = 0; octant < 8; ++octant)
+    {
+      if (octants[octant].empty())
+      {
+        continue;
+      }
+      Node child;
+      for (int i = 0; i < 3; ++i)
+      {
+        child.Origin[i] = node.Origin[i] + (((octant >> i) & 1) ? halfSize : 0.);
+      }
+      child.Size = halfSize;
+      this->Nodes.push_back(child);
+      pendingPoints.emplace_back();
+      pendingPoints.back().swap(octants[octant]);
+      node.NumberOfChildren++;
+    }
+    for (int child = node.NumberOfChildren - 1; child >= 0; --child)
+    {
+      stack.push_back(std::make_pair(node.FirstChild + child, depth + 1));
+    }
+    this->Nodes[nodeIndex] = node;
+  }
+}
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkPointCloudLOD)
+
+//-----------------------------------------------------------------------------
+int vtkPointCloudLOD::FillInputPortInformation(int vtkNotUsed(port), vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  info->Append(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkCompositeDataSet");
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkPointCloudLOD::RequestData(vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector, vtkInformationVector *outputVector)
+{
+  VV_TRACE_SCOPE("vtkPointCloudLOD::RequestData");
+  vtkDataObject* input = vtkDataObject::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+
+  // The clouds are the polydata input, or the polydata leaves of the composite input
+  std::vector<vtkPolyData*> clouds;
+  if (vtkPolyData* polyData = vtkPolyData::SafeDownCast(input))
+  {
+    clouds.push_back(polyData);
+  }
+  else if (vtkCompositeDataSet* composite = vtkCompositeDataSet::SafeDownCast(input))
+  {
+    vtkSmartPointer<vtkCompositeDataIterator> iterator;
+    iterator.TakeReference(composite->NewIterator());
+    for (iterator->InitTraversal(); !iterator->IsDoneWithTraversal(); iterator->GoToNextItem())
+    {
+      vtkPolyData* polyData = vtkPolyData::SafeDownCast(iterator->GetCurrentDataObject());
+      if (polyData && polyData->GetNumberOfPoints() > 0)
+      {
+        clouds.push_back(polyData);
+      }
+    }
+  }
+
+  // Only the octrees of the new or modified clouds are built, in parallel
+  std::map<vtkPolyData*, std::shared_ptr<Octree> > octrees;
+  std::vector<std::shared_ptr<Octree> > cloudOctrees;
+  std::vector<std::shared_ptr<Octree> > octreesToBuild;
+  for (vtkPolyData* cloud : clouds)
+  {
+    std::shared_ptr<Octree>& octree = octrees[cloud];
+    if (!octree)
+    {
+      auto previous = this->Octrees.find(cloud);
+      if (previous != this->Octrees.end() && previous->second->BuildTime == cloud->GetMTime() &&
+          previous->second->GridResolution == this->GridResolution)
+      {
+        octree = previous->second;
+      }
+      else
+      {
+        octree = std::make_shared<Octree>();
+        octree->Data = cloud;
+        octreesToBuild.push_back(octree);
+      }
+    }
+    cloudOctrees.push_back(octree);
+  }
+  // the octrees of the clouds which are not in the input anymore are released
+  this->Octrees.swap(octrees);
+
+  const int numberOfThreads = GetNumberOfThreads(this->NumberOfThreads);
+  if (!octreesToBuild.empty())
+  {
+    const int numberOfRanges = std::max<int>(1,
+      std::min<size_t>(numberOfThreads, octreesToBuild.size()));
+    ParallelFor(octreesToBuild.size(), numberOfRanges, [&](size_t, size_t begin, size_t end) {
+      for (size_t index = begin; index < end; ++index)
+      {
+        octreesToBuild[index]->Build(octreesToBuild[index]->Data, this->GridResolution);
+      }
+    });
+  }
+
+  // The nodes are loaded by decreasing error from the roots, the children of a
+  // node being candidates once it is loaded. The ties are broken by cloud and
+  // node index so that the selection does not depend on the order of the queue
+  const double pixelsPerRadian = this->ViewportHeight /
+    (2. * std::tan(0.5 * vtkMath::RadiansFromDegrees(this->CameraViewAngle)));
+  auto error = [&](const Node& node) {
+    if (!this->UseCamera)
+    {
+      return node.Spacing;
+    }
+    double squaredDistance = 0.;
+    for (int i = 0; i < 3; ++i)
+    {
+      const double delta = std::max(0., std::max(node.Origin[i] - this->CameraPosition[i],
+        this->CameraPosition[i] - node.Origin[i] - node.Size));
+      squaredDistance += delta * delta;
+    }
+    const double distance = std::max(node.Spacing, std::sqrt(squaredDistance));
+    return node.Spacing * pixelsPerRadian / distance;
+  };
+  typedef std::tuple<double, int, int> Candidate;
+  auto lowerPriority = [](const Candidate& a, const Candidate& b) {
+    if (std::get<0>(a) != std::get<0>(b))
+    {
+      return std::get<0>(a) < std::get<0>(b);
+    }
+    return std::make_pair(std::get<1>(a), std::get<2>(a)) > std::make_pair(std::get<1>(b), std::get<2>(b));
+  };
+  std::priority_queue<Candidate, std::vector<Candidate>, decltype(lowerPriority)> candidates(lowerPriority);
+  for (size_t cloud = 0; cloud < cloudOctrees.size(); ++cloud)
+  {
+    if (!cloudOctrees[cloud]->Nodes.empty())
+    {
+      candidates.push(Candidate(error(cloudOctrees[cloud]->Nodes[0]), static_cast<int>(cloud), 0));
+    }
+  }
+  std::vector<std::pair<int, int> > selectedNodes;
+  vtkIdType numberOfOutputPoints = 0;
+  while (!candidates.empty())
+  {
+    const Candidate candidate = candidates.top();
+    candidates.pop();
+    if (this->UseCamera && std::get<0>(candidate) < this->MaximumScreenSpaceError)
+    {
+      break;
+    }
+    const Octree& octree = *cloudOctrees[std::get<1>(candidate)];
+    const Node& node = octree.Nodes[std::get<2>(candidate)];
+    // a node which does not fit is skipped with its children, smaller nodes may still fit
+    if (numberOfOutputPoints + node.Count > this->PointBudget)
+    {
+      continue;
+    }
+    numberOfOutputPoints += node.Count;
+    selectedNodes.push_back(std::make_pair(std::get<1>(candidate), std::get<2>(candidate)));
+    for (int child = node.FirstChild; child < node.FirstChild + node.NumberOfChildren; ++child)
+    {
+      candidates.push(Candidate(error(octree.Nodes[child]), std::get<1>(candidate), child));
+    }
+  }
+  // the points of a cloud are read in the order of its octree
+  std::sort(selectedNodes.begin(), selectedNodes.end());
+
+  // The output has the point data arrays which all the clouds have
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  if (!clouds.empty() && clouds[0]->GetPoints())
+  {
+    points->SetDataType(clouds[0]->GetPoints()->GetDataType());
+  }
+  points->SetNumberOfPoints(numberOfOutputPoints);
+  std::vector<vtkSmartPointer<vtkDataArray> > outputArrays;
+  std::vector<std::vector<vtkDataArray*> > inputArrays;
+  if (!clouds.empty())
+  {
+    vtkPointData* firstPointData = clouds[0]->GetPointData();
+    for (int arrayIndex = 0; arrayIndex < firstPointData->GetNumberOfArrays(); ++arrayIndex)
+    {
+      vtkDataArray* firstArray = firstPointData->GetArray(arrayIndex);
+      if (!firstArray || !firstArray->GetName())
+      {
+        continue;
+      }
+      std::vector<vtkDataArray*> cloudArrays;
+      for (vtkPolyData* cloud : clouds)
+      {
+        vtkDataArray* cloudArray = cloud->GetPointData()->GetArray(firstArray->GetName());
+        if (!cloudArray || cloudArray->GetNumberOfComponents() != firstArray->GetNumberOfComponents())
+        {
+          break;
+        }
+        cloudArrays.push_back(cloudArray);
+      }
+      if (cloudArrays.size() != clouds.size())
+      {
+        continue;
+      }
+      vtkSmartPointer<vtkDataArray> outputArray;
+      outputArray.TakeReference(firstArray->NewInstance());
+      outputArray->SetName(firstArray->GetName());
+      outputArray->SetNumberOfComponents(firstArray->GetNumberOfComponents());
+      outputArray->SetNumberOfTuples(numberOfOutputPoints);
+      outputArrays.push_back(outputArray);
+      inputArrays.push_back(cloudArrays);
+    }
+  }
+
+  // Each range of selected nodes is copied by a thread
+  std::vector<vtkIdType> outputOffsets(selectedNodes.size() + 1, 0);
+  for (size_t index = 0; index < selectedNodes.size(); ++index)
+  {
+    const Octree& octree = *cloudOctrees[selectedNodes[index].first];
+    outputOffsets[index + 1] = outputOffsets[index] + octree.Nodes[selectedNodes[index].second].Count;
+  }
+  const int numberOfRanges = std::max<int>(1, std::min<vtkIdType>(
+    std::min<vtkIdType>(numberOfThreads, selectedNodes.size()), numberOfOutputPoints / MinimumPointsPerThread));
+  ParallelFor(selectedNodes.size(), numberOfRanges, [&](size_t, size_t begin, size_t end) {
+    double point[3];
+    for (size_t index = begin; index < end; ++index)
+    {
+      const int cloud = selectedNodes[index].first;
+      const Octree& octree = *cloudOctrees[cloud];
+      const Node& node = octree.Nodes[selectedNodes[index].second];
+      vtkIdType outputIndex = outputOffsets[index];
+      for (vtkIdType order = node.Offset; order < node.Offset + node.Count; ++order, ++outputIndex)
+      {
+        const vtkIdType pointIndex = octree.Order[order];
+        clouds[cloud]->GetPoint(pointIndex, point);
+        points->SetPoint(outputIndex, point);
+        for (size_t arrayIndex = 0; arrayIndex < outputArrays.size(); ++arrayIndex)
+        {
+          outputArrays[arrayIndex]->SetTuple(outputIndex, pointIndex, inputArrays[arrayIndex][cloud]);
+        }
+      }
+    }
+  });
+
+  vtkSmartPointer<vtkIdTypeArray> cells = vtkSmartPointer<vtkIdTypeArray>::New();
+  cells->SetNumberOfValues(2 * numberOfOutputPoints);
+  vtkIdType* ids = cells->GetPointer(0);
+  for (vtkIdType i = 0; i < numberOfOutputPoints; ++i)
+  {
+    ids[2 * i] = 1;
+    ids[2 * i + 1] = i;
+  }
+  vtkSmartPointer<vtkCellArray> verts = vtkSmartPointer<vtkCellArray>::New();
+  verts->SetCells(numberOfOutputPoints, cells);
+
+  output->SetPoints(points);
+  output->SetVerts(verts);
+  for (size_t arrayIndex = 0; arrayIndex < outputArrays.size(); ++arrayIndex)
+  {
+    output->GetPointData()->AddArray(outputArrays[arrayIndex]);
+  }
+  if (!clouds.empty())
+  {
+    vtkDataArray* scalars = clouds[0]->GetPointData()->GetScalars();
+    if (scalars && scalars->GetName() && output->GetPointData()->GetArray(scalars->GetName()))
+    {
+      output->GetPointData()->SetActiveScalars(scalars->GetName());
+    }
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkPointCloudLOD::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "PointBudget: " << this->PointBudget << std::endl;
+  os << indent << "GridResolution: " << this->GridResolution << std::endl;
+  os << indent << "UseCamera: " << this->UseCamera << std::endl;
+  os << indent << "CameraPosition: " << this->CameraPosition[0] << " " << this->CameraPosition[1]
+     << " " << this->CameraPosition[2] << std::endl;
+  os << indent << "CameraViewAngle: " << this->CameraViewAngle << std::endl;
+  os << indent << "ViewportHeight: " << this->ViewportHeight << std::endl;
+  os << indent << "MaximumScreenSpaceError: " << this->MaximumScreenSpaceError << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+}
@@ -0,0 +1,142 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_POINT_CLOUD_LOD_H
+#define VTK_POINT_CLOUD_LOD_H
+
+// VTK
+#include <vtkPolyDataAlgorithm.h>
+
+// STD
+#include <map>
+#include <memory>
+
+class vtkPolyData;
+
+/**
+ * @brief vtkPointCloudLOD reduce a large point cloud (a polydata, or the blocks of the
+ * trailing frames) to at most PointBudget points to render, keeping more points where
+ * they cover more pixels.
+ *
+ * The points of each polydata are organized in a nested octree: a node keeps at most one
+ * point per cell of a GridResolution^3 grid, the other points of the node going to its
+ * children. The nodes are then loaded from the root by decreasing screen space error, the
+ * spacing of their points projected on the screen from CameraPosition, until the budget is
+ * reached or the error of all the remaining nodes is below MaximumScreenSpaceError. Without
+ * camera the nodes are loaded by decreasing spacing until the budget is reached, which
+ * samples the clouds uniformly.
+ *
+ * The octree of a polydata is only built again when it is modified, so that moving the
+ * camera or adding a trailing frame only selects the nodes again
+ */
+class VTK_EXPORT vtkPointCloudLOD : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkPointCloudLOD *New();
+  vtkTypeMacro(vtkPointCloudLOD, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Get the maximum number of output points
+  vtkGetMacro(PointBudget, vtkIdType)
+
+  /// Set the maximum number of output points
+  vtkSetMacro(PointBudget, vtkIdType)
+
+  /// Get the number of cells along each axis of the sampling grid of a node
+  vtkGetMacro(GridResolution, int)
+
+  /// Set the number of cells along each axis of the sampling grid of a node
+  vtkSetClampMacro(GridResolution, int, 4, 128)
+
+  /// Get the option to compute the screen space error from the camera
+  vtkGetMacro(UseCamera, bool)
+
+  /// Set the option to compute the screen space error from the camera
+  vtkSetMacro(UseCamera, bool)
+
+  /// Get the position of the camera
+  vtkGetVector3Macro(CameraPosition, double)
+
+  /// Set the position of the camera
+  vtkSetVector3Macro(CameraPosition, double)
+
+  /// Get the vertical view angle of the camera, in degrees
+  vtkGetMacro(CameraViewAngle, double)
+
+  /// Set the vertical view angle of the camera, in degrees
+  vtkSetMacro(CameraViewAngle, double)
+
+  /// Get the height of the viewport, in pixels
+  vtkGetMacro(ViewportHeight, int)
+
+  /// Set the height of the viewport, in pixels
+  vtkSetMacro(ViewportHeight, int)
+
+  /// Get the screen space error under which a node is not loaded, in pixels, with the camera
+  vtkGetMacro(MaximumScreenSpaceError, double)
+
+  /// Set the screen space error under which a node is not loaded, in pixels, with the camera
+  vtkSetMacro(MaximumScreenSpaceError, double)
+
+  /// Get the number of threads building the octrees
+  vtkGetMacro(NumberOfThreads, int)
+
+  /// Set the number of threads building the octrees, 0 uses one thread per core
+  vtkSetMacro(NumberOfThreads, int)
+
+  struct Octree;
+
+protected:
+  vtkPointCloudLOD() = default;
+  ~vtkPointCloudLOD() = default;
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkPointCloudLOD(const vtkPointCloudLOD&) = delete;
+  void operator=(const vtkPointCloudLOD&) = delete;
+
+  /// maximum number of output points
+  vtkIdType PointBudget = 5000000;
+
+  /// number of cells along each axis of the sampling grid of a node
+  int GridResolution = 32;
+
+  /// compute the screen space error from the camera
+  bool UseCamera = false;
+
+  /// position of the camera
+  double CameraPosition[3] = {0, 0, 0};
+
+  /// vertical view angle of the camera, in degrees
+  double CameraViewAngle = 30.;
+
+  /// height of the viewport, in pixels
+  int ViewportHeight = 1000;
+
+  /// screen space error under which a node is not loaded, in pixels
+  double MaximumScreenSpaceError = 1.;
+
+  /// number of threads building the octrees
+  int NumberOfThreads = 0;
+
+  /// octree of each polydata of the last input
+  std::map<vtkPolyData*, std::shared_ptr<Octree> > Octrees;
+};
+
+#endif // VTK_POINT_CLOUD_LOD_H
@@ -16,11 +16,18 @@
 
 // LOCAL
 #include "vtkPointCloudLinearProjector.h"
+#include "ParallelPoints.h"
+#include "TraceEvents.h"
 #include "vtkEigenTools.h"
 
 // STD
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <numeric>
 #include <sstream>
 #include <cmath>
 
@@ -75,28 +82,50 @@ int vtkPointCloudLinearProjector::RequestInformation(vtkInformation *vtkNotUsed(
 int vtkPointCloudLinearProjector::RequestData(vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkPointCloudLinearProjector::RequestData");
   // Get the input
   vtkPolyData * input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
-
-  double point[3];
-  Eigen::Vector3d X;
-
-  auto transformedPoints = vtkSmartPointer<vtkPoints>::New();
-  transformedPoints->Resize(input->GetNumberOfPoints());
-  // Transform the input polydata
-  for (vtkIdType pointIndex = 0; pointIndex < input->GetNumberOfPoints(); ++pointIndex)
+  const vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  const size_t numberOfPixels = static_cast<size_t>(this->Dimensions[0]) * this->Dimensions[1];
+  const int numberOfThreads = GetNumberOfThreads(this->NumberOfThreads);
+
+  // Transform the input points, each range of points computing its bounding box
+  std::vector<double> transformed(3 * numberOfPoints);
+  const int numberOfPointRanges = GetNumberOfPointRanges(numberOfThreads, numberOfPoints);
+  std::array<double, 6> emptyBounds;
+  for (int i = 0; i < 3; ++i)
   {
-    input->GetPoint(pointIndex, point);
-    X << point[0], point[1], point[2];
-    X = this->Projector * X;
-    point[0] = X(0); point[1] = X(1); point[2] = X(2);
-    transformedPoints->SetPoint(pointIndex, point);
+    emptyBounds[2 * i] = std::numeric_limits<double>::max();
+    emptyBounds[2 * i + 1] = std::numeric_limits<double>::lowest();
+  }
+  std::array<double, 6> boundingBox = { { 0, 0, 0, 0, 0, 0 } };
+  if (numberOfPoints > 0)
+  {
+    const PointCoordinates coordinates(input->GetPoints());
+    boundingBox = ParallelReduce(numberOfPoints, numberOfPointRanges, emptyBounds,
+      [&](std::array<double, 6>& bounds, size_t begin, size_t end) {
+        double point[3];
+        for (size_t pointIndex = begin; pointIndex < end; ++pointIndex)
+        {
+          coordinates.Get(pointIndex, point);
+          for (int i = 0; i < 3; ++i)
+          {
+            const double value = this->Projector(i, 0) * point[0] +
+              this->Projector(i, 1) * point[1] + this->Projector(i, 2) * point[2];
+            transformed[3 * pointIndex + i] = value;
+            bounds[2 * i] = std::min(bounds[2 * i], value);
+            bounds[2 * i + 1] = std::max(bounds[2 * i + 1], value);
+          }
+        }
+      },
+      [](std::array<double, 6>& result, const std::array<double, 6>& bounds) {
+        for (int i = 0; i < 3; ++i)
+        {
+          result[2 * i] = std::min(result[2 * i], bounds[2 * i]);
+          result[2 * i + 1] = std::max(result[2 * i + 1], bounds[2 * i + 1]);
+        }
+      });
   }
-  transformedPoints->Modified();
-
-  // Get the point cloud bounding box parameters
-  double boundingBox[6];
-  transformedPoints->GetBounds(boundingBox);
   this->Spacing[0] = (boundingBox[1] - boundingBox[0]) / static_cast<double>(this->Dimensions[0]);
   this->Spacing[1] = (boundingBox[3] - boundingBox[2]) / static_cast<double>(this->Dimensions[1]);
 
@@ -106,42 +135,59 @@ int vtkPointCloudLinearProjector::RequestData(vtkInformation *vtkNotUsed(request
   image->SetSpacing(this->Spacing);
   image->SetOrigin(this->Origin);
   image->AllocateScalars(VTK_DOUBLE, 1);
-  unsigned char* dataPointer = reinterpret_cast<unsigned char*>(image->GetScalarPointer());
-  std::fill(dataPointer, dataPointer + this->Dimensions[0] * this->Dimensions[1], 0);
-
-  // Compute distribution about the height of the data lying in a pixel
-  std::vector<std::vector<double> > perPixelDistribution(this->Dimensions[0] * this->Dimensions[1]);
-  double scaleX = (this->Dimensions[0] - 1) / (boundingBox[1] - boundingBox[0]);
-  double scaleY = (this->Dimensions[1] - 1) / (boundingBox[3] - boundingBox[2]);
-  for (vtkIdType pointIndex = 0; pointIndex < input->GetNumberOfPoints(); ++pointIndex)
+  double* pixels = static_cast<double*>(image->GetScalarPointer());
+  std::fill(pixels, pixels + numberOfPixels, 0.);
+
+  // Pixel of each point, a flat bounding box gives a single column or row
+  const double scaleX = boundingBox[1] > boundingBox[0] ?
+    (this->Dimensions[0] - 1) / (boundingBox[1] - boundingBox[0]) : 0.;
+  const double scaleY = boundingBox[3] > boundingBox[2] ?
+    (this->Dimensions[1] - 1) / (boundingBox[3] - boundingBox[2]) : 0.;
+  std::vector<unsigned int> pointPixels(numberOfPoints);
+  ParallelFor(numberOfPoints, numberOfPointRanges, [&](size_t, size_t begin, size_t end) {
+    for (size_t pointIndex = begin; pointIndex < end; ++pointIndex)
+    {
+      const int xPixelCoord = std::floor((transformed[3 * pointIndex] - boundingBox[0]) * scaleX);
+      const int yPixelCoord = std::floor((transformed[3 * pointIndex + 1] - boundingBox[2]) * scaleY);
+      pointPixels[pointIndex] = xPixelCoord + this->Dimensions[0] * yPixelCoord;
+    }
+  });
+
+  // Gather the heights of the points of each pixel in a single array, the
+  // heights of the pixel k being in [offsets[k], offsets[k + 1][
+  std::vector<size_t> offsets(numberOfPixels + 1, 0);
+  for (unsigned int pixel : pointPixels)
   {
-    transformedPoints->GetPoint(pointIndex, point);
-    int xPixelCoord = std::floor((point[0] - boundingBox[0]) * scaleX);
-    int yPixelCoord = std::floor((point[1] - boundingBox[2]) * scaleY);
-    perPixelDistribution[xPixelCoord + this->Dimensions[0] * yPixelCoord].push_back(point[2]);
+    offsets[pixel + 1]++;
   }
-
-  // fill the image
-  for (int x = 0; x < this->Dimensions[0]; ++x)
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<double> heights(numberOfPoints);
   {
-    for (int y = 0; y < this->Dimensions[1]; ++y)
+    std::vector<size_t> cursors(offsets.begin(), offsets.end() - 1);
+    for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+    {
+      heights[cursors[pointPixels[pointIndex]]++] = transformed[3 * pointIndex + 2];
+    }
+  }
+
+  // fill the image, each range of rows selecting the rank value of its pixels
+  const int numberOfRowRanges = std::min(numberOfThreads, this->Dimensions[1]);
+  ParallelFor(this->Dimensions[1], numberOfRowRanges, [&](size_t, size_t firstRow, size_t lastRow) {
+    for (size_t pixel = firstRow * this->Dimensions[0]; pixel < lastRow * this->Dimensions[0]; ++pixel)
     {
       // if the pixel is empty, skip it
-      if (perPixelDistribution[x + this->Dimensions[0] * y].size() == 0)
+      const size_t count = offsets[pixel + 1] - offsets[pixel];
+      if (count == 0)
       {
         continue;
       }
 
-      // sort the heights values
-      std::sort(perPixelDistribution[x + this->Dimensions[0] * y].begin(),
-                perPixelDistribution[x + this->Dimensions[0] * y].end());
-
-      int rankIndex = std::floor((perPixelDistribution[x + this->Dimensions[0] * y].size() - 1) * this->RankPercentil);
-      double rankValue = perPixelDistribution[x + this->Dimensions[0] * y][rankIndex];
-      double value = rankValue - boundingBox[4];
-      image->SetScalarComponentFromDouble(x, y, 0, 0, value);
+      const int rankIndex = std::floor((count - 1) * this->RankPercentil);
+      double* first = heights.data() + offsets[pixel];
+      std::nth_element(first, first + rankIndex, first + count);
+      pixels[pixel] = first[rankIndex] - boundingBox[4];
     }
-  }
+  });
 
   vtkImageData* outputImage = vtkImageData::GetData(outputVector->GetInformationObject(0));
   outputImage->ShallowCopy(image);
@@ -43,6 +43,9 @@ public:
   vtkGetMacro(RankPercentil, double)
   vtkSetMacro(RankPercentil, double)
 
+  vtkGetMacro(NumberOfThreads, int)
+  vtkSetMacro(NumberOfThreads, int)
+
   // set the plane normal coordinates on which points are projected
   void SetPlaneNormal(double w0, double w1, double w2);
 
@@ -66,6 +69,10 @@ private:
   // percentil to extract when performing rank filter
   double RankPercentil = 0.5;
 
+  // threads transforming the points and filling the rows
+  // of the image, 0 uses one thread per core
+  int NumberOfThreads = 0;
+
   // Information about the projector
   Eigen::Matrix3d DiagonalizedProjector = Eigen::Matrix3d::Identity();
   Eigen::Matrix3d ChangeOfBasis = Eigen::Matrix3d::Identity();
@@ -15,6 +15,8 @@
 // limitations under the License.
 //=========================================================================
 #include "vtkProcessingSample.h"
+#include "ParallelPoints.h"
+#include "TraceEvents.h"
 
 #include "vtkFloatArray.h"
 #include "vtkInformation.h"
@@ -29,8 +31,21 @@
 
 #include <Eigen/Dense>
 
+#include <algorithm>
 #include <limits>
 
+namespace
+{
+//----------------------------------------------------------------------------
+// Accumulated by each range of points, then combined
+struct SampleStatistics
+{
+  Eigen::Vector3d Sum = Eigen::Vector3d::Zero();
+  int MinimumIntensity = std::numeric_limits<int>::max();
+  int MaximumIntensity = 0;
+};
+}
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkProcessingSample)
 
@@ -50,6 +65,7 @@ vtkProcessingSample::~vtkProcessingSample()
 int vtkProcessingSample::RequestData(vtkInformation* vtkNotUsed(request),
   vtkInformationVector** inputVector, vtkInformationVector* outputVector)
 {
+  VV_TRACE_SCOPE("vtkProcessingSample::RequestData");
   vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
   vtkPolyData* input = vtkPolyData::SafeDownCast(inInfo->Get(vtkDataObject::DATA_OBJECT()));
 
@@ -62,14 +78,38 @@ int vtkProcessingSample::RequestData(vtkInformation* vtkNotUsed(request),
     return 1;
   }
 
-  Eigen::Vector3d meanpoints;
-  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); ++i)
-  {
-    Eigen::Vector3d point;
-    points->GetPoint(i, point.data());
-    meanpoints += point;
-  }
-  meanpoints /= points->GetNumberOfPoints();
+  // Get the intensities and laser ids for points
+  const vtkIdType numberOfPoints = points->GetNumberOfPoints();
+  const PointCoordinates coordinates(points);
+  vtkDataArray* intensities = input->GetPointData()->GetArray("intensity");
+  vtkDataArray* laserIds = input->GetPointData()->GetArray("laser_id");
+  const ArrayComponent intensity(intensities);
+  const ArrayComponent laserId(laserIds);
+
+  // Sum the points and compute the max, min intensity for laser 3, each range of points
+  // accumulating in its own statistics
+  const SampleStatistics statistics = ParallelReduce(numberOfPoints,
+    GetNumberOfPointRanges(this->NumberOfThreads, numberOfPoints), SampleStatistics(),
+    [&](SampleStatistics& range, size_t begin, size_t end) {
+      Eigen::Vector3d point;
+      for (size_t i = begin; i < end; ++i)
+      {
+        coordinates.Get(i, point.data());
+        range.Sum += point;
+        if (intensities && laserIds && laserId.Get(i) == 3)
+        {
+          const int pointIntensity = static_cast<int>(intensity.Get(i));
+          range.MinimumIntensity = std::min(range.MinimumIntensity, pointIntensity);
+          range.MaximumIntensity = std::max(range.MaximumIntensity, pointIntensity);
+        }
+      }
+    },
+    [](SampleStatistics& result, const SampleStatistics& range) {
+      result.Sum += range.Sum;
+      result.MinimumIntensity = std::min(result.MinimumIntensity, range.MinimumIntensity);
+      result.MaximumIntensity = std::max(result.MaximumIntensity, range.MaximumIntensity);
+    });
+  Eigen::Vector3d meanpoints = statistics.Sum / static_cast<double>(numberOfPoints);
 
   // Create a sphere at the center location
   vtkNew<vtkSphereSource> spheresource;
@@ -77,38 +117,12 @@ int vtkProcessingSample::RequestData(vtkInformation* vtkNotUsed(request),
   spheresource->SetRadius(0.5);
   spheresource->Update();
 
-  // Get the intensities and laser ids for points
-  vtkUnsignedCharArray* intensities =
-    vtkUnsignedCharArray::SafeDownCast(input->GetPointData()->GetArray("intensity"));
-  vtkUnsignedCharArray* laserid =
-    vtkUnsignedCharArray::SafeDownCast(input->GetPointData()->GetArray("laser_id"));
-
-  // Compute the max, min intensity for laser 3
-  int minimum_intensity = std::numeric_limits<int>::max();
-  int maximum_intensity = 0;
-  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); ++i)
-  {
-    int laser = laserid->GetValue(i);
-    if (laser == 3)
-    {
-      int point_intensity = intensities->GetValue(i);
-      if (point_intensity < minimum_intensity)
-      {
-        minimum_intensity = point_intensity;
-      }
-      if (point_intensity > maximum_intensity)
-      {
-        maximum_intensity = point_intensity;
-      }
-    }
-  }
-
   // Add field data with some numbers
   vtkSmartPointer<vtkFloatArray> fielddata = vtkSmartPointer<vtkFloatArray>::New();
   fielddata->SetName("Values");
   fielddata->SetNumberOfComponents(1);
-  fielddata->InsertNextValue(minimum_intensity);
-  fielddata->InsertNextValue(maximum_intensity);
+  fielddata->InsertNextValue(statistics.MinimumIntensity);
+  fielddata->InsertNextValue(statistics.MaximumIntensity);
 
   vtkSmartPointer<vtkPolyData> outputPolyData = vtkSmartPointer<vtkPolyData>::New();
   outputPolyData->DeepCopy(spheresource->GetOutput());
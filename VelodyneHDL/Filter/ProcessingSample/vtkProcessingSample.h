@@ -32,6 +32,9 @@ public:
 
   static vtkProcessingSample* New();
 
+  vtkGetMacro(NumberOfThreads, int)
+  vtkSetMacro(NumberOfThreads, int)
+
 protected:
   virtual int RequestData(vtkInformation* request, vtkInformationVector** inputVector,
     vtkInformationVector* outputVector);
@@ -42,6 +45,9 @@ protected:
 private:
   vtkProcessingSample(const vtkProcessingSample&); // Not implemented.
   void operator=(const vtkProcessingSample&);      // Not implemented.
+
+  // threads processing the points, 0 uses one thread per core
+  int NumberOfThreads = 0;
 };
 
 #endif
@@ -0,0 +1,113 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "RangeImageNormals.h"
+#include "LidarRangeImage.h"
+#include "ParallelPoints.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// EIGEN
+#include <Eigen/Dense>
+
+namespace
+{
+//! Rows of which a thread estimates the normals at least
+const int MinimumRowsPerThread = 4;
+}
+
+//-----------------------------------------------------------------------------
+void RangeImageNormals::Compute(const LidarRangeImage& image, std::vector<float>& normals,
+                                std::vector<float>& curvatures) const
+{
+  const size_t numberOfPixels = image.Points.size();
+  normals.assign(3 * numberOfPixels, std::numeric_limits<float>::quiet_NaN());
+  curvatures.assign(numberOfPixels, std::numeric_limits<float>::quiet_NaN());
+  const int width = image.Width;
+  // a window wider than the image would count the same pixels twice
+  const int halfWidth = std::max(0, std::min(this->HalfWidth, (width - 1) / 2));
+  const int halfHeight = std::max(0, this->HalfHeight);
+
+  auto computeRows = [&](int firstRow, int lastRow) {
+    for (int row = firstRow; row < lastRow; ++row)
+    {
+      for (int col = 0; col < width; ++col)
+      {
+        const size_t pixel = static_cast<size_t>(row) * width + col;
+        if (image.Points[pixel] < 0)
+        {
+          continue;
+        }
+        const float maxDifference = static_cast<float>(this->MaximumRangeRatio) * image.Ranges[pixel];
+
+        // moments of the neighborhood, relatively to the return for the precision
+        const double cx = image.X[pixel], cy = image.Y[pixel], cz = image.Z[pixel];
+        int count = 0;
+        Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+        Eigen::Matrix3d squares = Eigen::Matrix3d::Zero();
+        for (int r = std::max(0, row - halfHeight); r <= std::min(image.Height - 1, row + halfHeight); ++r)
+        {
+          for (int c = col - halfWidth; c <= col + halfWidth; ++c)
+          {
+            const size_t other = static_cast<size_t>(r) * width + (c + width) % width;
+            if (image.Points[other] < 0 || std::abs(image.Ranges[other] - image.Ranges[pixel]) > maxDifference)
+            {
+              continue;
+            }
+            const Eigen::Vector3d p(image.X[other] - cx, image.Y[other] - cy, image.Z[other] - cz);
+            sum += p;
+            squares.noalias() += p * p.transpose();
+            count++;
+          }
+        }
+        if (count < std::max(this->MinimumNeighbors, 3))
+        {
+          continue;
+        }
+
+        const Eigen::Vector3d mean = sum / count;
+        const Eigen::Matrix3d covariance = squares / count - mean * mean.transpose();
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+        solver.computeDirect(covariance);
+        // the eigenvalues are sorted in increasing order
+        const Eigen::Vector3d eigenvalues = solver.eigenvalues().cwiseMax(0.);
+        Eigen::Vector3d normal = solver.eigenvectors().col(0);
+        if (normal.x() * cx + normal.y() * cy + normal.z() * cz > 0.)
+        {
+          normal = -normal;
+        }
+        const double total = eigenvalues.sum();
+        for (int i = 0; i < 3; ++i)
+        {
+          normals[3 * pixel + i] = static_cast<float>(normal[i]);
+        }
+        curvatures[pixel] = static_cast<float>(total > 0. ? eigenvalues[0] / total : 0.);
+      }
+    }
+  };
+
+  // the pixels are only written by the range of their row
+  const int numberOfRanges = std::max(1, static_cast<int>(std::min<size_t>(
+    GetNumberOfThreads(this->NumberOfThreads), image.Height / MinimumRowsPerThread)));
+  ParallelFor(image.Height, numberOfRanges, [&](size_t, size_t begin, size_t end) {
+    computeRows(static_cast<int>(begin), static_cast<int>(end));
+  });
+}
@@ -0,0 +1,55 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef RANGE_IMAGE_NORMALS_H
+#define RANGE_IMAGE_NORMALS_H
+
+// STD
+#include <vector>
+
+struct LidarRangeImage;
+
+/**
+ * @brief RangeImageNormals estimate the normal and the curvature of the returns of a lidar
+ * frame from their neighbors in its range image, instead of searching them in a kd-tree.
+ * The neighborhood of a return is the window of 2 * HalfWidth + 1 columns and
+ * 2 * HalfHeight + 1 rows around its pixel, the columns wrapping around, without the returns
+ * whose range differs by more than MaximumRangeRatio times its range, which are across a depth
+ * discontinuity. The normal is the eigenvector of the smallest eigenvalue of the covariance of
+ * the neighborhood, oriented toward the sensor, and the curvature is the ratio of this
+ * eigenvalue to their sum, 0 on a plane and 1/3 at most. The rows are processed in parallel.
+ */
+struct RangeImageNormals
+{
+  int HalfWidth = 2;
+  int HalfHeight = 1;
+  double MaximumRangeRatio = 0.2;
+  //! Number of neighbors, the return included, under which the normal is not estimated
+  int MinimumNeighbors = 4;
+  //! 0 uses one thread per core
+  int NumberOfThreads = 0;
+
+  /**
+   * @brief Compute estimate the normals and the curvatures of the pixels of an image, which
+   * are NaN for the pixels without return or with too few neighbors
+   * @param normals the 3 components of the normal of each pixel
+   */
+  void Compute(const LidarRangeImage& image, std::vector<float>& normals,
+               std::vector<float>& curvatures) const;
+};
+
+#endif // RANGE_IMAGE_NORMALS_H
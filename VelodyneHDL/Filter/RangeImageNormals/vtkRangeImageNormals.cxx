@@ -0,0 +1,114 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkRangeImageNormals.h"
+#include "LidarRangeImage.h"
+#include "RangeImageNormals.h"
+#include "TraceEvents.h"
+
+// STD
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// VTK
+#include <vtkFloatArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkRangeImageNormals)
+
+//-----------------------------------------------------------------------------
+int vtkRangeImageNormals::RequestData(vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector, vtkInformationVector *outputVector)
+{
+  VV_TRACE_SCOPE("vtkRangeImageNormals::RequestData");
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+  output->ShallowCopy(input);
+
+  const vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  LidarRangeImage image;
+  if (!image.Build(input, this->Width))
+  {
+    vtkErrorMacro("The input has no laser_id array");
+    return 0;
+  }
+
+  RangeImageNormals estimation;
+  estimation.HalfWidth = this->HalfWidth;
+  estimation.HalfHeight = this->HalfHeight;
+  estimation.MaximumRangeRatio = this->MaximumRangeRatio;
+  estimation.NumberOfThreads = this->NumberOfThreads;
+  std::vector<float> normals;
+  std::vector<float> curvatures;
+  estimation.Compute(image, normals, curvatures);
+
+  // the returns of a pixel get its values, unless they are far from the closest one
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  vtkSmartPointer<vtkFloatArray> normalArray = vtkSmartPointer<vtkFloatArray>::New();
+  normalArray->SetName("Normals");
+  normalArray->SetNumberOfComponents(3);
+  normalArray->SetNumberOfTuples(numberOfPoints);
+  vtkSmartPointer<vtkFloatArray> curvatureArray = vtkSmartPointer<vtkFloatArray>::New();
+  curvatureArray->SetName("curvature");
+  curvatureArray->SetNumberOfValues(numberOfPoints);
+  for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    const vtkIdType pixel = image.PixelOfPoint[pointIndex];
+    bool hasValues = pixel >= 0;
+    if (hasValues && image.Points[pixel] != pointIndex)
+    {
+      double point[3];
+      input->GetPoint(pointIndex, point);
+      const double range = vtkMath::Norm(point);
+      hasValues = std::abs(range - image.Ranges[pixel]) <= this->MaximumRangeRatio * range;
+    }
+    if (hasValues)
+    {
+      normalArray->SetTypedTuple(pointIndex, &normals[3 * pixel]);
+      curvatureArray->SetValue(pointIndex, curvatures[pixel]);
+    }
+    else
+    {
+      const float noNormal[3] = { nan, nan, nan };
+      normalArray->SetTypedTuple(pointIndex, noNormal);
+      curvatureArray->SetValue(pointIndex, nan);
+    }
+  }
+  output->GetPointData()->SetNormals(normalArray);
+  output->GetPointData()->AddArray(curvatureArray);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkRangeImageNormals::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Width: " << this->Width << std::endl;
+  os << indent << "HalfWidth: " << this->HalfWidth << std::endl;
+  os << indent << "HalfHeight: " << this->HalfHeight << std::endl;
+  os << indent << "MaximumRangeRatio: " << this->MaximumRangeRatio << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+}
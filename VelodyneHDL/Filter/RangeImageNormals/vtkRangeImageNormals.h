@@ -0,0 +1,97 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_RANGE_IMAGE_NORMALS_H
+#define VTK_RANGE_IMAGE_NORMALS_H
+
+// VTK
+#include <vtkPolyDataAlgorithm.h>
+
+/**
+ * @brief vtkRangeImageNormals estimate the normal and the curvature of the returns of a
+ * lidar frame from their neighbors in the range image of the sensor, which is linear in the
+ * number of returns and does not need a kd-tree (see RangeImageNormals).
+ *
+ * The frame must be in the sensor reference frame, with a laser_id array. The output gets a
+ * Normals array, oriented toward the sensor and set as the normals of the points, and a
+ * curvature array. A return hidden by a closer one of its pixel gets the values of this pixel
+ * if their ranges are close, NaN otherwise, as do the returns without enough neighbors.
+ */
+class VTK_EXPORT vtkRangeImageNormals : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkRangeImageNormals *New();
+  vtkTypeMacro(vtkRangeImageNormals, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Get the number of columns of the range image
+  vtkGetMacro(Width, int)
+
+  /// Set the number of columns of the range image, about the number of firings per rotation
+  vtkSetClampMacro(Width, int, 1, 36000)
+
+  /// Get the number of columns on each side of a return in its neighborhood
+  vtkGetMacro(HalfWidth, int)
+
+  /// Set the number of columns on each side of a return in its neighborhood
+  vtkSetClampMacro(HalfWidth, int, 1, 16)
+
+  /// Get the number of rows above and below a return in its neighborhood
+  vtkGetMacro(HalfHeight, int)
+
+  /// Set the number of rows above and below a return in its neighborhood
+  vtkSetClampMacro(HalfHeight, int, 1, 8)
+
+  /// Get the relative range difference above which a return is not a neighbor
+  vtkGetMacro(MaximumRangeRatio, double)
+
+  /// Set the relative range difference above which a return is not a neighbor
+  vtkSetClampMacro(MaximumRangeRatio, double, 0., 1.)
+
+  /// Get the number of threads used, 0 for one per core
+  vtkGetMacro(NumberOfThreads, int)
+
+  /// Set the number of threads used, 0 for one per core
+  vtkSetClampMacro(NumberOfThreads, int, 0, 256)
+
+protected:
+  vtkRangeImageNormals() = default;
+  ~vtkRangeImageNormals() = default;
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkRangeImageNormals(const vtkRangeImageNormals&) = delete;
+  void operator=(const vtkRangeImageNormals&) = delete;
+
+  /// number of columns of the range image
+  int Width = 2048;
+
+  /// number of columns on each side of a return in its neighborhood
+  int HalfWidth = 2;
+
+  /// number of rows above and below a return in its neighborhood
+  int HalfHeight = 1;
+
+  /// relative range difference above which a return is not a neighbor
+  double MaximumRangeRatio = 0.2;
+
+  /// number of threads used, 0 for one per core
+  int NumberOfThreads = 0;
+};
+
+#endif // VTK_RANGE_IMAGE_NORMALS_H
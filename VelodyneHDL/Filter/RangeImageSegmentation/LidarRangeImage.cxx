@@ -0,0 +1,130 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "LidarRangeImage.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// VTK
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+
+//-----------------------------------------------------------------------------
+bool LidarRangeImage::Build(vtkPolyData* frame, int width)
+{
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+  vtkDataArray* laserIds = frame->GetPointData()->GetArray("laser_id");
+  if (numberOfPoints > 0 && !laserIds)
+  {
+    return false;
+  }
+  // the azimuth of the interpreters is in hundredths of degree
+  vtkDataArray* azimuths = frame->GetPointData()->GetArray("azimuth");
+
+  // Elevation of each laser, from its returns
+  int numberOfLasers = 0;
+  std::vector<int> laserOfPoint(numberOfPoints);
+  for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    laserOfPoint[pointIndex] = static_cast<int>(laserIds->GetTuple1(pointIndex));
+    numberOfLasers = std::max(numberOfLasers, laserOfPoint[pointIndex] + 1);
+  }
+  std::vector<double> elevationSums(numberOfLasers, 0.);
+  std::vector<vtkIdType> elevationCounts(numberOfLasers, 0);
+  std::vector<float> ranges(numberOfPoints), heights(numberOfPoints), distances(numberOfPoints);
+  std::vector<int> columns(numberOfPoints);
+  double point[3];
+  for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    frame->GetPoint(pointIndex, point);
+    const double distance = std::sqrt(point[0] * point[0] + point[1] * point[1]);
+    ranges[pointIndex] = static_cast<float>(std::sqrt(distance * distance + point[2] * point[2]));
+    heights[pointIndex] = static_cast<float>(point[2]);
+    distances[pointIndex] = static_cast<float>(distance);
+
+    double azimuth = azimuths ? azimuths->GetTuple1(pointIndex) / 100. :
+      vtkMath::DegreesFromRadians(std::atan2(point[1], point[0]));
+    azimuth = std::fmod(azimuth + 360., 360.);
+    columns[pointIndex] = std::min(static_cast<int>(azimuth * width / 360.), width - 1);
+
+    const int laser = laserOfPoint[pointIndex];
+    if (laser >= 0 && ranges[pointIndex] > 0.f && std::isfinite(ranges[pointIndex]))
+    {
+      elevationSums[laser] += std::atan2(point[2], distance);
+      elevationCounts[laser]++;
+    }
+  }
+
+  // Rows of the lasers which have returns, sorted by elevation
+  std::vector<std::pair<double, int> > sorted;
+  for (int laser = 0; laser < numberOfLasers; ++laser)
+  {
+    if (elevationCounts[laser] > 0)
+    {
+      sorted.push_back(std::make_pair(elevationSums[laser] / elevationCounts[laser], laser));
+    }
+  }
+  std::sort(sorted.begin(), sorted.end());
+  this->Width = width;
+  this->Height = static_cast<int>(sorted.size());
+  this->RowElevations.clear();
+  std::vector<int> rowOfLaser(numberOfLasers, -1);
+  for (int row = 0; row < this->Height; ++row)
+  {
+    rowOfLaser[sorted[row].second] = row;
+    this->RowElevations.push_back(sorted[row].first);
+  }
+
+  // Closest return of each pixel
+  const vtkIdType numberOfPixels = static_cast<vtkIdType>(this->Width) * this->Height;
+  this->Points.assign(numberOfPixels, -1);
+  this->Ranges.assign(numberOfPixels, 0.f);
+  this->Heights.assign(numberOfPixels, 0.f);
+  this->Distances.assign(numberOfPixels, 0.f);
+  this->X.assign(numberOfPixels, 0.f);
+  this->Y.assign(numberOfPixels, 0.f);
+  this->Z.assign(numberOfPixels, 0.f);
+  this->PixelOfPoint.assign(numberOfPoints, -1);
+  for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    const int laser = laserOfPoint[pointIndex];
+    if (laser < 0 || rowOfLaser[laser] < 0 || !(ranges[pointIndex] > 0.f) || !std::isfinite(ranges[pointIndex]))
+    {
+      continue;
+    }
+    const vtkIdType pixel = static_cast<vtkIdType>(rowOfLaser[laser]) * this->Width + columns[pointIndex];
+    this->PixelOfPoint[pointIndex] = pixel;
+    if (this->Points[pixel] < 0 || ranges[pointIndex] < this->Ranges[pixel])
+    {
+      this->Points[pixel] = pointIndex;
+      this->Ranges[pixel] = ranges[pointIndex];
+      this->Heights[pixel] = heights[pointIndex];
+      this->Distances[pixel] = distances[pointIndex];
+      frame->GetPoint(pointIndex, point);
+      this->X[pixel] = static_cast<float>(point[0]);
+      this->Y[pixel] = static_cast<float>(point[1]);
+      this->Z[pixel] = static_cast<float>(point[2]);
+    }
+  }
+  return true;
+}
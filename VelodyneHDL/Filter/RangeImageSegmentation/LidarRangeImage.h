@@ -0,0 +1,63 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef LIDAR_RANGE_IMAGE_H
+#define LIDAR_RANGE_IMAGE_H
+
+// STD
+#include <vector>
+
+// VTK
+#include <vtkType.h>
+
+class vtkPolyData;
+
+/**
+ * @brief LidarRangeImage closest return of each pixel of the range image of a lidar frame,
+ * the rows being the lasers sorted by elevation, the lowest one first, and the columns the
+ * azimuths. The frame must be in the sensor reference frame, with a laser_id array (the
+ * azimuth array of the interpreters is used when present).
+ *
+ * The neighbors of a return in the image are the returns of the adjacent azimuths of its
+ * laser and the returns of the lasers above and below at the same azimuth, which is what
+ * the range image filters use instead of a kd-tree.
+ */
+struct LidarRangeImage
+{
+  int Width = 0;
+  int Height = 0;
+  //! Elevation of each row, in radians
+  std::vector<double> RowElevations;
+  //! Point of each pixel, -1 if the pixel has no return
+  std::vector<vtkIdType> Points;
+  //! Range, height and horizontal distance of the return of each pixel
+  std::vector<float> Ranges;
+  std::vector<float> Heights;
+  std::vector<float> Distances;
+  //! Coordinates of the return of each pixel
+  std::vector<float> X, Y, Z;
+  //! Pixel of each point of the frame, -1 if the point is not in the image
+  std::vector<vtkIdType> PixelOfPoint;
+
+  /**
+   * @brief Build project a frame in an image of width columns
+   * @return false if the frame has points but no laser_id array
+   */
+  bool Build(vtkPolyData* frame, int width);
+};
+
+#endif // LIDAR_RANGE_IMAGE_H
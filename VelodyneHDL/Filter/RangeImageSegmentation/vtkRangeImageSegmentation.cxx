@@ -0,0 +1,216 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkRangeImageSegmentation.h"
+#include "LidarRangeImage.h"
+#include "TraceEvents.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+// VTK
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkIntArray.h>
+#include <vtkMath.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Walk each column from the lowest row, a return being ground if the slope between it
+// and the last ground return is small. The first ground return of a column must also
+// have a small slope with the next return, so that an obstacle seen by the lowest
+// laser is not taken for ground
+void LabelGround(const LidarRangeImage& image, double maxSlope, std::vector<unsigned char>& ground)
+{
+  ground.assign(image.Points.size(), 0);
+  const double maxTangent = std::tan(maxSlope);
+  auto isFlat = [&](vtkIdType from, vtkIdType to) {
+    return std::abs(image.Heights[to] - image.Heights[from]) <=
+      maxTangent * std::abs(image.Distances[to] - image.Distances[from]);
+  };
+
+  std::vector<vtkIdType> column;
+  for (int col = 0; col < image.Width; ++col)
+  {
+    column.clear();
+    for (int row = 0; row < image.Height; ++row)
+    {
+      const vtkIdType pixel = static_cast<vtkIdType>(row) * image.Width + col;
+      if (image.Points[pixel] >= 0)
+      {
+        column.push_back(pixel);
+      }
+    }
+
+    vtkIdType lastGround = -1;
+    for (size_t k = 0; k < column.size(); ++k)
+    {
+      const bool isGround = lastGround < 0 ? k + 1 < column.size() && isFlat(column[k], column[k + 1])
+                                           : isFlat(lastGround, column[k]);
+      if (isGround)
+      {
+        ground[column[k]] = 1;
+        lastGround = column[k];
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Breadth-first search of the connected components of the non ground returns, two
+// neighbor returns being connected if the angle between the line joining them and
+// the beam of the farthest one is large enough. The columns wrap around. Each pixel
+// gets the index of its component, or -1
+int LabelComponents(const LidarRangeImage& image, const std::vector<unsigned char>& ground,
+                    double clusteringAngle, std::vector<int>& components, std::vector<vtkIdType>& sizes)
+{
+  const vtkIdType numberOfPixels = static_cast<vtkIdType>(image.Points.size());
+  components.assign(numberOfPixels, -1);
+  sizes.clear();
+  const double tanThreshold = std::tan(clusteringAngle);
+  const double columnAngle = 2. * vtkMath::Pi() / image.Width;
+
+  // tan of the angle between the line joining two returns psi radians apart and the
+  // beam of the farthest one
+  auto isConnected = [&](vtkIdType a, vtkIdType b, double psi) {
+    const double d1 = std::max(image.Ranges[a], image.Ranges[b]);
+    const double d2 = std::min(image.Ranges[a], image.Ranges[b]);
+    const double along = d1 - d2 * std::cos(psi);
+    const double across = d2 * std::sin(psi);
+    return along <= 0. || across > tanThreshold * along;
+  };
+
+  std::vector<vtkIdType> queue;
+  queue.reserve(numberOfPixels);
+  for (vtkIdType seed = 0; seed < numberOfPixels; ++seed)
+  {
+    if (image.Points[seed] < 0 || ground[seed] || components[seed] >= 0)
+    {
+      continue;
+    }
+    const int component = static_cast<int>(sizes.size());
+    components[seed] = component;
+    queue.clear();
+    queue.push_back(seed);
+    for (size_t head = 0; head < queue.size(); ++head)
+    {
+      const vtkIdType pixel = queue[head];
+      const int row = static_cast<int>(pixel / image.Width);
+      const int col = static_cast<int>(pixel % image.Width);
+      const std::pair<vtkIdType, double> neighbors[4] = {
+        { static_cast<vtkIdType>(row) * image.Width + (col + 1) % image.Width, columnAngle },
+        { static_cast<vtkIdType>(row) * image.Width + (col + image.Width - 1) % image.Width, columnAngle },
+        { row + 1 < image.Height ? pixel + image.Width : -1,
+          row + 1 < image.Height ? image.RowElevations[row + 1] - image.RowElevations[row] : 0. },
+        { row > 0 ? pixel - image.Width : -1,
+          row > 0 ? image.RowElevations[row] - image.RowElevations[row - 1] : 0. } };
+      for (const std::pair<vtkIdType, double>& neighbor : neighbors)
+      {
+        const vtkIdType other = neighbor.first;
+        if (other < 0 || image.Points[other] < 0 || ground[other] || components[other] >= 0 ||
+            !isConnected(pixel, other, neighbor.second))
+        {
+          continue;
+        }
+        components[other] = component;
+        queue.push_back(other);
+      }
+    }
+    sizes.push_back(static_cast<vtkIdType>(queue.size()));
+  }
+  return static_cast<int>(sizes.size());
+}
+}
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkRangeImageSegmentation)
+
+//-----------------------------------------------------------------------------
+int vtkRangeImageSegmentation::RequestData(vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector, vtkInformationVector *outputVector)
+{
+  VV_TRACE_SCOPE("vtkRangeImageSegmentation::RequestData");
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+  output->ShallowCopy(input);
+  this->NumberOfClusters = 0;
+
+  const vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  LidarRangeImage image;
+  if (!image.Build(input, this->Width))
+  {
+    vtkErrorMacro("The input has no laser_id array");
+    return 0;
+  }
+  const std::vector<vtkIdType>& pixelOfPoint = image.PixelOfPoint;
+
+  std::vector<unsigned char> ground;
+  LabelGround(image, vtkMath::RadiansFromDegrees(this->MaxGroundSlope), ground);
+  std::vector<int> components;
+  std::vector<vtkIdType> sizes;
+  const int numberOfComponents = LabelComponents(image, ground,
+    vtkMath::RadiansFromDegrees(this->ClusteringAngle), components, sizes);
+
+  // the small components are dropped, the others numbered in order
+  std::vector<int> clusterOfComponent(numberOfComponents, -1);
+  for (int component = 0; component < numberOfComponents; ++component)
+  {
+    if (sizes[component] >= this->MinimumClusterSize)
+    {
+      clusterOfComponent[component] = this->NumberOfClusters++;
+    }
+  }
+
+  // the returns of a pixel get its labels
+  vtkSmartPointer<vtkUnsignedCharArray> groundArray = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  groundArray->SetName("ground");
+  groundArray->SetNumberOfValues(numberOfPoints);
+  vtkSmartPointer<vtkIntArray> clusterArray = vtkSmartPointer<vtkIntArray>::New();
+  clusterArray->SetName("cluster_id");
+  clusterArray->SetNumberOfValues(numberOfPoints);
+  for (vtkIdType pointIndex = 0; pointIndex < numberOfPoints; ++pointIndex)
+  {
+    const vtkIdType pixel = pixelOfPoint[pointIndex];
+    groundArray->SetValue(pointIndex, pixel >= 0 ? ground[pixel] : 0);
+    clusterArray->SetValue(pointIndex, pixel >= 0 && components[pixel] >= 0 ?
+      clusterOfComponent[components[pixel]] : -1);
+  }
+  output->GetPointData()->AddArray(groundArray);
+  output->GetPointData()->AddArray(clusterArray);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkRangeImageSegmentation::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Width: " << this->Width << std::endl;
+  os << indent << "MaxGroundSlope: " << this->MaxGroundSlope << std::endl;
+  os << indent << "ClusteringAngle: " << this->ClusteringAngle << std::endl;
+  os << indent << "MinimumClusterSize: " << this->MinimumClusterSize << std::endl;
+  os << indent << "NumberOfClusters: " << this->NumberOfClusters << std::endl;
+}
@@ -0,0 +1,105 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_RANGE_IMAGE_SEGMENTATION_H
+#define VTK_RANGE_IMAGE_SEGMENTATION_H
+
+// VTK
+#include <vtkPolyDataAlgorithm.h>
+
+/**
+ * @brief vtkRangeImageSegmentation label the ground and the objects of a lidar frame,
+ * using the range image of the sensor instead of a kd-tree: the neighbors of a return
+ * are the returns of the adjacent azimuths of its laser, and the returns of the lasers
+ * above and below at the same azimuth.
+ *
+ * The frame must be in the sensor reference frame, with a laser_id array (the azimuth
+ * array of the interpreters is used when present). The rows of the image are the lasers
+ * sorted by elevation, the returns of a pixel are represented by the closest one.
+ *
+ * A column of the image is walked from the lowest laser, a return being ground if the
+ * slope between it and the last ground return is below MaxGroundSlope. The other returns
+ * are grouped by a breadth-first search on the image: two neighbor returns are in the same
+ * cluster if the angle between the line joining them and the beam of the farthest one is
+ * above ClusteringAngle, which is the case on a continuous surface and not across a depth
+ * discontinuity. Both steps are linear in the number of pixels.
+ *
+ * The output gets a ground array (1 for ground) and a cluster_id array (-1 for the ground
+ * and the clusters of less than MinimumClusterSize returns, the clusters being numbered
+ * from 0 in the order of the image)
+ */
+class VTK_EXPORT vtkRangeImageSegmentation : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkRangeImageSegmentation *New();
+  vtkTypeMacro(vtkRangeImageSegmentation, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Get the number of columns of the range image
+  vtkGetMacro(Width, int)
+
+  /// Set the number of columns of the range image, about the number of firings per rotation
+  vtkSetClampMacro(Width, int, 1, 36000)
+
+  /// Get the maximum slope between consecutive ground returns of a column, in degrees
+  vtkGetMacro(MaxGroundSlope, double)
+
+  /// Set the maximum slope between consecutive ground returns of a column, in degrees
+  vtkSetMacro(MaxGroundSlope, double)
+
+  /// Get the angle above which two neighbor returns are in the same cluster, in degrees
+  vtkGetMacro(ClusteringAngle, double)
+
+  /// Set the angle above which two neighbor returns are in the same cluster, in degrees
+  vtkSetMacro(ClusteringAngle, double)
+
+  /// Get the number of returns of the smallest cluster kept
+  vtkGetMacro(MinimumClusterSize, int)
+
+  /// Set the number of returns of the smallest cluster kept
+  vtkSetMacro(MinimumClusterSize, int)
+
+  /// Get the number of clusters of the last frame
+  vtkGetMacro(NumberOfClusters, int)
+
+protected:
+  vtkRangeImageSegmentation() = default;
+  ~vtkRangeImageSegmentation() = default;
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkRangeImageSegmentation(const vtkRangeImageSegmentation&) = delete;
+  void operator=(const vtkRangeImageSegmentation&) = delete;
+
+  /// number of columns of the range image
+  int Width = 2048;
+
+  /// maximum slope between consecutive ground returns of a column, in degrees
+  double MaxGroundSlope = 10.;
+
+  /// angle above which two neighbor returns are in the same cluster, in degrees
+  double ClusteringAngle = 10.;
+
+  /// number of returns of the smallest cluster kept
+  int MinimumClusterSize = 20;
+
+  /// number of clusters of the last frame
+  int NumberOfClusters = 0;
+};
+
+#endif // VTK_RANGE_IMAGE_SEGMENTATION_H
@@ -0,0 +1,307 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "MultiModelExtraction.h"
+#include "ParallelPoints.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+// BOOST
+#include <boost/cstdint.hpp>
+
+namespace
+{
+//! Model fitted in a cell, before the merge
+struct Candidate
+{
+  MultiModelExtraction::ModelType Type;
+  RansacModel::Parameters Parameters;
+  size_t NumberOfPoints;
+  //! Mean of the inliers
+  float Center[3];
+};
+
+struct Cell
+{
+  int X, Y;
+  //! Range of the cell in the points sorted by cell
+  size_t Begin, End;
+  std::vector<Candidate> Candidates;
+};
+
+//-----------------------------------------------------------------------------
+boost::int64_t CellKey(int x, int y)
+{
+  return (static_cast<boost::int64_t>(x) << 32) ^ static_cast<boost::uint32_t>(y);
+}
+
+//-----------------------------------------------------------------------------
+int FindRoot(std::vector<int>& parents, int k)
+{
+  while (parents[k] != k)
+  {
+    parents[k] = parents[parents[k]];
+    k = parents[k];
+  }
+  return k;
+}
+
+//-----------------------------------------------------------------------------
+bool AreSameModel(const Candidate& a, const Candidate& b, float cosMergeAngle, float mergeDistance)
+{
+  if (a.Type != b.Type)
+  {
+    return false;
+  }
+  if (a.Type == MultiModelExtraction::CYLINDER)
+  {
+    const float dx = a.Parameters[0] - b.Parameters[0], dy = a.Parameters[1] - b.Parameters[1];
+    return std::sqrt(dx * dx + dy * dy) < mergeDistance &&
+      std::abs(a.Parameters[2] - b.Parameters[2]) < mergeDistance;
+  }
+  // parallel planes, each one going through the inliers of the other
+  const float* p = a.Parameters;
+  const float* q = b.Parameters;
+  return std::abs(p[0] * q[0] + p[1] * q[1] + p[2] * q[2]) > cosMergeAngle &&
+    std::abs(p[0] * b.Center[0] + p[1] * b.Center[1] + p[2] * b.Center[2] + p[3]) < mergeDistance &&
+    std::abs(q[0] * a.Center[0] + q[1] * a.Center[1] + q[2] * a.Center[2] + q[3]) < mergeDistance;
+}
+}
+
+//-----------------------------------------------------------------------------
+void MultiModelExtraction::Run(const RansacPoints& points, Result& result) const
+{
+  result.Models.clear();
+  result.Labels.assign(points.size(), -1);
+  if (points.size() == 0 || this->CellSize <= 0.)
+  {
+    return;
+  }
+
+  // sort the points by cell, so that the points of a cell are contiguous
+  std::vector<boost::int64_t> keys(points.size());
+  for (size_t k = 0; k < points.size(); ++k)
+  {
+    keys[k] = CellKey(static_cast<int>(std::floor(points.X[k] / this->CellSize)),
+                      static_cast<int>(std::floor(points.Y[k] / this->CellSize)));
+  }
+  std::vector<size_t> order(points.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+  std::vector<Cell> cells;
+  std::unordered_map<boost::int64_t, size_t> cellOfKey;
+  for (size_t k = 0; k < order.size(); ++k)
+  {
+    if (k == 0 || keys[order[k]] != keys[order[k - 1]])
+    {
+      const size_t point = order[k];
+      Cell cell;
+      cell.X = static_cast<int>(std::floor(points.X[point] / this->CellSize));
+      cell.Y = static_cast<int>(std::floor(points.Y[point] / this->CellSize));
+      cell.Begin = k;
+      cell.End = k + 1;
+      cellOfKey[keys[point]] = cells.size();
+      cells.push_back(cell);
+    }
+    cells.back().End = k + 1;
+  }
+
+  // the cells are fitted in parallel, each one by a single range. A point is labelled
+  // with the index of its candidate in the cell, it is only written by the range of its cell
+  RansacEngine engine;
+  engine.Threshold = this->Threshold;
+  engine.MaxIterations = this->MaxIterations;
+  engine.NumberOfThreads = 1;
+  RansacPlane plane;
+  RansacVerticalCylinder cylinder;
+  cylinder.MinimumRadius = static_cast<float>(this->MinimumRadius);
+  cylinder.MaximumRadius = static_cast<float>(this->MaximumRadius);
+  std::vector<int> candidateOfPoint(points.size(), -1);
+  auto fitCells = [&](size_t, size_t firstCell, size_t lastCell) {
+    RansacPoints remaining;
+    std::vector<size_t> indices;
+    std::vector<unsigned char> isInlier;
+    for (size_t c = firstCell; c < lastCell; ++c)
+    {
+      Cell& cell = cells[c];
+      indices.assign(order.begin() + cell.Begin, order.begin() + cell.End);
+      RansacEngine cellEngine = engine;
+      cellEngine.Seed = this->Seed + static_cast<unsigned int>(c);
+      while (cell.Candidates.size() < this->MaximumModelsPerCell &&
+             indices.size() >= this->MinimumInliers)
+      {
+        remaining.resize(indices.size());
+        for (size_t k = 0; k < indices.size(); ++k)
+        {
+          remaining.X[k] = points.X[indices[k]];
+          remaining.Y[k] = points.Y[indices[k]];
+          remaining.Z[k] = points.Z[indices[k]];
+        }
+
+        // the plane or the cylinder which explains the most points
+        Candidate candidate;
+        RansacEngine::Result fit;
+        const RansacModel* model = &plane;
+        candidate.Type = PLANE;
+        if (!cellEngine.Run(plane, remaining, fit))
+        {
+          fit.NumberOfInliers = 0;
+        }
+        RansacEngine::Result cylinderFit;
+        if (this->FitCylinders && cellEngine.Run(cylinder, remaining, cylinderFit) &&
+            cylinderFit.NumberOfInliers > fit.NumberOfInliers)
+        {
+          fit = cylinderFit;
+          model = &cylinder;
+          candidate.Type = CYLINDER;
+        }
+        if (fit.NumberOfInliers < this->MinimumInliers)
+        {
+          break;
+        }
+
+        std::copy(fit.Parameters, fit.Parameters + RansacModel::MaximumNumberOfParameters,
+                  candidate.Parameters);
+        cellEngine.ComputeInliers(*model, fit.Parameters, remaining, isInlier);
+        double center[3] = { 0., 0., 0. };
+        size_t kept = 0;
+        for (size_t k = 0; k < indices.size(); ++k)
+        {
+          if (isInlier[k])
+          {
+            candidateOfPoint[indices[k]] = static_cast<int>(cell.Candidates.size());
+            center[0] += remaining.X[k];
+            center[1] += remaining.Y[k];
+            center[2] += remaining.Z[k];
+          }
+          else
+          {
+            indices[kept++] = indices[k];
+          }
+        }
+        candidate.NumberOfPoints = indices.size() - kept;
+        for (int i = 0; i < 3; ++i)
+        {
+          candidate.Center[i] = static_cast<float>(center[i] / candidate.NumberOfPoints);
+        }
+        indices.resize(kept);
+        cell.Candidates.push_back(candidate);
+      }
+    }
+  };
+  ParallelFor(cells.size(), GetNumberOfThreads(this->NumberOfThreads), fitCells);
+
+  // merge the same models of the neighbouring cells, the parts of a model being merged
+  // step by step across the cells it covers
+  std::vector<size_t> firstCandidate(cells.size() + 1, 0);
+  for (size_t c = 0; c < cells.size(); ++c)
+  {
+    firstCandidate[c + 1] = firstCandidate[c] + cells[c].Candidates.size();
+  }
+  std::vector<int> parents(firstCandidate.back());
+  std::iota(parents.begin(), parents.end(), 0);
+  const float cosMergeAngle = static_cast<float>(std::cos(this->MergeAngle * M_PI / 180.));
+  const float mergeDistance = static_cast<float>(this->MergeDistance);
+  const int neighbours[4][2] = { { 1, 0 }, { 0, 1 }, { 1, 1 }, { 1, -1 } };
+  for (size_t c = 0; c < cells.size(); ++c)
+  {
+    for (const auto& offset : neighbours)
+    {
+      auto neighbour = cellOfKey.find(CellKey(cells[c].X + offset[0], cells[c].Y + offset[1]));
+      if (neighbour == cellOfKey.end())
+      {
+        continue;
+      }
+      const size_t n = neighbour->second;
+      for (size_t i = 0; i < cells[c].Candidates.size(); ++i)
+      {
+        for (size_t j = 0; j < cells[n].Candidates.size(); ++j)
+        {
+          if (AreSameModel(cells[c].Candidates[i], cells[n].Candidates[j], cosMergeAngle,
+                           mergeDistance))
+          {
+            const int a = FindRoot(parents, static_cast<int>(firstCandidate[c] + i));
+            const int b = FindRoot(parents, static_cast<int>(firstCandidate[n] + j));
+            parents[std::max(a, b)] = std::min(a, b);
+          }
+        }
+      }
+    }
+  }
+
+  // a merged model takes the parameters of its largest part
+  std::vector<const Candidate*> candidates;
+  for (const Cell& cell : cells)
+  {
+    for (const Candidate& candidate : cell.Candidates)
+    {
+      candidates.push_back(&candidate);
+    }
+  }
+  std::vector<size_t> totals(parents.size(), 0);
+  std::vector<int> largest(parents.size(), -1);
+  for (size_t k = 0; k < candidates.size(); ++k)
+  {
+    const int root = FindRoot(parents, static_cast<int>(k));
+    totals[root] += candidates[k]->NumberOfPoints;
+    if (largest[root] < 0 || candidates[k]->NumberOfPoints > candidates[largest[root]]->NumberOfPoints)
+    {
+      largest[root] = static_cast<int>(k);
+    }
+  }
+  std::vector<int> roots;
+  for (size_t k = 0; k < parents.size(); ++k)
+  {
+    if (parents[k] == static_cast<int>(k))
+    {
+      roots.push_back(static_cast<int>(k));
+    }
+  }
+  std::stable_sort(roots.begin(), roots.end(),
+                   [&totals](int a, int b) { return totals[a] > totals[b]; });
+  std::vector<int> modelOfRoot(parents.size(), -1);
+  for (int root : roots)
+  {
+    modelOfRoot[root] = static_cast<int>(result.Models.size());
+    const Candidate& reference = *candidates[largest[root]];
+    Model model;
+    model.Type = reference.Type;
+    std::copy(reference.Parameters, reference.Parameters + RansacModel::MaximumNumberOfParameters,
+              model.Parameters);
+    model.NumberOfPoints = totals[root];
+    result.Models.push_back(model);
+  }
+
+  // label the points
+  for (size_t c = 0; c < cells.size(); ++c)
+  {
+    for (size_t k = cells[c].Begin; k < cells[c].End; ++k)
+    {
+      const size_t point = order[k];
+      if (candidateOfPoint[point] >= 0)
+      {
+        const int candidate = static_cast<int>(firstCandidate[c]) + candidateOfPoint[point];
+        result.Labels[point] = modelOfRoot[FindRoot(parents, candidate)];
+      }
+    }
+  }
+}
@@ -0,0 +1,86 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef MULTI_MODEL_EXTRACTION_H
+#define MULTI_MODEL_EXTRACTION_H
+
+// LOCAL
+#include "RansacEngine.h"
+
+// STD
+#include <vector>
+
+/**
+ * @brief MultiModelExtraction extract all the planes and the vertical cylinders of a point
+ * cloud, such as the ground, the walls and the poles, in a single pass. The cloud is split
+ * in square cells of CellSize on the horizontal plane, and the models of the cells are
+ * fitted in parallel with a RansacEngine: in each cell, the plane or the cylinder with the
+ * most inliers is kept and its inliers removed, until no model has MinimumInliers. The models
+ * of neighbouring cells which are the same, such as the parts of a wall, are then merged,
+ * and the points are labelled with their model.
+ */
+class MultiModelExtraction
+{
+public:
+  enum ModelType
+  {
+    PLANE = 0,
+    CYLINDER = 1
+  };
+
+  struct Model
+  {
+    ModelType Type;
+    //! Parameters of the largest part of the model, see RansacPlane and RansacVerticalCylinder
+    RansacModel::Parameters Parameters;
+    size_t NumberOfPoints;
+  };
+
+  struct Result
+  {
+    //! Models sorted by decreasing number of points
+    std::vector<Model> Models;
+    //! Model of each point, -1 for the points of no model
+    std::vector<int> Labels;
+  };
+
+  //! Distance from a point to a model under which the point is an inlier
+  double Threshold = 0.2;
+  //! Size of the cells fitted independently, in the unit of the points
+  double CellSize = 5.;
+  //! Maximum number of models fitted in a cell
+  unsigned int MaximumModelsPerCell = 4;
+  //! Number of inliers under which a model of a cell is rejected
+  size_t MinimumInliers = 50;
+  //! Maximum number of hypotheses per model
+  unsigned int MaxIterations = 200;
+  //! Indicate if the vertical cylinders are fitted, with radius in [MinimumRadius, MaximumRadius]
+  bool FitCylinders = true;
+  double MinimumRadius = 0.02;
+  double MaximumRadius = 0.5;
+  //! Maximum angle between the normals of two planes which are merged, in degrees
+  double MergeAngle = 5.;
+  //! Maximum distance between two models which are merged
+  double MergeDistance = 0.4;
+  //! Number of threads fitting the cells, 0 uses one thread per core
+  int NumberOfThreads = 0;
+  unsigned int Seed = 0;
+
+  void Run(const RansacPoints& points, Result& result) const;
+};
+
+#endif // MULTI_MODEL_EXTRACTION_H
@@ -0,0 +1,355 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "RansacEngine.h"
+#include "ParallelPoints.h"
+
+// VTK
+#include <vtkFloatArray.h>
+#include <vtkPoints.h>
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <random>
+
+// BOOST
+
+namespace
+{
+//! Hypotheses evaluated in parallel, the stopping criterion is checked between the batches.
+//! This does not depend on the number of threads so that neither does the result
+const unsigned int BatchSize = 32;
+//! Below this ratio of points in the subset, scoring on the subset first is not worth it
+const size_t MinimumPointsPerSubsetPoint = 4;
+//! Points of which a thread marks the inliers at least
+const size_t MinimumPointsPerThread = 16384;
+//! Norm under which the vectors computed from a sample are degenerated
+const float DegeneratedNorm = 1e-6f;
+
+//-----------------------------------------------------------------------------
+// Draw sampleSize distinct indices of [0, numberOfPoints[, from a generator
+// which only depends on the seed and the hypothesis
+void DrawSample(unsigned int seed, unsigned int hypothesis, size_t numberOfPoints,
+                unsigned int sampleSize, size_t* sample)
+{
+  std::seed_seq sequence{ seed, hypothesis };
+  std::mt19937 generator(sequence);
+  std::uniform_int_distribution<size_t> distribution(0, numberOfPoints - 1);
+  for (unsigned int i = 0; i < sampleSize; ++i)
+  {
+    do
+    {
+      sample[i] = distribution(generator);
+    } while (std::find(sample, sample + i, sample[i]) != sample + i);
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+RansacPoints::RansacPoints(vtkPoints* points)
+{
+  const vtkIdType numberOfPoints = points->GetNumberOfPoints();
+  this->resize(numberOfPoints);
+  vtkFloatArray* data = vtkFloatArray::SafeDownCast(points->GetData());
+  if (data)
+  {
+    const float* xyz = data->GetPointer(0);
+    for (vtkIdType k = 0; k < numberOfPoints; ++k)
+    {
+      this->X[k] = xyz[3 * k + 0];
+      this->Y[k] = xyz[3 * k + 1];
+      this->Z[k] = xyz[3 * k + 2];
+    }
+    return;
+  }
+  double point[3];
+  for (vtkIdType k = 0; k < numberOfPoints; ++k)
+  {
+    points->GetPoint(k, point);
+    this->X[k] = static_cast<float>(point[0]);
+    this->Y[k] = static_cast<float>(point[1]);
+    this->Z[k] = static_cast<float>(point[2]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void RansacPoints::resize(size_t size)
+{
+  this->X.resize(size);
+  this->Y.resize(size);
+  this->Z.resize(size);
+}
+
+//-----------------------------------------------------------------------------
+bool RansacPlane::Fit(const RansacPoints& points, const size_t* sample, Parameters parameters) const
+{
+  const size_t i0 = sample[0], i1 = sample[1], i2 = sample[2];
+  const float ux = points.X[i2] - points.X[i0], uy = points.Y[i2] - points.Y[i0], uz = points.Z[i2] - points.Z[i0];
+  const float vx = points.X[i1] - points.X[i0], vy = points.Y[i1] - points.Y[i0], vz = points.Z[i1] - points.Z[i0];
+  float a = uy * vz - uz * vy;
+  float b = uz * vx - ux * vz;
+  float c = ux * vy - uy * vx;
+  const float norm = std::sqrt(a * a + b * b + c * c);
+  if (norm < DegeneratedNorm)
+  {
+    return false;
+  }
+  a /= norm;
+  b /= norm;
+  c /= norm;
+  parameters[0] = a;
+  parameters[1] = b;
+  parameters[2] = c;
+  parameters[3] = -(a * points.X[i0] + b * points.Y[i0] + c * points.Z[i0]);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+size_t RansacPlane::CountInliers(const Parameters parameters, const RansacPoints& points,
+                                 size_t begin, size_t end, float threshold,
+                                 unsigned char* inliers) const
+{
+  const float a = parameters[0], b = parameters[1], c = parameters[2], d = parameters[3];
+  const float* x = points.X.data();
+  const float* y = points.Y.data();
+  const float* z = points.Z.data();
+  size_t count = 0;
+  if (inliers)
+  {
+    for (size_t k = begin; k < end; ++k)
+    {
+      inliers[k] = std::abs(a * x[k] + b * y[k] + c * z[k] + d) < threshold;
+      count += inliers[k];
+    }
+    return count;
+  }
+  for (size_t k = begin; k < end; ++k)
+  {
+    count += std::abs(a * x[k] + b * y[k] + c * z[k] + d) < threshold;
+  }
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+bool RansacLine::Fit(const RansacPoints& points, const size_t* sample, Parameters parameters) const
+{
+  const size_t i0 = sample[0], i1 = sample[1];
+  float ux = points.X[i1] - points.X[i0], uy = points.Y[i1] - points.Y[i0], uz = points.Z[i1] - points.Z[i0];
+  const float norm = std::sqrt(ux * ux + uy * uy + uz * uz);
+  if (norm < DegeneratedNorm)
+  {
+    return false;
+  }
+  parameters[0] = points.X[i0];
+  parameters[1] = points.Y[i0];
+  parameters[2] = points.Z[i0];
+  parameters[3] = ux / norm;
+  parameters[4] = uy / norm;
+  parameters[5] = uz / norm;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+size_t RansacLine::CountInliers(const Parameters parameters, const RansacPoints& points,
+                                size_t begin, size_t end, float threshold,
+                                unsigned char* inliers) const
+{
+  const float px = parameters[0], py = parameters[1], pz = parameters[2];
+  const float ux = parameters[3], uy = parameters[4], uz = parameters[5];
+  const float squaredThreshold = threshold * threshold;
+  const float* x = points.X.data();
+  const float* y = points.Y.data();
+  const float* z = points.Z.data();
+  size_t count = 0;
+  for (size_t k = begin; k < end; ++k)
+  {
+    const float dx = x[k] - px, dy = y[k] - py, dz = z[k] - pz;
+    const float along = dx * ux + dy * uy + dz * uz;
+    const bool isInlier = dx * dx + dy * dy + dz * dz - along * along < squaredThreshold;
+    if (inliers)
+    {
+      inliers[k] = isInlier;
+    }
+    count += isInlier;
+  }
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+bool RansacVerticalCylinder::Fit(const RansacPoints& points, const size_t* sample,
+                                 Parameters parameters) const
+{
+  // center of the circle going through the horizontal projections of the 3 points
+  const size_t i0 = sample[0], i1 = sample[1], i2 = sample[2];
+  const float bx = points.X[i1] - points.X[i0], by = points.Y[i1] - points.Y[i0];
+  const float cx = points.X[i2] - points.X[i0], cy = points.Y[i2] - points.Y[i0];
+  const float d = 2.f * (bx * cy - by * cx);
+  if (std::abs(d) < DegeneratedNorm)
+  {
+    return false;
+  }
+  const float b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+  const float ux = (cy * b2 - by * c2) / d;
+  const float uy = (bx * c2 - cx * b2) / d;
+  const float radius = std::sqrt(ux * ux + uy * uy);
+  if (radius < this->MinimumRadius || radius > this->MaximumRadius)
+  {
+    return false;
+  }
+  parameters[0] = points.X[i0] + ux;
+  parameters[1] = points.Y[i0] + uy;
+  parameters[2] = radius;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+size_t RansacVerticalCylinder::CountInliers(const Parameters parameters, const RansacPoints& points,
+                                            size_t begin, size_t end, float threshold,
+                                            unsigned char* inliers) const
+{
+  const float cx = parameters[0], cy = parameters[1], radius = parameters[2];
+  const float* x = points.X.data();
+  const float* y = points.Y.data();
+  size_t count = 0;
+  for (size_t k = begin; k < end; ++k)
+  {
+    const float dx = x[k] - cx, dy = y[k] - cy;
+    const bool isInlier = std::abs(std::sqrt(dx * dx + dy * dy) - radius) < threshold;
+    if (inliers)
+    {
+      inliers[k] = isInlier;
+    }
+    count += isInlier;
+  }
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+bool RansacEngine::Run(const RansacModel& model, const RansacPoints& points, Result& result) const
+{
+  result = Result();
+  const size_t numberOfPoints = points.size();
+  const unsigned int sampleSize = model.GetSampleSize();
+  if (numberOfPoints < sampleSize || this->MaxIterations == 0)
+  {
+    return false;
+  }
+  const float threshold = static_cast<float>(this->Threshold);
+  const int numberOfThreads = GetNumberOfThreads(this->NumberOfThreads);
+
+  // random subset of the points, contiguous so that scoring on it is cheap
+  RansacPoints subset;
+  const bool usePreemption =
+    this->PreemptiveSubsetSize > 0 && this->PreemptiveSubsetSize * MinimumPointsPerSubsetPoint <= numberOfPoints;
+  if (usePreemption)
+  {
+    std::mt19937 generator(this->Seed);
+    std::uniform_int_distribution<size_t> distribution(0, numberOfPoints - 1);
+    subset.resize(this->PreemptiveSubsetSize);
+    for (size_t k = 0; k < subset.size(); ++k)
+    {
+      const size_t index = distribution(generator);
+      subset.X[k] = points.X[index];
+      subset.Y[k] = points.Y[index];
+      subset.Z[k] = points.Z[index];
+    }
+  }
+
+  const unsigned int numberOfParameters = RansacModel::MaximumNumberOfParameters;
+  std::vector<float> parameters(BatchSize * numberOfParameters);
+  std::vector<size_t> scores(BatchSize);
+  bool hasModel = false;
+  unsigned int requiredIterations = this->MaxIterations;
+  while (result.NumberOfIterations < requiredIterations)
+  {
+    const unsigned int firstHypothesis = result.NumberOfIterations;
+    const unsigned int count = std::min(BatchSize, requiredIterations - firstHypothesis);
+
+    // a hypothesis is scored on all the points only if its inlier ratio on the subset
+    // is not 3 standard deviations below the best one
+    const double bestRatio = static_cast<double>(result.NumberOfInliers) / numberOfPoints;
+    const double minimumSubsetRatio = usePreemption ?
+      bestRatio - 3. * std::sqrt(bestRatio * (1. - bestRatio) / subset.size()) : 0.;
+
+    auto evaluate = [&](size_t begin, size_t end) {
+      size_t sample[RansacModel::MaximumNumberOfParameters];
+      for (size_t h = begin; h < end; ++h)
+      {
+        scores[h] = 0;
+        float* hypothesis = &parameters[h * numberOfParameters];
+        DrawSample(this->Seed, firstHypothesis + static_cast<unsigned int>(h), numberOfPoints, sampleSize, sample);
+        if (!model.Fit(points, sample, hypothesis))
+        {
+          continue;
+        }
+        if (usePreemption && minimumSubsetRatio > 0. &&
+            model.CountInliers(hypothesis, subset, 0, subset.size(), threshold) <
+              minimumSubsetRatio * subset.size())
+        {
+          continue;
+        }
+        scores[h] = model.CountInliers(hypothesis, points, 0, numberOfPoints, threshold);
+      }
+    };
+    ParallelFor(count, numberOfThreads,
+                [&](size_t, size_t begin, size_t end) { evaluate(begin, end); });
+
+    // the first best hypothesis is kept, whatever the number of threads
+    for (unsigned int h = 0; h < count; ++h)
+    {
+      if (scores[h] > result.NumberOfInliers)
+      {
+        result.NumberOfInliers = scores[h];
+        std::copy(&parameters[h * numberOfParameters], &parameters[(h + 1) * numberOfParameters], result.Parameters);
+        hasModel = true;
+      }
+    }
+    result.NumberOfIterations += count;
+
+    // stop once the model has enough inliers, or when a sample of inliers of
+    // the best model has been drawn with the required confidence
+    const double ratio = static_cast<double>(result.NumberOfInliers) / numberOfPoints;
+    if (ratio > this->RatioInliersRequired)
+    {
+      result.HasConverged = true;
+      break;
+    }
+    const double goodSampleProbability = std::pow(ratio, sampleSize);
+    if (goodSampleProbability > 0.)
+    {
+      const double iterations = goodSampleProbability >= 1. ? 0. :
+        std::log(1. - this->Confidence) / std::log(1. - goodSampleProbability);
+      requiredIterations = static_cast<unsigned int>(
+        std::min<double>(this->MaxIterations, std::ceil(std::max(0., iterations))));
+    }
+  }
+  return hasModel;
+}
+
+//-----------------------------------------------------------------------------
+void RansacEngine::ComputeInliers(const RansacModel& model, const RansacModel::Parameters parameters,
+                                  const RansacPoints& points, std::vector<unsigned char>& inliers) const
+{
+  inliers.resize(points.size());
+  const int numberOfRanges = static_cast<int>(std::min<size_t>(
+    GetNumberOfThreads(this->NumberOfThreads), points.size() / MinimumPointsPerThread));
+  ParallelFor(points.size(), numberOfRanges, [&](size_t, size_t begin, size_t end) {
+    model.CountInliers(parameters, points, begin, end, static_cast<float>(this->Threshold), inliers.data());
+  });
+}
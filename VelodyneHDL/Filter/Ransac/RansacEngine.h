@@ -0,0 +1,160 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef RANSAC_ENGINE_H
+#define RANSAC_ENGINE_H
+
+// STD
+#include <cstddef>
+#include <vector>
+
+class vtkPoints;
+
+/**
+ * @brief RansacPoints the coordinates of a point cloud stored per component, so that
+ * the distances of consecutive points to a model are computed together
+ */
+struct RansacPoints
+{
+  std::vector<float> X, Y, Z;
+
+  RansacPoints() = default;
+  explicit RansacPoints(vtkPoints* points);
+
+  size_t size() const { return this->X.size(); }
+  void resize(size_t size);
+};
+
+/**
+ * @brief RansacModel a geometric model fitted by the RansacEngine, defined by at most
+ * MaximumNumberOfParameters values
+ */
+class RansacModel
+{
+public:
+  static const unsigned int MaximumNumberOfParameters = 8;
+  typedef float Parameters[MaximumNumberOfParameters];
+
+  virtual ~RansacModel() = default;
+
+  //! Number of points defining a model
+  virtual unsigned int GetSampleSize() const = 0;
+
+  /**
+   * @brief Fit compute the model defined by some points
+   * @param sample indices of GetSampleSize() points
+   * @return false if the points are degenerated
+   */
+  virtual bool Fit(const RansacPoints& points, const size_t* sample, Parameters parameters) const = 0;
+
+  /**
+   * @brief CountInliers count the points of [begin, end[ closer to the model than threshold,
+   * and mark them in inliers if not null
+   */
+  virtual size_t CountInliers(const Parameters parameters, const RansacPoints& points,
+                              size_t begin, size_t end, float threshold,
+                              unsigned char* inliers = nullptr) const = 0;
+};
+
+//! Plane (a, b, c, d) of the points ax + by + cz + d = 0, with a unit normal
+class RansacPlane : public RansacModel
+{
+public:
+  unsigned int GetSampleSize() const override { return 3; }
+  bool Fit(const RansacPoints& points, const size_t* sample, Parameters parameters) const override;
+  size_t CountInliers(const Parameters parameters, const RansacPoints& points,
+                      size_t begin, size_t end, float threshold,
+                      unsigned char* inliers = nullptr) const override;
+};
+
+//! Line going through (px, py, pz) with the unit direction (ux, uy, uz)
+class RansacLine : public RansacModel
+{
+public:
+  unsigned int GetSampleSize() const override { return 2; }
+  bool Fit(const RansacPoints& points, const size_t* sample, Parameters parameters) const override;
+  size_t CountInliers(const Parameters parameters, const RansacPoints& points,
+                      size_t begin, size_t end, float threshold,
+                      unsigned char* inliers = nullptr) const override;
+};
+
+/**
+ * @brief RansacVerticalCylinder cylinder of vertical axis, such as a pole, of center (cx, cy)
+ * and radius r. The points are only used through their horizontal coordinates, so that the
+ * normals are not needed. The circles of radius out of [MinimumRadius, MaximumRadius] are
+ * degenerated, so that a wall or the ground is not taken for a very large cylinder
+ */
+class RansacVerticalCylinder : public RansacModel
+{
+public:
+  float MinimumRadius = 0.f;
+  float MaximumRadius = 1.f;
+
+  unsigned int GetSampleSize() const override { return 3; }
+  bool Fit(const RansacPoints& points, const size_t* sample, Parameters parameters) const override;
+  size_t CountInliers(const Parameters parameters, const RansacPoints& points,
+                      size_t begin, size_t end, float threshold,
+                      unsigned char* inliers = nullptr) const override;
+};
+
+/**
+ * @brief RansacEngine fit a model on a point cloud with random samples consensus.
+ * The hypotheses are evaluated by batches, in parallel. Each one is first scored on a
+ * random subset of the points, and only the ones which may beat the best hypothesis
+ * are scored on all the points. The iterations stop once the inlier ratio of the best
+ * hypothesis is RatioInliersRequired, or when it is unlikely that a better hypothesis
+ * will be drawn. The samples of a hypothesis only depend on the seed and its
+ * index, so the result does not depend on the number of threads
+ */
+class RansacEngine
+{
+public:
+  struct Result
+  {
+    RansacModel::Parameters Parameters = {};
+    size_t NumberOfInliers = 0;
+    unsigned int NumberOfIterations = 0;
+    //! Indicate if RatioInliersRequired has been reached
+    bool HasConverged = false;
+  };
+
+  //! Maximum number of hypotheses
+  unsigned int MaxIterations = 500;
+  //! Distance from a point to the model under which the point is an inlier
+  double Threshold = 0.5;
+  //! Inlier ratio for which a model is accepted without trying more hypotheses
+  double RatioInliersRequired = 1.0;
+  //! Probability that a sample without outliers has been drawn when the iterations stop
+  double Confidence = 0.99;
+  //! Number of points of the subset on which the hypotheses are scored first
+  size_t PreemptiveSubsetSize = 256;
+  //! 0 uses one thread per core
+  int NumberOfThreads = 0;
+  unsigned int Seed = 0;
+
+  /**
+   * @brief Run fit the model on the points
+   * @return false if no non degenerated sample has been drawn
+   */
+  bool Run(const RansacModel& model, const RansacPoints& points, Result& result) const;
+
+  //! Mark the inliers of a model, with 1, the outliers being 0
+  void ComputeInliers(const RansacModel& model, const RansacModel::Parameters parameters,
+                      const RansacPoints& points, std::vector<unsigned char>& inliers) const;
+};
+
+#endif // RANSAC_ENGINE_H
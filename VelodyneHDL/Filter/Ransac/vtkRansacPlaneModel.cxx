@@ -16,10 +16,13 @@
 
 // LOCAL
 #include "vtkRansacPlaneModel.h"
+#include "TraceEvents.h"
 
+#include "RansacEngine.h"
 #include "vtkConversions.h"
 
 // STD
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -53,53 +56,24 @@
 // Eigen
 #include <Eigen/Dense>
 
-//----------------------------------------------------------------------------
-struct RansacSampleInfo
-{
-public:
-  RansacSampleInfo() {}
-
-  RansacSampleInfo(unsigned int nInliers, unsigned int index1,
-                   unsigned int index2, unsigned int index3)
-  {
-    this->NInliers = nInliers;
-    this->Index1 = index1;
-    this->Index2 = index2;
-    this->Index3 = index3;
-  }
-
-  unsigned int NInliers;
-  unsigned int Index1;
-  unsigned int Index2;
-  unsigned int Index3;
-};
-
 //----------------------------------------------------------------------------
 void RefineRansac(std::vector<Eigen::Matrix<double, 3, 1> >& Points, vtkPolyData* output,
-                  RansacSampleInfo sampleInfo, double threshold, double PlaneParam[4])
+                  const std::vector<unsigned char>& inliers, double PlaneParam[4])
 {
   // Create inliers / outliers array information
   vtkNew<vtkUnsignedIntArray> inliersArray;
   inliersArray->SetName("ransac_plane_inliers");
+  inliersArray->SetNumberOfTuples(inliers.size());
 
-  // compute plane PlaneParameters
-  Eigen::Matrix<double, 3, 1> pointPlane = Points[sampleInfo.Index1];
-  Eigen::Matrix<double, 3, 1> normalPlane = (Points[sampleInfo.Index3] - pointPlane).cross(Points[sampleInfo.Index2] - pointPlane);
-  normalPlane.normalize();
-
-  // compute inliers
+  // gather inliers
   std::vector<Eigen::Matrix<double, 3, 1> > inliersPoints;
   for (unsigned int k = 0; k < Points.size(); ++k)
   {
-    if (std::abs((Points[k] - pointPlane).dot(normalPlane)) < threshold)
+    if (inliers[k])
     {
       inliersPoints.push_back(Points[k]);
-      inliersArray->InsertNextValue(1);
-    }
-    else
-    {
-      inliersArray->InsertNextValue(0);
     }
+    inliersArray->SetValue(k, inliers[k]);
   }
 
   // Now, compute the best plane using all inliers
@@ -124,8 +98,8 @@ void RefineRansac(std::vector<Eigen::Matrix<double, 3, 1> >& Points, vtkPolyData
   Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 3, 3> > eigenSolver(varianceCovariance);
 
   // PlaneParameters
-  normalPlane = eigenSolver.eigenvectors().col(0);
-  pointPlane = center;
+  Eigen::Matrix<double, 3, 1> normalPlane = eigenSolver.eigenvectors().col(0);
+  Eigen::Matrix<double, 3, 1> pointPlane = center;
   PlaneParam[0] = normalPlane(0);
   PlaneParam[1] = normalPlane(1);
   PlaneParam[2] = normalPlane(2);
@@ -134,21 +108,66 @@ void RefineRansac(std::vector<Eigen::Matrix<double, 3, 1> >& Points, vtkPolyData
   output->GetPointData()->AddArray(inliersArray.Get());
 }
 
+//----------------------------------------------------------------------------
+void AlignToPlane(std::vector<Eigen::Vector3d>& Points, const double PlaneParam[4])
+{
+  Eigen::Vector3d n(PlaneParam[0], PlaneParam[1], PlaneParam[2]);
+  Eigen::Vector3d v = n.cross(Eigen::Vector3d::UnitZ());
+  double angle = std::asin(v.norm());
+  Eigen::AngleAxisd rot(angle, v.normalized());
+  Eigen::Vector3d shift(0.0, 0.0, PlaneParam[3]);
+
+  // transform points
+  for (auto& pt : Points)
+  {
+    pt =  rot * pt + shift;
+  }
+}
 
 //----------------------------------------------------------------------------
-unsigned int ComputeNumberOfInlier(std::vector<Eigen::Matrix<double, 3, 1> >& Points, Eigen::Matrix<double, 3, 1> planePoint,
-                                   Eigen::Matrix<double, 3, 1> planeNormal, double threshold)
+// Refine a plane with iteratively reweighted least squares, the points being
+// weighted with the Tukey biweight of their distance to the current plane
+bool RefineTrackedPlane(const RansacPoints& points, float plane[4], double band, unsigned int iterations)
 {
-  unsigned int nInliers = 0;
-  for (unsigned int k = 0; k < Points.size(); ++k)
+  for (unsigned int iteration = 0; iteration < iterations; ++iteration)
   {
-    if (std::abs((Points[k] - planePoint).dot(planeNormal)) < threshold)
+    double sumWeights = 0;
+    Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+    Eigen::Matrix3d sumSquares = Eigen::Matrix3d::Zero();
+    for (size_t k = 0; k < points.size(); ++k)
     {
-      nInliers++;
+      const double distance = plane[0] * points.X[k] + plane[1] * points.Y[k] + plane[2] * points.Z[k] + plane[3];
+      const double u = distance / band;
+      if (std::abs(u) >= 1.)
+      {
+        continue;
+      }
+      const double weight = (1. - u * u) * (1. - u * u);
+      const Eigen::Vector3d point(points.X[k], points.Y[k], points.Z[k]);
+      sumWeights += weight;
+      sum += weight * point;
+      sumSquares += weight * point * point.transpose();
+    }
+    if (sumWeights <= 0)
+    {
+      return false;
     }
-  }
 
-  return nInliers;
+    // the normal is the direction of least weighted variance
+    const Eigen::Vector3d center = sum / sumWeights;
+    const Eigen::Matrix3d covariance = sumSquares / sumWeights - center * center.transpose();
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigenSolver(covariance);
+    Eigen::Vector3d normal = eigenSolver.eigenvectors().col(0);
+    if (normal.dot(Eigen::Vector3d(plane[0], plane[1], plane[2])) < 0)
+    {
+      normal = -normal;
+    }
+    plane[0] = normal(0);
+    plane[1] = normal(1);
+    plane[2] = normal(2);
+    plane[3] = -normal.dot(center);
+  }
+  return true;
 }
 
 // Implementation of the New function
@@ -173,6 +192,12 @@ vtkRansacPlaneModel::vtkRansacPlaneModel()
   this->TemporalAveraging = true;
   this->MaxTemporalAngleChange = 45.0;
   this->PreviousEstimationWeight = 0.9;
+  this->AssembleSectors = true;
+  this->TrackPlane = false;
+  this->TrackingIterations = 3;
+  this->TrackingBand = 1.0;
+  this->NumberOfThreads = 0;
+  this->Seed = 0;
 }
 
 //----------------------------------------------------------------------------
@@ -190,6 +215,7 @@ void vtkRansacPlaneModel::PrintSelf(ostream& os, vtkIndent indent)
 int vtkRansacPlaneModel::RequestData(vtkInformation *vtkNotUsed(request),
   vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkRansacPlaneModel::RequestData");
   // Save the previous plane estimate
   double prevPlaneEst[4];
   std::copy(this->PlaneParam, this->PlaneParam + 4, prevPlaneEst);
@@ -199,90 +225,79 @@ int vtkRansacPlaneModel::RequestData(vtkInformation *vtkNotUsed(request),
 
   // Get the output
   vtkPolyData *output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
-  output->ShallowCopy(input);
-
-  // Convert the point cloud in Eigen data structure point cloud
-  std::vector<Eigen::Vector3d> Points = vtkPointsToEigenVector(input->GetPoints());
 
-  // Create a random order of points index
-  std::vector<double> randomIndex(input->GetNumberOfPoints(), 0);
-  for (unsigned int k = 0; k < randomIndex.size(); ++k)
+  // a sector of a live stream only has a part of the ground, its frame is fitted once
+  // complete and the sectors in between are only aligned with the current estimate
+  if (this->AssembleSectors)
   {
-    randomIndex[k] = k;
-  }
-  std::random_shuffle(randomIndex.begin(), randomIndex.end());
-
-  // information variable about ransac iterations
-  bool shouldStopRansac = false;
-  unsigned int iterationMade = 0;
-  unsigned int iterationPointer = 0;
-
-  // keep information of iterations
-  std::vector<RansacSampleInfo> samplesInfo;
-  unsigned int maxInliers = 0;
-  unsigned int indexMaxInliers = 0;
-
-  // Affine plane PlaneParameters
-  Eigen::Matrix<double, 3, 1> planeNormal, planePoint;
-
-  // indicate if ransac has "converged"
-  bool hasConverged = false;
-
-  // Ransac loop
-  while (!shouldStopRansac)
-  {
-    // if we went throught the all random index we need
-    // to random shuffle again
-    if ((iterationPointer + 2) >= randomIndex.size())
+    if (!this->Assembler.AddSector(input))
     {
-      std::random_shuffle(randomIndex.begin(), randomIndex.end());
-      iterationPointer = 0;
+      output->ShallowCopy(input);
+      Eigen::Vector3d n(this->PlaneParam[0], this->PlaneParam[1], this->PlaneParam[2]);
+      if (this->AlignOutput && std::abs(n.norm() - 1) < 1e-3)
+      {
+        std::vector<Eigen::Vector3d> Points = vtkPointsToEigenVector(input->GetPoints());
+        AlignToPlane(Points, this->PlaneParam);
+        output->SetPoints(eigenVectorToVTKPoints(Points));
+      }
+      return 1;
     }
+    input = this->Assembler.GetFrame();
+  }
+  output->ShallowCopy(input);
 
-    // Compute current sample plane PlaneParameters
-    planePoint = Points[randomIndex[iterationPointer]];
-    planeNormal = (Points[randomIndex[iterationPointer + 2]] - planePoint).cross(Points[randomIndex[iterationPointer + 1]] - planePoint);
-    planeNormal.normalize();
-
-    // Compute the number of inliers / outliers
-    unsigned int nInliers = ComputeNumberOfInlier(Points, planePoint, planeNormal, this->Threshold);
-
-    // keep info
-    RansacSampleInfo info(nInliers, randomIndex[iterationPointer], randomIndex[iterationPointer + 1], randomIndex[iterationPointer + 2]);
-    samplesInfo.push_back(info);
-
-    if (nInliers > maxInliers)
-    {
-      maxInliers = nInliers;
-      indexMaxInliers = iterationMade;
-    }
+  // Convert the point cloud in Eigen data structure point cloud
+  std::vector<Eigen::Vector3d> Points = vtkPointsToEigenVector(input->GetPoints());
 
-    // Check that the number of inliers is enought to
-    // break the ransac algorithm loop
-    if (nInliers > input->GetNumberOfPoints() * this->RatioInliersRequired)
+  // Fit the plane on a float copy of the points, stored per component
+  RansacEngine engine;
+  engine.MaxIterations = this->MaxRansacIteration;
+  engine.Threshold = this->Threshold;
+  engine.RatioInliersRequired = this->RatioInliersRequired;
+  engine.NumberOfThreads = this->NumberOfThreads;
+  engine.Seed = this->Seed++;
+  RansacPlane model;
+  RansacPoints ransacPoints(input->GetPoints());
+  RansacEngine::Result result;
+  std::vector<unsigned char> inliers;
+
+  // The previous plane is refined, and kept if it still has enough inliers
+  bool isTracked = false;
+  if (this->TrackPlane && std::abs(Eigen::Vector3d(prevPlaneEst[0], prevPlaneEst[1], prevPlaneEst[2]).norm() - 1) < 1e-3)
+  {
+    std::copy(prevPlaneEst, prevPlaneEst + 4, result.Parameters);
+    if (RefineTrackedPlane(ransacPoints, result.Parameters, this->TrackingBand, this->TrackingIterations))
     {
-      shouldStopRansac = true;
-      hasConverged = true;
+      engine.ComputeInliers(model, result.Parameters, ransacPoints, inliers);
+      result.NumberOfInliers = std::count(inliers.begin(), inliers.end(), 1);
+      isTracked = result.NumberOfInliers > ransacPoints.size() * this->RatioInliersRequired;
     }
+  }
 
-    // check if the maximum iteration has been reached
-    if (iterationMade > this->MaxRansacIteration)
+  if (!isTracked)
+  {
+    if (!engine.Run(model, ransacPoints, result))
     {
-      shouldStopRansac = true;
+      vtkErrorMacro("Cannot fit a plane on " << input->GetNumberOfPoints() << " points");
+      return 0;
     }
-
-    // Updates iterations index
-    iterationMade++;
-    iterationPointer += 3; 
+    engine.ComputeInliers(model, result.Parameters, ransacPoints, inliers);
   }
 
   // Now refine using all inliers
-  RefineRansac(Points, output, samplesInfo[indexMaxInliers], this->Threshold, this->PlaneParam);
+  RefineRansac(Points, output, inliers, this->PlaneParam);
 
   // output info
-  std::cout << "ransac algorithm has converged: " << hasConverged << std::endl;
-  std::cout << "number of iteration made: " << iterationMade << std::endl;
-  std::cout << "number of inliers: " << maxInliers << ", " << samplesInfo[indexMaxInliers].NInliers << std::endl;
+  if (isTracked)
+  {
+    std::cout << "previous plane tracked" << std::endl;
+  }
+  else
+  {
+    std::cout << "ransac algorithm has converged: " << result.HasConverged << std::endl;
+    std::cout << "number of iteration made: " << result.NumberOfIterations << std::endl;
+  }
+  std::cout << "number of inliers: " << result.NumberOfInliers << std::endl;
   std::cout << "plane PlaneParams: [" << this->PlaneParam[0] << "," << this->PlaneParam[1] << "," << this->PlaneParam[2] << "," << this->PlaneParam[3] << "]" << std::endl;
 
   // flip normal if needed
@@ -330,16 +345,7 @@ int vtkRansacPlaneModel::RequestData(vtkInformation *vtkNotUsed(request),
   // transform output if enabled
   if (this->AlignOutput)
   {
-    Eigen::Vector3d v = n.cross(Eigen::Vector3d::UnitZ());
-    double angle = std::asin(v.norm());
-    Eigen::AngleAxisd rot(angle, v.normalized());
-    Eigen::Vector3d shift(0.0, 0.0, d);
-
-    // transform points
-    for (auto& pt : Points)
-    {
-      pt =  rot * pt + shift;
-    }
+    AlignToPlane(Points, this->PlaneParam);
     // copy points to output
     output->SetPoints(eigenVectorToVTKPoints(Points));
   }
@@ -17,6 +17,9 @@
 #ifndef VTK_RANSAC_PLANE_MODEL_H
 #define VTK_RANSAC_PLANE_MODEL_H
 
+// LOCAL
+#include "LidarSectorAssembler.h"
+
 // VTK
 #include <vtkPolyData.h>
 #include <vtkPolyDataAlgorithm.h>
@@ -77,6 +80,36 @@ class VTK_EXPORT vtkRansacPlaneModel : public vtkPolyDataAlgorithm
   /// Set how much the previous estimation is used in temporal averaging
   vtkSetMacro(PreviousEstimationWeight, double)
 
+  /// Get the option to fit the plane on the complete frames of a stream giving sectors
+  vtkGetMacro(AssembleSectors, bool)
+
+  /// Set the option to fit the plane on the complete frames of a stream giving sectors
+  vtkSetMacro(AssembleSectors, bool)
+
+  /// Get the option to refine the previous plane instead of running the ransac
+  vtkGetMacro(TrackPlane, bool)
+
+  /// Set the option to refine the previous plane instead of running the ransac
+  vtkSetMacro(TrackPlane, bool)
+
+  /// Get the number of reweighted least squares iterations refining the previous plane
+  vtkGetMacro(TrackingIterations, unsigned int)
+
+  /// Set the number of reweighted least squares iterations refining the previous plane
+  vtkSetMacro(TrackingIterations, unsigned int)
+
+  /// Get the distance to the previous plane of the points used to refine it
+  vtkGetMacro(TrackingBand, double)
+
+  /// Set the distance to the previous plane of the points used to refine it
+  vtkSetMacro(TrackingBand, double)
+
+  /// Get the number of threads evaluating the ransac hypotheses
+  vtkGetMacro(NumberOfThreads, int)
+
+  /// Set the number of threads evaluating the ransac hypotheses, 0 uses one thread per core
+  vtkSetMacro(NumberOfThreads, int)
+
 protected:
   // constructor / destructor
   vtkRansacPlaneModel();
@@ -113,6 +146,29 @@ private:
 
   /// how much the previous estimation is used in temporal averaging
   double PreviousEstimationWeight;
+
+  /// fit the plane once all the sectors of a frame are received, instead of on each sector
+  bool AssembleSectors;
+
+  /// sectors of the frame under construction
+  LidarSectorAssembler Assembler;
+
+  /// refine the previous plane with reweighted least squares, the ransac is only
+  /// run when the refined plane has less than RatioInliersRequired inliers
+  bool TrackPlane;
+
+  /// number of reweighted least squares iterations refining the previous plane
+  unsigned int TrackingIterations;
+
+  /// distance to the previous plane of the points used to refine it, the weights
+  /// of the points decrease to 0 at this distance
+  double TrackingBand;
+
+  /// number of threads evaluating the ransac hypotheses
+  int NumberOfThreads;
+
+  /// seed of the ransac samples, changed for each frame
+  unsigned int Seed;
 };
 
 #endif // VTK_RANSAC_PLANE_MODEL_H
\ No newline at end of file
@@ -0,0 +1,127 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "ImuPreintegration.h"
+
+// STD
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+void ImuPreintegration::AddMeasurement(double time, const Eigen::Vector3d& angularVelocity,
+                                       const Eigen::Vector3d& acceleration)
+{
+  if (!this->Measurements.empty() && time <= this->Measurements.back().Time)
+  {
+    return;
+  }
+  Measurement measurement;
+  measurement.Time = time;
+  measurement.AngularVelocity = angularVelocity;
+  measurement.Acceleration = acceleration;
+  this->Measurements.push_back(measurement);
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Matrix3d ImuPreintegration::Exp(const Eigen::Vector3d& rotation)
+{
+  const double angle = rotation.norm();
+  if (angle < 1e-9)
+  {
+    return Eigen::Matrix3d::Identity();
+  }
+  return Eigen::AngleAxisd(angle, rotation / angle).toRotationMatrix();
+}
+
+//-----------------------------------------------------------------------------
+ImuPreintegration::Measurement ImuPreintegration::Interpolate(size_t index, double time) const
+{
+  const Measurement& m0 = this->Measurements[index];
+  const Measurement& m1 = this->Measurements[index + 1];
+  const double ratio = (time - m0.Time) / (m1.Time - m0.Time);
+  Measurement measurement;
+  measurement.Time = time;
+  measurement.AngularVelocity = (1.0 - ratio) * m0.AngularVelocity + ratio * m1.AngularVelocity;
+  measurement.Acceleration = (1.0 - ratio) * m0.Acceleration + ratio * m1.Acceleration;
+  return measurement;
+}
+
+//-----------------------------------------------------------------------------
+bool ImuPreintegration::Integrate(double t0, double t1, Delta& delta)
+{
+  delta = Delta();
+  if (this->Measurements.size() < 2 || t1 <= t0 ||
+      this->Measurements.front().Time > t0 || this->Measurements.back().Time < t1)
+  {
+    return false;
+  }
+
+  // first measurement after t0
+  auto isBefore = [](const Measurement& m, double time) { return m.Time < time; };
+  const size_t first = std::lower_bound(this->Measurements.begin(), this->Measurements.end(),
+                                        t0, isBefore) - this->Measurements.begin();
+
+  // gravity in the referential of the IMU at t0
+  Eigen::Vector3d gravity = Eigen::Vector3d::Zero();
+  unsigned int numberOfGravityMeasurements = 0;
+  for (size_t index = first; index-- > 0 && this->Measurements[index].Time >= t0 - this->GravityWindow;)
+  {
+    gravity += this->Measurements[index].Acceleration - this->AccelerometerBias;
+    numberOfGravityMeasurements++;
+  }
+  if (numberOfGravityMeasurements == 0)
+  {
+    gravity = this->Measurements[first].Acceleration - this->AccelerometerBias;
+  }
+  else
+  {
+    gravity /= numberOfGravityMeasurements;
+  }
+
+  // midpoint integration over the measurements between t0 and t1,
+  // the first and last intervals start and end at them
+  Measurement previous = first > 0 ? this->Interpolate(first - 1, t0) : this->Measurements[first];
+  previous.Time = t0;
+  for (size_t index = first; previous.Time < t1; ++index)
+  {
+    const Measurement current = this->Measurements[index].Time > t1 ?
+      this->Interpolate(index - 1, t1) : this->Measurements[index];
+    const double dt = current.Time - previous.Time;
+    if (dt <= 0.0)
+    {
+      previous = current;
+      continue;
+    }
+
+    const Eigen::Vector3d angularVelocity = 0.5 * (previous.AngularVelocity + current.AngularVelocity)
+                                          - this->GyroscopeBias;
+    const Eigen::Matrix3d rotation = delta.Rotation * Exp(0.5 * dt * angularVelocity);
+    const Eigen::Vector3d acceleration = rotation * (0.5 * (previous.Acceleration + current.Acceleration)
+                                       - this->AccelerometerBias) - gravity;
+
+    delta.Position += delta.Velocity * dt + 0.5 * acceleration * dt * dt;
+    delta.Velocity += acceleration * dt;
+    delta.Rotation = delta.Rotation * Exp(dt * angularVelocity);
+    previous = current;
+  }
+
+  // the measurements before the gravity window will not be used again
+  while (this->Measurements.size() > 2 && this->Measurements[1].Time < t0 - this->GravityWindow)
+  {
+    this->Measurements.pop_front();
+  }
+  return true;
+}
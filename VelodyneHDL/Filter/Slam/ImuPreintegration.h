@@ -0,0 +1,95 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef IMU_PREINTEGRATION_H
+#define IMU_PREINTEGRATION_H
+
+// STD
+#include <deque>
+
+// EIGEN
+#include <Eigen/Dense>
+
+/**
+ * \class ImuPreintegration
+ * \brief Preintegration of the IMU measurements between two times, which gives
+ *        the rotation, velocity and position deltas of the IMU expressed in its
+ *        referential at the first time, independently of its unknown velocity.
+ *
+ *        The gravity is removed from the accelerations with its direction in the
+ *        IMU referential, estimated as the mean of the accelerations measured
+ *        during GravityWindow seconds before the first time. The biases of the
+ *        gyroscopes and accelerometers are constant, and zero unless they are set.
+ *
+ *        The measurements are in rad/s and m/s^2, in the IMU axes, and must be
+ *        added in time order. The measurements older than the gravity window of
+ *        an integration are dropped.
+ */
+class ImuPreintegration
+{
+public:
+  struct Measurement
+  {
+    double Time;
+    Eigen::Vector3d AngularVelocity;
+    Eigen::Vector3d Acceleration;
+  };
+
+  struct Delta
+  {
+    //! Rotation of the IMU at the second time in its referential at the first time
+    Eigen::Matrix3d Rotation = Eigen::Matrix3d::Identity();
+    //! Velocity and position change due to the accelerations, without gravity
+    Eigen::Vector3d Velocity = Eigen::Vector3d::Zero();
+    Eigen::Vector3d Position = Eigen::Vector3d::Zero();
+  };
+
+  //! Add a measurement, it is ignored if it is older than the last one
+  void AddMeasurement(double time, const Eigen::Vector3d& angularVelocity,
+                      const Eigen::Vector3d& acceleration);
+
+  void Clear() { this->Measurements.clear(); }
+
+  size_t GetNumberOfMeasurements() const { return this->Measurements.size(); }
+
+  /**
+   * @brief Integrate the measurements between two times, the ones around them
+   * are interpolated
+   * @return false if the measurements do not cover the interval
+   */
+  bool Integrate(double t0, double t1, Delta& delta);
+
+  void SetGyroscopeBias(const Eigen::Vector3d& bias) { this->GyroscopeBias = bias; }
+  void SetAccelerometerBias(const Eigen::Vector3d& bias) { this->AccelerometerBias = bias; }
+
+  //! Duration (s) of the measurements averaged to estimate the gravity
+  void SetGravityWindow(double window) { this->GravityWindow = window; }
+
+  //! Rotation vector whose exponential is a rotation matrix, stable for small angles
+  static Eigen::Matrix3d Exp(const Eigen::Vector3d& rotation);
+
+private:
+  //! Measurement interpolated at a time between two of them
+  Measurement Interpolate(size_t index, double time) const;
+
+  std::deque<Measurement> Measurements;
+  Eigen::Vector3d GyroscopeBias = Eigen::Vector3d::Zero();
+  Eigen::Vector3d AccelerometerBias = Eigen::Vector3d::Zero();
+  double GravityWindow = 1.0;
+};
+
+#endif // IMU_PREINTEGRATION_H
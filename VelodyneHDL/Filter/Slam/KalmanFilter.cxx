@@ -150,9 +150,6 @@ void KalmanFilter::Correction(Eigen::MatrixXd Measure)
     this->MeasureModel(6, 9) = this->VectorStatePredicted(9) / nv;
     this->MeasureModel(6, 10) = this->VectorStatePredicted(10) / nv;
     this->MeasureModel(6, 11) = this->VectorStatePredicted(11) / nv;
-    std::cout << "Vector State: " << std::endl << this->VectorStatePredicted.transpose() << std::endl;
-    std::cout << "Measure: " << std::endl << Measure.transpose() << std::endl;
-    std::cout << "Measure model: " << std::endl << this->MeasureModel << std::endl;
   }
 
   // Update using the measure and its covariance
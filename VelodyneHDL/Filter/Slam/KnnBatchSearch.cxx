@@ -0,0 +1,155 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "KnnBatchSearch.h"
+#ifdef VELOVIEW_HAS_CUDA
+#include "KnnBatchSearchCuda.h"
+#endif
+
+// STD
+#include <algorithm>
+#include <functional>
+
+// BOOST
+#include <boost/thread/thread.hpp>
+
+namespace
+{
+//! Queries searched by a thread at least, below the threads cost more than they save
+const size_t MinimumQueriesPerThread = 64;
+}
+
+//-----------------------------------------------------------------------------
+KnnBatchSearch::~KnnBatchSearch()
+{
+#ifdef VELOVIEW_HAS_CUDA
+  KnnCuda::Release(this->Device);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+bool KnnBatchSearch::IsGpuAvailable()
+{
+#ifdef VELOVIEW_HAS_CUDA
+  static const bool isAvailable = KnnCuda::IsAvailable();
+  return isAvailable;
+#else
+  return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+KnnBatchSearch::Backend KnnBatchSearch::GetBackend() const
+{
+  return (this->RequestedBackend == GPU && IsGpuAvailable()) ? GPU : CPU;
+}
+
+//-----------------------------------------------------------------------------
+void KnnBatchSearch::SetSearch(const pcl::search::Search<Point>::Ptr& search)
+{
+  this->CpuSearch = search;
+#ifdef VELOVIEW_HAS_CUDA
+  if (this->GetBackend() == GPU)
+  {
+    const pcl::PointCloud<Point>& cloud = *search->getInputCloud();
+    std::vector<float> xyz(3 * cloud.size());
+    for (size_t index = 0; index < cloud.size(); ++index)
+    {
+      xyz[3 * index + 0] = cloud[index].x;
+      xyz[3 * index + 1] = cloud[index].y;
+      xyz[3 * index + 2] = cloud[index].z;
+    }
+    this->Device = KnnCuda::Upload(this->Device, xyz.data(), cloud.size());
+  }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void KnnBatchSearch::Search(const pcl::PointCloud<Point>& queries, unsigned int k)
+{
+  this->K = k;
+  this->Indices.assign(queries.size() * k, -1);
+  this->SquaredDistances.assign(queries.size() * k, 0.0f);
+  this->Counts.assign(queries.size(), 0);
+  if (queries.empty() || k == 0)
+  {
+    return;
+  }
+
+  if (this->GetBackend() == GPU && k <= MaximumGpuNeighbors && this->SearchOnGpu(queries))
+  {
+    return;
+  }
+  this->SearchOnCpu(queries);
+}
+
+//-----------------------------------------------------------------------------
+void KnnBatchSearch::SearchOnCpu(const pcl::PointCloud<Point>& queries)
+{
+  auto searchRange = [&](size_t begin, size_t end) {
+    std::vector<int> indices;
+    std::vector<float> distances;
+    for (size_t query = begin; query < end; ++query)
+    {
+      const unsigned int count = this->CpuSearch->nearestKSearch(queries[query], this->K, indices, distances);
+      std::copy(indices.begin(), indices.begin() + count, this->Indices.begin() + query * this->K);
+      std::copy(distances.begin(), distances.begin() + count, this->SquaredDistances.begin() + query * this->K);
+      this->Counts[query] = count;
+    }
+  };
+
+  const size_t numberOfQueries = queries.size();
+  const size_t numberOfThreads = std::max<size_t>(1,
+    std::min<size_t>(this->NumberOfThreads, numberOfQueries / MinimumQueriesPerThread));
+  const size_t rangeSize = (numberOfQueries + numberOfThreads - 1) / numberOfThreads;
+  boost::thread_group threads;
+  for (size_t range = 1; range < numberOfThreads; ++range)
+  {
+    threads.create_thread(std::bind(searchRange, range * rangeSize,
+                                    std::min(numberOfQueries, (range + 1) * rangeSize)));
+  }
+  searchRange(0, std::min(numberOfQueries, rangeSize));
+  threads.join_all();
+}
+
+//-----------------------------------------------------------------------------
+bool KnnBatchSearch::SearchOnGpu(const pcl::PointCloud<Point>& queries)
+{
+#ifdef VELOVIEW_HAS_CUDA
+  std::vector<float> xyz(3 * queries.size());
+  for (size_t index = 0; index < queries.size(); ++index)
+  {
+    xyz[3 * index + 0] = queries[index].x;
+    xyz[3 * index + 1] = queries[index].y;
+    xyz[3 * index + 2] = queries[index].z;
+  }
+  if (!this->Device || !KnnCuda::Search(this->Device, xyz.data(), queries.size(), this->K,
+                                        this->Indices.data(), this->SquaredDistances.data()))
+  {
+    return false;
+  }
+  for (size_t query = 0; query < queries.size(); ++query)
+  {
+    const int* indices = this->GetIndices(query);
+    this->Counts[query] = std::find(indices, indices + this->K, -1) - indices;
+  }
+  return true;
+#else
+  (void)queries;
+  return false;
+#endif
+}
@@ -0,0 +1,106 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef KNN_BATCH_SEARCH_H
+#define KNN_BATCH_SEARCH_H
+
+// STD
+#include <vector>
+
+// PCL
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/search/search.h>
+
+namespace KnnCuda
+{
+struct DeviceCloud;
+}
+
+/**
+ * \class KnnBatchSearch
+ * \brief K nearest neighbors of a batch of queries, all searched at once: the
+ *        queries of an ICP iteration are searched in a single call instead of
+ *        one search per keypoint.
+ *
+ *        The CPU backend runs the search of the reference cloud from several
+ *        threads. The GPU backend, only available when built with CUDA, keeps
+ *        the reference cloud on the device and runs a brute-force search with a
+ *        thread per query. It falls back to the CPU backend when there is no
+ *        device, or more neighbors than MaximumGpuNeighbors are requested.
+ *
+ *        The reference cloud may hold NaN points, which are never found.
+ */
+class KnnBatchSearch
+{
+public:
+  typedef pcl::PointXYZINormal Point;
+
+  enum Backend
+  {
+    CPU = 0,
+    GPU = 1
+  };
+
+  //! Largest number of neighbors searched on the GPU
+  static const unsigned int MaximumGpuNeighbors = 32;
+
+  KnnBatchSearch() = default;
+  ~KnnBatchSearch();
+  KnnBatchSearch(const KnnBatchSearch&) = delete;
+  KnnBatchSearch& operator=(const KnnBatchSearch&) = delete;
+
+  //! Whether the GPU backend has been built and a device is available
+  static bool IsGpuAvailable();
+
+  //! Requested backend, the GPU one is only used if it is available
+  void SetBackend(Backend backend) { this->RequestedBackend = backend; }
+  Backend GetBackend() const;
+
+  void SetNumberOfThreads(unsigned int numberOfThreads) { this->NumberOfThreads = numberOfThreads; }
+
+  /**
+   * @brief SetSearch set the search of the reference cloud, used by the CPU backend.
+   * Its input cloud is copied to the device by the GPU backend, so this must be
+   * called again when it changes
+   */
+  void SetSearch(const pcl::search::Search<Point>::Ptr& search);
+
+  //! Search the k nearest neighbors of all the queries, sorted by distance
+  void Search(const pcl::PointCloud<Point>& queries, unsigned int k);
+
+  //! Results of a query, there may be less than k neighbors
+  unsigned int GetNumberOfNeighbors(size_t query) const { return this->Counts[query]; }
+  const int* GetIndices(size_t query) const { return this->Indices.data() + query * this->K; }
+  const float* GetSquaredDistances(size_t query) const { return this->SquaredDistances.data() + query * this->K; }
+
+private:
+  void SearchOnCpu(const pcl::PointCloud<Point>& queries);
+  bool SearchOnGpu(const pcl::PointCloud<Point>& queries);
+
+  Backend RequestedBackend = CPU;
+  unsigned int NumberOfThreads = 1;
+  pcl::search::Search<Point>::Ptr CpuSearch;
+  KnnCuda::DeviceCloud* Device = nullptr;
+
+  unsigned int K = 0;
+  std::vector<int> Indices;
+  std::vector<float> SquaredDistances;
+  std::vector<unsigned int> Counts;
+};
+
+#endif // KNN_BATCH_SEARCH_H
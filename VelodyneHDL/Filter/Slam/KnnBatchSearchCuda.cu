@@ -0,0 +1,206 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "KnnBatchSearchCuda.h"
+
+// CUDA
+#include <cuda_runtime.h>
+#include <math_constants.h>
+
+namespace
+{
+//! Must be the same as KnnBatchSearch::MaximumGpuNeighbors
+const unsigned int MaximumNeighbors = 32;
+//! Queries of a block, whose threads load the reference points in shared memory together
+const unsigned int BlockSize = 128;
+
+//-----------------------------------------------------------------------------
+// Each thread keeps the k nearest reference points of its query sorted, the
+// reference points are read by tiles shared by the threads of the block. NaN
+// points are never inserted since the comparisons with them are false
+__global__ void SearchKernel(const float* __restrict__ points, unsigned int numberOfPoints,
+                             const float* __restrict__ queries, unsigned int numberOfQueries,
+                             unsigned int k, int* indices, float* squaredDistances)
+{
+  __shared__ float tile[3 * BlockSize];
+  const unsigned int query = blockIdx.x * blockDim.x + threadIdx.x;
+  const bool isQuery = query < numberOfQueries;
+
+  float qx = 0.f, qy = 0.f, qz = 0.f;
+  if (isQuery)
+  {
+    qx = queries[3 * query + 0];
+    qy = queries[3 * query + 1];
+    qz = queries[3 * query + 2];
+  }
+
+  float bestDistances[MaximumNeighbors];
+  int bestIndices[MaximumNeighbors];
+  for (unsigned int i = 0; i < k; ++i)
+  {
+    bestDistances[i] = CUDART_INF_F;
+    bestIndices[i] = -1;
+  }
+
+  for (unsigned int tileStart = 0; tileStart < numberOfPoints; tileStart += BlockSize)
+  {
+    const unsigned int loaded = tileStart + threadIdx.x;
+    if (loaded < numberOfPoints)
+    {
+      tile[3 * threadIdx.x + 0] = points[3 * loaded + 0];
+      tile[3 * threadIdx.x + 1] = points[3 * loaded + 1];
+      tile[3 * threadIdx.x + 2] = points[3 * loaded + 2];
+    }
+    __syncthreads();
+
+    const unsigned int tileSize = min(BlockSize, numberOfPoints - tileStart);
+    for (unsigned int i = 0; isQuery && i < tileSize; ++i)
+    {
+      const float dx = tile[3 * i + 0] - qx;
+      const float dy = tile[3 * i + 1] - qy;
+      const float dz = tile[3 * i + 2] - qz;
+      const float distance = dx * dx + dy * dy + dz * dz;
+      if (distance < bestDistances[k - 1])
+      {
+        // insertion in the sorted neighbors
+        int position = k - 1;
+        while (position > 0 && bestDistances[position - 1] > distance)
+        {
+          bestDistances[position] = bestDistances[position - 1];
+          bestIndices[position] = bestIndices[position - 1];
+          --position;
+        }
+        bestDistances[position] = distance;
+        bestIndices[position] = tileStart + i;
+      }
+    }
+    __syncthreads();
+  }
+
+  if (isQuery)
+  {
+    for (unsigned int i = 0; i < k; ++i)
+    {
+      indices[query * k + i] = bestIndices[i];
+      squaredDistances[query * k + i] = bestIndices[i] < 0 ? 0.f : bestDistances[i];
+    }
+  }
+}
+}
+
+namespace KnnCuda
+{
+struct DeviceCloud
+{
+  float* Points = nullptr;
+  size_t NumberOfPoints = 0;
+  size_t Capacity = 0;
+  //! Buffers of the queries and results, grown as needed
+  float* Queries = nullptr;
+  int* Indices = nullptr;
+  float* SquaredDistances = nullptr;
+  size_t QueriesCapacity = 0;
+};
+
+//-----------------------------------------------------------------------------
+bool IsAvailable()
+{
+  int numberOfDevices = 0;
+  return cudaGetDeviceCount(&numberOfDevices) == cudaSuccess && numberOfDevices > 0;
+}
+
+//-----------------------------------------------------------------------------
+DeviceCloud* Upload(DeviceCloud* previous, const float* xyz, size_t numberOfPoints)
+{
+  DeviceCloud* cloud = previous ? previous : new DeviceCloud();
+  if (numberOfPoints > cloud->Capacity)
+  {
+    cudaFree(cloud->Points);
+    cloud->Points = nullptr;
+    cloud->Capacity = 0;
+    if (cudaMalloc(&cloud->Points, 3 * numberOfPoints * sizeof(float)) != cudaSuccess)
+    {
+      Release(cloud);
+      return nullptr;
+    }
+    cloud->Capacity = numberOfPoints;
+  }
+  cloud->NumberOfPoints = numberOfPoints;
+  if (numberOfPoints > 0 &&
+      cudaMemcpy(cloud->Points, xyz, 3 * numberOfPoints * sizeof(float), cudaMemcpyHostToDevice) != cudaSuccess)
+  {
+    Release(cloud);
+    return nullptr;
+  }
+  return cloud;
+}
+
+//-----------------------------------------------------------------------------
+void Release(DeviceCloud* cloud)
+{
+  if (!cloud)
+  {
+    return;
+  }
+  cudaFree(cloud->Points);
+  cudaFree(cloud->Queries);
+  cudaFree(cloud->Indices);
+  cudaFree(cloud->SquaredDistances);
+  delete cloud;
+}
+
+//-----------------------------------------------------------------------------
+bool Search(DeviceCloud* cloud, const float* queries, size_t numberOfQueries, unsigned int k,
+            int* indices, float* squaredDistances)
+{
+  if (k == 0 || k > MaximumNeighbors)
+  {
+    return false;
+  }
+
+  // the results buffers hold MaximumNeighbors neighbors per query so that
+  // they do not depend on k
+  if (numberOfQueries > cloud->QueriesCapacity)
+  {
+    cudaFree(cloud->Queries);
+    cudaFree(cloud->Indices);
+    cudaFree(cloud->SquaredDistances);
+    cloud->Queries = nullptr;
+    cloud->Indices = nullptr;
+    cloud->SquaredDistances = nullptr;
+    cloud->QueriesCapacity = 0;
+    if (cudaMalloc(&cloud->Queries, 3 * numberOfQueries * sizeof(float)) != cudaSuccess ||
+        cudaMalloc(&cloud->Indices, MaximumNeighbors * numberOfQueries * sizeof(int)) != cudaSuccess ||
+        cudaMalloc(&cloud->SquaredDistances, MaximumNeighbors * numberOfQueries * sizeof(float)) != cudaSuccess)
+    {
+      return false;
+    }
+    cloud->QueriesCapacity = numberOfQueries;
+  }
+
+  if (cudaMemcpy(cloud->Queries, queries, 3 * numberOfQueries * sizeof(float), cudaMemcpyHostToDevice) != cudaSuccess)
+  {
+    return false;
+  }
+  const unsigned int numberOfBlocks = static_cast<unsigned int>((numberOfQueries + BlockSize - 1) / BlockSize);
+  SearchKernel<<<numberOfBlocks, BlockSize>>>(cloud->Points, static_cast<unsigned int>(cloud->NumberOfPoints),
+    cloud->Queries, static_cast<unsigned int>(numberOfQueries), k, cloud->Indices, cloud->SquaredDistances);
+  return cudaGetLastError() == cudaSuccess &&
+    cudaMemcpy(indices, cloud->Indices, k * numberOfQueries * sizeof(int), cudaMemcpyDeviceToHost) == cudaSuccess &&
+    cudaMemcpy(squaredDistances, cloud->SquaredDistances, k * numberOfQueries * sizeof(float), cudaMemcpyDeviceToHost) == cudaSuccess;
+}
+}
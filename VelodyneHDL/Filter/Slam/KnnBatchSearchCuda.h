@@ -0,0 +1,49 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef KNN_BATCH_SEARCH_CUDA_H
+#define KNN_BATCH_SEARCH_CUDA_H
+
+// STD
+#include <cstddef>
+
+// Brute-force k nearest neighbors on the GPU, only built with CUDA. The
+// points are given as contiguous x, y, z floats
+namespace KnnCuda
+{
+//! Reference cloud copied to the device
+struct DeviceCloud;
+
+//! Whether there is a CUDA device
+bool IsAvailable();
+
+//! Copy a cloud to the device, reusing the memory of a previous one if given
+DeviceCloud* Upload(DeviceCloud* previous, const float* xyz, size_t numberOfPoints);
+
+void Release(DeviceCloud* cloud);
+
+/**
+ * @brief Search the k nearest neighbors of the queries, k must not be larger than
+ * KnnBatchSearch::MaximumGpuNeighbors. The results of a query are sorted and padded
+ * with -1 indices
+ * @return false if a CUDA call failed
+ */
+bool Search(DeviceCloud* cloud, const float* queries, size_t numberOfQueries, unsigned int k,
+            int* indices, float* squaredDistances);
+}
+
+#endif // KNN_BATCH_SEARCH_CUDA_H
@@ -0,0 +1,285 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "SlamMapFile.h"
+
+// STD
+#include <cstring>
+
+namespace
+{
+const char MapMagic[8] = { 'V', 'V', 'S', 'L', 'M', 'A', 'P', '\0' };
+const char IndexMagic[8] = { 'V', 'V', 'S', 'L', 'I', 'D', 'X', '\0' };
+
+//! Size of a chunk header: map, tile index and number of points
+const boost::uint64_t ChunkHeaderSize = 4 * sizeof(boost::int32_t) + sizeof(boost::uint32_t);
+//! Size of the footer: index offset and magic
+const boost::uint64_t FooterSize = sizeof(boost::uint64_t) + sizeof(IndexMagic);
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void WriteValue(std::fstream& stream, const T& value)
+{
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+bool ReadValue(std::fstream& stream, T& value)
+{
+  stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return stream.good();
+}
+}
+
+//-----------------------------------------------------------------------------
+SlamMapFile::~SlamMapFile()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool SlamMapFile::OpenForWriting(const std::string& filename, double tileSize)
+{
+  this->Close();
+  this->Stream.open(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!this->Stream.is_open())
+  {
+    this->LastError = "Cannot create the map file " + filename;
+    return false;
+  }
+  this->IsWriting = true;
+  this->TileSize = tileSize;
+  this->Index.clear();
+
+  this->Stream.write(MapMagic, sizeof(MapMagic));
+  WriteValue(this->Stream, static_cast<boost::uint32_t>(Version));
+  WriteValue(this->Stream, this->TileSize);
+  this->DataBegin = static_cast<boost::uint64_t>(this->Stream.tellp());
+  return this->Stream.good();
+}
+
+//-----------------------------------------------------------------------------
+bool SlamMapFile::OpenForReading(const std::string& filename)
+{
+  this->Close();
+  this->Stream.open(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!this->Stream.is_open())
+  {
+    this->LastError = "Cannot open the map file " + filename;
+    return false;
+  }
+  this->IsWriting = false;
+  this->Index.clear();
+
+  char magic[sizeof(MapMagic)];
+  boost::uint32_t version = 0;
+  this->Stream.read(magic, sizeof(magic));
+  if (!this->Stream.good() || std::memcmp(magic, MapMagic, sizeof(MapMagic)) != 0 ||
+    !ReadValue(this->Stream, version) || version != Version ||
+    !ReadValue(this->Stream, this->TileSize))
+  {
+    this->LastError = "Map file has an unsupported format";
+    this->Stream.close();
+    return false;
+  }
+  this->DataBegin = static_cast<boost::uint64_t>(this->Stream.tellg());
+
+  if (!this->ReadIndex())
+  {
+    this->Stream.close();
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void SlamMapFile::Close()
+{
+  if (!this->Stream.is_open())
+  {
+    return;
+  }
+  if (this->IsWriting)
+  {
+    // footer: the index, its offset and a magic telling that it is complete
+    this->Stream.seekp(0, std::ios::end);
+    const boost::uint64_t indexOffset = static_cast<boost::uint64_t>(this->Stream.tellp());
+    WriteValue(this->Stream, static_cast<boost::uint64_t>(this->Index.size()));
+    for (const auto& tile : this->Index)
+    {
+      for (boost::int32_t value : tile.first)
+      {
+        WriteValue(this->Stream, value);
+      }
+      WriteValue(this->Stream, static_cast<boost::uint64_t>(tile.second.size()));
+      for (boost::uint64_t offset : tile.second)
+      {
+        WriteValue(this->Stream, offset);
+      }
+    }
+    WriteValue(this->Stream, indexOffset);
+    this->Stream.write(IndexMagic, sizeof(IndexMagic));
+  }
+  this->Stream.close();
+  this->IsWriting = false;
+}
+
+//-----------------------------------------------------------------------------
+bool SlamMapFile::WriteTile(int map, const int index[3], const pcl::PointCloud<Point>& points)
+{
+  if (!this->IsWriting || points.empty())
+  {
+    return false;
+  }
+
+  this->Stream.seekp(0, std::ios::end);
+  const TileKey key = {{ map, index[0], index[1], index[2] }};
+  this->Index[key].push_back(static_cast<boost::uint64_t>(this->Stream.tellp()));
+  for (boost::int32_t value : key)
+  {
+    WriteValue(this->Stream, value);
+  }
+  WriteValue(this->Stream, static_cast<boost::uint32_t>(points.size()));
+
+  // the points are written at once
+  std::vector<float> values(4 * points.size());
+  for (size_t k = 0; k < points.size(); ++k)
+  {
+    values[4 * k + 0] = points[k].x;
+    values[4 * k + 1] = points[k].y;
+    values[4 * k + 2] = points[k].z;
+    values[4 * k + 3] = points[k].intensity;
+  }
+  this->Stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+  return this->Stream.good();
+}
+
+//-----------------------------------------------------------------------------
+bool SlamMapFile::ReadTile(int map, const int index[3], pcl::PointCloud<Point>& points)
+{
+  const TileKey key = {{ map, index[0], index[1], index[2] }};
+  auto tile = this->Index.find(key);
+  if (this->IsWriting || tile == this->Index.end())
+  {
+    return false;
+  }
+
+  std::vector<float> values;
+  for (boost::uint64_t offset : tile->second)
+  {
+    this->Stream.clear();
+    this->Stream.seekg(static_cast<std::streamoff>(offset + ChunkHeaderSize - sizeof(boost::uint32_t)));
+    boost::uint32_t numberOfPoints = 0;
+    if (!ReadValue(this->Stream, numberOfPoints))
+    {
+      this->LastError = "Map file is truncated";
+      return false;
+    }
+    values.resize(4 * numberOfPoints);
+    this->Stream.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(float));
+    if (!this->Stream.good())
+    {
+      this->LastError = "Map file is truncated";
+      return false;
+    }
+
+    const size_t first = points.size();
+    points.resize(first + numberOfPoints);
+    for (size_t k = 0; k < numberOfPoints; ++k)
+    {
+      Point& p = points[first + k];
+      p = Point();
+      p.x = values[4 * k + 0];
+      p.y = values[4 * k + 1];
+      p.z = values[4 * k + 2];
+      p.intensity = values[4 * k + 3];
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool SlamMapFile::ReadIndex()
+{
+  this->Stream.seekg(0, std::ios::end);
+  const boost::uint64_t fileSize = static_cast<boost::uint64_t>(this->Stream.tellg());
+
+  // index written when the file has been closed
+  if (fileSize >= this->DataBegin + FooterSize)
+  {
+    boost::uint64_t indexOffset = 0;
+    char magic[sizeof(IndexMagic)];
+    this->Stream.seekg(static_cast<std::streamoff>(fileSize - FooterSize));
+    if (ReadValue(this->Stream, indexOffset) && this->Stream.read(magic, sizeof(magic)) &&
+      std::memcmp(magic, IndexMagic, sizeof(IndexMagic)) == 0 &&
+      indexOffset >= this->DataBegin && indexOffset < fileSize)
+    {
+      this->Stream.seekg(static_cast<std::streamoff>(indexOffset));
+      boost::uint64_t numberOfTiles = 0;
+      bool isValid = ReadValue(this->Stream, numberOfTiles);
+      for (boost::uint64_t tile = 0; isValid && tile < numberOfTiles; ++tile)
+      {
+        TileKey key;
+        boost::uint64_t numberOfChunks = 0;
+        for (boost::int32_t& value : key)
+        {
+          isValid = isValid && ReadValue(this->Stream, value);
+        }
+        isValid = isValid && ReadValue(this->Stream, numberOfChunks);
+        std::vector<boost::uint64_t>& offsets = this->Index[key];
+        offsets.resize(isValid ? numberOfChunks : 0);
+        for (boost::uint64_t& offset : offsets)
+        {
+          isValid = isValid && ReadValue(this->Stream, offset);
+        }
+      }
+      if (isValid)
+      {
+        return true;
+      }
+      this->Index.clear();
+    }
+  }
+
+  // the file has not been closed: walk through the chunks, a truncated
+  // last chunk is ignored
+  this->Stream.clear();
+  boost::uint64_t offset = this->DataBegin;
+  while (offset + ChunkHeaderSize <= fileSize)
+  {
+    this->Stream.seekg(static_cast<std::streamoff>(offset));
+    TileKey key;
+    boost::uint32_t numberOfPoints = 0;
+    bool isValid = true;
+    for (boost::int32_t& value : key)
+    {
+      isValid = isValid && ReadValue(this->Stream, value);
+    }
+    isValid = isValid && ReadValue(this->Stream, numberOfPoints);
+    const boost::uint64_t next = offset + ChunkHeaderSize + 4 * sizeof(float) * numberOfPoints;
+    if (!isValid || next > fileSize)
+    {
+      break;
+    }
+    this->Index[key].push_back(offset);
+    offset = next;
+  }
+  this->Stream.clear();
+  return true;
+}
@@ -0,0 +1,103 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef SLAM_MAP_FILE_H
+#define SLAM_MAP_FILE_H
+
+// BOOST
+#include <boost/cstdint.hpp>
+
+// PCL
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+// STD
+#include <array>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * \class SlamMapFile
+ * \brief Binary global map of the slam, split in tiles which are the voxels of its
+ *        rolling grids. Each map (edges, planars, blobs) is stored separately.
+ *
+ *        The file is a header followed by chunks, each one holding the points of a
+ *        tile written at once: a tile is written when it leaves the rolling grid,
+ *        and may be written again if the grid comes back to it. The tile index is
+ *        appended when the file is closed, a file which has not been closed is
+ *        indexed again by reading the chunk headers. The points only keep their
+ *        position and intensity, in world coordinates.
+ */
+class SlamMapFile
+{
+public:
+  typedef pcl::PointXYZINormal Point;
+  //! map, then world index of the tile along x, y and z
+  typedef std::array<boost::int32_t, 4> TileKey;
+
+  SlamMapFile() = default;
+  ~SlamMapFile();
+
+  /**
+   * @brief OpenForWriting create a map file, an existing one is replaced
+   * @param tileSize size of the tiles, which is the resolution of the rolling grids
+   */
+  bool OpenForWriting(const std::string& filename, double tileSize);
+
+  /**
+   * @brief OpenForReading open a map file to read its tiles, and load its index
+   */
+  bool OpenForReading(const std::string& filename);
+
+  bool IsOpen() const { return this->Stream.is_open(); }
+
+  //! Write the index of the tiles at the end of the file when it is written
+  void Close();
+
+  //! Append the points of a tile, its previous chunks are kept
+  bool WriteTile(int map, const int index[3], const pcl::PointCloud<Point>& points);
+
+  /**
+   * @brief ReadTile append the points of all the chunks of a tile to points
+   * @return false if the map does not have this tile
+   */
+  bool ReadTile(int map, const int index[3], pcl::PointCloud<Point>& points);
+
+  double GetTileSize() const { return this->TileSize; }
+
+  size_t GetNumberOfTiles() const { return this->Index.size(); }
+
+  const std::string& GetLastError() const { return this->LastError; }
+
+private:
+  //! Increase it each time the layout of the file change
+  static const unsigned int Version = 1;
+
+  //! Read the index at the end of the file, or the chunks headers if there is none
+  bool ReadIndex();
+
+  std::fstream Stream;
+  bool IsWriting = false;
+  double TileSize = 0.0;
+  boost::uint64_t DataBegin = 0;
+  std::map<TileKey, std::vector<boost::uint64_t> > Index;
+  std::string LastError;
+};
+
+#endif // SLAM_MAP_FILE_H
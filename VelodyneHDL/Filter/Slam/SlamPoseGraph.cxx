@@ -0,0 +1,509 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "SlamPoseGraph.h"
+#include "CeresCostFunctions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include <ceres/ceres.h>
+
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/registration/icp.h>
+
+namespace
+{
+//! Standard deviations of the relative poses measured by the odometry and the loops
+const double OdometryRotationSigma = 0.01;
+const double OdometryTranslationSigma = 0.05;
+const double LoopRotationSigma = 0.02;
+const double LoopTranslationSigma = 0.1;
+
+//! Residual, in standard deviations, from which a loop is considered as an outlier
+const double LoopRobustScale = 20.0;
+
+//! Iterations of the loop alignment, and maximum distance (m) of its matched points
+const int LoopICPMaxIter = 30;
+const double LoopICPMaxDistance = 3.0;
+}
+
+//-----------------------------------------------------------------------------
+SlamPoseGraph::SlamPoseGraph()
+{
+  this->Thread = boost::thread(&SlamPoseGraph::ThreadLoop, this);
+}
+
+//-----------------------------------------------------------------------------
+SlamPoseGraph::~SlamPoseGraph()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(this->QueueMutex);
+    this->IsClosing = true;
+  }
+  this->QueueCondition.notify_all();
+  this->Thread.join();
+}
+
+//-----------------------------------------------------------------------------
+bool SlamPoseGraph::AddFrame(double time, const Pose& odometryPose,
+                             const pcl::PointCloud<Point>& edges, const pcl::PointCloud<Point>& planars)
+{
+  const Eigen::Isometry3d pose = ToIsometry(odometryPose);
+  if (this->HasKeyframe)
+  {
+    const Eigen::Isometry3d motion = this->LastKeyframePose.inverse() * pose;
+    const double angle = Eigen::AngleAxisd(motion.linear()).angle();
+    if (motion.translation().norm() < this->Params.KeyframeDistance &&
+        angle < this->Params.KeyframeAngle)
+    {
+      return false;
+    }
+  }
+  this->HasKeyframe = true;
+  this->LastKeyframePose = pose;
+
+  // The keypoints are only copied here, they are downsampled by the worker thread
+  QueuedKeyframe keyframe;
+  keyframe.Time = time;
+  keyframe.Odometry = odometryPose;
+  keyframe.Cloud.reset(new pcl::PointCloud<Point>());
+  keyframe.Cloud->reserve(edges.size() + planars.size());
+  keyframe.Cloud->insert(keyframe.Cloud->end(), edges.begin(), edges.end());
+  keyframe.Cloud->insert(keyframe.Cloud->end(), planars.begin(), planars.end());
+  {
+    boost::lock_guard<boost::mutex> lock(this->QueueMutex);
+    this->Queue.push_back(keyframe);
+  }
+  this->QueueCondition.notify_all();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool SlamPoseGraph::GetCorrections(std::vector<double>& times, std::vector<Eigen::Isometry3d>& corrections)
+{
+  boost::unique_lock<boost::mutex> lock(this->ResultMutex, boost::try_to_lock);
+  if (!lock.owns_lock() || !this->HasNewResult)
+  {
+    return false;
+  }
+  times = this->ResultTimes;
+  corrections = this->ResultCorrections;
+  this->HasNewResult = false;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void SlamPoseGraph::Flush()
+{
+  boost::unique_lock<boost::mutex> lock(this->QueueMutex);
+  while (!this->Queue.empty() || this->IsProcessing)
+  {
+    this->QueueCondition.wait(lock);
+  }
+}
+
+//-----------------------------------------------------------------------------
+size_t SlamPoseGraph::GetNumberOfKeyframes()
+{
+  boost::lock_guard<boost::mutex> lock(this->ResultMutex);
+  return this->ResultNumberOfKeyframes;
+}
+
+//-----------------------------------------------------------------------------
+size_t SlamPoseGraph::GetNumberOfLoopClosures()
+{
+  boost::lock_guard<boost::mutex> lock(this->ResultMutex);
+  return this->ResultNumberOfLoopClosures;
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Isometry3d SlamPoseGraph::ToIsometry(const Pose& pose)
+{
+  Eigen::Isometry3d transform = Eigen::Isometry3d::Identity();
+  transform.linear() = Eigen::Matrix3d(
+          Eigen::AngleAxisd(pose(2), Eigen::Vector3d::UnitZ())
+        * Eigen::AngleAxisd(pose(1), Eigen::Vector3d::UnitY())
+        * Eigen::AngleAxisd(pose(0), Eigen::Vector3d::UnitX()));
+  transform.translation() = pose.tail(3);
+  return transform;
+}
+
+//-----------------------------------------------------------------------------
+SlamPoseGraph::Pose SlamPoseGraph::FromIsometry(const Eigen::Isometry3d& transform)
+{
+  const Eigen::Matrix3d R = transform.linear();
+  Pose pose;
+  pose << std::atan2(R(2, 1), R(2, 2)),
+          -std::asin(std::max(-1.0, std::min(1.0, R(2, 0)))),
+          std::atan2(R(1, 0), R(0, 0)),
+          transform.translation();
+  return pose;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<unsigned char> SlamPoseGraph::ComputeDescriptor(const pcl::PointCloud<Point>& cloud,
+  unsigned int rings, unsigned int sectors, double maxRange)
+{
+  std::vector<unsigned char> descriptor(rings * sectors, 0);
+  for (const Point& p : cloud)
+  {
+    const double range = std::sqrt(p.x * p.x + p.y * p.y);
+    if (range >= maxRange)
+    {
+      continue;
+    }
+    const unsigned int ring = std::min(rings - 1, static_cast<unsigned int>(range / maxRange * rings));
+    const double azimuth = std::atan2(p.y, p.x) + M_PI;
+    const unsigned int sector = std::min(sectors - 1, static_cast<unsigned int>(azimuth / (2.0 * M_PI) * sectors));
+    // 0 is kept for the empty cells
+    const double height = std::max(1.0, std::min(255.0, (p.z + 2.0) * 10.0));
+    unsigned char& cell = descriptor[ring * sectors + sector];
+    cell = std::max(cell, static_cast<unsigned char>(height));
+  }
+  return descriptor;
+}
+
+//-----------------------------------------------------------------------------
+double SlamPoseGraph::DescriptorDistance(const std::vector<unsigned char>& first,
+  const std::vector<unsigned char>& second, unsigned int sectors, int* sectorShift)
+{
+  // Mean cosine distance between the sectors (columns of rings) which are
+  // not empty in both descriptors, for each rotation of the second one
+  const unsigned int rings = static_cast<unsigned int>(first.size() / sectors);
+  double bestDistance = 1.0;
+  int bestShift = 0;
+  for (unsigned int shift = 0; shift < sectors; ++shift)
+  {
+    double sum = 0.0;
+    unsigned int count = 0;
+    for (unsigned int sector = 0; sector < sectors; ++sector)
+    {
+      const unsigned int shifted = (sector + shift) % sectors;
+      double dot = 0.0, norm1 = 0.0, norm2 = 0.0;
+      for (unsigned int ring = 0; ring < rings; ++ring)
+      {
+        const double a = first[ring * sectors + sector];
+        const double b = second[ring * sectors + shifted];
+        dot += a * b;
+        norm1 += a * a;
+        norm2 += b * b;
+      }
+      if (norm1 > 0.0 && norm2 > 0.0)
+      {
+        sum += 1.0 - dot / std::sqrt(norm1 * norm2);
+        count++;
+      }
+    }
+    const double distance = count > 0 ? sum / count : 1.0;
+    if (distance < bestDistance)
+    {
+      bestDistance = distance;
+      bestShift = static_cast<int>(shift);
+    }
+  }
+  if (sectorShift)
+  {
+    *sectorShift = bestShift;
+  }
+  return bestDistance;
+}
+
+//-----------------------------------------------------------------------------
+void SlamPoseGraph::ThreadLoop()
+{
+  while (true)
+  {
+    QueuedKeyframe keyframe;
+    {
+      boost::unique_lock<boost::mutex> lock(this->QueueMutex);
+      while (this->Queue.empty() && !this->IsClosing)
+      {
+        this->QueueCondition.wait(lock);
+      }
+      if (this->Queue.empty())
+      {
+        return;
+      }
+      keyframe = this->Queue.front();
+      this->Queue.pop_front();
+      this->IsProcessing = true;
+    }
+
+    this->ProcessKeyframe(keyframe);
+
+    {
+      boost::lock_guard<boost::mutex> lock(this->QueueMutex);
+      this->IsProcessing = false;
+    }
+    this->QueueCondition.notify_all();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void SlamPoseGraph::ProcessKeyframe(QueuedKeyframe& queued)
+{
+  Keyframe keyframe;
+  keyframe.Time = queued.Time;
+  keyframe.Odometry = queued.Odometry;
+
+  // The keyframe keeps the correction of the previous one
+  const Eigen::Isometry3d odometry = ToIsometry(queued.Odometry);
+  if (this->Keyframes.empty())
+  {
+    keyframe.Estimate = queued.Odometry;
+  }
+  else
+  {
+    const Keyframe& previous = this->Keyframes.back();
+    Edge edge;
+    edge.From = this->Keyframes.size() - 1;
+    edge.To = this->Keyframes.size();
+    edge.Measure = ToIsometry(previous.Odometry).inverse() * odometry;
+    edge.IsLoop = false;
+    this->Edges.push_back(edge);
+    keyframe.Estimate = FromIsometry(ToIsometry(previous.Estimate) * edge.Measure);
+  }
+
+  // Downsample the keypoints, and keep at most MaxKeyframePoints of them
+  keyframe.Cloud.reset(new pcl::PointCloud<Point>());
+  pcl::VoxelGrid<Point> downSizeFilter;
+  downSizeFilter.setLeafSize(this->Params.KeyframeLeafSize, this->Params.KeyframeLeafSize, this->Params.KeyframeLeafSize);
+  downSizeFilter.setInputCloud(queued.Cloud);
+  downSizeFilter.filter(*keyframe.Cloud);
+  if (keyframe.Cloud->size() > this->Params.MaxKeyframePoints)
+  {
+    pcl::PointCloud<Point>::Ptr sampled(new pcl::PointCloud<Point>());
+    sampled->reserve(this->Params.MaxKeyframePoints);
+    const double step = static_cast<double>(keyframe.Cloud->size()) / this->Params.MaxKeyframePoints;
+    for (unsigned int k = 0; k < this->Params.MaxKeyframePoints; ++k)
+    {
+      sampled->push_back(keyframe.Cloud->at(static_cast<size_t>(k * step)));
+    }
+    keyframe.Cloud = sampled;
+  }
+  keyframe.Descriptor = ComputeDescriptor(*keyframe.Cloud, this->Params.DescriptorRings,
+    this->Params.DescriptorSectors, this->Params.DescriptorMaxRange);
+  this->Keyframes.push_back(keyframe);
+  this->NumberOfClouds++;
+
+  // Without loop the correction of the new keyframe is the one of the
+  // previous keyframe, which the front-end already applies
+  Edge loop;
+  if (this->DetectLoop(loop))
+  {
+    this->Edges.push_back(loop);
+    this->NumberOfLoopClosures++;
+    this->Optimize(loop.From);
+    this->PublishCorrections();
+  }
+  this->LimitKeyframeClouds();
+
+  boost::lock_guard<boost::mutex> lock(this->ResultMutex);
+  this->ResultNumberOfKeyframes = this->Keyframes.size();
+}
+
+//-----------------------------------------------------------------------------
+bool SlamPoseGraph::DetectLoop(Edge& loop)
+{
+  const size_t current = this->Keyframes.size() - 1;
+  if (current < this->Params.LoopMinKeyframeGap)
+  {
+    return false;
+  }
+  const Keyframe& keyframe = this->Keyframes[current];
+  const Eigen::Isometry3d estimate = ToIsometry(keyframe.Estimate);
+
+  // Closest descriptor among the keyframes near the current estimate
+  size_t candidate = current;
+  int candidateShift = 0;
+  double candidateDistance = this->Params.DescriptorThreshold;
+  for (size_t index = 0; index + this->Params.LoopMinKeyframeGap <= current; ++index)
+  {
+    const Keyframe& other = this->Keyframes[index];
+    if (!other.Cloud || (other.Estimate.tail(3) - keyframe.Estimate.tail(3)).norm() > this->Params.LoopSearchRadius)
+    {
+      continue;
+    }
+    int shift = 0;
+    const double distance = DescriptorDistance(keyframe.Descriptor, other.Descriptor, this->Params.DescriptorSectors, &shift);
+    if (distance < candidateDistance)
+    {
+      candidate = index;
+      candidateShift = shift;
+      candidateDistance = distance;
+    }
+  }
+  if (candidate == current)
+  {
+    return false;
+  }
+
+  // Align the keypoints starting from the estimated relative pose, and from
+  // the same pose with the yaw given by the rotation between the descriptors
+  // since the yaw drifts the most. The best alignment is kept
+  const Keyframe& other = this->Keyframes[candidate];
+  const Eigen::Isometry3d guess = ToIsometry(other.Estimate).inverse() * estimate;
+  Pose rotatedGuess = FromIsometry(guess);
+  rotatedGuess(2) = 2.0 * M_PI * candidateShift / this->Params.DescriptorSectors;
+  const Eigen::Isometry3d guesses[2] = { guess, ToIsometry(rotatedGuess) };
+
+  pcl::IterativeClosestPoint<Point, Point> icp;
+  icp.setInputSource(keyframe.Cloud);
+  icp.setInputTarget(other.Cloud);
+  icp.setMaximumIterations(LoopICPMaxIter);
+  icp.setMaxCorrespondenceDistance(LoopICPMaxDistance);
+  pcl::PointCloud<Point> aligned;
+  double bestFitness = this->Params.LoopMaxFitness;
+  bool isFound = false;
+  for (const Eigen::Isometry3d& initialGuess : guesses)
+  {
+    icp.align(aligned, initialGuess.matrix().cast<float>());
+    if (!icp.hasConverged())
+    {
+      continue;
+    }
+    const double fitness = icp.getFitnessScore(LoopICPMaxDistance);
+    if (fitness <= bestFitness)
+    {
+      bestFitness = fitness;
+      loop.Measure.matrix() = icp.getFinalTransformation().cast<double>();
+      isFound = true;
+    }
+  }
+
+  loop.From = candidate;
+  loop.To = current;
+  loop.IsLoop = true;
+  return isFound;
+}
+
+//-----------------------------------------------------------------------------
+void SlamPoseGraph::Optimize(size_t first)
+{
+  ceres::Problem problem;
+  std::vector<bool> isInProblem(this->Keyframes.size(), false);
+  for (const Edge& edge : this->Edges)
+  {
+    if (edge.From < first && edge.To < first)
+    {
+      continue;
+    }
+    const double rotationSigma = edge.IsLoop ? LoopRotationSigma : OdometryRotationSigma;
+    const double translationSigma = edge.IsLoop ? LoopTranslationSigma : OdometryTranslationSigma;
+    ceres::CostFunction* cost = new ceres::AutoDiffCostFunction<CostFunctions::RelativePoseResidual, 6, 6, 6>(
+      new CostFunctions::RelativePoseResidual(edge.Measure.linear(), edge.Measure.translation(),
+                                              1.0 / rotationSigma, 1.0 / translationSigma));
+    // the loops which are wrong despite their check should not distort the whole
+    // graph, the residuals are in standard deviations and a loop usually corrects
+    // several of them
+    ceres::LossFunction* loss = edge.IsLoop ? new ceres::HuberLoss(LoopRobustScale) : nullptr;
+    problem.AddResidualBlock(cost, loss, this->Keyframes[edge.From].Estimate.data(),
+                             this->Keyframes[edge.To].Estimate.data());
+    isInProblem[edge.From] = true;
+    isInProblem[edge.To] = true;
+  }
+
+  // The keyframes before the loop are held constant, the first one at least
+  // sets the referential of the graph
+  for (size_t index = 0; index <= first && index < this->Keyframes.size(); ++index)
+  {
+    if (isInProblem[index] && (index < first || index == 0))
+    {
+      problem.SetParameterBlockConstant(this->Keyframes[index].Estimate.data());
+    }
+  }
+
+  ceres::Solver::Options options;
+  options.max_num_iterations = 50;
+  options.linear_solver_type = ceres::SPARSE_NORMAL_CHOLESKY;
+  std::string error;
+  if (!options.IsValid(&error))
+  {
+    // ceres built without a sparse linear algebra library
+    options.linear_solver_type = ceres::CGNR;
+  }
+  ceres::Solver::Summary summary;
+  ceres::Solve(options, &problem, &summary);
+}
+
+//-----------------------------------------------------------------------------
+void SlamPoseGraph::LimitKeyframeClouds()
+{
+  if (this->NumberOfClouds <= this->Params.MaxKeyframeClouds)
+  {
+    return;
+  }
+
+  // The recent keyframes can not close a loop yet, they are kept
+  const size_t last = this->Keyframes.size() > this->Params.LoopMinKeyframeGap ?
+    this->Keyframes.size() - this->Params.LoopMinKeyframeGap : 0;
+  size_t dropped = this->Keyframes.size();
+  size_t previous = this->Keyframes.size();
+  double smallestGap = std::numeric_limits<double>::max();
+  for (size_t index = 0; index < last; ++index)
+  {
+    if (!this->Keyframes[index].Cloud)
+    {
+      continue;
+    }
+    if (previous < this->Keyframes.size())
+    {
+      const double gap = (this->Keyframes[index].Estimate.tail(3) - this->Keyframes[previous].Estimate.tail(3)).norm();
+      if (gap < smallestGap)
+      {
+        smallestGap = gap;
+        dropped = index;
+      }
+    }
+    previous = index;
+  }
+  if (dropped == this->Keyframes.size())
+  {
+    // all the keypoints are recent ones, the oldest are dropped
+    dropped = 0;
+    while (!this->Keyframes[dropped].Cloud)
+    {
+      dropped++;
+    }
+  }
+
+  this->Keyframes[dropped].Cloud.reset();
+  std::vector<unsigned char>().swap(this->Keyframes[dropped].Descriptor);
+  this->NumberOfClouds--;
+}
+
+//-----------------------------------------------------------------------------
+void SlamPoseGraph::PublishCorrections()
+{
+  std::vector<double> times(this->Keyframes.size());
+  std::vector<Eigen::Isometry3d> corrections(this->Keyframes.size());
+  for (size_t index = 0; index < this->Keyframes.size(); ++index)
+  {
+    const Keyframe& keyframe = this->Keyframes[index];
+    times[index] = keyframe.Time;
+    corrections[index] = ToIsometry(keyframe.Estimate) * ToIsometry(keyframe.Odometry).inverse();
+  }
+
+  boost::lock_guard<boost::mutex> lock(this->ResultMutex);
+  this->HasNewResult = true;
+  this->ResultTimes.swap(times);
+  this->ResultCorrections.swap(corrections);
+  this->ResultNumberOfLoopClosures = this->NumberOfLoopClosures;
+}
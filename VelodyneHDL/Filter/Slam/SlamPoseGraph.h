@@ -0,0 +1,220 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef SLAM_POSE_GRAPH_H
+#define SLAM_POSE_GRAPH_H
+
+// STD
+#include <deque>
+#include <memory>
+#include <vector>
+
+// BOOST
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+// EIGEN
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+
+// PCL
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+/**
+ * \class SlamPoseGraph
+ * \brief Pose graph backend of the slam. The odometry poses of the frames are
+ *        sampled in keyframes, whose keypoints are kept downsampled along with
+ *        a compact descriptor: the maximum height of the points in each cell
+ *        of a polar grid around the sensor. A worker thread looks for a past
+ *        keyframe near each new one with a similar descriptor, checks the loop
+ *        with an ICP between their keypoints and then optimizes the graph.
+ *
+ *        The optimization is incremental: only the keyframes since the oldest
+ *        one of the new loop are estimated again, from their last estimate,
+ *        the older ones are held constant. The front-end is never blocked, it
+ *        fetches the corrections of the keyframes once they are available.
+ *
+ *        The memory is bounded: only MaxKeyframeClouds keyframes keep their
+ *        keypoints and descriptor, when there are more the one closest to the
+ *        previous keyframe with keypoints is dropped, so that the remaining
+ *        ones cover the path evenly. The other keyframes only keep their poses.
+ *
+ *        The poses are (rx, ry, rz, tx, ty, tz) with R = Rz(rz) * Ry(ry) * Rx(rx)
+ *        as in the slam, the keypoints are expressed in the frame referential.
+ */
+class SlamPoseGraph
+{
+public:
+  typedef pcl::PointXYZINormal Point;
+  typedef Eigen::Matrix<double, 6, 1> Pose;
+
+  struct Parameters
+  {
+    //! Distance (m) and angle (rad) travelled from the last keyframe to add a new one
+    double KeyframeDistance = 2.0;
+    double KeyframeAngle = 0.35;
+
+    //! Polar grid of the descriptors
+    unsigned int DescriptorRings = 20;
+    unsigned int DescriptorSectors = 60;
+    double DescriptorMaxRange = 60.0;
+
+    //! Maximum descriptor distance, between 0 and 1, of a loop candidate
+    double DescriptorThreshold = 0.35;
+
+    //! Maximum distance (m) between the estimated positions of a loop candidate
+    double LoopSearchRadius = 15.0;
+
+    //! Minimum number of keyframes between the two keyframes of a loop
+    unsigned int LoopMinKeyframeGap = 50;
+
+    //! Maximum mean squared distance (m^2) of the matched points once a loop is aligned
+    double LoopMaxFitness = 0.3;
+
+    //! Leaf size of the keyframes keypoints, and maximum number of points kept
+    double KeyframeLeafSize = 0.5;
+    unsigned int MaxKeyframePoints = 3000;
+
+    //! Maximum number of keyframes keeping their keypoints
+    unsigned int MaxKeyframeClouds = 300;
+  };
+
+  SlamPoseGraph();
+  ~SlamPoseGraph();
+
+  //! Set the parameters before the first frame is added
+  void SetParameters(const Parameters& parameters) { this->Params = parameters; }
+  const Parameters& GetParameters() const { return this->Params; }
+
+  /**
+   * @brief AddFrame add the odometry pose of a frame. When the frame becomes a
+   * keyframe its keypoints are copied and queued for the worker thread
+   * @param edges, planars keypoints of the frame in its referential
+   * @return true if the frame is a new keyframe
+   */
+  bool AddFrame(double time, const Pose& odometryPose,
+                const pcl::PointCloud<Point>& edges, const pcl::PointCloud<Point>& planars);
+
+  /**
+   * @brief GetCorrections get the corrections of the keyframes, if a new optimization
+   * has finished since the last call. The correction of a keyframe maps its odometry
+   * pose to its optimized one. This never waits for the worker thread
+   * @return false if there is no new correction
+   */
+  bool GetCorrections(std::vector<double>& times, std::vector<Eigen::Isometry3d>& corrections);
+
+  //! Wait until the worker thread has processed the queued keyframes
+  void Flush();
+
+  //! Number of keyframes processed by the worker thread and of loops found among them
+  size_t GetNumberOfKeyframes();
+  size_t GetNumberOfLoopClosures();
+
+  static Eigen::Isometry3d ToIsometry(const Pose& pose);
+  static Pose FromIsometry(const Eigen::Isometry3d& transform);
+
+  /**
+   * @brief ComputeDescriptor compute the maximum height of the points in each cell of
+   * the polar grid, quantized by 10 cm from 2 m under the sensor. Empty cells are 0
+   */
+  static std::vector<unsigned char> ComputeDescriptor(const pcl::PointCloud<Point>& cloud,
+    unsigned int rings, unsigned int sectors, double maxRange);
+
+  /**
+   * @brief DescriptorDistance distance between two descriptors, between 0 and 1, for the
+   * best rotation of the second one by a whole number of sectors
+   * @param sectorShift number of sectors of the best rotation, if not null
+   */
+  static double DescriptorDistance(const std::vector<unsigned char>& first,
+    const std::vector<unsigned char>& second, unsigned int sectors, int* sectorShift = nullptr);
+
+private:
+  struct Keyframe
+  {
+    double Time = 0.0;
+    Pose Odometry;
+    //! Estimate optimized by the graph, the parameters of the solver
+    Pose Estimate;
+    pcl::PointCloud<Point>::Ptr Cloud;
+    std::vector<unsigned char> Descriptor;
+  };
+
+  struct Edge
+  {
+    size_t From, To;
+    //! Measured pose of To in the referential of From
+    Eigen::Isometry3d Measure;
+    bool IsLoop;
+  };
+
+  struct QueuedKeyframe
+  {
+    double Time;
+    Pose Odometry;
+    pcl::PointCloud<Point>::Ptr Cloud;
+  };
+
+  void ThreadLoop();
+
+  //! Add a keyframe to the graph, and optimize it if it closes a loop
+  void ProcessKeyframe(QueuedKeyframe& queued);
+
+  //! Look for a loop of the last keyframe, return false if none is found
+  bool DetectLoop(Edge& loop);
+
+  //! Optimize the keyframes from the first one, the previous ones are held constant
+  void Optimize(size_t first);
+
+  //! Drop the keypoints of a keyframe when there are too many
+  void LimitKeyframeClouds();
+
+  //! Copy the corrections of the keyframes for the front-end
+  void PublishCorrections();
+
+  Parameters Params;
+
+  //! Front-end state, only used by AddFrame
+  bool HasKeyframe = false;
+  Eigen::Isometry3d LastKeyframePose;
+
+  //! Graph, only used by the worker thread
+  std::vector<Keyframe> Keyframes;
+  std::vector<Edge> Edges;
+  size_t NumberOfClouds = 0;
+  size_t NumberOfLoopClosures = 0;
+
+  //! Keyframes queued for the worker thread
+  boost::mutex QueueMutex;
+  boost::condition_variable QueueCondition;
+  std::deque<QueuedKeyframe> Queue;
+  bool IsProcessing = false;
+  bool IsClosing = false;
+
+  //! Last corrections published by the worker thread
+  boost::mutex ResultMutex;
+  std::vector<double> ResultTimes;
+  std::vector<Eigen::Isometry3d> ResultCorrections;
+  bool HasNewResult = false;
+  size_t ResultNumberOfKeyframes = 0;
+  size_t ResultNumberOfLoopClosures = 0;
+
+  boost::thread Thread;
+};
+
+#endif // SLAM_POSE_GRAPH_H
@@ -70,15 +70,29 @@
 
 // LOCAL
 #include "vtkSlam.h"
+#include "TraceEvents.h"
+#include "LidarDecodingKernels.h"
 #include "vtkVelodyneTransformInterpolator.h"
 #include "vtkPCLConversions.h"
 #include "CeresCostFunctions.h"
+#include "ImuBuffer.h"
+#include "ImuPreintegration.h"
+#include "KnnBatchSearch.h"
+#include "SlamMapFile.h"
+#include "SlamPoseGraph.h"
 // STD
 #include <sstream>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <cfloat>
 #include <ctime>
+#include <deque>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
 // VTK
 #include <vtkCellArray.h>
 #include <vtkCellData.h>
@@ -86,6 +100,7 @@
 #include <vtkDoubleArray.h>
 #include <vtkFloatArray.h>
 #include <vtkInformation.h>
+#include <vtkIntArray.h>
 #include <vtkInformationVector.h>
 #include <vtkMath.h>
 #include <vtkNew.h>
@@ -107,11 +122,14 @@
 #include <Eigen/Dense>
 // PCL
 #include <pcl/point_types.h>
-#include <pcl/filters/voxel_grid.h>
 // CERES
 #include <ceres/ceres.h>
 #include <glog/logging.h>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "vtkTemporalTransforms.h"
 
 vtkStandardNewMacro(vtkSlam);
@@ -147,26 +165,26 @@ public:
 bool LineFitting::FitPCA(std::vector<Eigen::Vector3d >& points)
 {
   // Compute PCA to determine best line approximation
-  // of the points distribution
-  Eigen::MatrixXd data(points.size(), 3);
-
+  // of the points distribution. The mean and the covariance
+  // are summed point after point, so that the result does not
+  // depend on how the reductions are vectorized
+  Eigen::Vector3d mean = Eigen::Vector3d::Zero();
   for (unsigned int k = 0; k < points.size(); k++)
   {
-    data.row(k) = points[k];
+    mean += points[k];
   }
+  mean /= static_cast<double>(points.size());
 
-  Eigen::Vector3d mean = data.colwise().mean();
-  Eigen::MatrixXd centered = data.rowwise() - mean.transpose();
-  Eigen::MatrixXd cov = centered.transpose() * centered;
-  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(cov);
+  Eigen::Matrix3d cov = Eigen::Matrix3d::Zero();
+  for (unsigned int k = 0; k < points.size(); k++)
+  {
+    const Eigen::Vector3d centered = points[k] - mean;
+    cov += centered * centered.transpose();
+  }
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig(cov);
 
-  // Eigen values
-  Eigen::MatrixXd D(1,3);
   // Eigen vectors
-  Eigen::MatrixXd V(3,3);
-
-  D = eig.eigenvalues();
-  V = eig.eigenvectors();
+  Eigen::Matrix3d V = eig.eigenvectors();
 
   // Direction
   this->Direction = V.col(2).normalized();
@@ -252,6 +270,17 @@ Eigen::Matrix3d GetRotationMatrix(Eigen::Matrix<double, 6, 1> T)
         * Eigen::AngleAxisd(T(0), Eigen::Vector3d::UnitX()));   /* rotation around X-axis */
 }
 
+//-----------------------------------------------------------------------------
+// Rotation of the trajectory orientations, which compose the angles the
+// other way around than GetRotationMatrix
+Eigen::Matrix3d GetTrajectoryRotation(const Eigen::Matrix<double, 6, 1>& T)
+{
+  return Eigen::Matrix3d(
+          Eigen::AngleAxisd(T(0), Eigen::Vector3d::UnitX())
+        * Eigen::AngleAxisd(T(1), Eigen::Vector3d::UnitY())
+        * Eigen::AngleAxisd(T(2), Eigen::Vector3d::UnitZ()));
+}
+
 //-----------------------------------------------------------------------------
 template <typename T>
 vtkSmartPointer<T> CreateDataArray(const char* name, vtkIdType np, vtkPolyData* pd)
@@ -268,6 +297,25 @@ vtkSmartPointer<T> CreateDataArray(const char* name, vtkIdType np, vtkPolyData*
   return array;
 }
 
+//-----------------------------------------------------------------------------
+template <typename T>
+void AddColumn(const char* name, int nbComponents, vtkTable* table)
+{
+  vtkSmartPointer<T> array = vtkSmartPointer<T>::New();
+  array->SetNumberOfComponents(nbComponents);
+  array->SetName(name);
+  table->AddColumn(array);
+}
+
+//-----------------------------------------------------------------------------
+// A histogram which has not been computed for the frame is filled with zeros
+void InsertHistogram(const std::vector<double>& histogram, int nbBins, vtkAbstractArray* column)
+{
+  std::vector<double> tuple(histogram);
+  tuple.resize(nbBins, 0.0);
+  static_cast<vtkDoubleArray*>(column)->InsertNextTuple(tuple.data());
+}
+
 //-----------------------------------------------------------------------------
 template <typename T>
 std::vector<size_t> sortIdx(const std::vector<T> &v)
@@ -284,20 +332,36 @@ std::vector<size_t> sortIdx(const std::vector<T> &v)
 }
 
 //-----------------------------------------------------------------------------
-std::clock_t startTime;
+// Same as above for the n values of v, writing the sorted indexes into idx
+template <typename T>
+void sortIdx(const T* v, size_t n, size_t* idx)
+{
+  std::iota(idx, idx + n, 0);
+  std::sort(idx, idx + n, [v](size_t i1, size_t i2) {return v[i1] > v[i2];});
+}
+
+//-----------------------------------------------------------------------------
+// Wall clock time, the processor time of std::clock adds up the threads.
+// The keypoints extraction and the estimation are timed on their own
+// threads in pipelined mode
+thread_local std::chrono::steady_clock::time_point startTime;
+
+//-----------------------------------------------------------------------------
+double ElapsedTime(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
 //-----------------------------------------------------------------------------
 void InitTime()
 {
-  startTime = std::clock();
+  startTime = std::chrono::steady_clock::now();
 }
 
 //-----------------------------------------------------------------------------
-void StopTimeAndDisplay(std::string functionName)
+double StopTime()
 {
-  std::clock_t endTime = std::clock();
-  double dt = static_cast<double>(endTime - startTime) / CLOCKS_PER_SEC;
-  std::cout << "  -time elapsed in function <" << functionName << "> : " << dt << " sec" << std::endl;
+  return ElapsedTime(startTime);
 }
 
 //-----------------------------------------------------------------------------
@@ -305,144 +369,439 @@ double Rad2Deg(double val)
 {
   return val / vtkMath::Pi() * 180;
 }
+
+//! Size of the cells of the nearest neighbors search of the maps
+const double MapSearchCellSize = 1.0;
+
+//! Under this number of keypoints per thread, matching them sequentially is faster
+const size_t MinimumKeypointsPerThread = 64;
+
+//! Part of the frame time budget after which the ego-motion ICP loop stops,
+//! the rest is left to the mapping
+const double EgoMotionBudgetRatio = 0.4;
+
+//! The matches of an ICP iteration are reused when the solver stopped on its
+//! iteration limit after moving the pose less than this factor times the
+//! convergence thresholds, matching the keypoints again would find the same
+//! neighborhoods
+const double MatchReuseFactor = 10.0;
+
+//! One keypoint out of this step is matched by the coarse mapping iterations
+const size_t CoarseKeypointsStep = 4;
+
+//! In real-time mode, the keypoints sampling is refined when a frame takes
+//! less than this part of the budget, and is at most this step
+const double RealTimeSlackRatio = 0.6;
+const unsigned int MaximumKeypointsSamplingStep = 8;
+
+//-----------------------------------------------------------------------------
+// Keep one out of step keypoints, in their order
+void SubsampleKeypoints(std::vector<std::pair<int, int> >& keypoints, unsigned int step)
+{
+  if (step <= 1)
+  {
+    return;
+  }
+  size_t kept = 0;
+  for (size_t k = 0; k < keypoints.size(); k += step)
+  {
+    keypoints[kept++] = keypoints[k];
+  }
+  keypoints.resize(kept);
 }
 
-// The map reconstructed from the slam algorithm is stored in a voxel grid
-// which split the space in differents region. From this voxel grid it is possible
-// to only load the parts of the map which are pertinents when we run the mapping
-// optimization algorithm. Morevover, when a a region of the space is too far from
-// the current sensor position it is possible to remove the points stored in this region
-// and to move the voxel grid in a closest region of the sensor position. This is used
-// to decrease the memory used by the algorithm
-class RollingGrid {
-public:
-  RollingGrid() {}
+//-----------------------------------------------------------------------------
+// k nearest neighbors of p, taken from the query of the batch search if given
+void NearestKSearch(const pcl::search::Search<Point>::Ptr& search, const KnnBatchSearch* neighbors, size_t query,
+                    const Point& p, unsigned int k, std::vector<int>& indices, std::vector<float>& distances)
+{
+  if (!neighbors)
+  {
+    search->nearestKSearch(p, k, indices, distances);
+    return;
+  }
+  const unsigned int count = std::min(k, neighbors->GetNumberOfNeighbors(query));
+  indices.assign(neighbors->GetIndices(query), neighbors->GetIndices(query) + count);
+  distances.assign(neighbors->GetSquaredDistances(query), neighbors->GetSquaredDistances(query) + count);
+}
 
-  RollingGrid(double posX, double posY, double posZ)
+//-----------------------------------------------------------------------------
+// PCA of the first count neighbors of a keypoint. The mean and the covariance
+// are accumulated in fixed size matrices so that nothing is allocated
+void ComputeNeighborsPCA(const pcl::PointCloud<Point>& cloud, const std::vector<int>& indices, unsigned int count,
+                         Eigen::Vector3d& mean, Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d>& eig)
+{
+  mean = Eigen::Vector3d::Zero();
+  for (unsigned int k = 0; k < count; ++k)
   {
-    // should initialize using Tworld + size / 2
-    this->VoxelGridPosition[0] = static_cast<int>(posX);
-    this->VoxelGridPosition[1] = static_cast<int>(posY);
-    this->VoxelGridPosition[2] = static_cast<int>(posZ);;
+    const Point& pt = cloud.points[indices[k]];
+    mean += Eigen::Vector3d(pt.x, pt.y, pt.z);
   }
+  mean /= count;
 
-  // roll the grid to enable adding new point cloud
-  void Roll(Eigen::Matrix<double, 6, 1> &T)
+  Eigen::Matrix3d cov = Eigen::Matrix3d::Zero();
+  for (unsigned int k = 0; k < count; ++k)
   {
-    // Very basic implementation where the grid is not circular
+    const Point& pt = cloud.points[indices[k]];
+    const Eigen::Vector3d centered = Eigen::Vector3d(pt.x, pt.y, pt.z) - mean;
+    cov += centered * centered.transpose();
+  }
+  eig.compute(cov);
+}
 
-    // compute the position of the new frame center in the grid
-    int frameCenterX = std::floor(T[3] / this->VoxelSize) - this->VoxelGridPosition[0];
-    int frameCenterY = std::floor(T[4] / this->VoxelSize) - this->VoxelGridPosition[1];
-    int frameCenterZ = std::floor(T[5] / this->VoxelSize) - this->VoxelGridPosition[2];
+}
 
-    // shift the voxel grid to the left
-    while (frameCenterX - std::ceil(this->PointCloudSize / 2) <= 0)
+// Poses of an undistortion interpolator sampled on a regular grid over the sweep of a
+// frame. A point is undistorted by blending the two poses around its relative time
+// instead of interpolating a vtkTransform for each point: the grid is fine enough for
+// the blend of two close rotations to stay a rotation up to the precision of the points.
+// The poses are only read once sampled, so the points can be undistorted concurrently.
+class UndistortionPoses
+{
+public:
+  //! Number of intervals of the time grid
+  static const unsigned int Resolution = 256;
+
+  void Sample(vtkVelodyneTransformInterpolator* interpolator)
+  {
+    this->Poses.resize(Resolution + 1);
+    double times[Resolution + 1];
+    for (unsigned int k = 0; k <= Resolution; ++k)
     {
-      for (int j = 0; j < this->VoxelSize; j++)
+      times[k] = static_cast<double>(k) / Resolution;
+    }
+    std::vector<double> matrices(16 * (Resolution + 1));
+    interpolator->InterpolateTransformMatrices(times, Resolution + 1, matrices.data());
+    for (unsigned int k = 0; k <= Resolution; ++k)
+    {
+      for (unsigned int i = 0; i < 3; ++i)
       {
-        for (int k = 0; k < this->VoxelSize; k++)
+        for (unsigned int j = 0; j < 4; ++j)
         {
-          for (int i = this->VoxelSize - 1; i > 0; i--)
-          {
-            this->grid[i][j][k] = this->grid[i-1][j][k];
-          }
-          this->grid[0][j][k].reset(new pcl::PointCloud<Point>());
+          this->Poses[k](i, j) = matrices[16 * k + 4 * i + j];
         }
       }
-      frameCenterX++;
-      this->VoxelGridPosition[0]--;
     }
+  }
+
+  //! Transform a point with the pose at its relative time, stored in its intensity
+  void Transform(Point& p) const
+  {
+    const double t = std::min(std::max(static_cast<double>(p.intensity), 0.0), 1.0) * Resolution;
+    const unsigned int k = std::min(static_cast<unsigned int>(t), Resolution - 1);
+    const double ratio = t - k;
+    const Eigen::Matrix<double, 3, 4> M = (1.0 - ratio) * this->Poses[k] + ratio * this->Poses[k + 1];
+    const Eigen::Vector3d P = M.leftCols<3>() * Eigen::Vector3d(p.x, p.y, p.z) + M.col(3);
+    p.x = P(0);
+    p.y = P(1);
+    p.z = P(2);
+  }
+
+private:
+  std::vector<Eigen::Matrix<double, 3, 4>, Eigen::aligned_allocator<Eigen::Matrix<double, 3, 4> > > Poses;
+};
+
+// Nearest neighbors search over the points of a rolling grid, updated in place as the
+// voxels of the grid change instead of being rebuilt for each frame. The points are stored
+// in a single cloud, whose indices stay valid until their voxel changes, and hashed in small
+// cubic cells. A k nearest search visits the cells by growing shells around the query until
+// no unvisited cell can hold a closer point, which gives the same neighbors as a kd-tree.
+class VoxelHashSearch : public pcl::search::Search<Point>
+{
+public:
+  typedef boost::shared_ptr<VoxelHashSearch> Ptr;
+  using pcl::search::Search<Point>::nearestKSearch;
+  using pcl::search::Search<Point>::radiusSearch;
+
+  VoxelHashSearch(double cellSize, int numberOfVoxels)
+    : pcl::search::Search<Point>("VoxelHashSearch", true)
+    , Points(new pcl::PointCloud<Point>())
+    , CellSize(cellSize)
+    , VoxelSlots(numberOfVoxels)
+  {
+    this->input_ = this->Points;
+  }
+
+  size_t GetNumberOfPoints() const { return this->Points->size() - this->FreeSlots.size(); }
+
+  // memory used by the points and by the slots of the voxels and of the cells, in bytes
+  size_t GetMemorySize() const
+  {
+    size_t size = this->Points->points.capacity() * sizeof(Point) +
+      this->FreeSlots.capacity() * sizeof(int);
+    for (const std::vector<int>& slots : this->VoxelSlots)
+    {
+      size += sizeof(slots) + slots.capacity() * sizeof(int);
+    }
+    // each cell is a node of the hash map, pointed by a bucket
+    for (const CellMap::value_type& cell : this->Cells)
+    {
+      size += sizeof(cell) + 2 * sizeof(void*) + cell.second.capacity() * sizeof(int);
+    }
+    return size;
+  }
 
-    // shift the voxel grid to the right
-    while (frameCenterX + std::ceil(this->PointCloudSize / 2) >= this->VoxelSize - 1)
+  // replace the points of a voxel of the rolling grid
+  void SetVoxelPoints(int voxel, const pcl::PointCloud<Point>& cloud)
+  {
+    this->ClearVoxel(voxel);
+    std::vector<int>& slots = this->VoxelSlots[voxel];
+    for (unsigned int i = 0; i < cloud.size(); i++)
     {
-      for (int j = 0; j < this->VoxelSize; j++)
+      int slot;
+      if (this->FreeSlots.empty())
       {
-        for (int k = 0; k < this->VoxelSize; k++)
-        {
-          for (int i = 0; i < this->VoxelSize - 1; i++)
-          {
-            this->grid[i][j][k] = this->grid[i+1][j][k];
-          }
-          this->grid[VoxelSize-1][j][k].reset(new pcl::PointCloud<Point>());
-        }
+        slot = static_cast<int>(this->Points->size());
+        this->Points->push_back(cloud.points[i]);
       }
-      frameCenterX--;
-      this->VoxelGridPosition[0]++;
+      else
+      {
+        slot = this->FreeSlots.back();
+        this->FreeSlots.pop_back();
+        this->Points->points[slot] = cloud.points[i];
+      }
+      slots.push_back(slot);
+      this->Cells[this->GetCellKey(cloud.points[i])].push_back(slot);
     }
+  }
 
-    // shift the voxel grid to the bottom
-    while (frameCenterY - std::ceil(this->PointCloudSize / 2) <= 0)
+  // remove the points of a voxel of the rolling grid, their slots are reused by the next ones
+  void ClearVoxel(int voxel)
+  {
+    std::vector<int>& slots = this->VoxelSlots[voxel];
+    for (unsigned int i = 0; i < slots.size(); i++)
     {
-      for (int i = 0; i < this->VoxelSize; i++)
+      Point& point = this->Points->points[slots[i]];
+      CellMap::iterator cell = this->Cells.find(this->GetCellKey(point));
+      std::vector<int>& cellSlots = cell->second;
+      *std::find(cellSlots.begin(), cellSlots.end(), slots[i]) = cellSlots.back();
+      cellSlots.pop_back();
+      if (cellSlots.empty())
       {
-        for (int k = 0; k < this->VoxelSize; k++)
-        {
-          for (int j = this->VoxelSize - 1; j > 0; j--)
-          {
-            this->grid[i][j][k] = this->grid[i][j-1][k];
-          }
-          this->grid[i][0][k].reset(new pcl::PointCloud<Point>());
-        }
+        this->Cells.erase(cell);
       }
-      frameCenterY++;
-      this->VoxelGridPosition[1]--;
-//      cout << "bottom";
+      // a free slot must never be found by the exhaustive search
+      point.x = point.y = point.z = std::numeric_limits<float>::quiet_NaN();
+      this->FreeSlots.push_back(slots[i]);
+    }
+    slots.clear();
+  }
+
+  int nearestKSearch(const Point& point, int k, std::vector<int>& k_indices,
+    std::vector<float>& k_sqr_distances) const override
+  {
+    k_indices.clear();
+    k_sqr_distances.clear();
+    const size_t numberOfPoints = this->GetNumberOfPoints();
+    if (k <= 0 || numberOfPoints == 0)
+    {
+      return 0;
     }
+    const size_t count = std::min(static_cast<size_t>(k), numberOfPoints);
 
-    // shift the voxel grid to the top
-    while (frameCenterY + std::ceil(this->PointCloudSize / 2) >= this->VoxelSize - 1)
+    std::vector<std::pair<float, int> > candidates;
+    const int cx = this->GetCellIndex(point.x);
+    const int cy = this->GetCellIndex(point.y);
+    const int cz = this->GetCellIndex(point.z);
+    for (int shell = 0; ; shell++)
     {
-      for (int i = 0; i < this->VoxelSize; i++)
+      // past this volume, going through all the points is cheaper than visiting the cells
+      const double side = 2 * shell + 1;
+      if (side * side * side > numberOfPoints)
       {
-        for (int k = 0; k < this->VoxelSize; k++)
+        candidates.clear();
+        for (unsigned int slot = 0; slot < this->Points->size(); slot++)
         {
-          for (int j = 0; j < this->VoxelSize - 1; j++)
+          if (!std::isnan(this->Points->points[slot].x))
           {
-            this->grid[i][j][k] = this->grid[i][j+1][k];
+            candidates.push_back(
+              std::make_pair(SquaredDistance(point, this->Points->points[slot]), slot));
           }
-          this->grid[i][VoxelSize-1][k].reset(new pcl::PointCloud<Point>());
         }
+        std::nth_element(candidates.begin(), candidates.begin() + count - 1, candidates.end());
+        break;
       }
-      frameCenterY--;
-      this->VoxelGridPosition[1]++;
-    }
 
-    // shift the voxel grid to the "camera"
-    while (frameCenterZ - std::ceil(this->PointCloudSize / 2) <= 0)
-    {
-      for (int i = 0; i < this->VoxelSize; i++)
+      // the cells whose largest offset to the query cell is shell
+      for (int dx = -shell; dx <= shell; dx++)
       {
-        for (int j = 0; j < this->VoxelSize; j++)
+        for (int dy = -shell; dy <= shell; dy++)
         {
-          for (int k = this->VoxelSize - 1; k > 0; k--)
+          const bool onFace = std::abs(dx) == shell || std::abs(dy) == shell;
+          const int dzStep = (onFace || shell == 0) ? 1 : 2 * shell;
+          for (int dz = -shell; dz <= shell; dz += dzStep)
           {
-            this->grid[i][j][k] = this->grid[i][j][k-1];
+            this->AddCellCandidates(point, cx + dx, cy + dy, cz + dz, candidates);
           }
-          this->grid[i][j][0].reset(new pcl::PointCloud<Point>());
         }
       }
-      frameCenterZ++;
-      this->VoxelGridPosition[2]--;
+
+      if (candidates.size() >= count)
+      {
+        std::nth_element(candidates.begin(), candidates.begin() + count - 1, candidates.end());
+        // the points of the cells not visited yet are farther than shell cells
+        const double reach = shell * this->CellSize;
+        if (candidates[count - 1].first <= reach * reach)
+        {
+          break;
+        }
+      }
+    }
+
+    candidates.resize(count);
+    std::sort(candidates.begin(), candidates.end());
+    for (size_t i = 0; i < count; i++)
+    {
+      k_sqr_distances.push_back(candidates[i].first);
+      k_indices.push_back(candidates[i].second);
     }
+    return static_cast<int>(count);
+  }
 
-    // shift the voxel grid to the "horizon"
-    while (frameCenterZ + std::ceil(this->PointCloudSize  / 2) >= this->VoxelSize - 1)
+  int radiusSearch(const Point& point, double radius, std::vector<int>& k_indices,
+    std::vector<float>& k_sqr_distances, unsigned int max_nn = 0) const override
+  {
+    k_indices.clear();
+    k_sqr_distances.clear();
+    std::vector<std::pair<float, int> > candidates;
+    const int reach = static_cast<int>(std::ceil(radius / this->CellSize));
+    const int cx = this->GetCellIndex(point.x);
+    const int cy = this->GetCellIndex(point.y);
+    const int cz = this->GetCellIndex(point.z);
+    for (int dx = -reach; dx <= reach; dx++)
     {
-      for (int i = 0; i < this->VoxelSize; i++)
+      for (int dy = -reach; dy <= reach; dy++)
       {
-        for (int j = 0; j < this->VoxelSize; j++)
+        for (int dz = -reach; dz <= reach; dz++)
         {
-          for (int k = 0; k < this->VoxelSize - 1; k++)
-          {
-            this->grid[i][j][k] = this->grid[i][j][k+1];
-          }
-          this->grid[i][j][VoxelSize-1].reset(new pcl::PointCloud<Point>());
+          this->AddCellCandidates(point, cx + dx, cy + dy, cz + dz, candidates);
         }
       }
-      frameCenterZ--;
-      this->VoxelGridPosition[2]++;
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+      if (candidates[i].first > radius * radius || (max_nn > 0 && k_indices.size() == max_nn))
+      {
+        break;
+      }
+      k_sqr_distances.push_back(candidates[i].first);
+      k_indices.push_back(candidates[i].second);
+    }
+    return static_cast<int>(k_indices.size());
+  }
+
+private:
+  typedef std::unordered_map<uint64_t, std::vector<int> > CellMap;
+
+  static float SquaredDistance(const Point& a, const Point& b)
+  {
+    const float dx = a.x - b.x;
+    const float dy = a.y - b.y;
+    const float dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz;
+  }
+
+  int GetCellIndex(float coordinate) const
+  {
+    return static_cast<int>(std::floor(coordinate / this->CellSize));
+  }
+
+  // 21 bits per axis, which covers more than a thousand kilometers with metric cells
+  static uint64_t GetCellKey(int x, int y, int z)
+  {
+    const uint64_t mask = (1 << 21) - 1;
+    return ((static_cast<uint64_t>(x) & mask) << 42) | ((static_cast<uint64_t>(y) & mask) << 21) |
+      (static_cast<uint64_t>(z) & mask);
+  }
+
+  uint64_t GetCellKey(const Point& point) const
+  {
+    return GetCellKey(
+      this->GetCellIndex(point.x), this->GetCellIndex(point.y), this->GetCellIndex(point.z));
+  }
+
+  void AddCellCandidates(const Point& point, int x, int y, int z,
+    std::vector<std::pair<float, int> >& candidates) const
+  {
+    CellMap::const_iterator cell = this->Cells.find(GetCellKey(x, y, z));
+    if (cell == this->Cells.end())
+    {
+      return;
+    }
+    for (unsigned int i = 0; i < cell->second.size(); i++)
+    {
+      const int slot = cell->second[i];
+      candidates.push_back(std::make_pair(SquaredDistance(point, this->Points->points[slot]), slot));
+    }
+  }
+
+  //! Points of the map, with the free slots set to NaN
+  pcl::PointCloud<Point>::Ptr Points;
+
+  //! Slots of Points which can be reused
+  std::vector<int> FreeSlots;
+
+  //! Size of the cells in which the points are hashed
+  double CellSize;
+
+  //! Slots in Points of the points of each voxel of the rolling grid
+  std::vector<std::vector<int> > VoxelSlots;
+
+  //! Slots of the points of each cell
+  CellMap Cells;
+};
+
+//-----------------------------------------------------------------------------
+// The map reconstructed from the slam algorithm is stored in a voxel grid
+// which split the space in differents region. From this voxel grid it is possible
+// to only load the parts of the map which are pertinents when we run the mapping
+// optimization algorithm. Morevover, when a a region of the space is too far from
+// the current sensor position it is possible to remove the points stored in this region
+// and to move the voxel grid in a closest region of the sensor position. This is used
+// to decrease the memory used by the algorithm. The points added to a voxel are
+// downsampled as they are inserted: each leaf of the voxel keeps a single point,
+// the mean of the points added to it, so that revisiting a region does not grow it
+class RollingGrid {
+public:
+  RollingGrid() {}
+
+  RollingGrid(double posX, double posY, double posZ)
+  {
+    // should initialize using Tworld + size / 2
+    this->VoxelGridPosition[0] = static_cast<int>(posX);
+    this->VoxelGridPosition[1] = static_cast<int>(posY);
+    this->VoxelGridPosition[2] = static_cast<int>(posZ);;
+  }
+
+  // roll the grid to enable adding new point cloud
+  void Roll(Eigen::Matrix<double, 6, 1> &T)
+  {
+    // The grid is circular: a voxel of the world is stored at its world index modulo the
+    // size of the grid, rolling only moves the grid position and empties the voxels of
+    // the slices which enter the grid, in place of the ones which leave it.
+    const int halfPointCloudSize = this->PointCloudSize / 2;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      // compute the position of the new frame center in the grid
+      int frameCenter = std::floor(T[3 + axis] / this->VoxelSize) - this->VoxelGridPosition[axis];
+
+      // shift the voxel grid toward the negative values
+      if (frameCenter - halfPointCloudSize <= 0)
+      {
+        const int steps = halfPointCloudSize + 1 - frameCenter;
+        this->Shift(axis, -steps);
+        frameCenter += steps;
+      }
+
+      // shift the voxel grid toward the positive values
+      if (frameCenter + halfPointCloudSize >= this->VoxelSize - 1)
+      {
+        const int steps = frameCenter + halfPointCloudSize - this->VoxelSize + 2;
+        this->Shift(axis, steps);
+        frameCenter -= steps;
+      }
     }
   }
 
@@ -469,11 +828,8 @@ public:
           {
             continue;
           }
-          pcl::PointCloud<Point>:: Ptr voxel = this->grid[i][j][k];
-          for (unsigned int l = 0; l < voxel->size(); l++)
-          {
-            intersection->push_back(voxel->at(l));
-          }
+          const pcl::PointCloud<Point>& voxel = *this->grid[this->GetVoxelIndex(i, j, k)];
+          intersection->insert(intersection->end(), voxel.begin(), voxel.end());
         }
       }
     }
@@ -485,20 +841,11 @@ public:
   {
     pcl::PointCloud<Point>::Ptr intersection(new pcl::PointCloud<Point>);
 
-    // Get all voxel in intersection should use ceil here
-    for (int i = 0; i < VoxelSize; i++)
+    // the order of the voxels does not matter here
+    for (size_t index = 0; index < this->grid.size(); index++)
     {
-      for (int j = 0; j < VoxelSize; j++)
-      {
-        for (int k = 0; k < VoxelSize; k++)
-        {
-          pcl::PointCloud<Point>:: Ptr voxel = this->grid[i][j][k];
-          for (unsigned int l = 0; l < voxel->size(); l++)
-          {
-            intersection->push_back(voxel->at(l));
-          }
-        }
-      }
+      const pcl::PointCloud<Point>& voxel = *this->grid[index];
+      intersection->insert(intersection->end(), voxel.begin(), voxel.end());
     }
     return intersection;
   }
@@ -512,8 +859,8 @@ public:
       return;
     }
 
-    // Voxel to filte because new points were add
-    std::vector<std::vector<std::vector<int> > > voxelToFilter(VoxelSize, std::vector<std::vector<int> >(VoxelSize, std::vector<int>(VoxelSize, 0)));
+    // Voxels whose points are modified, to update in the search
+    std::fill(this->VoxelToUpdate.begin(), this->VoxelToUpdate.end(), 0);
 
     // Add points in the rolling grid
     int outlier = 0; // point who are not in the rolling grid
@@ -530,8 +877,13 @@ public:
         cubeIdxY >= 0 && cubeIdxY < this->VoxelSize &&
         cubeIdxZ >= 0 && cubeIdxZ < this->VoxelSize)
       {
-        voxelToFilter[cubeIdxX][cubeIdxY][cubeIdxZ] = 1;
-        grid[cubeIdxX][cubeIdxY][cubeIdxZ]->push_back(pts);
+        const int index = this->GetVoxelIndex(cubeIdxX, cubeIdxY, cubeIdxZ);
+        this->VoxelToUpdate[index] = 1;
+        this->VoxelIsModified[index] = 1;
+        this->VoxelWorldIndex[index] = {{ this->VoxelGridPosition[0] + cubeIdxX,
+                                          this->VoxelGridPosition[1] + cubeIdxY,
+                                          this->VoxelGridPosition[2] + cubeIdxZ }};
+        this->AddToLeaf(index, pts);
       }
       else
       {
@@ -539,23 +891,12 @@ public:
       }
     }
 
-    // Filter the modified pointCloud
-    pcl::VoxelGrid<Point> downSizeFilter;
-    downSizeFilter.setLeafSize(this->LeafSize, this->LeafSize, this->LeafSize);
-    for (int i = 0; i < this->VoxelSize; i++)
+    // The voxels are already downsampled, only their search needs to be updated
+    for (size_t index = 0; index < this->grid.size(); index++)
     {
-      for (int j = 0; j < this->VoxelSize; j++)
+      if (this->VoxelToUpdate[index] == 1)
       {
-        for (int k = 0; k < this->VoxelSize; k++)
-        {
-          if (voxelToFilter[i][j][k] == 1)
-          {
-            pcl::PointCloud<Point>::Ptr tmp(new pcl::PointCloud<Point>());
-            downSizeFilter.setInputCloud(grid[i][j][k]);
-            downSizeFilter.filter(*tmp);
-            grid[i][j][k] = tmp;
-          }
-        }
+        this->UpdateVoxelSearch(static_cast<int>(index));
       }
     }
   }
@@ -569,26 +910,300 @@ public:
   void SetSize(int size)
   {
     this->VoxelSize = size;
-    grid.resize(this->VoxelSize);
-    for (int i = 0; i < this->VoxelSize; i++)
+    grid.resize(this->VoxelSize * this->VoxelSize * this->VoxelSize);
+    for (size_t index = 0; index < this->grid.size(); index++)
     {
-      grid[i].resize(this->VoxelSize);
-      for (int j = 0; j < this->VoxelSize; j++)
+      grid[index].reset(new pcl::PointCloud<Point>());
+    }
+    this->VoxelToUpdate.assign(this->grid.size(), 0);
+    this->Leaves.assign(this->grid.size(), VoxelLeaves());
+    this->VoxelIsModified.assign(this->grid.size(), 0);
+    this->VoxelWorldIndex.resize(this->grid.size());
+    this->LoadedVoxel.reset(new pcl::PointCloud<Point>());
+    this->Search.reset(new VoxelHashSearch(MapSearchCellSize, static_cast<int>(this->grid.size())));
+    if (this->CoarseSearch)
+    {
+      this->CoarseSearch.reset(
+        new VoxelHashSearch(MapSearchCellSize, static_cast<int>(this->grid.size())));
+    }
+  }
+
+  // nearest neighbors search over all the points of the grid, kept up to date by Roll and Add
+  pcl::search::Search<Point>::Ptr GetSearch() const { return this->Search; }
+
+  // nearest neighbors search over the points of the grid downsampled in leaves
+  // of CoarseLeafFactor times the leaf size, null if there is no coarse level
+  pcl::search::Search<Point>::Ptr GetCoarseSearch() const { return this->CoarseSearch; }
+
+  // The coarse level is maintained along the grid when the factor is above 1
+  void SetCoarseLeafFactor(double factor)
+  {
+    if (factor == this->CoarseLeafFactor)
+    {
+      return;
+    }
+    this->CoarseLeafFactor = factor;
+    this->CoarseSearch.reset();
+    if (factor > 1.0)
+    {
+      this->CoarseSearch.reset(
+        new VoxelHashSearch(MapSearchCellSize, static_cast<int>(this->grid.size())));
+      for (size_t index = 0; index < this->grid.size(); index++)
       {
-        grid[i][j].resize(this->VoxelSize);
-        for (int k = 0; k < this->VoxelSize; k++)
-        {
-          grid[i][j][k].reset(new pcl::PointCloud<Point>());
-        }
+        this->UpdateVoxelSearch(static_cast<int>(index));
       }
     }
   }
 
-  void SetResolution(double resolution) { this->VoxelResolution = resolution; }
+  size_t GetNumberOfPoints() const { return this->Search->GetNumberOfPoints(); }
 
-  void SetLeafSize(double size) { this->LeafSize = size; }
+  // memory used by the voxels, their leaves and the search, in bytes
+  size_t GetMemorySize() const
+  {
+    size_t size = this->Search->GetMemorySize() +
+      (this->CoarseSearch ? this->CoarseSearch->GetMemorySize() : 0);
+    for (size_t index = 0; index < this->grid.size(); index++)
+    {
+      size += sizeof(pcl::PointCloud<Point>) + this->grid[index]->points.capacity() * sizeof(Point);
+      const VoxelLeaves& leaves = this->Leaves[index];
+      size += leaves.PointIndex.size() * (sizeof(std::pair<uint64_t, size_t>) + 2 * sizeof(void*)) +
+        leaves.NumberOfPoints.capacity() * sizeof(unsigned int);
+    }
+    return size;
+  }
+
+  void SetResolution(double resolution) { this->VoxelResolution = resolution; }
+
+  // Size of the voxels, the world is split in voxels of VoxelSize meters
+  double GetVoxelWorldSize() const { return this->VoxelSize; }
+
+  // Called with the world index of a voxel and its points when points added to
+  // it leave the grid, and when a voxel enters the grid to fill it
+  void SetVoxelLeaveCallback(const std::function<void(const int*, const pcl::PointCloud<Point>&)>& callback)
+  {
+    this->VoxelLeaveCallback = callback;
+  }
+  void SetVoxelEnterCallback(const std::function<void(const int*, pcl::PointCloud<Point>&)>& callback)
+  {
+    this->VoxelEnterCallback = callback;
+  }
+
+  // Call the leave callback for the voxels which have points added
+  // and are still in the grid
+  void FlushModifiedVoxels()
+  {
+    for (size_t index = 0; index < this->grid.size(); index++)
+    {
+      if (this->VoxelIsModified[index] && this->VoxelLeaveCallback)
+      {
+        this->VoxelLeaveCallback(this->VoxelWorldIndex[index].data(), *this->grid[index]);
+      }
+      this->VoxelIsModified[index] = 0;
+    }
+  }
+
+  // Fill all the voxels of the grid with the enter callback, the
+  // voxels which have points added are kept
+  void FillVoxels()
+  {
+    for (int i = 0; i < this->VoxelSize; i++)
+    {
+      for (int j = 0; j < this->VoxelSize; j++)
+      {
+        for (int k = 0; k < this->VoxelSize; k++)
+        {
+          const int index = this->GetVoxelIndex(i, j, k);
+          if (!this->VoxelIsModified[index])
+          {
+            this->grid[index]->clear();
+            this->Leaves[index].Clear();
+            this->ClearVoxelSearch(index);
+            this->FillVoxel(index, i, j, k);
+          }
+        }
+      }
+    }
+  }
+
+  // The points already in the grid are merged in the leaves of the new size
+  void SetLeafSize(double size)
+  {
+    if (size == this->LeafSize)
+    {
+      return;
+    }
+    this->LeafSize = size;
+    for (size_t index = 0; index < this->grid.size(); index++)
+    {
+      if (!this->grid[index]->empty())
+      {
+        this->grid[index].swap(this->LoadedVoxel);
+        this->AddLoadedVoxel(static_cast<int>(index));
+        this->UpdateVoxelSearch(static_cast<int>(index));
+      }
+    }
+  }
 
 private:
+  // index in the grid of the voxel at position i, j, k relatively to the grid position
+  int GetVoxelIndex(int i, int j, int k) const
+  {
+    const int x = this->Wrap(this->VoxelGridPosition[0] + i);
+    const int y = this->Wrap(this->VoxelGridPosition[1] + j);
+    const int z = this->Wrap(this->VoxelGridPosition[2] + k);
+    return (x * this->VoxelSize + y) * this->VoxelSize + z;
+  }
+
+  // world voxel index modulo the size of the grid
+  int Wrap(int index) const
+  {
+    const int wrapped = index % this->VoxelSize;
+    return wrapped < 0 ? wrapped + this->VoxelSize : wrapped;
+  }
+
+  // move the grid along an axis, and empty the slices which enter it. Once
+  // the whole grid is emptied, the remaining steps only move it, they are
+  // done first so that the slices emptied are the ones of the final grid
+  void Shift(int axis, int steps)
+  {
+    const int numberOfSlices = std::min(std::abs(steps), this->VoxelSize);
+    this->VoxelGridPosition[axis] += steps - (steps < 0 ? -numberOfSlices : numberOfSlices);
+    for (int n = 0; n < numberOfSlices; n++)
+    {
+      const int direction = steps < 0 ? -1 : 1;
+      this->VoxelGridPosition[axis] += direction;
+      // the slice entering the grid is stored where the one leaving it was
+      int slice[3] = { 0, 0, 0 };
+      slice[axis] = direction < 0 ? 0 : this->VoxelSize - 1;
+      for (int u = 0; u < this->VoxelSize; u++)
+      {
+        for (int v = 0; v < this->VoxelSize; v++)
+        {
+          slice[(axis + 1) % 3] = u;
+          slice[(axis + 2) % 3] = v;
+          // clear keeps the memory of the cloud for its next points
+          const int index = this->GetVoxelIndex(slice[0], slice[1], slice[2]);
+          if (this->VoxelIsModified[index] && this->VoxelLeaveCallback)
+          {
+            this->VoxelLeaveCallback(this->VoxelWorldIndex[index].data(), *this->grid[index]);
+          }
+          this->VoxelIsModified[index] = 0;
+          this->grid[index]->clear();
+          this->Leaves[index].Clear();
+          this->ClearVoxelSearch(index);
+          this->FillVoxel(index, slice[0], slice[1], slice[2]);
+        }
+      }
+    }
+  }
+
+  // give the points of a voxel to the searches, downsampled for the coarse one
+  void UpdateVoxelSearch(int index)
+  {
+    const pcl::PointCloud<Point>& voxel = *this->grid[index];
+    this->Search->SetVoxelPoints(index, voxel);
+    if (!this->CoarseSearch)
+    {
+      return;
+    }
+    this->CoarseVoxel.clear();
+    this->CoarseLeaves.Clear();
+    const double coarseLeafSize = this->CoarseLeafFactor * this->LeafSize;
+    for (const Point& p : voxel.points)
+    {
+      const auto leaf = this->CoarseLeaves.PointIndex.emplace(
+        GetLeafKey(p, coarseLeafSize), this->CoarseVoxel.size());
+      if (leaf.second)
+      {
+        this->CoarseVoxel.push_back(p);
+        this->CoarseLeaves.NumberOfPoints.push_back(1);
+      }
+      else
+      {
+        MergeInLeaf(this->CoarseVoxel.points[leaf.first->second],
+          this->CoarseLeaves.NumberOfPoints[leaf.first->second], p);
+      }
+    }
+    this->CoarseSearch->SetVoxelPoints(index, this->CoarseVoxel);
+  }
+
+  void ClearVoxelSearch(int index)
+  {
+    this->Search->ClearVoxel(index);
+    if (this->CoarseSearch)
+    {
+      this->CoarseSearch->ClearVoxel(index);
+    }
+  }
+
+  // fill an empty voxel at position i, j, k relatively to the grid position
+  void FillVoxel(int index, int i, int j, int k)
+  {
+    this->VoxelWorldIndex[index] = {{ this->VoxelGridPosition[0] + i,
+                                      this->VoxelGridPosition[1] + j,
+                                      this->VoxelGridPosition[2] + k }};
+    if (this->VoxelEnterCallback)
+    {
+      this->VoxelEnterCallback(this->VoxelWorldIndex[index].data(), *this->LoadedVoxel);
+      this->AddLoadedVoxel(index);
+      this->UpdateVoxelSearch(index);
+    }
+  }
+
+  // 21 bits per axis, the leaves of a voxel are far from wrapping around
+  static uint64_t GetLeafKey(const Point& p, double leafSize)
+  {
+    const uint64_t mask = (1 << 21) - 1;
+    const uint64_t x = static_cast<uint64_t>(static_cast<int64_t>(std::floor(p.x / leafSize))) & mask;
+    const uint64_t y = static_cast<uint64_t>(static_cast<int64_t>(std::floor(p.y / leafSize))) & mask;
+    const uint64_t z = static_cast<uint64_t>(static_cast<int64_t>(std::floor(p.z / leafSize))) & mask;
+    return (x << 42) | (y << 21) | z;
+  }
+
+  // move the point of a leaf to the mean of its numberOfPoints points and p
+  static void MergeInLeaf(Point& mean, unsigned int& numberOfPoints, const Point& p)
+  {
+    const float weight = 1.0f / ++numberOfPoints;
+    mean.x += weight * (p.x - mean.x);
+    mean.y += weight * (p.y - mean.y);
+    mean.z += weight * (p.z - mean.z);
+    mean.intensity += weight * (p.intensity - mean.intensity);
+    mean.normal_x += weight * (p.normal_x - mean.normal_x);
+    mean.normal_y += weight * (p.normal_y - mean.normal_y);
+    mean.normal_z += weight * (p.normal_z - mean.normal_z);
+    mean.curvature += weight * (p.curvature - mean.curvature);
+  }
+
+  // add a point to a voxel: it is the point of its leaf if the leaf is empty,
+  // otherwise the point of the leaf is moved to the mean of its points
+  void AddToLeaf(int index, const Point& p)
+  {
+    pcl::PointCloud<Point>& voxel = *this->grid[index];
+    VoxelLeaves& leaves = this->Leaves[index];
+    const auto leaf = leaves.PointIndex.emplace(GetLeafKey(p, this->LeafSize), voxel.size());
+    if (leaf.second)
+    {
+      voxel.push_back(p);
+      leaves.NumberOfPoints.push_back(1);
+      return;
+    }
+
+    const size_t pointIndex = leaf.first->second;
+    MergeInLeaf(voxel.points[pointIndex], leaves.NumberOfPoints[pointIndex], p);
+  }
+
+  // replace the points of a voxel by the loaded ones, merged in their leaves
+  void AddLoadedVoxel(int index)
+  {
+    this->grid[index]->clear();
+    this->Leaves[index].Clear();
+    for (size_t i = 0; i < this->LoadedVoxel->size(); i++)
+    {
+      this->AddToLeaf(index, this->LoadedVoxel->points[i]);
+    }
+    this->LoadedVoxel->clear();
+  }
+
   //! Size of the voxel grid: n*n*n voxels
   int VoxelSize = 50;
 
@@ -601,46 +1216,254 @@ private:
   //! Size of the leaf use to downsample the pointcloud
   double LeafSize = 0.2;
 
-  //! VoxelGrid of pointcloud
-  std::vector<std::vector<std::vector<pcl::PointCloud<Point>::Ptr> > > grid;
+  //! Circular VoxelGrid of pointcloud, see GetVoxelIndex
+  std::vector<pcl::PointCloud<Point>::Ptr> grid;
+
+  //! Voxels modified by Add, whose search needs to be updated
+  std::vector<char> VoxelToUpdate;
+
+  //! Leaves of a voxel which hold a point, with the index of their point in
+  //! the voxel cloud, and the number of points merged in each point
+  struct VoxelLeaves
+  {
+    std::unordered_map<uint64_t, size_t> PointIndex;
+    std::vector<unsigned int> NumberOfPoints;
+
+    void Clear()
+    {
+      this->PointIndex.clear();
+      this->NumberOfPoints.clear();
+    }
+  };
+  std::vector<VoxelLeaves> Leaves;
+
+  //! Voxels which have points added since they entered the grid,
+  //! and world index of the points each voxel stores
+  std::vector<char> VoxelIsModified;
+  std::vector<std::array<int, 3> > VoxelWorldIndex;
+
+  std::function<void(const int*, const pcl::PointCloud<Point>&)> VoxelLeaveCallback;
+  std::function<void(const int*, pcl::PointCloud<Point>&)> VoxelEnterCallback;
+
+  //! Spare cloud in which the points of a voxel are loaded
+  pcl::PointCloud<Point>::Ptr LoadedVoxel;
+
+  //! Nearest neighbors search over the points of the grid
+  VoxelHashSearch::Ptr Search;
+
+  //! Coarse level: search over the points of each voxel merged in leaves of
+  //! CoarseLeafFactor times LeafSize, and scratch voxel used to downsample them
+  double CoarseLeafFactor = 0.0;
+  VoxelHashSearch::Ptr CoarseSearch;
+  pcl::PointCloud<Point> CoarseVoxel;
+  VoxelLeaves CoarseLeaves;
 
   // Position of the VoxelGrid
   int VoxelGridPosition[3] = {0,0,0};
 };
 
+//-----------------------------------------------------------------------------
+class vtkSlam::FramesPipeline
+{
+public:
+  FramesPipeline(vtkSlam* slam)
+    : Slam(slam)
+  {
+    for (unsigned int k = 0; k < NumberOfFrames; ++k)
+    {
+      this->FreeFrames.push_back(std::make_shared<ExtractedFrame>());
+    }
+    this->ExtractionThread = boost::thread(&FramesPipeline::ExtractionLoop, this);
+    this->EstimationThread = boost::thread(&FramesPipeline::EstimationLoop, this);
+  }
+
+  // Process the frames still queued before returning
+  ~FramesPipeline()
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(this->Mutex);
+      this->IsClosing = true;
+    }
+    this->Condition.notify_all();
+    this->ExtractionThread.join();
+    this->EstimationThread.join();
+  }
+
+  // Block while too many frames are waiting for their extraction
+  void Push(vtkSmartPointer<vtkPolyData> frame)
+  {
+    boost::unique_lock<boost::mutex> lock(this->Mutex);
+    while (this->RawFrames.size() >= MaximumQueuedFrames)
+    {
+      this->Condition.wait(lock);
+    }
+    this->RawFrames.push_back(frame);
+    this->Condition.notify_all();
+  }
+
+private:
+  void ExtractionLoop()
+  {
+    while (true)
+    {
+      vtkSmartPointer<vtkPolyData> rawFrame;
+      std::shared_ptr<ExtractedFrame> frame;
+      {
+        boost::unique_lock<boost::mutex> lock(this->Mutex);
+        while (!(this->IsClosing && this->RawFrames.empty()) &&
+               (this->RawFrames.empty() || this->FreeFrames.empty()))
+        {
+          this->Condition.wait(lock);
+        }
+        if (this->RawFrames.empty())
+        {
+          this->ExtractionDone = true;
+          this->Condition.notify_all();
+          return;
+        }
+        rawFrame = this->RawFrames.front();
+        this->RawFrames.pop_front();
+        frame = this->FreeFrames.back();
+        this->FreeFrames.pop_back();
+        this->Condition.notify_all();
+      }
+
+      this->Slam->ExtractKeypoints(rawFrame, *frame);
+
+      boost::lock_guard<boost::mutex> lock(this->Mutex);
+      this->ExtractedFrames.push_back(frame);
+      this->Condition.notify_all();
+    }
+  }
+
+  void EstimationLoop()
+  {
+    while (true)
+    {
+      std::shared_ptr<ExtractedFrame> frame;
+      {
+        boost::unique_lock<boost::mutex> lock(this->Mutex);
+        while (this->ExtractedFrames.empty() && !this->ExtractionDone)
+        {
+          this->Condition.wait(lock);
+        }
+        if (this->ExtractedFrames.empty())
+        {
+          return;
+        }
+        frame = this->ExtractedFrames.front();
+        this->ExtractedFrames.pop_front();
+      }
+
+      // The previous frame is only released once the estimation no
+      // longer uses it, its buffers are then reused by the extraction
+      std::shared_ptr<ExtractedFrame> previousFrame = this->Slam->Frame;
+      this->Slam->EstimateFrame(frame);
+
+      if (previousFrame && previousFrame != frame)
+      {
+        boost::lock_guard<boost::mutex> lock(this->Mutex);
+        this->FreeFrames.push_back(previousFrame);
+        this->Condition.notify_all();
+      }
+    }
+  }
+
+  //! Frames being extracted, waiting for their estimation or free to be reused
+  static const unsigned int NumberOfFrames = 3;
+  //! Frames that can wait for their extraction
+  static const size_t MaximumQueuedFrames = 2;
+
+  vtkSlam* Slam;
+  boost::mutex Mutex;
+  boost::condition_variable Condition;
+  std::deque<vtkSmartPointer<vtkPolyData>> RawFrames;
+  std::deque<std::shared_ptr<ExtractedFrame>> ExtractedFrames;
+  std::vector<std::shared_ptr<ExtractedFrame>> FreeFrames;
+  bool IsClosing = false;
+  bool ExtractionDone = false;
+  boost::thread ExtractionThread;
+  boost::thread EstimationThread;
+};
+
 //-----------------------------------------------------------------------------
 int vtkSlam::RequestData(vtkInformation *vtkNotUsed(request),
 vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkSlam::RequestData");
+  // Each sensor has its frame and its calibration
+  const int numberOfSensors = inputVector[0]->GetNumberOfInformationObjects();
+  if (inputVector[1]->GetNumberOfInformationObjects() != numberOfSensors)
+  {
+    vtkErrorMacro(<< "Got " << numberOfSensors << " point clouds and "
+                  << inputVector[1]->GetNumberOfInformationObjects() << " calibrations");
+    return 0;
+  }
   if (this->LaserIdMapping.empty())
   {
-    vtkTable *calib = vtkTable::GetData(inputVector[1]->GetInformationObject(0));
-    this->UpdateLaserIdMapping(calib);
+    std::vector<vtkTable*> calibs;
+    for (int sensor = 0; sensor < numberOfSensors; ++sensor)
+    {
+      calibs.push_back(vtkTable::GetData(inputVector[1]->GetInformationObject(sensor)));
+    }
+    this->UpdateLaserIdMapping(calibs);
   }
 
   // Get the input
-  vtkPolyData *input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  if (numberOfSensors > 1)
+  {
+    std::vector<vtkPolyData*> frames;
+    for (int sensor = 0; sensor < numberOfSensors; ++sensor)
+    {
+      frames.push_back(vtkPolyData::GetData(inputVector[0]->GetInformationObject(sensor)));
+    }
+    this->AddFrames(frames);
+  }
+  else
+  {
+    vtkPolyData *input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+    this->AddFrame(input);
+  }
+
+  // The frames are still being processed in pipelined mode
+  if (this->Pipeline)
+  {
+    return 1;
+  }
 
-  this->AddFrame(input);
   // output 0 - Current Frame
   vtkInformation *outInfo0 = outputVector->GetInformationObject(0);
   vtkPolyData *output0 = vtkPolyData::SafeDownCast(
       outInfo0->Get(vtkDataObject::DATA_OBJECT()));
-  // add all debug information if displayMode == True
-  if (this->DisplayMode == true && this->NbrFrameProcessed > 0)
-  {
-    this->DisplayLaserIdMapping(this->vtkCurrentFrame);
-    this->DisplayRelAdv(this->vtkCurrentFrame);
-    this->DisplayUsedKeypoints(this->vtkCurrentFrame);
-    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->Angles, "angles_line", this->vtkCurrentFrame);
-    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->LengthResolution, "length_resolution", this->vtkCurrentFrame);
-    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->SaillantPoint, "saillant_point", this->vtkCurrentFrame);
-    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->DepthGap, "depth_gap", this->vtkCurrentFrame);
-    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->IntensityGap, "intensity_gap", this->vtkCurrentFrame);
-    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->BlobScore, "blob_score", this->vtkCurrentFrame);
-    AddVectorToPolydataPoints<int, vtkIntArray>(this->IsPointValid, "is_point_valid", this->vtkCurrentFrame);
-    AddVectorToPolydataPoints<int, vtkIntArray>(this->Label, "keypoint_label", this->vtkCurrentFrame);
+  // add all debug information at the full debug output level
+  if (this->OutputLevel >= FullDebug && this->NbrFrameProcessed > 0 && this->Frame)
+  {
+    this->DisplayLaserIdMapping(this->Frame->vtkCurrentFrame);
+    this->DisplayRelAdv(this->Frame->vtkCurrentFrame);
+    this->DisplayUsedKeypoints(this->Frame->vtkCurrentFrame);
+    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->Frame->Angles, "angles_line", this->Frame->vtkCurrentFrame);
+    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->Frame->LengthResolution, "length_resolution", this->Frame->vtkCurrentFrame);
+    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->Frame->SaillantPoint, "saillant_point", this->Frame->vtkCurrentFrame);
+    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->Frame->DepthGap, "depth_gap", this->Frame->vtkCurrentFrame);
+    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->Frame->IntensityGap, "intensity_gap", this->Frame->vtkCurrentFrame);
+    AddVectorToPolydataPoints<double, vtkDoubleArray>(this->Frame->BlobScore, "blob_score", this->Frame->vtkCurrentFrame);
+    AddVectorToPolydataPoints<int, vtkIntArray>(this->Frame->IsPointValid, "is_point_valid", this->Frame->vtkCurrentFrame);
+    AddVectorToPolydataPoints<int, vtkIntArray>(this->Frame->Label, "keypoint_label", this->Frame->vtkCurrentFrame);
+  }
+  // output 1 - Trajectory
+  auto *output1 = vtkPolyData::GetData(outputVector->GetInformationObject(1));
+  output1->ShallowCopy(this->Trajectory);
+
+  // output 5 - Profiling
+  auto *output5 = vtkTable::GetData(outputVector->GetInformationObject(5));
+  output5->ShallowCopy(this->ProfilingTable);
+
+  // Only the poses are required, the frame and the maps are not converted
+  if (this->OutputLevel <= Poses)
+  {
+    return 1;
   }
+
   // get transform
   vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
   transform->Translate(Tworld[3], Tworld[4], Tworld[5]);
@@ -649,28 +1472,27 @@ vtkInformationVector **inputVector, vtkInformationVector *outputVector)
   transform->RotateZ(Rad2Deg(Tworld[2]));
   // create transform filter and transformt the current frame
   vtkSmartPointer<vtkTransformPolyDataFilter> transformFilter = vtkSmartPointer<vtkTransformPolyDataFilter>::New();
-  transformFilter->SetInputData(this->vtkCurrentFrame);
-  transformFilter->SetTransform(transform);
-  transformFilter->Update();
-  output0->ShallowCopy(transformFilter->GetOutput());
-
-  // output 1 - Trajectory
-  auto *output1 = vtkPolyData::GetData(outputVector->GetInformationObject(1));
-  output1->ShallowCopy(this->Trajectory);
+  if (this->Frame)
+  {
+    transformFilter->SetInputData(this->Frame->vtkCurrentFrame);
+    transformFilter->SetTransform(transform);
+    transformFilter->Update();
+    output0->ShallowCopy(transformFilter->GetOutput());
+  }
 
   // output 2 - Edges Points Map
   auto *output2 = vtkPolyData::GetData(outputVector->GetInformationObject(2));
-  auto EdgeMap = vtkPCLConversions::PolyDataFromPointCloud(this->EdgesPointsLocalMap->Get());
+  auto EdgeMap = vtkPCLConversions::PolyDataViewOfPointCloud(this->EdgesPointsLocalMap->Get());
   output2->ShallowCopy(EdgeMap);
 
   // output 3 - Planar Points Map
   auto *output3 = vtkPolyData::GetData(outputVector->GetInformationObject(3));
-  auto PlanarMap = vtkPCLConversions::PolyDataFromPointCloud(this->PlanarPointsLocalMap->Get());
+  auto PlanarMap = vtkPCLConversions::PolyDataViewOfPointCloud(this->PlanarPointsLocalMap->Get());
   output3->ShallowCopy(PlanarMap);
 
   // output 4 - Blob Points Map
   auto *output4 = vtkPolyData::GetData(outputVector->GetInformationObject(4));
-  auto BlobMap = vtkPCLConversions::PolyDataFromPointCloud(this->BlobsPointsLocalMap->Get());
+  auto BlobMap = vtkPCLConversions::PolyDataViewOfPointCloud(this->BlobsPointsLocalMap->Get());
   output4->ShallowCopy(BlobMap);
 
   return 1;
@@ -683,10 +1505,32 @@ void vtkSlam::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "Slam Parameters: " << std::endl;
   vtkIndent paramIndent = indent.GetNextIndent();
   #define PrintParameter(param) os << paramIndent << #param << "\t" << this->param << std::endl;
+  PrintParameter(RealTime)
+  PrintParameter(OutputLevel)
+  PrintParameter(FrameTimeBudget)
+  PrintParameter(Deterministic)
+  PrintParameter(Profiling)
+  PrintParameter(LoopClosure)
+  PrintParameter(LoopClosureKeyframeDistance)
+  PrintParameter(LoopClosureSearchRadius)
+  PrintParameter(LoopClosureMaxKeyframes)
+  PrintParameter(MapExportFileName)
+  PrintParameter(InitialMapFileName)
+  PrintParameter(UpdateMap)
+  PrintParameter(MapKeyframeDistance)
+  PrintParameter(MapKeyframeAngle)
+  PrintParameter(MapKeyframeMinOverlap)
+  PrintParameter(ImuPrior)
+  PrintParameter(NeighborSearchBackend)
   PrintParameter(EgoMotionLMMaxIter)
   PrintParameter(EgoMotionICPMaxIter)
   PrintParameter(MappingLMMaxIter)
   PrintParameter(MappingICPMaxIter)
+  PrintParameter(MappingCoarseICPIter)
+  PrintParameter(CoarseMapLeafFactor)
+  PrintParameter(ICPConvergenceTranslation)
+  PrintParameter(ICPConvergenceAngle)
+  PrintParameter(ICPConvergenceCostDecrease)
   PrintParameter(EdgeSinAngleThreshold)
   PrintParameter(PlaneSinAngleThreshold)
   PrintParameter(EdgeDepthGapThreshold)
@@ -708,13 +1552,24 @@ void vtkSlam::PrintSelf(ostream& os, vtkIndent indent)
 vtkSlam::vtkSlam()
 {
   this->SetNumberOfInputPorts(2);
-  this->SetNumberOfOutputPorts(5);
+  this->SetNumberOfOutputPorts(6);
   this->Reset();
 }
 
 //-----------------------------------------------------------------------------
 void vtkSlam::Reset()
 {
+  this->StopPipeline();
+  this->FinishMapExport();
+  this->InitialMapFile.reset();
+
+  this->EgoMotionPoses = std::make_shared<UndistortionPoses>();
+  this->MappingPoses = std::make_shared<UndistortionPoses>();
+
+  this->EdgesNeighbors = std::make_shared<KnnBatchSearch>();
+  this->PlanarsNeighbors = std::make_shared<KnnBatchSearch>();
+  this->Scratch = FrameScratch();
+
   this->EdgesPointsLocalMap = std::make_shared<RollingGrid>();
   this->PlanarPointsLocalMap = std::make_shared<RollingGrid>();
   this->BlobsPointsLocalMap = std::make_shared<RollingGrid>();
@@ -726,6 +1581,7 @@ void vtkSlam::Reset()
   this->EdgesPointsLocalMap->SetSize(50);
   this->PlanarPointsLocalMap->SetSize(50);
   this->BlobsPointsLocalMap->SetSize(50);
+  this->UpdateCoarseMaps();
 
   // output of the vtk filter
 
@@ -733,8 +1589,20 @@ void vtkSlam::Reset()
   Tworld = Eigen::Matrix<double, 6, 1>::Zero();
 
   this->LaserIdMapping.clear();
+  this->ScanLineSensor.clear();
+  this->NumberOfSensors = 1;
   this->NbrFrameProcessed = 0;
+  this->KeypointsSamplingStep = 1;
+  this->LastFrameOverBudget = false;
   this->Tworld = Eigen::Matrix<double, 6, 1>::Zero();
+  this->Trelative = Eigen::Matrix<double, 6, 1>::Zero();
+  this->LastMapKeyframeTworld = Eigen::Matrix<double, 6, 1>::Zero();
+  this->PreviousFrameTime = 0.0;
+  this->PreviousFrameDuration = 0.0;
+  this->ProfilingTable = vtkSmartPointer<vtkTable>::New();
+  this->PoseGraph.reset();
+  this->OdometryPoses.clear();
+  this->LoopClosureCorrection = Eigen::Isometry3d::Identity();
 
   // add the required array in the trajectory
   CreateDataArray<vtkDoubleArray>("Variance Error", 0, this->Trajectory);
@@ -745,12 +1613,34 @@ void vtkSlam::Reset()
   CreateDataArray<vtkIntArray>("EgoMotion: edges used", 0, this->Trajectory);
   CreateDataArray<vtkIntArray>("EgoMotion: planes used", 0, this->Trajectory);
   CreateDataArray<vtkIntArray>("EgoMotion: total keypoints used", 0, this->Trajectory);
+  CreateDataArray<vtkDoubleArray>("Time: keypoints extraction", 0, this->Trajectory);
+  CreateDataArray<vtkDoubleArray>("Time: ego-motion", 0, this->Trajectory);
+  CreateDataArray<vtkDoubleArray>("Time: mapping", 0, this->Trajectory);
+  CreateDataArray<vtkDoubleArray>("Time: frame", 0, this->Trajectory);
+  CreateDataArray<vtkIntArray>("Real-time: keypoints sampling step", 0, this->Trajectory);
 }
 
 //-----------------------------------------------------------------------------
 vtkSlam::~vtkSlam()
 {
+  this->StopPipeline();
+  this->FinishMapExport();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::StartPipeline()
+{
+  if (!this->Pipeline)
+  {
+    this->Pipeline.reset(new FramesPipeline(this));
+  }
+}
 
+//-----------------------------------------------------------------------------
+void vtkSlam::StopPipeline()
+{
+  // The pipeline processes its remaining frames when destroyed
+  this->Pipeline.reset();
 }
 
 //-----------------------------------------------------------------------------
@@ -759,16 +1649,29 @@ int vtkSlam::FillInputPortInformation(int port, vtkInformation *info)
   if ( port == 0 )
   {
     info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkPolyData" );
+    info->Set(vtkAlgorithm::INPUT_IS_REPEATABLE(), 1);
     return 1;
   }
   if ( port == 1 )
   {
     info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkTable" );
+    info->Set(vtkAlgorithm::INPUT_IS_REPEATABLE(), 1);
     return 1;
   }
   return 0;
 }
 
+//-----------------------------------------------------------------------------
+int vtkSlam::FillOutputPortInformation(int port, vtkInformation *info)
+{
+  if ( port == 5 )
+  {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkTable" );
+    return 1;
+  }
+  return this->Superclass::FillOutputPortInformation(port, info);
+}
+
 //-----------------------------------------------------------------------------
 void vtkSlam::GetWorldTransform(double* Tworld)
 {
@@ -794,55 +1697,74 @@ void vtkSlam::GetWorldTransform(double* Tworld)
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::PrepareDataForNextFrame()
+void vtkSlam::PrepareDataForNextFrame(ExtractedFrame& frame)
 {
-  // Reset the pcl format pointcloud to store the new frame
-  this->pclCurrentFrame.reset(new pcl::PointCloud<Point>());
-  this->pclCurrentFrameByScan.resize(this->NLasers);
-  for (unsigned int k = 0; k < this->NLasers; ++k)
+  // The pcl format pointcloud is reused to keep its memory,
+  // all its points are overwritten by the new frame
+  if (!frame.pclCurrentFrame)
+  {
+    frame.pclCurrentFrame.reset(new pcl::PointCloud<Point>());
+  }
+
+  // The keypoints clouds are not cleared since they may still be
+  // the previous ones, released clouds are reused instead
+  frame.CurrentEdgesPoints = this->Scratch.AcquireCloud();
+  frame.CurrentPlanarsPoints = this->Scratch.AcquireCloud();
+  frame.CurrentBlobsPoints = this->Scratch.AcquireCloud();
+
+  // reset vtk <-> pcl id mapping, the points buffers are
+  // cleared without releasing their memory
+  frame.FromVTKtoPCLMapping.clear();
+  frame.FromPCLtoVTKMapping.clear();
+  frame.ScanLineOffsets.assign(this->NLasers + 1, 0);
+  frame.Angles.clear();
+  frame.LengthResolution.clear();
+  frame.SaillantPoint.clear();
+  frame.DepthGap.clear();
+  frame.IntensityGap.clear();
+  frame.BlobScore.clear();
+  frame.IsPointValid.clear();
+  frame.Label.clear();
+}
+
+//-----------------------------------------------------------------------------
+pcl::PointCloud<Point>::Ptr vtkSlam::FrameScratch::AcquireCloud()
+{
+  for (const pcl::PointCloud<Point>::Ptr& cloud : this->KeypointsClouds)
   {
-    this->pclCurrentFrameByScan[k].reset(new pcl::PointCloud<Point>());
-  }
-
-  this->CurrentEdgesPoints.reset(new pcl::PointCloud<Point>());
-  this->CurrentPlanarsPoints.reset(new pcl::PointCloud<Point>());
-  this->CurrentBlobsPoints.reset(new pcl::PointCloud<Point>());
-
-  // reset vtk <-> pcl id mapping
-  this->FromVTKtoPCLMapping.clear();
-  this->FromVTKtoPCLMapping.resize(0);
-  this->FromPCLtoVTKMapping.clear();
-  this->FromPCLtoVTKMapping.resize(this->NLasers);
-  this->Angles.clear();
-  this->Angles.resize(this->NLasers);
-  this->LengthResolution.clear();
-  this->LengthResolution.resize(this->NLasers);
-  this->SaillantPoint.clear();
-  this->SaillantPoint.resize(this->NLasers);
-  this->DepthGap.clear();
-  this->DepthGap.resize(this->NLasers);
-  this->IntensityGap.clear();
-  this->IntensityGap.resize(this->NLasers);
-  this->BlobScore.clear();
-  this->BlobScore.resize(this->NLasers);
-  this->IsPointValid.clear();
-  this->IsPointValid.resize(this->NLasers);
-  this->Label.clear();
-  this->Label.resize(this->NLasers);
+    if (cloud.use_count() == 1)
+    {
+      cloud->clear();
+      return cloud;
+    }
+  }
+  this->KeypointsClouds.emplace_back(new pcl::PointCloud<Point>());
+  return this->KeypointsClouds.back();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::KeypointMatches::Clear()
+{
+  this->Avalues.clear();
+  this->Pvalues.clear();
+  this->Xvalues.clear();
+  this->RadiusIncertitude.clear();
+  this->residualCoefficient.clear();
+  this->TimeValues.clear();
 }
 
 //-----------------------------------------------------------------------------
 template <typename T, typename Tvtk>
-void vtkSlam::AddVectorToPolydataPoints(const std::vector<std::vector<T>>& vec, const char* name, vtkPolyData* pd)
+void vtkSlam::AddVectorToPolydataPoints(const std::vector<T>& vec, const char* name, vtkPolyData* pd)
 {
   vtkSmartPointer<Tvtk> array = vtkSmartPointer<Tvtk>::New();
   array->Allocate(pd->GetNumberOfPoints());
   array->SetName(name);
   for (unsigned int k = 0; k < pd->GetNumberOfPoints(); ++k)
   {
-    unsigned int scan = this->FromVTKtoPCLMapping[k].first;
-    unsigned int index = this->FromVTKtoPCLMapping[k].second;
-    array->InsertNextTuple1(vec[scan][index]);
+    unsigned int scan = this->Frame->FromVTKtoPCLMapping[k].first;
+    unsigned int index = this->Frame->FromVTKtoPCLMapping[k].second;
+    array->InsertNextTuple1(vec[this->Frame->ScanLineOffsets[scan] + index]);
   }
   pd->GetPointData()->AddArray(array);
 }
@@ -871,9 +1793,9 @@ void vtkSlam::DisplayRelAdv(vtkSmartPointer<vtkPolyData> input)
   relAdvArray->SetName("relative_adv");
   for (unsigned int k = 0; k < input->GetNumberOfPoints(); ++k)
   {
-    unsigned int scan = this->FromVTKtoPCLMapping[k].first;
-    unsigned int index = this->FromVTKtoPCLMapping[k].second;
-    relAdvArray->InsertNextTuple1(this->pclCurrentFrameByScan[scan]->points[index].intensity);
+    unsigned int scan = this->Frame->FromVTKtoPCLMapping[k].first;
+    unsigned int index = this->Frame->FromVTKtoPCLMapping[k].second;
+    relAdvArray->InsertNextTuple1(this->Frame->pclCurrentFrame->points[this->Frame->ScanLineOffsets[scan] + index].intensity);
   }
   input->GetPointData()->AddArray(relAdvArray);
 }
@@ -908,21 +1830,23 @@ void vtkSlam::DisplayUsedKeypoints(vtkSmartPointer<vtkPolyData> input)
 
   // fill with 1 if the point is a keypoint
   // fill with 2 if the point is a used keypoint
-  for (unsigned int k = 0; k < this->EdgesIndex.size(); ++k)
+  for (unsigned int k = 0; k < this->Frame->EdgesIndex.size(); ++k)
   {
-    unsigned int scan = this->EdgesIndex[k].first;
-    unsigned int index = this->EdgesIndex[k].second;
+    unsigned int scan = this->Frame->EdgesIndex[k].first;
+    unsigned int index = this->Frame->EdgesIndex[k].second;
+    int vtkIndex = this->Frame->FromPCLtoVTKMapping[this->Frame->ScanLineOffsets[scan] + index];
 
-    edgeUsedEgoMotion->SetTuple1(this->FromPCLtoVTKMapping[scan][index], EdgePointRejectionEgoMotion[k]);
-    edgeUsedMapping->SetTuple1(this->FromPCLtoVTKMapping[scan][index], EdgePointRejectionMapping[k]);
+    edgeUsedEgoMotion->SetTuple1(vtkIndex, this->Frame->EdgePointRejectionEgoMotion[k]);
+    edgeUsedMapping->SetTuple1(vtkIndex, this->Frame->EdgePointRejectionMapping[k]);
   }
-  for (unsigned int k = 0; k < this->PlanarIndex.size(); ++k)
+  for (unsigned int k = 0; k < this->Frame->PlanarIndex.size(); ++k)
   {
-    unsigned int scan = this->PlanarIndex[k].first;
-    unsigned int index = this->PlanarIndex[k].second;
+    unsigned int scan = this->Frame->PlanarIndex[k].first;
+    unsigned int index = this->Frame->PlanarIndex[k].second;
+    int vtkIndex = this->Frame->FromPCLtoVTKMapping[this->Frame->ScanLineOffsets[scan] + index];
 
-    planarUsedEgoMotion->SetTuple1(this->FromPCLtoVTKMapping[scan][index], this->PlanarPointRejectionEgoMotion[k]);
-    planarUsedMapping->SetTuple1(this->FromPCLtoVTKMapping[scan][index], this->PlanarPointRejectionMapping[k]);
+    planarUsedEgoMotion->SetTuple1(vtkIndex, this->Frame->PlanarPointRejectionEgoMotion[k]);
+    planarUsedMapping->SetTuple1(vtkIndex, this->Frame->PlanarPointRejectionMapping[k]);
   }
 
   input->GetPointData()->AddArray(edgeUsedEgoMotion);
@@ -939,7 +1863,6 @@ void vtkSlam::AddFrame(vtkPolyData* newFrame)
     vtkGenericWarningMacro("Slam entry is a null pointer data");
     return;
   }
-  this->vtkCurrentFrame = newFrame;
 
   // Check if the number of lasers has been set
   if (this->NLasers == 0)
@@ -947,90 +1870,284 @@ void vtkSlam::AddFrame(vtkPolyData* newFrame)
     vtkGenericWarningMacro("Frame added without specifying the number of lasers");
   }
 
-  std::cout << "#########################################################" << std::endl
-            << "Processing frame : " << this->NbrFrameProcessed << std:: endl
-            << "#########################################################" << std::endl
-            << std::endl;
-
-  // Reset the members variables used during the last
-  // processed frame so that they can be used again
-  PrepareDataForNextFrame();
-
-  // Update the kalman filter time
-  double time = newFrame->GetPointData()->GetArray("adjustedtime")->GetTuple1(0) * 1e-6;
-
-  // If the new frame is the first one we just add the
-  // extracted keypoints into the map without running
-  // odometry and mapping steps
-  if (this->NbrFrameProcessed == 0)
+  // In pipelined mode the frame is only queued, the input may be
+  // modified by the pipeline before its keypoints are extracted
+  if (this->Pipeline)
   {
-    // Convert the new frame into pcl format and sort
-    // the laser scan-lines by vertical angle
-    this->ConvertAndSortScanLines(newFrame);
-
-    // Compute the edges and planars keypoints
-    this->ComputeKeyPoints(newFrame);
-
-    // update map using tworld
-    this->UpdateMapsUsingTworld();
-
-    // Current keypoints become previous ones
-    this->PreviousEdgesPoints = this->CurrentEdgesPoints;
-    this->PreviousPlanarsPoints = this->CurrentPlanarsPoints;
-    this->PreviousBlobsPoints = this->CurrentBlobsPoints;
-    this->NbrFrameProcessed++;
+    vtkSmartPointer<vtkPolyData> queuedFrame = vtkSmartPointer<vtkPolyData>::New();
+    queuedFrame->ShallowCopy(newFrame);
+    this->Pipeline->Push(queuedFrame);
     return;
   }
 
-  // Convert the new frame into pcl format and sort
-  // the laser scan-lines by vertical angle
-  InitTime();
-  this->ConvertAndSortScanLines(vtkCurrentFrame);
-  StopTimeAndDisplay("Sorting lines");
-
-  // Compute the edges and planars keypoints
-  InitTime();
-  this->ComputeKeyPoints(vtkCurrentFrame);
-  StopTimeAndDisplay("Keypoints extraction");
+  if (!this->Frame)
+  {
+    this->Frame = std::make_shared<ExtractedFrame>();
+  }
+  this->ExtractKeypoints(newFrame, *this->Frame);
+  this->EstimateFrame(this->Frame);
+}
 
-  // Perfom EgoMotion
+//-----------------------------------------------------------------------------
+void vtkSlam::AddFrames(const std::vector<vtkPolyData*>& frames)
+{
+  if (frames.size() != this->NumberOfSensors)
+  {
+    vtkGenericWarningMacro("Got " << frames.size() << " frames for " << this->NumberOfSensors << " sensors");
+    return;
+  }
+  for (vtkPolyData* frame : frames)
+  {
+    if (!frame || frame->GetNumberOfPoints() == 0)
+    {
+      vtkGenericWarningMacro("Slam entry is a null pointer or empty data");
+      return;
+    }
+  }
+  this->AddFrame(frames.size() == 1 ? frames[0] : this->MergeSensorsFrames(frames).GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkSlam::MergeSensorsFrames(const std::vector<vtkPolyData*>& frames)
+{
+  vtkIdType numberOfPoints = 0;
+  for (vtkPolyData* frame : frames)
+  {
+    numberOfPoints += frame->GetNumberOfPoints();
+  }
+
+  // only the arrays used by the slam are kept
+  vtkSmartPointer<vtkPolyData> merged = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToFloat();
+  points->SetNumberOfPoints(numberOfPoints);
+  merged->SetPoints(points.GetPointer());
+  const char* arrayNames[] = { "laser_id", "timestamp", "adjustedtime", "intensity" };
+  vtkDoubleArray* arrays[4];
+  for (int k = 0; k < 4; ++k)
+  {
+    vtkNew<vtkDoubleArray> array;
+    array->SetName(arrayNames[k]);
+    array->SetNumberOfValues(numberOfPoints);
+    merged->GetPointData()->AddArray(array.GetPointer());
+    arrays[k] = array.GetPointer();
+  }
+  vtkNew<vtkUnsignedCharArray> sensorArray;
+  sensorArray->SetName("sensor");
+  sensorArray->SetNumberOfValues(numberOfPoints);
+  merged->GetPointData()->AddArray(sensorArray.GetPointer());
+
+  vtkIdType mergedIndex = 0;
+  unsigned int laserOffset = 0;
+  for (unsigned int sensor = 0; sensor < frames.size(); ++sensor)
+  {
+    vtkPolyData* frame = frames[sensor];
+    const Eigen::Isometry3d pose = this->GetSensorPose(sensor);
+    vtkDataArray* inputArrays[4];
+    for (int k = 0; k < 4; ++k)
+    {
+      inputArrays[k] = frame->GetPointData()->GetArray(arrayNames[k]);
+    }
+    double x[3];
+    for (vtkIdType index = 0; index < frame->GetNumberOfPoints(); ++index, ++mergedIndex)
+    {
+      frame->GetPoint(index, x);
+      const Eigen::Vector3d X = pose * Eigen::Vector3d(x[0], x[1], x[2]);
+      points->SetPoint(mergedIndex, X.data());
+      arrays[0]->SetValue(mergedIndex, inputArrays[0]->GetTuple1(index) + laserOffset);
+      for (int k = 1; k < 4; ++k)
+      {
+        arrays[k]->SetValue(mergedIndex, inputArrays[k] ? inputArrays[k]->GetTuple1(index) : 0.0);
+      }
+      sensorArray->SetValue(mergedIndex, sensor);
+    }
+    laserOffset += std::count(this->ScanLineSensor.begin(), this->ScanLineSensor.end(), sensor);
+  }
+
+  vtkNew<vtkCellArray> vertices;
+  for (vtkIdType index = 0; index < numberOfPoints; ++index)
+  {
+    vertices->InsertNextCell(1, &index);
+  }
+  merged->SetVerts(vertices.GetPointer());
+  return merged;
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Isometry3d vtkSlam::GetSensorPose(unsigned int sensor) const
+{
+  Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+  if (sensor < this->SensorExtrinsics.size())
+  {
+    const std::array<double, 6>& extrinsic = this->SensorExtrinsics[sensor];
+    Eigen::Matrix<double, 6, 1> T;
+    T << extrinsic[0], extrinsic[1], extrinsic[2], extrinsic[3], extrinsic[4], extrinsic[5];
+    pose.linear() = GetRotationMatrix(T);
+    pose.translation() = T.tail(3);
+  }
+  return pose;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::ExpressFrameInVehicle(ExtractedFrame& frame)
+{
+  std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d> > poses;
+  for (unsigned int sensor = 0; sensor < this->NumberOfSensors; ++sensor)
+  {
+    poses.push_back(this->GetSensorPose(sensor));
+  }
+  // the scan line of a point gives its sensor
+  auto expressInVehicle = [&](pcl::PointCloud<Point>& cloud) {
+    for (Point& p : cloud.points)
+    {
+      const Eigen::Isometry3d& pose = poses[this->ScanLineSensor[static_cast<unsigned int>(p.normal_y)]];
+      const Eigen::Vector3d X = pose * Eigen::Vector3d(p.x, p.y, p.z);
+      p.x = X(0); p.y = X(1); p.z = X(2);
+    }
+  };
+  expressInVehicle(*frame.pclCurrentFrame);
+  expressInVehicle(*frame.CurrentEdgesPoints);
+  expressInVehicle(*frame.CurrentPlanarsPoints);
+  expressInVehicle(*frame.CurrentBlobsPoints);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::ExtractKeypoints(vtkSmartPointer<vtkPolyData> newFrame, ExtractedFrame& frame)
+{
+  // The sampling of this frame is the one adapted to the previous ones
+  frame.KeypointsSamplingStep = this->IsRealTime() ? this->KeypointsSamplingStep.load() : 1;
+  frame.SkipBlobs = this->IsRealTime() && this->LastFrameOverBudget;
+
+  // Reset the members variables used during the last
+  // processed frame so that they can be used again
+  frame.vtkCurrentFrame = newFrame;
+  this->PrepareDataForNextFrame(frame);
+
+  // Update the kalman filter time
+  frame.Time = newFrame->GetPointData()->GetArray("adjustedtime")->GetTuple1(0) * 1e-6;
+
+  // Convert the new frame into pcl format and sort
+  // the laser scan-lines by vertical angle
+  InitTime();
+  this->ConvertAndSortScanLines(newFrame, frame);
+  frame.KeypointsTime = StopTime();
+
+  // Compute the edges and planars keypoints, in the referential of
+  // their sensor, which are then expressed in the vehicle one
+  InitTime();
+  this->ComputeKeyPoints(frame);
+  if (this->NumberOfSensors > 1)
+  {
+    this->ExpressFrameInVehicle(frame);
+  }
+  frame.KeypointsTime += StopTime();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::EstimateFrame(const std::shared_ptr<ExtractedFrame>& frame)
+{
+  VV_TRACE_SCOPE("vtkSlam::EstimateFrame");
+  // The time budget of the frame only counts its processing, and not
+  // the time it waited for in the pipeline once extracted
+  this->Frame = frame;
+  this->Profile = FrameProfile();
+  this->FrameStartTime = std::chrono::steady_clock::now()
+    - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(frame->KeypointsTime));
+
+  // If the new frame is the first one we just add the
+  // extracted keypoints into the map without running
+  // odometry and mapping steps
+  if (this->NbrFrameProcessed == 0)
+  {
+    // update map using tworld, a frame located with an initial
+    // map is not added to it since its pose is only a guess
+    this->OpenMapFiles();
+    if (this->InitialMapFile)
+    {
+      this->EdgesPointsLocalMap->Roll(this->Tworld);
+      this->PlanarPointsLocalMap->Roll(this->Tworld);
+      this->BlobsPointsLocalMap->Roll(this->Tworld);
+      this->UpdateMapsMemory();
+    }
+    else
+    {
+      this->UpdateMapsUsingTworld();
+    }
+
+    // Current keypoints become previous ones
+    this->PreviousEdgesPoints = frame->CurrentEdgesPoints;
+    this->PreviousPlanarsPoints = frame->CurrentPlanarsPoints;
+    this->PreviousBlobsPoints = frame->CurrentBlobsPoints;
+    this->PreviousFrameTime = frame->Time;
+    this->PreviousFrameDuration = 0.0;
+    if (this->StreamFrameResults)
+    {
+      this->StreamFrameResult(*frame);
+    }
+    this->NbrFrameProcessed++;
+    return;
+  }
+
+  // Perfom EgoMotion
   InitTime();
   this->ComputeEgoMotion();
-  StopTimeAndDisplay("Ego-Motion");
+  const double egoMotionTime = StopTime();
+  this->Profile.EgoMotionTime = egoMotionTime;
 
   // Transform the current keypoints to the
   // referential of the sensor at the end of
   // frame acquisition
-  InitTime();
   //this->TransformCurrentKeypointsToEnd();
-  StopTimeAndDisplay("Undistortion");
 
   // Perform Mapping
   InitTime();
   this->Mapping();
-  StopTimeAndDisplay("Mapping");
+  const double mappingTime = StopTime();
+  this->Profile.MappingTime = mappingTime;
 
   // Current keypoints become previous ones
-  this->PreviousEdgesPoints = this->CurrentEdgesPoints;
-  this->PreviousPlanarsPoints = this->CurrentPlanarsPoints;
+  this->PreviousEdgesPoints = frame->CurrentEdgesPoints;
+  this->PreviousPlanarsPoints = frame->CurrentPlanarsPoints;
+  this->PreviousFrameDuration = frame->Time - this->PreviousFrameTime;
+  this->PreviousFrameTime = frame->Time;
   this->NbrFrameProcessed++;
 
-  // Motion and localization parameters estimation information display
-  Eigen::Vector3d angles, trans;
-  angles << Rad2Deg(this->Trelative(0)), Rad2Deg(this->Trelative(1)), Rad2Deg(this->Trelative(2));
-  trans << this->Trelative(3), this->Trelative(4), this->Trelative(5);
-  std::cout << "Ego-Motion estimation: angles = [" << angles.transpose() << "] translation: [" << trans.transpose() << "]" << std::endl;
-  angles << Rad2Deg(this->Tworld(0)), Rad2Deg(this->Tworld(1)), Rad2Deg(this->Tworld(2));
-  trans << this->Tworld(3), this->Tworld(4), this->Tworld(5);
-  std::cout << "Localiazion estimation: angles = [" << angles.transpose() << "] translation: [" << trans.transpose() << "]"
-            << std::endl << std::endl << std::endl;
-
-  // Update Trajectory
-  Eigen::AngleAxisd orientation = Eigen::AngleAxisd(
-      Eigen::AngleAxisd(this->Tworld[0], Eigen::Vector3d::UnitX())
-      * Eigen::AngleAxisd(this->Tworld[1],  Eigen::Vector3d::UnitY())
-      * Eigen::AngleAxisd(this->Tworld[2], Eigen::Vector3d::UnitZ()));
-  this->Trajectory->PushBack(time, orientation, Tworld.tail(3));
+  // Update Trajectory, corrected by the last loop closure
+  Eigen::AngleAxisd orientation = Eigen::AngleAxisd(GetTrajectoryRotation(this->Tworld));
+  Eigen::Vector3d position = this->Tworld.tail(3);
+  if (this->LoopClosure)
+  {
+    this->OdometryPoses.push_back(this->Tworld);
+    orientation = Eigen::AngleAxisd(this->LoopClosureCorrection.linear() * orientation.toRotationMatrix());
+    position = this->LoopClosureCorrection * position;
+  }
+  this->Trajectory->PushBack(frame->Time, orientation, position);
+
+  // Report the time spent on each stage and adapt the real-time sampling
+  const double frameTime = this->GetFrameElapsedTime();
+  vtkPointData* trajectoryData = this->Trajectory->GetPointData();
+  static_cast<vtkDoubleArray*>(trajectoryData->GetArray("Time: keypoints extraction"))->InsertNextValue(frame->KeypointsTime);
+  static_cast<vtkDoubleArray*>(trajectoryData->GetArray("Time: ego-motion"))->InsertNextValue(egoMotionTime);
+  static_cast<vtkDoubleArray*>(trajectoryData->GetArray("Time: mapping"))->InsertNextValue(mappingTime);
+  static_cast<vtkDoubleArray*>(trajectoryData->GetArray("Time: frame"))->InsertNextValue(frameTime);
+  static_cast<vtkIntArray*>(trajectoryData->GetArray("Real-time: keypoints sampling step"))->InsertNextValue(frame->KeypointsSamplingStep);
+  if (this->Profiling)
+  {
+    this->AppendFrameProfile(frameTime);
+  }
+  this->UpdateRealTimeSampling(frameTime);
+
+  // The pose graph runs on its own thread, and is not part of the frame time
+  if (this->LoopClosure)
+  {
+    this->UpdatePoseGraph();
+  }
+
+  // The results are written or sent outside of the frame time too
+  if (this->StreamFrameResults)
+  {
+    this->StreamFrameResult(*frame);
+  }
 
   // Indicate the filter has been modify
   this->Modified();
@@ -1038,232 +2155,379 @@ void vtkSlam::AddFrame(vtkPolyData* newFrame)
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::ConvertAndSortScanLines(vtkSmartPointer<vtkPolyData> input)
+void vtkSlam::StreamFrameResult(const ExtractedFrame& frame)
 {
-  // temp var
-  double xL[3]; // in {L}
-  Point yL; // in {L}
+  FrameResult result;
+  result.Index = this->NbrFrameProcessed;
+  result.Time = frame.Time;
+  std::copy(this->Tworld.data(), this->Tworld.data() + 6, result.Pose);
+
+  // The points are expressed in world coordinates as when they
+  // are added to the maps, undistorted if it is enabled
+  if (this->Undistortion)
+  {
+    this->InitUndistortionMapping();
+  }
+
+  // keypoints
+  const pcl::PointCloud<Point>::Ptr keypoints[3] = { frame.CurrentEdgesPoints, frame.CurrentPlanarsPoints,
+                                                     frame.CurrentBlobsPoints };
+  vtkNew<vtkPoints> keypointsPoints;
+  vtkNew<vtkUnsignedCharArray> keypointsType;
+  keypointsType->SetName("keypoint_type");
+  for (unsigned char type = 0; type < 3; ++type)
+  {
+    if (!keypoints[type])
+    {
+      continue;
+    }
+    pcl::PointCloud<Point> worldKeypoints(*keypoints[type]);
+    this->TransformToWorld(worldKeypoints);
+    for (const Point& p : worldKeypoints)
+    {
+      keypointsPoints->InsertNextPoint(p.x, p.y, p.z);
+      keypointsType->InsertNextValue(type);
+    }
+  }
+  result.Keypoints = vtkSmartPointer<vtkPolyData>::New();
+  result.Keypoints->SetPoints(keypointsPoints.GetPointer());
+  result.Keypoints->GetPointData()->AddArray(keypointsType.GetPointer());
+
+  // undistorted frame, in the order of the input frame with its arrays
+  if (this->StreamUndistortedFrames)
+  {
+    pcl::PointCloud<Point> cloud(*frame.pclCurrentFrame);
+    this->TransformToWorld(cloud);
+    vtkNew<vtkPoints> framePoints;
+    framePoints->SetNumberOfPoints(cloud.size());
+    for (size_t index = 0; index < cloud.size(); ++index)
+    {
+      framePoints->SetPoint(frame.FromPCLtoVTKMapping[index], cloud[index].x, cloud[index].y, cloud[index].z);
+    }
+    result.Frame = vtkSmartPointer<vtkPolyData>::New();
+    result.Frame->ShallowCopy(frame.vtkCurrentFrame);
+    result.Frame->SetPoints(framePoints.GetPointer());
+  }
 
+  this->FrameEstimated(result);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::ConvertAndSortScanLines(vtkSmartPointer<vtkPolyData> input, ExtractedFrame& frame)
+{
+  VV_TRACE_SCOPE("vtkSlam::ConvertAndSortScanLines");
   // Get informations about input pointcloud
   vtkDataArray* lasersId = input->GetPointData()->GetArray("laser_id");
   vtkDataArray* time = input->GetPointData()->GetArray("timestamp");
   vtkDataArray* reflectivity = input->GetPointData()->GetArray("intensity");
   vtkPoints* Points = input->GetPoints();
+  // the points coordinates are usually floats, they are then read without
+  // being converted to doubles and back
+  vtkFloatArray* floatPoints = vtkFloatArray::SafeDownCast(Points->GetData());
+  const float* xyz = floatPoints ? floatPoints->GetPointer(0) : nullptr;
   unsigned int Npts = input->GetNumberOfPoints();
-  double t0 = static_cast<double>(time->GetTuple1(0));
-  double t1 = static_cast<double>(time->GetTuple1(Npts - 1));
-  this->FromVTKtoPCLMapping.resize(Npts);
-
-
-  for (unsigned int index = 0; index < Npts; ++index)
+  double t0 = time->GetComponent(0, 0);
+  double t1 = time->GetComponent(Npts - 1, 0);
+
+  // Get the scan line of each point and its position into it,
+  // the points of a scan line are stored after the previous ones
+  frame.FromVTKtoPCLMapping.resize(Npts);
+  frame.FromPCLtoVTKMapping.resize(Npts);
+  vtkIntArray* laserOffsets = nullptr;
+  vtkIntArray* laserPoints = nullptr;
+  // the laser ids of the merged frames of several sensors are not the ones of the interpreter
+  if (this->NumberOfSensors == 1 && ScanLineIndex::Get(input, laserOffsets, laserPoints) &&
+    static_cast<size_t>(laserOffsets->GetNumberOfValues()) <= this->LaserIdMapping.size() + 1)
   {
-    // Get information about current point
-    Points->GetPoint(index, xL);
-    yL.x = xL[0]; yL.y = xL[1]; yL.z = xL[2];
-
-    double relAdv = (static_cast<double>(time->GetTuple1(index)) - t0) / (t1 - t0);
-    unsigned int id = static_cast<int>(lasersId->GetTuple1(index));
-    double reflec = static_cast<double>(reflectivity->GetTuple1(index));
-    id = this->LaserIdMapping[id];
-    yL.intensity = relAdv;
-    yL.normal_y = id;
-    yL.normal_z = reflec;
+    // the interpreter has already grouped the points by laser, in firing order
+    const int* offsets = laserOffsets->GetPointer(0);
+    const int numberOfLasers = static_cast<int>(laserOffsets->GetNumberOfValues()) - 1;
+    for (int laser = 0; laser < numberOfLasers; ++laser)
+    {
+      frame.ScanLineOffsets[this->LaserIdMapping[laser] + 1] = offsets[laser + 1] - offsets[laser];
+    }
+    std::partial_sum(frame.ScanLineOffsets.begin(), frame.ScanLineOffsets.end(),
+                     frame.ScanLineOffsets.begin());
+    for (int laser = 0; laser < numberOfLasers; ++laser)
+    {
+      const int id = static_cast<int>(this->LaserIdMapping[laser]);
+      for (int k = 0; k < offsets[laser + 1] - offsets[laser]; ++k)
+      {
+        const int index = laserPoints->GetValue(offsets[laser] + k);
+        frame.FromVTKtoPCLMapping[index] = std::pair<int, int>(id, k);
+        frame.FromPCLtoVTKMapping[frame.ScanLineOffsets[id] + k] = index;
+      }
+    }
+  }
+  else
+  {
+    for (unsigned int index = 0; index < Npts; ++index)
+    {
+      unsigned int id = static_cast<int>(lasersId->GetComponent(index, 0));
+      id = this->LaserIdMapping[id];
+      frame.FromVTKtoPCLMapping[index] = std::pair<int, int>(id, frame.ScanLineOffsets[id + 1]++);
+    }
+    std::partial_sum(frame.ScanLineOffsets.begin(), frame.ScanLineOffsets.end(),
+                     frame.ScanLineOffsets.begin());
+    for (unsigned int index = 0; index < Npts; ++index)
+    {
+      const std::pair<int, int>& pclIndex = frame.FromVTKtoPCLMapping[index];
+      frame.FromPCLtoVTKMapping[frame.ScanLineOffsets[pclIndex.first] + pclIndex.second] = index;
+    }
+  }
 
-    // add the current point to its corresponding laser scan
-    this->pclCurrentFrame->push_back(yL);
-    this->pclCurrentFrameByScan[id]->push_back(yL);
-    this->FromVTKtoPCLMapping[index] = std::pair<int, int>(id, this->pclCurrentFrameByScan[id]->size() - 1);
-    this->FromPCLtoVTKMapping[id].push_back(index);
+  // Fill the scan lines, which are contiguous in the sorted cloud. The
+  // threads only read the input arrays with GetComponent and GetPoint
+  // that do not use their internal tuple
+  // The merged frames of several sensors are in the vehicle referential,
+  // their points are expressed back in the referential of their sensor
+  std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d> > vehicleToSensors;
+  for (unsigned int sensor = 0; this->NumberOfSensors > 1 && sensor < this->NumberOfSensors; ++sensor)
+  {
+    vehicleToSensors.push_back(this->GetSensorPose(sensor).inverse());
   }
+
+  frame.pclCurrentFrame->resize(Npts);
+  this->ForEachScanLine([&](unsigned int scanLine) {
+    // temp var
+    double xL[3]; // in {L}
+    Point* scan = frame.pclCurrentFrame->points.data() + frame.ScanLineOffsets[scanLine];
+    const size_t scanSize = frame.ScanLineOffsets[scanLine + 1] - frame.ScanLineOffsets[scanLine];
+    const int* vtkIndices = frame.FromPCLtoVTKMapping.data() + frame.ScanLineOffsets[scanLine];
+    for (size_t k = 0; k < scanSize; ++k)
+    {
+      // Get information about current point, in {L}
+      const int index = vtkIndices[k];
+      Point& yL = scan[k];
+      if (xyz)
+      {
+        yL.x = xyz[3 * index]; yL.y = xyz[3 * index + 1]; yL.z = xyz[3 * index + 2];
+      }
+      else
+      {
+        Points->GetPoint(index, xL);
+        yL.x = xL[0]; yL.y = xL[1]; yL.z = xL[2];
+      }
+      if (!vehicleToSensors.empty())
+      {
+        const Eigen::Vector3d X = vehicleToSensors[this->ScanLineSensor[scanLine]] * Eigen::Vector3d(yL.x, yL.y, yL.z);
+        yL.x = X(0); yL.y = X(1); yL.z = X(2);
+      }
+      yL.intensity = (time->GetComponent(index, 0) - t0) / (t1 - t0);
+      yL.normal_y = scanLine;
+      yL.normal_z = reflectivity->GetComponent(index, 0);
+    }
+  });
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::ComputeKeyPoints(vtkSmartPointer<vtkPolyData> input)
+void vtkSlam::ComputeKeyPoints(ExtractedFrame& frame)
 {
+  VV_TRACE_SCOPE("vtkSlam::ComputeKeyPoints");
   // Initialize the vectors with the correct length
-  for (unsigned int k = 0; k < this->NLasers; ++k)
-  {
-    this->IsPointValid[k].resize(this->pclCurrentFrameByScan[k]->size(), 1);
-    this->Label[k].resize(this->pclCurrentFrameByScan[k]->size(), 0);
-    this->Angles[k].resize(this->pclCurrentFrameByScan[k]->size(),0);
-    this->LengthResolution[k].resize(this->pclCurrentFrameByScan[k]->size(),0);
-    this->SaillantPoint[k].resize(this->pclCurrentFrameByScan[k]->size(),0);
-    this->DepthGap[k].resize(this->pclCurrentFrameByScan[k]->size(), 0);
-    this->IntensityGap[k].resize(this->pclCurrentFrameByScan[k]->size(), 0);
-    this->BlobScore[k].resize(this->pclCurrentFrameByScan[k]->size(), 0);
-  }
+  const size_t Npts = frame.pclCurrentFrame->size();
+  frame.IsPointValid.resize(Npts, 1);
+  frame.Label.resize(Npts, 0);
+  frame.Angles.resize(Npts, 0);
+  frame.LengthResolution.resize(Npts, 0);
+  frame.SaillantPoint.resize(Npts, 0);
+  frame.DepthGap.resize(Npts, 0);
+  frame.IntensityGap.resize(Npts, 0);
+  frame.BlobScore.resize(Npts, 0);
+  frame.IsPointValidForPlanar.resize(Npts);
+  frame.SortedAnglesIndices.resize(Npts);
+  frame.SortedIndices.resize(Npts);
 
   // compute keypoints scores
-  this->ComputeCurvature(input);
+  this->ComputeCurvature(frame);
 
   // Invalid points with bad criteria
-  this->InvalidPointWithBadCriteria();
+  this->InvalidPointWithBadCriteria(frame);
 
   // labelize keypoints
-  this->SetKeyPointsLabels(input);
+  this->SetKeyPointsLabels(frame);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::ComputeCurvature(ExtractedFrame& frame)
+{
+  this->ForEachScanLine([&](unsigned int scanLine) { this->ComputeScanLineCurvature(frame, scanLine); });
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::ComputeCurvature(vtkSmartPointer<vtkPolyData> vtkNotUsed(input))
+void vtkSlam::ComputeScanLineCurvature(ExtractedFrame& frame, unsigned int scanLine)
 {
   Point currentPoint, nextPoint, previousPoint;
   Eigen::Vector3d X, centralPoint;
   LineFitting leftLine, rightLine, farNeighborsLine;
+  std::vector<Eigen::Vector3d > leftNeighbor;
+  std::vector<Eigen::Vector3d > rightNeighbor;
+  std::vector<Eigen::Vector3d > farNeighbors;
 
-  // loop over scans lines
-  for (unsigned int scanLine = 0; scanLine < this->NLasers; ++scanLine)
+  // loop over points in the current scan line
+  const Point* linePoints = frame.pclCurrentFrame->points.data() + frame.ScanLineOffsets[scanLine];
+  int Npts = frame.ScanLineOffsets[scanLine + 1] - frame.ScanLineOffsets[scanLine];
+
+  // if the line is almost empty, skip it
+  if (Npts < 2 * this->NeighborWidth + 1)
   {
-    // loop over points in the current scan line
-    int Npts = this->pclCurrentFrameByScan[scanLine]->size();
+    return;
+  }
 
-    // if the line is almost empty, skip it
-    if (Npts < 2 * this->NeighborWidth + 1)
+  const size_t offset = frame.ScanLineOffsets[scanLine];
+  double* lineAngles = frame.Angles.data() + offset;
+  double* lineSaillantPoint = frame.SaillantPoint.data() + offset;
+  double* lineDepthGap = frame.DepthGap.data() + offset;
+  double* lineIntensityGap = frame.IntensityGap.data() + offset;
+  double* lineBlobScore = frame.BlobScore.data() + offset;
+
+  for (int index = this->NeighborWidth; (index + this->NeighborWidth) < Npts; ++index)
+  {
+    // central point
+    currentPoint = linePoints[index];
+    centralPoint << currentPoint.x, currentPoint.y, currentPoint.z;
+
+    // compute intensity gap
+    nextPoint = linePoints[index + 1];
+    previousPoint = linePoints[index - 1];
+    lineIntensityGap[index] = std::abs(nextPoint.normal_z - previousPoint.normal_z);
+    // We will compute the line that fit the neighbors located
+    // previously the current. We will do the same for the
+    // neighbors located after the current points. We will then
+    // compute the angle between these two lines as an approximation
+    // of the "sharpness" of the current point.
+    leftNeighbor.clear();
+    rightNeighbor.clear();
+    farNeighbors.clear();
+
+    // Fill right and left neighborhood
+    // /!\ The way the neighbors are added
+    // to the vectors matters. Especially when
+    // computing the saillancy
+    for (int j = index - this->NeighborWidth; j <= index + this->NeighborWidth; ++j)
     {
-      continue;
+      currentPoint = linePoints[j];
+      X << currentPoint.x, currentPoint.y, currentPoint.z;
+      if (j < index)
+        leftNeighbor.push_back(X);
+      if (j > index)
+        rightNeighbor.push_back(X);
     }
 
-    for (int index = this->NeighborWidth; (index + this->NeighborWidth) < Npts; ++index)
-    {
-      // central point
-      currentPoint = this->pclCurrentFrameByScan[scanLine]->points[index];
-      centralPoint << currentPoint.x, currentPoint.y, currentPoint.z;
-
-      // compute intensity gap
-      nextPoint = this->pclCurrentFrameByScan[scanLine]->points[index + 1];
-      previousPoint = this->pclCurrentFrameByScan[scanLine]->points[index - 1];
-      this->IntensityGap[scanLine][index] = std::abs(nextPoint.normal_z - previousPoint.normal_z);
-      // We will compute the line that fit the neighbors located
-      // previously the current. We will do the same for the
-      // neighbors located after the current points. We will then
-      // compute the angle between these two lines as an approximation
-      // of the "sharpness" of the current point.
-      std::vector<Eigen::Vector3d > leftNeighbor;
-      std::vector<Eigen::Vector3d > rightNeighbor;
-      std::vector<Eigen::Vector3d > farNeighbors;
-
-      // Fill right and left neighborhood
-      // /!\ The way the neighbors are added
-      // to the vectors matters. Especially when
-      // computing the saillancy
-      for (int j = index - this->NeighborWidth; j <= index + this->NeighborWidth; ++j)
-      {
-        currentPoint = this->pclCurrentFrameByScan[scanLine]->points[j];
-        X << currentPoint.x, currentPoint.y, currentPoint.z;
-        if (j < index)
-          leftNeighbor.push_back(X);
-        if (j > index)
-          rightNeighbor.push_back(X);
-      }
+    // Fit line on the neighborhood and
+    // Indicate if the left and right side
+    // neighborhood of the current point is flat or not
+    bool leftFlat = leftLine.FitPCAAndCheckConsistency(leftNeighbor);
+    bool rightFlat = rightLine.FitPCAAndCheckConsistency(rightNeighbor);
 
-      // Fit line on the neighborhood and
-      // Indicate if the left and right side
-      // neighborhood of the current point is flat or not
-      bool leftFlat = leftLine.FitPCAAndCheckConsistency(leftNeighbor);
-      bool rightFlat = rightLine.FitPCAAndCheckConsistency(rightNeighbor);
+    // Measurement of the gap
+    double dist1 = 0; double dist2 = 0;
 
-      // Measurement of the gap
-      double dist1 = 0; double dist2 = 0;
-
-      // if both neighborhood are flat we can compute
-      // the angle between them as an approximation of the
-      // sharpness of the current point
-      if (rightFlat && leftFlat)
+    // if both neighborhood are flat we can compute
+    // the angle between them as an approximation of the
+    // sharpness of the current point
+    if (rightFlat && leftFlat)
+    {
+      // We check that the current point is not too far from its
+      // neighborhood lines. This is because we don't want a point
+      // to be considered as a angles point if it is due to gap
+      dist1 = std::sqrt((centralPoint - leftLine.Position).transpose() * leftLine.SemiDist * (centralPoint - leftLine.Position));
+      dist2 = std::sqrt((centralPoint - rightLine.Position).transpose() * rightLine.SemiDist * (centralPoint - rightLine.Position));
+
+      if ((dist1 < this->DistToLineThreshold) && (dist2 < this->DistToLineThreshold))
+        lineAngles[index] = std::abs((leftLine.Direction.cross(rightLine.Direction)).norm()); // sin of angle actually
+    }
+    // Here one side of the neighborhood is non flat
+    // Hence it is not worth to estimate the sharpness.
+    // Only the gap will be considered here.
+    else if (rightFlat && !leftFlat)
+    {
+      dist1 = 1000.0;
+      for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
       {
-        // We check that the current point is not too far from its
-        // neighborhood lines. This is because we don't want a point
-        // to be considered as a angles point if it is due to gap
-        dist1 = std::sqrt((centralPoint - leftLine.Position).transpose() * leftLine.SemiDist * (centralPoint - leftLine.Position));
-        dist2 = std::sqrt((centralPoint - rightLine.Position).transpose() * rightLine.SemiDist * (centralPoint - rightLine.Position));
-
-        if ((dist1 < this->DistToLineThreshold) && (dist2 < this->DistToLineThreshold))
-          this->Angles[scanLine][index] = std::abs((leftLine.Direction.cross(rightLine.Direction)).norm()); // sin of angle actually
+        dist1 = std::min(dist1,
+                std::sqrt((leftNeighbor[neighIndex] - rightLine.Position).transpose() * rightLine.SemiDist * (leftNeighbor[neighIndex] - rightLine.Position)));
       }
-      // Here one side of the neighborhood is non flat
-      // Hence it is not worth to estimate the sharpness.
-      // Only the gap will be considered here.
-      else if (rightFlat && !leftFlat)
+      dist1 = 0.5 * dist1;
+    }
+    else if (!rightFlat && leftFlat)
+    {
+      dist2 = 1000.0;
+      for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
       {
-        dist1 = 1000.0;
-        for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
-        {
-          dist1 = std::min(dist1,
-                  std::sqrt((leftNeighbor[neighIndex] - rightLine.Position).transpose() * rightLine.SemiDist * (leftNeighbor[neighIndex] - rightLine.Position)));
-        }
-        dist1 = 0.5 * dist1;
+        dist2 = std::min(dist2,
+                std::sqrt((rightNeighbor[neighIndex] - leftLine.Position).transpose() * leftLine.SemiDist * (rightNeighbor[neighIndex] - leftLine.Position)));
       }
-      else if (!rightFlat && leftFlat)
+      dist2 = 0.5 * dist2;
+    }
+    else
+    {
+      // Compute saillant point score
+      double currDepth = centralPoint.norm();
+      unsigned int diffDepth = 0;
+      bool canLeftBeAdded = true; bool hasLeftEncounteredDepthGap = false;
+      bool canRightBeAdded = true; bool hasRightEncounteredDepthGap = false;
+
+      // The saillant point score is the distance between the current point
+      // and the points that have a depth gap with the current point
+      for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
       {
-        dist2 = 1000.0;
-        for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
+        // Left neighborhood depth gap computation
+        if ((std::abs(leftNeighbor[leftNeighbor.size() - 1 - neighIndex].norm() - currDepth) > 1.5) && canLeftBeAdded)
         {
-          dist2 = std::min(dist2,
-                  std::sqrt((rightNeighbor[neighIndex] - leftLine.Position).transpose() * leftLine.SemiDist * (rightNeighbor[neighIndex] - leftLine.Position)));
+          hasLeftEncounteredDepthGap = true;
+          diffDepth++;
+          farNeighbors.push_back(leftNeighbor[neighIndex]);
         }
-        dist2 = 0.5 * dist2;
-      }
-      else
-      {
-        // Compute saillant point score
-        double currDepth = centralPoint.norm();
-        unsigned int diffDepth = 0;
-        bool canLeftBeAdded = true; bool hasLeftEncounteredDepthGap = false;
-        bool canRightBeAdded = true; bool hasRightEncounteredDepthGap = false;
-
-        // The saillant point score is the distance between the current point
-        // and the points that have a depth gap with the current point
-        for (unsigned int neighIndex = 0; neighIndex < leftNeighbor.size(); ++neighIndex)
+        else
         {
-          // Left neighborhood depth gap computation
-          if ((std::abs(leftNeighbor[leftNeighbor.size() - 1 - neighIndex].norm() - currDepth) > 1.5) && canLeftBeAdded)
+          if (hasLeftEncounteredDepthGap)
           {
-            hasLeftEncounteredDepthGap = true;
-            diffDepth++;
-            farNeighbors.push_back(leftNeighbor[neighIndex]);
-          }
-          else
-          {
-            if (hasLeftEncounteredDepthGap)
-            {
-              canLeftBeAdded = false;
-            }
-          }
-          // Right neigborhood depth gap computation
-          if ((std::abs(rightNeighbor[neighIndex].norm() - currDepth) > 1.5) && canRightBeAdded)
-          {
-            hasRightEncounteredDepthGap = true;
-            diffDepth++;
-            farNeighbors.push_back(rightNeighbor[neighIndex]);
-          }
-          else
-          {
-            if (hasRightEncounteredDepthGap)
-            {
-              canRightBeAdded = false;
-            }
+            canLeftBeAdded = false;
           }
         }
-
-        // If there is enought neighbors with a big depth gap
-        // we propose to compute the saillancy of the current
-        // as the distance between the line that fits the neighbors
-        // with a depth gap and the current point
-        if (static_cast<double>(diffDepth) / (2.0 * this->NeighborWidth) > 0.5)
+        // Right neigborhood depth gap computation
+        if ((std::abs(rightNeighbor[neighIndex].norm() - currDepth) > 1.5) && canRightBeAdded)
+        {
+          hasRightEncounteredDepthGap = true;
+          diffDepth++;
+          farNeighbors.push_back(rightNeighbor[neighIndex]);
+        }
+        else
         {
-          farNeighborsLine.FitPCA(farNeighbors);
-          this->SaillantPoint[scanLine][index] = std::sqrt(
-            (centralPoint - farNeighborsLine.Position).transpose() * farNeighborsLine.SemiDist * (centralPoint - farNeighborsLine.Position));
+          if (hasRightEncounteredDepthGap)
+          {
+            canRightBeAdded = false;
+          }
         }
+      }
 
-        this->BlobScore[scanLine][index] = 1;
+      // If there is enought neighbors with a big depth gap
+      // we propose to compute the saillancy of the current
+      // as the distance between the line that fits the neighbors
+      // with a depth gap and the current point
+      if (static_cast<double>(diffDepth) / (2.0 * this->NeighborWidth) > 0.5)
+      {
+        farNeighborsLine.FitPCA(farNeighbors);
+        lineSaillantPoint[index] = std::sqrt(
+          (centralPoint - farNeighborsLine.Position).transpose() * farNeighborsLine.SemiDist * (centralPoint - farNeighborsLine.Position));
       }
 
-      this->DepthGap[scanLine][index] = std::max(dist1, dist2);
+      lineBlobScore[index] = 1;
     }
+
+    lineDepthGap[index] = std::max(dist1, dist2);
   }
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::InvalidPointWithBadCriteria()
+void vtkSlam::InvalidPointWithBadCriteria(ExtractedFrame& frame)
+{
+  this->ForEachScanLine([&](unsigned int scanLine) { this->InvalidScanLinePointsWithBadCriteria(frame, scanLine); });
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::InvalidScanLinePointsWithBadCriteria(ExtractedFrame& frame, unsigned int scanLine)
 {
   // Temporary variables used in the next loop
   Eigen::Vector3d dX, X, Xn, Xp, Xproj, dXproj;
@@ -1272,390 +2536,425 @@ void vtkSlam::InvalidPointWithBadCriteria()
   Point currentPoint, nextPoint, previousPoint;
   Point temp;
 
-  // loop over scan lines
-  for (unsigned int scanLine = 0; scanLine < this->NLasers; ++scanLine)
+  const Point* linePoints = frame.pclCurrentFrame->points.data() + frame.ScanLineOffsets[scanLine];
+  int Npts = frame.ScanLineOffsets[scanLine + 1] - frame.ScanLineOffsets[scanLine];
+
+  // if the line is almost empty, skip it
+  if (Npts < 3 * this->NeighborWidth)
   {
-    int Npts = this->pclCurrentFrameByScan[scanLine]->size();
+    return;
+  }
+  int* lineIsPointValid = frame.IsPointValid.data() + frame.ScanLineOffsets[scanLine];
 
-    // if the line is almost empty, skip it
-    if (Npts < 3 * this->NeighborWidth)
-    {
-      continue;
-    }
-    // invalidate first and last points
-    for (int index = 0; index <= this->NeighborWidth; ++index)
-    {
-      this->IsPointValid[scanLine][index] = 0;
-    }
-    for (int index = Npts - 1 - this->NeighborWidth - 1; index < Npts; ++index)
-    {
-      this->IsPointValid[scanLine][index] = 0;
-    }
+  // invalidate first and last points
+  for (int index = 0; index <= this->NeighborWidth; ++index)
+  {
+    lineIsPointValid[index] = 0;
+  }
+  for (int index = Npts - 1 - this->NeighborWidth - 1; index < Npts; ++index)
+  {
+    lineIsPointValid[index] = 0;
+  }
 
-    // loop over points into the scan line
-    for (int index = this->NeighborWidth; index <  Npts - this->NeighborWidth - 1; ++index)
+  // loop over points into the scan line
+  for (int index = this->NeighborWidth; index <  Npts - this->NeighborWidth - 1; ++index)
+  {
+    currentPoint = linePoints[index];
+    nextPoint = linePoints[index + 1];
+    previousPoint = linePoints[index - 1];
+    X << currentPoint.x, currentPoint.y, currentPoint.z;
+    Xn << nextPoint.x, nextPoint.y, nextPoint.z;
+    Xp << previousPoint.x, previousPoint.y, previousPoint.z;
+    dX = Xn - X;
+    L = X.norm();
+    Ln = Xn.norm();
+    dLn = dX.norm();
+
+    // the expected length between two firing of the same laser
+    // depend on the distance and the angular resolution of the
+    // sensor.
+    expectedLength = 2.0 *  std::tan(this->AngleResolution / 2.0) * L;
+    double ratioExpectedLength = 10.0;
+
+    // if the length between the two firing
+    // is more than n-th the expected length
+    // it means that there is a gap. We now must
+    // determine if the gap is due to the geometry of
+    // the scene or if the gap is due to an occluded area
+    if (dLn > ratioExpectedLength * expectedLength)
     {
-      currentPoint = this->pclCurrentFrameByScan[scanLine]->points[index];
-      nextPoint = this->pclCurrentFrameByScan[scanLine]->points[index + 1];
-      previousPoint = this->pclCurrentFrameByScan[scanLine]->points[index - 1];
-      X << currentPoint.x, currentPoint.y, currentPoint.z;
-      Xn << nextPoint.x, nextPoint.y, nextPoint.z;
-      Xp << previousPoint.x, previousPoint.y, previousPoint.z;
-      dX = Xn - X;
-      L = X.norm();
-      Ln = Xn.norm();
-      dLn = dX.norm();
-
-      // the expected length between two firing of the same laser
-      // depend on the distance and the angular resolution of the
-      // sensor.
-      expectedLength = 2.0 *  std::tan(this->AngleResolution / 2.0) * L;
-      double ratioExpectedLength = 10.0;
-
-      // if the length between the two firing
-      // is more than n-th the expected length
-      // it means that there is a gap. We now must
-      // determine if the gap is due to the geometry of
-      // the scene or if the gap is due to an occluded area
-      if (dLn > ratioExpectedLength * expectedLength)
+      // Project the next point onto the
+      // sphere of center 0 and radius =
+      // norm of the current point. If the
+      // gap has disappeared it means that
+      // the gap was due to an occlusion
+      Xproj = L / Ln * Xn;
+      dXproj = Xproj - X;
+      // it is a depth gap, invalidate the part which belong
+      // to the occluded area (farest)
+      // invalid next part
+      if (L < Ln)
       {
-        // Project the next point onto the
-        // sphere of center 0 and radius =
-        // norm of the current point. If the
-        // gap has disappeared it means that
-        // the gap was due to an occlusion
-        Xproj = L / Ln * Xn;
-        dXproj = Xproj - X;
-        // it is a depth gap, invalidate the part which belong
-        // to the occluded area (farest)
-        // invalid next part
-        if (L < Ln)
+        for (int i = index + 1; i <= index + this->NeighborWidth; ++i)
         {
-          for (int i = index + 1; i <= index + this->NeighborWidth; ++i)
+          if (i > index + 1)
           {
-            if (i > index + 1)
+            temp = linePoints[i - 1];
+            Yp << temp.x, temp.y, temp.z;
+            temp = linePoints[i];
+            Y << temp.x, temp.y, temp.z;
+            dY = Y - Yp;
+            // if there is a gap in the neihborhood
+            // we do not invalidate the rest of neihborhood
+            if (dY.norm() > ratioExpectedLength * expectedLength)
             {
-              temp = this->pclCurrentFrameByScan[scanLine]->points[i - 1];
-              Yp << temp.x, temp.y, temp.z;
-              temp = this->pclCurrentFrameByScan[scanLine]->points[i];
-              Y << temp.x, temp.y, temp.z;
-              dY = Y - Yp;
-              // if there is a gap in the neihborhood
-              // we do not invalidate the rest of neihborhood
-              if (dY.norm() > ratioExpectedLength * expectedLength)
-              {
-                break;
-              }
+              break;
             }
-            this->IsPointValid[scanLine][i] = 0;
           }
+          lineIsPointValid[i] = 0;
         }
-        // invalid previous part
-        else
+      }
+      // invalid previous part
+      else
+      {
+        for (int i = index - this->NeighborWidth; i <= index; ++i)
         {
-          for (int i = index - this->NeighborWidth; i <= index; ++i)
+          if (i < index)
           {
-            if (i < index)
+            temp = linePoints[i + 1];
+            Yn << temp.x, temp.y, temp.z;
+            temp = linePoints[i];
+            Y << temp.x, temp.y, temp.z;
+            dY = Yn - Y;
+            // if there is a gap in the neihborhood
+            // we do not invalidate the rest of neihborhood
+            if (dY.norm() > ratioExpectedLength * expectedLength)
             {
-              temp = this->pclCurrentFrameByScan[scanLine]->points[i + 1];
-              Yn << temp.x, temp.y, temp.z;
-              temp = this->pclCurrentFrameByScan[scanLine]->points[i];
-              Y << temp.x, temp.y, temp.z;
-              dY = Yn - Y;
-              // if there is a gap in the neihborhood
-              // we do not invalidate the rest of neihborhood
-              if (dY.norm() > ratioExpectedLength * expectedLength)
-              {
-                break;
-              }
+              break;
             }
-            this->IsPointValid[scanLine][i] = 0;
           }
+          lineIsPointValid[i] = 0;
         }
       }
-      // Invalid points which are too close from the sensor
-      if (L < this->MinDistanceToSensor)
-      {
-        this->IsPointValid[scanLine][index] = 0;
-      }
+    }
+    // Invalid points which are too close from the sensor
+    if (L < this->MinDistanceToSensor)
+    {
+      lineIsPointValid[index] = 0;
+    }
 
-      // Invalid points which are on a planar
-      // surface nearly parallel to the laser
-      // beam direction
-      dLp = (X - Xp).norm();
-      if ((dLp > 1 / 4.0 * ratioExpectedLength * expectedLength) && (dLn > 1 / 4.0 * ratioExpectedLength * expectedLength))
-      {
-        this->IsPointValid[scanLine][index] = 0;
-      }
+    // Invalid points which are on a planar
+    // surface nearly parallel to the laser
+    // beam direction
+    dLp = (X - Xp).norm();
+    if ((dLp > 1 / 4.0 * ratioExpectedLength * expectedLength) && (dLn > 1 / 4.0 * ratioExpectedLength * expectedLength))
+    {
+      lineIsPointValid[index] = 0;
     }
   }
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::SetKeyPointsLabels(vtkSmartPointer<vtkPolyData> vtkNotUsed(input))
+void vtkSlam::SetKeyPointsLabels(ExtractedFrame& frame)
 {
-  this->EdgesIndex.clear(); this->EdgesIndex.resize(0);
-  this->PlanarIndex.clear(); this->PlanarIndex.resize(0);
-  this->BlobIndex.clear(); this->BlobIndex.resize(0);
-
-  // loop over the scan lines
+  // each scan line labels its keypoints in its own lists,
+  // which are then gathered in the scan lines order
+  std::vector<std::vector<std::pair<int, int> > > edges(this->NLasers);
+  std::vector<std::vector<std::pair<int, int> > > planars(this->NLasers);
+  std::vector<std::vector<std::pair<int, int> > > blobs(this->NLasers);
+  this->ForEachScanLine([&](unsigned int scanLine) {
+    this->LabelScanLineKeypoints(frame, scanLine, edges[scanLine], planars[scanLine], blobs[scanLine]);
+  });
+
+  frame.EdgesIndex.clear();
+  frame.PlanarIndex.clear();
+  frame.BlobIndex.clear();
   for (unsigned int scanLine = 0; scanLine < this->NLasers; ++scanLine)
   {
-    int Npts = this->pclCurrentFrameByScan[scanLine]->size();
-    unsigned int nbrEdgePicked = 0;
-    unsigned int nbrPlanarPicked = 0;
+    frame.EdgesIndex.insert(frame.EdgesIndex.end(), edges[scanLine].begin(), edges[scanLine].end());
+    frame.PlanarIndex.insert(frame.PlanarIndex.end(), planars[scanLine].begin(), planars[scanLine].end());
+    frame.BlobIndex.insert(frame.BlobIndex.end(), blobs[scanLine].begin(), blobs[scanLine].end());
+  }
 
-    // We split the validity of points between the edges
-    // keypoints and planar keypoints. This allows to take
-    // some points as planar keypoints even if they are close
-    // to an edge keypoint.
-    std::vector<int> IsPointValidForPlanar = this->IsPointValid[scanLine];
+  // add keypoints in increasing scan id order
+  std::sort(frame.EdgesIndex.begin(), frame.EdgesIndex.end());
+  std::sort(frame.PlanarIndex.begin(), frame.PlanarIndex.end());
+  std::sort(frame.BlobIndex.begin(), frame.BlobIndex.end());
+
+  // In real-time mode, keep one out of KeypointsSamplingStep keypoints
+  // spread over the scan lines and no blob after a frame over budget,
+  // these were chosen when the extraction started
+  SubsampleKeypoints(frame.EdgesIndex, frame.KeypointsSamplingStep);
+  SubsampleKeypoints(frame.PlanarIndex, frame.KeypointsSamplingStep);
+  SubsampleKeypoints(frame.BlobIndex, frame.KeypointsSamplingStep);
+  if (frame.SkipBlobs)
+  {
+    frame.BlobIndex.clear();
+  }
 
-    // if the line is almost empty, skip it
-    if (Npts < 3 * this->NeighborWidth)
-    {
-      continue;
-    }
+  // fill the keypoints vectors and compute the max dist keypoints
+  frame.FarestKeypointDist = 0.0;
+  Point p;
+  for (unsigned int k = 0; k < frame.EdgesIndex.size(); ++k)
+  {
+    p = frame.pclCurrentFrame->points[frame.ScanLineOffsets[frame.EdgesIndex[k].first] + frame.EdgesIndex[k].second];
+    frame.CurrentEdgesPoints->push_back(p);
+    frame.FarestKeypointDist = std::max(frame.FarestKeypointDist, static_cast<double>(std::sqrt(std::pow(p.x, 2) + std::pow(p.y, 2) + std::pow(p.z, 2))));
+  }
+  for (unsigned int k = 0; k < frame.PlanarIndex.size(); ++k)
+  {
+    p = frame.pclCurrentFrame->points[frame.ScanLineOffsets[frame.PlanarIndex[k].first] + frame.PlanarIndex[k].second];
+    frame.CurrentPlanarsPoints->push_back(p);
+    frame.FarestKeypointDist = std::max(frame.FarestKeypointDist, static_cast<double>(std::sqrt(std::pow(p.x, 2) + std::pow(p.y, 2) + std::pow(p.z, 2))));
+  }
+  for (unsigned int k = 0; k < frame.BlobIndex.size();  ++k)
+  {
+    p = frame.pclCurrentFrame->points[frame.ScanLineOffsets[frame.BlobIndex[k].first] + frame.BlobIndex[k].second];
+    frame.CurrentBlobsPoints->push_back(p);
+    frame.FarestKeypointDist = std::max(frame.FarestKeypointDist, static_cast<double>(std::sqrt(std::pow(p.x, 2) + std::pow(p.y, 2) + std::pow(p.z, 2))));
+  }
 
-    // Sort the curvature score in a decreasing order
-    std::vector<size_t> sortedDepthGapIdx = sortIdx<double>(this->DepthGap[scanLine]);
-    std::vector<size_t> sortedAnglesIdx = sortIdx<double>(this->Angles[scanLine]);
-    std::vector<size_t> sortedSaillancyIdx = sortIdx<double>(this->SaillantPoint[scanLine]);
-    std::vector<size_t> sortedIntensityGap = sortIdx<double>(this->IntensityGap[scanLine]);
+  // Initialize the IsKeypointUsed vectors
+  frame.EdgePointRejectionEgoMotion.clear(); frame.EdgePointRejectionEgoMotion.resize(frame.CurrentEdgesPoints->size());
+  frame.PlanarPointRejectionEgoMotion.clear(); frame.PlanarPointRejectionEgoMotion.resize(frame.CurrentPlanarsPoints->size());
+  frame.EdgePointRejectionMapping.clear(); frame.EdgePointRejectionMapping.resize(frame.CurrentEdgesPoints->size());
+  frame.PlanarPointRejectionMapping.clear(); frame.PlanarPointRejectionMapping.resize(frame.CurrentPlanarsPoints->size());
+}
 
-    double depthGap, sinAngle, saillancy, intensity;
-    int index = 0;
+//-----------------------------------------------------------------------------
+void vtkSlam::LabelScanLineKeypoints(ExtractedFrame& frame, unsigned int scanLine,
+                                     std::vector<std::pair<int, int> >& edges,
+                                     std::vector<std::pair<int, int> >& planars,
+                                     std::vector<std::pair<int, int> >& blobs)
+{
+  int Npts = frame.ScanLineOffsets[scanLine + 1] - frame.ScanLineOffsets[scanLine];
+  unsigned int nbrEdgePicked = 0;
+  unsigned int nbrPlanarPicked = 0;
 
-    // Edges using depth gap
-    for (int k = 0; k < Npts; ++k)
-    {
-      index = sortedDepthGapIdx[k];
-      depthGap = this->DepthGap[scanLine][index];
+  // if the line is almost empty, skip it
+  if (Npts < 3 * this->NeighborWidth)
+  {
+    return;
+  }
 
-      // thresh
-      if (depthGap < this->EdgeDepthGapThreshold)
-      {
-        break;
-      }
+  const size_t offset = frame.ScanLineOffsets[scanLine];
+  const double* lineAngles = frame.Angles.data() + offset;
+  const double* lineSaillantPoint = frame.SaillantPoint.data() + offset;
+  const double* lineDepthGap = frame.DepthGap.data() + offset;
+  const double* lineIntensityGap = frame.IntensityGap.data() + offset;
+  int* lineIsPointValid = frame.IsPointValid.data() + offset;
+  int* lineLabel = frame.Label.data() + offset;
+
+  // We split the validity of points between the edges
+  // keypoints and planar keypoints. This allows to take
+  // some points as planar keypoints even if they are close
+  // to an edge keypoint.
+  int* IsPointValidForPlanar = frame.IsPointValidForPlanar.data() + offset;
+  std::copy(lineIsPointValid, lineIsPointValid + Npts, IsPointValidForPlanar);
+
+  // Sort the curvature score in a decreasing order, the angles
+  // order is used twice while the others share the same buffer
+  size_t* sortedAnglesIdx = frame.SortedAnglesIndices.data() + offset;
+  size_t* sortedIdx = frame.SortedIndices.data() + offset;
+  sortIdx(lineAngles, Npts, sortedAnglesIdx);
+  sortIdx(lineDepthGap, Npts, sortedIdx);
+
+  double depthGap, sinAngle, saillancy, intensity;
+  int index = 0;
+
+  // Edges using depth gap
+  for (int k = 0; k < Npts; ++k)
+  {
+    index = sortedIdx[k];
+    depthGap = lineDepthGap[index];
 
-      // if the point is invalid continue
-      if (this->IsPointValid[scanLine][index] == 0)
-      {
-        continue;
-      }
-
-      // else indicate that the point is an edge
-      this->Label[scanLine][index] = 4;
-      this->EdgesIndex.push_back(std::pair<int, int>(scanLine, index));
-      nbrEdgePicked++;
-      //IsPointValidForPlanar[index] = 0;
-
-      // invalid its neighborhod
-      int indexBegin = index - this->NeighborWidth + 1;
-      int indexEnd = index + this->NeighborWidth - 1;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        this->IsPointValid[scanLine][j] = 0;
-      }
+    // thresh
+    if (depthGap < this->EdgeDepthGapThreshold)
+    {
+      break;
     }
 
-    // Edges using angles
-    for (int k = 0; k < Npts; ++k)
+    // if the point is invalid continue
+    if (lineIsPointValid[index] == 0)
     {
-      index = sortedAnglesIdx[k];
-      sinAngle = this->Angles[scanLine][index];
+      continue;
+    }
 
-      // thresh
-      if (sinAngle < this->EdgeSinAngleThreshold)
-      {
-        break;
-      }
+    // else indicate that the point is an edge
+    lineLabel[index] = 4;
+    edges.push_back(std::pair<int, int>(scanLine, index));
+    nbrEdgePicked++;
+    //IsPointValidForPlanar[index] = 0;
+
+    // invalid its neighborhod
+    int indexBegin = index - this->NeighborWidth + 1;
+    int indexEnd = index + this->NeighborWidth - 1;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
+    {
+      lineIsPointValid[j] = 0;
+    }
+  }
 
-      // if the point is invalid continue
-      if (this->IsPointValid[scanLine][index] == 0)
-      {
-        continue;
-      }
+  // Edges using angles
+  for (int k = 0; k < Npts; ++k)
+  {
+    index = sortedAnglesIdx[k];
+    sinAngle = lineAngles[index];
 
-      // else indicate that the point is an edge
-      this->Label[scanLine][index] = 4;
-      this->EdgesIndex.push_back(std::pair<int, int>(scanLine, index));
-      nbrEdgePicked++;
-      //IsPointValidForPlanar[index] = 0;
-
-      // invalid its neighborhod
-      int indexBegin = index - this->NeighborWidth;
-      int indexEnd = index + this->NeighborWidth;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        this->IsPointValid[scanLine][j] = 0;
-      }
+    // thresh
+    if (sinAngle < this->EdgeSinAngleThreshold)
+    {
+      break;
     }
 
-    // Edges using saillancy
-    for (int k = 0; k < Npts; ++k)
+    // if the point is invalid continue
+    if (lineIsPointValid[index] == 0)
     {
-      index = sortedSaillancyIdx[k];
-      saillancy = this->SaillantPoint[scanLine][index];
+      continue;
+    }
 
-      // thresh
-      if (saillancy < 1.5)
-      {
-        break;
-      }
+    // else indicate that the point is an edge
+    lineLabel[index] = 4;
+    edges.push_back(std::pair<int, int>(scanLine, index));
+    nbrEdgePicked++;
+    //IsPointValidForPlanar[index] = 0;
+
+    // invalid its neighborhod
+    int indexBegin = index - this->NeighborWidth;
+    int indexEnd = index + this->NeighborWidth;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
+    {
+      lineIsPointValid[j] = 0;
+    }
+  }
 
-      // if the point is invalid continue
-      if (this->IsPointValid[scanLine][index] == 0)
-      {
-        continue;
-      }
+  // Edges using saillancy
+  sortIdx(lineSaillantPoint, Npts, sortedIdx);
+  for (int k = 0; k < Npts; ++k)
+  {
+    index = sortedIdx[k];
+    saillancy = lineSaillantPoint[index];
 
-      // else indicate that the point is an edge
-      this->Label[scanLine][index] = 4;
-      this->EdgesIndex.push_back(std::pair<int, int>(scanLine, index));
-      nbrEdgePicked++;
-      //IsPointValidForPlanar[index] = 0;
-
-      // invalid its neighborhod
-      int indexBegin = index - this->NeighborWidth + 1;
-      int indexEnd = index + this->NeighborWidth - 1;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        this->IsPointValid[scanLine][j] = 0;
-      }
+    // thresh
+    if (saillancy < 1.5)
+    {
+      break;
     }
 
-    // Edges using intensity
-    for (int k = 0; k < Npts; ++k)
+    // if the point is invalid continue
+    if (lineIsPointValid[index] == 0)
     {
-      index = sortedIntensityGap[k];
-      intensity = this->IntensityGap[scanLine][index];
+      continue;
+    }
 
-      // thresh
-      if (intensity < 50.0)
-      {
-        break;
-      }
+    // else indicate that the point is an edge
+    lineLabel[index] = 4;
+    edges.push_back(std::pair<int, int>(scanLine, index));
+    nbrEdgePicked++;
+    //IsPointValidForPlanar[index] = 0;
+
+    // invalid its neighborhod
+    int indexBegin = index - this->NeighborWidth + 1;
+    int indexEnd = index + this->NeighborWidth - 1;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
+    {
+      lineIsPointValid[j] = 0;
+    }
+  }
 
-      // if the point is invalid continue
-      if (this->IsPointValid[scanLine][index] == 0)
-      {
-        continue;
-      }
+  // Edges using intensity
+  sortIdx(lineIntensityGap, Npts, sortedIdx);
+  for (int k = 0; k < Npts; ++k)
+  {
+    index = sortedIdx[k];
+    intensity = lineIntensityGap[index];
 
-      // else indicate that the point is an edge
-      this->Label[scanLine][index] = 4;
-      this->EdgesIndex.push_back(std::pair<int, int>(scanLine, index));
-      nbrEdgePicked++;
-      //IsPointValidForPlanar[index] = 0;
-
-      // invalid its neighborhood
-      int indexBegin = index - 1;
-      int indexEnd = index + 1;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        this->IsPointValid[scanLine][j] = 0;
-      }
+    // thresh
+    if (intensity < 50.0)
+    {
+      break;
     }
 
-    // Blobs Points
-    if (!this->FastSlam)
+    // if the point is invalid continue
+    if (lineIsPointValid[index] == 0)
     {
-      for (int k = 0; k < Npts; k = k + 3)
-      {
-        this->BlobIndex.push_back(std::pair<int, int>(scanLine, k));
-      }
+      continue;
     }
 
-    // Planes
-    for (int k = Npts - 1; k >= 0; --k)
+    // else indicate that the point is an edge
+    lineLabel[index] = 4;
+    edges.push_back(std::pair<int, int>(scanLine, index));
+    nbrEdgePicked++;
+    //IsPointValidForPlanar[index] = 0;
+
+    // invalid its neighborhood
+    int indexBegin = index - 1;
+    int indexEnd = index + 1;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
     {
-      index = sortedAnglesIdx[k];
-      sinAngle = this->Angles[scanLine][index];
-
-      // thresh
-      if (sinAngle > this->PlaneSinAngleThreshold)
-      {
-        break;
-      }
-
-      // if the point is invalid continue
-      if (IsPointValidForPlanar[index] == 0)
-      {
-        continue;
-      }
-
-      // else indicate that the point is a planar one
-      if ((this->Label[scanLine][index] != 4) && (this->Label[scanLine][index] != 3))
-        this->Label[scanLine][index] = 2;
-      this->PlanarIndex.push_back(std::pair<int, int>(scanLine, index));
-      IsPointValidForPlanar[index] = 0;
-      this->IsPointValid[scanLine][index] = 0;
-
-      // Invalid its neighbor so that we don't have too
-      // many planar keypoints in the same region. This is
-      // required because of the k-nearest search + plane
-      // approximation realized in the odometry part. Indeed,
-      // if all the planar points are on the same scan line the
-      // problem is degenerated since all the points are distributed
-      // on a line.
-      int indexBegin = index - 4;
-      int indexEnd = index + 4;
-      indexBegin = std::max(0, indexBegin);
-      indexEnd = std::min(Npts - 1, indexEnd);
-      for (int j = indexBegin; j <= indexEnd; ++j)
-      {
-        IsPointValidForPlanar[j] = 0;
-      }
-      nbrPlanarPicked++;
+      lineIsPointValid[j] = 0;
     }
   }
 
-  // add keypoints in increasing scan id order
-  std::sort(this->EdgesIndex.begin(), this->EdgesIndex.end());
-  std::sort(this->PlanarIndex.begin(), this->PlanarIndex.end());
-  std::sort(this->BlobIndex.begin(), this->BlobIndex.end());
-
-  // fill the keypoints vectors and compute the max dist keypoints
-  this->FarestKeypointDist = 0.0;
-  Point p;
-  for (unsigned int k = 0; k < this->EdgesIndex.size(); ++k)
-  {
-    p = this->pclCurrentFrameByScan[this->EdgesIndex[k].first]->points[this->EdgesIndex[k].second];
-    this->CurrentEdgesPoints->push_back(p);
-    this->FarestKeypointDist = std::max(this->FarestKeypointDist, static_cast<double>(std::sqrt(std::pow(p.x, 2) + std::pow(p.y, 2) + std::pow(p.z, 2))));
-  }
-  for (unsigned int k = 0; k < this->PlanarIndex.size(); ++k)
+  // Blobs Points
+  if (!this->FastSlam)
   {
-    p = this->pclCurrentFrameByScan[this->PlanarIndex[k].first]->points[this->PlanarIndex[k].second];
-    this->CurrentPlanarsPoints->push_back(p);
-    this->FarestKeypointDist = std::max(this->FarestKeypointDist, static_cast<double>(std::sqrt(std::pow(p.x, 2) + std::pow(p.y, 2) + std::pow(p.z, 2))));
+    for (int k = 0; k < Npts; k = k + 3)
+    {
+      blobs.push_back(std::pair<int, int>(scanLine, k));
+    }
   }
-  for (unsigned int k = 0; k < this->BlobIndex.size();  ++k)
+
+  // Planes
+  for (int k = Npts - 1; k >= 0; --k)
   {
-    p = this->pclCurrentFrameByScan[this->BlobIndex[k].first]->points[this->BlobIndex[k].second];
-    this->CurrentBlobsPoints->push_back(p);
-    this->FarestKeypointDist = std::max(this->FarestKeypointDist, static_cast<double>(std::sqrt(std::pow(p.x, 2) + std::pow(p.y, 2) + std::pow(p.z, 2))));
-  }
+    index = sortedAnglesIdx[k];
+    sinAngle = lineAngles[index];
 
-  // Initialize the IsKeypointUsed vectors
-  this->EdgePointRejectionEgoMotion.clear(); this->EdgePointRejectionEgoMotion.resize(this->CurrentEdgesPoints->size());
-  this->PlanarPointRejectionEgoMotion.clear(); this->PlanarPointRejectionEgoMotion.resize(this->CurrentPlanarsPoints->size());
-  this->EdgePointRejectionMapping.clear(); this->EdgePointRejectionMapping.resize(this->CurrentEdgesPoints->size());
-  this->PlanarPointRejectionMapping.clear(); this->PlanarPointRejectionMapping.resize(this->CurrentPlanarsPoints->size());
+    // thresh
+    if (sinAngle > this->PlaneSinAngleThreshold)
+    {
+      break;
+    }
+
+    // if the point is invalid continue
+    if (IsPointValidForPlanar[index] == 0)
+    {
+      continue;
+    }
 
-  // keypoints extraction informations
-  std::cout << "Extracted Edges: " << this->CurrentEdgesPoints->size() << " Planars: "
-            << this->CurrentPlanarsPoints->size() << " Blobs: "
-            << this->CurrentBlobsPoints->size() << std::endl;
+    // else indicate that the point is a planar one
+    if ((lineLabel[index] != 4) && (lineLabel[index] != 3))
+      lineLabel[index] = 2;
+    planars.push_back(std::pair<int, int>(scanLine, index));
+    IsPointValidForPlanar[index] = 0;
+    lineIsPointValid[index] = 0;
+
+    // Invalid its neighbor so that we don't have too
+    // many planar keypoints in the same region. This is
+    // required because of the k-nearest search + plane
+    // approximation realized in the odometry part. Indeed,
+    // if all the planar points are on the same scan line the
+    // problem is degenerated since all the points are distributed
+    // on a line.
+    int indexBegin = index - 4;
+    int indexEnd = index + 4;
+    indexBegin = std::max(0, indexBegin);
+    indexEnd = std::min(Npts - 1, indexEnd);
+    for (int j = indexBegin; j <= indexEnd; ++j)
+    {
+      IsPointValidForPlanar[j] = 0;
+    }
+    nbrPlanarPicked++;
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -1663,7 +2962,7 @@ void vtkSlam::TransformToWorld(Point& p)
 {
   if (this->Undistortion)
   {
-    this->ExpressPointInOtherReferencial(p, this->MappingInterpolator);
+    this->ExpressPointInOtherReferencial(p, *this->MappingPoses);
   }
   else
   {
@@ -1685,8 +2984,10 @@ void vtkSlam::TransformToWorld(Point& p)
 }
 
 //-----------------------------------------------------------------------------
-int vtkSlam::ComputeLineDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousEdges, Eigen::Matrix3d& R,
-                                                   Eigen::Vector3d& dT, Point p, std::string step)
+int vtkSlam::ComputeLineDistanceParameters(pcl::search::Search<Point>::Ptr kdtreePreviousEdges, Eigen::Matrix3d& R,
+                                                   Eigen::Vector3d& dT, Point p, std::string step,
+                                                   KeypointMatches& matches,
+                                                   const KnnBatchSearch* neighbors, size_t query)
 {
   // number of neighbors edge points required to approximate
   // the corresponding egde line
@@ -1725,11 +3026,11 @@ int vtkSlam::ComputeLineDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePr
   {
     if (step == "egoMotion")
     {
-      this->ExpressPointInOtherReferencial(p, this->EgoMotionInterpolator);
+      this->ExpressPointInOtherReferencial(p, *this->EgoMotionPoses);
     }
     else if (step == "mapping")
     {
-      this->ExpressPointInOtherReferencial(p, this->MappingInterpolator);
+      this->ExpressPointInOtherReferencial(p, *this->MappingPoses);
     }
   }
   else // rigid transform
@@ -1738,12 +3039,12 @@ int vtkSlam::ComputeLineDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePr
     p.x = P(0); p.y = P(1); p.z = P(2);
   }
 
-  std::vector<int> nearestIndex;
-  std::vector<float> nearestDist;
+  std::vector<int>& nearestIndex = matches.NearestIndex;
+  std::vector<float>& nearestDist = matches.NearestDist;
 
   if (step == "egoMotion")
   {
-    GetEgoMotionLineSpecificNeighbor(nearestIndex, nearestDist, requiredNearest, kdtreePreviousEdges, p);
+    GetEgoMotionLineSpecificNeighbor(nearestIndex, nearestDist, requiredNearest, kdtreePreviousEdges, p, matches, neighbors, query);
     if (nearestIndex.size() < this->EgoMotionMinimumLineNeighborRejection)
     {
       return 0;
@@ -1752,7 +3053,8 @@ int vtkSlam::ComputeLineDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePr
   }
   else if (step == "mapping")
   {
-    GetMappingLineSpecificNeigbbor(nearestIndex, nearestDist, this->MappingLineMaxDistInlier, requiredNearest, kdtreePreviousEdges, p);
+    GetMappingLineSpecificNeigbbor(nearestIndex, nearestDist, this->MappingLineMaxDistInlier, requiredNearest, kdtreePreviousEdges, p,
+                                   matches, neighbors, query);
     if (nearestIndex.size() < this->MappingMinimumLineNeighborRejection)
     {
       return 0;
@@ -1772,26 +3074,14 @@ int vtkSlam::ComputeLineDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePr
   // of the requiredNearest nearest edges points extracted
   // Thans to the PCA we will check the shape of the neighborhood
   // and keep it if it is distributed along a line
-  Eigen::MatrixXd data(requiredNearest, 3);
-
-  for (unsigned int k = 0; k < requiredNearest; k++)
-  {
-    Point pt = kdtreePreviousEdges->getInputCloud()->points[nearestIndex[k]];
-    data.row(k) << pt.x, pt.y, pt.z;
-  }
-
-  Eigen::Vector3d mean = data.colwise().mean();
-  Eigen::MatrixXd centered = data.rowwise() - mean.transpose();
-  Eigen::MatrixXd cov = centered.transpose() * centered;
-  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(cov);
+  Eigen::Vector3d mean;
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig;
+  ComputeNeighborsPCA(*kdtreePreviousEdges->getInputCloud(), nearestIndex, requiredNearest, mean, eig);
 
   // Eigen values
-  Eigen::MatrixXd D(1,3);
+  Eigen::Vector3d D = eig.eigenvalues();
   // Eigen vectors
-  Eigen::MatrixXd V(3,3);
-
-  D = eig.eigenvalues();
-  V = eig.eigenvectors();
+  Eigen::Matrix3d V = eig.eigenvectors();
 
   // if the first eigen value is significantly higher than
   // the second one, it means the sourrounding points are
@@ -1865,18 +3155,20 @@ int vtkSlam::ComputeLineDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePr
     return 5;
 
   // store the distance parameters values
-  this->Avalues.push_back(A);
-  this->Pvalues.push_back(mean);
-  this->Xvalues.push_back(P0);
-  this->TimeValues.push_back(p.intensity);
-  this->residualCoefficient.push_back(s);
-  this->RadiusIncertitude.push_back(0.0);
+  matches.Avalues.push_back(A);
+  matches.Pvalues.push_back(mean);
+  matches.Xvalues.push_back(P0);
+  matches.TimeValues.push_back(p.intensity);
+  matches.residualCoefficient.push_back(s);
+  matches.RadiusIncertitude.push_back(0.0);
   return 6;
 }
 
 //-----------------------------------------------------------------------------
-int vtkSlam::ComputePlaneDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousPlanes, Eigen::Matrix3d& R,
-                                                    Eigen::Vector3d& dT, Point p, std::string step)
+int vtkSlam::ComputePlaneDistanceParameters(pcl::search::Search<Point>::Ptr kdtreePreviousPlanes, Eigen::Matrix3d& R,
+                                                    Eigen::Vector3d& dT, Point p, std::string step,
+                                                    KeypointMatches& matches,
+                                                    const KnnBatchSearch* neighbors, size_t query)
 {
   // number of neighbors edge points required to approximate
   // the corresponding egde line
@@ -1916,11 +3208,11 @@ int vtkSlam::ComputePlaneDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreeP
   {
     if (step == "egoMotion")
     {
-      this->ExpressPointInOtherReferencial(p, this->EgoMotionInterpolator);
+      this->ExpressPointInOtherReferencial(p, *this->EgoMotionPoses);
     }
     else if (step == "mapping")
     {
-      this->ExpressPointInOtherReferencial(p, this->MappingInterpolator);
+      this->ExpressPointInOtherReferencial(p, *this->MappingPoses);
     }
   }
   else // rigid transform
@@ -1929,9 +3221,9 @@ int vtkSlam::ComputePlaneDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreeP
     p.x = P(0); p.y = P(1); p.z = P(2);
   }
 
-  std::vector<int> nearestIndex;
-  std::vector<float> nearestDist;
-  kdtreePreviousPlanes->nearestKSearch(p, requiredNearest, nearestIndex, nearestDist);
+  std::vector<int>& nearestIndex = matches.NearestIndex;
+  std::vector<float>& nearestDist = matches.NearestDist;
+  NearestKSearch(kdtreePreviousPlanes, neighbors, query, p, requiredNearest, nearestIndex, nearestDist);
 
   // It means that there is not enought keypoints in the neighbohood
   if (nearestIndex.size() < requiredNearest)
@@ -1950,26 +3242,14 @@ int vtkSlam::ComputePlaneDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreeP
   // of the requiredNearest nearest edges points extracted
   // Thanks to the PCA we will check the shape of the neighborhood
   // and keep it if it is distributed along a line
-  Eigen::MatrixXd data(requiredNearest,3);
-
-  for (unsigned int k = 0; k < requiredNearest; k++)
-  {
-    Point pt = kdtreePreviousPlanes->getInputCloud()->points[nearestIndex[k]];
-    data.row(k) << pt.x, pt.y, pt.z;
-  }
-
-  Eigen::Vector3d mean = data.colwise().mean();
-  Eigen::MatrixXd centered = data.rowwise() - mean.transpose();
-  Eigen::MatrixXd cov = centered.transpose() * centered;
-  Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(cov);
+  Eigen::Vector3d mean;
+  Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eig;
+  ComputeNeighborsPCA(*kdtreePreviousPlanes->getInputCloud(), nearestIndex, requiredNearest, mean, eig);
 
   // Eigen values
-  Eigen::MatrixXd D(1,3);
+  Eigen::Vector3d D = eig.eigenvalues();
   // Eigen vectors
-  Eigen::MatrixXd V(3,3);
-
-  D = eig.eigenvalues();
-  V = eig.eigenvectors();
+  Eigen::Matrix3d V = eig.eigenvectors();
 
   // if the second eigen value is close to the highest one
   // and bigger than the smallest one it means that the points
@@ -2026,18 +3306,19 @@ int vtkSlam::ComputePlaneDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreeP
     return 5;
 
   // store the distance parameters values
-  this->Avalues.push_back(A);
-  this->Pvalues.push_back(mean);
-  this->Xvalues.push_back(P0);
-  this->residualCoefficient.push_back(s);
-  this->TimeValues.push_back(p.intensity);
-  this->RadiusIncertitude.push_back(0.0);
+  matches.Avalues.push_back(A);
+  matches.Pvalues.push_back(mean);
+  matches.Xvalues.push_back(P0);
+  matches.residualCoefficient.push_back(s);
+  matches.TimeValues.push_back(p.intensity);
+  matches.RadiusIncertitude.push_back(0.0);
   return 6;
 }
 
 //-----------------------------------------------------------------------------
-int vtkSlam::ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousBlobs, Eigen::Matrix3d& R,
-                                                    Eigen::Vector3d& dT, Point p, std::string vtkNotUsed(step))
+int vtkSlam::ComputeBlobsDistanceParameters(pcl::search::Search<Point>::Ptr kdtreePreviousBlobs, Eigen::Matrix3d& R,
+                                                    Eigen::Vector3d& dT, Point p, std::string vtkNotUsed(step),
+                                                    KeypointMatches& matches)
 {
   // number of neighbors blobs points required to approximate
   // the corresponding ellipsoide
@@ -2058,8 +3339,8 @@ int vtkSlam::ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreeP
   P = R * P + dT;
   p.x = P(0); p.y = P(1); p.z = P(2);
 
-  std::vector<int> nearestIndex;
-  std::vector<float> nearestDist;
+  std::vector<int>& nearestIndex = matches.NearestIndex;
+  std::vector<float>& nearestDist = matches.NearestDist;
   kdtreePreviousBlobs->nearestKSearch(p, requiredNearest, nearestIndex, nearestDist);
 
   // It means that there is not enought keypoints in the neighbohood
@@ -2146,31 +3427,33 @@ int vtkSlam::ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreeP
   double s = 1.0;//1.0 - nearestDist[requiredNearest - 1] / maxDist;
 
   // store the distance parameters values
-  this->Avalues.push_back(A);
-  this->Pvalues.push_back(mean);
-  this->Xvalues.push_back(P0);
-  this->residualCoefficient.push_back(s);
-  this->RadiusIncertitude.push_back(0.0);
+  matches.Avalues.push_back(A);
+  matches.Pvalues.push_back(mean);
+  matches.Xvalues.push_back(P0);
+  matches.residualCoefficient.push_back(s);
+  matches.TimeValues.push_back(p.intensity);
+  matches.RadiusIncertitude.push_back(0.0);
   return 5;
 }
 
 //-----------------------------------------------------------------------------
 void vtkSlam::GetEgoMotionLineSpecificNeighbor(std::vector<int>& nearestValid, std::vector<float>& nearestValidDist,
-                                               unsigned int nearestSearch, pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousEdges, Point p)
+                                               unsigned int nearestSearch, pcl::search::Search<Point>::Ptr kdtreePreviousEdges, Point p,
+                                               KeypointMatches& scratch,
+                                               const KnnBatchSearch* neighbors, size_t query)
 {
   // clear vector
   nearestValid.clear();
-  nearestValid.resize(0);
   nearestValidDist.clear();
-  nearestValidDist.resize(0);
 
   // get nearest neighbor of the query point
-  std::vector<int> nearestIndex;
-  std::vector<float> nearestDist;
-  kdtreePreviousEdges->nearestKSearch(p, nearestSearch, nearestIndex, nearestDist);
+  std::vector<int>& nearestIndex = scratch.CandidateIndex;
+  std::vector<float>& nearestDist = scratch.CandidateDist;
+  NearestKSearch(kdtreePreviousEdges, neighbors, query, p, nearestSearch, nearestIndex, nearestDist);
 
   // take the closest point
-  std::vector<int> idAlreadyTook(this->NLasers, 0);
+  std::vector<int>& idAlreadyTook = scratch.IdAlreadyTook;
+  idAlreadyTook.assign(this->NLasers, 0);
   Point closest = kdtreePreviousEdges->getInputCloud()->points[nearestIndex[0]];
   nearestValid.push_back(nearestIndex[0]);
   nearestValidDist.push_back(nearestDist[0]);
@@ -2208,25 +3491,30 @@ void vtkSlam::GetEgoMotionLineSpecificNeighbor(std::vector<int>& nearestValid, s
 
 //-----------------------------------------------------------------------------
 void vtkSlam::GetMappingLineSpecificNeigbbor(std::vector<int>& nearestValid, std::vector<float>& nearestValidDist, double maxDistInlier,
-                                             unsigned int nearestSearch, pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousEdges, Point p)
+                                             unsigned int nearestSearch, pcl::search::Search<Point>::Ptr kdtreePreviousEdges, Point p,
+                                             KeypointMatches& scratch,
+                                             const KnnBatchSearch* neighbors, size_t query)
 {
   // reset vectors
   nearestValid.clear();
-  nearestValid.resize(0);
   nearestValidDist.clear();
-  nearestValidDist.resize(0);
 
   // to prevent square root when making camparisons
   maxDistInlier = std::pow(maxDistInlier, 2);
 
   // Take the neighborhood of the query point
   // get nearest neighbor of the query point
-  std::vector<int> nearestIndex;
-  std::vector<float> nearestDist;
-  kdtreePreviousEdges->nearestKSearch(p, nearestSearch, nearestIndex, nearestDist);
-
-  // take the closest point
-  std::vector<std::vector<int> > inliersList;
+  std::vector<int>& nearestIndex = scratch.CandidateIndex;
+  std::vector<float>& nearestDist = scratch.CandidateDist;
+  NearestKSearch(kdtreePreviousEdges, neighbors, query, p, nearestSearch, nearestIndex, nearestDist);
+
+  // take the closest point, the inliers of each candidate line are
+  // stored in the scratch lists, which keep their memory
+  std::vector<std::vector<int> >& inliersList = scratch.InliersList;
+  if (inliersList.size() < nearestIndex.size())
+  {
+    inliersList.resize(nearestIndex.size());
+  }
   Point closest = kdtreePreviousEdges->getInputCloud()->points[nearestIndex[0]];
   nearestValid.push_back(nearestIndex[0]);
   nearestValidDist.push_back(nearestDist[0]);
@@ -2243,7 +3531,8 @@ void vtkSlam::GetMappingLineSpecificNeigbbor(std::vector<int>& nearestValid, std
   // inmliers with the most inliers
   for (unsigned int ptIndex = 1; ptIndex < nearestIndex.size(); ++ptIndex)
   {
-    std::vector<int> inlierIndex;
+    std::vector<int>& inlierIndex = inliersList[ptIndex - 1];
+    inlierIndex.clear();
     pclP2 = kdtreePreviousEdges->getInputCloud()->points[nearestIndex[ptIndex]];
     P2 << pclP2.x, pclP2.y, pclP2.z;
     dir = (P2 - P1).normalized();
@@ -2259,12 +3548,11 @@ void vtkSlam::GetMappingLineSpecificNeigbbor(std::vector<int>& nearestValid, std
         inlierIndex.push_back(candidateIndex);
       }
     }
-    inliersList.push_back(inlierIndex);
   }
 
   std::size_t maxInliers = 0;
   int indexMaxInliers = -1;
-  for (unsigned int k = 0; k < inliersList.size(); ++k)
+  for (unsigned int k = 0; k + 1 < nearestIndex.size(); ++k)
   {
     if (inliersList[k].size() > maxInliers)
     {
@@ -2286,126 +3574,135 @@ void vtkSlam::GetMappingLineSpecificNeigbbor(std::vector<int>& nearestValid, std
 //-----------------------------------------------------------------------------
 void vtkSlam::ComputeEgoMotion()
 {
+  VV_TRACE_SCOPE("vtkSlam::ComputeEgoMotion");
   // Check that there is enought points to compute the EgoMotion
-  if ((this->CurrentEdgesPoints->size() == 0 || this->PreviousEdgesPoints->size() == 0) &&
-      (this->CurrentPlanarsPoints->size() == 0 || this->PreviousPlanarsPoints->size() == 0))
+  if ((this->Frame->CurrentEdgesPoints->size() == 0 || this->PreviousEdgesPoints->size() == 0) &&
+      (this->Frame->CurrentPlanarsPoints->size() == 0 || this->PreviousPlanarsPoints->size() == 0))
   {
     this->FillEgoMotionInfoArrayWithDefaultValues();
     vtkGenericWarningMacro("Not enought keypoints, EgoMotion skipped for this frame");
     return;
   }
 
-  // reset the relative transform
-  this->Trelative = Eigen::Matrix<double, 6, 1>::Zero();
+  // reset the relative transform, or start from the IMU prior
+  Eigen::Matrix<double, 6, 1> prior;
+  if (!this->ImuPrior || !this->ComputeImuPrior(prior))
+  {
+    prior = Eigen::Matrix<double, 6, 1>::Zero();
+  }
+  this->Trelative = prior;
 
   // kd-tree to process fast nearest neighbor
   // among the keypoints of the previous pointcloud
-  pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousEdges(new pcl::KdTreeFLANN<Point>());
-  pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousPlanes(new pcl::KdTreeFLANN<Point>());
-  pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousBlobs(new pcl::KdTreeFLANN<Point>());
+  pcl::search::Search<Point>::Ptr kdtreePreviousEdges(new pcl::search::KdTree<Point>());
+  pcl::search::Search<Point>::Ptr kdtreePreviousPlanes(new pcl::search::KdTree<Point>());
+  pcl::search::Search<Point>::Ptr kdtreePreviousBlobs(new pcl::search::KdTree<Point>());
   kdtreePreviousEdges->setInputCloud(this->PreviousEdgesPoints);
   kdtreePreviousPlanes->setInputCloud(this->PreviousPlanarsPoints);
   kdtreePreviousBlobs->setInputCloud(this->PreviousBlobsPoints);
-
-  std::cout << "========== Ego-Motion ==========" << std::endl;
-  std::cout << "previous <-> current edges : " << this->PreviousEdgesPoints->size() << " <-> " << this->CurrentEdgesPoints->size()
-            << "previous <-> current planes : " << this->PreviousPlanarsPoints->size() << " <-> " << this->CurrentPlanarsPoints->size() << std::endl;
+  if (this->NeighborSearchBackend > 0)
+  {
+    const KnnBatchSearch::Backend backend = this->IsNeighborSearchOnGpu() ? KnnBatchSearch::GPU : KnnBatchSearch::CPU;
+    this->EdgesNeighbors->SetBackend(backend);
+    this->PlanarsNeighbors->SetBackend(backend);
+    this->EdgesNeighbors->SetSearch(kdtreePreviousEdges);
+    this->PlanarsNeighbors->SetSearch(kdtreePreviousPlanes);
+  }
 
   unsigned int usedEdges = 0;
   unsigned int usedPlanes = 0;
-  Point currentPoint, transformedPoint;
+
+  // The cost function is reused by the problems of all the ICP
+  // iterations, it only reads the matches of the current one
+  CostFunctions::MahalanobisDistanceBatchResidual residuals(2.0);
+  ceres::Problem::Options problemOptions;
+  problemOptions.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
 
   // ICP - Levenberg-Marquardt loop:
   // At each step of this loop an ICP matching is performed
   // Once the keypoints matched, we estimate the the 6-DOF
   // parameters by minimizing a non-linear least square cost
   // function using a Levenberg-Marquardt algorithm
+  ICPStep nextStep = MatchKeypointsAgain;
   for (unsigned int icpCount = 0; icpCount < this->EgoMotionICPMaxIter; ++icpCount)
   {
-    // Rotation and translation at this step
-    Eigen::Matrix3d R = GetRotationMatrix(this->Trelative);
-    Eigen::Vector3d T;
-    T << this->Trelative(3), this->Trelative(4), this->Trelative(5);
-
-    // clear all keypoints matching data
-    this->ResetDistanceParameters();
-
-    // Init the undistortion interpolator
-    if (this->Undistortion)
+    // The matches of the previous iteration are kept when the pose barely moved
+    if (nextStep == MatchKeypointsAgain)
     {
-      this->EgoMotionInterpolator = this->InitUndistortionInterpolatorEgoMotion();
-    }
+      // Rotation and translation at this step
+      Eigen::Matrix3d R = GetRotationMatrix(this->Trelative);
+      Eigen::Vector3d T;
+      T << this->Trelative(3), this->Trelative(4), this->Trelative(5);
 
-    // loop over edges
-    for (unsigned int edgeIndex = 0; edgeIndex < this->CurrentEdgesPoints->size(); ++edgeIndex)
-    {
-      currentPoint = this->CurrentEdgesPoints->points[edgeIndex];
+      // clear all keypoints matching data
+      this->ResetDistanceParameters();
+      this->Profile.EgoMotionMatchings++;
 
+      // Init the undistortion interpolator
+      if (this->Undistortion)
+      {
+        this->InitUndistortionEgoMotion();
+      }
+
+      // match the edges
       // Find the closest correspondence edge line of the current edge point
-      if ((this->PreviousEdgesPoints->size() > 7) && (this->CurrentEdgesPoints->size() > 0))
+      if ((this->PreviousEdgesPoints->size() > 7) && (this->Frame->CurrentEdgesPoints->size() > 0))
       {
         // Compute the parameters of the point - line distance
         // i.e A = (I - n*n.t)^2 with n being the director vector
         // and P a point of the line
-        int rejectionIndex = this->ComputeLineDistanceParameters(kdtreePreviousEdges, R, T, currentPoint, "egoMotion");
-        this->EdgePointRejectionEgoMotion[edgeIndex] = rejectionIndex;
-        this->MatchRejectionHistogramLine[rejectionIndex] += 1;
+        const pcl::PointCloud<Point>& keypoints = *this->Frame->CurrentEdgesPoints;
+        const KnnBatchSearch* neighbors = this->SearchNeighbors(*this->EdgesNeighbors, keypoints, R, T,
+          *this->EgoMotionPoses, this->EgoMotionLineDistanceNbrNeighbors);
+        this->MatchKeypoints(keypoints,
+          [&](const Point& keypoint, KeypointMatches& matches) {
+            return this->ComputeLineDistanceParameters(kdtreePreviousEdges, R, T, keypoint, "egoMotion", matches,
+                                                       neighbors, &keypoint - keypoints.points.data());
+          },
+          this->GetRejectionsOutput(this->Frame->EdgePointRejectionEgoMotion), &this->MatchRejectionHistogramLine);
       }
-    }
-
-    // loop over surfaces
-    for (unsigned int planarIndex = 0; planarIndex < this->CurrentPlanarsPoints->size(); ++planarIndex)
-    {
-      currentPoint = this->CurrentPlanarsPoints->points[planarIndex];
 
+      // match the surfaces
       // Find the closest correspondence plane of the current planar point
-      if ((this->PreviousPlanarsPoints->size() > 7) && (this->CurrentPlanarsPoints->size() > 0))
+      if ((this->PreviousPlanarsPoints->size() > 7) && (this->Frame->CurrentPlanarsPoints->size() > 0))
       {
         // Compute the parameters of the point - plane distance
         // i.e A = n * n.t with n being a normal of the plane
         // and is a point of the plane
-        int rejectionIndex = this->ComputePlaneDistanceParameters(kdtreePreviousPlanes, R, T, currentPoint, "egoMotion");
-        this->PlanarPointRejectionEgoMotion[planarIndex] = rejectionIndex;
-        this->MatchRejectionHistogramPlane[rejectionIndex] += 1;
+        const pcl::PointCloud<Point>& keypoints = *this->Frame->CurrentPlanarsPoints;
+        const KnnBatchSearch* neighbors = this->SearchNeighbors(*this->PlanarsNeighbors, keypoints, R, T,
+          *this->EgoMotionPoses, this->EgoMotionPlaneDistanceNbrNeighbors);
+        this->MatchKeypoints(keypoints,
+          [&](const Point& keypoint, KeypointMatches& matches) {
+            return this->ComputePlaneDistanceParameters(kdtreePreviousPlanes, R, T, keypoint, "egoMotion", matches,
+                                                        neighbors, &keypoint - keypoints.points.data());
+          },
+          this->GetRejectionsOutput(this->Frame->PlanarPointRejectionEgoMotion), &this->MatchRejectionHistogramPlane);
       }
-    }
 
-    usedEdges = this->MatchRejectionHistogramLine[6];
-    usedPlanes = this->MatchRejectionHistogramPlane[6];
-    // Skip this frame if there is too few geometric
-    // keypoints matched
-    if ((usedPlanes + usedEdges) < 20)
-    {
-      vtkGenericWarningMacro("Too few geometric features, frame skipped");
-      break;
+      usedEdges = this->MatchRejectionHistogramLine[6];
+      usedPlanes = this->MatchRejectionHistogramPlane[6];
+      // Skip this frame if there is too few geometric
+      // keypoints matched
+      if ((usedPlanes + usedEdges) < 20)
+      {
+        vtkGenericWarningMacro("Too few geometric features, frame skipped");
+        break;
+      }
     }
 
     // We want to estimate our 6-DOF parameters using a non
     // linear least square minimization. The non linear part
     // comes from the Euler Angle parametrization of the rotation
     // endomorphism SO(3). To minimize it we use CERES to perform
-    // the Levenberg-Marquardt algorithm.
-    ceres::Problem problem;
-    for (unsigned int k = 0; k < Xvalues.size(); ++k)
-    {
-      if (this->Undistortion)
-      {
-        ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::MahalanobisDistanceLinearDistortionResidual, 1, 6>(
-                                              new CostFunctions::MahalanobisDistanceLinearDistortionResidual(
-                                                this->Avalues[k], this->Pvalues[k], this->Xvalues[k],
-                                                Eigen::Matrix<double, 3, 1>::Zero(),
-                                                Eigen::Matrix<double, 3, 3>::Identity(),
-                                                this->TimeValues[k], this->residualCoefficient[k]));
-        problem.AddResidualBlock(cost_function, new ceres::ArctanLoss(2.0), this->Trelative.data());
-      }
-      else
-      {
-        ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::MahalanobisDistanceAffineIsometryResidual, 1, 6>(
-                                             new CostFunctions::MahalanobisDistanceAffineIsometryResidual(this->Avalues[k], this->Pvalues[k],
-                                                                                                          this->Xvalues[k], this->residualCoefficient[k]));
-        problem.AddResidualBlock(cost_function, new ceres::ArctanLoss(2.0), this->Trelative.data());
-      }
-    }
+    // the Levenberg-Marquardt algorithm. All the matches are
+    // evaluated by a single residual block with analytic jacobians
+    const Eigen::Matrix<double, 6, 1> previousTrelative = this->Trelative;
+    residuals.SetMatches(this->Avalues, this->Pvalues, this->Xvalues,
+                         this->Undistortion ? &this->TimeValues : nullptr,
+                         this->residualCoefficient, Eigen::Vector3d::Zero());
+    ceres::Problem problem(problemOptions);
+    problem.AddResidualBlock(&residuals, nullptr, this->Trelative.data());
 
     ceres::Solver::Options options;
     options.max_num_iterations = this->EgoMotionLMMaxIter;
@@ -2414,25 +3711,34 @@ void vtkSlam::ComputeEgoMotion()
 
     ceres::Solver::Summary summary;
     ceres::Solve(options, &problem, &summary);
-    std::cout << summary.BriefReport() << std::endl;
+    this->Profile.EgoMotionICPIterations++;
+    this->Profile.EgoMotionLMIterations += summary.num_successful_steps + summary.num_unsuccessful_steps;
+    nextStep = this->GetNextICPStep(previousTrelative, this->Trelative, summary.initial_cost,
+      summary.final_cost, summary.termination_type == ceres::CONVERGENCE);
 
     // If no L-M iteration has been made since the
     // last ICP matching it means we reached a local
-    // minimum for the ICP-LM algorithm
-    if (summary.num_successful_steps == 1)
+    // minimum for the ICP-LM algorithm, the loop also
+    // stops once the pose update becomes negligible.
+    // In real-time mode, the estimation also stops once
+    // its part of the frame budget is spent
+    if (summary.num_successful_steps == 1 || nextStep == ICPConverged ||
+        this->IsFrameOverBudget(EgoMotionBudgetRatio))
     {
       break;
     }
   }
 
-  // Provide information about keypoints-neighborhood matching rejections
-  this->RejectionInformationDisplay();
+  // Keep the keypoints-neighborhood matching rejections of the last iteration
+  if (this->Profiling)
+  {
+    this->Profile.EgoMotionLineRejections = this->MatchRejectionHistogramLine;
+    this->Profile.EgoMotionPlaneRejections = this->MatchRejectionHistogramPlane;
+  }
 
   static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("EgoMotion: edges used"))->InsertNextValue(usedEdges);
   static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("EgoMotion: planes used"))->InsertNextValue(usedPlanes);
   static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("EgoMotion: total keypoints used"))->InsertNextValue(this->Xvalues.size());
-  std::cout << "used keypoints : " << this->Xvalues.size() << std::endl;
-  std::cout << "edges : " << usedEdges << " planes : " << usedPlanes << std::endl;
 
   // Integrate the relative motion
   // to the world transformation
@@ -2442,8 +3748,9 @@ void vtkSlam::ComputeEgoMotion()
 //-----------------------------------------------------------------------------
 void vtkSlam::Mapping()
 {
+  VV_TRACE_SCOPE("vtkSlam::Mapping");
   // Check that there is enought points to compute the EgoMotion
-  if (this->CurrentEdgesPoints->size() == 0 && this->CurrentPlanarsPoints->size() == 0)
+  if (this->Frame->CurrentEdgesPoints->size() == 0 && this->Frame->CurrentPlanarsPoints->size() == 0)
   {
     this->FillMappingInfoArrayWithDefaultValues();
     // update maps
@@ -2452,137 +3759,157 @@ void vtkSlam::Mapping()
     return;
   }
 
-  // contruct kd-tree for fast search
-  pcl::KdTreeFLANN<Point>::Ptr kdtreeEdges(new pcl::KdTreeFLANN<Point>());
-  pcl::KdTreeFLANN<Point>::Ptr kdtreePlanes(new pcl::KdTreeFLANN<Point>());
-  pcl::KdTreeFLANN<Point>::Ptr kdtreeBlobs(new pcl::KdTreeFLANN<Point>());
+  // the maps keep their nearest neighbors search up to date, there is no tree to build
+  pcl::search::Search<Point>::Ptr kdtreeEdges = this->EdgesPointsLocalMap->GetSearch();
+  pcl::search::Search<Point>::Ptr kdtreePlanes = this->PlanarPointsLocalMap->GetSearch();
+  pcl::search::Search<Point>::Ptr kdtreeBlobs = this->BlobsPointsLocalMap->GetSearch();
+  if (this->NeighborSearchBackend > 0)
+  {
+    const KnnBatchSearch::Backend backend = this->IsNeighborSearchOnGpu() ? KnnBatchSearch::GPU : KnnBatchSearch::CPU;
+    this->EdgesNeighbors->SetBackend(backend);
+    this->PlanarsNeighbors->SetBackend(backend);
+    this->EdgesNeighbors->SetSearch(kdtreeEdges);
+    this->PlanarsNeighbors->SetSearch(kdtreePlanes);
+  }
 
   // Set the FarestPoint to reduce the map to the minimun since
-  this->SetLidarMaximunRange(this->FarestKeypointDist);
+  this->SetLidarMaximunRange(this->Frame->FarestKeypointDist);
 
-  pcl::PointCloud<Point>::Ptr subEdgesPointsLocalMap = this->EdgesPointsLocalMap->Get(this->Tworld);
-  pcl::PointCloud<Point>::Ptr subPlanarPointsLocalMap = this->PlanarPointsLocalMap->Get(this->Tworld);
-
-  std::cout << "========== Mapping ==========" << std::endl;
-  std::cout << "Edges extracted from map: " << subEdgesPointsLocalMap->points.size()
-            << "Planes extracted from map: " << subPlanarPointsLocalMap->points.size() << std::endl;
-
-  kdtreeEdges->setInputCloud(subEdgesPointsLocalMap);
-  kdtreePlanes->setInputCloud(subPlanarPointsLocalMap);
-
-  if (!this->FastSlam)
-  {
-    pcl::PointCloud<Point>::Ptr subBlobPointsLocalMap = this->BlobsPointsLocalMap->Get(this->Tworld);
-    kdtreeBlobs->setInputCloud(subBlobPointsLocalMap);
-    std::cout << "blobs map : " << subBlobPointsLocalMap->points.size() << std::endl;
-  }
+  const size_t edgesMapSize = this->EdgesPointsLocalMap->GetNumberOfPoints();
+  const size_t planarsMapSize = this->PlanarPointsLocalMap->GetNumberOfPoints();
 
   unsigned int usedEdges = 0;
   unsigned int usedPlanes = 0;
   unsigned int usedBlobs = 0;
-  Point currentPoint;
   Eigen::MatrixXd estimatorCovariance(6, 6);
 
+  // The cost function is reused by the problems of all the ICP
+  // iterations, it only reads the matches of the current one
+  CostFunctions::MahalanobisDistanceBatchResidual residuals(2.0);
+  ceres::Problem::Options problemOptions;
+  problemOptions.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+
   // ICP - Levenberg-Marquardt loop:
   // At each step of this loop an ICP matching is performed
   // Once the keypoints matched, we estimate the the 6-DOF
   // parameters by minimizing a non-linear least square cost
   // function using a Levenberg-Marquardt algorithm
+  // Coarse-to-fine: the first iterations match one keypoint out of
+  // CoarseKeypointsStep with the coarse maps, searching their neighbors one
+  // by one, the last one at least is done at full resolution
+  pcl::search::Search<Point>::Ptr kdtreeCoarseEdges = this->EdgesPointsLocalMap->GetCoarseSearch();
+  pcl::search::Search<Point>::Ptr kdtreeCoarsePlanes = this->PlanarPointsLocalMap->GetCoarseSearch();
+  unsigned int coarseIterations = (kdtreeCoarseEdges && kdtreeCoarsePlanes && this->MappingICPMaxIter > 0) ?
+    std::min(this->MappingCoarseICPIter, this->MappingICPMaxIter - 1) : 0;
+  pcl::PointCloud<Point> coarseEdges;
+  pcl::PointCloud<Point> coarsePlanars;
+  for (size_t i = 0; coarseIterations > 0 && i < this->Frame->CurrentEdgesPoints->size(); i += CoarseKeypointsStep)
+  {
+    coarseEdges.push_back(this->Frame->CurrentEdgesPoints->points[i]);
+  }
+  for (size_t i = 0; coarseIterations > 0 && i < this->Frame->CurrentPlanarsPoints->size(); i += CoarseKeypointsStep)
+  {
+    coarsePlanars.push_back(this->Frame->CurrentPlanarsPoints->points[i]);
+  }
+
+  ICPStep nextStep = MatchKeypointsAgain;
   for (unsigned int icpCount = 0; icpCount < this->MappingICPMaxIter; ++icpCount)
   {
-    // clear all keypoints matching data
-    this->ResetDistanceParameters();
+    const bool coarse = icpCount < coarseIterations;
 
-    // Init the undistortion interpolator
-    if (this->Undistortion)
+    // The matches of the previous iteration are kept when the pose barely moved
+    if (nextStep == MatchKeypointsAgain)
     {
-      this->MappingInterpolator = this->InitUndistortionInterpolatorMapping();
-    }
+      // clear all keypoints matching data
+      this->ResetDistanceParameters();
+      this->Profile.MappingMatchings++;
 
-    // Rotation and position at this step
-    Eigen::Matrix3d R = GetRotationMatrix(this->Tworld);
-    Eigen::Vector3d T;
-    T << this->Tworld(3), this->Tworld(4), this->Tworld(5);
+      // Init the undistortion interpolator
+      if (this->Undistortion)
+      {
+        this->InitUndistortionMapping();
+      }
 
-    // loop over edges
-    for (unsigned int edgeIndex = 0; edgeIndex < this->CurrentEdgesPoints->size(); ++edgeIndex)
-    {
-      currentPoint = this->CurrentEdgesPoints->points[edgeIndex];
+      // Rotation and position at this step
+      Eigen::Matrix3d R = GetRotationMatrix(this->Tworld);
+      Eigen::Vector3d T;
+      T << this->Tworld(3), this->Tworld(4), this->Tworld(5);
 
-      if (this->CurrentEdgesPoints->size() > 0 && subEdgesPointsLocalMap->points.size() > 10)
+      // match the edges
+      if (this->Frame->CurrentEdgesPoints->size() > 0 && edgesMapSize > 10)
       {
         // Find the closest correspondence edge line of the current edge point
-        int rejectionIndex = this->ComputeLineDistanceParameters(kdtreeEdges, R, T, currentPoint, "mapping");
-        this->EdgePointRejectionMapping[edgeIndex] = rejectionIndex;
-        this->MatchRejectionHistogramLine[rejectionIndex] += 1;
+        const pcl::PointCloud<Point>& keypoints = coarse ? coarseEdges : *this->Frame->CurrentEdgesPoints;
+        const KnnBatchSearch* neighbors = coarse ? nullptr : this->SearchNeighbors(*this->EdgesNeighbors,
+          keypoints, R, T, *this->MappingPoses, this->MappingLineDistanceNbrNeighbors);
+        const pcl::search::Search<Point>::Ptr& search = coarse ? kdtreeCoarseEdges : kdtreeEdges;
+        this->MatchKeypoints(keypoints,
+          [&](const Point& keypoint, KeypointMatches& matches) {
+            return this->ComputeLineDistanceParameters(search, R, T, keypoint, "mapping", matches,
+                                                       neighbors, &keypoint - keypoints.points.data());
+          },
+          coarse ? nullptr : this->GetRejectionsOutput(this->Frame->EdgePointRejectionMapping), &this->MatchRejectionHistogramLine);
         usedEdges = this->Xvalues.size();
       }
-    }
-
-    // loop over surfaces
-    for (unsigned int planarIndex = 0; planarIndex < this->CurrentPlanarsPoints->size(); ++planarIndex)
-    {
-      currentPoint = this->CurrentPlanarsPoints->points[planarIndex];
 
-      if (this->CurrentPlanarsPoints->size() > 0 && subPlanarPointsLocalMap->size() > 10)
+      // match the surfaces
+      if (this->Frame->CurrentPlanarsPoints->size() > 0 && planarsMapSize > 10)
       {
         // Find the closest correspondence plane of the current planar point
-        int rejectionIndex = this->ComputePlaneDistanceParameters(kdtreePlanes, R, T, currentPoint, "mapping");
-        this->PlanarPointRejectionMapping[planarIndex] = rejectionIndex;
-        this->MatchRejectionHistogramPlane[rejectionIndex] += 1;
+        const pcl::PointCloud<Point>& keypoints = coarse ? coarsePlanars : *this->Frame->CurrentPlanarsPoints;
+        const KnnBatchSearch* neighbors = coarse ? nullptr : this->SearchNeighbors(*this->PlanarsNeighbors,
+          keypoints, R, T, *this->MappingPoses, this->MappingPlaneDistanceNbrNeighbors);
+        const pcl::search::Search<Point>::Ptr& search = coarse ? kdtreeCoarsePlanes : kdtreePlanes;
+        this->MatchKeypoints(keypoints,
+          [&](const Point& keypoint, KeypointMatches& matches) {
+            return this->ComputePlaneDistanceParameters(search, R, T, keypoint, "mapping", matches,
+                                                        neighbors, &keypoint - keypoints.points.data());
+          },
+          coarse ? nullptr : this->GetRejectionsOutput(this->Frame->PlanarPointRejectionMapping), &this->MatchRejectionHistogramPlane);
         usedPlanes = this->Xvalues.size() - usedEdges;
       }
-    }
 
-    if (!this->FastSlam && this->NbrFrameProcessed > 10)
-    {
-      // loop over blobs
-      for (unsigned int blobIndex = 0; blobIndex < this->CurrentBlobsPoints->size(); ++blobIndex)
+      if (!coarse && !this->FastSlam && this->NbrFrameProcessed > 10 && this->Frame->CurrentBlobsPoints->size() > 0)
       {
-        currentPoint = this->CurrentBlobsPoints->points[blobIndex];
-
-        // Find the closest correspondence plane of the current planar point
-        this->ComputeBlobsDistanceParameters(kdtreeBlobs, R, T, currentPoint, "mapping");
+        // match the blobs
+        this->MatchKeypoints(*this->Frame->CurrentBlobsPoints,
+          [&](const Point& keypoint, KeypointMatches& matches) {
+            return this->ComputeBlobsDistanceParameters(kdtreeBlobs, R, T, keypoint, "mapping", matches);
+          },
+          nullptr, nullptr);
         usedBlobs = this->Xvalues.size() - usedPlanes - usedEdges;
       }
-    }
 
-    // Skip this frame if there is too few geometric keypoints matched
-    if ((usedPlanes + usedEdges + usedBlobs) < 20)
-    {
-      vtkGenericWarningMacro("Too few geometric features, loop breaked");
-      std::cout << "planes: " << usedPlanes << " edges: " << usedEdges << " Blobs: " << usedBlobs << std::endl;
-      break;
+      // Skip this frame if there is too few geometric keypoints matched,
+      // the coarse matching falls back to the full resolution instead
+      if ((usedPlanes + usedEdges + usedBlobs) < 20 && coarse)
+      {
+        coarseIterations = 0;
+        continue;
+      }
+      if ((usedPlanes + usedEdges + usedBlobs) < 20)
+      {
+        vtkGenericWarningMacro("Too few geometric features, loop breaked");
+        break;
+      }
     }
 
-    // Get the previous sensor pose
-    Eigen::Matrix3d R0 = GetRotationMatrix(this->PreviousTworld);
+    // Get the previous sensor position, the distortion
+    // only interpolates the translation
     Eigen::Vector3d T0; T0 << this->PreviousTworld[3], this->PreviousTworld[4], this->PreviousTworld[5];
 
     // We want to estimate our 6-DOF parameters using a non
     // linear least square minimization. The non linear part
     // comes from the Euler Angle parametrization of the rotation
     // endomorphism SO(3). To minimize it we use CERES to perform
-    // the Levenberg-Marquardt algorithm.
-    ceres::Problem problem;
-    for (unsigned int k = 0; k < Xvalues.size(); ++k)
-    {
-      if (this->Undistortion)
-      {
-        ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::MahalanobisDistanceLinearDistortionResidual, 1, 6>(
-                                              new CostFunctions::MahalanobisDistanceLinearDistortionResidual(
-                                                this->Avalues[k], this->Pvalues[k], this->Xvalues[k], T0, R0,
-                                                this->TimeValues[k], this->residualCoefficient[k]));
-        problem.AddResidualBlock(cost_function, new ceres::ArctanLoss(2.0), this->Tworld.data());
-      }
-      else
-      {
-        ceres::CostFunction* cost_function = new ceres::AutoDiffCostFunction<CostFunctions::MahalanobisDistanceAffineIsometryResidual, 1, 6>(
-                                             new CostFunctions::MahalanobisDistanceAffineIsometryResidual(this->Avalues[k], this->Pvalues[k],
-                                                                                                          this->Xvalues[k], this->residualCoefficient[k]));
-        problem.AddResidualBlock(cost_function, new ceres::ArctanLoss(2.0), this->Tworld.data());
-      }
-    }
+    // the Levenberg-Marquardt algorithm. All the matches are
+    // evaluated by a single residual block with analytic jacobians
+    const Eigen::Matrix<double, 6, 1> previousTworld = this->Tworld;
+    residuals.SetMatches(this->Avalues, this->Pvalues, this->Xvalues,
+                         this->Undistortion ? &this->TimeValues : nullptr,
+                         this->residualCoefficient, T0);
+    ceres::Problem problem(problemOptions);
+    problem.AddResidualBlock(&residuals, nullptr, this->Tworld.data());
 
     ceres::Solver::Options options;
     options.max_num_iterations = this->MappingLMMaxIter;
@@ -2591,12 +3918,27 @@ void vtkSlam::Mapping()
 
     ceres::Solver::Summary summary;
     ceres::Solve(options, &problem, &summary);
-    std::cout << summary.BriefReport() << std::endl;
+    this->Profile.MappingICPIterations++;
+    this->Profile.MappingLMIterations += summary.num_successful_steps + summary.num_unsuccessful_steps;
+    nextStep = this->GetNextICPStep(previousTworld, this->Tworld, summary.initial_cost,
+      summary.final_cost, summary.termination_type == ceres::CONVERGENCE);
+
+    // The coarse iterations only bring the pose closer,
+    // the keypoints are then matched at full resolution
+    if (coarse)
+    {
+      nextStep = MatchKeypointsAgain;
+      continue;
+    }
 
     // If no L-M iteration has been made since the
     // last ICP matching it means we reached a local
-    // minimum for the ICP-LM algorithm
-    if (summary.num_successful_steps == 1)
+    // minimum for the ICP-LM algorithm, the loop also
+    // stops once the pose update becomes negligible.
+    // The estimation also stops at the last iteration
+    // or, in real-time mode, once the frame budget is spent
+    if (summary.num_successful_steps == 1 || nextStep == ICPConverged ||
+        icpCount + 1 == this->MappingICPMaxIter || this->IsFrameOverBudget(1.0))
     {
       // Now evaluate the quality of the parameters
       // estimated using an approximate computation
@@ -2620,8 +3962,12 @@ void vtkSlam::Mapping()
       }
   }
 
-  // Provide information about keypoints-neighborhood matching rejections
-  this->RejectionInformationDisplay();
+  // Keep the keypoints-neighborhood matching rejections of the last iteration
+  if (this->Profiling)
+  {
+    this->Profile.MappingLineRejections = this->MatchRejectionHistogramLine;
+    this->Profile.MappingPlaneRejections = this->MatchRejectionHistogramPlane;
+  }
 
   Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(estimatorCovariance);
   Eigen::MatrixXd D = eig.eigenvalues();
@@ -2632,219 +3978,595 @@ void vtkSlam::Mapping()
   static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: blobs used"))->InsertNextValue(usedBlobs);
   static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: total keypoints used"))->InsertNextValue(this->Xvalues.size());
 
-  std::cout << "Matches used: Total: " << this->Xvalues.size()
-            << " edges: " << usedEdges << " planes: " << usedPlanes << " blobs: " << usedBlobs << std::endl;
-  std::cout << "Covariance Eigen values: " << D.transpose() << std::endl;
-  std::cout << "Maximum variance: " << D(5) << std::endl;
-
   // Add the current computed transform to the list
   this->TworldList.push_back(this->Tworld);
 
   // Update the PreviousTworld data
   this->PreviousTworld = this->Tworld;
 
-  // update maps
-  this->UpdateMapsUsingTworld();
+  // update maps, with the keyframes only unless the frames are only localized
+  const size_t numberOfKeypoints =
+    this->Frame->CurrentEdgesPoints->size() + this->Frame->CurrentPlanarsPoints->size();
+  const double overlap = numberOfKeypoints > 0 ?
+    static_cast<double>(usedEdges + usedPlanes) / numberOfKeypoints : 0.0;
+  if ((!this->UpdateMap && this->InitialMapFile) || this->IsMapKeyframe(overlap))
+  {
+    this->UpdateMapsUsingTworld();
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSlam::IsMapKeyframe(double overlap) const
+{
+  if ((this->MapKeyframeDistance <= 0.0 && this->MapKeyframeAngle <= 0.0) ||
+      overlap < this->MapKeyframeMinOverlap)
+  {
+    return true;
+  }
+  const double distance = (this->Tworld.tail(3) - this->LastMapKeyframeTworld.tail(3)).norm();
+  const Eigen::Matrix3d rotation =
+    GetRotationMatrix(this->LastMapKeyframeTworld).transpose() * GetRotationMatrix(this->Tworld);
+  const double angle = vtkMath::DegreesFromRadians(Eigen::AngleAxisd(rotation).angle());
+  return (this->MapKeyframeDistance > 0.0 && distance >= this->MapKeyframeDistance) ||
+         (this->MapKeyframeAngle > 0.0 && angle >= this->MapKeyframeAngle);
 }
 
 //-----------------------------------------------------------------------------
 void vtkSlam::UpdateMapsUsingTworld()
 {
+  VV_TRACE_SCOPE("vtkSlam::UpdateMapsUsingTworld");
+  this->LastMapKeyframeTworld = this->Tworld;
+  // Localization only, the grids roll to load the initial map
+  if (!this->UpdateMap && this->InitialMapFile)
+  {
+    this->EdgesPointsLocalMap->Roll(this->Tworld);
+    this->PlanarPointsLocalMap->Roll(this->Tworld);
+    this->BlobsPointsLocalMap->Roll(this->Tworld);
+    this->UpdateMapsMemory();
+    return;
+  }
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  this->Profile.MapKeyframe = true;
+
   // Init the mapping interpolator
   if (this->Undistortion)
   {
-    this->MappingInterpolator = this->InitUndistortionInterpolatorMapping();
+    this->InitUndistortionMapping();
   }
 
   // Update EdgeMap
-  pcl::PointCloud<Point>::Ptr MapEdgesPoints(new pcl::PointCloud<Point>());
-  for (unsigned int i = 0; i < this->CurrentEdgesPoints->size(); ++i)
-  {
-    MapEdgesPoints->push_back(this->CurrentEdgesPoints->at(i));
-    this->TransformToWorld(MapEdgesPoints->at(i));
-  }
+  pcl::PointCloud<Point>::Ptr MapEdgesPoints(new pcl::PointCloud<Point>(*this->Frame->CurrentEdgesPoints));
+  this->TransformToWorld(*MapEdgesPoints);
   EdgesPointsLocalMap->Roll(this->Tworld);
   EdgesPointsLocalMap->Add(MapEdgesPoints);
 
-  // Update PlanarMap
-  pcl::PointCloud<Point>::Ptr MapPlanarsPoints(new pcl::PointCloud<Point>());
-  for (unsigned int i = 0; i < this->CurrentPlanarsPoints->size(); ++i)
+  // Update PlanarMap
+  pcl::PointCloud<Point>::Ptr MapPlanarsPoints(new pcl::PointCloud<Point>(*this->Frame->CurrentPlanarsPoints));
+  this->TransformToWorld(*MapPlanarsPoints);
+  PlanarPointsLocalMap->Roll(this->Tworld);
+  PlanarPointsLocalMap->Add(MapPlanarsPoints);
+
+  // Update BlobsMap. The all current frame is added
+  if (!this->FastSlam)
+  {
+    pcl::PointCloud<Point>::Ptr MapBlobsPoints(new pcl::PointCloud<Point>(*this->Frame->pclCurrentFrame));
+    this->TransformToWorld(*MapBlobsPoints);
+    BlobsPointsLocalMap->Roll(this->Tworld);
+    BlobsPointsLocalMap->Add(MapBlobsPoints);
+  }
+  this->UpdateMapsMemory();
+  this->Profile.MapUpdateTime = std::chrono::duration_cast<std::chrono::duration<double> >(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::UpdateMapsMemory()
+{
+  const size_t size = this->EdgesPointsLocalMap->GetMemorySize() +
+    this->PlanarPointsLocalMap->GetMemorySize() + this->BlobsPointsLocalMap->GetMemorySize();
+  this->MapsMemory.Set(static_cast<unsigned long>(size / 1024));
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::FillMappingInfoArrayWithDefaultValues()
+{
+  static_cast<vtkDoubleArray*>(this->Trajectory->GetPointData()->GetArray("Variance Error"))->InsertNextValue(10.0);
+  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: edges used"))->InsertNextValue(0);
+  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: planes used"))->InsertNextValue(0);
+  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: blobs used"))->InsertNextValue(0);
+  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: total keypoints used"))->InsertNextValue(0);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::FillEgoMotionInfoArrayWithDefaultValues()
+{
+  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("EgoMotion: edges used"))->InsertNextValue(0);
+  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("EgoMotion: planes used"))->InsertNextValue(0);
+  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("EgoMotion: total keypoints used"))->InsertNextValue(0);
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkVelodyneTransformInterpolator> vtkSlam::InitUndistortionInterpolatorEgoMotion()
+{
+  vtkSmartPointer<vtkVelodyneTransformInterpolator> resultInterp = vtkSmartPointer<vtkVelodyneTransformInterpolator>::New();
+  resultInterp->SetInterpolationTypeToLinear();
+
+  // Transforms representing the passage from the
+  // referential of the sensor at time t0 resp t1
+  // to the referential of the sensor at the time 0
+  vtkNew<vtkTransform> transform0, transform1;
+
+  // transform 0 is identity
+  transform0->Identity();
+  transform0->Modified();
+  transform0->Update();
+
+  // transform 1 is the delta transform
+  // between T0 and T1 computed in the EgoMotion
+  // i.e Trelative
+  Eigen::Matrix3d R = GetRotationMatrix(this->Trelative);
+  Eigen::Vector3d T;
+  T << this->Trelative(3), this->Trelative(4), this->Trelative(5);
+
+  vtkNew<vtkMatrix4x4> M;
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    for (unsigned int j = 0; j < 3; ++j)
+    {
+      M->Element[i][j] = R(i, j);
+    }
+    M->Element[i][3] = T(i);
+    M->Element[3][i] = 0;
+  }
+  M->Element[3][3] = 1.0;
+
+  transform1->SetMatrix(M.Get());
+  transform1->Modified();
+  transform1->Update();
+
+  // Add the transforms and update
+  resultInterp->AddTransform(0.0, transform0.GetPointer());
+  resultInterp->AddTransform(1.0, transform1.GetPointer());
+  resultInterp->Modified();
+
+  return resultInterp;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkVelodyneTransformInterpolator> vtkSlam::InitUndistortionInterpolatorMapping()
+{
+  vtkSmartPointer<vtkVelodyneTransformInterpolator> resultInterp = vtkSmartPointer<vtkVelodyneTransformInterpolator>::New();
+  resultInterp->SetInterpolationTypeToLinear();
+
+  // Transforms representing the passage from the
+  // referential of the sensor at time t0 resp t1
+  // to the referential of the sensor at the time 0
+  vtkNew<vtkTransform> transform0, transform1;
+
+  // transform 1 is the delta transform
+  // between T0 and T1
+  Eigen::Matrix3d R0, R1;
+  R0 = GetRotationMatrix(this->PreviousTworld);
+  R1 = GetRotationMatrix(this->Tworld);
+
+  Eigen::Vector3d T0, T1;
+  T0 << this->PreviousTworld(3), this->PreviousTworld(4), this->PreviousTworld(5);
+  T1 << this->Tworld(3), this->Tworld(4), this->Tworld(5);
+
+  vtkNew<vtkMatrix4x4> M0, M1;
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    for (unsigned int j = 0; j < 3; ++j)
+    {
+      M0->Element[i][j] = R0(i, j);
+      M1->Element[i][j] = R1(i, j);
+    }
+    M0->Element[i][3] = T0(i);
+    M0->Element[3][i] = 0;
+    M1->Element[i][3] = T1(i);
+    M1->Element[3][i] = 0;
+  }
+  M0->Element[3][3] = 1.0;
+  M1->Element[3][3] = 1.0;
+
+  transform0->SetMatrix(M0.Get());
+  transform0->Modified();
+  transform0->Update();
+
+  transform1->SetMatrix(M1.Get());
+  transform1->Modified();
+  transform1->Update();
+
+  // Add the transforms and update
+  resultInterp->AddTransform(0.0, transform0.GetPointer());
+  resultInterp->AddTransform(1.0, transform1.GetPointer());
+  resultInterp->Modified();
+
+  return resultInterp;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::InitUndistortionEgoMotion()
+{
+  this->EgoMotionInterpolator = this->InitUndistortionInterpolatorEgoMotion();
+  this->EgoMotionPoses->Sample(this->EgoMotionInterpolator);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::InitUndistortionMapping()
+{
+  this->MappingInterpolator = this->InitUndistortionInterpolatorMapping();
+  this->MappingPoses->Sample(this->MappingInterpolator);
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::ExpressPointInOtherReferencial(Point& p, const UndistortionPoses& poses)
+{
+  poses.Transform(p);
+}
+
+//-----------------------------------------------------------------------------
+const KnnBatchSearch* vtkSlam::SearchNeighbors(KnnBatchSearch& neighbors, const pcl::PointCloud<Point>& keypoints,
+                                               const Eigen::Matrix3d& R, const Eigen::Vector3d& dT,
+                                               const UndistortionPoses& poses, unsigned int k)
+{
+  if (this->NeighborSearchBackend <= 0)
+  {
+    return nullptr;
+  }
+
+  pcl::PointCloud<Point> queries = keypoints;
+  for (Point& p : queries.points)
+  {
+    if (this->Undistortion)
+    {
+      poses.Transform(p);
+    }
+    else
+    {
+      const Eigen::Vector3d P = R * Eigen::Vector3d(p.x, p.y, p.z) + dT;
+      p.x = P(0); p.y = P(1); p.z = P(2);
+    }
+  }
+  neighbors.SetNumberOfThreads(this->GetMaximumNumberOfThreads());
+  neighbors.Search(queries, k);
+  return &neighbors;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::TransformToWorld(pcl::PointCloud<Point>& cloud)
+{
+  // The rigid transform is computed once for all the points
+  const Eigen::Matrix3d R = GetRotationMatrix(this->Tworld);
+  const Eigen::Vector3d T = this->Tworld.tail(3);
+  auto transformRange = [&](size_t begin, size_t end) {
+    for (size_t index = begin; index < end; ++index)
+    {
+      Point& p = cloud.points[index];
+      if (this->Undistortion)
+      {
+        this->MappingPoses->Transform(p);
+      }
+      else
+      {
+        const Eigen::Vector3d P = R * Eigen::Vector3d(p.x, p.y, p.z) + T;
+        p.x = P(0); p.y = P(1); p.z = P(2);
+      }
+    }
+  };
+
+  const size_t numberOfPoints = cloud.size();
+  const size_t numberOfThreads = std::max<size_t>(1,
+    std::min<size_t>(this->GetMaximumNumberOfThreads(), numberOfPoints / (16 * MinimumKeypointsPerThread)));
+  const size_t rangeSize = (numberOfPoints + numberOfThreads - 1) / numberOfThreads;
+  boost::thread_group threads;
+  for (size_t range = 1; range < numberOfThreads; ++range)
+  {
+    threads.create_thread(std::bind(transformRange, range * rangeSize,
+                                    std::min(numberOfPoints, (range + 1) * rangeSize)));
+  }
+  transformRange(0, std::min(numberOfPoints, rangeSize));
+  threads.join_all();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::ResetDistanceParameters()
+{
+  this->Xvalues.clear();
+  this->Xvalues.resize(0);
+  this->Avalues.clear();
+  this->Avalues.resize(0);
+  this->Pvalues.clear();
+  this->Pvalues.resize(0);
+  this->TimeValues.clear();
+  this->TimeValues.resize(0);
+  this->residualCoefficient.clear();
+  this->residualCoefficient.resize(0);
+  this->RadiusIncertitude.clear();
+  this->RadiusIncertitude.resize(0);
+  this->MatchRejectionHistogramLine.clear();
+  this->MatchRejectionHistogramLine.resize(NrejectionCauses);
+  this->MatchRejectionHistogramPlane.clear();
+  this->MatchRejectionHistogramPlane.resize(NrejectionCauses);
+  this->MatchRejectionHistogramBlob.clear();
+  this->MatchRejectionHistogramBlob.resize(NrejectionCauses);
+}
+
+//-----------------------------------------------------------------------------
+double vtkSlam::GetFrameElapsedTime() const
+{
+  return ElapsedTime(this->FrameStartTime);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkSlam::IsFrameOverBudget(double budgetRatio) const
+{
+  return this->IsRealTime() && this->GetFrameElapsedTime() > budgetRatio * this->FrameTimeBudget;
+}
+
+//-----------------------------------------------------------------------------
+vtkSlam::ICPStep vtkSlam::GetNextICPStep(const Eigen::Matrix<double, 6, 1>& previousPose,
+  const Eigen::Matrix<double, 6, 1>& pose, double initialCost, double finalCost,
+  bool solverConverged) const
+{
+  const double translation = (pose.tail(3) - previousPose.tail(3)).norm();
+  const Eigen::Matrix3d rotation =
+    GetRotationMatrix(previousPose).transpose() * GetRotationMatrix(pose);
+  const double angle = vtkMath::DegreesFromRadians(Eigen::AngleAxisd(rotation).angle());
+  if ((translation <= this->ICPConvergenceTranslation && angle <= this->ICPConvergenceAngle) ||
+      (initialCost > 0.0 && initialCost - finalCost <= this->ICPConvergenceCostDecrease * initialCost))
+  {
+    return ICPConverged;
+  }
+  if (!solverConverged && translation <= MatchReuseFactor * this->ICPConvergenceTranslation &&
+      angle <= MatchReuseFactor * this->ICPConvergenceAngle)
+  {
+    return ReuseMatches;
+  }
+  return MatchKeypointsAgain;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::UpdateRealTimeSampling(double frameTime)
+{
+  if (!this->IsRealTime())
+  {
+    this->KeypointsSamplingStep = 1;
+    this->LastFrameOverBudget = false;
+    return;
+  }
+
+  // Take fewer keypoints as long as the frames are too long, and more
+  // again once they leave enough slack to avoid oscillating
+  this->LastFrameOverBudget = frameTime > this->FrameTimeBudget;
+  if (this->LastFrameOverBudget && this->KeypointsSamplingStep < MaximumKeypointsSamplingStep)
+  {
+    this->KeypointsSamplingStep++;
+  }
+  else if (frameTime < RealTimeSlackRatio * this->FrameTimeBudget && this->KeypointsSamplingStep > 1)
+  {
+    this->KeypointsSamplingStep--;
+  }
+}
+
+//-----------------------------------------------------------------------------
+unsigned int vtkSlam::GetMaximumNumberOfThreads() const
+{
+  return this->NumberOfThreads > 0 ? static_cast<unsigned int>(this->NumberOfThreads)
+                                   : std::max(1u, boost::thread::hardware_concurrency());
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::ForEachScanLine(const std::function<void(unsigned int)>& processScanLine)
+{
+  // the scan lines do not have the same number of points, each
+  // thread takes the next one to process once it is done
+  std::atomic<unsigned int> nextScanLine(0);
+  auto processScanLines = [&]() {
+    for (unsigned int scanLine = nextScanLine++; scanLine < this->NLasers; scanLine = nextScanLine++)
+    {
+      processScanLine(scanLine);
+    }
+  };
+
+  const unsigned int numberOfThreads = std::min(this->GetMaximumNumberOfThreads(), this->NLasers);
+  boost::thread_group threads;
+  for (unsigned int thread = 1; thread < numberOfThreads; ++thread)
+  {
+    threads.create_thread(processScanLines);
+  }
+  processScanLines();
+  threads.join_all();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::MatchKeypoints(const pcl::PointCloud<Point>& keypoints,
+                             const std::function<int(const Point&, KeypointMatches&)>& matchKeypoint,
+                             std::vector<int>* rejections, std::vector<double>* histogram)
+{
+  const size_t numberOfKeypoints = keypoints.size();
+  const size_t numberOfThreads = std::max<size_t>(1,
+    std::min<size_t>(this->GetMaximumNumberOfThreads(), numberOfKeypoints / MinimumKeypointsPerThread));
+  const size_t rangeSize = (numberOfKeypoints + numberOfThreads - 1) / numberOfThreads;
+
+  // each range has its own matches and histogram, the rejection causes are
+  // stored at the index of their keypoint. They are kept by the scratch
+  // to reuse their memory
+  std::vector<KeypointMatches>& matches = this->Scratch.ThreadMatches;
+  std::vector<std::vector<double> >& histograms = this->Scratch.ThreadHistograms;
+  if (matches.size() < numberOfThreads)
+  {
+    matches.resize(numberOfThreads);
+    histograms.resize(numberOfThreads);
+  }
+  for (size_t range = 0; range < numberOfThreads; ++range)
+  {
+    matches[range].Clear();
+    histograms[range].assign(histogram ? histogram->size() : 0, 0);
+  }
+  auto matchRange = [&](size_t range) {
+    const size_t end = std::min(numberOfKeypoints, (range + 1) * rangeSize);
+    for (size_t index = range * rangeSize; index < end; ++index)
+    {
+      const int rejectionIndex = matchKeypoint(keypoints.points[index], matches[range]);
+      if (rejections)
+      {
+        (*rejections)[index] = rejectionIndex;
+      }
+      if (histogram)
+      {
+        histograms[range][rejectionIndex] += 1;
+      }
+    }
+  };
+
+  boost::thread_group threads;
+  for (size_t range = 1; range < numberOfThreads; ++range)
   {
-    MapPlanarsPoints->push_back(this->CurrentPlanarsPoints->at(i));
-    this->TransformToWorld(MapPlanarsPoints->at(i));
+    threads.create_thread(std::bind(matchRange, range));
   }
-  PlanarPointsLocalMap->Roll(this->Tworld);
-  PlanarPointsLocalMap->Add(MapPlanarsPoints);
+  matchRange(0);
+  threads.join_all();
 
-  // Update BlobsMap. The all current frame is added
-  if (!this->FastSlam)
+  // merge in the keypoints order
+  for (size_t range = 0; range < numberOfThreads; ++range)
   {
-    pcl::PointCloud<Point>::Ptr MapBlobsPoints(new pcl::PointCloud<Point>());
-    for (unsigned int i = 0; i < this->pclCurrentFrame->size(); ++i)
+    const KeypointMatches& rangeMatches = matches[range];
+    this->Avalues.insert(this->Avalues.end(), rangeMatches.Avalues.begin(), rangeMatches.Avalues.end());
+    this->Pvalues.insert(this->Pvalues.end(), rangeMatches.Pvalues.begin(), rangeMatches.Pvalues.end());
+    this->Xvalues.insert(this->Xvalues.end(), rangeMatches.Xvalues.begin(), rangeMatches.Xvalues.end());
+    this->RadiusIncertitude.insert(this->RadiusIncertitude.end(),
+      rangeMatches.RadiusIncertitude.begin(), rangeMatches.RadiusIncertitude.end());
+    this->residualCoefficient.insert(this->residualCoefficient.end(),
+      rangeMatches.residualCoefficient.begin(), rangeMatches.residualCoefficient.end());
+    this->TimeValues.insert(this->TimeValues.end(),
+      rangeMatches.TimeValues.begin(), rangeMatches.TimeValues.end());
+    if (histogram)
     {
-      MapBlobsPoints->push_back(this->pclCurrentFrame->at(i));
-      this->TransformToWorld(MapBlobsPoints->at(i));
+      for (size_t k = 0; k < histogram->size(); ++k)
+      {
+        (*histogram)[k] += histograms[range][k];
+      }
     }
-    BlobsPointsLocalMap->Roll(this->Tworld);
-    BlobsPointsLocalMap->Add(MapBlobsPoints);
   }
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::FillMappingInfoArrayWithDefaultValues()
+void vtkSlam::AddImuMeasurement(double time, const double angularVelocity[3], const double acceleration[3])
 {
-  static_cast<vtkDoubleArray*>(this->Trajectory->GetPointData()->GetArray("Variance Error"))->InsertNextValue(10.0);
-  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: edges used"))->InsertNextValue(0);
-  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: planes used"))->InsertNextValue(0);
-  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: blobs used"))->InsertNextValue(0);
-  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("Mapping: total keypoints used"))->InsertNextValue(0);
+  if (!this->Imu)
+  {
+    this->Imu.reset(new ImuPreintegration());
+  }
+  this->Imu->AddMeasurement(time, Eigen::Vector3d(angularVelocity), Eigen::Vector3d(acceleration));
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::FillEgoMotionInfoArrayWithDefaultValues()
+void vtkSlam::ClearImuMeasurements()
 {
-  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("EgoMotion: edges used"))->InsertNextValue(0);
-  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("EgoMotion: planes used"))->InsertNextValue(0);
-  static_cast<vtkIntArray*>(this->Trajectory->GetPointData()->GetArray("EgoMotion: total keypoints used"))->InsertNextValue(0);
+  this->Imu.reset();
+  this->LastImuSourceTime = -std::numeric_limits<double>::infinity();
+  this->LastImuFrameTime = -std::numeric_limits<double>::infinity();
 }
 
 //-----------------------------------------------------------------------------
-vtkSmartPointer<vtkVelodyneTransformInterpolator> vtkSlam::InitUndistortionInterpolatorEgoMotion()
+void vtkSlam::SetImuBuffer(std::shared_ptr<ImuBuffer> buffer)
 {
-  vtkSmartPointer<vtkVelodyneTransformInterpolator> resultInterp = vtkSmartPointer<vtkVelodyneTransformInterpolator>::New();
-  resultInterp->SetInterpolationTypeToLinear();
-
-  // Transforms representing the passage from the
-  // referential of the sensor at time t0 resp t1
-  // to the referential of the sensor at the time 0
-  vtkNew<vtkTransform> transform0, transform1;
-
-  // transform 0 is identity
-  transform0->Identity();
-  transform0->Modified();
-  transform0->Update();
-
-  // transform 1 is the delta transform
-  // between T0 and T1 computed in the EgoMotion
-  // i.e Trelative
-  Eigen::Matrix3d R = GetRotationMatrix(this->Trelative);
-  Eigen::Vector3d T;
-  T << this->Trelative(3), this->Trelative(4), this->Trelative(5);
-
-  vtkNew<vtkMatrix4x4> M;
-  for (unsigned int i = 0; i < 3; ++i)
+  if (buffer != this->ImuSource)
   {
-    for (unsigned int j = 0; j < 3; ++j)
-    {
-      M->Element[i][j] = R(i, j);
-    }
-    M->Element[i][3] = T(i);
-    M->Element[3][i] = 0;
+    this->ImuSource = buffer;
+    this->ClearImuMeasurements();
   }
-  M->Element[3][3] = 1.0;
-
-  transform1->SetMatrix(M.Get());
-  transform1->Modified();
-  transform1->Update();
-
-  // Add the transforms and update
-  resultInterp->AddTransform(0.0, transform0.GetPointer());
-  resultInterp->AddTransform(1.0, transform1.GetPointer());
-  resultInterp->Modified();
-
-  return resultInterp;
 }
 
 //-----------------------------------------------------------------------------
-vtkSmartPointer<vtkVelodyneTransformInterpolator> vtkSlam::InitUndistortionInterpolatorMapping()
+void vtkSlam::PullImuMeasurements()
 {
-  vtkSmartPointer<vtkVelodyneTransformInterpolator> resultInterp = vtkSmartPointer<vtkVelodyneTransformInterpolator>::New();
-  resultInterp->SetInterpolationTypeToLinear();
-
-  // Transforms representing the passage from the
-  // referential of the sensor at time t0 resp t1
-  // to the referential of the sensor at the time 0
-  vtkNew<vtkTransform> transform0, transform1;
-
-  // transform 1 is the delta transform
-  // between T0 and T1
-  Eigen::Matrix3d R0, R1;
-  R0 = GetRotationMatrix(this->PreviousTworld);
-  R1 = GetRotationMatrix(this->Tworld);
-
-  Eigen::Vector3d T0, T1;
-  T0 << this->PreviousTworld(3), this->PreviousTworld(4), this->PreviousTworld(5);
-  T1 << this->Tworld(3), this->Tworld(4), this->Tworld(5);
-
-  vtkNew<vtkMatrix4x4> M0, M1;
-  for (unsigned int i = 0; i < 3; ++i)
+  if (!this->ImuSource)
   {
-    for (unsigned int j = 0; j < 3; ++j)
-    {
-      M0->Element[i][j] = R0(i, j);
-      M1->Element[i][j] = R1(i, j);
-    }
-    M0->Element[i][3] = T0(i);
-    M0->Element[3][i] = 0;
-    M1->Element[i][3] = T1(i);
-    M1->Element[3][i] = 0;
+    return;
   }
-  M0->Element[3][3] = 1.0;
-  M1->Element[3][3] = 1.0;
-
-  transform0->SetMatrix(M0.Get());
-  transform0->Modified();
-  transform0->Update();
-
-  transform1->SetMatrix(M1.Get());
-  transform1->Modified();
-  transform1->Update();
+  // the frames went back in time, the measurements are taken again from the buffer
+  if (this->Frame->Time < this->LastImuFrameTime)
+  {
+    this->ClearImuMeasurements();
+  }
+  this->LastImuFrameTime = this->Frame->Time;
 
-  // Add the transforms and update
-  resultInterp->AddTransform(0.0, transform0.GetPointer());
-  resultInterp->AddTransform(1.0, transform1.GetPointer());
-  resultInterp->Modified();
+  // the measurements just after the frame are needed to interpolate at its time
+  std::vector<ImuBuffer::Sample> samples;
+  this->ImuSource->GetSamples(this->LastImuSourceTime, this->Frame->Time + 1.0, samples);
+  for (const ImuBuffer::Sample& sample : samples)
+  {
+    this->AddImuMeasurement(sample.Time, sample.AngularVelocity.data(), sample.Acceleration.data());
+  }
+  if (!samples.empty())
+  {
+    this->LastImuSourceTime = samples.back().Time;
+  }
+}
 
-  return resultInterp;
+//-----------------------------------------------------------------------------
+void vtkSlam::AddSensorExtrinsic(double rx, double ry, double rz, double x, double y, double z)
+{
+  this->SensorExtrinsics.push_back({{ rx, ry, rz, x, y, z }});
+  this->Modified();
+  this->ParametersModificationTime.Modified();
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::ExpressPointInOtherReferencial(Point& p, vtkSmartPointer<vtkVelodyneTransformInterpolator> transform)
+void vtkSlam::ClearSensorExtrinsics()
 {
-  // interpolate the transform
-  vtkNew<vtkTransform> currTransform;
-  transform->InterpolateTransform(p.intensity, currTransform.GetPointer());
-  currTransform->Modified();
-  currTransform->Update();
+  if (!this->SensorExtrinsics.empty())
+  {
+    this->SensorExtrinsics.clear();
+    this->Modified();
+    this->ParametersModificationTime.Modified();
+  }
+}
 
-  double pos[3] = {p.x, p.y, p.z};
-  currTransform->InternalTransformPoint(pos, pos);
-  p.x = pos[0];
-  p.y = pos[1];
-  p.z = pos[2];
+//-----------------------------------------------------------------------------
+void vtkSlam::SetImuToLidar(double rx, double ry, double rz)
+{
+  if (this->ImuToLidar[0] != rx || this->ImuToLidar[1] != ry || this->ImuToLidar[2] != rz)
+  {
+    this->ImuToLidar[0] = rx;
+    this->ImuToLidar[1] = ry;
+    this->ImuToLidar[2] = rz;
+    this->Modified();
+    this->ParametersModificationTime.Modified();
+  }
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::ResetDistanceParameters()
+bool vtkSlam::ComputeImuPrior(Eigen::Matrix<double, 6, 1>& prior)
 {
-  this->Xvalues.clear();
-  this->Xvalues.resize(0);
-  this->Avalues.clear();
-  this->Avalues.resize(0);
-  this->Pvalues.clear();
-  this->Pvalues.resize(0);
-  this->TimeValues.clear();
-  this->TimeValues.resize(0);
-  this->residualCoefficient.clear();
-  this->residualCoefficient.resize(0);
-  this->RadiusIncertitude.clear();
-  this->RadiusIncertitude.resize(0);
-  this->MatchRejectionHistogramLine.clear();
-  this->MatchRejectionHistogramLine.resize(NrejectionCauses);
-  this->MatchRejectionHistogramPlane.clear();
-  this->MatchRejectionHistogramPlane.resize(NrejectionCauses);
-  this->MatchRejectionHistogramBlob.clear();
-  this->MatchRejectionHistogramBlob.resize(NrejectionCauses);
+  this->PullImuMeasurements();
+  ImuPreintegration::Delta delta;
+  if (!this->Imu || !this->Imu->Integrate(this->PreviousFrameTime, this->Frame->Time, delta))
+  {
+    return false;
+  }
+  const double dt = this->Frame->Time - this->PreviousFrameTime;
+
+  // The IMU deltas are expressed in the lidar referential, the
+  // lever arm between the sensors is neglected
+  Eigen::Matrix<double, 6, 1> imuToLidar;
+  imuToLidar << this->ImuToLidar[0], this->ImuToLidar[1], this->ImuToLidar[2], 0.0, 0.0, 0.0;
+  const Eigen::Matrix3d Ril = GetRotationMatrix(imuToLidar);
+  const Eigen::Matrix3d R = Ril * delta.Rotation * Ril.transpose();
+
+  // Velocity of the previous ego-motion, in the referential of the previous frame
+  Eigen::Vector3d velocity = Eigen::Vector3d::Zero();
+  if (this->PreviousFrameDuration > 0.0)
+  {
+    velocity = GetRotationMatrix(this->Trelative).transpose() * this->Trelative.tail(3) / this->PreviousFrameDuration;
+  }
+  const Eigen::Vector3d T = velocity * dt + Ril * delta.Position;
+
+  prior << std::atan2(R(2, 1), R(2, 2)), -std::asin(R(2, 0)), std::atan2(R(1, 0), R(0, 0)), T;
+  return true;
 }
 
 //-----------------------------------------------------------------------------
@@ -2901,6 +4623,7 @@ void vtkSlam::SetVoxelGridSize(unsigned int size)
   this->EdgesPointsLocalMap->SetSize(size);
   this->PlanarPointsLocalMap->SetSize(size);
   this->BlobsPointsLocalMap->SetSize(size);
+  this->UpdateMapsMemory();
   this->ParametersModificationTime.Modified();
 }
 
@@ -2913,6 +4636,39 @@ void vtkSlam::SetVoxelGridResolution(double resolution)
   this->ParametersModificationTime.Modified();
 }
 
+//-----------------------------------------------------------------------------
+void vtkSlam::SetMappingCoarseICPIter(unsigned int iterations)
+{
+  if (this->MappingCoarseICPIter != iterations)
+  {
+    this->MappingCoarseICPIter = iterations;
+    this->UpdateCoarseMaps();
+    this->Modified();
+    this->ParametersModificationTime.Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::SetCoarseMapLeafFactor(double factor)
+{
+  if (this->CoarseMapLeafFactor != factor)
+  {
+    this->CoarseMapLeafFactor = factor;
+    this->UpdateCoarseMaps();
+    this->Modified();
+    this->ParametersModificationTime.Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::UpdateCoarseMaps()
+{
+  const double factor = this->MappingCoarseICPIter > 0 ? this->CoarseMapLeafFactor : 0.0;
+  this->EdgesPointsLocalMap->SetCoarseLeafFactor(factor);
+  this->PlanarPointsLocalMap->SetCoarseLeafFactor(factor);
+  this->UpdateMapsMemory();
+}
+
 //-----------------------------------------------------------------------------
 void vtkSlam::SetLidarMaximunRange(const double maxRange)
 {
@@ -2922,46 +4678,283 @@ void vtkSlam::SetLidarMaximunRange(const double maxRange)
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::UpdateLaserIdMapping(vtkTable *calib)
+void vtkSlam::UpdateLaserIdMapping(const std::vector<vtkTable*>& calibs)
 {
-  this->NLasers = calib->GetNumberOfRows();
-  auto array = vtkDataArray::SafeDownCast(calib->GetColumnByName("verticalCorrection"));
-  if (array)
+  this->NLasers = 0;
+  this->NumberOfSensors = static_cast<unsigned int>(calibs.size());
+  this->LaserIdMapping.clear();
+  this->ScanLineSensor.clear();
+  for (unsigned int sensor = 0; sensor < calibs.size(); ++sensor)
   {
-    std::vector<double> verticalCorrection;
-    verticalCorrection.resize(array->GetNumberOfTuples());
-    for (int i =0; i < array->GetNumberOfTuples(); ++i)
+    vtkTable* calib = calibs[sensor];
+    const unsigned int offset = this->NLasers;
+    this->NLasers += calib->GetNumberOfRows();
+    this->ScanLineSensor.resize(this->NLasers, sensor);
+    auto array = vtkDataArray::SafeDownCast(calib->GetColumnByName("verticalCorrection"));
+    if (array)
+    {
+      std::vector<double> verticalCorrection;
+      verticalCorrection.resize(array->GetNumberOfTuples());
+      for (int i =0; i < array->GetNumberOfTuples(); ++i)
+      {
+        verticalCorrection[i] = array->GetTuple1(i);
+      }
+      for (size_t id : sortIdx(verticalCorrection))
+      {
+        this->LaserIdMapping.push_back(id + offset);
+      }
+    }
+    else
     {
-      verticalCorrection[i] = array->GetTuple1(i);
+      vtkErrorMacro("<< The calibration data has no colomn named 'verticalCorrection'");
     }
-    this->LaserIdMapping = sortIdx(verticalCorrection);
   }
-  else
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::SetMapExportFileName(const char* filename)
+{
+  const std::string name = filename ? filename : "";
+  if (name != this->MapExportFileName)
+  {
+    this->MapExportFileName = name;
+    this->Modified();
+    this->ParametersModificationTime.Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::SetInitialMapFileName(const char* filename)
+{
+  const std::string name = filename ? filename : "";
+  if (name != this->InitialMapFileName)
+  {
+    this->InitialMapFileName = name;
+    this->Modified();
+    this->ParametersModificationTime.Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::SetInitialPose(double rx, double ry, double rz, double x, double y, double z)
+{
+  const double pose[6] = { rx, ry, rz, x, y, z };
+  if (!std::equal(pose, pose + 6, this->InitialPose))
+  {
+    std::copy(pose, pose + 6, this->InitialPose);
+    this->Modified();
+    this->ParametersModificationTime.Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::OpenMapFiles()
+{
+  // The tiles of the files are the voxels of the grids, with
+  // one map for each kind of keypoints
+  RollingGrid* grids[3] = { this->EdgesPointsLocalMap.get(), this->PlanarPointsLocalMap.get(),
+                            this->BlobsPointsLocalMap.get() };
+  const double tileSize = this->EdgesPointsLocalMap->GetVoxelWorldSize();
+
+  if (!this->InitialMapFileName.empty())
+  {
+    this->InitialMapFile.reset(new SlamMapFile());
+    if (!this->InitialMapFile->OpenForReading(this->InitialMapFileName))
+    {
+      vtkErrorMacro(<< this->InitialMapFile->GetLastError());
+      this->InitialMapFile.reset();
+    }
+    else if (this->InitialMapFile->GetTileSize() != tileSize)
+    {
+      vtkErrorMacro(<< "The initial map has been written with another voxel grid size");
+      this->InitialMapFile.reset();
+    }
+  }
+
+  if (!this->MapExportFileName.empty())
+  {
+    if (this->MapExportFileName == this->InitialMapFileName)
+    {
+      vtkErrorMacro(<< "The map can not be exported to the initial map file");
+    }
+    else
+    {
+      this->MapExportFile.reset(new SlamMapFile());
+      if (!this->MapExportFile->OpenForWriting(this->MapExportFileName, tileSize))
+      {
+        vtkErrorMacro(<< this->MapExportFile->GetLastError());
+        this->MapExportFile.reset();
+      }
+    }
+  }
+
+  for (int map = 0; map < 3; ++map)
+  {
+    if (this->MapExportFile)
+    {
+      SlamMapFile* file = this->MapExportFile.get();
+      grids[map]->SetVoxelLeaveCallback([file, map](const int* index, const pcl::PointCloud<Point>& points) {
+        file->WriteTile(map, index, points);
+      });
+    }
+    if (this->InitialMapFile)
+    {
+      SlamMapFile* file = this->InitialMapFile.get();
+      grids[map]->SetVoxelEnterCallback([file, map](const int* index, pcl::PointCloud<Point>& points) {
+        file->ReadTile(map, index, points);
+      });
+    }
+  }
+
+  // Start at the initial pose, in the voxels of the initial map around it
+  if (this->InitialMapFile)
   {
-    vtkErrorMacro("<< The calibration data has no colomn named 'verticalCorrection'");
+    std::copy(this->InitialPose, this->InitialPose + 6, this->Tworld.data());
+    this->PreviousTworld = this->Tworld;
+    for (RollingGrid* grid : grids)
+    {
+      grid->Roll(this->Tworld);
+      grid->FillVoxels();
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::FinishMapExport()
+{
+  if (!this->MapExportFile)
+  {
+    return;
+  }
+  RollingGrid* grids[3] = { this->EdgesPointsLocalMap.get(), this->PlanarPointsLocalMap.get(),
+                            this->BlobsPointsLocalMap.get() };
+  for (RollingGrid* grid : grids)
+  {
+    grid->FlushModifiedVoxels();
+    grid->SetVoxelLeaveCallback(nullptr);
   }
+  this->MapExportFile->Close();
+  this->MapExportFile.reset();
 }
 
 //-----------------------------------------------------------------------------
-void vtkSlam::RejectionInformationDisplay()
+void vtkSlam::UpdatePoseGraph()
 {
-  double totalRejectionsLine = 0;
-  double totalRejectionsPlane = 0;
-  for (int k = 0; k < this->NrejectionCauses; ++k)
+  if (!this->PoseGraph)
+  {
+    SlamPoseGraph::Parameters parameters;
+    parameters.KeyframeDistance = this->LoopClosureKeyframeDistance;
+    parameters.LoopSearchRadius = this->LoopClosureSearchRadius;
+    parameters.MaxKeyframeClouds = this->LoopClosureMaxKeyframes;
+    this->PoseGraph.reset(new SlamPoseGraph());
+    this->PoseGraph->SetParameters(parameters);
+  }
+
+  this->PoseGraph->AddFrame(this->Frame->Time, this->Tworld,
+                            *this->Frame->CurrentEdgesPoints, *this->Frame->CurrentPlanarsPoints);
+  if (this->WaitForLoopClosure || this->Deterministic)
+  {
+    this->PoseGraph->Flush();
+  }
+
+  std::vector<double> keyframeTimes;
+  std::vector<Eigen::Isometry3d> corrections;
+  if (this->PoseGraph->GetCorrections(keyframeTimes, corrections) && !corrections.empty())
   {
-    totalRejectionsLine += this->MatchRejectionHistogramLine[k];
-    totalRejectionsPlane += this->MatchRejectionHistogramPlane[k];
+    this->CorrectTrajectory(keyframeTimes, corrections);
   }
-  std::cout << "Rejection frequencies lines: [";
-  for (int k = 0; k < this->NrejectionCauses; ++k)
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::CorrectTrajectory(const std::vector<double>& keyframeTimes,
+                                const std::vector<Eigen::Isometry3d>& corrections)
+{
+  // The loop closure may have been enabled after the first frames
+  vtkDataArray* times = this->Trajectory->GetTimeArray();
+  vtkDataArray* orientations = this->Trajectory->GetOrientationArray();
+  vtkDataArray* positions = this->Trajectory->GetTranslationArray();
+  const vtkIdType first = this->Trajectory->GetNumberOfPoints() - static_cast<vtkIdType>(this->OdometryPoses.size());
+
+  // The correction of a frame is interpolated between the keyframes around it
+  size_t keyframe = 0;
+  for (size_t index = 0; index < this->OdometryPoses.size(); ++index)
   {
-    std::cout << this->MatchRejectionHistogramLine[k] / totalRejectionsLine * 100.0 << ", ";
+    const double time = times->GetTuple1(first + index);
+    while (keyframe + 1 < keyframeTimes.size() && keyframeTimes[keyframe + 1] <= time)
+    {
+      keyframe++;
+    }
+    Eigen::Isometry3d correction = corrections[keyframe];
+    if (time > keyframeTimes[keyframe] && keyframe + 1 < keyframeTimes.size())
+    {
+      const double ratio = (time - keyframeTimes[keyframe]) / (keyframeTimes[keyframe + 1] - keyframeTimes[keyframe]);
+      const Eigen::Quaterniond q0(corrections[keyframe].linear());
+      const Eigen::Quaterniond q1(corrections[keyframe + 1].linear());
+      correction.linear() = q0.slerp(ratio, q1).toRotationMatrix();
+      correction.translation() = (1.0 - ratio) * corrections[keyframe].translation()
+                               + ratio * corrections[keyframe + 1].translation();
+    }
+
+    const Eigen::Matrix<double, 6, 1>& pose = this->OdometryPoses[index];
+    const Eigen::AngleAxisd orientation(correction.linear() * GetTrajectoryRotation(pose));
+    const Eigen::Vector3d position = correction * Eigen::Vector3d(pose.tail(3));
+    orientations->SetTuple4(first + index, orientation.axis()[0], orientation.axis()[1],
+                            orientation.axis()[2], orientation.angle());
+    positions->SetTuple(first + index, position.data());
   }
-  std::cout << std::endl;
-  std::cout << "Rejection frequencies planes: [";
-  for (int k = 0; k < this->NrejectionCauses; ++k)
+  orientations->Modified();
+  positions->Modified();
+  this->Trajectory->Modified();
+
+  this->LoopClosureCorrection = corrections.back();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSlam::AppendFrameProfile(double frameTime)
+{
+  vtkTable* table = this->ProfilingTable;
+  if (table->GetNumberOfColumns() == 0)
   {
-    std::cout << this->MatchRejectionHistogramPlane[k] / totalRejectionsPlane * 100.0 << ", ";
+    AddColumn<vtkIntArray>("Frame", 1, table);
+    AddColumn<vtkDoubleArray>("Time: keypoints extraction", 1, table);
+    AddColumn<vtkDoubleArray>("Time: ego-motion", 1, table);
+    AddColumn<vtkDoubleArray>("Time: mapping", 1, table);
+    AddColumn<vtkDoubleArray>("Time: frame", 1, table);
+    AddColumn<vtkIntArray>("Keypoints: edges", 1, table);
+    AddColumn<vtkIntArray>("Keypoints: planes", 1, table);
+    AddColumn<vtkIntArray>("Keypoints: blobs", 1, table);
+    AddColumn<vtkIntArray>("EgoMotion: ICP iterations", 1, table);
+    AddColumn<vtkIntArray>("EgoMotion: LM iterations", 1, table);
+    AddColumn<vtkIntArray>("Mapping: ICP iterations", 1, table);
+    AddColumn<vtkIntArray>("Mapping: LM iterations", 1, table);
+    AddColumn<vtkIntArray>("EgoMotion: matchings", 1, table);
+    AddColumn<vtkIntArray>("Mapping: matchings", 1, table);
+    AddColumn<vtkIntArray>("Mapping: keyframe", 1, table);
+    AddColumn<vtkDoubleArray>("Time: map update", 1, table);
+    AddColumn<vtkDoubleArray>("EgoMotion: lines rejections", this->NrejectionCauses, table);
+    AddColumn<vtkDoubleArray>("EgoMotion: planes rejections", this->NrejectionCauses, table);
+    AddColumn<vtkDoubleArray>("Mapping: lines rejections", this->NrejectionCauses, table);
+    AddColumn<vtkDoubleArray>("Mapping: planes rejections", this->NrejectionCauses, table);
   }
-  std::cout << std::endl;
+
+  static_cast<vtkIntArray*>(table->GetColumnByName("Frame"))->InsertNextValue(this->NbrFrameProcessed - 1);
+  static_cast<vtkDoubleArray*>(table->GetColumnByName("Time: keypoints extraction"))->InsertNextValue(this->Frame->KeypointsTime);
+  static_cast<vtkDoubleArray*>(table->GetColumnByName("Time: ego-motion"))->InsertNextValue(this->Profile.EgoMotionTime);
+  static_cast<vtkDoubleArray*>(table->GetColumnByName("Time: mapping"))->InsertNextValue(this->Profile.MappingTime);
+  static_cast<vtkDoubleArray*>(table->GetColumnByName("Time: frame"))->InsertNextValue(frameTime);
+  static_cast<vtkIntArray*>(table->GetColumnByName("Keypoints: edges"))->InsertNextValue(this->Frame->CurrentEdgesPoints->size());
+  static_cast<vtkIntArray*>(table->GetColumnByName("Keypoints: planes"))->InsertNextValue(this->Frame->CurrentPlanarsPoints->size());
+  static_cast<vtkIntArray*>(table->GetColumnByName("Keypoints: blobs"))->InsertNextValue(this->Frame->CurrentBlobsPoints->size());
+  static_cast<vtkIntArray*>(table->GetColumnByName("EgoMotion: ICP iterations"))->InsertNextValue(this->Profile.EgoMotionICPIterations);
+  static_cast<vtkIntArray*>(table->GetColumnByName("EgoMotion: LM iterations"))->InsertNextValue(this->Profile.EgoMotionLMIterations);
+  static_cast<vtkIntArray*>(table->GetColumnByName("Mapping: ICP iterations"))->InsertNextValue(this->Profile.MappingICPIterations);
+  static_cast<vtkIntArray*>(table->GetColumnByName("Mapping: LM iterations"))->InsertNextValue(this->Profile.MappingLMIterations);
+  static_cast<vtkIntArray*>(table->GetColumnByName("EgoMotion: matchings"))->InsertNextValue(this->Profile.EgoMotionMatchings);
+  static_cast<vtkIntArray*>(table->GetColumnByName("Mapping: matchings"))->InsertNextValue(this->Profile.MappingMatchings);
+  static_cast<vtkIntArray*>(table->GetColumnByName("Mapping: keyframe"))->InsertNextValue(this->Profile.MapKeyframe);
+  static_cast<vtkDoubleArray*>(table->GetColumnByName("Time: map update"))->InsertNextValue(this->Profile.MapUpdateTime);
+  InsertHistogram(this->Profile.EgoMotionLineRejections, this->NrejectionCauses, table->GetColumnByName("EgoMotion: lines rejections"));
+  InsertHistogram(this->Profile.EgoMotionPlaneRejections, this->NrejectionCauses, table->GetColumnByName("EgoMotion: planes rejections"));
+  InsertHistogram(this->Profile.MappingLineRejections, this->NrejectionCauses, table->GetColumnByName("Mapping: lines rejections"));
+  InsertHistogram(this->Profile.MappingPlaneRejections, this->NrejectionCauses, table->GetColumnByName("Mapping: planes rejections"));
 }
@@ -74,7 +74,14 @@
 // LOCAL
 #include "vtkPCLConversions.h"
 // STD
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 #include <ctime>
 // VTK
 #include <vtkPolyDataAlgorithm.h>
@@ -85,9 +92,10 @@
 // PCL
 #include <pcl/point_types.h>
 #include <pcl/filters/voxel_grid.h>
-#include <pcl/kdtree/kdtree_flann.h>
+#include <pcl/search/kdtree.h>
 
 #include "KalmanFilter.h"
+#include "MemoryAccounting.h"
 #include "vtkTemporalTransforms.h"
 
 // This custom macro is needed to make the SlamManager time agnostic
@@ -110,6 +118,12 @@ virtual void Set##name (type _arg) \
 
 class vtkVelodyneTransformInterpolator;
 class RollingGrid;
+class UndistortionPoses;
+class SlamPoseGraph;
+class SlamMapFile;
+class ImuPreintegration;
+class ImuBuffer;
+class KnnBatchSearch;
 class vtkTable;
 typedef pcl::PointXYZINormal Point;
 
@@ -127,12 +141,44 @@ public:
   // and to update the map using keypoints and ego-motion
   void AddFrame(vtkPolyData* newFrame);
 
+  // Add the frames of several synchronized sensors, in the order of their
+  // calibrations, see AddSensorExtrinsic
+  void AddFrames(const std::vector<vtkPolyData*>& frames);
+
+  // Results of an estimated frame, in world coordinates
+  struct FrameResult
+  {
+    unsigned int Index = 0;
+    double Time = 0.0;
+    // Pose of the sensor as (rx, ry, rz, x, y, z)
+    double Pose[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    // Keypoints with their "keypoint_type": 0 for
+    // the edges, 1 for the planars and 2 for the blobs
+    vtkSmartPointer<vtkPolyData> Keypoints;
+    // Undistorted frame, if StreamUndistortedFrames is set
+    vtkSmartPointer<vtkPolyData> Frame;
+  };
+
   // Get the computed world transform so far
   void GetWorldTransform(double* Tworld);
 
+  // Outputs filled by the filter: Poses only fills the trajectory and the
+  // profiling, Keypoints also the last frame and the maps, and FullDebug
+  // adds the internal variables of the slam to the last frame
+  enum OUTPUT_LEVEL
+  {
+    Poses = 0,
+    Keypoints = 1,
+    FullDebug = 2
+  };
+
   // Get/Set General
-  vtkGetMacro(DisplayMode, bool)
-  vtkCustomSetMacro(DisplayMode, bool)
+  vtkGetMacro(OutputLevel, int)
+  vtkCustomSetMacro(OutputLevel, int)
+
+  // The display mode is the FullDebug output level, kept for compatibility
+  bool GetDisplayMode() { return this->OutputLevel == FullDebug; }
+  void SetDisplayMode(bool mode) { this->SetOutputLevel(mode ? FullDebug : Keypoints); }
 
   vtkGetMacro(MaxDistBetweenTwoFrames, double)
   vtkCustomSetMacro(MaxDistBetweenTwoFrames, double)
@@ -149,6 +195,125 @@ public:
   vtkSetMacro(Undistortion, bool)
   vtkGetMacro(Undistortion, bool)
 
+  // Number of threads matching the keypoints, 0 uses one thread per core
+  vtkSetMacro(NumberOfThreads, int)
+  vtkGetMacro(NumberOfThreads, int)
+
+  // Real-time mode: when a frame takes more than FrameTimeBudget seconds,
+  // the next ones subsample their keypoints and skip the blobs until they
+  // fit in it again, and the ICP loops stop once the budget is spent
+  vtkGetMacro(RealTime, bool)
+  vtkCustomSetMacro(RealTime, bool)
+
+  vtkGetMacro(FrameTimeBudget, double)
+  vtkCustomSetMacro(FrameTimeBudget, double)
+
+  // Deterministic mode: the results only depend on the inputs and the
+  // parameters, whatever the number of threads and the time spent, so
+  // that the trajectories of two runs can be compared. The real-time
+  // mode is ignored, the neighbors are never searched on the GPU and
+  // each frame waits for the loop closure it triggers
+  vtkGetMacro(Deterministic, bool)
+  vtkCustomSetMacro(Deterministic, bool)
+
+  // Profiling: when enabled, the time spent on each stage, the keypoints
+  // extracted, the ICP iterations and the matching rejections of each
+  // frame are added as a row of the profiling table output
+  vtkGetMacro(Profiling, bool)
+  vtkCustomSetMacro(Profiling, bool)
+
+  // Loop closure: keyframes are sampled along the trajectory and a pose
+  // graph backend looks for loops between them on a worker thread. Once
+  // a loop is found the trajectory output is corrected, the odometry and
+  // the local maps keep going on in their own referential
+  vtkGetMacro(LoopClosure, bool)
+  vtkCustomSetMacro(LoopClosure, bool)
+
+  vtkGetMacro(LoopClosureKeyframeDistance, double)
+  vtkCustomSetMacro(LoopClosureKeyframeDistance, double)
+
+  vtkGetMacro(LoopClosureSearchRadius, double)
+  vtkCustomSetMacro(LoopClosureSearchRadius, double)
+
+  // Maximum number of keyframes keeping their keypoints to close loops
+  vtkGetMacro(LoopClosureMaxKeyframes, unsigned int)
+  vtkCustomSetMacro(LoopClosureMaxKeyframes, unsigned int)
+
+  // Map keyframes: a frame is only added to the maps if it moved more than
+  // MapKeyframeDistance meters or turned more than MapKeyframeAngle degrees
+  // since the last frame added, or if less than MapKeyframeMinOverlap of its
+  // edges and planars matched the maps. The other frames are only located in
+  // the maps. A zero distance and angle add all the frames to the maps
+  vtkGetMacro(MapKeyframeDistance, double)
+  vtkCustomSetMacro(MapKeyframeDistance, double)
+
+  vtkGetMacro(MapKeyframeAngle, double)
+  vtkCustomSetMacro(MapKeyframeAngle, double)
+
+  vtkGetMacro(MapKeyframeMinOverlap, double)
+  vtkCustomSetMacro(MapKeyframeMinOverlap, double)
+
+  // Global map: the voxels of the maps are written to the export file as
+  // they leave the rolling grids, and the remaining ones once the slam is
+  // done. When an initial map is set, the maps are filled with its voxels
+  // around InitialPose (rx, ry, rz, x, y, z) instead of starting empty. If
+  // UpdateMap is disabled the frames are only localized in the initial map
+  void SetMapExportFileName(const char* filename);
+  const char* GetMapExportFileName() { return this->MapExportFileName.c_str(); }
+
+  void SetInitialMapFileName(const char* filename);
+  const char* GetInitialMapFileName() { return this->InitialMapFileName.c_str(); }
+
+  void SetInitialPose(double rx, double ry, double rz, double x, double y, double z);
+  vtkGetVector6Macro(InitialPose, double)
+
+  vtkGetMacro(UpdateMap, bool)
+  vtkCustomSetMacro(UpdateMap, bool)
+
+  // IMU prior: the IMU measurements between two frames are preintegrated
+  // to initialize their ego-motion, instead of starting from no motion.
+  // The measurements are in rad/s and m/s^2, in the IMU axes, and their
+  // time in seconds is the one of the frames. ImuToLidar is the rotation
+  // (rx, ry, rz) from the IMU axes to the lidar axes
+  void AddImuMeasurement(double time, const double angularVelocity[3], const double acceleration[3]);
+  void ClearImuMeasurements();
+
+#ifndef __VTK_WRAP__
+  // The measurements can also be taken from a buffer filled by a position
+  // reader or a live stream (see vtkVelodyneHDLPositionReader::GetImuBuffer):
+  // the ones up to each new frame are added before its prior is computed
+  void SetImuBuffer(std::shared_ptr<ImuBuffer> buffer);
+#endif
+
+  vtkGetMacro(ImuPrior, bool)
+  vtkCustomSetMacro(ImuPrior, bool)
+
+  void SetImuToLidar(double rx, double ry, double rz);
+  vtkGetVector3Macro(ImuToLidar, double)
+
+  // Multiple lidars: the frames of several synchronized sensors are given
+  // by the connections of the point cloud input, with their calibrations
+  // in the same order on the calibration input. The keypoints of each
+  // sensor are extracted in its referential, then expressed in the
+  // vehicle referential and registered jointly on the maps, the pose
+  // estimated being the one of the vehicle. The extrinsic calibration
+  // of a sensor is its pose (rx, ry, rz, x, y, z) in the vehicle
+  // referential, the ones of the sensors are added in their order and
+  // the sensors without one are at the origin of the vehicle
+  void AddSensorExtrinsic(double rx, double ry, double rz, double x, double y, double z);
+  void ClearSensorExtrinsics();
+
+  // Clean commands of the inputs, which can have several connections
+  void RemoveAllPointCloudInputs() { this->RemoveAllInputConnections(0); }
+  void RemoveAllCalibrationInputs() { this->RemoveAllInputConnections(1); }
+
+  // Search of the neighbors of the edges and planars keypoints: 0 one
+  // search per keypoint, 1 all the keypoints of an ICP iteration searched
+  // at once, 2 the same on the GPU, which falls back to 1 when the plugin
+  // has not been built with CUDA or there is no device
+  vtkGetMacro(NeighborSearchBackend, int)
+  vtkCustomSetMacro(NeighborSearchBackend, int)
+
   // Set RollingGrid Parameters
   void SetVoxelGridLeafSize(double size);
   void SetVoxelGridSize(unsigned int size);
@@ -170,6 +335,19 @@ public:
   vtkGetMacro(EdgeDepthGapThreshold, double)
   vtkCustomSetMacro(EdgeDepthGapThreshold, double)
 
+  // ICP convergence: the ICP-LM loops of the ego-motion and the mapping stop
+  // once an iteration moves the pose less than ICPConvergenceTranslation
+  // meters and ICPConvergenceAngle degrees, or decreases the cost less than
+  // ICPConvergenceCostDecrease times its initial value
+  vtkGetMacro(ICPConvergenceTranslation, double)
+  vtkCustomSetMacro(ICPConvergenceTranslation, double)
+
+  vtkGetMacro(ICPConvergenceAngle, double)
+  vtkCustomSetMacro(ICPConvergenceAngle, double)
+
+  vtkGetMacro(ICPConvergenceCostDecrease, double)
+  vtkCustomSetMacro(ICPConvergenceCostDecrease, double)
+
   // Get/Set EgoMotion
   vtkGetMacro(EgoMotionLMMaxIter, unsigned int)
   vtkCustomSetMacro(EgoMotionLMMaxIter, unsigned int)
@@ -208,6 +386,16 @@ public:
   vtkGetMacro(MappingICPMaxIter, unsigned int)
   vtkCustomSetMacro(MappingICPMaxIter, unsigned int)
 
+  // Coarse-to-fine mapping: the first MappingCoarseICPIter ICP iterations
+  // match a subset of the keypoints with the edges and planars maps
+  // downsampled in leaves of CoarseMapLeafFactor times their leaf size. The
+  // coarse maps are only maintained when MappingCoarseICPIter is not 0
+  vtkGetMacro(MappingCoarseICPIter, unsigned int)
+  void SetMappingCoarseICPIter(unsigned int iterations);
+
+  vtkGetMacro(CoarseMapLeafFactor, double)
+  void SetCoarseMapLeafFactor(double factor);
+
   vtkGetMacro(MappingLineDistanceNbrNeighbors, unsigned int)
   vtkCustomSetMacro(MappingLineDistanceNbrNeighbors, unsigned int)
 
@@ -242,6 +430,7 @@ protected:
   ~vtkSlam();
 
   int FillInputPortInformation(int port, vtkInformation* info) override;
+  int FillOutputPortInformation(int port, vtkInformation* info) override;
   int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
 
   // Keeps track of the time the parameters have been modified
@@ -249,30 +438,107 @@ protected:
   // MTime is a much more general mecanism so we can't rely on it
   vtkTimeStamp ParametersModificationTime;
 
+  // Pipelined mode: the keypoints of the next frames are extracted by
+  // a thread while the current one is estimated by another. AddFrame
+  // only queues the frames, and the outputs are not updated until
+  // StopPipeline has processed all of them
+  void StartPipeline();
+  void StopPipeline();
+
+  // Write the voxels of the maps still in the rolling grids to the
+  // exported map, and close it
+  void FinishMapExport();
+
+  // Give the results of each estimated frame to FrameEstimated, from the
+  // estimation thread in pipelined mode. The undistorted frames are only
+  // built if requested since they are as large as the input frames
+  bool StreamFrameResults = false;
+  bool StreamUndistortedFrames = false;
+  virtual void FrameEstimated(const FrameResult& vtkNotUsed(result)) {}
+
+  // Wait for the loop closure of the frames added so far before
+  // producing the outputs, instead of correcting them later
+  bool WaitForLoopClosure = false;
+
 private:
   vtkSlam(const vtkSlam&);
   void operator = (const vtkSlam&);
   // Polydata which represents the trajectory computed
   vtkSmartPointer<vtkTemporalTransforms> Trajectory;
 
-  // Current point cloud stored in two differents
-  // formats: PCL-pointcloud and vtkPolyData
-  vtkSmartPointer<vtkPolyData> vtkCurrentFrame;
-  vtkSmartPointer<vtkPolyData> vtkProcessedFrame;
-  pcl::PointCloud<Point>::Ptr pclCurrentFrame;
-  std::vector<pcl::PointCloud<Point>::Ptr> pclCurrentFrameByScan;
-  std::vector<std::pair<int, int> > FromVTKtoPCLMapping;
-  std::vector<std::vector<int > > FromPCLtoVTKMapping;
-
-  // Mapping between keypoints and their corresponding
-  // index in the vtk input frame
-  std::vector<std::pair<int, int> > EdgesIndex;
-  std::vector<std::pair<int, int> > PlanarIndex;
-  std::vector<std::pair<int, int> > BlobIndex;
-  std::vector<int> EdgePointRejectionEgoMotion;
-  std::vector<int> PlanarPointRejectionEgoMotion;
-  std::vector<int> EdgePointRejectionMapping;
-  std::vector<int> PlanarPointRejectionMapping;
+  // Data of a frame whose keypoints have been extracted. The frame
+  // being estimated is Frame, in pipelined mode the next ones are
+  // extracted in other instances at the same time
+  struct ExtractedFrame
+  {
+    // The buffers are large, a frame is moved and never copied
+    ExtractedFrame() = default;
+    ExtractedFrame(const ExtractedFrame&) = delete;
+    ExtractedFrame& operator=(const ExtractedFrame&) = delete;
+    ExtractedFrame(ExtractedFrame&&) = default;
+    ExtractedFrame& operator=(ExtractedFrame&&) = default;
+
+    // Current point cloud stored in two differents
+    // formats: PCL-pointcloud and vtkPolyData. The pcl
+    // points are sorted by scan line, the ones of a scan
+    // line are contiguous and start at its offset
+    vtkSmartPointer<vtkPolyData> vtkCurrentFrame;
+    pcl::PointCloud<Point>::Ptr pclCurrentFrame;
+    std::vector<std::pair<int, int> > FromVTKtoPCLMapping;
+    std::vector<int> FromPCLtoVTKMapping;
+
+    // Mapping between keypoints and their corresponding
+    // index in the vtk input frame
+    std::vector<std::pair<int, int> > EdgesIndex;
+    std::vector<std::pair<int, int> > PlanarIndex;
+    std::vector<std::pair<int, int> > BlobIndex;
+    std::vector<int> EdgePointRejectionEgoMotion;
+    std::vector<int> PlanarPointRejectionEgoMotion;
+    std::vector<int> EdgePointRejectionMapping;
+    std::vector<int> PlanarPointRejectionMapping;
+
+    // keypoints extracted
+    pcl::PointCloud<Point>::Ptr CurrentEdgesPoints;
+    pcl::PointCloud<Point>::Ptr CurrentPlanarsPoints;
+    pcl::PointCloud<Point>::Ptr CurrentBlobsPoints;
+
+    // Curvature and over differntial operations
+    // point by point. The points of a scan line are contiguous
+    // and start at its offset, the same offsets index the
+    // pcl to vtk mapping. These buffers are kept from a frame
+    // to the next one so that their memory is reused
+    std::vector<size_t> ScanLineOffsets;
+    std::vector<double> Angles;
+    std::vector<double> DepthGap;
+    std::vector<double> BlobScore;
+    std::vector<double> LengthResolution;
+    std::vector<double> SaillantPoint;
+    std::vector<double> IntensityGap;
+    std::vector<int> IsPointValid;
+    std::vector<int> Label;
+
+    // Scratch buffers of the keypoints labelling, laid out as above
+    std::vector<int> IsPointValidForPlanar;
+    std::vector<size_t> SortedAnglesIndices;
+    std::vector<size_t> SortedIndices;
+
+    // norm of the farest keypoints
+    double FarestKeypointDist = 0.0;
+
+    // Acquisition time of the frame, in seconds
+    double Time = 0.0;
+
+    // Real-time sampling used for this frame and
+    // the time spent on its keypoints
+    unsigned int KeypointsSamplingStep = 1;
+    bool SkipBlobs = false;
+    double KeypointsTime = 0.0;
+  };
+  std::shared_ptr<ExtractedFrame> Frame;
+
+  // Pipelined mode, only set while it is running
+  class FramesPipeline;
+  std::unique_ptr<FramesPipeline> Pipeline;
 
   // If set to true the mapping planars keypoints used
   // will be the same than the EgoMotion one. If set to false
@@ -284,13 +550,92 @@ private:
   // The undistortion will improve the accuracy but
   // the computation speed will decrease
   bool Undistortion = false;
+
+  int NumberOfThreads = 0;
+
+  // Real-time mode parameters and state. One out of KeypointsSamplingStep
+  // keypoints is kept, it is adapted from a frame to the next one. They
+  // are read by the extraction thread in pipelined mode
+  bool RealTime = false;
+  double FrameTimeBudget = 0.1;
+  std::atomic<unsigned int> KeypointsSamplingStep{1};
+  std::atomic<bool> LastFrameOverBudget{false};
+  std::chrono::steady_clock::time_point FrameStartTime;
+
+  bool Deterministic = false;
+
+  // Per-stage measures of the frame being estimated, and the table
+  // with one row per frame they are appended to when profiling
+  struct FrameProfile
+  {
+    double EgoMotionTime = 0.0;
+    double MappingTime = 0.0;
+    unsigned int EgoMotionICPIterations = 0;
+    unsigned int EgoMotionLMIterations = 0;
+    unsigned int MappingICPIterations = 0;
+    unsigned int MappingLMIterations = 0;
+    unsigned int EgoMotionMatchings = 0;
+    unsigned int MappingMatchings = 0;
+    bool MapKeyframe = false;
+    double MapUpdateTime = 0.0;
+    std::vector<double> EgoMotionLineRejections;
+    std::vector<double> EgoMotionPlaneRejections;
+    std::vector<double> MappingLineRejections;
+    std::vector<double> MappingPlaneRejections;
+  };
+  bool Profiling = false;
+  FrameProfile Profile;
+  vtkSmartPointer<vtkTable> ProfilingTable;
+
+  // Loop closure parameters and backend. The odometry poses of the
+  // trajectory are kept to correct it again after each loop, the
+  // correction of the last keyframe is applied to the new frames
+  bool LoopClosure = false;
+  double LoopClosureKeyframeDistance = 2.0;
+  double LoopClosureSearchRadius = 15.0;
+  unsigned int LoopClosureMaxKeyframes = 300;
+  std::unique_ptr<SlamPoseGraph> PoseGraph;
+  std::vector<Eigen::Matrix<double, 6, 1> > OdometryPoses;
+  Eigen::Isometry3d LoopClosureCorrection = Eigen::Isometry3d::Identity();
+
+  // Map keyframes parameters, and pose of the last frame added to the maps
+  double MapKeyframeDistance = 0.5;
+  double MapKeyframeAngle = 5.0;
+  double MapKeyframeMinOverlap = 0.5;
+  Eigen::Matrix<double, 6, 1> LastMapKeyframeTworld = Eigen::Matrix<double, 6, 1>::Zero();
+
+  // Global map export and initial map, opened with the first frame
+  std::string MapExportFileName;
+  std::string InitialMapFileName;
+  double InitialPose[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+  bool UpdateMap = true;
+  std::unique_ptr<SlamMapFile> MapExportFile;
+  std::unique_ptr<SlamMapFile> InitialMapFile;
+
+  // IMU measurements, which are kept when the slam is reset
+  bool ImuPrior = false;
+  double ImuToLidar[3] = { 0.0, 0.0, 0.0 };
+  std::unique_ptr<ImuPreintegration> Imu;
+  std::shared_ptr<ImuBuffer> ImuSource;
+  double LastImuSourceTime = -std::numeric_limits<double>::infinity();
+  double LastImuFrameTime = -std::numeric_limits<double>::infinity();
+  double PreviousFrameTime = 0.0;
+  double PreviousFrameDuration = 0.0;
+
+  // Batched nearest neighbors searches of the edges and planars keypoints
+  int NeighborSearchBackend = 0;
+  std::shared_ptr<KnnBatchSearch> EdgesNeighbors;
+  std::shared_ptr<KnnBatchSearch> PlanarsNeighbors;
+
   vtkSmartPointer<vtkVelodyneTransformInterpolator> EgoMotionInterpolator;
   vtkSmartPointer<vtkVelodyneTransformInterpolator> MappingInterpolator;
 
-  // keypoints extracted
-  pcl::PointCloud<Point>::Ptr CurrentEdgesPoints;
-  pcl::PointCloud<Point>::Ptr CurrentPlanarsPoints;
-  pcl::PointCloud<Point>::Ptr CurrentBlobsPoints;
+  // Poses of the interpolators sampled over the frame sweep,
+  // which are the ones used to undistort the points
+  std::shared_ptr<UndistortionPoses> EgoMotionPoses;
+  std::shared_ptr<UndistortionPoses> MappingPoses;
+
+  // keypoints extracted from the previous frame
   pcl::PointCloud<Point>::Ptr PreviousEdgesPoints;
   pcl::PointCloud<Point>::Ptr PreviousPlanarsPoints;
   pcl::PointCloud<Point>::Ptr PreviousBlobsPoints;
@@ -300,20 +645,12 @@ private:
   std::shared_ptr<RollingGrid> PlanarPointsLocalMap;
   std::shared_ptr<RollingGrid> BlobsPointsLocalMap;
 
+  // Memory used by the local maps, set each time they are updated
+  MemoryAccounting::Account MapsMemory{ MemoryAccounting::SLAM_MAPS };
+
   // Mapping of the lasers id
   std::vector<size_t> LaserIdMapping;
 
-  // Curvature and over differntial operations
-  // scan by scan; point by point
-  std::vector<std::vector<double> > Angles;
-  std::vector<std::vector<double> > DepthGap;
-  std::vector<std::vector<double> > BlobScore;
-  std::vector<std::vector<double> > LengthResolution;
-  std::vector<std::vector<double> > SaillantPoint;
-  std::vector<std::vector<double> > IntensityGap;
-  std::vector<std::vector<int> > IsPointValid;
-  std::vector<std::vector<int> > Label;
-
   // with of the neighbor used to compute discrete
   // differential operators
   int NeighborWidth = 4;
@@ -321,6 +658,12 @@ private:
   // Number of lasers scan lines composing the pointcloud
   unsigned int NLasers = 0;
 
+  // With several sensors, their scan lines follow each other, the sensor
+  // of each scan line and the extrinsic calibration of the sensors
+  unsigned int NumberOfSensors = 1;
+  std::vector<unsigned int> ScanLineSensor;
+  std::vector<std::array<double, 6> > SensorExtrinsics;
+
   // maximal angle resolution of the lidar
   // azimutal resolution of the VLP-16. We add an extra 20 %
   double AngleResolution = 0.00698132; // 0.4 degree
@@ -363,6 +706,18 @@ private:
   unsigned int EgoMotionICPMaxIter = 4;
   unsigned int MappingICPMaxIter = 3;
 
+  // Number of the first mapping ICP iterations done against the coarse maps,
+  // whose leaves are CoarseMapLeafFactor times larger than the maps ones
+  unsigned int MappingCoarseICPIter = 1;
+  double CoarseMapLeafFactor = 2.0;
+
+  // The ICP-LM loops stop before their maximum number of iterations once
+  // the pose update, in meters and degrees, or the relative decrease of the
+  // cost is under these thresholds
+  double ICPConvergenceTranslation = 1e-4;
+  double ICPConvergenceAngle = 5e-3;
+  double ICPConvergenceCostDecrease = 1e-4;
+
   // When computing the point<->line and point<->plane distance
   // in the ICP, the kNearest edges/planes points of the current
   // points are selected to approximate the line/plane using a PCA
@@ -393,9 +748,6 @@ private:
   double EgoMotionMaxPlaneDistance = 0.2;
   double EgoMotionMaxLineDistance = 0.10;
 
-  // norm of the farest keypoints
-  double FarestKeypointDist;
-
   // Use or not blobs
   bool UseBlob = false;
 
@@ -446,6 +798,105 @@ private:
   std::vector<double> residualCoefficient;
   std::vector<double> TimeValues;
 
+  // Distance parameters of the keypoints matched by one thread, appended
+  // to the ones above once all the keypoints are matched
+  struct KeypointMatches
+  {
+    std::vector<Eigen::Matrix3d > Avalues;
+    std::vector<Eigen::Vector3d > Pvalues;
+    std::vector<Eigen::Vector3d > Xvalues;
+    std::vector<double> RadiusIncertitude;
+    std::vector<double> residualCoefficient;
+    std::vector<double> TimeValues;
+
+    // Buffers of the neighbors searches, reused by all the keypoints
+    // matched by the thread
+    std::vector<int> NearestIndex;
+    std::vector<float> NearestDist;
+    std::vector<int> CandidateIndex;
+    std::vector<float> CandidateDist;
+    std::vector<int> IdAlreadyTook;
+    std::vector<std::vector<int> > InliersList;
+
+    // Clear the distance parameters, keeping the memory of all the buffers
+    void Clear();
+  };
+
+  // Buffers kept from frame to frame, so that once the largest frame has
+  // been processed, the keypoints extraction and matching do not allocate
+  // memory anymore. They are cleared without releasing their memory, and
+  // only released by Reset
+  struct FrameScratch
+  {
+    // Matches and rejection histogram of each matching thread, only
+    // used by the frame estimation
+    std::vector<KeypointMatches> ThreadMatches;
+    std::vector<std::vector<double> > ThreadHistograms;
+
+    // Keypoints clouds, only used by the keypoints extraction. A cloud
+    // is reused once nothing else holds it, since the keypoints of a
+    // frame are kept as the previous ones
+    std::vector<pcl::PointCloud<Point>::Ptr> KeypointsClouds;
+
+    // Get an empty cloud, reusing the memory of a released one if any
+    pcl::PointCloud<Point>::Ptr AcquireCloud();
+  };
+  FrameScratch Scratch;
+
+  // Match each keypoint with matchKeypoint, which returns its rejection
+  // cause. The keypoints are split in contiguous ranges matched by several
+  // threads, and their matches are appended in the keypoints order so that
+  // the result does not depend on the number of threads. The rejection
+  // causes can be stored in rejections and counted in histogram, if any.
+  void MatchKeypoints(const pcl::PointCloud<Point>& keypoints,
+                      const std::function<int(const Point&, KeypointMatches&)>& matchKeypoint,
+                      std::vector<int>* rejections, std::vector<double>* histogram);
+
+  // Rejection causes of the keypoints to fill while matching them, they
+  // are only displayed at the full debug output level
+  std::vector<int>* GetRejectionsOutput(std::vector<int>& rejections)
+  {
+    return this->OutputLevel >= FullDebug ? &rejections : nullptr;
+  }
+
+  // Time spent on the current frame, in seconds
+  double GetFrameElapsedTime() const;
+
+  // Indicate if the real-time mode is enabled, it is not in deterministic mode
+  bool IsRealTime() const { return this->RealTime && !this->Deterministic; }
+
+  // Indicate if the real-time mode is enabled and the current frame
+  // has spent more than budgetRatio of its time budget
+  bool IsFrameOverBudget(double budgetRatio) const;
+
+  // Next step of an ICP-LM loop once the pose has been optimized from
+  // previousPose with the current matches: the keypoints are matched again,
+  // the matches are kept if the solver stopped on its iteration limit after
+  // a small update, or the loop stops once it converged
+  enum ICPStep
+  {
+    MatchKeypointsAgain,
+    ReuseMatches,
+    ICPConverged
+  };
+  ICPStep GetNextICPStep(const Eigen::Matrix<double, 6, 1>& previousPose,
+    const Eigen::Matrix<double, 6, 1>& pose, double initialCost, double finalCost,
+    bool solverConverged) const;
+
+  // Indicate if the batched neighbors search runs on the GPU, never in
+  // deterministic mode since it may not give the same neighbors
+  bool IsNeighborSearchOnGpu() const { return this->NeighborSearchBackend > 1 && !this->Deterministic; }
+
+  // Adapt the keypoints sampling to the time spent on the last frame
+  void UpdateRealTimeSampling(double frameTime);
+
+  // Number of threads to use, all the cores if NumberOfThreads is 0
+  unsigned int GetMaximumNumberOfThreads() const;
+
+  // Call processScanLine for each scan line, from several threads.
+  // It must only write the data of the scan line it is given
+  void ForEachScanLine(const std::function<void(unsigned int)>& processScanLine);
+
   // Histogram of the ICP matching rejection causes
   std::vector<double> MatchRejectionHistogramPlane;
   std::vector<double> MatchRejectionHistogramLine;
@@ -453,9 +904,18 @@ private:
   int NrejectionCauses = 7;
   void ResetDistanceParameters();
 
-  // Display information about the keypoints - neighborhood
-  // mathching rejections
-  void RejectionInformationDisplay();
+  // Open the exported and initial maps, and connect them to the
+  // rolling grids. The first frame starts at the initial pose
+  void OpenMapFiles();
+
+  // Add the current frame to the pose graph, and correct the
+  // trajectory if the graph has been optimized since the last frame
+  void UpdatePoseGraph();
+  void CorrectTrajectory(const std::vector<double>& keyframeTimes,
+                         const std::vector<Eigen::Isometry3d>& corrections);
+
+  // Append the profile of the current frame to the profiling table
+  void AppendFrameProfile(double frameTime);
 
   // Add a default point to the trajectories
   void AddDefaultPoint(double x, double y, double z, double rx, double ry, double rz, double t);
@@ -463,35 +923,51 @@ private:
   // Convert the input vtk-format pointcloud
   // into a pcl-pointcloud format. scan lines
   // will also be sorted by their vertical angles
-  void ConvertAndSortScanLines(vtkSmartPointer<vtkPolyData> input);
+  void ConvertAndSortScanLines(vtkSmartPointer<vtkPolyData> input, ExtractedFrame& frame);
 
   // Extract keypoints from the pointcloud. The key points
   // will be separated in two classes : Edges keypoints which
   // correspond to area with high curvature scan lines and
   // planar keypoints which have small curvature
-  void ComputeKeyPoints(vtkSmartPointer<vtkPolyData> input);
+  void ComputeKeyPoints(ExtractedFrame& frame);
 
   // Compute the curvature of the scan lines
   // The curvature is not the one of the surface
   // that intersected the lines but the curvature
   // of the scan lines taken in an isolated way
-  void ComputeCurvature(vtkSmartPointer<vtkPolyData> input);
+  void ComputeCurvature(ExtractedFrame& frame);
+  void ComputeScanLineCurvature(ExtractedFrame& frame, unsigned int scanLine);
 
   // Invalid the points with bad criteria from
   // the list of possible future keypoints.
   // This points correspond to planar surface
   // roughtly parallel to laser beam and points
   // close to a gap created by occlusion
-  void InvalidPointWithBadCriteria();
+  void InvalidPointWithBadCriteria(ExtractedFrame& frame);
+  void InvalidScanLinePointsWithBadCriteria(ExtractedFrame& frame, unsigned int scanLine);
 
   // Labelizes point to be a keypoints or not
-  void SetKeyPointsLabels(vtkSmartPointer<vtkPolyData> input);
+  void SetKeyPointsLabels(ExtractedFrame& frame);
+  void LabelScanLineKeypoints(ExtractedFrame& frame, unsigned int scanLine,
+                              std::vector<std::pair<int, int> >& edges,
+                              std::vector<std::pair<int, int> >& planars,
+                              std::vector<std::pair<int, int> >& blobs);
 
   // Reset all mumbers variables that are
   // used during the process of a frame.
   // The map and the recovered transformations
   // won't be reset.
-  void PrepareDataForNextFrame();
+  void PrepareDataForNextFrame(ExtractedFrame& frame);
+
+  // Extract the keypoints of a new frame, which only depends on it
+  void ExtractKeypoints(vtkSmartPointer<vtkPolyData> newFrame, ExtractedFrame& frame);
+
+  // Estimate the pose of an extracted frame and add it to the maps,
+  // it becomes the current Frame
+  void EstimateFrame(const std::shared_ptr<ExtractedFrame>& frame);
+
+  // Build the results of the current frame and give them to FrameEstimated
+  void StreamFrameResult(const ExtractedFrame& frame);
 
   // Find the ego motion of the sensor between
   // the current frame and the next one using
@@ -506,30 +982,51 @@ private:
   // Transform the input point already undistort into Tworld.
   void TransformToWorld(Point& p);
 
+  // Transform all the points of a cloud into Tworld, from several threads
+  void TransformToWorld(pcl::PointCloud<Point>& cloud);
+
   // Match the current keypoint with its neighborhood in the map / previous
   // frames. From this match we compute the point-to-neighborhood distance
   // function: 
   // (R * X + T - P).t * A * (R * X + T - P)
   // Where P is the mean point of the neighborhood and A is the symmetric
   // variance-covariance matrix encoding the shape of the neighborhood
-  int ComputeLineDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousEdges, Eigen::Matrix3d& R,
-                                             Eigen::Vector3d& dT, Point p, std::string step);
-  int ComputePlaneDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousPlanes, Eigen::Matrix3d& R,
-                                              Eigen::Vector3d& dT, Point p, std::string step);
-  int ComputeBlobsDistanceParameters(pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousBlobs, Eigen::Matrix3d& R,
-                                              Eigen::Vector3d& dT, Point p, std::string step);
+  // The neighbors of the keypoint are the ones of the query of the batch
+  // search if it is given
+  int ComputeLineDistanceParameters(pcl::search::Search<Point>::Ptr kdtreePreviousEdges, Eigen::Matrix3d& R,
+                                             Eigen::Vector3d& dT, Point p, std::string step,
+                                             KeypointMatches& matches,
+                                             const KnnBatchSearch* neighbors = nullptr, size_t query = 0);
+  int ComputePlaneDistanceParameters(pcl::search::Search<Point>::Ptr kdtreePreviousPlanes, Eigen::Matrix3d& R,
+                                              Eigen::Vector3d& dT, Point p, std::string step,
+                                              KeypointMatches& matches,
+                                              const KnnBatchSearch* neighbors = nullptr, size_t query = 0);
+  int ComputeBlobsDistanceParameters(pcl::search::Search<Point>::Ptr kdtreePreviousBlobs, Eigen::Matrix3d& R,
+                                              Eigen::Vector3d& dT, Point p, std::string step,
+                                              KeypointMatches& matches);
 
   // Instead of taking the k-nearest neigbirs in the odometry
   // step we will take specific neighbor using the particularities
   // of the velodyne's lidar sensor
   void GetEgoMotionLineSpecificNeighbor(std::vector<int>& nearestValid, std::vector<float>& nearestValidDist,
-                                        unsigned int nearestSearch, pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousEdges, Point p);
+                                        unsigned int nearestSearch, pcl::search::Search<Point>::Ptr kdtreePreviousEdges, Point p,
+                                        KeypointMatches& scratch,
+                                        const KnnBatchSearch* neighbors = nullptr, size_t query = 0);
 
   // Instead of taking the k-nearest neighbors in the mapping
   // step we will take specific neighbor using a sample consensus
   // model
   void GetMappingLineSpecificNeigbbor(std::vector<int>& nearestValid, std::vector<float>& nearestValidDist, double maxDistInlier,
-                                        unsigned int nearestSearch, pcl::KdTreeFLANN<Point>::Ptr kdtreePreviousEdges, Point p);
+                                        unsigned int nearestSearch, pcl::search::Search<Point>::Ptr kdtreePreviousEdges, Point p,
+                                        KeypointMatches& scratch,
+                                        const KnnBatchSearch* neighbors = nullptr, size_t query = 0);
+
+  // Search the neighbors of all the keypoints at once when the search
+  // is batched, the keypoints being transformed as the Compute*Parameters
+  // functions do. Return the batch search, or nullptr if not batched
+  const KnnBatchSearch* SearchNeighbors(KnnBatchSearch& neighbors, const pcl::PointCloud<Point>& keypoints,
+                                        const Eigen::Matrix3d& R, const Eigen::Vector3d& dT,
+                                        const UndistortionPoses& poses, unsigned int k);
 
   // All points of the current frame has been
   // acquired at a different timestamp. The goal
@@ -541,7 +1038,7 @@ private:
   // at time t0. The referential at time of acquisition t is estimated
   // using the constant velocity hypothesis and the provided sensor
   // position estimation
-  void ExpressPointInOtherReferencial(Point& p, vtkSmartPointer<vtkVelodyneTransformInterpolator> transform);
+  void ExpressPointInOtherReferencial(Point& p, const UndistortionPoses& poses);
 
   // Initialize the undistortion interpolator
   // for the EgoMotion part it is just an interpolation
@@ -551,6 +1048,17 @@ private:
   vtkSmartPointer<vtkVelodyneTransformInterpolator> InitUndistortionInterpolatorEgoMotion();
   vtkSmartPointer<vtkVelodyneTransformInterpolator> InitUndistortionInterpolatorMapping();
 
+  // Initialize the interpolators and sample their poses
+  void InitUndistortionEgoMotion();
+  void InitUndistortionMapping();
+
+  // Prior of the ego-motion of the current frame from the preintegrated
+  // IMU measurements, and the velocity of the previous ego-motion
+  bool ComputeImuPrior(Eigen::Matrix<double, 6, 1>& prior);
+
+  // Add the measurements of ImuSource which cover the current frame
+  void PullImuMeasurements();
+
   // Update the world transformation by integrating
   // the relative motion recover and the previous
   // world transformation
@@ -566,9 +1074,16 @@ private:
   // world reference frame coordinate system
   void UpdateMapsUsingTworld();
 
+  // Tell if the current frame must be added to the maps, overlap being the
+  // ratio of its edges and planars matched by the mapping
+  bool IsMapKeyframe(double overlap) const;
+
+  // Set MapsMemory from the current local maps
+  void UpdateMapsMemory();
+
   // Display infos
   template<typename T, typename Tvtk>
-  void AddVectorToPolydataPoints(const std::vector<std::vector<T>>& vec, const char* name, vtkPolyData* pd);
+  void AddVectorToPolydataPoints(const std::vector<T>& vec, const char* name, vtkPolyData* pd);
   void DisplayLaserIdMapping(vtkSmartPointer<vtkPolyData> input);
   void DisplayRelAdv(vtkSmartPointer<vtkPolyData> input);
   void DisplayUsedKeypoints(vtkSmartPointer<vtkPolyData> input);
@@ -576,14 +1091,29 @@ private:
   // Set the lidar maximun range
   void SetLidarMaximunRange(const double maxRange);
 
-  // Create a correspondance map between laser id and laser vertical angle
-  void UpdateLaserIdMapping(vtkTable* calib);
+  // Maintain the coarse level of the edges and planars maps if the
+  // coarse-to-fine mapping is enabled
+  void UpdateCoarseMaps();
+
+  // Create a correspondance map between laser id and laser vertical angle,
+  // the scan lines of the sensors follow each other
+  void UpdateLaserIdMapping(const std::vector<vtkTable*>& calibs);
+
+  // Pose of a sensor in the vehicle referential
+  Eigen::Isometry3d GetSensorPose(unsigned int sensor) const;
+
+  // Concatenate the frames of the sensors in a single frame in the vehicle
+  // referential, with the laser ids of each sensor after the previous ones
+  vtkSmartPointer<vtkPolyData> MergeSensorsFrames(const std::vector<vtkPolyData*>& frames);
+
+  // Express the points and the keypoints extracted in the referential of
+  // their sensor in the vehicle referential
+  void ExpressFrameInVehicle(ExtractedFrame& frame);
 
-  // Indicate if we are in display mode or not
-  // Display mode will add arrays showing some
-  // results of the slam algorithm such as
+  // Outputs filled by the filter, see OUTPUT_LEVEL. The full debug level
+  // adds arrays showing some results of the slam algorithm such as
   // the keypoints extracted, curvature etc
-  bool DisplayMode = false;
+  int OutputLevel = Keypoints;
 
   // Identity matrix
   Eigen::Matrix3d I3 = Eigen::Matrix3d::Identity();
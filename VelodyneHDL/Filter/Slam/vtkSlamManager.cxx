@@ -15,11 +15,18 @@
 // limitations under the License.
 //=========================================================================
 #include "vtkSlamManager.h"
+#include "TraceEvents.h"
 
 #include <vtkObjectFactory.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
+#include <vtkNew.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkXMLPolyDataWriter.h>
+#include <vtksys/SystemTools.hxx>
+
+#include <iomanip>
+#include <limits>
 #include <sstream>
 
 //----------------------------------------------------------------------------
@@ -34,6 +41,9 @@ void vtkSlamManager::PrintSelf(std::ostream &os, vtkIndent indent)
   PrintParameter(StartFrame)
   PrintParameter(EndFrame)
   PrintParameter(StepSize)
+  PrintParameter(Pipelined)
+  PrintParameter(StreamingDirectory)
+  PrintParameter(StreamUndistortedFrames)
   vtkIndent paramIndent = indent.GetNextIndent();
   this->Superclass::PrintSelf(os, paramIndent);
 }
@@ -59,6 +69,7 @@ int vtkSlamManager::RequestUpdateExtent(vtkInformation *vtkNotUsed(request),
 //----------------------------------------------------------------------------
 int vtkSlamManager::RequestData(vtkInformation *request, vtkInformationVector **inputVector, vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkSlamManager::RequestData");
   // Check parameters validity
   vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
   int nb_time_steps = inInfo->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
@@ -92,7 +103,7 @@ int vtkSlamManager::RequestData(vtkInformation *request, vtkInformationVector **
     {
       for (int i = 0; i < this->GetNumberOfOutputPorts(); ++i)
       {
-        auto *output = vtkPolyData::GetData(outputVector->GetInformationObject(i));
+        auto *output = vtkDataObject::GetData(outputVector->GetInformationObject(i));
         output->ShallowCopy(this->Cache[i]);
       }
       return 1;
@@ -100,6 +111,26 @@ int vtkSlamManager::RequestData(vtkInformation *request, vtkInformationVector **
     this->FirstIteration = false;
     this->Reset();
     this->CurrentFrame = this->AllFrame ? 0 : this->StartFrame;
+
+    // The results of the frames are streamed as they are processed
+    this->PosesFile.close();
+    if (!this->StreamingDirectory.empty())
+    {
+      vtksys::SystemTools::MakeDirectory(this->StreamingDirectory);
+      const std::string filename = this->StreamingDirectory + "/poses.csv";
+      this->PosesFile.open(filename.c_str());
+      if (!this->PosesFile.is_open())
+      {
+        vtkErrorMacro(<< "Cannot create " << filename)
+      }
+      this->PosesFile << "frame,time,rx,ry,rz,x,y,z" << std::endl;
+      this->PosesFile << std::setprecision(std::numeric_limits<double>::max_digits10);
+    }
+    this->StreamFrameResults = this->PosesFile.is_open() || this->Callback;
+    if (this->Pipelined)
+    {
+      this->StartPipeline();
+    }
   }
 
   // relaunch the pipeline if needed
@@ -121,20 +152,80 @@ int vtkSlamManager::RequestData(vtkInformation *request, vtkInformationVector **
   double progress = double(this->CurrentFrame-start)/double(stop-start);
   this->UpdateProgress(progress);
 
-  // process the frame
+  // process the frame, the last one once the previous ones are done
+  // so that the outputs are produced, along with the loops closed by them
+  if (LastIteration)
+  {
+    this->StopPipeline();
+  }
+  this->WaitForLoopClosure = LastIteration;
   vtkSlam::RequestData(request, inputVector, outputVector);
 
   // save data to the cache at the end
   if (LastIteration)
   {
+    this->FinishMapExport();
+    this->PosesFile.close();
     this->Cache.clear();
     for (int i = 0; i < this->GetNumberOfOutputPorts(); ++i)
     {
-      auto output = vtkSmartPointer<vtkPolyData>::New();
-      output->DeepCopy(vtkPolyData::GetData(outputVector->GetInformationObject(i)));
+      auto *data = vtkDataObject::GetData(outputVector->GetInformationObject(i));
+      auto output = vtkSmartPointer<vtkDataObject>::Take(data->NewInstance());
+      output->DeepCopy(data);
       this->Cache.push_back(output);
     }
+    unsigned long cacheSize = 0;
+    for (const vtkSmartPointer<vtkDataObject>& output : this->Cache)
+    {
+      cacheSize += output->GetActualMemorySize();
+    }
+    this->CacheMemory.Set(cacheSize);
   }
 
   return 1;
 }
+
+//----------------------------------------------------------------------------
+void vtkSlamManager::SetStreamingDirectory(const char* directory)
+{
+  const std::string name = directory ? directory : "";
+  if (name != this->StreamingDirectory)
+  {
+    this->StreamingDirectory = name;
+    this->Modified();
+    this->ParametersModificationTime.Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkSlamManager::FrameEstimated(const FrameResult& result)
+{
+  if (this->PosesFile.is_open())
+  {
+    this->PosesFile << result.Index << "," << result.Time;
+    for (double value : result.Pose)
+    {
+      this->PosesFile << "," << value;
+    }
+    this->PosesFile << "\n";
+
+    std::ostringstream suffix;
+    suffix << std::setw(6) << std::setfill('0') << result.Index << ".vtp";
+    vtkNew<vtkXMLPolyDataWriter> writer;
+    writer->SetDataModeToBinary();
+    writer->SetFileName((this->StreamingDirectory + "/keypoints_" + suffix.str()).c_str());
+    writer->SetInputData(result.Keypoints);
+    writer->Write();
+    if (result.Frame)
+    {
+      writer->SetFileName((this->StreamingDirectory + "/frame_" + suffix.str()).c_str());
+      writer->SetInputData(result.Frame);
+      writer->Write();
+    }
+  }
+
+  if (this->Callback)
+  {
+    this->Callback(result);
+  }
+}
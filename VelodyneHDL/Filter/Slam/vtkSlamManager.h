@@ -19,6 +19,11 @@
 
 #include <vtkSetGet.h>
 #include "vtkSlam.h"
+#include "MemoryAccounting.h"
+
+#include <fstream>
+#include <functional>
+#include <string>
 
 class VTK_EXPORT vtkSlamManager : public vtkSlam
 {
@@ -47,6 +52,26 @@ public:
   vtkCustomSetMacro(AllFrame, bool)
   //! @}
 
+  //! @{ @copydoc Pipelined
+  vtkGetMacro(Pipelined, bool)
+  vtkCustomSetMacro(Pipelined, bool)
+  //! @}
+
+  //! @{ @copydoc StreamingDirectory
+  void SetStreamingDirectory(const char* directory);
+  const char* GetStreamingDirectory() { return this->StreamingDirectory.c_str(); }
+  //! @}
+
+  //! @{ @copydoc StreamUndistortedFrames
+  vtkGetMacro(StreamUndistortedFrames, bool)
+  vtkCustomSetMacro(StreamUndistortedFrames, bool)
+  //! @}
+
+  //! Called with the results of each processed frame, from the estimation
+  //! thread in pipelined mode. The callback is not a parameter of the slam
+  typedef std::function<void(const FrameResult&)> FrameCallback;
+  void SetFrameCallback(const FrameCallback& callback) { this->Callback = callback; }
+
 protected:
   vtkSlamManager();
   int RequestUpdateExtent(vtkInformation*,
@@ -56,6 +81,9 @@ protected:
                   vtkInformationVector** inputVector,
                   vtkInformationVector* outputVector) override;
 
+  //! Write the results of a frame to the streaming directory, and call the callback
+  void FrameEstimated(const FrameResult& result) override;
+
   //! Overwrite StartFrame and EndFrame to process all the frame
   bool AllFrame = true;
 
@@ -69,6 +97,18 @@ protected:
   //! Process one frame every step size (ex: every frame, every 2 frame, 3 frame, ...)
   int StepSize = 1;
 
+  //! Extract the keypoints of the next frames while the current one is
+  //! estimated, the last frame is processed once the others are done
+  bool Pipelined = false;
+
+  //! Directory where the results of each frame are written as they are
+  //! processed, instead of only producing the outputs of the last one:
+  //! the poses are appended to poses.csv and the keypoints of each frame
+  //! are written to keypoints_<frame>.vtp, along with the undistorted
+  //! frame to frame_<frame>.vtp if StreamUndistortedFrames is set.
+  //! Nothing is written if it is empty
+  std::string StreamingDirectory;
+
 private:
   vtkSlamManager(const vtkSlamManager&) = delete;
   void operator = (const vtkSlamManager&) = delete;
@@ -76,7 +116,10 @@ private:
   bool FirstIteration = true;
   int CurrentFrame = 0;
   vtkMTimeType LastModifyTime = 0;
-  std::vector<vtkSmartPointer<vtkPolyData>> Cache;
+  std::vector<vtkSmartPointer<vtkDataObject>> Cache;
+  MemoryAccounting::Account CacheMemory{ MemoryAccounting::SLAM_CACHE };
+  FrameCallback Callback;
+  std::ofstream PosesFile;
 };
 
 #endif // VTKSLAMMANAGER_H
@@ -0,0 +1,122 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkSpreadSheetColumns.h"
+#include "TraceEvents.h"
+
+// STD
+#include <algorithm>
+
+// VTK
+#include <vtkDataSet.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkSpreadSheetColumns)
+
+//-----------------------------------------------------------------------------
+void vtkSpreadSheetColumns::AddColumn(const char* name)
+{
+  if (!name || std::find(this->Columns.begin(), this->Columns.end(), name) != this->Columns.end())
+  {
+    return;
+  }
+  this->Columns.push_back(name);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkSpreadSheetColumns::ClearColumns()
+{
+  if (this->Columns.empty())
+  {
+    return;
+  }
+  this->Columns.clear();
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkSpreadSheetColumns::GetNumberOfColumns() const
+{
+  return static_cast<int>(this->Columns.size());
+}
+
+//-----------------------------------------------------------------------------
+const char* vtkSpreadSheetColumns::GetColumn(int index) const
+{
+  if (index < 0 || index >= this->GetNumberOfColumns())
+  {
+    return nullptr;
+  }
+  return this->Columns[index].c_str();
+}
+
+//-----------------------------------------------------------------------------
+int vtkSpreadSheetColumns::FillInputPortInformation(int vtkNotUsed(port), vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkDataSet");
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkSpreadSheetColumns::RequestData(vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector, vtkInformationVector *outputVector)
+{
+  VV_TRACE_SCOPE("vtkSpreadSheetColumns::RequestData");
+  vtkDataSet* input = vtkDataSet::GetData(inputVector[0]->GetInformationObject(0));
+  vtkDataSet* output = vtkDataSet::GetData(outputVector->GetInformationObject(0));
+
+  // The output shares the points and arrays of the input, the arrays which
+  // are not columns are only dropped from the output point data
+  output->ShallowCopy(input);
+  if (this->Columns.empty())
+  {
+    return 1;
+  }
+  vtkPointData* pointData = output->GetPointData();
+  std::vector<std::string> hiddenArrays;
+  for (int arrayIndex = 0; arrayIndex < pointData->GetNumberOfArrays(); ++arrayIndex)
+  {
+    const char* name = pointData->GetArrayName(arrayIndex);
+    if (name && std::find(this->Columns.begin(), this->Columns.end(), name) == this->Columns.end())
+    {
+      hiddenArrays.push_back(name);
+    }
+  }
+  for (const std::string& name : hiddenArrays)
+  {
+    pointData->RemoveArray(name.c_str());
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkSpreadSheetColumns::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Columns:";
+  for (const std::string& column : this->Columns)
+  {
+    os << " " << column;
+  }
+  os << std::endl;
+}
@@ -0,0 +1,74 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_SPREADSHEET_COLUMNS_H
+#define VTK_SPREADSHEET_COLUMNS_H
+
+// VTK
+#include <vtkPassInputTypeAlgorithm.h>
+
+// STD
+#include <string>
+#include <vector>
+
+/**
+ * @brief vtkSpreadSheetColumns keep only the point data arrays to show in the
+ * spreadsheet view.
+ *
+ * The spreadsheet representation converts all the arrays of its input to the columns
+ * of a table before extracting the rows to display, which costs a copy of the 18 arrays
+ * of a frame each time the frame changes. This filter is placed between the frame and
+ * the spreadsheet: its output shares the points and the selected arrays of the input
+ * without copying them, so that only the selected columns are converted, the rows
+ * still being fetched by blocks by the view. Without selected column, all the arrays
+ * are kept
+ */
+class VTK_EXPORT vtkSpreadSheetColumns : public vtkPassInputTypeAlgorithm
+{
+public:
+  static vtkSpreadSheetColumns *New();
+  vtkTypeMacro(vtkSpreadSheetColumns, vtkPassInputTypeAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  /// Add a point data array to the columns
+  void AddColumn(const char* name);
+
+  /// Remove all the columns, all the arrays are then kept
+  void ClearColumns();
+
+  /// Get the number of selected columns
+  int GetNumberOfColumns() const;
+
+  /// Get the name of a selected column
+  const char* GetColumn(int index) const;
+
+protected:
+  vtkSpreadSheetColumns() = default;
+  ~vtkSpreadSheetColumns() = default;
+
+  int FillInputPortInformation(int port, vtkInformation* info) override;
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkSpreadSheetColumns(const vtkSpreadSheetColumns&) = delete;
+  void operator=(const vtkSpreadSheetColumns&) = delete;
+
+  /// names of the point data arrays to keep
+  std::vector<std::string> Columns;
+};
+
+#endif // VTK_SPREADSHEET_COLUMNS_H
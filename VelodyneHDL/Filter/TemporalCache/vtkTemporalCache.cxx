@@ -0,0 +1,284 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "vtkTemporalCache.h"
+#include "FrameCache.h"
+#include "TraceEvents.h"
+#include "vtkLidarReader.h"
+
+#include <vtkDataObject.h>
+#include <vtkExecutive.h>
+#include <vtkInformation.h>
+#include <vtkInformationDoubleVectorKey.h>
+#include <vtkInformationKeyVectorKey.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <algorithm>
+
+namespace
+{
+//! Memory used by the outputs by default, in mebibytes
+const int DefaultCacheSize = 256;
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkTemporalCache)
+
+//-----------------------------------------------------------------------------
+vtkTemporalCache::vtkTemporalCache()
+  : PrecomputeFrames(0)
+{
+  this->Cache = new FrameCache(MemoryAccounting::TEMPORAL_CACHE);
+  this->Cache->SetMemoryBudget(DefaultCacheSize * 1024);
+
+  // the outputs are computed again when they are released, unless the cache is being used
+  FrameCache* cache = this->Cache;
+  std::mutex* mutex = &this->CacheMutex;
+  cache->GetMemoryAccount().SetReleaser(MemoryAccounting::DECODED_DATA_PRIORITY,
+    [cache, mutex](unsigned long kibibytes) {
+      std::unique_lock<std::mutex> lock(*mutex, std::try_to_lock);
+      if (lock.owns_lock())
+      {
+        cache->Release(kibibytes);
+      }
+    });
+}
+
+//-----------------------------------------------------------------------------
+vtkTemporalCache::~vtkTemporalCache()
+{
+  this->Cache->GetMemoryAccount().SetReleaser(0, nullptr);
+  delete this->Cache;
+}
+
+//-----------------------------------------------------------------------------
+void vtkTemporalCache::SetCacheSize(int mebibytes)
+{
+  // this does not change the output, so the filter is not modified
+  std::lock_guard<std::mutex> lock(this->CacheMutex);
+  this->Cache->SetMemoryBudget(static_cast<unsigned long>(std::max(mebibytes, 0)) * 1024);
+}
+
+//-----------------------------------------------------------------------------
+int vtkTemporalCache::GetCacheSize()
+{
+  return static_cast<int>(this->Cache->GetMemoryBudget() / 1024);
+}
+
+//-----------------------------------------------------------------------------
+void vtkTemporalCache::SetPrecomputeFrames(int value)
+{
+  // this does not change the output, so the filter is not modified
+  this->PrecomputeFrames = std::max(value, 0);
+}
+
+//-----------------------------------------------------------------------------
+int vtkTemporalCache::GetCacheHits()
+{
+  return this->Cache->GetNumberOfHits();
+}
+
+//-----------------------------------------------------------------------------
+int vtkTemporalCache::GetCacheMisses()
+{
+  return this->Cache->GetNumberOfMisses();
+}
+
+//-----------------------------------------------------------------------------
+void vtkTemporalCache::ResetCacheStatistics()
+{
+  std::lock_guard<std::mutex> lock(this->CacheMutex);
+  this->Cache->ResetStatistics();
+}
+
+//-----------------------------------------------------------------------------
+void vtkTemporalCache::PlanUpdate(vtkInformation* request,
+                                  vtkInformation* inInfo,
+                                  vtkInformation* outInfo)
+{
+  this->TimeSteps.clear();
+  if (inInfo->Has(vtkStreamingDemandDrivenPipeline::TIME_STEPS()))
+  {
+    const double* timeSteps = inInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    this->TimeSteps.assign(
+      timeSteps, timeSteps + inInfo->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS()));
+  }
+
+  // only the time steps of the input are cached
+  this->RequestedIndex = -1;
+  if (outInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    this->RequestedTime = outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+    auto timeStep = std::lower_bound(this->TimeSteps.begin(), this->TimeSteps.end(),
+                                     this->RequestedTime);
+    if (timeStep != this->TimeSteps.end() && *timeStep == this->RequestedTime)
+    {
+      this->RequestedIndex = static_cast<int>(timeStep - this->TimeSteps.begin());
+    }
+  }
+  if (this->RequestedIndex >= 0 && this->PreviousIndex >= 0 &&
+      this->RequestedIndex != this->PreviousIndex)
+  {
+    this->Direction = this->RequestedIndex > this->PreviousIndex ? 1 : -1;
+  }
+  this->PreviousIndex = this->RequestedIndex;
+
+  // the outputs only change with the filters before the cache
+  this->InputTime = this->GetMTime();
+  auto executive = vtkDemandDrivenPipeline::SafeDownCast(this->GetInputExecutive(0, 0));
+  if (executive)
+  {
+    this->InputTime = std::max(this->InputTime, executive->GetPipelineMTime());
+  }
+
+  std::lock_guard<std::mutex> lock(this->CacheMutex);
+  this->Result = nullptr;
+  if (this->RequestedIndex >= 0)
+  {
+    this->Result = this->Cache->GetData(this->RequestedIndex, this->InputTime);
+  }
+  this->Steps.clear();
+  this->Step = 0;
+  this->ComputeRequested = !this->Result;
+  if (this->ComputeRequested)
+  {
+    this->Steps.push_back(this->RequestedIndex);
+  }
+  if (this->RequestedIndex >= 0 && this->Cache->GetMemoryBudget() > 0)
+  {
+    const int numberOfTimeSteps = static_cast<int>(this->TimeSteps.size());
+    for (int k = 1; k <= this->PrecomputeFrames; ++k)
+    {
+      const int index = this->RequestedIndex + k * this->Direction;
+      if (index < 0 || index >= numberOfTimeSteps)
+      {
+        break;
+      }
+      if (!this->Cache->Contains(index, this->InputTime))
+      {
+        this->Steps.push_back(index);
+      }
+    }
+  }
+
+  // announce all the time steps of the loop, so that a reader decodes them together
+  if (this->Steps.size() > 1)
+  {
+    std::vector<double> upcomingTimeSteps;
+    for (int index : this->Steps)
+    {
+      upcomingTimeSteps.push_back(this->TimeSteps[index]);
+    }
+    request->AppendUnique(vtkExecutive::KEYS_TO_COPY(), vtkLidarReader::UPDATE_TIME_STEPS());
+    inInfo->Set(vtkLidarReader::UPDATE_TIME_STEPS(), upcomingTimeSteps.data(),
+                static_cast<int>(upcomingTimeSteps.size()));
+  }
+  else
+  {
+    inInfo->Remove(vtkLidarReader::UPDATE_TIME_STEPS());
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkTemporalCache::RequestUpdateExtent(vtkInformation* request,
+                                          vtkInformationVector** inputVector,
+                                          vtkInformationVector* outputVector)
+{
+  vtkInformation* inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+
+  // the first iteration of the pipeline loop decides which time steps are requested
+  if (this->Step == 0)
+  {
+    this->PlanUpdate(request, inInfo, outInfo);
+  }
+
+  if (this->Steps.empty())
+  {
+    // the output is in the cache, the input is requested at the time it already has so that
+    // the filters before the cache do not execute
+    vtkDataObject* input = inInfo->Get(vtkDataObject::DATA_OBJECT());
+    if (input && input->GetInformation()->Has(vtkDataObject::DATA_TIME_STEP()))
+    {
+      inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(),
+                  input->GetInformation()->Get(vtkDataObject::DATA_TIME_STEP()));
+    }
+    return 1;
+  }
+
+  // a requested time which is not a time step is passed as is
+  const int index = this->Steps[this->Step];
+  if (index >= 0)
+  {
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(), this->TimeSteps[index]);
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkTemporalCache::RequestData(vtkInformation* request,
+                                  vtkInformationVector** inputVector,
+                                  vtkInformationVector* outputVector)
+{
+  VV_TRACE_SCOPE("vtkTemporalCache::RequestData");
+  vtkDataObject* input = vtkDataObject::GetData(inputVector[0], 0);
+  vtkDataObject* output = vtkDataObject::GetData(outputVector, 0);
+
+  std::lock_guard<std::mutex> lock(this->CacheMutex);
+  if (!this->Steps.empty())
+  {
+    const int index = this->Steps[this->Step];
+    vtkSmartPointer<vtkDataObject> copy;
+    if (input)
+    {
+      copy.TakeReference(input->NewInstance());
+      copy->ShallowCopy(input);
+      if (index >= 0)
+      {
+        this->Cache->Add(index, this->InputTime, copy);
+      }
+    }
+    if (this->Step == 0 && this->ComputeRequested)
+    {
+      this->Result = copy;
+    }
+
+    // the next time steps to compute in advance
+    if (++this->Step < this->Steps.size())
+    {
+      request->Set(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING(), 1);
+      return 1;
+    }
+    request->Remove(vtkStreamingDemandDrivenPipeline::CONTINUE_EXECUTING());
+    this->Steps.clear();
+    this->Step = 0;
+  }
+
+  if (this->Result)
+  {
+    output->ShallowCopy(this->Result);
+    if (this->RequestedIndex >= 0)
+    {
+      output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), this->RequestedTime);
+    }
+  }
+  else
+  {
+    output->Initialize();
+  }
+  this->Result = nullptr;
+  return 1;
+}
@@ -0,0 +1,123 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VTK_TEMPORAL_CACHE_H
+#define VTK_TEMPORAL_CACHE_H
+
+#include <vtkPassInputTypeAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+#include <mutex>
+#include <vector>
+
+class FrameCache;
+
+/**
+ * @brief The vtkTemporalCache class keeps the outputs of the filters before it by time step,
+ * so that going back to a time step already visited does not execute them again. It is
+ * inserted after an expensive filter (ransac, raw signal image, infilling...).
+ *
+ * The outputs are kept with the modification time of the pipeline before the cache: when a
+ * filter of this pipeline is modified, all the outputs are discarded. Only the requested
+ * times which are time steps of the input are cached.
+ *
+ * When PrecomputeFrames is set, the time steps following the requested one in the direction
+ * of the last move of the time are also requested from the input, in the same update, and
+ * announced together with vtkLidarReader::UPDATE_TIME_STEPS so that a reader decodes them
+ * concurrently.
+ */
+class VTK_EXPORT vtkTemporalCache : public vtkPassInputTypeAlgorithm
+{
+public:
+  static vtkTemporalCache* New();
+  vtkTypeMacro(vtkTemporalCache, vtkPassInputTypeAlgorithm)
+
+  //@{
+  /**
+   * @brief SetCacheSize set the memory that can be used to keep the outputs, in mebibytes,
+   * 0 disables the cache
+   */
+  void SetCacheSize(int mebibytes);
+  int GetCacheSize();
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkTemporalCache::PrecomputeFrames
+   */
+  vtkGetMacro(PrecomputeFrames, int)
+  void SetPrecomputeFrames(int value);
+  //@}
+
+  //! Number of requested time steps given by the cache
+  int GetCacheHits();
+
+  //! Number of requested time steps for which the input has been executed
+  int GetCacheMisses();
+
+  //! Reset the hit/miss counters
+  void ResetCacheStatistics();
+
+protected:
+  vtkTemporalCache();
+  ~vtkTemporalCache();
+
+  int RequestUpdateExtent(vtkInformation* request,
+                          vtkInformationVector** inputVector,
+                          vtkInformationVector* outputVector) override;
+
+  int RequestData(vtkInformation* request,
+                  vtkInformationVector** inputVector,
+                  vtkInformationVector* outputVector) override;
+
+private:
+  //! Prepare the time steps requested from the input by this update
+  void PlanUpdate(vtkInformation* request, vtkInformation* inInfo, vtkInformation* outInfo);
+
+  //! Number of time steps after the requested one to compute in advance, in the direction of
+  //! the last move of the time. They do not change the output, so the filter is not modified
+  int PrecomputeFrames;
+
+  //! Outputs by index of time step, with the pipeline modification time of the input
+  FrameCache* Cache = nullptr;
+
+  //! Held while the cache is used, so that MemoryAccounting::Enforce does not release it then
+  std::mutex CacheMutex;
+
+  //! Time steps of the input
+  std::vector<double> TimeSteps;
+  //! Requested time, and its time step index, -1 if it is not one of the time steps
+  double RequestedTime = 0.;
+  int RequestedIndex = -1;
+  //! Time step index requested by the previous update, and direction of the last move
+  int PreviousIndex = -1;
+  int Direction = 1;
+  //! Pipeline modification time of the input for the current update
+  vtkMTimeType InputTime = 0;
+
+  //! Time step indices requested from the input by the current update, one per iteration of
+  //! the pipeline loop, and the iteration being executed
+  std::vector<int> Steps;
+  size_t Step = 0;
+  //! Whether the requested time is not in the cache and is the first of Steps
+  bool ComputeRequested = false;
+
+  //! Output of the current update
+  vtkSmartPointer<vtkDataObject> Result;
+
+  vtkTemporalCache(const vtkTemporalCache&) /*= delete*/;
+  void operator=(const vtkTemporalCache&) /*= delete*/;
+};
+
+#endif // VTK_TEMPORAL_CACHE_H
@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include "vtkTemporalTransformsApplier.h"
+#include "FrameCache.h"
+#include "TraceEvents.h"
 
 #include <vtkCellData.h>
 #include <vtkInformation.h>
@@ -22,10 +24,18 @@
 #include <vtkPolyData.h>
 #include <vtkSmartPointer.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
-#include <vtkTransform.h>
 
+#include "PoseGrid.h"
 #include "vtkTemporalTransforms.h"
 
+#include <algorithm>
+
+namespace
+{
+//! Memory used by the transformed frames by default, in mebibytes
+const int DefaultCacheSize = 128;
+}
+
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkTemporalTransformsApplier)
 
@@ -37,6 +47,43 @@ vtkTemporalTransformsApplier::vtkTemporalTransformsApplier()
   this->Interpolator = vtkSmartPointer<vtkVelodyneTransformInterpolator>::New();
   this->Interpolator->SetInterpolationTypeToLinear();
   this->InterpolateEachPoint = true;
+  this->PoseSamplingStep = 1e-4;
+  this->NumberOfThreads = 0;
+  this->Cache = new FrameCache(MemoryAccounting::TRANSFORMED_FRAMES);
+  this->Cache->SetMemoryBudget(DefaultCacheSize * 1024);
+
+  // the frames are transformed again when they are released, unless the cache is being used
+  FrameCache* cache = this->Cache;
+  std::mutex* mutex = &this->CacheMutex;
+  cache->GetMemoryAccount().SetReleaser(MemoryAccounting::DECODED_DATA_PRIORITY,
+    [cache, mutex](unsigned long kibibytes) {
+      std::unique_lock<std::mutex> lock(*mutex, std::try_to_lock);
+      if (lock.owns_lock())
+      {
+        cache->Release(kibibytes);
+      }
+    });
+}
+
+//-----------------------------------------------------------------------------
+vtkTemporalTransformsApplier::~vtkTemporalTransformsApplier()
+{
+  this->Cache->GetMemoryAccount().SetReleaser(0, nullptr);
+  delete this->Cache;
+}
+
+//-----------------------------------------------------------------------------
+void vtkTemporalTransformsApplier::SetCacheSize(int mebibytes)
+{
+  // this does not change the output, so the filter is not modified
+  std::lock_guard<std::mutex> lock(this->CacheMutex);
+  this->Cache->SetMemoryBudget(static_cast<unsigned long>(std::max(mebibytes, 0)) * 1024);
+}
+
+//-----------------------------------------------------------------------------
+int vtkTemporalTransformsApplier::GetCacheSize()
+{
+  return static_cast<int>(this->Cache->GetMemoryBudget() / 1024);
 }
 
 //----------------------------------------------------------------------------
@@ -50,6 +97,7 @@ int vtkTemporalTransformsApplier::RequestData(vtkInformation* vtkNotUsed(request
                         vtkInformationVector** inputVector,
                         vtkInformationVector* outputVector)
 {
+  VV_TRACE_SCOPE("vtkTemporalTransformsApplier::RequestData");
   // Get the input
   vtkPolyData* pointcloud = vtkPolyData::GetData(inputVector[1]->GetInformationObject(0));
   vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
@@ -64,14 +112,88 @@ int vtkTemporalTransformsApplier::RequestData(vtkInformation* vtkNotUsed(request
     this->Interpolator->SetInterpolationType(type);
   }
 
-
-  // Copy the input and create some new points
+  // The output of a time step only changes with the filter and with the pipelines of its
+  // inputs, so a trail of frames going through the filter only transforms its new frames
   vtkPolyData* output = vtkPolyData::GetData(outputVector);
+  const int frameNumber = this->GetCachedFrameNumber(inputVector);
+  vtkMTimeType time = this->GetMTime();
+  for (int port = 0; port < this->GetNumberOfInputPorts(); ++port)
+  {
+    auto executive = vtkDemandDrivenPipeline::SafeDownCast(this->GetInputExecutive(port, 0));
+    time = std::max(time, executive ? executive->GetPipelineMTime() : 0);
+  }
+  std::lock_guard<std::mutex> lock(this->CacheMutex);
+  if (frameNumber >= 0)
+  {
+    vtkSmartPointer<vtkPolyData> frame = this->Cache->Get(frameNumber, time);
+    if (frame && frame->GetNumberOfPoints() == pointcloud->GetNumberOfPoints())
+    {
+      output->ShallowCopy(frame);
+      return 1;
+    }
+  }
+
+  const int result = this->TransformFrame(inputVector, output);
+  if (result && frameNumber >= 0)
+  {
+    auto frame = vtkSmartPointer<vtkPolyData>::New();
+    frame->ShallowCopy(output);
+    this->Cache->Add(frameNumber, time, frame);
+  }
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+int vtkTemporalTransformsApplier::GetCachedFrameNumber(vtkInformationVector** inputVector)
+{
+  vtkInformation* inInfo = inputVector[1]->GetInformationObject(0);
+  if (!inInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()) ||
+      !inInfo->Has(vtkStreamingDemandDrivenPipeline::TIME_STEPS()))
+  {
+    return -1;
+  }
+  const double time = inInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+
+  // the transform of the whole point cloud is given by the time of the trajectory
+  vtkInformation* trajectoryInfo = inputVector[0]->GetInformationObject(0);
+  if (!this->InterpolateEachPoint &&
+      (!trajectoryInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()) ||
+       trajectoryInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()) != time))
+  {
+    return -1;
+  }
+
+  const double* timeSteps = inInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  const double* timeStepsEnd =
+    timeSteps + inInfo->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  const double* timeStep = std::lower_bound(timeSteps, timeStepsEnd, time);
+  return timeStep != timeStepsEnd && *timeStep == time ? static_cast<int>(timeStep - timeSteps) : -1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkTemporalTransformsApplier::TransformFrame(vtkInformationVector** inputVector,
+                                                 vtkPolyData* output)
+{
+  vtkPolyData* pointcloud = vtkPolyData::GetData(inputVector[1]->GetInformationObject(0));
+
+  // Copy the input and create some new points, of the same type as the input ones
   output->ShallowCopy(pointcloud);
+  if (!pointcloud->GetPoints())
+  {
+    return 1;
+  }
+  vtkPoints* inputPoints = pointcloud->GetPoints();
+  const vtkIdType numberOfPoints = pointcloud->GetNumberOfPoints();
   auto points = vtkSmartPointer<vtkPoints>::New();
-  points->SetNumberOfPoints(pointcloud->GetNumberOfPoints());
+  points->SetDataType(inputPoints->GetDataType());
+  points->SetNumberOfPoints(numberOfPoints);
   output->SetPoints(points);
 
+  vtkDataArray* timestamp = nullptr;
+  double matrix[16];
+  PoseGrid grid;
+  grid.Poses.resize(1);
+
   // Apply the same transform to all points. The transform is determined by the
   // pipeline time
   if (!this->InterpolateEachPoint)
@@ -81,46 +203,73 @@ int vtkTemporalTransformsApplier::RequestData(vtkInformation* vtkNotUsed(request
     double currentTimestamp = inInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
 
     // get the right transform
-    auto transform = vtkSmartPointer<vtkTransform>::New();
-    this->Interpolator->InterpolateTransform(currentTimestamp,transform);
-    transform->Update();
-
-    // apply the transform
-    for (vtkIdType i = 0; i < pointcloud->GetNumberOfPoints(); i++)
-    {
-      float* inputPoint = reinterpret_cast<float*>
-          (pointcloud->GetPoints()->GetData()->WriteVoidPointer(3*i,1));
-      float* outputPoint = reinterpret_cast<float*>
-          (output->GetPoints()->GetData()->WriteVoidPointer(3*i,1));
-      transform->InternalTransformPoint(inputPoint, outputPoint);
-    }
+    this->Interpolator->InterpolateTransformMatrix(currentTimestamp, matrix);
+    PoseGrid::GetPose(matrix, grid.Poses[0]);
   }
   // Apply an individual transform to each points. The transform is determined by
   // a time array.
   else
   {
-    auto timestamp = this->GetInputArrayToProcess(0, inputVector);
+    timestamp = this->GetInputArrayToProcess(0, inputVector);
     if (!timestamp)
     {
       vtkErrorMacro(<<"No TimeStamp Array Selected")
       return 1;
     }
-    for (vtkIdType i = 0; i < pointcloud->GetNumberOfPoints(); i++)
+    if (numberOfPoints == 0)
+    {
+      return 1;
+    }
+
+    const int type = this->Interpolator->GetInterpolationType();
+    const bool isContinuous = type == vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_LINEAR ||
+                              type == vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_SPLINE;
+    const int pointsType = inputPoints->GetDataType();
+    if (this->PoseSamplingStep <= 0.0 || !isContinuous || (pointsType != VTK_FLOAT && pointsType != VTK_DOUBLE))
+    {
+      // interpolate the transform of each point, in seconds
+      double x[3], y[3];
+      for (vtkIdType i = 0; i < numberOfPoints; i++)
+      {
+        this->Interpolator->InterpolateTransformMatrix(timestamp->GetComponent(i, 0) * 1e-6, matrix);
+        inputPoints->GetPoint(i, x);
+        for (int k = 0; k < 3; ++k)
+        {
+          y[k] = matrix[4 * k] * x[0] + matrix[4 * k + 1] * x[1] + matrix[4 * k + 2] * x[2] + matrix[4 * k + 3];
+        }
+        points->SetPoint(i, y);
+      }
+      return 1;
+    }
+
+    // sample the poses over the time range of the frame, in seconds
+    double timeRange[2];
+    timestamp->GetRange(timeRange, 0);
+    grid.Sample(this->Interpolator, timeRange[0] * 1e-6, timeRange[1] * 1e-6, this->PoseSamplingStep);
+  }
+
+  // apply the transforms, the time of the points is only needed with several poses
+  auto time = [timestamp](vtkIdType i) { return timestamp->GetComponent(i, 0) * 1e-6; };
+  if (inputPoints->GetDataType() == VTK_DOUBLE)
+  {
+    TransformPoints(static_cast<const double*>(inputPoints->GetVoidPointer(0)),
+                    static_cast<double*>(points->GetVoidPointer(0)),
+                    numberOfPoints, time, grid, this->NumberOfThreads);
+  }
+  else if (inputPoints->GetDataType() == VTK_FLOAT)
+  {
+    TransformPoints(static_cast<const float*>(inputPoints->GetVoidPointer(0)),
+                    static_cast<float*>(points->GetVoidPointer(0)),
+                    numberOfPoints, time, grid, this->NumberOfThreads);
+  }
+  else
+  {
+    double x[3];
+    for (vtkIdType i = 0; i < numberOfPoints; i++)
     {
-      // get timestamp in seconds
-      double currentTimestamp = timestamp->GetTuple1(i) * 1e-6;
-
-      // get the right transform
-      auto transform = vtkSmartPointer<vtkTransform>::New();
-      this->Interpolator->InterpolateTransform(currentTimestamp,transform);
-      transform->Update();
-
-      // apply the transform
-      float* inputPoint = reinterpret_cast<float*>
-          (pointcloud->GetPoints()->GetData()->WriteVoidPointer(3*i,1));
-      float* outputPoint = reinterpret_cast<float*>
-          (output->GetPoints()->GetData()->WriteVoidPointer(3*i,1));
-      transform->InternalTransformPoint(inputPoint, outputPoint);
+      inputPoints->GetPoint(i, x);
+      const Eigen::Vector3d y = grid.Poses[0].leftCols<3>() * Eigen::Vector3d(x[0], x[1], x[2]) + grid.Poses[0].col(3);
+      points->SetPoint(i, y.data());
     }
   }
 
@@ -18,8 +18,12 @@
 #include <vtkNew.h>
 #include <vtkPolyDataAlgorithm.h>
 
+#include <mutex>
+
 #include "vtkVelodyneTransformInterpolator.h"
 
+class FrameCache;
+
 /**
  * @brief The vtkTemporalTransformsApplier take 2 inputs : a vtkTemporalTransforms which
  * contains the poses and orientation of the sensor and a polydata.
@@ -48,6 +52,32 @@ public:
   vtkSetMacro(InterpolateEachPoint, bool)
   //@}
 
+  //@{
+  /**
+   * @copydoc vtkTemporalTransformsApplier::PoseSamplingStep
+   */
+  vtkGetMacro(PoseSamplingStep, double)
+  vtkSetMacro(PoseSamplingStep, double)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkTemporalTransformsApplier::NumberOfThreads
+   */
+  vtkGetMacro(NumberOfThreads, int)
+  vtkSetMacro(NumberOfThreads, int)
+  //@}
+
+  //@{
+  /**
+   * @brief SetCacheSize set the memory that can be used to keep the transformed frames, in
+   * mebibytes, 0 disables the cache. The frames are cached by time step, so that a trail of
+   * frames only transforms its new frame when the time moves.
+   */
+  void SetCacheSize(int mebibytes);
+  int GetCacheSize();
+  //@}
+
   /**
    * @brief Override GetMTime() because we depend on the TransformInterpolator
    * which may be modified outside of this class.
@@ -56,6 +86,7 @@ public:
 
 protected:
   vtkTemporalTransformsApplier();
+  ~vtkTemporalTransformsApplier();
 
   int RequestInformation(vtkInformation* request,
                   vtkInformationVector** inputVector,
@@ -66,15 +97,39 @@ protected:
                   vtkInformationVector* outputVector);
 
 private:
+  //! Transform the points of the point cloud into output
+  int TransformFrame(vtkInformationVector** inputVector, vtkPolyData* output);
+
+  /**
+   * @brief GetCachedFrameNumber index of the requested time in the time steps of the point
+   * cloud, -1 if the time is not one of them and the output cannot be cached
+   */
+  int GetCachedFrameNumber(vtkInformationVector** inputVector);
+
     //! Indicate if a different transform should be apply to each point,
   //! or if the same transform should be apply to the whole point cloud.
   //! In the first case you must specify the array from the pointcloud containing the
   //! timestamp with 'SetInputArrayToProcess'
   bool InterpolateEachPoint;
 
+  //! When each point is interpolated, the poses are only interpolated once
+  //! per frame every PoseSamplingStep seconds, and the pose of a point is
+  //! blended from the two samples around its time. This is only done for
+  //! the linear and spline interpolations, 0 interpolates each point exactly
+  double PoseSamplingStep;
+
+  //! Number of threads transforming the points, 0 uses one thread per core
+  int NumberOfThreads;
+
   //! Interpolator used to get the right transform
   vtkSmartPointer<vtkVelodyneTransformInterpolator> Interpolator;
 
+  //! Transformed frames, with the modification time of the filter and of its inputs pipelines
+  FrameCache* Cache = nullptr;
+
+  //! Held while the cache is used, so that MemoryAccounting::Enforce does not release it then
+  std::mutex CacheMutex;
+
   vtkTemporalTransformsApplier(const vtkTemporalTransformsApplier&) /*= delete*/;
   void operator =(const vtkTemporalTransformsApplier&) /*= delete*/;
 };
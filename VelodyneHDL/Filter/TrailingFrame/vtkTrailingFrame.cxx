@@ -1,8 +1,23 @@
 #include "vtkTrailingFrame.h"
+#include "TraceEvents.h"
+#include "vtkLidarReader.h"
 
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkExecutive.h>
+#include <vtkInformationDoubleVectorKey.h>
+#include <vtkInformationKeyVectorKey.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkInformationVector.h>
 #include <vtkInformation.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+
+namespace
+{
+//! Extra capacity of the slots, so that they are not reallocated for slightly larger frames
+const double SlotCapacityMargin = 1.25;
+}
 
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkTrailingFrame)
@@ -12,10 +27,14 @@ vtkTrailingFrame::vtkTrailingFrame()
   : NumberOfTrailingFrames(0),
     PipelineTime(0),
     LastTimeProcessedIndex(-1),
-    FirstFilterIteration(true)
+    FirstFilterIteration(true),
+    MergeFrames(false),
+    SlotCapacity(0),
+    CacheMemory(MemoryAccounting::TRAILING_FRAMES)
 {
   this->CacheTimeRange[0] = -1;
   this->CacheTimeRange[1] = -1;
+  this->SetNumberOfOutputPorts(2);
 }
 
 //----------------------------------------------------------------------------
@@ -30,6 +49,21 @@ void vtkTrailingFrame::SetNumberOfTrailingFrames(const unsigned int value)
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkTrailingFrame::SetMergeFrames(const bool value)
+{
+  if (this->MergeFrames != value)
+  {
+    this->MergeFrames = value;
+    // release the slots, they are filled from the cache when enabled again
+    this->MergedFrames->Initialize();
+    this->SlotCapacity = 0;
+    this->SlotFrames.clear();
+    this->UpdateCacheMemory();
+    this->Modified();
+  }
+}
+
 //----------------------------------------------------------------------------
 int vtkTrailingFrame::FillOutputPortInformation(int port, vtkInformation *info)
 {
@@ -38,12 +72,17 @@ int vtkTrailingFrame::FillOutputPortInformation(int port, vtkInformation *info)
     info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkMultiBlockDataSet");
     return 1;
   }
+  if (port == 1)
+  {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkPolyData");
+    return 1;
+  }
 
   return 0;
 }
 
 //----------------------------------------------------------------------------
-int vtkTrailingFrame::RequestUpdateExtent(vtkInformation* vtkNotUsed(request),
+int vtkTrailingFrame::RequestUpdateExtent(vtkInformation* request,
                                       vtkInformationVector** inputVector,
                                       vtkInformationVector* vtkNotUsed(outputVector))
 {
@@ -111,10 +150,31 @@ int vtkTrailingFrame::RequestUpdateExtent(vtkInformation* vtkNotUsed(request),
       this->LastTimeProcessedIndex = std::max(this->CacheTimeRange[0], previousCacheTimeRange[1]);
     }
     this->FirstFilterIteration = false;
+
+    // announce all the time steps of the loop, so that a reader decodes them together
+    const int lastIndex = this->Direction == 1 ? this->CacheTimeRange[1] - 1 : this->CacheTimeRange[0];
+    std::vector<double> upcomingTimeSteps;
+    for (int index = this->LastTimeProcessedIndex; this->Direction * (lastIndex - index) >= 0;
+         index += this->Direction)
+    {
+      upcomingTimeSteps.push_back(this->TimeSteps[index]);
+    }
+    if (upcomingTimeSteps.size() > 1)
+    {
+      request->AppendUnique(vtkExecutive::KEYS_TO_COPY(), vtkLidarReader::UPDATE_TIME_STEPS());
+      inInfo->Set(vtkLidarReader::UPDATE_TIME_STEPS(), upcomingTimeSteps.data(),
+                  static_cast<int>(upcomingTimeSteps.size()));
+    }
+    else
+    {
+      inInfo->Remove(vtkLidarReader::UPDATE_TIME_STEPS());
+    }
   }
   // not first loop
   else
   {
+    // the time steps announced by the first iteration are kept for the whole loop, so that a
+    // reader updating asynchronously gives the requested frames
     this->LastTimeProcessedIndex += this->Direction;
   }
 
@@ -129,9 +189,11 @@ int vtkTrailingFrame::RequestData(vtkInformation* request,
                                   vtkInformationVector** inputVector,
                                   vtkInformationVector* outputVector)
 {
+  VV_TRACE_SCOPE("vtkTrailingFrame::RequestData");
   vtkPolyData* input = vtkPolyData::GetData(inputVector[0],0);
   vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
-  vtkMultiBlockDataSet* output = vtkMultiBlockDataSet::GetData(outputVector);
+  vtkMultiBlockDataSet* output = vtkMultiBlockDataSet::GetData(outputVector, 0);
+  vtkPolyData* mergedOutput = vtkPolyData::GetData(outputVector, 1);
 
   if ((this->LastTimeProcessedIndex == this->CacheTimeRange[0] && this->Direction == -1)
       || (this->LastTimeProcessedIndex == this->CacheTimeRange[1]-1 && this->Direction == 1))
@@ -186,5 +248,192 @@ int vtkTrailingFrame::RequestData(vtkInformation* request,
       output->SetBlock(n - i, this->Cache->GetBlock((current_frame_index + i) % n));
     }
   }
+
+  // the merged frames are updated once all the frames are in the cache
+  if (this->MergeFrames && this->FirstFilterIteration)
+  {
+    this->UpdateMergedFrames();
+  }
+  mergedOutput->ShallowCopy(this->MergedFrames.GetPointer());
+  this->UpdateCacheMemory();
   return 1;
 }
+
+//----------------------------------------------------------------------------
+void vtkTrailingFrame::UpdateCacheMemory()
+{
+  this->CacheMemory.Set(
+    this->Cache->GetActualMemorySize() + this->MergedFrames->GetActualMemorySize());
+}
+
+//----------------------------------------------------------------------------
+void vtkTrailingFrame::UpdateMergedFrames()
+{
+  const unsigned int numberOfSlots = this->NumberOfTrailingFrames + 1;
+  if (this->SlotFrames.size() != numberOfSlots)
+  {
+    this->SlotFrames.assign(numberOfSlots, nullptr);
+    this->SlotCapacity = 0;
+    this->MergedFrames->Initialize();
+  }
+
+  // the frames of the cache, the slots keep a reference to the frame they
+  // hold so a new frame is a new polydata
+  std::vector<vtkPolyData*> frames(numberOfSlots, nullptr);
+  vtkPolyData* largestFrame = nullptr;
+  bool fitsInSlots = true;
+  for (unsigned int slot = 0; slot < numberOfSlots; ++slot)
+  {
+    vtkPolyData* frame = vtkPolyData::SafeDownCast(this->Cache->GetBlock(slot));
+    if (!frame || frame->GetNumberOfPoints() == 0)
+    {
+      continue;
+    }
+    frames[slot] = frame;
+    if (!largestFrame || frame->GetNumberOfPoints() > largestFrame->GetNumberOfPoints())
+    {
+      largestFrame = frame;
+    }
+    if (frame != this->SlotFrames[slot].GetPointer())
+    {
+      fitsInSlots &= this->FitsInMergedFrames(frame);
+    }
+  }
+
+  // all the frames are written again in new slots
+  bool verticesModified = false;
+  if (!fitsInSlots)
+  {
+    this->AllocateMergedFrames(largestFrame,
+      static_cast<vtkIdType>(SlotCapacityMargin * largestFrame->GetNumberOfPoints()));
+    this->SlotFrames.assign(numberOfSlots, nullptr);
+    verticesModified = true;
+  }
+
+  for (unsigned int slot = 0; slot < numberOfSlots; ++slot)
+  {
+    if (frames[slot] == this->SlotFrames[slot].GetPointer())
+    {
+      continue;
+    }
+    verticesModified |= !frames[slot] != !this->SlotFrames[slot];
+    this->SlotFrames[slot] = frames[slot];
+    if (frames[slot])
+    {
+      this->WriteSlot(slot, frames[slot]);
+    }
+  }
+
+  if (verticesModified)
+  {
+    this->UpdateMergedVertices();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkTrailingFrame::FitsInMergedFrames(vtkPolyData* frame) const
+{
+  vtkPoints* points = this->MergedFrames->GetPoints();
+  if (!points || frame->GetNumberOfPoints() > this->SlotCapacity ||
+      points->GetDataType() != frame->GetPoints()->GetDataType())
+  {
+    return false;
+  }
+  // the frame must have all the merged arrays and no other named one
+  vtkPointData* mergedData = this->MergedFrames->GetPointData();
+  vtkPointData* frameData = frame->GetPointData();
+  int numberOfArrays = 0;
+  for (int i = 0; i < frameData->GetNumberOfArrays(); ++i)
+  {
+    vtkDataArray* array = frameData->GetArray(i);
+    if (!array || !array->GetName())
+    {
+      continue;
+    }
+    vtkDataArray* merged = mergedData->GetArray(array->GetName());
+    if (!merged || merged->GetDataType() != array->GetDataType() ||
+        merged->GetNumberOfComponents() != array->GetNumberOfComponents())
+    {
+      return false;
+    }
+    numberOfArrays++;
+  }
+  return numberOfArrays == mergedData->GetNumberOfArrays();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrailingFrame::AllocateMergedFrames(vtkPolyData* frame, vtkIdType capacity)
+{
+  const vtkIdType numberOfPoints = capacity * (this->NumberOfTrailingFrames + 1);
+  this->SlotCapacity = capacity;
+  this->MergedFrames->Initialize();
+
+  vtkNew<vtkPoints> points;
+  points->SetDataType(frame->GetPoints()->GetDataType());
+  points->SetNumberOfPoints(numberOfPoints);
+  this->MergedFrames->SetPoints(points.GetPointer());
+
+  // only the named arrays are kept, they are looked up by name
+  vtkPointData* frameData = frame->GetPointData();
+  for (int i = 0; i < frameData->GetNumberOfArrays(); ++i)
+  {
+    vtkDataArray* array = frameData->GetArray(i);
+    if (!array || !array->GetName())
+    {
+      continue;
+    }
+    vtkSmartPointer<vtkDataArray> merged;
+    merged.TakeReference(array->NewInstance());
+    merged->SetName(array->GetName());
+    merged->SetNumberOfComponents(array->GetNumberOfComponents());
+    merged->SetNumberOfTuples(numberOfPoints);
+    this->MergedFrames->GetPointData()->AddArray(merged);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkTrailingFrame::WriteSlot(unsigned int slot, vtkPolyData* frame)
+{
+  const vtkIdType start = slot * this->SlotCapacity;
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+
+  // arrays are copied along with the points, the unused points of the slot
+  // take the values of the last point of the frame
+  std::vector<std::pair<vtkDataArray*, vtkDataArray*> > arrays;
+  arrays.emplace_back(frame->GetPoints()->GetData(), this->MergedFrames->GetPoints()->GetData());
+  vtkPointData* mergedData = this->MergedFrames->GetPointData();
+  for (int i = 0; i < mergedData->GetNumberOfArrays(); ++i)
+  {
+    vtkDataArray* merged = mergedData->GetArray(i);
+    arrays.emplace_back(frame->GetPointData()->GetArray(merged->GetName()), merged);
+  }
+  for (const auto& array : arrays)
+  {
+    for (vtkIdType k = 0; k < this->SlotCapacity; ++k)
+    {
+      array.second->SetTuple(start + k, std::min(k, numberOfPoints - 1), array.first);
+    }
+    array.second->Modified();
+  }
+  this->MergedFrames->GetPoints()->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkTrailingFrame::UpdateMergedVertices()
+{
+  // a poly vertex cell per non empty slot
+  vtkNew<vtkCellArray> vertices;
+  for (unsigned int slot = 0; slot < this->SlotFrames.size(); ++slot)
+  {
+    if (!this->SlotFrames[slot])
+    {
+      continue;
+    }
+    vertices->InsertNextCell(static_cast<int>(this->SlotCapacity));
+    for (vtkIdType k = 0; k < this->SlotCapacity; ++k)
+    {
+      vertices->InsertCellPoint(slot * this->SlotCapacity + k);
+    }
+  }
+  this->MergedFrames->SetVerts(vertices.GetPointer());
+}
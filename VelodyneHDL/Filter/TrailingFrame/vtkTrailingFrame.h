@@ -2,15 +2,20 @@
 #define VTKTRAILINGFRAME_H
 
 #include <queue>
+#include <vector>
 
 #include "vtkPolyDataAlgorithm.h"
+#include "MemoryAccounting.h"
 #include <vtkNew.h>
 #include <vtkMultiBlockDataSet.h>
+#include <vtkSmartPointer.h>
 
 /**
  * @brief The vtkTrailingFrame class is a filter that combine consecutive timestep
  * of its input to produce a multiblock.
  * The input of this filter must produce only consecutive interger timestep.
+ * If MergeFrames is enabled, the trailing frames are also merged in a single
+ * polydata on the second output.
  */
 class VTK_EXPORT vtkTrailingFrame : public vtkPolyDataAlgorithm
 {
@@ -24,6 +29,12 @@ public:
   void SetNumberOfTrailingFrames(const unsigned int value);
   //! @}
 
+  //! @{
+  //! @copydoc MergeFrames
+  vtkGetMacro(MergeFrames, bool)
+  void SetMergeFrames(const bool value);
+  //! @}
+
 protected:
   vtkTrailingFrame();
 
@@ -57,6 +68,34 @@ private:
   //! Help variable
   bool FirstFilterIteration;
 
+  //! Merge the trailing frames in a single polydata, produced on the second output.
+  //! Each frame has a slot of preallocated points, in a ring like the cache blocks,
+  //! so that moving to the next time step only overwrites the slot of the oldest frame.
+  //! The points of a slot which are not used by its frame are copies of its last point
+  bool MergeFrames;
+  //! Merged frames, with only the point data arrays of the frames
+  vtkNew<vtkPolyData> MergedFrames;
+  //! Number of points of each slot
+  vtkIdType SlotCapacity;
+  //! Frame written in each slot, nullptr if the slot is empty
+  std::vector<vtkSmartPointer<vtkPolyData> > SlotFrames;
+
+  //! Memory used by the cache and the merged frames
+  MemoryAccounting::Account CacheMemory;
+
+  //! Write the cache blocks which have changed in their slots
+  void UpdateMergedFrames();
+  //! Allocate the slots for frames with the same points and arrays as frame
+  void AllocateMergedFrames(vtkPolyData* frame, vtkIdType capacity);
+  //! Indicate if the points and the arrays of frame can be written in a slot
+  bool FitsInMergedFrames(vtkPolyData* frame) const;
+  //! Copy frame in a slot and pad the slot with its last point
+  void WriteSlot(unsigned int slot, vtkPolyData* frame);
+  //! Vertices of all the points of the non empty slots
+  void UpdateMergedVertices();
+  //! Set CacheMemory from the current cache and merged frames
+  void UpdateCacheMemory();
+
   vtkTrailingFrame(const vtkTrailingFrame&); // not implemented
   void operator=(const vtkTrailingFrame&); // not implemented
 };
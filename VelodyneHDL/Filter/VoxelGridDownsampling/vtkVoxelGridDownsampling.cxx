@@ -0,0 +1,355 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkVoxelGridDownsampling.h"
+#include "ParallelPoints.h"
+#include "TraceEvents.h"
+
+// STD
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// BOOST
+#include <boost/thread/thread.hpp>
+
+namespace
+{
+//! Points processed by a thread at least
+const vtkIdType MinimumPointsPerThread = 65536;
+
+//-----------------------------------------------------------------------------
+// Voxels met by a range of points, in the order of their first point
+struct RangeVoxels
+{
+  std::unordered_map<uint64_t, vtkIdType> Indices;
+  std::vector<uint64_t> Keys;
+  std::vector<vtkIdType> Counts;
+  std::vector<std::array<double, 3> > Sums;
+  //! Index in the output of each voxel
+  std::vector<vtkIdType> OutputIndices;
+  //! Point of the range closest to the centroid of each voxel, and its squared distance
+  std::vector<vtkIdType> Closest;
+  std::vector<double> ClosestDistances;
+};
+}
+
+// Implementation of the New function
+vtkStandardNewMacro(vtkVoxelGridDownsampling)
+
+//-----------------------------------------------------------------------------
+int vtkVoxelGridDownsampling::RequestData(vtkInformation *vtkNotUsed(request),
+  vtkInformationVector **inputVector, vtkInformationVector *outputVector)
+{
+  VV_TRACE_SCOPE("vtkVoxelGridDownsampling::RequestData");
+  vtkPolyData* input = vtkPolyData::GetData(inputVector[0]->GetInformationObject(0));
+  vtkPolyData* output = vtkPolyData::GetData(outputVector->GetInformationObject(0));
+
+  if (this->LeafSize[0] <= 0. || this->LeafSize[1] <= 0. || this->LeafSize[2] <= 0.)
+  {
+    vtkErrorMacro("The leaf size must be positive");
+    return 0;
+  }
+  const vtkIdType numberOfPoints = input->GetNumberOfPoints();
+  if (numberOfPoints == 0)
+  {
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  int numberOfThreads = this->NumberOfThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = boost::thread::hardware_concurrency();
+  }
+  const int numberOfRanges = std::max<int>(1,
+    std::min<vtkIdType>(numberOfThreads, numberOfPoints / MinimumPointsPerThread));
+
+  // Bounds of the finite points, each range of points computing its own
+  std::vector<std::array<double, 6> > rangeBounds(numberOfRanges);
+  ParallelFor(numberOfPoints, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    std::array<double, 6>& bounds = rangeBounds[range];
+    for (int i = 0; i < 3; ++i)
+    {
+      bounds[2 * i] = std::numeric_limits<double>::max();
+      bounds[2 * i + 1] = std::numeric_limits<double>::lowest();
+    }
+    double point[3];
+    for (size_t pointIndex = begin; pointIndex < end; ++pointIndex)
+    {
+      input->GetPoint(pointIndex, point);
+      if (!std::isfinite(point[0]) || !std::isfinite(point[1]) || !std::isfinite(point[2]))
+      {
+        continue;
+      }
+      for (int i = 0; i < 3; ++i)
+      {
+        bounds[2 * i] = std::min(bounds[2 * i], point[i]);
+        bounds[2 * i + 1] = std::max(bounds[2 * i + 1], point[i]);
+      }
+    }
+  });
+  double minimum[3], maximum[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    minimum[i] = std::numeric_limits<double>::max();
+    maximum[i] = std::numeric_limits<double>::lowest();
+    for (const std::array<double, 6>& bounds : rangeBounds)
+    {
+      minimum[i] = std::min(minimum[i], bounds[2 * i]);
+      maximum[i] = std::max(maximum[i], bounds[2 * i + 1]);
+    }
+  }
+  if (minimum[0] > maximum[0])
+  {
+    vtkWarningMacro("No finite point, the output is empty");
+    return 1;
+  }
+
+  // The voxels are aligned on the multiples of the leaf size, their key is their
+  // index in the grid covering the bounds, which must fit in 64 bits
+  int64_t origin[3];
+  uint64_t dimensions[3];
+  double numberOfVoxels = 1.;
+  for (int i = 0; i < 3; ++i)
+  {
+    origin[i] = static_cast<int64_t>(std::floor(minimum[i] / this->LeafSize[i]));
+    const double dimension = std::floor(maximum[i] / this->LeafSize[i]) - origin[i] + 1.;
+    numberOfVoxels *= dimension;
+    dimensions[i] = static_cast<uint64_t>(dimension);
+  }
+  if (numberOfVoxels > static_cast<double>(std::numeric_limits<int64_t>::max()))
+  {
+    vtkWarningMacro("The leaf size is too small for the bounds of the points, they are not downsampled");
+    output->ShallowCopy(input);
+    return 1;
+  }
+
+  // First pass, each range of points counts the points of its voxels and sums
+  // their coordinates. The voxel of each point is its index in its range
+  std::vector<RangeVoxels> rangeVoxels(numberOfRanges);
+  std::vector<vtkIdType> voxelOfPoint(numberOfPoints);
+  ParallelFor(numberOfPoints, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    RangeVoxels& voxels = rangeVoxels[range];
+    double point[3];
+    for (size_t pointIndex = begin; pointIndex < end; ++pointIndex)
+    {
+      input->GetPoint(pointIndex, point);
+      if (!std::isfinite(point[0]) || !std::isfinite(point[1]) || !std::isfinite(point[2]))
+      {
+        voxelOfPoint[pointIndex] = -1;
+        continue;
+      }
+      uint64_t index[3];
+      for (int i = 0; i < 3; ++i)
+      {
+        index[i] = static_cast<uint64_t>(static_cast<int64_t>(std::floor(point[i] / this->LeafSize[i])) - origin[i]);
+      }
+      const uint64_t key = index[0] + dimensions[0] * (index[1] + dimensions[1] * index[2]);
+      auto inserted = voxels.Indices.emplace(key, static_cast<vtkIdType>(voxels.Keys.size()));
+      const vtkIdType voxel = inserted.first->second;
+      if (inserted.second)
+      {
+        voxels.Keys.push_back(key);
+        voxels.Counts.push_back(0);
+        voxels.Sums.push_back({{0., 0., 0.}});
+      }
+      voxels.Counts[voxel]++;
+      for (int i = 0; i < 3; ++i)
+      {
+        voxels.Sums[voxel][i] += point[i];
+      }
+      voxelOfPoint[pointIndex] = voxel;
+    }
+  });
+
+  // Merge the voxels of the ranges in order, so that the output points are in
+  // the order of the first point of their voxel
+  std::unordered_map<uint64_t, vtkIdType> outputIndices;
+  std::vector<vtkIdType> counts;
+  std::vector<std::array<double, 3> > centroids;
+  for (RangeVoxels& voxels : rangeVoxels)
+  {
+    voxels.OutputIndices.resize(voxels.Keys.size());
+    for (size_t voxel = 0; voxel < voxels.Keys.size(); ++voxel)
+    {
+      auto inserted = outputIndices.emplace(voxels.Keys[voxel], static_cast<vtkIdType>(counts.size()));
+      const vtkIdType outputIndex = inserted.first->second;
+      if (inserted.second)
+      {
+        counts.push_back(0);
+        centroids.push_back({{0., 0., 0.}});
+      }
+      counts[outputIndex] += voxels.Counts[voxel];
+      for (int i = 0; i < 3; ++i)
+      {
+        centroids[outputIndex][i] += voxels.Sums[voxel][i];
+      }
+      voxels.OutputIndices[voxel] = outputIndex;
+    }
+    std::unordered_map<uint64_t, vtkIdType>().swap(voxels.Indices);
+  }
+  const vtkIdType numberOfOutputPoints = static_cast<vtkIdType>(counts.size());
+  for (vtkIdType voxel = 0; voxel < numberOfOutputPoints; ++voxel)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      centroids[voxel][i] /= counts[voxel];
+    }
+  }
+
+  // Second pass, each range of points finds its points closest to the centroids
+  ParallelFor(numberOfPoints, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    RangeVoxels& voxels = rangeVoxels[range];
+    voxels.Closest.assign(voxels.Keys.size(), -1);
+    voxels.ClosestDistances.assign(voxels.Keys.size(), std::numeric_limits<double>::max());
+    double point[3];
+    for (size_t pointIndex = begin; pointIndex < end; ++pointIndex)
+    {
+      const vtkIdType voxel = voxelOfPoint[pointIndex];
+      if (voxel < 0)
+      {
+        continue;
+      }
+      input->GetPoint(pointIndex, point);
+      const std::array<double, 3>& centroid = centroids[voxels.OutputIndices[voxel]];
+      const double distance = (point[0] - centroid[0]) * (point[0] - centroid[0]) +
+        (point[1] - centroid[1]) * (point[1] - centroid[1]) +
+        (point[2] - centroid[2]) * (point[2] - centroid[2]);
+      if (distance < voxels.ClosestDistances[voxel])
+      {
+        voxels.ClosestDistances[voxel] = distance;
+        voxels.Closest[voxel] = pointIndex;
+      }
+    }
+  });
+
+  // the ranges are merged in order, so that the first of the closest points is kept
+  std::vector<vtkIdType> closest(numberOfOutputPoints, -1);
+  std::vector<double> closestDistances(numberOfOutputPoints, std::numeric_limits<double>::max());
+  for (const RangeVoxels& voxels : rangeVoxels)
+  {
+    for (size_t voxel = 0; voxel < voxels.Keys.size(); ++voxel)
+    {
+      const vtkIdType outputIndex = voxels.OutputIndices[voxel];
+      if (voxels.ClosestDistances[voxel] < closestDistances[outputIndex])
+      {
+        closestDistances[outputIndex] = voxels.ClosestDistances[voxel];
+        closest[outputIndex] = voxels.Closest[voxel];
+      }
+    }
+  }
+
+  // Emit the output points with the point data of the closest points
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataType(input->GetPoints()->GetDataType());
+  points->SetNumberOfPoints(numberOfOutputPoints);
+
+  vtkPointData* inputPointData = input->GetPointData();
+  std::vector<vtkDataArray*> inputArrays;
+  std::vector<vtkSmartPointer<vtkDataArray> > outputArrays;
+  for (int arrayIndex = 0; arrayIndex < inputPointData->GetNumberOfArrays(); ++arrayIndex)
+  {
+    vtkDataArray* inputArray = inputPointData->GetArray(arrayIndex);
+    if (!inputArray)
+    {
+      continue;
+    }
+    vtkSmartPointer<vtkDataArray> outputArray;
+    outputArray.TakeReference(inputArray->NewInstance());
+    outputArray->SetName(inputArray->GetName());
+    outputArray->SetNumberOfComponents(inputArray->GetNumberOfComponents());
+    outputArray->SetNumberOfTuples(numberOfOutputPoints);
+    inputArrays.push_back(inputArray);
+    outputArrays.push_back(outputArray);
+  }
+
+  const int numberOfOutputRanges = std::max<int>(1,
+    std::min<vtkIdType>(numberOfThreads, numberOfOutputPoints / MinimumPointsPerThread));
+  ParallelFor(numberOfOutputPoints, numberOfOutputRanges, [&](size_t, size_t begin, size_t end) {
+    double point[3];
+    for (size_t voxel = begin; voxel < end; ++voxel)
+    {
+      if (this->SamplingMode == ClosestPoint)
+      {
+        input->GetPoint(closest[voxel], point);
+        points->SetPoint(voxel, point);
+      }
+      else
+      {
+        points->SetPoint(voxel, centroids[voxel].data());
+      }
+      for (size_t arrayIndex = 0; arrayIndex < inputArrays.size(); ++arrayIndex)
+      {
+        outputArrays[arrayIndex]->SetTuple(voxel, closest[voxel], inputArrays[arrayIndex]);
+      }
+    }
+  });
+
+  vtkSmartPointer<vtkIdTypeArray> cells = vtkSmartPointer<vtkIdTypeArray>::New();
+  cells->SetNumberOfValues(2 * numberOfOutputPoints);
+  vtkIdType* ids = cells->GetPointer(0);
+  for (vtkIdType i = 0; i < numberOfOutputPoints; ++i)
+  {
+    ids[2 * i] = 1;
+    ids[2 * i + 1] = i;
+  }
+  vtkSmartPointer<vtkCellArray> verts = vtkSmartPointer<vtkCellArray>::New();
+  verts->SetCells(numberOfOutputPoints, cells);
+
+  output->SetPoints(points);
+  output->SetVerts(verts);
+  for (size_t arrayIndex = 0; arrayIndex < outputArrays.size(); ++arrayIndex)
+  {
+    output->GetPointData()->AddArray(outputArrays[arrayIndex]);
+  }
+  if (inputPointData->GetScalars() && inputPointData->GetScalars()->GetName())
+  {
+    output->GetPointData()->SetActiveScalars(inputPointData->GetScalars()->GetName());
+  }
+  output->GetFieldData()->PassData(input->GetFieldData());
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVoxelGridDownsampling::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LeafSize: " << this->LeafSize[0] << " " << this->LeafSize[1] << " "
+     << this->LeafSize[2] << std::endl;
+  os << indent << "SamplingMode: " << this->SamplingMode << std::endl;
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << std::endl;
+}
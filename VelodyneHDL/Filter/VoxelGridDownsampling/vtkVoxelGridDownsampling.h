@@ -0,0 +1,85 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_VOXEL_GRID_DOWNSAMPLING_H
+#define VTK_VOXEL_GRID_DOWNSAMPLING_H
+
+// VTK
+#include <vtkPolyDataAlgorithm.h>
+
+/**
+ * @brief vtkVoxelGridDownsampling keep one point per occupied voxel of a regular grid.
+ * The voxels are found with a hash table, the points being processed by several threads.
+ * The point data arrays (intensity, laser_id, timestamp, ...) of the output points are
+ * the ones of the input point closest to the centroid of each voxel, so that they stay
+ * meaningful. The output points are in the order of the first input point of their voxel,
+ * whatever the number of threads
+ */
+class VTK_EXPORT vtkVoxelGridDownsampling : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkVoxelGridDownsampling *New();
+  vtkTypeMacro(vtkVoxelGridDownsampling, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  enum SamplingModes
+  {
+    //! The output point is the centroid of the points of the voxel
+    Centroid = 0,
+    //! The output point is the input point closest to the centroid of the voxel
+    ClosestPoint = 1
+  };
+
+  /// Get the size of the voxels along x, y and z
+  vtkGetVector3Macro(LeafSize, double)
+
+  /// Set the size of the voxels along x, y and z
+  vtkSetVector3Macro(LeafSize, double)
+
+  /// Get the position of the output points
+  vtkGetMacro(SamplingMode, int)
+
+  /// Set the position of the output points, one of SamplingModes
+  vtkSetClampMacro(SamplingMode, int, Centroid, ClosestPoint)
+
+  /// Get the number of threads processing the points
+  vtkGetMacro(NumberOfThreads, int)
+
+  /// Set the number of threads processing the points, 0 uses one thread per core
+  vtkSetMacro(NumberOfThreads, int)
+
+protected:
+  vtkVoxelGridDownsampling() = default;
+  ~vtkVoxelGridDownsampling() = default;
+
+  int RequestData(vtkInformation *, vtkInformationVector **, vtkInformationVector *) override;
+
+private:
+  vtkVoxelGridDownsampling(const vtkVoxelGridDownsampling&) = delete;
+  void operator=(const vtkVoxelGridDownsampling&) = delete;
+
+  /// size of the voxels along x, y and z
+  double LeafSize[3] = {0.2, 0.2, 0.2};
+
+  /// position of the output points
+  int SamplingMode = Centroid;
+
+  /// number of threads processing the points
+  int NumberOfThreads = 0;
+};
+
+#endif // VTK_VOXEL_GRID_DOWNSAMPLING_H
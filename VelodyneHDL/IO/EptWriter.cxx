@@ -0,0 +1,482 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "EptWriter.h"
+
+// BOOST
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+
+// STD
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+//! Size of a point in the data files: X, Y, Z, Intensity, UserData, GpsTime
+const size_t RecordSize = 3 * 4 + 2 + 1 + 8;
+
+//! Depth below which the nodes are not divided anymore, whatever their cell size
+const int MaximumDepth = 24;
+
+//-----------------------------------------------------------------------------
+//! Write an integer in little endian, the byte order of the data files
+template<typename T>
+char* WriteLittleEndian(char* buffer, T value)
+{
+  for (size_t i = 0; i < sizeof(T); ++i)
+  {
+    buffer[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+  return buffer + sizeof(T);
+}
+
+//-----------------------------------------------------------------------------
+char* WriteLittleEndian(char* buffer, double value)
+{
+  boost::uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(double));
+  return WriteLittleEndian(buffer, bits);
+}
+
+//-----------------------------------------------------------------------------
+boost::uint32_t Quantize(double value, double offset, double scale)
+{
+  const double steps = std::round((value - offset) / scale);
+  const double clamped = std::max(std::min(steps,
+    static_cast<double>(std::numeric_limits<boost::int32_t>::max())),
+    static_cast<double>(std::numeric_limits<boost::int32_t>::min()));
+  return static_cast<boost::uint32_t>(static_cast<boost::int32_t>(clamped));
+}
+}
+
+//-----------------------------------------------------------------------------
+bool EptWriter::Key::operator<(const Key& other) const
+{
+  if (this->D != other.D)
+  {
+    return this->D < other.D;
+  }
+  if (this->X != other.X)
+  {
+    return this->X < other.X;
+  }
+  if (this->Y != other.Y)
+  {
+    return this->Y < other.Y;
+  }
+  return this->Z < other.Z;
+}
+
+//-----------------------------------------------------------------------------
+std::string EptWriter::Key::ToString() const
+{
+  std::ostringstream stream;
+  stream << this->D << "-" << this->X << "-" << this->Y << "-" << this->Z;
+  return stream.str();
+}
+
+//-----------------------------------------------------------------------------
+EptWriter::~EptWriter()
+{
+  if (this->IsOpen)
+  {
+    this->Close();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void EptWriter::SetScale(double horizontal, double vertical)
+{
+  this->Scale[0] = horizontal;
+  this->Scale[1] = horizontal;
+  this->Scale[2] = vertical;
+}
+
+//-----------------------------------------------------------------------------
+bool EptWriter::Open(const std::string& directory)
+{
+  this->Directory = directory;
+  this->Nodes.clear();
+  this->NextNodeId = 0;
+  this->NumberOfBufferedPoints = 0;
+  this->NumberOfCells = 0;
+  this->SpillCount = 0;
+  this->NumberOfPoints = 0;
+  this->HasRoot = false;
+  for (int i = 0; i < 3; ++i)
+  {
+    this->Bounds[2 * i] = std::numeric_limits<double>::max();
+    this->Bounds[2 * i + 1] = -std::numeric_limits<double>::max();
+  }
+
+  boost::system::error_code error;
+  for (const char* name : { "ept-data", "ept-hierarchy", "ept-tmp" })
+  {
+    fs::create_directories(fs::path(directory) / name, error);
+    if (error)
+    {
+      this->LastError = "Cannot create " + (fs::path(directory) / name).string() + ": " +
+        error.message();
+      return false;
+    }
+  }
+  this->IsOpen = true;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool EptWriter::Add(const Point* points, size_t numberOfPoints)
+{
+  if (!this->IsOpen)
+  {
+    this->LastError = "The dataset is not open";
+    return false;
+  }
+  for (size_t n = 0; n < numberOfPoints; ++n)
+  {
+    const double* position = points[n].Position;
+    if (!std::isfinite(position[0]) || !std::isfinite(position[1]) ||
+      !std::isfinite(position[2]))
+    {
+      continue;
+    }
+    this->Insert(points[n]);
+    if (this->NumberOfBufferedPoints + this->NumberOfCells >= this->MaximumBufferedPoints &&
+      !this->Spill())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void EptWriter::GrowRoot(const double position[3])
+{
+  if (!this->HasRoot)
+  {
+    this->HasRoot = true;
+    this->Size = this->InitialSize;
+    for (int i = 0; i < 3; ++i)
+    {
+      this->Origin[i] = position[i] - 0.5 * this->Size;
+    }
+    this->Nodes[Key{ 0, 0, 0, 0 }].Id = this->NextNodeId++;
+  }
+
+  auto contains = [this](const double* p) {
+    for (int i = 0; i < 3; ++i)
+    {
+      if (p[i] < this->Origin[i] || p[i] > this->Origin[i] + this->Size)
+      {
+        return false;
+      }
+    }
+    return true;
+  };
+  while (!contains(position))
+  {
+    // the root becomes a child of a cube twice as large, extended towards the point
+    int side[3];
+    for (int i = 0; i < 3; ++i)
+    {
+      side[i] = position[i] < this->Origin[i] ? 1 : 0;
+      this->Origin[i] -= side[i] * this->Size;
+    }
+    this->Size *= 2.;
+
+    std::map<Key, Node> nodes;
+    for (auto& item : this->Nodes)
+    {
+      const Key& key = item.first;
+      const int shift = 1 << key.D;
+      const Key movedKey = { key.D + 1, key.X + side[0] * shift, key.Y + side[1] * shift,
+        key.Z + side[2] * shift };
+      nodes.emplace(movedKey, std::move(item.second));
+    }
+    this->Nodes.swap(nodes);
+    this->Nodes[Key{ 0, 0, 0, 0 }].Id = this->NextNodeId++;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void EptWriter::Insert(const Point& point)
+{
+  const double* position = point.Position;
+  this->GrowRoot(position);
+  for (int i = 0; i < 3; ++i)
+  {
+    this->Bounds[2 * i] = std::min(this->Bounds[2 * i], position[i]);
+    this->Bounds[2 * i + 1] = std::max(this->Bounds[2 * i + 1], position[i]);
+  }
+  this->NumberOfPoints++;
+
+  const double minimumCellSize = std::min(std::min(this->Scale[0], this->Scale[1]), this->Scale[2]);
+  Key key = { 0, 0, 0, 0 };
+  double corner[3] = { this->Origin[0], this->Origin[1], this->Origin[2] };
+  double size = this->Size;
+  while (true)
+  {
+    auto inserted = this->Nodes.emplace(key, Node());
+    Node& node = inserted.first->second;
+    if (inserted.second)
+    {
+      node.Id = this->NextNodeId++;
+    }
+    node.LastUse = this->SpillCount;
+
+    const double cellSize = size / this->Span;
+    bool isKept = cellSize <= minimumCellSize || key.D >= MaximumDepth;
+    if (!isKept && !node.IsFull)
+    {
+      boost::uint32_t cell = 0;
+      for (int i = 0; i < 3; ++i)
+      {
+        const int index = static_cast<int>((position[i] - corner[i]) / cellSize);
+        cell = cell * this->Span + std::max(std::min(index, this->Span - 1), 0);
+      }
+      if (node.Cells.insert(cell).second)
+      {
+        this->NumberOfCells++;
+        isKept = true;
+      }
+    }
+    if (isKept)
+    {
+      node.Buffer.push_back(point);
+      node.NumberOfPoints++;
+      this->NumberOfBufferedPoints++;
+      return;
+    }
+
+    // the cell is taken, the point goes to the child containing it
+    size *= 0.5;
+    int child[3];
+    for (int i = 0; i < 3; ++i)
+    {
+      child[i] = position[i] >= corner[i] + size ? 1 : 0;
+      corner[i] += child[i] * size;
+    }
+    key = { key.D + 1, 2 * key.X + child[0], 2 * key.Y + child[1], 2 * key.Z + child[2] };
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string EptWriter::GetTemporaryFileName(const Node& node) const
+{
+  return (fs::path(this->Directory) / "ept-tmp" / (std::to_string(node.Id) + ".bin")).string();
+}
+
+//-----------------------------------------------------------------------------
+bool EptWriter::Spill()
+{
+  for (auto& item : this->Nodes)
+  {
+    Node& node = item.second;
+    if (!node.Buffer.empty())
+    {
+      std::ofstream stream(this->GetTemporaryFileName(node).c_str(),
+        std::ios::out | std::ios::binary | std::ios::app);
+      stream.write(reinterpret_cast<const char*>(&node.Buffer[0]),
+        node.Buffer.size() * sizeof(Point));
+      if (!stream)
+      {
+        this->LastError = "Cannot write " + this->GetTemporaryFileName(node);
+        return false;
+      }
+      std::vector<Point>().swap(node.Buffer);
+    }
+
+    // the nodes left behind by the sensor are not sampled anymore
+    if (node.LastUse < this->SpillCount && !node.IsFull)
+    {
+      this->NumberOfCells -= node.Cells.size();
+      std::unordered_set<boost::uint32_t>().swap(node.Cells);
+      node.IsFull = true;
+    }
+  }
+  this->NumberOfBufferedPoints = 0;
+  this->SpillCount++;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool EptWriter::WriteNode(const Key& key, Node& node)
+{
+  // the spilled points come first, then the buffered ones
+  std::vector<Point> points;
+  const std::string temporaryFileName = this->GetTemporaryFileName(node);
+  if (node.NumberOfPoints > node.Buffer.size())
+  {
+    std::ifstream stream(temporaryFileName.c_str(), std::ios::in | std::ios::binary);
+    points.resize(static_cast<size_t>(node.NumberOfPoints - node.Buffer.size()));
+    stream.read(reinterpret_cast<char*>(&points[0]), points.size() * sizeof(Point));
+    if (!stream)
+    {
+      return false;
+    }
+  }
+  points.insert(points.end(), node.Buffer.begin(), node.Buffer.end());
+  std::vector<Point>().swap(node.Buffer);
+
+  const double center[3] = { this->Origin[0] + 0.5 * this->Size,
+    this->Origin[1] + 0.5 * this->Size, this->Origin[2] + 0.5 * this->Size };
+  std::vector<char> data(points.size() * RecordSize);
+  char* record = data.empty() ? nullptr : &data[0];
+  for (const Point& point : points)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      record = WriteLittleEndian(record, Quantize(point.Position[i], center[i], this->Scale[i]));
+    }
+    record = WriteLittleEndian(record, static_cast<boost::uint16_t>(point.Intensity));
+    record = WriteLittleEndian(record, static_cast<boost::uint8_t>(point.UserData));
+    record = WriteLittleEndian(record, point.Time);
+  }
+
+  const fs::path fileName = fs::path(this->Directory) / "ept-data" / (key.ToString() + ".bin");
+  std::ofstream stream(fileName.string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!data.empty())
+  {
+    stream.write(&data[0], data.size());
+  }
+  if (!stream)
+  {
+    return false;
+  }
+  std::remove(temporaryFileName.c_str());
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool EptWriter::WriteMetadata()
+{
+  std::ostringstream hierarchy;
+  hierarchy << "{";
+  for (auto it = this->Nodes.begin(); it != this->Nodes.end(); ++it)
+  {
+    hierarchy << (it == this->Nodes.begin() ? "\n" : ",\n") << "  \"" << it->first.ToString()
+              << "\": " << it->second.NumberOfPoints;
+  }
+  hierarchy << "\n}\n";
+
+  const double center[3] = { this->Origin[0] + 0.5 * this->Size,
+    this->Origin[1] + 0.5 * this->Size, this->Origin[2] + 0.5 * this->Size };
+  std::ostringstream ept;
+  ept.precision(std::numeric_limits<double>::max_digits10);
+  ept << "{\n  \"bounds\": [" << this->Origin[0] << ", " << this->Origin[1] << ", "
+      << this->Origin[2] << ", " << this->Origin[0] + this->Size << ", "
+      << this->Origin[1] + this->Size << ", " << this->Origin[2] + this->Size << "],\n";
+  const double* bounds = this->Bounds;
+  ept << "  \"boundsConforming\": [" << bounds[0] << ", " << bounds[2] << ", " << bounds[4]
+      << ", " << bounds[1] << ", " << bounds[3] << ", " << bounds[5] << "],\n";
+  ept << "  \"dataType\": \"binary\",\n  \"hierarchyType\": \"json\",\n";
+  ept << "  \"points\": " << this->NumberOfPoints << ",\n";
+  ept << "  \"schema\": [\n";
+  const char* axes[3] = { "X", "Y", "Z" };
+  for (int i = 0; i < 3; ++i)
+  {
+    ept << "    { \"name\": \"" << axes[i] << "\", \"type\": \"signed\", \"size\": 4, "
+        << "\"scale\": " << this->Scale[i] << ", \"offset\": " << center[i] << " },\n";
+  }
+  ept << "    { \"name\": \"Intensity\", \"type\": \"unsigned\", \"size\": 2 },\n";
+  ept << "    { \"name\": \"UserData\", \"type\": \"unsigned\", \"size\": 1 },\n";
+  ept << "    { \"name\": \"GpsTime\", \"type\": \"float\", \"size\": 8 }\n  ],\n";
+  ept << "  \"span\": " << this->Span << ",\n";
+  if (this->EPSG > 0)
+  {
+    ept << "  \"srs\": { \"authority\": \"EPSG\", \"horizontal\": \"" << this->EPSG << "\" },\n";
+  }
+  else
+  {
+    ept << "  \"srs\": {},\n";
+  }
+  ept << "  \"version\": \"1.0.0\"\n}\n";
+
+  const fs::path directory(this->Directory);
+  std::ofstream hierarchyStream(
+    (directory / "ept-hierarchy" / "0-0-0-0.json").string().c_str(), std::ios::out | std::ios::trunc);
+  hierarchyStream << hierarchy.str();
+  std::ofstream eptStream((directory / "ept.json").string().c_str(), std::ios::out | std::ios::trunc);
+  eptStream << ept.str();
+  return hierarchyStream.good() && eptStream.good();
+}
+
+//-----------------------------------------------------------------------------
+bool EptWriter::Close()
+{
+  if (!this->IsOpen)
+  {
+    return false;
+  }
+  this->IsOpen = false;
+
+  // the nodes are independent, they are encoded in parallel
+  std::vector<std::map<Key, Node>::iterator> nodes;
+  for (auto it = this->Nodes.begin(); it != this->Nodes.end(); ++it)
+  {
+    nodes.push_back(it);
+  }
+  int numberOfThreads = this->NumberOfThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = std::max(static_cast<int>(boost::thread::hardware_concurrency()), 1);
+  }
+  std::atomic<size_t> nextNode(0);
+  std::atomic<bool> hasFailed(false);
+  auto writeNodes = [&]() {
+    for (size_t i = nextNode++; i < nodes.size(); i = nextNode++)
+    {
+      if (!this->WriteNode(nodes[i]->first, nodes[i]->second))
+      {
+        hasFailed = true;
+      }
+    }
+  };
+  boost::thread_group threads;
+  for (int i = 1; i < numberOfThreads; ++i)
+  {
+    threads.create_thread(writeNodes);
+  }
+  writeNodes();
+  threads.join_all();
+
+  boost::system::error_code error;
+  fs::remove_all(fs::path(this->Directory) / "ept-tmp", error);
+  if (hasFailed)
+  {
+    this->LastError = "Cannot write the nodes in " + this->Directory;
+    return false;
+  }
+  if (!this->WriteMetadata())
+  {
+    this->LastError = "Cannot write the metadata in " + this->Directory;
+    return false;
+  }
+  return true;
+}
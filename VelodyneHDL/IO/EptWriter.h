@@ -0,0 +1,167 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef EPT_WRITER_H
+#define EPT_WRITER_H
+
+// BOOST
+#include <boost/cstdint.hpp>
+
+// STD
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * \class EptWriter
+ * \brief This class streams points into an Entwine Point Tile dataset (ept.json, ept-data/ and
+ *        ept-hierarchy/ in a directory), an octree of tiles that GIS tools and web viewers load
+ *        progressively, from the coarse nodes to the detailed ones.
+ *        A node keeps at most one point per cell of a Span^3 grid, the other points going to
+ *        its children, down to the nodes whose cells are smaller than the scale. The root cube
+ *        is doubled towards the points falling outside of it, so the extent of the survey does
+ *        not need to be known beforehand.
+ *        The memory is bounded by MaximumBufferedPoints: above it the buffered points are
+ *        appended to a temporary file per node, and the occupied cells of the nodes which have
+ *        not received points since the previous spill are forgotten, these nodes sending their
+ *        next points to their children. The nodes are encoded on several threads by Close.
+ */
+class EptWriter
+{
+public:
+  //! A point, its position being in the output coordinate system
+  struct Point
+  {
+    double Position[3];
+    double Time;
+    unsigned short Intensity;
+    unsigned char UserData;
+  };
+
+  EptWriter() = default;
+  ~EptWriter();
+
+  //! Quantization step of the positions, in the units of the coordinate system
+  void SetScale(double horizontal, double vertical);
+
+  //! EPSG code of the coordinate system of the points, 0 if unknown
+  void SetEPSG(int epsg) { this->EPSG = epsg; }
+
+  //! Number of cells along each axis of the sampling grid of a node
+  void SetSpan(int span) { this->Span = span; }
+
+  //! Number of points kept in memory, spilled to the temporary files above it
+  void SetMaximumBufferedPoints(size_t count) { this->MaximumBufferedPoints = count; }
+
+  //! Side of the root cube around the first point, doubled when needed
+  void SetInitialSize(double size) { this->InitialSize = size; }
+
+  //! Number of threads encoding the nodes, 0 uses one thread per core
+  void SetNumberOfThreads(int count) { this->NumberOfThreads = count; }
+
+  /**
+   * @brief Open create the directories of the dataset
+   * @param directory directory of the dataset, ept.json being written in it by Close
+   * @return false if the directories cannot be created
+   */
+  bool Open(const std::string& directory);
+
+  /**
+   * @brief Add sort points in the octree, they are written by Close
+   * @return false if the temporary files cannot be written
+   */
+  bool Add(const Point* points, size_t numberOfPoints);
+
+  /**
+   * @brief Close write the nodes, the hierarchy and ept.json, and remove the temporary files
+   * @return false if a file cannot be written
+   */
+  bool Close();
+
+  boost::uint64_t GetNumberOfPoints() const { return this->NumberOfPoints; }
+
+  const std::string& GetLastError() const { return this->LastError; }
+
+  //! Depth and position of a node in the grid of its depth
+  struct Key
+  {
+    int D, X, Y, Z;
+    bool operator<(const Key& other) const;
+    std::string ToString() const;
+  };
+
+private:
+  struct Node
+  {
+    //! name of the temporary file of the node
+    size_t Id = 0;
+    //! occupied cells of the sampling grid
+    std::unordered_set<boost::uint32_t> Cells;
+    //! the occupied cells have been forgotten, the new points go to the children
+    bool IsFull = false;
+    std::vector<Point> Buffer;
+    boost::uint64_t NumberOfPoints = 0;
+    //! spill during which the node last received a point
+    size_t LastUse = 0;
+  };
+
+  //! Double the root cube towards a point until it contains it
+  void GrowRoot(const double position[3]);
+
+  void Insert(const Point& point);
+
+  //! Append the buffered points to the temporary files, and forget the inactive cells
+  bool Spill();
+
+  //! Write the data file of a node, from its temporary file and its buffer
+  bool WriteNode(const Key& key, Node& node);
+
+  bool WriteMetadata();
+
+  std::string GetTemporaryFileName(const Node& node) const;
+
+  double Scale[3] = { 1e-3, 1e-3, 1e-3 };
+  int EPSG = 0;
+  int Span = 128;
+  size_t MaximumBufferedPoints = 1 << 24;
+  double InitialSize = 256.;
+  int NumberOfThreads = 0;
+
+  std::string Directory;
+  bool IsOpen = false;
+
+  bool HasRoot = false;
+  //! lowest corner and side of the root cube
+  double Origin[3] = { 0., 0., 0. };
+  double Size = 0.;
+
+  std::map<Key, Node> Nodes;
+  size_t NextNodeId = 0;
+  size_t NumberOfBufferedPoints = 0;
+  size_t NumberOfCells = 0;
+  size_t SpillCount = 0;
+
+  boost::uint64_t NumberOfPoints = 0;
+  double Bounds[6];
+
+  std::string LastError;
+};
+
+#endif // EPT_WRITER_H
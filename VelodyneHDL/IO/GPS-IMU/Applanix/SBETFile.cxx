@@ -0,0 +1,191 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "SBETFile.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+
+namespace
+{
+static_assert(sizeof(SBETRecord) == 17 * sizeof(double), "SBETRecord must not be padded");
+
+//! Seconds in a GPS week, the SBET times are seconds of the week
+const double SecondsPerWeek = 7 * 24 * 3600.;
+const double Pi = 3.14159265358979323846;
+
+//-----------------------------------------------------------------------------
+bool IsValidRecord(const SBETRecord& record)
+{
+  return record.Time >= 0. && record.Time <= SecondsPerWeek &&
+    std::abs(record.Latitude) <= Pi / 2. && std::abs(record.Longitude) <= 2. * Pi;
+}
+}
+
+const size_t SBETFile::IndexStride;
+
+//-----------------------------------------------------------------------------
+bool SBETFile::IsSBETFile(const std::string& fileName)
+{
+  std::ifstream stream(fileName.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+  if (!stream.is_open())
+  {
+    return false;
+  }
+  const std::streamoff size = stream.tellg();
+  if (size <= 0 || size % sizeof(SBETRecord) != 0)
+  {
+    return false;
+  }
+  SBETRecord record;
+  stream.seekg(0);
+  return stream.read(reinterpret_cast<char*>(&record), sizeof(SBETRecord)) &&
+    IsValidRecord(record);
+}
+
+//-----------------------------------------------------------------------------
+bool SBETFile::Open(const std::string& fileName)
+{
+  this->Close();
+
+  try
+  {
+    this->File.open(fileName);
+  }
+  catch (const std::exception& e)
+  {
+    this->LastError = "Cannot map " + fileName + ": " + e.what();
+    return false;
+  }
+  if (this->File.size() % sizeof(SBETRecord) != 0)
+  {
+    this->LastError = "SBET file is truncated";
+    this->Close();
+    return false;
+  }
+  this->NumberOfRecords = this->File.size() / sizeof(SBETRecord);
+
+  // only one page every IndexStride records is read
+  this->Index.reserve(this->NumberOfRecords / IndexStride + 1);
+  for (size_t i = 0; i < this->NumberOfRecords; i += IndexStride)
+  {
+    const double time = this->GetTime(i);
+    if (!this->Index.empty() && time < this->Index.back())
+    {
+      this->LastError = "SBET file is not sorted by time";
+      this->Close();
+      return false;
+    }
+    this->Index.push_back(time);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void SBETFile::Close()
+{
+  if (this->File.is_open())
+  {
+    this->File.close();
+  }
+  this->NumberOfRecords = 0;
+  this->Index.clear();
+}
+
+//-----------------------------------------------------------------------------
+bool SBETFile::GetTimeRange(double range[2]) const
+{
+  if (this->NumberOfRecords == 0)
+  {
+    return false;
+  }
+  range[0] = this->GetTime(0);
+  range[1] = this->GetTime(this->NumberOfRecords - 1);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void SBETFile::GetRecord(size_t index, SBETRecord& record) const
+{
+  // the mapped data is not guaranteed to be aligned for doubles
+  std::memcpy(&record, this->File.data() + index * sizeof(SBETRecord), sizeof(SBETRecord));
+}
+
+//-----------------------------------------------------------------------------
+double SBETFile::GetTime(size_t index) const
+{
+  double time;
+  std::memcpy(&time, this->File.data() + index * sizeof(SBETRecord), sizeof(double));
+  return time;
+}
+
+//-----------------------------------------------------------------------------
+size_t SBETFile::FindRecord(double time) const
+{
+  // the first time of the index which is not lower than time follows the block of
+  // IndexStride records holding the searched record, which is then searched in the block
+  const size_t block = std::lower_bound(this->Index.begin(), this->Index.end(), time) -
+    this->Index.begin();
+  if (block == 0)
+  {
+    return 0;
+  }
+  size_t first = (block - 1) * IndexStride;
+  size_t count = std::min(IndexStride, this->NumberOfRecords - first);
+  while (count > 0)
+  {
+    const size_t step = count / 2;
+    if (this->GetTime(first + step) < time)
+    {
+      first += step + 1;
+      count -= step + 1;
+    }
+    else
+    {
+      count = step;
+    }
+  }
+  return first;
+}
+
+//-----------------------------------------------------------------------------
+bool SBETFile::Read(double tstart, double tend, std::vector<SBETRecord>& records)
+{
+  records.clear();
+  if (!this->IsOpen())
+  {
+    this->LastError = "The SBET file is not open";
+    return false;
+  }
+
+  for (size_t i = this->FindRecord(tstart); i < this->NumberOfRecords; ++i)
+  {
+    SBETRecord record;
+    this->GetRecord(i, record);
+    if (record.Time > tend)
+    {
+      break;
+    }
+    records.push_back(record);
+  }
+  return true;
+}
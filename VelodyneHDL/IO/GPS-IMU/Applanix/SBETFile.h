@@ -0,0 +1,121 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef SBET_FILE_H
+#define SBET_FILE_H
+
+// BOOST
+#include <boost/iostreams/device/mapped_file.hpp>
+
+// STD
+#include <string>
+#include <vector>
+
+/**
+ * \brief SBETRecord one record of an Applanix smoothed best estimate of trajectory
+ *        (SBET) file. The angles are in radians, the time in GPS seconds of the week.
+ */
+struct SBETRecord
+{
+  double Time;
+  double Latitude;
+  double Longitude;
+  double Altitude;
+  double VelocityX;
+  double VelocityY;
+  double VelocityZ;
+  double Roll;
+  double Pitch;
+  double Heading;
+  double WanderAngle;
+  double AccelerationX;
+  double AccelerationY;
+  double AccelerationZ;
+  double AngularRateX;
+  double AngularRateY;
+  double AngularRateZ;
+};
+
+/**
+ * \class SBETFile
+ * \brief This class reads the binary SBET files written by Applanix POSPac, a raw array of
+ *        SBETRecord sorted by time. The file is mapped and a sparse index holds the time of
+ *        one record every IndexStride, so that the records of a time window are found with
+ *        a binary search that only reads the pages of the index and of the window, instead
+ *        of loading a trajectory of several hours.
+ */
+class SBETFile
+{
+public:
+  //! Number of records between two times of the index
+  static const size_t IndexStride = 1024;
+
+  /**
+   * @brief IsSBETFile return true if a file looks like a SBET file: its size is a multiple
+   * of the record size and its first record has a time of the week and a position
+   */
+  static bool IsSBETFile(const std::string& fileName);
+
+  /**
+   * @brief Open map a SBET file and build its time index
+   * @return true if a valid file has been opened
+   */
+  bool Open(const std::string& fileName);
+
+  //! Unmap the file
+  void Close();
+
+  bool IsOpen() const { return this->File.is_open(); }
+
+  size_t GetNumberOfRecords() const { return this->NumberOfRecords; }
+
+  /**
+   * @brief GetTimeRange return the first and last times of the trajectory
+   * @return false if the trajectory is empty
+   */
+  bool GetTimeRange(double range[2]) const;
+
+  //! Copy the record at index, which must be lower than GetNumberOfRecords()
+  void GetRecord(size_t index, SBETRecord& record) const;
+
+  //! Return the time of the record at index
+  double GetTime(size_t index) const;
+
+  /**
+   * @brief FindRecord return the index of the first record whose time is not lower than
+   * time, GetNumberOfRecords() if there is none
+   */
+  size_t FindRecord(double time) const;
+
+  /**
+   * @brief Read copy the records whose time is between tstart and tend, both included,
+   * like vtkTemporalTransforms::ExtractTimes
+   * @return false if the file is not open
+   */
+  bool Read(double tstart, double tend, std::vector<SBETRecord>& records);
+
+  const std::string& GetLastError() { return this->LastError; }
+
+private:
+  boost::iostreams::mapped_file_source File;
+  size_t NumberOfRecords = 0;
+  //! Time of the records IndexStride * i
+  std::vector<double> Index;
+  std::string LastError;
+};
+
+#endif // SBET_FILE_H
@@ -27,12 +27,16 @@
 =========================================================================*/
 
 #include "vtkApplanixPositionReader.h"
+#include "TraceEvents.h"
 
+#include "GeoProjection.h"
+#include "SBETFile.h"
 #include "vtkVelodyneTransformInterpolator.h"
 
 #include <vtkCellArray.h>
 #include <vtkDoubleArray.h>
 #include <vtkInformationVector.h>
+#include <vtkMath.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
@@ -43,7 +47,9 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <limits>
 #include <map>
+#include <vector>
 
 #define DATA_ARRAY(name)                                                                           \
   vtkNew<vtkDoubleArray> name##Data;                                                               \
@@ -91,6 +97,9 @@ vtkApplanixPositionReader::vtkApplanixPositionReader()
   this->BaseRoll = 0.0;
   this->BasePitch = 0.0;
   this->TimeOffset = 16.0; // correct for at least 2012-Jul - 2015-May
+  this->UseTimeWindow = false;
+  this->TimeWindow[0] = 0.0;
+  this->TimeWindow[1] = 0.0;
   this->Internal->CalibrationTransform->Identity();
 
   this->SetNumberOfInputPorts(0);
@@ -114,6 +123,7 @@ vtkVelodyneTransformInterpolator* vtkApplanixPositionReader::GetInterpolator() c
 int vtkApplanixPositionReader::RequestData(
   vtkInformation* vtkNotUsed(request), vtkInformationVector** vtkNotUsed(inputVector), vtkInformationVector* outputVector)
 {
+  VV_TRACE_SCOPE("vtkApplanixPositionReader::RequestData");
   vtkPolyData* output = vtkPolyData::GetData(outputVector);
 
   if (!this->FileName || !*this->FileName)
@@ -141,100 +151,191 @@ int vtkApplanixPositionReader::RequestData(
   vtkNew<vtkIntArray> zoneData;
   zoneData->SetName("zone");
 
-  // Open data file
-  std::ifstream f(this->FileName);
-  if (!f.good())
+  // Time window, in the time of the file
+  double tstart = -std::numeric_limits<double>::max();
+  double tend = std::numeric_limits<double>::max();
+  if (this->UseTimeWindow)
   {
-    vtkErrorMacro("Failed to open input file \"" << this->FileName << "\"");
-    return VTK_ERROR;
+    tstart = this->TimeWindow[0] + this->TimeOffset;
+    tend = this->TimeWindow[1] + this->TimeOffset;
   }
 
-  std::string line;
-  std::string lastLine;
-
-  // Read header
-  size_t numFields = 0;
-  while (std::getline(f, line))
+  this->Internal->Fields.clear();
+  this->Internal->FieldMapping.clear();
+  std::vector<vtkDoubleArray*> outputArrays;
+  vtkIdType count = 0;
+  if (SBETFile::IsSBETFile(this->FileName))
   {
-    boost::algorithm::trim(line);
-    if (line.empty())
+    SBETFile sbet;
+    std::vector<SBETRecord> records;
+    if (!sbet.Open(this->FileName) || !sbet.Read(tstart, tend, records))
     {
-      continue;
+      vtkErrorMacro("Failed to read SBET file \"" << this->FileName << "\": "
+                                                   << sbet.GetLastError());
+      return VTK_ERROR;
     }
 
-    if (boost::starts_with(line, "central meridian"))
+    // the positions are projected in the UTM zone of the first one
+    count = static_cast<vtkIdType>(records.size());
+    std::vector<double> positions(3 * records.size());
+    for (size_t n = 0; n < records.size(); ++n)
     {
-      std::vector<std::string> parts;
-      boost::algorithm::split(
-        parts, line, boost::is_any_of(" "), boost::algorithm::token_compress_on);
-
-      zoneData->InsertNextValue(static_cast<int>(186 + boost::lexical_cast<double>(parts[3])) / 6);
+      positions[3 * n + 0] = vtkMath::DegreesFromRadians(records[n].Longitude);
+      positions[3 * n + 1] = vtkMath::DegreesFromRadians(records[n].Latitude);
+      positions[3 * n + 2] = records[n].Altitude;
     }
-
-    if (line[0] == '(')
+    if (!records.empty())
     {
-      // Set up field index mapping
-      std::vector<std::string> fields;
-      boost::algorithm::split(
-        fields, lastLine, boost::is_any_of(","), boost::algorithm::token_compress_on);
-
-      numFields = fields.size();
-      for (size_t n = 0; n < numFields; ++n)
+      const int zone = GeoProjection::UTMZone(positions[1], positions[0]);
+      zoneData->InsertNextValue(zone);
+      GeoProjection projection(
+        GeoProjection::LatLongDefinition(), GeoProjection::UTMDefinition(zone, positions[1] < 0));
+      if (!projection.Transform(&positions[0], records.size()))
       {
-        boost::algorithm::trim(fields[n]);
-        this->Internal->Fields.insert(std::make_pair(fields[n], n));
+        vtkWarningMacro("Some positions of \"" << this->FileName << "\" could not be projected");
       }
-
-      // Done with header
-      break;
     }
 
-    lastLine = line;
+    vtkDoubleArray* arrays[] = { timeData.GetPointer(), eastingData.GetPointer(),
+      northingData.GetPointer(), heightData.GetPointer(), latData.GetPointer(),
+      lonData.GetPointer(), rollData.GetPointer(), pitchData.GetPointer(),
+      headingData.GetPointer() };
+    for (vtkDoubleArray* array : arrays)
+    {
+      array->SetNumberOfTuples(count);
+      outputArrays.push_back(array);
+    }
+    for (vtkIdType n = 0; n < count; ++n)
+    {
+      const SBETRecord& record = records[n];
+      timeData->SetValue(n, record.Time);
+      eastingData->SetValue(n, positions[3 * n + 0]);
+      northingData->SetValue(n, positions[3 * n + 1]);
+      heightData->SetValue(n, record.Altitude);
+      latData->SetValue(n, vtkMath::DegreesFromRadians(record.Latitude));
+      lonData->SetValue(n, vtkMath::DegreesFromRadians(record.Longitude));
+      rollData->SetValue(n, vtkMath::DegreesFromRadians(record.Roll));
+      pitchData->SetValue(n, vtkMath::DegreesFromRadians(record.Pitch));
+      headingData->SetValue(n, vtkMath::DegreesFromRadians(record.Heading));
+    }
   }
-
-  // Set up data array mapping
-  this->Internal->SetMapping("TIME", timeData);
-  this->Internal->SetMapping("DISTANCE", distanceData);
-  this->Internal->SetMapping("EASTING", eastingData);
-  this->Internal->SetMapping("NORTHING", northingData);
-  this->Internal->SetMapping("ELLIPSOID HEIGHT", heightData);
-  this->Internal->SetMapping("LATITUDE", latData);
-  this->Internal->SetMapping("LONGITUDE", lonData);
-  this->Internal->SetMapping("ROLL", rollData);
-  this->Internal->SetMapping("PITCH", pitchData);
-  this->Internal->SetMapping("HEADING", headingData);
-
-  // Read data
-  vtkIdType count = 0;
-  while (std::getline(f, line))
+  else
   {
-    boost::algorithm::trim(line);
-    if (line.empty())
+    // Open data file
+    std::ifstream f(this->FileName);
+    if (!f.good())
     {
-      continue;
+      vtkErrorMacro("Failed to open input file \"" << this->FileName << "\"");
+      return VTK_ERROR;
     }
 
-    // Split into fields
-    std::vector<std::string> fields;
-    boost::algorithm::split(
-      fields, line, boost::is_any_of(" "), boost::algorithm::token_compress_on);
+    std::string line;
+    std::string lastLine;
+
+    // Read header
+    size_t numFields = 0;
+    while (std::getline(f, line))
+    {
+      boost::algorithm::trim(line);
+      if (line.empty())
+      {
+        continue;
+      }
+
+      if (boost::starts_with(line, "central meridian"))
+      {
+        std::vector<std::string> parts;
+        boost::algorithm::split(
+          parts, line, boost::is_any_of(" "), boost::algorithm::token_compress_on);
+
+        zoneData->InsertNextValue(static_cast<int>(186 + boost::lexical_cast<double>(parts[3])) / 6);
+      }
+
+      if (line[0] == '(')
+      {
+        // Set up field index mapping
+        std::vector<std::string> fields;
+        boost::algorithm::split(
+          fields, lastLine, boost::is_any_of(","), boost::algorithm::token_compress_on);
+
+        numFields = fields.size();
+        for (size_t n = 0; n < numFields; ++n)
+        {
+          boost::algorithm::trim(fields[n]);
+          this->Internal->Fields.insert(std::make_pair(fields[n], n));
+        }
+
+        // Done with header
+        break;
+      }
+
+      lastLine = line;
+    }
 
-    if (fields.size() < numFields)
+    // Set up data array mapping
+    this->Internal->SetMapping("TIME", timeData);
+    this->Internal->SetMapping("DISTANCE", distanceData);
+    this->Internal->SetMapping("EASTING", eastingData);
+    this->Internal->SetMapping("NORTHING", northingData);
+    this->Internal->SetMapping("ELLIPSOID HEIGHT", heightData);
+    this->Internal->SetMapping("LATITUDE", latData);
+    this->Internal->SetMapping("LONGITUDE", lonData);
+    this->Internal->SetMapping("ROLL", rollData);
+    this->Internal->SetMapping("PITCH", pitchData);
+    this->Internal->SetMapping("HEADING", headingData);
+
+    // Read data
+    FieldIndexMap::const_iterator timeField = this->Internal->Fields.find("TIME");
+    while (std::getline(f, line))
     {
-      vtkWarningMacro("Line '" << line << "' has only " << fields.size() << "fields "
-                               << "(expected " << numFields << ")");
-      continue;
+      boost::algorithm::trim(line);
+      if (line.empty())
+      {
+        continue;
+      }
+
+      // Split into fields
+      std::vector<std::string> fields;
+      boost::algorithm::split(
+        fields, line, boost::is_any_of(" "), boost::algorithm::token_compress_on);
+
+      if (fields.size() < numFields)
+      {
+        vtkWarningMacro("Line '" << line << "' has only " << fields.size() << "fields "
+                                 << "(expected " << numFields << ")");
+        continue;
+      }
+
+      // Skip the lines outside of the time window, the file is sorted by time
+      if (this->UseTimeWindow && timeField != this->Internal->Fields.end())
+      {
+        const double time = boost::lexical_cast<double>(fields[timeField->second]);
+        if (time > tend)
+        {
+          break;
+        }
+        if (time < tstart)
+        {
+          continue;
+        }
+      }
+
+      // Assign values to data arrays
+      for (FieldDataMap::iterator iter = this->Internal->FieldMapping.begin();
+           iter != this->Internal->FieldMapping.end(); ++iter)
+      {
+        const double value = boost::lexical_cast<double>(fields[iter->first]);
+        iter->second->InsertNextValue(value);
+      }
+
+      ++count;
     }
 
-    // Assign values to data arrays
     for (FieldDataMap::iterator iter = this->Internal->FieldMapping.begin();
          iter != this->Internal->FieldMapping.end(); ++iter)
     {
-      const double value = boost::lexical_cast<double>(fields[iter->first]);
-      iter->second->InsertNextValue(value);
+      outputArrays.push_back(iter->second);
     }
-
-    ++count;
   }
 
   // Verify position information
@@ -312,10 +413,9 @@ int vtkApplanixPositionReader::RequestData(
   output->SetLines(cells.GetPointer());
 
   output->GetFieldData()->AddArray(zoneData.GetPointer());
-  for (FieldDataMap::iterator iter = this->Internal->FieldMapping.begin();
-       iter != this->Internal->FieldMapping.end(); ++iter)
+  for (vtkDoubleArray* array : outputArrays)
   {
-    output->GetPointData()->AddArray(iter->second);
+    output->GetPointData()->AddArray(array);
   }
 
   return VTK_OK;
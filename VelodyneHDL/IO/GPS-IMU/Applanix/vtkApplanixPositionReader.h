@@ -27,7 +27,8 @@
 =========================================================================*/
 // .NAME vtkApplanixPositionReader - class for reading Applanix data
 // .Section Description
-//
+// Reads the text exports of Applanix POSPac and the binary SBET files. The
+// SBET files are mapped and only the records of TimeWindow are read.
 
 #ifndef _vtkApplanixPositionReader_h
 #define _vtkApplanixPositionReader_h
@@ -73,6 +74,15 @@ public:
   vtkSetMacro(TimeOffset, double);
   vtkGetMacro(TimeOffset, double);
 
+  // Description:
+  // Only read the positions whose time, once corrected by TimeOffset, is in
+  // TimeWindow, so that a short lidar recording can be georeferenced without
+  // loading a trajectory of several hours. Default is false (whole file).
+  vtkSetMacro(UseTimeWindow, bool);
+  vtkGetMacro(UseTimeWindow, bool);
+  vtkSetVector2Macro(TimeWindow, double);
+  vtkGetVector2Macro(TimeWindow, double);
+
   void SetCalibrationTransform(vtkTransform* transform);
 
   // Description:
@@ -92,6 +102,9 @@ protected:
 
   double TimeOffset;
 
+  bool UseTimeWindow;
+  double TimeWindow[2];
+
   class vtkInternal;
   vtkInternal* Internal;
 
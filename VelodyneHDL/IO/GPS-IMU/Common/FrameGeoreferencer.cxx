@@ -0,0 +1,136 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameGeoreferencer.h"
+#include "PoseGrid.h"
+#include "vtkVelodyneTransformInterpolator.h"
+
+// STD
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+//! Number of exact poses interpolated by one call to the trajectory
+const size_t PoseBatchSize = 4096;
+}
+
+//-----------------------------------------------------------------------------
+FrameGeoreferencer::FrameGeoreferencer()
+{
+  this->Origin[0] = this->Origin[1] = this->Origin[2] = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+FrameGeoreferencer::~FrameGeoreferencer() = default;
+
+//-----------------------------------------------------------------------------
+void FrameGeoreferencer::SetTrajectory(vtkVelodyneTransformInterpolator* trajectory)
+{
+  this->Trajectory = trajectory;
+}
+
+//-----------------------------------------------------------------------------
+vtkVelodyneTransformInterpolator* FrameGeoreferencer::GetTrajectory() const
+{
+  return this->Trajectory;
+}
+
+//-----------------------------------------------------------------------------
+void FrameGeoreferencer::SetOrigin(double x, double y, double z)
+{
+  this->Origin[0] = x;
+  this->Origin[1] = y;
+  this->Origin[2] = z;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameGeoreferencer::Georeference(
+  const double* points, const double* times, size_t numberOfPoints, double* positions)
+{
+  return this->GeoreferenceImpl(points, times, numberOfPoints, positions);
+}
+
+//-----------------------------------------------------------------------------
+bool FrameGeoreferencer::Georeference(
+  const float* points, const double* times, size_t numberOfPoints, double* positions)
+{
+  return this->GeoreferenceImpl(points, times, numberOfPoints, positions);
+}
+
+//-----------------------------------------------------------------------------
+template <typename T>
+bool FrameGeoreferencer::GeoreferenceImpl(
+  const T* points, const double* times, size_t numberOfPoints, double* positions)
+{
+  const Eigen::Vector3d origin(this->Origin[0], this->Origin[1], this->Origin[2]);
+  if (!this->Trajectory || this->Trajectory->GetNumberOfTransforms() == 0)
+  {
+    for (size_t i = 0; i < numberOfPoints; ++i)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        positions[3 * i + k] = points[3 * i + k] + origin(k);
+      }
+    }
+    return false;
+  }
+  if (numberOfPoints == 0)
+  {
+    return true;
+  }
+
+  // the origin is added to the translation of the poses
+  const int type = this->Trajectory->GetInterpolationType();
+  const bool isContinuous = type == vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_LINEAR ||
+                            type == vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_SPLINE;
+  if (this->PoseSamplingStep > 0.0 && isContinuous)
+  {
+    const auto range = std::minmax_element(times, times + numberOfPoints);
+    PoseGrid grid;
+    grid.Sample(this->Trajectory, *range.first, *range.second, this->PoseSamplingStep);
+    for (PoseGrid::Pose& pose : grid.Poses)
+    {
+      pose.col(3) += origin;
+    }
+    TransformPoints(points, positions, static_cast<vtkIdType>(numberOfPoints),
+                    [times](vtkIdType i) { return times[i]; }, grid, this->NumberOfThreads);
+    return true;
+  }
+
+  // exact pose of each point, interpolated by batches
+  std::vector<double> matrices(16 * std::min(numberOfPoints, PoseBatchSize));
+  PoseGrid::Pose pose;
+  for (size_t begin = 0; begin < numberOfPoints; begin += PoseBatchSize)
+  {
+    const size_t count = std::min(PoseBatchSize, numberOfPoints - begin);
+    this->Trajectory->InterpolateTransformMatrices(
+      times + begin, static_cast<vtkIdType>(count), matrices.data());
+    for (size_t i = 0; i < count; ++i)
+    {
+      PoseGrid::GetPose(&matrices[16 * i], pose);
+      const size_t n = begin + i;
+      const Eigen::Vector3d x(points[3 * n], points[3 * n + 1], points[3 * n + 2]);
+      const Eigen::Vector3d y = pose.leftCols<3>() * x + pose.col(3) + origin;
+      positions[3 * n] = y(0);
+      positions[3 * n + 1] = y(1);
+      positions[3 * n + 2] = y(2);
+    }
+  }
+  return true;
+}
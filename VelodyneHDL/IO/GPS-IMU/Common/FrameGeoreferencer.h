@@ -0,0 +1,92 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAME_GEOREFERENCER_H
+#define FRAME_GEOREFERENCER_H
+
+// VTK
+#include <vtkSmartPointer.h>
+
+// STD
+#include <cstddef>
+
+class vtkVelodyneTransformInterpolator;
+
+/**
+ * \class FrameGeoreferencer
+ * \brief Compute the world coordinates of the points of a frame from their time and the
+ *        trajectory of a GPS/INS position reader (vtkVelodyneHDLPositionReader or
+ *        vtkApplanixPositionReader). The trajectory is interpolated once on a regular time
+ *        grid over the frame, then the points are transformed with the blended poses of
+ *        their time by several threads, instead of interpolating a vtkTransform per point.
+ *        The trajectories of the position readers are relative to their first position,
+ *        whose coordinates are added as Origin to get absolute coordinates in the system of
+ *        the reader (UTM).
+ */
+class FrameGeoreferencer
+{
+public:
+  FrameGeoreferencer();
+  ~FrameGeoreferencer();
+
+  //! Trajectory from the sensor frame to the frame of the position reader, can be null
+  void SetTrajectory(vtkVelodyneTransformInterpolator* trajectory);
+  vtkVelodyneTransformInterpolator* GetTrajectory() const;
+
+  //! Coordinates of the origin of the trajectory, added to the transformed points
+  void SetOrigin(double x, double y, double z);
+
+  /**
+   * @brief SetPoseSamplingStep set the time between two poses of the grid, in seconds. The
+   * trajectory is interpolated exactly at the time of each point with 0, and with the
+   * nearest interpolation types
+   */
+  void SetPoseSamplingStep(double step) { this->PoseSamplingStep = step; }
+  double GetPoseSamplingStep() const { return this->PoseSamplingStep; }
+
+  //! Number of threads transforming the points, 0 uses one thread per core
+  void SetNumberOfThreads(int numberOfThreads) { this->NumberOfThreads = numberOfThreads; }
+  int GetNumberOfThreads() const { return this->NumberOfThreads; }
+
+  /**
+   * @brief Georeference compute the world coordinates of points
+   * @param points x, y, z of each point in the sensor frame
+   * @param times time of each point in seconds, in the time of the trajectory
+   * @param numberOfPoints number of points
+   * @param positions x, y, z of each point in the world, may be points
+   * @return false if there is no trajectory, the points are then only moved by Origin
+   */
+  bool Georeference(const double* points, const double* times, size_t numberOfPoints,
+                    double* positions);
+  bool Georeference(const float* points, const double* times, size_t numberOfPoints,
+                    double* positions);
+
+private:
+  template <typename T>
+  bool GeoreferenceImpl(const T* points, const double* times, size_t numberOfPoints,
+                        double* positions);
+
+  FrameGeoreferencer(const FrameGeoreferencer&) = delete;
+  FrameGeoreferencer& operator=(const FrameGeoreferencer&) = delete;
+
+  vtkSmartPointer<vtkVelodyneTransformInterpolator> Trajectory;
+  double Origin[3];
+  double PoseSamplingStep = 1e-4;
+  int NumberOfThreads = 0;
+};
+
+#endif // FRAME_GEOREFERENCER_H
@@ -0,0 +1,230 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#include "GeoProjection.h"
+
+#include <vtk_libproj4.h>
+
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+//! Under this number of positions per thread, starting the threads costs more than it saves
+const size_t MinimumChunkSize = 16384;
+}
+
+//-----------------------------------------------------------------------------
+struct GeoProjection::ThreadProjection
+{
+  ThreadProjection(const std::string& inDefinition, const std::string& outDefinition)
+  {
+    this->Context = pj_ctx_alloc();
+    if (this->Context)
+    {
+      this->In = pj_init_plus_ctx(this->Context, inDefinition.c_str());
+      this->Out = pj_init_plus_ctx(this->Context, outDefinition.c_str());
+    }
+  }
+
+  ~ThreadProjection()
+  {
+    if (this->In)
+    {
+      pj_free(this->In);
+    }
+    if (this->Out)
+    {
+      pj_free(this->Out);
+    }
+    if (this->Context)
+    {
+      pj_ctx_free(this->Context);
+    }
+  }
+
+  bool IsValid() const { return this->In && this->Out; }
+
+  projCtx Context = nullptr;
+  projPJ In = nullptr;
+  projPJ Out = nullptr;
+};
+
+//-----------------------------------------------------------------------------
+GeoProjection::GeoProjection(const std::string& inDefinition, const std::string& outDefinition)
+  : InDefinition(inDefinition)
+  , OutDefinition(outDefinition)
+{
+  ThreadProjection* projection = this->GetThreadProjection(0);
+  this->Valid = projection->IsValid();
+  this->OutputLatLong = this->Valid && pj_is_latlong(projection->Out);
+}
+
+//-----------------------------------------------------------------------------
+GeoProjection::~GeoProjection() = default;
+
+//-----------------------------------------------------------------------------
+std::string GeoProjection::UTMDefinition(int zone, bool south)
+{
+  std::ostringstream ss;
+  ss << "+proj=utm +zone=" << zone << (south ? " +south" : "")
+     << " +ellps=WGS84 +units=m +no_defs";
+  return ss.str();
+}
+
+//-----------------------------------------------------------------------------
+int GeoProjection::UTMZone(double lat, double lon)
+{
+  double longTemp = (lon + 180) - static_cast<int>((lon + 180) / 360) * 360 - 180;
+
+  int zone = static_cast<int>((longTemp + 180) / 6) + 1;
+  if (lat >= 56.0 && lat < 64.0 && longTemp >= 3.0 && longTemp < 12.0)
+  {
+    zone = 32;
+  }
+
+  if (lat >= 72.0 && lat < 84)
+  {
+    if (longTemp >= 0.0 && longTemp < 9.0)
+    {
+      zone = 31;
+    }
+    else if (longTemp >= 9.0 && longTemp < 21.0)
+    {
+      zone = 33;
+    }
+    else if (longTemp >= 21.0 && longTemp < 33.0)
+    {
+      zone = 35;
+    }
+    else if (longTemp >= 33.0 && longTemp < 42.0)
+    {
+      zone = 37;
+    }
+  }
+
+  return zone;
+}
+
+//-----------------------------------------------------------------------------
+std::string GeoProjection::LatLongDefinition()
+{
+  return "+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs";
+}
+
+//-----------------------------------------------------------------------------
+GeoProjection::ThreadProjection* GeoProjection::GetThreadProjection(size_t index)
+{
+  if (index >= this->Projections.size())
+  {
+    this->Projections.resize(index + 1);
+  }
+  if (!this->Projections[index])
+  {
+    this->Projections[index].reset(new ThreadProjection(this->InDefinition, this->OutDefinition));
+  }
+  return this->Projections[index].get();
+}
+
+//-----------------------------------------------------------------------------
+bool GeoProjection::TransformChunk(ThreadProjection* projection, double* positions, size_t count)
+{
+  const bool inLatLong = pj_is_latlong(projection->In);
+  const bool outLatLong = pj_is_latlong(projection->Out);
+  if (inLatLong)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      positions[3 * i + 0] *= DEG_TO_RAD;
+      positions[3 * i + 1] *= DEG_TO_RAD;
+    }
+  }
+
+  // the positions PROJ fails to convert are set to HUGE_VAL, without always an error code
+  int error = pj_transform(projection->In, projection->Out, static_cast<long>(count), 3,
+    positions + 0, positions + 1, positions + 2);
+  bool success = (error == 0);
+  for (size_t i = 0; i < count; ++i)
+  {
+    double* position = positions + 3 * i;
+    if (position[0] == HUGE_VAL || position[1] == HUGE_VAL)
+    {
+      success = false;
+      continue;
+    }
+    if (outLatLong)
+    {
+      position[0] *= RAD_TO_DEG;
+      position[1] *= RAD_TO_DEG;
+    }
+  }
+  return success;
+}
+
+//-----------------------------------------------------------------------------
+bool GeoProjection::Transform(double* positions, size_t numberOfPositions)
+{
+  if (!this->Valid)
+  {
+    return false;
+  }
+  if (numberOfPositions == 0)
+  {
+    return true;
+  }
+
+  size_t numberOfThreads = this->NumberOfThreads > 0
+    ? static_cast<size_t>(this->NumberOfThreads)
+    : std::max(1u, boost::thread::hardware_concurrency());
+  numberOfThreads = std::max<size_t>(
+    1, std::min(numberOfThreads, numberOfPositions / MinimumChunkSize));
+
+  if (numberOfThreads == 1)
+  {
+    return TransformChunk(this->GetThreadProjection(0), positions, numberOfPositions);
+  }
+
+  // the projections are created here, a worker must not resize the vector
+  for (size_t i = 0; i < numberOfThreads; ++i)
+  {
+    if (!this->GetThreadProjection(i)->IsValid())
+    {
+      return false;
+    }
+  }
+
+  const size_t chunkSize = (numberOfPositions + numberOfThreads - 1) / numberOfThreads;
+  std::vector<char> results(numberOfThreads, 1);
+  boost::thread_group workers;
+  // the calling thread converts the first chunk
+  for (size_t i = 1; i < numberOfThreads; ++i)
+  {
+    const size_t begin = i * chunkSize;
+    const size_t count = std::min(chunkSize, numberOfPositions - begin);
+    workers.create_thread([this, &results, positions, i, begin, count]() {
+      results[i] = TransformChunk(this->Projections[i].get(), positions + 3 * begin, count);
+    });
+  }
+  results[0] = TransformChunk(this->Projections[0].get(), positions, chunkSize);
+  workers.join_all();
+
+  return std::find(results.begin(), results.end(), 0) == results.end();
+}
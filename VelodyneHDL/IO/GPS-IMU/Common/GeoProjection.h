@@ -0,0 +1,110 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef GEO_PROJECTION_H
+#define GEO_PROJECTION_H
+
+// STD
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * \class GeoProjection
+ * \brief Convert coordinates between two geographic coordinate systems with PROJ, by batches.
+ *        A batch of contiguous x, y, z positions is transformed with one PROJ call per chunk,
+ *        the chunks being converted in parallel for large batches. PROJ objects cannot be shared
+ *        between threads, each thread uses its own PROJ context and projections, which are
+ *        created once and reused by the next batches.
+ *        The angles of the lat/long systems are in degrees, x being the longitude.
+ */
+class GeoProjection
+{
+public:
+  /**
+   * @brief GeoProjection create the conversion
+   * @param inDefinition PROJ definition of the input system, ex: "+init=epsg:32631"
+   * @param outDefinition PROJ definition of the output system
+   */
+  GeoProjection(const std::string& inDefinition, const std::string& outDefinition);
+  ~GeoProjection();
+
+  //! False if a definition is not understood by PROJ
+  bool IsValid() const { return this->Valid; }
+
+  //! True if the output system is a lat/long one
+  bool IsOutputLatLong() const { return this->OutputLatLong; }
+
+  /**
+   * @brief SetNumberOfThreads set how many threads convert a large batch
+   * @param numberOfThreads 0 uses one thread per core, 1 converts on the calling thread
+   */
+  void SetNumberOfThreads(int numberOfThreads) { this->NumberOfThreads = numberOfThreads; }
+  int GetNumberOfThreads() const { return this->NumberOfThreads; }
+
+  /**
+   * @brief Transform convert interleaved positions in place
+   * @param positions x, y, z of each position
+   * @param numberOfPositions number of positions
+   * @return false if some positions could not be converted, they are then set to HUGE_VAL
+   */
+  bool Transform(double* positions, size_t numberOfPositions);
+
+  /**
+   * @brief UTMDefinition return the PROJ definition of a WGS84 UTM zone
+   * @param zone UTM zone, between 1 and 60
+   * @param south true for the zones of the southern hemisphere
+   */
+  static std::string UTMDefinition(int zone, bool south);
+
+  /**
+   * @brief UTMZone return the UTM zone of a position, with the exceptions of Norway and
+   * Svalbard
+   * @param lat latitude in degrees
+   * @param lon longitude in degrees
+   */
+  static int UTMZone(double lat, double lon);
+
+  //! PROJ definition of the WGS84 lat/long system
+  static std::string LatLongDefinition();
+
+private:
+  GeoProjection(const GeoProjection&) = delete;
+  GeoProjection& operator=(const GeoProjection&) = delete;
+
+  //! PROJ context and projections used by one thread
+  struct ThreadProjection;
+
+  /**
+   * @brief GetThreadProjection return the projections of a thread, created on first use
+   * @param index index of the thread, the calling thread being 0
+   */
+  ThreadProjection* GetThreadProjection(size_t index);
+
+  //! Convert a chunk with the projections of a thread
+  static bool TransformChunk(ThreadProjection* projection, double* positions, size_t count);
+
+  std::string InDefinition;
+  std::string OutDefinition;
+  bool Valid = false;
+  bool OutputLatLong = false;
+  int NumberOfThreads = 0;
+  std::vector<std::unique_ptr<ThreadProjection> > Projections;
+};
+
+#endif // GEO_PROJECTION_H
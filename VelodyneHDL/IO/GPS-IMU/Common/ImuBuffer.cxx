@@ -0,0 +1,149 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "ImuBuffer.h"
+
+// STD
+#include <algorithm>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+bool IsBefore(const ImuBuffer::Sample& sample, double time)
+{
+  return sample.Time < time;
+}
+}
+
+//-----------------------------------------------------------------------------
+void ImuBuffer::Add(const Sample& sample)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (!this->Samples.empty() && sample.Time <= this->Samples.back().Time)
+  {
+    return;
+  }
+  this->Samples.push_back(sample);
+  this->DropOldSamples();
+}
+
+//-----------------------------------------------------------------------------
+void ImuBuffer::Add(const std::vector<Sample>& samples)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  for (const Sample& sample : samples)
+  {
+    if (this->Samples.empty() || sample.Time > this->Samples.back().Time)
+    {
+      this->Samples.push_back(sample);
+    }
+  }
+  this->DropOldSamples();
+}
+
+//-----------------------------------------------------------------------------
+void ImuBuffer::Clear()
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->Samples.clear();
+}
+
+//-----------------------------------------------------------------------------
+size_t ImuBuffer::GetNumberOfSamples() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  return this->Samples.size();
+}
+
+//-----------------------------------------------------------------------------
+bool ImuBuffer::GetTimeRange(double& first, double& last) const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (this->Samples.empty())
+  {
+    return false;
+  }
+  first = this->Samples.front().Time;
+  last = this->Samples.back().Time;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+size_t ImuBuffer::GetSamples(double t0, double t1, std::vector<Sample>& samples) const
+{
+  samples.clear();
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  auto begin = std::lower_bound(this->Samples.begin(), this->Samples.end(), t0, IsBefore);
+  for (auto it = begin; it != this->Samples.end() && it->Time <= t1; ++it)
+  {
+    samples.push_back(*it);
+  }
+  return samples.size();
+}
+
+//-----------------------------------------------------------------------------
+bool ImuBuffer::Interpolate(double time, Sample& sample) const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (this->Samples.empty() || time < this->Samples.front().Time ||
+      time > this->Samples.back().Time)
+  {
+    return false;
+  }
+  auto next = std::lower_bound(this->Samples.begin(), this->Samples.end(), time, IsBefore);
+  if (next->Time == time)
+  {
+    sample = *next;
+    return true;
+  }
+  auto previous = next - 1;
+  const double ratio = (time - previous->Time) / (next->Time - previous->Time);
+  sample.Time = time;
+  sample.AngularVelocity = (1.0 - ratio) * previous->AngularVelocity + ratio * next->AngularVelocity;
+  sample.Acceleration = (1.0 - ratio) * previous->Acceleration + ratio * next->Acceleration;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void ImuBuffer::SetMaximumDuration(double duration)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->MaximumDuration = std::max(duration, 0.0);
+  this->DropOldSamples();
+}
+
+//-----------------------------------------------------------------------------
+double ImuBuffer::GetMaximumDuration() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  return this->MaximumDuration;
+}
+
+//-----------------------------------------------------------------------------
+void ImuBuffer::DropOldSamples()
+{
+  if (this->MaximumDuration <= 0.0 || this->Samples.empty())
+  {
+    return;
+  }
+  const double oldest = this->Samples.back().Time - this->MaximumDuration;
+  while (this->Samples.front().Time < oldest)
+  {
+    this->Samples.pop_front();
+  }
+}
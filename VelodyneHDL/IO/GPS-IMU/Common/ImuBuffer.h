@@ -0,0 +1,94 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef IMU_BUFFER_H
+#define IMU_BUFFER_H
+
+// BOOST
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+// EIGEN
+#include <Eigen/Core>
+
+// STD
+#include <deque>
+#include <vector>
+
+/**
+ * \class ImuBuffer
+ * \brief Time ordered measurements of an IMU, filled offline by a position reader or live
+ *        by the position port of a stream, and queried by time range by the consumers (SLAM
+ *        prediction, undistortion) without reading the file again. The buffer can be filled
+ *        by one thread while others query it.
+ *
+ *        The angular velocities are in rad/s and the accelerations in m/s^2, in the IMU axes,
+ *        and the times in seconds in the time base of the lidar frames.
+ */
+class ImuBuffer
+{
+public:
+  struct Sample
+  {
+    double Time;
+    Eigen::Vector3d AngularVelocity;
+    Eigen::Vector3d Acceleration;
+  };
+
+  //! Add a sample, it is ignored if it is not newer than the last one
+  void Add(const Sample& sample);
+
+  //! Add time ordered samples with a single lock
+  void Add(const std::vector<Sample>& samples);
+
+  void Clear();
+
+  size_t GetNumberOfSamples() const;
+
+  //! Time of the first and last samples, false if the buffer is empty
+  bool GetTimeRange(double& first, double& last) const;
+
+  /**
+   * @brief GetSamples copy the samples whose time is in [t0, t1]
+   * @return the number of samples copied, samples is cleared first
+   */
+  size_t GetSamples(double t0, double t1, std::vector<Sample>& samples) const;
+
+  /**
+   * @brief Interpolate linearly the measurements at a time
+   * @return false if the time is out of the samples
+   */
+  bool Interpolate(double time, Sample& sample) const;
+
+  /**
+   * @brief SetMaximumDuration duration in seconds kept by the buffer, the older samples are
+   * dropped when new ones are added. 0, the default, keeps all of them, a live stream should
+   * set it to bound the memory.
+   */
+  void SetMaximumDuration(double duration);
+  double GetMaximumDuration() const;
+
+private:
+  //! Drop the samples older than MaximumDuration, the mutex must be held
+  void DropOldSamples();
+
+  mutable boost::mutex Mutex;
+  std::deque<Sample> Samples;
+  double MaximumDuration = 0.0;
+};
+
+#endif // IMU_BUFFER_H
@@ -1,9 +1,9 @@
 #include "NMEAParser.h"
 
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <cmath>
-#include <sstream>
-#include <stdexcept>
 #include <limits>
 
 #include <vtkMath.h>
@@ -12,81 +12,127 @@
 #define UNUSED(expr) do { (void)(expr); } while (0)
 
 namespace {
+  //! Longest numeric field, the fields are copied in a buffer as strtod needs a terminated
+  //! string and a field is only terminated by the next comma
+  const size_t MaxNumberSize = 63;
+
+  /* same rules as std::stod: leading spaces are skipped, the number can be followed by
+   * other characters, but some must be read and the value must fit in a double */
+  bool ParseDouble(const NMEAWords::Word& word, double& value)
+  {
+    if (word.Size > MaxNumberSize)
+    {
+      return false;
+    }
+    char buffer[MaxNumberSize + 1];
+    std::memcpy(buffer, word.Data, word.Size);
+    buffer[word.Size] = '\0';
+    char* end = nullptr;
+    errno = 0;
+    const double read = std::strtod(buffer, &end);
+    if (end == buffer || errno == ERANGE)
+    {
+      return false;
+    }
+    value = read;
+    return true;
+  }
+
+  /* same rules as std::stoul */
+  bool ParseUnsigned(const char* data, size_t size, unsigned long& value)
+  {
+    if (size > MaxNumberSize)
+    {
+      return false;
+    }
+    char buffer[MaxNumberSize + 1];
+    std::memcpy(buffer, data, size);
+    buffer[size] = '\0';
+    char* end = nullptr;
+    errno = 0;
+    const unsigned long read = std::strtoul(buffer, &end, 10);
+    if (end == buffer || errno == ERANGE)
+    {
+      return false;
+    }
+    value = read;
+    return true;
+  }
+
   /* parse in format HHMMSS.SS (.SS optional) */
-  bool ParseUTCSecondsOfDay(const std::vector<std::string>& w,
+  bool ParseUTCSecondsOfDay(const NMEAWords& w,
                     unsigned int pos,
                     NMEALocation& location)
   {
-    try {
-      double read = std::stod(w[pos]);
-      double integral_part;
-      std::modf(read, &integral_part);
-      double fractional_part = read - integral_part;
-      int HHMMSS = static_cast<int>(vtkMath::Round(integral_part));
-      int SS = HHMMSS % 100;
-      int MM = ((HHMMSS - SS) % 10000) / 100;
-      int HH = (HHMMSS - SS - 100 * MM) / 10000;
-      location.UTCSecondsOfDay =
-          fractional_part
-          + static_cast<double>(SS)
-          + 60.0 * static_cast<double>(MM)
-          + 3600.0 * static_cast<double>(HH);
-    }
-    catch (const std::logic_error&) {
+    double read = 0.0;
+    if (!ParseDouble(w[pos], read))
+    {
       return false;
     }
+    double integral_part;
+    std::modf(read, &integral_part);
+    double fractional_part = read - integral_part;
+    int HHMMSS = static_cast<int>(vtkMath::Round(integral_part));
+    int SS = HHMMSS % 100;
+    int MM = ((HHMMSS - SS) % 10000) / 100;
+    int HH = (HHMMSS - SS - 100 * MM) / 10000;
+    location.UTCSecondsOfDay =
+        fractional_part
+        + static_cast<double>(SS)
+        + 60.0 * static_cast<double>(MM)
+        + 3600.0 * static_cast<double>(HH);
     return true;
   }
 
-  bool ParseFAA(const std::vector<std::string>& w,
+  bool ParseFAA(const NMEAWords& w,
                     unsigned int pos,
                     NMEALocation& location)
   {
-    if (w[pos] == "")
+    const NMEAWords::Word& word = w[pos];
+    if (word.empty())
     {
       location.HasFAA = false;
       location.FAA = NMEALocation::UNDEFINED_FAA;
+      return true;
     }
-    else if (w[pos] == "A")
-    {
-      location.HasFAA = true;
-      location.FAA = NMEALocation::AUTONOMOUS_FAA;
-    }
-    else if (w[pos] == "D")
+    if (word.Size != 1)
     {
-      location.HasFAA = true;
-      location.FAA = NMEALocation::DIFFERENTIAL_FAA;
+      return true;
     }
-    else if (w[pos] == "E")
-    {
-      location.HasFAA = true;
-      location.FAA = NMEALocation::ESTIMATED_FAA;
-    }
-    else if (w[pos] == "M")
-    {
-      location.HasFAA = true;
-      location.FAA = NMEALocation::MANUAL_FAA;
-    }
-    else if (w[pos] == "S")
-    {
-      location.HasFAA = true;
-      location.FAA = NMEALocation::SIMULATED_FAA;
-    }
-    else if (w[pos] == "N")
-    {
-      location.HasFAA = true;
-      location.FAA = NMEALocation::DATA_NOT_VALID_FAA;
-    }
-    else if (w[pos] == "P")
+
+    switch (word.Data[0])
     {
-      location.HasFAA = true;
-      location.FAA = NMEALocation::PRECISE_FAA;
+      case 'A':
+        location.FAA = NMEALocation::AUTONOMOUS_FAA;
+        break;
+      case 'D':
+        location.FAA = NMEALocation::DIFFERENTIAL_FAA;
+        break;
+      case 'E':
+        location.FAA = NMEALocation::ESTIMATED_FAA;
+        break;
+      case 'M':
+        location.FAA = NMEALocation::MANUAL_FAA;
+        break;
+      case 'S':
+        location.FAA = NMEALocation::SIMULATED_FAA;
+        break;
+      case 'N':
+        location.FAA = NMEALocation::DATA_NOT_VALID_FAA;
+        break;
+      case 'P':
+        location.FAA = NMEALocation::PRECISE_FAA;
+        break;
+      default:
+        // unknown modes are ignored
+        return true;
     }
+    location.HasFAA = true;
 
     return true;
   }
 
-  bool ParseLatLong(const std::vector<std::string>& w,
+  bool ParseLatLong(const NMEAWords& w,
                     unsigned int uLat,
                     unsigned int latNS,
                     unsigned int uLong,
@@ -97,11 +143,8 @@ namespace {
     // We make the fields ULAT, ULONG, LATNS and LONGEW mandatory
     double latDec = 0.0;
     double lonDec = 0.0;
-    try {
-      latDec = std::stod(w[uLat]);
-      lonDec = std::stod(w[uLong]);
-    }
-    catch (const std::logic_error&) {
+    if (!ParseDouble(w[uLat], latDec) || !ParseDouble(w[uLong], lonDec))
+    {
       return false;
     }
     double latDeg = std::floor(latDec / 100.0);
@@ -136,6 +179,71 @@ namespace {
 
     return true;
   }
+
+  int HexadecimalDigit(char c)
+  {
+    if (c >= '0' && c <= '9')
+    {
+      return c - '0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+      return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+      return c - 'a' + 10;
+    }
+    return -1;
+  }
+
+  unsigned int ReadChecksum(const char* sentence, size_t size)
+  {
+    if (size < 2)
+    {
+      // returns a value that does not fit in a byte,
+      // can be used to detect that Checksum is not readable
+      return std::numeric_limits<unsigned int>::max();
+    }
+
+    // the checksum is read from the last two characters, as std::hex would
+    const char* checksum = sentence + size - 2;
+    if (checksum[0] == ' ' || checksum[0] == '\t')
+    {
+      const int digit = HexadecimalDigit(checksum[1]);
+      return digit < 0 ? std::numeric_limits<unsigned int>::max() : digit;
+    }
+    const int high = HexadecimalDigit(checksum[0]);
+    const int low = HexadecimalDigit(checksum[1]);
+    if (high < 0)
+    {
+      return std::numeric_limits<unsigned int>::max();
+    }
+    return low < 0 ? high : 16 * high + low;
+  }
+
+  unsigned int ComputeChecksum(const char* str, size_t size)
+  {
+    if (size < 1 + 1 + 2) /* at least: $, *, checksum */
+    {
+      return std::numeric_limits<unsigned int>::max();
+    }
+
+    unsigned int computed = 0;
+    for (size_t i = 1; i < size - 3; i++)
+    {
+      computed ^= static_cast<unsigned int>(str[i]);
+    }
+
+    return computed;
+  }
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAWords::Word::operator==(const char* text) const
+{
+  return std::strncmp(this->Data, text, this->Size) == 0 && text[this->Size] == '\0';
 }
 
 
@@ -170,8 +278,15 @@ void NMEALocation::Init()
 //------------------------------------------------------------------------------
 bool NMEAParser::ChecksumValid(const std::string& sentence)
 {
-  unsigned int computed = ComputeChecksum(sentence);
-  unsigned int read = ReadChecksum(sentence);
+  return this->ChecksumValid(sentence.c_str(), std::strlen(sentence.c_str()));
+}
+
+
+//------------------------------------------------------------------------------
+bool NMEAParser::ChecksumValid(const char* sentence, size_t size)
+{
+  unsigned int computed = ::ComputeChecksum(sentence, size);
+  unsigned int read = ::ReadChecksum(sentence, size);
   // (checks that we do not have a return corresponding to an error)
   return read == computed && read != std::numeric_limits<unsigned int>::max();
 }
@@ -180,43 +295,18 @@ bool NMEAParser::ChecksumValid(const std::string& sentence)
 //------------------------------------------------------------------------------
 unsigned int NMEAParser::ReadChecksum(const std::string& sentence)
 {
-  if (sentence.size() < 2)
-  {
-    // returns a value that does not fit in a byte,
-    // can be used to detect that Checksum is not readable
-    return std::numeric_limits<unsigned int>::max();
-  }
-
-  std::string checksumString = sentence.substr(sentence.size() - 2, 2);
-  unsigned int checksumByte; // does not seem to work with unsigned char
-  std::stringstream ss;
-  ss << std::hex << checksumString;
-  ss >> checksumByte;
-  return checksumByte;
+  return ::ReadChecksum(sentence.c_str(), sentence.size());
 }
 
 
 //------------------------------------------------------------------------------
 unsigned int NMEAParser::ComputeChecksum(const std::string& sentence)
 {
-  const char* str = sentence.c_str();
-  if (strlen(str) < 1 + 1 + 2) /* at least: $, *, checksum */
-  {
-    return std::numeric_limits<unsigned int>::max();
-  }
-
-  unsigned int computed = 0;
-  for (int i = 1; i < static_cast<int>(strlen(str)) - 3; i++)
-  {
-    computed ^= static_cast<unsigned int>(str[i]);
-  }
-
-  return computed;
+  return ::ComputeChecksum(sentence.c_str(), std::strlen(sentence.c_str()));
 }
 
-
 //------------------------------------------------------------------------------
-bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
+bool NMEAParser::ParseGPRMC(const NMEAWords& w,
                             NMEALocation& location)
 {
   const unsigned int RMC_UTC_TIME = 1;
@@ -233,7 +323,7 @@ bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
   const unsigned int RMC_FAA = 12; // ! warning: present only if version >= 2.3
   /* UTC seconds of day */
   // We make the field mandatory
-  if (w[RMC_UTC_TIME] == "")
+  if (w[RMC_UTC_TIME].empty())
   {
     return false;
   }
@@ -268,13 +358,11 @@ bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
 
 
   /* Speed */
-  if (w[RMC_SPEED] != "")
+  if (!w[RMC_SPEED].empty())
   {
     location.HasSpeed = true;
-    try {
-      location.Speed = std::stod(w[RMC_SPEED]);
-    }
-    catch (const std::logic_error&) {
+    if (!ParseDouble(w[RMC_SPEED], location.Speed))
+    {
       return false;
     }
   }
@@ -286,13 +374,11 @@ bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
 
 
   /* Angle */
-  if (w[RMC_ANGLE] != "")
+  if (!w[RMC_ANGLE].empty())
   {
     location.HasTrackAngle = true;
-    try {
-      location.TrackAngle = std::stod(w[RMC_ANGLE]);
-    }
-    catch (const std::logic_error&) {
+    if (!ParseDouble(w[RMC_ANGLE], location.TrackAngle))
+    {
       return false;
     }
   }
@@ -304,24 +390,23 @@ bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
 
 
   /* Date */
-  if (w[RMC_DATE] != "")
+  if (!w[RMC_DATE].empty())
   {
-    if (w[RMC_DATE].size() != 6)
+    if (w[RMC_DATE].Size != 6)
     {
       return false;
     }
     location.HasDate = true;
-    try {
-      location.DateDay = static_cast<int>(
-                              std::stoul(w[RMC_DATE].substr(0, 2)));
-      location.DateMonth = static_cast<int>(
-                              std::stoul(w[RMC_DATE].substr(2,2)));
-      location.DateYear = static_cast<int>(
-                              std::stoul(w[RMC_DATE].substr(4,2)));
-    }
-    catch (const std::logic_error&) {
+    const char* date = w[RMC_DATE].Data;
+    unsigned long day = 0, month = 0, year = 0;
+    if (!ParseUnsigned(date, 2, day) || !ParseUnsigned(date + 2, 2, month) ||
+        !ParseUnsigned(date + 4, 2, year))
+    {
       return false;
     }
+    location.DateDay = static_cast<int>(day);
+    location.DateMonth = static_cast<int>(month);
+    location.DateYear = static_cast<int>(year);
   }
   else
   {
@@ -345,7 +430,7 @@ bool NMEAParser::ParseGPRMC(const std::vector<std::string>& w,
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
+bool NMEAParser::ParseGPGGA(const NMEAWords& w,
                             NMEALocation& location)
 {
   const unsigned int GGA_UTC_TIME = 1;
@@ -364,7 +449,7 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
   const unsigned int GGA_DIF_STATION = 14;
   /* UTC seconds of day */
   // We make the field mandatory
-  if (w[GGA_UTC_TIME] == "")
+  if (w[GGA_UTC_TIME].empty())
   {
     return false;
   }
@@ -382,51 +467,50 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
 
 
   /* "Quality" (it is more about the type of fix) */
-  if (w[GGA_QUALITY] == "")
+  if (w[GGA_QUALITY].empty())
   {
     location.HasTypeOfFix = false;
   }
   else
   {
     location.HasTypeOfFix = true;
-    try {
-      int quality = static_cast<int>(std::stoul(w[GGA_QUALITY]));
-      switch (quality) {
-        case 0:
-          location.TypeOfFix = NMEALocation::NO_FIX;
-          break;
-        case 1:
-          location.TypeOfFix = NMEALocation::GPS_FIX;
-          break;
-        case 2:
-          location.TypeOfFix = NMEALocation::DIFFERENTIAL_GPS_FIX;
-          break;
-        case 3:
-          location.TypeOfFix = NMEALocation::PPS_FIX;
-          break;
-        case 4:
-          location.TypeOfFix = NMEALocation::RTK_FIX;
-          break;
-        case 5:
-          location.TypeOfFix = NMEALocation::FLOAT_RTK_FIX;
-          break;
-        case 6:
-          location.TypeOfFix = NMEALocation::ESTIMATED_FIX;
-          break;
-        case 7:
-          location.TypeOfFix = NMEALocation::MANUAL_INPUT_FIX;
-          break;
-        case 8:
-          location.TypeOfFix = NMEALocation::SIMULATION_FIX;
-          break;
-        default:
-          location.TypeOfFix = NMEALocation::UNDEFINED_FIX;
-          return false;
-      }
-    }
-    catch (const std::logic_error&) {
+    unsigned long quality = 0;
+    if (!ParseUnsigned(w[GGA_QUALITY].Data, w[GGA_QUALITY].Size, quality))
+    {
       return false;
     }
+    switch (quality) {
+      case 0:
+        location.TypeOfFix = NMEALocation::NO_FIX;
+        break;
+      case 1:
+        location.TypeOfFix = NMEALocation::GPS_FIX;
+        break;
+      case 2:
+        location.TypeOfFix = NMEALocation::DIFFERENTIAL_GPS_FIX;
+        break;
+      case 3:
+        location.TypeOfFix = NMEALocation::PPS_FIX;
+        break;
+      case 4:
+        location.TypeOfFix = NMEALocation::RTK_FIX;
+        break;
+      case 5:
+        location.TypeOfFix = NMEALocation::FLOAT_RTK_FIX;
+        break;
+      case 6:
+        location.TypeOfFix = NMEALocation::ESTIMATED_FIX;
+        break;
+      case 7:
+        location.TypeOfFix = NMEALocation::MANUAL_INPUT_FIX;
+        break;
+      case 8:
+        location.TypeOfFix = NMEALocation::SIMULATION_FIX;
+        break;
+      default:
+        location.TypeOfFix = NMEALocation::UNDEFINED_FIX;
+        return false;
+    }
   }
 
 
@@ -435,13 +519,11 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
 
 
   /* Horizontal dilution of precision */
-  if (w[GGA_HDOP] != "")
+  if (!w[GGA_HDOP].empty())
   {
     location.HasHorizontalDOP = true;
-    try {
-      location.HorizontalDOP = std::stod(w[GGA_HDOP]);
-    }
-    catch (const std::logic_error&) {
+    if (!ParseDouble(w[GGA_HDOP], location.HorizontalDOP))
+    {
       return false;
     }
   }
@@ -453,16 +535,14 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
 
 
   /* Antenna Altitude above/below sea level */
-  if (w[GGA_ALT] != "")
+  if (!w[GGA_ALT].empty())
   {
     // makes the unit field mandatory
     if (w[GGA_ALTUNIT] == "M")
     {
       location.HasAltitude = true;
-      try {
-        location.Altitude = std::stod(w[GGA_ALT]);
-      }
-      catch (const std::logic_error&) {
+      if (!ParseDouble(w[GGA_ALT], location.Altitude))
+      {
         return false;
       }
     }
@@ -479,16 +559,14 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
 
 
   /* Geoidal separation */
-  if (w[GGA_GEOSEP] != "")
+  if (!w[GGA_GEOSEP].empty())
   {
     // makes the unit field mandatory
     if (w[GGA_GEOSEPUNIT] == "M")
     {
       location.HasGeoidalSeparation = true;
-      try {
-        location.GeoidalSeparation = std::stod(w[GGA_GEOSEP]);
-      }
-      catch (const std::logic_error&) {
+      if (!ParseDouble(w[GGA_GEOSEP], location.GeoidalSeparation))
+      {
         return false;
       }
     }
@@ -519,7 +597,7 @@ bool NMEAParser::ParseGPGGA(const std::vector<std::string>& w,
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::ParseGPGLL(const std::vector<std::string>& w,
+bool NMEAParser::ParseGPGLL(const NMEAWords& w,
                             NMEALocation& location)
 {
   const unsigned int GLL_ULAT = 1;
@@ -539,7 +617,7 @@ bool NMEAParser::ParseGPGLL(const std::vector<std::string>& w,
 
   /* UTC seconds of day */
   // We make the field mandatory
-  if (w[GLL_UTC_TIME] == "")
+  if (w[GLL_UTC_TIME].empty())
   {
     return false;
   }
@@ -576,98 +654,117 @@ bool NMEAParser::ParseGPGLL(const std::vector<std::string>& w,
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::IsGPRMC(const std::vector<std::string>& w)
-{
-  const unsigned int NAME = 0;
-  return w.size() > 0
-      && w[NAME] == "$GPRMC"
-      && (w.size() == 13 || w.size() == 14);
-}
-
-
-//------------------------------------------------------------------------------
-bool NMEAParser::IsGPGGA(const std::vector<std::string>& w)
+NMEAParser::SentenceType NMEAParser::GetSentenceType(const NMEAWords& w)
 {
   const unsigned int NAME = 0;
-  return w.size() > 0
-      && w[NAME] == "$GPGGA"
-      && w.size() == 15; // On first read of catdb.org I understood 16
-}
-
+  if (w.size() == 0)
+  {
+    return UNKNOWN_SENTENCE;
+  }
+  const NMEAWords::Word& name = w[NAME];
+  if (name.Size != 6 || std::strncmp(name.Data, "$GP", 3) != 0)
+  {
+    return UNKNOWN_SENTENCE;
+  }
 
-//------------------------------------------------------------------------------
-bool NMEAParser::IsGPGLL(const std::vector<std::string>& w)
-{
-  const unsigned int NAME = 0;
-  return w.size() > 0
-      && w[NAME] == "$GPGLL"
-      && (w.size() == 8 || w.size() == 9);
+  // There can be multiple possible length because "FAA mode indicator" is
+  // present in NMEA 2.3 and later.
+  // This "FAA mode indicator" is not present in Velodyne relay packets of
+  // file "HDL32-V2_R into Butterfield into Digital Drive.pcap".
+  const char* type = name.Data + 3;
+  if (std::strncmp(type, "RMC", 3) == 0)
+  {
+    return (w.size() == 13 || w.size() == 14) ? GPRMC_SENTENCE : UNKNOWN_SENTENCE;
+  }
+  if (std::strncmp(type, "GGA", 3) == 0)
+  {
+    // On first read of catdb.org I understood 16
+    return w.size() == 15 ? GPGGA_SENTENCE : UNKNOWN_SENTENCE;
+  }
+  if (std::strncmp(type, "GLL", 3) == 0)
+  {
+    return (w.size() == 8 || w.size() == 9) ? GPGLL_SENTENCE : UNKNOWN_SENTENCE;
+  }
+  return UNKNOWN_SENTENCE;
 }
 
 
 //------------------------------------------------------------------------------
-bool NMEAParser::ParseLocation(const std::string& sentence, NMEALocation& location)
+bool NMEAParser::ParseLocation(const char* sentence, size_t size, NMEALocation& location)
 {
   // reset location. This is important to do because no sentence can fill
   // all NMEALocation fields.
   location.Init();
-  std::vector<std::string> w = SplitWords(sentence);
+  NMEAWords w;
+  this->SplitWords(sentence, size, w);
   if (w.size() < 1)
   {
     // the sequence is empty, so it contains no location
     return false;
   }
 
-  if (!ChecksumValid(sentence))
+  if (!this->ChecksumValid(sentence, size))
   {
     return false;
   }
 
   // Look for sentences providing location,
   // and check that their length is correct.
-  // There can be multiple possible length because "FAA mode indicator" is
-  // present in NMEA 2.3 and later.
-  // This "FAA mode indicator" is not present in Velodyne relay packets of
-  // file "HDL32-V2_R into Butterfield into Digital Drive.pcap".
-  if (IsGPRMC(w))
-  {
-    return ParseGPRMC(w, location);
-  }
-  if (IsGPGGA(w))
-  {
-    return ParseGPGGA(w, location);
-  }
-  else if (IsGPGLL(w))
-  {
-    return ParseGPGLL(w, location);
-  }
-  else
-  {
-    // not a location sentence, or sentence with invalid length
-    return false;
+  switch (this->GetSentenceType(w))
+  {
+    case GPRMC_SENTENCE:
+      return this->ParseGPRMC(w, location);
+    case GPGGA_SENTENCE:
+      return this->ParseGPGGA(w, location);
+    case GPGLL_SENTENCE:
+      return this->ParseGPGLL(w, location);
+    default:
+      // not a location sentence, or sentence with invalid length
+      return false;
   }
 }
 
 
+//------------------------------------------------------------------------------
+bool NMEAParser::ParseLocation(const std::string& sentence, NMEALocation& location)
+{
+  return this->ParseLocation(sentence.c_str(), std::strlen(sentence.c_str()), location);
+}
+
+
 //------------------------------------------------------------------------------
 bool NMEAParser::ParseLocation(const char* sentence, NMEALocation& location)
 {
-  return this->ParseLocation(std::string(sentence), location);
+  return this->ParseLocation(sentence, std::strlen(sentence), location);
 }
 
 
 //------------------------------------------------------------------------------
-std::vector<std::string> NMEAParser::SplitWords(const std::string& sentence)
+void NMEAParser::SplitWords(const std::string& sentence, NMEAWords& words)
 {
-  std::stringstream sstr(sentence);
-  std::string token;
+  this->SplitWords(sentence.c_str(), sentence.size(), words);
+}
 
-  std::vector<std::string> result;
 
-  while (std::getline(sstr, token, ','))
-  {
-    result.push_back(token);
+//------------------------------------------------------------------------------
+void NMEAParser::SplitWords(const char* sentence, size_t size, NMEAWords& words)
+{
+  words.NumberOfWords = 0;
+  size_t begin = 0;
+  // like std::getline, a last empty field is not a word
+  while (begin < size)
+  {
+    const void* comma = std::memchr(sentence + begin, ',', size - begin);
+    const size_t end = comma ? static_cast<const char*>(comma) - sentence : size;
+    if (words.NumberOfWords == NMEAWords::MaxNumberOfWords)
+    {
+      // too many words for a location sentence
+      words.NumberOfWords = NMEAWords::MaxNumberOfWords + 1;
+      return;
+    }
+    NMEAWords::Word& word = words.Words[words.NumberOfWords++];
+    word.Data = sentence + begin;
+    word.Size = end - begin;
+    begin = end + 1;
   }
-
-  return result;
 }
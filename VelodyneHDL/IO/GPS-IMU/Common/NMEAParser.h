@@ -1,26 +1,65 @@
 #ifndef NMEAPARSER_H
 #define NMEAPARSER_H
 
+#include <cstddef>
 #include <string>
-#include <vector>
 #include <vvConfigure.h>
 
 struct NMEALocation;
 
+/**
+ * @brief NMEAWords fields of a NMEA sentence split at the commas, without copy: the words
+ * point inside the sentence, which must outlive them.
+ * As with std::getline, an empty field after the last comma is not a word. The last word
+ * keeps the "*XX" checksum.
+ */
+struct VelodyneHDLPlugin_EXPORT NMEAWords
+{
+  struct Word
+  {
+    const char* Data;
+    size_t Size;
+
+    bool empty() const { return this->Size == 0; }
+    bool operator==(const char* text) const;
+    bool operator!=(const char* text) const { return !(*this == text); }
+  };
+
+  //! Location sentences have at most 15 words
+  static const size_t MaxNumberOfWords = 24;
+
+  Word Words[MaxNumberOfWords];
+  //! Number of words, MaxNumberOfWords + 1 if the sentence has more words than can be stored
+  size_t NumberOfWords = 0;
+
+  size_t size() const { return this->NumberOfWords; }
+  const Word& operator[](size_t i) const { return this->Words[i]; }
+};
+
 /**
  * @brief NMEAParser parses a NMEA 0183 sentence that provides location data
  * (GPRMC, GPGGA or GPGLL sequence).
  *
  * If the sentence can be parsed, the result is stored inside a NMEALocation
- * structure.
+ * structure. Nothing is allocated while parsing, so that high rate GNSS logs can be
+ * decoded quickly.
  */
 class VelodyneHDLPlugin_EXPORT NMEAParser
 {
 public:
-  std::vector<std::string> SplitWords(const std::string& sentence);
-  bool IsGPGLL(const std::vector<std::string>& w);
-  bool IsGPGGA(const std::vector<std::string>& w);
-  bool IsGPRMC(const std::vector<std::string>& w);
+  enum SentenceType { UNKNOWN_SENTENCE = 0, GPRMC_SENTENCE, GPGGA_SENTENCE, GPGLL_SENTENCE };
+
+  void SplitWords(const std::string& sentence, NMEAWords& words);
+  void SplitWords(const char* sentence, size_t size, NMEAWords& words);
+
+  /**
+   * @brief GetSentenceType return the type of a location sentence, UNKNOWN_SENTENCE if it is
+   * not a location sentence or if its number of words is wrong
+   */
+  SentenceType GetSentenceType(const NMEAWords& w);
+  bool IsGPGLL(const NMEAWords& w) { return this->GetSentenceType(w) == GPGLL_SENTENCE; }
+  bool IsGPGGA(const NMEAWords& w) { return this->GetSentenceType(w) == GPGGA_SENTENCE; }
+  bool IsGPRMC(const NMEAWords& w) { return this->GetSentenceType(w) == GPRMC_SENTENCE; }
   /** @name ParseLocation functions
    * @brief Parse a NMEA 0183 sentence that provides a location
    * @param sentence must be a string starting with $GP{RMC,GGA,GLL}
@@ -32,9 +71,9 @@ public:
    * If false is returned, do not use the struct location.
    */
   ///@{
-  bool ParseGPRMC(const std::vector<std::string>& w, NMEALocation& location);
-  bool ParseGPGGA(const std::vector<std::string>& w, NMEALocation& location);
-  bool ParseGPGLL(const std::vector<std::string>& w, NMEALocation& location);
+  bool ParseGPRMC(const NMEAWords& w, NMEALocation& location);
+  bool ParseGPGGA(const NMEAWords& w, NMEALocation& location);
+  bool ParseGPGLL(const NMEAWords& w, NMEALocation& location);
   bool ParseLocation(const char* sentence, NMEALocation& location);
   bool ParseLocation(const std::string& sentence, NMEALocation& location);
   ///@}
@@ -50,8 +89,12 @@ public:
    * @return Returns true if the sentence has a valid checksum
    */
   bool ChecksumValid(const std::string& sentence);
+  bool ChecksumValid(const char* sentence, size_t size);
   unsigned int ReadChecksum(const std::string& sentence);
   unsigned int ComputeChecksum(const std::string& sentence);
+
+private:
+  bool ParseLocation(const char* sentence, size_t size, NMEALocation& location);
 };
 
 /**
@@ -0,0 +1,179 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "TrajectoryBuffer.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+bool IsBefore(const TrajectoryBuffer::Sample& sample, double time)
+{
+  return sample.Time < time;
+}
+}
+
+//-----------------------------------------------------------------------------
+void TrajectoryBuffer::Add(const Sample& sample)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (!this->Samples.empty() && sample.Time <= this->Samples.back().Time)
+  {
+    return;
+  }
+  this->Samples.push_back(sample);
+  this->DropOldSamples();
+  ++this->Revision;
+}
+
+//-----------------------------------------------------------------------------
+void TrajectoryBuffer::Clear()
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->Samples.clear();
+  ++this->Revision;
+}
+
+//-----------------------------------------------------------------------------
+size_t TrajectoryBuffer::GetNumberOfSamples() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  return this->Samples.size();
+}
+
+//-----------------------------------------------------------------------------
+bool TrajectoryBuffer::GetTimeRange(double& first, double& last) const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (this->Samples.empty())
+  {
+    return false;
+  }
+  first = this->Samples.front().Time;
+  last = this->Samples.back().Time;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool TrajectoryBuffer::GetLastSample(Sample& sample) const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (this->Samples.empty())
+  {
+    return false;
+  }
+  sample = this->Samples.back();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+size_t TrajectoryBuffer::GetSamples(double t0, double t1, std::vector<Sample>& samples) const
+{
+  samples.clear();
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  auto begin = std::lower_bound(this->Samples.begin(), this->Samples.end(), t0, IsBefore);
+  for (auto it = begin; it != this->Samples.end() && it->Time <= t1; ++it)
+  {
+    samples.push_back(*it);
+  }
+  return samples.size();
+}
+
+//-----------------------------------------------------------------------------
+bool TrajectoryBuffer::Interpolate(double time, Sample& sample) const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (this->Samples.empty() || time < this->Samples.front().Time ||
+      time > this->Samples.back().Time)
+  {
+    return false;
+  }
+  auto next = std::lower_bound(this->Samples.begin(), this->Samples.end(), time, IsBefore);
+  if (next->Time == time)
+  {
+    sample = *next;
+    return true;
+  }
+  auto previous = next - 1;
+  const double ratio = (time - previous->Time) / (next->Time - previous->Time);
+  sample.Time = time;
+  sample.GPSTime = (1.0 - ratio) * previous->GPSTime + ratio * next->GPSTime;
+  sample.Lat = (1.0 - ratio) * previous->Lat + ratio * next->Lat;
+  sample.Long = (1.0 - ratio) * previous->Long + ratio * next->Long;
+  sample.Position = (1.0 - ratio) * previous->Position + ratio * next->Position;
+  // the heading wraps at 360 degrees
+  double headingChange = std::fmod(next->Heading - previous->Heading, 360.0);
+  if (headingChange > 180.0)
+  {
+    headingChange -= 360.0;
+  }
+  else if (headingChange < -180.0)
+  {
+    headingChange += 360.0;
+  }
+  sample.Heading = previous->Heading + ratio * headingChange;
+  if (sample.Heading < 0.0)
+  {
+    sample.Heading += 360.0;
+  }
+  else if (sample.Heading >= 360.0)
+  {
+    sample.Heading -= 360.0;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TrajectoryBuffer::SetMaximumDuration(double duration)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->MaximumDuration = std::max(duration, 0.0);
+  this->DropOldSamples();
+  ++this->Revision;
+}
+
+//-----------------------------------------------------------------------------
+double TrajectoryBuffer::GetMaximumDuration() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  return this->MaximumDuration;
+}
+
+//-----------------------------------------------------------------------------
+unsigned long TrajectoryBuffer::GetRevision() const
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  return this->Revision;
+}
+
+//-----------------------------------------------------------------------------
+void TrajectoryBuffer::DropOldSamples()
+{
+  if (this->MaximumDuration <= 0.0 || this->Samples.empty())
+  {
+    return;
+  }
+  const double oldest = this->Samples.back().Time - this->MaximumDuration;
+  while (this->Samples.front().Time < oldest)
+  {
+    this->Samples.pop_front();
+  }
+}
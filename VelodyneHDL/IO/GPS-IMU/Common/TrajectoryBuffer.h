@@ -0,0 +1,100 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef TRAJECTORY_BUFFER_H
+#define TRAJECTORY_BUFFER_H
+
+// BOOST
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+// EIGEN
+#include <Eigen/Core>
+
+// STD
+#include <deque>
+#include <vector>
+
+/**
+ * \class TrajectoryBuffer
+ * \brief Rolling, time ordered positions of a GNSS receiver, filled live from the position
+ *        packets of a stream and queried by the consumers (georeferencing, time
+ *        synchronization) while it is filled. The queries by time are a binary search.
+ *
+ *        The times are in seconds in the time base of the lidar frames, the positions in
+ *        meters in a projected system (UTM) and the headings in degrees.
+ */
+class TrajectoryBuffer
+{
+public:
+  struct Sample
+  {
+    double Time;
+    //! UTC time of the fix, in seconds since the midnight of the first fix
+    double GPSTime;
+    double Lat;
+    double Long;
+    Eigen::Vector3d Position;
+    double Heading;
+  };
+
+  //! Add a sample, it is ignored if it is not newer than the last one
+  void Add(const Sample& sample);
+
+  void Clear();
+
+  size_t GetNumberOfSamples() const;
+
+  //! Time of the first and last samples, false if the buffer is empty
+  bool GetTimeRange(double& first, double& last) const;
+
+  //! Last sample added, false if the buffer is empty
+  bool GetLastSample(Sample& sample) const;
+
+  /**
+   * @brief GetSamples copy the samples whose time is in [t0, t1]
+   * @return the number of samples copied, samples is cleared first
+   */
+  size_t GetSamples(double t0, double t1, std::vector<Sample>& samples) const;
+
+  /**
+   * @brief Interpolate linearly the position at a time, the heading along the shortest arc
+   * @return false if the time is out of the samples
+   */
+  bool Interpolate(double time, Sample& sample) const;
+
+  /**
+   * @brief SetMaximumDuration duration in seconds kept by the buffer, the older samples are
+   * dropped when new ones are added. 0, the default, keeps all of them.
+   */
+  void SetMaximumDuration(double duration);
+  double GetMaximumDuration() const;
+
+  //! Incremented each time the samples change, so that a consumer can tell it has seen them
+  unsigned long GetRevision() const;
+
+private:
+  //! Drop the samples older than MaximumDuration, the mutex must be held
+  void DropOldSamples();
+
+  mutable boost::mutex Mutex;
+  std::deque<Sample> Samples;
+  double MaximumDuration = 0.0;
+  unsigned long Revision = 0;
+};
+
+#endif // TRAJECTORY_BUFFER_H
@@ -0,0 +1,142 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "VelodyneImuDecoder.h"
+
+// STD
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+const unsigned short BIT_12_MASK = 0x0fff;
+const unsigned short REMAINDER_12_MASK = 0x07ff;
+const unsigned short SIGN_12_MASK = 0x0800;
+
+//! Microseconds in an hour, the period of the lidar time
+const double HOUR_US = 1e6 * 3600.0;
+const double STANDARD_GRAVITY = 9.80665;
+const double DEG_TO_RAD = 3.14159265358979323846 / 180.0;
+
+//-----------------------------------------------------------------------------
+short ReadChannel(const unsigned char* data)
+{
+  unsigned short value;
+  std::memcpy(&value, data, 2);
+  // Select only least significant 12 bits and perform 12 bit twos complement
+  value &= BIT_12_MASK;
+  return static_cast<short>(-2048 * ((value & SIGN_12_MASK) >> 11) + (value & REMAINDER_12_MASK));
+}
+}
+
+const double VelodyneImuDecoder::GyroScale = 0.09766;       // deg / s
+const double VelodyneImuDecoder::TemperatureScale = 0.1453; // C
+const double VelodyneImuDecoder::TemperatureOffset = 25.0;  // C
+const double VelodyneImuDecoder::AccelScale = 0.001221;     // G
+
+//-----------------------------------------------------------------------------
+VelodyneImuDecoder::VelodyneImuDecoder()
+{
+  this->GyroAxes.setIdentity();
+  this->AccelAxes.setZero();
+  for (int board = 0; board < 3; ++board)
+  {
+    this->AccelAxes((board + 1) % 3, 2 * board) = 0.5;
+    this->AccelAxes((board + 2) % 3, 2 * board + 1) = 0.5;
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool VelodyneImuDecoder::ReadChannels(const unsigned char* data, unsigned int bytes, Channels& channels)
+{
+  if (bytes != 512)
+  {
+    // Data-Packet Specifications says that position-packets are 512 byte long.
+    return false;
+  }
+  for (int i = 0; i < 14; ++i)
+  {
+    if (data[i] != 0)
+    {
+      return false;
+    }
+  }
+
+  for (int i = 0; i < 3; ++i)
+  {
+    channels.Gyro[i] = ReadChannel(data + 14 + i * 8);
+    channels.Temperature[i] = ReadChannel(data + 14 + i * 8 + 2);
+    channels.AccelX[i] = ReadChannel(data + 14 + i * 8 + 4);
+    channels.AccelY[i] = ReadChannel(data + 14 + i * 8 + 6);
+  }
+  std::memcpy(&channels.TohTimestamp, data + 14 + 3 * 8 + 160, 4);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool VelodyneImuDecoder::Decode(const unsigned char* data, unsigned int bytes, ImuBuffer::Sample& sample)
+{
+  Channels channels;
+  if (!ReadChannels(data, bytes, channels))
+  {
+    return false;
+  }
+
+  if (this->HasLastTimestamp &&
+      static_cast<double>(channels.TohTimestamp) - this->LastTimestamp < -0.5 * HOUR_US)
+  {
+    // top of the hour wrap
+    this->TimeOffset += HOUR_US;
+  }
+  this->HasLastTimestamp = true;
+  this->LastTimestamp = channels.TohTimestamp;
+  this->ToSample(channels, 1e-6 * (channels.TohTimestamp + this->TimeOffset), sample);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void VelodyneImuDecoder::ToSample(const Channels& channels, double time, ImuBuffer::Sample& sample) const
+{
+  sample.Time = time;
+  Eigen::Vector3d gyro;
+  Eigen::Matrix<double, 6, 1> accel;
+  for (int i = 0; i < 3; ++i)
+  {
+    gyro(i) = channels.Gyro[i] * GyroScale;
+    accel(2 * i) = channels.AccelX[i] * AccelScale;
+    accel(2 * i + 1) = channels.AccelY[i] * AccelScale;
+  }
+  sample.AngularVelocity = DEG_TO_RAD * (this->GyroAxes * gyro);
+  sample.Acceleration = STANDARD_GRAVITY * (this->AccelAxes * accel);
+}
+
+//-----------------------------------------------------------------------------
+void VelodyneImuDecoder::Reset()
+{
+  this->HasLastTimestamp = false;
+  this->LastTimestamp = 0;
+  this->TimeOffset = 0.0;
+}
+
+//-----------------------------------------------------------------------------
+void VelodyneImuDecoder::SetChannelAxes(const Eigen::Matrix3d& gyroAxes,
+                                        const Eigen::Matrix<double, 3, 6>& accelAxes)
+{
+  this->GyroAxes = gyroAxes;
+  this->AccelAxes = accelAxes;
+}
@@ -0,0 +1,98 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VELODYNE_IMU_DECODER_H
+#define VELODYNE_IMU_DECODER_H
+
+// LOCAL
+#include "ImuBuffer.h"
+
+// EIGEN
+#include <Eigen/Core>
+
+/**
+ * \class VelodyneImuDecoder
+ * \brief Decode the gyroscopes and accelerometers of the Velodyne position packets (512 bytes
+ *        of UDP payload) into ImuBuffer samples. The sensor has three boards, each with a
+ *        gyroscope and a two axes accelerometer. ChannelAxes gives the axes they measure,
+ *        by default board i measures the rotation around axis i, and its X and Y
+ *        accelerometers the axes i+1 and i+2 (modulo 3); the two readings of an axis are
+ *        averaged. Use vtkSlam::SetImuToLidar to rotate these axes to the lidar ones.
+ *
+ *        The time of a sample is the lidar time of the packet in seconds, as for the lidar
+ *        frames. It wraps every hour, the wraps are followed so that the times increase.
+ */
+class VelodyneImuDecoder
+{
+public:
+  //! Channels of a position packet, 12 bits two's complement values
+  struct Channels
+  {
+    unsigned int TohTimestamp;
+    short Gyro[3];
+    short Temperature[3];
+    short AccelX[3];
+    short AccelY[3];
+  };
+
+  //! Scales of the channels to deg/s, degrees Celsius and G
+  static const double GyroScale;
+  static const double TemperatureScale;
+  static const double TemperatureOffset;
+  static const double AccelScale;
+
+  VelodyneImuDecoder();
+
+  /**
+   * @brief ReadChannels read the channels of a position packet
+   * @return false if the packet is not a position packet
+   */
+  static bool ReadChannels(const unsigned char* data, unsigned int bytes, Channels& channels);
+
+  /**
+   * @brief Decode a position packet into a sample, the packets must be given in order
+   * @return false if the packet is not a position packet
+   */
+  bool Decode(const unsigned char* data, unsigned int bytes, ImuBuffer::Sample& sample);
+
+  //! Convert the channels of a packet to a sample at a time in seconds
+  void ToSample(const Channels& channels, double time, ImuBuffer::Sample& sample) const;
+
+  //! Forget the time of the previous packets, to decode another file
+  void Reset();
+
+  //! @{
+  /**
+   * Axes measured by the channels: the angular velocity (rad/s) is GyroAxes times the three
+   * gyroscopes (deg/s), the acceleration (m/s^2) AccelAxes times the accelerometers (G), in
+   * the order X1, Y1, X2, Y2, X3, Y3
+   */
+  void SetChannelAxes(const Eigen::Matrix3d& gyroAxes, const Eigen::Matrix<double, 3, 6>& accelAxes);
+  const Eigen::Matrix3d& GetGyroAxes() const { return this->GyroAxes; }
+  const Eigen::Matrix<double, 3, 6>& GetAccelAxes() const { return this->AccelAxes; }
+  //! @}
+
+private:
+  Eigen::Matrix3d GyroAxes;
+  Eigen::Matrix<double, 3, 6> AccelAxes;
+
+  bool HasLastTimestamp = false;
+  unsigned int LastTimestamp = 0;
+  double TimeOffset = 0.0;
+};
+
+#endif // VELODYNE_IMU_DECODER_H
@@ -27,7 +27,9 @@
 =========================================================================*/
 
 #include "vtkVelodyneHDLPositionReader.h"
+#include "TraceEvents.h"
 
+#include "vtkLidarReader.h"
 #include "vtkPacketFileReader.h"
 #include "vtkPacketFileWriter.h"
 #include "vtkVelodyneTransformInterpolator.h"
@@ -53,22 +55,30 @@
 #include <vtkUnsignedCharArray.h>
 #include <vtkUnsignedIntArray.h>
 #include <vtkUnsignedShortArray.h>
+#include <vtkWeakPointer.h>
 
 #include <vtk_libproj4.h>
+#include "GeoProjection.h"
 #include "NMEAParser.h"
+#include "VelodyneImuDecoder.h"
 #include "statistics.h"
 
 #include <boost/foreach.hpp>
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
-#include <boost/algorithm/string.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <iomanip>
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <sstream>
+#include <vector>
 
+#include <cctype>
 #include <cmath>
+#include <cstring>
 
 #ifdef _MSC_VER
 #include <boost/cstdint.hpp>
@@ -88,10 +98,7 @@ struct PositionPacket
   // - without a gps plugged: the instant when the lidar was powered on
   // - with a gps: any full UTC hour (such as 12:00:00 am, UTC)
   unsigned int tohTimestamp;
-  short gyro[3];
-  short temp[3];
-  short accelx[3];
-  short accely[3];
+  VelodyneImuDecoder::Channels Imu;
   // Usage of field PPS (Pulse Per Second signal) is explained in PDF document
   // "Webserver User Guide (VLP-16 & HDL-32E)" available at
   // https://velodynelidar.com/downloads.html#application_notes
@@ -105,121 +112,66 @@ struct PositionPacket
 };
 }
 
-namespace
-{
-int LatLongToZone(double lat, double lon)
-{
-  double longTemp = (lon + 180) - static_cast<int>((lon + 180) / 360) * 360 - 180;
-
-  int zone = static_cast<int>((longTemp + 180) / 6) + 1;
-  if (lat >= 56.0 && lat < 64.0 && longTemp >= 3.0 && longTemp < 12.0)
-  {
-    zone = 32;
-  }
-
-  if (lat >= 72.0 && lat < 84)
-  {
-    if (longTemp >= 0.0 && longTemp < 9.0)
-    {
-      zone = 31;
-    }
-    else if (longTemp >= 9.0 && longTemp < 21.0)
-    {
-      zone = 33;
-    }
-    else if (longTemp >= 21.0 && longTemp < 33.0)
-    {
-      zone = 35;
-    }
-    else if (longTemp >= 33.0 && longTemp < 42.0)
-    {
-      zone = 37;
-    }
-  }
-
-  return zone;
-}
-
-
-class UTMProjector
+//-----------------------------------------------------------------------------
+//! Values decoded from the position packets of a file, the output is built from them once
+//! all the packets have been read
+struct vtkVelodyneHDLPositionReader::DecodedPositions
 {
-  public:
-  UTMProjector(bool shouldWarnOnWeirdGPSData)
-  {
-    this->ShouldWarnOnWeirdGPSData = shouldWarnOnWeirdGPSData;
-    this->pj_utm = nullptr;
-    this->UTMZone = -1;
-  }
-
-  ~UTMProjector()
+  DecodedPositions()
   {
-    if (this->IsInitialized())
+    this->Lats->SetName("lat");
+    this->Lons->SetName("lon");
+    this->Times->SetName("time");
+    this->GPSTimes->SetName("gpstime");
+    const char* names[] = { "gyro1", "gyro2", "gyro3", "temp1", "temp2", "temp3", "accel1x",
+      "accel1y", "accel2x", "accel2y", "accel3x", "accel3y", "heading" };
+    for (const char* name : names)
     {
-      pj_free(this->pj_utm);
+      vtkSmartPointer<vtkDoubleArray> dataVector = vtkSmartPointer<vtkDoubleArray>::New();
+      dataVector->SetName(name);
+      this->DataVectors[name] = dataVector;
     }
   }
 
-  void Project(double lat, double lon, double& x, double& y)
-  {
-    if (!this->IsInitialized())
-    {
-      this->Init(lat, lon);
-    }
-
-    projUV lp;
-    lp.u = DEG_TO_RAD * lon;
-    lp.v = DEG_TO_RAD * lat;
-
-    projUV xy;
-    xy = pj_fwd(lp, pj_utm);
-    if (pj_utm->ctx->last_errno != 0 && this->ShouldWarnOnWeirdGPSData)
-    {
-      vtkGenericWarningMacro("Error : WGS84 projection failed, this will create a GPS error. "
-                             "Please check the latitude and longitude inputs");
-    }
-
-    x = xy.u;
-    y = xy.v;
-  }
-
-  private:
-  bool IsInitialized()
-  {
-    return this->pj_utm != nullptr;
-  }
-
-  void Init(double initial_lat, double initial_lon)
-  {
-    assert(!pj_utm);
-    this->UTMZone = LatLongToZone(initial_lat, initial_lon);
-    std::stringstream utmparams;
-    utmparams << "+proj=utm ";
-    std::stringstream zone;
-    zone << "+zone=" << this->UTMZone;
-    this->UTMString = zone.str();
-    // WARNING: Dont let the string stream pass out of scope until
-    // we finish initialization
-    utmparams << this->UTMString << " ";
-    if (initial_lat < 0)
-    {
-      utmparams << "+south ";
-    }
-
-    utmparams << "+ellps=WGS84 ";
-    utmparams << "+units=m ";
-    utmparams << "+no_defs ";
-    pj_utm = pj_init_plus(utmparams.str().c_str());
-  }
-
-  bool ShouldWarnOnWeirdGPSData;
-  projPJ pj_utm;
-  int UTMZone;
-  std::string UTMString;
+  vtkSmartPointer<vtkDoubleArray> Lats = vtkSmartPointer<vtkDoubleArray>::New();
+  vtkSmartPointer<vtkDoubleArray> Lons = vtkSmartPointer<vtkDoubleArray>::New();
+  vtkSmartPointer<vtkDoubleArray> Times = vtkSmartPointer<vtkDoubleArray>::New();
+  vtkSmartPointer<vtkDoubleArray> GPSTimes = vtkSmartPointer<vtkDoubleArray>::New();
+  std::map<std::string, vtkSmartPointer<vtkDoubleArray> > DataVectors;
+  vtkIdType NumberOfPoints = 0;
+
+  //! positions of the points, the points with a sentence hold their longitude and latitude
+  //! until they are projected
+  std::vector<double> Positions;
+  std::vector<vtkIdType> GeoPointIds;
+
+  //! warnings about the sentences, they are given when the output is built as the packets may
+  //! be decoded by the indexing thread of a vtkLidarReader
+  std::vector<std::string> Warnings;
+
+  //! time of day wraps
+  bool HasLastLidarUpdateTime = false;
+  double LastLidarUpdateTime = 0.0;
+  double LidarTimeOffset = 0.0;
+  bool HasLastGPSUpdateTime = false;
+  double LastGPSUpdateTime = 0.0;
+  double GPSTimeOffset = 0.0;
+  double ConvertedGPSUpdateTime = 0.0;
+  double PreviousConvertedGPSUpdateTime = -1.0; // negative means "no previous"
+
+  //! synchronization between the lidar and the GPS, the measurements of the timeshift do not
+  //! include AssumedHardwareLag yet
+  bool PPSSynced = false;
+  PPSState LastPPSState = PPS_ABSENT;
+  bool HasTimeshiftEstimation = false;
+  std::vector<double> TimeshiftMeasurements;
+
+  //! IMU measurements of all the position packets, whatever their sentence
+  std::vector<ImuBuffer::Sample> ImuSamples;
 };
-}
 
 //-----------------------------------------------------------------------------
-class vtkVelodyneHDLPositionReader::vtkInternal
+class vtkVelodyneHDLPositionReader::vtkInternal : public vtkLidarReader::PacketObserver
 {
 public:
   vtkInternal()
@@ -233,27 +185,44 @@ public:
 
   int ProcessHDLPacket(const unsigned char* data, unsigned int bytes, PositionPacket& position);
 
+  //! Decode a packet and append it to the decoded positions if it is a position packet
+  void DecodePacket(const unsigned char* data, unsigned int bytes, bool useGPGGASentences,
+    DecodedPositions& decoded);
+
   void InterpolateGPS(
     vtkPoints* points, vtkDataArray* gpsTime, vtkDataArray* times, vtkDataArray* heading);
 
+  void StartPackets(const std::string& fileName) override;
+  void ProcessPacket(
+    const unsigned char* data, unsigned int dataLength, double timeSinceStart) override;
+  void EndPackets(bool complete) override;
+
   vtkPacketFileReader* Reader;
   double Offset[3];
 
   vtkNew<vtkVelodyneTransformInterpolator> Interp;
   vtkNew<vtkTransform> CalibrationTransform;
-};
 
-namespace
-{
-const unsigned short BIT_12_MASK = 0x0fff;
-const unsigned short REMAINDER_12_MASK = 0x07ff;
-const unsigned short SIGN_12_MASK = 0x0800;
-
-const double GYRO_SCALE = 0.09766;   // deg / s
-const double TEMP_SCALE = 0.1453;    // C
-const double TEMP_OFFSET = 25.0;     // C
-const double ACCEL_SCALE = 0.001221; // G
-}
+  //! Lidar reader giving the packets of its scans, see SetLidarReader
+  vtkWeakPointer<vtkLidarReader> LidarReader;
+
+  //! Protect the scan state, the scan may be run by the indexing thread of the lidar reader
+  boost::mutex ScanMutex;
+  //! notified when a scan ends
+  boost::condition_variable ScanCondition;
+  bool IsScanning = false;
+  //! positions decoded by the last complete scan, null if there is none
+  std::unique_ptr<DecodedPositions> Scanned;
+  std::string ScannedFileName;
+  bool ScannedUseGPGGASentences = false;
+  //! copy of the reader setting, read when a scan starts
+  bool UseGPGGASentences = false;
+
+  //! converts the IMU channels of the packets
+  VelodyneImuDecoder ImuDecoder;
+  //! IMU measurements of the last output, the consumers keep it
+  std::shared_ptr<ImuBuffer> Imu = std::make_shared<ImuBuffer>();
+};
 
 //-----------------------------------------------------------------------------
 int vtkVelodyneHDLPositionReader::vtkInternal::ProcessHDLPacket(
@@ -265,43 +234,12 @@ int vtkVelodyneHDLPositionReader::vtkInternal::ProcessHDLPacket(
     return 0;
   }
 
-  for (int i = 0; i < 14; ++i)
-  {
-    if (data[i] != 0)
-    {
-      std::cerr << "unexpected data in first zeros block\n";
-      return 0;
-    }
-  }
-
-  for (int i = 0; i < 3; ++i)
-  {
-    memcpy(position.gyro + i, data + 14 + i * 8, 2);
-    memcpy(position.temp + i, data + 14 + i * 8 + 2, 2);
-    memcpy(position.accelx + i, data + 14 + i * 8 + 4, 2);
-    memcpy(position.accely + i, data + 14 + i * 8 + 6, 2);
-  }
-
-  for (int i = 0; i < 3; ++i)
+  if (!VelodyneImuDecoder::ReadChannels(data, bytes, position.Imu))
   {
-    // Selector only least significant 12 bits
-    position.gyro[i] &= BIT_12_MASK;
-    position.temp[i] &= BIT_12_MASK;
-    position.accelx[i] &= BIT_12_MASK;
-    position.accely[i] &= BIT_12_MASK;
-
-    // Perform 12 bit twos complement
-    position.gyro[i] =
-      -2048 * ((position.gyro[i] & SIGN_12_MASK) >> 11) + (position.gyro[i] & REMAINDER_12_MASK);
-    position.temp[i] =
-      -2048 * ((position.temp[i] & SIGN_12_MASK) >> 11) + (position.temp[i] & REMAINDER_12_MASK);
-    position.accelx[i] = -2048 * ((position.accelx[i] & SIGN_12_MASK) >> 11) +
-      (position.accelx[i] & REMAINDER_12_MASK);
-    position.accely[i] = -2048 * ((position.accely[i] & SIGN_12_MASK) >> 11) +
-      (position.accely[i] & REMAINDER_12_MASK);
+    std::cerr << "unexpected data in first zeros block\n";
+    return 0;
   }
-
-  memcpy(&position.tohTimestamp, data + 14 + 3 * 8 + 160, 4);
+  position.tohTimestamp = position.Imu.TohTimestamp;
 
   // ethernet payload starts at byte 2A, PPS byte is at F4 inside full ethernet
   // frame, so PPS in payload is at F4 - 2A = 244 - 42 = 202
@@ -344,6 +282,12 @@ vtkVelodyneTransformInterpolator* vtkVelodyneHDLPositionReader::GetInterpolator(
   return this->Internal->Interp.GetPointer();
 }
 
+//-----------------------------------------------------------------------------
+std::shared_ptr<ImuBuffer> vtkVelodyneHDLPositionReader::GetImuBuffer()
+{
+  return this->Internal->Imu;
+}
+
 //-----------------------------------------------------------------------------
 void vtkVelodyneHDLPositionReader::vtkInternal::InterpolateGPS(
   vtkPoints* points, vtkDataArray* gpsTime, vtkDataArray* times, vtkDataArray* headings)
@@ -437,6 +381,10 @@ vtkVelodyneHDLPositionReader::vtkVelodyneHDLPositionReader()
 //-----------------------------------------------------------------------------
 vtkVelodyneHDLPositionReader::~vtkVelodyneHDLPositionReader()
 {
+  if (this->Internal->LidarReader)
+  {
+    this->Internal->LidarReader->SetPacketObserver(nullptr);
+  }
   delete this->Internal;
 }
 
@@ -465,305 +413,416 @@ void vtkVelodyneHDLPositionReader::SetFileName(const std::string& filename)
 
 
 //-----------------------------------------------------------------------------
-int vtkVelodyneHDLPositionReader::RequestData(vtkInformation* vtkNotUsed(request),
-                                              vtkInformationVector** vtkNotUsed(inputVector),
-                                              vtkInformationVector* outputVector)
+void vtkVelodyneHDLPositionReader::vtkInternal::DecodePacket(const unsigned char* data,
+  unsigned int bytes, bool useGPGGASentences, DecodedPositions& decoded)
 {
-  vtkPolyData* output = vtkPolyData::GetData(outputVector);
-
-  if (!this->FileName.length())
+  PositionPacket position;
+  if (!this->ProcessHDLPacket(data, bytes, position))
   {
-    vtkErrorMacro("FileName has not been set.");
-    return 0;
+    return;
   }
 
+  if (!decoded.HasLastLidarUpdateTime)
+  {
+    decoded.HasLastLidarUpdateTime = true;
+    decoded.LastLidarUpdateTime = position.tohTimestamp;
+  }
+  else
+  {
+    if (position.tohTimestamp - decoded.LastLidarUpdateTime < - 1e6 * 0.5 * 3600.0)
+    {
+      // tod wrap detected
+      decoded.LidarTimeOffset += 1e6 * 3600.0;
+    }
+    decoded.LastLidarUpdateTime = position.tohTimestamp;
+  }
+  double convertedLidarUpdateTime = position.tohTimestamp + decoded.LidarTimeOffset;
 
-  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
-  vtkSmartPointer<vtkPolyLine> polyLine = vtkSmartPointer<vtkPolyLine>::New();
-  vtkSmartPointer<vtkIdList> polyIds = polyLine->GetPointIds();
-
-  // Data arrays
-  vtkSmartPointer<vtkDoubleArray> lats = vtkSmartPointer<vtkDoubleArray>::New();
-  lats->SetName("lat");
-  vtkSmartPointer<vtkDoubleArray> lons = vtkSmartPointer<vtkDoubleArray>::New();
-  lons->SetName("lon");
-
-  vtkSmartPointer<vtkDoubleArray> times = vtkSmartPointer<vtkDoubleArray>::New();
-  times->SetName("time");
-
-  vtkSmartPointer<vtkDoubleArray> gpsTime = vtkSmartPointer<vtkDoubleArray>::New();
-  gpsTime->SetName("gpstime");
-
-  typedef std::map<std::string, vtkSmartPointer<vtkDoubleArray> > VecMap;
-  VecMap dataVectors;
-  dataVectors.insert(std::make_pair("gyro1", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("gyro2", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("gyro3", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("temp1", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("temp2", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("temp3", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel1x", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel1y", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel2x", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel2y", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel3x", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("accel3y", vtkSmartPointer<vtkDoubleArray>::New()));
-  dataVectors.insert(std::make_pair("heading", vtkSmartPointer<vtkDoubleArray>::New()));
-  for (VecMap::iterator it = dataVectors.begin(); it != dataVectors.end(); ++it)
-  {
-    it->second->SetName(it->first.c_str());
-  }
-
-  points->Allocate(5000, 5000);
-  cells->Allocate(5000, 5000);
-  lats->Allocate(5000, 5000);
-  lons->Allocate(5000, 5000);
-  gpsTime->Allocate(5000, 5000);
-
-  const unsigned char* data;
-  unsigned int dataLength;
-  double timeSinceStart;
-
-  UTMProjector proj(this->ShouldWarnOnWeirdGPSData);
-
-  this->Open();
-  vtkIdType pointcount = 0;
-
-  bool hasLastGPSUpdateTime = false;
-  double lastGPSUpdateTime = 0.0;
-  double GPSTimeOffset = 0.0;
-  double convertedGPSUpdateTime = 0.0;
-
-  bool hasLastLidarUpdateTime = false;
-  double lastLidarUpdateTime = 0.0;
-  double lidarTimeOffset = 0.0;
+  ImuBuffer::Sample imuSample;
+  this->ImuDecoder.ToSample(position.Imu, 1e-6 * convertedLidarUpdateTime, imuSample);
+  decoded.ImuSamples.push_back(imuSample);
 
-  double previousConvertedGPSUpdateTime = -1.0; // negative means "no previous"
 
-  while (this->Internal->Reader->NextPacket(data, dataLength, timeSinceStart))
+  double x, y, z, lat, lon, heading, gpsUpdateTime;
+  if (std::string(position.sentance).size() == 0)
+  {
+    // If there is no sentence to parse (no gps connected),
+    // we use the following:
+    x = 0.0;
+    y = 0.0;
+    z = 0.0;
+    lat = 0.0;
+    lon = 0.0;
+    heading = 0.0;
+    // the follwing value is wrong (no gps update so no update time),
+    // so it should also be 0.0 (invalid)
+    // but this value is kept to not risk breaking anything:
+    gpsUpdateTime = position.tohTimestamp;
+  }
+  else
   {
-    PositionPacket position;
-    if (!this->Internal->ProcessHDLPacket(data, dataLength, position))
+    NMEAParser parser;
+    NMEALocation parsedNMEA;
+    parsedNMEA.Init();
+    // the sentence is not copied: its words point inside the packet
+    const char* NMEASentence = position.sentance;
+    const void* end = std::memchr(NMEASentence, '\0', sizeof(position.sentance));
+    size_t sentenceSize = end ? static_cast<const char*>(end) - NMEASentence
+                              : sizeof(position.sentance);
+    while (sentenceSize > 0 && std::isspace(static_cast<unsigned char>(NMEASentence[sentenceSize - 1])))
     {
-      continue;
+      --sentenceSize;
     }
-
-    if (!hasLastLidarUpdateTime)
+    NMEAWords NMEAwords;
+    parser.SplitWords(NMEASentence, sentenceSize, NMEAwords);
+    if (!parser.ChecksumValid(NMEASentence, sentenceSize))
     {
-      hasLastLidarUpdateTime = true;
-      lastLidarUpdateTime = position.tohTimestamp;
+      decoded.Warnings.push_back("NMEA sentence: <" + std::string(NMEASentence, sentenceSize) +
+                                 ">has invalid checksum");
+      // TODO: should we skip or should we expect lazy NMEA implementers ?
     }
-    else
+
+    const NMEAParser::SentenceType sentenceType = parser.GetSentenceType(NMEAwords);
+    if ((useGPGGASentences && sentenceType != NMEAParser::GPGGA_SENTENCE)
+        || (!useGPGGASentences && sentenceType != NMEAParser::GPRMC_SENTENCE))
     {
-      if (position.tohTimestamp - lastLidarUpdateTime < - 1e6 * 0.5 * 3600.0)
-      {
-        // tod wrap detected
-        lidarTimeOffset += 1e6 * 3600.0;
-      }
+      return; // not the NMEA sentence we are interested in, skipping
     }
-    double convertedLidarUpdateTime = position.tohTimestamp + lidarTimeOffset;
 
+    if ( !( (sentenceType == NMEAParser::GPGGA_SENTENCE && parser.ParseGPGGA(NMEAwords, parsedNMEA))
+         || (sentenceType == NMEAParser::GPRMC_SENTENCE && parser.ParseGPRMC(NMEAwords, parsedNMEA)) ))
+    {
+      decoded.Warnings.push_back("Failed to parse NMEA sentence: <" +
+                                 std::string(NMEASentence, sentenceSize) + ">");
+      return; // skipping this PositionPacket
+    }
 
-    double x, y, z, lat, lon, heading, gpsUpdateTime;
-    if (std::string(position.sentance).size() == 0)
+    // Gathering information on time synchronization between Lidar & GPS,
+    // see Velodyne doc mentioned at definition of PositionPacket above.
+    // We assume the Lidar will remain synchronized on gps (UTC) time even
+    // if some NMEA packets without fix are received later (tunnel, hill ...).
+    if (!decoded.PPSSynced
+        && position.PPSSync == PPS_LOCKED
+        && parsedNMEA.Valid)
     {
-      // If there is no sentence to parse (no gps connected),
-      // we use the following:
-      x = 0.0;
-      y = 0.0;
-      z = 0.0;
-      lat = 0.0;
-      lon = 0.0;
-      heading = 0.0;
-      // the follwing value is wrong (no gps update so no update time),
-      // so it should also be 0.0 (invalid)
-      // but this value is kept to not risk breaking anything:
-      gpsUpdateTime = position.tohTimestamp;
+      decoded.PPSSynced = true;
     }
-    else
+    decoded.LastPPSState = static_cast<PPSState>(position.PPSSync);
+
+    lat = parsedNMEA.Lat;
+    lon = parsedNMEA.Long;
+    x = lon;
+    y = lat;
+    decoded.GeoPointIds.push_back(decoded.NumberOfPoints);
+    z = 0.0;
+    // If sentence is GPGGA,  we have a chance to get an altitude
+    if (sentenceType == NMEAParser::GPGGA_SENTENCE)
     {
-      NMEAParser parser;
-      NMEALocation parsedNMEA;
-      parsedNMEA.Init();
-      std::string NMEASentence = std::string(position.sentance);
-      boost::trim_right(NMEASentence);
-      std::vector<std::string> NMEAwords = parser.SplitWords(NMEASentence);
-      if (!parser.ChecksumValid(NMEASentence))
-      {
-        vtkGenericWarningMacro("NMEA sentence: "
-                               << "<" << NMEASentence << ">"
-                               << "has invalid checksum");
-        // TODO: should we skip or should we expect lazy NMEA implementers ?
-      }
-
-      if ((this->UseGPGGASentences && !parser.IsGPGGA(NMEAwords))
-          || (!this->UseGPGGASentences && !parser.IsGPRMC(NMEAwords)))
-      {
-        continue; // not the NMEA sentence we are interested in, skipping
-      }
-
-      if ( !( (parser.IsGPGGA(NMEAwords) && parser.ParseGPGGA(NMEAwords, parsedNMEA))
-           || (parser.IsGPRMC(NMEAwords) && parser.ParseGPRMC(NMEAwords, parsedNMEA)) ))
-      {
-        vtkGenericWarningMacro("Failed to parse NMEA sentence: "
-                               << "<" << NMEASentence << ">");
-        continue; // skipping this PositionPacket
-      }
-
-      // Gathering information on time synchronization between Lidar & GPS,
-      // see Velodyne doc mentioned at definition of PositionPacket above.
-      // We assume the Lidar will remain synchronized on gps (UTC) time even
-      // if some NMEA packets without fix are received later (tunnel, hill ...).
-      if (!this->PPSSynced
-          && position.PPSSync == PPSState::PPS_LOCKED
-          && parsedNMEA.Valid)
+      if (parsedNMEA.HasAltitude)
       {
-        this->PPSSynced = true;
-      }
-      this->LastPPSState = static_cast<PPSState>(position.PPSSync);
-
-      lat = parsedNMEA.Lat;
-      lon = parsedNMEA.Long;
-      x = 0.0;
-      y = 0.0;
-      proj.Project(lat, lon, x, y);
-      z = 0.0;
-      // If sentence is GPGGA,  we have a chance to get an altitude
-      if (parser.IsGPGGA(NMEAwords))
-      {
-        if (parsedNMEA.HasAltitude)
+        if (parsedNMEA.HasGeoidalSeparation)
         {
-          if (parsedNMEA.HasGeoidalSeparation)
-          {
-            // setting z to Height above ellipsoid
-            // (coherent with setting 'datum=WGS84' in proj4)
-            z = parsedNMEA.Altitude + parsedNMEA.GeoidalSeparation;
-          }
-          else
-          {
-            // Two possibilities: either Altitude is actually height above
-            // ellipsoid, or it is effectively height above local MSL.
-            // In this case we could need something better than this
-            // (such as a look up table for geoid separation like GeographicLib)
-            z = parsedNMEA.Altitude;
-          }
+          // setting z to Height above ellipsoid
+          // (coherent with setting 'datum=WGS84' in proj4)
+          z = parsedNMEA.Altitude + parsedNMEA.GeoidalSeparation;
         }
         else
         {
-          z = 0.0;
+          // Two possibilities: either Altitude is actually height above
+          // ellipsoid, or it is effectively height above local MSL.
+          // In this case we could need something better than this
+          // (such as a look up table for geoid separation like GeographicLib)
+          z = parsedNMEA.Altitude;
         }
       }
-
-      if (parsedNMEA.HasTrackAngle)
-      {
-        heading = parsedNMEA.TrackAngle;
-      }
       else
       {
-	heading = 0.0;
+        z = 0.0;
       }
+    }
 
-      gpsUpdateTime = parsedNMEA.UTCSecondsOfDay;
-      if (!hasLastGPSUpdateTime)
-      {
-        hasLastGPSUpdateTime = true;
-        lastGPSUpdateTime = gpsUpdateTime;
-      }
-      else
-      {
-        if (gpsUpdateTime - lastGPSUpdateTime < - 12.0 * 3600.0)
-        {
-          // tod wrap detected
-          GPSTimeOffset += 24.0 * 3600.0;
-        }
-      }
+    if (parsedNMEA.HasTrackAngle)
+    {
+      heading = parsedNMEA.TrackAngle;
+    }
+    else
+    {
+      heading = 0.0;
+    }
 
-      convertedGPSUpdateTime = gpsUpdateTime + GPSTimeOffset;
-      if (previousConvertedGPSUpdateTime < 0.0)
+    gpsUpdateTime = parsedNMEA.UTCSecondsOfDay;
+    if (!decoded.HasLastGPSUpdateTime)
+    {
+      decoded.HasLastGPSUpdateTime = true;
+      decoded.LastGPSUpdateTime = gpsUpdateTime;
+    }
+    else
+    {
+      if (gpsUpdateTime - decoded.LastGPSUpdateTime < - 12.0 * 3600.0)
       {
-        previousConvertedGPSUpdateTime = convertedGPSUpdateTime;
+        // tod wrap detected
+        decoded.GPSTimeOffset += 24.0 * 3600.0;
       }
+    }
 
-      if (convertedGPSUpdateTime > previousConvertedGPSUpdateTime
-          && parsedNMEA.Valid)
-      {
-        // We have detected that this position packet is the first one since
-        // last gps fix (there are more position packets than there are fixes)
-        // and that the new NMEA sentence refers to a valid fix,
-        // so we can do an estimation of the timeshift.
-        this->HasTimeshiftEstimation = true;
-        // To understand this formula, think that we want to add this timeshift
-        // to a lidar time to get a gps time, and that the "lidar instant" that
-        // corresponds to the new fix is earlier than convertedLidarUpdateTime,
-        // because of the time it took the information to go from GPS to Lidar.
-        // Possible improvement: store the different estimations
-        // (one per new fix) and return the median.
-        this->TimeshiftMeasurements.push_back(
-            convertedGPSUpdateTime -
-            (1e-6 * convertedLidarUpdateTime - this->AssumedHardwareLag));
-      }
-      previousConvertedGPSUpdateTime = convertedGPSUpdateTime;
+    decoded.ConvertedGPSUpdateTime = gpsUpdateTime + decoded.GPSTimeOffset;
+    if (decoded.PreviousConvertedGPSUpdateTime < 0.0)
+    {
+      decoded.PreviousConvertedGPSUpdateTime = decoded.ConvertedGPSUpdateTime;
     }
 
-    if (pointcount == 0)
+    if (decoded.ConvertedGPSUpdateTime > decoded.PreviousConvertedGPSUpdateTime
+        && parsedNMEA.Valid)
     {
-      this->Internal->Offset[0] = x;
-      this->Internal->Offset[1] = y;
+      // We have detected that this position packet is the first one since
+      // last gps fix (there are more position packets than there are fixes)
+      // and that the new NMEA sentence refers to a valid fix,
+      // so we can do an estimation of the timeshift.
+      decoded.HasTimeshiftEstimation = true;
+      // To understand this formula, think that we want to add this timeshift
+      // to a lidar time to get a gps time, and that the "lidar instant" that
+      // corresponds to the new fix is earlier than convertedLidarUpdateTime,
+      // because of the time it took the information to go from GPS to Lidar.
+      // Possible improvement: store the different estimations
+      // (one per new fix) and return the median.
+      decoded.TimeshiftMeasurements.push_back(
+          decoded.ConvertedGPSUpdateTime - 1e-6 * convertedLidarUpdateTime);
     }
+    decoded.PreviousConvertedGPSUpdateTime = decoded.ConvertedGPSUpdateTime;
+  }
+
+  decoded.Positions.push_back(x);
+  decoded.Positions.push_back(y);
+  decoded.Positions.push_back(z);
+  decoded.Lats->InsertNextValue(lat);
+  decoded.Lons->InsertNextValue(lon);
+  decoded.GPSTimes->InsertNextValue(decoded.ConvertedGPSUpdateTime);
+
+  decoded.Times->InsertNextValue(convertedLidarUpdateTime);
+
+  const VelodyneImuDecoder::Channels& imu = position.Imu;
+  decoded.DataVectors["gyro1"]->InsertNextValue(imu.Gyro[0] * VelodyneImuDecoder::GyroScale);
+  decoded.DataVectors["gyro2"]->InsertNextValue(imu.Gyro[1] * VelodyneImuDecoder::GyroScale);
+  decoded.DataVectors["gyro3"]->InsertNextValue(imu.Gyro[2] * VelodyneImuDecoder::GyroScale);
+  decoded.DataVectors["temp1"]->InsertNextValue(
+    imu.Temperature[0] * VelodyneImuDecoder::TemperatureScale + VelodyneImuDecoder::TemperatureOffset);
+  decoded.DataVectors["temp2"]->InsertNextValue(
+    imu.Temperature[1] * VelodyneImuDecoder::TemperatureScale + VelodyneImuDecoder::TemperatureOffset);
+  decoded.DataVectors["temp3"]->InsertNextValue(
+    imu.Temperature[2] * VelodyneImuDecoder::TemperatureScale + VelodyneImuDecoder::TemperatureOffset);
+  decoded.DataVectors["accel1x"]->InsertNextValue(imu.AccelX[0] * VelodyneImuDecoder::AccelScale);
+  decoded.DataVectors["accel2x"]->InsertNextValue(imu.AccelX[1] * VelodyneImuDecoder::AccelScale);
+  decoded.DataVectors["accel3x"]->InsertNextValue(imu.AccelX[2] * VelodyneImuDecoder::AccelScale);
+  decoded.DataVectors["accel1y"]->InsertNextValue(imu.AccelY[0] * VelodyneImuDecoder::AccelScale);
+  decoded.DataVectors["accel2y"]->InsertNextValue(imu.AccelY[1] * VelodyneImuDecoder::AccelScale);
+  decoded.DataVectors["accel3y"]->InsertNextValue(imu.AccelY[2] * VelodyneImuDecoder::AccelScale);
+  decoded.DataVectors["heading"]->InsertNextValue(heading);
+
+  decoded.NumberOfPoints++;
+}
 
-    x -= this->Internal->Offset[0];
-    y -= this->Internal->Offset[1];
-
-    points->InsertNextPoint(x, y, z);
-    lats->InsertNextValue(lat);
-    lons->InsertNextValue(lon);
-    gpsTime->InsertNextValue(convertedGPSUpdateTime);
-    polyIds->InsertNextId(pointcount);
-
-    times->InsertNextValue(convertedLidarUpdateTime);
-
-    dataVectors["gyro1"]->InsertNextValue(position.gyro[0] * GYRO_SCALE);
-    dataVectors["gyro2"]->InsertNextValue(position.gyro[1] * GYRO_SCALE);
-    dataVectors["gyro3"]->InsertNextValue(position.gyro[2] * GYRO_SCALE);
-    dataVectors["temp1"]->InsertNextValue(position.temp[0] * TEMP_SCALE + TEMP_OFFSET);
-    dataVectors["temp2"]->InsertNextValue(position.temp[1] * TEMP_SCALE + TEMP_OFFSET);
-    dataVectors["temp3"]->InsertNextValue(position.temp[2] * TEMP_SCALE + TEMP_OFFSET);
-    dataVectors["accel1x"]->InsertNextValue(position.accelx[0] * ACCEL_SCALE);
-    dataVectors["accel2x"]->InsertNextValue(position.accelx[1] * ACCEL_SCALE);
-    dataVectors["accel3x"]->InsertNextValue(position.accelx[2] * ACCEL_SCALE);
-    dataVectors["accel1y"]->InsertNextValue(position.accely[0] * ACCEL_SCALE);
-    dataVectors["accel2y"]->InsertNextValue(position.accely[1] * ACCEL_SCALE);
-    dataVectors["accel3y"]->InsertNextValue(position.accely[2] * ACCEL_SCALE);
-    dataVectors["heading"]->InsertNextValue(heading);
-
-    pointcount++;
+//-----------------------------------------------------------------------------
+void vtkVelodyneHDLPositionReader::vtkInternal::StartPackets(const std::string& fileName)
+{
+  boost::lock_guard<boost::mutex> lock(this->ScanMutex);
+  this->Scanned.reset(new DecodedPositions);
+  this->ScannedFileName = fileName;
+  this->ScannedUseGPGGASentences = this->UseGPGGASentences;
+  this->IsScanning = true;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodyneHDLPositionReader::vtkInternal::ProcessPacket(const unsigned char* data,
+  unsigned int dataLength, double vtkNotUsed(timeSinceStart))
+{
+  // the decoded positions are only used by the scanning thread until EndPackets
+  if (this->Scanned)
+  {
+    this->DecodePacket(data, dataLength, this->ScannedUseGPGGASentences, *this->Scanned);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodyneHDLPositionReader::vtkInternal::EndPackets(bool complete)
+{
+  boost::lock_guard<boost::mutex> lock(this->ScanMutex);
+  if (!complete)
+  {
+    this->Scanned.reset();
+  }
+  this->IsScanning = false;
+  this->ScanCondition.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodyneHDLPositionReader::SetLidarReader(vtkLidarReader* reader)
+{
+  if (reader == this->Internal->LidarReader.GetPointer())
+  {
+    return;
+  }
+
+  // once removed, the previous reader does not call the observer anymore
+  if (this->Internal->LidarReader)
+  {
+    this->Internal->LidarReader->SetPacketObserver(nullptr);
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->ScanMutex);
+    this->Internal->Scanned.reset();
+    this->Internal->IsScanning = false;
+    this->Internal->ScanCondition.notify_all();
+  }
+  this->Internal->LidarReader = reader;
+  if (reader)
+  {
+    reader->SetPacketObserver(this->Internal);
+  }
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkVelodyneHDLPositionReader::RequestData(vtkInformation* vtkNotUsed(request),
+                                              vtkInformationVector** vtkNotUsed(inputVector),
+                                              vtkInformationVector* outputVector)
+{
+  VV_TRACE_SCOPE("vtkVelodyneHDLPositionReader::RequestData");
+  vtkPolyData* output = vtkPolyData::GetData(outputVector);
+
+  if (!this->FileName.length())
+  {
+    vtkErrorMacro("FileName has not been set.");
+    return 0;
+  }
+
+  // use the packets decoded while the lidar reader indexed the same file, the scan may still
+  // be running in its background thread
+  {
+    boost::unique_lock<boost::mutex> lock(this->Internal->ScanMutex);
+    while (this->Internal->IsScanning)
+    {
+      this->Internal->ScanCondition.wait(lock);
+    }
+    if (this->Internal->Scanned && this->Internal->ScannedFileName == this->FileName &&
+      this->Internal->ScannedUseGPGGASentences == this->UseGPGGASentences)
+    {
+      this->BuildOutput(*this->Internal->Scanned, output);
+      return 1;
+    }
+  }
+
+  const unsigned char* data;
+  unsigned int dataLength;
+  double timeSinceStart;
+
+  this->Open();
+  DecodedPositions decoded;
+  while (this->Internal->Reader && this->Internal->Reader->NextPacket(data, dataLength, timeSinceStart))
+  {
+    this->Internal->DecodePacket(data, dataLength, this->UseGPGGASentences, decoded);
   }
   this->Close();
 
+  this->BuildOutput(decoded, output);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodyneHDLPositionReader::BuildOutput(const DecodedPositions& decoded, vtkPolyData* output)
+{
+  for (const std::string& warning : decoded.Warnings)
+  {
+    vtkGenericWarningMacro(<< warning);
+  }
+  this->PPSSynced = decoded.PPSSynced;
+  this->LastPPSState = decoded.LastPPSState;
+  this->HasTimeshiftEstimation = decoded.HasTimeshiftEstimation;
+  this->TimeshiftMeasurements.clear();
+  for (double measurement : decoded.TimeshiftMeasurements)
+  {
+    this->TimeshiftMeasurements.push_back(measurement + this->AssumedHardwareLag);
+  }
+
+  this->Internal->Imu->Clear();
+  this->Internal->Imu->Add(decoded.ImuSamples);
+
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  vtkSmartPointer<vtkPolyLine> polyLine = vtkSmartPointer<vtkPolyLine>::New();
+  vtkSmartPointer<vtkIdList> polyIds = polyLine->GetPointIds();
+  const vtkIdType pointcount = decoded.NumberOfPoints;
+  points->Allocate(pointcount);
+  polyIds->SetNumberOfIds(pointcount);
+  for (vtkIdType i = 0; i < pointcount; ++i)
+  {
+    polyIds->SetId(i, i);
+  }
+
+  // the positions with a sentence hold their longitude and latitude until they are projected
+  std::vector<double> positions = decoded.Positions;
+  const std::vector<vtkIdType>& geoPointIds = decoded.GeoPointIds;
+  if (!geoPointIds.empty())
+  {
+    // the UTM zone is the one of the first position
+    const double firstLon = positions[3 * geoPointIds[0] + 0];
+    const double firstLat = positions[3 * geoPointIds[0] + 1];
+    GeoProjection projection(GeoProjection::LatLongDefinition(),
+      GeoProjection::UTMDefinition(GeoProjection::UTMZone(firstLat, firstLon), firstLat < 0));
+
+    std::vector<double> geoPositions(3 * geoPointIds.size(), 0.0);
+    for (size_t i = 0; i < geoPointIds.size(); ++i)
+    {
+      geoPositions[3 * i + 0] = positions[3 * geoPointIds[i] + 0];
+      geoPositions[3 * i + 1] = positions[3 * geoPointIds[i] + 1];
+    }
+    if (!projection.Transform(&geoPositions[0], geoPointIds.size()) &&
+      this->ShouldWarnOnWeirdGPSData)
+    {
+      vtkGenericWarningMacro("Error : WGS84 projection failed, this will create a GPS error. "
+                             "Please check the latitude and longitude inputs");
+    }
+    for (size_t i = 0; i < geoPointIds.size(); ++i)
+    {
+      positions[3 * geoPointIds[i] + 0] = geoPositions[3 * i + 0];
+      positions[3 * geoPointIds[i] + 1] = geoPositions[3 * i + 1];
+    }
+  }
+
+  if (pointcount > 0)
+  {
+    this->Internal->Offset[0] = positions[0];
+    this->Internal->Offset[1] = positions[1];
+  }
+  for (vtkIdType i = 0; i < pointcount; ++i)
+  {
+    points->InsertNextPoint(positions[3 * i + 0] - this->Internal->Offset[0],
+      positions[3 * i + 1] - this->Internal->Offset[1], positions[3 * i + 2]);
+  }
+
   cells->InsertNextCell(polyLine);
 
   // Optionally interpolate the GPS values... note that we assume that the
   // first GPS point is not 0,0 if we have valid GPS data; otherwise we assume
   // that the GPS data is garbage and ignore it
+  vtkDoubleArray* lats = decoded.Lats;
+  vtkDoubleArray* lons = decoded.Lons;
   if (lats->GetNumberOfTuples() && lons->GetNumberOfTuples() &&
     (lats->GetValue(0) != 0.0 || lons->GetValue(0) != 0.0))
   {
-    this->Internal->InterpolateGPS(points, gpsTime, times, dataVectors["heading"]);
+    this->Internal->InterpolateGPS(
+      points, decoded.GPSTimes, decoded.Times, decoded.DataVectors.at("heading"));
   }
 
   output->SetPoints(points);
   output->SetLines(cells);
   output->GetPointData()->AddArray(lats);
   output->GetPointData()->AddArray(lons);
-  output->GetPointData()->AddArray(gpsTime);
-  output->GetPointData()->AddArray(times);
-  for (VecMap::iterator it = dataVectors.begin(); it != dataVectors.end(); ++it)
+  output->GetPointData()->AddArray(decoded.GPSTimes);
+  output->GetPointData()->AddArray(decoded.Times);
+  for (const auto& dataVector : decoded.DataVectors)
   {
-    output->GetPointData()->AddArray(it->second);
+    output->GetPointData()->AddArray(dataVector.second);
   }
-
-  return 1;
 }
 
 //-----------------------------------------------------------------------------
@@ -784,6 +843,8 @@ void vtkVelodyneHDLPositionReader::PrintSelf(ostream& os, vtkIndent indent)
 void vtkVelodyneHDLPositionReader::SetUseGPGGASentences(bool useGPGGASentences)
 {
   this->UseGPGGASentences = useGPGGASentences;
+  boost::lock_guard<boost::mutex> lock(this->Internal->ScanMutex);
+  this->Internal->UseGPGGASentences = useGPGGASentences;
 }
 
 //-----------------------------------------------------------------------------
@@ -32,10 +32,13 @@
 #ifndef _vtkVelodyneHDLPositionReader_h
 #define _vtkVelodyneHDLPositionReader_h
 
+#include <memory>
 #include <string>
 #include <vtkPolyDataAlgorithm.h>
 #include <vtkSmartPointer.h>
 
+class ImuBuffer;
+class vtkLidarReader;
 class vtkTransform;
 class vtkVelodyneTransformInterpolator;
 
@@ -66,6 +69,20 @@ public:
 
   vtkVelodyneTransformInterpolator* GetInterpolator();
 
+#ifndef __VTK_WRAP__
+  // Description:
+  // IMU measurements of all the position packets, filled when the output is built. The
+  // buffer stays the same object for the life of the reader, so that a consumer such as
+  // vtkSlam::SetImuBuffer can keep it.
+  std::shared_ptr<ImuBuffer> GetImuBuffer();
+#endif
+
+  // Description:
+  // Decode the position packets while the lidar reader reads the same file to build its
+  // frame index, instead of reading the whole file again. The reader must be set before
+  // the frame index is built, otherwise the file is read by RequestData as usual.
+  void SetLidarReader(vtkLidarReader* reader);
+
   // field names starts with PPS_ because accessed from python wrapping which
   // does not scope using the name of the enum
   // Warning: PPS_LOCKED does not mean that Lidar is synchronized with GPS:
@@ -89,6 +106,10 @@ protected:
   void Open();
   void Close();
 
+  struct DecodedPositions;
+  // Project the decoded positions and fill the output
+  void BuildOutput(const DecodedPositions& decoded, vtkPolyData* output);
+
   std::string FileName;
 
   class vtkInternal;
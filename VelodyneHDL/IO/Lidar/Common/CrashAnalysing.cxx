@@ -17,8 +17,17 @@
 
 // LOCAL
 #include "CrashAnalysing.h"
+#include "PacketBuffer.h"
+#include "vtkPacketFileWriter.h"
+
+// BOOST
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/file_mapping.hpp>
 
 // STD
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <ctime>
 #include <fstream>
 #include <sstream>
@@ -27,78 +36,196 @@
 // VTK
 #include <vtkInformation.h>
 
+namespace
+{
+const char RingMagic[8] = { 'V', 'V', 'C', 'R', 'A', 'S', 'H', '1' };
+
+//! Beginning of the ring file
+struct RingHeader
+{
+  char Magic[8];
+  boost::uint32_t SlotSize;
+  boost::uint32_t NumberOfSlots;
+  //! Number of packets added since the ring has been created, the newest one is in the slot
+  //! (NumberOfPackets - 1) % NumberOfSlots
+  boost::uint64_t NumberOfPackets;
+};
+
+//! Beginning of each slot, followed by the packet data
+struct SlotHeader
+{
+  //! 0 while the packet is copied, so that a slot written during a crash is ignored
+  boost::uint32_t Length;
+  boost::uint32_t Second;
+  boost::uint32_t Microsecond;
+  boost::uint32_t Reserved;
+};
+
+//! Larger packets are truncated, rounded so that the slots stay aligned
+const size_t SlotSize = (sizeof(SlotHeader) + PacketBuffer::Capacity + 63) / 64 * 64;
+const size_t SlotCapacity = SlotSize - sizeof(SlotHeader);
+const size_t HeaderSize = 64;
+
 //-----------------------------------------------------------------------------
-void CrashAnalysisWriter::AddPacket(const std::string& packet)
+size_t GetSlotOffset(size_t index)
 {
-  // The idea is to store 2 .pcap files. One corresponding
-  // to the last N packets received and one corresponding to
-  // the N older ones. Switching from one file to the other
-  // insure that we always have at least the N last packets
-  // (except for the very beginning).
-  // When switching to file 0 or 1, the existing content of the
-  // file is discarded resulting in a storage of a number of packets
-  // between N and 2*N
-  if (this->PacketCount % this->NbrPacketsToStore == 0)
-  {
-    // Close the writer if it is already opened
-    if (this->Writer.IsOpen())
-    {
-      this->Writer.Close();
-    }
+  return HeaderSize + index * SlotSize;
+}
+}
+
+//-----------------------------------------------------------------------------
+CrashAnalysisWriter::~CrashAnalysisWriter()
+{
+  this->CloseAnalyzer();
+}
 
-    // Switch the filename and open the writer
-    this->FileToStore++;
-    unsigned int nbrFile = this->FileToStore % 2; // file name: 0 or 1
-    std::stringstream ss;
-    ss << this->Filename << nbrFile << ".bin";
-    if (!this->Writer.Open(ss.str()))
+//-----------------------------------------------------------------------------
+bool CrashAnalysisWriter::OpenRing()
+{
+  const size_t numberOfSlots = std::max(this->NbrPacketsToStore, 1u);
+  const size_t fileSize = HeaderSize + numberOfSlots * SlotSize;
+  try
+  {
     {
-      vtkGenericWarningMacro("Crash analysis failed to open the log file.");
-      return;
+      // the file must have its final size before being mapped
+      std::filebuf file;
+      if (!file.open(this->GetRingFilename().c_str(),
+            std::ios_base::in | std::ios_base::out | std::ios_base::trunc | std::ios_base::binary))
+      {
+        return false;
+      }
+      file.pubseekoff(fileSize - 1, std::ios_base::beg);
+      file.sputc(0);
     }
+    boost::interprocess::file_mapping mapping(
+      this->GetRingFilename().c_str(), boost::interprocess::read_write);
+    this->Region.reset(new boost::interprocess::mapped_region(
+      mapping, boost::interprocess::read_write, 0, fileSize));
+  }
+  catch (const boost::interprocess::interprocess_exception&)
+  {
+    this->Region.reset();
+    return false;
   }
 
-  this->WriteLastPacket(packet);
-  this->PacketCount++;
+  RingHeader* header = static_cast<RingHeader*>(this->Region->get_address());
+  std::memset(header, 0, HeaderSize);
+  header->SlotSize = static_cast<boost::uint32_t>(SlotSize);
+  header->NumberOfSlots = static_cast<boost::uint32_t>(numberOfSlots);
+  // written last, a ring without it is ignored
+  std::memcpy(header->Magic, RingMagic, sizeof(RingMagic));
+  return true;
 }
 
 //-----------------------------------------------------------------------------
-void CrashAnalysisWriter::WriteLastPacket(const std::string& packet)
+void CrashAnalysisWriter::AddPacket(const unsigned char* data, size_t size)
 {
-  // check that the writer is opened
-  if (!this->Writer.IsOpen())
+  if (!this->Region)
   {
-    vtkGenericWarningMacro("Crash analysis couldn't save last packet received since the writer is not opened");
-    return;
+    if (this->OpenFailed)
+    {
+      return;
+    }
+    if (!this->OpenRing())
+    {
+      vtkGenericWarningMacro("Crash analysis failed to open the log file.");
+      this->OpenFailed = true;
+      return;
+    }
   }
 
-  this->Writer.WritePacket(
-          reinterpret_cast<const unsigned char*>(packet.c_str()), packet.length());
+  unsigned char* ring = static_cast<unsigned char*>(this->Region->get_address());
+  RingHeader* header = reinterpret_cast<RingHeader*>(ring);
+  unsigned char* slot = ring + GetSlotOffset(header->NumberOfPackets % header->NumberOfSlots);
+  SlotHeader* slotHeader = reinterpret_cast<SlotHeader*>(slot);
+
+  // the pages of the file are updated in memory, the kernel writes them to the disk
+  slotHeader->Length = 0;
+  const size_t length = std::min(size, SlotCapacity);
+  std::memcpy(slot + sizeof(SlotHeader), data, length);
+  const std::chrono::microseconds now = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now().time_since_epoch());
+  slotHeader->Second = static_cast<boost::uint32_t>(now.count() / 1000000);
+  slotHeader->Microsecond = static_cast<boost::uint32_t>(now.count() % 1000000);
+  slotHeader->Length = static_cast<boost::uint32_t>(length);
+  header->NumberOfPackets++;
 }
 
 //-----------------------------------------------------------------------------
 void CrashAnalysisWriter::CloseAnalyzer()
 {
-  if (this->Writer.IsOpen())
-  {
-    this->Writer.Close();
-    return;
-  }
+  this->Region.reset();
+  this->OpenFailed = false;
 }
 
 //-----------------------------------------------------------------------------
 void CrashAnalysisWriter::DeleteLogFiles()
 {
-  std::remove((this->Filename + "0.bin").c_str());
-  std::remove((this->Filename + "1.bin").c_str());
+  std::remove(this->GetRingFilename().c_str());
 }
 
 //-----------------------------------------------------------------------------
-void CrashAnalysisWriter::ArchivePreviousLogIfExist()
+bool CrashAnalysisWriter::DumpRing(const std::string& ringFilename, const std::string& pcapFilename)
+{
+  try
+  {
+    boost::interprocess::file_mapping mapping(ringFilename.c_str(), boost::interprocess::read_only);
+    boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+    const unsigned char* ring = static_cast<const unsigned char*>(region.get_address());
+    if (region.get_size() < HeaderSize)
+    {
+      return false;
+    }
+    const RingHeader* header = reinterpret_cast<const RingHeader*>(ring);
+    if (std::memcmp(header->Magic, RingMagic, sizeof(RingMagic)) != 0 ||
+      header->SlotSize != SlotSize || header->NumberOfSlots == 0 ||
+      region.get_size() < HeaderSize + header->NumberOfSlots * SlotSize)
+    {
+      return false;
+    }
+
+    vtkPacketFileWriter writer;
+    // the packets are written by large chunks
+    writer.SetBufferSize(1 << 20);
+    if (!writer.Open(pcapFilename))
+    {
+      return false;
+    }
+    const boost::uint64_t last = header->NumberOfPackets;
+    const boost::uint64_t first = last > header->NumberOfSlots ? last - header->NumberOfSlots : 0;
+    for (boost::uint64_t i = first; i < last; ++i)
+    {
+      const unsigned char* slot =
+        ring + GetSlotOffset(static_cast<size_t>(i % header->NumberOfSlots));
+      const SlotHeader* slotHeader = reinterpret_cast<const SlotHeader*>(slot);
+      if (slotHeader->Length == 0 || slotHeader->Length > SlotCapacity)
+      {
+        continue;
+      }
+      timeval time;
+      time.tv_sec = slotHeader->Second;
+      time.tv_usec = slotHeader->Microsecond;
+      writer.WritePacket(slot + sizeof(SlotHeader), slotHeader->Length, time);
+    }
+    writer.Close();
+  }
+  catch (const boost::interprocess::interprocess_exception&)
+  {
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string CrashAnalysisWriter::ArchivePreviousLogIfExist()
 {
   // check if the file exists
-  std::ifstream file1((this->Filename + "0.bin").c_str());
-  std::ifstream file2((this->Filename + "1.bin").c_str());
+  std::ifstream file(this->GetRingFilename().c_str());
+  if (!file.good())
+  {
+    return "";
+  }
+  file.close();
 
   // Get the date and time
   std::time_t rawtime;
@@ -109,25 +236,18 @@ void CrashAnalysisWriter::ArchivePreviousLogIfExist()
   std::strftime(buffer, sizeof(buffer), "%d_%m_%Y_%H_%M_%S", timeinfo);
   std::string timeStr(buffer);
 
-  bool fileHasBeenRenamed = false;
-  // The file exists, rename it
-  if (file1.good())
-  {
-    file1.close();
-    std::rename((this->Filename + "0.bin").c_str(), (this->Filename + timeStr + "_0.bin").c_str());
-    fileHasBeenRenamed = true;
-  }
-  if (file2.good())
+  // The file exists, convert it
+  const std::string archiveName = this->Filename + timeStr + ".pcap";
+  if (!DumpRing(this->GetRingFilename(), archiveName))
   {
-    file2.close();
-    std::rename((this->Filename + "1.bin").c_str(), (this->Filename + timeStr + "_1.bin").c_str());
-    fileHasBeenRenamed = true;
+    vtkGenericWarningMacro("We found the log file: " << this->GetRingFilename()
+                           << " which may be due to " << SOFTWARE_NAME << " previous crash, "
+                           << "but it could not be converted.");
+    return "";
   }
-
-  if (fileHasBeenRenamed)
-  {
-    vtkGenericWarningMacro("We found log files in folder: " << this->Filename
-                           << " which may be due to " << SOFTWARE_NAME << " previous crash. "
-                           << "The log files have been renamed using timestamp: " << timeStr);
-  }
-}
\ No newline at end of file
+  this->DeleteLogFiles();
+  vtkGenericWarningMacro("We found log files in folder: " << this->Filename
+                         << " which may be due to " << SOFTWARE_NAME << " previous crash. "
+                         << "The last packets received have been saved in: " << archiveName);
+  return archiveName;
+}
@@ -18,33 +18,39 @@
 #ifndef CRASH_ANALYSING_H
 #define CRASH_ANALYSING_H
 
-// LOCAL
-#include "vtkPacketFileWriter.h"
+// BOOST
+#include <boost/interprocess/mapped_region.hpp>
 
 // STD
+#include <memory>
 #include <string>
 
 /**
  * \class CrashAnalysisWriter
- * \brief This class is responsible to save as a .pcap file
- *        the last N packets received and remove the older ones.
- *        The idea is to generate a small .pcap to analyze when
- *        the software crashes in streaming mode
+ * \brief This class is responsible to keep the last N packets received
+ *        and remove the older ones, so that a small .pcap can be
+ *        analyzed when the software crashes in streaming mode.
+ *        The packets are copied in a ring of fixed size slots mapped
+ *        on a file: adding a packet is a memory copy and the kernel
+ *        writes the file, even if the process crashes or is killed.
+ *        The ring is converted to a .pcap when the next stream starts.
 */
 class CrashAnalysisWriter
 {
 public:
   // Default constructor
-  CrashAnalysisWriter() {this->PacketCount = 0;}
+  CrashAnalysisWriter() = default;
+  ~CrashAnalysisWriter();
 
-  // Setters
+  // Setters, to call before the first packet is added
   void SetNbrPacketsToStore(unsigned int arg) {this->NbrPacketsToStore = arg;}
   void SetFilename(const std::string& arg) {this->Filename = arg;}
 
-  // Add a packet to the crash analyzer
-  void AddPacket(const std::string& packet);
+  // Add a packet to the crash analyzer, overwriting the oldest one
+  // once the ring is full
+  void AddPacket(const unsigned char* data, size_t size);
 
-  // Close the pcap writer if it is opened
+  // Unmap the ring if it is mapped
   void CloseAnalyzer();
 
   // Delete the logs files
@@ -53,22 +59,26 @@ public:
   // If a previous log exists it means that the
   // stream has been quit unproperly and has potentialy
   // crashed. We will archieve the previous log in this
-  // case
-  void ArchivePreviousLogIfExist();
+  // case. Return the name of the archive, empty if there
+  // was no previous log
+  std::string ArchivePreviousLogIfExist();
+
+  // Write the packets of a ring file to a .pcap file, from the oldest to the newest
+  static bool DumpRing(const std::string& ringFilename, const std::string& pcapFilename);
 
 private:
+  // Create the ring file and map it
+  bool OpenRing();
+
+  std::string GetRingFilename() { return this->Filename + "Ring.bin"; }
+
   // Export file information
   unsigned int NbrPacketsToStore = 5000;
   std::string Filename = "";
 
-  // Writer
-  vtkPacketFileWriter Writer;
-
-  // Internal parameters
-  unsigned int PacketCount = 0;
-  unsigned int FileToStore = 0;
-
-  void WriteLastPacket(const std::string& packet);
+  // Mapping of the ring file, null until the first packet
+  std::unique_ptr<boost::interprocess::mapped_region> Region;
+  bool OpenFailed = false;
 };
 
-#endif // CRASH_ANALYSING_H
\ No newline at end of file
+#endif // CRASH_ANALYSING_H
@@ -0,0 +1,538 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "DecodedFrameFile.h"
+#include "FrameIndexFile.h"
+#include "LidarDecodingKernels.h"
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkFieldData.h>
+#include <vtkInformation.h>
+#include <vtkInformationObjectBaseKey.h>
+#include <vtkNew.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+
+// BOOST
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+// STD
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace
+{
+const char FileMagic[8] = { 'V', 'V', 'F', 'R', 'A', 'M', 'E', 'S' };
+const char FooterMagic[8] = { 'V', 'V', 'F', 'R', 'E', 'N', 'D', '\0' };
+
+//! The columns are aligned for their largest type, a double or a vtkIdType
+const boost::uint64_t Alignment = 8;
+
+// The file is the header, the key, the frames, the table of the frame offsets and
+// the footer. A frame is its header, the points array, its point data arrays and
+// its field data arrays. An array is its header, its name and its values. The key,
+// the names and the values are padded to the alignment.
+struct FileHeader
+{
+  char Magic[8];
+  boost::uint32_t Version;
+  boost::uint32_t KeyLength;
+  boost::uint64_t PcapSize;
+  boost::int64_t PcapTime;
+};
+
+struct FrameHeader
+{
+  boost::uint64_t NumberOfPoints;
+  //! the vertices are recreated, one per point, as done by the interpreters
+  boost::uint64_t NumberOfVerts;
+  boost::uint32_t NumberOfPointArrays;
+  boost::uint32_t NumberOfFieldArrays;
+};
+
+struct ArrayHeader
+{
+  boost::int32_t DataType;
+  boost::int32_t NumberOfComponents;
+  boost::uint64_t NumberOfTuples;
+  boost::uint32_t NameLength;
+  boost::uint32_t Reserved;
+};
+
+struct FileFooter
+{
+  boost::uint64_t NumberOfFrames;
+  boost::uint64_t FrameTableOffset;
+  char Magic[8];
+};
+
+//-----------------------------------------------------------------------------
+boost::uint64_t Align(boost::uint64_t position)
+{
+  return (position + Alignment - 1) / Alignment * Alignment;
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void WriteValue(std::ofstream& stream, const T& value)
+{
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+void WritePadding(std::ofstream& stream)
+{
+  const char zeros[Alignment] = { 0 };
+  const boost::uint64_t position = static_cast<boost::uint64_t>(stream.tellp());
+  stream.write(zeros, Align(position) - position);
+}
+
+//-----------------------------------------------------------------------------
+// Read a value of the mapped file with bound checking, position is moved after it
+template<typename T>
+bool ReadValue(const char* data, boost::uint64_t size, boost::uint64_t& position, T& value)
+{
+  if (position > size || size - position < sizeof(T))
+  {
+    return false;
+  }
+  std::memcpy(&value, data + position, sizeof(T));
+  position += sizeof(T);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Only the arrays storing their values contiguously with a fixed size can be mapped
+bool IsMappableArray(vtkAbstractArray* array)
+{
+  return vtkDataArray::SafeDownCast(array) && array->GetDataType() != VTK_BIT &&
+    array->GetDataTypeSize() > 0;
+}
+
+//-----------------------------------------------------------------------------
+// Count the arrays of some point or field data which can be written
+boost::uint32_t CountMappableArrays(vtkFieldData* data)
+{
+  boost::uint32_t count = 0;
+  for (int i = 0; i < data->GetNumberOfArrays(); ++i)
+  {
+    count += IsMappableArray(data->GetAbstractArray(i)) ? 1 : 0;
+  }
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+void WriteArray(std::ofstream& stream, vtkDataArray* array)
+{
+  const char* name = array->GetName() ? array->GetName() : "";
+  ArrayHeader header;
+  header.DataType = array->GetDataType();
+  header.NumberOfComponents = array->GetNumberOfComponents();
+  header.NumberOfTuples = static_cast<boost::uint64_t>(array->GetNumberOfTuples());
+  header.NameLength = static_cast<boost::uint32_t>(std::strlen(name));
+  header.Reserved = 0;
+  WriteValue(stream, header);
+  stream.write(name, header.NameLength);
+  WritePadding(stream);
+
+  const std::streamsize bytes = static_cast<std::streamsize>(
+    header.NumberOfTuples * header.NumberOfComponents * array->GetDataTypeSize());
+  if (bytes > 0)
+  {
+    stream.write(static_cast<const char*>(array->GetVoidPointer(0)), bytes);
+  }
+  WritePadding(stream);
+}
+
+//-----------------------------------------------------------------------------
+void WriteArrays(std::ofstream& stream, vtkFieldData* data)
+{
+  for (int i = 0; i < data->GetNumberOfArrays(); ++i)
+  {
+    if (IsMappableArray(data->GetAbstractArray(i)))
+    {
+      WriteArray(stream, data->GetArray(i));
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Owner of the mapped file, referenced by the arrays built on it
+class MappedFile : public vtkObject
+{
+public:
+  static MappedFile* New();
+  vtkTypeMacro(MappedFile, vtkObject)
+
+  boost::iostreams::mapped_file File;
+
+protected:
+  MappedFile() = default;
+
+private:
+  MappedFile(const MappedFile&) = delete;
+  void operator=(const MappedFile&) = delete;
+};
+vtkStandardNewMacro(MappedFile)
+}
+
+vtkInformationKeyMacro(DecodedFrameFile, MAPPING, ObjectBase);
+
+//-----------------------------------------------------------------------------
+std::string DecodedFrameFile::GetDecodedFrameFileName(const std::string& pcapFileName)
+{
+  return pcapFileName + ".vvframes";
+}
+
+//-----------------------------------------------------------------------------
+boost::uint64_t DecodedFrameFile::Hash(const void* data, size_t size)
+{
+  boost::uint64_t hash = 14695981039346656037ULL;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; ++i)
+  {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+//-----------------------------------------------------------------------------
+bool DecodedFrameFile::Open(const std::string& pcapFileName, const std::string& key)
+{
+  this->Close();
+
+  const std::string fileName = GetDecodedFrameFileName(pcapFileName);
+  boost::system::error_code ec;
+  if (!boost::filesystem::exists(fileName, ec))
+  {
+    this->LastError = "No decoded frame file";
+    return false;
+  }
+
+  // private mapping: the arrays can be modified in place without changing the file
+  vtkSmartPointer<MappedFile> mapping = vtkSmartPointer<MappedFile>::New();
+  try
+  {
+    boost::iostreams::mapped_file_params params(fileName);
+    params.flags = boost::iostreams::mapped_file::priv;
+    mapping->File.open(params);
+  }
+  catch (const std::exception& e)
+  {
+    this->LastError = std::string("Cannot map ") + fileName + ": " + e.what();
+    return false;
+  }
+  char* data = mapping->File.data();
+  const boost::uint64_t size = static_cast<boost::uint64_t>(mapping->File.size());
+
+  // header: check that the file correspond to this version and pcap
+  boost::uint64_t position = 0;
+  FileHeader header;
+  if (!ReadValue(data, size, position, header) ||
+    std::memcmp(header.Magic, FileMagic, sizeof(FileMagic)) != 0 || header.Version != Version)
+  {
+    this->LastError = "Decoded frame file has an unsupported format";
+    return false;
+  }
+
+  boost::uint64_t pcapSize = 0;
+  boost::int64_t pcapTime = 0;
+  if (!FrameIndexFile::GetFileStamp(pcapFileName, pcapSize, pcapTime) ||
+    header.PcapSize != pcapSize || header.PcapTime != pcapTime)
+  {
+    this->LastError = "Decoded frame file is older than the pcap file";
+    return false;
+  }
+
+  if (header.KeyLength != key.size() || size - position < header.KeyLength ||
+    key.compare(0, key.size(), data + position, header.KeyLength) != 0)
+  {
+    this->LastError = "Decoded frame file was built with other settings";
+    return false;
+  }
+
+  // footer: it is written last, a file without it is incomplete
+  FileFooter footer;
+  boost::uint64_t footerPosition = size - std::min<boost::uint64_t>(size, sizeof(FileFooter));
+  if (size < sizeof(FileHeader) + sizeof(FileFooter) ||
+    !ReadValue(data, size, footerPosition, footer) ||
+    std::memcmp(footer.Magic, FooterMagic, sizeof(FooterMagic)) != 0 ||
+    footer.FrameTableOffset > size - sizeof(FileFooter) ||
+    footer.NumberOfFrames > (size - sizeof(FileFooter) - footer.FrameTableOffset) / 8)
+  {
+    this->LastError = "Decoded frame file is truncated";
+    return false;
+  }
+
+  this->FrameOffsets.resize(static_cast<size_t>(footer.NumberOfFrames));
+  if (!this->FrameOffsets.empty())
+  {
+    std::memcpy(&this->FrameOffsets[0], data + footer.FrameTableOffset,
+      this->FrameOffsets.size() * sizeof(boost::uint64_t));
+  }
+  this->Mapping = mapping;
+  this->Data = data;
+  this->Size = size;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void DecodedFrameFile::Close()
+{
+  // the mapping is released with the last array using it
+  this->Mapping = nullptr;
+  this->Data = nullptr;
+  this->Size = 0;
+  this->FrameOffsets.clear();
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkDataArray> DecodedFrameFile::MapArray(boost::uint64_t& position)
+{
+  ArrayHeader header;
+  if (!ReadValue(this->Data, this->Size, position, header) || header.NumberOfComponents <= 0 ||
+    header.DataType == VTK_BIT)
+  {
+    return nullptr;
+  }
+  const boost::uint64_t namePosition = position;
+  position = Align(position + header.NameLength);
+  vtkSmartPointer<vtkDataArray> array;
+  array.TakeReference(vtkDataArray::CreateDataArray(header.DataType));
+  if (!array || array->GetDataType() != header.DataType || position > this->Size)
+  {
+    return nullptr;
+  }
+
+  const boost::uint64_t numberOfValues = header.NumberOfTuples * header.NumberOfComponents;
+  const boost::uint64_t bytes = numberOfValues * array->GetDataTypeSize();
+  if (numberOfValues / header.NumberOfComponents != header.NumberOfTuples ||
+    numberOfValues > this->Size || this->Size - position < bytes)
+  {
+    return nullptr;
+  }
+
+  const std::string name(this->Data + namePosition, header.NameLength);
+  array->SetName(name.c_str());
+  array->SetNumberOfComponents(header.NumberOfComponents);
+  if (numberOfValues > 0)
+  {
+    // the array does not own the values, it keeps the mapping alive instead
+    array->SetVoidArray(this->Data + position, static_cast<vtkIdType>(numberOfValues), 1);
+    array->GetInformation()->Set(MAPPING(), this->Mapping);
+  }
+  position = Align(position + bytes);
+  return array;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> DecodedFrameFile::GetFrame(int frameNumber)
+{
+  if (!this->IsOpen() || frameNumber < 0 || frameNumber >= this->GetNumberOfFrames())
+  {
+    this->LastError = "No such frame";
+    return nullptr;
+  }
+
+  boost::uint64_t position = this->FrameOffsets[frameNumber];
+  FrameHeader header;
+  if (!ReadValue(this->Data, this->Size, position, header))
+  {
+    this->LastError = "Decoded frame file is corrupted";
+    return nullptr;
+  }
+  vtkSmartPointer<vtkDataArray> points = this->MapArray(position);
+  if (!points || points->GetNumberOfComponents() != 3 ||
+    static_cast<boost::uint64_t>(points->GetNumberOfTuples()) != header.NumberOfPoints)
+  {
+    this->LastError = "Decoded frame file is corrupted";
+    return nullptr;
+  }
+
+  vtkSmartPointer<vtkPolyData> frame = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> framePoints;
+  framePoints->SetData(points);
+  frame->SetPoints(framePoints.GetPointer());
+  for (boost::uint32_t i = 0; i < header.NumberOfPointArrays + header.NumberOfFieldArrays; ++i)
+  {
+    vtkSmartPointer<vtkDataArray> array = this->MapArray(position);
+    if (!array)
+    {
+      this->LastError = "Decoded frame file is corrupted";
+      return nullptr;
+    }
+    if (i < header.NumberOfPointArrays)
+    {
+      frame->GetPointData()->AddArray(array);
+    }
+    else
+    {
+      frame->GetFieldData()->AddArray(array);
+    }
+  }
+  if (header.NumberOfVerts > 0)
+  {
+    frame->SetVerts(NewVertexCells(static_cast<vtkIdType>(header.NumberOfVerts)));
+  }
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+DecodedFrameFileWriter::~DecodedFrameFileWriter()
+{
+  if (this->Stream.is_open())
+  {
+    this->Abort();
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool DecodedFrameFileWriter::Open(const std::string& pcapFileName, const std::string& key)
+{
+  if (this->Stream.is_open())
+  {
+    this->Abort();
+  }
+  this->FrameOffsets.clear();
+
+  FileHeader header;
+  std::memcpy(header.Magic, FileMagic, sizeof(FileMagic));
+  header.Version = DecodedFrameFile::Version;
+  header.KeyLength = static_cast<boost::uint32_t>(key.size());
+  if (!FrameIndexFile::GetFileStamp(pcapFileName, header.PcapSize, header.PcapTime))
+  {
+    this->LastError = "Cannot stat the pcap file";
+    return false;
+  }
+
+  this->FileName = DecodedFrameFile::GetDecodedFrameFileName(pcapFileName);
+  this->TemporaryFileName = this->FileName + ".tmp";
+  this->Stream.open(
+    this->TemporaryFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!this->Stream.is_open())
+  {
+    this->LastError = "Cannot open " + this->TemporaryFileName + " for writing";
+    return false;
+  }
+
+  WriteValue(this->Stream, header);
+  this->Stream.write(key.data(), key.size());
+  WritePadding(this->Stream);
+  return this->Stream.good();
+}
+
+//-----------------------------------------------------------------------------
+bool DecodedFrameFileWriter::WriteFrame(vtkPolyData* frame)
+{
+  if (!this->Stream.is_open())
+  {
+    this->LastError = "The decoded frame file is not open";
+    return false;
+  }
+  vtkDataArray* points = frame && frame->GetPoints() ? frame->GetPoints()->GetData() : nullptr;
+  if (!frame || (points && points->GetNumberOfComponents() != 3))
+  {
+    this->LastError = "Invalid frame";
+    this->Abort();
+    return false;
+  }
+
+  this->FrameOffsets.push_back(static_cast<boost::uint64_t>(this->Stream.tellp()));
+  FrameHeader header;
+  header.NumberOfPoints = static_cast<boost::uint64_t>(frame->GetNumberOfPoints());
+  header.NumberOfVerts = static_cast<boost::uint64_t>(frame->GetNumberOfVerts());
+  header.NumberOfPointArrays = CountMappableArrays(frame->GetPointData());
+  header.NumberOfFieldArrays = CountMappableArrays(frame->GetFieldData());
+  WriteValue(this->Stream, header);
+
+  // a frame without points still has an empty points array
+  if (points)
+  {
+    WriteArray(this->Stream, points);
+  }
+  else
+  {
+    vtkNew<vtkPoints> empty;
+    empty->SetDataTypeToFloat();
+    WriteArray(this->Stream, empty->GetData());
+  }
+  WriteArrays(this->Stream, frame->GetPointData());
+  WriteArrays(this->Stream, frame->GetFieldData());
+
+  if (!this->Stream.good())
+  {
+    this->LastError = "Failed to write " + this->TemporaryFileName;
+    this->Abort();
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool DecodedFrameFileWriter::Close()
+{
+  if (!this->Stream.is_open())
+  {
+    this->LastError = "The decoded frame file is not open";
+    return false;
+  }
+
+  FileFooter footer;
+  footer.NumberOfFrames = this->FrameOffsets.size();
+  footer.FrameTableOffset = static_cast<boost::uint64_t>(this->Stream.tellp());
+  std::memcpy(footer.Magic, FooterMagic, sizeof(FooterMagic));
+  if (!this->FrameOffsets.empty())
+  {
+    this->Stream.write(reinterpret_cast<const char*>(&this->FrameOffsets[0]),
+      this->FrameOffsets.size() * sizeof(boost::uint64_t));
+  }
+  WriteValue(this->Stream, footer);
+  this->Stream.close();
+  if (this->Stream.fail())
+  {
+    this->LastError = "Failed to write " + this->TemporaryFileName;
+    std::remove(this->TemporaryFileName.c_str());
+    return false;
+  }
+
+  // a mapped file is not modified, it is unlinked and remains valid until it is unmapped
+  boost::system::error_code ec;
+  boost::filesystem::rename(this->TemporaryFileName, this->FileName, ec);
+  if (ec)
+  {
+    this->LastError = "Cannot replace " + this->FileName + ": " + ec.message();
+    std::remove(this->TemporaryFileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void DecodedFrameFileWriter::Abort()
+{
+  // do not leave a half written file behind
+  this->Stream.close();
+  std::remove(this->TemporaryFileName.c_str());
+  this->FrameOffsets.clear();
+}
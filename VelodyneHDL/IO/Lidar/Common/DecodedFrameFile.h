@@ -0,0 +1,158 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef DECODED_FRAME_FILE_H
+#define DECODED_FRAME_FILE_H
+
+// VTK
+#include <vtkDataArray.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// BOOST
+#include <boost/cstdint.hpp>
+
+// STD
+#include <fstream>
+#include <string>
+#include <vector>
+
+class vtkInformationObjectBaseKey;
+
+/**
+ * \class DecodedFrameFile
+ * \brief This class is responsible to read the decoded frames of a pcap file saved in a sidecar
+ *        file (<file>.vvframes) by DecodedFrameFileWriter, so that the packets do not have to be
+ *        decoded again when the pcap is analysed several times.
+ *        The file is mapped in memory and each column of a frame (points, point and field data
+ *        arrays) is stored contiguously with its vtk type, the arrays of the returned frames use
+ *        the mapped memory without copying it. The mapping is copy on write, and stays valid as
+ *        long as one of these arrays exists, even after Close.
+ *        Like the frame index, the file is rejected if the pcap has changed or if it has been
+ *        written with another key, which must describe the calibration and everything else which
+ *        changes the decoded frames.
+ */
+class DecodedFrameFile
+{
+public:
+  /**
+   * @brief GetDecodedFrameFileName return the name of the sidecar file associated to a pcap file
+   * @param pcapFileName the pcap file
+   */
+  static std::string GetDecodedFrameFileName(const std::string& pcapFileName);
+
+  /**
+   * @brief Hash return a 64 bits FNV-1a hash of some data, used to put a calibration in a key
+   */
+  static boost::uint64_t Hash(const void* data, size_t size);
+
+  /**
+   * @brief Open map the decoded frames of a pcap file if they exist and are still valid
+   * @param pcapFileName the pcap file whose frames have been decoded
+   * @param key string describing the settings used to decode the frames, the file is rejected if
+   * it has been written with another key
+   * @return true if a valid file has been opened
+   */
+  bool Open(const std::string& pcapFileName, const std::string& key);
+
+  //! Unmap the file, the frames already returned remain valid
+  void Close();
+
+  bool IsOpen() const { return this->Mapping.GetPointer() != nullptr; }
+
+  int GetNumberOfFrames() const { return static_cast<int>(this->FrameOffsets.size()); }
+
+  /**
+   * @brief GetFrame return a frame whose arrays are stored in the mapped file
+   * @param frameNumber between 0 and GetNumberOfFrames()
+   * @return nullptr if the file is not open or the frame is corrupted
+   */
+  vtkSmartPointer<vtkPolyData> GetFrame(int frameNumber);
+
+  const std::string& GetLastError() { return this->LastError; }
+
+private:
+  friend class DecodedFrameFileWriter;
+
+  //! Increase it each time the layout of the file change
+  static const unsigned int Version = 1;
+
+  //! Holds a reference on the mapping in the information of each array using it
+  static vtkInformationObjectBaseKey* MAPPING();
+
+  /**
+   * @brief MapArray create an array using the mapped column stored at a position
+   * @param position[in,out] position of the column, moved after it
+   * @return nullptr if the column is corrupted
+   */
+  vtkSmartPointer<vtkDataArray> MapArray(boost::uint64_t& position);
+
+  //! Object owning the mapped file, shared with the arrays of the returned frames
+  vtkSmartPointer<vtkObject> Mapping;
+  char* Data = nullptr;
+  boost::uint64_t Size = 0;
+  //! Position of each frame in the file
+  std::vector<boost::uint64_t> FrameOffsets;
+  std::string LastError;
+};
+
+/**
+ * \class DecodedFrameFileWriter
+ * \brief Write the decoded frames of a pcap file, in order, in the file read by DecodedFrameFile.
+ *        The frames are written in a temporary file which replaces the previous one once
+ *        complete, so that a file being read is never modified.
+ */
+class DecodedFrameFileWriter
+{
+public:
+  ~DecodedFrameFileWriter();
+
+  /**
+   * @brief Open start writing the decoded frames of a pcap file
+   * @param pcapFileName the pcap file whose frames are decoded
+   * @param key string describing the settings used to decode the frames
+   * @return true on success
+   */
+  bool Open(const std::string& pcapFileName, const std::string& key);
+
+  /**
+   * @brief WriteFrame append the next frame. Only the numeric arrays are saved.
+   * @return true on success
+   */
+  bool WriteFrame(vtkPolyData* frame);
+
+  /**
+   * @brief Close complete the file and replace the previous one
+   * @return true on success, otherwise nothing is left behind
+   */
+  bool Close();
+
+  const std::string& GetLastError() { return this->LastError; }
+
+private:
+  //! Remove the temporary file of an incomplete write
+  void Abort();
+
+  std::ofstream Stream;
+  std::string FileName;
+  std::string TemporaryFileName;
+  std::vector<boost::uint64_t> FrameOffsets;
+  std::string LastError;
+};
+
+#endif // DECODED_FRAME_FILE_H
@@ -0,0 +1,121 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FileRangeCopy.h"
+
+// STD
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+namespace
+{
+//-----------------------------------------------------------------------------
+//! Same as CopyFileRanges, but the copy is done by the kernel without going through user space
+bool SendFileRanges(const std::string& source, const FileRanges& ranges,
+  const std::string& destination, bool append)
+{
+  const int input = open(source.c_str(), O_RDONLY);
+  // sendfile does not support O_APPEND, the end of the file is reached by seeking instead
+  const int output = open(destination.c_str(), O_WRONLY | O_CREAT | (append ? 0 : O_TRUNC), 0644);
+  struct stat sourceStatus;
+  bool success = input >= 0 && output >= 0 && fstat(input, &sourceStatus) == 0 &&
+    lseek(output, 0, SEEK_END) >= 0;
+  for (size_t i = 0; success && i < ranges.size(); ++i)
+  {
+    const size_t maxCopyLength = 1 << 30;
+    off_t offset = static_cast<off_t>(ranges[i].first);
+    const off_t end =
+      static_cast<off_t>(std::min<boost::uint64_t>(ranges[i].second, sourceStatus.st_size));
+    while (success && offset < end)
+    {
+      const size_t length = static_cast<size_t>(std::min<off_t>(end - offset, maxCopyLength));
+      success = sendfile(output, input, &offset, length) > 0;
+    }
+  }
+  if (input >= 0)
+  {
+    close(input);
+  }
+  if (output >= 0)
+  {
+    success = close(output) == 0 && success;
+  }
+  return success;
+}
+}
+#endif
+
+//-----------------------------------------------------------------------------
+bool CopyFileRanges(const std::string& source, const FileRanges& ranges,
+  const std::string& destination, bool append, std::string& error)
+{
+#if defined(__linux__)
+  if (SendFileRanges(source, ranges, destination, append))
+  {
+    return true;
+  }
+  // some file systems do not support it
+#endif
+
+  std::ifstream input(source.c_str(), std::ios::in | std::ios::binary);
+  std::ofstream output(destination.c_str(),
+    std::ios::out | std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+  if (!input.is_open() || !output.is_open())
+  {
+    error = "Cannot open " + (input.is_open() ? destination : source);
+    return false;
+  }
+  input.seekg(0, std::ios::end);
+  const boost::uint64_t sourceSize = static_cast<boost::uint64_t>(input.tellg());
+
+  std::vector<char> buffer(8 << 20);
+  for (size_t i = 0; i < ranges.size(); ++i)
+  {
+    boost::uint64_t offset = ranges[i].first;
+    const boost::uint64_t end = std::min(ranges[i].second, sourceSize);
+    input.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+    while (offset < end)
+    {
+      const std::streamsize length =
+        static_cast<std::streamsize>(std::min<boost::uint64_t>(end - offset, buffer.size()));
+      if (!input.read(&buffer[0], length) || !output.write(&buffer[0], length))
+      {
+        error = std::strerror(errno);
+        return false;
+      }
+      offset += length;
+    }
+  }
+  output.close();
+  if (output.fail())
+  {
+    error = std::strerror(errno);
+    return false;
+  }
+  return true;
+}
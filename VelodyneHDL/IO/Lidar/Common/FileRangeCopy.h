@@ -0,0 +1,41 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FILE_RANGE_COPY_H
+#define FILE_RANGE_COPY_H
+
+// BOOST
+#include <boost/cstdint.hpp>
+
+// STD
+#include <string>
+#include <utility>
+#include <vector>
+
+//! Byte ranges of a file, as [begin, end) offsets
+typedef std::vector<std::pair<boost::uint64_t, boost::uint64_t> > FileRanges;
+
+/**
+ * @brief CopyFileRanges create a file made of some byte ranges of another, a range ending after
+ * the end of the source stops at its end. With append, the ranges are added at the end of
+ * destination. On Linux the copy is done by the kernel without going through user space.
+ * @param error[out] the reason of the failure, when false is returned
+ */
+bool CopyFileRanges(const std::string& source, const FileRanges& ranges,
+  const std::string& destination, bool append, std::string& error);
+
+#endif // FILE_RANGE_COPY_H
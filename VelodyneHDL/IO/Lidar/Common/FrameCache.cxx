@@ -0,0 +1,116 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameCache.h"
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkDataObject> FrameCache::GetData(int frameNumber, vtkMTimeType time)
+{
+  if (time != this->Time)
+  {
+    this->Clear();
+    this->Time = time;
+  }
+
+  auto it = this->Index.find(frameNumber);
+  if (it == this->Index.end())
+  {
+    this->NumberOfMisses++;
+    return nullptr;
+  }
+
+  this->NumberOfHits++;
+  this->Entries.splice(this->Entries.begin(), this->Entries, it->second);
+  return it->second->Frame;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameCache::Contains(int frameNumber, vtkMTimeType time) const
+{
+  return time == this->Time && this->Index.count(frameNumber);
+}
+
+//-----------------------------------------------------------------------------
+void FrameCache::Add(int frameNumber, vtkMTimeType time, vtkDataObject* frame)
+{
+  if (!frame || this->MemoryBudget == 0)
+  {
+    return;
+  }
+  if (time != this->Time)
+  {
+    this->Clear();
+    this->Time = time;
+  }
+
+  const unsigned long size = frame->GetActualMemorySize();
+  if (size > this->MemoryBudget)
+  {
+    return;
+  }
+
+  auto it = this->Index.find(frameNumber);
+  if (it != this->Index.end())
+  {
+    this->MemorySize -= it->second->Size;
+    this->Entries.erase(it->second);
+    this->Index.erase(it);
+  }
+
+  this->Shrink(this->MemoryBudget - size);
+  Entry entry = { frameNumber, frame, size };
+  this->Entries.push_front(entry);
+  this->Index[frameNumber] = this->Entries.begin();
+  this->MemorySize += size;
+  this->Memory.Set(this->MemorySize);
+}
+
+//-----------------------------------------------------------------------------
+void FrameCache::Clear()
+{
+  this->Entries.clear();
+  this->Index.clear();
+  this->MemorySize = 0;
+  this->Memory.Set(0);
+}
+
+//-----------------------------------------------------------------------------
+void FrameCache::SetMemoryBudget(unsigned long kibibytes)
+{
+  this->MemoryBudget = kibibytes;
+  this->Shrink(kibibytes);
+}
+
+//-----------------------------------------------------------------------------
+void FrameCache::Shrink(unsigned long budget)
+{
+  while (!this->Entries.empty() && this->MemorySize > budget)
+  {
+    const Entry& last = this->Entries.back();
+    this->MemorySize -= last.Size;
+    this->Index.erase(last.FrameNumber);
+    this->Entries.pop_back();
+  }
+  this->Memory.Set(this->MemorySize);
+}
+
+//-----------------------------------------------------------------------------
+void FrameCache::Release(unsigned long kibibytes)
+{
+  this->Shrink(this->MemorySize > kibibytes ? this->MemorySize - kibibytes : 0);
+}
@@ -0,0 +1,129 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+// LOCAL
+#include "MemoryAccounting.h"
+
+// VTK
+#include <vtkDataObject.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// STD
+#include <list>
+#include <unordered_map>
+
+/**
+ * \class FrameCache
+ * \brief Least recently used cache of decoded frames, limited by the memory used by the frames.
+ *        The frames are usually polydata, but any data object can be cached.
+ *        Each frame is stored with the modification time of the object which produced it, when
+ *        a frame is requested with another time (ex: a property of the interpreter has changed),
+ *        all the frames are discarded.
+ */
+class FrameCache
+{
+public:
+  //! @param subsystem account of the memory used by the cached frames
+  explicit FrameCache(MemoryAccounting::Subsystem subsystem = MemoryAccounting::READER_FRAMES)
+    : Memory(subsystem)
+  {
+  }
+
+  /**
+   * @brief GetData return a cached frame and mark it as the most recently used
+   * @param frameNumber index of the frame
+   * @param time modification time of the frame producer
+   * @return nullptr if the frame is not in the cache
+   */
+  vtkSmartPointer<vtkDataObject> GetData(int frameNumber, vtkMTimeType time);
+
+  //! Same as GetData, for the caches of polydata
+  vtkSmartPointer<vtkPolyData> Get(int frameNumber, vtkMTimeType time)
+  {
+    return vtkPolyData::SafeDownCast(this->GetData(frameNumber, time));
+  }
+
+  /**
+   * @brief Contains check if a frame is in the cache, without updating the statistics
+   * @param frameNumber index of the frame
+   * @param time modification time of the frame producer
+   */
+  bool Contains(int frameNumber, vtkMTimeType time) const;
+
+  /**
+   * @brief Add store a frame, evicting the least recently used ones to stay within the budget
+   * @param frameNumber index of the frame
+   * @param time modification time of the frame producer
+   * @param frame the decoded frame, it must not be modified afterward
+   */
+  void Add(int frameNumber, vtkMTimeType time, vtkDataObject* frame);
+
+  //! Discard all cached frames
+  void Clear();
+
+  /**
+   * @brief SetMemoryBudget set the maximum memory used by the cached frames
+   * @param kibibytes budget, 0 disables the cache
+   */
+  void SetMemoryBudget(unsigned long kibibytes);
+  unsigned long GetMemoryBudget() const { return this->MemoryBudget; }
+
+  //! Memory currently used by the cached frames, in kibibytes
+  unsigned long GetMemorySize() const { return this->MemorySize; }
+
+  int GetNumberOfFrames() const { return static_cast<int>(this->Index.size()); }
+  int GetNumberOfHits() const { return this->NumberOfHits; }
+  int GetNumberOfMisses() const { return this->NumberOfMisses; }
+  void ResetStatistics() { this->NumberOfHits = this->NumberOfMisses = 0; }
+
+  /**
+   * @brief Release evict the least recently used frames until the given memory is freed, see
+   * MemoryAccounting::Enforce. The budget is unchanged, so the cache fills up again.
+   * @param kibibytes memory to free
+   */
+  void Release(unsigned long kibibytes);
+
+  //! Account set with the memory used by the cache, to make it releasable
+  MemoryAccounting::Account& GetMemoryAccount() { return this->Memory; }
+
+private:
+  struct Entry
+  {
+    int FrameNumber;
+    vtkSmartPointer<vtkDataObject> Frame;
+    unsigned long Size;
+  };
+
+  //! Remove the least recently used frames until the budget is satisfied
+  void Shrink(unsigned long budget);
+
+  //! Most recently used first
+  std::list<Entry> Entries;
+  std::unordered_map<int, std::list<Entry>::iterator> Index;
+  vtkMTimeType Time = 0;
+  unsigned long MemoryBudget = 0;
+  unsigned long MemorySize = 0;
+  int NumberOfHits = 0;
+  int NumberOfMisses = 0;
+  MemoryAccounting::Account Memory;
+};
+
+#endif // FRAME_CACHE_H
@@ -0,0 +1,562 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "FrameCodec.h"
+#include "LidarDecodingKernels.h"
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedShortArray.h>
+
+// BOOST
+#include <boost/cstdint.hpp>
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+const char Magic[4] = { 'V', 'V', 'F', 'C' };
+
+//! The header is the magic, the version, the flags, the time, the resolutions, the number of
+//! points and the number of rows, the integers and the doubles being little endian
+const size_t HeaderSize = 4 + 1 + 1 + 8 + 8 + 8 + 4 + 4;
+
+enum Flags
+{
+  HasIntensity = 1,
+  HasLaserId = 2
+};
+
+//! Above this number of leading ones, a Rice code is followed by the value on 32 bits
+const int EscapeLength = 24;
+
+//-----------------------------------------------------------------------------
+void WriteUInt32(unsigned char* data, boost::uint32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    data[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+}
+
+//-----------------------------------------------------------------------------
+boost::uint32_t ReadUInt32(const unsigned char* data)
+{
+  boost::uint32_t value = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    value |= static_cast<boost::uint32_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+void WriteDouble(unsigned char* data, double value)
+{
+  boost::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  WriteUInt32(data, static_cast<boost::uint32_t>(bits));
+  WriteUInt32(data + 4, static_cast<boost::uint32_t>(bits >> 32));
+}
+
+//-----------------------------------------------------------------------------
+double ReadDouble(const unsigned char* data)
+{
+  const boost::uint64_t bits =
+    ReadUInt32(data) | (static_cast<boost::uint64_t>(ReadUInt32(data + 4)) << 32);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+boost::uint32_t ZigZag(boost::int32_t value)
+{
+  return (static_cast<boost::uint32_t>(value) << 1) ^ static_cast<boost::uint32_t>(value >> 31);
+}
+
+//-----------------------------------------------------------------------------
+boost::int32_t UnZigZag(boost::uint32_t value)
+{
+  return static_cast<boost::int32_t>(value >> 1) ^ -static_cast<boost::int32_t>(value & 1);
+}
+
+//-----------------------------------------------------------------------------
+//! Add a decoded residual, wrapping around instead of overflowing on corrupted data
+boost::int32_t AddResidual(boost::int32_t value, boost::uint32_t codedResidual)
+{
+  return static_cast<boost::int32_t>(
+    static_cast<boost::uint32_t>(value) + static_cast<boost::uint32_t>(UnZigZag(codedResidual)));
+}
+
+//-----------------------------------------------------------------------------
+//! Difference of two azimuths in [-numberOfAzimuths / 2, numberOfAzimuths / 2)
+boost::int32_t WrapAzimuth(boost::int64_t difference, boost::int64_t numberOfAzimuths)
+{
+  difference %= numberOfAzimuths;
+  if (difference < -numberOfAzimuths / 2)
+  {
+    difference += numberOfAzimuths;
+  }
+  else if (difference >= numberOfAzimuths - numberOfAzimuths / 2)
+  {
+    difference -= numberOfAzimuths;
+  }
+  return static_cast<boost::int32_t>(difference);
+}
+
+//-----------------------------------------------------------------------------
+class BitWriter
+{
+public:
+  explicit BitWriter(std::vector<unsigned char>& data)
+    : Data(data)
+  {
+  }
+
+  //! Append the low bits of a value, numberOfBits being at most 32
+  void Write(boost::uint32_t value, int numberOfBits)
+  {
+    const boost::uint64_t mask = (static_cast<boost::uint64_t>(1) << numberOfBits) - 1;
+    this->Buffer |= (value & mask) << this->Count;
+    this->Count += numberOfBits;
+    while (this->Count >= 8)
+    {
+      this->Data.push_back(static_cast<unsigned char>(this->Buffer));
+      this->Buffer >>= 8;
+      this->Count -= 8;
+    }
+  }
+
+  void WriteOnes(int numberOfOnes)
+  {
+    for (; numberOfOnes > 0; numberOfOnes -= 16)
+    {
+      const int count = std::min(numberOfOnes, 16);
+      this->Write((1u << count) - 1, count);
+    }
+  }
+
+  //! Write the last bits, padded with zeros
+  void Flush()
+  {
+    if (this->Count > 0)
+    {
+      this->Data.push_back(static_cast<unsigned char>(this->Buffer));
+    }
+    this->Buffer = 0;
+    this->Count = 0;
+  }
+
+private:
+  std::vector<unsigned char>& Data;
+  boost::uint64_t Buffer = 0;
+  int Count = 0;
+};
+
+//-----------------------------------------------------------------------------
+class BitReader
+{
+public:
+  BitReader(const unsigned char* data, size_t size)
+    : Data(data)
+    , Size(size)
+  {
+  }
+
+  //! Read numberOfBits bits, at most 32, the reader is exhausted after the end of the data
+  boost::uint32_t Read(int numberOfBits)
+  {
+    while (this->Count < numberOfBits)
+    {
+      if (this->Position >= this->Size)
+      {
+        this->Exhausted = true;
+        return 0;
+      }
+      this->Buffer |= static_cast<boost::uint64_t>(this->Data[this->Position++]) << this->Count;
+      this->Count += 8;
+    }
+    const boost::uint64_t mask = (static_cast<boost::uint64_t>(1) << numberOfBits) - 1;
+    const boost::uint32_t value = static_cast<boost::uint32_t>(this->Buffer & mask);
+    this->Buffer >>= numberOfBits;
+    this->Count -= numberOfBits;
+    return value;
+  }
+
+  bool IsExhausted() const { return this->Exhausted; }
+
+private:
+  const unsigned char* Data;
+  size_t Size;
+  size_t Position = 0;
+  boost::uint64_t Buffer = 0;
+  int Count = 0;
+  bool Exhausted = false;
+};
+
+//-----------------------------------------------------------------------------
+//! Rice code whose parameter follows the mean of the last values, the same on both sides, so
+//! that a channel whose residuals are small costs about one bit per value
+class AdaptiveRiceCode
+{
+public:
+  void Write(BitWriter& writer, boost::uint32_t value)
+  {
+    const int k = this->GetParameter();
+    const boost::uint32_t quotient = value >> k;
+    if (quotient < EscapeLength)
+    {
+      writer.WriteOnes(static_cast<int>(quotient));
+      writer.Write(0, 1);
+      writer.Write(value, k);
+    }
+    else
+    {
+      writer.WriteOnes(EscapeLength);
+      writer.Write(value, 32);
+    }
+    this->Update(value);
+  }
+
+  boost::uint32_t Read(BitReader& reader)
+  {
+    const int k = this->GetParameter();
+    boost::uint32_t quotient = 0;
+    while (quotient < EscapeLength && reader.Read(1) == 1)
+    {
+      quotient++;
+    }
+    const boost::uint32_t value =
+      quotient < EscapeLength ? (quotient << k) | reader.Read(k) : reader.Read(32);
+    this->Update(value);
+    return value;
+  }
+
+private:
+  int GetParameter() const
+  {
+    int k = 0;
+    while (k < 31 && (this->Count << k) < this->Sum)
+    {
+      k++;
+    }
+    return k;
+  }
+
+  void Update(boost::uint32_t value)
+  {
+    this->Sum += value;
+    this->Count++;
+    if (this->Count >= 64)
+    {
+      this->Sum = (this->Sum + 1) / 2;
+      this->Count /= 2;
+    }
+  }
+
+  boost::uint64_t Sum = 16;
+  boost::uint64_t Count = 4;
+};
+
+//-----------------------------------------------------------------------------
+//! Codes of the values of the points of a row, each one predicted from the previous point
+struct RowCoder
+{
+  AdaptiveRiceCode Azimuth;
+  AdaptiveRiceCode Elevation;
+  AdaptiveRiceCode Range;
+  AdaptiveRiceCode Intensity;
+};
+
+//-----------------------------------------------------------------------------
+struct QuantizedPoint
+{
+  boost::int32_t Azimuth;
+  boost::int32_t Elevation;
+  boost::int32_t Range;
+  boost::int32_t Intensity;
+};
+}
+
+//-----------------------------------------------------------------------------
+bool FrameCodec::Encode(vtkPolyData* frame, double time, std::vector<unsigned char>& data) const
+{
+  data.clear();
+  if (!frame || !(this->RangeResolution > 0) || !(this->AngleResolution > 0) ||
+    this->AngleResolution > 180 || this->LaserDecimation < 1)
+  {
+    return false;
+  }
+
+  vtkPoints* points = frame->GetPoints();
+  vtkDataArray* intensities = frame->GetPointData()->GetArray("intensity");
+  vtkDataArray* laserIds = frame->GetPointData()->GetArray("laser_id");
+  const vtkIdType numberOfPoints = points ? points->GetNumberOfPoints() : 0;
+
+  // the points are grouped by laser, keeping their order in each laser
+  std::vector<vtkIdType> order;
+  std::vector<int> ids(numberOfPoints, 0);
+  order.reserve(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    double point[3];
+    points->GetPoint(i, point);
+    if (!vtkMath::IsFinite(point[0]) || !vtkMath::IsFinite(point[1]) ||
+      !vtkMath::IsFinite(point[2]))
+    {
+      continue;
+    }
+    if (laserIds)
+    {
+      const double id = laserIds->GetTuple1(i);
+      if (!(id >= 0 && id <= std::numeric_limits<unsigned short>::max()))
+      {
+        return false;
+      }
+      ids[i] = static_cast<int>(id);
+    }
+    order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(),
+    [&ids](vtkIdType a, vtkIdType b) { return ids[a] < ids[b]; });
+
+  // rows of the kept lasers, as [begin, end) in order
+  std::vector<std::pair<size_t, size_t> > rows;
+  int numberOfLasers = 0;
+  for (size_t begin = 0, end = 0; begin < order.size(); begin = end)
+  {
+    for (end = begin + 1; end < order.size() && ids[order[end]] == ids[order[begin]]; ++end)
+    {
+    }
+    if (numberOfLasers++ % this->LaserDecimation == 0)
+    {
+      rows.push_back(std::make_pair(begin, end));
+    }
+  }
+
+  const double degreesToRadians = vtkMath::Pi() / 180.;
+  const boost::int64_t numberOfAzimuths =
+    std::max<boost::int64_t>(vtkMath::Round(360. / this->AngleResolution), 1);
+  const double maximumRange = std::numeric_limits<boost::int32_t>::max();
+
+  data.resize(HeaderSize);
+  BitWriter writer(data);
+  AdaptiveRiceCode rowIdCode;
+  AdaptiveRiceCode rowSizeCode;
+  int previousId = -1;
+  boost::uint32_t numberOfCodedPoints = 0;
+  for (const std::pair<size_t, size_t>& row : rows)
+  {
+    const int id = ids[order[row.first]];
+    rowIdCode.Write(writer, static_cast<boost::uint32_t>(id - previousId - 1));
+    rowSizeCode.Write(writer, static_cast<boost::uint32_t>(row.second - row.first));
+    previousId = id;
+
+    RowCoder coder;
+    QuantizedPoint previous = { 0, 0, 0, 0 };
+    boost::int32_t azimuthStep = 0;
+    for (size_t j = row.first; j < row.second; ++j)
+    {
+      const vtkIdType i = order[j];
+      double point[3];
+      points->GetPoint(i, point);
+      const double planarRange = std::sqrt(point[0] * point[0] + point[1] * point[1]);
+      const double range = std::sqrt(planarRange * planarRange + point[2] * point[2]);
+      const double azimuth = std::atan2(point[1], point[0]) / degreesToRadians;
+      const double elevation = std::atan2(point[2], planarRange) / degreesToRadians;
+
+      QuantizedPoint current;
+      current.Azimuth = static_cast<boost::int32_t>(
+        ((vtkMath::Round(azimuth / this->AngleResolution) % numberOfAzimuths) + numberOfAzimuths) %
+        numberOfAzimuths);
+      current.Elevation = vtkMath::Round(elevation / this->AngleResolution);
+      current.Range =
+        static_cast<boost::int32_t>(std::min(std::round(range / this->RangeResolution), maximumRange));
+      current.Intensity = intensities ?
+        static_cast<boost::int32_t>(std::min(std::max(intensities->GetTuple1(i), 0.), 255.)) : 0;
+
+      // the azimuth of a laser mostly increases by a constant step
+      const boost::int32_t step = WrapAzimuth(
+        static_cast<boost::int64_t>(current.Azimuth) - previous.Azimuth, numberOfAzimuths);
+      coder.Azimuth.Write(writer,
+        ZigZag(WrapAzimuth(static_cast<boost::int64_t>(step) - azimuthStep, numberOfAzimuths)));
+      coder.Elevation.Write(writer, ZigZag(current.Elevation - previous.Elevation));
+      coder.Range.Write(writer, ZigZag(current.Range - previous.Range));
+      if (intensities)
+      {
+        coder.Intensity.Write(writer, ZigZag(current.Intensity - previous.Intensity));
+      }
+      azimuthStep = step;
+      previous = current;
+      numberOfCodedPoints++;
+    }
+  }
+  writer.Flush();
+
+  unsigned char* header = data.data();
+  std::memcpy(header, Magic, sizeof(Magic));
+  header[4] = Version;
+  header[5] = static_cast<unsigned char>((intensities ? HasIntensity : 0) |
+    (laserIds ? HasLaserId : 0));
+  WriteDouble(header + 6, time);
+  WriteDouble(header + 14, this->RangeResolution);
+  WriteDouble(header + 22, this->AngleResolution);
+  WriteUInt32(header + 30, numberOfCodedPoints);
+  WriteUInt32(header + 34, static_cast<boost::uint32_t>(rows.size()));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> FrameCodec::Decode(
+  const unsigned char* data, size_t size, double& time)
+{
+  if (size < HeaderSize || std::memcmp(data, Magic, sizeof(Magic)) != 0 || data[4] != Version)
+  {
+    return nullptr;
+  }
+  const unsigned char flags = data[5];
+  time = ReadDouble(data + 6);
+  const double rangeResolution = ReadDouble(data + 14);
+  const double angleResolution = ReadDouble(data + 22);
+  const boost::uint32_t numberOfPoints = ReadUInt32(data + 30);
+  const boost::uint32_t numberOfRows = ReadUInt32(data + 34);
+  // each point takes at least 3 bits
+  if (!(rangeResolution > 0) || !(angleResolution > 0) || angleResolution > 180 ||
+    numberOfPoints > 8 * (size - HeaderSize) / 3 || numberOfRows > numberOfPoints)
+  {
+    return nullptr;
+  }
+
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToFloat();
+  points->SetNumberOfPoints(numberOfPoints);
+  points->GetData()->SetName("Points_m_XYZ");
+  float* xyz = static_cast<float*>(points->GetVoidPointer(0));
+  vtkSmartPointer<vtkUnsignedCharArray> intensities;
+  if (flags & HasIntensity)
+  {
+    intensities = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    intensities->SetName("intensity");
+    intensities->SetNumberOfTuples(numberOfPoints);
+  }
+  std::vector<int> laserIds;
+  if (flags & HasLaserId)
+  {
+    laserIds.resize(numberOfPoints);
+  }
+
+  const double degreesToRadians = vtkMath::Pi() / 180.;
+  const boost::int64_t numberOfAzimuths =
+    std::max<boost::int64_t>(vtkMath::Round(360. / angleResolution), 1);
+
+  BitReader reader(data + HeaderSize, size - HeaderSize);
+  AdaptiveRiceCode rowIdCode;
+  AdaptiveRiceCode rowSizeCode;
+  boost::int64_t id = -1;
+  boost::uint32_t numberOfDecodedPoints = 0;
+  for (boost::uint32_t r = 0; r < numberOfRows; ++r)
+  {
+    id += static_cast<boost::int64_t>(rowIdCode.Read(reader)) + 1;
+    const boost::uint32_t rowSize = rowSizeCode.Read(reader);
+    if (reader.IsExhausted() || id > std::numeric_limits<unsigned short>::max() ||
+      rowSize > numberOfPoints - numberOfDecodedPoints)
+    {
+      return nullptr;
+    }
+
+    RowCoder coder;
+    QuantizedPoint current = { 0, 0, 0, 0 };
+    boost::int32_t azimuthStep = 0;
+    for (boost::uint32_t j = 0; j < rowSize; ++j)
+    {
+      azimuthStep = WrapAzimuth(
+        static_cast<boost::int64_t>(azimuthStep) + UnZigZag(coder.Azimuth.Read(reader)),
+        numberOfAzimuths);
+      current.Azimuth = static_cast<boost::int32_t>(
+        ((current.Azimuth + static_cast<boost::int64_t>(azimuthStep)) % numberOfAzimuths +
+          numberOfAzimuths) % numberOfAzimuths);
+      current.Elevation = AddResidual(current.Elevation, coder.Elevation.Read(reader));
+      current.Range = AddResidual(current.Range, coder.Range.Read(reader));
+      if (intensities)
+      {
+        current.Intensity = AddResidual(current.Intensity, coder.Intensity.Read(reader));
+      }
+
+      const double range = current.Range * rangeResolution;
+      const double azimuth = current.Azimuth * angleResolution * degreesToRadians;
+      const double elevation = current.Elevation * angleResolution * degreesToRadians;
+      const vtkIdType i = numberOfDecodedPoints++;
+      xyz[3 * i] = static_cast<float>(range * std::cos(elevation) * std::cos(azimuth));
+      xyz[3 * i + 1] = static_cast<float>(range * std::cos(elevation) * std::sin(azimuth));
+      xyz[3 * i + 2] = static_cast<float>(range * std::sin(elevation));
+      if (intensities)
+      {
+        intensities->SetValue(i, static_cast<unsigned char>(current.Intensity & 0xff));
+      }
+      if (!laserIds.empty())
+      {
+        laserIds[i] = static_cast<int>(id);
+      }
+    }
+  }
+  if (reader.IsExhausted() || numberOfDecodedPoints != numberOfPoints)
+  {
+    return nullptr;
+  }
+
+  vtkSmartPointer<vtkPolyData> frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->SetPoints(points.GetPointer());
+  frame->SetVerts(NewVertexCells(numberOfPoints));
+  if (intensities)
+  {
+    frame->GetPointData()->AddArray(intensities);
+  }
+  if (!laserIds.empty())
+  {
+    // the ids of the lidars supported fit in a byte, like the laser_id of their interpreters
+    vtkSmartPointer<vtkDataArray> array;
+    if (id <= std::numeric_limits<unsigned char>::max())
+    {
+      array = vtkSmartPointer<vtkUnsignedCharArray>::New();
+    }
+    else
+    {
+      array = vtkSmartPointer<vtkUnsignedShortArray>::New();
+    }
+    array->SetName("laser_id");
+    array->SetNumberOfTuples(numberOfPoints);
+    for (boost::uint32_t i = 0; i < numberOfPoints; ++i)
+    {
+      array->SetTuple1(i, laserIds[i]);
+    }
+    frame->GetPointData()->AddArray(array);
+  }
+  return frame;
+}
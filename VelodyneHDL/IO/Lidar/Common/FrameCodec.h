@@ -0,0 +1,80 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+// VTK
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// STD
+#include <vector>
+
+/**
+ * \class FrameCodec
+ * \brief Compact lossy coding of the decoded frames, used to stream them over links which are
+ *        too slow for the lidar packets. The points are converted to spherical coordinates
+ *        quantized with RangeResolution and AngleResolution, and grouped by laser so that each
+ *        laser forms a row of a range image. Along a row the values are predicted from the
+ *        previous point and the residuals are entropy coded with adaptive Rice codes, along with
+ *        the intensities. The coordinates are relative to the origin of the frame.
+ *        Only the points, the "intensity" and the "laser_id" arrays are kept, the frames
+ *        without laser_id are coded as a single row.
+ */
+class FrameCodec
+{
+public:
+  /**
+   * @brief Encode code a frame
+   * @param frame frame to code, its points must be float or double
+   * @param time time of the frame, given back by Decode
+   * @param data[out] coded frame
+   * @return false if the frame cannot be coded
+   */
+  bool Encode(vtkPolyData* frame, double time, std::vector<unsigned char>& data) const;
+
+  /**
+   * @brief Decode rebuild a frame coded by Encode, with float points
+   * @param time[out] time given to Encode
+   * @return nullptr if the data is not a valid coded frame
+   */
+  static vtkSmartPointer<vtkPolyData> Decode(const unsigned char* data, size_t size, double& time);
+
+  //! Quantization step of the ranges, in meters
+  double GetRangeResolution() const { return this->RangeResolution; }
+  void SetRangeResolution(double resolution) { this->RangeResolution = resolution; }
+
+  //! Quantization step of the azimuths and vertical angles, in degrees
+  double GetAngleResolution() const { return this->AngleResolution; }
+  void SetAngleResolution(double resolution) { this->AngleResolution = resolution; }
+
+  //! Only keep the points of one laser out of LaserDecimation, the lasers being sorted by id
+  int GetLaserDecimation() const { return this->LaserDecimation; }
+  void SetLaserDecimation(int decimation) { this->LaserDecimation = decimation; }
+
+private:
+  //! Increase it each time the layout of the coded frames change
+  static const unsigned char Version = 1;
+
+  double RangeResolution = 0.01;
+  double AngleResolution = 0.01;
+  int LaserDecimation = 1;
+};
+
+#endif // FRAME_CODEC_H
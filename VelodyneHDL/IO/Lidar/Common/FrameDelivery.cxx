@@ -0,0 +1,93 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameDelivery.h"
+
+// STD
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+FrameDelivery::FrameDelivery()
+  : DeliveryPolicy(LATEST_FRAME)
+  , MaximumQueueLength(10)
+{
+  this->Reset();
+}
+
+//-----------------------------------------------------------------------------
+void FrameDelivery::SetMaximumQueueLength(size_t length)
+{
+  this->MaximumQueueLength = std::max(length, static_cast<size_t>(1));
+}
+
+//-----------------------------------------------------------------------------
+void FrameDelivery::Reset()
+{
+  this->HasDelivered = false;
+  this->LastFrame = 0;
+  this->NumberOfDeliveredFrames = 0;
+  this->NumberOfSkippedFrames = 0;
+}
+
+//-----------------------------------------------------------------------------
+size_t FrameDelivery::GetNumberOfPendingFrames(
+  unsigned long firstFrame, size_t numberOfFrames) const
+{
+  const unsigned long end = firstFrame + numberOfFrames;
+  if (!this->HasDelivered)
+  {
+    return numberOfFrames > 0 ? 1 : 0;
+  }
+  return end > this->LastFrame + 1 ? static_cast<size_t>(end - this->LastFrame - 1) : 0;
+}
+
+//-----------------------------------------------------------------------------
+int FrameDelivery::SelectFrame(unsigned long firstFrame, size_t numberOfFrames)
+{
+  if (numberOfFrames == 0)
+  {
+    return -1;
+  }
+  const unsigned long end = firstFrame + numberOfFrames;
+
+  // the consumer starts with the last frame, the frames published before it are not skipped
+  unsigned long frame = end - 1;
+  if (this->HasDelivered)
+  {
+    const unsigned long next = this->LastFrame + 1;
+    if (next >= end)
+    {
+      // nothing new, the last delivered frame is given again if it is still kept
+      return static_cast<int>(
+        (this->LastFrame >= firstFrame && this->LastFrame < end ? this->LastFrame : end - 1) -
+        firstFrame);
+    }
+    if (this->DeliveryPolicy == EVERY_FRAME)
+    {
+      const unsigned long oldestQueued =
+        end - std::min<unsigned long>(end - next, this->MaximumQueueLength);
+      frame = std::max(oldestQueued, firstFrame);
+    }
+    this->NumberOfSkippedFrames += frame - next;
+  }
+
+  this->HasDelivered = true;
+  this->LastFrame = frame;
+  this->NumberOfDeliveredFrames++;
+  return static_cast<int>(frame - firstFrame);
+}
@@ -0,0 +1,85 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAME_DELIVERY_H
+#define FRAME_DELIVERY_H
+
+// STD
+#include <cstddef>
+
+/**
+ * @brief The FrameDelivery class chooses the live frames given to a consumer, such as the
+ * pipeline of a vtkLidarStream, when it takes them slower than they are published. Each
+ * consumer has its own delivery, so that a slow consumer does not slow down the others.
+ *
+ * The frames are numbered in the order of their publication, a consumer gets them from the
+ * frames kept by PacketConsumer. With LATEST_FRAME, the consumer gets the last frame and the
+ * frames published before it since the previous delivery are skipped, so the consumer stays
+ * current. With EVERY_FRAME, the consumer gets the frames in order, but no more than
+ * MaximumQueueLength frames wait for it: the older ones are skipped, so the latency is bounded.
+ * The frames evicted from the cache before being delivered are skipped too.
+ *
+ * This class is not thread safe, it is used by the thread of its consumer.
+ */
+class FrameDelivery
+{
+public:
+  enum Policy
+  {
+    EVERY_FRAME = 0,
+    LATEST_FRAME = 1
+  };
+
+  FrameDelivery();
+
+  Policy GetPolicy() const { return this->DeliveryPolicy; }
+  void SetPolicy(Policy policy) { this->DeliveryPolicy = policy; }
+
+  //! Highest number of frames waiting to be delivered with EVERY_FRAME, at least 1
+  size_t GetMaximumQueueLength() const { return this->MaximumQueueLength; }
+  void SetMaximumQueueLength(size_t length);
+
+  /**
+   * @brief SelectFrame choose the frame to deliver, the first delivery is the last frame
+   * published. The last delivered frame is given again when no frame has been published
+   * since, without counting it.
+   * @param firstFrame number of the oldest frame kept
+   * @param numberOfFrames number of frames kept, the last one is the last published
+   * @return the index of the frame among the frames kept, -1 if there is none
+   */
+  int SelectFrame(unsigned long firstFrame, size_t numberOfFrames);
+
+  //! Number of frames published after the last delivered one, with the same parameters
+  size_t GetNumberOfPendingFrames(unsigned long firstFrame, size_t numberOfFrames) const;
+
+  //! Number of frames delivered, and published but never delivered, since the last Reset
+  unsigned long GetNumberOfDeliveredFrames() const { return this->NumberOfDeliveredFrames; }
+  unsigned long GetNumberOfSkippedFrames() const { return this->NumberOfSkippedFrames; }
+
+  //! Forget the delivered frames and the counters, the next delivery is the last frame
+  void Reset();
+
+private:
+  Policy DeliveryPolicy;
+  size_t MaximumQueueLength;
+  bool HasDelivered;
+  unsigned long LastFrame;
+  unsigned long NumberOfDeliveredFrames;
+  unsigned long NumberOfSkippedFrames;
+};
+
+#endif // FRAME_DELIVERY_H
@@ -0,0 +1,268 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameIndexFile.h"
+
+// BOOST
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+
+// STD
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+const char IndexMagic[8] = { 'V', 'V', 'F', 'R', 'I', 'D', 'X', '\0' };
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void WriteValue(std::ofstream& stream, const T& value)
+{
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+bool ReadValue(std::ifstream& stream, T& value)
+{
+  stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return stream.good();
+}
+
+//-----------------------------------------------------------------------------
+void WriteBlob(std::ofstream& stream, const std::vector<unsigned char>& blob)
+{
+  WriteValue(stream, static_cast<boost::uint64_t>(blob.size()));
+  if (!blob.empty())
+  {
+    stream.write(reinterpret_cast<const char*>(&blob[0]), blob.size());
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool ReadBlob(std::ifstream& stream, std::vector<unsigned char>& blob)
+{
+  boost::uint64_t size = 0;
+  if (!ReadValue(stream, size))
+  {
+    return false;
+  }
+  blob.clear();
+  if (size > 0)
+  {
+    blob.resize(static_cast<size_t>(size));
+    stream.read(reinterpret_cast<char*>(&blob[0]), size);
+    if (stream.gcount() != static_cast<std::streamsize>(size))
+    {
+      blob.clear();
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+bool FrameIndexFile::GetFileStamp(
+  const std::string& filename, boost::uint64_t& size, boost::int64_t& time)
+{
+  boost::system::error_code ec;
+  size = static_cast<boost::uint64_t>(boost::filesystem::file_size(filename, ec));
+  if (ec)
+  {
+    return false;
+  }
+  time = static_cast<boost::int64_t>(boost::filesystem::last_write_time(filename, ec));
+  return !ec;
+}
+
+//-----------------------------------------------------------------------------
+std::string FrameIndexFile::GetIndexFileName(const std::string& pcapFileName)
+{
+  return pcapFileName + ".vvidx";
+}
+
+//-----------------------------------------------------------------------------
+bool FrameIndexFile::Read(const std::string& pcapFileName, const std::string& key,
+  std::vector<FramePosition>& positions, std::vector<unsigned char>& streamCalibration,
+  std::vector<unsigned char>& packetAzimuths)
+{
+  positions.clear();
+  streamCalibration.clear();
+  packetAzimuths.clear();
+
+  std::ifstream stream(GetIndexFileName(pcapFileName).c_str(), std::ios::in | std::ios::binary);
+  if (!stream.is_open())
+  {
+    this->LastError = "No index file";
+    return false;
+  }
+
+  // header: check that the index correspond to this version and pcap
+  char magic[sizeof(IndexMagic)];
+  boost::uint32_t version = 0;
+  boost::uint64_t pcapSize = 0, expectedPcapSize = 0;
+  boost::int64_t pcapTime = 0, expectedPcapTime = 0;
+  stream.read(magic, sizeof(magic));
+  if (!stream.good() || std::memcmp(magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+    !ReadValue(stream, version) || version != Version)
+  {
+    this->LastError = "Index file has an unsupported format";
+    return false;
+  }
+
+  if (!ReadValue(stream, pcapSize) || !ReadValue(stream, pcapTime) ||
+    !GetFileStamp(pcapFileName, expectedPcapSize, expectedPcapTime) ||
+    pcapSize != expectedPcapSize || pcapTime != expectedPcapTime)
+  {
+    this->LastError = "Index file is older than the pcap file";
+    return false;
+  }
+
+  boost::uint32_t keyLength = 0;
+  if (!ReadValue(stream, keyLength) || keyLength != key.size())
+  {
+    this->LastError = "Index file was built with other settings";
+    return false;
+  }
+  std::string storedKey(keyLength, '\0');
+  stream.read(&storedKey[0], keyLength);
+  if (!stream.good() || storedKey != key)
+  {
+    this->LastError = "Index file was built with other settings";
+    return false;
+  }
+
+  // frame positions
+  boost::uint64_t numberOfFrames = 0;
+  if (!ReadValue(stream, numberOfFrames))
+  {
+    this->LastError = "Index file is truncated";
+    return false;
+  }
+  positions.reserve(static_cast<size_t>(numberOfFrames));
+  for (boost::uint64_t i = 0; i < numberOfFrames; ++i)
+  {
+    boost::uint64_t position = 0;
+    boost::int32_t skip = 0;
+    double time = 0;
+    FramePosition framePosition(0, 0, 0.);
+    boost::int32_t numberOfPackets = 0, missingPackets = 0, duplicatePackets = 0;
+    if (!ReadValue(stream, position) || !ReadValue(stream, skip) || !ReadValue(stream, time) ||
+      !ReadValue(stream, framePosition.FirstSensorTime) ||
+      !ReadValue(stream, framePosition.LastSensorTime) || !ReadValue(stream, numberOfPackets) ||
+      !ReadValue(stream, framePosition.AzimuthCoverage) || !ReadValue(stream, missingPackets) ||
+      !ReadValue(stream, duplicatePackets) || !ReadValue(stream, framePosition.LargestTimeGap))
+    {
+      this->LastError = "Index file is truncated";
+      positions.clear();
+      return false;
+    }
+    framePosition.Position = position;
+    framePosition.Skip = skip;
+    framePosition.Time = time;
+    framePosition.NumberOfPackets = numberOfPackets;
+    framePosition.NumberOfMissingPackets = missingPackets;
+    framePosition.NumberOfDuplicatePackets = duplicatePackets;
+    positions.push_back(framePosition);
+  }
+
+  // calibration detected in the stream, and azimuths of the packets
+  if (!ReadBlob(stream, streamCalibration) || !ReadBlob(stream, packetAzimuths))
+  {
+    this->LastError = "Index file is truncated";
+    positions.clear();
+    streamCalibration.clear();
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool FrameIndexFile::Write(const std::string& pcapFileName, const std::string& key,
+  const std::vector<FramePosition>& positions,
+  const std::vector<unsigned char>& streamCalibration,
+  const std::vector<unsigned char>& packetAzimuths)
+{
+  boost::uint64_t pcapSize = 0;
+  boost::int64_t pcapTime = 0;
+  if (!GetFileStamp(pcapFileName, pcapSize, pcapTime))
+  {
+    this->LastError = "Cannot stat the pcap file";
+    return false;
+  }
+
+  // the index is written next to it then renamed over it, so that the readers of the same
+  // pcap, possibly in other processes, never see a half written index
+  const std::string indexFileName = GetIndexFileName(pcapFileName);
+  const std::string temporaryFileName =
+    boost::filesystem::unique_path(indexFileName + ".%%%%-%%%%-%%%%.tmp").string();
+  std::ofstream stream(
+    temporaryFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!stream.is_open())
+  {
+    this->LastError = "Cannot open " + temporaryFileName + " for writing";
+    return false;
+  }
+
+  stream.write(IndexMagic, sizeof(IndexMagic));
+  WriteValue(stream, static_cast<boost::uint32_t>(Version));
+  WriteValue(stream, pcapSize);
+  WriteValue(stream, pcapTime);
+  WriteValue(stream, static_cast<boost::uint32_t>(key.size()));
+  stream.write(key.data(), key.size());
+
+  WriteValue(stream, static_cast<boost::uint64_t>(positions.size()));
+  for (size_t i = 0; i < positions.size(); ++i)
+  {
+    WriteValue(stream, positions[i].Position);
+    WriteValue(stream, static_cast<boost::int32_t>(positions[i].Skip));
+    WriteValue(stream, positions[i].Time);
+    WriteValue(stream, positions[i].FirstSensorTime);
+    WriteValue(stream, positions[i].LastSensorTime);
+    WriteValue(stream, static_cast<boost::int32_t>(positions[i].NumberOfPackets));
+    WriteValue(stream, positions[i].AzimuthCoverage);
+    WriteValue(stream, static_cast<boost::int32_t>(positions[i].NumberOfMissingPackets));
+    WriteValue(stream, static_cast<boost::int32_t>(positions[i].NumberOfDuplicatePackets));
+    WriteValue(stream, positions[i].LargestTimeGap);
+  }
+
+  WriteBlob(stream, streamCalibration);
+  WriteBlob(stream, packetAzimuths);
+
+  stream.close();
+  if (stream.fail())
+  {
+    // do not leave a half written index behind
+    this->LastError = "Failed to write " + temporaryFileName;
+    std::remove(temporaryFileName.c_str());
+    return false;
+  }
+  boost::system::error_code error;
+  boost::filesystem::rename(temporaryFileName, indexFileName, error);
+  if (error)
+  {
+    this->LastError = "Cannot replace " + indexFileName + ": " + error.message();
+    std::remove(temporaryFileName.c_str());
+    return false;
+  }
+  return true;
+}
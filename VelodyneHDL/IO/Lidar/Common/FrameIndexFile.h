@@ -0,0 +1,96 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAME_INDEX_FILE_H
+#define FRAME_INDEX_FILE_H
+
+// LOCAL
+#include "vtkLidarReader.h"
+
+// BOOST
+#include <boost/cstdint.hpp>
+
+// STD
+#include <string>
+#include <vector>
+
+/**
+ * \class FrameIndexFile
+ * \brief This class is responsible to save and restore the frame index of a pcap file
+ *        in a sidecar file (<file>.vvidx) located next to the pcap.
+ *        The index stores the pcap size and last modification time so that a stale
+ *        index is detected and ignored. The GPS times of the frames are stored with their
+ *        positions, along with the quality of the frames measured from their packets. It can
+ *        also hold an opaque calibration blob
+ *        provided by the interpreter, for sensors that send their calibration in the stream,
+ *        and the opaque packet azimuths serialized by PacketAzimuthIndex.
+ */
+class FrameIndexFile
+{
+public:
+  /**
+   * @brief GetIndexFileName return the name of the sidecar file associated to a pcap file
+   * @param pcapFileName the pcap file
+   */
+  static std::string GetIndexFileName(const std::string& pcapFileName);
+
+  /**
+   * @brief GetFileStamp return the size and last modification time of a file, which are stored
+   * in the sidecar files to detect that the pcap has changed
+   * @return false if the file cannot be stat
+   */
+  static bool GetFileStamp(const std::string& filename, boost::uint64_t& size, boost::int64_t& time);
+
+  /**
+   * @brief Read load the index of a pcap file if it exists and is still valid
+   * @param pcapFileName the pcap file which has been indexed
+   * @param key string describing the interpreter settings used to build the index, the index is
+   * rejected if it has been built with another key
+   * @param positions[out] the frame index
+   * @param streamCalibration[out] calibration blob stored with the index, may be empty
+   * @param packetAzimuths[out] packet azimuths stored with the index, may be empty
+   * @return true if a valid index has been loaded
+   */
+  bool Read(const std::string& pcapFileName, const std::string& key,
+    std::vector<FramePosition>& positions, std::vector<unsigned char>& streamCalibration,
+    std::vector<unsigned char>& packetAzimuths);
+
+  /**
+   * @brief Write save the index of a pcap file
+   * @param pcapFileName the pcap file which has been indexed
+   * @param key string describing the interpreter settings used to build the index
+   * @param positions the frame index
+   * @param streamCalibration calibration blob to store with the index, may be empty
+   * @param packetAzimuths packet azimuths to store with the index, may be empty
+   * @return true on success
+   */
+  bool Write(const std::string& pcapFileName, const std::string& key,
+    const std::vector<FramePosition>& positions,
+    const std::vector<unsigned char>& streamCalibration,
+    const std::vector<unsigned char>& packetAzimuths);
+
+  const std::string& GetLastError() { return this->LastError; }
+
+private:
+  //! Increase it each time the layout of the file change, or when the indexes written by a
+  //! previous version miss some information (e.g. the qualities of the incremental indexing)
+  static const unsigned int Version = 7;
+
+  std::string LastError;
+};
+
+#endif // FRAME_INDEX_FILE_H
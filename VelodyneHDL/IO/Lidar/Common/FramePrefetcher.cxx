@@ -0,0 +1,95 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FramePrefetcher.h"
+
+// BOOST
+#include <boost/bind.hpp>
+
+//-----------------------------------------------------------------------------
+FramePrefetcher::FramePrefetcher(const Callback& prefetchFrame)
+  : PrefetchFrame(prefetchFrame)
+{
+}
+
+//-----------------------------------------------------------------------------
+FramePrefetcher::~FramePrefetcher()
+{
+  if (this->Thread)
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(this->Mutex);
+      this->Pending.clear();
+      this->ShouldStop = true;
+    }
+    this->WorkCondition.notify_all();
+    this->Thread->join();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FramePrefetcher::Request(const std::vector<int>& frames)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    this->Pending.assign(frames.begin(), frames.end());
+  }
+  if (!this->Thread)
+  {
+    this->Thread = boost::shared_ptr<boost::thread>(
+      new boost::thread(boost::bind(&FramePrefetcher::ThreadLoop, this)));
+  }
+  this->WorkCondition.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+void FramePrefetcher::Cancel()
+{
+  boost::unique_lock<boost::mutex> lock(this->Mutex);
+  this->Pending.clear();
+  while (this->IsBusy)
+  {
+    this->DoneCondition.wait(lock);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FramePrefetcher::ThreadLoop()
+{
+  boost::unique_lock<boost::mutex> lock(this->Mutex);
+  while (true)
+  {
+    while (this->Pending.empty() && !this->ShouldStop)
+    {
+      this->WorkCondition.wait(lock);
+    }
+    if (this->ShouldStop)
+    {
+      return;
+    }
+
+    const int frame = this->Pending.front();
+    this->Pending.pop_front();
+    this->IsBusy = true;
+    lock.unlock();
+    this->PrefetchFrame(frame);
+    lock.lock();
+    this->IsBusy = false;
+    this->DoneCondition.notify_all();
+  }
+}
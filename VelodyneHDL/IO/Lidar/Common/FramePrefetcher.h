@@ -0,0 +1,74 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAME_PREFETCHER_H
+#define FRAME_PREFETCHER_H
+
+// BOOST
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+// STD
+#include <deque>
+#include <vector>
+
+/**
+ * \class FramePrefetcher
+ * \brief Worker thread which prepares frames before they are requested, ex: decode the next
+ *        frames during playback. Each requested frame is given to a callback called on the worker
+ *        thread, the callback is responsible for the synchronization with the rest of the program.
+ */
+class FramePrefetcher
+{
+public:
+  typedef boost::function<void(int)> Callback;
+
+  FramePrefetcher(const Callback& prefetchFrame);
+
+  ~FramePrefetcher();
+
+  /**
+   * @brief Request replace the frames waiting to be prefetched, the thread is started if needed
+   * @param frames frames to prefetch, in order of priority
+   */
+  void Request(const std::vector<int>& frames);
+
+  /**
+   * @brief Cancel forget the frames waiting to be prefetched and wait for the frame in progress,
+   * so that the callback is not running when this function returns
+   */
+  void Cancel();
+
+private:
+  void ThreadLoop();
+
+  Callback PrefetchFrame;
+  boost::shared_ptr<boost::thread> Thread;
+  boost::mutex Mutex;
+  //! notified when some frames are requested, or when the thread must stop
+  boost::condition_variable WorkCondition;
+  //! notified when a frame has been prefetched
+  boost::condition_variable DoneCondition;
+  std::deque<int> Pending;
+  bool IsBusy = false;
+  bool ShouldStop = false;
+};
+
+#endif // FRAME_PREFETCHER_H
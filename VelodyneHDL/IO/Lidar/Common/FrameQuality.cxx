@@ -0,0 +1,159 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "FrameQuality.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+//! The sensor times wrap every hour
+const double Hour = 3600.;
+
+//! Resolution of the azimuth coverage, in degrees
+const int CoverageBins = 360;
+
+//! A time gap holds missing packets when it is longer than this number of median intervals
+const double GapRatio = 1.5;
+
+//-----------------------------------------------------------------------------
+//! Azimuth in [0, 360[
+double NormalizeAzimuth(double azimuth)
+{
+  azimuth = std::fmod(azimuth, 360.);
+  return azimuth < 0. ? azimuth + 360. : azimuth;
+}
+
+//-----------------------------------------------------------------------------
+//! Same sensor time, or both without one, and same azimuths
+bool IsSamePacket(const PacketAzimuthIndex::Packet& a, const PacketAzimuthIndex::Packet& b)
+{
+  const bool isSameTime =
+    a.SensorTime == b.SensorTime || (std::isnan(a.SensorTime) && std::isnan(b.SensorTime));
+  return isSameTime && a.FirstAzimuth == b.FirstAzimuth && a.LastAzimuth == b.LastAzimuth;
+}
+
+//-----------------------------------------------------------------------------
+void ComputeFrameQuality(const PacketAzimuthIndex::Packet* packets, size_t numberOfPackets,
+  FramePosition& position)
+{
+  position.NumberOfPackets = static_cast<int>(numberOfPackets);
+
+  // azimuth bins touched by the packets, the direction of the rotation being the shortest
+  // way from the first azimuth to the last one, as in PacketAzimuthIndex
+  std::vector<bool> covered(CoverageBins, false);
+  for (size_t i = 0; i < numberOfPackets; ++i)
+  {
+    double first = packets[i].FirstAzimuth;
+    double width = NormalizeAzimuth(packets[i].LastAzimuth - first);
+    if (width > 180.)
+    {
+      first = packets[i].LastAzimuth;
+      width = 360. - width;
+    }
+    const int firstBin = static_cast<int>(std::floor(first));
+    const int lastBin = std::max(firstBin, static_cast<int>(std::ceil(first + width)) - 1);
+    for (int bin = firstBin; bin <= lastBin && bin < firstBin + CoverageBins; ++bin)
+    {
+      covered[((bin % CoverageBins) + CoverageBins) % CoverageBins] = true;
+    }
+  }
+  position.AzimuthCoverage =
+    static_cast<double>(std::count(covered.begin(), covered.end(), true)) / CoverageBins;
+
+  // a duplicate packet does not count in the intervals between the packets
+  position.NumberOfDuplicatePackets = 0;
+  std::vector<double> intervals;
+  bool hasTimes = true;
+  for (size_t i = 1; i < numberOfPackets; ++i)
+  {
+    if (IsSamePacket(packets[i], packets[i - 1]))
+    {
+      position.NumberOfDuplicatePackets++;
+      continue;
+    }
+    double interval = packets[i].SensorTime - packets[i - 1].SensorTime;
+    hasTimes &= !std::isnan(interval);
+    if (interval < -Hour / 2.)
+    {
+      interval += Hour;
+    }
+    intervals.push_back(interval);
+  }
+
+  position.NumberOfMissingPackets = -1;
+  position.LargestTimeGap = std::numeric_limits<double>::quiet_NaN();
+  if (!hasTimes || intervals.empty())
+  {
+    return;
+  }
+  position.LargestTimeGap = *std::max_element(intervals.begin(), intervals.end());
+  std::vector<double> sorted = intervals;
+  std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+  const double median = sorted[sorted.size() / 2];
+  position.NumberOfMissingPackets = 0;
+  if (median <= 0.)
+  {
+    return;
+  }
+  for (double interval : intervals)
+  {
+    if (interval > GapRatio * median)
+    {
+      position.NumberOfMissingPackets += static_cast<int>(std::lround(interval / median)) - 1;
+    }
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+void ComputeFrameQualities(
+  const std::vector<PacketAzimuthIndex::Packet>& packets, std::vector<FramePosition>& positions)
+{
+  // same packets as PacketAzimuthIndex::Build, the first packet of the next frame ends a frame
+  auto byPosition = [](const PacketAzimuthIndex::Packet& packet, boost::uint64_t position) {
+    return packet.Position < position;
+  };
+  for (size_t frame = 0; frame < positions.size(); ++frame)
+  {
+    auto begin =
+      std::lower_bound(packets.begin(), packets.end(), positions[frame].Position, byPosition);
+    if (begin == packets.end())
+    {
+      break;
+    }
+    auto end = packets.end();
+    if (frame + 1 < positions.size())
+    {
+      end = std::lower_bound(begin, packets.end(), positions[frame + 1].Position, byPosition);
+      end = end != packets.end() ? end + 1 : end;
+    }
+    ComputeFrameQuality(&*begin, end - begin, positions[frame]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool IsFrameDamaged(const FramePosition& position, double minimumCoverage)
+{
+  return position.NumberOfPackets > 0 &&
+    (position.NumberOfMissingPackets > 0 || position.NumberOfDuplicatePackets > 0 ||
+      position.AzimuthCoverage < minimumCoverage);
+}
@@ -0,0 +1,47 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef FRAME_QUALITY_H
+#define FRAME_QUALITY_H
+
+// LOCAL
+#include "PacketAzimuthIndex.h"
+#include "vtkLidarReader.h"
+
+// STD
+#include <vector>
+
+// Completeness of the frames measured from their lidar packets while the file is indexed, so
+// that the frames damaged by a packet loss are known without decoding them. The packets of a
+// frame are the ones of PacketAzimuthIndex, from its first packet to the first packet of the
+// next frame.
+
+//-----------------------------------------------------------------------------
+// Set the quality fields of the frames of an index, see FramePosition::NumberOfPackets.
+// The missing packets are the ones expected in the time gaps between consecutive packets, a
+// gap being compared to the median time between the packets of the frame. A duplicate packet
+// has the sensor time and the azimuths of the previous one.
+// packets: all the lidar packets of the file, in file order
+void ComputeFrameQualities(
+  const std::vector<PacketAzimuthIndex::Packet>& packets, std::vector<FramePosition>& positions);
+
+//-----------------------------------------------------------------------------
+// A frame whose packets have been indexed is damaged when it misses packets, has duplicated
+// ones, or covers less than minimumCoverage of the turn
+bool IsFrameDamaged(const FramePosition& position, double minimumCoverage);
+
+#endif // FRAME_QUALITY_H
@@ -0,0 +1,268 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "FrameStreamServer.h"
+
+// VTK
+#include <vtkSetGet.h>
+
+// BOOST
+#include <boost/bind.hpp>
+#include <boost/chrono.hpp>
+
+// STD
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+FrameStreamServer::FrameStreamServer()
+  : Acceptor(IOService)
+  , NumberOfClients(0)
+  , NumberOfSentFrames(0)
+  , NumberOfSkippedFrames(0)
+  , NumberOfSentBytes(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+FrameStreamServer::~FrameStreamServer()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+bool FrameStreamServer::Start(int port)
+{
+  if (this->IsRunning())
+  {
+    return true;
+  }
+
+  boost::system::error_code error;
+  const boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), port);
+  this->Acceptor.open(endpoint.protocol(), error);
+  if (!error)
+  {
+    // a restarted server takes the port back without waiting for the previous connections
+    this->Acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), error);
+    this->Acceptor.bind(endpoint, error);
+  }
+  if (!error)
+  {
+    this->Acceptor.listen(boost::asio::socket_base::max_connections, error);
+  }
+  if (error)
+  {
+    vtkGenericWarningMacro("Cannot stream the frames on port " << port << ": "
+                                                               << error.message());
+    this->Acceptor.close(error);
+    return false;
+  }
+
+  this->NumberOfClients = 0;
+  this->NumberOfSentFrames = 0;
+  this->NumberOfSkippedFrames = 0;
+  this->NumberOfSentBytes = 0;
+  {
+    boost::lock_guard<boost::mutex> lock(this->FrameMutex);
+    this->IsStopping = false;
+  }
+  this->IOService.reset();
+  this->Accept();
+  this->NetworkThread = boost::shared_ptr<boost::thread>(
+    new boost::thread([this]() { this->IOService.run(); }));
+  this->EncodingThread = boost::shared_ptr<boost::thread>(
+    new boost::thread(boost::bind(&FrameStreamServer::EncodingLoop, this, this->Codec,
+      this->MaximumFrameRate)));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void FrameStreamServer::Stop()
+{
+  if (!this->IsRunning())
+  {
+    return;
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(this->FrameMutex);
+    this->IsStopping = true;
+    this->PendingFrame = nullptr;
+  }
+  this->FrameCondition.notify_all();
+  this->EncodingThread->join();
+  this->EncodingThread.reset();
+
+  // the pending writes are abandoned, the viewers see the connection closed
+  this->IOService.stop();
+  this->NetworkThread->join();
+  this->NetworkThread.reset();
+  boost::system::error_code error;
+  this->Acceptor.close(error);
+  for (const ClientPointer& client : this->Clients)
+  {
+    client->Socket.close(error);
+  }
+  this->Clients.clear();
+  this->NumberOfClients = 0;
+}
+
+//-----------------------------------------------------------------------------
+void FrameStreamServer::SendFrame(vtkPolyData* frame, double time)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(this->FrameMutex);
+    if (this->IsStopping)
+    {
+      return;
+    }
+    if (this->PendingFrame)
+    {
+      this->NumberOfSkippedFrames++;
+    }
+    this->PendingFrame = frame;
+    this->PendingTime = time;
+  }
+  this->FrameCondition.notify_one();
+}
+
+//-----------------------------------------------------------------------------
+void FrameStreamServer::EncodingLoop(FrameCodec codec, double maximumFrameRate)
+{
+  typedef boost::chrono::steady_clock Clock;
+  const Clock::duration period = maximumFrameRate > 0 ?
+    boost::chrono::duration_cast<Clock::duration>(
+      boost::chrono::duration<double>(1. / maximumFrameRate)) :
+    Clock::duration::zero();
+  Clock::time_point nextTime = Clock::now();
+  std::vector<unsigned char> data;
+  while (true)
+  {
+    vtkSmartPointer<vtkPolyData> frame;
+    double time = 0;
+    {
+      // wait for a frame, then for the frame rate to allow sending it, the frames received
+      // meanwhile replace it
+      boost::unique_lock<boost::mutex> lock(this->FrameMutex);
+      while (!this->IsStopping && (!this->PendingFrame || Clock::now() < nextTime))
+      {
+        if (this->PendingFrame)
+        {
+          this->FrameCondition.wait_until(lock, nextTime);
+        }
+        else
+        {
+          this->FrameCondition.wait(lock);
+        }
+      }
+      if (this->IsStopping)
+      {
+        return;
+      }
+      frame = this->PendingFrame;
+      time = this->PendingTime;
+      this->PendingFrame = nullptr;
+    }
+    nextTime = Clock::now() + period;
+
+    // nobody to send it to, the frame is not coded
+    if (this->NumberOfClients == 0 || !codec.Encode(frame, time, data))
+    {
+      continue;
+    }
+    std::shared_ptr<std::vector<unsigned char> > message =
+      std::make_shared<std::vector<unsigned char> >(4 + data.size());
+    const boost::uint32_t size = static_cast<boost::uint32_t>(data.size());
+    for (int i = 0; i < 4; ++i)
+    {
+      (*message)[i] = static_cast<unsigned char>(size >> (8 * i));
+    }
+    std::copy(data.begin(), data.end(), message->begin() + 4);
+    this->IOService.post(
+      boost::bind(&FrameStreamServer::Broadcast, this, MessagePointer(message)));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FrameStreamServer::Accept()
+{
+  ClientPointer client = std::make_shared<Client>(this->IOService);
+  this->Acceptor.async_accept(client->Socket,
+    boost::bind(&FrameStreamServer::HandleAccept, this, client, boost::asio::placeholders::error));
+}
+
+//-----------------------------------------------------------------------------
+void FrameStreamServer::HandleAccept(ClientPointer client, const boost::system::error_code& error)
+{
+  if (error == boost::asio::error::operation_aborted)
+  {
+    return;
+  }
+  if (!error)
+  {
+    // the frames are written at once, there is nothing to gain by delaying them
+    boost::system::error_code optionError;
+    client->Socket.set_option(boost::asio::ip::tcp::no_delay(true), optionError);
+    this->Clients.push_back(client);
+    this->NumberOfClients = static_cast<int>(this->Clients.size());
+  }
+  this->Accept();
+}
+
+//-----------------------------------------------------------------------------
+void FrameStreamServer::Broadcast(MessagePointer message)
+{
+  for (const ClientPointer& client : this->Clients)
+  {
+    if (client->IsSending)
+    {
+      this->NumberOfSkippedFrames++;
+      continue;
+    }
+    client->IsSending = true;
+    boost::asio::async_write(client->Socket, boost::asio::buffer(*message),
+      boost::bind(&FrameStreamServer::HandleWrite, this, client, message,
+        boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void FrameStreamServer::HandleWrite(ClientPointer client, MessagePointer vtkNotUsed(message),
+  const boost::system::error_code& error, size_t size)
+{
+  client->IsSending = false;
+  if (error)
+  {
+    // the viewer has disconnected
+    this->RemoveClient(client);
+    return;
+  }
+  this->NumberOfSentFrames++;
+  this->NumberOfSentBytes += size;
+}
+
+//-----------------------------------------------------------------------------
+void FrameStreamServer::RemoveClient(ClientPointer client)
+{
+  boost::system::error_code error;
+  client->Socket.close(error);
+  this->Clients.erase(
+    std::remove(this->Clients.begin(), this->Clients.end(), client), this->Clients.end());
+  this->NumberOfClients = static_cast<int>(this->Clients.size());
+}
@@ -0,0 +1,132 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef FRAME_STREAM_SERVER_H
+#define FRAME_STREAM_SERVER_H
+
+// LOCAL
+#include "FrameCodec.h"
+
+// BOOST
+#include <boost/asio.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+// STD
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * \class FrameStreamServer
+ * \brief Send the decoded frames, coded by FrameCodec, to the viewers connected on a TCP port,
+ *        so that a remote VeloView shows a sensor over a link too slow for its packets. Each
+ *        message is the size of the coded frame on 4 little endian bytes followed by the coded
+ *        frame. SendFrame never blocks the caller: a dedicated thread codes the latest frame at
+ *        most MaximumFrameRate times per second, and a viewer still receiving the previous
+ *        frame skips the new one, so that a slow viewer only lowers its own frame rate.
+ */
+class FrameStreamServer
+{
+public:
+  FrameStreamServer();
+  ~FrameStreamServer();
+
+  /**
+   * @brief Start accept the viewers on a port
+   * @return false if the port cannot be listened
+   */
+  bool Start(int port);
+
+  void Stop();
+
+  bool IsRunning() { return static_cast<bool>(this->EncodingThread); }
+
+  //! Give the next frame to send, it must not be modified afterward. Does not block.
+  void SendFrame(vtkPolyData* frame, double time);
+
+  //! Coding of the frames, used by the next Start
+  FrameCodec& GetCodec() { return this->Codec; }
+
+  //! Highest number of frames sent per second, 0 means no limit, used by the next Start
+  double GetMaximumFrameRate() { return this->MaximumFrameRate; }
+  void SetMaximumFrameRate(double rate) { this->MaximumFrameRate = rate; }
+
+  //! Number of viewers connected
+  int GetNumberOfClients() { return this->NumberOfClients; }
+
+  //! Frames sent since the last Start, counted once for each viewer
+  unsigned long GetNumberOfSentFrames() { return this->NumberOfSentFrames; }
+
+  //! Frames not sent since the last Start, because of the frame rate or of a slow viewer
+  unsigned long GetNumberOfSkippedFrames() { return this->NumberOfSkippedFrames; }
+
+  //! Bytes sent since the last Start, to all the viewers
+  unsigned long long GetNumberOfSentBytes() { return this->NumberOfSentBytes; }
+
+private:
+  struct Client
+  {
+    Client(boost::asio::io_service& service)
+      : Socket(service)
+    {
+    }
+    boost::asio::ip::tcp::socket Socket;
+    //! The previous message is still being written
+    bool IsSending = false;
+  };
+  typedef std::shared_ptr<Client> ClientPointer;
+  typedef std::shared_ptr<const std::vector<unsigned char> > MessagePointer;
+
+  //! Takes copies of the settings, so that they can be modified while the server runs
+  void EncodingLoop(FrameCodec codec, double maximumFrameRate);
+
+  //! The following functions run on the network thread, which owns the clients
+  void Accept();
+  void HandleAccept(ClientPointer client, const boost::system::error_code& error);
+  void Broadcast(MessagePointer message);
+  void HandleWrite(ClientPointer client, MessagePointer message,
+    const boost::system::error_code& error, size_t size);
+  void RemoveClient(ClientPointer client);
+
+  FrameCodec Codec;
+  double MaximumFrameRate = 10.;
+
+  boost::asio::io_service IOService;
+  boost::asio::ip::tcp::acceptor Acceptor;
+  std::vector<ClientPointer> Clients;
+
+  boost::shared_ptr<boost::thread> NetworkThread;
+  boost::shared_ptr<boost::thread> EncodingThread;
+
+  //! Protects the frame waiting to be coded
+  boost::mutex FrameMutex;
+  boost::condition_variable FrameCondition;
+  vtkSmartPointer<vtkPolyData> PendingFrame;
+  double PendingTime = 0;
+  //! Also true before the first Start, so that the frames are ignored
+  bool IsStopping = true;
+
+  std::atomic<int> NumberOfClients;
+  std::atomic<unsigned long> NumberOfSentFrames;
+  std::atomic<unsigned long> NumberOfSkippedFrames;
+  std::atomic<unsigned long long> NumberOfSentBytes;
+};
+
+#endif // FRAME_STREAM_SERVER_H
@@ -0,0 +1,640 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "LidarDecodingKernels.h"
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkFieldData.h>
+#include <vtkIntArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNew.h>
+#include <vtkTable.h>
+#include <vtkTransform.h>
+
+// BOOST
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+// STD
+#include <numeric>
+#include <deque>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Connectivity of the vertex cells (1, 0, 1, 1, 1, 2...) of the largest frame so far, which
+// the frames share instead of building their own. A larger frame allocates a connectivity
+// twice as large, the previous ones are kept as long as the program runs since the frames
+// still use them, so that less than twice the largest connectivity is allocated.
+class SharedVertexConnectivity
+{
+public:
+  const vtkIdType* Get(vtkIdType numberOfVerts)
+  {
+    const size_t size = static_cast<size_t>(numberOfVerts) * 2;
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    if (this->Connectivities.empty() || this->Connectivities.back().size() < size)
+    {
+      const size_t previous = this->Connectivities.empty() ? 0 : this->Connectivities.back().size();
+      std::vector<vtkIdType> connectivity(std::max(size, 2 * previous));
+      for (size_t i = 0; i < connectivity.size() / 2; ++i)
+      {
+        connectivity[i * 2] = 1;
+        connectivity[i * 2 + 1] = static_cast<vtkIdType>(i);
+      }
+      this->Connectivities.push_back(std::move(connectivity));
+    }
+    // the values are never modified once written, they are read without the lock
+    return this->Connectivities.back().data();
+  }
+
+private:
+  boost::mutex Mutex;
+  std::deque<std::vector<vtkIdType> > Connectivities;
+};
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkCellArray> NewVertexCells(vtkIdType numberOfVerts)
+{
+  vtkSmartPointer<vtkCellArray> cellArray = vtkSmartPointer<vtkCellArray>::New();
+  if (numberOfVerts <= 0)
+  {
+    return cellArray;
+  }
+
+  // the array does not own the shared values (save = 1), it copies them if it is resized
+  static SharedVertexConnectivity shared;
+  vtkNew<vtkIdTypeArray> cells;
+  cells->SetArray(const_cast<vtkIdType*>(shared.Get(numberOfVerts)), numberOfVerts * 2, 1);
+  cellArray->SetCells(numberOfVerts, cells.GetPointer());
+  return cellArray;
+}
+
+//-----------------------------------------------------------------------------
+const AzimuthLookupTable& AzimuthLookupTable::GetHundredthsOfDegree()
+{
+  struct Table : AzimuthLookupTable
+  {
+    Table()
+    {
+      this->Cos.resize(NumberOfAngles);
+      this->Sin.resize(NumberOfAngles);
+      for (int i = 0; i < NumberOfAngles; i++)
+      {
+        const double rad = (i / 100.0) * vtkMath::Pi() / 180.0;
+        this->Cos[i] = std::cos(rad);
+        this->Sin[i] = std::sin(rad);
+      }
+    }
+  };
+  static const Table table;
+  return table;
+}
+
+//-----------------------------------------------------------------------------
+void SphericalCropTest::Build(bool cropOutside, const double region[6],
+  vtkTransform* sensorTransform, int numberOfLasers, const double* laserOffset,
+  const double* laserVerticalAngle)
+{
+  this->CropOutside = cropOutside;
+  std::copy(region, region + 6, this->Region);
+
+  // A rotation followed by a translation moves the points by at most the length of the
+  // translation, and a translation alone keeps the bounds of the vertical angle as well
+  bool isRigid = true;
+  bool isTranslation = true;
+  double translation = 0;
+  if (sensorTransform)
+  {
+    vtkMatrix4x4* matrix = sensorTransform->GetMatrix();
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        const double identity = i == j ? 1.0 : 0.0;
+        double dot = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+          dot += matrix->GetElement(k, i) * matrix->GetElement(k, j);
+        }
+        isRigid &= std::abs(dot - identity) < 1e-12;
+        isTranslation &= matrix->GetElement(i, j) == identity;
+      }
+      translation += matrix->GetElement(i, 3) * matrix->GetElement(i, 3);
+    }
+    translation = std::sqrt(translation);
+  }
+  this->HasDistanceBounds = isRigid;
+
+  // margins for the rounding errors of the exact test, in meter and degree
+  const double distanceEpsilon = 1e-6;
+  const double angleEpsilon = 1e-7;
+  for (int i = 0; i < MaximumNumberOfLasers; ++i)
+  {
+    this->DistanceMargin[i] = 0;
+    this->VerticalAngleDecision[i] = 0;
+    this->VerticalAngleMinDistance[i] = 0;
+    if (i >= numberOfLasers)
+    {
+      continue;
+    }
+    const double offset = laserOffset[i] + translation + distanceEpsilon;
+    this->DistanceMargin[i] = offset;
+    if (!isTranslation)
+    {
+      continue;
+    }
+
+    // the vertical angle of a return at distance d differs from the one of its laser by at
+    // most asin(offset / d)
+    const double angle = laserVerticalAngle[i];
+    const double insideMargin = std::min(angle - this->Region[2], this->Region[3] - angle);
+    const double margin = std::abs(insideMargin) - angleEpsilon;
+    if (margin <= 0)
+    {
+      continue;
+    }
+    this->VerticalAngleDecision[i] = insideMargin > 0 ? 1 : -1;
+    this->VerticalAngleMinDistance[i] =
+      margin >= 90.0 ? offset : offset / std::sin(vtkMath::RadiansFromDegrees(margin));
+  }
+}
+
+//-----------------------------------------------------------------------------
+const char* const RangeImageBuilder::DimensionsName = "range_image_dimensions";
+const char* const RangeImageBuilder::RangeName = "range_image";
+const char* const RangeImageBuilder::IntensityName = "intensity_image";
+const char* const RangeImageBuilder::TimeName = "adjustedtime_image";
+
+//-----------------------------------------------------------------------------
+void RangeImageBuilder::Reset(int width, const std::vector<double>& laserVerticalAngle)
+{
+  this->Width = width;
+  this->Height = static_cast<int>(laserVerticalAngle.size());
+  std::vector<std::pair<double, int> > sorted(this->Height);
+  for (int laser = 0; laser < this->Height; ++laser)
+  {
+    sorted[laser] = std::make_pair(laserVerticalAngle[laser], laser);
+  }
+  std::sort(sorted.begin(), sorted.end());
+  this->Rows.resize(this->Height);
+  for (int row = 0; row < this->Height; ++row)
+  {
+    this->Rows[sorted[row].second] = row;
+  }
+
+  const vtkIdType numberOfPixels = static_cast<vtkIdType>(this->Width) * this->Height;
+  this->Range = vtkSmartPointer<vtkFloatArray>::New();
+  this->Range->SetName(RangeName);
+  this->Range->SetNumberOfValues(numberOfPixels);
+  std::fill_n(this->Range->GetPointer(0), numberOfPixels, 0.f);
+  this->Intensity = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  this->Intensity->SetName(IntensityName);
+  this->Intensity->SetNumberOfValues(numberOfPixels);
+  std::fill_n(this->Intensity->GetPointer(0), numberOfPixels, 0);
+  this->Time = vtkSmartPointer<vtkDoubleArray>::New();
+  this->Time->SetName(TimeName);
+  this->Time->SetNumberOfValues(numberOfPixels);
+  std::fill_n(this->Time->GetPointer(0), numberOfPixels, 0.);
+  this->Filled.assign(numberOfPixels, 0);
+  this->NumberOfReturns = 0;
+}
+
+//-----------------------------------------------------------------------------
+void RangeImageBuilder::Clear()
+{
+  this->Width = 0;
+  this->Height = 0;
+  this->Range = nullptr;
+  this->Intensity = nullptr;
+  this->Time = nullptr;
+  this->Filled.clear();
+  this->NumberOfReturns = 0;
+}
+
+//-----------------------------------------------------------------------------
+void RangeImageBuilder::Append(const RangeImageBuilder& other, double timeShift)
+{
+  if (other.IsEmpty() || other.NumberOfReturns == 0)
+  {
+    return;
+  }
+  if (this->IsEmpty())
+  {
+    // sorting the rows by themselves gives them back
+    std::vector<double> rank(other.Rows.begin(), other.Rows.end());
+    this->Reset(other.Width, rank);
+  }
+  const vtkIdType numberOfPixels = static_cast<vtkIdType>(this->Width) * this->Height;
+  for (vtkIdType pixel = 0; pixel < numberOfPixels; ++pixel)
+  {
+    if (other.Filled[pixel])
+    {
+      this->Range->GetPointer(0)[pixel] = other.Range->GetPointer(0)[pixel];
+      this->Intensity->GetPointer(0)[pixel] = other.Intensity->GetPointer(0)[pixel];
+      this->Time->GetPointer(0)[pixel] = other.Time->GetPointer(0)[pixel] + timeShift;
+      this->Filled[pixel] = 1;
+    }
+  }
+  this->NumberOfReturns += other.NumberOfReturns;
+}
+
+//-----------------------------------------------------------------------------
+void RangeImageBuilder::AddTo(vtkFieldData* fieldData) const
+{
+  if (this->IsEmpty())
+  {
+    return;
+  }
+  vtkNew<vtkIntArray> dimensions;
+  dimensions->SetName(DimensionsName);
+  dimensions->SetNumberOfValues(2);
+  dimensions->SetValue(0, this->Width);
+  dimensions->SetValue(1, this->Height);
+  fieldData->AddArray(dimensions.GetPointer());
+  fieldData->AddArray(this->Range);
+  fieldData->AddArray(this->Intensity);
+  fieldData->AddArray(this->Time);
+}
+
+//-----------------------------------------------------------------------------
+const char* const ScanLineIndex::OffsetsName = "scan_line_offsets";
+const char* const ScanLineIndex::PointsName = "scan_line_points";
+
+//-----------------------------------------------------------------------------
+void ScanLineIndex::AddTo(vtkFieldData* fieldData, const unsigned char* laserIds,
+  vtkIdType numberOfPoints, int numberOfLasers)
+{
+  // counting sort of the points by laser, which keeps their order in a laser
+  std::vector<int> counts(256 + 1, 0);
+  for (vtkIdType id = 0; id < numberOfPoints; ++id)
+  {
+    counts[laserIds[id] + 1]++;
+  }
+  int size = std::max(std::min(numberOfLasers, 256), 0);
+  for (int laser = size; laser < 256; ++laser)
+  {
+    if (counts[laser + 1] > 0)
+    {
+      size = laser + 1;
+    }
+  }
+
+  vtkNew<vtkIntArray> offsets;
+  offsets->SetName(OffsetsName);
+  offsets->SetNumberOfValues(size + 1);
+  int* offset = offsets->GetPointer(0);
+  std::partial_sum(counts.begin(), counts.begin() + size + 1, offset);
+
+  vtkNew<vtkIntArray> points;
+  points->SetName(PointsName);
+  points->SetNumberOfValues(numberOfPoints);
+  int* point = points->GetPointer(0);
+  std::vector<int> next(offset, offset + size);
+  for (vtkIdType id = 0; id < numberOfPoints; ++id)
+  {
+    point[next[laserIds[id]]++] = static_cast<int>(id);
+  }
+
+  fieldData->AddArray(offsets.GetPointer());
+  fieldData->AddArray(points.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+bool ScanLineIndex::Get(vtkPolyData* frame, vtkIntArray*& offsets, vtkIntArray*& points)
+{
+  vtkFieldData* fieldData = frame->GetFieldData();
+  offsets = vtkIntArray::SafeDownCast(fieldData->GetArray(OffsetsName));
+  points = vtkIntArray::SafeDownCast(fieldData->GetArray(PointsName));
+  // the field data is passed by the filters which remove points, the index is then stale
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+  return offsets && points && offsets->GetNumberOfValues() > 1 &&
+    points->GetNumberOfValues() == numberOfPoints &&
+    offsets->GetValue(offsets->GetNumberOfValues() - 1) == numberOfPoints;
+}
+
+//-----------------------------------------------------------------------------
+const char* const DualReturnSelection::MaskName = "dual_return_selected";
+
+//-----------------------------------------------------------------------------
+void DualReturnSelection::Clear()
+{
+  this->Keys.clear();
+  this->NumberOfKeys = 0;
+}
+
+//-----------------------------------------------------------------------------
+void DualReturnSelection::Add(
+  unsigned char laserId, unsigned short azimuth, bool isSecondReturn, int tolerance)
+{
+  if (this->Keys.empty())
+  {
+    this->Keys.resize((2 * NumberOfLasers * NumberOfAzimuths + 63) / 64, 0);
+  }
+  tolerance = std::min(std::max(tolerance, 0), NumberOfAzimuths / 2 - 1);
+  for (int delta = -tolerance; delta <= tolerance; ++delta)
+  {
+    // the azimuths wrap around at 360 degrees
+    const int bin = (azimuth % NumberOfAzimuths + delta + NumberOfAzimuths) % NumberOfAzimuths;
+    const size_t key = GetKey(laserId, bin, isSecondReturn);
+    vtkTypeUInt64& word = this->Keys[key / 64];
+    const vtkTypeUInt64 bit = vtkTypeUInt64(1) << (key % 64);
+    if (!(word & bit))
+    {
+      word |= bit;
+      this->NumberOfKeys++;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType DualReturnSelection::Mark(const unsigned char* laserIds,
+  const unsigned short* azimuths, const vtkIdType* matching, vtkIdType numberOfPoints,
+  unsigned char* mask) const
+{
+  std::fill(mask, mask + numberOfPoints, 0);
+  if (this->IsEmpty())
+  {
+    return 0;
+  }
+  vtkIdType numberOfMarked = 0;
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    const vtkIdType dual = matching[i];
+    if (dual >= 0 && dual < numberOfPoints && !mask[dual] &&
+      this->Contains(laserIds[i], azimuths[i], dual < i))
+    {
+      mask[dual] = 1;
+      numberOfMarked++;
+    }
+  }
+  return numberOfMarked;
+}
+
+//-----------------------------------------------------------------------------
+const double LaserStatistics::DistanceBinBounds[LaserStatistics::NumberOfDistanceBins - 1] = {
+  1., 2., 5., 10., 20., 50., 100.
+};
+const char* const LaserStatistics::LaserCountsName = "laser_statistics_counts";
+const char* const LaserStatistics::LaserIntensitiesName = "laser_statistics_intensities";
+const char* const LaserStatistics::LaserDistancesName = "laser_statistics_distances";
+const char* const LaserStatistics::AzimuthCountsName = "azimuth_statistics_counts";
+const char* const LaserStatistics::AzimuthIntensitiesName = "azimuth_statistics_intensities";
+const char* const LaserStatistics::AzimuthDistancesName = "azimuth_statistics_distances";
+
+namespace
+{
+//-----------------------------------------------------------------------------
+template<typename ArrayType, typename T>
+void AddStatisticsArray(
+  vtkFieldData* fieldData, const char* name, const std::vector<T>& values, int numberOfComponents)
+{
+  vtkNew<ArrayType> array;
+  array->SetName(name);
+  array->SetNumberOfComponents(numberOfComponents);
+  array->SetNumberOfTuples(static_cast<vtkIdType>(values.size() / numberOfComponents));
+  std::copy(values.begin(), values.end(), array->GetPointer(0));
+  fieldData->AddArray(array.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+void AddGroupArrays(vtkFieldData* fieldData, const LaserStatistics::Group& group,
+  const char* countsName, const char* intensitiesName, const char* distancesName)
+{
+  AddStatisticsArray<vtkIdTypeArray>(fieldData, countsName, group.Counts, 3);
+  AddStatisticsArray<vtkDoubleArray>(fieldData, intensitiesName, group.Intensities, 2);
+  AddStatisticsArray<vtkIdTypeArray>(
+    fieldData, distancesName, group.Distances, LaserStatistics::NumberOfDistanceBins);
+}
+
+//-----------------------------------------------------------------------------
+// Read the arrays of a group, the group is resized if it is empty
+bool ReadGroupArrays(vtkFieldData* fieldData, LaserStatistics::Group& group,
+  const char* countsName, const char* intensitiesName, const char* distancesName)
+{
+  vtkIdTypeArray* counts = vtkIdTypeArray::SafeDownCast(fieldData->GetArray(countsName));
+  vtkDoubleArray* intensities = vtkDoubleArray::SafeDownCast(fieldData->GetArray(intensitiesName));
+  vtkIdTypeArray* distances = vtkIdTypeArray::SafeDownCast(fieldData->GetArray(distancesName));
+  if (!counts || !intensities || !distances || counts->GetNumberOfComponents() != 3 ||
+    intensities->GetNumberOfComponents() != 2 ||
+    distances->GetNumberOfComponents() != LaserStatistics::NumberOfDistanceBins)
+  {
+    return false;
+  }
+  const vtkIdType size = counts->GetNumberOfTuples();
+  if (intensities->GetNumberOfTuples() != size || distances->GetNumberOfTuples() != size)
+  {
+    return false;
+  }
+  LaserStatistics::Group other;
+  other.Counts.assign(counts->GetPointer(0), counts->GetPointer(0) + 3 * size);
+  other.Intensities.assign(intensities->GetPointer(0), intensities->GetPointer(0) + 2 * size);
+  other.Distances.assign(distances->GetPointer(0),
+    distances->GetPointer(0) + LaserStatistics::NumberOfDistanceBins * size);
+  if (group.Counts.empty())
+  {
+    group.Resize(static_cast<int>(size));
+  }
+  if (group.GetSize() != size)
+  {
+    return false;
+  }
+  group.Append(other);
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+void LaserStatistics::Group::Resize(int size)
+{
+  this->Counts.assign(3 * size, 0);
+  this->Intensities.assign(2 * size, 0.);
+  this->Distances.assign(NumberOfDistanceBins * size, 0);
+}
+
+//-----------------------------------------------------------------------------
+void LaserStatistics::Group::Clear()
+{
+  std::fill(this->Counts.begin(), this->Counts.end(), 0);
+  std::fill(this->Intensities.begin(), this->Intensities.end(), 0.);
+  std::fill(this->Distances.begin(), this->Distances.end(), 0);
+}
+
+//-----------------------------------------------------------------------------
+void LaserStatistics::Group::Append(const Group& other)
+{
+  for (size_t i = 0; i < this->Counts.size(); ++i)
+  {
+    this->Counts[i] += other.Counts[i];
+  }
+  for (size_t i = 0; i < this->Intensities.size(); i += 2)
+  {
+    this->Intensities[i] += other.Intensities[i];
+    this->Intensities[i + 1] = std::max(this->Intensities[i + 1], other.Intensities[i + 1]);
+  }
+  for (size_t i = 0; i < this->Distances.size(); ++i)
+  {
+    this->Distances[i] += other.Distances[i];
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LaserStatistics::Reset(int numberOfLasers, int numberOfSlots, double distanceResolution)
+{
+  this->Lasers.Resize(numberOfLasers);
+  this->AzimuthBins.Resize(NumberOfAzimuthBins);
+  this->FirstReturns.assign(numberOfSlots, 0);
+  this->DistanceResolution = distanceResolution;
+  for (int i = 0; i < NumberOfDistanceBins - 1; ++i)
+  {
+    this->DistanceBounds[i] =
+      static_cast<unsigned int>(std::ceil(DistanceBinBounds[i] / distanceResolution));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void LaserStatistics::Clear()
+{
+  this->Lasers.Clear();
+  this->AzimuthBins.Clear();
+}
+
+//-----------------------------------------------------------------------------
+void LaserStatistics::Append(const LaserStatistics& other)
+{
+  if (other.IsEmpty())
+  {
+    return;
+  }
+  if (this->IsEmpty())
+  {
+    *this = other;
+    return;
+  }
+  if (this->Lasers.GetSize() != other.Lasers.GetSize())
+  {
+    return;
+  }
+  this->Lasers.Append(other.Lasers);
+  this->AzimuthBins.Append(other.AzimuthBins);
+  this->FirstReturns = other.FirstReturns;
+}
+
+//-----------------------------------------------------------------------------
+void LaserStatistics::AddTo(vtkFieldData* fieldData) const
+{
+  if (this->IsEmpty())
+  {
+    return;
+  }
+  AddGroupArrays(
+    fieldData, this->Lasers, LaserCountsName, LaserIntensitiesName, LaserDistancesName);
+  AddGroupArrays(
+    fieldData, this->AzimuthBins, AzimuthCountsName, AzimuthIntensitiesName, AzimuthDistancesName);
+}
+
+//-----------------------------------------------------------------------------
+bool LaserStatistics::Add(vtkFieldData* fieldData)
+{
+  if (!fieldData)
+  {
+    return false;
+  }
+  LaserStatistics other;
+  if (!ReadGroupArrays(
+        fieldData, other.Lasers, LaserCountsName, LaserIntensitiesName, LaserDistancesName) ||
+    !ReadGroupArrays(fieldData, other.AzimuthBins, AzimuthCountsName, AzimuthIntensitiesName,
+      AzimuthDistancesName) ||
+    other.AzimuthBins.GetSize() != NumberOfAzimuthBins)
+  {
+    return false;
+  }
+  if (!this->IsEmpty() && this->Lasers.GetSize() != other.Lasers.GetSize())
+  {
+    return false;
+  }
+  this->Append(other);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void LaserStatistics::FillTable(vtkTable* table) const
+{
+  table->Initialize();
+  const int numberOfLasers = this->Lasers.GetSize();
+  const int numberOfBins = this->IsEmpty() ? 0 : NumberOfAzimuthBins;
+  const vtkIdType numberOfRows = numberOfLasers + numberOfBins;
+
+  vtkNew<vtkIntArray> laserId;
+  laserId->SetName("laser_id");
+  vtkNew<vtkDoubleArray> azimuth;
+  azimuth->SetName("azimuth");
+  vtkNew<vtkIdTypeArray> returns;
+  returns->SetName("returns");
+  vtkNew<vtkIdTypeArray> zeroReturns;
+  zeroReturns->SetName("zero_returns");
+  vtkNew<vtkDoubleArray> zeroReturnRate;
+  zeroReturnRate->SetName("zero_return_rate");
+  vtkNew<vtkDoubleArray> meanIntensity;
+  meanIntensity->SetName("mean_intensity");
+  vtkNew<vtkDoubleArray> maxIntensity;
+  maxIntensity->SetName("max_intensity");
+  vtkNew<vtkDoubleArray> dualReturnRatio;
+  dualReturnRatio->SetName("dual_return_ratio");
+  vtkNew<vtkIdTypeArray> distanceHistogram;
+  distanceHistogram->SetName("distance_histogram");
+  distanceHistogram->SetNumberOfComponents(NumberOfDistanceBins);
+  vtkDataArray* columns[] = { laserId.GetPointer(), azimuth.GetPointer(), returns.GetPointer(),
+    zeroReturns.GetPointer(), zeroReturnRate.GetPointer(), meanIntensity.GetPointer(),
+    maxIntensity.GetPointer(), dualReturnRatio.GetPointer(), distanceHistogram.GetPointer() };
+  for (vtkDataArray* column : columns)
+  {
+    column->SetNumberOfTuples(numberOfRows);
+  }
+
+  for (vtkIdType row = 0; row < numberOfRows; ++row)
+  {
+    const bool isLaser = row < numberOfLasers;
+    const Group& group = isLaser ? this->Lasers : this->AzimuthBins;
+    const vtkIdType index = isLaser ? row : row - numberOfLasers;
+    const vtkIdType* counts = &group.Counts[3 * index];
+    const double* intensities = &group.Intensities[2 * index];
+    const vtkIdType nonZero = counts[0] - counts[1];
+
+    laserId->SetValue(row, isLaser ? static_cast<int>(index) : -1);
+    azimuth->SetValue(row, isLaser ? -1. : 360. * index / NumberOfAzimuthBins);
+    returns->SetValue(row, counts[0]);
+    zeroReturns->SetValue(row, counts[1]);
+    zeroReturnRate->SetValue(row, counts[0] > 0 ? static_cast<double>(counts[1]) / counts[0] : 0.);
+    meanIntensity->SetValue(row, nonZero > 0 ? intensities[0] / nonZero : 0.);
+    maxIntensity->SetValue(row, intensities[1]);
+    dualReturnRatio->SetValue(row, counts[0] > 0 ? static_cast<double>(counts[2]) / counts[0] : 0.);
+    std::copy(&group.Distances[NumberOfDistanceBins * index],
+      &group.Distances[NumberOfDistanceBins * index] + NumberOfDistanceBins,
+      distanceHistogram->GetPointer(NumberOfDistanceBins * row));
+  }
+
+  for (vtkDataArray* column : columns)
+  {
+    table->AddColumn(column);
+  }
+}
@@ -0,0 +1,582 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef LIDAR_DECODING_KERNELS_H
+#define LIDAR_DECODING_KERNELS_H
+
+// VTK
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+class vtkCellArray;
+class vtkFieldData;
+class vtkIntArray;
+class vtkTable;
+class vtkTransform;
+
+// Building blocks of the packet interpreters: they do not depend on the packet format of a
+// vendor, so that a new interpreter gets the same performance as the Velodyne one without
+// deriving them again.
+
+//-----------------------------------------------------------------------------
+// One vertex cell per point, the cells of a frame. The connectivity is not built for each
+// frame, all the frames share the one of the largest frame, so it must not be modified.
+vtkSmartPointer<vtkCellArray> NewVertexCells(vtkIdType numberOfVerts);
+
+//-----------------------------------------------------------------------------
+// Create a named array of np values with room for prereserved_np values, added to pd if any
+template<typename T>
+vtkSmartPointer<T> CreateDataArray(const char* name, vtkIdType np, vtkIdType prereserved_np, vtkPolyData* pd)
+{
+  vtkSmartPointer<T> array = vtkSmartPointer<T>::New();
+  array->Allocate(prereserved_np);
+  array->SetName(name);
+  if (np > 0)
+  {
+    array->SetNumberOfTuples(np);
+  }
+  if (pd)
+  {
+    pd->GetPointData()->AddArray(array);
+  }
+
+  return array;
+}
+
+//-----------------------------------------------------------------------------
+// Same as CreateDataArray, with a vtkFloatArray or a vtkDoubleArray
+inline vtkSmartPointer<vtkDataArray> CreateRealDataArray(bool singlePrecision, const char* name, vtkIdType np, vtkIdType prereserved_np, vtkPolyData* pd)
+{
+  if (singlePrecision)
+  {
+    return CreateDataArray<vtkFloatArray>(name, np, prereserved_np, pd);
+  }
+  return CreateDataArray<vtkDoubleArray>(name, np, prereserved_np, pd);
+}
+
+//-----------------------------------------------------------------------------
+// Give a malloc'ed buffer of capacity values to an array holding numberOfValues values.
+// The array reports the whole buffer in its memory size.
+template<typename ArrayT, typename T>
+void GiveBuffer(ArrayT* array, T* data, vtkIdType capacity, vtkIdType numberOfValues)
+{
+  capacity -= capacity % array->GetNumberOfComponents();
+  array->SetArray(data, capacity, 0, vtkAbstractArray::VTK_DATA_ARRAY_FREE);
+  // this does not reallocate as the array is large enough
+  array->SetNumberOfValues(numberOfValues);
+}
+
+//-----------------------------------------------------------------------------
+// Take the buffer of an array which is not shared, the array is left empty
+inline void* TakeBuffer(vtkDataArray* array, size_t& bytes)
+{
+  if (!array || array->GetReferenceCount() != 1 || !array->GetVoidPointer(0))
+  {
+    return nullptr;
+  }
+  void* data = array->GetVoidPointer(0);
+  bytes = static_cast<size_t>(array->GetSize()) * array->GetDataTypeSize();
+  // the array forgets the buffer without freeing it
+  array->SetVoidArray(data, array->GetSize(), 1);
+  array->Initialize();
+  return data;
+}
+
+//-----------------------------------------------------------------------------
+// One array of the frame under construction. The values are written in a plain
+// malloc'ed buffer, which is given to the vtk array without copy when the
+// frame is split.
+template<typename T>
+struct FrameColumn
+{
+  T* Data = nullptr;
+  // size of the buffer, which is never shrunk so that a recycled buffer can be reused as is
+  size_t Bytes = 0;
+
+  FrameColumn() = default;
+  FrameColumn(const FrameColumn&) = delete;
+  FrameColumn& operator=(const FrameColumn&) = delete;
+  ~FrameColumn() { std::free(this->Data); }
+
+  void Reallocate(vtkIdType numberOfValues)
+  {
+    const size_t bytes = sizeof(T) * std::max<vtkIdType>(numberOfValues, 1);
+    if (this->Data && bytes <= this->Bytes)
+    {
+      return;
+    }
+    void* data = std::realloc(this->Data, bytes);
+    if (!data)
+    {
+      throw std::bad_alloc();
+    }
+    this->Data = static_cast<T*>(data);
+    this->Bytes = bytes;
+  }
+
+  // Use the buffer of a frame which has been released, see FrameRecycler
+  void Adopt(void* data, size_t bytes)
+  {
+    std::free(this->Data);
+    this->Data = static_cast<T*>(data);
+    this->Bytes = bytes;
+  }
+
+  template<typename ArrayT>
+  void Release(ArrayT* array, vtkIdType numberOfValues)
+  {
+    // the array takes the whole buffer, so that it can be recycled with its capacity
+    GiveBuffer(array, this->Data, this->Bytes / sizeof(T), numberOfValues);
+    this->Data = nullptr;
+    this->Bytes = 0;
+  }
+
+  // Same as Release, the values are converted to float, in place
+  void ReleaseAsFloat(vtkFloatArray* array, vtkIdType numberOfValues)
+  {
+    // the byte copies keep the compiler from reordering the overlapping reads and writes
+    char* bytes = reinterpret_cast<char*>(this->Data);
+    for (vtkIdType i = 0; i < numberOfValues; ++i)
+    {
+      T value;
+      std::memcpy(&value, bytes + i * sizeof(T), sizeof(T));
+      const float converted = static_cast<float>(value);
+      std::memcpy(bytes + i * sizeof(float), &converted, sizeof(float));
+    }
+    GiveBuffer(array, reinterpret_cast<float*>(this->Data), this->Bytes / sizeof(float),
+      numberOfValues);
+    this->Data = nullptr;
+    this->Bytes = 0;
+  }
+
+  // Copy the first numberOfValues values of another column at offset
+  void CopyFrom(const FrameColumn& other, vtkIdType offset, vtkIdType numberOfValues)
+  {
+    std::copy(other.Data, other.Data + numberOfValues, this->Data + offset);
+  }
+
+  // Release to a vtkFloatArray or a vtkDoubleArray
+  void ReleaseReal(vtkDataArray* array, vtkIdType numberOfValues)
+  {
+    if (vtkFloatArray* floatArray = vtkFloatArray::SafeDownCast(array))
+    {
+      this->ReleaseAsFloat(floatArray, numberOfValues);
+    }
+    else
+    {
+      this->Release(vtkDoubleArray::SafeDownCast(array), numberOfValues);
+    }
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Give the buffer of an array which is not used anymore to a column which has none
+template<typename T>
+void RecycleColumn(FrameColumn<T>& column, vtkDataArray* array)
+{
+  if (column.Data)
+  {
+    return;
+  }
+  size_t bytes = 0;
+  if (void* data = TakeBuffer(array, bytes))
+  {
+    column.Adopt(data, bytes);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Copy numberOfTuples tuples of a column from the tuple first to a new array with the type,
+// name and number of components of model, added to pd if any. The column keeps its buffer, this
+// is used to give a part of the frame under construction.
+template<typename T>
+vtkSmartPointer<vtkDataArray> CopyColumnRange(const FrameColumn<T>& column, vtkIdType first, vtkIdType numberOfTuples,
+  vtkDataArray* model, vtkPolyData* pd)
+{
+  vtkSmartPointer<vtkDataArray> array = vtkSmartPointer<vtkDataArray>::Take(model->NewInstance());
+  array->SetName(model->GetName());
+  const int components = model->GetNumberOfComponents();
+  array->SetNumberOfComponents(components);
+  array->SetNumberOfTuples(numberOfTuples);
+  const T* begin = column.Data + first * components;
+  const T* end = begin + numberOfTuples * components;
+  if (vtkFloatArray* floatArray = vtkFloatArray::SafeDownCast(array))
+  {
+    // the real columns are converted like ReleaseReal does
+    std::copy(begin, end, floatArray->GetPointer(0));
+  }
+  else
+  {
+    std::copy(begin, end, static_cast<T*>(array->GetVoidPointer(0)));
+  }
+  if (pd)
+  {
+    pd->GetPointData()->AddArray(array);
+  }
+  return array;
+}
+
+//-----------------------------------------------------------------------------
+// Cosine and sine of the azimuths, indexed by hundredths of degree from 0 to 360 degrees
+// included. The table is computed once and shared by all the interpreters.
+struct AzimuthLookupTable
+{
+  static const int NumberOfAngles = 36001;
+
+  std::vector<double> Cos;
+  std::vector<double> Sin;
+
+  static const AzimuthLookupTable& GetHundredthsOfDegree();
+};
+
+//-----------------------------------------------------------------------------
+// Conservative spherical crop test, evaluated before the position of a return
+// is computed. The position of a return is its corrected distance along the
+// direction of its laser, plus an offset which only depends on the laser, so
+// its distance to the origin and its vertical angle are bounded from the
+// corrected distance alone. The azimuth is tested as is by shouldBeCroppedOut.
+struct SphericalCropTest
+{
+  static const int MaximumNumberOfLasers = 128;
+
+  //! interpreter time the test has been built for, 0 to force an update
+  vtkMTimeType BuildTime = 0;
+
+  bool CropOutside = false;
+  double Region[6];
+
+  //! false if the sensor transform does not preserve the distances
+  bool HasDistanceBounds = false;
+  //! maximum difference between the distance to the origin and the corrected distance
+  double DistanceMargin[MaximumNumberOfLasers];
+
+  //! vertical angle decision of each laser: 1 inside the region, -1 outside, 0 undecided
+  signed char VerticalAngleDecision[MaximumNumberOfLasers];
+  //! the vertical angle decision holds for the returns further than this distance
+  double VerticalAngleMinDistance[MaximumNumberOfLasers];
+
+  /**
+   * @brief Build prepare the test of the returns of numberOfLasers lasers
+   * @param laserOffset norm of the offset between the position of a return of each laser and
+   * its corrected distance along the direction of the laser
+   * @param laserVerticalAngle vertical angle of each laser, in degree
+   */
+  void Build(bool cropOutside, const double region[6], vtkTransform* sensorTransform,
+    int numberOfLasers, const double* laserOffset, const double* laserVerticalAngle);
+
+  //! true if shouldBeCroppedOut would crop the return out, whatever its exact position
+  bool IsCroppedOut(double theta, int laser, double distanceM) const
+  {
+    // same convention as shouldBeCroppedOut: a point outside of the region is
+    // cropped unless CropOutside is set
+    // a point outside the region on one axis is outside of it
+    const bool outsideIsCropped = !this->CropOutside;
+    if (theta < this->Region[0] || theta > this->Region[1])
+    {
+      return outsideIsCropped;
+    }
+
+    const signed char verticalAngle = distanceM > this->VerticalAngleMinDistance[laser] ?
+      this->VerticalAngleDecision[laser] : 0;
+    if (verticalAngle < 0)
+    {
+      return outsideIsCropped;
+    }
+    bool inside = verticalAngle > 0;
+
+    if (!this->HasDistanceBounds)
+    {
+      return false;
+    }
+    const double distance = std::abs(distanceM);
+    const double minDistance = distance - this->DistanceMargin[laser];
+    const double maxDistance = distance + this->DistanceMargin[laser];
+    if (maxDistance < this->Region[4] || minDistance > this->Region[5])
+    {
+      return outsideIsCropped;
+    }
+    inside &= minDistance >= this->Region[4] && maxDistance <= this->Region[5];
+
+    // a point inside the region on all axes is inside of it
+    return inside && !outsideIsCropped;
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Range image of the frame under construction, see vtkLidarPacketInterpreter::RangeImageWidth.
+// The returns are written in it while they are decoded, so that the image based filters do not
+// have to project the point cloud. An empty pixel has a null range.
+struct RangeImageBuilder
+{
+  //! Names of the field data arrays of a frame holding its image, the dimensions being
+  //! the width and the height
+  static const char* const DimensionsName;
+  static const char* const RangeName;
+  static const char* const IntensityName;
+  static const char* const TimeName;
+
+  int Width = 0;
+  int Height = 0;
+  //! Row of each laser, the lasers being sorted by vertical angle
+  std::vector<int> Rows;
+  vtkSmartPointer<vtkFloatArray> Range;
+  vtkSmartPointer<vtkUnsignedCharArray> Intensity;
+  vtkSmartPointer<vtkDoubleArray> Time;
+  //! Indicate the pixels which have a return, a return may have a null range
+  std::vector<unsigned char> Filled;
+  vtkIdType NumberOfReturns = 0;
+
+  //! Start a new image whose height is the number of lasers
+  void Reset(int width, const std::vector<double>& laserVerticalAngle);
+
+  //! Forget the image, it is not reused as it may have been given to a frame
+  void Clear();
+
+  bool IsEmpty() const { return !this->Range; }
+
+  //! Write a return, the azimuth being in hundredths of degree in [0, 36000)
+  void AddReturn(int laser, unsigned int azimuth, double range, unsigned char intensity, double time)
+  {
+    if (laser < 0 || laser >= this->Height)
+    {
+      return;
+    }
+    const int column = std::min(static_cast<int>(azimuth * static_cast<unsigned int>(this->Width) / 36000u),
+      this->Width - 1);
+    const vtkIdType pixel = static_cast<vtkIdType>(this->Rows[laser]) * this->Width + column;
+    this->Range->GetPointer(0)[pixel] = static_cast<float>(range);
+    this->Intensity->GetPointer(0)[pixel] = intensity;
+    this->Time->GetPointer(0)[pixel] = time;
+    this->Filled[pixel] = 1;
+    this->NumberOfReturns++;
+  }
+
+  //! Write the returns of the image of a partition, decoded after this one, their time being
+  //! shifted by timeShift
+  void Append(const RangeImageBuilder& other, double timeShift);
+
+  //! Add the image to the field data of a frame, it must then be reset or cleared
+  void AddTo(vtkFieldData* fieldData) const;
+};
+
+//-----------------------------------------------------------------------------
+// Points of a frame grouped by laser, added to its field data by the interpreter which knows the
+// laser of each point, so that the filters working on the scan lines do not group the points
+// again. The points of a laser keep their firing order, which is the azimuth order of a spinning
+// sensor.
+struct ScanLineIndex
+{
+  //! Names of the field data arrays of a frame holding its index, the points of the laser l
+  //! being Points[Offsets[l], Offsets[l + 1]), there is one more offset than lasers
+  static const char* const OffsetsName;
+  static const char* const PointsName;
+
+  //! Add the index of the points whose laser ids are given to the field data of their frame,
+  //! there are at least numberOfLasers lasers in the index
+  static void AddTo(vtkFieldData* fieldData, const unsigned char* laserIds,
+    vtkIdType numberOfPoints, int numberOfLasers);
+
+  //! Get the index of a frame, false if it has none or if its points have been filtered since
+  static bool Get(vtkPolyData* frame, vtkIntArray*& offsets, vtkIntArray*& points);
+};
+
+//-----------------------------------------------------------------------------
+// Returns selected by their laser, their azimuth and their rank in their firing, which tell the
+// same returns apart in every frame, and whose dual returns are marked in the frames. The two
+// returns of a firing have the same laser and azimuth, the first one being decoded first has the
+// lowest point id. The selection is a bit per laser, hundredth of degree and rank, about 2 MB, so
+// that each return of a frame is looked up in constant time and its dual return found through
+// its dual_return_matching id.
+struct DualReturnSelection
+{
+  static const int NumberOfLasers = 256;
+  static const int NumberOfAzimuths = 36000;
+
+  //! Name of the point data array of a frame which is 1 for the dual returns of the selected
+  //! returns and 0 elsewhere
+  static const char* const MaskName;
+
+  void Clear();
+  bool IsEmpty() const { return this->NumberOfKeys == 0; }
+
+  //! Select the first or second returns of a laser within tolerance hundredths of degree of an
+  //! azimuth, as the azimuths of the firings drift from a rotation to the next
+  void Add(unsigned char laserId, unsigned short azimuth, bool isSecondReturn, int tolerance);
+
+  bool Contains(unsigned char laserId, unsigned short azimuth, bool isSecondReturn) const
+  {
+    const size_t key = GetKey(laserId, azimuth % NumberOfAzimuths, isSecondReturn);
+    return !this->Keys.empty() && ((this->Keys[key / 64] >> (key % 64)) & 1);
+  }
+
+  //! Bits of the selected keys, empty when no return was ever selected
+  const std::vector<vtkTypeUInt64>& GetKeys() const { return this->Keys; }
+
+  //! Set mask to 1 for the dual returns of the selected returns among numberOfPoints returns,
+  //! and to 0 for the others. matching holds the id of the dual return of each return, -1 for
+  //! the single returns, so that the single returns are never selected. Returns the number of
+  //! returns marked.
+  vtkIdType Mark(const unsigned char* laserIds, const unsigned short* azimuths,
+    const vtkIdType* matching, vtkIdType numberOfPoints, unsigned char* mask) const;
+
+private:
+  static size_t GetKey(unsigned char laserId, int azimuth, bool isSecondReturn)
+  {
+    return 2 * (static_cast<size_t>(laserId) * NumberOfAzimuths + azimuth) + isSecondReturn;
+  }
+
+  //! Bit of each key, allocated by the first selected return
+  std::vector<vtkTypeUInt64> Keys;
+  vtkIdType NumberOfKeys = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Statistics of the returns of the frame under construction, per laser and per azimuth bin,
+// gathered while the firings are decoded so that the health of a sensor is checked without
+// going through the points. They count the returns given by the sensor, before the laser
+// selection, the crop and the removal of the null distances, a dual return being a second
+// return which differs from the first one of its firing.
+struct LaserStatistics
+{
+  static const int NumberOfAzimuthBins = 36;
+  //! The distances are counted in [0, 1), [1, 2), [2, 5), [5, 10), [10, 20), [20, 50),
+  //! [50, 100) and [100, +inf) meters, the null distances not being counted
+  static const int NumberOfDistanceBins = 8;
+  static const double DistanceBinBounds[NumberOfDistanceBins - 1];
+
+  //! Names of the field data arrays of a frame holding its statistics, the counts having the
+  //! returns, null returns and dual returns as components, the intensities the sum and the
+  //! maximum of the intensities of the returns which are not null
+  static const char* const LaserCountsName;
+  static const char* const LaserIntensitiesName;
+  static const char* const LaserDistancesName;
+  static const char* const AzimuthCountsName;
+  static const char* const AzimuthIntensitiesName;
+  static const char* const AzimuthDistancesName;
+
+  //! Accumulated values of the lasers or of the azimuth bins
+  struct Group
+  {
+    std::vector<vtkIdType> Counts;
+    std::vector<double> Intensities;
+    std::vector<vtkIdType> Distances;
+
+    int GetSize() const { return static_cast<int>(this->Counts.size() / 3); }
+    void Resize(int size);
+    void Clear();
+    void Append(const Group& other);
+
+    void AddReturn(int index, int distanceBin, unsigned char intensity)
+    {
+      vtkIdType* counts = &this->Counts[3 * index];
+      counts[0]++;
+      if (distanceBin < 0)
+      {
+        counts[1]++;
+        return;
+      }
+      double* intensities = &this->Intensities[2 * index];
+      intensities[0] += intensity;
+      intensities[1] = std::max(intensities[1], static_cast<double>(intensity));
+      this->Distances[index * NumberOfDistanceBins + distanceBin]++;
+    }
+  };
+
+  Group Lasers;
+  Group AzimuthBins;
+  //! Last first return of each return slot, see AddReturn
+  std::vector<unsigned int> FirstReturns;
+  //! Bounds of the distance bins, in distance units
+  unsigned int DistanceBounds[NumberOfDistanceBins - 1];
+  double DistanceResolution = 0;
+
+  //! Start counting, the lasers being numbered from 0 to numberOfLasers - 1
+  void Reset(int numberOfLasers, int numberOfSlots, double distanceResolution);
+
+  //! Set the counts to zero, the sizes being kept
+  void Clear();
+
+  bool IsEmpty() const { return this->Lasers.Counts.empty(); }
+
+  //! Count a return, the azimuth being in hundredths of degree in [0, 36000) and the distance
+  //! in distance units. The slot identifies the laser in its firing block, the second return of
+  //! a dual return firing being compared with the first return of its slot.
+  void AddReturn(int laser, int slot, unsigned int azimuth, unsigned int distance,
+    unsigned char intensity, bool isSecondReturn)
+  {
+    const unsigned int value = (distance << 8) | intensity;
+    const int bin = std::min(static_cast<int>(azimuth * NumberOfAzimuthBins / 36000u),
+      NumberOfAzimuthBins - 1);
+    const bool hasLaser = laser >= 0 && laser < this->Lasers.GetSize();
+    if (isSecondReturn)
+    {
+      if (value != this->FirstReturns[slot])
+      {
+        this->AzimuthBins.Counts[3 * bin + 2]++;
+        if (hasLaser)
+        {
+          this->Lasers.Counts[3 * laser + 2]++;
+        }
+      }
+      return;
+    }
+    this->FirstReturns[slot] = value;
+
+    int distanceBin = -1;
+    if (distance != 0)
+    {
+      distanceBin = 0;
+      while (distanceBin < NumberOfDistanceBins - 1 && distance >= this->DistanceBounds[distanceBin])
+      {
+        distanceBin++;
+      }
+    }
+    this->AzimuthBins.AddReturn(bin, distanceBin, intensity);
+    if (hasLaser)
+    {
+      this->Lasers.AddReturn(laser, distanceBin, intensity);
+    }
+  }
+
+  //! Count the returns of a partition, decoded after this one
+  void Append(const LaserStatistics& other);
+
+  //! Add the statistics to the field data of a frame, they must then be cleared
+  void AddTo(vtkFieldData* fieldData) const;
+
+  //! Add the statistics stored in the field data of a frame, e.g. to aggregate several frames
+  //! @return false if the frame has no statistics or if they do not match the previous ones
+  bool Add(vtkFieldData* fieldData);
+
+  //! Write the statistics in a table with a row per laser followed by a row per azimuth bin.
+  //! The laser_id of the azimuth bins and the azimuth of the lasers are -1.
+  void FillTable(vtkTable* table) const;
+};
+
+#endif // LIDAR_DECODING_KERNELS_H
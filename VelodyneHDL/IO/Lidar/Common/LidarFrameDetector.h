@@ -0,0 +1,78 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef LIDAR_FRAME_DETECTOR_H
+#define LIDAR_FRAME_DETECTOR_H
+
+// STD
+#include <vector>
+
+/**
+ * \class LidarFrameDetector
+ * \brief Lightweight frame split detector used to build the frame index on several threads.
+ *        It does the same work as vtkLidarPacketInterpreter::PreProcessPacket, but all its state
+ *        is local to the detector and it has no side effect on the interpreter which created it,
+ *        so that several detectors can process different parts of a pcap concurrently.
+ *        Contrary to PreProcessPacket, every split is reported, even when the frame which ends is
+ *        empty: the caller is responsible to apply IgnoreEmptyFrames, as the content of a frame
+ *        can span several parts of the file.
+ */
+class LidarFrameDetector
+{
+public:
+  virtual ~LidarFrameDetector() = default;
+
+  /**
+   * @brief IsLidarPacket same as vtkLidarPacketInterpreter::IsLidarPacket
+   * @param data raw data packet
+   * @param dataLength size of the data packet
+   */
+  virtual bool IsLidarPacket(unsigned char const* data, unsigned int dataLength) = 0;
+
+  //! A frame split found in a packet
+  struct Split
+  {
+    //! offset of the new frame in the packet
+    int PositionInPacket;
+    //! true if the frame that ends here contains some valid data since the previous split or
+    //! the last call to ResetContent
+    bool HasContent;
+  };
+
+  /**
+   * @brief DetectFrame look for the frame splits in a lidar packet
+   * @param data raw data packet
+   * @param dataLength size of the data packet
+   * @param splits[out] all the splits found in the packet, in order
+   */
+  virtual void DetectFrame(
+    unsigned char const* data, unsigned int dataLength, std::vector<Split>& splits) = 0;
+
+  /**
+   * @brief HasContent indicate if some valid data has been seen since the last split or
+   * the last call to ResetContent
+   */
+  virtual bool HasContent() = 0;
+
+  /**
+   * @brief ResetContent forget about the data seen since the last split, the state used to detect
+   * the splits is kept
+   */
+  virtual void ResetContent() = 0;
+};
+
+#endif // LIDAR_FRAME_DETECTOR_H
@@ -0,0 +1,90 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "LidarInterpreterRegistry.h"
+
+//-----------------------------------------------------------------------------
+LidarInterpreterRegistry& LidarInterpreterRegistry::GetInstance()
+{
+  static LidarInterpreterRegistry registry;
+  return registry;
+}
+
+//-----------------------------------------------------------------------------
+void LidarInterpreterRegistry::Register(const std::string& name, Factory factory)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  for (Entry& entry : this->Entries)
+  {
+    if (entry.Name == name)
+    {
+      entry.Create = factory;
+      entry.Prototype = nullptr;
+      return;
+    }
+  }
+  Entry entry = { name, factory, nullptr };
+  this->Entries.push_back(entry);
+}
+
+//-----------------------------------------------------------------------------
+std::vector<std::string> LidarInterpreterRegistry::GetNames()
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  std::vector<std::string> names;
+  for (const Entry& entry : this->Entries)
+  {
+    names.push_back(entry.Name);
+  }
+  return names;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkLidarPacketInterpreter> LidarInterpreterRegistry::Create(
+  const std::string& name)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  for (const Entry& entry : this->Entries)
+  {
+    if (entry.Name == name)
+    {
+      vtkSmartPointer<vtkLidarPacketInterpreter> interpreter;
+      interpreter.TakeReference(entry.Create());
+      return interpreter;
+    }
+  }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+std::string LidarInterpreterRegistry::Detect(unsigned char const* data, unsigned int dataLength)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  for (Entry& entry : this->Entries)
+  {
+    if (!entry.Prototype)
+    {
+      entry.Prototype.TakeReference(entry.Create());
+    }
+    if (entry.Prototype->HasPacketSignature(data, dataLength))
+    {
+      return entry.Name;
+    }
+  }
+  return std::string();
+}
@@ -0,0 +1,108 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef LIDAR_INTERPRETER_REGISTRY_H
+#define LIDAR_INTERPRETER_REGISTRY_H
+
+// LOCAL
+#include "vtkLidarPacketInterpreter.h"
+
+// BOOST
+#include <boost/thread/mutex.hpp>
+
+// STD
+#include <string>
+#include <vector>
+
+/**
+ * \class LidarInterpreterRegistry
+ * \brief List of the packet interpreters available, so that the interpreter of a recording can be
+ *        selected from the signature of its packets when several sensor vendors are used.
+ *        An interpreter is added at load time with a static LidarInterpreterRegistrar declared in
+ *        its translation unit.
+ */
+class LidarInterpreterRegistry
+{
+public:
+  typedef vtkLidarPacketInterpreter* (*Factory)();
+
+  static LidarInterpreterRegistry& GetInstance();
+
+  /**
+   * @brief Register add an interpreter, the interpreters registered first are tested first
+   * @param name name of the interpreter, an interpreter already registered with this name is
+   * replaced
+   * @param factory create a new instance of the interpreter, owned by the caller
+   */
+  void Register(const std::string& name, Factory factory);
+
+  /**
+   * @brief GetNames return the names of the registered interpreters, in registration order
+   */
+  std::vector<std::string> GetNames();
+
+  /**
+   * @brief Create return a new interpreter
+   * @return nullptr if no interpreter has been registered with this name
+   */
+  vtkSmartPointer<vtkLidarPacketInterpreter> Create(const std::string& name);
+
+  /**
+   * @brief Detect look for the first registered interpreter which recognizes a packet,
+   * see vtkLidarPacketInterpreter::HasPacketSignature
+   * @param data raw data packet
+   * @param dataLength size of the data packet
+   * @return the name of the interpreter, empty if none recognizes the packet
+   */
+  std::string Detect(unsigned char const* data, unsigned int dataLength);
+
+private:
+  LidarInterpreterRegistry() = default;
+  LidarInterpreterRegistry(const LidarInterpreterRegistry&) = delete;
+  LidarInterpreterRegistry& operator=(const LidarInterpreterRegistry&) = delete;
+
+  struct Entry
+  {
+    std::string Name;
+    Factory Create;
+    //! instance used to test the packet signatures, created on the first detection
+    vtkSmartPointer<vtkLidarPacketInterpreter> Prototype;
+  };
+
+  boost::mutex Mutex;
+  std::vector<Entry> Entries;
+};
+
+/**
+ * \class LidarInterpreterRegistrar
+ * \brief Register the interpreter T when it is constructed, an interpreter registers itself
+ *        with a static instance: static LidarInterpreterRegistrar<vtkMyInterpreter> registrar("My");
+ */
+template<typename T>
+class LidarInterpreterRegistrar
+{
+public:
+  LidarInterpreterRegistrar(const char* name)
+  {
+    LidarInterpreterRegistry::GetInstance().Register(name, &LidarInterpreterRegistrar::Create);
+  }
+
+private:
+  static vtkLidarPacketInterpreter* Create() { return T::New(); }
+};
+
+#endif // LIDAR_INTERPRETER_REGISTRY_H
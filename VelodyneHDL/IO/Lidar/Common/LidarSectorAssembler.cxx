@@ -0,0 +1,167 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "LidarSectorAssembler.h"
+
+// VTK
+#include <vtkAppendPolyData.h>
+#include <vtkFieldData.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+
+const char* LidarSectorAssembler::FrameIndexArrayName = "FrameIndex";
+const char* LidarSectorAssembler::SectorIndexArrayName = "SectorIndex";
+const char* LidarSectorAssembler::IsLastSectorArrayName = "IsLastSector";
+
+namespace
+{
+//-----------------------------------------------------------------------------
+void AddIntValue(vtkFieldData* fieldData, const char* name, int value)
+{
+  vtkNew<vtkIntArray> array;
+  array->SetName(name);
+  array->SetNumberOfTuples(1);
+  array->SetValue(0, value);
+  fieldData->AddArray(array.GetPointer());
+}
+
+//-----------------------------------------------------------------------------
+bool GetIntValue(vtkFieldData* fieldData, const char* name, int& value)
+{
+  vtkDataArray* array = fieldData->GetArray(name);
+  if (!array || array->GetNumberOfTuples() == 0)
+  {
+    return false;
+  }
+  value = static_cast<int>(array->GetComponent(0, 0));
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+void LidarSectorAssembler::SetSectorInformation(
+  vtkPolyData* sector, int frameIndex, int sectorIndex, bool isLast)
+{
+  vtkFieldData* fieldData = sector->GetFieldData();
+  AddIntValue(fieldData, FrameIndexArrayName, frameIndex);
+  AddIntValue(fieldData, SectorIndexArrayName, sectorIndex);
+  AddIntValue(fieldData, IsLastSectorArrayName, isLast ? 1 : 0);
+}
+
+//-----------------------------------------------------------------------------
+bool LidarSectorAssembler::GetSectorInformation(
+  vtkPolyData* polyData, int& frameIndex, int& sectorIndex, bool& isLast)
+{
+  vtkFieldData* fieldData = polyData ? polyData->GetFieldData() : nullptr;
+  int last = 0;
+  if (!fieldData || !GetIntValue(fieldData, FrameIndexArrayName, frameIndex) ||
+    !GetIntValue(fieldData, SectorIndexArrayName, sectorIndex) ||
+    !GetIntValue(fieldData, IsLastSectorArrayName, last))
+  {
+    return false;
+  }
+  isLast = last != 0;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarSectorAssembler::IsPartialFrame(vtkPolyData* polyData)
+{
+  int frameIndex = 0, sectorIndex = 0;
+  bool isLast = false;
+  return GetSectorInformation(polyData, frameIndex, sectorIndex, isLast) && !isLast;
+}
+
+//-----------------------------------------------------------------------------
+bool LidarSectorAssembler::AddSector(vtkPolyData* sector)
+{
+  int frameIndex = 0, sectorIndex = 0;
+  bool isLast = false;
+  if (!GetSectorInformation(sector, frameIndex, sectorIndex, isLast))
+  {
+    this->Sectors.clear();
+    this->FrameIndex = -1;
+    this->IsSynchronized = true;
+    this->Frame = sector;
+    return true;
+  }
+
+  if (frameIndex != this->FrameIndex)
+  {
+    // a frame can only be assembled from its first sector, which follows the last sector of
+    // the previous frame. The sectors are dropped until then if the sectors started in the
+    // middle of a rotation or if the last sector of the previous frame has been lost.
+    this->IsSynchronized = this->IsSynchronized && this->Sectors.empty();
+    this->Sectors.clear();
+    this->FrameIndex = frameIndex;
+  }
+  if (!this->IsSynchronized)
+  {
+    this->IsSynchronized = isLast;
+    return false;
+  }
+  this->Sectors.push_back(sector);
+  if (!isLast)
+  {
+    return false;
+  }
+
+  this->Frame = this->Assemble();
+  this->Sectors.clear();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void LidarSectorAssembler::Reset()
+{
+  this->Sectors.clear();
+  this->FrameIndex = -1;
+  this->IsSynchronized = false;
+  this->Frame = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> LidarSectorAssembler::Assemble() const
+{
+  vtkSmartPointer<vtkPolyData> frame = vtkSmartPointer<vtkPolyData>::New();
+  if (this->Sectors.size() == 1)
+  {
+    frame->ShallowCopy(this->Sectors.front());
+  }
+  else
+  {
+    // the points are in the order of the sectors, which is the order of the frame
+    vtkNew<vtkAppendPolyData> append;
+    for (size_t i = 0; i < this->Sectors.size(); ++i)
+    {
+      append->AddInputData(this->Sectors[i]);
+    }
+    append->Update();
+    frame->ShallowCopy(append->GetOutput());
+  }
+
+  // the field data of the frame is the one of its last sector, e.g. the rotation speed
+  vtkNew<vtkFieldData> fieldData;
+  fieldData->ShallowCopy(this->Sectors.back()->GetFieldData());
+  fieldData->RemoveArray(FrameIndexArrayName);
+  fieldData->RemoveArray(SectorIndexArrayName);
+  fieldData->RemoveArray(IsLastSectorArrayName);
+  frame->SetFieldData(fieldData.GetPointer());
+  return frame;
+}
@@ -0,0 +1,91 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef LIDAR_SECTOR_ASSEMBLER_H
+#define LIDAR_SECTOR_ASSEMBLER_H
+
+// VTK
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// STD
+#include <vector>
+
+/**
+ * \class LidarSectorAssembler
+ * \brief Gather the sectors given by a live stream in sector mode back into complete frames,
+ *        for the filters which need a whole rotation. A sector is a part of a frame given as
+ *        soon as its azimuth range has been decoded, see vtkLidarPacketInterpreter::SectorSize.
+ *        Its field data tells the frame it belongs to and whether it is the last one.
+ */
+class LidarSectorAssembler
+{
+public:
+  //! Names of the field data arrays describing a sector
+  static const char* FrameIndexArrayName;
+  static const char* SectorIndexArrayName;
+  static const char* IsLastSectorArrayName;
+
+  /**
+   * @brief SetSectorInformation describe a sector in its field data
+   * @param frameIndex index of the frame, only used to know which sectors belong together
+   * @param sectorIndex index of the azimuth range of the sector
+   * @param isLast true if the frame is complete with this sector
+   */
+  static void SetSectorInformation(
+    vtkPolyData* sector, int frameIndex, int sectorIndex, bool isLast);
+
+  /**
+   * @brief GetSectorInformation read the description set by SetSectorInformation
+   * @return false if the polydata is a complete frame and not a sector
+   */
+  static bool GetSectorInformation(
+    vtkPolyData* polyData, int& frameIndex, int& sectorIndex, bool& isLast);
+
+  /**
+   * @brief IsPartialFrame true if the polydata is a sector which does not complete its frame,
+   * the filters keeping a state per rotation must wait for the last sector
+   */
+  static bool IsPartialFrame(vtkPolyData* polyData);
+
+  /**
+   * @brief AddSector add the next sector. Only the frames whose sectors have all been added are
+   * assembled, the sectors of an incomplete frame are dropped. A complete frame is given as is.
+   * @return true if a frame has been completed, it is then given by GetFrame
+   */
+  bool AddSector(vtkPolyData* sector);
+
+  /**
+   * @brief GetFrame last completed frame, without the sector information
+   */
+  vtkSmartPointer<vtkPolyData> GetFrame() const { return this->Frame; }
+
+  //! Forget the sectors added and the last frame
+  void Reset();
+
+private:
+  vtkSmartPointer<vtkPolyData> Assemble() const;
+
+  std::vector<vtkSmartPointer<vtkPolyData> > Sectors;
+  int FrameIndex = -1;
+  //! true once the last sector of a frame has been seen, the next sector starts a frame
+  bool IsSynchronized = false;
+  vtkSmartPointer<vtkPolyData> Frame;
+};
+
+#endif // LIDAR_SECTOR_ASSEMBLER_H
@@ -0,0 +1,122 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "LiveTelemetry.h"
+
+// BOOST
+#include <boost/chrono.hpp>
+#include <boost/thread/locks.hpp>
+
+// STD
+#include <algorithm>
+
+const double LiveTelemetry::SampleInterval = 1.0;
+
+//-----------------------------------------------------------------------------
+double LiveTelemetry::GetTime()
+{
+  return boost::chrono::duration_cast<boost::chrono::duration<double> >(
+    boost::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+void LiveTelemetry::AddFrame(double decodeTime)
+{
+  const unsigned long long microseconds = ToMicroseconds(decodeTime);
+  this->FrameDecodeTime += microseconds;
+  // only the decoding thread changes the maximum, until the next sample resets it
+  if (microseconds > this->MaxFrameDecodeTime)
+  {
+    this->MaxFrameDecodeTime = microseconds;
+  }
+  this->Frames++;
+}
+
+//-----------------------------------------------------------------------------
+void LiveTelemetry::AddReceiveLatency(double latency)
+{
+  // the clock of the network card may be slightly ahead of the system clock
+  const unsigned long long microseconds = ToMicroseconds(std::max(latency, 0.));
+  this->ReceiveLatency += microseconds;
+  if (microseconds > this->MaxReceiveLatency)
+  {
+    this->MaxReceiveLatency = microseconds;
+  }
+  this->StampedPackets++;
+}
+
+//-----------------------------------------------------------------------------
+LiveTelemetry::Sample LiveTelemetry::GetSample()
+{
+  boost::lock_guard<boost::mutex> lock(this->SampleMutex);
+  const double now = GetTime();
+  const double duration = now - this->Previous.Time;
+  if (duration < SampleInterval)
+  {
+    return this->LastSample;
+  }
+
+  Counters current;
+  current.Time = now;
+  current.ReceivedPackets = this->ReceivedPackets;
+  current.QueuedPackets = this->QueuedPackets;
+  current.DroppedPackets = this->DroppedPackets;
+  current.DecodedPackets = this->DecodedPackets;
+  current.Frames = this->Frames;
+  current.FrameDecodeTime = this->FrameDecodeTime;
+  current.StampedPackets = this->StampedPackets;
+  current.ReceiveLatency = this->ReceiveLatency;
+  current.DecodingWaitTime = this->DecodingWaitTime;
+  current.PublishingWaitTime = this->PublishingWaitTime;
+
+  Sample sample;
+  // the first sample only starts the counting
+  if (this->Previous.Time > 0)
+  {
+    sample.ReceivedPacketRate =
+      (current.ReceivedPackets - this->Previous.ReceivedPackets) / duration;
+    sample.QueuedPacketRate = (current.QueuedPackets - this->Previous.QueuedPackets) / duration;
+    sample.DroppedPacketRate = (current.DroppedPackets - this->Previous.DroppedPackets) / duration;
+    sample.DecodedPacketRate = (current.DecodedPackets - this->Previous.DecodedPackets) / duration;
+    sample.FrameRate = (current.Frames - this->Previous.Frames) / duration;
+    sample.DecodingWaitRatio =
+      (current.DecodingWaitTime - this->Previous.DecodingWaitTime) * 1e-6 / duration;
+    sample.PublishingWaitRatio =
+      (current.PublishingWaitTime - this->Previous.PublishingWaitTime) * 1e-6 / duration;
+  }
+  const unsigned long long numberOfFrames = current.Frames - this->Previous.Frames;
+  if (numberOfFrames > 0)
+  {
+    sample.FrameDecodeTime =
+      (current.FrameDecodeTime - this->Previous.FrameDecodeTime) * 1e-6 / numberOfFrames;
+  }
+  sample.MaxFrameDecodeTime = this->MaxFrameDecodeTime.exchange(0) * 1e-6;
+  const unsigned long long numberOfStampedPackets =
+    current.StampedPackets - this->Previous.StampedPackets;
+  if (numberOfStampedPackets > 0)
+  {
+    sample.ReceiveLatency =
+      (current.ReceiveLatency - this->Previous.ReceiveLatency) * 1e-6 / numberOfStampedPackets;
+  }
+  sample.MaxReceiveLatency = this->MaxReceiveLatency.exchange(0) * 1e-6;
+
+  this->Previous = current;
+  this->LastSample = sample;
+  return sample;
+}
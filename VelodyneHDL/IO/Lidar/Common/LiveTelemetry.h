@@ -0,0 +1,143 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef LIVE_TELEMETRY_H
+#define LIVE_TELEMETRY_H
+
+// BOOST
+#include <boost/thread/mutex.hpp>
+
+// STD
+#include <atomic>
+
+/**
+ * \class LiveTelemetry
+ * \brief Counters of the live pipeline, updated by the network and the decoding threads
+ *        without locking, and turned into rates over the last second when they are queried,
+ *        so that the hardware can be sized and the regressions caught while streaming.
+ */
+class LiveTelemetry
+{
+public:
+  //! Rates and times over the last sampling interval
+  struct Sample
+  {
+    //! Packets per second given by the network, kept by the decoding queue, decoded, and
+    //! dropped because the decoding queue was full
+    double ReceivedPacketRate = 0;
+    double QueuedPacketRate = 0;
+    double DecodedPacketRate = 0;
+    double DroppedPacketRate = 0;
+    //! Frames, or sectors, published per second
+    double FrameRate = 0;
+    //! Mean and maximum time spent decoding the packets of a frame, in seconds
+    double FrameDecodeTime = 0;
+    double MaxFrameDecodeTime = 0;
+    //! Mean and maximum time from the arrival of a packet, as stamped by the system, until it
+    //! is queued for decoding, in seconds
+    double ReceiveLatency = 0;
+    double MaxReceiveLatency = 0;
+    //! Fraction of the time spent waiting for ReaderMutex by the decoding, and for
+    //! ConsumerMutex by the publication of the frames
+    double DecodingWaitRatio = 0;
+    double PublishingWaitRatio = 0;
+  };
+
+  //! Time of a steady clock, in seconds, used for all the times of the live pipeline
+  static double GetTime();
+
+  void AddReceivedPackets(unsigned long count) { this->ReceivedPackets += count; }
+  void AddQueuedPackets(unsigned long count) { this->QueuedPackets += count; }
+  void AddDroppedPackets(unsigned long count) { this->DroppedPackets += count; }
+  void AddDecodedPacket() { this->DecodedPackets++; }
+  void AddDecodingWaitTime(double seconds) { this->DecodingWaitTime += ToMicroseconds(seconds); }
+  void AddPublishingWaitTime(double seconds)
+  {
+    this->PublishingWaitTime += ToMicroseconds(seconds);
+  }
+
+  //! Called by the decoding thread with each published frame
+  void AddFrame(double decodeTime);
+
+  //! Called by the network thread with each packet whose arrival time is known
+  void AddReceiveLatency(double latency);
+
+  //! Time from the first packet of the frame given to the pipeline until it was given
+  void SetDisplayedFrameAge(double seconds) { this->DisplayedFrameAge = seconds; }
+  double GetDisplayedFrameAge() { return this->DisplayedFrameAge; }
+
+  //! Total times waited for the locks, in seconds
+  double GetDecodingWaitTime() { return this->DecodingWaitTime * 1e-6; }
+  double GetPublishingWaitTime() { return this->PublishingWaitTime * 1e-6; }
+
+  unsigned long long GetNumberOfReceivedPackets() { return this->ReceivedPackets; }
+  unsigned long long GetNumberOfDecodedPackets() { return this->DecodedPackets; }
+  unsigned long long GetNumberOfDroppedPackets() { return this->DroppedPackets; }
+
+  /**
+   * @brief GetSample rates since the previous sample, the sample is only renewed once
+   * SampleInterval has elapsed so that it can be queried for each value
+   */
+  Sample GetSample();
+
+  //! Minimum duration of a sample, in seconds
+  static const double SampleInterval;
+
+private:
+  static unsigned long long ToMicroseconds(double seconds)
+  {
+    return static_cast<unsigned long long>(seconds * 1e6);
+  }
+
+  std::atomic<unsigned long long> ReceivedPackets{ 0 };
+  std::atomic<unsigned long long> QueuedPackets{ 0 };
+  std::atomic<unsigned long long> DroppedPackets{ 0 };
+  std::atomic<unsigned long long> DecodedPackets{ 0 };
+  std::atomic<unsigned long long> Frames{ 0 };
+  //! in microseconds, so that they can be atomic
+  std::atomic<unsigned long long> FrameDecodeTime{ 0 };
+  std::atomic<unsigned long long> MaxFrameDecodeTime{ 0 };
+  std::atomic<unsigned long long> StampedPackets{ 0 };
+  std::atomic<unsigned long long> ReceiveLatency{ 0 };
+  std::atomic<unsigned long long> MaxReceiveLatency{ 0 };
+  std::atomic<unsigned long long> DecodingWaitTime{ 0 };
+  std::atomic<unsigned long long> PublishingWaitTime{ 0 };
+  std::atomic<double> DisplayedFrameAge{ 0 };
+
+  //! Counters at the beginning of the current sample
+  struct Counters
+  {
+    double Time = 0;
+    unsigned long long ReceivedPackets = 0;
+    unsigned long long QueuedPackets = 0;
+    unsigned long long DroppedPackets = 0;
+    unsigned long long DecodedPackets = 0;
+    unsigned long long Frames = 0;
+    unsigned long long FrameDecodeTime = 0;
+    unsigned long long StampedPackets = 0;
+    unsigned long long ReceiveLatency = 0;
+    unsigned long long DecodingWaitTime = 0;
+    unsigned long long PublishingWaitTime = 0;
+  };
+
+  boost::mutex SampleMutex;
+  Counters Previous;
+  Sample LastSample;
+};
+
+#endif // LIVE_TELEMETRY_H
@@ -0,0 +1,200 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "NetworkIngestionEngine.h"
+#include "ThreadTopology.h"
+
+// VTK
+#include <vtkSetGet.h>
+
+// BOOST
+#include <boost/thread/thread.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+struct NetworkIngestionEngine::Worker
+{
+  boost::asio::io_service Service;
+  std::unique_ptr<boost::asio::io_service::work> Work;
+  std::unique_ptr<boost::thread> Thread;
+  int NumberOfSources = 0;
+};
+
+namespace
+{
+//-----------------------------------------------------------------------------
+void PinCurrentThread(int cpu)
+{
+#ifdef __linux__
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+  {
+    vtkGenericWarningMacro("Failed to pin the receive thread on the core " << cpu);
+  }
+#else
+  (void)cpu;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void RunService(boost::asio::io_service* service, int index, int cpu)
+{
+  ThreadTopology::ApplyToCurrentThread(ThreadTopology::RECEIVE, index);
+  if (cpu >= 0)
+  {
+    PinCurrentThread(cpu);
+  }
+  service->run();
+}
+}
+
+//-----------------------------------------------------------------------------
+NetworkIngestionEngine& NetworkIngestionEngine::GetInstance()
+{
+  static NetworkIngestionEngine instance;
+  return instance;
+}
+
+//-----------------------------------------------------------------------------
+NetworkIngestionEngine::NetworkIngestionEngine()
+  : NumberOfThreads(0)
+  , NumberOfAttachedSources(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+NetworkIngestionEngine::~NetworkIngestionEngine()
+{
+  this->StopWorkers();
+}
+
+//-----------------------------------------------------------------------------
+void NetworkIngestionEngine::SetNumberOfThreads(int numberOfThreads)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->NumberOfThreads = std::max(numberOfThreads, 0);
+}
+
+//-----------------------------------------------------------------------------
+int NetworkIngestionEngine::GetNumberOfThreads()
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  return this->NumberOfThreads;
+}
+
+//-----------------------------------------------------------------------------
+void NetworkIngestionEngine::SetThreadAffinity(const std::vector<int>& cpus)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->ThreadAffinity = cpus;
+}
+
+//-----------------------------------------------------------------------------
+boost::asio::io_service& NetworkIngestionEngine::Attach()
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  const int poolSize = this->NumberOfThreads > 0
+    ? this->NumberOfThreads
+    : ThreadTopology::GetPoolSize(ThreadTopology::RECEIVE);
+  const int maximumNumberOfThreads = poolSize > 0
+    ? poolSize
+    : std::max(static_cast<int>(boost::thread::hardware_concurrency()), 1);
+
+  // a new thread is started as long as every running thread already serves a source
+  Worker* leastLoaded = nullptr;
+  for (const std::unique_ptr<Worker>& worker : this->Workers)
+  {
+    if (!leastLoaded || worker->NumberOfSources < leastLoaded->NumberOfSources)
+    {
+      leastLoaded = worker.get();
+    }
+  }
+  if (static_cast<int>(this->Workers.size()) < maximumNumberOfThreads &&
+    (!leastLoaded || leastLoaded->NumberOfSources > 0))
+  {
+    this->StartWorker();
+    leastLoaded = this->Workers.back().get();
+  }
+
+  leastLoaded->NumberOfSources++;
+  this->NumberOfAttachedSources++;
+  return leastLoaded->Service;
+}
+
+//-----------------------------------------------------------------------------
+void NetworkIngestionEngine::Detach(boost::asio::io_service& service)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  for (const std::unique_ptr<Worker>& worker : this->Workers)
+  {
+    if (&worker->Service == &service && worker->NumberOfSources > 0)
+    {
+      worker->NumberOfSources--;
+      this->NumberOfAttachedSources--;
+      break;
+    }
+  }
+  if (this->NumberOfAttachedSources == 0)
+  {
+    this->StopWorkers();
+  }
+}
+
+//-----------------------------------------------------------------------------
+int NetworkIngestionEngine::GetNumberOfRunningThreads()
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  return static_cast<int>(this->Workers.size());
+}
+
+//-----------------------------------------------------------------------------
+void NetworkIngestionEngine::StartWorker()
+{
+  const int index = static_cast<int>(this->Workers.size());
+  const int cpu = this->ThreadAffinity.empty()
+    ? -1
+    : this->ThreadAffinity[index % this->ThreadAffinity.size()];
+
+  std::unique_ptr<Worker> worker(new Worker);
+  worker->Work.reset(new boost::asio::io_service::work(worker->Service));
+  worker->Thread.reset(new boost::thread(RunService, &worker->Service, index, cpu));
+  this->Workers.push_back(std::move(worker));
+}
+
+//-----------------------------------------------------------------------------
+void NetworkIngestionEngine::StopWorkers()
+{
+  for (const std::unique_ptr<Worker>& worker : this->Workers)
+  {
+    worker->Work.reset();
+    worker->Service.stop();
+  }
+  for (const std::unique_ptr<Worker>& worker : this->Workers)
+  {
+    worker->Thread->join();
+  }
+  this->Workers.clear();
+}
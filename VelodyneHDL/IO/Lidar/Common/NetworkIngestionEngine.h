@@ -0,0 +1,90 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef NETWORK_INGESTION_ENGINE_H
+#define NETWORK_INGESTION_ENGINE_H
+
+// BOOST
+#include <boost/asio.hpp>
+#include <boost/thread/mutex.hpp>
+
+// STD
+#include <memory>
+#include <vector>
+
+/**
+ * \class NetworkIngestionEngine
+ * \brief Pool of receive threads shared by all the NetworkSources, so that several sensors are
+ *        spread over a bounded number of cores instead of each stream running its own thread.
+ *        Each source is served by a single thread, the least loaded one when it is attached,
+ *        so that the packets of a sensor keep a single producer and their order. The threads
+ *        are started with the first attached source and stopped with the last one.
+ */
+class NetworkIngestionEngine
+{
+public:
+  static NetworkIngestionEngine& GetInstance();
+
+  NetworkIngestionEngine();
+  ~NetworkIngestionEngine();
+
+  /**
+   * @brief SetNumberOfThreads set the number of receive threads, taken into account the next
+   * time the threads are started. 0 means the pool size of the receive threads given by
+   * ThreadTopology, or one per sensor up to the number of cores if it is not set either.
+   */
+  void SetNumberOfThreads(int numberOfThreads);
+  int GetNumberOfThreads();
+
+  /**
+   * @brief SetThreadAffinity pin the receive thread i on the core cpus[i % cpus.size()], for
+   * example on the cores close to the network card queues. Only supported on Linux, taken into
+   * account the next time the threads are started. An empty list uses the placement of the
+   * receive threads given by ThreadTopology, which also gives their priority and NUMA node.
+   */
+  void SetThreadAffinity(const std::vector<int>& cpus);
+
+  /**
+   * @brief Attach give the service of the least loaded thread, on which all the sockets of a
+   * source must be created
+   */
+  boost::asio::io_service& Attach();
+
+  /**
+   * @brief Detach release a service given by Attach, once all its sockets are closed
+   */
+  void Detach(boost::asio::io_service& service);
+
+  /**
+   * @brief GetNumberOfRunningThreads number of threads currently serving sources
+   */
+  int GetNumberOfRunningThreads();
+
+private:
+  struct Worker;
+
+  void StartWorker();
+  void StopWorkers();
+
+  boost::mutex Mutex;
+  int NumberOfThreads;
+  std::vector<int> ThreadAffinity;
+  std::vector<std::unique_ptr<Worker> > Workers;
+  int NumberOfAttachedSources;
+};
+
+#endif // NETWORK_INGESTION_ENGINE_H
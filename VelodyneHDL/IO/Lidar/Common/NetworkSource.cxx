@@ -17,10 +17,13 @@
 
 // LOCAL
 #include "NetworkSource.h"
+#include "NetworkIngestionEngine.h"
 #include "vtkPacketFileWriter.h"
 #include "PacketReceiver.h"
 #include "PacketFileWriter.h"
 #include "PacketConsumer.h"
+#include "PositionConsumer.h"
+#include "TimeShiftBuffer.h"
 
 #define LIDAR_PACKET_TO_STORE_CRASH_ANALYSIS 5000
 #define GPS_PACKET_TO_STORE_CRASH_ANALYSIS 5000
@@ -29,53 +32,72 @@
 NetworkSource::~NetworkSource()
 {
   this->Stop();
-
-  delete this->DummyWork;
-
-  if (this->Thread)
-  {
-    this->Thread->join();
-  }
 }
 
 //-----------------------------------------------------------------------------
-void NetworkSource::QueuePackets(std::string *packet)
+void NetworkSource::QueuePackets(const std::vector<PacketBufferPointer>& packets)
 {
-  std::string* packet2 = 0;
+  if (this->Consumer)
+  {
+    this->Consumer->Enqueue(packets);
+  }
+
   if (this->Writer)
   {
-    packet2 = new std::string(*packet);
+    this->Writer->Enqueue(packets);
   }
 
-  if (this->Consumer)
+  if (this->TimeShift)
   {
-    this->Consumer->Enqueue(packet);
+    this->TimeShift->Enqueue(packets);
   }
 
-  if (this->Writer)
+  if (this->Positions && this->ListenGPS)
   {
-    this->Writer->Enqueue(packet2);
+    this->Positions->Enqueue(packets);
   }
 }
 
 //-----------------------------------------------------------------------------
 void NetworkSource::Start()
 {
-  if (!this->Thread)
+  if (!this->IOService)
   {
     std::cout << "Start listen" << std::endl;
-    this->Thread.reset(
-      new boost::thread(boost::bind(&boost::asio::io_service::run, &this->IOService)));
+    // both receivers run on the same thread, so that the consumer has a single producer
+    this->IOService = &NetworkIngestionEngine::GetInstance().Attach();
   }
 
   // Create work
   this->LIDARPortReceiver = boost::shared_ptr<PacketReceiver>(new PacketReceiver(
-    this->IOService, LIDARPort, ForwardedLIDARPort, ForwardedIpAddress, IsForwarding, this));
+    *this->IOService, LIDARPort, ForwardedLIDARPort, ForwardedIpAddress, IsForwarding, this));
 
   if (this->ListenGPS)
   {
+    if (this->Positions)
+    {
+      this->Positions->Start();
+    }
     this->PositionPortReceiver = boost::shared_ptr<PacketReceiver>(new PacketReceiver(
-      this->IOService, GPSPort, ForwardedGPSPort, ForwardedIpAddress, IsForwarding, this));
+      *this->IOService, GPSPort, ForwardedGPSPort, ForwardedIpAddress, IsForwarding, this));
+  }
+
+  if (!this->MulticastAddress.empty())
+  {
+    this->LIDARPortReceiver->JoinMulticastGroup(this->MulticastAddress);
+    if (this->ListenGPS)
+    {
+      this->PositionPortReceiver->JoinMulticastGroup(this->MulticastAddress);
+    }
+  }
+
+  if (!this->SensorIpAddress.empty())
+  {
+    this->LIDARPortReceiver->SetSourceFilter(this->SensorIpAddress);
+    if (this->ListenGPS)
+    {
+      this->PositionPortReceiver->SetSourceFilter(this->SensorIpAddress);
+    }
   }
 
   if (this->IsCrashAnalysing)
@@ -129,8 +151,17 @@ void NetworkSource::Stop()
 {
   // Kill the receivers
   this->LIDARPortReceiver.reset();
-  if (this->ListenGPS)
+  // even if ListenGPS changed since Start, the sockets must be closed before the Detach
+  this->PositionPortReceiver.reset();
+
+  if (this->IOService)
+  {
+    NetworkIngestionEngine::GetInstance().Detach(*this->IOService);
+    this->IOService = nullptr;
+  }
+
+  if (this->Positions)
   {
-    this->PositionPortReceiver.reset();
+    this->Positions->Stop();
   }
 }
@@ -33,19 +33,25 @@
 #include <boost/filesystem.hpp>
 #include <boost/thread/thread.hpp>
 
+#include "PacketBuffer.h"
+
 #include <deque>
 #include <queue>
+#include <vector>
 
 class PacketConsumer;
 class PacketReceiver;
 class PacketFileWriter;
+class PositionConsumer;
+class TimeShiftBuffer;
 /**
-* \class PacketReceiver
-* \brief This class is responsible for the IOService and  two PacketReceiver classes
+* \class NetworkSource
+* \brief This class is responsible for two PacketReceiver classes, served by a thread of the
+* NetworkIngestionEngine shared with the other sources
 * @param _consumer boost::shared_ptr<PacketConsumer>
 * @param argLIDARPort The used port to receive the LIDAR information
 * @param ForwardedLIDARPort_ The port which will receive the lidar forwarded packets
-* @param ForwardedIpAddress_ The ip which will receive the forwarded packets
+* @param ForwardedIpAddress_ The ips which will receive the forwarded packets, separated by commas
 * @param isForwarding_ Allow the forwarding
 */
 class NetworkSource
@@ -59,19 +65,19 @@ public:
     , ForwardedIpAddress(ForwardedIpAddress_)
     , IsForwarding(isForwarding_)
     , IsCrashAnalysing(isCrashAnalysing_)
-    , IOService()
-    , Thread()
+    , IOService(nullptr)
     , LIDARPortReceiver()
     , Consumer(_consumer)
     , Writer()
-    , DummyWork(new boost::asio::io_service::work(this->IOService))
   {
       this->ListenGPS = false;
   }
 
   ~NetworkSource();
 
-  void QueuePackets(std::string* packet);
+  //! Give the batch of packets received at once by a PacketReceiver to the consumer, to the
+  //! writer and to the time shift buffer, which share the buffers
+  void QueuePackets(const std::vector<PacketBufferPointer>& packets);
 
   void Start();
 
@@ -83,12 +89,15 @@ public:
   int GPSPort;                    /*!< The port to receive GPS information. Default is 8308 */
   int ForwardedLIDARPort;         /*!< The port to send LIDAR forwarded packets*/
   int ForwardedGPSPort;           /*!< The port to send GPS forwarded packets*/
-  std::string ForwardedIpAddress; /*!< The ip to send forwarded packets*/
+  std::string ForwardedIpAddress; /*!< The ips to send forwarded packets, separated by commas*/
   bool IsForwarding;              /*!< Allowing the forwarding of the packets*/
   bool IsCrashAnalysing;
+  std::string SensorIpAddress;    /*!< Only the packets sent by this ip are kept, if not empty */
+  std::string MulticastAddress;   /*!< The multicast group to join, if not empty */
 
-  boost::asio::io_service IOService; /*!< The in/out service which will handle the Packets */
-  boost::shared_ptr<boost::thread> Thread;
+  /*!< The in/out service which will handle the Packets, given by the NetworkIngestionEngine
+   *   while the source is started */
+  boost::asio::io_service* IOService;
 
   boost::shared_ptr<PacketReceiver>
     LIDARPortReceiver; /*!< The PacketReceiver configured to receive LIDAR information */
@@ -99,7 +108,11 @@ public:
   std::shared_ptr<PacketConsumer> Consumer;
   std::shared_ptr<PacketFileWriter> Writer;
 
-  boost::asio::io_service::work* DummyWork;
+  /*!< Keeps the last minutes of the packets on the disk, if not null */
+  std::shared_ptr<TimeShiftBuffer> TimeShift;
+
+  /*!< Decodes the position packets received on GPSPort on its own thread, if not null */
+  std::shared_ptr<PositionConsumer> Positions;
 };
 
 
@@ -0,0 +1,313 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PacketAzimuthIndex.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+//! Azimuths are stored in hundredths of degree
+const int AzimuthResolution = 100;
+const int FullTurn = 360 * AzimuthResolution;
+//! Distances are stored in centimeters
+const int DistanceResolution = 100;
+//! Sensor times are stored in microseconds
+const double TimeResolution = 1e6;
+
+//-----------------------------------------------------------------------------
+void WriteVarint(std::vector<unsigned char>& data, boost::uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    data.push_back(static_cast<unsigned char>(value | 0x80));
+    value >>= 7;
+  }
+  data.push_back(static_cast<unsigned char>(value));
+}
+
+//-----------------------------------------------------------------------------
+bool ReadVarint(const std::vector<unsigned char>& data, size_t& offset, boost::uint64_t& value)
+{
+  value = 0;
+  for (int shift = 0; shift < 64 && offset < data.size(); shift += 7)
+  {
+    const unsigned char byte = data[offset++];
+    value |= static_cast<boost::uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+//! Signed values are stored as unsigned ones, the small magnitudes being the small values
+boost::uint64_t ZigZagEncode(boost::int64_t value)
+{
+  return (static_cast<boost::uint64_t>(value) << 1) ^ static_cast<boost::uint64_t>(value >> 63);
+}
+
+//-----------------------------------------------------------------------------
+boost::int64_t ZigZagDecode(boost::uint64_t value)
+{
+  return static_cast<boost::int64_t>(value >> 1) ^ -static_cast<boost::int64_t>(value & 1);
+}
+
+//-----------------------------------------------------------------------------
+//! Angle in [0, 360[
+double NormalizeAzimuth(double azimuth)
+{
+  const double normalized = std::fmod(azimuth, 360.);
+  return normalized < 0. ? normalized + 360. : normalized;
+}
+}
+
+//-----------------------------------------------------------------------------
+void PacketAzimuthIndex::Build(
+  const std::vector<Packet>& packets, const std::vector<FramePosition>& positions)
+{
+  this->Frames.assign(positions.size(), std::vector<unsigned char>());
+  auto byPosition = [](const Packet& packet, boost::uint64_t position) {
+    return packet.Position < position;
+  };
+  std::vector<Packet> framePackets;
+  for (size_t frame = 0; frame < positions.size(); ++frame)
+  {
+    // the first packet of the next frame also ends this one
+    auto begin =
+      std::lower_bound(packets.begin(), packets.end(), positions[frame].Position, byPosition);
+    auto end = packets.end();
+    if (frame + 1 < positions.size())
+    {
+      end = std::lower_bound(begin, packets.end(), positions[frame + 1].Position, byPosition);
+      end = end != packets.end() ? end + 1 : end;
+    }
+    framePackets.assign(begin, end);
+    this->SetFramePackets(static_cast<int>(frame), framePackets);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool PacketAzimuthIndex::HasFrame(int frameNumber) const
+{
+  return frameNumber >= 0 && static_cast<size_t>(frameNumber) < this->Frames.size() &&
+    !this->Frames[frameNumber].empty();
+}
+
+//-----------------------------------------------------------------------------
+void PacketAzimuthIndex::SetFramePackets(int frameNumber, const std::vector<Packet>& packets)
+{
+  if (frameNumber < 0)
+  {
+    return;
+  }
+  if (static_cast<size_t>(frameNumber) >= this->Frames.size())
+  {
+    this->Frames.resize(frameNumber + 1);
+  }
+  std::vector<unsigned char>& data = this->Frames[frameNumber];
+  data.clear();
+  WriteVarint(data, packets.size());
+  boost::uint64_t lastPosition = 0;
+  int lastAzimuth = 0;
+  boost::int64_t lastTime = 0;
+  for (const Packet& packet : packets)
+  {
+    // the range is stored from its lowest azimuth, the direction of the rotation being the
+    // shortest way from the first azimuth to the last one
+    double first = NormalizeAzimuth(packet.FirstAzimuth);
+    double width = NormalizeAzimuth(packet.LastAzimuth - packet.FirstAzimuth);
+    if (width > 180.)
+    {
+      first = NormalizeAzimuth(packet.LastAzimuth);
+      width = 360. - width;
+    }
+    const int azimuth =
+      std::min(static_cast<int>(std::floor(first * AzimuthResolution)), FullTurn - 1);
+    const int azimuthWidth = static_cast<int>(std::ceil(width * AzimuthResolution));
+    WriteVarint(data, packet.Position - lastPosition);
+    WriteVarint(data, (azimuth - lastAzimuth + FullTurn) % FullTurn);
+    WriteVarint(data, azimuthWidth);
+
+    // distances: 0 if unknown, otherwise 1 + the minimum distance and the zero distance flag,
+    // then 0 if there is no non zero distance, otherwise 1 + the width of the range
+    if (!packet.HasDistances)
+    {
+      WriteVarint(data, 0);
+      WriteVarint(data, 0);
+    }
+    else if (packet.MinDistance > packet.MaxDistance)
+    {
+      WriteVarint(data, 1 + (packet.HasZeroDistance ? 1 : 0));
+      WriteVarint(data, 0);
+    }
+    else
+    {
+      const boost::uint64_t minDistance = static_cast<boost::uint64_t>(
+        std::floor(std::max(packet.MinDistance, 0.) * DistanceResolution));
+      const boost::uint64_t maxDistance = static_cast<boost::uint64_t>(
+        std::ceil(std::max(packet.MaxDistance, 0.) * DistanceResolution));
+      WriteVarint(data, 1 + (minDistance << 1 | (packet.HasZeroDistance ? 1 : 0)));
+      WriteVarint(data, 1 + std::max(maxDistance, minDistance) - minDistance);
+    }
+
+    // sensor time: 0 if unknown, otherwise 1 + the offset from the previous known time
+    if (std::isnan(packet.SensorTime))
+    {
+      WriteVarint(data, 0);
+    }
+    else
+    {
+      const boost::int64_t time = std::llround(packet.SensorTime * TimeResolution);
+      WriteVarint(data, 1 + ZigZagEncode(time - lastTime));
+      lastTime = time;
+    }
+    lastPosition = packet.Position;
+    lastAzimuth = azimuth;
+  }
+  data.shrink_to_fit();
+}
+
+//-----------------------------------------------------------------------------
+bool PacketAzimuthIndex::GetFramePackets(int frameNumber, std::vector<Packet>& packets) const
+{
+  packets.clear();
+  if (!this->HasFrame(frameNumber))
+  {
+    return false;
+  }
+  const std::vector<unsigned char>& data = this->Frames[frameNumber];
+  size_t offset = 0;
+  boost::uint64_t numberOfPackets = 0;
+  ReadVarint(data, offset, numberOfPackets);
+  packets.reserve(static_cast<size_t>(std::min<boost::uint64_t>(numberOfPackets, data.size())));
+  boost::uint64_t position = 0;
+  int azimuth = 0;
+  boost::int64_t time = 0;
+  for (boost::uint64_t i = 0; i < numberOfPackets; ++i)
+  {
+    boost::uint64_t positionOffset = 0, azimuthOffset = 0, width = 0;
+    boost::uint64_t minDistance = 0, distanceWidth = 0, timeOffset = 0;
+    if (!ReadVarint(data, offset, positionOffset) || !ReadVarint(data, offset, azimuthOffset) ||
+      !ReadVarint(data, offset, width) || !ReadVarint(data, offset, minDistance) ||
+      !ReadVarint(data, offset, distanceWidth) || !ReadVarint(data, offset, timeOffset))
+    {
+      packets.clear();
+      return false;
+    }
+    position += positionOffset;
+    azimuth = static_cast<int>((azimuth + azimuthOffset) % FullTurn);
+
+    Packet packet = { position, static_cast<double>(azimuth) / AzimuthResolution,
+      static_cast<double>(azimuth + width) / AzimuthResolution, minDistance > 0, false, 1., 0.,
+      std::numeric_limits<double>::quiet_NaN() };
+    if (packet.HasDistances)
+    {
+      packet.HasZeroDistance = ((minDistance - 1) & 1) != 0;
+      if (distanceWidth > 0)
+      {
+        const boost::uint64_t distance = (minDistance - 1) >> 1;
+        packet.MinDistance = static_cast<double>(distance) / DistanceResolution;
+        packet.MaxDistance = static_cast<double>(distance + distanceWidth - 1) / DistanceResolution;
+      }
+    }
+    if (timeOffset > 0)
+    {
+      time += ZigZagDecode(timeOffset - 1);
+      packet.SensorTime = static_cast<double>(time) / TimeResolution;
+    }
+    packets.push_back(packet);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool PacketAzimuthIndex::GetSectorPackets(int frameNumber, double azimuthMin, double azimuthMax,
+  double margin, std::vector<boost::uint64_t>& positions) const
+{
+  positions.clear();
+  std::vector<Packet> packets;
+  if (!this->GetFramePackets(frameNumber, packets))
+  {
+    return false;
+  }
+  const int sectorStart =
+    static_cast<int>(std::floor(NormalizeAzimuth(azimuthMin - margin) * AzimuthResolution));
+  const int sectorWidth = static_cast<int>(std::ceil(
+    (NormalizeAzimuth(azimuthMax - azimuthMin) + 2. * margin) * AzimuthResolution));
+
+  for (const Packet& packet : packets)
+  {
+    // the azimuths are exact multiples of the resolution
+    const int azimuth = static_cast<int>(std::lround(packet.FirstAzimuth * AzimuthResolution));
+    const int width = static_cast<int>(
+      std::lround((packet.LastAzimuth - packet.FirstAzimuth) * AzimuthResolution));
+
+    // two arcs overlap when one of them starts in the other one
+    const int packetInSector = (azimuth - sectorStart + FullTurn) % FullTurn;
+    const int sectorInPacket = (sectorStart - azimuth + FullTurn) % FullTurn;
+    if (sectorWidth >= FullTurn || packetInSector <= sectorWidth || sectorInPacket <= width)
+    {
+      positions.push_back(packet.Position);
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void PacketAzimuthIndex::Serialize(std::vector<unsigned char>& data) const
+{
+  data.clear();
+  WriteVarint(data, this->Frames.size());
+  for (const std::vector<unsigned char>& frame : this->Frames)
+  {
+    WriteVarint(data, frame.size());
+    data.insert(data.end(), frame.begin(), frame.end());
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool PacketAzimuthIndex::Deserialize(const std::vector<unsigned char>& data)
+{
+  this->Frames.clear();
+  size_t offset = 0;
+  boost::uint64_t numberOfFrames = 0;
+  // each frame takes at least one byte
+  if (!ReadVarint(data, offset, numberOfFrames) || numberOfFrames > data.size())
+  {
+    return false;
+  }
+  this->Frames.resize(static_cast<size_t>(numberOfFrames));
+  for (std::vector<unsigned char>& frame : this->Frames)
+  {
+    boost::uint64_t size = 0;
+    if (!ReadVarint(data, offset, size) || size > data.size() - offset)
+    {
+      this->Frames.clear();
+      return false;
+    }
+    frame.assign(data.begin() + offset, data.begin() + offset + static_cast<size_t>(size));
+    offset += static_cast<size_t>(size);
+  }
+  return true;
+}
@@ -0,0 +1,120 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef PACKET_AZIMUTH_INDEX_H
+#define PACKET_AZIMUTH_INDEX_H
+
+// LOCAL
+#include "vtkLidarReader.h"
+
+// BOOST
+#include <boost/cstdint.hpp>
+
+// STD
+#include <vector>
+
+/**
+ * \class PacketAzimuthIndex
+ * \brief Position, azimuth range, distance range and sensor time of the lidar packets of each
+ *        frame, so that the packets of an azimuth sector, or the ones a crop keeps, can be
+ *        decoded without reading the other ones, and a packet can be found by GPS time.
+ *        The packets of a frame are the ones from its first packet to the first packet of the
+ *        next frame, included as the frame ends in it. They are stored compressed, about 12
+ *        bytes per packet: the offset from the previous packet, the azimuth from the previous
+ *        packet and the width of the packet in hundredths of degree, the distance range in
+ *        centimeters, and the time from the previous packet in microseconds, as variable length
+ *        integers.
+ *        A frame whose packets have not been recorded yet is unknown, see SetFramePackets.
+ */
+class PacketAzimuthIndex
+{
+public:
+  //! A lidar packet, its azimuth range going from FirstAzimuth to LastAzimuth in the direction
+  //! of the rotation, in degrees, see vtkLidarPacketInterpreter::GetPacketAzimuthRange, and the
+  //! range of its distances when HasDistances is set, see
+  //! vtkLidarPacketInterpreter::GetPacketDistanceRange. SensorTime is the time given by
+  //! vtkLidarPacketInterpreter::GetPacketSensorTime, NaN if unknown.
+  struct Packet
+  {
+    boost::uint64_t Position;
+    double FirstAzimuth;
+    double LastAzimuth;
+    bool HasDistances;
+    //! true if some lasers of the packet have no return
+    bool HasZeroDistance;
+    //! range of the non zero distances in meters, MinDistance > MaxDistance if there is none
+    double MinDistance;
+    double MaxDistance;
+    //! in seconds since the top of the hour, rounded to the microsecond
+    double SensorTime;
+  };
+
+  /**
+   * @brief Build record the packets of all the frames of an index
+   * @param packets all the lidar packets of the file, in file order
+   * @param positions frame index of the file
+   */
+  void Build(const std::vector<Packet>& packets, const std::vector<FramePosition>& positions);
+
+  //! Forget all the frames
+  void Clear() { this->Frames.clear(); }
+
+  bool HasFrame(int frameNumber) const;
+
+  /**
+   * @brief SetFramePackets record the packets of a frame, from its first packet to the first
+   * packet of the next frame
+   */
+  void SetFramePackets(int frameNumber, const std::vector<Packet>& packets);
+
+  /**
+   * @brief GetSectorPackets return the packets of a frame overlapping an azimuth sector, which
+   * goes from azimuthMin to azimuthMax in increasing azimuth, in degrees, and may contain 0
+   * @param margin widening of the sector on both sides, in degrees
+   * @param positions[out] positions of the packets, in file order
+   * @return false if the packets of the frame are unknown
+   */
+  bool GetSectorPackets(int frameNumber, double azimuthMin, double azimuthMax, double margin,
+    std::vector<boost::uint64_t>& positions) const;
+
+  /**
+   * @brief GetFramePackets return all the packets of a frame, their azimuths and distances
+   * being rounded outwards to the stored resolution. The first azimuth is in [0, 360[ and the
+   * last one is greater, by at most half a turn.
+   * @param packets[out] packets of the frame, in file order
+   * @return false if the packets of the frame are unknown
+   */
+  bool GetFramePackets(int frameNumber, std::vector<Packet>& packets) const;
+
+  /**
+   * @brief Serialize write the known frames in a buffer stored in the frame index file
+   */
+  void Serialize(std::vector<unsigned char>& data) const;
+
+  /**
+   * @brief Deserialize restore the frames written by Serialize
+   * @return false if the buffer is corrupted, the index is then empty
+   */
+  bool Deserialize(const std::vector<unsigned char>& data);
+
+private:
+  //! Compressed packets of each frame, see SetFramePackets, empty when unknown
+  std::vector<std::vector<unsigned char> > Frames;
+};
+
+#endif // PACKET_AZIMUTH_INDEX_H
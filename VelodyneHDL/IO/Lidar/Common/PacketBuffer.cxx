@@ -0,0 +1,124 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PacketBuffer.h"
+
+// BOOST
+#include <boost/chrono.hpp>
+
+namespace
+{
+// Enough for the receive batches and for a few seconds of recording of the fastest sensors
+const size_t DefaultNumberOfBuffers = 1 << 14;
+}
+
+//-----------------------------------------------------------------------------
+boost::int64_t PacketBuffer::GetSystemTime()
+{
+  return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+    boost::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+//-----------------------------------------------------------------------------
+void intrusive_ptr_add_ref(PacketBuffer* buffer)
+{
+  buffer->ReferenceCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+//-----------------------------------------------------------------------------
+void intrusive_ptr_release(PacketBuffer* buffer)
+{
+  if (buffer->ReferenceCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    if (buffer->Pool)
+    {
+      buffer->Pool->Release(buffer);
+    }
+    else
+    {
+      delete buffer;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+PacketBufferPool& PacketBufferPool::GetInstance()
+{
+  // never destroyed, as the buffers may be released by threads stopped after the static
+  // destructors
+  static PacketBufferPool* instance = new PacketBufferPool(DefaultNumberOfBuffers);
+  return *instance;
+}
+
+//-----------------------------------------------------------------------------
+PacketBufferPool::PacketBufferPool(size_t numberOfBuffers)
+  : NumberOfBuffers(numberOfBuffers)
+  , Slab(nullptr)
+  , NumberOfHeapBuffers(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+PacketBufferPool::~PacketBufferPool()
+{
+  delete[] this->Slab;
+}
+
+//-----------------------------------------------------------------------------
+PacketBufferPointer PacketBufferPool::Acquire()
+{
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    if (!this->Slab)
+    {
+      // allocated on first use, so that reading files does not cost the memory of the slab
+      this->Slab = new PacketBuffer[this->NumberOfBuffers];
+      this->FreeBuffers.reserve(this->NumberOfBuffers);
+      for (size_t i = this->NumberOfBuffers; i > 0; --i)
+      {
+        this->Slab[i - 1].Pool = this;
+        this->FreeBuffers.push_back(&this->Slab[i - 1]);
+      }
+    }
+    if (!this->FreeBuffers.empty())
+    {
+      PacketBuffer* buffer = this->FreeBuffers.back();
+      this->FreeBuffers.pop_back();
+      buffer->Size = 0;
+      buffer->ArrivalTime = 0;
+      buffer->Source = PacketBuffer::NoTimestamp;
+      return PacketBufferPointer(buffer);
+    }
+  }
+  this->NumberOfHeapBuffers++;
+  return PacketBufferPointer(new PacketBuffer);
+}
+
+//-----------------------------------------------------------------------------
+size_t PacketBufferPool::GetNumberOfFreeBuffers()
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  return this->Slab ? this->FreeBuffers.size() : this->NumberOfBuffers;
+}
+
+//-----------------------------------------------------------------------------
+void PacketBufferPool::Release(PacketBuffer* buffer)
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->FreeBuffers.push_back(buffer);
+}
@@ -0,0 +1,146 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PACKET_BUFFER_H
+#define PACKET_BUFFER_H
+
+// BOOST
+#include <boost/cstdint.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+// STD
+#include <atomic>
+#include <vector>
+
+class PacketBufferPool;
+
+/**
+ * \class PacketBuffer
+ * \brief Reference counted buffer holding a received packet, so that the consumer, the writer
+ *        and the crash analysis share the same data without copy. The buffers are taken from a
+ *        PacketBufferPool and go back to it once the last reference is released.
+ */
+class PacketBuffer
+{
+public:
+  //! Expecting exactly 1206 bytes, using larger buffers so that if a larger packet arrives
+  //! unexpectedly we'll notice it
+  static const size_t Capacity = 1500;
+
+  //! Clock which stamped the arrival of the packet, from the most to the least accurate
+  enum TimestampSource
+  {
+    NoTimestamp = 0,
+    //! stamped by the network card, on the clock of the card which must be synchronized with
+    //! the system clock (phc2sys) for the time to be comparable
+    HardwareTimestamp,
+    //! stamped by the kernel when the packet entered the network stack
+    KernelTimestamp,
+    //! stamped by the receiver once the packet has been read from the socket
+    SoftwareTimestamp
+  };
+
+  unsigned char* GetData() { return this->Data; }
+  const unsigned char* GetData() const { return this->Data; }
+
+  size_t GetSize() const { return this->Size; }
+  void SetSize(size_t size) { this->Size = size; }
+
+  //! Arrival time of the packet on the system clock, in nanoseconds since the epoch, 0 if unknown
+  boost::int64_t GetArrivalTime() const { return this->ArrivalTime; }
+  TimestampSource GetTimestampSource() const { return this->Source; }
+  void SetArrivalTime(boost::int64_t nanoseconds, TimestampSource source)
+  {
+    this->ArrivalTime = nanoseconds;
+    this->Source = source;
+  }
+
+  //! Current time of the system clock, on the scale of the arrival times
+  static boost::int64_t GetSystemTime();
+
+  //! True if nobody else holds the buffer, it can then be reused in place
+  bool IsUnique() const { return this->ReferenceCount.load(std::memory_order_acquire) == 1; }
+
+private:
+  friend class PacketBufferPool;
+  friend void intrusive_ptr_add_ref(PacketBuffer* buffer);
+  friend void intrusive_ptr_release(PacketBuffer* buffer);
+
+  PacketBuffer() = default;
+  PacketBuffer(const PacketBuffer&) = delete;
+  PacketBuffer& operator=(const PacketBuffer&) = delete;
+
+  std::atomic<int> ReferenceCount{ 0 };
+  //! Pool owning the buffer, null if it has been allocated because the pool was empty
+  PacketBufferPool* Pool = nullptr;
+  size_t Size = 0;
+  boost::int64_t ArrivalTime = 0;
+  TimestampSource Source = NoTimestamp;
+  unsigned char Data[Capacity];
+};
+
+typedef boost::intrusive_ptr<PacketBuffer> PacketBufferPointer;
+
+void intrusive_ptr_add_ref(PacketBuffer* buffer);
+void intrusive_ptr_release(PacketBuffer* buffer);
+
+/**
+ * \class PacketBufferPool
+ * \brief Preallocated slab of packet buffers, so that the live path does not allocate memory
+ *        for each packet. If all the buffers are in use, for example when the recording lags
+ *        behind, the new buffers are allocated on the heap and freed once released.
+ */
+class PacketBufferPool
+{
+public:
+  //! Pool shared by all the streams, its buffers are only allocated on the first Acquire
+  static PacketBufferPool& GetInstance();
+
+  //! The pool must outlive all its buffers
+  explicit PacketBufferPool(size_t numberOfBuffers);
+  ~PacketBufferPool();
+
+  /**
+   * @brief Acquire take a free buffer
+   */
+  PacketBufferPointer Acquire();
+
+  /**
+   * @brief GetNumberOfHeapBuffers number of buffers allocated because the pool was empty
+   */
+  unsigned long GetNumberOfHeapBuffers() { return this->NumberOfHeapBuffers; }
+
+  /**
+   * @brief GetNumberOfFreeBuffers number of buffers of the slab not in use
+   */
+  size_t GetNumberOfFreeBuffers();
+
+private:
+  friend void intrusive_ptr_release(PacketBuffer* buffer);
+
+  void Release(PacketBuffer* buffer);
+
+  const size_t NumberOfBuffers;
+  PacketBuffer* Slab;
+  std::vector<PacketBuffer*> FreeBuffers;
+  boost::mutex Mutex;
+  std::atomic<unsigned long> NumberOfHeapBuffers;
+};
+
+#endif // PACKET_BUFFER_H
@@ -1,25 +1,82 @@
 #include "PacketConsumer.h"
+#include "ThreadTopology.h"
+#include "TraceEvents.h"
 
-#include "SynchronizedQueue.h"
-#include "vtkAppendPolyData.h"
+#include <vtkMath.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+// More than a second of the fastest sensors
+const size_t PacketRingSize = 1 << 14;
+
+//----------------------------------------------------------------------------
+// Take the lock, returning the time spent waiting for it if it is held by another thread
+double LockMeasuringWait(boost::unique_lock<boost::mutex>& lock)
+{
+  if (lock.try_lock())
+  {
+    return 0;
+  }
+  const double start = LiveTelemetry::GetTime();
+  lock.lock();
+  return LiveTelemetry::GetTime() - start;
+}
+}
 
 //----------------------------------------------------------------------------
 PacketConsumer::PacketConsumer()
+  : NewData(false)
+  , Snapshot(new FrameSnapshot)
+  , FrameDecodeTime(0)
+  , FrameFirstPacketTime(vtkMath::Nan())
+  , CacheMemory(MemoryAccounting::LIVE_FRAMES)
 {
-  this->NewData = false;
   this->ShouldCheckSensor = true;
   this->MaxNumberOfFrames = 1000;
-  this->LastTime = 0.0;
-  this->Timesteps.clear();
-  this->Frames.clear();
-  this->Packets.reset(new SynchronizedQueue<std::string*>);
+  this->RetentionTime = 0.0;
+  this->MaxCacheSize = 0;
+  this->LastTime = -std::numeric_limits<double>::infinity();
+  this->SensorTimeOrigin = vtkMath::Nan();
+  this->OverflowPolicy = PacketRing::DROP_OLDEST;
+  this->Packets.reset(new PacketRing(PacketRingSize, this->OverflowPolicy));
+  // the live frames are released last, the sensor does not send them again
+  this->CacheMemory.SetReleaser(MemoryAccounting::LIVE_DATA_PRIORITY,
+    [this](unsigned long kibibytes) { this->ReleaseFrames(kibibytes); });
 }
 
 //----------------------------------------------------------------------------
 void PacketConsumer::HandleSensorData(const unsigned char *data, unsigned int length)
 {
-  boost::lock_guard<boost::mutex> lock(this->ReaderMutex);
+  VV_TRACE_SCOPE("PacketConsumer::HandleSensorData");
+  boost::unique_lock<boost::mutex> lock(this->ReaderMutex, boost::defer_lock);
+  this->Telemetry.AddDecodingWaitTime(LockMeasuringWait(lock));
+  const double start = LiveTelemetry::GetTime();
+  if (!vtkMath::IsFinite(this->FrameFirstPacketTime))
+  {
+    this->FrameFirstPacketTime = start;
+  }
   this->Interpreter->ProcessPacket(data, length);
+  this->FrameDecodeTime += LiveTelemetry::GetTime() - start;
+  this->Telemetry.AddDecodedPacket();
+  if (this->Interpreter->GetSectorSize() > 0)
+  {
+    // in sector mode the sectors are published instead of the frames, the last sector of a
+    // frame is given when it is split
+    const std::vector<vtkSmartPointer<vtkPolyData> >& sectors =
+      this->Interpreter->GetSectorsAvailable();
+    for (size_t i = 0; i < sectors.size(); ++i)
+    {
+      this->HandleNewData(sectors[i]);
+    }
+    this->Interpreter->ClearAllSectorsAvailable();
+    this->Interpreter->ClearAllFramesAvailable();
+    return;
+  }
   if (this->Interpreter->IsNewFrameReady())
   {
     this->HandleNewData(this->Interpreter->GetLastFrameAvailable());
@@ -28,73 +85,151 @@ void PacketConsumer::HandleSensorData(const unsigned char *data, unsigned int le
 }
 
 //----------------------------------------------------------------------------
-vtkSmartPointer<vtkPolyData> PacketConsumer::GetFrameForTime(double timeRequest, double &actualTime, int numberOfTrailingFrames)
+vtkSmartPointer<vtkPolyData> PacketConsumer::GetFrameForTime(
+  double timeRequest, double& actualTime, double* firstPacketTime)
 {
-  size_t stepIndex = this->GetIndexForTime(timeRequest);
-  if (stepIndex < this->Timesteps.size())
+  FrameSnapshotPointer snapshot = this->GetSnapshot();
+  size_t stepIndex = GetIndexForTime(snapshot->Timesteps, timeRequest);
+  if (stepIndex < snapshot->Timesteps.size())
   {
-    actualTime = this->Timesteps[stepIndex];
-    if(numberOfTrailingFrames == 0)
+    actualTime = snapshot->Timesteps[stepIndex];
+    if (firstPacketTime)
     {
-      return this->Frames[stepIndex];
-    }
-    else
-    {
-      vtkSmartPointer<vtkAppendPolyData> appendFilter = vtkSmartPointer<vtkAppendPolyData>::New();
-      for (size_t i = stepIndex - std::min(stepIndex, static_cast<size_t>(numberOfTrailingFrames));
-           i < stepIndex; ++i)
-      {
-        appendFilter->AddInputData(this->Frames[i]);
-      }
-
-      appendFilter->Update();
-      return vtkSmartPointer<vtkPolyData>(appendFilter->GetOutput());
+      *firstPacketTime = snapshot->FirstPacketTimes[stepIndex];
     }
+    return snapshot->Frames[stepIndex];
   }
   actualTime = 0;
   return 0;
 }
 
 //----------------------------------------------------------------------------
-std::vector<double> PacketConsumer::GetTimesteps()
+vtkSmartPointer<vtkMultiBlockDataSet> PacketConsumer::GetFramesForTime(
+  double timeRequest, double& actualTime, int numberOfTrailingFrames)
+{
+  vtkSmartPointer<vtkMultiBlockDataSet> frames = vtkSmartPointer<vtkMultiBlockDataSet>::New();
+  FrameSnapshotPointer snapshot = this->GetSnapshot();
+  size_t stepIndex = GetIndexForTime(snapshot->Timesteps, timeRequest);
+  if (stepIndex >= snapshot->Timesteps.size())
+  {
+    actualTime = 0;
+    return frames;
+  }
+
+  actualTime = snapshot->Timesteps[stepIndex];
+  const size_t numberOfFrames =
+    std::min(stepIndex, static_cast<size_t>(std::max(numberOfTrailingFrames, 0))) + 1;
+  frames->SetNumberOfBlocks(static_cast<unsigned int>(numberOfFrames));
+  for (size_t i = 0; i < numberOfFrames; ++i)
+  {
+    frames->SetBlock(static_cast<unsigned int>(i), snapshot->Frames[stepIndex - i]);
+  }
+  return frames;
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> PacketConsumer::GetFrameForDelivery(
+  FrameDelivery& delivery, double& actualTime, double* firstPacketTime)
 {
-  boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
-  const size_t nTimesteps = this->Timesteps.size();
-  std::vector<double> timesteps(nTimesteps, 0);
-  for (size_t i = 0; i < nTimesteps; ++i)
+  FrameSnapshotPointer snapshot = this->GetSnapshot();
+  const int index = delivery.SelectFrame(snapshot->GetFirstFrameNumber(), snapshot->Frames.size());
+  if (index < 0)
+  {
+    actualTime = 0;
+    return 0;
+  }
+  actualTime = snapshot->Timesteps[index];
+  if (firstPacketTime)
   {
-    timesteps[i] = this->Timesteps[i];
+    *firstPacketTime = snapshot->FirstPacketTimes[index];
   }
-  return timesteps;
+  return snapshot->Frames[index];
+}
+
+//----------------------------------------------------------------------------
+size_t PacketConsumer::GetNumberOfPendingFrames(const FrameDelivery& delivery)
+{
+  FrameSnapshotPointer snapshot = this->GetSnapshot();
+  return delivery.GetNumberOfPendingFrames(
+    snapshot->GetFirstFrameNumber(), snapshot->Frames.size());
+}
+
+//----------------------------------------------------------------------------
+std::vector<double> PacketConsumer::GetTimesteps()
+{
+  FrameSnapshotPointer snapshot = this->GetSnapshot();
+  return std::vector<double>(snapshot->Timesteps.begin(), snapshot->Timesteps.end());
 }
 
 //----------------------------------------------------------------------------
 void PacketConsumer::SetMaxNumberOfFrames(int nFrames)
 {
-  boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
-  this->MaxNumberOfFrames = nFrames;
-  this->UpdateDequeSize();
+  {
+    boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
+    this->MaxNumberOfFrames = nFrames;
+  }
+  this->ApplyRetention();
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::SetRetentionTime(double seconds)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
+    this->RetentionTime = std::max(seconds, 0.0);
+  }
+  this->ApplyRetention();
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::SetMaxCacheSize(unsigned long kibibytes)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
+    this->MaxCacheSize = kibibytes;
+  }
+  this->ApplyRetention();
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::ApplyRetention()
+{
+  FrameSnapshotPointer previous;
+  {
+    boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
+    previous = this->GetSnapshot();
+    std::shared_ptr<FrameSnapshot> next(new FrameSnapshot(*previous));
+    this->UpdateDequeSize(*next, LiveTelemetry::GetTime(), 0);
+    std::atomic_store(&this->Snapshot, FrameSnapshotPointer(next));
+    this->CacheMemory.Set(next->TotalSize);
+  }
+  // the evicted frames are released here, outside the lock, unless a reader still holds them
 }
 
 //----------------------------------------------------------------------------
 bool PacketConsumer::CheckForNewData()
 {
-  boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
-  bool newData = this->NewData;
-  this->NewData = false;
-  return newData;
+  return this->NewData.exchange(false);
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::SetNewDataCallback(const NewDataCallback& callback)
+{
+  boost::lock_guard<boost::mutex> lock(this->CallbackMutex);
+  this->OnNewData = callback;
 }
 
 //----------------------------------------------------------------------------
 void PacketConsumer::ThreadLoop()
 {
-  std::string* packet = 0;
+  const unsigned char* data = 0;
+  unsigned int length = 0;
+  ThreadTopology::ApplyToCurrentThread(ThreadTopology::DECODE);
   this->Interpreter->ResetCurrentFrame();
-  while (this->Packets->dequeue(packet))
+  while (this->Packets->WaitFront(data, length))
   {
-    this->HandleSensorData(
-          reinterpret_cast<const unsigned char*>(packet->c_str()), packet->length());
-    delete packet;
+    this->HandleSensorData(data, length);
+    this->Packets->Pop();
   }
 }
 
@@ -106,7 +241,11 @@ void PacketConsumer::Start()
     return;
   }
 
-  this->Packets.reset(new SynchronizedQueue<std::string*>);
+  this->Packets.reset(new PacketRing(PacketRingSize, this->OverflowPolicy));
+  // the sensor may have been restarted, its time is aligned again on the first frame
+  this->SensorTimeOrigin = vtkMath::Nan();
+  this->FrameDecodeTime = 0;
+  this->FrameFirstPacketTime = vtkMath::Nan();
   this->Thread = boost::shared_ptr<boost::thread>(
         new boost::thread(boost::bind(&PacketConsumer::ThreadLoop, this)));
 }
@@ -116,63 +255,257 @@ void PacketConsumer::Stop()
 {
   if (this->Thread)
   {
-    this->Packets->stopQueue();
+    this->Packets->Stop();
     this->Thread->join();
     this->Thread.reset();
+    if (this->Packets->GetNumberOfDroppedPackets() > 0)
+    {
+      vtkGenericWarningMacro("Packets dropped by the consumer: "
+                             << this->Packets->GetNumberOfDroppedPackets());
+    }
     this->Packets.reset();
   }
 }
 
 //----------------------------------------------------------------------------
-void PacketConsumer::Enqueue(std::string *packet) { this->Packets->enqueue(packet); }
+void PacketConsumer::Enqueue(const std::vector<PacketBufferPointer>& packets)
+{
+  // only this thread drops packets, the difference is the number of packets dropped here
+  const unsigned long numberOfDroppedPackets = this->Packets->GetNumberOfDroppedPackets();
+  unsigned long numberOfQueuedPackets = 0;
+  const boost::int64_t now = PacketBuffer::GetSystemTime();
+  for (const PacketBufferPointer& packet : packets)
+  {
+    if (packet->GetArrivalTime() > 0)
+    {
+      this->Telemetry.AddReceiveLatency((now - packet->GetArrivalTime()) * 1e-9);
+    }
+    if (this->Packets->Push(reinterpret_cast<const char*>(packet->GetData()), packet->GetSize()))
+    {
+      numberOfQueuedPackets++;
+    }
+  }
+  this->Telemetry.AddReceivedPackets(packets.size());
+  this->Telemetry.AddQueuedPackets(numberOfQueuedPackets);
+  this->Telemetry.AddDroppedPackets(
+    this->Packets->GetNumberOfDroppedPackets() - numberOfDroppedPackets);
+}
+
+//----------------------------------------------------------------------------
+unsigned long PacketConsumer::GetNumberOfDroppedPackets()
+{
+  return this->Packets ? this->Packets->GetNumberOfDroppedPackets() : 0;
+}
 
 //----------------------------------------------------------------------------
-void PacketConsumer::UnloadData()
+size_t PacketConsumer::GetQueueDepth()
 {
-  this->Frames.clear();
-  this->Timesteps.clear();
+  return this->Packets ? this->Packets->GetDepth() : 0;
 }
 
 //----------------------------------------------------------------------------
-void PacketConsumer::UpdateDequeSize()
+void PacketConsumer::UnloadData()
 {
-  if (this->MaxNumberOfFrames <= 0)
+  FrameSnapshotPointer previous;
   {
-    return;
+    boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
+    previous = this->GetSnapshot();
+    // the frames keep their numbers, so that the deliveries do not give the old ones again
+    std::shared_ptr<FrameSnapshot> next(new FrameSnapshot);
+    next->NumberOfPublishedFrames = previous->NumberOfPublishedFrames;
+    std::atomic_store(&this->Snapshot, FrameSnapshotPointer(next));
+    this->CacheMemory.Set(0);
   }
-  while (static_cast<int>(this->Frames.size()) >= this->MaxNumberOfFrames)
+  // the frames are released here, outside the lock, unless a reader still holds them
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::ReleaseFrames(unsigned long kibibytes)
+{
+  FrameSnapshotPointer previous;
   {
-    this->Frames.pop_front();
-    this->Timesteps.pop_front();
+    boost::unique_lock<boost::mutex> lock(this->ConsumerMutex, boost::try_to_lock);
+    if (!lock.owns_lock())
+    {
+      return;
+    }
+    previous = this->GetSnapshot();
+    // the last frame is kept, it is the one shown
+    size_t numberOfEvicted = 0;
+    unsigned long released = 0;
+    while (released < kibibytes && numberOfEvicted + 1 < previous->Frames.size())
+    {
+      released += previous->FrameSizes[numberOfEvicted++];
+    }
+    if (numberOfEvicted == 0)
+    {
+      return;
+    }
+    std::shared_ptr<FrameSnapshot> next(new FrameSnapshot(*previous));
+    EraseOldestFrames(*next, numberOfEvicted);
+    std::atomic_store(&this->Snapshot, FrameSnapshotPointer(next));
+    this->CacheMemory.Set(next->TotalSize);
   }
+  // the evicted frames are released here, outside the lock, unless a reader still holds them
 }
 
 //----------------------------------------------------------------------------
-size_t PacketConsumer::GetIndexForTime(double time)
+void PacketConsumer::UpdateDequeSize(
+  FrameSnapshot& snapshot, double now, unsigned long newFrameSize)
 {
-  size_t index = 0;
-  double minDifference = VTK_DOUBLE_MAX;
-  const size_t nTimesteps = this->Timesteps.size();
-  for (size_t i = 0; i < nTimesteps; ++i)
+  // the frames are ordered by publication, so the frames to evict are the first ones
+  const size_t numberOfFrames = snapshot.Frames.size();
+  size_t numberOfEvicted = 0;
+  if (this->MaxNumberOfFrames > 0 &&
+    numberOfFrames >= static_cast<size_t>(this->MaxNumberOfFrames))
+  {
+    numberOfEvicted = numberOfFrames - this->MaxNumberOfFrames + (newFrameSize > 0 ? 1 : 0);
+  }
+  if (this->RetentionTime > 0)
+  {
+    while (numberOfEvicted < numberOfFrames &&
+      now - snapshot.PublicationTimes[numberOfEvicted] > this->RetentionTime)
+    {
+      numberOfEvicted++;
+    }
+  }
+  numberOfEvicted = std::min(numberOfEvicted, numberOfFrames);
+  unsigned long totalSize = snapshot.TotalSize;
+  for (size_t i = 0; i < numberOfEvicted; ++i)
   {
-    double difference = std::abs(this->Timesteps[i] - time);
-    if (difference < minDifference)
+    totalSize -= snapshot.FrameSizes[i];
+  }
+  if (this->MaxCacheSize > 0)
+  {
+    while (numberOfEvicted < numberOfFrames && totalSize + newFrameSize > this->MaxCacheSize)
     {
-      minDifference = difference;
-      index = i;
+      totalSize -= snapshot.FrameSizes[numberOfEvicted++];
     }
   }
+
+  EraseOldestFrames(snapshot, numberOfEvicted);
+}
+
+//----------------------------------------------------------------------------
+void PacketConsumer::EraseOldestFrames(FrameSnapshot& snapshot, size_t numberOfEvicted)
+{
+  for (size_t i = 0; i < numberOfEvicted; ++i)
+  {
+    snapshot.TotalSize -= snapshot.FrameSizes[i];
+  }
+  snapshot.Frames.erase(snapshot.Frames.begin(), snapshot.Frames.begin() + numberOfEvicted);
+  snapshot.Timesteps.erase(
+    snapshot.Timesteps.begin(), snapshot.Timesteps.begin() + numberOfEvicted);
+  snapshot.PublicationTimes.erase(
+    snapshot.PublicationTimes.begin(), snapshot.PublicationTimes.begin() + numberOfEvicted);
+  snapshot.FirstPacketTimes.erase(
+    snapshot.FirstPacketTimes.begin(), snapshot.FirstPacketTimes.begin() + numberOfEvicted);
+  snapshot.FrameSizes.erase(
+    snapshot.FrameSizes.begin(), snapshot.FrameSizes.begin() + numberOfEvicted);
+}
+
+//----------------------------------------------------------------------------
+size_t PacketConsumer::GetIndexForTime(const std::deque<double>& timesteps, double time)
+{
+  if (timesteps.empty())
+  {
+    return 0;
+  }
+
+  // the timesteps are increasing, the closest one is next to the first not less than time
+  const size_t index =
+    std::distance(timesteps.begin(), std::lower_bound(timesteps.begin(), timesteps.end(), time));
+  if (index == timesteps.size())
+  {
+    return index - 1;
+  }
+  if (index > 0 && time - timesteps[index - 1] <= timesteps[index] - time)
+  {
+    return index - 1;
+  }
   return index;
 }
 
 //----------------------------------------------------------------------------
 void PacketConsumer::HandleNewData(vtkSmartPointer<vtkPolyData> polyData)
 {
-  boost::lock_guard<boost::mutex> lock(this->ConsumerMutex);
+  // at least 1 so that an empty frame still takes room in the cache
+  const unsigned long frameSize = std::max(polyData->GetActualMemorySize(), 1ul);
+  const double now = LiveTelemetry::GetTime();
+  const double frameTime = this->ComputeFrameTime(polyData);
+  // the sectors published by the same packet after the first one have no packet of their own
+  const double firstPacketTime =
+    vtkMath::IsFinite(this->FrameFirstPacketTime) ? this->FrameFirstPacketTime : now;
+  this->Telemetry.AddFrame(this->FrameDecodeTime);
+  this->FrameDecodeTime = 0;
+  this->FrameFirstPacketTime = vtkMath::Nan();
+  FrameSnapshotPointer previous;
+  {
+    boost::unique_lock<boost::mutex> lock(this->ConsumerMutex, boost::defer_lock);
+    this->Telemetry.AddPublishingWaitTime(LockMeasuringWait(lock));
 
-  this->UpdateDequeSize();
-  this->Timesteps.push_back(this->LastTime);
-  this->Frames.push_back(polyData);
+    // the readers keep using the previous snapshot until they take the new one
+    previous = this->GetSnapshot();
+    std::shared_ptr<FrameSnapshot> next(new FrameSnapshot(*previous));
+    this->UpdateDequeSize(*next, now, frameSize);
+    next->Timesteps.push_back(frameTime);
+    next->Frames.push_back(polyData);
+    next->PublicationTimes.push_back(now);
+    next->FirstPacketTimes.push_back(firstPacketTime);
+    next->FrameSizes.push_back(frameSize);
+    next->TotalSize += frameSize;
+    next->NumberOfPublishedFrames++;
+    std::atomic_store(&this->Snapshot, FrameSnapshotPointer(next));
+    this->CacheMemory.Set(next->TotalSize);
+  }
   this->NewData = true;
-  this->LastTime += 1.0;
+  if (this->FrameServer && this->Interpreter->GetSectorSize() == 0)
+  {
+    this->FrameServer->SendFrame(polyData, frameTime);
+  }
+  if (this->SharedMemoryRing && this->Interpreter->GetSectorSize() == 0)
+  {
+    this->SharedMemoryRing->Publish(polyData, frameTime);
+  }
+  if (this->Ros2 && this->Interpreter->GetSectorSize() == 0)
+  {
+    this->Ros2->PublishFrame(polyData, frameTime);
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(this->CallbackMutex);
+    if (this->OnNewData)
+    {
+      this->OnNewData();
+    }
+  }
+  // the evicted frames are released here, outside the lock
+}
+
+//----------------------------------------------------------------------------
+double PacketConsumer::ComputeFrameTime(vtkPolyData* polyData)
+{
+  const double now = std::chrono::duration_cast<std::chrono::duration<double> >(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  const double sensorTime = this->Interpreter->GetFrameSensorTime(polyData);
+
+  double time = now;
+  if (vtkMath::IsFinite(sensorTime))
+  {
+    // the sensor gives the time since the top of the hour, the hour comes from the system clock.
+    // A sensor without GPS synchronization keeps correct intervals between its frames.
+    if (!vtkMath::IsFinite(this->SensorTimeOrigin))
+    {
+      this->SensorTimeOrigin = std::round((now - sensorTime) / 3600.) * 3600.;
+    }
+    time = this->SensorTimeOrigin + sensorTime;
+  }
+  time += this->Interpreter->GetTimeOffset();
+
+  // the cache is sorted by time, which could go back if the sensor restarts
+  if (time <= this->LastTime)
+  {
+    time = this->LastTime + 1e-6;
+  }
+  this->LastTime = time;
+  return time;
 }
@@ -29,27 +29,81 @@
 #ifndef PACKETCONSUMER_H
 #define PACKETCONSUMER_H
 
+#include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 #include <vtkNew.h>
+#include <atomic>
 #include <deque>
+#include <memory>
+#include <vector>
 
+#include "vtkMultiBlockDataSet.h"
 #include "vtkSmartPointer.h"
 #include "vtkLidarPacketInterpreter.h"
-
-
-template<typename T>
-class SynchronizedQueue;
+#include "FrameDelivery.h"
+#include "FrameStreamServer.h"
+#include "LiveTelemetry.h"
+#include "MemoryAccounting.h"
+#include "PacketBuffer.h"
+#include "PacketRing.h"
+#include "Ros2Publisher.h"
+#include "SharedMemoryFrameRing.h"
 
 class PacketConsumer
 {
 public:
   PacketConsumer();
 
+  /**
+   * Frames of the live cache at a given time. A snapshot is never modified once published, the
+   * decoding thread publishes a new one with each frame, so that the readers never wait for
+   * the decoding and the decoding never waits for the readers.
+   */
+  struct FrameSnapshot
+  {
+    std::deque<vtkSmartPointer<vtkPolyData> > Frames;
+    std::deque<double> Timesteps;
+    //! When each frame has been published, in seconds of a steady clock
+    std::deque<double> PublicationTimes;
+    //! When the first packet of each frame has been decoded, in seconds of the same clock
+    std::deque<double> FirstPacketTimes;
+    //! Memory used by each frame, in kibibytes
+    std::deque<unsigned long> FrameSizes;
+    unsigned long TotalSize = 0;
+    //! Frames published since the creation of the consumer, the last frame is the last of them
+    unsigned long NumberOfPublishedFrames = 0;
+
+    //! Number of the first frame in the order of publication, see FrameDelivery
+    unsigned long GetFirstFrameNumber() const
+    {
+      return this->NumberOfPublishedFrames - static_cast<unsigned long>(this->Frames.size());
+    }
+  };
+  typedef std::shared_ptr<const FrameSnapshot> FrameSnapshotPointer;
+
   void HandleSensorData(const unsigned char* data, unsigned int length);
 
-  // You must lock PacketConsumer.ConsumerMutex while calling this function
-  vtkSmartPointer<vtkPolyData> GetFrameForTime(double timeRequest, double& actualTime, int numberOfTrailingFrame = 0);
+  // Current frames, they stay valid as long as the snapshot is held. No lock is needed.
+  FrameSnapshotPointer GetSnapshot() const { return std::atomic_load(&this->Snapshot); }
+
+  // Frame of the current snapshot closest to timeRequest. No lock is needed.
+  // If firstPacketTime is given, it is set to when the first packet of the frame was decoded.
+  vtkSmartPointer<vtkPolyData> GetFrameForTime(
+    double timeRequest, double& actualTime, double* firstPacketTime = nullptr);
+
+  // Same as GetFrameForTime with the previous frames, the block 0 is the requested frame, the
+  // block 1 the previous one, and so on. The frames are shared with the cache, not copied.
+  vtkSmartPointer<vtkMultiBlockDataSet> GetFramesForTime(
+    double timeRequest, double& actualTime, int numberOfTrailingFrames);
+
+  // Frame of the current snapshot chosen by the delivery of a consumer which takes the frames
+  // in order, see FrameDelivery. No lock is needed.
+  vtkSmartPointer<vtkPolyData> GetFrameForDelivery(
+    FrameDelivery& delivery, double& actualTime, double* firstPacketTime = nullptr);
+
+  // Number of frames of the current snapshot waiting for the delivery of a consumer
+  size_t GetNumberOfPendingFrames(const FrameDelivery& delivery);
 
   std::vector<double> GetTimesteps();
 
@@ -57,43 +111,134 @@ public:
 
   void SetMaxNumberOfFrames(int nFrames);
 
+  //! Only keep the frames published during the last seconds, 0 means no limit
+  double GetRetentionTime() { return this->RetentionTime; }
+  void SetRetentionTime(double seconds);
+
+  //! Only keep the latest frames using up to this memory, in kibibytes, 0 means no limit
+  unsigned long GetMaxCacheSize() { return this->MaxCacheSize; }
+  void SetMaxCacheSize(unsigned long kibibytes);
+
+  //! Memory used by the cached frames, in kibibytes
+  unsigned long GetCacheSize() { return this->GetSnapshot()->TotalSize; }
+
   bool CheckForNewData();
 
+  //! Called on the decoding thread each time a frame is published, it must not block
+  typedef boost::function<void()> NewDataCallback;
+
+  //! Notify the frames instead of waiting for CheckForNewData to be polled, an empty callback
+  //! removes it. Once this returns, the previous callback is not running anymore.
+  void SetNewDataCallback(const NewDataCallback& callback);
+
   void ThreadLoop();
 
   void Start();
 
   void Stop();
 
-  void Enqueue(std::string* packet);
+  //! Copy the packets in the ring
+  void Enqueue(const std::vector<PacketBufferPointer>& packets);
+
+  //! What to drop when the packets come faster than they are processed, used by the next Start
+  void SetOverflowPolicy(PacketRing::OverflowPolicy policy) { this->OverflowPolicy = policy; }
+
+  //! Number of packets dropped since the last Start because the ring was full
+  unsigned long GetNumberOfDroppedPackets();
+
+  //! Number of packets waiting to be decoded
+  size_t GetQueueDepth();
 
   void SetInterpreter(vtkLidarPacketInterpreter* inter) { this->Interpreter = inter;}
 
+  //! Also send the frames to the remote viewers, set before Start. The sectors are not sent.
+  void SetFrameStreamServer(std::shared_ptr<FrameStreamServer> server)
+  {
+    this->FrameServer = server;
+  }
+
+  //! Also publish the frames in a shared memory ring, set before Start. The sectors are not.
+  void SetSharedMemoryRing(std::shared_ptr<SharedMemoryFrameRing> ring)
+  {
+    this->SharedMemoryRing = ring;
+  }
+
+  //! Also publish the frames on ROS 2, set before Start. The sectors are not published.
+  void SetRos2Publisher(std::shared_ptr<Ros2Publisher> publisher)
+  {
+    this->Ros2 = publisher;
+  }
+
   void UnloadData();
 
+  //! Total time the decoding thread waited for ReaderMutex, in seconds
+  double GetDecodingWaitTime() { return this->Telemetry.GetDecodingWaitTime(); }
+
+  //! Total time the publication of the frames waited for ConsumerMutex, in seconds
+  double GetPublishingWaitTime() { return this->Telemetry.GetPublishingWaitTime(); }
+
+  //! Counters of the packets and of the frames, since the creation of the consumer
+  LiveTelemetry& GetTelemetry() { return this->Telemetry; }
+
   // Hold this when running reader code code or modifying its internals
   boost::mutex ReaderMutex;
 
-  // Hold this when modifying internals of reader
+  // Held while publishing a new snapshot, never needed to read the frames
   boost::mutex ConsumerMutex;
 
 protected:
-  void UpdateDequeSize();
+  // Remove at once the oldest frames which do not fit the retention limits, keeping room for
+  // a new frame of the given size, 0 if no frame is added
+  void UpdateDequeSize(FrameSnapshot& snapshot, double now, unsigned long newFrameSize);
+
+  // Apply the retention limits to the published frames
+  void ApplyRetention();
+
+  // Releaser of CacheMemory, evict the oldest published frames to free the given memory
+  void ReleaseFrames(unsigned long kibibytes);
 
-  size_t GetIndexForTime(double time);
+  // Remove the given number of oldest frames and update TotalSize
+  static void EraseOldestFrames(FrameSnapshot& snapshot, size_t numberOfEvicted);
+
+  static size_t GetIndexForTime(const std::deque<double>& timesteps, double time);
 
   void HandleNewData(vtkSmartPointer<vtkPolyData> polyData);
 
+  // Timestep of a new frame, in seconds since the epoch like the timesteps of the reader. The
+  // time given by the sensor is aligned on the hour of the system clock, the system clock is
+  // used if the frame has no sensor time. The timesteps are kept increasing.
+  double ComputeFrameTime(vtkPolyData* polyData);
+
   bool ShouldCheckSensor;
-  bool NewData;
+  std::atomic<bool> NewData;
+  //! Protects OnNewData, which is called by the decoding thread
+  boost::mutex CallbackMutex;
+  NewDataCallback OnNewData;
   int MaxNumberOfFrames;
+  double RetentionTime;
+  unsigned long MaxCacheSize;
   double LastTime;
+  //! Offset from the time of the sensor to the epoch, NaN until the first frame
+  double SensorTimeOrigin;
 
-  std::deque<vtkSmartPointer<vtkPolyData> > Frames;
-  std::deque<double> Timesteps;
+  //! Published frames, only accessed with std::atomic_load and std::atomic_store
+  FrameSnapshotPointer Snapshot;
   vtkLidarPacketInterpreter* Interpreter;
-
-  boost::shared_ptr<SynchronizedQueue<std::string*> > Packets;
+  std::shared_ptr<FrameStreamServer> FrameServer;
+  std::shared_ptr<SharedMemoryFrameRing> SharedMemoryRing;
+  std::shared_ptr<Ros2Publisher> Ros2;
+
+  LiveTelemetry Telemetry;
+  //! Time spent decoding the packets of the current frame, only used by the decoding thread
+  double FrameDecodeTime;
+  //! When the first packet of the current frame has been decoded, NaN until it is
+  double FrameFirstPacketTime;
+  //! Memory used by the cached frames, set with each snapshot
+  MemoryAccounting::Account CacheMemory;
+
+  // Packets received and not processed yet, fed by the single network thread
+  boost::shared_ptr<PacketRing> Packets;
+  PacketRing::OverflowPolicy OverflowPolicy;
 
   boost::shared_ptr<boost::thread> Thread;
 };
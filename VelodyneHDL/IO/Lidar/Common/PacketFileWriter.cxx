@@ -1,18 +1,67 @@
 #include "PacketFileWriter.h"
+#include "ThreadTopology.h"
 
 //! @todo this include is only for vtkGenericWarningMacro which is strange
 #include <vtkMath.h>
 
+#include <vector>
+
+namespace
+{
+//! The packets are coalesced in a buffer of this size before being written
+const size_t WriteBufferSize = 4 << 20;
+//! Maximum time a packet waits in the buffer, so that a crash does not lose much data
+const boost::chrono::milliseconds FlushInterval(500);
+//! Above this number of queued packets, which is about 20 seconds of a VLS-128,
+//! the new packets are dropped
+const size_t MaxQueueDepth = 1 << 18;
+}
+
+//-----------------------------------------------------------------------------
+PacketFileWriter::PacketFileWriter()
+  : NumberOfDroppedPackets(0)
+  , NumberOfWrittenPackets(0)
+{
+  this->PacketWriter.SetBufferSize(WriteBufferSize);
+}
+
 //-----------------------------------------------------------------------------
 void PacketFileWriter::ThreadLoop()
 {
-  std::string* packet = 0;
-  while (this->Packets->dequeue(packet))
+  ThreadTopology::ApplyToCurrentThread(ThreadTopology::RECORD);
+  std::vector<PacketBufferPointer> packets;
+  boost::chrono::steady_clock::time_point lastFlush = boost::chrono::steady_clock::now();
+  bool isRunning = true;
+  while (isRunning)
   {
-    this->PacketWriter.WritePacket(
-          reinterpret_cast<const unsigned char*>(packet->c_str()), packet->length());
+    isRunning = this->Packets->dequeueAll(packets, FlushInterval);
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+      const unsigned int size = static_cast<unsigned int>(packets[i]->GetSize());
+      const boost::int64_t arrivalTime = packets[i]->GetArrivalTime();
+      if (arrivalTime > 0)
+      {
+        // the pcap headers get the time the packet arrived, not the time it is written
+        timeval time;
+        time.tv_sec = static_cast<long>(arrivalTime / 1000000000);
+        time.tv_usec = static_cast<long>(arrivalTime % 1000000000 / 1000);
+        this->PacketWriter.WritePacket(packets[i]->GetData(), size, time);
+      }
+      else
+      {
+        this->PacketWriter.WritePacket(packets[i]->GetData(), size);
+      }
+    }
+    this->NumberOfWrittenPackets += packets.size();
+    // give the buffers back to the pool without waiting for the next packets
+    packets.clear();
 
-    delete packet;
+    const boost::chrono::steady_clock::time_point now = boost::chrono::steady_clock::now();
+    if (!isRunning || now - lastFlush >= FlushInterval)
+    {
+      this->PacketWriter.Flush();
+      lastFlush = now;
+    }
   }
 }
 
@@ -38,7 +87,9 @@ void PacketFileWriter::Start(const std::string &filename)
     }
   }
 
-  this->Packets.reset(new SynchronizedQueue<std::string*>);
+  this->NumberOfDroppedPackets = 0;
+  this->NumberOfWrittenPackets = 0;
+  this->Packets.reset(new SynchronizedQueue<PacketBufferPointer>);
   this->Thread = boost::shared_ptr<boost::thread>(
         new boost::thread(boost::bind(&PacketFileWriter::ThreadLoop, this)));
 }
@@ -56,17 +107,24 @@ void PacketFileWriter::Stop()
 }
 
 //-----------------------------------------------------------------------------
-void PacketFileWriter::Enqueue(std::string *packet)
+void PacketFileWriter::Enqueue(const std::vector<PacketBufferPointer>& packets)
 {
   // TODO
   // After capturing a stream and stoping the recording, Packets is NULL
   // and this loop continues until a new reader or stream is selected.
   if (this->Packets != NULL)
   {
-    this->Packets->enqueue(packet);
+    const size_t count = this->Packets->tryEnqueueAll(packets, MaxQueueDepth);
+    this->NumberOfDroppedPackets += packets.size() - count;
   }
   else
   {
     this->Stop();
   }
 }
+
+//-----------------------------------------------------------------------------
+unsigned int PacketFileWriter::GetQueueDepth()
+{
+  return this->Packets ? this->Packets->size() : 0;
+}
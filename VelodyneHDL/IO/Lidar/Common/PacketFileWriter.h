@@ -29,33 +29,68 @@
 #ifndef PACKETWRITER_H
 #define PACKETWRITER_H
 
+#include <atomic>
 #include <string>
 #include <queue>
+#include <vector>
 #include <boost/thread/thread.hpp>
 #include <boost/asio.hpp>
 
 #include "vtkPacketFileWriter.h"
+#include "PacketBuffer.h"
 #include "SynchronizedQueue.h"
 
+/**
+ * @brief The PacketFileWriter class records the packets received from a sensor in a pcap file.
+ * The packets are written by a dedicated thread, which coalesces them in large buffers and
+ * writes them when the buffer is full or after a while, so that the disk does not see a small
+ * write for each packet. If the disk cannot keep up, the queue is bounded and the packets in
+ * excess are dropped (and counted) instead of backing up the receive path.
+ */
 class PacketFileWriter
 {
 public:
+  PacketFileWriter();
+
   void ThreadLoop();
 
   void Start(const std::string& filename);
 
+  /**
+   * @brief Stop write all the queued packets and stop the writing thread
+   */
   void Stop();
 
-  void Enqueue(std::string* packet);
+  //! Queue a batch of packets, the queue is locked once. The buffers are shared, not copied.
+  void Enqueue(const std::vector<PacketBufferPointer>& packets);
 
   bool IsOpen() { return this->PacketWriter.IsOpen(); }
 
   void Close() { this->PacketWriter.Close(); }
 
+  /**
+   * @brief GetQueueDepth number of packets waiting to be written
+   */
+  unsigned int GetQueueDepth();
+
+  /**
+   * @brief GetNumberOfDroppedPackets number of packets which have not been recorded because the
+   * queue was full, since the last Start
+   */
+  unsigned long GetNumberOfDroppedPackets() { return this->NumberOfDroppedPackets; }
+
+  /**
+   * @brief GetNumberOfWrittenPackets number of packets recorded since the last Start
+   */
+  unsigned long GetNumberOfWrittenPackets() { return this->NumberOfWrittenPackets; }
+
 private:
   vtkPacketFileWriter PacketWriter;
   boost::shared_ptr<boost::thread> Thread;
-  boost::shared_ptr<SynchronizedQueue<std::string*> > Packets;
+  boost::shared_ptr<SynchronizedQueue<PacketBufferPointer> > Packets;
+
+  std::atomic<unsigned long> NumberOfDroppedPackets;
+  std::atomic<unsigned long> NumberOfWrittenPackets;
 };
 
 
@@ -0,0 +1,206 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "PacketForwarder.h"
+#include "ThreadTopology.h"
+
+// VTK
+#include <vtkSetGet.h>
+
+// BOOST
+#include <boost/algorithm/string.hpp>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+//! Maximum time the sending thread sleeps without checking if it is stopped
+const boost::chrono::milliseconds WaitInterval(100);
+//! Above this number of queued packets, about a tenth of a second of a VLS-128, the new packets
+//! are dropped, so that a destination which cannot keep up does not hold the pooled buffers
+const size_t MaxQueueDepth = 1 << 12;
+}
+
+//-----------------------------------------------------------------------------
+PacketForwarder::PacketForwarder()
+  : Socket(IOService)
+  , NumberOfDroppedPackets(0)
+  , NumberOfSentPackets(0)
+  , NumberOfSendErrors(0)
+{
+  this->Socket.open(boost::asio::ip::udp::v4());
+  // Allow to send the packet on the same machine
+  this->Socket.set_option(boost::asio::ip::multicast::enable_loopback(true));
+}
+
+//-----------------------------------------------------------------------------
+PacketForwarder::~PacketForwarder()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+bool PacketForwarder::AddDestination(const std::string& ipAddress, int port)
+{
+  boost::system::error_code errCode;
+  const boost::asio::ip::address address =
+    boost::asio::ip::address_v4::from_string(ipAddress, errCode);
+  if (errCode)
+  {
+    vtkGenericWarningMacro("Forward ip address " << ipAddress << " not valid, packets won't be "
+      "forwarded to it");
+    return false;
+  }
+  this->Destinations.push_back(boost::asio::ip::udp::endpoint(address, port));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int PacketForwarder::AddDestinations(const std::string& ipAddresses, int port)
+{
+  std::vector<std::string> addresses;
+  boost::split(addresses, ipAddresses, boost::is_any_of(",; "), boost::token_compress_on);
+  int numberOfDestinations = 0;
+  for (size_t i = 0; i < addresses.size(); ++i)
+  {
+    if (!addresses[i].empty() && this->AddDestination(addresses[i], port))
+    {
+      numberOfDestinations++;
+    }
+  }
+  return numberOfDestinations;
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::Start()
+{
+  if (this->Thread || this->Destinations.empty())
+  {
+    return;
+  }
+
+  this->NumberOfDroppedPackets = 0;
+  this->NumberOfSentPackets = 0;
+  this->NumberOfSendErrors = 0;
+  this->Packets.reset(new SynchronizedQueue<PacketBufferPointer>);
+  this->Thread = boost::shared_ptr<boost::thread>(
+    new boost::thread(boost::bind(&PacketForwarder::ThreadLoop, this)));
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::Stop()
+{
+  if (this->Thread)
+  {
+    this->Packets->stopQueue();
+    this->Thread->join();
+    this->Thread.reset();
+    this->Packets.reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::Enqueue(const std::vector<PacketBufferPointer>& packets)
+{
+  if (this->Packets)
+  {
+    const size_t count = this->Packets->tryEnqueueAll(packets, MaxQueueDepth);
+    this->NumberOfDroppedPackets += packets.size() - count;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::ThreadLoop()
+{
+  ThreadTopology::ApplyToCurrentThread(ThreadTopology::FORWARD);
+  std::vector<PacketBufferPointer> packets;
+  bool isRunning = true;
+  while (isRunning)
+  {
+    isRunning = this->Packets->dequeueAll(packets, WaitInterval);
+    for (size_t i = 0; i < this->Destinations.size(); ++i)
+    {
+      this->Send(packets, this->Destinations[i]);
+    }
+    // give the buffers back to the pool without waiting for the next packets
+    packets.clear();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PacketForwarder::Send(const std::vector<PacketBufferPointer>& packets,
+  const boost::asio::ip::udp::endpoint& destination)
+{
+#ifdef __linux__
+  mmsghdr messages[FORWARD_BATCH_SIZE];
+  iovec buffers[FORWARD_BATCH_SIZE];
+  for (size_t first = 0; first < packets.size(); first += FORWARD_BATCH_SIZE)
+  {
+    const unsigned int batchSize =
+      static_cast<unsigned int>(std::min<size_t>(packets.size() - first, FORWARD_BATCH_SIZE));
+    std::memset(messages, 0, sizeof(messages));
+    for (unsigned int i = 0; i < batchSize; ++i)
+    {
+      const PacketBufferPointer& packet = packets[first + i];
+      buffers[i].iov_base = packet->GetData();
+      buffers[i].iov_len = packet->GetSize();
+      messages[i].msg_hdr.msg_name = const_cast<sockaddr*>(destination.data());
+      messages[i].msg_hdr.msg_namelen = static_cast<socklen_t>(destination.size());
+      messages[i].msg_hdr.msg_iov = &buffers[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    unsigned int sent = 0;
+    while (sent < batchSize)
+    {
+      const int count =
+        sendmmsg(this->Socket.native_handle(), messages + sent, batchSize - sent, 0);
+      if (count <= 0)
+      {
+        // the packet which failed is skipped
+        this->NumberOfSendErrors++;
+        sent++;
+        continue;
+      }
+      this->NumberOfSentPackets += count;
+      sent += count;
+    }
+  }
+#else
+  for (size_t i = 0; i < packets.size(); ++i)
+  {
+    boost::system::error_code error;
+    this->Socket.send_to(
+      boost::asio::buffer(packets[i]->GetData(), packets[i]->GetSize()), destination, 0, error);
+    if (error)
+    {
+      this->NumberOfSendErrors++;
+    }
+    else
+    {
+      this->NumberOfSentPackets++;
+    }
+  }
+#endif
+}
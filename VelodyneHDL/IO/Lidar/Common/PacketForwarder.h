@@ -0,0 +1,115 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef PACKET_FORWARDER_H
+#define PACKET_FORWARDER_H
+
+// LOCAL
+#include "PacketBuffer.h"
+#include "SynchronizedQueue.h"
+
+// BOOST
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+
+// STD
+#include <atomic>
+#include <string>
+#include <vector>
+
+/*!< Maximum number of packets sent at once to a destination */
+#define FORWARD_BATCH_SIZE 64
+
+/**
+ * \class PacketForwarder
+ * \brief Send a copy of the received packets to one or several destinations. The packets are
+ *        sent by a dedicated thread, in batches with sendmmsg on Linux, from the buffers shared
+ *        with the other consumers of the packets, so that a slow destination never delays the
+ *        reception. The queue is bounded and the packets in excess are dropped and counted.
+ */
+class PacketForwarder
+{
+public:
+  PacketForwarder();
+  ~PacketForwarder();
+
+  /**
+   * @brief AddDestination add a destination before Start
+   * @param ipAddress ip address, which can be a multicast group
+   * @param port port of the destination
+   * @return false if the address is not valid, the destination is then ignored
+   */
+  bool AddDestination(const std::string& ipAddress, int port);
+
+  /**
+   * @brief AddDestinations add a list of ip addresses separated by commas, semicolons or
+   * spaces, all with the same port, see AddDestination
+   * @return the number of destinations added
+   */
+  int AddDestinations(const std::string& ipAddresses, int port);
+
+  size_t GetNumberOfDestinations() { return this->Destinations.size(); }
+
+  void Start();
+
+  /**
+   * @brief Stop send the queued packets and stop the sending thread
+   */
+  void Stop();
+
+  //! Queue a batch of packets, the queue is locked once. The buffers are shared, not copied.
+  void Enqueue(const std::vector<PacketBufferPointer>& packets);
+
+  /**
+   * @brief GetNumberOfDroppedPackets number of packets which have not been forwarded because
+   * the queue was full, since the last Start
+   */
+  unsigned long GetNumberOfDroppedPackets() { return this->NumberOfDroppedPackets; }
+
+  /**
+   * @brief GetNumberOfSentPackets number of packets sent since the last Start, counted once
+   * for each destination
+   */
+  unsigned long GetNumberOfSentPackets() { return this->NumberOfSentPackets; }
+
+  /**
+   * @brief GetNumberOfSendErrors number of packets the system refused to send
+   */
+  unsigned long GetNumberOfSendErrors() { return this->NumberOfSendErrors; }
+
+private:
+  void ThreadLoop();
+
+  //! Send the packets to a destination, by batches of FORWARD_BATCH_SIZE
+  void Send(const std::vector<PacketBufferPointer>& packets,
+    const boost::asio::ip::udp::endpoint& destination);
+
+  //! Only owns the socket, the sends are synchronous
+  boost::asio::io_service IOService;
+  boost::asio::ip::udp::socket Socket;
+  std::vector<boost::asio::ip::udp::endpoint> Destinations;
+
+  boost::shared_ptr<boost::thread> Thread;
+  boost::shared_ptr<SynchronizedQueue<PacketBufferPointer> > Packets;
+
+  std::atomic<unsigned long> NumberOfDroppedPackets;
+  std::atomic<unsigned long> NumberOfSentPackets;
+  std::atomic<unsigned long> NumberOfSendErrors;
+};
+
+#endif // PACKET_FORWARDER_H
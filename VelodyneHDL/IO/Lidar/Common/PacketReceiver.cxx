@@ -21,56 +21,114 @@
 
 #include <vtkMath.h>
 
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#endif
+
+namespace
+{
+#ifdef __linux__
+//! Timestamps given by SO_TIMESTAMPING: software, deprecated, and raw hardware
+const int NumberOfTimestamps = 3;
+
+//! Control data of a received packet: the drop counter and the arrival timestamps
+const size_t ControlSize =
+  CMSG_SPACE(sizeof(uint32_t)) + CMSG_SPACE(NumberOfTimestamps * sizeof(timespec));
+
+//-----------------------------------------------------------------------------
+boost::int64_t ToNanoseconds(const timespec& time)
+{
+  return static_cast<boost::int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+}
+#endif
+}
+
 
 //-----------------------------------------------------------------------------
 PacketReceiver::PacketReceiver(boost::asio::io_service &io, int port, int forwardport, std::string forwarddestinationIp, bool isforwarding, NetworkSource *parent)
-  : isForwarding(isforwarding)
-  , Port(port)
+  : Port(port)
   , PacketCounter(0)
   , Socket(io)
-  , ForwardedSocket(io)
   , Parent(parent)
+  , NumberOfKernelDrops(0)
+  , IsFilteringSource(false)
+  , NumberOfFilteredPackets(0)
   , IsReceiving(true)
   , ShouldStop(false)
 {
+  for (int i = 0; i < RECEIVE_BATCH_SIZE; ++i)
+  {
+    this->Buffers.push_back(PacketBufferPool::GetInstance().Acquire());
+  }
+  this->Batch.reserve(RECEIVE_BATCH_SIZE);
+
   this->Socket.open(boost::asio::ip::udp::v4()); // Opening the socket with an UDP v4 protocol
   this->Socket.set_option(boost::asio::ip::udp::socket::reuse_address(
                       true)); // Tell the OS we accept to re-use the port address for an other app
   this->Socket.bind(boost::asio::ip::udp::endpoint(
                 boost::asio::ip::udp::v4(), port)); // Bind the socket to the right address
 
-  // Check that the provided ipadress is valid
-  boost::system::error_code errCode;
-  boost::asio::ip::address ipAddressForwarding = boost::asio::ip::address_v4::from_string(forwarddestinationIp, errCode);
-
-  // If the ip address is not valid we replace it by a generic
-  // 0.0.0.0 ip address. This is due to the application
-  // crashes on windows if a not valid ip address is provided
-  // with error message:
-  // Qt has caught an exception from an event handler. This
-  // is not supported in Qt.
-  if (errCode)
+  // The packets are read without blocking once the socket is readable, see ReceiveBatch
+  this->Socket.non_blocking(true);
+  boost::system::error_code bufferError;
+  this->Socket.set_option(
+    boost::asio::socket_base::receive_buffer_size(RECEIVE_BUFFER_BYTES), bufferError);
+  boost::asio::socket_base::receive_buffer_size bufferSize;
+  this->Socket.get_option(bufferSize, bufferError);
+  if (bufferError || bufferSize.value() < RECEIVE_BUFFER_BYTES / 2)
   {
-    ipAddressForwarding = boost::asio::ip::address_v4::from_string("0.0.0.0");
-    if (this->isForwarding)
+    // Linux reports twice the size used for the packets data
+    vtkGenericWarningMacro("Receive buffer of port " << port << " limited to "
+                           << bufferSize.value() << " bytes, packets may be dropped at high rates");
+  }
+#ifdef SO_RXQ_OVFL
+  // The number of packets dropped by the system is given with each packet
+  int enableDropCounter = 1;
+  setsockopt(this->Socket.native_handle(), SOL_SOCKET, SO_RXQ_OVFL, &enableDropCounter,
+    sizeof(enableDropCounter));
+#endif
+#ifdef __linux__
+  // The arrival time of each packet is given with it. It is stamped by the network card if it
+  // has been configured to stamp all the received packets (hwstamp_ctl -i <interface> -r 1),
+  // by the kernel otherwise. The clock of the card must follow the system clock (phc2sys) for
+  // its stamps to be comparable with the other times.
+  int timestamping = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+    SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+  if (setsockopt(this->Socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPING, &timestamping,
+        sizeof(timestamping)) != 0)
+  {
+    int enableTimestamps = 1;
+    setsockopt(this->Socket.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &enableTimestamps,
+      sizeof(enableTimestamps));
+  }
+#endif
+
+  if (isforwarding)
+  {
+    // the packets are sent by the thread of the forwarder, out of the receive path
+    this->Forwarder.reset(new PacketForwarder);
+    if (this->Forwarder->AddDestinations(forwarddestinationIp, forwardport) == 0)
     {
       vtkGenericWarningMacro("Forward ip address not valid, packets won't be forwarded");
-      this->isForwarding = false;
+      this->Forwarder.reset();
+    }
+    else
+    {
+      this->Forwarder->Start();
     }
   }
-
-  this->ForwardEndpoint = boost::asio::ip::udp::endpoint(ipAddressForwarding, forwardport);
-  this->ForwardedSocket.open(ForwardEndpoint.protocol()); // Opening the socket with an UDP v4 protocol
-  // toward the forwarded ip address and port
-  this->ForwardedSocket.set_option(boost::asio::ip::multicast::enable_loopback(
-                                true)); // Allow to send the packet on the same machine
 }
 
 //-----------------------------------------------------------------------------
 PacketReceiver::~PacketReceiver()
 {
   this->Socket.cancel();
-  this->ForwardedSocket.cancel();
   {
     boost::unique_lock<boost::mutex> guard(this->IsReceivingMtx);
     this->ShouldStop = true;
@@ -96,9 +154,8 @@ void PacketReceiver::StartReceive()
     this->IsReceiving = true;
   }
 
-  // expecting exactly 1206 bytes, using a larger buffer so that if a
-  // larger packet arrives unexpectedly we'll notice it.
-  this->Socket.async_receive(boost::asio::buffer(this->RXBuffer, BUFFER_SIZE),
+  // wait until the socket is readable, all the packets waiting are then read by the callback
+  this->Socket.async_receive(boost::asio::null_buffers(),
                              boost::bind(&PacketReceiver::SocketCallback, this, boost::asio::placeholders::error,
                                          boost::asio::placeholders::bytes_transferred));
 }
@@ -133,26 +190,186 @@ void PacketReceiver::SocketCallback(
 
     return;
   }
-  std::string* packet = new std::string(this->RXBuffer, numberOfBytes);
-
-  if (this->isForwarding)
+  const int numberOfPackets = this->ReceiveBatch();
+  for (int i = 0; i < numberOfPackets; ++i)
   {
-    ForwardedSocket.send_to(boost::asio::buffer(packet->c_str(), numberOfBytes), ForwardEndpoint);
+    const PacketBufferPointer& packet = this->Buffers[i];
+
+    if (this->IsCrashAnalysing)
+    {
+      this->CrashAnalysis.AddPacket(packet->GetData(), packet->GetSize());
+    }
+
+    this->Batch.push_back(packet);
   }
 
-  if (this->IsCrashAnalysing)
+  if (!this->Batch.empty())
   {
-    this->CrashAnalysis.AddPacket(*packet);
+    if (this->Forwarder)
+    {
+      this->Forwarder->Enqueue(this->Batch);
+    }
+    this->Parent->QueuePackets(this->Batch);
+    this->Batch.clear();
   }
 
-  this->Parent->QueuePackets(packet);
+  for (int i = 0; i < numberOfPackets; ++i)
+  {
+    if (!this->Buffers[i]->IsUnique())
+    {
+      this->Buffers[i] = PacketBufferPool::GetInstance().Acquire();
+    }
+  }
 
   this->StartReceive();
 
-  if ((++this->PacketCounter % 5000) == 0)
+  const int previousCounter = this->PacketCounter;
+  this->PacketCounter += numberOfPackets;
+  if (this->PacketCounter / 5000 != previousCounter / 5000)
   {
-    std::cout << "RECV packets: " << this->PacketCounter << " on " << this->Port << std::endl;
-    ;
+    std::cout << "RECV packets: " << this->PacketCounter << " on " << this->Port
+              << ", dropped by the system: " << this->NumberOfKernelDrops << std::endl;
   }
 }
 
+//-----------------------------------------------------------------------------
+void PacketReceiver::JoinMulticastGroup(const std::string& groupAddress)
+{
+  boost::system::error_code errCode;
+  const boost::asio::ip::address address =
+    boost::asio::ip::address::from_string(groupAddress, errCode);
+  if (!errCode)
+  {
+    this->Socket.set_option(boost::asio::ip::multicast::join_group(address), errCode);
+  }
+  if (errCode)
+  {
+    vtkGenericWarningMacro("Failed to join the multicast group " << groupAddress << " on port "
+      << this->Port << ": " << errCode.message());
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PacketReceiver::SetSourceFilter(const std::string& ipAddress)
+{
+  boost::system::error_code errCode;
+  this->SourceAddress = boost::asio::ip::address_v4::from_string(ipAddress, errCode);
+  this->IsFilteringSource = !errCode;
+  if (errCode)
+  {
+    vtkGenericWarningMacro("Sensor ip address not valid, the packets won't be filtered");
+  }
+}
+
+//-----------------------------------------------------------------------------
+int PacketReceiver::ReceiveBatch()
+{
+#ifdef __linux__
+  mmsghdr messages[RECEIVE_BATCH_SIZE];
+  iovec buffers[RECEIVE_BATCH_SIZE];
+  sockaddr_in sources[RECEIVE_BATCH_SIZE];
+  // room for the drop counter given by SO_RXQ_OVFL and the arrival timestamps
+  char control[RECEIVE_BATCH_SIZE][ControlSize];
+  std::memset(messages, 0, sizeof(messages));
+  for (int i = 0; i < RECEIVE_BATCH_SIZE; ++i)
+  {
+    buffers[i].iov_base = this->Buffers[i]->GetData();
+    buffers[i].iov_len = PacketBuffer::Capacity;
+    messages[i].msg_hdr.msg_name = &sources[i];
+    messages[i].msg_hdr.msg_namelen = sizeof(sources[i]);
+    messages[i].msg_hdr.msg_iov = &buffers[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+    messages[i].msg_hdr.msg_control = control[i];
+    messages[i].msg_hdr.msg_controllen = sizeof(control[i]);
+  }
+
+  const int numberOfReceivedPackets =
+    recvmmsg(this->Socket.native_handle(), messages, RECEIVE_BATCH_SIZE, MSG_DONTWAIT, nullptr);
+  if (numberOfReceivedPackets <= 0)
+  {
+    return 0;
+  }
+  // for the packets the kernel did not stamp
+  const boost::int64_t receiveTime = PacketBuffer::GetSystemTime();
+  const uint32_t sourceAddress = htonl(this->SourceAddress.to_ulong());
+  int numberOfPackets = 0;
+  for (int i = 0; i < numberOfReceivedPackets; ++i)
+  {
+    this->Buffers[i]->SetSize(messages[i].msg_len);
+    this->Buffers[i]->SetArrivalTime(receiveTime, PacketBuffer::SoftwareTimestamp);
+    msghdr& header = messages[i].msg_hdr;
+    for (cmsghdr* message = CMSG_FIRSTHDR(&header); message;
+         message = CMSG_NXTHDR(&header, message))
+    {
+      if (message->cmsg_level != SOL_SOCKET)
+      {
+        continue;
+      }
+#ifdef SO_RXQ_OVFL
+      if (message->cmsg_type == SO_RXQ_OVFL)
+      {
+        // total number of packets dropped since the socket has been opened
+        uint32_t drops = 0;
+        std::memcpy(&drops, CMSG_DATA(message), sizeof(drops));
+        this->NumberOfKernelDrops = drops;
+      }
+#endif
+      if (message->cmsg_type == SCM_TIMESTAMPING)
+      {
+        // the raw hardware stamp is zero when the card does not stamp the packets
+        timespec stamps[NumberOfTimestamps];
+        std::memcpy(stamps, CMSG_DATA(message), sizeof(stamps));
+        if (stamps[2].tv_sec != 0 || stamps[2].tv_nsec != 0)
+        {
+          this->Buffers[i]->SetArrivalTime(
+            ToNanoseconds(stamps[2]), PacketBuffer::HardwareTimestamp);
+        }
+        else if (stamps[0].tv_sec != 0 || stamps[0].tv_nsec != 0)
+        {
+          this->Buffers[i]->SetArrivalTime(
+            ToNanoseconds(stamps[0]), PacketBuffer::KernelTimestamp);
+        }
+      }
+      else if (message->cmsg_type == SCM_TIMESTAMPNS)
+      {
+        timespec stamp;
+        std::memcpy(&stamp, CMSG_DATA(message), sizeof(stamp));
+        this->Buffers[i]->SetArrivalTime(ToNanoseconds(stamp), PacketBuffer::KernelTimestamp);
+      }
+    }
+    if (this->IsFilteringSource && sources[i].sin_addr.s_addr != sourceAddress)
+    {
+      this->NumberOfFilteredPackets++;
+      continue;
+    }
+    // the packets kept are gathered at the beginning of the batch
+    this->Buffers[i].swap(this->Buffers[numberOfPackets++]);
+  }
+  return numberOfPackets;
+#else
+  int numberOfPackets = 0;
+  boost::system::error_code error;
+  boost::asio::ip::udp::endpoint source;
+  for (int i = 0; i < RECEIVE_BATCH_SIZE; ++i)
+  {
+    const std::size_t numberOfBytes = this->Socket.receive_from(
+      boost::asio::buffer(this->Buffers[numberOfPackets]->GetData(), PacketBuffer::Capacity),
+      source, 0, error);
+    // would_block once all the waiting packets have been read
+    if (error)
+    {
+      break;
+    }
+    if (this->IsFilteringSource && source.address() != this->SourceAddress)
+    {
+      // the buffer is reused for the next packet
+      this->NumberOfFilteredPackets++;
+      continue;
+    }
+    this->Buffers[numberOfPackets]->SetSize(numberOfBytes);
+    this->Buffers[numberOfPackets++]->SetArrivalTime(
+      PacketBuffer::GetSystemTime(), PacketBuffer::SoftwareTimestamp);
+  }
+  return numberOfPackets;
+#endif
+}
@@ -31,28 +31,42 @@
 
 // LOCAL
 #include "CrashAnalysing.h"
+#include "PacketBuffer.h"
+#include "PacketForwarder.h"
 
 // BOOST
 #include <boost/asio.hpp>
 #include <boost/thread/thread.hpp>
 
 // STD
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 class NetworkSource;
 
-/*!< Size of the buffer used to store the data received */
-#define BUFFER_SIZE 1500
-
 /*!< Number of packed save when the option CrashAnalysing is set */
 #define NBR_PACKETS_SAVED  1500
 
+/*!< Maximum number of packets read at once from the socket */
+#define RECEIVE_BATCH_SIZE 64
+
+/*!< Size requested for the kernel receive buffer of the socket, so that a burst of packets is
+ *  not dropped while the previous batch is handled. The system may limit it. */
+#define RECEIVE_BUFFER_BYTES (8 * 1024 * 1024)
+
 /**
  * \class PacketReceiver
  * \brief This classs is reponsbale for listening on a socket and each time a packet is received,
  * it will enqueue the packet on a specific Queue. Here it is used to setup an UDP multicast protocol.
- * The packet receiver can forward the received packets and/or store them in a output bin file
+ * The packet receiver can forward the received packets and/or store them in a output bin file.
+ * The packets are forwarded by a PacketForwarder, on its own thread.
+ * Each time the socket is readable, all the packets waiting in the socket are read at once, up to
+ * RECEIVE_BATCH_SIZE, with recvmmsg on Linux and with non blocking reads elsewhere.
+ * The arrival time of each packet is kept in its buffer: on Linux it is stamped by the network
+ * card or the kernel, elsewhere by the receiver once the packet has been read.
 */
 class PacketReceiver
 {
@@ -62,7 +76,8 @@ public:
    * @param io The in/out service used to handle the reception of the packets
    * @param port The port address which will receive the packet
    * @param forwardport The port adress which will receive the forwarded packets
-   * @param forwarddestinationIp The IP adress of the computer which will receive the forwarded packets
+   * @param forwarddestinationIp The IP adresses of the computers which will receive the forwarded
+   * packets, separated by commas
    * @param isforwarding Allow or not the forwarding of the packets
    * @param parent @todo to replace by a synchronizedQueue
    */
@@ -87,13 +102,50 @@ public:
 
   void SocketCallback(const boost::system::error_code& error, std::size_t numberOfBytes);
 
+  /**
+   * @brief JoinMulticastGroup receive the packets sent to a multicast group on the port
+   * @param groupAddress ip address of the group
+   */
+  void JoinMulticastGroup(const std::string& groupAddress);
+
+  /**
+   * @brief SetSourceFilter only keep the packets sent by a sensor, so that several sensors
+   * sending on the same port or multicast group are given to different sources
+   * @param ipAddress ip address of the sensor
+   */
+  void SetSourceFilter(const std::string& ipAddress);
+
+  /**
+   * @brief GetNumberOfFilteredPackets number of packets ignored because they were sent by
+   * another sensor than the one given to SetSourceFilter
+   */
+  unsigned long GetNumberOfFilteredPackets() { return this->NumberOfFilteredPackets; }
+
+  /**
+   * @brief GetNumberOfForwardDrops number of packets not forwarded because the destinations
+   * could not keep up
+   */
+  unsigned long GetNumberOfForwardDrops()
+  {
+    return this->Forwarder ? this->Forwarder->GetNumberOfDroppedPackets() : 0;
+  }
+
+  /**
+   * @brief GetNumberOfKernelDrops number of packets dropped by the system because the receive
+   * buffer of the socket was full, only available on Linux
+   */
+  unsigned long GetNumberOfKernelDrops() { return this->NumberOfKernelDrops; }
+
 private:
-  /*!< Allow or not the forwarding of the packets */
-  bool isForwarding;
+  /**
+   * @brief ReceiveBatch read the packets waiting in the socket without blocking
+   * @return the number of packets read in the first Buffers
+   */
+  int ReceiveBatch();
+
+  /*!< Sends the packets to the forward destinations, null if the packets are not forwarded */
+  std::unique_ptr<PacketForwarder> Forwarder;
 
-  /*!< EndPoint to forward to, contain information such as forward ip, forward port */
-  boost::asio::ip::udp::endpoint ForwardEndpoint;
-  
   /*!< Port address which will receive the packet */
   int Port;                
   
@@ -103,15 +155,23 @@ private:
   /*!< Socket : determines the protocol used and the address used for the reception of the packets */
   boost::asio::ip::udp::socket Socket;
 
-  /*!< Socket : determines the protocol used and the address used for the reception of the forwarded packets */
-  boost::asio::ip::udp::socket ForwardedSocket;
-
   /*!< Network Shouce where the packet will be enqueue */
   NetworkSource* Parent;
 
-  /*!< Buffer which will saved the data. Expecting exactly 1206 bytes, using a larger buffer
-   *  so that if a larger packet arrives unexpectedly we'll notice it. */
-  char RXBuffer[BUFFER_SIZE];
+  /*!< Buffers receiving the data of a batch, taken from the PacketBufferPool. The buffers kept
+   *  by the parent are replaced after each batch, the others are reused as is. */
+  std::vector<PacketBufferPointer> Buffers;
+
+  /*!< Packets of the last batch, given to the parent */
+  std::vector<PacketBufferPointer> Batch;
+
+  /*!< Number of packets dropped by the system, as reported with the last packet */
+  std::atomic<unsigned long> NumberOfKernelDrops;
+
+  /*!< Only the packets sent by SourceAddress are kept when set */
+  bool IsFilteringSource;
+  boost::asio::ip::address_v4 SourceAddress;
+  std::atomic<unsigned long> NumberOfFilteredPackets;
 
   bool IsReceiving; /*!< Flag indicating if the socket is receiving packets */
   bool ShouldStop;  /*!< Flag indicating if we should stop the listening */
@@ -0,0 +1,196 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+// BOOST
+#include <boost/thread/thread.hpp>
+
+// STD
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+/**
+ * \class PacketRing
+ * \brief Bounded lock-free ring of fixed size packet slots, between one producer thread and one
+ *        consumer thread. The consumer reads the packets in place, without copy, and waits for
+ *        new packets by polling with a backoff instead of sleeping on a condition variable.
+ *        When the ring is full, either the new packet or the oldest waiting one is dropped.
+ */
+class PacketRing
+{
+public:
+  enum OverflowPolicy
+  {
+    DROP_NEWEST = 0, /*!< the packet which does not fit is dropped */
+    DROP_OLDEST = 1, /*!< the oldest packet not read yet is dropped to make room */
+  };
+
+  //! Size of a slot, the larger packets are truncated
+  static const size_t SlotSize = 1500;
+
+  /**
+   * @param numberOfSlots maximum number of packets waiting in the ring
+   * @param policy what to drop when the ring is full
+   */
+  PacketRing(size_t numberOfSlots, OverflowPolicy policy)
+    : Slots(numberOfSlots)
+    , Policy(policy)
+  {
+  }
+
+  /**
+   * @brief Push copy a packet in the ring, called by the producer thread
+   * @return false if the packet has been dropped
+   */
+  bool Push(const char* data, size_t size)
+  {
+    const size_t numberOfSlots = this->Slots.size();
+    const size_t head = this->Head.load(std::memory_order_relaxed);
+    size_t tail = this->Tail.load();
+    while (this->Policy == DROP_OLDEST && head - tail >= numberOfSlots)
+    {
+      // the consumer may take the oldest packet at the same time
+      if (this->Tail.compare_exchange_weak(tail, tail + 1))
+      {
+        this->NumberOfDroppedOldest.fetch_add(1, std::memory_order_relaxed);
+        tail++;
+      }
+    }
+    // the slot of the head may still be read by the consumer, even once its packet is dropped
+    if (head - tail >= numberOfSlots || this->Reading.load() + numberOfSlots == head)
+    {
+      this->NumberOfDroppedNewest.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    Slot& slot = this->Slots[head % numberOfSlots];
+    const size_t slotSize = SlotSize;
+    slot.Size = std::min(size, slotSize);
+    std::memcpy(slot.Data, data, slot.Size);
+    this->Head.store(head + 1, std::memory_order_release);
+    this->NumberOfPushedPackets.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  /**
+   * @brief WaitFront wait for a packet, called by the consumer thread. The packet stays valid
+   * until the call to Pop.
+   * @param data[out] data of the oldest packet
+   * @param size[out] size of the oldest packet
+   * @return false once Stop has been called
+   */
+  bool WaitFront(const unsigned char*& data, unsigned int& size)
+  {
+    int attempt = 0;
+    while (!this->Stopped.load(std::memory_order_acquire))
+    {
+      size_t tail = this->Tail.load();
+      if (tail != this->Head.load(std::memory_order_acquire))
+      {
+        // announce the slot before taking it, so that the producer does not overwrite it
+        this->Reading.store(tail);
+        if (this->Tail.compare_exchange_strong(tail, tail + 1))
+        {
+          const Slot& slot = this->Slots[tail % this->Slots.size()];
+          data = reinterpret_cast<const unsigned char*>(slot.Data);
+          size = static_cast<unsigned int>(slot.Size);
+          return true;
+        }
+        // the producer dropped this packet meanwhile
+        this->Reading.store(NoSlot);
+        continue;
+      }
+      Backoff(attempt++);
+    }
+    return false;
+  }
+
+  /**
+   * @brief Pop release the packet given by WaitFront
+   */
+  void Pop() { this->Reading.store(NoSlot); }
+
+  /**
+   * @brief Stop wake up the consumer, WaitFront then returns false
+   */
+  void Stop() { this->Stopped.store(true, std::memory_order_release); }
+
+  //! Number of packets waiting to be read
+  size_t GetDepth()
+  {
+    // the tail is read first, so that it is never after the head
+    const size_t tail = this->Tail.load();
+    return this->Head.load() - tail;
+  }
+
+  unsigned long GetNumberOfPushedPackets() { return this->NumberOfPushedPackets; }
+  unsigned long GetNumberOfDroppedPackets()
+  {
+    return this->NumberOfDroppedNewest + this->NumberOfDroppedOldest;
+  }
+  unsigned long GetNumberOfDroppedNewestPackets() { return this->NumberOfDroppedNewest; }
+  unsigned long GetNumberOfDroppedOldestPackets() { return this->NumberOfDroppedOldest; }
+
+private:
+  // Spin first, as the packets are expected every few tens of microseconds, then give the core
+  // to the other threads, and sleep when the stream is paused
+  static void Backoff(int attempt)
+  {
+    if (attempt < 64)
+    {
+      return;
+    }
+    if (attempt < 128)
+    {
+      boost::this_thread::yield();
+      return;
+    }
+    boost::this_thread::sleep(boost::posix_time::microseconds(attempt < 1024 ? 20 : 500));
+  }
+
+  struct Slot
+  {
+    size_t Size = 0;
+    char Data[SlotSize];
+  };
+
+  // value of Reading when the consumer does not hold a packet, chosen so that adding the number
+  // of slots never gives the position of a packet
+  static const size_t NoSlot = std::numeric_limits<size_t>::max() / 2;
+
+  std::vector<Slot> Slots;
+  const OverflowPolicy Policy;
+
+  //! position of the next packet to write, only changed by the producer
+  alignas(64) std::atomic<size_t> Head{ 0 };
+  //! position of the next packet to read, changed by the consumer and by the dropping producer
+  alignas(64) std::atomic<size_t> Tail{ 0 };
+  //! position of the packet held by the consumer, NoSlot if none
+  alignas(64) std::atomic<size_t> Reading{ NoSlot };
+  std::atomic<bool> Stopped{ false };
+
+  alignas(64) std::atomic<unsigned long> NumberOfPushedPackets{ 0 };
+  std::atomic<unsigned long> NumberOfDroppedNewest{ 0 };
+  std::atomic<unsigned long> NumberOfDroppedOldest{ 0 };
+};
+
+#endif // PACKET_RING_H
@@ -0,0 +1,302 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "PositionConsumer.h"
+#include "GeoProjection.h"
+#include "ThreadTopology.h"
+
+// STD
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+//! Size of the UDP payload of a position packet
+const unsigned int PositionPacketSize = 512;
+//! Offset and maximum size of the NMEA sentence in a position packet
+const size_t SentenceOffset = 14 + 8 + 8 + 8 + 160 + 4 + 4;
+const size_t SentenceSize = 306;
+//! Time waited for packets before checking that the thread must stop
+const boost::chrono::milliseconds PollInterval(100);
+//! Above this number of queued packets, which is more than a minute of position packets,
+//! the new packets are dropped
+const size_t MaxQueueDepth = 1 << 14;
+
+//-----------------------------------------------------------------------------
+//! NMEA sentence of a position packet, without the trailing spaces, empty when no GPS is
+//! connected. It is not copied: it points inside the packet.
+const char* GetSentence(const unsigned char* data, size_t& size)
+{
+  const char* sentence = reinterpret_cast<const char*>(data + SentenceOffset);
+  const void* end = std::memchr(sentence, '\0', SentenceSize);
+  size = end ? static_cast<const char*>(end) - sentence : SentenceSize;
+  while (size > 0 && std::isspace(static_cast<unsigned char>(sentence[size - 1])))
+  {
+    --size;
+  }
+  return sentence;
+}
+
+//-----------------------------------------------------------------------------
+//! Number of days from 1970-01-01 to a date of the proleptic Gregorian calendar
+long DaysSinceEpoch(int year, int month, int day)
+{
+  // the year starts in March, so that the leap day is the last one
+  year -= month <= 2 ? 1 : 0;
+  const long era = (year >= 0 ? year : year - 399) / 400;
+  const long yearOfEra = year - era * 400;
+  const long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 719468;
+}
+}
+
+//-----------------------------------------------------------------------------
+PositionConsumer::PositionConsumer()
+  : NumberOfDroppedPackets(0)
+  , UseGPGGASentences(false)
+  , Imu(std::make_shared<ImuBuffer>())
+  , Trajectory(std::make_shared<TrajectoryBuffer>())
+  , HasOrigin(false)
+  , Origin(Eigen::Vector3d::Zero())
+{
+}
+
+//-----------------------------------------------------------------------------
+PositionConsumer::~PositionConsumer()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+void PositionConsumer::Start()
+{
+  if (this->Thread)
+  {
+    return;
+  }
+
+  // a new session, the lidar time may have been reset
+  this->Imu->Clear();
+  this->Trajectory->Clear();
+  this->ImuDecoder.Reset();
+  this->Projection.reset();
+  this->HasLastGPSTime = false;
+  this->GPSTimeOffset = 0.0;
+  this->HasOrigin = false;
+
+  this->NumberOfDroppedPackets = 0;
+  this->Packets.reset(new SynchronizedQueue<PacketBufferPointer>);
+  this->Thread = boost::shared_ptr<boost::thread>(
+        new boost::thread(boost::bind(&PositionConsumer::ThreadLoop, this)));
+}
+
+//-----------------------------------------------------------------------------
+void PositionConsumer::Stop()
+{
+  if (this->Thread)
+  {
+    this->Packets->stopQueue();
+    this->Thread->join();
+    this->Thread.reset();
+    this->Packets.reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PositionConsumer::Enqueue(const std::vector<PacketBufferPointer>& packets)
+{
+  if (!this->Packets)
+  {
+    return;
+  }
+
+  // the lidar packets are much larger, the receivers give batches of a single port
+  std::vector<PacketBufferPointer> positionPackets;
+  for (const PacketBufferPointer& packet : packets)
+  {
+    if (packet->GetSize() == PositionPacketSize)
+    {
+      positionPackets.push_back(packet);
+    }
+  }
+  if (!positionPackets.empty())
+  {
+    const size_t count = this->Packets->tryEnqueueAll(positionPackets, MaxQueueDepth);
+    this->NumberOfDroppedPackets += positionPackets.size() - count;
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool PositionConsumer::GetOrigin(Eigen::Vector3d& origin) const
+{
+  if (!this->HasOrigin)
+  {
+    return false;
+  }
+  origin = this->Origin;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void PositionConsumer::ThreadLoop()
+{
+  ThreadTopology::ApplyToCurrentThread(ThreadTopology::POSITION);
+  std::vector<PacketBufferPointer> packets;
+  bool isRunning = true;
+  while (isRunning)
+  {
+    isRunning = this->Packets->dequeueAll(packets, PollInterval);
+    for (const PacketBufferPointer& packet : packets)
+    {
+      this->Decode(packet->GetData(), static_cast<unsigned int>(packet->GetSize()));
+    }
+    // give the buffers back to the pool without waiting for the next packets
+    packets.clear();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void PositionConsumer::Decode(const unsigned char* data, unsigned int bytes)
+{
+  ImuBuffer::Sample imuSample;
+  if (!this->ImuDecoder.Decode(data, bytes, imuSample))
+  {
+    return;
+  }
+  this->Imu->Add(imuSample);
+
+  // the sentence is not copied: its words point inside the packet
+  size_t size = 0;
+  const char* sentence = GetSentence(data, size);
+  if (size == 0)
+  {
+    // no GPS connected
+    return;
+  }
+
+  NMEAWords words;
+  this->Parser.SplitWords(sentence, size, words);
+  const NMEAParser::SentenceType type = this->Parser.GetSentenceType(words);
+  NMEALocation location;
+  location.Init();
+  if (this->UseGPGGASentences)
+  {
+    if (type != NMEAParser::GPGGA_SENTENCE || !this->Parser.ParseGPGGA(words, location))
+    {
+      return;
+    }
+  }
+  else if (type != NMEAParser::GPRMC_SENTENCE || !this->Parser.ParseGPRMC(words, location))
+  {
+    return;
+  }
+  if (!location.Valid)
+  {
+    return;
+  }
+
+  // the UTC time of day wraps at midnight
+  if (this->HasLastGPSTime && location.UTCSecondsOfDay - this->LastGPSTime < -12.0 * 3600.0)
+  {
+    this->GPSTimeOffset += 24.0 * 3600.0;
+  }
+  const bool isNewFix = !this->HasLastGPSTime || location.UTCSecondsOfDay != this->LastGPSTime;
+  this->HasLastGPSTime = true;
+  this->LastGPSTime = location.UTCSecondsOfDay;
+  if (!isNewFix)
+  {
+    // the sentence is repeated in the packets until the next fix, its time is the one of the
+    // first packet, as for the timeshift estimation of vtkVelodyneHDLPositionReader
+    return;
+  }
+
+  if (!this->Projection)
+  {
+    // the UTM zone is the one of the first fix, as for vtkVelodyneHDLPositionReader
+    this->Projection.reset(new GeoProjection(GeoProjection::LatLongDefinition(),
+      GeoProjection::UTMDefinition(
+        GeoProjection::UTMZone(location.Lat, location.Long), location.Lat < 0)));
+    this->Projection->SetNumberOfThreads(1);
+  }
+  double position[3] = { location.Long, location.Lat, 0.0 };
+  if (!this->Projection->Transform(position, 1))
+  {
+    return;
+  }
+  // the height above the ellipsoid, which is the datum of the projection, if available
+  if (location.HasAltitude)
+  {
+    position[2] = location.Altitude;
+    if (location.HasGeoidalSeparation)
+    {
+      position[2] += location.GeoidalSeparation;
+    }
+  }
+
+  TrajectoryBuffer::Sample sample;
+  sample.Time = imuSample.Time;
+  sample.GPSTime = location.UTCSecondsOfDay + this->GPSTimeOffset;
+  sample.Lat = location.Lat;
+  sample.Long = location.Long;
+  sample.Position = Eigen::Vector3d(position[0], position[1], position[2]);
+  sample.Heading = location.HasTrackAngle ? location.TrackAngle : 0.0;
+  if (!this->HasOrigin)
+  {
+    this->Origin = sample.Position;
+    this->HasOrigin = true;
+  }
+  this->Trajectory->Add(sample);
+  if (this->Ros2)
+  {
+    this->Ros2->PublishPosition(sample, this->Origin);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool PositionConsumer::DecodeUTCTime(
+  const unsigned char* data, unsigned int bytes, double& time, double& sensorTime)
+{
+  VelodyneImuDecoder::Channels channels;
+  if (bytes != PositionPacketSize || !VelodyneImuDecoder::ReadChannels(data, bytes, channels))
+  {
+    return false;
+  }
+  size_t size = 0;
+  const char* sentence = GetSentence(data, size);
+  NMEAParser parser;
+  NMEAWords words;
+  NMEALocation location;
+  location.Init();
+  parser.SplitWords(sentence, size, words);
+  if (size == 0 || parser.GetSentenceType(words) != NMEAParser::GPRMC_SENTENCE ||
+    !parser.ParseGPRMC(words, location) || !location.HasDate)
+  {
+    return false;
+  }
+
+  // the year has two digits
+  const int year = location.DateYear + (location.DateYear < 80 ? 2000 : 1900);
+  const double fixTime =
+    DaysSinceEpoch(year, location.DateMonth, location.DateDay) * 86400.0 + location.UTCSecondsOfDay;
+  // the fix is less than half an hour away from the packet
+  sensorTime = 1e-6 * channels.TohTimestamp;
+  time = 3600.0 * std::round((fixTime - sensorTime) / 3600.0) + sensorTime;
+  return true;
+}
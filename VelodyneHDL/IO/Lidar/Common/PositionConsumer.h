@@ -0,0 +1,117 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef POSITIONCONSUMER_H
+#define POSITIONCONSUMER_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <boost/thread/thread.hpp>
+
+#include "ImuBuffer.h"
+#include "NMEAParser.h"
+#include "PacketBuffer.h"
+#include "Ros2Publisher.h"
+#include "SynchronizedQueue.h"
+#include "TrajectoryBuffer.h"
+#include "VelodyneImuDecoder.h"
+
+class GeoProjection;
+
+/**
+ * @brief The PositionConsumer class decodes the position packets of a live stream on its own
+ * thread, so that the receive path only queues them. The IMU channels go to an ImuBuffer and
+ * the NMEA sentences with a valid fix to a TrajectoryBuffer, projected in the UTM zone of the
+ * first fix. As for PacketFileWriter, the queue is bounded and the packets in excess are
+ * dropped (and counted).
+ */
+class PositionConsumer
+{
+public:
+  PositionConsumer();
+  ~PositionConsumer();
+
+  //! Clear the buffers and start the decoding thread
+  void Start();
+
+  //! Decode the queued packets and stop the decoding thread
+  void Stop();
+
+  //! Queue the position packets of a batch, the other packets are ignored
+  void Enqueue(const std::vector<PacketBufferPointer>& packets);
+
+  std::shared_ptr<ImuBuffer> GetImuBuffer() { return this->Imu; }
+  std::shared_ptr<TrajectoryBuffer> GetTrajectory() { return this->Trajectory; }
+
+  /**
+   * @brief SetUseGPGGASentences use the GPGGA sentences, which have the altitude, instead of
+   * the GPRMC ones, as vtkVelodyneHDLPositionReader::SetUseGPGGASentences
+   */
+  void SetUseGPGGASentences(bool use) { this->UseGPGGASentences = use; }
+  bool GetUseGPGGASentences() const { return this->UseGPGGASentences; }
+
+  /**
+   * @brief GetOrigin projected position of the first fix since Start, false if there is none
+   * yet. It does not change once set, until the next Start.
+   */
+  bool GetOrigin(Eigen::Vector3d& origin) const;
+
+  //! Also publish the fixes on ROS 2, set before Start
+  void SetRos2Publisher(std::shared_ptr<Ros2Publisher> publisher) { this->Ros2 = publisher; }
+
+  //! Number of position packets which have not been decoded because the queue was full
+  unsigned long GetNumberOfDroppedPackets() { return this->NumberOfDroppedPackets; }
+
+  /**
+   * @brief DecodeUTCTime UTC time of a position packet, the date and the hour coming from its
+   * GPRMC sentence and the rest from the top of the hour timestamp of the packet, which is the
+   * clock of the lidar packets
+   * @param time[out] UTC time of the packet in seconds since the epoch
+   * @param sensorTime[out] timestamp of the packet in seconds since the top of the hour
+   * @return false if the packet is not a position packet or if its sentence has no date
+   */
+  static bool DecodeUTCTime(
+    const unsigned char* data, unsigned int bytes, double& time, double& sensorTime);
+
+private:
+  void ThreadLoop();
+
+  //! Decode a position packet, only called by the decoding thread
+  void Decode(const unsigned char* data, unsigned int bytes);
+
+  boost::shared_ptr<boost::thread> Thread;
+  boost::shared_ptr<SynchronizedQueue<PacketBufferPointer> > Packets;
+  std::atomic<unsigned long> NumberOfDroppedPackets;
+  std::atomic<bool> UseGPGGASentences;
+
+  std::shared_ptr<ImuBuffer> Imu;
+  std::shared_ptr<TrajectoryBuffer> Trajectory;
+  std::shared_ptr<Ros2Publisher> Ros2;
+
+  //! state of the decoding thread
+  NMEAParser Parser;
+  VelodyneImuDecoder ImuDecoder;
+  std::unique_ptr<GeoProjection> Projection;
+  bool HasLastGPSTime = false;
+  double LastGPSTime = 0.0;
+  double GPSTimeOffset = 0.0;
+  std::atomic<bool> HasOrigin;
+  Eigen::Vector3d Origin;
+};
+
+#endif // POSITIONCONSUMER_H
@@ -0,0 +1,139 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef RAW_FRAME_CACHE_H
+#define RAW_FRAME_CACHE_H
+
+// LOCAL
+#include "MemoryAccounting.h"
+
+// BOOST
+#include <boost/cstdint.hpp>
+
+// STD
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \struct RawFrame
+ * \brief Lidar packets of a frame before the one where the next frame starts, as read from the
+ *        file. The returns are kept in the layout of the sensor (3 bytes per return for a
+ *        Velodyne), so they are about 30 times smaller than the decoded frame.
+ */
+struct RawFrame
+{
+  //! File positions of the first packet of the frame and of the next frame, the packets
+  //! are the lidar packets in between
+  boost::uint64_t Position = 0;
+  boost::uint64_t EndPosition = 0;
+  //! Packets one after the other
+  std::vector<unsigned char> Data;
+  //! Offset of each packet in Data, followed by the size of Data
+  std::vector<size_t> Offsets;
+
+  size_t GetNumberOfPackets() const { return this->Offsets.empty() ? 0 : this->Offsets.size() - 1; }
+
+  //! Memory used by the packets, in kibibytes
+  unsigned long GetMemorySize() const;
+};
+
+/**
+ * \class RawFrameCache
+ * \brief Least recently used cache of the packets of the frames, limited by the memory they use.
+ *        The packets do not depend on the calibration, the sensor transform or any other setting
+ *        of the interpreter, so a frame whose decoded version has been discarded because a
+ *        setting changed is decoded again without reading the file. The frames are stored with
+ *        a key identifying how the frames are split (ex: the lidar port), when a frame is
+ *        requested with another key all the frames are discarded.
+ */
+class RawFrameCache
+{
+public:
+  /**
+   * @brief Get return the packets of a frame and mark them as the most recently used
+   * @param frameNumber index of the frame
+   * @param key identify how the packets of the frames are selected
+   * @return nullptr if the frame is not in the cache
+   */
+  std::shared_ptr<const RawFrame> Get(int frameNumber, const std::string& key);
+
+  /**
+   * @brief Add store the packets of a frame, evicting the least recently used ones to stay
+   * within the budget
+   * @param frameNumber index of the frame
+   * @param key identify how the packets of the frames are selected
+   * @param frame the packets, they must not be modified afterward
+   */
+  void Add(int frameNumber, const std::string& key, std::shared_ptr<const RawFrame> frame);
+
+  //! Discard all cached frames
+  void Clear();
+
+  /**
+   * @brief SetMemoryBudget set the maximum memory used by the cached packets
+   * @param kibibytes budget, 0 disables the cache
+   */
+  void SetMemoryBudget(unsigned long kibibytes);
+  unsigned long GetMemoryBudget() const { return this->MemoryBudget; }
+
+  //! Memory currently used by the cached packets, in kibibytes
+  unsigned long GetMemorySize() const { return this->MemorySize; }
+
+  int GetNumberOfFrames() const { return static_cast<int>(this->Index.size()); }
+  int GetNumberOfHits() const { return this->NumberOfHits; }
+  int GetNumberOfMisses() const { return this->NumberOfMisses; }
+  void ResetStatistics() { this->NumberOfHits = this->NumberOfMisses = 0; }
+
+  /**
+   * @brief Release evict the least recently used packets until the given memory is freed, see
+   * MemoryAccounting::Enforce. The budget is unchanged, so the cache fills up again.
+   * @param kibibytes memory to free
+   */
+  void Release(unsigned long kibibytes);
+
+  //! Account set with the memory used by the cache, to make it releasable
+  MemoryAccounting::Account& GetMemoryAccount() { return this->Memory; }
+
+private:
+  struct Entry
+  {
+    int FrameNumber;
+    std::shared_ptr<const RawFrame> Frame;
+    unsigned long Size;
+  };
+
+  //! Remove the least recently used frames until the budget is satisfied
+  void Shrink(unsigned long budget);
+
+  //! Discard the frames if the key changes
+  void SetKey(const std::string& key);
+
+  //! Most recently used first
+  std::list<Entry> Entries;
+  std::unordered_map<int, std::list<Entry>::iterator> Index;
+  std::string Key;
+  unsigned long MemoryBudget = 0;
+  unsigned long MemorySize = 0;
+  int NumberOfHits = 0;
+  int NumberOfMisses = 0;
+  MemoryAccounting::Account Memory{ MemoryAccounting::READER_PACKETS };
+};
+
+#endif // RAW_FRAME_CACHE_H
@@ -0,0 +1,416 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+
+// LOCAL
+#include "Ros2Publisher.h"
+
+// VTK
+#include <vtkMath.h>
+#include <vtkSetGet.h>
+
+#ifdef VELOVIEW_HAS_ROS2
+// VTK
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+
+// ROS 2
+#include <nav_msgs/msg/odometry.hpp>
+#include <rclcpp/rclcpp.hpp>
+#include <sensor_msgs/msg/nav_sat_fix.hpp>
+#include <sensor_msgs/msg/point_cloud2.hpp>
+#include <sensor_msgs/msg/point_field.hpp>
+
+// BOOST
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+// STD
+#include <cmath>
+#include <cstring>
+#include <vector>
+#endif
+
+#ifdef VELOVIEW_HAS_ROS2
+namespace
+{
+typedef sensor_msgs::msg::PointCloud2 PointCloud;
+typedef sensor_msgs::msg::PointField PointField;
+
+//! Protects the initialization of ROS 2, shared by the streams of the process
+boost::mutex InitializationMutex;
+
+//-----------------------------------------------------------------------------
+//! Field of the point clouds, the points being its array with an empty name
+struct Field
+{
+  std::string Name;
+  vtkDataArray* Array;
+  int Component;
+  boost::uint8_t DataType;
+  boost::uint32_t Size;
+};
+
+//-----------------------------------------------------------------------------
+//! PointField type of the values of a VTK type, false for the types which cannot be published
+bool GetFieldType(int dataType, boost::uint8_t& type, boost::uint32_t& size)
+{
+  switch (dataType)
+  {
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR:
+      type = PointField::INT8;
+      size = 1;
+      return true;
+    case VTK_UNSIGNED_CHAR:
+      type = PointField::UINT8;
+      size = 1;
+      return true;
+    case VTK_SHORT:
+      type = PointField::INT16;
+      size = 2;
+      return true;
+    case VTK_UNSIGNED_SHORT:
+      type = PointField::UINT16;
+      size = 2;
+      return true;
+    case VTK_INT:
+      type = PointField::INT32;
+      size = 4;
+      return true;
+    case VTK_UNSIGNED_INT:
+      type = PointField::UINT32;
+      size = 4;
+      return true;
+    case VTK_FLOAT:
+      type = PointField::FLOAT32;
+      size = 4;
+      return true;
+    case VTK_DOUBLE:
+    case VTK_LONG:
+    case VTK_UNSIGNED_LONG:
+    case VTK_LONG_LONG:
+    case VTK_UNSIGNED_LONG_LONG:
+    case VTK_ID_TYPE:
+      type = PointField::FLOAT64;
+      size = 8;
+      return true;
+    default:
+      return false;
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<typename TIn, typename TOut>
+void InterleaveTypedValues(const TIn* values, int numberOfComponents, int component,
+  vtkIdType numberOfPoints, unsigned char* output, size_t stride)
+{
+  values += component;
+  for (vtkIdType i = 0; i < numberOfPoints; ++i, values += numberOfComponents, output += stride)
+  {
+    const TOut value = static_cast<TOut>(*values);
+    std::memcpy(output, &value, sizeof(TOut));
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Copy a component of an array in a field of the point records
+template<typename TOut>
+void InterleaveValues(vtkDataArray* array, int component, vtkIdType numberOfPoints,
+  unsigned char* output, size_t stride)
+{
+  if (!array->HasStandardMemoryLayout())
+  {
+    for (vtkIdType i = 0; i < numberOfPoints; ++i, output += stride)
+    {
+      const TOut value = static_cast<TOut>(array->GetComponent(i, component));
+      std::memcpy(output, &value, sizeof(TOut));
+    }
+    return;
+  }
+  switch (array->GetDataType())
+  {
+    vtkTemplateMacro((InterleaveTypedValues<VTK_TT, TOut>)(
+      static_cast<const VTK_TT*>(array->GetVoidPointer(0)), array->GetNumberOfComponents(),
+      component, numberOfPoints, output, stride));
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Fill a point cloud with a frame, the fields are reused if they have not changed
+void FillPointCloud(vtkPolyData* frame, double time, const std::string& frameId, PointCloud& cloud)
+{
+  std::vector<Field> fields;
+  vtkDataArray* points = frame->GetPoints()->GetData();
+  const char* axes[3] = { "x", "y", "z" };
+  for (int i = 0; i < 3; ++i)
+  {
+    fields.push_back({ axes[i], points, i, PointField::FLOAT32, 4 });
+  }
+  vtkPointData* pointData = frame->GetPointData();
+  for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+  {
+    vtkDataArray* array = pointData->GetArray(i);
+    Field field = { std::string(), array, 0, 0, 0 };
+    if (array && array->GetName() && array->GetNumberOfComponents() == 1 &&
+      GetFieldType(array->GetDataType(), field.DataType, field.Size))
+    {
+      field.Name = array->GetName();
+      fields.push_back(field);
+    }
+  }
+
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+  cloud.header.stamp.sec = static_cast<boost::int32_t>(std::floor(time));
+  cloud.header.stamp.nanosec = static_cast<boost::uint32_t>((time - std::floor(time)) * 1e9);
+  cloud.header.frame_id = frameId;
+  cloud.height = 1;
+  cloud.width = static_cast<boost::uint32_t>(numberOfPoints);
+  cloud.is_bigendian = false;
+  cloud.is_dense = true;
+  cloud.fields.resize(fields.size());
+  boost::uint32_t offset = 0;
+  for (size_t i = 0; i < fields.size(); ++i)
+  {
+    cloud.fields[i].name = fields[i].Name;
+    cloud.fields[i].offset = offset;
+    cloud.fields[i].datatype = fields[i].DataType;
+    cloud.fields[i].count = 1;
+    offset += fields[i].Size;
+  }
+  cloud.point_step = offset;
+  cloud.row_step = offset * cloud.width;
+  cloud.data.resize(static_cast<size_t>(cloud.row_step));
+
+  unsigned char* data = cloud.data.data();
+  for (size_t i = 0; i < fields.size(); ++i)
+  {
+    unsigned char* output = data + cloud.fields[i].offset;
+    vtkDataArray* array = fields[i].Array;
+    const int component = fields[i].Component;
+    switch (fields[i].DataType)
+    {
+      case PointField::INT8:
+        InterleaveValues<boost::int8_t>(array, component, numberOfPoints, output, offset);
+        break;
+      case PointField::UINT8:
+        InterleaveValues<boost::uint8_t>(array, component, numberOfPoints, output, offset);
+        break;
+      case PointField::INT16:
+        InterleaveValues<boost::int16_t>(array, component, numberOfPoints, output, offset);
+        break;
+      case PointField::UINT16:
+        InterleaveValues<boost::uint16_t>(array, component, numberOfPoints, output, offset);
+        break;
+      case PointField::INT32:
+        InterleaveValues<boost::int32_t>(array, component, numberOfPoints, output, offset);
+        break;
+      case PointField::UINT32:
+        InterleaveValues<boost::uint32_t>(array, component, numberOfPoints, output, offset);
+        break;
+      case PointField::FLOAT32:
+        InterleaveValues<float>(array, component, numberOfPoints, output, offset);
+        break;
+      default:
+        InterleaveValues<double>(array, component, numberOfPoints, output, offset);
+        break;
+    }
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+struct Ros2Publisher::Internal
+{
+  rclcpp::Node::SharedPtr Node;
+  rclcpp::Publisher<PointCloud>::SharedPtr PointCloudPublisher;
+  rclcpp::Publisher<sensor_msgs::msg::NavSatFix>::SharedPtr FixPublisher;
+  rclcpp::Publisher<nav_msgs::msg::Odometry>::SharedPtr OdometryPublisher;
+  std::string FrameId;
+  std::string OdometryFrameId;
+};
+#else
+//-----------------------------------------------------------------------------
+struct Ros2Publisher::Internal
+{
+};
+#endif
+
+//-----------------------------------------------------------------------------
+Ros2Publisher::Ros2Publisher()
+  : IsStarted(false)
+  , NumberOfPublishedFrames(0)
+  , NumberOfLoanedFrames(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+Ros2Publisher::~Ros2Publisher()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+bool Ros2Publisher::IsAvailable()
+{
+#ifdef VELOVIEW_HAS_ROS2
+  return true;
+#else
+  return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+bool Ros2Publisher::Start(const std::string& nodeName)
+{
+  if (this->IsStarted)
+  {
+    return true;
+  }
+#ifdef VELOVIEW_HAS_ROS2
+  std::unique_ptr<Internal> node(new Internal);
+  node->FrameId = this->FrameId;
+  node->OdometryFrameId = this->OdometryFrameId;
+  try
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(InitializationMutex);
+      if (!rclcpp::ok())
+      {
+        rclcpp::init(0, nullptr);
+      }
+    }
+    node->Node = std::make_shared<rclcpp::Node>(nodeName);
+    // the latest frame matters more than the reliability, as for the sensor drivers
+    node->PointCloudPublisher =
+      node->Node->create_publisher<PointCloud>(this->PointCloudTopic, rclcpp::SensorDataQoS());
+    node->FixPublisher = node->Node->create_publisher<sensor_msgs::msg::NavSatFix>(
+      this->FixTopic, rclcpp::SensorDataQoS());
+    node->OdometryPublisher = node->Node->create_publisher<nav_msgs::msg::Odometry>(
+      this->OdometryTopic, rclcpp::SensorDataQoS());
+  }
+  catch (const std::exception& exception)
+  {
+    vtkGenericWarningMacro("Cannot create the ROS 2 node " << nodeName << ": " << exception.what());
+    return false;
+  }
+  this->Node = std::move(node);
+  this->NumberOfPublishedFrames = 0;
+  this->NumberOfLoanedFrames = 0;
+  this->IsStarted = true;
+  return true;
+#else
+  vtkGenericWarningMacro("Cannot create the ROS 2 node " << nodeName
+                                                         << ": VeloView is built without ROS 2");
+  return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void Ros2Publisher::Stop()
+{
+  // the decoding threads are stopped before
+  this->IsStarted = false;
+  this->Node.reset();
+}
+
+//-----------------------------------------------------------------------------
+void Ros2Publisher::PublishFrame(vtkPolyData* frame, double time)
+{
+#ifdef VELOVIEW_HAS_ROS2
+  if (!this->IsStarted || !frame || !frame->GetPoints())
+  {
+    return;
+  }
+  Internal* node = this->Node.get();
+  try
+  {
+    if (node->PointCloudPublisher->can_loan_messages())
+    {
+      auto message = node->PointCloudPublisher->borrow_loaned_message();
+      FillPointCloud(frame, time, node->FrameId, message.get());
+      node->PointCloudPublisher->publish(std::move(message));
+      this->NumberOfLoanedFrames++;
+    }
+    else
+    {
+      std::unique_ptr<PointCloud> message(new PointCloud);
+      FillPointCloud(frame, time, node->FrameId, *message);
+      node->PointCloudPublisher->publish(std::move(message));
+    }
+    this->NumberOfPublishedFrames++;
+  }
+  catch (const std::exception& exception)
+  {
+    vtkGenericWarningMacro("Cannot publish the frame on ROS 2: " << exception.what());
+  }
+#else
+  (void)frame;
+  (void)time;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void Ros2Publisher::PublishPosition(
+  const TrajectoryBuffer::Sample& sample, const Eigen::Vector3d& origin)
+{
+#ifdef VELOVIEW_HAS_ROS2
+  if (!this->IsStarted)
+  {
+    return;
+  }
+  Internal* node = this->Node.get();
+  // the time of the fix is the one it is received at, the GPS only gives the time of day
+  const rclcpp::Time stamp = node->Node->now();
+  try
+  {
+    std::unique_ptr<sensor_msgs::msg::NavSatFix> fix(new sensor_msgs::msg::NavSatFix);
+    fix->header.stamp = stamp;
+    fix->header.frame_id = node->FrameId;
+    fix->status.status = sensor_msgs::msg::NavSatStatus::STATUS_FIX;
+    fix->status.service = sensor_msgs::msg::NavSatStatus::SERVICE_GPS;
+    fix->latitude = sample.Lat;
+    fix->longitude = sample.Long;
+    fix->altitude = sample.Position.z();
+    fix->position_covariance_type = sensor_msgs::msg::NavSatFix::COVARIANCE_TYPE_UNKNOWN;
+    node->FixPublisher->publish(std::move(fix));
+
+    // the heading is clockwise from the north, the yaw counterclockwise from the east
+    const Eigen::Vector3d position = sample.Position - origin;
+    const double yaw = vtkMath::RadiansFromDegrees(90.0 - sample.Heading);
+    std::unique_ptr<nav_msgs::msg::Odometry> odometry(new nav_msgs::msg::Odometry);
+    odometry->header.stamp = stamp;
+    odometry->header.frame_id = node->OdometryFrameId;
+    odometry->child_frame_id = node->FrameId;
+    odometry->pose.pose.position.x = position.x();
+    odometry->pose.pose.position.y = position.y();
+    odometry->pose.pose.position.z = position.z();
+    odometry->pose.pose.orientation.z = std::sin(yaw / 2.0);
+    odometry->pose.pose.orientation.w = std::cos(yaw / 2.0);
+    node->OdometryPublisher->publish(std::move(odometry));
+  }
+  catch (const std::exception& exception)
+  {
+    vtkGenericWarningMacro("Cannot publish the position on ROS 2: " << exception.what());
+  }
+#else
+  (void)sample;
+  (void)origin;
+#endif
+}
@@ -0,0 +1,108 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+
+#ifndef ROS2_PUBLISHER_H
+#define ROS2_PUBLISHER_H
+
+// LOCAL
+#include "TrajectoryBuffer.h"
+
+// VTK
+#include <vtkPolyData.h>
+
+// STD
+#include <atomic>
+#include <memory>
+#include <string>
+
+/**
+ * \class Ros2Publisher
+ * \brief Publish the frames of a live stream as sensor_msgs/PointCloud2 and its GPS fixes as
+ *        sensor_msgs/NavSatFix and nav_msgs/Odometry on a ROS 2 node, from the decoding
+ *        threads, so that a ROS 2 perception stack gets the frames without a Python bridge.
+ *
+ * A frame is converted once, directly in the message given to the middleware: the message is
+ * loaned from the middleware when it supports it, otherwise it is moved to the publisher, so
+ * that the intra-process subscribers receive it without a copy. The fields of the point
+ * clouds are x, y, z as float32, then the single component point data arrays of the frame,
+ * with their own type, the 64 bits integers as float64. The odometry is the position of the
+ * fix relative to the first one in its UTM zone, with the heading as yaw.
+ *
+ * It is only available if VeloView has been built with ENABLE_ROS2, otherwise Start fails.
+ */
+class Ros2Publisher
+{
+public:
+  Ros2Publisher();
+  ~Ros2Publisher();
+
+  //! True if VeloView has been built with ROS 2
+  static bool IsAvailable();
+
+  /**
+   * @brief Start create the node and its publishers, initializing ROS 2 if needed
+   * @return false if ROS 2 is not available or the node cannot be created
+   */
+  bool Start(const std::string& nodeName);
+
+  void Stop();
+
+  bool IsRunning() { return this->IsStarted; }
+
+  //! Publish a frame, time being in seconds since the epoch. Called by the decoding thread.
+  void PublishFrame(vtkPolyData* frame, double time);
+
+  //! Publish a fix, origin being the projected position of the first one. Called by the
+  //! position decoding thread.
+  void PublishPosition(const TrajectoryBuffer::Sample& sample, const Eigen::Vector3d& origin);
+
+  //! Settings used by the next Start
+  void SetFrameId(const std::string& frameId) { this->FrameId = frameId; }
+  const std::string& GetFrameId() const { return this->FrameId; }
+  void SetOdometryFrameId(const std::string& frameId) { this->OdometryFrameId = frameId; }
+  const std::string& GetOdometryFrameId() const { return this->OdometryFrameId; }
+  void SetPointCloudTopic(const std::string& topic) { this->PointCloudTopic = topic; }
+  const std::string& GetPointCloudTopic() const { return this->PointCloudTopic; }
+  void SetFixTopic(const std::string& topic) { this->FixTopic = topic; }
+  const std::string& GetFixTopic() const { return this->FixTopic; }
+  void SetOdometryTopic(const std::string& topic) { this->OdometryTopic = topic; }
+  const std::string& GetOdometryTopic() const { return this->OdometryTopic; }
+
+  //! Frames published since the last Start, and how many of them in loaned messages
+  unsigned long GetNumberOfPublishedFrames() { return this->NumberOfPublishedFrames; }
+  unsigned long GetNumberOfLoanedFrames() { return this->NumberOfLoanedFrames; }
+
+private:
+  Ros2Publisher(const Ros2Publisher&) = delete;
+  void operator=(const Ros2Publisher&) = delete;
+
+  std::string FrameId = "velodyne";
+  std::string OdometryFrameId = "odom";
+  std::string PointCloudTopic = "velodyne_points";
+  std::string FixTopic = "fix";
+  std::string OdometryTopic = "odom";
+
+  struct Internal;
+  std::unique_ptr<Internal> Node;
+  std::atomic<bool> IsStarted;
+  std::atomic<unsigned long> NumberOfPublishedFrames;
+  std::atomic<unsigned long> NumberOfLoanedFrames;
+};
+
+#endif // ROS2_PUBLISHER_H
@@ -0,0 +1,373 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+
+// LOCAL
+#include "SharedMemoryFrameRing.h"
+
+// VTK
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkSetGet.h>
+
+// BOOST
+#include <boost/interprocess/shared_memory_object.hpp>
+
+// STD
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the sequences of the ring must be lock free");
+
+namespace
+{
+const char RingMagic[8] = { 'V', 'V', 'F', 'R', 'M', 'R', 'N', 'G' };
+const boost::uint32_t RingVersion = 1;
+const boost::uint64_t Alignment = 64;
+
+//-----------------------------------------------------------------------------
+boost::uint64_t Align(boost::uint64_t size)
+{
+  return (size + Alignment - 1) / Alignment * Alignment;
+}
+
+//-----------------------------------------------------------------------------
+//! The numeric VTK types, the only ones read from a slot
+bool IsNumericType(boost::uint32_t type)
+{
+  return (type >= VTK_CHAR && type <= VTK_ID_TYPE) ||
+    (type >= VTK_SIGNED_CHAR && type <= VTK_UNSIGNED_LONG_LONG);
+}
+}
+
+//-----------------------------------------------------------------------------
+struct SharedMemoryFrameRing::Header
+{
+  char Magic[8];
+  boost::uint32_t Version;
+  boost::uint32_t NumberOfSlots;
+  boost::uint64_t SlotSize;
+  std::atomic<boost::uint64_t> NumberOfPublishedFrames;
+  char Reserved[32];
+};
+
+//-----------------------------------------------------------------------------
+struct SharedMemoryFrameRing::SlotHeader
+{
+  std::atomic<boost::uint64_t> Sequence;
+  boost::uint64_t FrameNumber;
+  double Time;
+  boost::uint64_t NumberOfPoints;
+  boost::uint32_t NumberOfArrays;
+  char Reserved[28];
+};
+
+//-----------------------------------------------------------------------------
+struct SharedMemoryFrameRing::ArrayDescriptor
+{
+  char Name[48];
+  boost::uint32_t DataType;
+  boost::uint32_t NumberOfComponents;
+  boost::uint64_t Offset;
+};
+
+static_assert(sizeof(std::atomic<boost::uint64_t>) == 8, "unexpected size of the sequences");
+
+//-----------------------------------------------------------------------------
+SharedMemoryFrameRing::~SharedMemoryFrameRing()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+SharedMemoryFrameRing::Header* SharedMemoryFrameRing::GetHeader()
+{
+  return static_cast<Header*>(this->Region->get_address());
+}
+
+//-----------------------------------------------------------------------------
+SharedMemoryFrameRing::SlotHeader* SharedMemoryFrameRing::GetSlot(boost::uint64_t index)
+{
+  const Header* header = this->GetHeader();
+  char* slot = static_cast<char*>(this->Region->get_address()) + sizeof(Header) +
+    (index % header->NumberOfSlots) * header->SlotSize;
+  return reinterpret_cast<SlotHeader*>(slot);
+}
+
+//-----------------------------------------------------------------------------
+bool SharedMemoryFrameRing::Create(
+  const std::string& name, unsigned int numberOfSlots, boost::uint64_t slotSize)
+{
+  namespace bi = boost::interprocess;
+  this->Close();
+  slotSize = Align(std::max<boost::uint64_t>(slotSize, sizeof(SlotHeader) + Alignment));
+  numberOfSlots = std::max(numberOfSlots, 1u);
+  try
+  {
+    // a previous process may have been killed before removing it
+    bi::shared_memory_object::remove(name.c_str());
+    bi::shared_memory_object object(bi::create_only, name.c_str(), bi::read_write);
+    object.truncate(static_cast<bi::offset_t>(sizeof(Header) + numberOfSlots * slotSize));
+    this->Region.reset(new bi::mapped_region(object, bi::read_write));
+  }
+  catch (const bi::interprocess_exception& exception)
+  {
+    vtkGenericWarningMacro("Cannot create the shared memory " << name << ": " << exception.what());
+    bi::shared_memory_object::remove(name.c_str());
+    return false;
+  }
+  this->CreatedName = name;
+
+  // the new object is filled with zeros, the slots are empty
+  Header* header = new (this->Region->get_address()) Header;
+  header->Version = RingVersion;
+  header->NumberOfSlots = numberOfSlots;
+  header->SlotSize = slotSize;
+  header->NumberOfPublishedFrames.store(0, std::memory_order_relaxed);
+  for (unsigned int i = 0; i < numberOfSlots; ++i)
+  {
+    new (this->GetSlot(i)) SlotHeader;
+    this->GetSlot(i)->Sequence.store(0, std::memory_order_relaxed);
+  }
+  // the readers check the magic number last
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->Magic, RingMagic, sizeof(RingMagic));
+
+  this->NumberOfPublishedFrames = 0;
+  this->NumberOfSkippedFrames = 0;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool SharedMemoryFrameRing::Open(const std::string& name)
+{
+  namespace bi = boost::interprocess;
+  this->Close();
+  try
+  {
+    bi::shared_memory_object object(bi::open_only, name.c_str(), bi::read_write);
+    this->Region.reset(new bi::mapped_region(object, bi::read_write));
+  }
+  catch (const bi::interprocess_exception&)
+  {
+    return false;
+  }
+
+  const Header* header = this->GetHeader();
+  const size_t size = this->Region->get_size();
+  const bool isValid = size >= sizeof(Header) &&
+    std::memcmp(header->Magic, RingMagic, sizeof(RingMagic)) == 0 &&
+    header->Version == RingVersion && header->NumberOfSlots > 0 &&
+    header->SlotSize >= sizeof(SlotHeader) &&
+    sizeof(Header) + header->NumberOfSlots * header->SlotSize <= size;
+  if (!isValid)
+  {
+    this->Region.reset();
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void SharedMemoryFrameRing::Close()
+{
+  this->Region.reset();
+  if (!this->CreatedName.empty())
+  {
+    // the readers keep their mapping, the name is freed for the next Create
+    boost::interprocess::shared_memory_object::remove(this->CreatedName.c_str());
+    this->CreatedName.clear();
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool SharedMemoryFrameRing::Publish(vtkPolyData* frame, double time)
+{
+  if (!this->Region || this->CreatedName.empty() || !frame || !frame->GetPoints())
+  {
+    return false;
+  }
+
+  // layout of the frame, the points first
+  std::vector<vtkDataArray*> arrays(1, frame->GetPoints()->GetData());
+  vtkPointData* pointData = frame->GetPointData();
+  for (int i = 0; i < pointData->GetNumberOfArrays(); ++i)
+  {
+    vtkDataArray* array = pointData->GetArray(i);
+    if (array && array->GetName() && std::strlen(array->GetName()) < sizeof(ArrayDescriptor::Name))
+    {
+      arrays.push_back(array);
+    }
+  }
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+  std::vector<boost::uint64_t> offsets(arrays.size());
+  boost::uint64_t size = Align(sizeof(SlotHeader) + arrays.size() * sizeof(ArrayDescriptor));
+  for (size_t i = 0; i < arrays.size(); ++i)
+  {
+    offsets[i] = size;
+    size += Align(static_cast<boost::uint64_t>(numberOfPoints) * arrays[i]->GetNumberOfComponents() *
+      arrays[i]->GetDataTypeSize());
+  }
+  Header* header = this->GetHeader();
+  if (size > header->SlotSize)
+  {
+    if (this->NumberOfSkippedFrames++ == 0)
+    {
+      vtkGenericWarningMacro("The frames of " << size << " bytes do not fit in the slots of "
+                                              << header->SlotSize << " bytes of the shared memory");
+    }
+    return false;
+  }
+
+  const boost::uint64_t frameNumber = header->NumberOfPublishedFrames.load(std::memory_order_relaxed);
+  SlotHeader* slot = this->GetSlot(frameNumber);
+  char* slotData = reinterpret_cast<char*>(slot);
+  const boost::uint64_t sequence = slot->Sequence.load(std::memory_order_relaxed);
+  slot->Sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->FrameNumber = frameNumber;
+  slot->Time = time;
+  slot->NumberOfPoints = static_cast<boost::uint64_t>(numberOfPoints);
+  slot->NumberOfArrays = static_cast<boost::uint32_t>(arrays.size());
+  ArrayDescriptor* descriptors = reinterpret_cast<ArrayDescriptor*>(slotData + sizeof(SlotHeader));
+  for (size_t i = 0; i < arrays.size(); ++i)
+  {
+    vtkDataArray* array = arrays[i];
+    ArrayDescriptor& descriptor = descriptors[i];
+    std::memset(descriptor.Name, 0, sizeof(descriptor.Name));
+    std::strcpy(descriptor.Name, i == 0 ? "Points" : array->GetName());
+    descriptor.DataType = static_cast<boost::uint32_t>(array->GetDataType());
+    descriptor.NumberOfComponents = static_cast<boost::uint32_t>(array->GetNumberOfComponents());
+    descriptor.Offset = offsets[i];
+    const size_t numberOfBytes =
+      static_cast<size_t>(numberOfPoints) * descriptor.NumberOfComponents * array->GetDataTypeSize();
+    if (numberOfBytes == 0)
+    {
+      continue;
+    }
+    if (array->HasStandardMemoryLayout())
+    {
+      std::memcpy(slotData + offsets[i], array->GetVoidPointer(0), numberOfBytes);
+    }
+    else
+    {
+      // the arrays of another layout are copied in an array of the same type
+      vtkSmartPointer<vtkDataArray> copy;
+      copy.TakeReference(vtkDataArray::CreateDataArray(array->GetDataType()));
+      copy->DeepCopy(array);
+      std::memcpy(slotData + offsets[i], copy->GetVoidPointer(0), numberOfBytes);
+    }
+  }
+
+  slot->Sequence.store(sequence + 2, std::memory_order_release);
+  header->NumberOfPublishedFrames.store(frameNumber + 1, std::memory_order_release);
+  this->NumberOfPublishedFrames++;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool SharedMemoryFrameRing::ReadLatestFrame(
+  vtkSmartPointer<vtkPolyData>& frame, double& time, boost::uint64_t& frameNumber)
+{
+  if (!this->Region)
+  {
+    return false;
+  }
+  Header* header = this->GetHeader();
+  const boost::uint64_t numberOfFrames = header->NumberOfPublishedFrames.load(std::memory_order_acquire);
+  if (numberOfFrames == 0)
+  {
+    return false;
+  }
+  SlotHeader* slot = this->GetSlot(numberOfFrames - 1);
+  const char* slotData = reinterpret_cast<const char*>(slot);
+  const boost::uint64_t sequence = slot->Sequence.load(std::memory_order_acquire);
+  if (sequence == 0 || sequence % 2 != 0)
+  {
+    return false;
+  }
+
+  // the descriptors are only trusted once the sequence is checked, their offsets are bounded
+  const boost::uint64_t slotSize = header->SlotSize;
+  const boost::uint64_t numberOfPoints = slot->NumberOfPoints;
+  const boost::uint32_t numberOfArrays = slot->NumberOfArrays;
+  const double frameTime = slot->Time;
+  const boost::uint64_t number = slot->FrameNumber;
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  bool isValid = numberOfPoints <= slotSize &&
+    sizeof(SlotHeader) + numberOfArrays * sizeof(ArrayDescriptor) <= slotSize;
+  const ArrayDescriptor* descriptors =
+    reinterpret_cast<const ArrayDescriptor*>(slotData + sizeof(SlotHeader));
+  for (boost::uint32_t i = 0; isValid && i < numberOfArrays; ++i)
+  {
+    ArrayDescriptor descriptor;
+    std::memcpy(&descriptor, descriptors + i, sizeof(descriptor));
+    descriptor.Name[sizeof(descriptor.Name) - 1] = '\0';
+    const boost::uint32_t expectedComponents = i == 0 ? 3 : descriptor.NumberOfComponents;
+    vtkSmartPointer<vtkDataArray> array;
+    if (IsNumericType(descriptor.DataType))
+    {
+      array.TakeReference(vtkDataArray::CreateDataArray(static_cast<int>(descriptor.DataType)));
+    }
+    if (!array || descriptor.NumberOfComponents == 0 || descriptor.NumberOfComponents > 16 ||
+      descriptor.NumberOfComponents != expectedComponents || descriptor.Offset > slotSize)
+    {
+      isValid = false;
+      break;
+    }
+    const boost::uint64_t numberOfBytes =
+      numberOfPoints * descriptor.NumberOfComponents * array->GetDataTypeSize();
+    if (numberOfBytes > slotSize - descriptor.Offset)
+    {
+      isValid = false;
+      break;
+    }
+    array->SetName(descriptor.Name);
+    array->SetNumberOfComponents(static_cast<int>(descriptor.NumberOfComponents));
+    array->SetNumberOfTuples(static_cast<vtkIdType>(numberOfPoints));
+    if (numberOfBytes > 0)
+    {
+      std::memcpy(array->GetVoidPointer(0), slotData + descriptor.Offset, numberOfBytes);
+    }
+    if (i == 0)
+    {
+      vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+      points->SetData(array);
+      output->SetPoints(points);
+    }
+    else
+    {
+      output->GetPointData()->AddArray(array);
+    }
+  }
+
+  // the frame is valid if the publisher has not started to overwrite it during the copy
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (!isValid || slot->Sequence.load(std::memory_order_relaxed) != sequence || !output->GetPoints())
+  {
+    return false;
+  }
+  frame = output;
+  time = frameTime;
+  frameNumber = number;
+  return true;
+}
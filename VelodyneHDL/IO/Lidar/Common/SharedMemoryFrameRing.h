@@ -0,0 +1,142 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+
+#ifndef SHARED_MEMORY_FRAME_RING_H
+#define SHARED_MEMORY_FRAME_RING_H
+
+// VTK
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// BOOST
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+// STD
+#include <atomic>
+#include <memory>
+#include <string>
+
+/**
+ * \class SharedMemoryFrameRing
+ * \brief Publish the decoded frames in a shared memory object, a ring of fixed size slots, so
+ *        that the other processes of the vehicle read them in place instead of decoding the
+ *        sensor again. The publisher never waits for the readers: a slot is protected by a
+ *        sequence lock, and a reader checks after using a frame that it has not been
+ *        overwritten meanwhile.
+ *
+ * The layout uses the byte order of the host, the offsets are in bytes:
+ *
+ * Header, at 0:
+ *   0  char[8]  magic "VVFRMRNG"
+ *   8  uint32   version, 1
+ *   12 uint32   number of slots
+ *   16 uint64   size of a slot, a multiple of 64
+ *   24 uint64   number of frames published, atomic. The latest frame is in the slot
+ *               (number - 1) % number of slots
+ *   32 to 63    reserved
+ *
+ * Slot i, at 64 + i * size of a slot:
+ *   0  uint64   sequence, atomic. It is odd while the slot is written, and 0 until it is first
+ *               written
+ *   8  uint64   number of the frame, from 0 for the first frame published
+ *   16 double   time of the frame, in seconds since the epoch
+ *   24 uint64   number of points
+ *   32 uint32   number of arrays, the first one being the coordinates of the points
+ *   36 to 63    reserved
+ *   64          a descriptor of 64 bytes per array:
+ *                 0  char[48] name, null terminated, "Points" for the coordinates
+ *                 48 uint32   VTK type of the values (VTK_FLOAT is 10, VTK_DOUBLE is 11 ...)
+ *                 52 uint32   number of components
+ *                 56 uint64   offset of the values from the start of the slot, a multiple of 64
+ *               the values of each array are contiguous, the components of a point together
+ *
+ * To read the latest frame, a reader loads the number of frames published, loads the sequence
+ * of its slot with an acquire barrier and checks that it is even and not 0, uses the frame,
+ * then issues an acquire barrier and loads the sequence again: the frame is valid only if the
+ * sequence has not changed. A frame is overwritten after the number of slots - 1 next ones
+ * have been published, which gives that many frame periods to use it. Open and ReadLatestFrame
+ * implement this protocol with a copy of the frame.
+ */
+class SharedMemoryFrameRing
+{
+public:
+  SharedMemoryFrameRing() = default;
+  ~SharedMemoryFrameRing();
+
+  /**
+   * @brief Create create the shared memory object, replacing a stale one with this name, and
+   * publish the frames in it. The object is removed by Close.
+   * @param name name of the object, without slash, "/dev/shm/<name>" on Linux
+   * @return false if the object cannot be created
+   */
+  bool Create(const std::string& name, unsigned int numberOfSlots, boost::uint64_t slotSize);
+
+  /**
+   * @brief Open map an object created by another process, to read its frames
+   * @return false if the object does not exist or does not have the expected layout
+   */
+  bool Open(const std::string& name);
+
+  //! Unmap the object, and remove it if it was created by Create
+  void Close();
+
+  bool IsOpen() { return static_cast<bool>(this->Region); }
+
+  /**
+   * @brief Publish copy a frame in the next slot. A frame which does not fit in a slot is
+   * skipped. Must only be called by a single thread, never blocks on the readers.
+   * @return false if the frame is not published
+   */
+  bool Publish(vtkPolyData* frame, double time);
+
+  /**
+   * @brief ReadLatestFrame copy the latest frame published in the ring opened with Open
+   * @param frameNumber[out] number of the frame, from 0 for the first frame published
+   * @return false if no frame has been published, or if it was overwritten during the copy
+   */
+  bool ReadLatestFrame(vtkSmartPointer<vtkPolyData>& frame, double& time,
+    boost::uint64_t& frameNumber);
+
+  //! Frames published since Create
+  unsigned long GetNumberOfPublishedFrames() { return this->NumberOfPublishedFrames; }
+
+  //! Frames skipped since Create because they did not fit in a slot
+  unsigned long GetNumberOfSkippedFrames() { return this->NumberOfSkippedFrames; }
+
+private:
+  SharedMemoryFrameRing(const SharedMemoryFrameRing&) = delete;
+  void operator=(const SharedMemoryFrameRing&) = delete;
+
+  struct Header;
+  struct SlotHeader;
+  struct ArrayDescriptor;
+
+  Header* GetHeader();
+  SlotHeader* GetSlot(boost::uint64_t index);
+
+  std::unique_ptr<boost::interprocess::mapped_region> Region;
+  //! Name of the object created by Create, empty when the object has been opened
+  std::string CreatedName;
+
+  std::atomic<unsigned long> NumberOfPublishedFrames{ 0 };
+  std::atomic<unsigned long> NumberOfSkippedFrames{ 0 };
+};
+
+#endif // SHARED_MEMORY_FRAME_RING_H
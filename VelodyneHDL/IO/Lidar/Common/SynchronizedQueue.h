@@ -30,6 +30,7 @@
 #define SYNCHRONIZEDQUEUE_H
 
 #include <queue>
+#include <vector>
 #include <boost/thread.hpp>
 
 /**
@@ -60,6 +61,23 @@ public:
     }
   }
 
+  /**
+   * @brief enqueueAll add several elements at once, the waiting thread is woken up once
+   */
+  void enqueueAll(const std::vector<T> &data)
+  {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+
+    if (enqueue_data_ && !data.empty())
+    {
+      for (const T& element : data)
+      {
+        queue_.push(element);
+      }
+      cond_.notify_one();
+    }
+  }
+
   bool dequeue(T &result)
   {
     boost::unique_lock<boost::mutex> lock(mutex_);
@@ -81,6 +99,74 @@ public:
     return true;
   }
 
+  /**
+   * @brief tryEnqueue add some data unless the queue already contains maxSize elements
+   * @return false if the data has not been added
+   */
+  bool tryEnqueue(const T &data, size_t maxSize)
+  {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+
+    if (!enqueue_data_ || queue_.size() >= maxSize)
+    {
+      return false;
+    }
+    queue_.push(data);
+    cond_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief tryEnqueueAll same as tryEnqueue for several elements, the first ones are added
+   * until the queue contains maxSize elements
+   * @return the number of elements which have been added
+   */
+  size_t tryEnqueueAll(const std::vector<T> &data, size_t maxSize)
+  {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+
+    size_t count = 0;
+    while (enqueue_data_ && count < data.size() && queue_.size() < maxSize)
+    {
+      queue_.push(data[count++]);
+    }
+    if (count > 0)
+    {
+      cond_.notify_one();
+    }
+    return count;
+  }
+
+  /**
+   * @brief dequeueAll wait until some data is available or the timeout expires, and move all
+   * the queued data at the end of results. Contrary to dequeue, the data still queued when the
+   * queue is stopped is returned, so that nothing is lost.
+   * @return false once the queue has been stopped
+   */
+  template<typename Duration>
+  bool dequeueAll(std::vector<T> &results, const Duration &timeout)
+  {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+
+    if (queue_.empty() && (!request_to_end_))
+    {
+      cond_.wait_for(lock, timeout);
+    }
+
+    while (!queue_.empty())
+    {
+      results.push_back(queue_.front());
+      queue_.pop();
+    }
+
+    if (request_to_end_)
+    {
+      enqueue_data_ = false;
+      return false;
+    }
+    return true;
+  }
+
   void stopQueue()
   {
     boost::unique_lock<boost::mutex> lock(mutex_);
@@ -0,0 +1,370 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "TimeShiftBuffer.h"
+#include "FileRangeCopy.h"
+#include "LidarFrameDetector.h"
+#include "ThreadTopology.h"
+
+// BOOST
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+// STD
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+//! The packets are coalesced in a buffer of this size before being written
+const size_t WriteBufferSize = 4 << 20;
+//! The buffer is written at least this often, so that the frames can be saved soon
+const boost::chrono::milliseconds FlushInterval(500);
+//! Above this number of queued packets, the new packets are dropped
+const size_t MaxQueueDepth = 1 << 18;
+//! Length of the pcap header written at the beginning of each segment
+const boost::uint64_t SegmentHeaderLength = 24;
+
+const char SegmentPrefix[] = "timeshift_";
+const char SegmentExtension[] = ".pcap";
+
+//-----------------------------------------------------------------------------
+double GetPacketTime(const PacketBufferPointer& packet)
+{
+  const boost::int64_t arrivalTime = packet->GetArrivalTime();
+  return 1e-9 * (arrivalTime > 0 ? arrivalTime : PacketBuffer::GetSystemTime());
+}
+}
+
+//-----------------------------------------------------------------------------
+TimeShiftBuffer::TimeShiftBuffer()
+  : Duration(1800.)
+  , MaximumSize(0)
+  , SegmentDuration(60.)
+  , NextSegmentNumber(0)
+  , NumberOfSavedWindows(0)
+  , NumberOfDroppedPackets(0)
+{
+  this->Writer.SetBufferSize(WriteBufferSize);
+}
+
+//-----------------------------------------------------------------------------
+TimeShiftBuffer::~TimeShiftBuffer()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+bool TimeShiftBuffer::Start(const std::string& directory, LidarFrameDetector* detector)
+{
+  std::unique_ptr<LidarFrameDetector> newDetector(detector);
+  if (this->Thread)
+  {
+    return true;
+  }
+
+  // the segments of the previous session would be mixed with the new ones by the reader
+  boost::system::error_code error;
+  boost::filesystem::create_directories(directory, error);
+  if (!boost::filesystem::is_directory(directory, error))
+  {
+    return false;
+  }
+  for (boost::filesystem::directory_iterator it(directory, error), end; !error && it != end;
+       it.increment(error))
+  {
+    const std::string name = it->path().filename().string();
+    if (name.compare(0, sizeof(SegmentPrefix) - 1, SegmentPrefix) == 0 &&
+      it->path().extension() == SegmentExtension)
+    {
+      boost::filesystem::remove(it->path(), error);
+    }
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    this->Segments.clear();
+    this->Frames.clear();
+  }
+  this->Directory = directory;
+  this->Detector = std::move(newDetector);
+  this->PendingFrames.clear();
+  this->NextSegmentNumber = 0;
+  this->NumberOfDroppedPackets = 0;
+  this->Packets.reset(new SynchronizedQueue<PacketBufferPointer>);
+  this->Thread = boost::shared_ptr<boost::thread>(
+    new boost::thread(boost::bind(&TimeShiftBuffer::ThreadLoop, this)));
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TimeShiftBuffer::Stop()
+{
+  if (this->Thread)
+  {
+    this->Packets->stopQueue();
+    this->Thread->join();
+    this->Thread.reset();
+    this->Packets.reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TimeShiftBuffer::Enqueue(const std::vector<PacketBufferPointer>& packets)
+{
+  if (this->Packets)
+  {
+    const size_t count = this->Packets->tryEnqueueAll(packets, MaxQueueDepth);
+    this->NumberOfDroppedPackets += packets.size() - count;
+  }
+}
+
+//-----------------------------------------------------------------------------
+unsigned int TimeShiftBuffer::GetQueueDepth()
+{
+  return this->Packets ? this->Packets->size() : 0;
+}
+
+//-----------------------------------------------------------------------------
+std::string TimeShiftBuffer::GetFilePattern()
+{
+  return (boost::filesystem::path(this->Directory) /
+           (std::string(SegmentPrefix) + "*" + SegmentExtension)).string();
+}
+
+//-----------------------------------------------------------------------------
+std::string TimeShiftBuffer::GetSegmentFileName(int number)
+{
+  // zero padded, so that the names sort in the chronological order
+  char name[32];
+  std::snprintf(name, sizeof(name), "%s%06d%s", SegmentPrefix, number, SegmentExtension);
+  return (boost::filesystem::path(this->Directory) / name).string();
+}
+
+//-----------------------------------------------------------------------------
+void TimeShiftBuffer::ThreadLoop()
+{
+  ThreadTopology::ApplyToCurrentThread(ThreadTopology::RECORD);
+  std::vector<PacketBufferPointer> packets;
+  double segmentStartTime = 0.;
+  boost::chrono::steady_clock::time_point lastFlush = boost::chrono::steady_clock::now();
+  bool isRunning = true;
+  while (isRunning)
+  {
+    isRunning = this->Packets->dequeueAll(packets, FlushInterval);
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+      const double time = GetPacketTime(packets[i]);
+      if (!this->Writer.IsOpen() || time - segmentStartTime >= this->SegmentDuration)
+      {
+        this->OpenSegment(time);
+        segmentStartTime = time;
+      }
+      if (this->Writer.IsOpen())
+      {
+        this->WritePacket(packets[i], time);
+      }
+      else
+      {
+        this->NumberOfDroppedPackets++;
+      }
+    }
+    // give the buffers back to the pool without waiting for the next packets
+    packets.clear();
+
+    const boost::chrono::steady_clock::time_point now = boost::chrono::steady_clock::now();
+    if (!isRunning || now - lastFlush >= FlushInterval)
+    {
+      this->Flush();
+      lastFlush = now;
+    }
+  }
+  this->Writer.Close();
+}
+
+//-----------------------------------------------------------------------------
+void TimeShiftBuffer::WritePacket(const PacketBufferPointer& packet, double time)
+{
+  const unsigned char* data = packet->GetData();
+  const unsigned int size = static_cast<unsigned int>(packet->GetSize());
+  const boost::uint64_t begin = this->Writer.GetFileOffset();
+  timeval recordTime;
+  recordTime.tv_sec = static_cast<long>(time);
+  recordTime.tv_usec = static_cast<long>((time - recordTime.tv_sec) * 1e6);
+  this->Writer.WritePacket(data, size, recordTime);
+
+  // the empty frames are ignored, as done by default by the reader
+  if (!this->Detector || !this->Detector->IsLidarPacket(data, size))
+  {
+    return;
+  }
+  std::vector<LidarFrameDetector::Split> splits;
+  this->Detector->DetectFrame(data, size, splits);
+  for (size_t i = 0; i < splits.size(); ++i)
+  {
+    if (splits[i].HasContent)
+    {
+      Frame frame = { this->NextSegmentNumber - 1, time, begin, this->Writer.GetFileOffset() };
+      this->PendingFrames.push_back(frame);
+      break;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void TimeShiftBuffer::Flush()
+{
+  if (!this->Writer.IsOpen())
+  {
+    return;
+  }
+  // the frames are only given once their packets can be read from the disk
+  this->Writer.Flush();
+  const boost::uint64_t length = this->Writer.GetFileOffset();
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (!this->Segments.empty())
+  {
+    this->Segments.back().Length = length;
+  }
+  this->Frames.insert(this->Frames.end(), this->PendingFrames.begin(), this->PendingFrames.end());
+  this->PendingFrames.clear();
+}
+
+//-----------------------------------------------------------------------------
+void TimeShiftBuffer::OpenSegment(double time)
+{
+  this->Flush();
+  this->Writer.Close();
+
+  const int number = this->NextSegmentNumber++;
+  const std::string fileName = this->GetSegmentFileName(number);
+  if (!this->Writer.Open(fileName))
+  {
+    return;
+  }
+  {
+    Segment segment = { number, fileName, time, SegmentHeaderLength };
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    this->Segments.push_back(segment);
+  }
+  this->RemoveOldSegments(time);
+}
+
+//-----------------------------------------------------------------------------
+void TimeShiftBuffer::RemoveOldSegments(double time)
+{
+  std::vector<std::string> removedFiles;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    if (this->NumberOfSavedWindows > 0)
+    {
+      return;
+    }
+    boost::uint64_t totalLength = 0;
+    for (const Segment& segment : this->Segments)
+    {
+      totalLength += segment.Length;
+    }
+    // a segment is deleted once the next one starts before the duration
+    const boost::uint64_t maximumLength = static_cast<boost::uint64_t>(this->MaximumSize) << 20;
+    while (this->Segments.size() > 1 &&
+      (time - this->Segments[1].StartTime >= this->Duration ||
+        (maximumLength > 0 && totalLength > maximumLength)))
+    {
+      const Segment& segment = this->Segments.front();
+      while (!this->Frames.empty() && this->Frames.front().SegmentNumber <= segment.Number)
+      {
+        this->Frames.pop_front();
+      }
+      totalLength -= segment.Length;
+      removedFiles.push_back(segment.FileName);
+      this->Segments.pop_front();
+    }
+  }
+
+  for (const std::string& fileName : removedFiles)
+  {
+    boost::system::error_code error;
+    boost::filesystem::remove(fileName, error);
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::vector<double> TimeShiftBuffer::GetFrameTimes()
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  std::vector<double> times;
+  times.reserve(this->Frames.size());
+  for (const Frame& frame : this->Frames)
+  {
+    times.push_back(frame.Time);
+  }
+  return times;
+}
+
+//-----------------------------------------------------------------------------
+bool TimeShiftBuffer::SaveWindow(
+  double startTime, double endTime, const std::string& filename, std::string& error)
+{
+  // the byte ranges of each segment to copy, the header is the one of the first segment
+  std::vector<std::pair<std::string, FileRanges> > copies;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Mutex);
+    auto isBefore = [](const Frame& frame, double time) { return frame.Time < time; };
+    auto first = std::lower_bound(this->Frames.begin(), this->Frames.end(), startTime, isBefore);
+    if (first == this->Frames.end() || first->Time > endTime)
+    {
+      error = "No frame starts in the time window";
+      return false;
+    }
+    auto next = std::upper_bound(this->Frames.begin(), this->Frames.end(), endTime,
+      [](double time, const Frame& frame) { return time < frame.Time; });
+
+    const int lastSegment =
+      next != this->Frames.end() ? next->SegmentNumber : this->Segments.back().Number;
+    for (const Segment& segment : this->Segments)
+    {
+      if (segment.Number < first->SegmentNumber || segment.Number > lastSegment)
+      {
+        continue;
+      }
+      FileRanges ranges;
+      if (copies.empty())
+      {
+        ranges.push_back(std::make_pair(0, SegmentHeaderLength));
+      }
+      const boost::uint64_t begin =
+        segment.Number == first->SegmentNumber ? first->Begin : SegmentHeaderLength;
+      const boost::uint64_t end =
+        next != this->Frames.end() && segment.Number == lastSegment ? next->End : segment.Length;
+      ranges.push_back(std::make_pair(begin, std::min(end, segment.Length)));
+      copies.push_back(std::make_pair(segment.FileName, ranges));
+    }
+    this->NumberOfSavedWindows++;
+  }
+
+  bool success = true;
+  for (size_t i = 0; success && i < copies.size(); ++i)
+  {
+    success = CopyFileRanges(copies[i].first, copies[i].second, filename, i > 0, error);
+  }
+
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->NumberOfSavedWindows--;
+  return success;
+}
@@ -0,0 +1,172 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef TIME_SHIFT_BUFFER_H
+#define TIME_SHIFT_BUFFER_H
+
+// LOCAL
+#include "vtkPacketFileWriter.h"
+#include "PacketBuffer.h"
+#include "SynchronizedQueue.h"
+
+// BOOST
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+// STD
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+class LidarFrameDetector;
+
+/**
+ * @brief The TimeShiftBuffer class keeps the last minutes of the packets of a live sensor on the
+ * disk, so that the live session can be rewound beyond the frames cached in memory by
+ * PacketConsumer, without recording everything beforehand.
+ *
+ * The packets are written by a dedicated thread in the same way as PacketFileWriter, in pcap
+ * segment files of SegmentDuration seconds named so that the reader opens them as a sequence
+ * with GetFilePattern. The oldest segments are deleted when the buffer holds more than
+ * Duration seconds or MaximumSize mebibytes. The segments of a previous session in the
+ * directory are deleted by Start, the ones of the current session are kept after Stop.
+ *
+ * A frame detector finds the frames in the lidar packets as they are written, so that a time
+ * window is saved with SaveWindow by copying the records, without decoding nor parsing them.
+ * The frames are indexed by the arrival time of the packet where they start, in seconds since
+ * the epoch, which is close to the timesteps of vtkLidarStream.
+ */
+class TimeShiftBuffer
+{
+public:
+  TimeShiftBuffer();
+  ~TimeShiftBuffer();
+
+  //! Seconds of packets kept on the disk, used by the next Start
+  double GetDuration() { return this->Duration; }
+  void SetDuration(double seconds) { this->Duration = seconds; }
+
+  //! Disk space used by the packets, in mebibytes, 0 means no limit, used by the next Start
+  unsigned long GetMaximumSize() { return this->MaximumSize; }
+  void SetMaximumSize(unsigned long mebibytes) { this->MaximumSize = mebibytes; }
+
+  //! Seconds of packets in each segment file, a segment is deleted at once
+  double GetSegmentDuration() { return this->SegmentDuration; }
+  void SetSegmentDuration(double seconds) { this->SegmentDuration = seconds; }
+
+  /**
+   * @brief Start delete the segments of a previous session in the directory, which is created
+   * if needed, and start the writing thread
+   * @param detector detector of the frames of the sensor, owned by the buffer. Without it the
+   * packets are kept but no window can be saved.
+   */
+  bool Start(const std::string& directory, LidarFrameDetector* detector);
+
+  /**
+   * @brief Stop write all the queued packets and stop the writing thread, the segments are kept
+   */
+  void Stop();
+
+  //! Queue a batch of packets, the queue is locked once. The buffers are shared, not copied.
+  void Enqueue(const std::vector<PacketBufferPointer>& packets);
+
+  //! Pattern matching the segments, in chronological order, see vtkLidarReader::SetFileName
+  std::string GetFilePattern();
+
+  //! Times of the frames on the disk, only the frames whose packets are flushed are given
+  std::vector<double> GetFrameTimes();
+
+  /**
+   * @brief SaveWindow save in a pcap file the packets of the frames starting between startTime
+   * and endTime, and the packet where the frame after them starts, which completes the last
+   * one. All the traffic in between is kept. The segments are not deleted meanwhile.
+   * @param error[out] the reason of the failure, when false is returned
+   */
+  bool SaveWindow(
+    double startTime, double endTime, const std::string& filename, std::string& error);
+
+  //! Number of packets waiting to be written
+  unsigned int GetQueueDepth();
+
+  //! Number of packets which have not been written because the queue was full or the segment
+  //! could not be created, since the last Start
+  unsigned long GetNumberOfDroppedPackets() { return this->NumberOfDroppedPackets; }
+
+private:
+  //! A segment file, its length only counts the packets flushed to the disk
+  struct Segment
+  {
+    int Number;
+    std::string FileName;
+    double StartTime;
+    boost::uint64_t Length;
+  };
+
+  //! A frame, in the segment where its first packet is
+  struct Frame
+  {
+    int SegmentNumber;
+    double Time;
+    //! offsets of the record of the packet where the frame starts, and of the next record
+    boost::uint64_t Begin;
+    boost::uint64_t End;
+  };
+
+  void ThreadLoop();
+
+  //! Write a packet, add the frame it starts to the pending frames
+  void WritePacket(const PacketBufferPointer& packet, double time);
+
+  //! Flush the current segment, then publish its new length and the pending frames
+  void Flush();
+
+  //! Close the current segment and open the next one, then delete the oldest segments
+  void OpenSegment(double time);
+
+  //! Delete the oldest segments beyond Duration and MaximumSize, the current one is kept
+  void RemoveOldSegments(double time);
+
+  std::string GetSegmentFileName(int number);
+
+  double Duration;
+  unsigned long MaximumSize;
+  double SegmentDuration;
+  std::string Directory;
+
+  //! Only used by the writing thread while it runs
+  vtkPacketFileWriter Writer;
+  std::unique_ptr<LidarFrameDetector> Detector;
+  std::vector<Frame> PendingFrames;
+  int NextSegmentNumber;
+
+  //! Protects Segments, Frames and NumberOfSavedWindows
+  boost::mutex Mutex;
+  std::deque<Segment> Segments;
+  std::deque<Frame> Frames;
+  //! Windows being saved, the segments are not deleted meanwhile
+  int NumberOfSavedWindows;
+
+  boost::shared_ptr<boost::thread> Thread;
+  boost::shared_ptr<SynchronizedQueue<PacketBufferPointer> > Packets;
+  std::atomic<unsigned long> NumberOfDroppedPackets;
+};
+
+#endif // TIME_SHIFT_BUFFER_H
@@ -0,0 +1,199 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "vtkLidarFrameIterator.h"
+#include "vtkLidarReader.h"
+
+// VTK
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// BOOST
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+// STD
+#include <algorithm>
+#include <deque>
+#include <utility>
+
+//-----------------------------------------------------------------------------
+//! Frames given by the decoding thread to Next
+class vtkLidarFrameIterator::vtkInternal
+{
+public:
+  void Decode(vtkLidarReader* reader, int firstFrame, int lastFrame);
+
+  boost::thread Thread;
+  boost::mutex Mutex;
+  //! notified when a frame is queued, or when the decoding ends
+  boost::condition_variable FrameQueued;
+  //! notified when a frame is given by Next, or when the iteration is stopped
+  boost::condition_variable FrameTaken;
+
+  std::deque<std::pair<int, vtkSmartPointer<vtkPolyData> > > Frames;
+  size_t MaximumFrames = 1;
+  bool IsDecodingDone = true;
+  bool IsComplete = false;
+  bool Stop = false;
+
+  //! frame given by the last call to Next
+  vtkSmartPointer<vtkPolyData> Current;
+};
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameIterator::vtkInternal::Decode(vtkLidarReader* reader, int firstFrame, int lastFrame)
+{
+  const bool isComplete = reader->GetFrames(firstFrame, lastFrame, [this](int frame, vtkPolyData* data) {
+    boost::unique_lock<boost::mutex> lock(this->Mutex);
+    while (this->Frames.size() >= this->MaximumFrames && !this->Stop)
+    {
+      this->FrameTaken.wait(lock);
+    }
+    if (this->Stop)
+    {
+      return false;
+    }
+    this->Frames.push_back(std::make_pair(frame, vtkSmartPointer<vtkPolyData>(data)));
+    this->FrameQueued.notify_all();
+    return true;
+  });
+
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->IsComplete = isComplete && !this->Stop;
+  this->IsDecodingDone = true;
+  this->FrameQueued.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLidarFrameIterator)
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameIterator::vtkLidarFrameIterator()
+  : Internal(new vtkInternal)
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameIterator::~vtkLidarFrameIterator()
+{
+  this->Stop();
+  this->SetReader(nullptr);
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameIterator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Reader: " << this->Reader << endl;
+  os << indent << "NumberOfPrefetchedFrames: " << this->NumberOfPrefetchedFrames << endl;
+  os << indent << "FrameNumber: " << this->FrameNumber << endl;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameIterator::SetReader(vtkLidarReader* reader)
+{
+  if (reader == this->Reader)
+  {
+    return;
+  }
+  this->Stop();
+  if (this->Reader)
+  {
+    this->Reader->UnRegister(this);
+  }
+  this->Reader = reader;
+  if (this->Reader)
+  {
+    this->Reader->Register(this);
+  }
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarFrameIterator::Start(int firstFrame, int lastFrame)
+{
+  this->Stop();
+  if (!this->Reader)
+  {
+    vtkErrorMacro("Start() called but there is no reader.");
+    return false;
+  }
+  if (lastFrame < 0)
+  {
+    lastFrame = this->Reader->GetNumberOfFrames() - 1;
+  }
+
+  vtkInternal* internal = this->Internal;
+  {
+    boost::lock_guard<boost::mutex> lock(internal->Mutex);
+    internal->MaximumFrames = std::max(this->NumberOfPrefetchedFrames, 1);
+    internal->IsDecodingDone = false;
+    internal->IsComplete = false;
+    internal->Stop = false;
+  }
+  internal->Thread = boost::thread(
+    &vtkInternal::Decode, internal, this->Reader, firstFrame, lastFrame);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+vtkPolyData* vtkLidarFrameIterator::Next()
+{
+  vtkInternal* internal = this->Internal;
+  boost::unique_lock<boost::mutex> lock(internal->Mutex);
+  while (internal->Frames.empty() && !internal->IsDecodingDone)
+  {
+    internal->FrameQueued.wait(lock);
+  }
+  this->IsComplete = internal->IsComplete;
+  if (internal->Frames.empty())
+  {
+    this->FrameNumber = -1;
+    internal->Current = nullptr;
+    return nullptr;
+  }
+  this->FrameNumber = internal->Frames.front().first;
+  internal->Current = internal->Frames.front().second;
+  internal->Frames.pop_front();
+  internal->FrameTaken.notify_all();
+  return internal->Current;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameIterator::Stop()
+{
+  vtkInternal* internal = this->Internal;
+  {
+    boost::lock_guard<boost::mutex> lock(internal->Mutex);
+    internal->Stop = true;
+    internal->FrameTaken.notify_all();
+  }
+  if (internal->Thread.joinable())
+  {
+    internal->Thread.join();
+  }
+  internal->Frames.clear();
+  internal->Current = nullptr;
+  this->FrameNumber = -1;
+  this->IsComplete = internal->IsComplete;
+}
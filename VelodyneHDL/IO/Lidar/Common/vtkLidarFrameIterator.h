@@ -0,0 +1,94 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef VTK_LIDAR_FRAME_ITERATOR_H
+#define VTK_LIDAR_FRAME_ITERATOR_H
+
+#include <vtkObject.h>
+
+class vtkLidarReader;
+class vtkPolyData;
+
+/**
+ * @brief The vtkLidarFrameIterator class gives the frames of a range of a vtkLidarReader one
+ * after the other, for the scripts processing all the frames of a capture without setting the
+ * animation time and updating the pipeline for each one.
+ *
+ * The frames are decoded by vtkLidarReader::GetFrames on a background thread, at most
+ * NumberOfPrefetchedFrames frames ahead of the one given by Next, so that the decoding of
+ * the next frames goes on while the caller processes the current one. Each frame is a new
+ * vtkPolyData whose arrays are never reused, they can be wrapped without copy and stay valid
+ * as long as they are referenced.
+ */
+class VTK_EXPORT vtkLidarFrameIterator : public vtkObject
+{
+public:
+  static vtkLidarFrameIterator* New();
+  vtkTypeMacro(vtkLidarFrameIterator, vtkObject)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  /// Set the reader of the frames, which must have its frame index. This stops the iteration
+  void SetReader(vtkLidarReader* reader);
+  vtkGetObjectMacro(Reader, vtkLidarReader)
+
+  /// Number of frames decoded ahead of the one given by Next, 2 by default
+  vtkSetMacro(NumberOfPrefetchedFrames, int)
+  vtkGetMacro(NumberOfPrefetchedFrames, int)
+
+  /**
+   * @brief Start decode a range of frames, stopping the previous iteration
+   * @param firstFrame first frame to give
+   * @param lastFrame last frame to give, this frame is included, -1 for the last frame
+   * @return false if there is no reader
+   */
+  bool Start(int firstFrame, int lastFrame);
+
+  /**
+   * @brief Next wait for the next frame of the range
+   * @return the frame, kept by the iterator until the next call, null after the last frame
+   */
+  vtkPolyData* Next();
+
+  /// Number of the frame given by the last call to Next, -1 after the last frame
+  vtkGetMacro(FrameNumber, int)
+
+  /// True if all the frames of the range have been decoded, false if the file could not be
+  /// read or the iteration has been stopped
+  vtkGetMacro(IsComplete, bool)
+
+  /// Stop the decoding, the frames decoded but not given yet are dropped
+  void Stop();
+
+protected:
+  vtkLidarFrameIterator();
+  ~vtkLidarFrameIterator() override;
+
+private:
+  vtkLidarFrameIterator(const vtkLidarFrameIterator&) = delete;
+  void operator=(const vtkLidarFrameIterator&) = delete;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+  vtkLidarReader* Reader = nullptr;
+  int NumberOfPrefetchedFrames = 2;
+  int FrameNumber = -1;
+  bool IsComplete = false;
+};
+
+#endif // VTK_LIDAR_FRAME_ITERATOR_H
@@ -0,0 +1,404 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkLidarFrameStreamSource.h"
+#include "FrameCodec.h"
+#include "LiveTelemetry.h"
+
+// VTK
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// BOOST
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+// STD
+#include <atomic>
+#include <limits>
+#include <vector>
+
+namespace
+{
+//! Time between two attempts to connect to the server
+const boost::posix_time::seconds RetryInterval(1);
+//! Above this size a message cannot be a frame, the connection is reset
+const boost::uint32_t MaximumMessageSize = 64 << 20;
+
+//-----------------------------------------------------------------------------
+//! The operations pending when the source is stopped complete as aborted at the next Start,
+//! they must not connect again
+bool IsAborted(const boost::system::error_code& error)
+{
+  return error == boost::asio::error::operation_aborted;
+}
+}
+
+class vtkLidarFrameStreamSourceInternal
+{
+public:
+  vtkLidarFrameStreamSourceInternal()
+    : Socket(IOService)
+    , Resolver(IOService)
+    , RetryTimer(IOService)
+    , Header(4)
+    , IsConnected(false)
+    , NewFrame(false)
+    , NumberOfReceivedFrames(0)
+    , NumberOfInvalidFrames(0)
+    , NumberOfReceivedBytes(0)
+  {
+  }
+
+  //! The following functions run on the receiving thread
+  void Connect();
+  void HandleConnect(const boost::system::error_code& error);
+  void ReadHeader();
+  void HandleHeader(const boost::system::error_code& error);
+  void HandleMessage(const boost::system::error_code& error);
+  //! Close the connection and connect again after RetryInterval
+  void Retry();
+
+  std::string ServerAddress = "127.0.0.1";
+  int ServerPort = 2370;
+  //! Start has been called, otherwise the first update starts the source
+  bool WasStarted = false;
+
+  boost::asio::io_service IOService;
+  boost::asio::ip::tcp::socket Socket;
+  boost::asio::ip::tcp::resolver Resolver;
+  boost::asio::deadline_timer RetryTimer;
+  boost::shared_ptr<boost::thread> Thread;
+  std::vector<unsigned char> Header;
+  std::vector<unsigned char> Message;
+
+  //! Protects the latest frame, which is replaced by the receiving thread
+  boost::mutex FrameMutex;
+  vtkSmartPointer<vtkPolyData> Frame;
+  double FrameTime = 0;
+
+  //! Protects OnNewFrame, which is called by the receiving thread
+  boost::mutex CallbackMutex;
+  boost::function<void()> OnNewFrame;
+
+  std::atomic<bool> IsConnected;
+  std::atomic<bool> NewFrame;
+  std::atomic<unsigned long> NumberOfReceivedFrames;
+  std::atomic<unsigned long> NumberOfInvalidFrames;
+  std::atomic<unsigned long long> NumberOfReceivedBytes;
+
+  //! Bytes received and time of the last sample of the bit rate, used by GetReceivedBitRate
+  unsigned long long SampleBytes = 0;
+  double SampleTime = 0;
+  double BitRate = 0;
+};
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSourceInternal::Connect()
+{
+  boost::asio::ip::tcp::resolver::query query(
+    this->ServerAddress, std::to_string(this->ServerPort));
+  boost::system::error_code error;
+  boost::asio::ip::tcp::resolver::iterator endpoints = this->Resolver.resolve(query, error);
+  if (error)
+  {
+    this->Retry();
+    return;
+  }
+  boost::asio::async_connect(this->Socket, endpoints,
+    boost::bind(&vtkLidarFrameStreamSourceInternal::HandleConnect, this,
+      boost::asio::placeholders::error));
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSourceInternal::HandleConnect(const boost::system::error_code& error)
+{
+  if (IsAborted(error))
+  {
+    return;
+  }
+  if (error)
+  {
+    this->Retry();
+    return;
+  }
+  this->IsConnected = true;
+  this->ReadHeader();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSourceInternal::ReadHeader()
+{
+  boost::asio::async_read(this->Socket, boost::asio::buffer(this->Header),
+    boost::bind(&vtkLidarFrameStreamSourceInternal::HandleHeader, this,
+      boost::asio::placeholders::error));
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSourceInternal::HandleHeader(const boost::system::error_code& error)
+{
+  if (IsAborted(error))
+  {
+    return;
+  }
+  boost::uint32_t size = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    size |= static_cast<boost::uint32_t>(this->Header[i]) << (8 * i);
+  }
+  if (error || size > MaximumMessageSize)
+  {
+    this->Retry();
+    return;
+  }
+  this->Message.resize(size);
+  boost::asio::async_read(this->Socket, boost::asio::buffer(this->Message),
+    boost::bind(&vtkLidarFrameStreamSourceInternal::HandleMessage, this,
+      boost::asio::placeholders::error));
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSourceInternal::HandleMessage(const boost::system::error_code& error)
+{
+  if (IsAborted(error))
+  {
+    return;
+  }
+  if (error)
+  {
+    this->Retry();
+    return;
+  }
+  this->NumberOfReceivedBytes += this->Header.size() + this->Message.size();
+
+  double time = 0;
+  vtkSmartPointer<vtkPolyData> frame =
+    FrameCodec::Decode(this->Message.data(), this->Message.size(), time);
+  if (!frame)
+  {
+    // a server of another version, the next messages are still delimited
+    this->NumberOfInvalidFrames++;
+    this->ReadHeader();
+    return;
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(this->FrameMutex);
+    this->Frame = frame;
+    this->FrameTime = time;
+  }
+  this->NumberOfReceivedFrames++;
+  this->NewFrame = true;
+  {
+    boost::lock_guard<boost::mutex> lock(this->CallbackMutex);
+    if (this->OnNewFrame)
+    {
+      this->OnNewFrame();
+    }
+  }
+  this->ReadHeader();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSourceInternal::Retry()
+{
+  this->IsConnected = false;
+  boost::system::error_code error;
+  this->Socket.close(error);
+  this->RetryTimer.expires_from_now(RetryInterval);
+  this->RetryTimer.async_wait([this](const boost::system::error_code& timerError) {
+    if (!IsAborted(timerError))
+    {
+      this->Connect();
+    }
+  });
+}
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLidarFrameStreamSource)
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameStreamSource::vtkLidarFrameStreamSource()
+  : Internal(new vtkLidarFrameStreamSourceInternal)
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(1);
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarFrameStreamSource::~vtkLidarFrameStreamSource()
+{
+  this->Stop();
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarFrameStreamSource::GetServerAddress()
+{
+  return this->Internal->ServerAddress;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSource::SetServerAddress(const std::string& address)
+{
+  this->Internal->ServerAddress = address;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameStreamSource::GetServerPort()
+{
+  return this->Internal->ServerPort;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSource::SetServerPort(int port)
+{
+  this->Internal->ServerPort = port;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSource::Start()
+{
+  this->Internal->WasStarted = true;
+  if (this->Internal->Thread)
+  {
+    return;
+  }
+
+  this->Internal->NumberOfReceivedFrames = 0;
+  this->Internal->NumberOfInvalidFrames = 0;
+  this->Internal->NumberOfReceivedBytes = 0;
+  this->Internal->SampleBytes = 0;
+  this->Internal->SampleTime = LiveTelemetry::GetTime();
+  this->Internal->BitRate = 0;
+  this->Internal->IOService.reset();
+  // the server is resolved by the receiving thread, so that Start never waits for it
+  this->Internal->IOService.post(
+    boost::bind(&vtkLidarFrameStreamSourceInternal::Connect, this->Internal));
+  vtkLidarFrameStreamSourceInternal* internal = this->Internal;
+  this->Internal->Thread = boost::shared_ptr<boost::thread>(
+    new boost::thread([internal]() { internal->IOService.run(); }));
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSource::Stop()
+{
+  if (!this->Internal->Thread)
+  {
+    return;
+  }
+
+  this->Internal->IOService.stop();
+  this->Internal->Thread->join();
+  this->Internal->Thread.reset();
+  boost::system::error_code error;
+  this->Internal->Socket.close(error);
+  this->Internal->RetryTimer.cancel(error);
+  this->Internal->IsConnected = false;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSource::Poll()
+{
+  if (this->Internal->NewFrame.exchange(false))
+  {
+    this->Modified();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarFrameStreamSource::SetNewFrameCallback(const boost::function<void()>& callback)
+{
+  boost::lock_guard<boost::mutex> lock(this->Internal->CallbackMutex);
+  this->Internal->OnNewFrame = callback;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarFrameStreamSource::GetNeedsUpdate()
+{
+  this->Poll();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarFrameStreamSource::GetIsConnected()
+{
+  return this->Internal->IsConnected;
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarFrameStreamSource::GetNumberOfReceivedFrames()
+{
+  return static_cast<vtkIdType>(this->Internal->NumberOfReceivedFrames);
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarFrameStreamSource::GetNumberOfInvalidFrames()
+{
+  return static_cast<vtkIdType>(this->Internal->NumberOfInvalidFrames);
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarFrameStreamSource::GetReceivedBitRate()
+{
+  // sampled at most once per second, so that a single frame does not make the rate jump
+  const double now = LiveTelemetry::GetTime();
+  const double elapsed = now - this->Internal->SampleTime;
+  if (elapsed >= 1.)
+  {
+    const unsigned long long bytes = this->Internal->NumberOfReceivedBytes;
+    this->Internal->BitRate = 8. * (bytes - this->Internal->SampleBytes) / elapsed;
+    this->Internal->SampleBytes = bytes;
+    this->Internal->SampleTime = now;
+  }
+  return this->Internal->BitRate;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarFrameStreamSource::GetFrameTime()
+{
+  boost::lock_guard<boost::mutex> lock(this->Internal->FrameMutex);
+  return this->Internal->FrameTime;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarFrameStreamSource::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector), vtkInformationVector* outputVector)
+{
+  if (!this->Internal->WasStarted)
+  {
+    this->Start();
+  }
+
+  vtkPolyData* output = vtkPolyData::GetData(outputVector);
+  vtkSmartPointer<vtkPolyData> frame;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->FrameMutex);
+    frame = this->Internal->Frame;
+  }
+  // the received frames are never modified, the output shares their arrays
+  if (frame)
+  {
+    output->ShallowCopy(frame);
+  }
+  return 1;
+}
@@ -0,0 +1,94 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTKLIDARFRAMESTREAMSOURCE_H
+#define VTKLIDARFRAMESTREAMSOURCE_H
+
+#include <vtkPolyDataAlgorithm.h>
+
+#ifndef __VTK_WRAP__
+#include <boost/function.hpp>
+#endif
+
+#include <string>
+
+class vtkLidarFrameStreamSourceInternal;
+
+/**
+ * @brief The vtkLidarFrameStreamSource class shows the frames streamed by a remote
+ * vtkLidarStream, see vtkLidarStream::SetFrameStreamingPort. A thread receives the frames and
+ * reconnects when the connection is lost, the output is the latest frame received, given by
+ * the next update once Poll has found it. The first update starts the source if Start has not
+ * been called.
+ */
+class VTK_EXPORT vtkLidarFrameStreamSource : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarFrameStreamSource* New();
+  vtkTypeMacro(vtkLidarFrameStreamSource, vtkPolyDataAlgorithm)
+
+  //! Host name or ip address of the streaming VeloView, used by the next Start
+  std::string GetServerAddress();
+  void SetServerAddress(const std::string& address);
+
+  //! Port of the frame streaming, used by the next Start
+  int GetServerPort();
+  void SetServerPort(int port);
+
+  void Start();
+  void Stop();
+
+  //! Modify the source if a frame has been received since the last Poll
+  void Poll();
+
+#ifndef __VTK_WRAP__
+  //! @copydoc vtkLidarStream::SetNewFrameCallback
+  void SetNewFrameCallback(const boost::function<void()>& callback);
+#endif
+
+  /**
+   * @brief GetNeedsUpdate
+   * @return true if a new frame is ready
+   */
+  bool GetNeedsUpdate();
+
+  bool GetIsConnected();
+
+  //! Frames received since the last Start, and the frames which could not be decoded
+  vtkIdType GetNumberOfReceivedFrames();
+  vtkIdType GetNumberOfInvalidFrames();
+
+  //! Bits per second received over the last second or so
+  double GetReceivedBitRate();
+
+  //! Time of the last frame received, in seconds since the epoch, given by the server
+  double GetFrameTime();
+
+protected:
+  vtkLidarFrameStreamSource();
+  ~vtkLidarFrameStreamSource();
+
+  int RequestData(vtkInformation* request, vtkInformationVector** inputVector,
+    vtkInformationVector* outputVector) override;
+
+private:
+  vtkLidarFrameStreamSourceInternal* Internal;
+  vtkLidarFrameStreamSource(const vtkLidarFrameStreamSource&); // not implemented
+  void operator=(const vtkLidarFrameStreamSource&);            // not implemented
+};
+
+#endif // VTKLIDARFRAMESTREAMSOURCE_H
@@ -0,0 +1,578 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#include "vtkLidarMultiSensorReader.h"
+
+#include "LidarInterpreterRegistry.h"
+#include "RawFrameCache.h"
+#include "ThreadTopology.h"
+#include "vtkLidarPacketInterpreter.h"
+#include "vtkLidarReader.h"
+#include "vtkPacketFileReader.h"
+
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+//! Packets decoded by a thread at least, so that the threads are worth starting
+const size_t MinimumPacketsPerPartition = 64;
+
+//! A sensor of the capture, with everything needed to decode its frames on its own thread
+struct Sensor
+{
+  boost::uint32_t Address = 0;
+  unsigned short Port = 0;
+  std::string InterpreterName;
+  vtkSmartPointer<vtkLidarPacketInterpreter> Interpreter;
+  std::vector<FramePosition> Positions;
+
+  //! packet reader kept open between the requests
+  vtkPacketFileReader Reader;
+  //! last frame decoded, given again as long as the requested frame of the sensor is the same
+  vtkSmartPointer<vtkPolyData> Frame;
+  int FrameNumber = -1;
+
+  //! lidar packets of the frame decoded on several threads, reused from one frame to the next
+  RawFrame Packets;
+  //! interpreters decoding the parts of a frame, created for the modification time
+  //! PartitionDecodersTime of the interpreter
+  std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> > PartitionDecoders;
+  vtkMTimeType PartitionDecodersTime = 0;
+};
+
+//-----------------------------------------------------------------------------
+std::string FormatEndpoint(boost::uint32_t address, unsigned short port)
+{
+  std::ostringstream endpoint;
+  endpoint << (address >> 24) << "." << ((address >> 16) & 0xff) << "."
+           << ((address >> 8) & 0xff) << "." << (address & 0xff) << ":" << port;
+  return endpoint.str();
+}
+
+//-----------------------------------------------------------------------------
+//! Number of threads decoding the frames, see vtkLidarMultiSensorReader::NumberOfDecodingThreads
+int GetNumberOfDecodingThreads(int numberOfDecodingThreads)
+{
+  int numberOfThreads = numberOfDecodingThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = ThreadTopology::GetPoolSize(ThreadTopology::DECODE);
+  }
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = boost::thread::hardware_concurrency();
+  }
+  return std::max(numberOfThreads, 1);
+}
+
+//-----------------------------------------------------------------------------
+//! Check that a packet read has been sent by a sensor and is a lidar packet
+bool IsSensorLidarPacket(Sensor* sensor, const unsigned char* data, unsigned int dataLength)
+{
+  boost::uint32_t address = 0;
+  unsigned short port = 0;
+  return sensor->Reader.GetPacketSource(address, port) && address == sensor->Address &&
+    port == sensor->Port && sensor->Interpreter->IsLidarPacket(data, dataLength);
+}
+
+//-----------------------------------------------------------------------------
+/**
+ * Decode the packets of a sensor before the one where its next frame starts, on several threads
+ * when the interpreter supports it. The reader is left at the start of the next frame.
+ * @return true if the frame is complete, which only happens with a sequential decoding
+ */
+bool DecodeSensorPackets(
+  Sensor* sensor, int frameNumber, int numberOfThreads, int& firstFramePositionInPacket)
+{
+  // the packets of the other sensors are skipped while gathering the packets of the frame
+  vtkPacketFileReader& reader = sensor->Reader;
+  const boost::uint64_t nextFramePosition = sensor->Positions[frameNumber + 1].Position;
+  RawFrame& packets = sensor->Packets;
+  packets.Data.clear();
+  packets.Offsets.assign(1, 0);
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  boost::uint64_t position = reader.GetFileOffset();
+  while (position < nextFramePosition && reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    if (IsSensorLidarPacket(sensor, data, dataLength))
+    {
+      packets.Data.insert(packets.Data.end(), data, data + dataLength);
+      packets.Offsets.push_back(packets.Data.size());
+    }
+    position = reader.GetFileOffset();
+  }
+
+  vtkLidarPacketInterpreter* interpreter = sensor->Interpreter;
+  if (interpreter->GetMTime() != sensor->PartitionDecodersTime)
+  {
+    sensor->PartitionDecoders.clear();
+    sensor->PartitionDecodersTime = interpreter->GetMTime();
+  }
+  const size_t numberOfPackets = packets.GetNumberOfPackets();
+  const size_t numberOfPartitions =
+    std::min(static_cast<size_t>(numberOfThreads), numberOfPackets / MinimumPacketsPerPartition);
+  if (numberOfPartitions >= 2 &&
+    interpreter->ProcessPacketsInParallel(packets.Data.data(), packets.Offsets,
+      firstFramePositionInPacket, numberOfPartitions, sensor->PartitionDecoders))
+  {
+    firstFramePositionInPacket = 0;
+    return false;
+  }
+
+  const std::vector<size_t>& offsets = packets.Offsets;
+  for (size_t i = 0; i < numberOfPackets; ++i)
+  {
+    interpreter->ProcessPacket(&packets.Data[offsets[i]],
+      static_cast<unsigned int>(offsets[i + 1] - offsets[i]), firstFramePositionInPacket);
+    if (interpreter->IsNewFrameReady())
+    {
+      return true;
+    }
+    firstFramePositionInPacket = 0;
+  }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+//! Decode a frame of a sensor, skipping the packets sent by the other devices
+void DecodeSensorFrame(Sensor* sensor, const std::string& filename, bool useMemoryMapping,
+  int frameNumber, int numberOfThreads)
+{
+  sensor->Frame = nullptr;
+  sensor->FrameNumber = frameNumber;
+  vtkPacketFileReader& reader = sensor->Reader;
+  if (!reader.IsOpen() && !reader.Open(filename, useMemoryMapping))
+  {
+    return;
+  }
+
+  vtkLidarPacketInterpreter* interpreter = sensor->Interpreter;
+  interpreter->ResetCurrentFrame();
+  reader.SetFileOffset(sensor->Positions[frameNumber].Position);
+  int firstFramePositionInPacket = sensor->Positions[frameNumber].Skip;
+
+  // the packet where the next frame starts also ends this one, it is decoded below
+  if (numberOfThreads > 1 && frameNumber + 1 < static_cast<int>(sensor->Positions.size()) &&
+    DecodeSensorPackets(sensor, frameNumber, numberOfThreads, firstFramePositionInPacket))
+  {
+    sensor->Frame = interpreter->GetLastFrameAvailable();
+    return;
+  }
+
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    if (!IsSensorLidarPacket(sensor, data, dataLength))
+    {
+      continue;
+    }
+
+    interpreter->ProcessPacket(data, dataLength, firstFramePositionInPacket);
+    if (interpreter->IsNewFrameReady())
+    {
+      sensor->Frame = interpreter->GetLastFrameAvailable();
+      return;
+    }
+    firstFramePositionInPacket = 0;
+  }
+
+  interpreter->SplitFrame(true);
+  sensor->Frame = interpreter->GetLastFrameAvailable();
+}
+
+//-----------------------------------------------------------------------------
+class vtkLidarMultiSensorReaderInternal
+{
+public:
+  std::vector<std::unique_ptr<Sensor> > Sensors;
+
+  std::vector<std::string> CalibrationFileNames;
+
+  //! false until the file has been scanned, the sensors are then known
+  bool IsIndexed = false;
+};
+
+//-----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkLidarMultiSensorReader)
+
+//-----------------------------------------------------------------------------
+vtkLidarMultiSensorReader::vtkLidarMultiSensorReader()
+  : Internal(new vtkLidarMultiSensorReaderInternal)
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(GetMaximumNumberOfSensors());
+  this->Internal->CalibrationFileNames.resize(GetMaximumNumberOfSensors());
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarMultiSensorReader::~vtkLidarMultiSensorReader()
+{
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiSensorReader::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FileName: " << this->FileName << endl;
+  os << indent << "NumberOfDecodingThreads: " << this->NumberOfDecodingThreads << endl;
+  for (int i = 0; i < this->GetNumberOfSensors(); ++i)
+  {
+    os << indent << "Sensor " << i << ": " << this->GetSensorEndpoint(i) << " "
+       << this->GetSensorInterpreterName(i) << ", " << this->GetNumberOfFrames(i) << " frames"
+       << endl;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiSensorReader::SetNumberOfDecodingThreads(int numberOfThreads)
+{
+  // this does not change the output, so the reader is not modified
+  this->NumberOfDecodingThreads = std::max(numberOfThreads, 0);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiSensorReader::SetFileName(const std::string& filename)
+{
+  if (filename == this->FileName)
+  {
+    return;
+  }
+
+  this->FileName = filename;
+  this->Internal->Sensors.clear();
+  this->Internal->IsIndexed = false;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarMultiSensorReader::SetCalibrationFileName(int sensor, const std::string& filename)
+{
+  if (sensor < 0 || sensor >= GetMaximumNumberOfSensors() ||
+    filename == this->Internal->CalibrationFileNames[sensor])
+  {
+    return;
+  }
+
+  // the frame index may depend on the calibration, the file is scanned again
+  this->Internal->CalibrationFileNames[sensor] = filename;
+  this->Internal->Sensors.clear();
+  this->Internal->IsIndexed = false;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarMultiSensorReader::GetCalibrationFileName(int sensor)
+{
+  if (sensor < 0 || sensor >= GetMaximumNumberOfSensors())
+  {
+    return std::string();
+  }
+  return this->Internal->CalibrationFileNames[sensor];
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarMultiSensorReader::GetNumberOfSensors()
+{
+  return static_cast<int>(this->Internal->Sensors.size());
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarMultiSensorReader::GetSensorEndpoint(int sensor)
+{
+  if (sensor < 0 || sensor >= this->GetNumberOfSensors())
+  {
+    return std::string();
+  }
+  const Sensor& s = *this->Internal->Sensors[sensor];
+  return FormatEndpoint(s.Address, s.Port);
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarMultiSensorReader::GetSensorInterpreterName(int sensor)
+{
+  if (sensor < 0 || sensor >= this->GetNumberOfSensors())
+  {
+    return std::string();
+  }
+  return this->Internal->Sensors[sensor]->InterpreterName;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarMultiSensorReader::GetNumberOfFrames(int sensor)
+{
+  if (sensor < 0 || sensor >= this->GetNumberOfSensors())
+  {
+    return 0;
+  }
+  return static_cast<int>(this->Internal->Sensors[sensor]->Positions.size());
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarMultiSensorReader::ReadFrameInformation()
+{
+  std::vector<std::unique_ptr<Sensor> >& sensors = this->Internal->Sensors;
+  sensors.clear();
+
+  vtkPacketFileReader reader;
+  if (!reader.Open(this->FileName, this->UseMemoryMappedFile))
+  {
+    vtkErrorMacro(<< "Failed to open packet file: " << this->FileName << endl
+                  << reader.GetLastError());
+    return false;
+  }
+
+  // index of the sensor of each sender, -1 for the senders which are not lidars, such as the
+  // position packets, or which exceed the number of output ports
+  std::map<std::pair<boost::uint32_t, unsigned short>, int> sensorIndices;
+  LidarInterpreterRegistry& registry = LidarInterpreterRegistry::GetInstance();
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  boost::uint64_t lastFilePosition = reader.GetFileOffset();
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    // same progress reporting as vtkLidarReader::ReadFrameInformation
+    this->UpdateProgress(0.0);
+
+    const boost::uint64_t packetPosition = lastFilePosition;
+    lastFilePosition = reader.GetFileOffset();
+    std::pair<boost::uint32_t, unsigned short> sender;
+    if (!reader.GetPacketSource(sender.first, sender.second))
+    {
+      continue;
+    }
+
+    auto it = sensorIndices.find(sender);
+    if (it == sensorIndices.end())
+    {
+      int index = -1;
+      const std::string name = registry.Detect(data, dataLength);
+      if (!name.empty() && sensors.size() < static_cast<size_t>(GetMaximumNumberOfSensors()))
+      {
+        index = static_cast<int>(sensors.size());
+        std::unique_ptr<Sensor> sensor(new Sensor);
+        sensor->Address = sender.first;
+        sensor->Port = sender.second;
+        sensor->InterpreterName = name;
+        sensor->Interpreter = registry.Create(name);
+        const std::string& calibration = this->Internal->CalibrationFileNames[index];
+        if (!calibration.empty())
+        {
+          sensor->Interpreter->LoadCalibration(calibration);
+        }
+        sensor->Interpreter->ResetPreProcessing();
+        sensors.push_back(std::move(sensor));
+      }
+      else if (!name.empty())
+      {
+        vtkWarningMacro(<< "Only " << GetMaximumNumberOfSensors() << " sensors can be read, "
+                        << FormatEndpoint(sender.first, sender.second) << " is ignored");
+      }
+      it = sensorIndices.insert(std::make_pair(sender, index)).first;
+    }
+    if (it->second < 0)
+    {
+      continue;
+    }
+
+    // same rules as vtkLidarReader::ReadFrameInformation
+    Sensor& sensor = *sensors[it->second];
+    if (!sensor.Interpreter->IsLidarPacket(data, dataLength))
+    {
+      continue;
+    }
+    if (sensor.Positions.empty())
+    {
+      sensor.Positions.push_back(FramePosition(packetPosition, 0, timeSinceStart - 1));
+    }
+    bool isNewFrame = false;
+    int framePositionInPacket = 0;
+    sensor.Interpreter->PreProcessPacket(data, dataLength, isNewFrame, framePositionInPacket);
+    if (isNewFrame)
+    {
+      sensor.Positions.push_back(FramePosition(packetPosition, framePositionInPacket, timeSinceStart));
+    }
+  }
+
+  for (size_t i = 0; i < sensors.size(); ++i)
+  {
+    if (!sensors[i]->Interpreter->GetIsCalibrated())
+    {
+      vtkErrorMacro(<< "The calibration of sensor " << i << " ("
+                    << FormatEndpoint(sensors[i]->Address, sensors[i]->Port)
+                    << ") could not be loaded");
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarMultiSensorReader::RequestInformation(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector), vtkInformationVector* outputVector)
+{
+  if (!this->Internal->IsIndexed && !this->FileName.empty())
+  {
+    this->ReadFrameInformation();
+    this->Internal->IsIndexed = true;
+  }
+
+  // the time steps of the first sensor are shared by all the output ports
+  std::vector<double> timeSteps;
+  if (!this->Internal->Sensors.empty())
+  {
+    const Sensor& sensor = *this->Internal->Sensors.front();
+    const double timeOffset = sensor.Interpreter->GetTimeOffset();
+    for (const FramePosition& position : sensor.Positions)
+    {
+      timeSteps.push_back(position.Time + timeOffset);
+    }
+    // see vtkLidarReader::SetTimestepInformation
+    if (!this->ShowFirstAndLastFrame && timeSteps.size() >= 3)
+    {
+      timeSteps.pop_back();
+      timeSteps.erase(timeSteps.begin());
+    }
+  }
+
+  for (int port = 0; port < this->GetNumberOfOutputPorts(); ++port)
+  {
+    vtkInformation* info = outputVector->GetInformationObject(port);
+    if (timeSteps.empty())
+    {
+      info->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+      info->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+      continue;
+    }
+    double timeRange[2] = { timeSteps.front(), timeSteps.back() };
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), timeSteps.data(),
+      static_cast<int>(timeSteps.size()));
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+  }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarMultiSensorReader::RequestData(vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** vtkNotUsed(inputVector), vtkInformationVector* outputVector)
+{
+  std::vector<std::unique_ptr<Sensor> >& sensors = this->Internal->Sensors;
+  if (sensors.empty())
+  {
+    vtkErrorMacro("No sensor found in " << this->FileName);
+    return 0;
+  }
+
+  vtkInformation* info = outputVector->GetInformationObject(0);
+  double timestep = 0.0;
+  if (info->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP()))
+  {
+    timestep = info->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
+  }
+
+  // the first sensor gives the frame of the time step, as vtkLidarReader does, and the other
+  // sensors their frame closest to this one
+  std::vector<int> frameNumbers(sensors.size(), -1);
+  double frameTime = timestep;
+  for (size_t i = 0; i < sensors.size(); ++i)
+  {
+    const std::vector<FramePosition>& positions = sensors[i]->Positions;
+    const double timeOffset = sensors[i]->Interpreter->GetTimeOffset();
+    if (positions.empty() || !sensors[i]->Interpreter->GetIsCalibrated())
+    {
+      continue;
+    }
+    auto position = std::lower_bound(positions.begin(), positions.end(), frameTime - timeOffset,
+      [](const FramePosition& fp, double d) { return fp.Time < d; });
+    if (i == 0)
+    {
+      if (position == positions.end())
+      {
+        position--;
+      }
+      frameTime = position->Time + timeOffset;
+    }
+    else if (position == positions.end() ||
+      (position != positions.begin() &&
+        frameTime - timeOffset - (position - 1)->Time < position->Time - (frameTime - timeOffset)))
+    {
+      position--;
+    }
+    frameNumbers[i] = static_cast<int>(std::distance(positions.begin(), position));
+  }
+
+  // each sensor has its own interpreter and packet reader, so they are decoded concurrently
+  std::vector<size_t> sensorsToDecode;
+  for (size_t i = 0; i < sensors.size(); ++i)
+  {
+    if (frameNumbers[i] >= 0 && frameNumbers[i] != sensors[i]->FrameNumber)
+    {
+      sensorsToDecode.push_back(i);
+    }
+  }
+  // the decoding threads are shared by these sensors, the packets of a high rate sensor being
+  // decoded on several threads
+  const int threadsPerSensor = sensorsToDecode.empty() ? 1 :
+    std::max(1, GetNumberOfDecodingThreads(this->NumberOfDecodingThreads) /
+      static_cast<int>(sensorsToDecode.size()));
+  boost::thread_group threads;
+  for (size_t i = 1; i < sensorsToDecode.size(); ++i)
+  {
+    const size_t sensor = sensorsToDecode[i];
+    threads.create_thread(boost::bind(&DecodeSensorFrame, sensors[sensor].get(), this->FileName,
+      this->UseMemoryMappedFile, frameNumbers[sensor], threadsPerSensor));
+  }
+  if (!sensorsToDecode.empty())
+  {
+    const size_t sensor = sensorsToDecode.front();
+    DecodeSensorFrame(sensors[sensor].get(), this->FileName, this->UseMemoryMappedFile,
+      frameNumbers[sensor], threadsPerSensor);
+  }
+  threads.join_all();
+
+  for (int port = 0; port < this->GetNumberOfOutputPorts(); ++port)
+  {
+    vtkPolyData* output = vtkPolyData::GetData(outputVector, port);
+    if (port < static_cast<int>(sensors.size()) && frameNumbers[port] >= 0 && sensors[port]->Frame)
+    {
+      output->ShallowCopy(sensors[port]->Frame);
+    }
+    else
+    {
+      output->Initialize();
+    }
+  }
+  return 1;
+}
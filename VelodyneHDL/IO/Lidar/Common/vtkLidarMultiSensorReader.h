@@ -0,0 +1,118 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef VTKLIDARMULTISENSORREADER_H
+#define VTKLIDARMULTISENSORREADER_H
+
+#include <vtkPolyDataAlgorithm.h>
+
+#include <string>
+
+class vtkLidarMultiSensorReaderInternal;
+
+/**
+ * @brief The vtkLidarMultiSensorReader class reads a capture of several sensors, told apart by
+ * the address and the port their packets are sent from. A single scan of the file builds the
+ * frame index of every sensor, each one having its own interpreter, created from the packets.
+ * Output port i gives the frame of sensor i, the sensors being numbered in the order of their
+ * first packet. The time steps are the frames of the first sensor, the other sensors give their
+ * frame closest in time. The frames of the sensors are decoded concurrently, and the packets
+ * of each frame on several threads when the interpreter supports it.
+ */
+class VTK_EXPORT vtkLidarMultiSensorReader : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkLidarMultiSensorReader* New();
+  vtkTypeMacro(vtkLidarMultiSensorReader, vtkPolyDataAlgorithm)
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  //! Number of output ports, the sensors after them are ignored
+  static int GetMaximumNumberOfSensors() { return 4; }
+
+  vtkGetMacro(FileName, std::string)
+  void SetFileName(const std::string& filename);
+
+  /**
+   * @brief SetCalibrationFileName set the calibration file of a sensor, needed by the sensors
+   * which do not send their calibration in their packets
+   * @param sensor between 0 and GetMaximumNumberOfSensors()
+   */
+  void SetCalibrationFileName(int sensor, const std::string& filename);
+  std::string GetCalibrationFileName(int sensor);
+
+  vtkGetMacro(ShowFirstAndLastFrame, bool)
+  vtkSetMacro(ShowFirstAndLastFrame, bool)
+
+  vtkGetMacro(UseMemoryMappedFile, bool)
+  vtkSetMacro(UseMemoryMappedFile, bool)
+
+  /**
+   * @brief SetNumberOfDecodingThreads set how many threads decode the frames of the sensors,
+   * shared by the sensors whose frame changes, each one decoding the packets of its frame on
+   * its part of the threads
+   * @param numberOfThreads 0 uses the pool size of the decode threads given by ThreadTopology,
+   * or one thread per core if it is not set, 1 decodes the packets of each sensor sequentially
+   */
+  void SetNumberOfDecodingThreads(int numberOfThreads);
+  vtkGetMacro(NumberOfDecodingThreads, int)
+
+  //! Number of sensors found in the file, available after UpdateInformation
+  int GetNumberOfSensors();
+
+  //! Sender of the packets of a sensor, such as "192.168.1.201:2368"
+  std::string GetSensorEndpoint(int sensor);
+
+  //! Name of the interpreter of a sensor, as registered in the LidarInterpreterRegistry
+  std::string GetSensorInterpreterName(int sensor);
+
+  int GetNumberOfFrames(int sensor);
+
+protected:
+  vtkLidarMultiSensorReader();
+  ~vtkLidarMultiSensorReader();
+
+  int RequestInformation(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+  //! Name of the pcap file to read
+  std::string FileName;
+
+  //! Show/Hide the first and last frame of the first sensor, usually partial frames
+  bool ShowFirstAndLastFrame = false;
+
+  //! Map the pcap file in memory instead of reading it through libpcap
+  bool UseMemoryMappedFile = false;
+
+  //! Number of threads decoding the frames, 0 means the pool size of ThreadTopology
+  int NumberOfDecodingThreads = 0;
+
+private:
+  /**
+   * @brief ReadFrameInformation read the whole pcap once, create an interpreter for each
+   * sensor and build the frame index of every sensor
+   */
+  bool ReadFrameInformation();
+
+  vtkLidarMultiSensorReaderInternal* Internal = nullptr;
+
+  vtkLidarMultiSensorReader(const vtkLidarMultiSensorReader&) = delete;
+  void operator=(const vtkLidarMultiSensorReader&) = delete;
+};
+
+#endif // VTKLIDARMULTISENSORREADER_H
@@ -1,25 +1,43 @@
 #include "vtkLidarPacketInterpreter.h"
+#include "LidarDecodingKernels.h"
 
+#include <vtkMatrix4x4.h>
 #include <vtkTransform.h>
 
-namespace {
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace
+{
 //-----------------------------------------------------------------------------
-vtkSmartPointer<vtkCellArray> NewVertexCells(vtkIdType numberOfVerts)
+//! Packets of a frame decoded by one thread, see ProcessPacketsInParallel
+struct DecodingPartition
 {
-  vtkNew<vtkIdTypeArray> cells;
-  cells->SetNumberOfValues(numberOfVerts * 2);
-  vtkIdType* ids = cells->GetPointer(0);
-  for (vtkIdType i = 0; i < numberOfVerts; ++i)
+  vtkLidarPacketInterpreter* Decoder = nullptr;
+  const unsigned char* Data = nullptr;
+  const std::vector<size_t>* Offsets = nullptr;
+  size_t FirstPacket = 0;
+  size_t EndPacket = 0;
+  int FirstPositionInPacket = 0;
+};
+
+//-----------------------------------------------------------------------------
+void DecodePartition(DecodingPartition* partition)
+{
+  int positionInPacket = partition->FirstPositionInPacket;
+  const std::vector<size_t>& offsets = *partition->Offsets;
+  for (size_t i = partition->FirstPacket; i < partition->EndPacket; ++i)
   {
-    ids[i * 2] = 1;
-    ids[i * 2 + 1] = i;
+    partition->Decoder->ProcessPacket(partition->Data + offsets[i],
+      static_cast<unsigned int>(offsets[i + 1] - offsets[i]), positionInPacket);
+    positionInPacket = 0;
   }
-
-  vtkSmartPointer<vtkCellArray> cellArray = vtkSmartPointer<vtkCellArray>::New();
-  cellArray->SetCells(numberOfVerts, cells.GetPointer());
-  return cellArray;
 }
-
 }
 
 //-----------------------------------------------------------------------------
@@ -41,6 +59,78 @@ bool vtkLidarPacketInterpreter::SplitFrame(bool force)
   return true;
 }
 
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkLidarPacketInterpreter> vtkLidarPacketInterpreter::CreatePreviewDecoder(
+  int decimation)
+{
+  vtkSmartPointer<vtkLidarPacketInterpreter> decoder = this->CreatePartitionDecoder();
+  if (!decoder || decimation <= 1)
+  {
+    return decoder;
+  }
+
+  // thin out the lasers the user has selected rather than all of them
+  int numberOfSelected = 0;
+  for (size_t i = 0; i < decoder->LaserSelection.size(); ++i)
+  {
+    if (decoder->LaserSelection[i] && numberOfSelected++ % decimation != 0)
+    {
+      decoder->LaserSelection[i] = false;
+    }
+  }
+  return decoder;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarPacketInterpreter::ProcessPacketsInParallel(const unsigned char* data,
+  const std::vector<size_t>& offsets, int firstPositionInPacket, size_t numberOfPartitions,
+  std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> >& decoders)
+{
+  const size_t numberOfPackets = offsets.empty() ? 0 : offsets.size() - 1;
+  numberOfPartitions = std::min(numberOfPartitions, numberOfPackets);
+  if (numberOfPartitions < 2)
+  {
+    return false;
+  }
+  while (decoders.size() < numberOfPartitions)
+  {
+    vtkSmartPointer<vtkLidarPacketInterpreter> decoder = this->CreatePartitionDecoder();
+    if (!decoder)
+    {
+      decoders.clear();
+      return false;
+    }
+    decoders.push_back(decoder);
+  }
+
+  std::vector<DecodingPartition> partitions(numberOfPartitions);
+  boost::thread_group threads;
+  for (size_t i = 0; i < numberOfPartitions; ++i)
+  {
+    DecodingPartition& partition = partitions[i];
+    partition.Decoder = decoders[i];
+    partition.Decoder->ResetCurrentFrame();
+    partition.Data = data;
+    partition.Offsets = &offsets;
+    partition.FirstPacket = numberOfPackets * i / numberOfPartitions;
+    partition.EndPacket = numberOfPackets * (i + 1) / numberOfPartitions;
+    partition.FirstPositionInPacket = i == 0 ? firstPositionInPacket : 0;
+    threads.create_thread(boost::bind(&DecodePartition, &partition));
+  }
+  threads.join_all();
+
+  // the partitions are whole packets, so they are appended in order to the current frame
+  for (size_t i = 0; i < numberOfPartitions; ++i)
+  {
+    if (!this->AppendPartition(partitions[i].Decoder))
+    {
+      this->ResetCurrentFrame();
+      return false;
+    }
+  }
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 bool vtkLidarPacketInterpreter::shouldBeCroppedOut(double pos[3], double theta)
 {
@@ -61,7 +151,7 @@ bool vtkLidarPacketInterpreter::shouldBeCroppedOut(double pos[3], double theta)
       vertAngle *= 180.0 / vtkMath::Pi();
 
       pointInside = theta >= this->CropRegion[0] && theta <= this->CropRegion[1];
-      pointInside &= theta >= this->CropRegion[0] && theta <= this->CropRegion[1];
+      pointInside &= vertAngle >= this->CropRegion[2] && vertAngle <= this->CropRegion[3];
       pointInside &= R >= this->CropRegion[4] && R <= this->CropRegion[5];
       break;
     }
@@ -75,6 +165,181 @@ bool vtkLidarPacketInterpreter::shouldBeCroppedOut(double pos[3], double theta)
   return !((pointInside && !this->CropOutside) || (!pointInside && this->CropOutside));
 }
 
+//-----------------------------------------------------------------------------
+bool vtkLidarPacketInterpreter::IsPacketCroppedOut(
+  double firstAzimuth, double lastAzimuth, double minDistance, double maxDistance)
+{
+  if (this->CropMode != CROP_MODE::Cartesian && this->CropMode != CROP_MODE::Spherical)
+  {
+    return false;
+  }
+  if (minDistance > maxDistance)
+  {
+    return true;
+  }
+
+  // A rigid sensor transform moves the origin to its translation and keeps the distances to it,
+  // the points of the packet are in a spherical shell around it
+  bool isRigid = true;
+  double center[3] = { 0., 0., 0. };
+  if (this->SensorTransform)
+  {
+    vtkMatrix4x4* matrix = this->SensorTransform->GetMatrix();
+    for (int i = 0; i < 3; ++i)
+    {
+      for (int j = 0; j < 3; ++j)
+      {
+        double dot = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+          dot += matrix->GetElement(k, i) * matrix->GetElement(k, j);
+        }
+        isRigid &= std::abs(dot - (i == j ? 1.0 : 0.0)) < 1e-12;
+      }
+      center[i] = matrix->GetElement(i, 3);
+    }
+  }
+  const double margin = this->GetMaximumDistanceCorrection() + 1e-6;
+  const double innerRadius = std::max(minDistance - margin, 0.);
+  const double outerRadius = maxDistance + margin;
+  const double* region = this->CropRegion;
+
+  if (this->CropMode == CROP_MODE::Cartesian)
+  {
+    if (!isRigid)
+    {
+      return false;
+    }
+    if (this->CropOutside)
+    {
+      // the whole shell is in the box
+      bool inside = true;
+      for (int i = 0; i < 3; ++i)
+      {
+        inside &= center[i] - outerRadius >= region[2 * i];
+        inside &= center[i] + outerRadius <= region[2 * i + 1];
+      }
+      return inside;
+    }
+    // the shell does not reach the box, or the box is inside the hole of the shell
+    double nearest = 0., farthest = 0.;
+    for (int i = 0; i < 3; ++i)
+    {
+      const double low = region[2 * i] - center[i];
+      const double high = region[2 * i + 1] - center[i];
+      const double nearest1D = low > 0. ? low : high < 0. ? -high : 0.;
+      const double farthest1D = std::max(std::abs(low), std::abs(high));
+      nearest += nearest1D * nearest1D;
+      farthest += farthest1D * farthest1D;
+    }
+    return outerRadius < std::sqrt(nearest) || innerRadius > std::sqrt(farthest);
+  }
+
+  // The azimuth tested by shouldBeCroppedOut is the one of the firing, the arc of the packet
+  // is split in two when it goes through 0
+  const double azimuthEpsilon = 1e-7;
+  double start = std::fmod(firstAzimuth, 360.);
+  start = start < 0. ? start + 360. : start;
+  const double end = start + std::max(lastAzimuth - firstAzimuth, 0.);
+  auto intersects = [&](double low, double high) {
+    return high >= region[0] - azimuthEpsilon && low <= region[1] + azimuthEpsilon;
+  };
+  auto contains = [&](double low, double high) {
+    return low >= region[0] + azimuthEpsilon && high <= region[1] - azimuthEpsilon;
+  };
+  bool azimuthMayBeInside = intersects(start, std::min(end, 360.));
+  bool azimuthIsInside = contains(start, std::min(end, 360.));
+  if (end > 360.)
+  {
+    azimuthMayBeInside |= intersects(0., end - 360.);
+    azimuthIsInside &= contains(0., end - 360.);
+  }
+
+  // the distance to the origin moves by at most the length of the translation
+  const double translation =
+    std::sqrt(center[0] * center[0] + center[1] * center[1] + center[2] * center[2]);
+  const double minR = std::max(innerRadius - translation, 0.);
+  const double maxR = outerRadius + translation;
+  const bool distanceMayBeInside = !isRigid || (maxR >= region[4] && minR <= region[5]);
+  const bool distanceIsInside = isRigid && minR >= region[4] && maxR <= region[5];
+
+  if (this->CropOutside)
+  {
+    // the vertical angle of the points is only bounded by the region when it covers all of them
+    const bool verticalAngleIsInside = region[2] <= -90. && region[3] >= 90.;
+    return azimuthIsInside && distanceIsInside && verticalAngleIsInside;
+  }
+  return !azimuthMayBeInside || !distanceMayBeInside;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarPacketInterpreter::CopyDecodingSettings(vtkLidarPacketInterpreter* decoder)
+{
+  decoder->CalibrationFileName = this->CalibrationFileName;
+  decoder->CalibrationReportedNumLasers = this->CalibrationReportedNumLasers;
+  decoder->IsCalibrated = this->IsCalibrated;
+  decoder->TimeOffset = this->TimeOffset;
+  decoder->LaserSelection = this->LaserSelection;
+  decoder->DistanceResolutionM = this->DistanceResolutionM;
+  decoder->Frequency = this->Frequency;
+  decoder->IgnoreZeroDistances = this->IgnoreZeroDistances;
+  decoder->IgnoreEmptyFrames = this->IgnoreEmptyFrames;
+  decoder->RangeImageWidth = this->RangeImageWidth;
+  decoder->SkipPointCloud = this->SkipPointCloud;
+  decoder->ApplyTransform = this->ApplyTransform;
+  decoder->CropMode = this->CropMode;
+  decoder->CropOutside = this->CropOutside;
+  std::copy(this->CropRegion, this->CropRegion + 6, decoder->CropRegion);
+
+  if (this->SensorTransform)
+  {
+    vtkNew<vtkTransform> transform;
+    transform->SetMatrix(this->SensorTransform->GetMatrix());
+    decoder->SetSensorTransform(transform.GetPointer());
+  }
+  else
+  {
+    decoder->SetSensorTransform(nullptr);
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarPacketInterpreter::GetDecodingKey()
+{
+  std::stringstream key;
+  key.precision(std::numeric_limits<double>::max_digits10);
+  key << this->GetClassName() << " Calibration=" << this->CalibrationFileName
+      << " NumberOfLasers=" << this->CalibrationReportedNumLasers
+      << " TimeOffset=" << this->TimeOffset
+      << " DistanceResolution=" << this->DistanceResolutionM
+      << " IgnoreZeroDistances=" << this->IgnoreZeroDistances
+      << " IgnoreEmptyFrames=" << this->IgnoreEmptyFrames << " LaserSelection=";
+  for (size_t i = 0; i < this->LaserSelection.size(); ++i)
+  {
+    key << this->LaserSelection[i];
+  }
+  key << " RangeImageWidth=" << this->RangeImageWidth << " SkipPointCloud=" << this->SkipPointCloud;
+  key << " ApplyTransform=" << this->ApplyTransform;
+  if (this->SensorTransform)
+  {
+    vtkMatrix4x4* matrix = this->SensorTransform->GetMatrix();
+    for (int i = 0; i < 16; ++i)
+    {
+      key << (i == 0 ? " SensorTransform=" : ",") << matrix->GetElement(i / 4, i % 4);
+    }
+  }
+  key << " CropMode=" << this->CropMode;
+  if (this->CropMode != CROP_MODE::None)
+  {
+    key << " CropOutside=" << this->CropOutside << " CropRegion=";
+    for (int i = 0; i < 6; ++i)
+    {
+      key << (i == 0 ? "" : ",") << this->CropRegion[i];
+    }
+  }
+  return key.str();
+}
+
 //-----------------------------------------------------------------------------
 vtkCxxSetObjectMacro(vtkLidarPacketInterpreter, SensorTransform, vtkTransform)
 
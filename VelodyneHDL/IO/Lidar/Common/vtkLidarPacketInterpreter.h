@@ -16,6 +16,7 @@
 #ifndef VTKLIDARPROVIDERINTERNAL_H
 #define VTKLIDARPROVIDERINTERNAL_H
 
+#include <vtkMath.h>
 #include <vtkNew.h>
 #include <vtkSmartPointer.h>
 #include <vtkTable.h>
@@ -23,6 +24,7 @@
 #include <vtkAlgorithm.h>
 
 class vtkTransform;
+class LidarFrameDetector;
 
 class VTK_EXPORT  vtkLidarPacketInterpreter : public vtkAlgorithm
 {
@@ -92,6 +94,12 @@ public:
   virtual void PreProcessPacket(unsigned char const * data, unsigned int dataLength,
                          bool& isNewFrame, int& framePositionInPacket) = 0;
 
+  /**
+   * @brief ResetPreProcessing forget the state kept by PreProcessPacket between the packets,
+   * must be called before processing a new stream from its beginning
+   */
+  virtual void ResetPreProcessing() {}
+
   /**
    * @brief IsLidarPacket check if the given packet is really a lidar packet
    * @param data raw data packet
@@ -99,6 +107,187 @@ public:
    */
   virtual bool IsLidarPacket(unsigned char const * data, unsigned int dataLength) = 0;
 
+  /**
+   * @brief HasPacketSignature check if the given packet has been produced by a sensor supported
+   * by this interpreter, used to select an interpreter among the registered ones. It must be
+   * stricter than IsLidarPacket when the packets of another vendor can have the same size.
+   * @param data raw data packet
+   * @param dataLength size of the data packet
+   */
+  virtual bool HasPacketSignature(unsigned char const * data, unsigned int dataLength)
+  {
+    return this->IsLidarPacket(data, dataLength);
+  }
+
+  /**
+   * @brief GetPacketAzimuthRange return the azimuths swept by the firings of a lidar packet, so
+   * that the packets can be indexed by azimuth and a sector of a frame decoded alone. It has no
+   * side effect on the interpreter, so that it can be called while indexing on several threads.
+   * @param data raw data packet
+   * @param dataLength size of the data packet
+   * @param firstAzimuth[out] azimuth of the first firing, in degrees
+   * @param lastAzimuth[out] azimuth at the end of the last firing, in degrees
+   * @return false if the interpreter does not support it
+   */
+  virtual bool GetPacketAzimuthRange(unsigned char const* vtkNotUsed(data),
+    unsigned int vtkNotUsed(dataLength), double& vtkNotUsed(firstAzimuth),
+    double& vtkNotUsed(lastAzimuth))
+  {
+    return false;
+  }
+
+  /**
+   * @brief GetMaximumAzimuthCorrection largest difference in degrees between the azimuth of a
+   * point and the azimuth of its firing, due to the calibration of the lasers
+   */
+  virtual double GetMaximumAzimuthCorrection() { return 0.; }
+
+  /**
+   * @brief GetPacketDistanceRange return the range of the distances measured by a lidar packet,
+   * before any calibration, so that the packets which cannot intersect the crop region are not
+   * decoded. It has no side effect on the interpreter, like GetPacketAzimuthRange.
+   * @param data raw data packet
+   * @param dataLength size of the data packet
+   * @param minDistance[out] smallest non zero distance, in meters
+   * @param maxDistance[out] largest distance, in meters, smaller than minDistance if all the
+   * distances are zero
+   * @param hasZeroDistance[out] true if some distances are zero, i.e. some lasers had no return
+   * @return false if the interpreter does not support it
+   */
+  virtual bool GetPacketDistanceRange(unsigned char const* vtkNotUsed(data),
+    unsigned int vtkNotUsed(dataLength), double& vtkNotUsed(minDistance),
+    double& vtkNotUsed(maxDistance), bool& vtkNotUsed(hasZeroDistance))
+  {
+    return false;
+  }
+
+  /**
+   * @brief GetMaximumDistanceCorrection largest difference in meters between the distance of a
+   * point to the sensor and the distance measured by its laser, due to the calibration
+   */
+  virtual double GetMaximumDistanceCorrection() { return 0.; }
+
+  /**
+   * @brief GetPacketSensorTime return the time of the first firing of a lidar packet given by
+   * the sensor, so that the frames can be found by GPS time. It has no side effect on the
+   * interpreter, like GetPacketAzimuthRange.
+   * @param data raw data packet
+   * @param dataLength size of the data packet
+   * @param time[out] in seconds since the top of the hour of the sensor clock
+   * @return false if the interpreter does not support it
+   */
+  virtual bool GetPacketSensorTime(unsigned char const* vtkNotUsed(data),
+    unsigned int vtkNotUsed(dataLength), double& vtkNotUsed(time))
+  {
+    return false;
+  }
+
+  /**
+   * @brief IsPacketCroppedOut check that the crop removes all the returns of a lidar packet,
+   * whatever their exact position, so that it does not need to be decoded. It is conservative:
+   * a packet is only reported when the crop region can be bounded from the packet ranges.
+   * @param firstAzimuth azimuth of the first firing of the packet, in degrees
+   * @param lastAzimuth azimuth at the end of the last firing, in degrees, greater than
+   * firstAzimuth by less than a turn
+   * @param minDistance smallest distance of the returns kept, see GetPacketDistanceRange
+   * @param maxDistance largest distance of the returns kept, smaller than minDistance if the
+   * packet has no return to keep
+   */
+  bool IsPacketCroppedOut(
+    double firstAzimuth, double lastAzimuth, double minDistance, double maxDistance);
+
+  /**
+   * @brief CreateFrameDetector create a detector which finds the frame splits like PreProcessPacket
+   * does, but without any side effect on the interpreter, so that the frame index can be built on
+   * several threads. The caller takes the ownership of the detector.
+   * @return nullptr if the interpreter does not support it, PreProcessPacket is used instead
+   */
+  virtual LidarFrameDetector* CreateFrameDetector() { return nullptr; }
+
+  /**
+   * @brief CreatePartitionDecoder create an interpreter with the same calibration and settings,
+   * used to decode a range of the packets of a frame on another thread. Each range is processed
+   * by its own decoder after a call to ResetCurrentFrame, and the ranges are then given in order
+   * to AppendPartition.
+   * @return nullptr if the interpreter cannot decode a frame by parts
+   */
+  virtual vtkSmartPointer<vtkLidarPacketInterpreter> CreatePartitionDecoder() { return nullptr; }
+
+  /**
+   * @brief AppendPartition add the points decoded by a partition decoder to the current frame,
+   * as if its packets had been processed by this interpreter
+   * @param partition decoder created by CreatePartitionDecoder
+   * @return false if the range of packets cannot be appended (e.g. the frame is split in it), the
+   * current frame must then be decoded again sequentially
+   */
+  virtual bool AppendPartition(vtkLidarPacketInterpreter* vtkNotUsed(partition)) { return false; }
+
+  /**
+   * @brief ProcessPacketsInParallel decode a batch of lidar packets of the current frame on
+   * several threads, each range of packets by its own partition decoder, and append the ranges
+   * in order to the current frame. The batch starts the current frame, which must be empty, and
+   * must not contain the start of the next frame.
+   * @param data packets one after the other
+   * @param offsets offset of each packet in data, followed by the size of data
+   * @param firstPositionInPacket where the frame starts in the first packet
+   * @param numberOfPartitions number of threads used, at least 2
+   * @param decoders[in,out] partition decoders, created when there are less than
+   * numberOfPartitions. They are kept by the caller from one batch to the next, and must be
+   * cleared when the settings of the interpreter change.
+   * @return false if the interpreter cannot decode a frame by parts, or if a range cannot be
+   * appended. The current frame is then empty, and the batch must be processed sequentially.
+   */
+  bool ProcessPacketsInParallel(const unsigned char* data, const std::vector<size_t>& offsets,
+    int firstPositionInPacket, size_t numberOfPartitions,
+    std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> >& decoders);
+
+  /**
+   * @brief CreatePreviewDecoder create a partition decoder giving a coarse version of the frames,
+   * quick to decode, such as while the timeline is scrubbed. One selected laser out of decimation
+   * is kept, and one firing out of decimation by the interpreters able to skip firings.
+   * @param decimation 1 keeps all the points
+   * @return nullptr if the interpreter cannot create a partition decoder
+   */
+  virtual vtkSmartPointer<vtkLidarPacketInterpreter> CreatePreviewDecoder(int decimation);
+
+  /**
+   * @brief CreateUnfilteredDecoder create a partition decoder keeping the returns removed by the
+   * crop and the laser selection, whose frames are given to FilterFrame. The crop and the laser
+   * selection can then be tuned on a frame without decoding it again.
+   * @return nullptr if the filters cannot be applied after decoding with the current settings
+   */
+  virtual vtkSmartPointer<vtkLidarPacketInterpreter> CreateUnfilteredDecoder() { return nullptr; }
+
+  /**
+   * @brief FilterFrame apply the crop and the laser selection to a frame decoded by a decoder
+   * created by CreateUnfilteredDecoder, giving the frame this interpreter would have decoded.
+   * The frame is not modified.
+   * @return the frame itself when all its points are kept, nullptr if it cannot be filtered
+   */
+  virtual vtkSmartPointer<vtkPolyData> FilterFrame(vtkPolyData* vtkNotUsed(frame)) { return nullptr; }
+
+  /**
+   * @brief GetStreamCalibration serialize the calibration which has been detected in the stream
+   * (ex: HDL-64 rolling calibration) so that it can be stored along with the frame index.
+   * @param data[out] opaque calibration blob
+   * @return false if there is no calibration coming from the stream to save
+   */
+  virtual bool GetStreamCalibration(std::vector<unsigned char>& vtkNotUsed(data)) { return false; }
+
+  /**
+   * @brief SetStreamCalibration restore a calibration previously returned by GetStreamCalibration
+   * @param data opaque calibration blob
+   * @return true if the interpreter is now calibrated
+   */
+  virtual bool SetStreamCalibration(const std::vector<unsigned char>& vtkNotUsed(data)) { return false; }
+
+  /**
+   * @brief GetDecodingKey return a string describing the calibration and the settings which
+   * change the decoded frames, so that frames saved on disk can be identified. Interpreters with
+   * their own settings or calibration must append them to the common ones.
+   */
+  virtual std::string GetDecodingKey();
+
   /**
    * @brief ResetCurrentFrame reset all information to handle some new frame. This reset the
    * frame container, some information about the current frame, guesses about the sensor type, etc
@@ -121,6 +310,31 @@ public:
    */
   void ClearAllFramesAvailable() { this->Frames.clear(); }
 
+  /**
+   * @brief IsNewSectorReady check if sectors of the frame under construction are ready, see
+   * SectorSize
+   */
+  bool IsNewSectorReady() { return this->Sectors.size(); }
+
+  /**
+   * @brief GetSectorsAvailable return the sectors completed since the last clear, in order.
+   * The last sector of a frame is given when the frame is split, before the sectors of the
+   * next frame.
+   */
+  const std::vector<vtkSmartPointer<vtkPolyData> >& GetSectorsAvailable() { return this->Sectors; }
+
+  /**
+   * @brief ClearAllSectorsAvailable delete all sectors that have been given
+   */
+  void ClearAllSectorsAvailable() { this->Sectors.clear(); }
+
+  /**
+   * @brief GetFrameSensorTime time of a frame given by the sensor, in seconds. The origin
+   * depends on the sensor, for example the top of the hour of its GPS clock.
+   * @return NaN if the frame does not carry the time of the sensor
+   */
+  virtual double GetFrameSensorTime(vtkPolyData* vtkNotUsed(frame)) { return vtkMath::Nan(); }
+
   /**
    * @brief GetSensorInformation return information to display to the user
    * @return
@@ -161,6 +375,24 @@ public:
   vtkGetMacro(IgnoreEmptyFrames, bool)
   vtkSetMacro(IgnoreEmptyFrames, bool)
 
+  /**
+   * @copydoc vtkLidarPacketInterpreter::SectorSize
+   */
+  vtkGetMacro(SectorSize, double)
+  vtkSetMacro(SectorSize, double)
+
+  /**
+   * @copydoc vtkLidarPacketInterpreter::RangeImageWidth
+   */
+  vtkGetMacro(RangeImageWidth, int)
+  vtkSetMacro(RangeImageWidth, int)
+
+  /**
+   * @copydoc vtkLidarPacketInterpreter::SkipPointCloud
+   */
+  vtkGetMacro(SkipPointCloud, bool)
+  vtkSetMacro(SkipPointCloud, bool)
+
   vtkGetMacro(ApplyTransform, bool)
   vtkSetMacro(ApplyTransform, bool)
 
@@ -186,12 +418,23 @@ protected:
    */
   bool shouldBeCroppedOut(double pos[3], double theta);
 
+  /**
+   * @brief CopyDecodingSettings copy the calibration and processing settings common to all the
+   * interpreters to a partition decoder. The sensor transform is copied, not shared, as it is
+   * updated while processing the packets.
+   * @param decoder interpreter created by CreatePartitionDecoder
+   */
+  void CopyDecodingSettings(vtkLidarPacketInterpreter* decoder);
+
   //! Buffer to store the frame once they are ready
   std::vector<vtkSmartPointer<vtkPolyData> > Frames;
 
   //! Frame under construction
   vtkSmartPointer<vtkPolyData> CurrentFrame;
 
+  //! Parts of the frame under construction which are ready, see SectorSize
+  std::vector<vtkSmartPointer<vtkPolyData> > Sectors;
+
   //! File containing all calibration information
   std::string CalibrationFileName = "";
 
@@ -226,6 +469,22 @@ protected:
   //! Proccess/skip frame with 0 points
   bool IgnoreEmptyFrames = false;
 
+  //! Azimuth range in degrees of the sectors given while a frame is built, so that the points
+  //! can be processed before the rotation completes. 0 disables the sectors, which are only
+  //! produced by the interpreters able to split a frame under construction. Set by the live
+  //! stream, the sectors must be cleared by the caller like the frames.
+  double SectorSize = 0;
+
+  //! Number of columns of the range image of each frame, 0 disables it. The interpreters which
+  //! support it write the returns in a number of lasers x RangeImageWidth image while decoding,
+  //! whose rows are the lasers sorted by vertical angle and columns the azimuth. The range,
+  //! intensity and adjusted time channels are added to the field data of the frame, see
+  //! RangeImageBuilder, the last return of a pixel being kept.
+  int RangeImageWidth = 0;
+
+  //! Only build the range image of the frames, which then have no point
+  bool SkipPointCloud = false;
+
   //! Indicate if the vtkLidarProvider::SensorTransform is apply
   bool ApplyTransform = false;
 
@@ -241,13 +500,14 @@ protected:
 
   //! Depending on the :CropingMode select this can have different meaning:
   //! - vtkLidarProvider::CropModeEnum::Cartesian it correspond to [X_min, X_max, Y_min, Y_max, Z_min, Z_max]
-  //! - vtkLidarProvider::CropModeEnum::Spherical it correspond to [R_min, R_max, THETA_min, THETA_max, PHI_min, PHI_max]
+  //! - vtkLidarProvider::CropModeEnum::Spherical it correspond to [THETA_min, THETA_max, PHI_min, PHI_max, R_min, R_max]
+  //!   where THETA is the azimuth and PHI the vertical angle
   //! - vtkLidarProvider::CropModeEnum::Spherical -> Note implemented yet
   //! all distance are in cm and all angle are in degree
   double CropRegion[6] = {0,0,0,0,0,0};
 
   vtkLidarPacketInterpreter() = default;
-  virtual ~vtkLidarPacketInterpreter() = default;
+  virtual ~vtkLidarPacketInterpreter() { this->SetSensorTransform(nullptr); }
 
 private:
   vtkLidarPacketInterpreter(const vtkLidarPacketInterpreter&) = delete;
@@ -16,7 +16,7 @@ int vtkLidarProvider::FillOutputPortInformation(int port, vtkInformation* info)
     info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkPolyData" );
     return 1;
   }
-  if ( port == 1 )
+  if ( port == 1 || port == 2 )
   {
     info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkTable" );
     return 1;
@@ -78,7 +78,8 @@ vtkMTimeType vtkLidarProvider::GetMTime()
 vtkLidarProvider::vtkLidarProvider()
 {
   this->SetNumberOfInputPorts(0);
-  this->SetNumberOfOutputPorts(2);
+  // frames, calibration and statistics of the returns of the frames
+  this->SetNumberOfOutputPorts(3);
 }
 
 //-----------------------------------------------------------------------------
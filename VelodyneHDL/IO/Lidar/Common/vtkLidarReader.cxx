@@ -1,174 +1,2632 @@
 #include "vtkLidarReader.h"
+#include "TraceEvents.h"
 
+#include "DecodedFrameFile.h"
+#include "FileRangeCopy.h"
+#include "FrameCache.h"
+#include "FrameIndexFile.h"
+#include "FramePrefetcher.h"
+#include "FrameQuality.h"
+#include "LidarDecodingKernels.h"
+#include "LidarFrameDetector.h"
+#include "LidarInterpreterRegistry.h"
+#include "MemoryAccounting.h"
+#include "PacketAzimuthIndex.h"
+#include "PositionConsumer.h"
+#include "RawFrameCache.h"
+#include "ThreadTopology.h"
 #include "vtkLidarPacketInterpreter.h"
-#include "vtkPacketFileWriter.h"
 #include "vtkPacketFileReader.h"
 
+#include <vtkDataObject.h>
+#include <vtkDoubleArray.h>
+#include <vtkInformationDoubleVectorKey.h>
 #include <vtkInformationVector.h>
 #include <vtkInformation.h>
+#include <vtkIntArray.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTable.h>
+#include <vtksys/Glob.hxx>
+
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+//! Default memory budget of the frame cache, in mebibytes
+const int DefaultFrameCacheSize = 256;
+
+//! Default memory budget of the raw frame cache, in mebibytes
+const int DefaultRawFrameCacheSize = 128;
+
+//! Number of lidar packets needed by a detector to know in which direction the azimuth goes.
+//! A chunk does not report its first packets, they are reported by the previous chunk instead.
+const int NumberOfOverlappingPackets = 4;
+//! Splitting smaller files is not worth it
+const boost::uint64_t MinimumChunkSize = 16 << 20;
+
+//! Smallest number of lidar packets decoded by a thread when a frame is decoded in parallel,
+//! below that starting the threads costs more than it saves
+const size_t MinimumPacketsPerPartition = 64;
+
+//! Duration from the start of a file in which the position packets are searched for the date
+//! and the hour of the lidar packets, in seconds
+const double MaximumUTCTimeSearchDuration = 10.;
+
+//! The sensor times are given from the top of the hour
+const double Hour = 3600.;
+
+//! Number of frames the incremental indexing must find before the time steps are published,
+//! the first and last frames are usually partial and hidden
+const size_t MinimumNumberOfIndexedFrames = 3;
+
+struct IndexedSplit
+{
+  boost::uint64_t Position;
+  double Time;
+  LidarFrameDetector::Split Split;
+};
+
+//! Part of the pcap indexed by one thread
+struct IndexingChunk
+{
+  //! record where the chunk starts
+  boost::uint64_t Begin = 0;
+  //! record where the next chunk starts
+  boost::uint64_t End = 0;
+
+  std::vector<IndexedSplit> Splits;
+  bool HasFirstPacket = false;
+  boost::uint64_t FirstPacketPosition = 0;
+  double FirstPacketTime = 0;
+  //! if the frame in progress at the end of the chunk contains some data
+  bool TrailingContent = false;
+  //! positions of the first packet reported, and of the first one that was not reported.
+  //! For consecutive chunks, they must match, otherwise a record boundary was wrong.
+  boost::uint64_t ReportedBegin = 0;
+  boost::uint64_t ReportedEnd = 0;
+  bool Success = false;
+  //! positions of the packets of the chunk which are not lidar packets, only recorded for a
+  //! vtkLidarReader::PacketObserver
+  std::vector<boost::uint64_t> OtherPackets;
+  //! lidar packets reported by the chunk with their azimuths, only recorded when the
+  //! interpreter gives them
+  std::vector<PacketAzimuthIndex::Packet> Packets;
+};
+
+//-----------------------------------------------------------------------------
+//! Azimuth range of a lidar packet, and its distance range if the interpreter gives it
+//! @return false if the interpreter cannot give the azimuths of the packet
+bool GetPacketRanges(vtkLidarPacketInterpreter* interpreter, const unsigned char* data,
+  unsigned int dataLength, PacketAzimuthIndex::Packet& packet)
+{
+  if (!interpreter->GetPacketAzimuthRange(
+        data, dataLength, packet.FirstAzimuth, packet.LastAzimuth))
+  {
+    return false;
+  }
+  packet.HasDistances = interpreter->GetPacketDistanceRange(
+    data, dataLength, packet.MinDistance, packet.MaxDistance, packet.HasZeroDistance);
+  if (!interpreter->GetPacketSensorTime(data, dataLength, packet.SensorTime))
+  {
+    packet.SensorTime = std::numeric_limits<double>::quiet_NaN();
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//! UTC time of the first lidar packet of a file, from the first position packet with a dated
+//! NMEA sentence found at the start of the file, see PositionConsumer::DecodeUTCTime
+//! @return false if there is none, or if the interpreter does not give the time of the packets
+bool GetFirstPacketUTCTime(
+  const std::string& fileName, vtkLidarPacketInterpreter* interpreter, double& time)
+{
+  vtkPacketFileReader reader;
+  if (!reader.Open(fileName, true))
+  {
+    return false;
+  }
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  bool hasLidarPacket = false, hasPositionPacket = false;
+  double lidarReceiveTime = 0., lidarSensorTime = 0.;
+  double positionReceiveTime = 0., positionSensorTime = 0., positionTime = 0.;
+  while ((!hasLidarPacket || !hasPositionPacket) &&
+    reader.NextPacket(data, dataLength, timeSinceStart) &&
+    timeSinceStart < MaximumUTCTimeSearchDuration)
+  {
+    if (interpreter->IsLidarPacket(data, dataLength))
+    {
+      if (!hasLidarPacket)
+      {
+        if (!interpreter->GetPacketSensorTime(data, dataLength, lidarSensorTime))
+        {
+          return false;
+        }
+        lidarReceiveTime = timeSinceStart;
+        hasLidarPacket = true;
+      }
+    }
+    else if (!hasPositionPacket &&
+      PositionConsumer::DecodeUTCTime(data, dataLength, positionTime, positionSensorTime))
+    {
+      positionReceiveTime = timeSinceStart;
+      hasPositionPacket = true;
+    }
+  }
+  if (!hasLidarPacket || !hasPositionPacket)
+  {
+    return false;
+  }
+
+  // both packets have the time of the sensor clock, which wraps every hour, the wrap between
+  // them is the one closest to the time between their reception
+  const double elapsed = positionSensorTime - lidarSensorTime;
+  const double receiveElapsed = positionReceiveTime - lidarReceiveTime;
+  time = positionTime - elapsed - Hour * std::round((receiveElapsed - elapsed) / Hour);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//! Set the GPS times of the frames from the sensor times of all the lidar packets of the file,
+//! the first packet being measured at firstPacketTime, see GetFirstPacketUTCTime
+void SetFrameSensorTimes(const std::vector<PacketAzimuthIndex::Packet>& packets,
+  double firstPacketTime, std::vector<FramePosition>& positions)
+{
+  if (packets.empty() || std::isnan(packets.front().SensorTime))
+  {
+    return;
+  }
+  // the sensor times wrap every hour, they are followed from the first packet
+  std::vector<double> times(packets.size());
+  double offset = firstPacketTime - packets.front().SensorTime;
+  double lastTime = packets.front().SensorTime;
+  for (size_t i = 0; i < packets.size(); ++i)
+  {
+    const double time = packets[i].SensorTime;
+    if (std::isnan(time))
+    {
+      times[i] = time;
+      continue;
+    }
+    if (time < lastTime - Hour / 2.)
+    {
+      offset += Hour;
+    }
+    times[i] = time + offset;
+    lastTime = time;
+  }
+
+  // same packets as PacketAzimuthIndex::Build, the first packet of the next frame ends a frame
+  auto byPosition = [](const PacketAzimuthIndex::Packet& packet, boost::uint64_t position) {
+    return packet.Position < position;
+  };
+  for (size_t frame = 0; frame < positions.size(); ++frame)
+  {
+    auto begin =
+      std::lower_bound(packets.begin(), packets.end(), positions[frame].Position, byPosition);
+    if (begin == packets.end())
+    {
+      break;
+    }
+    auto last = packets.end() - 1;
+    if (frame + 1 < positions.size())
+    {
+      last = std::lower_bound(begin, packets.end(), positions[frame + 1].Position, byPosition);
+      last = last != packets.end() ? last : last - 1;
+    }
+    positions[frame].FirstSensorTime = times[begin - packets.begin()];
+    positions[frame].LastSensorTime = times[last - packets.begin()];
+  }
+}
+
+//-----------------------------------------------------------------------------
+void IndexChunk(const std::string& filename, unsigned short port, LidarFrameDetector* detector,
+  vtkLidarPacketInterpreter* azimuthSource, bool isFirstChunk, bool recordOtherPackets,
+  IndexingChunk* chunk)
+{
+  vtkPacketFileReader reader;
+  if (!reader.Open(filename, true, port))
+  {
+    return;
+  }
+  const boost::uint64_t fileSize = reader.GetFileSize();
+  reader.SetFileOffset(chunk->Begin);
+
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  std::vector<LidarFrameDetector::Split> splits;
+
+  // initialize the detector state with packets reported by the previous chunk
+  int remainingPackets = isFirstChunk ? 0 : NumberOfOverlappingPackets;
+  while (remainingPackets > 0)
+  {
+    const boost::uint64_t packetPosition = reader.GetFileOffset();
+    if (!reader.NextPacket(data, dataLength, timeSinceStart))
+    {
+      chunk->ReportedBegin = chunk->ReportedEnd = fileSize;
+      chunk->Success = true;
+      return;
+    }
+    if (detector->IsLidarPacket(data, dataLength))
+    {
+      detector->DetectFrame(data, dataLength, splits);
+      remainingPackets--;
+    }
+    else if (recordOtherPackets && packetPosition < chunk->End)
+    {
+      chunk->OtherPackets.push_back(packetPosition);
+    }
+  }
+  detector->ResetContent();
+  chunk->ReportedBegin = reader.GetFileOffset();
+
+  // report the packets of the chunk, and the first packets of the next one
+  boost::uint64_t lastFilePosition = chunk->ReportedBegin;
+  remainingPackets = NumberOfOverlappingPackets;
+  while (remainingPackets > 0)
+  {
+    if (!reader.NextPacket(data, dataLength, timeSinceStart))
+    {
+      lastFilePosition = fileSize;
+      break;
+    }
+    const boost::uint64_t nextFilePosition = reader.GetFileOffset();
+    if (!detector->IsLidarPacket(data, dataLength))
+    {
+      // the packets after End are recorded by the next chunk
+      if (recordOtherPackets && lastFilePosition < chunk->End)
+      {
+        chunk->OtherPackets.push_back(lastFilePosition);
+      }
+      lastFilePosition = nextFilePosition;
+      continue;
+    }
+
+    if (!chunk->HasFirstPacket)
+    {
+      chunk->HasFirstPacket = true;
+      chunk->FirstPacketPosition = lastFilePosition;
+      chunk->FirstPacketTime = timeSinceStart;
+    }
+
+    detector->DetectFrame(data, dataLength, splits);
+    for (size_t i = 0; i < splits.size(); ++i)
+    {
+      IndexedSplit split = { lastFilePosition, timeSinceStart, splits[i] };
+      chunk->Splits.push_back(split);
+    }
+    PacketAzimuthIndex::Packet packet = { lastFilePosition, 0., 0. };
+    if (azimuthSource && GetPacketRanges(azimuthSource, data, dataLength, packet))
+    {
+      chunk->Packets.push_back(packet);
+    }
+
+    // End is a record boundary, so a packet ending after it also starts after it
+    if (nextFilePosition > chunk->End)
+    {
+      remainingPackets--;
+    }
+    lastFilePosition = nextFilePosition;
+  }
+  chunk->ReportedEnd = lastFilePosition;
+  chunk->TrailingContent = detector->HasContent();
+  chunk->Success = true;
+}
+
+//-----------------------------------------------------------------------------
+//! Index whole files of a sequence, each one as a single chunk, until there is no file left
+void IndexSequenceFiles(const std::vector<std::string>* filenames, unsigned short port,
+  const std::vector<LidarFrameDetector*>* detectors, bool recordOtherPackets,
+  std::atomic<size_t>* nextFile, std::vector<IndexingChunk>* chunks)
+{
+  for (size_t i = (*nextFile)++; i < chunks->size(); i = (*nextFile)++)
+  {
+    if (!(*detectors)[i])
+    {
+      continue;
+    }
+    IndexingChunk& chunk = (*chunks)[i];
+    vtkPacketFileReader reader;
+    if (reader.Open((*filenames)[i], true, port))
+    {
+      chunk.Begin = reader.GetFileOffset();
+      chunk.End = reader.GetFileSize();
+      reader.Close();
+      IndexChunk(
+        (*filenames)[i], port, (*detectors)[i], nullptr, true, recordOtherPackets, &chunk);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Create the frame index of consecutive chunks, applying IgnoreEmptyFrames as
+//! PreProcessPacket would have done
+void StitchChunks(const IndexingChunk* chunks, size_t numberOfChunks, bool ignoreEmptyFrames,
+  std::vector<FramePosition>& positions)
+{
+  bool hasContent = false;
+  bool firstPacket = true;
+  positions.clear();
+  for (size_t c = 0; c < numberOfChunks; ++c)
+  {
+    const IndexingChunk& chunk = chunks[c];
+    if (firstPacket && chunk.HasFirstPacket)
+    {
+      // the first timestep is moved back, see ReadFrameInformation
+      positions.push_back(FramePosition(chunk.FirstPacketPosition, 0, chunk.FirstPacketTime - 1));
+      firstPacket = false;
+    }
+
+    size_t i = 0;
+    while (i < chunk.Splits.size())
+    {
+      // only one frame can start in a given packet
+      const IndexedSplit& packet = chunk.Splits[i];
+      int framePositionInPacket = -1;
+      for (; i < chunk.Splits.size() && chunk.Splits[i].Position == packet.Position; ++i)
+      {
+        if (hasContent || chunk.Splits[i].Split.HasContent || !ignoreEmptyFrames)
+        {
+          framePositionInPacket = chunk.Splits[i].Split.PositionInPacket;
+        }
+        hasContent = false;
+      }
+      if (framePositionInPacket >= 0)
+      {
+        positions.push_back(FramePosition(packet.Position, framePositionInPacket, packet.Time));
+      }
+    }
+    hasContent = hasContent || chunk.TrailingContent;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Find the frames starting between two positions of a sequence, the first one being the start
+//! of a frame. This finds the splits missed by the indexing of each file, which starts again
+//! from scratch at the beginning of a file.
+void DetectSeamSplits(vtkPacketFileReader* reader, LidarFrameDetector* detector,
+  boost::uint64_t begin, boost::uint64_t end, bool ignoreEmptyFrames,
+  std::vector<FramePosition>& positions)
+{
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  std::vector<LidarFrameDetector::Split> splits;
+  reader->SetFileOffset(begin);
+  boost::uint64_t lastFilePosition = begin;
+  // the first packets initialize the detector state, the frame starting there is known
+  int remainingPackets = NumberOfOverlappingPackets;
+  while (lastFilePosition < end && reader->NextPacket(data, dataLength, timeSinceStart))
+  {
+    const boost::uint64_t nextFilePosition = reader->GetFileOffset();
+    if (detector->IsLidarPacket(data, dataLength))
+    {
+      detector->DetectFrame(data, dataLength, splits);
+      if (remainingPackets > 0)
+      {
+        remainingPackets--;
+        detector->ResetContent();
+      }
+      else
+      {
+        int framePositionInPacket = -1;
+        for (size_t i = 0; i < splits.size(); ++i)
+        {
+          if (splits[i].HasContent || !ignoreEmptyFrames)
+          {
+            framePositionInPacket = splits[i].PositionInPacket;
+          }
+        }
+        if (framePositionInPacket >= 0)
+        {
+          positions.push_back(
+            FramePosition(lastFilePosition, framePositionInPacket, timeSinceStart));
+        }
+      }
+    }
+    lastFilePosition = nextFilePosition;
+  }
+}
+
+//! Frame index built by a background thread, see vtkLidarReader::IncrementalIndexing
+struct IncrementalIndex
+{
+  boost::mutex Mutex;
+  //! notified each time a frame is found, and when the thread ends
+  boost::condition_variable Condition;
+  //! frames found by the thread which have not been added to the frame index yet
+  std::vector<FramePosition> PendingPositions;
+  //! set by the reader to abort the indexing
+  bool Stop = false;
+  bool Done = false;
+  bool Success = false;
+  //! given the packets which are not lidar packets, removed by the reader when it changes
+  vtkLidarReader::PacketObserver* Observer = nullptr;
+
+  std::unique_ptr<LidarFrameDetector> Detector;
+  //! copy of the interpreter giving the azimuths and the sensor times of the packets to the
+  //! thread, null if the interpreter cannot be copied. The index is then not saved, as the
+  //! qualities and the times of the frames are missing.
+  vtkSmartPointer<vtkLidarPacketInterpreter> AzimuthSource;
+  //! lidar packets with their azimuths, and time of the first one, only read by the reader
+  //! once the thread is done
+  std::vector<PacketAzimuthIndex::Packet> Packets;
+  bool HasFirstPacketTime = false;
+  double FirstPacketTime = 0.;
+  boost::thread Thread;
+};
+
+//-----------------------------------------------------------------------------
+void IndexIncrementally(const std::string& filename, bool useMemoryMapping, unsigned short port,
+  bool ignoreEmptyFrames, IncrementalIndex* index)
+{
+  vtkPacketFileReader reader;
+  if (reader.Open(filename, useMemoryMapping, port))
+  {
+    const unsigned char* data = 0;
+    unsigned int dataLength = 0;
+    double timeSinceStart = 0;
+    std::vector<LidarFrameDetector::Split> splits;
+    boost::uint64_t lastFilePosition = reader.GetFileOffset();
+    bool firstPacket = true;
+    {
+      boost::lock_guard<boost::mutex> lock(index->Mutex);
+      if (index->Observer)
+      {
+        index->Observer->StartPackets(filename);
+      }
+    }
+
+    while (reader.NextPacket(data, dataLength, timeSinceStart))
+    {
+      const boost::uint64_t nextFilePosition = reader.GetFileOffset();
+      if (!index->Detector->IsLidarPacket(data, dataLength))
+      {
+        lastFilePosition = nextFilePosition;
+        boost::lock_guard<boost::mutex> lock(index->Mutex);
+        if (index->Observer && !index->Stop)
+        {
+          index->Observer->ProcessPacket(data, dataLength, timeSinceStart);
+        }
+        continue;
+      }
+
+      // same rules as the sequential scan, see ReadFrameInformation
+      std::vector<FramePosition> positions;
+      if (firstPacket)
+      {
+        positions.push_back(FramePosition(lastFilePosition, 0, timeSinceStart - 1));
+        firstPacket = false;
+      }
+      index->Detector->DetectFrame(data, dataLength, splits);
+      int framePositionInPacket = -1;
+      for (size_t i = 0; i < splits.size(); ++i)
+      {
+        if (splits[i].HasContent || !ignoreEmptyFrames)
+        {
+          framePositionInPacket = splits[i].PositionInPacket;
+        }
+      }
+      if (framePositionInPacket >= 0)
+      {
+        positions.push_back(FramePosition(lastFilePosition, framePositionInPacket, timeSinceStart));
+      }
+      PacketAzimuthIndex::Packet packet = { lastFilePosition, 0., 0. };
+      if (index->AzimuthSource &&
+        GetPacketRanges(index->AzimuthSource, data, dataLength, packet))
+      {
+        index->Packets.push_back(packet);
+      }
+      lastFilePosition = nextFilePosition;
+
+      boost::lock_guard<boost::mutex> lock(index->Mutex);
+      if (index->Stop)
+      {
+        if (index->Observer)
+        {
+          index->Observer->EndPackets(false);
+        }
+        return;
+      }
+      if (!positions.empty())
+      {
+        index->PendingPositions.insert(
+          index->PendingPositions.end(), positions.begin(), positions.end());
+        index->Condition.notify_all();
+      }
+    }
+    index->Success = true;
+  }
+  if (index->Success && !index->Packets.empty())
+  {
+    index->HasFirstPacketTime =
+      GetFirstPacketUTCTime(filename, index->AzimuthSource, index->FirstPacketTime);
+  }
+
+  boost::lock_guard<boost::mutex> lock(index->Mutex);
+  if (index->Observer && index->Success)
+  {
+    index->Observer->EndPackets(true);
+  }
+  index->Done = true;
+  index->Condition.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+//! Decode the packets following the current position of the reader until the frame in progress
+//! of the interpreter is split, the frame in progress is given when the file has been read
+vtkSmartPointer<vtkPolyData> DecodeFramePackets(vtkLidarPacketInterpreter* interpreter,
+  vtkPacketFileReader* reader, int firstFramePositionInPacket)
+{
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart;
+  while (reader->NextPacket(data, dataLength, timeSinceStart))
+  {
+
+    if (!interpreter->IsLidarPacket(data, dataLength))
+    {
+      continue;
+    }
+
+    interpreter->ProcessPacket(data, dataLength, firstFramePositionInPacket);
+
+    // check if the required frames are ready
+    if (interpreter->IsNewFrameReady())
+    {
+      return interpreter->GetLastFrameAvailable();
+    }
+    firstFramePositionInPacket = 0;
+  }
+
+  interpreter->SplitFrame(true);
+  return interpreter->GetLastFrameAvailable();
+}
+
+//-----------------------------------------------------------------------------
+//! Frames decoded by the threads of vtkLidarReader::GetFrames, they are given to the callback
+//! in order by the calling thread
+struct FrameBatch
+{
+  boost::mutex Mutex;
+  //! notified when a frame has been decoded, or when a thread stops
+  boost::condition_variable FrameDecoded;
+  //! notified when a frame has been given to the callback, or when the batch is canceled
+  boost::condition_variable FrameDelivered;
+
+  //! positions of the frames to decode, and of the frame following the last one if any
+  std::vector<FramePosition> Positions;
+  boost::uint64_t EndPosition = std::numeric_limits<boost::uint64_t>::max();
+  std::vector<std::string> FileNames;
+  bool UseMemoryMappedFile = false;
+  unsigned short Port = 0;
+
+  //! next frame to decode and next frame to deliver, relative to the first frame of the batch
+  size_t NextFrame = 0;
+  size_t NextDelivery = 0;
+  //! at most this number of frames are decoded and waiting to be delivered
+  size_t MaximumPendingFrames = 0;
+  //! the packets of the frames before this one have been asked to the system, see
+  //! vtkPacketFileReader::WillNeed
+  size_t ReadAheadFrame = 0;
+  std::map<size_t, vtkSmartPointer<vtkPolyData> > DecodedFrames;
+  int RunningThreads = 0;
+  bool Stop = false;
+};
+
+//-----------------------------------------------------------------------------
+void DecodeBatchFrames(FrameBatch* batch, vtkLidarPacketInterpreter* interpreter)
+{
+  vtkPacketFileReader reader;
+  const bool isOpen = reader.Open(batch->FileNames, batch->UseMemoryMappedFile, batch->Port);
+
+  boost::unique_lock<boost::mutex> lock(batch->Mutex);
+  while (isOpen && !batch->Stop)
+  {
+    const size_t frame = batch->NextFrame;
+    if (frame >= batch->Positions.size())
+    {
+      break;
+    }
+    if (frame >= batch->NextDelivery + batch->MaximumPendingFrames)
+    {
+      batch->FrameDelivered.wait(lock);
+      continue;
+    }
+    batch->NextFrame++;
+    // the packets of the frames the threads take next are read by the system while this one
+    // is decoded, so that few threads keep the storage busy
+    const size_t readAheadBegin = std::max(batch->ReadAheadFrame, frame);
+    const size_t readAheadEnd =
+      std::min(frame + batch->MaximumPendingFrames + 1, batch->Positions.size());
+    batch->ReadAheadFrame = std::max(batch->ReadAheadFrame, readAheadEnd);
+    lock.unlock();
+
+    interpreter->ResetCurrentFrame();
+    reader.SetFileOffset(batch->Positions[frame].Position);
+    if (readAheadBegin < readAheadEnd)
+    {
+      reader.WillNeed(batch->Positions[readAheadBegin].Position,
+        readAheadEnd < batch->Positions.size() ? batch->Positions[readAheadEnd].Position
+                                               : batch->EndPosition);
+    }
+    vtkSmartPointer<vtkPolyData> polyData =
+      DecodeFramePackets(interpreter, &reader, batch->Positions[frame].Skip);
+
+    lock.lock();
+    batch->DecodedFrames[frame] = polyData;
+    batch->FrameDecoded.notify_all();
+  }
+  // if the file cannot be opened, the frames are decoded by the other threads
+  batch->RunningThreads--;
+  batch->FrameDecoded.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+//! Number of threads decoding a frame in parallel, see vtkLidarReader::NumberOfDecodingThreads
+int GetNumberOfDecodingThreads(int numberOfDecodingThreads)
+{
+  int numberOfThreads = numberOfDecodingThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = ThreadTopology::GetPoolSize(ThreadTopology::DECODE);
+  }
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = boost::thread::hardware_concurrency();
+  }
+  return numberOfThreads;
+}
+}
+
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+class vtkLidarReaderInternal
+{
+public:
+  //! Protect the interpreter, the frame caches and the packet readers, as frames are also
+  //! decoded by the prefetcher thread
+  boost::mutex DecodeMutex;
+
+  //! Packet reader used by the prefetcher thread
+  vtkPacketFileReader PrefetchReader;
+
+  //! Copy of the interpreter decoding the prefetched frames, created for the frame content time
+  //! PrefetchDecoderTime by the thread updating the pipeline, which changes the settings of the
+  //! interpreter without the decode lock. See SchedulePrefetch.
+  boost::mutex PrefetchDecoderMutex;
+  vtkSmartPointer<vtkLidarPacketInterpreter> PrefetchDecoder;
+  vtkMTimeType PrefetchDecoderTime = 0;
+
+  std::unique_ptr<FramePrefetcher> Prefetcher;
+
+  //! Frame index in progress, null when the index is complete
+  std::unique_ptr<IncrementalIndex> Indexing;
+
+  //! Given the packets which are not lidar packets by the scans, see SetPacketObserver
+  vtkLidarReader::PacketObserver* Observer = nullptr;
+
+  //! Modification time set by the last Poll which extended the frame index, and the time used
+  //! to identify the decoded frames before it. See GetFrameContentTime.
+  vtkMTimeType IndexModifiedTime = 0;
+  vtkMTimeType FrameContentTime = 0;
+
+  //! Lidar packets of each frame with their azimuths, see GetFrame with an azimuth sector.
+  //! The frames are recorded while building the frame index when the interpreter supports it,
+  //! otherwise the first time a sector of the frame is requested.
+  PacketAzimuthIndex PacketAzimuths;
+
+  //! GetFrameIndexKey when the frame index was built. The index is only built again when this
+  //! key changes, the other settings of the interpreter only change how the frames are decoded.
+  std::string FrameIndexKey;
+
+  //! Interpreters decoding the parts of a frame, created for the frame content time
+  //! PartitionDecodersTime. See DecodePacketsInParallel.
+  std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> > PartitionDecoders;
+  vtkMTimeType PartitionDecodersTime = 0;
+
+  //! Lidar packets of the frames, see GetRawFrame
+  RawFrameCache RawFrames;
+
+  //! Copy of the lidar packets of the frame being decoded in parallel, reused from one frame to
+  //! the next when they are not kept by the raw frame cache
+  std::shared_ptr<RawFrame> Packets = std::make_shared<RawFrame>();
+
+  //! Decoded frame file opened for the frame content time DecodedFramesTime
+  DecodedFrameFile DecodedFrames;
+  vtkMTimeType DecodedFramesTime = 0;
+
+  //! Last frame given by RequestData, with its number and its frame content time. It is given
+  //! again while the requested frame is decoded in the background.
+  vtkSmartPointer<vtkPolyData> LastFrame;
+  int LastFrameNumber = -1;
+  vtkMTimeType LastFrameTime = 0;
+
+  //! Last frame given by RequestData decoded without the crop and the laser selection, with
+  //! the key of the settings used. See DecodeFilteredFrame.
+  vtkSmartPointer<vtkPolyData> UnfilteredFrame;
+  int UnfilteredFrameNumber = -1;
+  std::string UnfilteredFrameKey;
+
+  //! Frame decoded in the background for an asynchronous update, -1 if none, and the frame
+  //! found ready by Poll, given by the next RequestData without waiting for the cache lock.
+  //! This is only used by the thread updating the pipeline.
+  int PendingFrame = -1;
+  vtkSmartPointer<vtkPolyData> ReadyFrame;
+  int ReadyFrameNumber = -1;
+
+  //! Decoder of the previews, created for the frame content time PreviewDecoderTime, and the
+  //! packet reader kept open while scrubbing. See vtkLidarReader::Scrubbing.
+  vtkSmartPointer<vtkLidarPacketInterpreter> PreviewDecoder;
+  vtkMTimeType PreviewDecoderTime = 0;
+  vtkPacketFileReader PreviewReader;
+
+  //! The last frame given by RequestData is a preview
+  bool IsPreview = false;
+};
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarReader::GetFrameIndexKey()
+{
+  std::stringstream key;
+  key << this->Interpreter->GetClassName();
+  // the points which are kept only change where the frames start when the empty frames are
+  // skipped, otherwise IgnoreZeroDistances is a decoding setting like the laser selection
+  if (this->Interpreter->GetIgnoreEmptyFrames())
+  {
+    key << " IgnoreZeroDistances=" << this->Interpreter->GetIgnoreZeroDistances();
+  }
+  key << " IgnoreEmptyFrames=" << this->Interpreter->GetIgnoreEmptyFrames()
+      << " LidarPort=" << this->GetDestinationPort();
+  return key.str();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::LoadFrameIndexFile()
+{
+  FrameIndexFile indexFile;
+  std::vector<unsigned char> streamCalibration;
+  std::vector<unsigned char> packetAzimuths;
+  if (!indexFile.Read(this->FileNames.front(), this->GetFrameIndexKey(), this->FilePositions,
+        streamCalibration, packetAzimuths))
+  {
+    vtkDebugMacro(<< "Frame index not loaded: " << indexFile.GetLastError());
+    return false;
+  }
+
+  if (!streamCalibration.empty())
+  {
+    this->Interpreter->SetStreamCalibration(streamCalibration);
+  }
+
+  // without calibration the pcap must be scanned anyway to find it
+  if (!this->Interpreter->GetIsCalibrated())
+  {
+    this->FilePositions.clear();
+    return false;
+  }
+  if (!this->Internal->PacketAzimuths.Deserialize(packetAzimuths))
+  {
+    vtkDebugMacro(<< "Packet azimuths not loaded, they are indexed again when needed");
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SaveFrameIndexFile()
+{
+  FrameIndexFile indexFile;
+  std::vector<unsigned char> streamCalibration;
+  this->Interpreter->GetStreamCalibration(streamCalibration);
+  std::vector<unsigned char> packetAzimuths;
+  this->Internal->PacketAzimuths.Serialize(packetAzimuths);
+  if (!indexFile.Write(this->FileNames.front(), this->GetFrameIndexKey(), this->FilePositions,
+        streamCalibration, packetAzimuths))
+  {
+    // the pcap may be located in a read only directory, this is not an error
+    vtkDebugMacro(<< "Frame index not saved: " << indexFile.GetLastError());
+  }
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarReader::GetDecodedFrameKey()
+{
+  return this->GetFrameIndexKey() + " " + this->Interpreter->GetDecodingKey();
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarReader::ReadDecodedFrame(int frameNumber, vtkMTimeType time)
+{
+  // the decoded frames are stored next to a single file
+  if (this->FileNames.size() != 1)
+  {
+    return nullptr;
+  }
+
+  DecodedFrameFile& file = this->Internal->DecodedFrames;
+  if (this->Internal->DecodedFramesTime != time)
+  {
+    this->Internal->DecodedFramesTime = time;
+    if (!file.Open(this->FileNames.front(), this->GetDecodedFrameKey()))
+    {
+      vtkDebugMacro(<< "Decoded frames not loaded: " << file.GetLastError());
+    }
+  }
+
+  // the frames must correspond to the current frame index
+  if (!file.IsOpen() || file.GetNumberOfFrames() != this->GetNumberOfFrames())
+  {
+    return nullptr;
+  }
+  return file.GetFrame(frameNumber);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::SaveDecodedFrameFile()
+{
+  if (this->FileNames.empty() || this->GetNumberOfFrames() == 0 || this->GetIsIndexing())
+  {
+    vtkErrorMacro("SaveDecodedFrameFile() called but the frame index is not complete.");
+    return false;
+  }
+  if (this->FileNames.size() > 1)
+  {
+    vtkErrorMacro("The decoded frames of a sequence of files cannot be saved.");
+    return false;
+  }
+
+  std::string key;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+    key = this->GetDecodedFrameKey();
+    DecodedFrameFile& file = this->Internal->DecodedFrames;
+    if (file.Open(this->FileNames.front(), key) &&
+      file.GetNumberOfFrames() == this->GetNumberOfFrames())
+    {
+      return true;
+    }
+    // a mapped file cannot be replaced on every platform, GetFrame opens the new one
+    file.Close();
+    this->Internal->DecodedFramesTime = 0;
+  }
+
+  DecodedFrameFileWriter writer;
+  if (!writer.Open(this->FileNames.front(), key))
+  {
+    vtkErrorMacro(<< "Cannot save the decoded frames: " << writer.GetLastError());
+    return false;
+  }
+  const bool decoded = this->GetFrames(0, this->GetNumberOfFrames() - 1,
+    [&writer](int, vtkPolyData* frame) { return writer.WriteFrame(frame); });
+  if (!decoded || !writer.Close())
+  {
+    vtkErrorMacro(<< "Cannot save the decoded frames: " << writer.GetLastError());
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::ReadFrameInformationInParallel()
+{
+  int numberOfThreads = this->NumberOfIndexingThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = boost::thread::hardware_concurrency();
+  }
+  // the calibration contained in the stream can only be read sequentially
+  if (numberOfThreads < 2 || !this->Interpreter->GetIsCalibrated())
+  {
+    return false;
+  }
+  std::unique_ptr<LidarFrameDetector> detector(this->Interpreter->CreateFrameDetector());
+  if (!detector)
+  {
+    return false;
+  }
+
+  // split the file at record boundaries
+  const std::string& fileName = this->FileNames.front();
+  vtkPacketFileReader reader;
+  if (!reader.Open(fileName, true, this->GetDestinationPort()))
+  {
+    return false;
+  }
+  const boost::uint64_t fileSize = reader.GetFileSize();
+  const size_t numberOfChunks =
+    std::min(static_cast<boost::uint64_t>(numberOfThreads), fileSize / MinimumChunkSize);
+  if (numberOfChunks < 2)
+  {
+    return false;
+  }
+  std::vector<IndexingChunk> chunks(numberOfChunks);
+  chunks[0].Begin = reader.GetFileOffset();
+  for (size_t i = 1; i < numberOfChunks; ++i)
+  {
+    if (!reader.FindRecordBoundary(fileSize / numberOfChunks * i, chunks[i].Begin) ||
+      chunks[i].Begin <= chunks[i - 1].Begin)
+    {
+      vtkDebugMacro(<< "Cannot split " << fileName << ", indexing it sequentially");
+      return false;
+    }
+    chunks[i - 1].End = chunks[i].Begin;
+  }
+  chunks.back().End = fileSize;
+  reader.Close();
+
+  PacketObserver* observer = this->GetDestinationPort() == 0 ? this->Internal->Observer : nullptr;
+  std::vector<std::unique_ptr<LidarFrameDetector> > detectors;
+  boost::thread_group threads;
+  for (size_t i = 0; i < numberOfChunks; ++i)
+  {
+    detectors.emplace_back(this->Interpreter->CreateFrameDetector());
+    threads.create_thread(
+      boost::bind(&IndexChunk, fileName, this->GetDestinationPort(), detectors.back().get(),
+        this->Interpreter, i == 0, observer != nullptr, &chunks[i]));
+  }
+  this->UpdateProgress(0.0);
+  threads.join_all();
+
+  for (size_t i = 0; i < numberOfChunks; ++i)
+  {
+    if (!chunks[i].Success || (i > 0 && chunks[i - 1].ReportedEnd != chunks[i].ReportedBegin))
+    {
+      vtkDebugMacro(<< "Chunks of " << fileName << " do not match, indexing it sequentially");
+      return false;
+    }
+  }
+
+  StitchChunks(
+    chunks.data(), chunks.size(), this->Interpreter->GetIgnoreEmptyFrames(), this->FilePositions);
+  std::vector<PacketAzimuthIndex::Packet> packets;
+  for (const IndexingChunk& chunk : chunks)
+  {
+    packets.insert(packets.end(), chunk.Packets.begin(), chunk.Packets.end());
+  }
+  if (!packets.empty())
+  {
+    this->Internal->PacketAzimuths.Build(packets, this->FilePositions);
+    double firstPacketTime = 0.;
+    if (GetFirstPacketUTCTime(fileName, this->Interpreter, firstPacketTime))
+    {
+      SetFrameSensorTimes(packets, firstPacketTime, this->FilePositions);
+    }
+    ComputeFrameQualities(packets, this->FilePositions);
+  }
+
+  // the other packets are a small part of the file, they are read again in order
+  if (observer && reader.Open(fileName, true))
+  {
+    const unsigned char* data = 0;
+    unsigned int dataLength = 0;
+    double timeSinceStart = 0;
+    observer->StartPackets(fileName);
+    for (const IndexingChunk& chunk : chunks)
+    {
+      for (boost::uint64_t position : chunk.OtherPackets)
+      {
+        reader.SetFileOffset(position);
+        if (reader.NextPacket(data, dataLength, timeSinceStart))
+        {
+          observer->ProcessPacket(data, dataLength, timeSinceStart);
+        }
+      }
+    }
+    observer->EndPackets(true);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::ReadSequenceFrameInformation()
+{
+  const size_t numberOfFiles = this->FileNames.size();
+  const std::string key = this->GetFrameIndexKey();
+  const unsigned short port = this->GetDestinationPort();
+  PacketObserver* observer = port == 0 ? this->Internal->Observer : nullptr;
+
+  // frame index of each file, with the offsets in this file
+  std::vector<std::vector<FramePosition> > filePositions(numberOfFiles);
+  size_t numberOfLoadedFiles = 0;
+  for (size_t i = 0; i < numberOfFiles && this->UseFrameIndexFile; ++i)
+  {
+    FrameIndexFile indexFile;
+    std::vector<unsigned char> streamCalibration;
+    if (indexFile.Read(this->FileNames[i], key, filePositions[i], streamCalibration))
+    {
+      numberOfLoadedFiles++;
+      if (!streamCalibration.empty())
+      {
+        this->Interpreter->SetStreamCalibration(streamCalibration);
+      }
+    }
+    else
+    {
+      filePositions[i].clear();
+    }
+  }
+
+  // the calibration contained in the stream can only be read sequentially
+  if (!this->Interpreter->GetIsCalibrated())
+  {
+    return false;
+  }
+  std::unique_ptr<LidarFrameDetector> seamDetector(this->Interpreter->CreateFrameDetector());
+  if (!seamDetector)
+  {
+    return false;
+  }
+
+  // the missing files are indexed concurrently, all of them if the observer needs the other
+  // packets as they are not stored in the sidecar files
+  const bool indexAllFiles = observer && numberOfLoadedFiles < numberOfFiles;
+  std::vector<std::unique_ptr<LidarFrameDetector> > detectors(numberOfFiles);
+  std::vector<LidarFrameDetector*> fileDetectors(numberOfFiles, nullptr);
+  size_t numberOfMissingFiles = 0;
+  for (size_t i = 0; i < numberOfFiles; ++i)
+  {
+    if (indexAllFiles || filePositions[i].empty())
+    {
+      detectors[i].reset(this->Interpreter->CreateFrameDetector());
+      fileDetectors[i] = detectors[i].get();
+      numberOfMissingFiles++;
+    }
+  }
+  std::vector<IndexingChunk> chunks(numberOfFiles);
+  if (numberOfMissingFiles > 0)
+  {
+    int numberOfThreads = this->NumberOfIndexingThreads;
+    if (numberOfThreads <= 0)
+    {
+      numberOfThreads = boost::thread::hardware_concurrency();
+    }
+    numberOfThreads =
+      std::max(1, std::min(numberOfThreads, static_cast<int>(numberOfMissingFiles)));
+    std::atomic<size_t> nextFile(0);
+    boost::thread_group threads;
+    for (int i = 0; i < numberOfThreads; ++i)
+    {
+      threads.create_thread(boost::bind(&IndexSequenceFiles, &this->FileNames, port,
+        &fileDetectors, observer != nullptr, &nextFile, &chunks));
+    }
+    this->UpdateProgress(0.0);
+    threads.join_all();
+  }
+
+  std::vector<unsigned char> streamCalibration;
+  this->Interpreter->GetStreamCalibration(streamCalibration);
+  const bool ignoreEmptyFrames = this->Interpreter->GetIgnoreEmptyFrames();
+  for (size_t i = 0; i < numberOfFiles; ++i)
+  {
+    if (!fileDetectors[i])
+    {
+      continue;
+    }
+    if (!chunks[i].Success)
+    {
+      vtkErrorMacro(<< "Failed to open packet file: " << this->FileNames[i]);
+      return false;
+    }
+    StitchChunks(&chunks[i], 1, ignoreEmptyFrames, filePositions[i]);
+    FrameIndexFile indexFile;
+    if (this->UseFrameIndexFile &&
+      !indexFile.Write(this->FileNames[i], key, filePositions[i], streamCalibration))
+    {
+      vtkDebugMacro(<< "Frame index not saved: " << indexFile.GetLastError());
+    }
+  }
+
+  // merge the frame indexes. The first frame of a file continues the last frame of the previous
+  // file, so it is dropped, and the frames starting around the seam are detected again
+  vtkPacketFileReader reader;
+  if (!reader.Open(this->FileNames, true, port))
+  {
+    vtkErrorMacro(<< "Failed to open packet file: " << this->FileName << endl
+                                          << reader.GetLastError());
+    return false;
+  }
+  this->FilePositions.clear();
+  for (size_t i = 0; i < numberOfFiles; ++i)
+  {
+    std::vector<FramePosition> positions = filePositions[i];
+    for (FramePosition& position : positions)
+    {
+      position.Position = vtkPacketFileReader::MakeSequenceOffset(i, position.Position);
+    }
+    if (positions.empty())
+    {
+      continue;
+    }
+    if (this->FilePositions.empty())
+    {
+      this->FilePositions = positions;
+      continue;
+    }
+
+    const boost::uint64_t seamEnd = positions.size() > 1 ?
+      positions[1].Position :
+      vtkPacketFileReader::MakeSequenceOffset(i + 1, 0);
+    DetectSeamSplits(&reader, seamDetector.get(), this->FilePositions.back().Position, seamEnd,
+      ignoreEmptyFrames, this->FilePositions);
+    this->FilePositions.insert(this->FilePositions.end(), positions.begin() + 1, positions.end());
+  }
+
+  // the other packets are read again in order through the sequence
+  if (indexAllFiles)
+  {
+    const unsigned char* data = 0;
+    unsigned int dataLength = 0;
+    double timeSinceStart = 0;
+    observer->StartPackets(this->FileName);
+    for (size_t i = 0; i < numberOfFiles; ++i)
+    {
+      for (boost::uint64_t position : chunks[i].OtherPackets)
+      {
+        reader.SetFileOffset(vtkPacketFileReader::MakeSequenceOffset(i, position));
+        if (reader.NextPacket(data, dataLength, timeSinceStart))
+        {
+          observer->ProcessPacket(data, dataLength, timeSinceStart);
+        }
+      }
+    }
+    observer->EndPackets(true);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::StartIncrementalIndexing()
+{
+  // the calibration contained in the stream can only be read by the interpreter
+  if (!this->Interpreter->GetIsCalibrated())
+  {
+    return false;
+  }
+  std::unique_ptr<LidarFrameDetector> detector(this->Interpreter->CreateFrameDetector());
+  if (!detector)
+  {
+    return false;
+  }
+
+  this->FilePositions.clear();
+  this->Internal->Indexing.reset(new IncrementalIndex);
+  IncrementalIndex* index = this->Internal->Indexing.get();
+  index->Detector = std::move(detector);
+  index->AzimuthSource = this->Interpreter->CreatePartitionDecoder();
+  if (this->GetDestinationPort() == 0)
+  {
+    index->Observer = this->Internal->Observer;
+  }
+  index->Thread = boost::thread(boost::bind(&IndexIncrementally, this->FileNames.front(),
+    this->UseMemoryMappedFile, this->GetDestinationPort(),
+    this->Interpreter->GetIgnoreEmptyFrames(), index));
+
+  // wait for something to display
+  {
+    boost::unique_lock<boost::mutex> lock(index->Mutex);
+    while (!index->Done && index->PendingPositions.size() < MinimumNumberOfIndexedFrames)
+    {
+      index->Condition.wait(lock);
+    }
+  }
+  this->AppendIndexedFrames();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::AppendIndexedFrames()
+{
+  IncrementalIndex* index = this->Internal->Indexing.get();
+  if (!index)
+  {
+    return false;
+  }
+
+  const size_t numberOfFrames = this->FilePositions.size();
+  bool done = false;
+  {
+    boost::lock_guard<boost::mutex> lock(index->Mutex);
+    this->FilePositions.insert(this->FilePositions.end(), index->PendingPositions.begin(),
+      index->PendingPositions.end());
+    index->PendingPositions.clear();
+    done = index->Done;
+  }
+
+  if (done)
+  {
+    index->Thread.join();
+    if (!index->Success)
+    {
+      vtkErrorMacro(<< "Failed to open packet file: " << this->FileName);
+    }
+    else
+    {
+      // same frame information as the sequential scan, see ReadFrameInformation
+      if (!index->Packets.empty())
+      {
+        this->Internal->PacketAzimuths.Build(index->Packets, this->FilePositions);
+        if (index->HasFirstPacketTime)
+        {
+          SetFrameSensorTimes(index->Packets, index->FirstPacketTime, this->FilePositions);
+        }
+        ComputeFrameQualities(index->Packets, this->FilePositions);
+      }
+      if (this->UseFrameIndexFile && index->AzimuthSource)
+      {
+        this->SaveFrameIndexFile();
+      }
+    }
+    this->Internal->Indexing.reset();
+  }
+  return this->FilePositions.size() > numberOfFrames;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::StopIncrementalIndexing()
+{
+  IncrementalIndex* index = this->Internal->Indexing.get();
+  if (!index)
+  {
+    return;
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(index->Mutex);
+    index->Stop = true;
+  }
+  index->Thread.join();
+  this->Internal->Indexing.reset();
+  // a partial index would never be completed
+  this->FilePositions.clear();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetPacketObserver(PacketObserver* observer)
+{
+  boost::lock_guard<boost::mutex> decodeLock(this->Internal->DecodeMutex);
+  this->Internal->Observer = observer;
+  IncrementalIndex* index = this->Internal->Indexing.get();
+  if (index)
+  {
+    // a new observer would miss the packets already read
+    boost::lock_guard<boost::mutex> lock(index->Mutex);
+    if (index->Observer != observer)
+    {
+      index->Observer = nullptr;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::GetIsIndexing()
+{
+  return this->Internal->Indexing != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::Poll()
+{
+  // the lock is not waited for while the prefetcher decodes a frame, so that polling never
+  // blocks, the next call does the work instead
+  boost::unique_lock<boost::mutex> lock(this->Internal->DecodeMutex, boost::try_to_lock);
+  if (!lock.owns_lock())
+  {
+    return;
+  }
+
+  const vtkMTimeType contentTime = this->GetFrameContentTime();
+  bool modified = this->AppendIndexedFrames();
+  vtkLidarReaderInternal* internal = this->Internal;
+  if (internal->PendingFrame >= 0 && this->Cache->Contains(internal->PendingFrame, contentTime))
+  {
+    internal->ReadyFrame = this->Cache->Get(internal->PendingFrame, contentTime);
+    internal->ReadyFrameNumber = internal->PendingFrame;
+    internal->PendingFrame = -1;
+    modified = true;
+  }
+  if (!modified)
+  {
+    return;
+  }
+
+  // the new time steps are published by RequestInformation, and the frame decoded in the
+  // background is given by the next RequestData, so the reader must be modified.
+  // The frames already decoded have not changed, keep using them.
+  this->Modified();
+  internal->IndexModifiedTime = this->GetMTime();
+  internal->FrameContentTime = contentTime;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetAsynchronousUpdate(bool asynchronous)
+{
+  // this does not change the output, so the reader is not modified
+  this->AsynchronousUpdate = asynchronous;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::GetIsFramePending()
+{
+  return this->Internal->PendingFrame >= 0;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetScrubbing(bool scrubbing)
+{
+  if (this->Scrubbing == scrubbing)
+  {
+    return;
+  }
+  this->Scrubbing = scrubbing;
+  if (scrubbing)
+  {
+    return;
+  }
+
+  this->Internal->PreviewReader.Close();
+  if (!this->Internal->IsPreview)
+  {
+    return;
+  }
+
+  // the next RequestData gives the full frame, the frames already decoded have not changed
+  const vtkMTimeType contentTime = this->GetFrameContentTime();
+  this->Modified();
+  this->Internal->IndexModifiedTime = this->GetMTime();
+  this->Internal->FrameContentTime = contentTime;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetPreviewDecimation(int decimation)
+{
+  // the preview shown is kept until the next update, so the reader is not modified
+  this->PreviewDecimation = std::max(1, decimation);
+  this->Internal->PreviewDecoder = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::GetIsPreview()
+{
+  return this->Internal->IsPreview;
+}
+
+//-----------------------------------------------------------------------------
+vtkMTimeType vtkLidarReader::GetFrameContentTime()
+{
+  const vtkMTimeType time = this->GetMTime();
+  return time == this->Internal->IndexModifiedTime ? this->Internal->FrameContentTime : time;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarReader::ReadFrameInformation()
+{
+  this->Internal->PacketAzimuths.Clear();
+
+  // the sidecar files, the incremental indexing and the split of a file in chunks are about
+  // a single file, a sequence is indexed file by file
+  const bool isSequence = this->FileNames.size() > 1;
+  if (isSequence)
+  {
+    if (this->ReadSequenceFrameInformation())
+    {
+      return this->GetNumberOfFrames();
+    }
+  }
+  else
+  {
+    if (this->UseFrameIndexFile && this->LoadFrameIndexFile())
+    {
+      return this->GetNumberOfFrames();
+    }
+
+    if (this->IncrementalIndexing && this->StartIncrementalIndexing())
+    {
+      return this->GetNumberOfFrames();
+    }
+
+    if (this->ReadFrameInformationInParallel())
+    {
+      if (this->UseFrameIndexFile)
+      {
+        this->SaveFrameIndexFile();
+      }
+      return this->GetNumberOfFrames();
+    }
+  }
+
+  vtkPacketFileReader reader;
+  if (!reader.Open(this->FileNames, this->UseMemoryMappedFile, this->GetDestinationPort()))
+  {
+    vtkErrorMacro(<< "Failed to open packet file: " << this->FileName << endl
+                                          << reader.GetLastError());
+    return 0;
+  }
+
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  bool isNewFrame = false;
+  int framePositionInPacket = 0;
+  double timeSinceStart = 0;
+
+  this->FilePositions.clear();
+  this->Interpreter->ResetPreProcessing();
+  boost::uint64_t lastFilePosition = reader.GetFileOffset();
+  bool firstIteration = true;
+  std::vector<PacketAzimuthIndex::Packet> packets;
+  PacketObserver* observer = this->GetDestinationPort() == 0 ? this->Internal->Observer : nullptr;
+  if (observer)
+  {
+    observer->StartPackets(this->FileName);
+  }
+
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    // This command sends a signal that can be observed from outside
+    // and that is used to diplay a Qt progress dialog from Python
+    // This progress dialog is not displaying a progress percentage,
+    // thus it is ok to pass 0.0
+    this->UpdateProgress(0.0);
+
+
+    if (!this->Interpreter->IsLidarPacket(data, dataLength))
+    {
+      if (observer)
+      {
+        observer->ProcessPacket(data, dataLength, timeSinceStart);
+      }
+      lastFilePosition = reader.GetFileOffset();
+      continue;
+    }
+
+    // add an index for the first Lidar packet
+    if (firstIteration)
+    {
+      // it is possible that the first packet contains 2 frames
+      // (end and start of one), and as we rely on the packet header time
+      // this 2 frames will have the same timestep. So to avoid that we
+      // artificatially move the first timeStep back by one.
+      FramePosition newPosition(lastFilePosition, 0, timeSinceStart-1);
+      this->FilePositions.push_back(newPosition);
+      firstIteration = false;
+    }
+
+    // check if the packet content indicate a new frame should be created
+    this->Interpreter->PreProcessPacket(data, dataLength, isNewFrame, framePositionInPacket);
+    if (isNewFrame)
+    {
+      FramePosition newPosition(lastFilePosition,framePositionInPacket, timeSinceStart);
+      this->FilePositions.push_back(newPosition);
+    }
+
+    PacketAzimuthIndex::Packet packet = { lastFilePosition, 0., 0. };
+    if (GetPacketRanges(this->Interpreter, data, dataLength, packet))
+    {
+      packets.push_back(packet);
+    }
+
+    lastFilePosition = reader.GetFileOffset();
+  }
+  if (observer)
+  {
+    observer->EndPackets(true);
+  }
+  if (!packets.empty())
+  {
+    this->Internal->PacketAzimuths.Build(packets, this->FilePositions);
+    double firstPacketTime = 0.;
+    if (GetFirstPacketUTCTime(this->FileNames.front(), this->Interpreter, firstPacketTime))
+    {
+      SetFrameSensorTimes(packets, firstPacketTime, this->FilePositions);
+    }
+    ComputeFrameQualities(packets, this->FilePositions);
+  }
+
+  if (!this->Interpreter->GetIsCalibrated())
+  {
+    vtkErrorMacro( << "The calibration could not be loaded from the pcap file");
+  }
+  else if (this->UseFrameIndexFile && !isSequence)
+  {
+    this->SaveFrameIndexFile();
+  }
+  return this->GetNumberOfFrames();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetTimestepInformation(vtkInformation *info)
+{
+  size_t numberOfTimesteps = this->FilePositions.size();
+  std::vector<double> timesteps(numberOfTimesteps);
+  double timeOffset = this->GetInterpreter()->GetTimeOffset();
+  for (size_t i = 0; i < numberOfTimesteps; ++i)
+  {
+    timesteps[i] = this->FilePositions[i].Time + timeOffset;
+  }
+
+  if (this->FilePositions.size())
+  {
+    double* firstTimestepPointer = &timesteps.front();
+    double* lastTimestepPointer = &timesteps.back();
+    // Remove the first and last frame timestep
+    // in case you have less that 3 timstep we will still show the partial
+    // frame to avoid showing nothing
+    if (!this->ShowFirstAndLastFrame && numberOfTimesteps >= 3)
+    {
+      firstTimestepPointer++;
+      lastTimestepPointer--;
+      numberOfTimesteps -= 2;
+
+    }
+    double timeRange[2] = { *firstTimestepPointer, *lastTimestepPointer };
+    // In order to avoid to display
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), firstTimestepPointer, numberOfTimesteps);
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+  }
+  else
+  {
+    info->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    info->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+  }
+}
+
+vtkStandardNewMacro(vtkLidarReader)
+vtkInformationKeyMacro(vtkLidarReader, UPDATE_TIME_STEPS, DoubleVector);
+
+//-----------------------------------------------------------------------------
+vtkLidarReader::vtkLidarReader()
+  : Cache(new FrameCache)
+  , Internal(new vtkLidarReaderInternal)
+{
+  this->Cache->SetMemoryBudget(DefaultFrameCacheSize * 1024);
+  this->Internal->RawFrames.SetMemoryBudget(DefaultRawFrameCacheSize * 1024);
+
+  // the caches are released by MemoryAccounting::Enforce, unless a frame is being decoded
+  vtkLidarReaderInternal* internal = this->Internal;
+  FrameCache* cache = this->Cache;
+  cache->GetMemoryAccount().SetReleaser(MemoryAccounting::DECODED_DATA_PRIORITY,
+    [internal, cache](unsigned long kibibytes) {
+      boost::unique_lock<boost::mutex> lock(internal->DecodeMutex, boost::try_to_lock);
+      if (lock.owns_lock())
+      {
+        cache->Release(kibibytes);
+      }
+    });
+  internal->RawFrames.GetMemoryAccount().SetReleaser(MemoryAccounting::FILE_DATA_PRIORITY,
+    [internal](unsigned long kibibytes) {
+      boost::unique_lock<boost::mutex> lock(internal->DecodeMutex, boost::try_to_lock);
+      if (lock.owns_lock())
+      {
+        internal->RawFrames.Release(kibibytes);
+      }
+    });
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarReader::~vtkLidarReader()
+{
+  this->Cache->GetMemoryAccount().SetReleaser(0, nullptr);
+  this->Internal->RawFrames.GetMemoryAccount().SetReleaser(0, nullptr);
+  // stop the threads first, they use everything else
+  this->StopIncrementalIndexing();
+  this->Internal->Prefetcher.reset();
+  this->Close();
+  delete this->Cache;
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetFileName(const std::string &filename)
+{
+  if (filename == this->FileName)
+  {
+    return;
+  }
+
+  this->FileName = filename;
+  this->FileNames.clear();
+  if (filename.find_first_of("*?[") == std::string::npos)
+  {
+    if (!filename.empty())
+    {
+      this->FileNames.push_back(filename);
+    }
+  }
+  else
+  {
+    // the files split by a logger are numbered, so their names give the chronological order
+    vtksys::Glob glob;
+    glob.FindFiles(filename);
+    this->FileNames = glob.GetFiles();
+    std::sort(this->FileNames.begin(), this->FileNames.end());
+    if (this->FileNames.empty())
+    {
+      vtkErrorMacro(<< "No file matches " << filename);
+    }
+  }
+  this->ResetFiles();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::AddFileName(const std::string& filename)
+{
+  if (this->FileNames.empty())
+  {
+    this->FileName = filename;
+  }
+  this->FileNames.push_back(filename);
+  this->ResetFiles();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::ResetFiles()
+{
+  this->CancelPrefetch();
+  this->StopIncrementalIndexing();
+  this->FilePositions.clear();
+  this->Internal->PacketAzimuths.Clear();
+  this->Cache->Clear();
+  this->Internal->RawFrames.Clear();
+  this->Internal->UnfilteredFrame = nullptr;
+  this->Internal->DecodedFrames.Close();
+  this->Modified();
+}
 
 //-----------------------------------------------------------------------------
-int vtkLidarReader::ReadFrameInformation()
+std::string vtkLidarReader::DetectInterpreterName()
 {
   vtkPacketFileReader reader;
-  if (!reader.Open(this->FileName))
+  if (!reader.Open(this->FileNames, this->UseMemoryMappedFile, this->GetDestinationPort()))
   {
     vtkErrorMacro(<< "Failed to open packet file: " << this->FileName << endl
                                           << reader.GetLastError());
+    return std::string();
+  }
+
+  // the other packets of the sensor, like the position packets, are not recognized
+  const int maximumNumberOfPackets = 1000;
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  LidarInterpreterRegistry& registry = LidarInterpreterRegistry::GetInstance();
+  for (int i = 0; i < maximumNumberOfPackets && reader.NextPacket(data, dataLength, timeSinceStart);
+       ++i)
+  {
+    const std::string name = registry.Detect(data, dataLength);
+    if (!name.empty())
+    {
+      return name;
+    }
+  }
+  return std::string();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetLidarPort(int port)
+{
+  if (port == this->LidarPort)
+  {
+    return;
+  }
+
+  // the frame index only contains the packets sent to this port
+  this->CancelPrefetch();
+  this->StopIncrementalIndexing();
+  this->LidarPort = port;
+  this->FilePositions.clear();
+  this->Cache->Clear();
+  this->Internal->RawFrames.Clear();
+  this->Internal->UnfilteredFrame = nullptr;
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+unsigned short vtkLidarReader::GetDestinationPort()
+{
+  const bool isValid = this->LidarPort > 0 && this->LidarPort <= 65535;
+  return isValid ? static_cast<unsigned short>(this->LidarPort) : 0;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarReader::GetFrame(int frameNumber)
+{
+  VV_TRACE_SCOPE("vtkLidarReader::GetFrame");
+  boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+
+  // the frame content depends on the interpreter and reader settings
+  const vtkMTimeType time = this->GetFrameContentTime();
+  vtkSmartPointer<vtkPolyData> frame = this->Cache->Get(frameNumber, time);
+  if (frame)
+  {
+    return frame;
+  }
+
+  // the decoded frames are not cached, they are already in memory
+  if (this->UseDecodedFrameFile)
+  {
+    frame = this->ReadDecodedFrame(frameNumber, time);
+    if (frame)
+    {
+      return frame;
+    }
+  }
+
+  if (!this->Reader)
+  {
+    vtkErrorMacro("GetFrame() called but packet file reader is not open.");
+    return 0;
+  }
+  if (!this->Interpreter->GetIsCalibrated())
+  {
+    vtkErrorMacro("Corrections have not been set");
     return 0;
   }
 
+  frame = this->DecodeFrame(this->Reader, frameNumber);
+  this->Cache->Add(frameNumber, time, frame);
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarReader::GetFrame(
+  int frameNumber, double azimuthMin, double azimuthMax)
+{
+  VV_TRACE_SCOPE("vtkLidarReader::GetFrame sector");
+  // a full turn is the whole frame, which may already be cached
+  if (azimuthMax - azimuthMin >= 360. || !this->Reader || !this->Interpreter ||
+    frameNumber < 0 || frameNumber >= this->GetNumberOfFrames())
+  {
+    return this->GetFrame(frameNumber);
+  }
+
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+    if (!this->Interpreter->GetIsCalibrated())
+    {
+      vtkErrorMacro("Corrections have not been set");
+      return 0;
+    }
+    std::vector<boost::uint64_t> packets;
+    if (this->IndexFramePackets(this->Reader, frameNumber) &&
+      this->Internal->PacketAzimuths.GetSectorPackets(frameNumber, azimuthMin, azimuthMax,
+        this->Interpreter->GetMaximumAzimuthCorrection(), packets))
+    {
+      return this->DecodeSelectedPackets(this->Reader, frameNumber, packets);
+    }
+  }
+
+  // without the azimuths of the packets the whole frame is decoded
+  return this->GetFrame(frameNumber);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::IndexFramePackets(vtkPacketFileReader* reader, int frameNumber)
+{
+  PacketAzimuthIndex& index = this->Internal->PacketAzimuths;
+  if (index.HasFrame(frameNumber))
+  {
+    return true;
+  }
+
+  // the packets are only read, from the first one of the frame to the first one of the next
+  const boost::uint64_t end = frameNumber + 1 < this->GetNumberOfFrames() ?
+    this->FilePositions[frameNumber + 1].Position :
+    std::numeric_limits<boost::uint64_t>::max();
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  std::vector<PacketAzimuthIndex::Packet> packets;
+  reader->SetFileOffset(this->FilePositions[frameNumber].Position);
+  boost::uint64_t position = reader->GetFileOffset();
+  while (position <= end && reader->NextPacket(data, dataLength, timeSinceStart))
+  {
+    PacketAzimuthIndex::Packet packet = { position, 0., 0. };
+    position = reader->GetFileOffset();
+    if (!this->Interpreter->IsLidarPacket(data, dataLength))
+    {
+      continue;
+    }
+    if (!GetPacketRanges(this->Interpreter, data, dataLength, packet))
+    {
+      return false;
+    }
+    packets.push_back(packet);
+  }
+  index.SetFramePackets(frameNumber, packets);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkTable> vtkLidarReader::GetFrameQualities()
+{
+  const vtkIdType numberOfFrames = static_cast<vtkIdType>(this->FilePositions.size());
+  auto times = vtkSmartPointer<vtkDoubleArray>::New();
+  times->SetName("time");
+  auto packets = vtkSmartPointer<vtkIntArray>::New();
+  packets->SetName("packets");
+  auto coverages = vtkSmartPointer<vtkDoubleArray>::New();
+  coverages->SetName("azimuth_coverage");
+  auto missing = vtkSmartPointer<vtkIntArray>::New();
+  missing->SetName("missing_packets");
+  auto duplicates = vtkSmartPointer<vtkIntArray>::New();
+  duplicates->SetName("duplicate_packets");
+  auto gaps = vtkSmartPointer<vtkDoubleArray>::New();
+  gaps->SetName("largest_time_gap");
+  auto damaged = vtkSmartPointer<vtkIntArray>::New();
+  damaged->SetName("damaged");
+  vtkDataArray* arrays[] = { times, packets, coverages, missing, duplicates, gaps, damaged };
+  for (vtkDataArray* array : arrays)
+  {
+    array->SetNumberOfTuples(numberOfFrames);
+  }
+
+  // the times are the time steps of the frames
+  const double timeOffset = this->Interpreter ? this->Interpreter->GetTimeOffset() : 0.;
+  for (vtkIdType i = 0; i < numberOfFrames; ++i)
+  {
+    const FramePosition& position = this->FilePositions[i];
+    times->SetValue(i, position.Time + timeOffset);
+    packets->SetValue(i, position.NumberOfPackets);
+    coverages->SetValue(i, position.AzimuthCoverage);
+    missing->SetValue(i, position.NumberOfMissingPackets);
+    duplicates->SetValue(i, position.NumberOfDuplicatePackets);
+    gaps->SetValue(i, position.LargestTimeGap);
+    damaged->SetValue(i, this->GetIsFrameDamaged(static_cast<int>(i)));
+  }
+
+  auto table = vtkSmartPointer<vtkTable>::New();
+  for (vtkDataArray* array : arrays)
+  {
+    table->AddColumn(array);
+  }
+  return table;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::GetIsFrameDamaged(int frameNumber, double minimumCoverage)
+{
+  if (frameNumber < 0 || frameNumber >= this->GetNumberOfFrames())
+  {
+    return false;
+  }
+  return IsFrameDamaged(this->FilePositions[frameNumber], minimumCoverage);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::GetFrameForUTCTime(double time, int& frameNumber, int& packetOffset)
+{
+  frameNumber = -1;
+  packetOffset = -1;
+  // the last frame starting before the time
+  auto next = std::upper_bound(this->FilePositions.begin(), this->FilePositions.end(), time,
+    [](double t, const FramePosition& position) { return t < position.FirstSensorTime; });
+  if (next == this->FilePositions.begin())
+  {
+    return false;
+  }
+  const FramePosition& position = *(next - 1);
+  if (std::isnan(position.FirstSensorTime) || !(time <= position.LastSensorTime))
+  {
+    return false;
+  }
+  frameNumber = static_cast<int>(std::distance(this->FilePositions.begin(), next) - 1);
+
+  std::vector<PacketAzimuthIndex::Packet> packets;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+    this->Internal->PacketAzimuths.GetFramePackets(frameNumber, packets);
+  }
+  if (packets.empty() || std::isnan(packets.front().SensorTime))
+  {
+    return true;
+  }
+  // the last packet measured before the time, the sensor times wrapping every hour
+  const double elapsed = time - position.FirstSensorTime;
+  packetOffset = 0;
+  for (size_t i = 1; i < packets.size(); ++i)
+  {
+    double packetElapsed = packets[i].SensorTime - packets.front().SensorTime;
+    packetElapsed += packetElapsed < -Hour / 2. ? Hour : 0.;
+    if (packetElapsed > elapsed)
+    {
+      break;
+    }
+    packetOffset = std::isnan(packetElapsed) ? packetOffset : static_cast<int>(i);
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::GetCropPackets(int frameNumber, std::vector<boost::uint64_t>& positions)
+{
+  positions.clear();
+  std::vector<PacketAzimuthIndex::Packet> packets;
+  if (this->Interpreter->GetCropMode() == vtkLidarPacketInterpreter::CROP_MODE::None ||
+    !this->Internal->PacketAzimuths.GetFramePackets(frameNumber, packets))
+  {
+    return false;
+  }
+  const bool keepZeroDistances = !this->Interpreter->GetIgnoreZeroDistances();
+  for (const PacketAzimuthIndex::Packet& packet : packets)
+  {
+    if (!packet.HasDistances)
+    {
+      return false;
+    }
+    // the returns without distance are near the sensor
+    double minDistance = packet.MinDistance;
+    double maxDistance = packet.MaxDistance;
+    if (keepZeroDistances && packet.HasZeroDistance)
+    {
+      minDistance = 0.;
+      maxDistance = std::max(maxDistance, 0.);
+    }
+    if (!this->Interpreter->IsPacketCroppedOut(
+          packet.FirstAzimuth, packet.LastAzimuth, minDistance, maxDistance))
+    {
+      positions.push_back(packet.Position);
+    }
+  }
+  return positions.size() < packets.size();
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarReader::DecodeSelectedPackets(vtkPacketFileReader* reader,
+  int frameNumber, const std::vector<boost::uint64_t>& packets)
+{
+  // the packets are decoded in file order, the last one may be the one where the next
+  // frame starts, which splits the frame
   const unsigned char* data = 0;
   unsigned int dataLength = 0;
-  bool isNewFrame = false;
-  int framePositionInPacket = 0;
   double timeSinceStart = 0;
+  const FramePosition& position = this->FilePositions[frameNumber];
+  this->Interpreter->ResetCurrentFrame();
+  for (size_t i = 0; i < packets.size() && !this->Interpreter->IsNewFrameReady(); ++i)
+  {
+    reader->SetFileOffset(packets[i]);
+    if (!reader->NextPacket(data, dataLength, timeSinceStart))
+    {
+      break;
+    }
+    this->Interpreter->ProcessPacket(
+      data, dataLength, packets[i] == position.Position ? position.Skip : 0);
+  }
+  if (!this->Interpreter->IsNewFrameReady())
+  {
+    this->Interpreter->SplitFrame(true);
+  }
+  return this->Interpreter->GetLastFrameAvailable();
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarReader::DecodeFrame(vtkPacketFileReader* reader, int frameNumber)
+{
+  // the frame shown is decoded again when the crop or the laser selection are tuned on it
+  if (frameNumber == this->Internal->LastFrameNumber)
+  {
+    vtkSmartPointer<vtkPolyData> frame = this->DecodeFilteredFrame(reader, frameNumber);
+    if (frame)
+    {
+      return frame;
+    }
+  }
+
+  // the packets whose returns are all removed by the crop are not read
+  std::vector<boost::uint64_t> packets;
+  if (this->GetCropPackets(frameNumber, packets))
+  {
+    return this->DecodeSelectedPackets(reader, frameNumber, packets);
+  }
+
+  this->Interpreter->ResetCurrentFrame();
+
+  int firstFramePositionInPacket = this->FilePositions[frameNumber].Skip;
+
+  reader->SetFileOffset(this->FilePositions[frameNumber].Position);
+
+  // the packets before the one where the next frame starts are decoded from memory, then the
+  // decoding goes on from the file
+  std::shared_ptr<const RawFrame> packets = this->GetRawFrame(reader, frameNumber);
+  if (packets && !this->DecodePacketsInParallel(*packets, frameNumber, firstFramePositionInPacket))
+  {
+    const std::vector<size_t>& offsets = packets->Offsets;
+    for (size_t i = 0; i < packets->GetNumberOfPackets(); ++i)
+    {
+      this->Interpreter->ProcessPacket(&packets->Data[offsets[i]],
+        static_cast<unsigned int>(offsets[i + 1] - offsets[i]), firstFramePositionInPacket);
+      if (this->Interpreter->IsNewFrameReady())
+      {
+        return this->Interpreter->GetLastFrameAvailable();
+      }
+      firstFramePositionInPacket = 0;
+    }
+  }
+  return DecodeFramePackets(this->Interpreter, reader, firstFramePositionInPacket);
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarReader::DecodeFilteredFrame(
+  vtkPacketFileReader* reader, int frameNumber)
+{
+  VV_TRACE_SCOPE("vtkLidarReader::DecodeFilteredFrame");
+  vtkSmartPointer<vtkLidarPacketInterpreter> decoder =
+    this->Interpreter->CreateUnfilteredDecoder();
+  if (!decoder)
+  {
+    return nullptr;
+  }
+
+  // the frame without the filters is only decoded again when the other settings change
+  vtkLidarReaderInternal* internal = this->Internal;
+  const std::string key = this->GetFrameIndexKey() + " " + decoder->GetDecodingKey();
+  if (!internal->UnfilteredFrame || internal->UnfilteredFrameNumber != frameNumber ||
+    internal->UnfilteredFrameKey != key)
+  {
+    const FramePosition& position = this->FilePositions[frameNumber];
+    decoder->ResetCurrentFrame();
+    reader->SetFileOffset(position.Position);
+    internal->UnfilteredFrame = DecodeFramePackets(decoder, reader, position.Skip);
+    internal->UnfilteredFrameNumber = frameNumber;
+    internal->UnfilteredFrameKey = key;
+  }
+  return this->Interpreter->FilterFrame(internal->UnfilteredFrame);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::GetFrames(int firstFrame, int lastFrame, const FrameCallback& callback)
+{
+  firstFrame = std::max(firstFrame, 0);
+  lastFrame = std::min(lastFrame, this->GetNumberOfFrames() - 1);
+  if (firstFrame > lastFrame)
+  {
+    return true;
+  }
+  if (this->FileNames.empty() || !this->Interpreter->GetIsCalibrated())
+  {
+    vtkErrorMacro("GetFrames() called but the reader has no calibrated file.");
+    return false;
+  }
+
+  int numberOfThreads = this->NumberOfDecodingThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = ThreadTopology::GetPoolSize(ThreadTopology::DECODE);
+  }
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = boost::thread::hardware_concurrency();
+  }
+  numberOfThreads = std::min(numberOfThreads, lastFrame - firstFrame + 1);
+
+  // the threads do not use the interpreter and the frame index, which the prefetcher and Poll
+  // may change, they use copies made before they start
+  FrameBatch batch;
+  std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> > decoders;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+    for (int i = 0; i < numberOfThreads && numberOfThreads > 1; ++i)
+    {
+      vtkSmartPointer<vtkLidarPacketInterpreter> decoder =
+        this->Interpreter->CreatePartitionDecoder();
+      if (!decoder)
+      {
+        decoders.clear();
+        break;
+      }
+      decoders.push_back(decoder);
+    }
+    batch.Positions.assign(
+      this->FilePositions.begin() + firstFrame, this->FilePositions.begin() + lastFrame + 1);
+    if (lastFrame + 1 < this->GetNumberOfFrames())
+    {
+      batch.EndPosition = this->FilePositions[lastFrame + 1].Position;
+    }
+  }
+
+  if (decoders.empty())
+  {
+    const bool wasOpen = this->Reader != nullptr;
+    if (!wasOpen)
+    {
+      this->Open();
+    }
+    bool success = true;
+    for (int frame = firstFrame; frame <= lastFrame && success; ++frame)
+    {
+      success = callback(frame, this->GetFrame(frame));
+    }
+    if (!wasOpen)
+    {
+      this->Close();
+    }
+    return success;
+  }
+
+  batch.FileNames = this->FileNames;
+  batch.UseMemoryMappedFile = this->UseMemoryMappedFile;
+  batch.Port = this->GetDestinationPort();
+  batch.MaximumPendingFrames = 2 * decoders.size();
+  batch.RunningThreads = static_cast<int>(decoders.size());
+
+  boost::thread_group threads;
+  for (size_t i = 0; i < decoders.size(); ++i)
+  {
+    threads.create_thread(boost::bind(&DecodeBatchFrames, &batch, decoders[i].GetPointer()));
+  }
+
+  bool success = true;
+  const size_t numberOfFrames = batch.Positions.size();
+  boost::unique_lock<boost::mutex> lock(batch.Mutex);
+  while (batch.NextDelivery < numberOfFrames)
+  {
+    auto it = batch.DecodedFrames.find(batch.NextDelivery);
+    if (it == batch.DecodedFrames.end())
+    {
+      if (batch.RunningThreads == 0)
+      {
+        vtkErrorMacro("Cannot open " << this->FileName << " to decode the frames.");
+        success = false;
+        break;
+      }
+      batch.FrameDecoded.wait(lock);
+      continue;
+    }
+    vtkSmartPointer<vtkPolyData> polyData = it->second;
+    batch.DecodedFrames.erase(it);
+    const int frame = firstFrame + static_cast<int>(batch.NextDelivery);
+    batch.NextDelivery++;
+    batch.FrameDelivered.notify_all();
+
+    lock.unlock();
+    success = callback(frame, polyData);
+    lock.lock();
+    if (!success)
+    {
+      break;
+    }
+  }
+  batch.Stop = true;
+  batch.FrameDelivered.notify_all();
+  lock.unlock();
+  threads.join_all();
+  return success;
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<const RawFrame> vtkLidarReader::GetRawFrame(
+  vtkPacketFileReader* reader, int frameNumber)
+{
+  // the packet where the next frame starts also ends this one, it is decoded from the file
+  if (frameNumber + 1 >= this->GetNumberOfFrames())
+  {
+    return nullptr;
+  }
+  RawFrameCache& cache = this->Internal->RawFrames;
+  const bool isCached = cache.GetMemoryBudget() > 0;
+  if (!isCached && GetNumberOfDecodingThreads(this->NumberOfDecodingThreads) < 2)
+  {
+    return nullptr;
+  }
+
+  // the packets do not depend on the decoding settings, only on where the frames start
+  const boost::uint64_t framePosition = this->FilePositions[frameNumber].Position;
+  const boost::uint64_t nextFramePosition = this->FilePositions[frameNumber + 1].Position;
+  const std::string key = this->GetFrameIndexKey();
+  if (isCached)
+  {
+    std::shared_ptr<const RawFrame> cached = cache.Get(frameNumber, key);
+    if (cached && cached->Position == framePosition && cached->EndPosition == nextFramePosition)
+    {
+      reader->SetFileOffset(nextFramePosition);
+      return cached;
+    }
+  }
+
+  // gather the lidar packets, the readers only keep the last packet available
+  std::shared_ptr<RawFrame> frame =
+    isCached ? std::make_shared<RawFrame>() : this->Internal->Packets;
+  frame->Position = framePosition;
+  frame->EndPosition = nextFramePosition;
+  frame->Data.clear();
+  frame->Offsets.assign(1, 0);
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart;
+  boost::uint64_t splitPosition = framePosition;
+  while (splitPosition < nextFramePosition && reader->NextPacket(data, dataLength, timeSinceStart))
+  {
+    if (this->Interpreter->IsLidarPacket(data, dataLength))
+    {
+      frame->Data.insert(frame->Data.end(), data, data + dataLength);
+      frame->Offsets.push_back(frame->Data.size());
+    }
+    splitPosition = reader->GetFileOffset();
+  }
+
+  // a frame cut by a read error is not kept
+  if (isCached && splitPosition >= nextFramePosition)
+  {
+    frame->Data.shrink_to_fit();
+    frame->Offsets.shrink_to_fit();
+    cache.Add(frameNumber, key, frame);
+  }
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::DecodePacketsInParallel(
+  const RawFrame& packets, int frameNumber, int& firstFramePositionInPacket)
+{
+  const int numberOfThreads = GetNumberOfDecodingThreads(this->NumberOfDecodingThreads);
+  if (numberOfThreads < 2)
+  {
+    return false;
+  }
+  const size_t numberOfPackets = packets.GetNumberOfPackets();
+  const size_t numberOfPartitions = std::min(
+    static_cast<size_t>(numberOfThreads), numberOfPackets / MinimumPacketsPerPartition);
+  if (numberOfPartitions < 2)
+  {
+    return false;
+  }
+
+  // the decoders copy the settings of the interpreter when they are created
+  std::vector<vtkSmartPointer<vtkLidarPacketInterpreter> >& decoders =
+    this->Internal->PartitionDecoders;
+  const vtkMTimeType time = this->GetFrameContentTime();
+  if (time != this->Internal->PartitionDecodersTime)
+  {
+    decoders.clear();
+    this->Internal->PartitionDecodersTime = time;
+  }
+  if (!this->Interpreter->ProcessPacketsInParallel(packets.Data.data(), packets.Offsets,
+        firstFramePositionInPacket, numberOfPartitions, decoders))
+  {
+    vtkDebugMacro(<< "Frame " << frameNumber << " cannot be decoded in parallel");
+    return false;
+  }
+  firstFramePositionInPacket = 0;
+  return true;
+}
 
-  this->FilePositions.clear();
-  fpos_t lastFilePosition;
-  reader.GetFilePosition(&lastFilePosition);
-  bool firstIteration = true;
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetNumberOfDecodingThreads(int numberOfThreads)
+{
+  // this does not change the output, so the reader is not modified
+  this->NumberOfDecodingThreads = std::max(numberOfThreads, 0);
+}
 
-  while (reader.NextPacket(data, dataLength, timeSinceStart))
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetPrefetchFrames(int numberOfFrames)
+{
+  // this does not change the output, so the reader is not modified
+  this->PrefetchFrames = std::max(numberOfFrames, 0);
+  if (this->PrefetchFrames == 0 && this->Internal->PendingFrame < 0)
   {
-    // This command sends a signal that can be observed from outside
-    // and that is used to diplay a Qt progress dialog from Python
-    // This progress dialog is not displaying a progress percentage,
-    // thus it is ok to pass 0.0
-    this->UpdateProgress(0.0);
+    this->CancelPrefetch();
+  }
+}
 
+//-----------------------------------------------------------------------------
+bool vtkLidarReader::SchedulePrefetch(int frameNumber, unsigned long frameSize)
+{
+  vtkLidarReaderInternal* internal = this->Internal;
+  const int pending = internal->PendingFrame;
+  if ((this->PrefetchFrames <= 0 && pending < 0) || this->Cache->GetMemoryBudget() == 0)
+  {
+    return false;
+  }
 
-    if (!this->Interpreter->IsLidarPacket(data, dataLength))
+  // the prefetcher never uses the interpreter, whose settings are changed by this thread
+  {
+    const vtkMTimeType time = this->GetFrameContentTime();
+    boost::lock_guard<boost::mutex> lock(internal->PrefetchDecoderMutex);
+    if (!internal->PrefetchDecoder || internal->PrefetchDecoderTime != time)
     {
-      reader.GetFilePosition(&lastFilePosition);
-      continue;
+      internal->PrefetchDecoder = this->Interpreter->CreatePartitionDecoder();
+      internal->PrefetchDecoderTime = time;
     }
-
-    // add an index for the first Lidar packet
-    if (firstIteration)
+    if (!internal->PrefetchDecoder)
     {
-      // it is possible that the first packet contains 2 frames
-      // (end and start of one), and as we rely on the packet header time
-      // this 2 frames will have the same timestep. So to avoid that we
-      // artificatially move the first timeStep back by one.
-      FramePosition newPosition(lastFilePosition, 0, timeSinceStart-1);
-      this->FilePositions.push_back(newPosition);
-      firstIteration = false;
+      return false;
     }
+  }
 
-    // check if the packet content indicate a new frame should be created
-    this->Interpreter->PreProcessPacket(data, dataLength, isNewFrame, framePositionInPacket);
-    if (isNewFrame)
+  // keep half of the cache for the frames already visited
+  const unsigned long budget = this->Cache->GetMemoryBudget() / 2;
+  std::vector<int> frames;
+  if (pending >= 0)
+  {
+    frames.push_back(pending);
+  }
+  for (int i = 1; i <= this->PrefetchFrames && (i + 1) * frameSize <= budget; ++i)
+  {
+    const int frame = frameNumber + this->PrefetchDirection * i;
+    if (frame < 0 || frame >= this->GetNumberOfFrames())
     {
-      FramePosition newPosition(lastFilePosition,framePositionInPacket, timeSinceStart);
-      this->FilePositions.push_back(newPosition);
+      break;
     }
-
-    reader.GetFilePosition(&lastFilePosition);
+    frames.push_back(frame);
   }
 
-  if (!this->Interpreter->GetIsCalibrated())
+  if (!internal->Prefetcher)
   {
-    vtkErrorMacro( << "The calibration could not be loaded from the pcap file");
+    internal->Prefetcher.reset(
+      new FramePrefetcher(boost::bind(&vtkLidarReader::PrefetchFrame, this, _1)));
   }
-  return this->GetNumberOfFrames();
+  internal->Prefetcher->Request(frames);
+  return true;
 }
 
 //-----------------------------------------------------------------------------
-void vtkLidarReader::SetTimestepInformation(vtkInformation *info)
+vtkSmartPointer<vtkPolyData> vtkLidarReader::GetFrameInBackground(int frameNumber)
 {
-  size_t numberOfTimesteps = this->FilePositions.size();
-  std::vector<double> timesteps(numberOfTimesteps);
-  double timeOffset = this->GetInterpreter()->GetTimeOffset();
-  for (size_t i = 0; i < numberOfTimesteps; ++i)
+  vtkLidarReaderInternal* internal = this->Internal;
+  vtkSmartPointer<vtkPolyData> readyFrame = internal->ReadyFrame;
+  const int readyFrameNumber = internal->ReadyFrameNumber;
+  internal->ReadyFrame = nullptr;
+  internal->ReadyFrameNumber = -1;
+  internal->PendingFrame = -1;
+
+  // the first frame, and the first one after a change of the frame content, are decoded right
+  // away as there is nothing else to show. The decoded frame file is fast enough to be read.
+  const vtkMTimeType time = this->GetFrameContentTime();
+  if (!internal->LastFrame || internal->LastFrameTime != time || this->UseDecodedFrameFile)
   {
-    timesteps[i] = this->FilePositions[i].Time + timeOffset;
+    return nullptr;
   }
 
-  if (this->FilePositions.size())
+  // the frame would be evicted by the frames prefetched before being given
+  const unsigned long frameSize = internal->LastFrame->GetActualMemorySize();
+  if (2 * frameSize > this->Cache->GetMemoryBudget())
   {
-    double* firstTimestepPointer = &timesteps.front();
-    double* lastTimestepPointer = &timesteps.back();
-    // Remove the first and last frame timestep
-    // in case you have less that 3 timstep we will still show the partial
-    // frame to avoid showing nothing
-    if (!this->ShowFirstAndLastFrame && numberOfTimesteps >= 3)
-    {
-      firstTimestepPointer++;
-      lastTimestepPointer--;
-      numberOfTimesteps -= 2;
+    return nullptr;
+  }
+
+  if (readyFrame && readyFrameNumber == frameNumber)
+  {
+    return readyFrame;
+  }
 
+  // the cache cannot be read while the prefetcher decodes a frame, the frame is then
+  // considered missing and Poll tells when it is there
+  {
+    boost::unique_lock<boost::mutex> lock(internal->DecodeMutex, boost::try_to_lock);
+    if (lock.owns_lock() && this->Cache->Contains(frameNumber, time))
+    {
+      return this->Cache->Get(frameNumber, time);
     }
-    double timeRange[2] = { *firstTimestepPointer, *lastTimestepPointer };
-    // In order to avoid to display
-    info->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), firstTimestepPointer, numberOfTimesteps);
-    info->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
   }
-  else
+
+  // the frame is decoded right away when the prefetcher cannot decode it
+  internal->PendingFrame = frameNumber;
+  if (!this->SchedulePrefetch(frameNumber, frameSize))
   {
-    info->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
-    info->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+    internal->PendingFrame = -1;
+    return nullptr;
   }
+  return internal->LastFrame;
 }
 
 //-----------------------------------------------------------------------------
-vtkStandardNewMacro(vtkLidarReader)
-
-//-----------------------------------------------------------------------------
-void vtkLidarReader::SetFileName(const std::string &filename)
+vtkSmartPointer<vtkPolyData> vtkLidarReader::GetPreviewFrame(int frameNumber)
 {
-  if (filename == this->FileName)
+  VV_TRACE_SCOPE("vtkLidarReader::GetPreviewFrame");
+  boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+  vtkLidarReaderInternal* internal = this->Internal;
+
+  const vtkMTimeType time = this->GetFrameContentTime();
+  if (!internal->PreviewDecoder || internal->PreviewDecoderTime != time)
   {
-    return;
+    internal->PreviewDecoder = this->Interpreter->CreatePreviewDecoder(this->PreviewDecimation);
+    internal->PreviewDecoderTime = time;
+  }
+  if (!internal->PreviewDecoder)
+  {
+    return nullptr;
   }
 
-  this->FileName = filename;
-  this->FilePositions.clear();
-  this->Modified();
+  vtkPacketFileReader& reader = internal->PreviewReader;
+  if (reader.IsOpen() && reader.GetFileNames() != this->FileNames)
+  {
+    reader.Close();
+  }
+  if (!reader.IsOpen() &&
+    !reader.Open(this->FileNames, this->UseMemoryMappedFile, this->GetDestinationPort()))
+  {
+    return nullptr;
+  }
+
+  const FramePosition& position = this->FilePositions[frameNumber];
+  internal->PreviewDecoder->ResetCurrentFrame();
+  reader.SetFileOffset(position.Position);
+  return DecodeFramePackets(internal->PreviewDecoder, &reader, position.Skip);
 }
 
 //-----------------------------------------------------------------------------
-vtkSmartPointer<vtkPolyData> vtkLidarReader::GetFrame(int frameNumber)
+void vtkLidarReader::PrefetchFrame(int frameNumber)
 {
-  this->Interpreter->ResetCurrentFrame();
-  if (!this->Reader)
+  // the frame is decoded with the settings of the copy, and cached for the time of the copy
+  vtkSmartPointer<vtkLidarPacketInterpreter> decoder;
+  vtkMTimeType time;
   {
-    vtkErrorMacro("GetFrame() called but packet file reader is not open.");
-    return 0;
+    boost::lock_guard<boost::mutex> lock(this->Internal->PrefetchDecoderMutex);
+    decoder = this->Internal->PrefetchDecoder;
+    time = this->Internal->PrefetchDecoderTime;
   }
-  if (!this->Interpreter->GetIsCalibrated())
+
+  boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+  if (!decoder || frameNumber < 0 || frameNumber >= this->GetNumberOfFrames() ||
+    !decoder->GetIsCalibrated() || this->Cache->Contains(frameNumber, time))
   {
-    vtkErrorMacro("Corrections have not been set");
-    return 0;
+    return;
   }
 
-  const unsigned char* data = 0;
-  unsigned int dataLength = 0;
-  double timeSinceStart;
-  int firstFramePositionInPacket = this->FilePositions[frameNumber].Skip;
+  // the frames of an opened decoded frame file are given without decoding
+  const DecodedFrameFile& decodedFrames = this->Internal->DecodedFrames;
+  if (this->UseDecodedFrameFile && this->Internal->DecodedFramesTime == time &&
+    decodedFrames.IsOpen() && decodedFrames.GetNumberOfFrames() == this->GetNumberOfFrames())
+  {
+    return;
+  }
 
-  this->Reader->SetFilePosition(&this->FilePositions[frameNumber].Position);
-  while (this->Reader->NextPacket(data, dataLength, timeSinceStart))
+  vtkPacketFileReader& reader = this->Internal->PrefetchReader;
+  if (reader.IsOpen() && reader.GetFileNames() != this->FileNames)
   {
+    reader.Close();
+  }
+  if (!reader.IsOpen() &&
+    !reader.Open(this->FileNames, this->UseMemoryMappedFile, this->GetDestinationPort()))
+  {
+    return;
+  }
+  const FramePosition& position = this->FilePositions[frameNumber];
+  decoder->ResetCurrentFrame();
+  reader.SetFileOffset(position.Position);
+  this->Cache->Add(frameNumber, time, DecodeFramePackets(decoder, &reader, position.Skip));
+}
 
-    if (!this->Interpreter->IsLidarPacket(data, dataLength))
+//-----------------------------------------------------------------------------
+void vtkLidarReader::CacheFrames(const double* timeSteps, int numberOfTimeSteps)
+{
+  // the cached frames would be evicted before being requested
+  if (this->Cache->GetMemoryBudget() == 0)
+  {
+    return;
+  }
+
+  std::vector<int> frames;
+  vtkMTimeType time;
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+    time = this->GetFrameContentTime();
+    for (int i = 0; i < numberOfTimeSteps; ++i)
     {
-      continue;
+      auto idx = std::lower_bound(this->FilePositions.begin(),
+                                  this->FilePositions.end(),
+                                  timeSteps[i],
+                                  [](FramePosition& fp, double d)
+                                    { return fp.Time < d; });
+      const int frame = static_cast<int>(std::distance(this->FilePositions.begin(), idx));
+      if (idx != this->FilePositions.end() && !this->Cache->Contains(frame, time))
+      {
+        frames.push_back(frame);
+      }
     }
+  }
+  if (frames.size() < 2)
+  {
+    return;
+  }
 
-    this->Interpreter->ProcessPacket(data, dataLength, firstFramePositionInPacket);
-
-    // check if the required frames are ready
-    if (this->Interpreter->IsNewFrameReady())
+  // the missing frames are decoded as one range, the frames of the range which are
+  // already cached or not requested are dropped
+  std::sort(frames.begin(), frames.end());
+  this->GetFrames(frames.front(), frames.back(), [&](int frameNumber, vtkPolyData* frame) {
+    if (std::binary_search(frames.begin(), frames.end(), frameNumber))
     {
-      return this->Interpreter->GetLastFrameAvailable();
+      boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+      this->Cache->Add(frameNumber, time, frame);
     }
-    firstFramePositionInPacket = 0;
+    return true;
+  });
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::CancelPrefetch()
+{
+  if (this->Internal->Prefetcher)
+  {
+    this->Internal->Prefetcher->Cancel();
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(this->Internal->PrefetchDecoderMutex);
+    this->Internal->PrefetchDecoder = nullptr;
   }
+  this->Internal->PrefetchReader.Close();
+  this->Internal->PreviewReader.Close();
+}
 
-  this->Interpreter->SplitFrame(true);
-  return this->Interpreter->GetLastFrameAvailable();
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetCalibrationFileName(const std::string& filename)
+{
+  this->CancelPrefetch();
+  this->StopIncrementalIndexing();
+  this->Superclass::SetCalibrationFileName(filename);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetInterpreter(vtkLidarPacketInterpreter* interpreter)
+{
+  this->CancelPrefetch();
+  this->StopIncrementalIndexing();
+  this->Superclass::SetInterpreter(interpreter);
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetFrameCacheSize(int mebibytes)
+{
+  // this does not change the output, so the reader is not modified
+  this->Cache->SetMemoryBudget(static_cast<unsigned long>(std::max(mebibytes, 0)) * 1024);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarReader::GetFrameCacheSize()
+{
+  return static_cast<int>(this->Cache->GetMemoryBudget() / 1024);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarReader::GetFrameCacheHits()
+{
+  return this->Cache->GetNumberOfHits();
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarReader::GetFrameCacheMisses()
+{
+  return this->Cache->GetNumberOfMisses();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::ResetFrameCacheStatistics()
+{
+  this->Cache->ResetStatistics();
+  this->Internal->RawFrames.ResetStatistics();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarReader::SetRawFrameCacheSize(int mebibytes)
+{
+  // this does not change the output, so the reader is not modified
+  this->Internal->RawFrames.SetMemoryBudget(
+    static_cast<unsigned long>(std::max(mebibytes, 0)) * 1024);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarReader::GetRawFrameCacheSize()
+{
+  return static_cast<int>(this->Internal->RawFrames.GetMemoryBudget() / 1024);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarReader::GetRawFrameCacheHits()
+{
+  return this->Internal->RawFrames.GetNumberOfHits();
 }
 
 //-----------------------------------------------------------------------------
@@ -176,7 +2634,7 @@ void vtkLidarReader::Open()
 {
   this->Close();
   this->Reader = new vtkPacketFileReader;
-  if (!this->Reader->Open(this->FileName))
+  if (!this->Reader->Open(this->FileNames, this->UseMemoryMappedFile, this->GetDestinationPort()))
   {
     vtkErrorMacro(<< "Failed to open packet file: " << this->FileName << endl
                                                  << this->Reader->GetLastError())
@@ -200,74 +2658,81 @@ void vtkLidarReader::SaveFrame(int startFrame, int endFrame, const std::string &
     return;
   }
 
-  vtkPacketFileWriter writer;
-  if (!writer.Open(filename))
-  {
-    vtkErrorMacro("Failed to open packet file for writing: " << filename);
-    return;
-  }
-
-
   // Ensure that frame indexes match between what is effectively shown
   // and what is present inside the PCAP
-  size_t numberOfTimesteps = this->FilePositions.size();
-  if (!this->ShowFirstAndLastFrame && numberOfTimesteps >= 3)
+  const int numberOfFrames = this->GetNumberOfFrames();
+  if (!this->ShowFirstAndLastFrame && numberOfFrames >= 3)
   {
     startFrame++;
     endFrame++;
   }
+  if (startFrame < 0 || startFrame >= numberOfFrames || endFrame < startFrame)
+  {
+    vtkErrorMacro("Cannot save frames " << startFrame << " to " << endFrame << ", only "
+                                        << numberOfFrames << " frames are available.");
+    return;
+  }
 
-  // because fpos_t is plateform specific and should not be used for comparaison
-  // it's not possible to simply interate from FiePositions[start] to FilePositions[end]
-  // we need to detect new frame in the pcap directly once again
-  pcap_pkthdr* header = 0;
-  const unsigned char* data = 0;
-  unsigned int dataLength = 0;
-  unsigned int dataHeaderLength = 0;
-  double timeSinceStart = 0;
-  int currentFrame = startFrame;
+  // The records are copied as is, from the first packet of startFrame to the packet where
+  // endFrame + 1 starts, which is needed to complete endFrame as frames can start in the middle
+  // of a packet. All the traffic in between is kept, such as the Velodyne IMU/GPS packets.
+  // The header of the source (the pcap global header, or the pcapng section header and
+  // interfaces) is copied too, so the link type and the timestamp resolution are preserved.
+  // In a sequence, the records of each file are copied in turn, after the header of the file
+  // where startFrame is.
+  vtkPacketFileReader reader;
+  if (!reader.Open(this->FileNames, this->UseMemoryMappedFile))
+  {
+    vtkErrorMacro(<< "Failed to open packet file: " << this->FileName << endl
+                                          << reader.GetLastError());
+    return;
+  }
+  const boost::uint64_t begin = this->FilePositions[startFrame].Position;
+  boost::uint64_t end = vtkPacketFileReader::MakeSequenceOffset(this->FileNames.size(), 0);
+  if (endFrame + 1 < numberOfFrames)
+  {
+    const unsigned char* data = 0;
+    unsigned int dataLength = 0;
+    double timeSinceStart = 0;
+    reader.SetFileOffset(this->FilePositions[endFrame + 1].Position);
+    if (reader.NextPacket(data, dataLength, timeSinceStart))
+    {
+      end = reader.GetFileOffset();
+    }
+  }
+  reader.Close();
 
-  bool isNewFrame = false;
-  int notUsed = 0;
-
-  // Explanation for why we need to allow currentFrame to go to endFrame + 1:
-  // If '[]' represents a packet, '|' represents the separation between frames,
-  // Then the contents of a Velodyne Lidar PCAP is in general*:
-  // [-- incomplete frame --|-- begin frame 0 --]
-  // [-- content of frame 0 --]
-  // ... many packets ...
-  // [-- end frame 0 --|-- begin frame1 --]
-  // ... end of the PCAP
-  // Here we see that the first separation between two frame happens in the
-  // first packet. We do need to see one more separation than the number of
-  // packets to write. This is due to the fact that the first incomplete frame
-  // is hidden by VeloView.
-  // A possible improvement to VeloView would be to not always hide this first
-  // frame, depending on a flag set on the reader.
-  // *if you are very lucky the first frame will start at the begining of the
-  // first packet, and there will be no "incomplete frame".
-  //
-  // In my test, writing all frames of the PCAP results in a .pcap file exactly
-  // identical to the one that is read, if you enable "ShowFirstAndLastFrame".
-
-  this->Reader->SetFilePosition(&this->FilePositions[startFrame].Position);
-
-  while (this->Reader->NextPacket(
-           data, dataLength, timeSinceStart, &header, &dataHeaderLength)
-         && currentFrame <= endFrame + 1) // see explanation above for "+ 1"
-  {
-    // writing all packets, even those that do not contain lidar frames,
-    // such as the 512 bytes packets of Velodyne IMU data + forwarded GPS data
-    writer.WritePacket(header, const_cast<unsigned char*>(data) - dataHeaderLength);
-    if (this->Interpreter->IsLidarPacket(data, dataLength))
+  this->UpdateProgress(0.0);
+  const size_t firstFile = vtkPacketFileReader::GetFileIndex(begin);
+  const size_t lastFile =
+    std::min(vtkPacketFileReader::GetFileIndex(end), this->FileNames.size() - 1);
+  for (size_t i = firstFile; i <= lastFile; ++i)
+  {
+    if (!reader.Open(this->FileNames[i], this->UseMemoryMappedFile))
+    {
+      vtkErrorMacro(<< "Failed to open packet file: " << this->FileNames[i] << endl
+                                            << reader.GetLastError());
+      return;
+    }
+    const boost::uint64_t headerLength = reader.GetFileOffset();
+    reader.Close();
+
+    FileRanges ranges;
+    if (i == firstFile)
     {
-      // we need to count frames and some are split in multiple packets
-      this->Interpreter->PreProcessPacket(data, dataLength, isNewFrame, notUsed);
-      currentFrame += static_cast<int>(isNewFrame);
-      this->UpdateProgress(0.0);
+      ranges.push_back(std::make_pair(0, headerLength));
+    }
+    ranges.push_back(std::make_pair(
+      i == firstFile ? vtkPacketFileReader::GetOffsetInFile(begin) : headerLength,
+      vtkPacketFileReader::GetFileIndex(end) == i ? vtkPacketFileReader::GetOffsetInFile(end) :
+                                                    std::numeric_limits<boost::uint64_t>::max()));
+    std::string error;
+    if (!CopyFileRanges(this->FileNames[i], ranges, filename, i != firstFile, error))
+    {
+      vtkErrorMacro("Failed to save frames in " << filename << ": " << error);
+      return;
     }
   }
-    writer.Close();
 }
 
 //-----------------------------------------------------------------------------
@@ -275,12 +2740,16 @@ int vtkLidarReader::RequestData(vtkInformation *vtkNotUsed(request),
                                 vtkInformationVector **vtkNotUsed(inputVector),
                                 vtkInformationVector *outputVector)
 {
+  VV_TRACE_SCOPE("vtkLidarReader::RequestData");
   vtkPolyData* output = vtkPolyData::GetData(outputVector);
   vtkTable* calibration = vtkTable::GetData(outputVector,1);
 
+  // make room for the frame before decoding it
+  MemoryAccounting::Enforce();
+
   vtkInformation* info = outputVector->GetInformationObject(0);
 
-  if (this->FileName.empty())
+  if (this->FileNames.empty())
   {
     vtkErrorMacro("FileName has not been set.");
     return 0;
@@ -314,14 +2783,87 @@ int vtkLidarReader::RequestData(vtkInformation *vtkNotUsed(request),
     return 0;
   }
 
-  //! @todo we should no open the pcap file everytime a frame is requested !!!
-  this->Open();
-  output->ShallowCopy(this->GetFrame(frameRequested));
-  this->Close();
+  vtkInformationDoubleVectorKey* upcomingKey = vtkLidarReader::UPDATE_TIME_STEPS();
+  if (info->Has(upcomingKey) && !this->UseDecodedFrameFile)
+  {
+    this->CacheFrames(info->Get(upcomingKey), info->Length(upcomingKey));
+  }
+
+  // the frames of the requests announcing several time steps must be the requested ones
+  vtkSmartPointer<vtkPolyData> frame;
+  bool isPreview = false;
+  if (this->Scrubbing && !info->Has(upcomingKey))
+  {
+    this->Internal->PendingFrame = -1;
+    this->Internal->ReadyFrame = nullptr;
+    bool isCached = false;
+    {
+      boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+      isCached = this->Cache->Contains(frameRequested, this->GetFrameContentTime());
+    }
+    if (!isCached && !this->UseDecodedFrameFile)
+    {
+      frame = this->GetPreviewFrame(frameRequested);
+      isPreview = frame != nullptr;
+    }
+  }
+  else if (this->AsynchronousUpdate && !info->Has(upcomingKey))
+  {
+    frame = this->GetFrameInBackground(frameRequested);
+  }
+  else
+  {
+    this->Internal->PendingFrame = -1;
+    this->Internal->ReadyFrame = nullptr;
+  }
+
+  if (!frame)
+  {
+    //! @todo we should no open the pcap file everytime a frame is requested !!!
+    bool isCached = false;
+    {
+      boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+      isCached = this->Cache->Contains(frameRequested, this->GetFrameContentTime());
+    }
+    if (!isCached)
+    {
+      this->Open();
+    }
+    frame = this->GetFrame(frameRequested);
+    if (!isCached)
+    {
+      this->Close();
+    }
+  }
+  output->ShallowCopy(frame);
+
+  if (this->Internal->PendingFrame >= 0)
+  {
+    // the time of the frame given tells the consumers that it is not the requested one
+    output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(),
+      this->FilePositions[this->Internal->LastFrameNumber].Time);
+  }
+  else
+  {
+    // a preview is given again while the full frame is decoded in the background, but the
+    // frames around it are only prefetched once the scrubbing ends
+    this->Internal->LastFrame = frame;
+    this->Internal->LastFrameNumber = static_cast<int>(frameRequested);
+    this->Internal->LastFrameTime = this->GetFrameContentTime();
+    this->Internal->IsPreview = isPreview;
+    if (!isPreview)
+    {
+      this->SchedulePrefetch(frameRequested, output->GetActualMemorySize());
+    }
+  }
 
   vtkTable *t = this->Interpreter->GetCalibrationTable();
   calibration->ShallowCopy(t);
 
+  LaserStatistics statistics;
+  statistics.Add(output->GetFieldData());
+  statistics.FillTable(vtkTable::GetData(outputVector, 2));
+
   return 1;
 }
 
@@ -330,10 +2872,38 @@ int vtkLidarReader::RequestInformation(vtkInformation* request,
                                        vtkInformationVector** inputVector,
                                        vtkInformationVector* outputVector)
 {
+  if (!this->Interpreter && !this->FileNames.empty())
+  {
+    const std::string name = this->DetectInterpreterName();
+    if (!name.empty())
+    {
+      this->SetInterpreter(LidarInterpreterRegistry::GetInstance().Create(name));
+    }
+  }
   this->Superclass::RequestInformation(request, inputVector, outputVector);
-  if (!this->FileName.empty() && this->FilePositions.empty())
+
+  // the interpreter is modified by the decoding settings too, such as the crop region or the
+  // laser selection, the frame index is kept unless the settings it depends on have changed
+  if (this->Interpreter && (!this->FilePositions.empty() || this->GetIsIndexing()) &&
+    this->GetFrameIndexKey() != this->Internal->FrameIndexKey)
+  {
+    this->CancelPrefetch();
+    this->StopIncrementalIndexing();
+    this->FilePositions.clear();
+  }
+
+  if (!this->FileNames.empty() && (this->FilePositions.empty() || this->GetIsIndexing()))
   {
-    this->ReadFrameInformation();
+    boost::lock_guard<boost::mutex> lock(this->Internal->DecodeMutex);
+    if (this->GetIsIndexing())
+    {
+      this->AppendIndexedFrames();
+    }
+    else
+    {
+      this->ReadFrameInformation();
+      this->Internal->FrameIndexKey = this->GetFrameIndexKey();
+    }
   }
   vtkInformation* info = outputVector->GetInformationObject(0);
   this->SetTimestepInformation(info);
@@ -18,8 +18,19 @@
 
 #include "vtkLidarProvider.h"
 
+#include <boost/cstdint.hpp>
+#include <limits>
+#include <memory>
+#ifndef __VTK_WRAP__
+#include <boost/function.hpp>
+#endif
+
+class vtkInformationDoubleVectorKey;
 class vtkPacketFileReader;
+class vtkTable;
+class FrameCache;
 struct FramePosition;
+struct RawFrame;
 //! @todo a decition should be made if the opening/closing of the pcap should be handle by
 //! the class itself of the class user. Currently this is not clear
 
@@ -39,6 +50,18 @@ public:
   vtkGetMacro(FileName, std::string)
   virtual void SetFileName(const std::string& filename);
 
+  /**
+   * @brief AddFileName append a file to the sequence of files read as a single one, such as a
+   * capture split in several files by a logger. The files must be given in chronological order.
+   * @param filename file following the last one of the sequence
+   */
+  void AddFileName(const std::string& filename);
+
+  /**
+   * @brief GetNumberOfFiles number of files in the sequence, see FileNames
+   */
+  int GetNumberOfFiles() { return static_cast<int>(this->FileNames.size()); }
+
 
   /**
    * @brief GetFrame returns the requested frame
@@ -46,6 +69,48 @@ public:
    */
   virtual vtkSmartPointer<vtkPolyData> GetFrame(int frameNumber);
 
+  /**
+   * @brief GetFrame returns the points of a frame in an azimuth sector of the sensor, only the
+   * packets overlapping the sector being read and decoded. The packets are found with their
+   * azimuths recorded in the frame index, or recorded the first time a sector of the frame is
+   * requested. The points of these packets are all kept, so the frame may extend a little
+   * beyond the sector. These frames are not cached. The whole frame is returned when the
+   * interpreter cannot give the azimuths of the packets.
+   * @param frameNumber beteween 0 and vtkLidarReader::GetNumberOfFrames()
+   * @param azimuthMin start of the sector in degrees
+   * @param azimuthMax end of the sector in degrees, going in increasing azimuth from azimuthMin
+   * so that the sector may contain 0, a sector of 360 degrees or more being the whole frame
+   */
+  vtkSmartPointer<vtkPolyData> GetFrame(int frameNumber, double azimuthMin, double azimuthMax);
+
+  /**
+   * @brief GetFrameForUTCTime find the frame measured at a GPS time, and its lidar packet
+   * measured at this time, with a binary search on the GPS times of the frame index, see
+   * FramePosition::FirstSensorTime
+   * @param time UTC time in seconds since the epoch
+   * @param frameNumber[out] frame containing the time
+   * @param packetOffset[out] number of lidar packets of the frame before the one measured at
+   * this time, -1 if the packets of the frame are not indexed
+   * @return false if the frames have no GPS time, or if the time is outside of the file
+   */
+  bool GetFrameForUTCTime(double time, int& frameNumber, int& packetOffset);
+
+  /**
+   * @brief GetFrameQualities quality of the frames measured from their lidar packets while the
+   * file is indexed, so that the damaged frames are known without decoding them. The table has
+   * a row per frame, with its time step and the quality fields of FramePosition. The frames
+   * whose packets have not been indexed (sequences of files, incremental indexing, interpreters
+   * not giving the azimuths of the packets) have 0 packets.
+   */
+  vtkSmartPointer<vtkTable> GetFrameQualities();
+
+  /**
+   * @brief GetIsFrameDamaged check if a frame misses packets, has duplicated packets, or covers
+   * less than minimumCoverage of the turn, see GetFrameQualities
+   * @return false if the packets of the frame have not been indexed
+   */
+  bool GetIsFrameDamaged(int frameNumber, double minimumCoverage = 0.95);
+
   /**
    * @brief Open open the pcap file
    * @todo a decition should be made if the opening/closing of the pcap should be handle by
@@ -63,18 +128,233 @@ public:
   /**
    * @brief SaveFrame save the packet corresponding to the desired frames in a pcap file.
    * Because we are saving network packet, part of previous and/or next frames could be included in generated the pcap
+   * When the frames span several files of a sequence, the header of the first of them is kept,
+   * so the files must share the same link type
    * @param startFrame first frame to record
    * @param endFrame last frame to record, this frame is included
    * @param filename where to save the generate pcap file
    */
   virtual void SaveFrame(int startFrame, int endFrame, const std::string& filename);
 
+  /**
+   * @brief DetectInterpreterName look in the first packets of the file for a packet recognized by
+   * one of the interpreters of the LidarInterpreterRegistry. When no interpreter has been set,
+   * the detected one is created by RequestInformation.
+   * @return the name of the interpreter, empty if no packet is recognized
+   */
+  std::string DetectInterpreterName();
+
+#ifndef __VTK_WRAP__
+  /**
+   * @brief FrameCallback receive a frame decoded by GetFrames
+   * @return false to stop the decoding
+   */
+  typedef boost::function<bool(int frameNumber, vtkPolyData* frame)> FrameCallback;
+
+  /**
+   * @brief GetFrames decode a range of frames and give them in order to a callback, called on the
+   * calling thread. The frames are decoded by NumberOfDecodingThreads threads, each one with its
+   * own copy of the interpreter and its own file handle. The frame cache is not used.
+   * @param firstFrame first frame to decode
+   * @param lastFrame last frame to decode, this frame is included
+   * @param callback called for each frame
+   * @return false if the callback stopped the decoding or the file cannot be read
+   */
+  bool GetFrames(int firstFrame, int lastFrame, const FrameCallback& callback);
+
+  /**
+   * @brief PacketObserver receive the packets which are not lidar packets, such as the GPS
+   * position packets, while the pcap is read to build the frame index. This way they are
+   * decoded without reading the whole file a second time.
+   * The methods are called in file order, on the indexing thread when the index is built in
+   * the background.
+   */
+  class PacketObserver
+  {
+  public:
+    virtual ~PacketObserver() = default;
+
+    //! a scan of the file starts, the packets of a previous scan must be forgotten
+    virtual void StartPackets(const std::string& fileName) = 0;
+
+    virtual void ProcessPacket(const unsigned char* data, unsigned int dataLength,
+      double timeSinceStart) = 0;
+
+    //! the scan ends, complete is false if it has been aborted before the end of the file
+    virtual void EndPackets(bool complete) = 0;
+  };
+
+  /**
+   * @brief SetPacketObserver set the observer given the packets of the next scans.
+   * Nothing is given when the frame index is loaded from its sidecar file, or when LidarPort
+   * is set as the other packets are then skipped. Removing the observer during a background
+   * scan stops giving it the packets immediately, without calling EndPackets.
+   * @param observer observer to use, nullptr to remove it
+   */
+  void SetPacketObserver(PacketObserver* observer);
+#endif
+
+  /**
+   * @brief UPDATE_TIME_STEPS time steps that a downstream filter is about to request one after
+   * the other, set with UPDATE_TIME_STEP in the update extent request. The frames of these time
+   * steps which are not in the frame cache are decoded concurrently with GetFrames and cached,
+   * so that the following requests do not decode them one at a time.
+   * A filter between the reader and the requester forwards it if the key is in
+   * vtkExecutive::KEYS_TO_COPY()
+   */
+  static vtkInformationDoubleVectorKey* UPDATE_TIME_STEPS();
+
   vtkGetMacro(ShowFirstAndLastFrame, bool)
   vtkSetMacro(ShowFirstAndLastFrame, bool)
 
+  vtkGetMacro(UseFrameIndexFile, bool)
+  vtkSetMacro(UseFrameIndexFile, bool)
+
+  vtkGetMacro(UseMemoryMappedFile, bool)
+  vtkSetMacro(UseMemoryMappedFile, bool)
+
+  vtkGetMacro(UseDecodedFrameFile, bool)
+  vtkSetMacro(UseDecodedFrameFile, bool)
+
+  /**
+   * @brief SaveDecodedFrameFile decode all the frames and save them in a sidecar file
+   * (<file>.vvframes), used instead of the pcap by GetFrame when UseDecodedFrameFile is enabled.
+   * Nothing is done if the file is already up to date.
+   * @return true if the file is up to date
+   */
+  bool SaveDecodedFrameFile();
+
+  vtkGetMacro(NumberOfIndexingThreads, int)
+  vtkSetMacro(NumberOfIndexingThreads, int)
+
+  vtkGetMacro(IncrementalIndexing, bool)
+  vtkSetMacro(IncrementalIndexing, bool)
+
+  /**
+   * @brief SetNumberOfDecodingThreads set how many threads decode the packets of a frame, and
+   * the frames given by GetFrames
+   * @param numberOfThreads 0 uses the pool size of the decode threads given by ThreadTopology,
+   * or one thread per core if it is not set, 1 decodes the packets sequentially
+   */
+  void SetNumberOfDecodingThreads(int numberOfThreads);
+  vtkGetMacro(NumberOfDecodingThreads, int)
+
+  /**
+   * @copydoc LidarPort
+   */
+  vtkGetMacro(LidarPort, int)
+  virtual void SetLidarPort(int port);
+
+  /**
+   * @brief GetIsIndexing true while the frame index is being built in the background,
+   * see IncrementalIndexing
+   */
+  bool GetIsIndexing();
+
+  /**
+   * @brief Poll add the frames found by the background indexing to the frame index.
+   * The reader is modified when there are new frames, so that the next UpdateInformation
+   * publishes their time steps. The frames already in the cache are kept.
+   */
+  void Poll();
+
+  /**
+   * @brief SetAsynchronousUpdate when enabled, a requested frame which is not in the frame cache
+   * is decoded by the prefetcher thread, and RequestData gives the last frame meanwhile, so that
+   * the update does not wait for the decoding. Poll modifies the reader once the frame is ready,
+   * the next update then gives it. The requests announcing UPDATE_TIME_STEPS, and the first
+   * frame after a change of the frame content, are still answered synchronously.
+   */
+  void SetAsynchronousUpdate(bool asynchronous);
+  vtkGetMacro(AsynchronousUpdate, bool)
+
+  /**
+   * @brief GetIsFramePending true while the last requested frame is decoded in the background,
+   * the output being then the previous frame, see AsynchronousUpdate
+   */
+  bool GetIsFramePending();
+
+  /**
+   * @brief SetScrubbing tell that the user is dragging the time slider. Meanwhile, a requested
+   * frame which is not in the frame cache is replaced by a preview, decoded with a subset of the
+   * lasers and firings, see PreviewDecimation. The previews are not cached and nothing is
+   * prefetched around them. Ending the scrubbing modifies the reader when a preview is shown,
+   * so that the next update refines it to the full frame.
+   */
+  void SetScrubbing(bool scrubbing);
+  vtkGetMacro(Scrubbing, bool)
+
+  /**
+   * @copydoc PreviewDecimation
+   */
+  void SetPreviewDecimation(int decimation);
+  vtkGetMacro(PreviewDecimation, int)
+
+  /**
+   * @brief GetIsPreview true when the last frame given is a preview, see Scrubbing
+   */
+  bool GetIsPreview();
+
+  /**
+   * @brief SetFrameCacheSize set the memory that can be used to keep the decoded frames,
+   * so that a frame already visited is not decoded again
+   * @param mebibytes memory budget, 0 disables the cache
+   */
+  void SetFrameCacheSize(int mebibytes);
+  int GetFrameCacheSize();
+
+  /**
+   * @brief GetFrameCacheHits number of frames that have been served by the frame cache
+   */
+  int GetFrameCacheHits();
+
+  /**
+   * @brief GetFrameCacheMisses number of frames that have been decoded
+   */
+  int GetFrameCacheMisses();
+
+  /**
+   * @brief ResetFrameCacheStatistics reset the hit/miss counters of the frame cache and of the
+   * raw frame cache
+   */
+  void ResetFrameCacheStatistics();
+
+  /**
+   * @brief SetRawFrameCacheSize set the memory that can be used to keep the lidar packets of the
+   * frames, so that a frame decoded again because the calibration, the sensor transform or
+   * another decoding setting has changed is not read from the file again
+   * @param mebibytes memory budget, 0 disables the cache
+   */
+  void SetRawFrameCacheSize(int mebibytes);
+  int GetRawFrameCacheSize();
+
+  /**
+   * @brief GetRawFrameCacheHits number of frames decoded from the packets of the raw frame cache
+   */
+  int GetRawFrameCacheHits();
+
+  /**
+   * @brief SetPrefetchFrames set how many frames are decoded in the background after each
+   * requested frame, so that they are already in the frame cache when playing
+   * @param numberOfFrames number of frames to decode in advance, 0 disables the prefetching
+   */
+  void SetPrefetchFrames(int numberOfFrames);
+  vtkGetMacro(PrefetchFrames, int)
+
+  /**
+   * @brief SetPrefetchDirection set in which direction the frames are prefetched
+   * @param direction 1 to prefetch the next frames, -1 for the previous ones
+   */
+  void SetPrefetchDirection(int direction) { this->PrefetchDirection = direction < 0 ? -1 : 1; }
+  vtkGetMacro(PrefetchDirection, int)
+
+  void SetCalibrationFileName(const std::string& filename) override;
+
+  void SetInterpreter(vtkLidarPacketInterpreter* interpreter) override;
+
 protected:
-  vtkLidarReader() = default;
-  ~vtkLidarReader() = default;
+  vtkLidarReader();
+  ~vtkLidarReader();
 
   int RequestData(vtkInformation* request,
                   vtkInformationVector** inputVector,
@@ -82,30 +362,278 @@ protected:
 
   int RequestInformation(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
 
-  //! Name of the pcap file to read
+  //! Name of the pcap file to read. It may be a glob pattern, such as capture_*.pcap, which
+  //! selects a sequence of files read as a single one in the order of their names.
   std::string FileName = "";
 
+  //! Files read one after the other, FileName or the files matching it, see AddFileName.
+  //! The file offsets of the frame index are the ones of vtkPacketFileReader::MakeSequenceOffset
+  std::vector<std::string> FileNames;
+
   //! frame index which enable to jump quickly to a given frame
   std::vector<FramePosition> FilePositions;
 
   //! Show/Hide the first and last frame that most of the time are partial frames
   bool ShowFirstAndLastFrame = false;
 
+  //! Load the frame index from a sidecar file (<file>.vvidx) when it is up to date,
+  //! and create/refresh it after a full scan of the pcap
+  bool UseFrameIndexFile = true;
+
+  //! Map the pcap file in memory instead of reading it through libpcap
+  bool UseMemoryMappedFile = false;
+
+  //! Read the frames from the sidecar file written by SaveDecodedFrameFile (<file>.vvframes)
+  //! when it has been written with the current settings, instead of decoding the packets
+  bool UseDecodedFrameFile = false;
+
+  //! Number of threads used to build the frame index, 0 means one per core
+  int NumberOfIndexingThreads = 0;
+
+  //! Number of threads decoding the packets of a frame, 0 means the pool size of ThreadTopology
+  int NumberOfDecodingThreads = 1;
+
+  //! Publish the first frames as soon as they are found and keep building the frame index
+  //! in a background thread, the time steps are extended by Poll
+  bool IncrementalIndexing = false;
+
+  //! Only read the UDP packets sent to this port, 0 reads all of them. In a capture of several
+  //! sensors, this selects the sensor to display and skips the packets of the other devices.
+  int LidarPort = 0;
+
   //! libpcap wrapped reader which enable to get the raw pcap packet from the pcap file
   vtkPacketFileReader* Reader = nullptr;
 
+  //! Decoded frames, indexed by frame number
+  FrameCache* Cache = nullptr;
+
+  //! Number of frames decoded in the background after each requested frame
+  int PrefetchFrames = 0;
+
+  //! 1 to prefetch the next frames, -1 for the previous ones
+  int PrefetchDirection = 1;
+
+  //! Decode the frames which are not cached in the background instead of during RequestData
+  bool AsynchronousUpdate = false;
+
+  //! The time slider is being dragged, the frames which are not cached are previewed
+  bool Scrubbing = false;
+
+  //! A preview keeps one laser out of PreviewDecimation, and one firing out of
+  //! PreviewDecimation with the interpreters able to skip firings
+  int PreviewDecimation = 4;
+
 private:
   /**
    * @brief ReadFrameInformation read the whole pcap and create a frame index.
    * In case the calibration is contained in the pcap file, this will also read it
    */
   int ReadFrameInformation();
+
+  /**
+   * @brief ReadFrameInformationInParallel split the pcap in several chunks indexed concurrently
+   * with the interpreter frame detector. This is only possible when the interpreter is already
+   * calibrated and supports it.
+   * @return false if the index has not been built, the pcap must then be read sequentially
+   */
+  bool ReadFrameInformationInParallel();
+
+  /**
+   * @brief ReadSequenceFrameInformation build the frame index of a sequence of files from the
+   * frame index of each file, loaded from its sidecar file or built concurrently with the
+   * other missing ones. The frames which span two files are stitched together.
+   * This is only possible when the interpreter is calibrated and supports it.
+   * @return false if the index has not been built, the sequence must then be read sequentially
+   */
+  bool ReadSequenceFrameInformation();
+
+  /**
+   * @brief StartIncrementalIndexing start building the frame index in a background thread with
+   * the interpreter frame detector, and wait until the first frames have been found.
+   * This is only possible when the interpreter is already calibrated and supports it.
+   * @return false if the indexing has not been started, the pcap must then be read entirely
+   */
+  bool StartIncrementalIndexing();
+
+  /**
+   * @brief AppendIndexedFrames add the frames found by the background indexing to the frame
+   * index. Once complete, the qualities, the sensor times and the packet azimuths of the frames
+   * are computed as by the sequential scan, and the index is saved if the interpreter could give
+   * them to the indexing thread. The caller must hold the decode lock.
+   * @return true if some frames have been added
+   */
+  bool AppendIndexedFrames();
+
+  /**
+   * @brief StopIncrementalIndexing abort the background indexing, the partial index is discarded
+   */
+  void StopIncrementalIndexing();
+
+  /**
+   * @brief GetFrameContentTime return the modification time identifying the decoded frames.
+   * This is the reader modification time, except that Poll modifications are ignored as
+   * extending the frame index does not change the frames.
+   */
+  vtkMTimeType GetFrameContentTime();
+
+  /**
+   * @brief GetDestinationPort return the port given to the packet readers, 0 for any
+   */
+  unsigned short GetDestinationPort();
+
+  /**
+   * @brief GetFrameIndexKey return a string describing the settings that change the frame index,
+   * an index file built with other settings is considered stale.
+   */
+  std::string GetFrameIndexKey();
+
+  /**
+   * @brief LoadFrameIndexFile try to fill the frame index from the sidecar file
+   * @return true if the index has been loaded and the interpreter is calibrated
+   */
+  bool LoadFrameIndexFile();
+
+  /**
+   * @brief SaveFrameIndexFile save the current frame index in the sidecar file
+   */
+  void SaveFrameIndexFile();
+
+  /**
+   * @brief GetDecodedFrameKey return a string describing the settings that change the decoded
+   * frames, a decoded frame file written with other settings is considered stale.
+   */
+  std::string GetDecodedFrameKey();
+
+  /**
+   * @brief ReadDecodedFrame return a frame from the decoded frame file, which is opened again
+   * each time the frame content changes. The caller must hold the decode lock.
+   * @param frameNumber beteween 0 and vtkLidarReader::GetNumberOfFrames()
+   * @param time frame content time, see GetFrameContentTime
+   * @return nullptr if there is no valid decoded frame file
+   */
+  vtkSmartPointer<vtkPolyData> ReadDecodedFrame(int frameNumber, vtkMTimeType time);
   /**
    * @brief SetTimestepInformation Set the timestep available
    * @param info
    */
   void SetTimestepInformation(vtkInformation *info);
 
+  /**
+   * @brief DecodeFrame read and decode a frame, the caller must hold the decode lock
+   * @param reader opened packet reader to use
+   * @param frameNumber beteween 0 and vtkLidarReader::GetNumberOfFrames()
+   */
+  vtkSmartPointer<vtkPolyData> DecodeFrame(vtkPacketFileReader* reader, int frameNumber);
+
+  /**
+   * @brief DecodeFilteredFrame apply the crop and the laser selection of the interpreter to the
+   * frame decoded without them, which is kept and only decoded again for another frame or when
+   * the other settings change. The caller must hold the decode lock.
+   * @param reader opened packet reader to use
+   * @param frameNumber beteween 0 and vtkLidarReader::GetNumberOfFrames()
+   * @return nullptr if the interpreter cannot filter its frames after decoding them
+   */
+  vtkSmartPointer<vtkPolyData> DecodeFilteredFrame(vtkPacketFileReader* reader, int frameNumber);
+
+  /**
+   * @brief IndexFramePackets record the azimuths of the lidar packets of a frame if they are not
+   * known yet, the caller must hold the decode lock
+   * @param reader opened packet reader to use
+   * @param frameNumber beteween 0 and vtkLidarReader::GetNumberOfFrames()
+   * @return false if the interpreter cannot give the azimuths of the packets
+   */
+  bool IndexFramePackets(vtkPacketFileReader* reader, int frameNumber);
+
+  /**
+   * @brief GetCropPackets select the lidar packets of a frame which may have returns kept by
+   * the crop of the interpreter, from their ranges recorded while indexing
+   * @param frameNumber beteween 0 and vtkLidarReader::GetNumberOfFrames()
+   * @param positions[out] positions of the selected packets, in file order
+   * @return false if no packet can be skipped, or if the ranges of the packets are unknown
+   */
+  bool GetCropPackets(int frameNumber, std::vector<boost::uint64_t>& positions);
+
+  /**
+   * @brief DecodeSelectedPackets decode some lidar packets of a frame as the whole frame, the
+   * caller must hold the decode lock
+   * @param reader opened packet reader to use
+   * @param frameNumber beteween 0 and vtkLidarReader::GetNumberOfFrames()
+   * @param packets positions of the packets to decode, in file order
+   */
+  vtkSmartPointer<vtkPolyData> DecodeSelectedPackets(vtkPacketFileReader* reader,
+    int frameNumber, const std::vector<boost::uint64_t>& packets);
+
+  /**
+   * @brief GetRawFrame give the lidar packets of a frame before the one where the next frame
+   * starts, from the raw frame cache or read from the file and added to it. The caller must hold
+   * the decode lock.
+   * @param reader opened packet reader to use, left at the start of the next frame
+   * @param frameNumber beteween 0 and vtkLidarReader::GetNumberOfFrames()
+   * @return nullptr for the last frame, or when the packets are not needed: the raw frame cache
+   * is disabled and the frames are decoded on a single thread
+   */
+  std::shared_ptr<const RawFrame> GetRawFrame(vtkPacketFileReader* reader, int frameNumber);
+
+  /**
+   * @brief DecodePacketsInParallel decode the packets of a frame before the one where the next
+   * frame starts on several threads, and append them to the frame in progress of the interpreter.
+   * On failure nothing has been decoded.
+   * @param packets lidar packets of the frame, see GetRawFrame
+   * @param frameNumber frame to decode
+   * @param firstFramePositionInPacket[in,out] where the frame starts in its first packet, set to 0
+   * when this packet has been decoded
+   */
+  bool DecodePacketsInParallel(
+    const RawFrame& packets, int frameNumber, int& firstFramePositionInPacket);
+
+  /**
+   * @brief SchedulePrefetch ask the prefetcher to decode the frames following a requested frame,
+   * after the frame pending when updating asynchronously. The prefetcher decodes them with a
+   * copy of the interpreter made here, by the thread which changes its settings.
+   * @param frameNumber the frame which has just been requested
+   * @param frameSize memory used by this frame in kibibytes, used to stay within the cache budget
+   * @return false if nothing is prefetched, e.g. when the interpreter cannot be copied
+   */
+  bool SchedulePrefetch(int frameNumber, unsigned long frameSize);
+
+  /**
+   * @brief GetFrameInBackground return the requested frame when it is cached, otherwise ask the
+   * prefetcher to decode it and return the last frame given, see AsynchronousUpdate
+   * @return nullptr if the frame must be decoded right away
+   */
+  vtkSmartPointer<vtkPolyData> GetFrameInBackground(int frameNumber);
+
+  /**
+   * @brief GetPreviewFrame decode a coarse version of a frame, see Scrubbing
+   * @return nullptr if the interpreter cannot decode previews
+   */
+  vtkSmartPointer<vtkPolyData> GetPreviewFrame(int frameNumber);
+
+  /**
+   * @brief PrefetchFrame decode a frame with the copy of the interpreter made by SchedulePrefetch
+   * and put it in the frame cache, this is called by the prefetcher thread
+   */
+  void PrefetchFrame(int frameNumber);
+
+  /**
+   * @brief CacheFrames decode concurrently the frames of some time steps which are not already
+   * in the frame cache, and put them in the cache
+   */
+  void CacheFrames(const double* timeSteps, int numberOfTimeSteps);
+
+  /**
+   * @brief CancelPrefetch stop the prefetching, this must be called before changing the file,
+   * the calibration or the interpreter
+   */
+  void CancelPrefetch();
+
+  /**
+   * @brief ResetFiles forget everything related to the files read, after a change of FileNames
+   */
+  void ResetFiles();
+
+  vtkLidarReaderInternal* Internal = nullptr;
+
   vtkLidarReader(const vtkLidarReader&) = delete;
   void operator=(const vtkLidarReader&) = delete;
 };
@@ -115,11 +643,15 @@ private:
 //-----------------------------------------------------------------------------
 typedef struct FramePosition
 {
-  FramePosition(const fpos_t pos, const int skip, const double time)
-    : Position(pos), Skip(skip), Time(time) {}
+  FramePosition(const boost::uint64_t pos, const int skip, const double time)
+    : Position(pos), Skip(skip), Time(time),
+      FirstSensorTime(std::numeric_limits<double>::quiet_NaN()),
+      LastSensorTime(std::numeric_limits<double>::quiet_NaN()),
+      NumberOfPackets(0), AzimuthCoverage(0.), NumberOfMissingPackets(-1),
+      NumberOfDuplicatePackets(0), LargestTimeGap(std::numeric_limits<double>::quiet_NaN()) {}
 
-  //! position of the first packet of the given frame
-  fpos_t Position;
+  //! byte offset in the file of the first packet of the given frame
+  boost::uint64_t Position;
   //! Offset specific to the lidar data format
   //! Used as some frame start at the middle of a packet
   int Skip;
@@ -128,6 +660,22 @@ typedef struct FramePosition
   //! payload of the packet. It's contained in the header, and indicate when a packet has been
   //! received
   double Time;
+  //! GPS time of the first lidar packet of the frame, and of the last one which is the first
+  //! packet of the next frame, in seconds since the epoch (UTC). The date and the hour come from
+  //! the NMEA sentences of the position packets, the times are NaN when there is none, or when
+  //! the interpreter does not give the time of the packets.
+  double FirstSensorTime;
+  double LastSensorTime;
+  //! Quality of the frame measured by the indexing from its lidar packets, see
+  //! ComputeFrameQualities. NumberOfPackets is 0 when the packets have not been indexed, and
+  //! NumberOfMissingPackets is -1 when the interpreter does not give the time of the packets.
+  int NumberOfPackets;
+  //! fraction of the turn covered by the azimuths of the packets, in [0, 1]
+  double AzimuthCoverage;
+  int NumberOfMissingPackets;
+  int NumberOfDuplicatePackets;
+  //! largest time between two consecutive packets, in seconds
+  double LargestTimeGap;
 } FramePosition;
 
 #endif // VTKLIDARREADER_H
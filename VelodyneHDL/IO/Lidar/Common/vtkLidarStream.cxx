@@ -17,15 +17,38 @@
 
 // LOCAL
 #include "vtkLidarStream.h"
+#include "LidarDecodingKernels.h"
+#include "TraceEvents.h"
+#include "FrameDelivery.h"
+#include "FrameStreamServer.h"
 #include "NetworkSource.h"
 #include "PacketConsumer.h"
 #include "PacketFileWriter.h"
+#include "PositionConsumer.h"
+#include "Ros2Publisher.h"
+#include "SharedMemoryFrameRing.h"
+#include "ThreadTopology.h"
+#include "TimeShiftBuffer.h"
 
 // VTK
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
 #include <vtkInformationVector.h>
 #include <vtkInformation.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkPolyLine.h>
 #include <vtkStreamingDemandDrivenPipeline.h>
 
+// STD
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <vector>
+
 class vtkLidarStreamInternal
 {
 public:
@@ -34,18 +57,123 @@ public:
     : Consumer(new PacketConsumer)
     , Writer(new PacketFileWriter)
     , Network(std::unique_ptr<NetworkSource>(new NetworkSource(this->Consumer, argLIDARPort, ForwardedLIDARPort,
-                                                               ForwardedIpAddress, isForwarding, isCrashAnalysing))) {}
+                                                               ForwardedIpAddress, isForwarding, isCrashAnalysing)))
+  {
+    this->Network->Positions = this->Positions;
+    this->Positions->GetImuBuffer()->SetMaximumDuration(60.0);
+    this->Positions->GetTrajectory()->SetMaximumDuration(600.0);
+  }
+
+  //! Fill the trajectory output with the positions of the buffer
+  void UpdateTrajectory();
 
 
   //! where to save a live record of the sensor
   std::string OutputFileName;
 
+  //! azimuth range of the sectors given instead of the frames, 0 to give the frames
+  double SectorSize = 0;
+
+  //! number of timesteps whose return statistics are summed in the statistics output
+  int StatisticsWindow = 10;
+
+  //! frames given to the pipeline while it shows the last timestep
+  FrameDelivery Delivery;
+  //! last timestep given by RequestInformation, the pipeline shows it while it follows the sensor
+  double LastTimestep = -std::numeric_limits<double>::infinity();
+
+  //! port on which the decoded frames are streamed to the remote viewers, 0 to disable it
+  int FrameStreamingPort = 0;
+
+  //! shared memory object in which the decoded frames are published, empty to disable it
+  std::string SharedMemoryName;
+  int SharedMemoryNumberOfSlots = 4;
+  //! in mebibytes
+  int SharedMemorySlotSize = 16;
+
+  //! ROS 2 node on which the decoded frames are published, empty to disable it
+  std::string Ros2NodeName;
+
+  //! directory in which the last packets are kept on the disk, empty to disable it
+  std::string TimeShiftDirectory;
+
 
   std::shared_ptr<PacketConsumer> Consumer;
+  std::shared_ptr<FrameStreamServer> FrameServer = std::make_shared<FrameStreamServer>();
+  std::shared_ptr<SharedMemoryFrameRing> SharedMemoryRing = std::make_shared<SharedMemoryFrameRing>();
+  std::shared_ptr<Ros2Publisher> Ros2 = std::make_shared<Ros2Publisher>();
   std::shared_ptr<PacketFileWriter> Writer;
+  std::shared_ptr<TimeShiftBuffer> TimeShift = std::make_shared<TimeShiftBuffer>();
+  std::shared_ptr<PositionConsumer> Positions = std::make_shared<PositionConsumer>();
   std::unique_ptr<NetworkSource> Network;
+
+  //! trajectory output, only rebuilt when the buffer has changed since TrajectoryRevision
+  vtkSmartPointer<vtkPolyData> Trajectory = vtkSmartPointer<vtkPolyData>::New();
+  unsigned long TrajectoryRevision = 0;
 };
 
+//-----------------------------------------------------------------------------
+void vtkLidarStreamInternal::UpdateTrajectory()
+{
+  std::shared_ptr<TrajectoryBuffer> buffer = this->Positions->GetTrajectory();
+  const unsigned long revision = buffer->GetRevision();
+  if (revision == this->TrajectoryRevision)
+  {
+    return;
+  }
+  this->TrajectoryRevision = revision;
+
+  std::vector<TrajectoryBuffer::Sample> samples;
+  buffer->GetSamples(-std::numeric_limits<double>::infinity(),
+    std::numeric_limits<double>::infinity(), samples);
+  Eigen::Vector3d origin = Eigen::Vector3d::Zero();
+  this->Positions->GetOrigin(origin);
+
+  // same arrays as vtkVelodyneHDLPositionReader, the positions are relative to the first fix
+  const vtkIdType count = static_cast<vtkIdType>(samples.size());
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints(count);
+  vtkSmartPointer<vtkPolyLine> polyLine = vtkSmartPointer<vtkPolyLine>::New();
+  polyLine->GetPointIds()->SetNumberOfIds(count);
+  const char* names[] = { "lat", "lon", "gpstime", "time", "heading" };
+  vtkSmartPointer<vtkDoubleArray> arrays[5];
+  for (int k = 0; k < 5; ++k)
+  {
+    arrays[k] = vtkSmartPointer<vtkDoubleArray>::New();
+    arrays[k]->SetName(names[k]);
+    arrays[k]->SetNumberOfTuples(count);
+  }
+  for (vtkIdType i = 0; i < count; ++i)
+  {
+    const TrajectoryBuffer::Sample& sample = samples[i];
+    const Eigen::Vector3d position = sample.Position - origin;
+    points->SetPoint(i, position.x(), position.y(), position.z());
+    polyLine->GetPointIds()->SetId(i, i);
+    arrays[0]->SetValue(i, sample.Lat);
+    arrays[1]->SetValue(i, sample.Long);
+    arrays[2]->SetValue(i, sample.GPSTime);
+    // in microseconds, as the time of the position reader
+    arrays[3]->SetValue(i, 1e6 * sample.Time);
+    arrays[4]->SetValue(i, sample.Heading);
+  }
+
+  vtkSmartPointer<vtkCellArray> cells = vtkSmartPointer<vtkCellArray>::New();
+  if (count > 0)
+  {
+    cells->InsertNextCell(polyLine);
+  }
+
+  // a new object, so that the previous output given to the pipeline is not modified
+  this->Trajectory = vtkSmartPointer<vtkPolyData>::New();
+  this->Trajectory->SetPoints(points);
+  this->Trajectory->SetLines(cells);
+  for (int k = 0; k < 5; ++k)
+  {
+    this->Trajectory->GetPointData()->AddArray(arrays[k]);
+  }
+}
+
 
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkLidarStream)
@@ -54,6 +182,8 @@ vtkStandardNewMacro(vtkLidarStream)
 vtkLidarStream::vtkLidarStream()
 {
   this->Internal = new vtkLidarStreamInternal(2368, 2369, "127.0.0.1", false, false);
+  // frames, calibration, statistics and trajectory
+  this->SetNumberOfOutputPorts(4);
 }
 
 //-----------------------------------------------------------------------------
@@ -66,8 +196,7 @@ vtkLidarStream::~vtkLidarStream()
 //-----------------------------------------------------------------------------
 int vtkLidarStream::GetNumberOfFrames()
 {
-  std::cerr << "this is not implemented yet" << std::endl;
-  return 0;
+  return static_cast<int>(this->Internal->Consumer->GetSnapshot()->Frames.size());
 }
 
 //-----------------------------------------------------------------------------
@@ -154,6 +283,107 @@ void vtkLidarStream::EnableGPSListening(const bool value)
   this->Internal->Network->ListenGPS = value;
 }
 
+//-----------------------------------------------------------------------------
+std::shared_ptr<ImuBuffer> vtkLidarStream::GetImuBuffer()
+{
+  return this->Internal->Positions->GetImuBuffer();
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetImuBufferDuration()
+{
+  return this->Internal->Positions->GetImuBuffer()->GetMaximumDuration();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetImuBufferDuration(double seconds)
+{
+  this->Internal->Positions->GetImuBuffer()->SetMaximumDuration(seconds);
+}
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<TrajectoryBuffer> vtkLidarStream::GetTrajectoryBuffer()
+{
+  return this->Internal->Positions->GetTrajectory();
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetTrajectoryDuration()
+{
+  return this->Internal->Positions->GetTrajectory()->GetMaximumDuration();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetTrajectoryDuration(double seconds)
+{
+  if (seconds == this->GetTrajectoryDuration())
+  {
+    return;
+  }
+
+  this->Internal->Positions->GetTrajectory()->SetMaximumDuration(seconds);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarStream::GetUseGPGGASentences()
+{
+  return this->Internal->Positions->GetUseGPGGASentences();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetUseGPGGASentences(bool use)
+{
+  if (use == this->GetUseGPGGASentences())
+  {
+    return;
+  }
+
+  this->Internal->Positions->SetUseGPGGASentences(use);
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfDroppedPositionPackets()
+{
+  return static_cast<int>(this->Internal->Positions->GetNumberOfDroppedPackets());
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetSensorIpAddress()
+{
+  return this->Internal->Network->SensorIpAddress;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetSensorIpAddress(const std::string& ipAddress)
+{
+  this->Internal->Network->SensorIpAddress = ipAddress;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetMulticastAddress()
+{
+  return this->Internal->Network->MulticastAddress;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetMulticastAddress(const std::string& ipAddress)
+{
+  this->Internal->Network->MulticastAddress = ipAddress;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetNumberOfNetworkThreads(int numberOfThreads)
+{
+  ThreadTopology::SetPoolSize(ThreadTopology::RECEIVE, numberOfThreads);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfNetworkThreads()
+{
+  return ThreadTopology::GetPoolSize(ThreadTopology::RECEIVE);
+}
 
 //-----------------------------------------------------------------------------
 void vtkLidarStream::SetIsForwarding(bool value)
@@ -173,6 +403,378 @@ void vtkLidarStream::SetIsCrashAnalysing(const bool value)
   this->Internal->Network->IsCrashAnalysing = value;
 }
 
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetRecordingQueueDepth()
+{
+  return static_cast<int>(this->Internal->Writer->GetQueueDepth());
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfDroppedRecordedPackets()
+{
+  return static_cast<int>(this->Internal->Writer->GetNumberOfDroppedPackets());
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetTimeShiftDirectory()
+{
+  return this->Internal->TimeShiftDirectory;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetTimeShiftDirectory(const std::string& directory)
+{
+  this->Internal->TimeShiftDirectory = directory;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetTimeShiftDuration()
+{
+  return this->Internal->TimeShift->GetDuration();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetTimeShiftDuration(double seconds)
+{
+  this->Internal->TimeShift->SetDuration(std::max(seconds, 0.0));
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetTimeShiftMaximumSize()
+{
+  return static_cast<int>(this->Internal->TimeShift->GetMaximumSize());
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetTimeShiftMaximumSize(int mebibytes)
+{
+  this->Internal->TimeShift->SetMaximumSize(static_cast<unsigned long>(std::max(mebibytes, 0)));
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetTimeShiftFilePattern()
+{
+  return this->Internal->TimeShift->GetFilePattern();
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfTimeShiftFrames()
+{
+  return static_cast<int>(this->Internal->TimeShift->GetFrameTimes().size());
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetTimeShiftStartTime()
+{
+  const std::vector<double> times = this->Internal->TimeShift->GetFrameTimes();
+  return times.empty() ? std::numeric_limits<double>::quiet_NaN() : times.front();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarStream::SaveTimeShiftWindow(
+  double startTime, double endTime, const std::string& filename)
+{
+  std::string error;
+  if (!this->Internal->TimeShift->SaveWindow(startTime, endTime, filename, error))
+  {
+    vtkErrorMacro(<< "Failed to save the time shift window in " << filename << ": " << error);
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfDroppedTimeShiftPackets()
+{
+  return static_cast<int>(this->Internal->TimeShift->GetNumberOfDroppedPackets());
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetDecodingWaitTime()
+{
+  return this->Internal->Consumer->GetDecodingWaitTime();
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetPublishingWaitTime()
+{
+  return this->Internal->Consumer->GetPublishingWaitTime();
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetReceivedPacketRate()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().ReceivedPacketRate;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetQueuedPacketRate()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().QueuedPacketRate;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetDecodedPacketRate()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().DecodedPacketRate;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetDroppedPacketRate()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().DroppedPacketRate;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetFrameRate()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().FrameRate;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetFrameDecodeTime()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().FrameDecodeTime;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetMaxFrameDecodeTime()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().MaxFrameDecodeTime;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetReceiveLatency()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().ReceiveLatency;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetMaxReceiveLatency()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().MaxReceiveLatency;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetDecodingWaitRatio()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().DecodingWaitRatio;
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetPublishingWaitRatio()
+{
+  return this->Internal->Consumer->GetTelemetry().GetSample().PublishingWaitRatio;
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfReceivedPackets()
+{
+  return static_cast<vtkIdType>(
+    this->Internal->Consumer->GetTelemetry().GetNumberOfReceivedPackets());
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfDecodedPackets()
+{
+  return static_cast<vtkIdType>(
+    this->Internal->Consumer->GetTelemetry().GetNumberOfDecodedPackets());
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfDroppedPackets()
+{
+  return static_cast<vtkIdType>(
+    this->Internal->Consumer->GetTelemetry().GetNumberOfDroppedPackets());
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetDecodingQueueDepth()
+{
+  return static_cast<int>(this->Internal->Consumer->GetQueueDepth());
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetFrameStreamingPort()
+{
+  return this->Internal->FrameStreamingPort;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetFrameStreamingPort(int port)
+{
+  this->Internal->FrameStreamingPort = std::max(port, 0);
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetFrameStreamingRate()
+{
+  return this->Internal->FrameServer->GetMaximumFrameRate();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetFrameStreamingRate(double rate)
+{
+  this->Internal->FrameServer->SetMaximumFrameRate(std::max(rate, 0.0));
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetFrameStreamingLaserDecimation()
+{
+  return this->Internal->FrameServer->GetCodec().GetLaserDecimation();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetFrameStreamingLaserDecimation(int decimation)
+{
+  this->Internal->FrameServer->GetCodec().SetLaserDecimation(std::max(decimation, 1));
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetFrameStreamingRangeResolution()
+{
+  return this->Internal->FrameServer->GetCodec().GetRangeResolution();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetFrameStreamingRangeResolution(double meters)
+{
+  if (meters > 0)
+  {
+    this->Internal->FrameServer->GetCodec().SetRangeResolution(meters);
+  }
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfFrameStreamingClients()
+{
+  return this->Internal->FrameServer->GetNumberOfClients();
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfStreamedFrames()
+{
+  return static_cast<vtkIdType>(this->Internal->FrameServer->GetNumberOfSentFrames());
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfStreamedBytes()
+{
+  return static_cast<vtkIdType>(this->Internal->FrameServer->GetNumberOfSentBytes());
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetSharedMemoryName()
+{
+  return this->Internal->SharedMemoryName;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetSharedMemoryName(const std::string& name)
+{
+  this->Internal->SharedMemoryName = name;
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetSharedMemoryNumberOfSlots()
+{
+  return this->Internal->SharedMemoryNumberOfSlots;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetSharedMemoryNumberOfSlots(int numberOfSlots)
+{
+  this->Internal->SharedMemoryNumberOfSlots = std::max(numberOfSlots, 2);
+}
+
+//-----------------------------------------------------------------------------
+int vtkLidarStream::GetSharedMemorySlotSize()
+{
+  return this->Internal->SharedMemorySlotSize;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetSharedMemorySlotSize(int mebibytes)
+{
+  this->Internal->SharedMemorySlotSize = std::max(mebibytes, 1);
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfSharedFrames()
+{
+  return static_cast<vtkIdType>(this->Internal->SharedMemoryRing->GetNumberOfPublishedFrames());
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfFramesTooLargeToShare()
+{
+  return static_cast<vtkIdType>(this->Internal->SharedMemoryRing->GetNumberOfSkippedFrames());
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetRos2NodeName()
+{
+  return this->Internal->Ros2NodeName;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetRos2NodeName(const std::string& name)
+{
+  this->Internal->Ros2NodeName = name;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetRos2FrameId()
+{
+  return this->Internal->Ros2->GetFrameId();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetRos2FrameId(const std::string& frameId)
+{
+  this->Internal->Ros2->SetFrameId(frameId);
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetRos2PointCloudTopic()
+{
+  return this->Internal->Ros2->GetPointCloudTopic();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarStream::SetRos2PointCloudTopic(const std::string& topic)
+{
+  this->Internal->Ros2->SetPointCloudTopic(topic);
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfRos2Frames()
+{
+  return static_cast<vtkIdType>(this->Internal->Ros2->GetNumberOfPublishedFrames());
+}
+
+//-----------------------------------------------------------------------------
+double vtkLidarStream::GetDisplayedFrameAge()
+{
+  return this->Internal->Consumer->GetTelemetry().GetDisplayedFrameAge();
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkLidarStream::GetTelemetrySummary()
+{
+  const LiveTelemetry::Sample sample = this->Internal->Consumer->GetTelemetry().GetSample();
+  std::ostringstream summary;
+  summary << std::fixed << std::setprecision(0) << sample.ReceivedPacketRate << " packets/s, "
+          << sample.DroppedPacketRate << " dropped/s, queue " << this->GetDecodingQueueDepth()
+          << ", " << std::setprecision(1) << sample.FrameRate << " frames/s, decode "
+          << sample.FrameDecodeTime * 1e3 << " ms (max " << sample.MaxFrameDecodeTime * 1e3
+          << "), receive " << sample.ReceiveLatency * 1e3 << " ms (max "
+          << sample.MaxReceiveLatency * 1e3 << "), lock wait " << (sample.DecodingWaitRatio + sample.PublishingWaitRatio) * 1e2
+          << " %, age " << std::setprecision(0) << this->GetDisplayedFrameAge() * 1e3 << " ms, "
+          << this->GetNumberOfSkippedFrames() << " frames skipped";
+  return summary.str();
+}
+
 //-----------------------------------------------------------------------------
 bool vtkLidarStream::GetNeedsUpdate()
 {
@@ -187,7 +789,12 @@ void vtkLidarStream::Start()
   {
     vtkErrorMacro(<< "Please set a Interpreter")
   }
+  else
+  {
+    this->Interpreter->SetSectorSize(this->Internal->SectorSize);
+  }
   this->Internal->Consumer->SetInterpreter(this->Interpreter);
+  this->Internal->Delivery.Reset();
   if (this->Internal->OutputFileName.length())
   {
     this->Internal->Writer->Start(this->Internal->OutputFileName);
@@ -200,6 +807,21 @@ void vtkLidarStream::Start()
     this->Internal->Network->Writer = this->Internal->Writer;
   }
 
+  // the frames are found in the packets kept on the disk without decoding them
+  this->Internal->Network->TimeShift.reset();
+  if (!this->Internal->TimeShiftDirectory.empty())
+  {
+    if (this->Internal->TimeShift->Start(this->Internal->TimeShiftDirectory,
+          this->Interpreter ? this->Interpreter->CreateFrameDetector() : nullptr))
+    {
+      this->Internal->Network->TimeShift = this->Internal->TimeShift;
+    }
+    else
+    {
+      vtkErrorMacro(<< "Cannot keep the packets in " << this->Internal->TimeShiftDirectory);
+    }
+  }
+
   // Check if the IP address is valid
 //  {
 //    boost::system::error_code ec;
@@ -211,6 +833,27 @@ void vtkLidarStream::Start()
 //    }
 //  }
 
+  // a port already used only disables the streaming, the sensor is still received
+  const bool isStreaming = this->Internal->FrameStreamingPort > 0 &&
+    this->Internal->FrameServer->Start(this->Internal->FrameStreamingPort);
+  this->Internal->Consumer->SetFrameStreamServer(
+    isStreaming ? this->Internal->FrameServer : std::shared_ptr<FrameStreamServer>());
+
+  // the shared memory is created again, so that the readers see the new layout of the frames
+  const bool isSharing = !this->Internal->SharedMemoryName.empty() &&
+    this->Internal->SharedMemoryRing->Create(this->Internal->SharedMemoryName,
+      this->Internal->SharedMemoryNumberOfSlots,
+      static_cast<boost::uint64_t>(this->Internal->SharedMemorySlotSize) << 20);
+  this->Internal->Consumer->SetSharedMemoryRing(
+    isSharing ? this->Internal->SharedMemoryRing : std::shared_ptr<SharedMemoryFrameRing>());
+
+  const bool isPublishing = !this->Internal->Ros2NodeName.empty() &&
+    this->Internal->Ros2->Start(this->Internal->Ros2NodeName);
+  const std::shared_ptr<Ros2Publisher> ros2 =
+    isPublishing ? this->Internal->Ros2 : std::shared_ptr<Ros2Publisher>();
+  this->Internal->Consumer->SetRos2Publisher(ros2);
+  this->Internal->Positions->SetRos2Publisher(ros2);
+
   this->Internal->Consumer->Start();
 //  this->Internal->Network->LIDARPort = this->LIDARPort;
 //  this->Internal->Network->ForwardedLIDARPort = this->ForwardedLIDARPort;
@@ -225,18 +868,80 @@ void vtkLidarStream::Stop()
 {
   this->Internal->Network->Stop();
   this->Internal->Consumer->Stop();
+  this->Internal->FrameServer->Stop();
+  this->Internal->SharedMemoryRing->Close();
+  this->Internal->Ros2->Stop();
   this->Internal->Writer->Stop();
+  this->Internal->TimeShift->Stop();
 }
 
 //----------------------------------------------------------------------------
 void vtkLidarStream::Poll()
 {
-  if (this->Internal->Consumer->CheckForNewData())
+  // the frames waiting for a slow pipeline are given by the next updates
+  if (this->Internal->Consumer->CheckForNewData() ||
+    this->Internal->Positions->GetTrajectory()->GetRevision() != this->Internal->TrajectoryRevision ||
+    this->GetNumberOfPendingFrames() > 0)
   {
     this->Modified();
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkLidarStream::SetNewFrameCallback(const boost::function<void()>& callback)
+{
+  this->Internal->Consumer->SetNewDataCallback(callback);
+}
+
+//----------------------------------------------------------------------------
+int vtkLidarStream::GetDeliveryPolicy()
+{
+  return static_cast<int>(this->Internal->Delivery.GetPolicy());
+}
+
+//----------------------------------------------------------------------------
+void vtkLidarStream::SetDeliveryPolicy(int policy)
+{
+  const FrameDelivery::Policy deliveryPolicy =
+    policy == FrameDelivery::EVERY_FRAME ? FrameDelivery::EVERY_FRAME : FrameDelivery::LATEST_FRAME;
+  if (deliveryPolicy != this->Internal->Delivery.GetPolicy())
+  {
+    this->Internal->Delivery.SetPolicy(deliveryPolicy);
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkLidarStream::GetDeliveryQueueLength()
+{
+  return static_cast<int>(this->Internal->Delivery.GetMaximumQueueLength());
+}
+
+//----------------------------------------------------------------------------
+void vtkLidarStream::SetDeliveryQueueLength(int length)
+{
+  this->Internal->Delivery.SetMaximumQueueLength(static_cast<size_t>(std::max(length, 1)));
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfDeliveredFrames()
+{
+  return static_cast<vtkIdType>(this->Internal->Delivery.GetNumberOfDeliveredFrames());
+}
+
+//----------------------------------------------------------------------------
+vtkIdType vtkLidarStream::GetNumberOfSkippedFrames()
+{
+  return static_cast<vtkIdType>(this->Internal->Delivery.GetNumberOfSkippedFrames());
+}
+
+//----------------------------------------------------------------------------
+int vtkLidarStream::GetNumberOfPendingFrames()
+{
+  return static_cast<int>(
+    this->Internal->Consumer->GetNumberOfPendingFrames(this->Internal->Delivery));
+}
+
 //----------------------------------------------------------------------------
 int vtkLidarStream::GetCacheSize()
 {
@@ -255,6 +960,86 @@ void vtkLidarStream::SetCacheSize(int cacheSize)
   this->Modified();
 }
 
+//----------------------------------------------------------------------------
+double vtkLidarStream::GetCacheDuration()
+{
+  return this->Internal->Consumer->GetRetentionTime();
+}
+
+//----------------------------------------------------------------------------
+void vtkLidarStream::SetCacheDuration(double seconds)
+{
+  if (seconds == this->GetCacheDuration())
+  {
+    return;
+  }
+
+  this->Internal->Consumer->SetRetentionTime(seconds);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkLidarStream::GetCacheMemorySize()
+{
+  return static_cast<int>(this->Internal->Consumer->GetMaxCacheSize() / 1024);
+}
+
+//----------------------------------------------------------------------------
+void vtkLidarStream::SetCacheMemorySize(int mebibytes)
+{
+  if (mebibytes == this->GetCacheMemorySize())
+  {
+    return;
+  }
+
+  const unsigned long kibibytes = static_cast<unsigned long>(std::max(mebibytes, 0)) * 1024;
+  this->Internal->Consumer->SetMaxCacheSize(kibibytes);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+double vtkLidarStream::GetSectorSize()
+{
+  return this->Internal->SectorSize;
+}
+
+//----------------------------------------------------------------------------
+void vtkLidarStream::SetSectorSize(double degrees)
+{
+  degrees = std::max(degrees, 0.0);
+  if (degrees == this->Internal->SectorSize)
+  {
+    return;
+  }
+
+  this->Internal->SectorSize = degrees;
+  if (this->Interpreter)
+  {
+    // the interpreter is used by the decoding thread
+    boost::lock_guard<boost::mutex> lock(this->Internal->Consumer->ReaderMutex);
+    this->Interpreter->SetSectorSize(degrees);
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkLidarStream::GetStatisticsWindow()
+{
+  return this->Internal->StatisticsWindow;
+}
+
+//----------------------------------------------------------------------------
+void vtkLidarStream::SetStatisticsWindow(int numberOfTimesteps)
+{
+  numberOfTimesteps = std::max(numberOfTimesteps, 1);
+  if (numberOfTimesteps == this->Internal->StatisticsWindow)
+  {
+    return;
+  }
+  this->Internal->StatisticsWindow = numberOfTimesteps;
+  this->Modified();
+}
+
 //-----------------------------------------------------------------------------
 void vtkLidarStream::UnloadFrames()
 {
@@ -262,6 +1047,17 @@ void vtkLidarStream::UnloadFrames()
 }
 
 
+//-----------------------------------------------------------------------------
+int vtkLidarStream::FillOutputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 3)
+  {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkPolyData");
+    return 1;
+  }
+  return this->Superclass::FillOutputPortInformation(port, info);
+}
+
 //-----------------------------------------------------------------------------
 int vtkLidarStream::RequestInformation(vtkInformation* request,
                                        vtkInformationVector** inputVector,
@@ -272,6 +1068,8 @@ int vtkLidarStream::RequestInformation(vtkInformation* request,
 
   std::vector<double> timesteps = this->Internal->Consumer->GetTimesteps();
   const size_t nTimesteps = timesteps.size();
+  this->Internal->LastTimestep =
+    nTimesteps > 0 ? timesteps.back() : -std::numeric_limits<double>::infinity();
   if (nTimesteps > 0)
   {
     outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), &timesteps.front(),
@@ -282,8 +1080,16 @@ int vtkLidarStream::RequestInformation(vtkInformation* request,
     outInfo->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
   }
 
-  double timeRange[2] = { 0.0, nTimesteps ? nTimesteps - 1.0 : 0.0 };
-  outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+  // the timesteps are the sensor time of the frames, like the ones of the reader
+  if (nTimesteps > 0)
+  {
+    double timeRange[2] = { timesteps.front(), timesteps.back() };
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+  }
+  else
+  {
+    outInfo->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+  }
 
   return 1;
 }
@@ -293,6 +1099,7 @@ int vtkLidarStream::RequestData(vtkInformation* vtkNotUsed(request),
                                 vtkInformationVector** vtkNotUsed(inputVector),
                                 vtkInformationVector* outputVector)
 {
+  VV_TRACE_SCOPE("vtkLidarStream::RequestData");
   vtkInformation* outInfo = outputVector->GetInformationObject(0);
   vtkDataSet* output = vtkDataSet::SafeDownCast(outInfo->Get(vtkDataObject::DATA_OBJECT()));
 
@@ -301,9 +1108,10 @@ int vtkLidarStream::RequestData(vtkInformation* vtkNotUsed(request),
   {
     timeRequest = outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP());
   }
+  double shownTime = timeRequest;
 
   {
-    boost::lock_guard<boost::mutex> lock(this->Internal->Consumer->ConsumerMutex);
+    // the consumer publishes snapshots of its frames, reading them does not block the decoding
     double actualTime;
     vtkSmartPointer<vtkPolyData> polyData(NULL);
 //  if (this->Internal->Consumer->GetNumberOfTrailingFrames() > 0)
@@ -313,14 +1121,28 @@ int vtkLidarStream::RequestData(vtkInformation* vtkNotUsed(request),
 //  }
 //  else
 //  {
-    polyData = this->Internal->Consumer->GetFrameForTime(timeRequest, actualTime);
+    double firstPacketTime = 0;
+    if (timeRequest >= this->Internal->LastTimestep)
+    {
+      // the pipeline follows the sensor, it gets the frames chosen by the delivery policy
+      polyData = this->Internal->Consumer->GetFrameForDelivery(
+        this->Internal->Delivery, actualTime, &firstPacketTime);
+    }
+    else
+    {
+      polyData =
+        this->Internal->Consumer->GetFrameForTime(timeRequest, actualTime, &firstPacketTime);
+    }
 //  }
 
     if (polyData)
     {
+      this->Internal->Consumer->GetTelemetry().SetDisplayedFrameAge(
+        LiveTelemetry::GetTime() - firstPacketTime);
       // printf("request %f, returning %f\n", timeRequest, actualTime);
       output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), actualTime);
       output->ShallowCopy(polyData);
+      shownTime = actualTime;
     }
   }
 
@@ -328,5 +1150,24 @@ int vtkLidarStream::RequestData(vtkInformation* vtkNotUsed(request),
   vtkTable *t = this->Interpreter->GetCalibrationTable();
   calibration->ShallowCopy(t);
 
+  // the statistics are summed over the window ending at the shown timestep
+  LaserStatistics statistics;
+  double windowTime;
+  vtkSmartPointer<vtkMultiBlockDataSet> window = this->Internal->Consumer->GetFramesForTime(
+    shownTime, windowTime, this->Internal->StatisticsWindow - 1);
+  for (unsigned int i = 0; i < window->GetNumberOfBlocks(); ++i)
+  {
+    vtkDataObject* frame = window->GetBlock(i);
+    if (frame)
+    {
+      statistics.Add(frame->GetFieldData());
+    }
+  }
+  statistics.FillTable(vtkTable::GetData(outputVector, 2));
+
+  this->Internal->UpdateTrajectory();
+  vtkPolyData* trajectory = vtkPolyData::GetData(outputVector, 3);
+  trajectory->ShallowCopy(this->Internal->Trajectory);
+
   return 1;
 }
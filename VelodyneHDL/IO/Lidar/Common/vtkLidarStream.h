@@ -18,6 +18,14 @@
 
 #include "vtkLidarProvider.h"
 
+#ifndef __VTK_WRAP__
+#include <boost/function.hpp>
+#include <memory>
+
+class ImuBuffer;
+class TrajectoryBuffer;
+#endif
+
 class vtkLidarStreamInternal;
 
 class VTK_EXPORT vtkLidarStream : public vtkLidarProvider
@@ -30,14 +38,79 @@ public:
 
   void Poll();
 
+#ifndef __VTK_WRAP__
+  /**
+   * @brief SetNewFrameCallback set a function called on the decoding thread each time a frame
+   * is received, so that the application updates the stream when there is a new frame instead
+   * of polling it. The function must not block, it typically posts an event to the thread
+   * which calls Poll. An empty function removes it.
+   */
+  void SetNewFrameCallback(const boost::function<void()>& callback);
+#endif
+
   void Start();
   void Stop();
 
   void UnloadFrames();
 
+  /**
+   * @brief GetCacheSize maximum number of frames kept, 0 means no limit
+   */
   int GetCacheSize();
   void SetCacheSize(int cacheSize);
 
+  /**
+   * @brief GetCacheDuration only the frames received during the last seconds are kept, 0 means
+   * no limit
+   */
+  double GetCacheDuration();
+  void SetCacheDuration(double seconds);
+
+  /**
+   * @brief GetCacheMemorySize maximum memory used by the frames kept, in mebibytes, 0 means no
+   * limit
+   */
+  int GetCacheMemorySize();
+  void SetCacheMemorySize(int mebibytes);
+
+  /**
+   * @brief GetDeliveryPolicy how the frames are given to the pipeline while it shows the last
+   * timestep, when its filters take them slower than the sensor sends them, see FrameDelivery.
+   * 0 gives every frame in order, with up to DeliveryQueueLength frames waiting, 1 gives the
+   * last frame and skips the others. The other timesteps are given as requested.
+   */
+  int GetDeliveryPolicy();
+  void SetDeliveryPolicy(int policy);
+
+  /**
+   * @copydoc FrameDelivery::GetMaximumQueueLength
+   */
+  int GetDeliveryQueueLength();
+  void SetDeliveryQueueLength(int length);
+
+  /**
+   * Frames given to the pipeline and frames skipped by the delivery since the last Start, and
+   * frames waiting to be given
+   */
+  vtkIdType GetNumberOfDeliveredFrames();
+  vtkIdType GetNumberOfSkippedFrames();
+  int GetNumberOfPendingFrames();
+
+  /**
+   * @brief GetSectorSize azimuth range in degrees of the sectors given instead of the frames,
+   * so that the points are processed before the rotation completes, 0 to give the frames.
+   * Each sector is a timestep of the stream, LidarSectorAssembler gives the frames back.
+   */
+  double GetSectorSize();
+  void SetSectorSize(double degrees);
+
+  /**
+   * @brief GetStatisticsWindow number of timesteps up to the shown one whose return statistics
+   * are summed in the third output. In sector mode only the last sector of a frame carries them.
+   */
+  int GetStatisticsWindow();
+  void SetStatisticsWindow(int numberOfTimesteps);
+
   /**
    * @copydoc vtkLidarStreamInternal::OutputFileName
    */
@@ -76,6 +149,56 @@ public:
 
   void EnableGPSListening(const bool);
 
+#ifndef __VTK_WRAP__
+  /**
+   * @brief GetImuBuffer IMU measurements of the position packets received while the GPS port
+   * is listened, over the last ImuBufferDuration seconds
+   */
+  std::shared_ptr<ImuBuffer> GetImuBuffer();
+#endif
+  double GetImuBufferDuration();
+  void SetImuBufferDuration(double seconds);
+
+#ifndef __VTK_WRAP__
+  /**
+   * @brief GetTrajectoryBuffer positions of the fixes received while the GPS port is listened,
+   * over the last TrajectoryDuration seconds. The fourth output gives them as a polyline.
+   */
+  std::shared_ptr<TrajectoryBuffer> GetTrajectoryBuffer();
+#endif
+  double GetTrajectoryDuration();
+  void SetTrajectoryDuration(double seconds);
+
+  /**
+   * @copydoc PositionConsumer::SetUseGPGGASentences
+   */
+  bool GetUseGPGGASentences();
+  void SetUseGPGGASentences(bool use);
+
+  /**
+   * @copydoc PositionConsumer::GetNumberOfDroppedPackets
+   */
+  int GetNumberOfDroppedPositionPackets();
+
+  /**
+   * @copydoc NetworkSource::SensorIpAddress
+   */
+  std::string GetSensorIpAddress();
+  void SetSensorIpAddress(const std::string& ipAddress);
+
+  /**
+   * @copydoc NetworkSource::MulticastAddress
+   */
+  std::string GetMulticastAddress();
+  void SetMulticastAddress(const std::string& ipAddress);
+
+  /**
+   * Number of threads receiving the packets of all the streams, 0 for one per sensor up to the
+   * number of cores, see ThreadTopology::SetPoolSize
+   */
+  static void SetNumberOfNetworkThreads(int numberOfThreads);
+  static int GetNumberOfNetworkThreads();
+
   /**
    * @copydoc NetworkSource::IsForwarding
    */
@@ -88,6 +211,203 @@ public:
   bool GetIsCrashAnalysing();
   void SetIsCrashAnalysing(bool value);
 
+  /**
+   * @copydoc PacketFileWriter::GetQueueDepth
+   */
+  int GetRecordingQueueDepth();
+
+  /**
+   * @copydoc PacketFileWriter::GetNumberOfDroppedPackets
+   */
+  int GetNumberOfDroppedRecordedPackets();
+
+  /**
+   * @brief GetTimeShiftDirectory directory in which the last minutes of the packets are kept
+   * by TimeShiftBuffer, so that the session can be rewound beyond the cached frames by opening
+   * GetTimeShiftFilePattern with a reader. An empty directory disables it. The time shift
+   * settings are used by the next Start.
+   */
+  std::string GetTimeShiftDirectory();
+  void SetTimeShiftDirectory(const std::string& directory);
+
+  /**
+   * @brief GetTimeShiftDuration seconds of packets kept on the disk
+   */
+  double GetTimeShiftDuration();
+  void SetTimeShiftDuration(double seconds);
+
+  /**
+   * @brief GetTimeShiftMaximumSize disk space used by the packets kept, in mebibytes, 0 means
+   * no limit
+   */
+  int GetTimeShiftMaximumSize();
+  void SetTimeShiftMaximumSize(int mebibytes);
+
+  /**
+   * @copydoc TimeShiftBuffer::GetFilePattern
+   */
+  std::string GetTimeShiftFilePattern();
+
+  /**
+   * @brief Frames whose packets are kept on the disk, and time of the oldest one, NaN if there
+   * is none
+   */
+  int GetNumberOfTimeShiftFrames();
+  double GetTimeShiftStartTime();
+
+  /**
+   * @brief SaveTimeShiftWindow save in a pcap file the packets kept on the disk of the frames
+   * starting between two times, in seconds since the epoch as the timesteps, see
+   * TimeShiftBuffer::SaveWindow
+   */
+  bool SaveTimeShiftWindow(double startTime, double endTime, const std::string& filename);
+
+  /**
+   * @copydoc TimeShiftBuffer::GetNumberOfDroppedPackets
+   */
+  int GetNumberOfDroppedTimeShiftPackets();
+
+  /**
+   * @copydoc PacketConsumer::GetDecodingWaitTime
+   */
+  double GetDecodingWaitTime();
+
+  /**
+   * @copydoc PacketConsumer::GetPublishingWaitTime
+   */
+  double GetPublishingWaitTime();
+
+  /**
+   * Telemetry of the live pipeline, the rates and times are over the last second, see
+   * LiveTelemetry::Sample
+   */
+  double GetReceivedPacketRate();
+  double GetQueuedPacketRate();
+  double GetDecodedPacketRate();
+  double GetDroppedPacketRate();
+  double GetFrameRate();
+  double GetFrameDecodeTime();
+  double GetMaxFrameDecodeTime();
+  double GetReceiveLatency();
+  double GetMaxReceiveLatency();
+  double GetDecodingWaitRatio();
+  double GetPublishingWaitRatio();
+
+  /**
+   * Lidar packets received, decoded, and dropped because the decoding queue was full, since
+   * the stream was created
+   */
+  vtkIdType GetNumberOfReceivedPackets();
+  vtkIdType GetNumberOfDecodedPackets();
+  vtkIdType GetNumberOfDroppedPackets();
+
+  /**
+   * @copydoc PacketConsumer::GetQueueDepth
+   */
+  int GetDecodingQueueDepth();
+
+  /**
+   * @brief GetFrameStreamingPort TCP port on which the decoded frames are sent to the remote
+   * viewers, coded by FrameCodec, 0 disables it. The streaming settings are used by the next
+   * Start, the sectors are not streamed.
+   */
+  int GetFrameStreamingPort();
+  void SetFrameStreamingPort(int port);
+
+  /**
+   * @copydoc FrameStreamServer::MaximumFrameRate
+   */
+  double GetFrameStreamingRate();
+  void SetFrameStreamingRate(double rate);
+
+  /**
+   * @copydoc FrameCodec::LaserDecimation
+   */
+  int GetFrameStreamingLaserDecimation();
+  void SetFrameStreamingLaserDecimation(int decimation);
+
+  /**
+   * @copydoc FrameCodec::RangeResolution
+   */
+  double GetFrameStreamingRangeResolution();
+  void SetFrameStreamingRangeResolution(double meters);
+
+  /**
+   * Viewers connected to the frame streaming, and frames and bytes sent to them since the
+   * last Start
+   */
+  int GetNumberOfFrameStreamingClients();
+  vtkIdType GetNumberOfStreamedFrames();
+  vtkIdType GetNumberOfStreamedBytes();
+
+  /**
+   * @brief GetSharedMemoryName name of the shared memory object in which the decoded frames are
+   * published for the other processes, with the layout of SharedMemoryFrameRing. An empty
+   * name disables it. The shared memory settings are used by the next Start, the sectors are
+   * not published.
+   */
+  std::string GetSharedMemoryName();
+  void SetSharedMemoryName(const std::string& name);
+
+  /**
+   * @brief GetSharedMemoryNumberOfSlots number of frames kept in the shared memory, a frame
+   * stays readable during this number of frames minus one
+   */
+  int GetSharedMemoryNumberOfSlots();
+  void SetSharedMemoryNumberOfSlots(int numberOfSlots);
+
+  /**
+   * @brief GetSharedMemorySlotSize size of a slot of the shared memory in mebibytes, the larger
+   * frames are not published
+   */
+  int GetSharedMemorySlotSize();
+  void SetSharedMemorySlotSize(int mebibytes);
+
+  /**
+   * Frames published in the shared memory, and frames too large for its slots, since the last
+   * Start
+   */
+  vtkIdType GetNumberOfSharedFrames();
+  vtkIdType GetNumberOfFramesTooLargeToShare();
+
+  /**
+   * @brief GetRos2NodeName name of the ROS 2 node on which the decoded frames and the GPS
+   * fixes are published, as described by Ros2Publisher. An empty name disables it, as does a
+   * VeloView built without ROS 2. The ROS 2 settings are used by the next Start, the sectors
+   * are not published.
+   */
+  std::string GetRos2NodeName();
+  void SetRos2NodeName(const std::string& name);
+
+  /**
+   * @brief GetRos2FrameId frame id of the point clouds and of the fixes
+   */
+  std::string GetRos2FrameId();
+  void SetRos2FrameId(const std::string& frameId);
+
+  /**
+   * @brief GetRos2PointCloudTopic topic of the point clouds, the fixes and the odometry are
+   * published on "fix" and "odom"
+   */
+  std::string GetRos2PointCloudTopic();
+  void SetRos2PointCloudTopic(const std::string& topic);
+
+  /**
+   * Frames published on ROS 2 since the last Start
+   */
+  vtkIdType GetNumberOfRos2Frames();
+
+  /**
+   * @brief GetDisplayedFrameAge time in seconds from the decoding of the first packet of the
+   * last frame given to the pipeline until it was given
+   */
+  double GetDisplayedFrameAge();
+
+  /**
+   * @brief GetTelemetrySummary one line summary of the telemetry, for the status bar
+   */
+  std::string GetTelemetrySummary();
+
   /**
    * @brief GetNeedsUpdate
    * @return true if a new frame is ready
@@ -104,6 +424,8 @@ protected:
 
   virtual int RequestInformation(vtkInformation*, vtkInformationVector**, vtkInformationVector*);
 
+  int FillOutputPortInformation(int port, vtkInformation* info) override;
+
 private:
   vtkLidarStreamInternal* Internal;
   vtkLidarStream(const vtkLidarStream&); // not implemented
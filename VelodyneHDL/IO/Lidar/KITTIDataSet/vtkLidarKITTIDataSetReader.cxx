@@ -1,4 +1,7 @@
 #include "vtkLidarKITTIDataSetReader.h"
+#include "TraceEvents.h"
+#include "ParallelPoints.h"
+#include "LidarDecodingKernels.h"
 
 #include <vtkStreamingDemandDrivenPipeline.h>
 #include <vtkInformationVector.h>
@@ -6,31 +9,20 @@
 #include <vtkPoints.h>
 #include <vtkPointData.h>
 #include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
 #include <vtkPolyData.h>
 #include <vtkMath.h>
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
 #include <sstream>
 
 # include <boost/filesystem.hpp>
+# include <boost/iostreams/device/mapped_file.hpp>
 
 namespace  {
-//-----------------------------------------------------------------------------
-vtkSmartPointer<vtkCellArray> NewVertexCells(vtkIdType numberOfVerts)
-{
-  vtkNew<vtkIdTypeArray> cells;
-  cells->SetNumberOfValues(numberOfVerts * 2);
-  vtkIdType* ids = cells->GetPointer(0);
-  for (vtkIdType i = 0; i < numberOfVerts; ++i)
-  {
-    ids[i * 2] = 1;
-    ids[i * 2 + 1] = i;
-  }
-
-  vtkSmartPointer<vtkCellArray> cellArray = vtkSmartPointer<vtkCellArray>::New();
-  cellArray->SetCells(numberOfVerts, cells.GetPointer());
-  return cellArray;
-}
-
 //-----------------------------------------------------------------------------
 template<typename T>
 vtkSmartPointer<T> CreateDataArray(const char* name, vtkPolyData* pd)
@@ -47,6 +39,18 @@ typedef struct point {
   float z;
   float intensity;
 } point_t;
+
+//! Points converted by a thread at least
+const vtkIdType MinimumPointsPerThread = 16384;
+
+//-----------------------------------------------------------------------------
+// True if the angle of the projection of the point on the XY plane is negative, without
+// computing it: std::atan2(y, x) < 0, including the signed zeros
+bool IsBelowXAxis(const point_t& pt)
+{
+  return pt.y < 0 || (pt.y == 0 && std::signbit(pt.y) && (pt.x < 0 || std::signbit(pt.x)));
+}
+
 }
 
 //-----------------------------------------------------------------------------
@@ -110,75 +114,117 @@ vtkSmartPointer<vtkPolyData> vtkLidarKITTIDataSetReader::GetFrame(int frameNumbe
   vtkSmartPointer<vtkDoubleArray> timestamp = CreateDataArray<vtkDoubleArray>("timestamp", poly);
   vtkSmartPointer<vtkDoubleArray> adjustedTime = CreateDataArray<vtkDoubleArray>("adjustedtime", poly);
 
-  int startFrame = std::max(0, frameNumber);
-  for (int i = startFrame; i <= frameNumber; i++)
+  // produce path to the required .bin file
+  std::stringstream ss;
+  ss << std::setw(10) << std::setfill('0') << std::max(0, frameNumber);
+  std::string filename = this->GetFileName() + ss.str() + ".bin";
+
+  // the file is mapped instead of read, the points are converted straight from the mapping
+  boost::iostreams::mapped_file_source file;
+  try
   {
-    // produce path to the required .bin file
-    std::stringstream ss;
-    ss << std::setw(10) << std::setfill('0') << i;
-    std::string filename = this->GetFileName() + ss.str() + ".bin";
-
-    ifstream is;
-    is.open(filename, ios::binary|ios::in);
-    // get length of file:
-    is.seekg(0, ios::end);
-    int length = is.tellg();
-    is.seekg(0, ios::beg);
-
-    // variable used to detect a laser jump
-    double old_thetaProj = 0;
-    int laser_id = 0;
-
-    // buffer used to read the points
-    char buffer[16];
-    const int nbPoints = length / 16;
-    for (int i = 0; i < nbPoints; i++)
-    {
-      is.read(buffer, 16);
-      point_t* pt;
-      pt = reinterpret_cast<point_t*>(buffer);
-      double x = pt->x;
-      double y = pt->y;
-      double z = pt->z;
+    file.open(filename);
+  }
+  catch (const std::exception& e)
+  {
+    vtkErrorMacro(<< "Failed to open " << filename << ": " << e.what());
+    poly->SetVerts(NewVertexCells(0));
+    return poly;
+  }
+  const point_t* pts = reinterpret_cast<const point_t*>(file.data());
+  vtkIdType nbPoints = static_cast<vtkIdType>(file.size() / sizeof(point_t));
 
-      double radius = sqrt(x*x + y*y + z*z);
-      double thetaProj = 180 / vtkMath::Pi() * std::atan2(pt->y, pt->x);
-      double azimut = 180 / vtkMath::Pi() * std::atan2(pt->x, pt->y);
+  points->SetNumberOfPoints(nbPoints);
+  vtkDoubleArray* arrays[] = { xArray, yArray, zArray, intensityArray, azimutArray,
+    elevationArray, radiusArray, idArray, timestamp, adjustedTime };
+  for (vtkDoubleArray* array : arrays)
+  {
+    array->SetNumberOfTuples(nbPoints);
+  }
+  float* xyz = static_cast<vtkFloatArray*>(points->GetData())->GetPointer(0);
+  double* x = xArray->GetPointer(0);
+  double* y = yArray->GetPointer(0);
+  double* z = zArray->GetPointer(0);
+  double* intensity = intensityArray->GetPointer(0);
+  double* azimut = azimutArray->GetPointer(0);
+  double* elevation = elevationArray->GetPointer(0);
+  double* radius = radiusArray->GetPointer(0);
+  double* laserId = idArray->GetPointer(0);
+  double* time = timestamp->GetPointer(0);
+  double* adjusted = adjustedTime->GetPointer(0);
 
-      if (azimut < 0)
-        azimut = 360 + azimut;
+  // The lasers are stored one after the other, a new laser starts when the projection of the
+  // points on the XY plane crosses the X axis from below. The crossings only depend on the
+  // previous point, so each range counts its crossings while converting its points, and the
+  // laser ids are the running count of the crossings once the counts of the ranges are known.
+  const int numberOfRanges = static_cast<int>(std::max<vtkIdType>(1,
+    std::min<vtkIdType>(GetNumberOfThreads(0), nbPoints / MinimumPointsPerThread)));
+  std::vector<int> crossingsPerRange(numberOfRanges, 0);
+  ParallelFor(nbPoints, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    int crossings = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+      const point_t& pt = pts[i];
+      xyz[3 * i + 0] = pt.x;
+      xyz[3 * i + 1] = pt.y;
+      xyz[3 * i + 2] = pt.z;
+      x[i] = pt.x;
+      y[i] = pt.y;
+      z[i] = pt.z;
+      intensity[i] = pt.intensity;
+      const double projRadius2 = static_cast<double>(pt.x) * pt.x + static_cast<double>(pt.y) * pt.y;
+      radius[i] = std::sqrt(projRadius2 + static_cast<double>(pt.z) * pt.z);
+      elevation[i] = 180 / vtkMath::Pi() * std::atan2(pt.z, std::sqrt(projRadius2));
+      double azimuth = 180 / vtkMath::Pi() * std::atan2(pt.x, pt.y);
+      if (azimuth < 0)
+      {
+        azimuth = 360 + azimuth;
+      }
+      azimut[i] = azimuth;
+      time[i] = azimuth / 360.0;
+      adjusted[i] = time[i];
 
-      if(old_thetaProj < 0 && thetaProj >= 0)
+      // the first point has no predecessor, as if it was on the X axis
+      const bool crossing = i > 0 && IsBelowXAxis(pts[i - 1]) && !IsBelowXAxis(pt);
+      crossings += crossing;
+      laserId[i] = crossings;
+    }
+    crossingsPerRange[range] = crossings;
+  });
+
+  // laser id of the first point of each range
+  std::vector<int> firstLaserOfRange(numberOfRanges, 0);
+  const size_t rangeSize = (nbPoints + numberOfRanges - 1) / numberOfRanges;
+  for (int range = 1; range < numberOfRanges; ++range)
+  {
+    firstLaserOfRange[range] = firstLaserOfRange[range - 1] + crossingsPerRange[range - 1];
+  }
+  const int numberOfLasers = firstLaserOfRange.back() + crossingsPerRange.back() + 1;
+  ParallelFor(nbPoints, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    const int offset = firstLaserOfRange[range];
+    if (offset > 0)
+    {
+      for (size_t i = begin; i < end; ++i)
       {
-        laser_id++;
-        if (laser_id >= this->NbrLaser)
-        {
-          vtkErrorMacro(<< "An error occur while parsing the frame, more than 64 laser where detected. The last point won't be processed")
-          break;
-        }
+        laserId[i] += offset;
       }
-      double projRadius = std::sqrt(pt->x * pt->x + pt->y * pt->y);
-      double elevation = 180 / vtkMath::Pi() * std::atan2(pt->z, projRadius);
-
-      double time = azimut / 360.0;
-
-      // fill the polydata
-      points->InsertNextPoint(pt->x, pt->y, pt->z);
-      xArray->InsertNextValue(pt->x);
-      yArray->InsertNextValue(pt->y);
-      zArray->InsertNextValue(pt->z);
-      radiusArray->InsertNextValue(radius);
-      intensityArray->InsertNextValue(pt->intensity);
-      azimutArray->InsertNextValue(azimut);
-      idArray->InsertNextValue(laser_id);
-      elevationArray->InsertNextValue(elevation);
-      timestamp->InsertNextValue(time);
-      adjustedTime->InsertNextValue(time);
-
-      // update old azimut
-      old_thetaProj = thetaProj;
     }
-    is.close();
+  });
+  if (numberOfLasers > this->NbrLaser)
+  {
+    vtkErrorMacro(<< "An error occur while parsing the frame, more than " << this->NbrLaser
+                  << " laser where detected. The last points won't be processed")
+    // the ids increase, the points of the extra lasers are at the end
+    const size_t range = std::upper_bound(firstLaserOfRange.begin(), firstLaserOfRange.end(),
+      this->NbrLaser - 1) - firstLaserOfRange.begin() - 1;
+    const double* first = std::lower_bound(laserId + range * rangeSize,
+      laserId + std::min<size_t>(nbPoints, (range + 1) * rangeSize), this->NbrLaser);
+    nbPoints = static_cast<vtkIdType>(first - laserId);
+    points->SetNumberOfPoints(nbPoints);
+    for (vtkDoubleArray* array : arrays)
+    {
+      array->SetNumberOfTuples(nbPoints);
+    }
   }
 
   poly->SetVerts(NewVertexCells(poly->GetNumberOfPoints()));
@@ -191,6 +237,7 @@ int vtkLidarKITTIDataSetReader::RequestData(vtkInformation* vtkNotUsed(request),
                                             vtkInformationVector** vtkNotUsed(inputVector),
                                             vtkInformationVector* outputVector)
 {
+  VV_TRACE_SCOPE("vtkLidarKITTIDataSetReader::RequestData");
   vtkPolyData* output = vtkPolyData::GetData(outputVector);
   vtkInformation* info = outputVector->GetInformationObject(0);
 
@@ -0,0 +1,277 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "VelodyneFiringKernel.h"
+
+// The kernels only use separate multiplications and additions, in the same order as the scalar
+// code, so that the results are bit identical. This file must be compiled without floating
+// point contraction (no fused multiply-add), see CMakeLists.txt.
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VELODYNE_FIRING_KERNEL_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VELODYNE_FIRING_KERNEL_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace DataPacketFixedLength;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+inline void ComputeFiringPosition(const FiringCorrectionTable& table, int laser,
+  unsigned short azimuth, unsigned short distance, double distanceResolution,
+  const double* cosTable, const double* sinTable, double& x, double& y, double& z,
+  double& distanceM)
+{
+  // realAzimuth = azimuth/100 - rotationalCorrection
+  // cos(a-b) = cos(a)*cos(b) + sin(a)*sin(b)
+  // sin(a-b) = sin(a)*cos(b) - cos(a)*sin(b)
+  const double cosA = cosTable[azimuth];
+  const double sinA = sinTable[azimuth];
+  const double cosAzimuth =
+    cosA * table.CosRotationalCorrection[laser] + sinA * table.SinRotationalCorrection[laser];
+  const double sinAzimuth =
+    sinA * table.CosRotationalCorrection[laser] - cosA * table.SinRotationalCorrection[laser];
+
+  const double corrected = distance * distanceResolution + table.DistanceCorrection[laser];
+  const double xyDistance =
+    corrected * table.CosVertCorrection[laser] - table.SinVertOffsetCorrection[laser];
+  const double horizontalOffset = table.HorizontalOffsetCorrection[laser];
+
+  x = xyDistance * sinAzimuth - horizontalOffset * cosAzimuth;
+  y = xyDistance * cosAzimuth + horizontalOffset * sinAzimuth;
+  z = corrected * table.SinVertCorrection[laser] + table.VerticalOffsetCorrection[laser];
+  distanceM = corrected;
+}
+
+#if defined(VELODYNE_FIRING_KERNEL_AVX2)
+#if defined(__GNUC__) || defined(__clang__)
+#define VELODYNE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define VELODYNE_TARGET_AVX2
+#endif
+
+//-----------------------------------------------------------------------------
+bool HasAVX2()
+{
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+  {
+    return false;
+  }
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  // the OS must save the ymm registers
+  if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+  {
+    return false;
+  }
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return false;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+VELODYNE_TARGET_AVX2 void ComputeFiringPositionsAVX2(const FiringCorrectionTable& table,
+  int firstLaser, int count, const unsigned short* azimuth, const unsigned short* distance,
+  double distanceResolution, const double* cosTable, const double* sinTable, double* x, double* y,
+  double* z, double* distanceM)
+{
+  const __m256d resolution = _mm256_set1_pd(distanceResolution);
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    const int laser = firstLaser + i;
+    // the lookups are not done with vgatherdpd, which is slower than separate loads on many
+    // processors
+    const __m256d cosA = _mm256_set_pd(cosTable[azimuth[i + 3]], cosTable[azimuth[i + 2]],
+      cosTable[azimuth[i + 1]], cosTable[azimuth[i]]);
+    const __m256d sinA = _mm256_set_pd(sinTable[azimuth[i + 3]], sinTable[azimuth[i + 2]],
+      sinTable[azimuth[i + 1]], sinTable[azimuth[i]]);
+    const __m256d cosRot = _mm256_loadu_pd(table.CosRotationalCorrection + laser);
+    const __m256d sinRot = _mm256_loadu_pd(table.SinRotationalCorrection + laser);
+    const __m256d cosAzimuth =
+      _mm256_add_pd(_mm256_mul_pd(cosA, cosRot), _mm256_mul_pd(sinA, sinRot));
+    const __m256d sinAzimuth =
+      _mm256_sub_pd(_mm256_mul_pd(sinA, cosRot), _mm256_mul_pd(cosA, sinRot));
+
+    const __m256d rawDistance = _mm256_cvtepi32_pd(
+      _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(distance + i))));
+    const __m256d corrected = _mm256_add_pd(
+      _mm256_mul_pd(rawDistance, resolution), _mm256_loadu_pd(table.DistanceCorrection + laser));
+    const __m256d xyDistance =
+      _mm256_sub_pd(_mm256_mul_pd(corrected, _mm256_loadu_pd(table.CosVertCorrection + laser)),
+        _mm256_loadu_pd(table.SinVertOffsetCorrection + laser));
+    const __m256d horizontalOffset = _mm256_loadu_pd(table.HorizontalOffsetCorrection + laser);
+
+    _mm256_storeu_pd(x + i,
+      _mm256_sub_pd(
+        _mm256_mul_pd(xyDistance, sinAzimuth), _mm256_mul_pd(horizontalOffset, cosAzimuth)));
+    _mm256_storeu_pd(y + i,
+      _mm256_add_pd(
+        _mm256_mul_pd(xyDistance, cosAzimuth), _mm256_mul_pd(horizontalOffset, sinAzimuth)));
+    _mm256_storeu_pd(z + i,
+      _mm256_add_pd(_mm256_mul_pd(corrected, _mm256_loadu_pd(table.SinVertCorrection + laser)),
+        _mm256_loadu_pd(table.VerticalOffsetCorrection + laser)));
+    _mm256_storeu_pd(distanceM + i, corrected);
+  }
+
+  // remaining returns, computed here and not by ComputeFiringPositionsScalar, as calling non AVX
+  // code with the upper part of the registers in use is very slow
+  for (; i < count; ++i)
+  {
+    ComputeFiringPosition(table, firstLaser + i, azimuth[i], distance[i], distanceResolution,
+      cosTable, sinTable, x[i], y[i], z[i], distanceM[i]);
+  }
+  _mm256_zeroupper();
+}
+#endif
+
+#if defined(VELODYNE_FIRING_KERNEL_NEON)
+//-----------------------------------------------------------------------------
+void ComputeFiringPositionsNEON(const FiringCorrectionTable& table, int firstLaser, int count,
+  const unsigned short* azimuth, const unsigned short* distance, double distanceResolution,
+  const double* cosTable, const double* sinTable, double* x, double* y, double* z,
+  double* distanceM)
+{
+  const float64x2_t resolution = vdupq_n_f64(distanceResolution);
+  int i = 0;
+  for (; i + 2 <= count; i += 2)
+  {
+    const int laser = firstLaser + i;
+    const float64x2_t cosA =
+      vcombine_f64(vld1_f64(cosTable + azimuth[i]), vld1_f64(cosTable + azimuth[i + 1]));
+    const float64x2_t sinA =
+      vcombine_f64(vld1_f64(sinTable + azimuth[i]), vld1_f64(sinTable + azimuth[i + 1]));
+    const float64x2_t cosRot = vld1q_f64(table.CosRotationalCorrection + laser);
+    const float64x2_t sinRot = vld1q_f64(table.SinRotationalCorrection + laser);
+    const float64x2_t cosAzimuth = vaddq_f64(vmulq_f64(cosA, cosRot), vmulq_f64(sinA, sinRot));
+    const float64x2_t sinAzimuth = vsubq_f64(vmulq_f64(sinA, cosRot), vmulq_f64(cosA, sinRot));
+
+    const double rawDistanceValues[2] = { static_cast<double>(distance[i]),
+      static_cast<double>(distance[i + 1]) };
+    const float64x2_t corrected = vaddq_f64(vmulq_f64(vld1q_f64(rawDistanceValues), resolution),
+      vld1q_f64(table.DistanceCorrection + laser));
+    const float64x2_t xyDistance =
+      vsubq_f64(vmulq_f64(corrected, vld1q_f64(table.CosVertCorrection + laser)),
+        vld1q_f64(table.SinVertOffsetCorrection + laser));
+    const float64x2_t horizontalOffset = vld1q_f64(table.HorizontalOffsetCorrection + laser);
+
+    vst1q_f64(x + i,
+      vsubq_f64(vmulq_f64(xyDistance, sinAzimuth), vmulq_f64(horizontalOffset, cosAzimuth)));
+    vst1q_f64(y + i,
+      vaddq_f64(vmulq_f64(xyDistance, cosAzimuth), vmulq_f64(horizontalOffset, sinAzimuth)));
+    vst1q_f64(z + i, vaddq_f64(vmulq_f64(corrected, vld1q_f64(table.SinVertCorrection + laser)),
+                       vld1q_f64(table.VerticalOffsetCorrection + laser)));
+    vst1q_f64(distanceM + i, corrected);
+  }
+
+  // remaining returns
+  for (; i < count; ++i)
+  {
+    ComputeFiringPosition(table, firstLaser + i, azimuth[i], distance[i], distanceResolution,
+      cosTable, sinTable, x[i], y[i], z[i], distanceM[i]);
+  }
+}
+#endif
+
+typedef void (*FiringKernel)(const FiringCorrectionTable&, int, int, const unsigned short*,
+  const unsigned short*, double, const double*, const double*, double*, double*, double*,
+  double*);
+
+//-----------------------------------------------------------------------------
+FiringKernel SelectFiringKernel(const char*& name)
+{
+#if defined(VELODYNE_FIRING_KERNEL_AVX2)
+  if (HasAVX2())
+  {
+    name = "AVX2";
+    return &ComputeFiringPositionsAVX2;
+  }
+#elif defined(VELODYNE_FIRING_KERNEL_NEON)
+  name = "NEON";
+  return &ComputeFiringPositionsNEON;
+#endif
+  name = "scalar";
+  return &ComputeFiringPositionsScalar;
+}
+
+const char* FiringKernelName = "";
+// the CPU is checked once, when the library is loaded
+const FiringKernel SelectedFiringKernel = SelectFiringKernel(FiringKernelName);
+}
+
+//-----------------------------------------------------------------------------
+void FiringCorrectionTable::Set(const HDLLaserCorrection* corrections)
+{
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    const HDLLaserCorrection& correction = corrections[i];
+    // cos(0) and sin(0) are exactly 1 and 0, so the lasers without rotational correction get
+    // the same azimuth as with the lookup table only
+    this->CosRotationalCorrection[i] = correction.cosRotationalCorrection;
+    this->SinRotationalCorrection[i] = correction.sinRotationalCorrection;
+    this->DistanceCorrection[i] = correction.distanceCorrection;
+    this->CosVertCorrection[i] = correction.cosVertCorrection;
+    this->SinVertCorrection[i] = correction.sinVertCorrection;
+    this->SinVertOffsetCorrection[i] = correction.sinVertOffsetCorrection;
+    this->VerticalOffsetCorrection[i] = correction.verticalOffsetCorrection;
+    this->HorizontalOffsetCorrection[i] = correction.horizontalOffsetCorrection;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ComputeFiringPositionsScalar(const FiringCorrectionTable& table, int firstLaser, int count,
+  const unsigned short* azimuth, const unsigned short* distance, double distanceResolution,
+  const double* cosTable, const double* sinTable, double* x, double* y, double* z,
+  double* distanceM)
+{
+  for (int i = 0; i < count; ++i)
+  {
+    ComputeFiringPosition(table, firstLaser + i, azimuth[i], distance[i], distanceResolution,
+      cosTable, sinTable, x[i], y[i], z[i], distanceM[i]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void ComputeFiringPositions(const FiringCorrectionTable& table, int firstLaser, int count,
+  const unsigned short* azimuth, const unsigned short* distance, double distanceResolution,
+  const double* cosTable, const double* sinTable, double* x, double* y, double* z,
+  double* distanceM)
+{
+  SelectedFiringKernel(table, firstLaser, count, azimuth, distance, distanceResolution, cosTable,
+    sinTable, x, y, z, distanceM);
+}
+
+//-----------------------------------------------------------------------------
+const char* GetFiringKernelName()
+{
+  return FiringKernelName;
+}
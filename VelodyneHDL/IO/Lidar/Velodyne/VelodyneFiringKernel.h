@@ -0,0 +1,85 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VELODYNE_FIRING_KERNEL_H
+#define VELODYNE_FIRING_KERNEL_H
+
+// LOCAL
+#include "vtkDataPacket.h"
+
+/**
+ * \struct FiringCorrectionTable
+ * \brief Per laser corrections used to compute the position of the returns, stored as a
+ *        structure of arrays indexed by the laser id of the firing blocks, so that the returns
+ *        of several lasers can be processed together.
+ */
+struct FiringCorrectionTable
+{
+  double CosRotationalCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double SinRotationalCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double DistanceCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double CosVertCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double SinVertCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double SinVertOffsetCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double VerticalOffsetCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+  double HorizontalOffsetCorrection[DataPacketFixedLength::HDL_MAX_NUM_LASERS];
+
+  /**
+   * @brief Set copy the corrections of all the lasers, their precomputed values
+   * (cosVertCorrection, ...) must be up to date
+   */
+  void Set(const DataPacketFixedLength::HDLLaserCorrection* corrections);
+};
+
+/**
+ * @brief ComputeFiringPositions compute the position and corrected distance of the returns of
+ * several consecutive lasers of a firing block. This does the same computation as
+ * vtkVelodynePacketInterpreter::ComputeCorrectedValues and gives bit identical results. It runs
+ * a vectorized kernel when the CPU supports it (AVX2 on x86, NEON on 64 bits ARM), and a scalar
+ * loop otherwise.
+ * @param table corrections of the lasers
+ * @param firstLaser index in the table of the laser of the first return
+ * @param count number of returns to process
+ * @param azimuth azimuth of each return, in hundredths of degree in [0, 36000)
+ * @param distance raw distance of each return
+ * @param distanceResolution size of a raw distance unit in meter
+ * @param cosTable cosine of the azimuths, indexed by hundredths of degree
+ * @param sinTable sine of the azimuths, indexed by hundredths of degree
+ * @param x[out] x coordinate of each return
+ * @param y[out] y coordinate of each return
+ * @param z[out] z coordinate of each return
+ * @param distanceM[out] corrected distance of each return in meter
+ */
+void ComputeFiringPositions(const FiringCorrectionTable& table, int firstLaser, int count,
+  const unsigned short* azimuth, const unsigned short* distance, double distanceResolution,
+  const double* cosTable, const double* sinTable, double* x, double* y, double* z,
+  double* distanceM);
+
+/**
+ * @brief ComputeFiringPositionsScalar same as ComputeFiringPositions, without vectorization
+ */
+void ComputeFiringPositionsScalar(const FiringCorrectionTable& table, int firstLaser, int count,
+  const unsigned short* azimuth, const unsigned short* distance, double distanceResolution,
+  const double* cosTable, const double* sinTable, double* x, double* y, double* z,
+  double* distanceM);
+
+/**
+ * @brief GetFiringKernelName name of the instruction set used by ComputeFiringPositions
+ */
+const char* GetFiringKernelName();
+
+#endif // VELODYNE_FIRING_KERNEL_H
@@ -0,0 +1,65 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "VelodyneFrameDetector.h"
+
+using namespace DataPacketFixedLength;
+
+//-----------------------------------------------------------------------------
+bool VelodyneFrameDetector::IsLidarPacket(
+  unsigned char const* vtkNotUsed(data), unsigned int dataLength)
+{
+  return dataLength == HDLDataPacket::getDataByteLength();
+}
+
+//-----------------------------------------------------------------------------
+void VelodyneFrameDetector::DetectFrame(
+  unsigned char const* data, unsigned int vtkNotUsed(dataLength), std::vector<Split>& splits)
+{
+  const HDLDataPacket* dataPacket = reinterpret_cast<const HDLDataPacket*>(data);
+  const bool isVLS128 = dataPacket->isVLS128();
+  splits.clear();
+
+  for (int i = 0; i < HDL_FIRING_PER_PKT; ++i)
+  {
+    const HDLFiringData& firingData = dataPacket->firingData[i];
+
+    // Skip dummy blocks of VLS-128 dual mode last 4 blocks
+    if (isVLS128 && (firingData.blockIdentifier == 0 || firingData.blockIdentifier == 0xFFFF))
+    {
+      continue;
+    }
+
+    // Test if at least one laser has a positive distance, once per frame
+    if (!this->Content)
+    {
+      this->Content = !this->IgnoreZeroDistances;
+      for (int laserID = 0; laserID < HDL_LASER_PER_FIRING && !this->Content; laserID++)
+      {
+        this->Content = firingData.laserReturns[laserID].distance != 0;
+      }
+    }
+
+    if (this->State.hasChangedWithValue(firingData))
+    {
+      Split split = { i, this->Content };
+      splits.push_back(split);
+      this->Content = false;
+    }
+  }
+}
@@ -0,0 +1,178 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VELODYNE_FRAME_DETECTOR_H
+#define VELODYNE_FRAME_DETECTOR_H
+
+// LOCAL
+#include "LidarFrameDetector.h"
+#include "vtkDataPacket.h"
+
+// VTK
+#include <vtkObject.h>
+
+/**
+ * \class FramingState
+ * \brief Follow the azimuth of the firing blocks, a frame is split when the direction of the
+ *        rotation changes.
+ */
+class FramingState
+{
+  int FirstAzimuth;
+  int LastAzimuth;
+  int LastAzimuthSlope;
+  bool HasSplit;
+
+public:
+  FramingState() { reset(); }
+  void reset()
+  {
+    FirstAzimuth = -1;
+    LastAzimuth = -1;
+    LastAzimuthSlope = 0;
+    HasSplit = false;
+  }
+  bool hasChangedWithValue(const DataPacketFixedLength::HDLFiringData& firingData)
+  {
+    bool hasLastAzimuth = (LastAzimuth != -1);
+    if (!hasLastAzimuth)
+    {
+      FirstAzimuth = firingData.rotationalPosition;
+    }
+    bool azimuthFrameSplit = hasChangedWithValue(
+      firingData.rotationalPosition, hasLastAzimuth, LastAzimuth, LastAzimuthSlope);
+    HasSplit = HasSplit || azimuthFrameSplit;
+    return azimuthFrameSplit;
+  }
+
+  static bool hasChangedWithValue(int curValue, bool& hasLastValue, int& lastValue, int& lastSlope)
+  {
+    // If we dont have previous value, dont change
+    if (!hasLastValue)
+    {
+      lastValue = curValue;
+      hasLastValue = true;
+      return false;
+    }
+    int curSlope = curValue - lastValue;
+    lastValue = curValue;
+    if (curSlope == 0)
+      return false;
+    int isSlopeSameDirection = curSlope * lastSlope;
+    // curSlope has same sign as lastSlope: no change
+    if (isSlopeSameDirection > 0)
+      return false;
+    // curSlope has different sign as lastSlope: change!
+    else if (isSlopeSameDirection < 0)
+    {
+      lastSlope = 0;
+      return true;
+    }
+    // LastAzimuthSlope not set: set the slope
+    if (lastSlope == 0 && curSlope != 0)
+    {
+      lastSlope = curSlope;
+      return false;
+    }
+    vtkGenericWarningMacro("Unhandled sequence of value in state.");
+    return false;
+  }
+
+  static bool willChangeWithValue(int curValue, bool hasLastValue, int lastValue, int lastSlope)
+  {
+    return hasChangedWithValue(curValue, hasLastValue, lastValue, lastSlope);
+  }
+
+  // Continue with the state of the blocks which follow the ones seen by this state, when they
+  // have been processed from a reset state. Return false, without changing the state, if the
+  // frame would have been split in these blocks.
+  bool append(const FramingState& next)
+  {
+    if (next.HasSplit)
+    {
+      return false;
+    }
+    if (next.FirstAzimuth == -1)
+    {
+      return true;
+    }
+    bool hasLastAzimuth = (LastAzimuth != -1);
+    int lastAzimuth = LastAzimuth;
+    int lastSlope = LastAzimuthSlope;
+    if (hasChangedWithValue(next.FirstAzimuth, hasLastAzimuth, lastAzimuth, lastSlope))
+    {
+      return false;
+    }
+    // the slope of next has been set by its first values, without the ones before them
+    if (lastSlope * next.LastAzimuthSlope < 0)
+    {
+      return false;
+    }
+    if (lastSlope == 0)
+    {
+      lastSlope = next.LastAzimuthSlope;
+    }
+    if (FirstAzimuth == -1)
+    {
+      FirstAzimuth = next.FirstAzimuth;
+    }
+    LastAzimuth = next.LastAzimuth;
+    LastAzimuthSlope = lastSlope;
+    return true;
+  }
+};
+
+/**
+ * \class VelodyneFrameDetector
+ * \brief Frame split detection of the Velodyne packets. It only reads the azimuth of the firing
+ *        blocks and the footer of the packets, and the distances until a valid return is found
+ *        when the zero distances are ignored: there is no calibration involved. Its state is a
+ *        few values, and can be copied.
+ */
+class VelodyneFrameDetector : public LidarFrameDetector
+{
+public:
+  VelodyneFrameDetector(bool ignoreZeroDistances)
+    : IgnoreZeroDistances(ignoreZeroDistances)
+  {
+  }
+
+  bool IsLidarPacket(unsigned char const* data, unsigned int dataLength) override;
+
+  void DetectFrame(
+    unsigned char const* data, unsigned int dataLength, std::vector<Split>& splits) override;
+
+  bool HasContent() override { return this->Content; }
+
+  void ResetContent() override { this->Content = false; }
+
+  /**
+   * @brief Reset forget all the packets seen
+   */
+  void Reset()
+  {
+    this->State.reset();
+    this->Content = false;
+  }
+
+private:
+  FramingState State;
+  bool IgnoreZeroDistances;
+  bool Content = false;
+};
+
+#endif // VELODYNE_FRAME_DETECTOR_H
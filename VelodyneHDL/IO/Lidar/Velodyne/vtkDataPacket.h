@@ -299,6 +299,8 @@ struct HDLLaserCorrection // Internal representation of per-laser correction
   double cosVertCorrection;
   double sinVertOffsetCorrection;
   double cosVertOffsetCorrection;
+  // HDL-64 intensity correction term of the focal distance
+  double focalOffset;
   HDLLaserCorrection()
   {
     rotationalCorrection = verticalCorrection = 0;
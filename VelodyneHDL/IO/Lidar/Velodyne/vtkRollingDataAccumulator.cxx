@@ -14,9 +14,13 @@
 
 #include "vtkRollingDataAccumulator.h"
 
+#include <algorithm>
+#include <cstring>
+
 vtkRollingDataAccumulator::vtkRollingDataAccumulator()
   : beginMarkerValuePair(0, '5', '#')
 {
+  this->clear();
 }
 
 //--------------------------------------------------------------------------------
@@ -25,50 +29,36 @@ vtkRollingDataAccumulator::~vtkRollingDataAccumulator()
 }
 void vtkRollingDataAccumulator::clear()
 {
-  this->beginPosition.clear();
-  this->accumulatedData.clear();
-  this->accumulatedDataType.clear();
-  this->accumulatedValue.clear();
+  this->numberOfValues = 0;
+  this->numberOfMarkers = 0;
+  this->lastMarkerPosition = -1;
+  this->goodSequencePosition = -1;
+  this->numberOfGoodSequences = 0;
 }
 
 void vtkRollingDataAccumulator::appendData(TypeValueDataPair valuePair)
 {
+  const long position = this->numberOfValues;
   if (valuePair.dataType == this->beginMarkerValuePair.dataType &&
     valuePair.dataValue == this->beginMarkerValuePair.dataValue)
   {
-    beginPosition.push_back(this->accumulatedData.size());
+    // the previous sequence is complete if it has the expected length
+    if (this->lastMarkerPosition >= byteBeforeMarker &&
+      position - this->lastMarkerPosition == expectedLength)
+    {
+      this->goodSequencePosition = this->lastMarkerPosition;
+      this->numberOfGoodSequences++;
+    }
+    this->lastMarkerPosition = position;
+    this->numberOfMarkers++;
   }
-  this->accumulatedData.push_back(valuePair);
-  this->accumulatedDataType.push_back(valuePair.dataType);
-  this->accumulatedValue.push_back(valuePair.dataValue);
+  this->accumulatedValue[position % capacity] = valuePair.dataValue;
+  this->numberOfValues++;
 }
 bool vtkRollingDataAccumulator::areRollingDataReady() const
 {
   // We want to have received numberOfRoundNeeded times the data, to be sure.
-  return (this->accumulatedData.size() > this->expectedLength * numberOfRoundNeeded) &&
-    (beginPosition.size() > this->numberOfRoundNeeded - 1);
-}
-bool vtkRollingDataAccumulator::getGoodSequenceId(int& idRollingSequence) const
-{
-  idRollingSequence = 0;
-
-  // Prevent seg fault when beginPosition is empty
-  if (beginPosition.size() < 3)
-    return false;
-
-  while (idRollingSequence < static_cast<int>((beginPosition.size()) - 1) &&
-    (beginPosition[idRollingSequence] < byteBeforeMarker ||
-      ((beginPosition[idRollingSequence + 1] - beginPosition[idRollingSequence]) !=
-        expectedLength)))
-  {
-    idRollingSequence++;
-  }
-  if (idRollingSequence == static_cast<int>(beginPosition.size()) - 1)
-  {
-    idRollingSequence = -1;
-    return false;
-  }
-  return true;
+  return (this->numberOfValues > capacity) && (this->numberOfMarkers > numberOfRoundNeeded - 1);
 }
 
 void vtkRollingDataAccumulator::appendData(
@@ -79,12 +69,17 @@ void vtkRollingDataAccumulator::appendData(
 bool vtkRollingDataAccumulator::getAlignedRollingData(std::vector<unsigned char>& data) const
 {
   data.clear();
-  int idRollingSequence = 0;
-  if (!this->areRollingDataReady() || !getGoodSequenceId(idRollingSequence))
+  // the sequence must not have been overwritten by the values received after it
+  if (!this->areRollingDataReady() || this->goodSequencePosition < 0 ||
+    this->numberOfValues - this->goodSequencePosition > capacity)
   {
     return false;
   }
-  data.resize(expectedLength);
-  memcpy(&data[0], &accumulatedValue[beginPosition[idRollingSequence]], expectedLength);
+  const long length = expectedLength;
+  data.resize(length);
+  const long begin = this->goodSequencePosition % capacity;
+  const long firstPart = std::min(length, capacity - begin);
+  memcpy(&data[0], &this->accumulatedValue[begin], firstPart);
+  memcpy(&data[firstPart], &this->accumulatedValue[0], length - firstPart);
   return true;
 }
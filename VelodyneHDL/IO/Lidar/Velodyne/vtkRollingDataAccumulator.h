@@ -29,15 +29,25 @@ struct TypeValueDataPair
   }
 };
 
+// Accumulate the status bytes of the HDL-64 packets to extract the rolling calibration.
+// The values are kept in a ring of numberOfRoundNeeded sequences, and the markers which start
+// a sequence are tracked as the values are appended, so that no step rescans the data.
 class vtkRollingDataAccumulator
 {
+private:
+  static const long expectedLength = 4160;
+  static const int numberOfRoundNeeded = 3;
+  static const int byteBeforeMarker = 6;
+  static const long capacity = expectedLength * numberOfRoundNeeded;
+
 public:
   void appendData(TypeValueDataPair valuePair);
   void appendData(unsigned int timestamp, unsigned char dataType, unsigned char dataValue);
   void setTotalExpectedDataLength();
   bool areRollingDataReady() const;
   bool getDSRCalibrationData() const;
-  bool getGoodSequenceId(int& idRollingSequence) const;
+  // Number of complete sequences received, the aligned data change when it increases
+  unsigned long getNumberOfGoodSequences() const { return this->numberOfGoodSequences; }
   bool getAlignedRollingData(std::vector<unsigned char>& data) const;
   void clear();
   vtkRollingDataAccumulator();
@@ -50,15 +60,16 @@ public:
   }
 
 protected:
-  std::vector<TypeValueDataPair> accumulatedData;
-  std::vector<unsigned char> accumulatedDataType;
-  std::vector<unsigned char> accumulatedValue;
-  std::vector<long> beginPosition;
+  // value of the position p of the stream is at p % capacity
+  unsigned char accumulatedValue[capacity];
+  long numberOfValues;
+  long numberOfMarkers;
+  long lastMarkerPosition;
+  // position of the marker of the last sequence followed by the marker of the next one
+  long goodSequencePosition;
+  unsigned long numberOfGoodSequences;
 
 private:
-  static const long expectedLength = 4160;
-  static const int numberOfRoundNeeded = 3;
-  static const int byteBeforeMarker = 6;
   const TypeValueDataPair beginMarkerValuePair;
 };
 #endif // VTKROLLINGDATAACCUMULATOR_H
@@ -1,8 +1,27 @@
 #include "vtkVelodynePacketInterpreter.h"
-
+#include "TraceEvents.h"
+#include "DecodedFrameFile.h"
+#include "LidarDecodingKernels.h"
+#include "LidarFrameDetector.h"
+#include "LidarInterpreterRegistry.h"
+#include "LidarSectorAssembler.h"
+#include "ParallelPoints.h"
+#include "VelodyneFiringKernel.h"
+#include "VelodyneFrameDetector.h"
+#include "vtkTemporalTransforms.h"
+#include "vtkVelodyneTransformInterpolator.h"
+
+#include <vtkDataArraySelection.h>
+#include <vtkDataSet.h>
 #include <vtkPoints.h>
 #include <vtkPointData.h>
 #include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkIntArray.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedShortArray.h>
+#include <vtkMatrix4x4.h>
 #include <vtkTransform.h>
 
 #include <boost/property_tree/xml_parser.hpp>
@@ -11,6 +30,15 @@
 #include "vtkDataPacket.h"
 #include "vtkRollingDataAccumulator.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <new>
+#include <sstream>
+
 using namespace DataPacketFixedLength;
 
 #define PacketProcessingDebugMacro(x)                                                              \
@@ -21,27 +49,6 @@ using namespace DataPacketFixedLength;
     }                                                                                              \
   }
 
-//namespace
-//{
-//! @todo this method are actually usefull for every Interpreter and should go to the top
-template<typename T>
-vtkSmartPointer<T> CreateDataArray(const char* name, vtkIdType np, vtkIdType prereserved_np, vtkPolyData* pd)
-{
-  vtkSmartPointer<T> array = vtkSmartPointer<T>::New();
-  array->Allocate(prereserved_np);
-  array->SetName(name);
-  if (np > 0)
-  {
-    array->SetNumberOfTuples(np);
-  }
-  if (pd)
-  {
-    pd->GetPointData()->AddArray(array);
-  }
-
-  return array;
-}
-
 // Structure to compute RPM and handle degenerated cases
 struct RPMCalculator
 {
@@ -95,6 +102,33 @@ struct RPMCalculator
     return dAngle / dTime;
   }
 
+  // Add the data of another calculator, as if its packets had been added to this one
+  void Merge(const RPMCalculator& other)
+  {
+    if (other.ValueReady[0] && other.MinAngle < this->MinAngle)
+    {
+      this->MinAngle = other.MinAngle;
+      this->ValueReady[0] = true;
+    }
+    if (other.ValueReady[1] && other.MaxAngle > this->MaxAngle)
+    {
+      this->MaxAngle = other.MaxAngle;
+      this->ValueReady[1] = true;
+    }
+    if (other.ValueReady[2] && other.MinTime < this->MinTime)
+    {
+      this->MinTime = other.MinTime;
+      this->ValueReady[2] = true;
+    }
+    if (other.ValueReady[3] && other.MaxTime > this->MaxTime)
+    {
+      this->MaxTime = other.MaxTime;
+      this->ValueReady[3] = true;
+    }
+    this->IsReady = this->ValueReady[0] && this->ValueReady[1] && this->ValueReady[2] &&
+      this->ValueReady[3];
+  }
+
   void AddData(const HDLDataPacket* HDLPacket, unsigned int rawtime)
   {
     if (HDLPacket->firingData[0].rotationalPosition < this->MinAngle)
@@ -128,6 +162,174 @@ struct RPMCalculator
   }
 };
 
+//-----------------------------------------------------------------------------
+// Highest firing rate of the Velodyne sensors per laser (HDL-32: one firing every 46.08us), used
+// to plan the capacity of the frames.
+const double MaximumFiringRate = 1.0 / 46.08e-6;
+// Timestamps are given in microseconds since the top of the hour
+const double HourInMicroseconds = 3600.0 * 1e6;
+
+//-----------------------------------------------------------------------------
+// Below this rotation speed the sensor is not spinning, the capacity is not planned for longer
+// rotations which would never be completed.
+const double MinimumRPM = 300.0;
+
+//-----------------------------------------------------------------------------
+// Structure of arrays holding the points of the frame under construction.
+// The capacity is planned when the frame is created, so that adding a point
+// is only a few stores, without the bound check and growth of InsertNextValue.
+struct VelodyneFrameBuilder
+{
+  vtkIdType NumberOfPoints = 0;
+  vtkIdType Capacity = 0;
+
+  FrameColumn<float> Points; // 3 components
+  FrameColumn<double> PointsX;
+  FrameColumn<double> PointsY;
+  FrameColumn<double> PointsZ;
+  FrameColumn<unsigned char> Intensity;
+  FrameColumn<unsigned char> LaserId;
+  FrameColumn<unsigned short> Azimuth;
+  FrameColumn<double> Distance;
+  FrameColumn<unsigned short> DistanceRaw;
+  FrameColumn<double> Timestamp;
+  FrameColumn<double> VerticalAngle;
+  FrameColumn<unsigned int> RawTime;
+  FrameColumn<int> IntensityFlag;
+  FrameColumn<int> DistanceFlag;
+  FrameColumn<unsigned int> Flags;
+  FrameColumn<vtkIdType> DualReturnMatching;
+
+  // Start a new frame which can hold capacity points without growing
+  void Reset(vtkIdType capacity)
+  {
+    this->NumberOfPoints = 0;
+    this->Capacity = 0;
+    this->Reallocate(std::max<vtkIdType>(capacity, 1));
+  }
+
+  // Add a point and return its id, its values must then be set in every array
+  vtkIdType AddPoint()
+  {
+    if (this->NumberOfPoints == this->Capacity)
+    {
+      // the capacity was under estimated
+      this->Reallocate(this->Capacity + this->Capacity / 2 + 1);
+    }
+    return this->NumberOfPoints++;
+  }
+
+  // Append the points of another frame, the ids of the matching dual returns are shifted
+  void Append(const VelodyneFrameBuilder& other)
+  {
+    const vtkIdType offset = this->NumberOfPoints;
+    const vtkIdType n = other.NumberOfPoints;
+    if (offset + n > this->Capacity)
+    {
+      this->Reallocate(offset + n);
+    }
+    this->Points.CopyFrom(other.Points, 3 * offset, 3 * n);
+    this->PointsX.CopyFrom(other.PointsX, offset, n);
+    this->PointsY.CopyFrom(other.PointsY, offset, n);
+    this->PointsZ.CopyFrom(other.PointsZ, offset, n);
+    this->Intensity.CopyFrom(other.Intensity, offset, n);
+    this->LaserId.CopyFrom(other.LaserId, offset, n);
+    this->Azimuth.CopyFrom(other.Azimuth, offset, n);
+    this->Distance.CopyFrom(other.Distance, offset, n);
+    this->DistanceRaw.CopyFrom(other.DistanceRaw, offset, n);
+    this->Timestamp.CopyFrom(other.Timestamp, offset, n);
+    this->VerticalAngle.CopyFrom(other.VerticalAngle, offset, n);
+    this->RawTime.CopyFrom(other.RawTime, offset, n);
+    this->IntensityFlag.CopyFrom(other.IntensityFlag, offset, n);
+    this->DistanceFlag.CopyFrom(other.DistanceFlag, offset, n);
+    this->Flags.CopyFrom(other.Flags, offset, n);
+    for (vtkIdType i = 0; i < n; ++i)
+    {
+      const vtkIdType matching = other.DualReturnMatching.Data[i];
+      this->DualReturnMatching.Data[offset + i] = matching >= 0 ? matching + offset : matching;
+    }
+    this->NumberOfPoints += n;
+  }
+
+  void Reallocate(vtkIdType capacity)
+  {
+    this->Points.Reallocate(3 * capacity);
+    this->PointsX.Reallocate(capacity);
+    this->PointsY.Reallocate(capacity);
+    this->PointsZ.Reallocate(capacity);
+    this->Intensity.Reallocate(capacity);
+    this->LaserId.Reallocate(capacity);
+    this->Azimuth.Reallocate(capacity);
+    this->Distance.Reallocate(capacity);
+    this->DistanceRaw.Reallocate(capacity);
+    this->Timestamp.Reallocate(capacity);
+    this->VerticalAngle.Reallocate(capacity);
+    this->RawTime.Reallocate(capacity);
+    this->IntensityFlag.Reallocate(capacity);
+    this->DistanceFlag.Reallocate(capacity);
+    this->Flags.Reallocate(capacity);
+    this->DualReturnMatching.Reallocate(capacity);
+    this->Capacity = capacity;
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Frames given by the interpreter, kept so that the buffers of their arrays are
+// reused by the frame builder once the consumer of the frames has released
+// them, instead of allocating new buffers for each frame.
+struct FrameRecycler
+{
+  // Frames which have been given after the last one are dropped
+  static const size_t MaximumNumberOfFrames = 4;
+
+  std::deque<vtkSmartPointer<vtkPolyData> > Frames;
+
+  void Add(vtkPolyData* frame)
+  {
+    this->Frames.push_back(frame);
+    if (this->Frames.size() > MaximumNumberOfFrames)
+    {
+      this->Frames.pop_front();
+    }
+  }
+
+  // Give the buffers of a frame which is not used anymore to the columns of the builder
+  // which have none, the frame is then forgotten
+  void Recycle(VelodyneFrameBuilder& builder)
+  {
+    for (auto it = this->Frames.begin(); it != this->Frames.end(); ++it)
+    {
+      vtkPolyData* frame = *it;
+      if (frame->GetReferenceCount() != 1 ||
+        (frame->GetPoints() && frame->GetPoints()->GetReferenceCount() != 1))
+      {
+        continue;
+      }
+      vtkPointData* pointData = frame->GetPointData();
+      if (frame->GetPoints())
+      {
+        RecycleColumn(builder.Points, frame->GetPoints()->GetData());
+      }
+      RecycleColumn(builder.PointsX, pointData->GetArray("X"));
+      RecycleColumn(builder.PointsY, pointData->GetArray("Y"));
+      RecycleColumn(builder.PointsZ, pointData->GetArray("Z"));
+      RecycleColumn(builder.Intensity, pointData->GetArray("intensity"));
+      RecycleColumn(builder.LaserId, pointData->GetArray("laser_id"));
+      RecycleColumn(builder.Azimuth, pointData->GetArray("azimuth"));
+      RecycleColumn(builder.Distance, pointData->GetArray("distance_m"));
+      RecycleColumn(builder.DistanceRaw, pointData->GetArray("distance_raw"));
+      RecycleColumn(builder.Timestamp, pointData->GetArray("adjustedtime"));
+      RecycleColumn(builder.VerticalAngle, pointData->GetArray("vertical_angle"));
+      RecycleColumn(builder.RawTime, pointData->GetArray("timestamp"));
+      RecycleColumn(builder.IntensityFlag, pointData->GetArray("dual_intensity"));
+      RecycleColumn(builder.DistanceFlag, pointData->GetArray("dual_distance"));
+      RecycleColumn(builder.DualReturnMatching, pointData->GetArray("dual_return_matching"));
+      this->Frames.erase(it);
+      return;
+    }
+  }
+};
+
 //-----------------------------------------------------------------------------
 int MapFlags(unsigned int flags, unsigned int low, unsigned int high)
 {
@@ -148,6 +350,16 @@ int MapIntensityFlag(unsigned int flags)
     vtkVelodynePacketInterpreter::DUAL_INTENSITY_LOW, vtkVelodynePacketInterpreter::DUAL_INTENSITY_HIGH);
 }
 
+//-----------------------------------------------------------------------------
+//! Norm of the offset between the position of a return and its corrected distance along the
+//! laser direction (see ComputeFiringPositions)
+double LaserOffset(const HDLLaserCorrection& correction)
+{
+  return std::sqrt(correction.horizontalOffsetCorrection * correction.horizontalOffsetCorrection +
+    correction.verticalOffsetCorrection * correction.verticalOffsetCorrection *
+      (1.0 + correction.sinVertCorrection * correction.sinVertCorrection));
+}
+
 //-----------------------------------------------------------------------------
 double HDL32AdjustTimeStamp(int firingblock, int dsr, const bool isDualReturnMode)
 {
@@ -220,64 +432,205 @@ double VLS128AdjustTimeStamp(int firingblock, int dsr, const bool isDualReturnMo
   }
 }
 
-
 //-----------------------------------------------------------------------------
-class FramingState
+// Timing policies of the sensor families: time of a return relative to the
+// packet timestamp, and number of blocks of a firing sequence
+struct VLS128Timing
 {
-  int LastAzimuth;
-  int LastAzimuthSlope;
+  static double AdjustTimeStamp(int firingBlock, int dsr, bool isDualReturnMode)
+  {
+    return VLS128AdjustTimeStamp(firingBlock, dsr, isDualReturnMode);
+  }
+  static int BlocksPerSequence(bool isDualReturnMode) { return isDualReturnMode ? 8 : 4; }
+};
 
-public:
-  FramingState() { reset(); }
-  void reset()
+struct HDL64Timing
+{
+  static double AdjustTimeStamp(int firingBlock, int dsr, bool isDualReturnMode)
   {
-    LastAzimuth = -1;
-    LastAzimuthSlope = 0;
+    return -HDL64EAdjustTimeStamp(firingBlock, dsr, isDualReturnMode);
   }
-  bool hasChangedWithValue(const HDLFiringData& firingData)
+  static int BlocksPerSequence(bool isDualReturnMode) { return isDualReturnMode ? 4 : 2; }
+};
+
+struct VLP32Timing
+{
+  static double AdjustTimeStamp(int firingBlock, int dsr, bool isDualReturnMode)
   {
-    bool hasLastAzimuth = (LastAzimuth != -1);
-    bool azimuthFrameSplit = hasChangedWithValue(
-      firingData.rotationalPosition, hasLastAzimuth, LastAzimuth, LastAzimuthSlope);
-    return azimuthFrameSplit;
+    return VLP32AdjustTimeStamp(firingBlock, dsr, isDualReturnMode);
   }
+  static int BlocksPerSequence(bool isDualReturnMode) { return isDualReturnMode ? 2 : 1; }
+};
 
-  static bool hasChangedWithValue(int curValue, bool& hasLastValue, int& lastValue, int& lastSlope)
+struct HDL32Timing
+{
+  static double AdjustTimeStamp(int firingBlock, int dsr, bool isDualReturnMode)
   {
-    // If we dont have previous value, dont change
-    if (!hasLastValue)
-    {
-      lastValue = curValue;
-      hasLastValue = true;
-      return false;
-    }
-    int curSlope = curValue - lastValue;
-    lastValue = curValue;
-    if (curSlope == 0)
-      return false;
-    int isSlopeSameDirection = curSlope * lastSlope;
-    // curSlope has same sign as lastSlope: no change
-    if (isSlopeSameDirection > 0)
-      return false;
-    // curSlope has different sign as lastSlope: change!
-    else if (isSlopeSameDirection < 0)
-    {
-      lastSlope = 0;
-      return true;
-    }
-    // LastAzimuthSlope not set: set the slope
-    if (lastSlope == 0 && curSlope != 0)
+    return HDL32AdjustTimeStamp(firingBlock, dsr, isDualReturnMode);
+  }
+  static int BlocksPerSequence(bool isDualReturnMode) { return isDualReturnMode ? 2 : 1; }
+};
+
+struct VLP16Timing
+{
+  static double AdjustTimeStamp(int firingBlock, int dsr, bool isDualReturnMode)
+  {
+    // a block holds two firings of the 16 lasers
+    return VLP16AdjustTimeStamp(firingBlock, dsr % 16, dsr / 16, isDualReturnMode);
+  }
+  static int BlocksPerSequence(bool isDualReturnMode) { return isDualReturnMode ? 2 : 1; }
+};
+
+// Unknown sensor: no adjustment
+struct NoTiming
+{
+};
+
+//-----------------------------------------------------------------------------
+// Intra firing adjustments of each return, which only depend on the position
+// of the return in the packet. Indexed by [dual return][firing block][dsr].
+struct FiringTimingTable
+{
+  //! calibration the table was built for
+  int NumberOfLasers = -1;
+  bool IsVLP32 = false;
+
+  //! offset of the return timestamp in microseconds, rounded
+  double TimestampOffset[2][HDL_FIRING_PER_PKT][HDL_LASER_PER_FIRING];
+  //! fraction of the azimuth difference between blocks to add to the azimuth of the return
+  double AzimuthRatio[2][HDL_FIRING_PER_PKT][HDL_LASER_PER_FIRING];
+};
+
+//-----------------------------------------------------------------------------
+template<typename Timing>
+void FillTimingTable(FiringTimingTable& table)
+{
+  for (int dual = 0; dual < 2; ++dual)
+  {
+    const bool isDualReturnMode = dual != 0;
+    for (int firingBlock = 0; firingBlock < HDL_FIRING_PER_PKT; ++firingBlock)
     {
-      lastSlope = curSlope;
-      return false;
+      const double blockdsr0 = Timing::AdjustTimeStamp(firingBlock, 0, isDualReturnMode);
+      const double nextblockdsr0 = Timing::AdjustTimeStamp(
+        firingBlock + Timing::BlocksPerSequence(isDualReturnMode), 0, isDualReturnMode);
+      for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; ++dsr)
+      {
+        const double timestampadjustment =
+          Timing::AdjustTimeStamp(firingBlock, dsr, isDualReturnMode);
+        table.AzimuthRatio[dual][firingBlock][dsr] =
+          (timestampadjustment - blockdsr0) / (nextblockdsr0 - blockdsr0);
+        table.TimestampOffset[dual][firingBlock][dsr] = vtkMath::Round(timestampadjustment);
+      }
     }
-    vtkGenericWarningMacro("Unhandled sequence of value in state.");
-    return false;
   }
+}
+
+//-----------------------------------------------------------------------------
+template<>
+void FillTimingTable<NoTiming>(FiringTimingTable& table)
+{
+  std::fill_n(&table.TimestampOffset[0][0][0], 2 * HDL_FIRING_PER_PKT * HDL_LASER_PER_FIRING, 0.0);
+  std::fill_n(&table.AzimuthRatio[0][0][0], 2 * HDL_FIRING_PER_PKT * HDL_LASER_PER_FIRING, 0.0);
+}
+
+//-----------------------------------------------------------------------------
+// Layout of the packets of the sensor families. ProcessPacketFor and
+// ProcessFiringFor are instantiated once per family, so that the packet loop
+// does not check the sensor type. GenericFamily keeps the runtime checks for
+// the data which does not match any family (e.g. HDL-64 data with a VLP-16
+// calibration).
+struct VLP16Family
+{
+  static bool IsHDL64(bool) { return false; }
+  static bool IsVLS128(const HDLDataPacket*) { return false; }
+  static bool HasVLP16Calibration(int) { return true; }
+  static bool IsDualModeReturn(const HDLDataPacket* dataPacket)
+  {
+    return dataPacket->isDualModeReturn16Or32();
+  }
+  static bool IsDualReturnFiringBlock(const HDLDataPacket* dataPacket, int firingBlock)
+  {
+    return dataPacket->isDualModeReturn16Or32() &&
+      HDLDataPacket::isDualBlockOfDualPacket16Or32(firingBlock);
+  }
+};
+
+// HDL-32 and VLP-32, their timings only differ in the timing table
+struct Sensor32Family : VLP16Family
+{
+  static bool HasVLP16Calibration(int) { return false; }
+};
+
+struct HDL64Family
+{
+  static bool IsHDL64(bool) { return true; }
+  static bool IsVLS128(const HDLDataPacket*) { return false; }
+  static bool HasVLP16Calibration(int) { return false; }
+  static bool IsDualModeReturn(const HDLDataPacket* dataPacket)
+  {
+    return dataPacket->isDualModeReturnHDL64();
+  }
+  static bool IsDualReturnFiringBlock(const HDLDataPacket* dataPacket, int firingBlock)
+  {
+    return dataPacket->isDualModeReturnHDL64() &&
+      HDLDataPacket::isDualBlockOfDualPacket64(firingBlock);
+  }
+};
+
+struct VLS128Family
+{
+  static bool IsHDL64(bool) { return false; }
+  static bool IsVLS128(const HDLDataPacket*) { return true; }
+  static bool HasVLP16Calibration(int) { return false; }
+  static bool IsDualModeReturn(const HDLDataPacket* dataPacket)
+  {
+    return dataPacket->isDualModeReturnVLS128();
+  }
+  static bool IsDualReturnFiringBlock(const HDLDataPacket* dataPacket, int firingBlock)
+  {
+    return dataPacket->isDualModeReturnVLS128() &&
+      HDLDataPacket::isDualBlockOfDualPacket128(firingBlock);
+  }
+};
+
+struct GenericFamily
+{
+  static bool IsHDL64(bool isHDL64Data) { return isHDL64Data; }
+  static bool IsVLS128(const HDLDataPacket* dataPacket) { return dataPacket->isVLS128(); }
+  static bool HasVLP16Calibration(int numberOfLasers) { return numberOfLasers == 16; }
+  static bool IsDualModeReturn(const HDLDataPacket* dataPacket)
+  {
+    return dataPacket->isDualModeReturn();
+  }
+  static bool IsDualReturnFiringBlock(const HDLDataPacket* dataPacket, int firingBlock)
+  {
+    return dataPacket->isDualReturnFiringBlock(firingBlock);
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Last return added for each laser, so that the second return of a dual return
+// pair is matched without reading back the columns of the frame
+struct DualReturnTracker
+{
+  struct LaserReturn
+  {
+    vtkIdType PointId;
+    double Distance;
+    // as stored in the frame
+    unsigned char Intensity;
+    unsigned int Flags;
+  };
+  LaserReturn Lasers[HDL_MAX_NUM_LASERS];
 
-  static bool willChangeWithValue(int curValue, bool hasLastValue, int lastValue, int lastSlope)
+  DualReturnTracker() { this->Reset(); }
+
+  void Reset()
   {
-    return hasChangedWithValue(curValue, hasLastValue, lastValue, lastSlope);
+    for (LaserReturn& laser : this->Lasers)
+    {
+      laser.PointId = -1;
+    }
   }
 };
 
@@ -440,6 +793,9 @@ struct last4cyclesByte
 //-----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkVelodynePacketInterpreter)
 
+//-----------------------------------------------------------------------------
+static LidarInterpreterRegistrar<vtkVelodynePacketInterpreter> VelodyneRegistrar("Velodyne");
+
 //-----------------------------------------------------------------------------
 vtkVelodynePacketInterpreter::vtkVelodynePacketInterpreter()
 {
@@ -450,12 +806,26 @@ vtkVelodynePacketInterpreter::vtkVelodynePacketInterpreter()
   this->OutputPacketProcessingDebugInfo = false;
   this->SensorPowerMode = 0;
   this->CurrentFrameState = new FramingState;
+  this->PacketDetector = nullptr;
+  this->FrameBuilder = new VelodyneFrameBuilder;
+  this->RangeImage = new RangeImageBuilder;
+  this->Statistics = new LaserStatistics;
+  this->SelectedDualReturns = new DualReturnSelection;
+  this->TimingTable = new FiringTimingTable;
+  this->CropTest = new SphericalCropTest;
+  this->PacketDecoder = nullptr;
   this->LastTimestamp = std::numeric_limits<unsigned int>::max();
+  this->FirstTimestamp = 0;
   this->TimeAdjust = std::numeric_limits<double>::quiet_NaN();
   this->FiringsSkip = 0;
   this->ShouldCheckSensor = true;
 
-  std::fill(this->LastPointId, this->LastPointId + HDL_MAX_NUM_LASERS, -1);
+  this->LastReturns = new DualReturnTracker;
+  this->Recycler = new FrameRecycler;
+  this->SectorStart = 0;
+  this->SectorEnd = 0;
+  this->CurrentSector = -1;
+  this->FrameCounter = 0;
 
   this->LaserSelection.resize(HDL_MAX_NUM_LASERS, true);
   this->DualReturnFilter = 0;
@@ -465,7 +835,18 @@ vtkVelodynePacketInterpreter::vtkVelodynePacketInterpreter()
   this->DistanceResolutionM = 0.002;
   this->WantIntensityCorrection = false;
 
+  this->UseSinglePrecision = false;
+  this->PointArraySelection = vtkSmartPointer<vtkDataArraySelection>::New();
+  const char* outputArrays[] = { "X", "Y", "Z", "intensity", "laser_id", "azimuth", "distance_m",
+    "distance_raw", "adjustedtime", "timestamp", "vertical_angle", "dual_distance",
+    "dual_intensity", "dual_return_matching" };
+  for (const char* name : outputArrays)
+  {
+    this->PointArraySelection->AddArray(name);
+  }
+
   this->rollingCalibrationData = new vtkRollingDataAccumulator();
+  this->RollingCalibrationSequence = 0;
   this->Init();
 }
 
@@ -476,6 +857,15 @@ vtkVelodynePacketInterpreter::~vtkVelodynePacketInterpreter()
     delete this->rollingCalibrationData;
   }
   delete this->CurrentFrameState;
+  delete this->PacketDetector;
+  delete this->FrameBuilder;
+  delete this->RangeImage;
+  delete this->Statistics;
+  delete this->TimingTable;
+  delete this->CropTest;
+  delete this->SelectedDualReturns;
+  delete this->LastReturns;
+  delete this->Recycler;
 }
 
 //-----------------------------------------------------------------------------
@@ -716,6 +1106,7 @@ void vtkVelodynePacketInterpreter::LoadCalibration(const std::string& filename)
 //-----------------------------------------------------------------------------
 void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, unsigned int dataLength, int startPosition)
 {
+  VV_TRACE_SCOPE("vtkVelodynePacketInterpreter::ProcessPacket");
   if (!this->IsLidarPacket(data, dataLength))
   {
     return;
@@ -723,7 +1114,11 @@ void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, uns
 
   const HDLDataPacket* dataPacket = reinterpret_cast<const HDLDataPacket*>(data);
 
-  this->IsHDL64Data |= dataPacket->isHDL64();
+  if (!this->IsHDL64Data && dataPacket->isHDL64())
+  {
+    this->IsHDL64Data = true;
+    this->PacketDecoder = nullptr;
+  }
 
   // Accumulate HDL64 Status byte data
   if (IsHDL64Data && this->IsCorrectionFromLiveStream &&
@@ -750,47 +1145,97 @@ void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, uns
   // transform
   if (SensorTransform) this->SensorTransform->Update();
 
-  int firingBlock = startPosition;
-
-  bool isVLS128 = dataPacket->isVLS128();
-  // Compute the list of total azimuth advanced during one full firing block
-  std::vector<int> diffs(HDL_FIRING_PER_PKT - 1);
-  for (int i = 0; i < HDL_FIRING_PER_PKT - 1; ++i)
+  if (this->CropMode == CROP_MODE::Spherical)
   {
-    int localDiff = (36000 + 18000 + dataPacket->firingData[i + 1].rotationalPosition -
-                      dataPacket->firingData[i].rotationalPosition) %
-      36000 - 18000;
-    diffs[i] = localDiff;
+    this->UpdateSphericalCropTest();
   }
 
-
   if (!IsHDL64Data)
   { // with HDL64, it should be filled by LoadCorrectionsFromStreamData
     this->ReportedSensor = dataPacket->getSensorType();
     this->ReportedSensorReturnMode = dataPacket->getDualReturnSensorMode();
   }
 
-  std::sort(diffs.begin(), diffs.end());
-  // Assume the median of the packet's rotationalPosition differences
-  int azimuthDiff = diffs[HDL_FIRING_PER_PKT / 2];
+  if (!this->PacketDecoder)
+  {
+    this->PacketDecoder = this->SelectPacketDecoder(dataPacket);
+  }
+  (this->*PacketDecoder)(dataPacket, startPosition, timestamp, rawtime);
+
+  if (this->SectorSize > 0)
+  {
+    this->SplitSectors(false);
+  }
+}
+
+//-----------------------------------------------------------------------------
+vtkVelodynePacketInterpreter::PacketDecoderType vtkVelodynePacketInterpreter::SelectPacketDecoder(
+  const HDLDataPacket* dataPacket)
+{
+  const bool isVLS128 = dataPacket->isVLS128();
+  const bool hasVLP16Calibration = this->CalibrationReportedNumLasers == 16;
+  if (hasVLP16Calibration || (this->IsHDL64Data && isVLS128))
+  {
+    if (!this->IsHDL64Data && !isVLS128)
+    {
+      return &vtkVelodynePacketInterpreter::ProcessPacketFor<VLP16Family>;
+    }
+    return &vtkVelodynePacketInterpreter::ProcessPacketFor<GenericFamily>;
+  }
   if (this->IsHDL64Data)
   {
-    azimuthDiff = diffs[HDL_FIRING_PER_PKT - 2];
+    return &vtkVelodynePacketInterpreter::ProcessPacketFor<HDL64Family>;
+  }
+  if (isVLS128)
+  {
+    return &vtkVelodynePacketInterpreter::ProcessPacketFor<VLS128Family>;
   }
-  else if (isVLS128)
+  return &vtkVelodynePacketInterpreter::ProcessPacketFor<Sensor32Family>;
+}
+
+//-----------------------------------------------------------------------------
+template<typename Family>
+void vtkVelodynePacketInterpreter::ProcessPacketFor(
+  const HDLDataPacket* dataPacket, int startPosition, double timestamp, unsigned int rawtime)
+{
+  int firingBlock = startPosition;
+
+  const bool isVLS128 = Family::IsVLS128(dataPacket);
+  // Compute the list of total azimuth advanced during one full firing block
+  // The VLS-128 computes it for each block instead
+  int azimuthDiff = 0;
+  if (!isVLS128)
   {
-    azimuthDiff = diffs[HDL_FIRING_PER_PKT - 1];
+    int diffs[HDL_FIRING_PER_PKT - 1];
+    for (int i = 0; i < HDL_FIRING_PER_PKT - 1; ++i)
+    {
+      int localDiff = (36000 + 18000 + dataPacket->firingData[i + 1].rotationalPosition -
+                        dataPacket->firingData[i].rotationalPosition) %
+        36000 - 18000;
+      diffs[i] = localDiff;
+    }
+
+    if (Family::IsHDL64(this->IsHDL64Data))
+    {
+      // largest difference, the blocks of the upper and lower lasers have the same azimuth
+      azimuthDiff = *std::max_element(diffs, diffs + HDL_FIRING_PER_PKT - 1);
+    }
+    else
+    {
+      // Assume the median of the packet's rotationalPosition differences
+      std::nth_element(diffs, diffs + HDL_FIRING_PER_PKT / 2, diffs + HDL_FIRING_PER_PKT - 1);
+      azimuthDiff = diffs[HDL_FIRING_PER_PKT / 2];
+    }
   }
 
   // assert(azimuthDiff > 0);
 
+  const bool isDualReturnPacket = Family::IsDualModeReturn(dataPacket);
   // Add DualReturn-specific arrays if newly detected dual return packet
-  if (dataPacket->isDualModeReturn() && !this->HasDualReturn)
+  if (isDualReturnPacket && !this->HasDualReturn)
   {
     this->HasDualReturn = true;
-    this->CurrentFrame->GetPointData()->AddArray(this->DistanceFlag.GetPointer());
-    this->CurrentFrame->GetPointData()->AddArray(this->IntensityFlag.GetPointer());
-    this->CurrentFrame->GetPointData()->AddArray(this->DualReturnMatching.GetPointer());
+    this->AddDualReturnArrays(this->CurrentFrame);
   }
 
   for (; firingBlock < HDL_FIRING_PER_PKT; ++firingBlock)
@@ -826,8 +1271,9 @@ void vtkVelodynePacketInterpreter::ProcessPacket(unsigned char const * data, uns
     // Skip this firing every PointSkip
     if (this->FiringsSkip == 0 || firingBlock % (this->FiringsSkip + 1) == 0)
     {
-      this->ProcessFiring(firingData, multiBlockLaserIdOffset, firingBlock, azimuthDiff, timestamp,
-        rawtime, dataPacket->isDualReturnFiringBlock(firingBlock), dataPacket->isDualModeReturn());
+      this->ProcessFiringFor<Family>(firingData, multiBlockLaserIdOffset, firingBlock, azimuthDiff,
+        timestamp, rawtime, Family::IsDualReturnFiringBlock(dataPacket, firingBlock),
+        isDualReturnPacket);
     }
   }
 }
@@ -847,157 +1293,395 @@ bool vtkVelodynePacketInterpreter::IsLidarPacket(unsigned char const * data, uns
 }
 
 //-----------------------------------------------------------------------------
-void vtkVelodynePacketInterpreter::ProcessFiring(const HDLFiringData *firingData, int firingBlockLaserOffset, int firingBlock, int azimuthDiff, double timestamp, unsigned int rawtime, bool isThisFiringDualReturnData, bool isDualReturnPacket)
+bool vtkVelodynePacketInterpreter::GetPacketAzimuthRange(unsigned char const* data,
+  unsigned int dataLength, double& firstAzimuth, double& lastAzimuth)
 {
-  // First return block of a dual return packet: init last point of laser
-  if (!isThisFiringDualReturnData &&
-    (!this->IsHDL64Data || (this->IsHDL64Data && ((firingBlock % 4) == 0))))
+  if (!this->IsLidarPacket(data, dataLength))
   {
-    this->FirstPointIdOfDualReturnPair = this->Points->GetNumberOfPoints();
+    return false;
   }
-
-  for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; dsr++)
+  const HDLDataPacket* dataPacket = reinterpret_cast<const HDLDataPacket*>(data);
+  const bool isVLS128 = dataPacket->isVLS128();
+  int firstBlock = -1;
+  int lastBlock = -1;
+  for (int i = 0; i < HDL_FIRING_PER_PKT; ++i)
   {
-    const unsigned char rawLaserId = static_cast<unsigned char>(dsr + firingBlockLaserOffset);
-    unsigned char laserId = rawLaserId;
-    const unsigned short azimuth = firingData->rotationalPosition;
-
-    // Detect VLP-16 data and adjust laser id if necessary
-    int firingWithinBlock = 0;
-
-    if (this->CalibrationReportedNumLasers == 16)
+    const unsigned short blockIdentifier = dataPacket->firingData[i].blockIdentifier;
+    if (isVLS128 && (blockIdentifier == 0 || blockIdentifier == 0xFFFF))
     {
-      if (firingBlockLaserOffset != 0)
-      {
-        if (!this->alreadyWarnedForIgnoredHDL64FiringPacket)
-        {
-          vtkGenericWarningMacro("Error: Received a HDL-64 UPPERBLOCK firing packet "
-                                 "with a VLP-16 calibration file. Ignoring the firing.");
-          this->alreadyWarnedForIgnoredHDL64FiringPacket = true;
-        }
-        return;
-      }
-      if (laserId >= 16)
-      {
-        laserId -= 16;
-        firingWithinBlock = 1;
-      }
+      continue;
     }
+    firstBlock = firstBlock < 0 ? i : firstBlock;
+    lastBlock = i;
+  }
+  if (firstBlock < 0)
+  {
+    return false;
+  }
 
-    // Interpolate azimuths and timestamps per laser within firing blocks
-    double timestampadjustment = 0;
-    int azimuthadjustment = 0;
-    if (this->UseIntraFiringAdjustment)
-    {
-      double blockdsr0 = 0, nextblockdsr0 = 1;
-      switch (this->CalibrationReportedNumLasers)
-      {
-        case 128:
-        {
-          timestampadjustment = VLS128AdjustTimeStamp(firingBlock, dsr, isDualReturnPacket);
-          nextblockdsr0 = VLS128AdjustTimeStamp(
-            firingBlock + (isDualReturnPacket ? 8 : 4), 0, isDualReturnPacket);
-          blockdsr0 = VLS128AdjustTimeStamp(firingBlock, 0, isDualReturnPacket);
-          break;
-        }
-        case 64:
-        {
-          timestampadjustment = -HDL64EAdjustTimeStamp(firingBlock, dsr, isDualReturnPacket);
-          nextblockdsr0 = -HDL64EAdjustTimeStamp(
-            firingBlock + (isDualReturnPacket ? 4 : 2), 0, isDualReturnPacket);
-          blockdsr0 = -HDL64EAdjustTimeStamp(firingBlock, 0, isDualReturnPacket);
-          break;
-        }
-        case 32:
-        {
-          if (this->ReportedSensor == VLP32AB || this->ReportedSensor == VLP32C)
-          {
-            timestampadjustment = VLP32AdjustTimeStamp(firingBlock, dsr, isDualReturnPacket);
-            nextblockdsr0 = VLP32AdjustTimeStamp(
-              firingBlock + (isDualReturnPacket ? 2 : 1), 0, isDualReturnPacket);
-            blockdsr0 = VLP32AdjustTimeStamp(firingBlock, 0, isDualReturnPacket);
-          }
-          else
-          {
-            timestampadjustment = HDL32AdjustTimeStamp(firingBlock, dsr, isDualReturnPacket);
-            nextblockdsr0 = HDL32AdjustTimeStamp(
-              firingBlock + (isDualReturnPacket ? 2 : 1), 0, isDualReturnPacket);
-            blockdsr0 = HDL32AdjustTimeStamp(firingBlock, 0, isDualReturnPacket);
-          }
-          break;
-        }
-        case 16:
-        {
-          timestampadjustment =
-            VLP16AdjustTimeStamp(firingBlock, laserId, firingWithinBlock, isDualReturnPacket);
-          nextblockdsr0 = VLP16AdjustTimeStamp(
-            firingBlock + (isDualReturnPacket ? 2 : 1), 0, 0, isDualReturnPacket);
-          blockdsr0 = VLP16AdjustTimeStamp(firingBlock, 0, 0, isDualReturnPacket);
-          break;
-        }
-        default:
-        {
-          timestampadjustment = 0.0;
-          blockdsr0 = 0.0;
-          nextblockdsr0 = 1.0;
-        }
-      }
-      azimuthadjustment = vtkMath::Round(
-        azimuthDiff * ((timestampadjustment - blockdsr0) / (nextblockdsr0 - blockdsr0)));
-      timestampadjustment = vtkMath::Round(timestampadjustment);
-    }
-    if ((!this->IgnoreZeroDistances || firingData->laserReturns[dsr].distance != 0.0) &&
-      this->LaserSelection[laserId])
-    {
-      this->PushFiringData(laserId, rawLaserId, azimuth + azimuthadjustment,
-        timestamp + timestampadjustment, rawtime + static_cast<unsigned int>(timestampadjustment),
-        &(firingData->laserReturns[dsr]), &(laser_corrections_[dsr + firingBlockLaserOffset]),
-        isThisFiringDualReturnData);
-    }
+  // the last firing lasts until the next azimuth, the blocks of the upper and lower lasers
+  // having the same azimuth. The step is negative when the sensor turns the other way.
+  int step = 0;
+  for (int i = lastBlock; i > firstBlock && step == 0; --i)
+  {
+    step = (36000 + 18000 + dataPacket->firingData[i].rotationalPosition -
+             dataPacket->firingData[i - 1].rotationalPosition) %
+        36000 - 18000;
   }
+  firstAzimuth = dataPacket->firingData[firstBlock].rotationalPosition / 100.;
+  lastAzimuth = (dataPacket->firingData[lastBlock].rotationalPosition + step) / 100.;
+  return true;
 }
 
 //-----------------------------------------------------------------------------
-void vtkVelodynePacketInterpreter::PushFiringData(unsigned char laserId, unsigned char rawLaserId,
-                                                  unsigned short azimuth, double timestamp,
-                                                  unsigned int rawtime, const HDLLaserReturn *laserReturn,
-                                                  const HDLLaserCorrection *correction, bool isFiringDualReturnData)
+double vtkVelodynePacketInterpreter::GetMaximumAzimuthCorrection()
 {
-  azimuth %= 36000;
-  const vtkIdType thisPointId = this->Points->GetNumberOfPoints();
-  short intensity = laserReturn->intensity;
-
-  // Compute raw position
-  double distanceM;
-  double pos[3];
-  bool applyIntensityCorrection =
-    this->WantIntensityCorrection && this->IsHDL64Data && !(this->SensorPowerMode == CorrectionOn);
-  ComputeCorrectedValues(
-    azimuth, laserReturn, correction, pos, distanceM, intensity, applyIntensityCorrection);
-
-  // Apply sensor transform
-  if (SensorTransform) this->SensorTransform->InternalTransformPoint(pos, pos);
+  double correction = 0.;
+  const int numberOfLasers = std::min(this->CalibrationReportedNumLasers, HDL_MAX_NUM_LASERS);
+  for (int i = 0; i < numberOfLasers; ++i)
+  {
+    correction = std::max(correction, std::abs(this->laser_corrections_[i].rotationalCorrection));
+  }
+  return correction;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkVelodynePacketInterpreter::GetPacketDistanceRange(unsigned char const* data,
+  unsigned int dataLength, double& minDistance, double& maxDistance, bool& hasZeroDistance)
+{
+  if (!this->IsLidarPacket(data, dataLength))
+  {
+    return false;
+  }
+  const HDLDataPacket* dataPacket = reinterpret_cast<const HDLDataPacket*>(data);
+  const bool isVLS128 = dataPacket->isVLS128();
+  unsigned short minRawDistance = std::numeric_limits<unsigned short>::max();
+  unsigned short maxRawDistance = 0;
+  hasZeroDistance = false;
+  for (int i = 0; i < HDL_FIRING_PER_PKT; ++i)
+  {
+    const HDLFiringData& firingData = dataPacket->firingData[i];
+    if (isVLS128 && (firingData.blockIdentifier == 0 || firingData.blockIdentifier == 0xFFFF))
+    {
+      continue;
+    }
+    for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; ++dsr)
+    {
+      const unsigned short distance = firingData.laserReturns[dsr].distance;
+      if (distance == 0)
+      {
+        hasZeroDistance = true;
+        continue;
+      }
+      minRawDistance = std::min(minRawDistance, distance);
+      maxRawDistance = std::max(maxRawDistance, distance);
+    }
+  }
+  minDistance = minRawDistance * this->DistanceResolutionM;
+  maxDistance = maxRawDistance * this->DistanceResolutionM;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+double vtkVelodynePacketInterpreter::GetMaximumDistanceCorrection()
+{
+  double correction = 0.;
+  const int numberOfLasers = std::min(this->CalibrationReportedNumLasers, HDL_MAX_NUM_LASERS);
+  for (int i = 0; i < numberOfLasers; ++i)
+  {
+    const HDLLaserCorrection& laser = this->laser_corrections_[i];
+    correction = std::max(correction, std::abs(laser.distanceCorrection) + LaserOffset(laser));
+  }
+  return correction;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkVelodynePacketInterpreter::GetPacketSensorTime(
+  unsigned char const* data, unsigned int dataLength, double& time)
+{
+  if (!this->IsLidarPacket(data, dataLength))
+  {
+    return false;
+  }
+  const HDLDataPacket* dataPacket = reinterpret_cast<const HDLDataPacket*>(data);
+  time = dataPacket->gpsTimestamp * 1e-6;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+double vtkVelodynePacketInterpreter::GetFrameSensorTime(vtkPolyData* frame)
+{
+  vtkDataArray* time = frame->GetPointData()->GetArray("adjustedtime");
+  if (!time || time->GetNumberOfTuples() == 0)
+  {
+    return vtkMath::Nan();
+  }
+  // microseconds
+  return time->GetComponent(0, 0) * 1e-6;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkVelodynePacketInterpreter::HasPacketSignature(
+  unsigned char const* data, unsigned int dataLength)
+{
+  if (!this->IsLidarPacket(data, dataLength))
+  {
+    return false;
+  }
+  // the first firing block of every sensor holds the returns of one of the laser blocks
+  const HDLDataPacket* dataPacket = reinterpret_cast<const HDLDataPacket*>(data);
+  const unsigned short blockIdentifier = dataPacket->firingData[0].blockIdentifier;
+  return blockIdentifier == BLOCK_0_TO_31 || blockIdentifier == BLOCK_32_TO_63 ||
+    blockIdentifier == BLOCK_64_TO_95 || blockIdentifier == BLOCK_96_TO_127;
+}
+
+//-----------------------------------------------------------------------------
+const FiringTimingTable& vtkVelodynePacketInterpreter::GetTimingTable()
+{
+  FiringTimingTable& table = *this->TimingTable;
+  const bool isVLP32 = this->ReportedSensor == VLP32AB || this->ReportedSensor == VLP32C;
+  if (table.NumberOfLasers == this->CalibrationReportedNumLasers && table.IsVLP32 == isVLP32)
+  {
+    return table;
+  }
+
+  switch (this->CalibrationReportedNumLasers)
+  {
+    case 128:
+      FillTimingTable<VLS128Timing>(table);
+      break;
+    case 64:
+      FillTimingTable<HDL64Timing>(table);
+      break;
+    case 32:
+      if (isVLP32)
+      {
+        FillTimingTable<VLP32Timing>(table);
+      }
+      else
+      {
+        FillTimingTable<HDL32Timing>(table);
+      }
+      break;
+    case 16:
+      FillTimingTable<VLP16Timing>(table);
+      break;
+    default:
+      FillTimingTable<NoTiming>(table);
+  }
+  table.NumberOfLasers = this->CalibrationReportedNumLasers;
+  table.IsVLP32 = isVLP32;
+  return table;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::UpdateSphericalCropTest()
+{
+  SphericalCropTest& test = *this->CropTest;
+  const vtkMTimeType time = this->GetMTime();
+  if (test.BuildTime == time)
+  {
+    return;
+  }
+  test.BuildTime = time;
+
+  static_assert(HDL_MAX_NUM_LASERS <= SphericalCropTest::MaximumNumberOfLasers,
+    "the crop test cannot hold all the lasers");
+  double laserOffset[HDL_MAX_NUM_LASERS];
+  double laserVerticalAngle[HDL_MAX_NUM_LASERS];
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    const HDLLaserCorrection& correction = this->laser_corrections_[i];
+    laserOffset[i] = LaserOffset(correction);
+    laserVerticalAngle[i] = correction.verticalCorrection;
+  }
+  test.Build(this->CropOutside, this->CropRegion, this->SensorTransform, HDL_MAX_NUM_LASERS,
+    laserOffset, laserVerticalAngle);
+}
+
+//-----------------------------------------------------------------------------
+template<typename Family>
+void vtkVelodynePacketInterpreter::ProcessFiringFor(const HDLFiringData* firingData,
+  int firingBlockLaserOffset, int firingBlock, int azimuthDiff, double timestamp,
+  unsigned int rawtime, bool isThisFiringDualReturnData, bool isDualReturnPacket)
+{
+  // First return block of a dual return packet: init last point of laser
+  if (!isThisFiringDualReturnData &&
+    (!Family::IsHDL64(this->IsHDL64Data) || ((firingBlock % 4) == 0)))
+  {
+    this->FirstPointIdOfDualReturnPair = this->FrameBuilder->NumberOfPoints;
+  }
+
+  // Detect VLP-16 data and adjust laser id if necessary
+  const bool hasVLP16Calibration = Family::HasVLP16Calibration(this->CalibrationReportedNumLasers);
+  if (hasVLP16Calibration && firingBlockLaserOffset != 0)
+  {
+    if (!this->alreadyWarnedForIgnoredHDL64FiringPacket)
+    {
+      vtkGenericWarningMacro("Error: Received a HDL-64 UPPERBLOCK firing packet "
+                             "with a VLP-16 calibration file. Ignoring the firing.");
+      this->alreadyWarnedForIgnoredHDL64FiringPacket = true;
+    }
+    return;
+  }
+
+  // The per laser azimuth and timestamp are gathered first, so that the positions of all
+  // the returns of the block are computed at once. The returns which are not selected,
+  // or which the spherical crop removes whatever their exact position, are skipped
+  // before their position is computed.
+  unsigned char laserIds[HDL_LASER_PER_FIRING];
+  unsigned short azimuths[HDL_LASER_PER_FIRING];
+  unsigned short distances[HDL_LASER_PER_FIRING];
+  double timestampAdjustments[HDL_LASER_PER_FIRING];
+  bool isKept[HDL_LASER_PER_FIRING];
+  int firstKept = HDL_LASER_PER_FIRING;
+  int lastKept = -1;
+  const FiringTimingTable& timing = this->GetTimingTable();
+  LaserStatistics& statistics = *this->Statistics;
+  if (statistics.Lasers.GetSize() != this->CalibrationReportedNumLasers ||
+    statistics.DistanceResolution != this->DistanceResolutionM)
+  {
+    statistics.Reset(
+      this->CalibrationReportedNumLasers, HDL_MAX_NUM_LASERS, this->DistanceResolutionM);
+  }
+  const bool useCropTest = this->CropMode == CROP_MODE::Spherical;
+  for (int dsr = 0; dsr < HDL_LASER_PER_FIRING; dsr++)
+  {
+    const unsigned char rawLaserId = static_cast<unsigned char>(dsr + firingBlockLaserOffset);
+    unsigned char laserId = rawLaserId;
+    const unsigned short azimuth = firingData->rotationalPosition;
+
+    if (hasVLP16Calibration && laserId >= 16)
+    {
+      laserId -= 16;
+    }
+
+    // Interpolate azimuths and timestamps per laser within firing blocks
+    double timestampadjustment = 0;
+    int azimuthadjustment = 0;
+    if (this->UseIntraFiringAdjustment)
+    {
+      timestampadjustment = timing.TimestampOffset[isDualReturnPacket][firingBlock][dsr];
+      azimuthadjustment =
+        vtkMath::Round(azimuthDiff * timing.AzimuthRatio[isDualReturnPacket][firingBlock][dsr]);
+    }
+    laserIds[dsr] = laserId;
+    azimuths[dsr] = static_cast<unsigned short>(azimuth + azimuthadjustment) % 36000;
+    distances[dsr] = firingData->laserReturns[dsr].distance;
+    timestampAdjustments[dsr] = timestampadjustment;
+    statistics.AddReturn(laserId, rawLaserId, azimuths[dsr], distances[dsr],
+      firingData->laserReturns[dsr].intensity, isThisFiringDualReturnData);
+
+    bool kept = (!this->IgnoreZeroDistances || distances[dsr] != 0) &&
+      this->LaserSelection[laserId];
+    if (kept && useCropTest)
+    {
+      const double distanceM = distances[dsr] * this->DistanceResolutionM +
+        this->CorrectionTable.DistanceCorrection[rawLaserId];
+      kept = !this->CropTest->IsCroppedOut(
+        static_cast<double>(azimuths[dsr]) / 100.0, rawLaserId, distanceM);
+    }
+    isKept[dsr] = kept;
+    if (kept)
+    {
+      firstKept = std::min(firstKept, dsr);
+      lastKept = dsr;
+    }
+  }
+
+  if (lastKept < 0)
+  {
+    return;
+  }
+
+  // the returns of a block share its time, they are moved with the same pose
+  if (this->PoseInterpolator)
+  {
+    double matrix[16];
+    this->PoseInterpolator->InterpolateTransformMatrix(timestamp * 1e-6, matrix);
+    std::copy(matrix, matrix + 12, this->FiringPose);
+  }
+
+  double x[HDL_LASER_PER_FIRING], y[HDL_LASER_PER_FIRING], z[HDL_LASER_PER_FIRING];
+  double distancesM[HDL_LASER_PER_FIRING];
+  const AzimuthLookupTable& azimuthTable = AzimuthLookupTable::GetHundredthsOfDegree();
+  ComputeFiringPositions(this->CorrectionTable, firingBlockLaserOffset + firstKept,
+    lastKept - firstKept + 1, azimuths + firstKept, distances + firstKept,
+    this->DistanceResolutionM, &azimuthTable.Cos[0], &azimuthTable.Sin[0],
+    x + firstKept, y + firstKept, z + firstKept, distancesM + firstKept);
+
+  for (int dsr = firstKept; dsr <= lastKept; dsr++)
+  {
+    if (!isKept[dsr])
+    {
+      continue;
+    }
+    const unsigned char rawLaserId = static_cast<unsigned char>(dsr + firingBlockLaserOffset);
+    double pos[3] = { x[dsr], y[dsr], z[dsr] };
+    const double timestampadjustment = timestampAdjustments[dsr];
+    this->PushFiringData(laserIds[dsr], rawLaserId, azimuths[dsr], timestamp + timestampadjustment,
+      rawtime + static_cast<unsigned int>(timestampadjustment), &(firingData->laserReturns[dsr]),
+      &(laser_corrections_[rawLaserId]), pos, distancesM[dsr], isThisFiringDualReturnData);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::PushFiringData(unsigned char laserId, unsigned char rawLaserId,
+                                                  unsigned short azimuth, double timestamp,
+                                                  unsigned int rawtime, const HDLLaserReturn *laserReturn,
+                                                  const HDLLaserCorrection *correction, double pos[3],
+                                                  double distanceM, bool isFiringDualReturnData)
+{
+  VelodyneFrameBuilder& frame = *this->FrameBuilder;
+  const vtkIdType thisPointId = frame.NumberOfPoints;
+  short intensity = laserReturn->intensity;
+
+  bool applyIntensityCorrection =
+    this->WantIntensityCorrection && this->IsHDL64Data && !(this->SensorPowerMode == CorrectionOn);
+  if (applyIntensityCorrection)
+  {
+    intensity = ComputeCorrectedIntensity(laserReturn, correction);
+  }
+
+  // Apply sensor transform
+  if (SensorTransform) this->SensorTransform->InternalTransformPoint(pos, pos);
 
   if (this->shouldBeCroppedOut(pos, static_cast<double>(azimuth) / 100.0))
     return;
 
-  // Do not add any data before here as this might short-circuit
-  if (isFiringDualReturnData)
+  // the crop is relative to the sensor, the motion is compensated afterwards
+  if (this->PoseInterpolator)
   {
-    const vtkIdType dualPointId = this->LastPointId[rawLaserId];
-    if (dualPointId < this->FirstPointIdOfDualReturnPair)
+    const double x[3] = { pos[0], pos[1], pos[2] };
+    const double* pose = this->FiringPose;
+    for (int k = 0; k < 3; ++k)
     {
-      // No matching point from first set (skipped?)
-      this->Flags->InsertNextValue(DUAL_DOUBLED);
-      this->DistanceFlag->InsertNextValue(0);
-      this->DualReturnMatching->InsertNextValue(-1); // std::numeric_limits<vtkIdType>::quiet_NaN()
-      this->IntensityFlag->InsertNextValue(0);
+      pos[k] = pose[4 * k] * x[0] + pose[4 * k + 1] * x[1] + pose[4 * k + 2] * x[2] + pose[4 * k + 3];
     }
-    else
+  }
+
+  // every return kept is written in the image, the dual return filter only applies to the points
+  if (this->RangeImageWidth > 0)
+  {
+    this->AddRangeImageReturn(laserId, azimuth, distanceM, static_cast<unsigned char>(intensity), timestamp);
+    if (this->SkipPointCloud)
+    {
+      return;
+    }
+  }
+
+  // Do not add any data before here as this might short-circuit
+  unsigned int flags = DUAL_DOUBLED;
+  vtkIdType dualReturnMatching = -1; // std::numeric_limits<vtkIdType>::quiet_NaN()
+  if (isFiringDualReturnData)
+  {
+    DualReturnTracker::LaserReturn& dualReturn = this->LastReturns->Lasers[rawLaserId];
+    const vtkIdType dualPointId = dualReturn.PointId;
+    if (dualPointId >= this->FirstPointIdOfDualReturnPair)
     {
-      const short dualIntensity = this->Intensity->GetValue(dualPointId);
-      const double dualDistance = this->Distance->GetValue(dualPointId);
-      unsigned int firstFlags = this->Flags->GetValue(dualPointId);
+      const short dualIntensity = dualReturn.Intensity;
+      const double dualDistance = dualReturn.Distance;
+      unsigned int firstFlags = dualReturn.Flags;
       unsigned int secondFlags = 0;
 
       if (dualDistance == distanceM && intensity == dualIntensity)
@@ -1034,76 +1718,89 @@ void vtkVelodynePacketInterpreter::PushFiringData(unsigned char laserId, unsigne
         if (!(secondFlags & this->DualReturnFilter))
         {
           // second return does not match filter; skip
-          this->Flags->SetValue(dualPointId, firstFlags);
-          this->DistanceFlag->SetValue(dualPointId, MapDistanceFlag(firstFlags));
-          this->IntensityFlag->SetValue(dualPointId, MapIntensityFlag(firstFlags));
+          dualReturn.Flags = firstFlags;
+          frame.Flags.Data[dualPointId] = firstFlags;
+          frame.DistanceFlag.Data[dualPointId] = MapDistanceFlag(firstFlags);
+          frame.IntensityFlag.Data[dualPointId] = MapIntensityFlag(firstFlags);
           return;
         }
         if (!(firstFlags & this->DualReturnFilter))
         {
           // first return does not match filter; replace with second return
-          this->Points->SetPoint(dualPointId, pos);
-          this->Distance->SetValue(dualPointId, distanceM);
-          this->DistanceRaw->SetValue(dualPointId, laserReturn->distance);
-          this->Intensity->SetValue(dualPointId, intensity);
-          this->Timestamp->SetValue(dualPointId, timestamp);
-          this->RawTime->SetValue(dualPointId, rawtime);
-          this->Flags->SetValue(dualPointId, secondFlags);
-          this->DistanceFlag->SetValue(dualPointId, MapDistanceFlag(secondFlags));
-          this->IntensityFlag->SetValue(dualPointId, MapIntensityFlag(secondFlags));
+          std::copy(pos, pos + 3, frame.Points.Data + 3 * dualPointId);
+          frame.Distance.Data[dualPointId] = distanceM;
+          frame.DistanceRaw.Data[dualPointId] = laserReturn->distance;
+          frame.Intensity.Data[dualPointId] = static_cast<unsigned char>(intensity);
+          frame.Timestamp.Data[dualPointId] = timestamp;
+          frame.RawTime.Data[dualPointId] = rawtime;
+          frame.Flags.Data[dualPointId] = secondFlags;
+          frame.DistanceFlag.Data[dualPointId] = MapDistanceFlag(secondFlags);
+          frame.IntensityFlag.Data[dualPointId] = MapIntensityFlag(secondFlags);
+          dualReturn.Distance = distanceM;
+          dualReturn.Intensity = static_cast<unsigned char>(intensity);
+          dualReturn.Flags = secondFlags;
           return;
         }
       }
 
-      this->Flags->SetValue(dualPointId, firstFlags);
-      this->DistanceFlag->SetValue(dualPointId, MapDistanceFlag(firstFlags));
-      this->IntensityFlag->SetValue(dualPointId, MapIntensityFlag(firstFlags));
-      this->Flags->InsertNextValue(secondFlags);
-      this->DistanceFlag->InsertNextValue(MapDistanceFlag(secondFlags));
-      this->IntensityFlag->InsertNextValue(MapIntensityFlag(secondFlags));
+      dualReturn.Flags = firstFlags;
+      frame.Flags.Data[dualPointId] = firstFlags;
+      frame.DistanceFlag.Data[dualPointId] = MapDistanceFlag(firstFlags);
+      frame.IntensityFlag.Data[dualPointId] = MapIntensityFlag(firstFlags);
+      flags = secondFlags;
       // The first return indicates the dual return
       // and the dual return indicates the first return
-      this->DualReturnMatching->InsertNextValue(dualPointId);
-      this->DualReturnMatching->SetValue(dualPointId, thisPointId);
+      dualReturnMatching = dualPointId;
+      frame.DualReturnMatching.Data[dualPointId] = thisPointId;
     }
-  }
-  else
-  {
-    this->Flags->InsertNextValue(DUAL_DOUBLED);
-    this->DistanceFlag->InsertNextValue(0);
-    this->IntensityFlag->InsertNextValue(0);
-    this->DualReturnMatching->InsertNextValue(-1); // std::numeric_limits<vtkIdType>::quiet_NaN()
-  }
-
-  this->Points->InsertNextPoint(pos);
-  this->PointsX->InsertNextValue(pos[0]);
-  this->PointsY->InsertNextValue(pos[1]);
-  this->PointsZ->InsertNextValue(pos[2]);
-  this->Azimuth->InsertNextValue(azimuth);
-  this->Intensity->InsertNextValue(intensity);
-  this->LaserId->InsertNextValue(laserId);
-  this->Timestamp->InsertNextValue(timestamp);
-  this->RawTime->InsertNextValue(rawtime);
-  this->Distance->InsertNextValue(distanceM);
-  this->DistanceRaw->InsertNextValue(laserReturn->distance);
-  this->LastPointId[rawLaserId] = thisPointId;
-  this->VerticalAngle->InsertNextValue(this->laser_corrections_[laserId].verticalCorrection);
+    // else no matching point from first set (skipped?)
+  }
+
+  frame.AddPoint();
+  std::copy(pos, pos + 3, frame.Points.Data + 3 * thisPointId);
+  frame.PointsX.Data[thisPointId] = pos[0];
+  frame.PointsY.Data[thisPointId] = pos[1];
+  frame.PointsZ.Data[thisPointId] = pos[2];
+  frame.Azimuth.Data[thisPointId] = azimuth;
+  frame.Intensity.Data[thisPointId] = static_cast<unsigned char>(intensity);
+  frame.LaserId.Data[thisPointId] = laserId;
+  frame.Timestamp.Data[thisPointId] = timestamp;
+  frame.RawTime.Data[thisPointId] = rawtime;
+  frame.Distance.Data[thisPointId] = distanceM;
+  frame.DistanceRaw.Data[thisPointId] = laserReturn->distance;
+  frame.VerticalAngle.Data[thisPointId] = this->laser_corrections_[laserId].verticalCorrection;
+  frame.Flags.Data[thisPointId] = flags;
+  frame.DistanceFlag.Data[thisPointId] = flags == DUAL_DOUBLED ? 0 : MapDistanceFlag(flags);
+  frame.IntensityFlag.Data[thisPointId] = flags == DUAL_DOUBLED ? 0 : MapIntensityFlag(flags);
+  frame.DualReturnMatching.Data[thisPointId] = dualReturnMatching;
+  DualReturnTracker::LaserReturn& lastReturn = this->LastReturns->Lasers[rawLaserId];
+  lastReturn.PointId = thisPointId;
+  lastReturn.Distance = distanceM;
+  lastReturn.Intensity = static_cast<unsigned char>(intensity);
+  lastReturn.Flags = flags;
 }
 
 //-----------------------------------------------------------------------------
-void vtkVelodynePacketInterpreter::InitTrigonometricTables()
+void vtkVelodynePacketInterpreter::AddRangeImageReturn(unsigned char laserId, unsigned short azimuth,
+                                                       double distanceM, unsigned char intensity,
+                                                       double timestamp)
 {
-  if (cos_lookup_table_.size() == 0 || sin_lookup_table_.size() == 0)
+  // the calibration may be read from the stream, the image is started once it is known
+  if (this->RangeImage->Width != this->RangeImageWidth)
   {
-    cos_lookup_table_.resize(HDL_NUM_ROT_ANGLES);
-    sin_lookup_table_.resize(HDL_NUM_ROT_ANGLES);
-    for (unsigned int i = 0; i < HDL_NUM_ROT_ANGLES; i++)
+    const int numberOfLasers = std::min(this->CalibrationReportedNumLasers, HDL_MAX_NUM_LASERS);
+    if (numberOfLasers <= 0)
     {
-      double rad = HDL_Grabber_toRadians(i / 100.0);
-      cos_lookup_table_[i] = std::cos(rad);
-      sin_lookup_table_[i] = std::sin(rad);
+      return;
     }
+    std::vector<double> verticalAngles(numberOfLasers);
+    for (int laser = 0; laser < numberOfLasers; ++laser)
+    {
+      verticalAngles[laser] = this->laser_corrections_[laser].verticalCorrection;
+    }
+    this->RangeImage->Reset(this->RangeImageWidth, verticalAngles);
   }
+  this->RangeImage->AddReturn(laserId, azimuth, distanceM, intensity, timestamp);
 }
 
 //-----------------------------------------------------------------------------
@@ -1123,21 +1820,23 @@ void vtkVelodynePacketInterpreter::PrecomputeCorrectionCosSin()
       correction.verticalOffsetCorrection * correction.sinVertCorrection;
     correction.cosVertOffsetCorrection =
       correction.verticalOffsetCorrection * correction.cosVertCorrection;
+    correction.focalOffset = 256 * pow(1.0 - correction.focalDistance / 131.0, 2);
   }
+  this->CorrectionTable.Set(this->laser_corrections_);
+  // the decoder depends on the number of lasers of the calibration
+  this->PacketDecoder = nullptr;
+  this->CropTest->BuildTime = 0;
 }
 
 //-----------------------------------------------------------------------------
 void vtkVelodynePacketInterpreter::Init()
 {
-  this->InitTrigonometricTables();
   this->ResetCurrentFrame();
 }
 
 //-----------------------------------------------------------------------------
 double vtkVelodynePacketInterpreter::ComputeTimestamp(unsigned int tohTime)
 {
-  static const double hourInMilliseconds = 3600.0 * 1e6;
-
   if (tohTime < this->LastTimestamp)
   {
     if (!vtkMath::IsFinite(this->TimeAdjust))
@@ -1145,11 +1844,12 @@ double vtkVelodynePacketInterpreter::ComputeTimestamp(unsigned int tohTime)
       // Ought to warn about this, but happens when applogic is checking that
       // we can read the file :-(
       this->TimeAdjust = 0;
+      this->FirstTimestamp = tohTime;
     }
     else
     {
       // Hour has wrapped; add an hour to the update adjustment value
-      this->TimeAdjust += hourInMilliseconds;
+      this->TimeAdjust += HourInMicroseconds;
     }
   }
 
@@ -1158,41 +1858,11 @@ double vtkVelodynePacketInterpreter::ComputeTimestamp(unsigned int tohTime)
 }
 
 //-----------------------------------------------------------------------------
-void vtkVelodynePacketInterpreter::ComputeCorrectedValues(const unsigned short azimuth, const HDLLaserReturn *laserReturn, const HDLLaserCorrection *correction, double pos[], double &distanceM, short &intensity, bool correctIntensity)
+short vtkVelodynePacketInterpreter::ComputeCorrectedIntensity(
+  const HDLLaserReturn* laserReturn, const HDLLaserCorrection* correction)
 {
-  intensity = laserReturn->intensity;
-
-  double cosAzimuth, sinAzimuth;
-  if (correction->rotationalCorrection == 0)
-  {
-    cosAzimuth = this->cos_lookup_table_[azimuth];
-    sinAzimuth = this->sin_lookup_table_[azimuth];
-  }
-  else
-  {
-    // realAzimuth = azimuth/100 - rotationalCorrection
-    // cos(a-b) = cos(a)*cos(b) + sin(a)*sin(b)
-    // sin(a-b) = sin(a)*cos(b) - cos(a)*sin(b)
-    cosAzimuth = this->cos_lookup_table_[azimuth] * correction->cosRotationalCorrection +
-      this->sin_lookup_table_[azimuth] * correction->sinRotationalCorrection;
-    sinAzimuth = this->sin_lookup_table_[azimuth] * correction->cosRotationalCorrection -
-      this->cos_lookup_table_[azimuth] * correction->sinRotationalCorrection;
-  }
-  // Compute the distance in the xy plane (w/o accounting for rotation)
-  /**the new term of 'vert_offset * sin_vert_angle'
-   * was added to the expression due to the mathemathical
-   * model we used.
-   */
-  double distanceMRaw = laserReturn->distance * this->DistanceResolutionM;
-  distanceM = distanceMRaw + correction->distanceCorrection;
-  double xyDistance =
-    distanceM * correction->cosVertCorrection - correction->sinVertOffsetCorrection;
-
-  pos[0] = xyDistance * sinAzimuth - correction->horizontalOffsetCorrection * cosAzimuth;
-  pos[1] = xyDistance * cosAzimuth + correction->horizontalOffsetCorrection * sinAzimuth;
-  pos[2] = distanceM * correction->sinVertCorrection + correction->verticalOffsetCorrection;
-
-  if (correctIntensity && (correction->minIntensity < correction->maxIntensity))
+  short intensity = laserReturn->intensity;
+  if (correction->minIntensity < correction->maxIntensity)
   {
     // Compute corrected intensity
 
@@ -1216,32 +1886,31 @@ void vtkVelodynePacketInterpreter::ComputeCorrectedValues(const unsigned short a
       computedIntensity = 0;
     }
 
-    double focalOffset = 256 * pow(1.0 - correction->focalDistance / 131.0, 2);
-    double insideAbsValue = std::abs(
-      focalOffset - 256 * pow(1.0 - static_cast<double>(laserReturn->distance) / 65535.0f, 2));
-
-    if (insideAbsValue > 0)
-    {
-      computedIntensity = computedIntensity + correction->focalSlope * insideAbsValue;
-    }
-    else
-    {
-      computedIntensity = computedIntensity + correction->closeSlope * insideAbsValue;
-    }
+    // the focal offset is precomputed with the calibration, the distance term is a square.
+    // As the absolute value is never negative, the close slope of the manual would only
+    // multiply 0, so the focal slope is always used.
+    const double distanceTerm = 1.0 - static_cast<double>(laserReturn->distance) / 65535.0;
+    const double insideAbsValue = std::abs(correction->focalOffset - 256 * (distanceTerm * distanceTerm));
+    computedIntensity = computedIntensity + correction->focalSlope * insideAbsValue;
     computedIntensity = std::max(std::min(computedIntensity, 255.0), 1.0);
 
     intensity = static_cast<short>(computedIntensity);
   }
+  return intensity;
 }
 
 //-----------------------------------------------------------------------------
 bool vtkVelodynePacketInterpreter::HDL64LoadCorrectionsFromStreamData()
 {
+  // the data only change when a new complete sequence has been received
+  const unsigned long sequence = this->rollingCalibrationData->getNumberOfGoodSequences();
   std::vector<unsigned char> data;
-  if (!this->rollingCalibrationData->getAlignedRollingData(data))
+  if (sequence == this->RollingCalibrationSequence ||
+    !this->rollingCalibrationData->getAlignedRollingData(data))
   {
     return false;
   }
+  this->RollingCalibrationSequence = sequence;
   // the rollingCalibrationData considers the marker to be "#" in reserved4
   const int idxDSRDataFromMarker =
     static_cast<int>(-reinterpret_cast<unsigned long>(&((HDLLaserCorrectionByte*)0)->reserved4));
@@ -1298,12 +1967,27 @@ vtkSmartPointer<vtkPolyData> vtkVelodynePacketInterpreter::CreateNewEmptyFrame(v
   // prereserve for 50% points more than actually received in previous frame
   prereservedNumberOfPoints = std::max(static_cast<int>(prereservedNumberOfPoints * 1.5), defaultPrereservedNumberOfPointsPerFrame);
 
+  // When the sensor layout is known, plan for a full rotation: a Velodyne laser fires at most
+  // MaximumFiringRate times per second, and each firing gives two returns in dual mode.
+  // The frame builder buffers are given to the frame when it is split, and reused once the
+  // frame has been released.
+  if (this->CalibrationReportedNumLasers > 0 && this->Frequency > 0)
+  {
+    const double rotationDuration = 60.0 / std::max(this->Frequency, MinimumRPM);
+    const double firingsPerRotation = MaximumFiringRate * rotationDuration / (this->FiringsSkip + 1);
+    const vtkIdType plannedNumberOfPoints = static_cast<vtkIdType>(
+      this->CalibrationReportedNumLasers * firingsPerRotation * (this->HasDualReturn ? 2 : 1));
+    prereservedNumberOfPoints = std::max(prereservedNumberOfPoints, plannedNumberOfPoints);
+  }
+  this->Recycler->Recycle(*this->FrameBuilder);
+  this->FrameBuilder->Reset(prereservedNumberOfPoints);
+
   vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
 
-  // points
+  // points, the storage of the arrays is given by the frame builder in SplitFrame
+  prereservedNumberOfPoints = 0;
   vtkNew<vtkPoints> points;
   points->SetDataTypeToFloat();
-  points->Allocate(prereservedNumberOfPoints);
   if (numberOfPoints > 0 )
   {
     points->SetNumberOfPoints(numberOfPoints);
@@ -1314,23 +1998,29 @@ vtkSmartPointer<vtkPolyData> vtkVelodynePacketInterpreter::CreateNewEmptyFrame(v
 
   // intensity
   this->Points = points.GetPointer();
-  this->PointsX = CreateDataArray<vtkDoubleArray>("X", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->PointsY = CreateDataArray<vtkDoubleArray>("Y", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->PointsZ = CreateDataArray<vtkDoubleArray>("Z", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->Intensity = CreateDataArray<vtkUnsignedCharArray>("intensity", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->LaserId = CreateDataArray<vtkUnsignedCharArray>("laser_id", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->Azimuth = CreateDataArray<vtkUnsignedShortArray>("azimuth", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->Distance = CreateDataArray<vtkDoubleArray>("distance_m", numberOfPoints, prereservedNumberOfPoints, polyData);
+  // the arrays which are not selected are not added to the frame
+  auto output = [this, &polyData](const char* name) {
+    return this->PointArraySelection->ArrayIsEnabled(name) ? polyData.GetPointer() : nullptr;
+  };
+  const bool single = this->UseSinglePrecision;
+  this->PointsX = CreateRealDataArray(single, "X", numberOfPoints, prereservedNumberOfPoints, output("X"));
+  this->PointsY = CreateRealDataArray(single, "Y", numberOfPoints, prereservedNumberOfPoints, output("Y"));
+  this->PointsZ = CreateRealDataArray(single, "Z", numberOfPoints, prereservedNumberOfPoints, output("Z"));
+  this->Intensity = CreateDataArray<vtkUnsignedCharArray>("intensity", numberOfPoints, prereservedNumberOfPoints, output("intensity"));
+  this->LaserId = CreateDataArray<vtkUnsignedCharArray>("laser_id", numberOfPoints, prereservedNumberOfPoints, output("laser_id"));
+  this->Azimuth = CreateDataArray<vtkUnsignedShortArray>("azimuth", numberOfPoints, prereservedNumberOfPoints, output("azimuth"));
+  this->Distance = CreateRealDataArray(single, "distance_m", numberOfPoints, prereservedNumberOfPoints, output("distance_m"));
   this->DistanceRaw =
-    CreateDataArray<vtkUnsignedShortArray>("distance_raw", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->Timestamp = CreateDataArray<vtkDoubleArray>("adjustedtime", numberOfPoints, prereservedNumberOfPoints, polyData);
-  this->RawTime = CreateDataArray<vtkUnsignedIntArray>("timestamp", numberOfPoints, prereservedNumberOfPoints, polyData);
+    CreateDataArray<vtkUnsignedShortArray>("distance_raw", numberOfPoints, prereservedNumberOfPoints, output("distance_raw"));
+  // the time in microseconds needs more than the 24 bits of precision of a float
+  this->Timestamp = CreateDataArray<vtkDoubleArray>("adjustedtime", numberOfPoints, prereservedNumberOfPoints, output("adjustedtime"));
+  this->RawTime = CreateDataArray<vtkUnsignedIntArray>("timestamp", numberOfPoints, prereservedNumberOfPoints, output("timestamp"));
   this->DistanceFlag = CreateDataArray<vtkIntArray>("dual_distance", numberOfPoints, prereservedNumberOfPoints, nullptr);
   this->IntensityFlag = CreateDataArray<vtkIntArray>("dual_intensity", numberOfPoints, prereservedNumberOfPoints, nullptr);
   this->Flags = CreateDataArray<vtkUnsignedIntArray>("dual_flags", numberOfPoints, prereservedNumberOfPoints, nullptr);
   this->DualReturnMatching =
     CreateDataArray<vtkIdTypeArray>("dual_return_matching", numberOfPoints, prereservedNumberOfPoints, nullptr);
-  this->VerticalAngle = CreateDataArray<vtkDoubleArray>("vertical_angle", numberOfPoints, prereservedNumberOfPoints, polyData);
+  this->VerticalAngle = CreateRealDataArray(single, "vertical_angle", numberOfPoints, prereservedNumberOfPoints, output("vertical_angle"));
 
   // FieldData : RPM
   vtkSmartPointer<vtkDoubleArray> rpmData = vtkSmartPointer<vtkDoubleArray>::New();
@@ -1341,24 +2031,55 @@ vtkSmartPointer<vtkPolyData> vtkVelodynePacketInterpreter::CreateNewEmptyFrame(v
   polyData->GetFieldData()->AddArray(rpmData);
 
   if (this->HasDualReturn)
+  {
+    this->AddDualReturnArrays(polyData);
+  }
+
+  return polyData;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::AddDualReturnArrays(vtkPolyData* polyData)
+{
+  if (this->PointArraySelection->ArrayIsEnabled("dual_distance"))
   {
     polyData->GetPointData()->AddArray(this->DistanceFlag.GetPointer());
+  }
+  if (this->PointArraySelection->ArrayIsEnabled("dual_intensity"))
+  {
     polyData->GetPointData()->AddArray(this->IntensityFlag.GetPointer());
+  }
+  if (this->PointArraySelection->ArrayIsEnabled("dual_return_matching"))
+  {
     polyData->GetPointData()->AddArray(this->DualReturnMatching.GetPointer());
   }
-
-  return polyData;
 }
 
 //-----------------------------------------------------------------------------
 bool vtkVelodynePacketInterpreter::SplitFrame(bool force)
 {
-  if (this->vtkLidarPacketInterpreter::SplitFrame(force))
-  {
-    for (size_t n = 0; n < HDL_MAX_NUM_LASERS; ++n)
-    {
-      this->LastPointId[n] = -1;
-    }
+  VV_TRACE_SCOPE("vtkVelodynePacketInterpreter::SplitFrame");
+  // the remaining points are given as the last sector of a frame which is going to be split
+  if (this->SectorSize > 0 &&
+    (this->FrameBuilder->NumberOfPoints > 0 || !this->IgnoreEmptyFrames || force))
+  {
+    this->SplitSectors(true);
+    this->FrameCounter++;
+  }
+  this->SectorStart = 0;
+  this->SectorEnd = 0;
+  this->CurrentSector = -1;
+  this->ReleaseFrameBuilder();
+  // without point cloud, the frame is empty when its image is
+  const bool hasImageReturns = this->SkipPointCloud && this->RangeImage->NumberOfReturns > 0;
+  if (this->vtkLidarPacketInterpreter::SplitFrame(force || hasImageReturns))
+  {
+    this->RangeImage->AddTo(this->Frames.back()->GetFieldData());
+    this->RangeImage->Clear();
+    this->Statistics->AddTo(this->Frames.back()->GetFieldData());
+    this->Statistics->Clear();
+    this->Recycler->Add(this->Frames.back());
+    this->LastReturns->Reset();
     // compute th rpm and add it to the splited frame
     this->Frequency = this->RpmCalculator_->GetRPM();
     this->RpmCalculator_->Reset();
@@ -1368,27 +2089,277 @@ bool vtkVelodynePacketInterpreter::SplitFrame(bool force)
 
     return true;
   }
-  if (this->ShouldAddDualReturnArray)
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+int vtkVelodynePacketInterpreter::GetNumberOfPointArrays()
+{
+  return this->PointArraySelection->GetNumberOfArrays();
+}
+
+//-----------------------------------------------------------------------------
+const char* vtkVelodynePacketInterpreter::GetPointArrayName(int index)
+{
+  return this->PointArraySelection->GetArrayName(index);
+}
+
+//-----------------------------------------------------------------------------
+int vtkVelodynePacketInterpreter::GetPointArrayStatus(const char* name)
+{
+  return this->PointArraySelection->ArrayIsEnabled(name);
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::SetPoseSource(vtkTemporalTransforms* trajectory)
+{
+  if (!trajectory || trajectory->GetNumberOfPoints() == 0)
   {
-    this->Frames.back()->GetPointData()->AddArray(this->SelectedDualReturn);
+    if (this->PoseInterpolator)
+    {
+      this->PoseInterpolator = nullptr;
+      this->PoseSourceHash.clear();
+      this->Modified();
+    }
+    return;
   }
 
-  return false;
+  // the decoded frames are cached by decoding key, which tells the trajectories apart
+  const auto times = trajectory->GetTimes();
+  const auto axisAngles = trajectory->GetAxisAngles();
+  const auto translations = trajectory->GetTranslations();
+  std::stringstream hash;
+  hash << std::hex << DecodedFrameFile::Hash(times.data(), times.size() * sizeof(double)) << ","
+       << DecodedFrameFile::Hash(axisAngles.data(), axisAngles.size() * sizeof(double)) << ","
+       << DecodedFrameFile::Hash(translations.data(), translations.size() * sizeof(double));
+
+  this->PoseInterpolator = trajectory->CreateInterpolator();
+  this->PoseInterpolator->SetInterpolationTypeToLinear();
+  this->PoseSourceHash = hash.str();
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::SetPointArrayStatus(const char* name, int status)
+{
+  if (this->GetPointArrayStatus(name) == (status != 0))
+  {
+    return;
+  }
+  if (status)
+  {
+    this->PointArraySelection->EnableArray(name);
+  }
+  else
+  {
+    this->PointArraySelection->DisableArray(name);
+  }
+  this->Modified();
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::ReleaseFrameBuilder()
+{
+  VelodyneFrameBuilder& frame = *this->FrameBuilder;
+  const vtkIdType n = frame.NumberOfPoints;
+  if (n == 0)
+  {
+    // keep the buffers for the points to come
+    return;
+  }
+
+  // the laser of each point is known here, the consumers of the scan lines get them grouped
+  ScanLineIndex::AddTo(this->CurrentFrame->GetFieldData(), frame.LaserId.Data, n,
+    this->CalibrationReportedNumLasers);
+
+  // the dual returns of the selected returns are found through their matching ids
+  if (this->ShouldAddDualReturnArray && this->HasDualReturn)
+  {
+    vtkNew<vtkUnsignedCharArray> mask;
+    mask->SetName(DualReturnSelection::MaskName);
+    mask->SetNumberOfValues(n);
+    this->SelectedDualReturns->Mark(frame.LaserId.Data, frame.Azimuth.Data,
+      frame.DualReturnMatching.Data, n, mask->GetPointer(0));
+    this->CurrentFrame->GetPointData()->AddArray(mask.GetPointer());
+  }
+
+  frame.Points.Release(vtkFloatArray::SafeDownCast(this->Points->GetData()), 3 * n);
+  // the buffers of the arrays which are not output are kept for the next frame
+  vtkDataArraySelection* selection = this->PointArraySelection;
+  if (selection->ArrayIsEnabled("X"))
+  {
+    frame.PointsX.ReleaseReal(this->PointsX, n);
+  }
+  if (selection->ArrayIsEnabled("Y"))
+  {
+    frame.PointsY.ReleaseReal(this->PointsY, n);
+  }
+  if (selection->ArrayIsEnabled("Z"))
+  {
+    frame.PointsZ.ReleaseReal(this->PointsZ, n);
+  }
+  if (selection->ArrayIsEnabled("intensity"))
+  {
+    frame.Intensity.Release(this->Intensity.GetPointer(), n);
+  }
+  if (selection->ArrayIsEnabled("laser_id"))
+  {
+    frame.LaserId.Release(this->LaserId.GetPointer(), n);
+  }
+  if (selection->ArrayIsEnabled("azimuth"))
+  {
+    frame.Azimuth.Release(this->Azimuth.GetPointer(), n);
+  }
+  if (selection->ArrayIsEnabled("distance_m"))
+  {
+    frame.Distance.ReleaseReal(this->Distance, n);
+  }
+  if (selection->ArrayIsEnabled("distance_raw"))
+  {
+    frame.DistanceRaw.Release(this->DistanceRaw.GetPointer(), n);
+  }
+  if (selection->ArrayIsEnabled("adjustedtime"))
+  {
+    frame.Timestamp.Release(this->Timestamp.GetPointer(), n);
+  }
+  if (selection->ArrayIsEnabled("vertical_angle"))
+  {
+    frame.VerticalAngle.ReleaseReal(this->VerticalAngle, n);
+  }
+  if (selection->ArrayIsEnabled("timestamp"))
+  {
+    frame.RawTime.Release(this->RawTime.GetPointer(), n);
+  }
+  if (this->HasDualReturn)
+  {
+    if (selection->ArrayIsEnabled("dual_intensity"))
+    {
+      frame.IntensityFlag.Release(this->IntensityFlag.GetPointer(), n);
+    }
+    if (selection->ArrayIsEnabled("dual_distance"))
+    {
+      frame.DistanceFlag.Release(this->DistanceFlag.GetPointer(), n);
+    }
+    if (selection->ArrayIsEnabled("dual_return_matching"))
+    {
+      frame.DualReturnMatching.Release(this->DualReturnMatching.GetPointer(), n);
+    }
+  }
+  this->Points->Modified();
+
+  // the next frame must allocate new buffers
+  frame.NumberOfPoints = 0;
+  frame.Capacity = 0;
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::SplitSectors(bool endOfFrame)
+{
+  const VelodyneFrameBuilder& frame = *this->FrameBuilder;
+  const vtkIdType numberOfPoints = frame.NumberOfPoints;
+  const double sectorSize = this->SectorSize * 100.0;
+  const int numberOfSectors = std::max(static_cast<int>(std::ceil(36000.0 / sectorSize)), 1);
+  for (vtkIdType id = this->SectorEnd; id < numberOfPoints; ++id)
+  {
+    const int sector = static_cast<int>(frame.Azimuth.Data[id] / sectorSize) % numberOfSectors;
+    if (this->CurrentSector < 0)
+    {
+      this->CurrentSector = sector;
+      continue;
+    }
+    // the lasers of a firing have different azimuths, the points which go back to the
+    // previous sector stay in the current one
+    const int advance = (sector - this->CurrentSector + numberOfSectors) % numberOfSectors;
+    if (advance == 0 || 2 * advance > numberOfSectors)
+    {
+      continue;
+    }
+    this->AddSector(this->SectorStart, id, false);
+    this->SectorStart = id;
+    this->CurrentSector = sector;
+  }
+  this->SectorEnd = numberOfPoints;
+
+  if (endOfFrame)
+  {
+    this->AddSector(this->SectorStart, numberOfPoints, true);
+    this->SectorStart = numberOfPoints;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::AddSector(vtkIdType first, vtkIdType last, bool isLast)
+{
+  // the builder keeps its buffers for the frame, the points of the sector are copied
+  const VelodyneFrameBuilder& frame = *this->FrameBuilder;
+  const vtkIdType n = last - first;
+  vtkSmartPointer<vtkPolyData> sector = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetData(CopyColumnRange(frame.Points, first, n, this->Points->GetData(), nullptr));
+  sector->SetPoints(points.GetPointer());
+  sector->SetVerts(NewVertexCells(n));
+
+  vtkDataArraySelection* selection = this->PointArraySelection;
+  auto output = [selection, &sector](const char* name) {
+    return selection->ArrayIsEnabled(name) ? sector.GetPointer() : nullptr;
+  };
+  CopyColumnRange(frame.PointsX, first, n, this->PointsX, output("X"));
+  CopyColumnRange(frame.PointsY, first, n, this->PointsY, output("Y"));
+  CopyColumnRange(frame.PointsZ, first, n, this->PointsZ, output("Z"));
+  CopyColumnRange(frame.Intensity, first, n, this->Intensity, output("intensity"));
+  CopyColumnRange(frame.LaserId, first, n, this->LaserId, output("laser_id"));
+  CopyColumnRange(frame.Azimuth, first, n, this->Azimuth, output("azimuth"));
+  CopyColumnRange(frame.Distance, first, n, this->Distance, output("distance_m"));
+  CopyColumnRange(frame.DistanceRaw, first, n, this->DistanceRaw, output("distance_raw"));
+  CopyColumnRange(frame.Timestamp, first, n, this->Timestamp, output("adjustedtime"));
+  CopyColumnRange(frame.VerticalAngle, first, n, this->VerticalAngle, output("vertical_angle"));
+  CopyColumnRange(frame.RawTime, first, n, this->RawTime, output("timestamp"));
+  if (this->HasDualReturn)
+  {
+    CopyColumnRange(frame.IntensityFlag, first, n, this->IntensityFlag, output("dual_intensity"));
+    CopyColumnRange(frame.DistanceFlag, first, n, this->DistanceFlag, output("dual_distance"));
+    // the ids of the matching returns are the ones of the frame, so that they are still valid
+    // once the sectors are assembled
+    CopyColumnRange(frame.DualReturnMatching, first, n, this->DualReturnMatching,
+      output("dual_return_matching"));
+  }
+
+  vtkNew<vtkDoubleArray> rpmData;
+  rpmData->SetNumberOfTuples(1);
+  rpmData->SetName("RotationPerMinute");
+  rpmData->SetTuple1(0, this->Frequency);
+  sector->GetFieldData()->AddArray(rpmData.GetPointer());
+  // the frame assembled from the sectors has the field data of its last sector
+  if (isLast)
+  {
+    this->Statistics->AddTo(sector->GetFieldData());
+  }
+  LidarSectorAssembler::SetSectorInformation(sector, this->FrameCounter, this->CurrentSector, isLast);
+
+  this->Sectors.push_back(sector);
 }
 
 //-----------------------------------------------------------------------------
 void vtkVelodynePacketInterpreter::ResetCurrentFrame()
 {
-  std::fill(this->LastPointId, this->LastPointId + HDL_MAX_NUM_LASERS, -1);
+  this->LastReturns->Reset();
   this->CurrentFrameState->reset();
   this->LastTimestamp = std::numeric_limits<unsigned int>::max();
   this->TimeAdjust = std::numeric_limits<double>::quiet_NaN();
 
   this->rollingCalibrationData->clear();
+  this->RollingCalibrationSequence = 0;
   this->HasDualReturn = false;
   this->IsHDL64Data = false;
   this->IsVLS128 = false;
+  this->PacketDecoder = nullptr;
   this->Frames.clear();
+  this->Sectors.clear();
+  this->SectorStart = 0;
+  this->SectorEnd = 0;
+  this->CurrentSector = -1;
+  this->RangeImage->Clear();
+  this->Statistics->Clear();
   this->CurrentFrame = this->CreateNewEmptyFrame(0);
 
   this->ShouldCheckSensor = true;
@@ -1398,18 +2369,10 @@ void vtkVelodynePacketInterpreter::ResetCurrentFrame()
 void vtkVelodynePacketInterpreter::PreProcessPacket(unsigned char const * data, unsigned int dataLength, bool &isNewFrame, int &framePositionInPacket)
 {
   const HDLDataPacket* dataPacket = reinterpret_cast<const HDLDataPacket*>(data);
-  //! @todo don't use static value here this is ugly...
-  static bool isEmptyFrame = true;
-  static FramingState currentFrameState;
-  static int numberOfFiringPackets = 0;
-  static int lastnumberOfFiringPackets = 0;
-  static int frameNumber;
 
   isNewFrame = false;
   framePositionInPacket = 0;
 
-  numberOfFiringPackets++;
-
   //! @todo this could be useful at a higher level
   if (this->ShouldCheckSensor)
   {
@@ -1417,65 +2380,25 @@ void vtkVelodynePacketInterpreter::PreProcessPacket(unsigned char const * data,
     this->ShouldCheckSensor = false;
   }
 
-
-  //    unsigned int timeDiff = dataPacket->gpsTimestamp - lastTimestamp;
-  //    if (timeDiff > 600 && lastTimestamp != 0)
-  //      {
-  //      printf("missed %d packets\n",  static_cast<int>(floor((timeDiff/553.0) + 0.5)));
-  //      }
-
-
-
   this->IsHDL64Data |= dataPacket->isHDL64();
 
   this->IsVLS128 = dataPacket->isVLS128();
 
-  for (int i = 0; i < HDL_FIRING_PER_PKT; ++i)
+  if (!this->PacketDetector)
   {
-    const HDLFiringData& firingData = dataPacket->firingData[i];
-
-
-    // Skip dummy blocks of VLS-128 dual mode last 4 blocks
-    if (IsVLS128 && (firingData.blockIdentifier == 0 || firingData.blockIdentifier == 0xFFFF))
-    {
-      continue;
-    }
-
-    // Test if at least one laser has a positive distance
-    if (this->IgnoreZeroDistances)
-    {
-      for (int laserID = 0; laserID < HDL_LASER_PER_FIRING; laserID++)
-      {
-        if (firingData.laserReturns[laserID].distance != 0)
-        {
-          isEmptyFrame = false;
-          break;
-        }
-      }
-    }
-    else
-    {
-      isEmptyFrame = false;
-    }
-
-    if (currentFrameState.hasChangedWithValue(firingData))
+    this->ResetPreProcessing();
+  }
+  this->PacketDetector->DetectFrame(data, dataLength, this->PacketSplits);
+  for (const LidarFrameDetector::Split& split : this->PacketSplits)
+  {
+    // Add file position if the frame is not empty
+    if (split.HasContent || !this->IgnoreEmptyFrames)
     {
-      // Add file position if the frame is not empty
-      if (!isEmptyFrame || !this->IgnoreEmptyFrames)
-      {
-        isNewFrame = true;
-        framePositionInPacket = i;
-        frameNumber++;
-        PacketProcessingDebugMacro(
-          << "\n\nEnd of frame #" << frameNumber
-          << ". #packets: " << numberOfFiringPackets - lastnumberOfFiringPackets << "\n\n"
-          << "RotationalPositions: ");
-        lastnumberOfFiringPackets = numberOfFiringPackets;
-      }
-      // We start a new frame, reinitialize the boolean
-      isEmptyFrame = true;
+      isNewFrame = true;
+      framePositionInPacket = split.PositionInPacket;
+      PacketProcessingDebugMacro(<< "\n\nEnd of frame in block #" << split.PositionInPacket
+                                 << " of the packet\n\n");
     }
-    PacketProcessingDebugMacro(<< firingData.rotationalPosition << ", ");
   }
 
   // Accumulate HDL64 Status byte data
@@ -1487,6 +2410,13 @@ void vtkVelodynePacketInterpreter::PreProcessPacket(unsigned char const * data,
   }
 }
 
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::ResetPreProcessing()
+{
+  delete this->PacketDetector;
+  this->PacketDetector = new VelodyneFrameDetector(this->IgnoreZeroDistances);
+}
+
 //-----------------------------------------------------------------------------
 bool vtkVelodynePacketInterpreter::CheckReportedSensorAndCalibrationFileConsistent(const HDLDataPacket* dataPacket)
 {
@@ -1526,6 +2456,323 @@ bool vtkVelodynePacketInterpreter::CheckReportedSensorAndCalibrationFileConsiste
   return true;
 }
 
+//-----------------------------------------------------------------------------
+LidarFrameDetector* vtkVelodynePacketInterpreter::CreateFrameDetector()
+{
+  return new VelodyneFrameDetector(this->IgnoreZeroDistances);
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkLidarPacketInterpreter> vtkVelodynePacketInterpreter::CreatePartitionDecoder()
+{
+  // the timestamps of a partition are only known once it is appended, after the poses are needed
+  if (this->PoseInterpolator)
+  {
+    return nullptr;
+  }
+  vtkSmartPointer<vtkVelodynePacketInterpreter> decoder =
+    vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  decoder->CopyDecodingSettings(this);
+  std::copy(this->laser_corrections_, this->laser_corrections_ + HDL_MAX_NUM_LASERS,
+    decoder->laser_corrections_);
+  std::copy(&this->XMLColorTable[0][0], &this->XMLColorTable[0][0] + 3 * HDL_MAX_NUM_LASERS,
+    &decoder->XMLColorTable[0][0]);
+  decoder->PrecomputeCorrectionCosSin();
+  decoder->IsCorrectionFromLiveStream = this->IsCorrectionFromLiveStream;
+  decoder->UseIntraFiringAdjustment = this->UseIntraFiringAdjustment;
+  decoder->FiringsSkip = this->FiringsSkip;
+  decoder->DualReturnFilter = this->DualReturnFilter;
+  decoder->WantIntensityCorrection = this->WantIntensityCorrection;
+  decoder->SensorPowerMode = this->SensorPowerMode;
+  decoder->UseSinglePrecision = this->UseSinglePrecision;
+  decoder->ReportedFactoryField1 = this->ReportedFactoryField1;
+  decoder->ReportedFactoryField2 = this->ReportedFactoryField2;
+  // the partitions are never split into frames, the warnings are given by this interpreter
+  decoder->alreadyWarnedForIgnoredHDL64FiringPacket = true;
+  return decoder;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkLidarPacketInterpreter> vtkVelodynePacketInterpreter::CreatePreviewDecoder(
+  int decimation)
+{
+  vtkSmartPointer<vtkLidarPacketInterpreter> decoder =
+    this->Superclass::CreatePreviewDecoder(decimation);
+  vtkVelodynePacketInterpreter* preview = vtkVelodynePacketInterpreter::SafeDownCast(decoder);
+  if (preview && decimation > 1)
+  {
+    // the firings skipped by the user stay skipped
+    preview->FiringsSkip = (this->FiringsSkip + 1) * decimation - 1;
+  }
+  return decoder;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkLidarPacketInterpreter> vtkVelodynePacketInterpreter::CreateUnfilteredDecoder()
+{
+  // the range image, the dual return filter and the selected dual returns depend on the
+  // returns removed while decoding
+  if (this->RangeImageWidth > 0 || this->DualReturnFilter != 0 || this->ShouldAddDualReturnArray)
+  {
+    return nullptr;
+  }
+  vtkSmartPointer<vtkLidarPacketInterpreter> decoder = this->CreatePartitionDecoder();
+  if (!decoder)
+  {
+    return nullptr;
+  }
+  decoder->SetCropMode(CROP_MODE::None);
+  decoder->SetLaserSelection(std::vector<bool>(this->LaserSelection.size(), true));
+  return decoder;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkVelodynePacketInterpreter::FilterFrame(vtkPolyData* frame)
+{
+  VV_TRACE_SCOPE("vtkVelodynePacketInterpreter::FilterFrame");
+  // the partition decoders give all the arrays, whatever the array selection, and the dual
+  // return arrays of the dual return frames
+  vtkPointData* pointData = frame->GetPointData();
+  vtkUnsignedCharArray* laserIds =
+    vtkUnsignedCharArray::SafeDownCast(pointData->GetArray("laser_id"));
+  vtkUnsignedShortArray* azimuths =
+    vtkUnsignedShortArray::SafeDownCast(pointData->GetArray("azimuth"));
+  vtkIdTypeArray* matching =
+    vtkIdTypeArray::SafeDownCast(pointData->GetArray("dual_return_matching"));
+  vtkFloatArray* points =
+    frame->GetPoints() ? vtkFloatArray::SafeDownCast(frame->GetPoints()->GetData()) : nullptr;
+  const bool selectsLasers =
+    std::find(this->LaserSelection.begin(), this->LaserSelection.end(), false) !=
+    this->LaserSelection.end();
+  const bool crops =
+    this->CropMode == CROP_MODE::Cartesian || this->CropMode == CROP_MODE::Spherical;
+  if (!points || (selectsLasers && !laserIds) || (crops && !azimuths))
+  {
+    return nullptr;
+  }
+
+  // the crop is tested on the positions in double precision when they are available, as while
+  // decoding
+  vtkDoubleArray* xs = vtkDoubleArray::SafeDownCast(pointData->GetArray("X"));
+  vtkDoubleArray* ys = vtkDoubleArray::SafeDownCast(pointData->GetArray("Y"));
+  vtkDoubleArray* zs = vtkDoubleArray::SafeDownCast(pointData->GetArray("Z"));
+  const bool hasDoublePositions = xs && ys && zs;
+
+  // each range numbers its kept points, the ranges are then shifted by the points kept before
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+  const int numberOfRanges = GetNumberOfPointRanges(0, numberOfPoints);
+  std::vector<vtkIdType> newIds(numberOfPoints);
+  std::vector<vtkIdType> rangeOffsets(numberOfRanges + 1, 0);
+  ParallelFor(numberOfPoints, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    vtkIdType count = 0;
+    double pos[3];
+    for (size_t i = begin; i < end; ++i)
+    {
+      bool kept = true;
+      if (selectsLasers)
+      {
+        const size_t laserId = laserIds->GetValue(i);
+        kept = laserId < this->LaserSelection.size() && this->LaserSelection[laserId];
+      }
+      if (kept && crops)
+      {
+        if (hasDoublePositions)
+        {
+          pos[0] = xs->GetValue(i);
+          pos[1] = ys->GetValue(i);
+          pos[2] = zs->GetValue(i);
+        }
+        else
+        {
+          const float* point = points->GetPointer(3 * i);
+          std::copy(point, point + 3, pos);
+        }
+        kept = !this->shouldBeCroppedOut(pos, azimuths->GetValue(i) / 100.0);
+      }
+      newIds[i] = kept ? count++ : -1;
+    }
+    rangeOffsets[range + 1] = count;
+  });
+  for (int range = 0; range < numberOfRanges; ++range)
+  {
+    rangeOffsets[range + 1] += rangeOffsets[range];
+  }
+  const vtkIdType numberOfKeptPoints = rangeOffsets.back();
+  if (numberOfKeptPoints == numberOfPoints)
+  {
+    return frame;
+  }
+
+  // the arrays which are not selected are not given to the output
+  vtkSmartPointer<vtkPolyData> output = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> outputPoints;
+  outputPoints->SetDataTypeToFloat();
+  outputPoints->SetNumberOfPoints(numberOfKeptPoints);
+  outputPoints->GetData()->SetName(points->GetName());
+  output->SetPoints(outputPoints.GetPointer());
+  std::vector<vtkDataArray*> inputArrays(1, points);
+  std::vector<vtkDataArray*> outputArrays(1, outputPoints->GetData());
+  for (int arrayIndex = 0; arrayIndex < pointData->GetNumberOfArrays(); ++arrayIndex)
+  {
+    vtkDataArray* inputArray = pointData->GetArray(arrayIndex);
+    if (!inputArray || !inputArray->GetName() ||
+      (this->PointArraySelection->ArrayExists(inputArray->GetName()) &&
+        !this->PointArraySelection->ArrayIsEnabled(inputArray->GetName())))
+    {
+      continue;
+    }
+    vtkSmartPointer<vtkDataArray> outputArray;
+    outputArray.TakeReference(inputArray->NewInstance());
+    outputArray->SetName(inputArray->GetName());
+    outputArray->SetNumberOfComponents(inputArray->GetNumberOfComponents());
+    outputArray->SetNumberOfTuples(numberOfKeptPoints);
+    output->GetPointData()->AddArray(outputArray);
+    inputArrays.push_back(inputArray);
+    outputArrays.push_back(outputArray);
+  }
+  output->GetFieldData()->ShallowCopy(frame->GetFieldData());
+
+  std::vector<vtkIdType> keptIds(numberOfKeptPoints);
+  ParallelFor(numberOfPoints, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+    {
+      if (newIds[i] < 0)
+      {
+        continue;
+      }
+      newIds[i] += rangeOffsets[range];
+      keptIds[newIds[i]] = i;
+      for (size_t arrayIndex = 0; arrayIndex < inputArrays.size(); ++arrayIndex)
+      {
+        const size_t tupleSize =
+          inputArrays[arrayIndex]->GetDataTypeSize() * inputArrays[arrayIndex]->GetNumberOfComponents();
+        std::memcpy(static_cast<char*>(outputArrays[arrayIndex]->GetVoidPointer(0)) +
+            newIds[i] * tupleSize,
+          static_cast<char*>(inputArrays[arrayIndex]->GetVoidPointer(0)) + i * tupleSize,
+          tupleSize);
+      }
+    }
+  });
+
+  // the scan lines of the frame are indexed again with the kept points
+  if (laserIds)
+  {
+    std::vector<unsigned char> keptLaserIds(numberOfKeptPoints);
+    for (vtkIdType id = 0; id < numberOfKeptPoints; ++id)
+    {
+      keptLaserIds[id] = laserIds->GetValue(keptIds[id]);
+    }
+    ScanLineIndex::AddTo(output->GetFieldData(), keptLaserIds.data(), numberOfKeptPoints,
+      this->CalibrationReportedNumLasers);
+  }
+
+  // a return whose dual return is removed is decoded as a single return
+  if (matching)
+  {
+    vtkPointData* outputData = output->GetPointData();
+    vtkIdTypeArray* outputMatching =
+      vtkIdTypeArray::SafeDownCast(outputData->GetArray("dual_return_matching"));
+    vtkIntArray* distanceFlags = vtkIntArray::SafeDownCast(outputData->GetArray("dual_distance"));
+    vtkIntArray* intensityFlags =
+      vtkIntArray::SafeDownCast(outputData->GetArray("dual_intensity"));
+    for (vtkIdType id = 0; id < numberOfKeptPoints; ++id)
+    {
+      const vtkIdType dualId = matching->GetValue(keptIds[id]);
+      const vtkIdType newDualId = dualId >= 0 ? newIds[dualId] : -1;
+      if (outputMatching)
+      {
+        outputMatching->SetValue(id, newDualId);
+      }
+      if (dualId >= 0 && newDualId < 0)
+      {
+        if (distanceFlags)
+        {
+          distanceFlags->SetValue(id, 0);
+        }
+        if (intensityFlags)
+        {
+          intensityFlags->SetValue(id, 0);
+        }
+      }
+    }
+  }
+
+  output->SetVerts(NewVertexCells(numberOfKeptPoints));
+  return output;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkVelodynePacketInterpreter::AppendPartition(vtkLidarPacketInterpreter* partition)
+{
+  vtkVelodynePacketInterpreter* decoder = vtkVelodynePacketInterpreter::SafeDownCast(partition);
+  if (!decoder || decoder->IsNewFrameReady() || this->IsNewFrameReady() ||
+    !this->CurrentFrameState->append(*decoder->CurrentFrameState))
+  {
+    return false;
+  }
+  // the partition has not seen any packet
+  if (!vtkMath::IsFinite(decoder->TimeAdjust))
+  {
+    return true;
+  }
+
+  // the timestamps of the partition start from its first packet, continue the ones of the frame
+  double timeAdjust = 0;
+  if (vtkMath::IsFinite(this->TimeAdjust))
+  {
+    timeAdjust = this->TimeAdjust;
+    if (decoder->FirstTimestamp < this->LastTimestamp)
+    {
+      timeAdjust += HourInMicroseconds;
+    }
+  }
+  else
+  {
+    this->FirstTimestamp = decoder->FirstTimestamp;
+  }
+  const vtkIdType offset = this->FrameBuilder->NumberOfPoints;
+  this->FrameBuilder->Append(*decoder->FrameBuilder);
+  double* timestamps = this->FrameBuilder->Timestamp.Data;
+  for (vtkIdType i = offset; i < this->FrameBuilder->NumberOfPoints; ++i)
+  {
+    timestamps[i] += timeAdjust;
+  }
+  this->RangeImage->Append(*decoder->RangeImage, timeAdjust);
+  this->Statistics->Append(*decoder->Statistics);
+  this->TimeAdjust = timeAdjust + decoder->TimeAdjust;
+  this->LastTimestamp = decoder->LastTimestamp;
+
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    const DualReturnTracker::LaserReturn& laser = decoder->LastReturns->Lasers[i];
+    if (laser.PointId >= 0)
+    {
+      this->LastReturns->Lasers[i] = laser;
+      this->LastReturns->Lasers[i].PointId += offset;
+    }
+  }
+  this->FirstPointIdOfDualReturnPair = decoder->FirstPointIdOfDualReturnPair + offset;
+  this->RpmCalculator_->Merge(*decoder->RpmCalculator_);
+
+  if (decoder->IsHDL64Data && !this->IsHDL64Data)
+  {
+    this->IsHDL64Data = true;
+    this->PacketDecoder = nullptr;
+  }
+  if (!this->IsHDL64Data)
+  {
+    this->ReportedSensor = decoder->ReportedSensor;
+    this->ReportedSensorReturnMode = decoder->ReportedSensorReturnMode;
+  }
+  if (decoder->HasDualReturn && !this->HasDualReturn)
+  {
+    this->HasDualReturn = true;
+    this->AddDualReturnArrays(this->CurrentFrame);
+  }
+  this->ShouldCheckSensor = false;
+  return true;
+}
+
 //-----------------------------------------------------------------------------
 std::string vtkVelodynePacketInterpreter::GetSensorInformation()
 {
@@ -1544,15 +2791,138 @@ std::string vtkVelodynePacketInterpreter::GetSensorInformation()
 }
 
 //-----------------------------------------------------------------------------
-void vtkVelodynePacketInterpreter::SetSelectedPointsWithDualReturn(double* data, int Npoints)
+bool vtkVelodynePacketInterpreter::GetStreamCalibration(std::vector<unsigned char>& data)
 {
-  this->SelectedDualReturn = vtkSmartPointer<vtkDoubleArray>::New();
-  this->SelectedDualReturn->Allocate(60000);
-  this->SelectedDualReturn->SetName("dualReturn_of_selectedPoints");
+  // only the HDL-64 rolling calibration is read from the stream
+  if (!this->IsCorrectionFromLiveStream || !this->IsCalibrated)
+  {
+    return false;
+  }
+
+  const int header[3] = { this->CalibrationReportedNumLasers,
+    static_cast<int>(this->SensorPowerMode), static_cast<int>(this->ReportedSensorReturnMode) };
+  data.resize(sizeof(header) + sizeof(this->laser_corrections_));
+  std::memcpy(&data[0], header, sizeof(header));
+  std::memcpy(&data[sizeof(header)], this->laser_corrections_, sizeof(this->laser_corrections_));
+  return true;
+}
 
-  for (int k = 0; k < Npoints; ++k)
+//-----------------------------------------------------------------------------
+bool vtkVelodynePacketInterpreter::SetStreamCalibration(const std::vector<unsigned char>& data)
+{
+  int header[3];
+  if (!this->IsCorrectionFromLiveStream ||
+    data.size() != sizeof(header) + sizeof(this->laser_corrections_))
+  {
+    return false;
+  }
+
+  std::memcpy(header, &data[0], sizeof(header));
+  std::memcpy(this->laser_corrections_, &data[sizeof(header)], sizeof(this->laser_corrections_));
+  this->CalibrationReportedNumLasers = header[0];
+  this->SensorPowerMode = static_cast<unsigned char>(header[1]);
+  this->ReportedSensorReturnMode = static_cast<DualReturnSensorMode>(header[2]);
+  this->PrecomputeCorrectionCosSin();
+  this->IsCalibrated = true;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkVelodynePacketInterpreter::GetDecodingKey()
+{
+  // the calibration may come from the stream, it is identified by its content. The structure
+  // is padded, only the corrections themselves are hashed.
+  std::vector<double> corrections;
+  corrections.reserve(HDL_MAX_NUM_LASERS * 12);
+  for (int i = 0; i < HDL_MAX_NUM_LASERS; ++i)
+  {
+    const HDLLaserCorrection& correction = this->laser_corrections_[i];
+    const double values[12] = { correction.rotationalCorrection, correction.verticalCorrection,
+      correction.distanceCorrection, correction.distanceCorrectionX,
+      correction.distanceCorrectionY, correction.verticalOffsetCorrection,
+      correction.horizontalOffsetCorrection, correction.focalDistance, correction.focalSlope,
+      correction.closeSlope, static_cast<double>(correction.minIntensity),
+      static_cast<double>(correction.maxIntensity) };
+    corrections.insert(corrections.end(), values, values + 12);
+  }
+
+  std::stringstream key;
+  key << this->Superclass::GetDecodingKey() << std::hex << " CorrectionsHash="
+      << DecodedFrameFile::Hash(&corrections[0], corrections.size() * sizeof(double)) << std::dec
+      << " SensorPowerMode=" << static_cast<int>(this->SensorPowerMode)
+      << " FactoryFields=" << static_cast<int>(this->ReportedFactoryField1) << ","
+      << static_cast<int>(this->ReportedFactoryField2)
+      << " FiringsSkip=" << this->FiringsSkip
+      << " UseIntraFiringAdjustment=" << this->UseIntraFiringAdjustment
+      << " DualReturnFilter=" << this->DualReturnFilter
+      << " WantIntensityCorrection=" << this->WantIntensityCorrection
+      << " ShouldAddDualReturnArray=" << this->ShouldAddDualReturnArray
+      << " SelectedDualReturns=" << this->SelectedDualReturnsHash
+      << " UseSinglePrecision=" << this->UseSinglePrecision
+      << " PoseSource=" << this->PoseSourceHash << " PointArrays=";
+  for (int i = 0; i < this->GetNumberOfPointArrays(); ++i)
+  {
+    const char* name = this->GetPointArrayName(i);
+    if (this->GetPointArrayStatus(name))
+    {
+      key << name << ",";
+    }
+  }
+  return key.str();
+}
+
+//-----------------------------------------------------------------------------
+void vtkVelodynePacketInterpreter::SetSelectedPointsWithDualReturn(vtkDataSet* selectedPoints)
+{
+  vtkDataArray* laserIds =
+    selectedPoints ? selectedPoints->GetPointData()->GetArray("laser_id") : nullptr;
+  vtkDataArray* azimuths =
+    selectedPoints ? selectedPoints->GetPointData()->GetArray("azimuth") : nullptr;
+  if (selectedPoints && selectedPoints->GetNumberOfPoints() > 0 && (!laserIds || !azimuths))
+  {
+    vtkErrorMacro("The selected points have no laser_id or azimuth array");
+    return;
+  }
+
+  // the rank of a return in its firing is known from the ids in its frame, which the extracted
+  // selections keep, both returns are selected otherwise
+  vtkDataArray* matching =
+    selectedPoints ? selectedPoints->GetPointData()->GetArray("dual_return_matching") : nullptr;
+  vtkDataArray* originalIds =
+    selectedPoints ? selectedPoints->GetPointData()->GetArray("vtkOriginalPointIds") : nullptr;
+  const bool hasRanks = matching && originalIds;
+
+  this->SelectedDualReturns->Clear();
+  const vtkIdType numberOfPoints = laserIds && azimuths ? selectedPoints->GetNumberOfPoints() : 0;
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    const unsigned char laserId = static_cast<unsigned char>(laserIds->GetTuple1(i));
+    const unsigned short azimuth = static_cast<unsigned short>(azimuths->GetTuple1(i));
+    const int tolerance = this->DualReturnSelectionTolerance;
+    if (hasRanks)
+    {
+      const double dual = matching->GetTuple1(i);
+      const bool isSecondReturn = dual >= 0 && dual < originalIds->GetTuple1(i);
+      this->SelectedDualReturns->Add(laserId, azimuth, isSecondReturn, tolerance);
+    }
+    else
+    {
+      this->SelectedDualReturns->Add(laserId, azimuth, false, tolerance);
+      this->SelectedDualReturns->Add(laserId, azimuth, true, tolerance);
+    }
+  }
+
+  // the decoded frames are cached by decoding key, which tells the selections apart
+  std::stringstream hash;
+  if (!this->SelectedDualReturns->IsEmpty())
+  {
+    const std::vector<vtkTypeUInt64>& keys = this->SelectedDualReturns->GetKeys();
+    hash << std::hex << DecodedFrameFile::Hash(keys.data(), keys.size() * sizeof(vtkTypeUInt64));
+  }
+  if (hash.str() != this->SelectedDualReturnsHash)
   {
-    this->SelectedDualReturn->InsertNextValue(data[k]);
+    this->SelectedDualReturnsHash = hash.str();
+    this->Modified();
   }
 }
 
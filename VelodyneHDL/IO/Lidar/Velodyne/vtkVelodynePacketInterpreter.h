@@ -3,6 +3,7 @@
 
 #include "vtkLidarPacketInterpreter.h"
 #include "vtkDataPacket.h"
+#include "VelodyneFiringKernel.h"
 #include <vtkUnsignedCharArray.h>
 #include <vtkUnsignedIntArray.h>
 #include <vtkUnsignedShortArray.h>
@@ -11,8 +12,21 @@
 using namespace DataPacketFixedLength;
 
 class RPMCalculator;
+class vtkDataArraySelection;
+class vtkDataSet;
 class FramingState;
+class VelodyneFrameDetector;
+struct VelodyneFrameBuilder;
+struct FiringTimingTable;
+struct SphericalCropTest;
+struct DualReturnTracker;
+struct FrameRecycler;
+struct RangeImageBuilder;
+struct LaserStatistics;
+struct DualReturnSelection;
 class vtkRollingDataAccumulator;
+class vtkTemporalTransforms;
+class vtkVelodyneTransformInterpolator;
 
 
 class VTK_EXPORT vtkVelodynePacketInterpreter : public vtkLidarPacketInterpreter
@@ -40,15 +54,85 @@ public:
 
   bool IsLidarPacket(unsigned char const * data, unsigned int dataLength) override;
 
+  bool HasPacketSignature(unsigned char const * data, unsigned int dataLength) override;
+
+  /**
+   * @brief GetPacketAzimuthRange azimuth of the first firing block of the packet, and of the
+   * last one plus the step between two firings, the dummy blocks of the VLS-128 being skipped
+   */
+  bool GetPacketAzimuthRange(unsigned char const* data, unsigned int dataLength,
+    double& firstAzimuth, double& lastAzimuth) override;
+
+  /**
+   * @brief GetMaximumAzimuthCorrection largest rotational correction of the calibrated lasers
+   */
+  double GetMaximumAzimuthCorrection() override;
+
+  /**
+   * @brief GetPacketDistanceRange range of the raw distances of the firing blocks of the packet,
+   * scaled by DistanceResolutionM, the dummy blocks of the VLS-128 being skipped
+   */
+  bool GetPacketDistanceRange(unsigned char const* data, unsigned int dataLength,
+    double& minDistance, double& maxDistance, bool& hasZeroDistance) override;
+
+  /**
+   * @brief GetMaximumDistanceCorrection largest distance correction of the calibrated lasers,
+   * plus the offset of their returns from their direction
+   */
+  double GetMaximumDistanceCorrection() override;
+
+  /**
+   * @brief GetPacketSensorTime GPS timestamp of the packet, which the sensor gives in
+   * microseconds since the top of the hour
+   */
+  bool GetPacketSensorTime(
+    unsigned char const* data, unsigned int dataLength, double& time) override;
+
+  /**
+   * @brief GetFrameSensorTime GPS time of the first return of the frame, in seconds since the
+   * top of the hour of the first frame, taken from its adjustedtime array
+   */
+  double GetFrameSensorTime(vtkPolyData* frame) override;
+
   vtkSmartPointer<vtkPolyData> CreateNewEmptyFrame(vtkIdType numberOfPoints, vtkIdType prereservedNumberOfPoints = 60000) override;
 
   void ResetCurrentFrame() override;
 
   void PreProcessPacket(unsigned char const * data, unsigned int dataLength, bool &isNewFrame, int &framePositionInPacket) override;
 
+  void ResetPreProcessing() override;
+
+  LidarFrameDetector* CreateFrameDetector() override;
+
+  vtkSmartPointer<vtkLidarPacketInterpreter> CreatePartitionDecoder() override;
+
+  bool AppendPartition(vtkLidarPacketInterpreter* partition) override;
+
+  vtkSmartPointer<vtkLidarPacketInterpreter> CreatePreviewDecoder(int decimation) override;
+
+  vtkSmartPointer<vtkLidarPacketInterpreter> CreateUnfilteredDecoder() override;
+
+  vtkSmartPointer<vtkPolyData> FilterFrame(vtkPolyData* frame) override;
+
   std::string GetSensorInformation() override;
 
-  void SetSelectedPointsWithDualReturn(double* data, int Npoints);
+  bool GetStreamCalibration(std::vector<unsigned char>& data) override;
+
+  bool SetStreamCalibration(const std::vector<unsigned char>& data) override;
+
+  std::string GetDecodingKey() override;
+
+  // Select the returns at the laser and the azimuth of some points, read from their laser_id and
+  // azimuth arrays, such as the points extracted from a selection in a frame. The selection
+  // holds in every frame, and when ShouldAddDualReturnArray is set the frames have a
+  // dual_return_selected array which is 1 for the dual returns of the selected returns. The
+  // first or second return of a firing is told apart with the dual_return_matching and
+  // vtkOriginalPointIds arrays, both are selected without them. The returns are selected within
+  // DualReturnSelectionTolerance hundredths of degree of the azimuths. A null or empty data set
+  // clears the selection.
+  void SetSelectedPointsWithDualReturn(vtkDataSet* selectedPoints);
+  vtkGetMacro(DualReturnSelectionTolerance, int)
+  vtkSetMacro(DualReturnSelectionTolerance, int)
 
   void GetXMLColorTable(double XMLColorTable[]);
 
@@ -74,6 +158,26 @@ public:
 
   vtkSetMacro(DualReturnFilter, unsigned int)
 
+  // Store the X, Y, Z, distance_m and vertical_angle arrays in single precision,
+  // the points are always in single precision
+  vtkGetMacro(UseSinglePrecision, bool)
+  vtkSetMacro(UseSinglePrecision, bool)
+
+  // Trajectory of the sensor, whose times are in seconds like the adjustedtime array divided by
+  // 1e6. When it is set the points are given in its world coordinates, the pose of each firing
+  // block being interpolated at the time of the block, which removes the distortion due to the
+  // motion of the sensor while decoding. The poses are copied, it must be set again once the
+  // trajectory is modified. The frames are then decoded sequentially, without partitions.
+  void SetPoseSource(vtkTemporalTransforms* trajectory);
+  bool HasPoseSource() { return this->PoseInterpolator != nullptr; }
+
+  // Selection of the point arrays added to the frames, by name. All the arrays are output by
+  // default, unselecting the unused ones reduces the memory used by each frame.
+  int GetNumberOfPointArrays();
+  const char* GetPointArrayName(int index);
+  int GetPointArrayStatus(const char* name);
+  void SetPointArrayStatus(const char* name, int status);
+
 protected:
   // Process the laser return from the firing data
   // firingData - one of HDL_FIRING_PER_PKT from the packet
@@ -82,16 +186,37 @@ protected:
   // azimuthDiff - average azimuth change between firings
   // timestamp - the timestamp of the packet
   // geotransform - georeferencing transform
-  void ProcessFiring(const HDLFiringData* firingData,
+  // Family - layout of the packets of the sensor (see SelectPacketDecoder)
+  template<typename Family>
+  void ProcessFiringFor(const HDLFiringData* firingData,
     int firingBlockLaserOffset, int firingBlock, int azimuthDiff, double timestamp,
     unsigned int rawtime, bool isThisFiringDualReturnData, bool isDualReturnPacket);
 
+  // Decode the firing blocks of a packet, from the block startPosition
+  template<typename Family>
+  void ProcessPacketFor(const HDLDataPacket* dataPacket, int startPosition, double timestamp,
+    unsigned int rawtime);
+
+  typedef void (vtkVelodynePacketInterpreter::*PacketDecoderType)(
+    const HDLDataPacket*, int, double, unsigned int);
+
+  // Pick the instance of ProcessPacketFor matching the sensor and the calibration
+  PacketDecoderType SelectPacketDecoder(const HDLDataPacket* dataPacket);
+
+  // Add a return to the current frame
+  // azimuth - in [0, 36000)
+  // pos, distanceM - position and corrected distance computed by ComputeFiringPositions
   void PushFiringData(unsigned char laserId, unsigned char rawLaserId,
                       unsigned short azimuth, double timestamp,
                       unsigned int rawtime, const HDLLaserReturn* laserReturn,
-                      const HDLLaserCorrection* correction, bool isFiringDualReturnData);
+                      const HDLLaserCorrection* correction, double pos[3],
+                      double distanceM, bool isFiringDualReturnData);
 
-  void InitTrigonometricTables();
+  // Intra firing adjustments for the current sensor, built when the sensor changes
+  const FiringTimingTable& GetTimingTable();
+
+  // Rebuild the early spherical crop test when the crop settings or the transform change
+  void UpdateSphericalCropTest();
 
   void PrecomputeCorrectionCosSin();
 
@@ -99,32 +224,52 @@ protected:
 
   double ComputeTimestamp(unsigned int tohTime);
 
-  void ComputeCorrectedValues(const unsigned short azimuth,
-                              const HDLLaserReturn* laserReturn, const HDLLaserCorrection* correction, double pos[3],
-                              double& distanceM, short& intensity, bool correctIntensity);
+  // Intensity correction of the HDL-64
+  short ComputeCorrectedIntensity(const HDLLaserReturn* laserReturn, const HDLLaserCorrection* correction);
 
   bool HDL64LoadCorrectionsFromStreamData();
 
   bool CheckReportedSensorAndCalibrationFileConsistent(const HDLDataPacket* dataPacket);
 
+  // Give the buffers of the frame builder to the arrays of the current frame
+  void ReleaseFrameBuilder();
+
+  // Give the points of the frame builder whose sector is complete as sectors, all of them if
+  // the frame is split
+  void SplitSectors(bool endOfFrame);
+
+  // Copy the points [first, last) of the frame builder to a sector
+  void AddSector(vtkIdType first, vtkIdType last, bool isLast);
+
+  // Write a return in the range image, started on the first return of the frame
+  void AddRangeImageReturn(unsigned char laserId, unsigned short azimuth, double distanceM,
+                           unsigned char intensity, double timestamp);
+
+  // Add the selected arrays specific to dual return to a frame
+  void AddDualReturnArrays(vtkPolyData* polyData);
+
   vtkSmartPointer<vtkPoints> Points;
-  vtkSmartPointer<vtkDoubleArray> PointsX;
-  vtkSmartPointer<vtkDoubleArray> PointsY;
-  vtkSmartPointer<vtkDoubleArray> PointsZ;
+  vtkSmartPointer<vtkDataArray> PointsX;
+  vtkSmartPointer<vtkDataArray> PointsY;
+  vtkSmartPointer<vtkDataArray> PointsZ;
   vtkSmartPointer<vtkUnsignedCharArray> Intensity;
   vtkSmartPointer<vtkUnsignedCharArray> LaserId;
   vtkSmartPointer<vtkUnsignedShortArray> Azimuth;
-  vtkSmartPointer<vtkDoubleArray> Distance;
+  vtkSmartPointer<vtkDataArray> Distance;
   vtkSmartPointer<vtkUnsignedShortArray> DistanceRaw;
   vtkSmartPointer<vtkDoubleArray> Timestamp;
-  vtkSmartPointer<vtkDoubleArray> VerticalAngle;
+  vtkSmartPointer<vtkDataArray> VerticalAngle;
   vtkSmartPointer<vtkUnsignedIntArray> RawTime;
   vtkSmartPointer<vtkIntArray> IntensityFlag;
   vtkSmartPointer<vtkIntArray> DistanceFlag;
   vtkSmartPointer<vtkUnsignedIntArray> Flags;
   vtkSmartPointer<vtkIdTypeArray> DualReturnMatching;
-  vtkSmartPointer<vtkDoubleArray> SelectedDualReturn;
 
+  // Returns whose dual returns are marked in the frames, see SetSelectedPointsWithDualReturn,
+  // and the hash of their keys identifying them in the decoding key
+  DualReturnSelection* SelectedDualReturns;
+  std::string SelectedDualReturnsHash;
+  int DualReturnSelectionTolerance = 10;
   bool ShouldAddDualReturnArray;
 
   // sensor information
@@ -156,23 +301,49 @@ protected:
   RPMCalculator* RpmCalculator_;
 
   FramingState* CurrentFrameState;
+  // Frame split detection of PreProcessPacket, created by ResetPreProcessing
+  VelodyneFrameDetector* PacketDetector;
+  std::vector<LidarFrameDetector::Split> PacketSplits;
+  // Points of the current frame, they are moved to the vtk arrays when the frame is split
+  VelodyneFrameBuilder* FrameBuilder;
+  // Frames whose buffers are reused by the frame builder once they are released
+  FrameRecycler* Recycler;
+  // First point of the frame builder not given in a sector yet, and first point not checked
+  vtkIdType SectorStart;
+  vtkIdType SectorEnd;
+  // Sector of the azimuth of SectorStart, -1 if the frame has no point yet
+  int CurrentSector;
+  // Index of the frame under construction, which tells the sectors of a frame apart
+  int FrameCounter;
+  // Range image of the current frame, see RangeImageWidth
+  RangeImageBuilder* RangeImage;
+  // Statistics of the returns of the current frame, added to its field data
+  LaserStatistics* Statistics;
+  FiringTimingTable* TimingTable;
+  SphericalCropTest* CropTest;
+  // Selected on the first packet, reset with the frame or the calibration
+  PacketDecoderType PacketDecoder;
   unsigned int LastTimestamp;
+  // Time of the packet which started the time adjustment, used to append the partitions
+  unsigned int FirstTimestamp;
   std::vector<double> RpmByFrames;
   double TimeAdjust;
-  vtkIdType LastPointId[HDL_MAX_NUM_LASERS];
+  // Last return of each laser, used to match the dual returns
+  DualReturnTracker* LastReturns;
   vtkIdType FirstPointIdOfDualReturnPair;
 
   unsigned char SensorPowerMode;
 
   // Parameters ready by calibration
-  std::vector<double> cos_lookup_table_;
-  std::vector<double> sin_lookup_table_;
   HDLLaserCorrection laser_corrections_[HDL_MAX_NUM_LASERS];
+  FiringCorrectionTable CorrectionTable = FiringCorrectionTable();
   double XMLColorTable[HDL_MAX_NUM_LASERS][3];
   bool IsCorrectionFromLiveStream = true;
 
   // Sensor parameters presented as rolling data, extracted from enough packets
   vtkRollingDataAccumulator* rollingCalibrationData;
+  // Number of complete sequences of rollingCalibrationData when the corrections were last read
+  unsigned long RollingCalibrationSequence;
 
   // User configurable parameters
   int FiringsSkip;
@@ -183,6 +354,17 @@ protected:
 
   unsigned int DualReturnFilter;
 
+  bool UseSinglePrecision;
+
+  // Poses of the pose source, see SetPoseSource, and the hash of the poses identifying them
+  // in the decoding key
+  vtkSmartPointer<vtkVelodyneTransformInterpolator> PoseInterpolator;
+  std::string PoseSourceHash;
+  // Row-major 3x4 pose of the firing block being decoded, when there is a pose source
+  double FiringPose[12];
+
+  vtkSmartPointer<vtkDataArraySelection> PointArraySelection;
+
   vtkVelodynePacketInterpreter();
   ~vtkVelodynePacketInterpreter();
 
@@ -0,0 +1,158 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "NpyStackWriter.h"
+
+// STD
+#include <sstream>
+
+// VTK
+#include <vtkType.h>
+
+namespace
+{
+//! Size of the header, the magic string included, a multiple of 64 as NumPy recommends
+const size_t HeaderSize = 128;
+
+//! Size of the buffer of the file, so that the small frames are written in large blocks
+const size_t FileBufferSize = 1 << 20;
+}
+
+//-----------------------------------------------------------------------------
+NpyStackWriter::~NpyStackWriter()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+std::string NpyStackWriter::GetDescr(int vtkScalarType)
+{
+  switch (vtkScalarType)
+  {
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR:
+      return "|i1";
+    case VTK_UNSIGNED_CHAR:
+      return "|u1";
+    case VTK_SHORT:
+      return "<i2";
+    case VTK_UNSIGNED_SHORT:
+      return "<u2";
+    case VTK_INT:
+      return "<i4";
+    case VTK_UNSIGNED_INT:
+      return "<u4";
+    case VTK_LONG_LONG:
+      return "<i8";
+    case VTK_UNSIGNED_LONG_LONG:
+      return "<u8";
+    case VTK_FLOAT:
+      return "<f4";
+    case VTK_DOUBLE:
+      return "<f8";
+  }
+  return std::string();
+}
+
+//-----------------------------------------------------------------------------
+bool NpyStackWriter::Open(const std::string& fileName, const std::string& descr,
+  size_t itemSize, const std::vector<size_t>& frameShape)
+{
+  this->Close();
+  this->Descr = descr;
+  this->FrameShape = frameShape;
+  this->FrameSize = itemSize;
+  for (size_t dimension : frameShape)
+  {
+    this->FrameSize *= dimension;
+  }
+  this->NumberOfFrames = 0;
+  this->HasFailed = false;
+
+  this->File = std::fopen(fileName.c_str(), "wb");
+  if (!this->File)
+  {
+    return false;
+  }
+  std::setvbuf(this->File, nullptr, _IOFBF, FileBufferSize);
+  if (!this->WriteHeader())
+  {
+    std::fclose(this->File);
+    this->File = nullptr;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool NpyStackWriter::Append(const void* frame)
+{
+  if (!this->File || this->HasFailed)
+  {
+    return false;
+  }
+  if (this->FrameSize > 0 && std::fwrite(frame, this->FrameSize, 1, this->File) != 1)
+  {
+    this->HasFailed = true;
+    return false;
+  }
+  this->NumberOfFrames++;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool NpyStackWriter::Close()
+{
+  if (!this->File)
+  {
+    return false;
+  }
+  bool isWritten = !this->HasFailed && std::fseek(this->File, 0, SEEK_SET) == 0 &&
+    this->WriteHeader();
+  isWritten = std::fclose(this->File) == 0 && isWritten;
+  this->File = nullptr;
+  return isWritten;
+}
+
+//-----------------------------------------------------------------------------
+bool NpyStackWriter::WriteHeader()
+{
+  // version 1.0: the magic string, the version, the length of the dictionary on 2 bytes
+  // and the dictionary padded with spaces and ended by a new line
+  std::ostringstream dictionary;
+  dictionary << "{'descr': '" << this->Descr << "', 'fortran_order': False, 'shape': ("
+             << this->NumberOfFrames << ",";
+  for (size_t dimension : this->FrameShape)
+  {
+    dictionary << " " << dimension << ",";
+  }
+  dictionary << "), }";
+  std::string header = dictionary.str();
+  const size_t prefixSize = 10;
+  if (prefixSize + header.size() + 1 > HeaderSize)
+  {
+    return false;
+  }
+  header.resize(HeaderSize - prefixSize - 1, ' ');
+  header += '\n';
+
+  const char prefix[prefixSize] = { '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+    static_cast<char>(header.size() & 0xFF), static_cast<char>(header.size() >> 8) };
+  return std::fwrite(prefix, prefixSize, 1, this->File) == 1 &&
+    std::fwrite(header.data(), header.size(), 1, this->File) == 1;
+}
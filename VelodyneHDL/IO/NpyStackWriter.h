@@ -0,0 +1,79 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef NPY_STACK_WRITER_H
+#define NPY_STACK_WRITER_H
+
+// STD
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * \class NpyStackWriter
+ * \brief This class streams frames of the same shape into a NumPy .npy file, as an array
+ *        whose first axis is the frame, which numpy.load or numpy.memmap open as a tensor.
+ *        The header is written with room for any number of frames and rewritten by Close
+ *        with the number of frames appended, so the frames are never held in memory.
+ *        The data is written in the byte order of the machine, which must be little endian.
+ */
+class NpyStackWriter
+{
+public:
+  NpyStackWriter() = default;
+  ~NpyStackWriter();
+
+  /**
+   * \brief Open create the file, closing the previous one
+   * \param descr NumPy type of the values, for example "|u1", "<u2" or "<f4"
+   * \param itemSize size of a value in bytes
+   * \param frameShape dimensions of a frame, the last one varying the fastest
+   * \return false if the file cannot be created
+   */
+  bool Open(const std::string& fileName, const std::string& descr, size_t itemSize,
+    const std::vector<size_t>& frameShape);
+
+  //! Append a frame of GetFrameSize bytes, return false on a write error
+  bool Append(const void* frame);
+
+  //! Write the number of frames in the header and close the file, return false on error
+  bool Close();
+
+  bool IsOpen() const { return this->File != nullptr; }
+  size_t GetNumberOfFrames() const { return this->NumberOfFrames; }
+  size_t GetFrameSize() const { return this->FrameSize; }
+  const std::string& GetDescr() const { return this->Descr; }
+  const std::vector<size_t>& GetFrameShape() const { return this->FrameShape; }
+
+  //! NumPy type of a VTK scalar type, empty if there is none
+  static std::string GetDescr(int vtkScalarType);
+
+private:
+  NpyStackWriter(const NpyStackWriter&) = delete;
+  NpyStackWriter& operator=(const NpyStackWriter&) = delete;
+
+  bool WriteHeader();
+
+  FILE* File = nullptr;
+  std::string Descr;
+  std::vector<size_t> FrameShape;
+  size_t FrameSize = 0;
+  size_t NumberOfFrames = 0;
+  bool HasFailed = false;
+};
+
+#endif // NPY_STACK_WRITER_H
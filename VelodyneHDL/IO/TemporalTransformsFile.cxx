@@ -0,0 +1,396 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "TemporalTransformsFile.h"
+
+// VTK
+#include <vtkDoubleArray.h>
+
+// BOOST
+#include <boost/filesystem.hpp>
+
+// STD
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace
+{
+const char FileMagic[8] = { 'V', 'V', 'P', 'O', 'S', 'E', 'S', '\0' };
+const char FooterMagic[8] = { 'V', 'V', 'P', 'O', 'E', 'N', 'D', '\0' };
+
+// The file is the header, the chunks, the chunk table and the footer. A chunk is the
+// times, then the translations (x, y, z) and the orientations (axis x, y, z, angle)
+// of its transforms, all of them doubles.
+struct FileHeader
+{
+  char Magic[8];
+  boost::uint32_t Version;
+  boost::uint32_t Reserved;
+};
+
+struct FileFooter
+{
+  boost::uint64_t NumberOfChunks;
+  boost::uint64_t ChunkTableOffset;
+  char Magic[8];
+};
+
+//! Number of doubles of a transform in a chunk
+const boost::uint64_t ValuesPerTransform = 1 + 3 + 4;
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void WriteValue(std::ofstream& stream, const T& value)
+{
+  stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+void WriteDoubles(std::ofstream& stream, const std::vector<double>& values)
+{
+  if (!values.empty())
+  {
+    stream.write(reinterpret_cast<const char*>(&values[0]), values.size() * sizeof(double));
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+bool TemporalTransformsFile::IsTemporalTransformsFile(const std::string& fileName)
+{
+  std::ifstream stream(fileName.c_str(), std::ios::in | std::ios::binary);
+  char magic[sizeof(FileMagic)];
+  return stream.read(magic, sizeof(magic)) && std::memcmp(magic, FileMagic, sizeof(FileMagic)) == 0;
+}
+
+//-----------------------------------------------------------------------------
+bool TemporalTransformsFile::Open(const std::string& fileName)
+{
+  this->Close();
+
+  try
+  {
+    this->File.open(fileName);
+  }
+  catch (const std::exception& e)
+  {
+    this->LastError = "Cannot map " + fileName + ": " + e.what();
+    return false;
+  }
+  const char* data = this->File.data();
+  const boost::uint64_t size = static_cast<boost::uint64_t>(this->File.size());
+
+  FileHeader header;
+  FileFooter footer;
+  if (size < sizeof(FileHeader) + sizeof(FileFooter))
+  {
+    this->LastError = "Trajectory file is truncated";
+    this->Close();
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(FileHeader));
+  std::memcpy(&footer, data + size - sizeof(FileFooter), sizeof(FileFooter));
+  if (std::memcmp(header.Magic, FileMagic, sizeof(FileMagic)) != 0 || header.Version != Version)
+  {
+    this->LastError = "Trajectory file has an unsupported format";
+    this->Close();
+    return false;
+  }
+
+  // footer: it is written last, a file without it is incomplete
+  const boost::uint64_t tableEnd = size - sizeof(FileFooter);
+  if (std::memcmp(footer.Magic, FooterMagic, sizeof(FooterMagic)) != 0 ||
+    footer.ChunkTableOffset > tableEnd ||
+    footer.NumberOfChunks != (tableEnd - footer.ChunkTableOffset) / sizeof(Chunk))
+  {
+    this->LastError = "Trajectory file is truncated";
+    this->Close();
+    return false;
+  }
+
+  this->Chunks.resize(static_cast<size_t>(footer.NumberOfChunks));
+  if (!this->Chunks.empty())
+  {
+    std::memcpy(&this->Chunks[0], data + footer.ChunkTableOffset,
+      this->Chunks.size() * sizeof(Chunk));
+  }
+  for (const Chunk& chunk : this->Chunks)
+  {
+    if (chunk.Offset > footer.ChunkTableOffset || chunk.NumberOfTransforms >
+        (footer.ChunkTableOffset - chunk.Offset) / (ValuesPerTransform * sizeof(double)))
+    {
+      this->LastError = "Trajectory file is corrupted";
+      this->Close();
+      return false;
+    }
+    this->NumberOfTransforms += chunk.NumberOfTransforms;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TemporalTransformsFile::Close()
+{
+  if (this->File.is_open())
+  {
+    this->File.close();
+  }
+  this->Chunks.clear();
+  this->NumberOfTransforms = 0;
+}
+
+//-----------------------------------------------------------------------------
+bool TemporalTransformsFile::GetTimeRange(double range[2]) const
+{
+  if (this->Chunks.empty())
+  {
+    return false;
+  }
+  range[0] = this->Chunks.front().StartTime;
+  range[1] = this->Chunks.back().EndTime;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkTemporalTransforms> TemporalTransformsFile::Read(double tstart, double tend)
+{
+  if (!this->IsOpen())
+  {
+    this->LastError = "The trajectory file is not open";
+    return nullptr;
+  }
+
+  // the chunks are sorted by time, the first one ending after tstart is searched, then
+  // in each chunk the times of the window
+  auto firstChunk = std::lower_bound(this->Chunks.begin(), this->Chunks.end(), tstart,
+    [](const Chunk& chunk, double time) { return chunk.EndTime < time; });
+  std::vector<std::pair<const double*, std::pair<size_t, size_t> > > ranges;
+  size_t numberOfTransforms = 0;
+  for (auto chunk = firstChunk; chunk != this->Chunks.end() && chunk->StartTime <= tend; ++chunk)
+  {
+    const double* times = reinterpret_cast<const double*>(this->File.data() + chunk->Offset);
+    const double* end = times + chunk->NumberOfTransforms;
+    const size_t first = std::lower_bound(times, end, tstart) - times;
+    const size_t last = std::upper_bound(times + first, end, tend) - times;
+    ranges.push_back(std::make_pair(times, std::make_pair(first, last)));
+    numberOfTransforms += last - first;
+  }
+
+  auto time = vtkSmartPointer<vtkDoubleArray>::New();
+  time->SetNumberOfTuples(numberOfTransforms);
+  auto translation = vtkSmartPointer<vtkDoubleArray>::New();
+  translation->SetNumberOfComponents(3);
+  translation->SetNumberOfTuples(numberOfTransforms);
+  auto orientation = vtkSmartPointer<vtkDoubleArray>::New();
+  orientation->SetNumberOfComponents(4);
+  orientation->SetNumberOfTuples(numberOfTransforms);
+
+  // only the pages of the window are read from the file
+  vtkIdType index = 0;
+  for (size_t i = 0; i < ranges.size(); ++i)
+  {
+    const Chunk& chunk = *(firstChunk + i);
+    const double* times = ranges[i].first;
+    const double* translations = times + chunk.NumberOfTransforms;
+    const double* orientations = translations + 3 * chunk.NumberOfTransforms;
+    const size_t first = ranges[i].second.first;
+    const size_t count = ranges[i].second.second - first;
+    std::copy(times + first, times + first + count, time->GetPointer(index));
+    std::copy(translations + 3 * first, translations + 3 * (first + count),
+      translation->GetPointer(3 * index));
+    std::copy(orientations + 4 * first, orientations + 4 * (first + count),
+      orientation->GetPointer(4 * index));
+    index += static_cast<vtkIdType>(count);
+  }
+
+  auto transforms = vtkSmartPointer<vtkTemporalTransforms>::New();
+  transforms->SetTranslationArray(translation);
+  transforms->SetTimeArray(time);
+  transforms->SetOrientationArray(orientation);
+  return transforms;
+}
+
+//-----------------------------------------------------------------------------
+TemporalTransformsFileWriter::~TemporalTransformsFileWriter()
+{
+  if (this->Stream.is_open())
+  {
+    this->Abort();
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool TemporalTransformsFileWriter::Open(const std::string& fileName, unsigned int chunkSize)
+{
+  if (this->Stream.is_open())
+  {
+    this->Abort();
+  }
+  this->Chunks.clear();
+  this->Times.clear();
+  this->Translations.clear();
+  this->Orientations.clear();
+  this->ChunkSize = std::max(1u, chunkSize);
+
+  this->FileName = fileName;
+  this->TemporaryFileName = this->FileName + ".tmp";
+  this->Stream.open(
+    this->TemporaryFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!this->Stream.is_open())
+  {
+    this->LastError = "Cannot open " + this->TemporaryFileName + " for writing";
+    return false;
+  }
+
+  FileHeader header;
+  std::memcpy(header.Magic, FileMagic, sizeof(FileMagic));
+  header.Version = TemporalTransformsFile::Version;
+  header.Reserved = 0;
+  WriteValue(this->Stream, header);
+  return this->Stream.good();
+}
+
+//-----------------------------------------------------------------------------
+bool TemporalTransformsFileWriter::Write(
+  double time, const double orientation[4], const double translation[3])
+{
+  if (!this->Stream.is_open())
+  {
+    this->LastError = "The trajectory file is not open";
+    return false;
+  }
+  const bool isSorted = this->Times.empty() ? this->Chunks.empty() || this->Chunks.back().EndTime <= time
+                                            : this->Times.back() <= time;
+  if (!isSorted)
+  {
+    this->LastError = "The transforms are not sorted by time";
+    this->Abort();
+    return false;
+  }
+
+  this->Times.push_back(time);
+  this->Translations.insert(this->Translations.end(), translation, translation + 3);
+  this->Orientations.insert(this->Orientations.end(), orientation, orientation + 4);
+  return this->Times.size() < this->ChunkSize || this->WriteChunk();
+}
+
+//-----------------------------------------------------------------------------
+bool TemporalTransformsFileWriter::Write(vtkTemporalTransforms* transforms)
+{
+  vtkDataArray* time = transforms ? transforms->GetTimeArray() : nullptr;
+  vtkDataArray* orientation = transforms ? transforms->GetOrientationArray() : nullptr;
+  if (!time || !orientation || !transforms->GetPoints())
+  {
+    this->LastError = "Invalid trajectory";
+    this->Abort();
+    return false;
+  }
+  vtkDataArray* translation = transforms->GetTranslationArray();
+  for (vtkIdType i = 0; i < transforms->GetNumberOfPoints(); ++i)
+  {
+    double axisAngle[4], position[3];
+    orientation->GetTuple(i, axisAngle);
+    translation->GetTuple(i, position);
+    if (!this->Write(time->GetTuple1(i), axisAngle, position))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool TemporalTransformsFileWriter::WriteChunk()
+{
+  TemporalTransformsFile::Chunk chunk;
+  chunk.StartTime = this->Times.front();
+  chunk.EndTime = this->Times.back();
+  chunk.Offset = static_cast<boost::uint64_t>(this->Stream.tellp());
+  chunk.NumberOfTransforms = this->Times.size();
+  this->Chunks.push_back(chunk);
+
+  WriteDoubles(this->Stream, this->Times);
+  WriteDoubles(this->Stream, this->Translations);
+  WriteDoubles(this->Stream, this->Orientations);
+  this->Times.clear();
+  this->Translations.clear();
+  this->Orientations.clear();
+  if (!this->Stream.good())
+  {
+    this->LastError = "Failed to write " + this->TemporaryFileName;
+    this->Abort();
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool TemporalTransformsFileWriter::Close()
+{
+  if (!this->Stream.is_open())
+  {
+    this->LastError = "The trajectory file is not open";
+    return false;
+  }
+  if (!this->Times.empty() && !this->WriteChunk())
+  {
+    return false;
+  }
+
+  FileFooter footer;
+  footer.NumberOfChunks = this->Chunks.size();
+  footer.ChunkTableOffset = static_cast<boost::uint64_t>(this->Stream.tellp());
+  std::memcpy(footer.Magic, FooterMagic, sizeof(FooterMagic));
+  if (!this->Chunks.empty())
+  {
+    this->Stream.write(reinterpret_cast<const char*>(&this->Chunks[0]),
+      this->Chunks.size() * sizeof(TemporalTransformsFile::Chunk));
+  }
+  WriteValue(this->Stream, footer);
+  this->Stream.close();
+  if (this->Stream.fail())
+  {
+    this->LastError = "Failed to write " + this->TemporaryFileName;
+    std::remove(this->TemporaryFileName.c_str());
+    return false;
+  }
+
+  boost::system::error_code ec;
+  boost::filesystem::rename(this->TemporaryFileName, this->FileName, ec);
+  if (ec)
+  {
+    this->LastError = "Cannot replace " + this->FileName + ": " + ec.message();
+    std::remove(this->TemporaryFileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void TemporalTransformsFileWriter::Abort()
+{
+  // do not leave a half written file behind
+  this->Stream.close();
+  std::remove(this->TemporaryFileName.c_str());
+  this->Chunks.clear();
+  this->Times.clear();
+  this->Translations.clear();
+  this->Orientations.clear();
+}
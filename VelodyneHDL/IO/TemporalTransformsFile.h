@@ -0,0 +1,163 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef TEMPORAL_TRANSFORMS_FILE_H
+#define TEMPORAL_TRANSFORMS_FILE_H
+
+// LOCAL
+#include "vtkTemporalTransforms.h"
+
+// VTK
+#include <vtkSmartPointer.h>
+
+// BOOST
+#include <boost/cstdint.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+// STD
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * \class TemporalTransformsFile
+ * \brief This class reads a pose trajectory saved in the binary format of
+ *        TemporalTransformsFileWriter (<file>.tposes), which is much faster to load than
+ *        the CSV format for long trajectories.
+ *        The transforms are stored by chunks of consecutive times, each chunk holding its
+ *        times, translations and axis-angle orientations contiguously as doubles. A table at
+ *        the end of the file gives the time range of each chunk, so that a time window is
+ *        found by a binary search and only the chunks overlapping it are read from the mapped
+ *        file.
+ */
+class TemporalTransformsFile
+{
+public:
+  /**
+   * @brief IsTemporalTransformsFile return true if a file starts like a binary trajectory
+   */
+  static bool IsTemporalTransformsFile(const std::string& fileName);
+
+  /**
+   * @brief Open map a binary trajectory file and read its chunk table
+   * @return true if a valid file has been opened
+   */
+  bool Open(const std::string& fileName);
+
+  //! Unmap the file
+  void Close();
+
+  bool IsOpen() const { return this->File.is_open(); }
+
+  boost::uint64_t GetNumberOfTransforms() const { return this->NumberOfTransforms; }
+
+  /**
+   * @brief GetTimeRange return the first and last times of the trajectory
+   * @return false if the trajectory is empty
+   */
+  bool GetTimeRange(double range[2]) const;
+
+  /**
+   * @brief Read return the transforms whose time is between tstart and tend, both included,
+   * like vtkTemporalTransforms::ExtractTimes
+   * @return nullptr if the file is not open or a chunk is corrupted
+   */
+  vtkSmartPointer<vtkTemporalTransforms> Read(double tstart, double tend);
+
+  const std::string& GetLastError() { return this->LastError; }
+
+private:
+  friend class TemporalTransformsFileWriter;
+
+  //! Increase it each time the layout of the file change
+  static const unsigned int Version = 1;
+
+  struct Chunk
+  {
+    double StartTime;
+    double EndTime;
+    boost::uint64_t Offset;
+    boost::uint64_t NumberOfTransforms;
+  };
+
+  boost::iostreams::mapped_file_source File;
+  std::vector<Chunk> Chunks;
+  boost::uint64_t NumberOfTransforms = 0;
+  std::string LastError;
+};
+
+/**
+ * \class TemporalTransformsFileWriter
+ * \brief Write a pose trajectory in the binary format read by TemporalTransformsFile. The
+ *        transforms are appended in increasing time and written by chunks, so that a
+ *        trajectory can be saved while it is computed. The file is written in a temporary
+ *        file which replaces the previous one once complete.
+ */
+class TemporalTransformsFileWriter
+{
+public:
+  ~TemporalTransformsFileWriter();
+
+  /**
+   * @brief Open start writing a trajectory
+   * @param fileName file to write
+   * @param chunkSize number of transforms of a chunk, smaller chunks make shorter time
+   * windows faster to read
+   * @return true on success
+   */
+  bool Open(const std::string& fileName, unsigned int chunkSize = 4096);
+
+  /**
+   * @brief Write append a transform, its time must not be lower than the previous one
+   * @param orientation axis (x, y, z) and angle in radian, as in vtkTemporalTransforms
+   * @return true on success
+   */
+  bool Write(double time, const double orientation[4], const double translation[3]);
+
+  /**
+   * @brief Write append all the transforms of a trajectory
+   * @return true on success
+   */
+  bool Write(vtkTemporalTransforms* transforms);
+
+  /**
+   * @brief Close complete the file and replace the previous one
+   * @return true on success, otherwise nothing is left behind
+   */
+  bool Close();
+
+  const std::string& GetLastError() { return this->LastError; }
+
+private:
+  //! Write the buffered transforms as a chunk
+  bool WriteChunk();
+
+  //! Remove the temporary file of an incomplete write
+  void Abort();
+
+  std::ofstream Stream;
+  std::string FileName;
+  std::string TemporaryFileName;
+  unsigned int ChunkSize = 4096;
+  std::vector<double> Times;
+  std::vector<double> Translations;
+  std::vector<double> Orientations;
+  std::vector<TemporalTransformsFile::Chunk> Chunks;
+  std::string LastError;
+};
+
+#endif // TEMPORAL_TRANSFORMS_FILE_H
@@ -0,0 +1,216 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "ZipArchiveWriter.h"
+
+// STD
+#include <ctime>
+#include <limits>
+
+// BOOST
+#include <boost/crc.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace
+{
+const boost::uint32_t LocalHeaderSignature = 0x04034b50;
+const boost::uint32_t CentralHeaderSignature = 0x02014b50;
+const boost::uint32_t EndSignature = 0x06054b50;
+const boost::uint32_t Zip64EndSignature = 0x06064b50;
+const boost::uint32_t Zip64LocatorSignature = 0x07064b50;
+
+//! versions needed to extract, 2.0 for the stored files and 4.5 for the Zip64 records
+const boost::uint16_t Version = 20;
+const boost::uint16_t Zip64Version = 45;
+//! the names are encoded in UTF-8
+const boost::uint16_t UTF8Flag = 0x0800;
+
+const boost::uint32_t Max32 = std::numeric_limits<boost::uint32_t>::max();
+const boost::uint16_t Max16 = std::numeric_limits<boost::uint16_t>::max();
+
+//! Size of the buffer of the archive, so that the headers are not written one by one
+const size_t FileBufferSize = 1 << 20;
+
+//-----------------------------------------------------------------------------
+//! Records of the zip format, made of little endian integers
+class Record
+{
+public:
+  Record& Add16(boost::uint16_t value)
+  {
+    this->Bytes.push_back(static_cast<char>(value & 0xFF));
+    this->Bytes.push_back(static_cast<char>(value >> 8));
+    return *this;
+  }
+  Record& Add32(boost::uint32_t value)
+  {
+    return this->Add16(static_cast<boost::uint16_t>(value & 0xFFFF))
+      .Add16(static_cast<boost::uint16_t>(value >> 16));
+  }
+  Record& Add64(boost::uint64_t value)
+  {
+    return this->Add32(static_cast<boost::uint32_t>(value & Max32))
+      .Add32(static_cast<boost::uint32_t>(value >> 32));
+  }
+  Record& Add(const std::string& bytes)
+  {
+    this->Bytes += bytes;
+    return *this;
+  }
+  bool Write(FILE* file) const
+  {
+    return std::fwrite(this->Bytes.data(), 1, this->Bytes.size(), file) == this->Bytes.size();
+  }
+  size_t Size() const { return this->Bytes.size(); }
+
+private:
+  std::string Bytes;
+};
+}
+
+//-----------------------------------------------------------------------------
+ZipArchiveWriter::~ZipArchiveWriter()
+{
+  this->Close();
+}
+
+//-----------------------------------------------------------------------------
+bool ZipArchiveWriter::Open(const std::string& fileName)
+{
+  this->Close();
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  this->Entries.clear();
+  this->Offset = 0;
+  this->HasFailed = false;
+
+  // all the files get the time of the creation of the archive
+  const std::time_t now = std::time(nullptr);
+  const std::tm* local = std::localtime(&now);
+  if (local)
+  {
+    this->Time = static_cast<boost::uint16_t>(
+      (local->tm_hour << 11) | (local->tm_min << 5) | (local->tm_sec / 2));
+    this->Date = static_cast<boost::uint16_t>(
+      ((local->tm_year - 80) << 9) | ((local->tm_mon + 1) << 5) | local->tm_mday);
+  }
+
+  this->File = std::fopen(fileName.c_str(), "wb");
+  if (!this->File)
+  {
+    return false;
+  }
+  std::setvbuf(this->File, nullptr, _IOFBF, FileBufferSize);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ZipArchiveWriter::AddFile(const std::string& name, const void* data, size_t size)
+{
+  if (static_cast<boost::uint64_t>(size) >= Max32 || name.size() >= Max16)
+  {
+    return false;
+  }
+  // the checksum is computed before taking the lock, by the thread giving the file
+  boost::crc_32_type crc;
+  crc.process_bytes(data, size);
+
+  Entry entry;
+  entry.Name = name;
+  entry.CRC = crc.checksum();
+  entry.Size = static_cast<boost::uint32_t>(size);
+
+  Record header;
+  header.Add32(LocalHeaderSignature).Add16(Version).Add16(UTF8Flag).Add16(0)
+    .Add16(this->Time).Add16(this->Date).Add32(entry.CRC).Add32(entry.Size).Add32(entry.Size)
+    .Add16(static_cast<boost::uint16_t>(name.size())).Add16(0).Add(name);
+
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (!this->File || this->HasFailed)
+  {
+    return false;
+  }
+  entry.Offset = this->Offset;
+  if (!header.Write(this->File) || (size > 0 && std::fwrite(data, size, 1, this->File) != 1))
+  {
+    this->HasFailed = true;
+    return false;
+  }
+  this->Offset += header.Size() + size;
+  this->Entries.push_back(entry);
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool ZipArchiveWriter::Close()
+{
+  boost::lock_guard<boost::mutex> lock(this->Mutex);
+  if (!this->File)
+  {
+    return false;
+  }
+
+  // the central directory lists the files, the offsets which do not fit on 32 bits being in
+  // a Zip64 extra field
+  const boost::uint64_t directoryOffset = this->Offset;
+  boost::uint64_t directorySize = 0;
+  bool isWritten = !this->HasFailed;
+  for (const Entry& entry : this->Entries)
+  {
+    if (!isWritten)
+    {
+      break;
+    }
+    const bool isZip64 = entry.Offset >= Max32;
+    Record header;
+    header.Add32(CentralHeaderSignature).Add16(Zip64Version)
+      .Add16(isZip64 ? Zip64Version : Version).Add16(UTF8Flag).Add16(0)
+      .Add16(this->Time).Add16(this->Date).Add32(entry.CRC).Add32(entry.Size).Add32(entry.Size)
+      .Add16(static_cast<boost::uint16_t>(entry.Name.size())).Add16(isZip64 ? 12 : 0)
+      .Add16(0).Add16(0).Add16(0).Add32(0)
+      .Add32(isZip64 ? Max32 : static_cast<boost::uint32_t>(entry.Offset)).Add(entry.Name);
+    if (isZip64)
+    {
+      header.Add16(1).Add16(8).Add64(entry.Offset);
+    }
+    isWritten = header.Write(this->File);
+    directorySize += header.Size();
+  }
+
+  const boost::uint64_t numberOfEntries = this->Entries.size();
+  const bool isZip64 =
+    numberOfEntries >= Max16 || directoryOffset >= Max32 || directorySize >= Max32;
+  Record end;
+  if (isZip64)
+  {
+    const boost::uint64_t zip64EndOffset = directoryOffset + directorySize;
+    end.Add32(Zip64EndSignature).Add64(44).Add16(Zip64Version).Add16(Zip64Version)
+      .Add32(0).Add32(0).Add64(numberOfEntries).Add64(numberOfEntries)
+      .Add64(directorySize).Add64(directoryOffset);
+    end.Add32(Zip64LocatorSignature).Add32(0).Add64(zip64EndOffset).Add32(1);
+  }
+  const boost::uint16_t numberOfEntries16 =
+    isZip64 ? Max16 : static_cast<boost::uint16_t>(numberOfEntries);
+  end.Add32(EndSignature).Add16(0).Add16(0).Add16(numberOfEntries16).Add16(numberOfEntries16)
+    .Add32(isZip64 ? Max32 : static_cast<boost::uint32_t>(directorySize))
+    .Add32(isZip64 ? Max32 : static_cast<boost::uint32_t>(directoryOffset)).Add16(0);
+  isWritten = isWritten && end.Write(this->File);
+
+  isWritten = std::fclose(this->File) == 0 && isWritten;
+  this->File = nullptr;
+  return isWritten;
+}
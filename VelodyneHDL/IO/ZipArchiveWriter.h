@@ -0,0 +1,92 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef ZIP_ARCHIVE_WRITER_H
+#define ZIP_ARCHIVE_WRITER_H
+
+// BOOST
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+
+// STD
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * \class ZipArchiveWriter
+ * \brief This class streams files into a zip archive as they are produced, without writing
+ *        them to a temporary directory first. The files are stored without compression,
+ *        which suits the files that are already compressed, like the VTP files with zlib
+ *        compressed appended data, and makes adding a file a single write.
+ *        AddFile may be called by several threads at the same time, the files are written
+ *        in the order of the calls. The Zip64 records are written when the archive is larger
+ *        than 4 GiB or has more than 65535 files, a single file must be smaller than 4 GiB.
+ */
+class ZipArchiveWriter
+{
+public:
+  ZipArchiveWriter() = default;
+  ~ZipArchiveWriter();
+
+  //! Create the archive, return false if the file cannot be created
+  bool Open(const std::string& fileName);
+
+  /**
+   * \brief AddFile write a file in the archive
+   * \param name path of the file in the archive, with / as separator
+   * \return false on a write error or if the file is too large
+   */
+  bool AddFile(const std::string& name, const void* data, size_t size);
+  bool AddFile(const std::string& name, const std::string& content)
+  {
+    return this->AddFile(name, content.data(), content.size());
+  }
+
+  //! Write the central directory and close the archive, return false on error
+  bool Close();
+
+  bool IsOpen() const { return this->File != nullptr; }
+
+  //! Number of files added to the archive
+  size_t GetNumberOfFiles() const { return this->Entries.size(); }
+
+private:
+  ZipArchiveWriter(const ZipArchiveWriter&) = delete;
+  ZipArchiveWriter& operator=(const ZipArchiveWriter&) = delete;
+
+  //! A file of the archive, as written in the central directory
+  struct Entry
+  {
+    std::string Name;
+    boost::uint32_t CRC;
+    boost::uint32_t Size;
+    boost::uint64_t Offset;
+  };
+
+  boost::mutex Mutex;
+  FILE* File = nullptr;
+  //! offset of the next local header
+  boost::uint64_t Offset = 0;
+  //! modification time and date of the files, in MS-DOS format
+  boost::uint16_t Time = 0;
+  boost::uint16_t Date = 0;
+  std::vector<Entry> Entries;
+  bool HasFailed = false;
+};
+
+#endif // ZIP_ARCHIVE_WRITER_H
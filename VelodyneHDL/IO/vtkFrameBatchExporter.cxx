@@ -0,0 +1,246 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkFrameBatchExporter.h"
+#include "vtkLidarPointCloudFile.h"
+#include "vtkLidarReader.h"
+#include "ZipArchiveWriter.h"
+
+// STD
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <utility>
+
+// VTK
+#include <vtkAlgorithm.h>
+#include <vtkPolyData.h>
+#include <vtkXMLPolyDataWriter.h>
+
+// BOOST
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace
+{
+//! Frames decoded and waiting for a writing thread, per writing thread at most
+const size_t MaximumQueuedFramesPerThread = 2;
+}
+
+//-----------------------------------------------------------------------------
+//! Frames given by the decoding to the writing threads
+struct vtkFrameBatchExporter::FrameQueue
+{
+  boost::mutex Mutex;
+  //! notified when a frame is queued, or when the export ends
+  boost::condition_variable FrameQueued;
+  //! notified when a frame has been written
+  boost::condition_variable FrameWritten;
+
+  std::deque<std::pair<int, vtkSmartPointer<vtkPolyData> > > Frames;
+  size_t MaximumFrames = 0;
+  int NumberOfWritingThreads = 1;
+  size_t NumberOfWrittenFrames = 0;
+  //! no frame will be queued anymore
+  bool IsDecodingDone = false;
+  //! the export is aborted, the queued frames are dropped
+  bool Stop = false;
+  bool HasFailed = false;
+};
+
+//-----------------------------------------------------------------------------
+vtkFrameBatchExporter::vtkFrameBatchExporter(int format, const std::string& fileNameTemplate)
+  : OutputFormat(format)
+  , FileNameTemplate(fileNameTemplate)
+{
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkFrameBatchExporter::GetFileName(int frame) const
+{
+  std::vector<char> fileName(this->FileNameTemplate.size() + 32);
+  std::snprintf(fileName.data(), fileName.size(), this->FileNameTemplate.c_str(), frame);
+  return fileName.data();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkFrameBatchExporter::ExportFrames(
+  vtkLidarReader* reader, int firstFrame, int lastFrame, const ProgressCallback& progress)
+{
+  this->FileNames.clear();
+  if (!reader)
+  {
+    return false;
+  }
+  const double numberOfFrames = std::max(lastFrame - firstFrame + 1, 1);
+
+  int numberOfThreads = this->NumberOfThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = boost::thread::hardware_concurrency();
+  }
+  numberOfThreads = std::max(1, std::min(numberOfThreads, lastFrame - firstFrame + 1));
+
+  FrameQueue queue;
+  queue.MaximumFrames = MaximumQueuedFramesPerThread * numberOfThreads;
+  queue.NumberOfWritingThreads = numberOfThreads;
+  boost::thread_group threads;
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    threads.create_thread(boost::bind(&vtkFrameBatchExporter::WriteFrames, this, &queue));
+  }
+
+  // the frames are decoded by the reader threads and given in order on this thread, which
+  // waits while the queue is full so that the decoding does not outpace the writing
+  bool isComplete = reader->GetFrames(firstFrame, lastFrame, [&](int frame, vtkPolyData* data) {
+    size_t numberOfWrittenFrames = 0;
+    {
+      boost::unique_lock<boost::mutex> lock(queue.Mutex);
+      while (queue.Frames.size() >= queue.MaximumFrames && !queue.HasFailed)
+      {
+        queue.FrameWritten.wait(lock);
+      }
+      if (queue.HasFailed)
+      {
+        return false;
+      }
+      queue.Frames.push_back(std::make_pair(frame, vtkSmartPointer<vtkPolyData>(data)));
+      queue.FrameQueued.notify_one();
+      numberOfWrittenFrames = queue.NumberOfWrittenFrames;
+    }
+    this->FileNames.push_back(this->GetFileName(frame));
+    return !progress || progress(numberOfWrittenFrames / numberOfFrames);
+  });
+
+  // the progress is reported until the last queued frame is written
+  {
+    boost::unique_lock<boost::mutex> lock(queue.Mutex);
+    queue.IsDecodingDone = true;
+    queue.Stop = !isComplete;
+    queue.FrameQueued.notify_all();
+    while (!queue.Stop && !queue.HasFailed && queue.NumberOfWrittenFrames < this->FileNames.size())
+    {
+      queue.FrameWritten.wait(lock);
+      const size_t numberOfWrittenFrames = queue.NumberOfWrittenFrames;
+      lock.unlock();
+      const bool isCanceled = progress && !progress(numberOfWrittenFrames / numberOfFrames);
+      lock.lock();
+      if (isCanceled)
+      {
+        queue.Stop = true;
+        queue.FrameQueued.notify_all();
+      }
+    }
+  }
+  threads.join_all();
+  return !queue.Stop && !queue.HasFailed;
+}
+
+//-----------------------------------------------------------------------------
+void vtkFrameBatchExporter::WriteFrames(FrameQueue* queue)
+{
+  // each thread has its own filters and writer
+  std::vector<vtkSmartPointer<vtkAlgorithm> > filters;
+  if (this->Factory)
+  {
+    filters = this->Factory();
+    for (size_t i = 1; i < filters.size(); ++i)
+    {
+      filters[i]->SetInputConnection(filters[i - 1]->GetOutputPort());
+    }
+  }
+  vtkSmartPointer<vtkXMLPolyDataWriter> writer;
+  vtkLidarCSVWriter csvWriter = this->CSVWriter;
+  if (queue->NumberOfWritingThreads > 1)
+  {
+    // the frames are already written in parallel
+    csvWriter.SetNumberOfThreads(1);
+  }
+  vtkLidarPointCloudFile cloudWriter;
+  cloudWriter.SetFormat(
+    this->OutputFormat == PLY ? vtkLidarPointCloudFile::PLY : vtkLidarPointCloudFile::PCD);
+  cloudWriter.SetColumns(this->CSVWriter.GetColumns());
+  if (this->OutputFormat == VTP)
+  {
+    writer = vtkSmartPointer<vtkXMLPolyDataWriter>::New();
+    writer->SetDataModeToAppended();
+    writer->EncodeAppendedDataOff();
+    writer->SetCompressorTypeToZLib();
+    writer->SetWriteToOutputString(this->Archive != nullptr);
+  }
+
+  boost::unique_lock<boost::mutex> lock(queue->Mutex);
+  while (!queue->Stop && !queue->HasFailed)
+  {
+    if (queue->Frames.empty())
+    {
+      if (queue->IsDecodingDone)
+      {
+        break;
+      }
+      queue->FrameQueued.wait(lock);
+      continue;
+    }
+    std::pair<int, vtkSmartPointer<vtkPolyData> > frame = queue->Frames.front();
+    queue->Frames.pop_front();
+    lock.unlock();
+
+    vtkPolyData* data = frame.second;
+    if (!filters.empty())
+    {
+      filters.front()->SetInputDataObject(frame.second);
+      filters.back()->Update();
+      data = vtkPolyData::SafeDownCast(filters.back()->GetOutputDataObject(0));
+    }
+    const std::string fileName = this->GetFileName(frame.first);
+    bool isWritten = false;
+    if (data && this->OutputFormat == VTP)
+    {
+      writer->SetInputData(data);
+      writer->SetFileName(fileName.c_str());
+      isWritten = writer->Write() == 1;
+      writer->SetInputData(nullptr);
+      if (this->Archive)
+      {
+        isWritten = isWritten && this->Archive->AddFile(fileName, writer->GetOutputStdString());
+      }
+    }
+    else if (this->Archive)
+    {
+      isWritten = false;
+    }
+    else if (data && (this->OutputFormat == PCD || this->OutputFormat == PLY))
+    {
+      isWritten = cloudWriter.Write(data, fileName);
+    }
+    else if (data)
+    {
+      isWritten = csvWriter.Write(data, fileName);
+    }
+    frame.second = nullptr;
+
+    lock.lock();
+    queue->NumberOfWrittenFrames++;
+    queue->HasFailed = queue->HasFailed || !isWritten;
+    queue->FrameWritten.notify_all();
+  }
+  // the other threads stop too when a file cannot be written
+  queue->FrameQueued.notify_all();
+}
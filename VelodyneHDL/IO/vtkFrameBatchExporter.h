@@ -0,0 +1,134 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_FRAME_BATCH_EXPORTER_H
+#define VTK_FRAME_BATCH_EXPORTER_H
+
+// STD
+#include <string>
+#include <vector>
+
+// LOCAL
+#include "vtkLidarCSVWriter.h"
+
+// VTK
+#include <vtkSmartPointer.h>
+#include <vtkSystemIncludes.h>
+
+// BOOST
+#include <boost/function.hpp>
+
+class vtkAlgorithm;
+class vtkLidarReader;
+class vtkPolyData;
+class ZipArchiveWriter;
+
+/**
+ * @brief vtkFrameBatchExporter export a range of frames of a reader to one file per frame,
+ * without going through the pipeline and the animation scene for each frame.
+ *
+ * The frames are decoded by the threads of vtkLidarReader::GetFrames and given to
+ * NumberOfThreads writing threads through a bounded queue, so that the memory stays bounded
+ * when the disk is slower than the decoding. Each writing thread has its own filter chain,
+ * created by the FilterFactory, and its own writer.
+ * - CSV writes the coordinates then the point data arrays of each point with the
+ *   vtkLidarCSVWriter given by GetCSVWriter, like the CSV export of the application
+ * - VTP writes a vtkXMLPolyDataWriter file with zlib compressed appended data
+ * - PCD and PLY write the binary files of vtkLidarPointCloudFile, whose columns are the ones
+ *   of the CSV writer
+ *
+ * The VTP files can be added to a zip archive instead, in memory by each writing thread, so
+ * that an archive of the frames is made without a temporary directory.
+ */
+class VTK_EXPORT vtkFrameBatchExporter
+{
+public:
+  enum Format
+  {
+    CSV = 0,
+    VTP = 1,
+    PCD = 2,
+    PLY = 3
+  };
+
+  /**
+   * @brief FilterFactory create the filters processing the frames before they are written,
+   * called once per writing thread. The filters are connected in order, the frames being the
+   * input of the first one and the output of the last one, a vtkPolyData, being written.
+   */
+  typedef boost::function<std::vector<vtkSmartPointer<vtkAlgorithm> >()> FilterFactory;
+
+  /**
+   * @brief ProgressCallback receive the progress of ExportFrames, between 0 and 1, on the
+   * calling thread
+   * @return false to abort the export
+   */
+  typedef boost::function<bool(double progress)> ProgressCallback;
+
+  /**
+   * @param format one of Format
+   * @param fileNameTemplate name of the files, with a printf integer conversion replaced by
+   * the frame number, for example "frame_%04d.vtp"
+   */
+  vtkFrameBatchExporter(int format, const std::string& fileNameTemplate);
+
+  /// Set the number of writing threads, 0 uses one thread per core
+  void SetNumberOfThreads(int numberOfThreads) { this->NumberOfThreads = numberOfThreads; }
+
+  /// Get the writer of the CSV files, to set its columns, delimiter and precision. The
+  /// columns are also the point data arrays of the PCD and PLY files
+  vtkLidarCSVWriter& GetCSVWriter() { return this->CSVWriter; }
+
+  /// Set the archive the VTP files are added to, the file names being their paths in the
+  /// archive, instead of writing them to the disk. The other formats cannot be archived
+  void SetArchive(ZipArchiveWriter* archive) { this->Archive = archive; }
+
+  /// Set the filter chain applied to the frames, none by default
+  void SetFilterFactory(const FilterFactory& factory) { this->Factory = factory; }
+
+  /**
+   * @brief ExportFrames write the frames of a reader, the files are complete when this returns
+   * @param reader reader of the frames
+   * @param firstFrame first frame to export
+   * @param lastFrame last frame to export, this frame is included
+   * @param progress called after each frame, may be empty
+   * @return false if the export has been aborted or a file could not be written
+   */
+  bool ExportFrames(vtkLidarReader* reader, int firstFrame, int lastFrame,
+    const ProgressCallback& progress = ProgressCallback());
+
+  /// Get the names of the files written by the last export, in the order of the frames
+  const std::vector<std::string>& GetFileNames() const { return this->FileNames; }
+
+  /// Get the name of the file of a frame
+  std::string GetFileName(int frame) const;
+
+private:
+  struct FrameQueue;
+
+  void WriteFrames(FrameQueue* queue);
+
+  int OutputFormat = CSV;
+  std::string FileNameTemplate;
+  int NumberOfThreads = 0;
+  vtkLidarCSVWriter CSVWriter;
+  FilterFactory Factory;
+  ZipArchiveWriter* Archive = nullptr;
+  std::vector<std::string> FileNames;
+};
+
+#endif // VTK_FRAME_BATCH_EXPORTER_H
@@ -0,0 +1,221 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkImageSequenceExporter.h"
+#include "NpyStackWriter.h"
+#include "vtkLidarReader.h"
+
+// STD
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <utility>
+
+// VTK
+#include <vtkAlgorithm.h>
+#include <vtkImageData.h>
+#include <vtkPolyData.h>
+
+// BOOST
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace
+{
+//! Frames decoded and waiting for the writing thread
+const size_t MaximumQueuedFrames = 4;
+}
+
+//-----------------------------------------------------------------------------
+//! Frames given by the decoding to the writing thread
+struct vtkImageSequenceExporter::FrameQueue
+{
+  boost::mutex Mutex;
+  //! notified when a frame is queued, or when the export ends
+  boost::condition_variable FrameQueued;
+  //! notified when an image has been written
+  boost::condition_variable FrameWritten;
+
+  std::deque<std::pair<int, vtkSmartPointer<vtkPolyData> > > Frames;
+  size_t NumberOfWrittenFrames = 0;
+  //! no frame will be queued anymore
+  bool IsDecodingDone = false;
+  //! the export is aborted, the queued frames are dropped
+  bool Stop = false;
+  bool HasFailed = false;
+};
+
+//-----------------------------------------------------------------------------
+vtkImageSequenceExporter::vtkImageSequenceExporter(const std::string& fileNameTemplate)
+  : FileNameTemplate(fileNameTemplate)
+{
+}
+
+//-----------------------------------------------------------------------------
+std::string vtkImageSequenceExporter::GetFileName(int frame) const
+{
+  std::vector<char> fileName(this->FileNameTemplate.size() + 32);
+  std::snprintf(fileName.data(), fileName.size(), this->FileNameTemplate.c_str(), frame);
+  return fileName.data();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkImageSequenceExporter::ExportFrames(
+  vtkLidarReader* reader, int firstFrame, int lastFrame, const ProgressCallback& progress)
+{
+  this->FileNames.clear();
+  if (!reader || !this->Factory)
+  {
+    return false;
+  }
+  const double numberOfFrames = std::max(lastFrame - firstFrame + 1, 1);
+
+  FrameQueue queue;
+  boost::thread writingThread(boost::bind(&vtkImageSequenceExporter::WriteImages, this, &queue));
+
+  // the frames are decoded by the reader threads and given in order on this thread, which
+  // waits while the queue is full so that the decoding does not outpace the writing
+  size_t numberOfQueuedFrames = 0;
+  bool isComplete = reader->GetFrames(firstFrame, lastFrame, [&](int frame, vtkPolyData* data) {
+    size_t numberOfWrittenFrames = 0;
+    {
+      boost::unique_lock<boost::mutex> lock(queue.Mutex);
+      while (queue.Frames.size() >= MaximumQueuedFrames && !queue.HasFailed)
+      {
+        queue.FrameWritten.wait(lock);
+      }
+      if (queue.HasFailed)
+      {
+        return false;
+      }
+      queue.Frames.push_back(std::make_pair(frame, vtkSmartPointer<vtkPolyData>(data)));
+      queue.FrameQueued.notify_one();
+      numberOfWrittenFrames = queue.NumberOfWrittenFrames;
+    }
+    numberOfQueuedFrames++;
+    return !progress || progress(numberOfWrittenFrames / numberOfFrames);
+  });
+
+  // the progress is reported until the last queued frame is written
+  {
+    boost::unique_lock<boost::mutex> lock(queue.Mutex);
+    queue.IsDecodingDone = true;
+    queue.Stop = !isComplete;
+    queue.FrameQueued.notify_all();
+    while (!queue.Stop && !queue.HasFailed && queue.NumberOfWrittenFrames < numberOfQueuedFrames)
+    {
+      queue.FrameWritten.wait(lock);
+      const size_t numberOfWrittenFrames = queue.NumberOfWrittenFrames;
+      lock.unlock();
+      const bool isCanceled = progress && !progress(numberOfWrittenFrames / numberOfFrames);
+      lock.lock();
+      if (isCanceled)
+      {
+        queue.Stop = true;
+        queue.FrameQueued.notify_all();
+      }
+    }
+  }
+  writingThread.join();
+  return !queue.Stop && !queue.HasFailed;
+}
+
+//-----------------------------------------------------------------------------
+void vtkImageSequenceExporter::WriteImages(FrameQueue* queue)
+{
+  std::vector<vtkSmartPointer<vtkAlgorithm> > filters = this->Factory();
+  for (size_t i = 1; i < filters.size(); ++i)
+  {
+    filters[i]->SetInputConnection(filters[i - 1]->GetOutputPort());
+  }
+  NpyStackWriter writer;
+  const size_t framesPerChunk = static_cast<size_t>(std::max(this->FramesPerChunk, 1));
+
+  boost::unique_lock<boost::mutex> lock(queue->Mutex);
+  while (!queue->Stop && !queue->HasFailed)
+  {
+    if (queue->Frames.empty())
+    {
+      if (queue->IsDecodingDone)
+      {
+        break;
+      }
+      queue->FrameQueued.wait(lock);
+      continue;
+    }
+    std::pair<int, vtkSmartPointer<vtkPolyData> > frame = queue->Frames.front();
+    queue->Frames.pop_front();
+    lock.unlock();
+
+    vtkImageData* image = nullptr;
+    if (!filters.empty())
+    {
+      filters.front()->SetInputDataObject(frame.second);
+      filters.back()->Update();
+      image = vtkImageData::SafeDownCast(filters.back()->GetOutputDataObject(0));
+    }
+    bool isWritten = false;
+    const std::string descr = image ? NpyStackWriter::GetDescr(image->GetScalarType()) : "";
+    if (!descr.empty())
+    {
+      // the values of the image are in the order of the array, x varying the fastest
+      int dimensions[3];
+      image->GetDimensions(dimensions);
+      std::vector<size_t> shape;
+      if (dimensions[2] > 1)
+      {
+        shape.push_back(dimensions[2]);
+      }
+      shape.push_back(dimensions[1]);
+      shape.push_back(dimensions[0]);
+      const int numberOfComponents = image->GetNumberOfScalarComponents();
+      if (numberOfComponents > 1)
+      {
+        shape.push_back(numberOfComponents);
+      }
+
+      if (!writer.IsOpen() || writer.GetNumberOfFrames() >= framesPerChunk ||
+        writer.GetDescr() != descr || writer.GetFrameShape() != shape)
+      {
+        const bool isClosed = !writer.IsOpen() || writer.Close();
+        const std::string fileName = this->GetFileName(frame.first);
+        isWritten = isClosed && writer.Open(fileName, descr, image->GetScalarSize(), shape);
+        this->FileNames.push_back(fileName);
+      }
+      else
+      {
+        isWritten = true;
+      }
+      isWritten = isWritten && writer.Append(image->GetScalarPointer());
+    }
+    frame.second = nullptr;
+
+    lock.lock();
+    queue->NumberOfWrittenFrames++;
+    queue->HasFailed = queue->HasFailed || !isWritten;
+    queue->FrameWritten.notify_all();
+  }
+  lock.unlock();
+  if (writer.IsOpen() && !writer.Close())
+  {
+    lock.lock();
+    queue->HasFailed = true;
+  }
+}
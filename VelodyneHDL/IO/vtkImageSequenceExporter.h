@@ -0,0 +1,107 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_IMAGE_SEQUENCE_EXPORTER_H
+#define VTK_IMAGE_SEQUENCE_EXPORTER_H
+
+// STD
+#include <string>
+#include <vector>
+
+// VTK
+#include <vtkSmartPointer.h>
+#include <vtkSystemIncludes.h>
+
+// BOOST
+#include <boost/function.hpp>
+
+class vtkAlgorithm;
+class vtkLidarReader;
+
+/**
+ * @brief vtkImageSequenceExporter export the images made from a range of frames of a reader,
+ * for example by vtkLidarRawSignalImage, as chunks of FramesPerChunk images stacked in NumPy
+ * .npy files (see NpyStackWriter), instead of one image file per frame.
+ *
+ * The frames are decoded ahead by the threads of vtkLidarReader::GetFrames, and given through
+ * a bounded queue to a background thread which makes the images with the filters of the
+ * FilterFactory and appends them to the current chunk, so that the images are produced at the
+ * decoding speed. The values keep the scalar type of the images, the array of a chunk having
+ * the shape (frames, height, width) or (frames, height, width, components). A new chunk is
+ * started when the dimensions or the type of the images change.
+ */
+class VTK_EXPORT vtkImageSequenceExporter
+{
+public:
+  /**
+   * @brief FilterFactory create the filters making the images from the frames, called once.
+   * The filters are connected in order, the frames being the input of the first one and the
+   * output of the last one, a vtkImageData, being written.
+   */
+  typedef boost::function<std::vector<vtkSmartPointer<vtkAlgorithm> >()> FilterFactory;
+
+  /**
+   * @brief ProgressCallback receive the progress of ExportFrames, between 0 and 1, on the
+   * calling thread
+   * @return false to abort the export
+   */
+  typedef boost::function<bool(double progress)> ProgressCallback;
+
+  /**
+   * @param fileNameTemplate name of the chunks, with a printf integer conversion replaced by
+   * the number of their first frame, for example "images_%04d.npy"
+   */
+  explicit vtkImageSequenceExporter(const std::string& fileNameTemplate);
+
+  /// Set the maximum number of images of a chunk, 100 by default
+  void SetFramesPerChunk(int framesPerChunk) { this->FramesPerChunk = framesPerChunk; }
+  int GetFramesPerChunk() const { return this->FramesPerChunk; }
+
+  /// Set the filters making the images, which must be set before the export
+  void SetFilterFactory(const FilterFactory& factory) { this->Factory = factory; }
+
+  /**
+   * @brief ExportFrames write the images of the frames of a reader, the files are complete
+   * when this returns
+   * @param reader reader of the frames
+   * @param firstFrame first frame to export
+   * @param lastFrame last frame to export, this frame is included
+   * @param progress called after each frame, may be empty
+   * @return false if the export has been aborted, a frame gave no image or a file could not
+   * be written
+   */
+  bool ExportFrames(vtkLidarReader* reader, int firstFrame, int lastFrame,
+    const ProgressCallback& progress = ProgressCallback());
+
+  /// Get the names of the chunks written by the last export, in the order of the frames
+  const std::vector<std::string>& GetFileNames() const { return this->FileNames; }
+
+  /// Get the name of the chunk starting at a frame
+  std::string GetFileName(int frame) const;
+
+private:
+  struct FrameQueue;
+
+  void WriteImages(FrameQueue* queue);
+
+  std::string FileNameTemplate;
+  int FramesPerChunk = 100;
+  FilterFactory Factory;
+  std::vector<std::string> FileNames;
+};
+
+#endif // VTK_IMAGE_SEQUENCE_EXPORTER_H
@@ -13,16 +13,37 @@
 // limitations under the License.
 
 #include "vtkLASFileWriter.h"
+#include "EptWriter.h"
+#include "FrameGeoreferencer.h"
+#include "vtkLidarReader.h"
 
 #include <vtkPointData.h>
 #include <vtkPolyData.h>
 
 #include <vtk_libproj4.h>
 
+#ifdef PJ_VERSION // 4.8 or later
+#include "GeoProjection.h"
+#endif
+
 #include <liblas/liblas.hpp>
 
 #include <Eigen/Dense>
 
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <vector>
+
 #ifndef PJ_VERSION // 4.8 or later
 #include <cassert>
 #endif
@@ -33,38 +54,21 @@ namespace
 #ifdef PJ_VERSION // 4.8 or later
 
 //-----------------------------------------------------------------------------
-projPJ CreateProj(int epsg)
+std::string EPSGDefinition(int epsg)
 {
   std::ostringstream ss;
-  ss << "+init=epsg:" << epsg << " ";
-  return pj_init_plus(ss.str().c_str());
+  ss << "+init=epsg:" << epsg;
+  return ss.str();
 }
 
 //-----------------------------------------------------------------------------
-Eigen::Vector3d ConvertGcs(Eigen::Vector3d p, projPJ inProj, projPJ outProj)
+// Convert a single position, the frames are converted by batches with GeoProjection::Transform
+Eigen::Vector3d ConvertGcs(Eigen::Vector3d p, GeoProjection& projection)
 {
-  if (pj_is_latlong(inProj))
+  if (!projection.Transform(p.data(), 1))
   {
-    p[0] *= DEG_TO_RAD;
-    p[1] *= DEG_TO_RAD;
+    vtkGenericWarningMacro("Error : CRS conversion failed");
   }
-
-  double* const data = p.data();
-  //std::cout << "position in : [" << p[0] << ";" << p[1] << ";" << p[2] << "]" << std::endl;
-  int last_errno = pj_transform(inProj, outProj, 1, 1, data + 0, data + 1, data + 2);
-  //std::cout << "position out : [" << p[0] << ";" << p[1] << ";" << p[2] << "]" << std::endl << std::endl;
-
-  if (last_errno != 0)
-  {
-    vtkGenericWarningMacro("Error : CRS conversion failed with error: " << last_errno);
-  }
-
-  if (pj_is_latlong(outProj))
-  {
-    p[0] *= RAD_TO_DEG;
-    p[1] *= RAD_TO_DEG;
-  }
-
   return p;
 }
 
@@ -111,8 +115,64 @@ Eigen::Vector3d InvertProj(Eigen::Vector3d in, PROJ* proj)
   return Eigen::Vector3d(lp.lam * RAD_TO_DEG, lp.phi * RAD_TO_DEG, in[2]);
 }
 
+//-----------------------------------------------------------------------------
+// Same as InvertProj for numberOfPoints interleaved x, y, z positions, PROJ 4.7 can only
+// convert one point at a time
+void InvertProj(double* positions, size_t numberOfPoints, PROJ* proj)
+{
+  for (size_t i = 0; i < numberOfPoints; ++i)
+  {
+    Eigen::Map<Eigen::Vector3d> position(positions + 3 * i);
+    position = InvertProj(Eigen::Vector3d(position), proj);
+  }
+}
+
 #endif
+
+//! Number of converted frames waiting to be written above which the conversion waits
+const size_t MaximumNumberOfQueuedBatches = 4;
+
+//! Number of returns counted in the header
+const int NumberOfReturnCounts = 5;
+
+//! Offsets in the public header block of the fields patched once the points are written,
+//! they are at the same place in all the LAS versions
+const std::streamoff PointCountOffset = 107;
+const std::streamoff PointsByReturnOffset = 111;
+const std::streamoff MaxXOffset = 179;
+
+//-----------------------------------------------------------------------------
+//! Write an integer in little endian, the byte order of the LAS files
+template<typename T>
+void WriteLittleEndian(std::ostream& stream, T value)
+{
+  char bytes[sizeof(T)];
+  for (size_t i = 0; i < sizeof(T); ++i)
+  {
+    bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+  stream.write(bytes, sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+void WriteLittleEndian(std::ostream& stream, double value)
+{
+  boost::uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(double));
+  WriteLittleEndian(stream, bits);
 }
+}
+
+//-----------------------------------------------------------------------------
+//! Points of a frame selected by the time range, in the output coordinate system
+struct vtkLASFileWriter::PointBatch
+{
+  //! x, y, z of each point
+  std::vector<double> Positions;
+  std::vector<unsigned short> Intensities;
+  std::vector<unsigned char> LaserIds;
+  std::vector<double> Times;
+};
 
 //-----------------------------------------------------------------------------
 class vtkLASFileWriter::vtkInternal
@@ -125,35 +185,263 @@ public:
 
   void Close();
 
+  /**
+   * @brief ConvertFrame select the points of a frame in the time range and convert them to the
+   * output coordinate system, with one projection call for the whole frame
+   */
+  void ConvertFrame(vtkPolyData* data, PointBatch& batch);
+
+  //! Wait until the writing thread has room for a batch, and give it
+  void Enqueue(const std::shared_ptr<PointBatch>& batch);
+
+  //! Write the queued batches with liblas until Close
+  void WritingLoop();
+
+  /**
+   * @brief PatchHeader write the number of points and the bounds of the points written in the
+   * header, once the writer has been deleted
+   */
+  void PatchHeader();
+
+  std::string FileName;
   std::ofstream Stream;
-  liblas::Writer* Writer;
+  liblas::Writer* Writer = nullptr;
+
+  //! Entwine Point Tile dataset written instead of the LAS file, see SetTiled
+  bool IsTiled = false;
+  std::unique_ptr<EptWriter> Tiles;
+
+  boost::thread WritingThread;
+  boost::mutex QueueMutex;
+  boost::condition_variable QueueCondition;
+  std::deque<std::shared_ptr<PointBatch> > Queue;
+  bool IsClosing = false;
 
   double MinTime;
   double MaxTime;
-  Eigen::Vector3d Origin;
+  //! Moves the points with the trajectory at their time, and by the origin
+  FrameGeoreferencer Georeferencer;
 
   size_t npoints;
   double MinPt[3];
   double MaxPt[3];
 
+  //! Number of points, number of points per return and bounds of the points written by the
+  //! writing thread, the header is patched with them on close
+  boost::uint64_t WrittenPoints = 0;
+  boost::uint64_t WrittenPointsByReturn[NumberOfReturnCounts] = { 0, 0, 0, 0, 0 };
+  double WrittenMin[3] = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+    std::numeric_limits<double>::max() };
+  double WrittenMax[3] = { -std::numeric_limits<double>::max(),
+    -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() };
+
   liblas::Header header;
   bool IsWriterInstanciated;
 
 #ifdef PJ_VERSION // 4.8 or later
-  projPJ InProj;
-  projPJ OutProj;
+  std::unique_ptr<GeoProjection> Projection;
 #else
   PROJ* Proj;
 #endif
   int OutGcs;
+  //! EPSG code of the coordinate system of the points, given by SetOrigin
+  int Gcs = 0;
 };
 
 //-----------------------------------------------------------------------------
 void vtkLASFileWriter::vtkInternal::Close()
 {
-  delete this->Writer;
-  this->Writer = 0;
+  // the queued batches are written before the thread exits
+  {
+    boost::lock_guard<boost::mutex> lock(this->QueueMutex);
+    this->IsClosing = true;
+  }
+  this->QueueCondition.notify_all();
+  if (this->WritingThread.joinable())
+  {
+    this->WritingThread.join();
+  }
+
+  if (this->Writer)
+  {
+    delete this->Writer;
+    this->Writer = 0;
+    this->PatchHeader();
+  }
   this->Stream.close();
+
+  if (this->Tiles)
+  {
+    if (!this->Tiles->Close())
+    {
+      vtkGenericWarningMacro("Failed to write the tiles: " << this->Tiles->GetLastError());
+    }
+    this->Tiles.reset();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLASFileWriter::vtkInternal::PatchHeader()
+{
+  // the fields are 32 bits in the LAS 1.0 to 1.3 headers
+  this->Stream.seekp(PointCountOffset);
+  WriteLittleEndian(this->Stream, static_cast<boost::uint32_t>(this->WrittenPoints));
+  this->Stream.seekp(PointsByReturnOffset);
+  for (int i = 0; i < NumberOfReturnCounts; ++i)
+  {
+    WriteLittleEndian(this->Stream, static_cast<boost::uint32_t>(this->WrittenPointsByReturn[i]));
+  }
+
+  // max x, min x, max y, min y, max z, min z
+  if (this->WrittenPoints > 0)
+  {
+    this->Stream.seekp(MaxXOffset);
+    for (int i = 0; i < 3; ++i)
+    {
+      WriteLittleEndian(this->Stream, this->WrittenMax[i]);
+      WriteLittleEndian(this->Stream, this->WrittenMin[i]);
+    }
+  }
+  this->Stream.seekp(0, std::ios::end);
+  if (!this->Stream)
+  {
+    vtkGenericWarningMacro("Failed to update the header of the LAS file");
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLASFileWriter::vtkInternal::ConvertFrame(vtkPolyData* data, PointBatch& batch)
+{
+  vtkPoints* const points = data->GetPoints();
+  vtkDataArray* const intensityData = data->GetPointData()->GetArray("intensity");
+  vtkDataArray* const laserIdData = data->GetPointData()->GetArray("laser_id");
+  vtkDataArray* const timestampData = data->GetPointData()->GetArray("timestamp");
+
+  const vtkIdType numPoints = points ? points->GetNumberOfPoints() : 0;
+  batch.Positions.reserve(3 * numPoints);
+  batch.Intensities.reserve(numPoints);
+  batch.LaserIds.reserve(numPoints);
+  batch.Times.reserve(numPoints);
+  for (vtkIdType n = 0; n < numPoints; ++n)
+  {
+    const double time = timestampData->GetComponent(n, 0) * 1e-6;
+    if (time >= this->MinTime && time <= this->MaxTime)
+    {
+      double pos[3];
+      points->GetPoint(n, pos);
+      batch.Positions.insert(batch.Positions.end(), pos, pos + 3);
+      batch.Intensities.push_back(static_cast<unsigned short>(intensityData->GetComponent(n, 0)));
+      batch.LaserIds.push_back(static_cast<unsigned char>(laserIdData->GetComponent(n, 0)));
+      batch.Times.push_back(time);
+    }
+  }
+
+  double* const positions = batch.Positions.empty() ? nullptr : &batch.Positions[0];
+  const double* const times = batch.Times.empty() ? nullptr : &batch.Times[0];
+  this->Georeferencer.Georeference(positions, times, batch.Times.size(), positions);
+#ifdef PJ_VERSION // 4.8 or later
+  if (this->Projection && !this->Projection->Transform(positions, batch.Times.size()))
+  {
+    vtkGenericWarningMacro("Error : CRS conversion failed for some points");
+  }
+#else
+  if (this->Proj)
+  {
+    InvertProj(positions, batch.Times.size(), this->Proj);
+  }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+void vtkLASFileWriter::vtkInternal::Enqueue(const std::shared_ptr<PointBatch>& batch)
+{
+  boost::unique_lock<boost::mutex> lock(this->QueueMutex);
+  while (this->Queue.size() >= MaximumNumberOfQueuedBatches)
+  {
+    this->QueueCondition.wait(lock);
+  }
+  this->Queue.push_back(batch);
+  this->QueueCondition.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+void vtkLASFileWriter::vtkInternal::WritingLoop()
+{
+  const boost::uint16_t returnNumber = 1;
+  std::unique_ptr<liblas::Point> lasPoint;
+  if (this->Writer)
+  {
+    lasPoint.reset(new liblas::Point(&this->Writer->GetHeader()));
+    lasPoint->SetReturnNumber(returnNumber);
+    lasPoint->SetNumberOfReturns(1);
+  }
+  std::vector<EptWriter::Point> tilePoints;
+  bool hasFailed = false;
+  while (true)
+  {
+    std::shared_ptr<PointBatch> batch;
+    {
+      boost::unique_lock<boost::mutex> lock(this->QueueMutex);
+      while (this->Queue.empty() && !this->IsClosing)
+      {
+        this->QueueCondition.wait(lock);
+      }
+      if (this->Queue.empty())
+      {
+        return;
+      }
+      batch = this->Queue.front();
+      this->Queue.pop_front();
+    }
+    this->QueueCondition.notify_all();
+
+    // after a failure the batches are still dequeued so that the conversion is not blocked
+    if (this->Tiles && !hasFailed)
+    {
+      tilePoints.resize(batch->Times.size());
+      for (size_t n = 0; n < batch->Times.size(); ++n)
+      {
+        EptWriter::Point& point = tilePoints[n];
+        std::copy(&batch->Positions[3 * n], &batch->Positions[3 * n] + 3, point.Position);
+        point.Time = batch->Times[n];
+        point.Intensity = batch->Intensities[n];
+        point.UserData = batch->LaserIds[n];
+      }
+      if (!tilePoints.empty() && !this->Tiles->Add(&tilePoints[0], tilePoints.size()))
+      {
+        vtkGenericWarningMacro("Failed to write the tiles: " << this->Tiles->GetLastError());
+        hasFailed = true;
+      }
+      continue;
+    }
+    try
+    {
+      for (size_t n = 0; lasPoint && n < batch->Times.size() && !hasFailed; ++n)
+      {
+        liblas::Point& p = *lasPoint;
+        p.SetCoordinates(
+          batch->Positions[3 * n + 0], batch->Positions[3 * n + 1], batch->Positions[3 * n + 2]);
+        p.SetIntensity(batch->Intensities[n]);
+        p.SetUserData(batch->LaserIds[n]);
+        p.SetTime(batch->Times[n]);
+        this->Writer->WritePoint(p);
+
+        // the header is patched with the points actually written
+        this->WrittenPoints++;
+        this->WrittenPointsByReturn[returnNumber - 1]++;
+        for (int i = 0; i < 3; ++i)
+        {
+          this->WrittenMin[i] = std::min(this->WrittenMin[i], batch->Positions[3 * n + i]);
+          this->WrittenMax[i] = std::max(this->WrittenMax[i], batch->Positions[3 * n + i]);
+        }
+      }
+    }
+    catch (const std::exception& e)
+    {
+      vtkGenericWarningMacro("Failed to write the LAS points: " << e.what());
+      hasFailed = true;
+    }
+  }
 }
 
 //-----------------------------------------------------------------------------
@@ -163,10 +451,7 @@ vtkLASFileWriter::vtkLASFileWriter(const char* filename)
   this->Internal->MinTime = -std::numeric_limits<double>::infinity();
   this->Internal->MaxTime = +std::numeric_limits<double>::infinity();
 
-#ifdef PJ_VERSION // 4.8 or later
-  this->Internal->InProj = 0;
-  this->Internal->OutProj = 0;
-#else
+#ifndef PJ_VERSION // 4.8 or later
   this->Internal->Proj = 0;
 #endif
   this->Internal->OutGcs = -1;
@@ -179,7 +464,7 @@ vtkLASFileWriter::vtkLASFileWriter(const char* filename)
     this->Internal->MinPt[i] = std::numeric_limits<double>::max();
   }
 
-  this->Internal->Stream.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+  this->Internal->FileName = filename;
 
   this->Internal->header.SetSoftwareId(SOFTWARE_NAME);
   this->Internal->header.SetDataFormatId(liblas::ePointFormat1);
@@ -191,10 +476,7 @@ vtkLASFileWriter::~vtkLASFileWriter()
 {
   this->Internal->Close();
 
-#ifdef PJ_VERSION // 4.8 or later
-  pj_free(this->Internal->InProj);
-  pj_free(this->Internal->OutProj);
-#else
+#ifndef PJ_VERSION // 4.8 or later
   proj_free(this->Internal->Proj);
 #endif
 
@@ -217,14 +499,15 @@ void vtkLASFileWriter::SetOrigin(int gcs, double easting, double northing, doubl
     return;
   }
 
-  Eigen::Vector3d origin(northing, easting, height);
-  this->Internal->Origin = origin;
+  // the trajectories of the position readers have x along the easting
+  Eigen::Vector3d origin(easting, northing, height);
+  this->Internal->Georeferencer.SetOrigin(origin[0], origin[1], origin[2]);
 
   // Convert offset to output GCS, if a geoconversion is set up
 #ifdef PJ_VERSION // 4.8 or later
-  if (this->Internal->OutProj)
+  if (this->Internal->Projection)
   {
-    origin = ConvertGcs(origin, this->Internal->InProj, this->Internal->OutProj);
+    origin = ConvertGcs(origin, *this->Internal->Projection);
     gcs = this->Internal->OutGcs;
   }
 #else
@@ -236,6 +519,7 @@ void vtkLASFileWriter::SetOrigin(int gcs, double easting, double northing, doubl
 #endif
 
   // Update header
+  this->Internal->Gcs = gcs;
   this->Internal->header.SetOffset(origin[0], origin[1], origin[2]);
   try
   {
@@ -260,11 +544,12 @@ void vtkLASFileWriter::SetOrigin(int gcs, double easting, double northing, doubl
 void vtkLASFileWriter::SetGeoConversion(int in, int out)
 {
 #ifdef PJ_VERSION // 4.8 or later
-  pj_free(this->Internal->InProj);
-  pj_free(this->Internal->OutProj);
-
-  this->Internal->InProj = CreateProj(in);
-  this->Internal->OutProj = CreateProj(out);
+  this->Internal->Projection.reset(new GeoProjection(EPSGDefinition(in), EPSGDefinition(out)));
+  if (!this->Internal->Projection->IsValid())
+  {
+    vtkGenericWarningMacro("Unknown EPSG code, the points will not be converted");
+    this->Internal->Projection.reset();
+  }
 #else
   // The PROJ 4.7 API makes it near impossible to do generic transforms, hence
   // InvertProj (see also comments there) is full of assumptions. Assert some
@@ -286,47 +571,24 @@ void vtkLASFileWriter::SetGeoConversion(int in, int out, int utmZone, bool isLat
   in = in;  // this was just added to avoid the warning: "parameter 'in' is not used"
 
   std::stringstream utmparamsIn;
-  utmparamsIn << "+proj=utm ";
-  std::stringstream zone;
-  zone << "+zone=" << utmZone;
-  std::string UTMString = zone.str();
-  utmparamsIn << UTMString << " ";
-  utmparamsIn << "+datum=WGS84 ";
-  utmparamsIn << "+units=m ";
-  utmparamsIn << "+no_defs ";
-  this->Internal->InProj = pj_init_plus(utmparamsIn.str().c_str());
-  std::cout << "init In : " << utmparamsIn.str() << std::endl;
+  utmparamsIn << "+proj=utm +zone=" << utmZone << " +datum=WGS84 +units=m +no_defs";
 
+  std::stringstream utmparamsOut;
   if (isLatLon)
   {
-    std::stringstream utmparamsOut;
-    utmparamsOut << "+proj=longlat ";
-    utmparamsOut << "+ellps=WGS84 ";
-    utmparamsOut << "+datum=WGS84 ";
-    utmparamsOut << "+no_defs ";
-    this->Internal->OutProj = pj_init_plus(utmparamsOut.str().c_str());
-    std::cout << "init Out : " << utmparamsOut.str() << std::endl;
+    utmparamsOut << "+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs";
   }
   else
   {
-    std::stringstream utmparamsOut;
-    utmparamsOut << "+proj=utm ";
-    std::stringstream zone;
-    zone << "+zone=" << utmZone;
-    std::string UTMString = zone.str();
-    utmparamsOut << UTMString << " ";
-    utmparamsOut << "+ellps=WGS84 ";
-    utmparamsOut << "+datum=WGS84 ";
-    utmparamsOut << "+no_defs ";
-    this->Internal->OutProj = pj_init_plus(utmparamsOut.str().c_str());
-  }
-
-  std::cout << "InProj :  created : " << this->Internal->InProj << std::endl;
-  std::cout << "OutProj created : " << this->Internal->OutProj << std::endl;
-  if (this->Internal->InProj)
-    std::cout << "inProj datum_type : [" << this->Internal->InProj->datum_type << "]" << std::endl;
-  if (this->Internal->OutProj)
-    std::cout << "outProj datum_type : [" << this->Internal->OutProj->datum_type << "]" << std::endl;
+    utmparamsOut << "+proj=utm +zone=" << utmZone << " +ellps=WGS84 +datum=WGS84 +no_defs";
+  }
+
+  this->Internal->Projection.reset(new GeoProjection(utmparamsIn.str(), utmparamsOut.str()));
+  if (!this->Internal->Projection->IsValid())
+  {
+    vtkGenericWarningMacro("Invalid UTM zone, the points will not be converted");
+    this->Internal->Projection.reset();
+  }
 #else
   // The PROJ 4.7 API makes it near impossible to do generic transforms, hence
   // InvertProj (see also comments there) is full of assumptions. Assert some
@@ -341,6 +603,23 @@ void vtkLASFileWriter::SetGeoConversion(int in, int out, int utmZone, bool isLat
   this->Internal->OutGcs = out;
 }
 
+//-----------------------------------------------------------------------------
+void vtkLASFileWriter::SetTiled(bool tiled)
+{
+  if (this->Internal->IsWriterInstanciated)
+  {
+    vtkGenericWarningMacro("The output can't be changed once the writer is instanciated");
+    return;
+  }
+  this->Internal->IsTiled = tiled;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLASFileWriter::SetTrajectory(vtkVelodyneTransformInterpolator* trajectory)
+{
+  this->Internal->Georeferencer.SetTrajectory(trajectory);
+}
+
 //-----------------------------------------------------------------------------
 void vtkLASFileWriter::SetPrecision(double neTol, double hTol)
 {
@@ -358,48 +637,37 @@ void vtkLASFileWriter::WriteFrame(vtkPolyData* data)
 {
   if (!this->Internal->IsWriterInstanciated)
   {
-    this->Internal->Writer = new liblas::Writer(this->Internal->Stream, this->Internal->header);
-    this->Internal->IsWriterInstanciated = true;
-  }
-
-  vtkPoints* const points = data->GetPoints();
-  vtkDataArray* const intensityData = data->GetPointData()->GetArray("intensity");
-  vtkDataArray* const laserIdData = data->GetPointData()->GetArray("laser_id");
-  vtkDataArray* const timestampData = data->GetPointData()->GetArray("timestamp");
-
-  const vtkIdType numPoints = points->GetNumberOfPoints();
-  for (vtkIdType n = 0; n < numPoints; ++n)
-  {
-    const double time = timestampData->GetComponent(n, 0) * 1e-6;
-    if (time >= this->Internal->MinTime && time <= this->Internal->MaxTime)
+    if (this->Internal->IsTiled)
     {
-      Eigen::Vector3d pos;
-      points->GetPoint(n, pos.data());
-      pos += this->Internal->Origin;
-
-#ifdef PJ_VERSION // 4.8 or later
-      if (this->Internal->OutProj)
-      {
-        pos = ConvertGcs(pos, this->Internal->InProj, this->Internal->OutProj);
-      }
-#else
-      if (this->Internal->Proj)
+      // the dataset is in the directory named like the file, the nodes being quantized like
+      // the points of the LAS file
+      boost::filesystem::path directory(this->Internal->FileName);
+      directory.replace_extension();
+      const liblas::Header& header = this->Internal->header;
+      this->Internal->Tiles.reset(new EptWriter);
+      this->Internal->Tiles->SetScale(header.GetScaleX(), header.GetScaleZ());
+      this->Internal->Tiles->SetEPSG(this->Internal->Gcs);
+      if (!this->Internal->Tiles->Open(directory.string()))
       {
-        pos = InvertProj(pos, this->Internal->Proj);
+        vtkGenericWarningMacro("Failed to write the tiles: " << this->Internal->Tiles->GetLastError());
+        this->Internal->Tiles.reset();
       }
-#endif
-
-      liblas::Point p(&this->Internal->Writer->GetHeader());
-      p.SetCoordinates(pos[0], pos[1], pos[2]);
-      p.SetIntensity(static_cast<uint16_t>(intensityData->GetComponent(n, 0)));
-      p.SetReturnNumber(1);
-      p.SetNumberOfReturns(1);
-      p.SetUserData(static_cast<uint8_t>(laserIdData->GetComponent(n, 0)));
-      p.SetTime(time);
-
-      this->Internal->Writer->WritePoint(p);
     }
+    else
+    {
+      this->Internal->Stream.open(
+        this->Internal->FileName.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+      this->Internal->Writer = new liblas::Writer(this->Internal->Stream, this->Internal->header);
+    }
+    this->Internal->IsWriterInstanciated = true;
+    this->Internal->WritingThread =
+      boost::thread(boost::bind(&vtkLASFileWriter::vtkInternal::WritingLoop, this->Internal));
   }
+
+  // the points are converted here while the previous frames are written by the thread
+  std::shared_ptr<PointBatch> batch = std::make_shared<PointBatch>();
+  this->Internal->ConvertFrame(data, *batch);
+  this->Internal->Enqueue(batch);
 }
 
 //-----------------------------------------------------------------------------
@@ -413,44 +681,40 @@ void vtkLASFileWriter::FlushMetaData()
 //-----------------------------------------------------------------------------
 void vtkLASFileWriter::UpdateMetaData(vtkPolyData* data)
 {
-  vtkPoints* const points = data->GetPoints();
-  vtkDataArray* const timestampData = data->GetPointData()->GetArray("timestamp");
+  PointBatch batch;
+  this->Internal->ConvertFrame(data, batch);
 
-  const vtkIdType numPoints = points->GetNumberOfPoints();
-  for (vtkIdType n = 0; n < numPoints; ++n)
+  this->Internal->npoints += batch.Times.size();
+  for (size_t n = 0; n < batch.Times.size(); ++n)
   {
-    const double time = timestampData->GetComponent(n, 0) * 1e-6;
-    if (time >= this->Internal->MinTime && time <= this->Internal->MaxTime)
+    for (int i = 0; i < 3; ++i)
     {
-      Eigen::Vector3d pos;
-      points->GetPoint(n, pos.data());
-      pos += this->Internal->Origin;
-
-#ifdef PJ_VERSION // 4.8 or later
-      if (this->Internal->OutProj)
-      {
-        pos = ConvertGcs(pos, this->Internal->InProj, this->Internal->OutProj);
-      }
-#else
-      if (this->Internal->Proj)
+      const double value = batch.Positions[3 * n + i];
+      if (value > this->Internal->MaxPt[i])
       {
-        pos = InvertProj(pos, this->Internal->Proj);
+        this->Internal->MaxPt[i] = value;
       }
-#endif
-
-      this->Internal->npoints++;
-
-      for (int i = 0; i < 3; ++i)
+      if (value < this->Internal->MinPt[i])
       {
-        if (pos[i] > this->Internal->MaxPt[i])
-        {
-          this->Internal->MaxPt[i] = pos[i];
-        }
-        if (pos[i] < this->Internal->MinPt[i])
-        {
-          this->Internal->MinPt[i] = pos[i];
-        }
+        this->Internal->MinPt[i] = value;
       }
     }
   }
 }
+
+//-----------------------------------------------------------------------------
+bool vtkLASFileWriter::WriteFrames(
+  vtkLidarReader* reader, int firstFrame, int lastFrame, const ProgressCallback& progress)
+{
+  const double numberOfFrames = std::max(lastFrame - firstFrame + 1, 1);
+
+  // the frames are decoded by the reader threads, converted on this thread and written by the
+  // writing thread, the bounds and the number of points are patched in the header on close
+  const bool isComplete =
+    reader->GetFrames(firstFrame, lastFrame, [&](int frame, vtkPolyData* data) {
+      this->WriteFrame(data);
+      return !progress || progress((frame - firstFrame + 1) / numberOfFrames);
+    });
+  this->Internal->Close();
+  return isComplete;
+}
@@ -34,7 +34,11 @@
 
 #include <vtkSystemIncludes.h>
 
+#include <boost/function.hpp>
+
+class vtkLidarReader;
 class vtkPolyData;
+class vtkVelodyneTransformInterpolator;
 
 class VTK_EXPORT vtkLASFileWriter
 {
@@ -48,13 +52,57 @@ public:
   void SetGeoConversion(int in, int out, int utmZone, bool isLatLon);
   void SetPrecision(double neTol, double hTol = 1e-3);
 
+  /**
+   * @brief SetTrajectory set the poses of the sensor given by a position reader, the points
+   * are moved with the pose of their time before the origin is added. The poses are
+   * interpolated once per frame on a time grid and the points are transformed in parallel.
+   */
+  void SetTrajectory(vtkVelodyneTransformInterpolator* trajectory);
+
+  /**
+   * @brief SetTiled write the points as an Entwine Point Tile octree instead of a single LAS
+   * file. The dataset is written in the directory named like the file without its extension
+   * (survey.las gives survey/ept.json), the nodes being flushed in parallel when the writer is
+   * closed. It must be called before the first frame is written.
+   */
+  void SetTiled(bool tiled);
+
+  /**
+   * @brief UpdateMetaData and FlushMetaData fill the header before the points are written. They
+   * are not needed anymore: the number of points and the bounds of the points written are
+   * patched in the header when the file is closed.
+   */
   void UpdateMetaData(vtkPolyData* data);
   void FlushMetaData();
 
+  /**
+   * @brief WriteFrame write the points of a frame in the time range, the header being completed
+   * when the writer is destroyed
+   */
   void WriteFrame(vtkPolyData* data);
 
+  /**
+   * @brief ProgressCallback receive the progress of WriteFrames, between 0 and 1
+   * @return false to abort the export
+   */
+  typedef boost::function<bool(double progress)> ProgressCallback;
+
+  /**
+   * @brief WriteFrames export a range of frames of a reader, each frame being decoded once. The
+   * points of a frame are projected with a single call, and written by a thread while the next
+   * frames are decoded. The file is complete when this returns.
+   * @param reader reader of the frames
+   * @param firstFrame first frame to export
+   * @param lastFrame last frame to export, this frame is included
+   * @param progress called after each frame, may be empty
+   * @return false if the export has been aborted
+   */
+  bool WriteFrames(vtkLidarReader* reader, int firstFrame, int lastFrame,
+    const ProgressCallback& progress = ProgressCallback());
+
 protected:
   class vtkInternal;
+  struct PointBatch;
 
   vtkInternal* Internal;
 };
@@ -0,0 +1,297 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// LOCAL
+#include "vtkLidarCSVWriter.h"
+#include "ParallelPoints.h"
+
+// STD
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+
+// VTK
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// BOOST
+
+namespace
+{
+//! Points formatted by a thread at least
+const vtkIdType MinimumPointsPerThread = 65536;
+
+//! Exact powers of ten of the fixed point formatting
+const double PowersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                               1e12, 1e13, 1e14, 1e15, 1e16, 1e17 };
+const long long IntegerPowersOfTen[] = { 1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL,
+  10000000LL, 100000000LL, 1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL,
+  10000000000000LL, 100000000000000LL, 1000000000000000LL, 10000000000000000LL,
+  100000000000000000LL };
+const int MaximumDecimals = 17;
+
+//! Above this magnitude, a scaled value is not an exact integer in a double
+const double MaximumScaledValue = 9e15;
+
+//-----------------------------------------------------------------------------
+// Column of the file, a component of the points or of a point data array
+struct Column
+{
+  vtkDataArray* Array;
+  int Component;
+  bool IsInteger;
+  bool IsFloat;
+};
+
+//-----------------------------------------------------------------------------
+void AppendInteger(std::string& buffer, long long value)
+{
+  char digits[24];
+  int size = 0;
+  unsigned long long magnitude = value < 0 ? 0ULL - static_cast<unsigned long long>(value)
+                                           : static_cast<unsigned long long>(value);
+  do
+  {
+    digits[size++] = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (value < 0)
+  {
+    buffer.push_back('-');
+  }
+  while (size > 0)
+  {
+    buffer.push_back(digits[--size]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Append scaled / 10^decimals, scaled being an integer
+void AppendScaled(std::string& buffer, long long scaled, int decimals)
+{
+  if (scaled < 0)
+  {
+    buffer.push_back('-');
+    scaled = -scaled;
+  }
+  AppendInteger(buffer, scaled / IntegerPowersOfTen[decimals]);
+  if (decimals > 0)
+  {
+    buffer.push_back('.');
+    long long fraction = scaled % IntegerPowersOfTen[decimals];
+    const size_t end = buffer.size() + decimals;
+    buffer.resize(end);
+    for (int i = 1; i <= decimals; ++i)
+    {
+      buffer[end - i] = static_cast<char>('0' + fraction % 10);
+      fraction /= 10;
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+void AppendPrintf(std::string& buffer, const char* format, int precision, double value)
+{
+  char text[512];
+  const int size = std::snprintf(text, sizeof(text), format, precision, value);
+  buffer.append(text, std::min<size_t>(std::max(size, 0), sizeof(text) - 1));
+}
+
+//-----------------------------------------------------------------------------
+void AppendFixed(std::string& buffer, double value, int decimals)
+{
+  if (decimals <= MaximumDecimals && std::isfinite(value) &&
+      std::abs(value) * PowersOfTen[decimals] < MaximumScaledValue)
+  {
+    AppendScaled(buffer, std::llround(value * PowersOfTen[decimals]), decimals);
+    return;
+  }
+  AppendPrintf(buffer, "%.*f", decimals, value);
+}
+
+//-----------------------------------------------------------------------------
+bool IsCloseToFloatMiddle(double value)
+{
+  const float closest = static_cast<float>(value);
+  const float next = std::nextafter(closest, value > closest ? HUGE_VALF : -HUGE_VALF);
+  const double middle = 0.5 * (static_cast<double>(closest) + static_cast<double>(next));
+  return std::abs(value - middle) <= 4. * std::numeric_limits<double>::epsilon() * std::abs(value);
+}
+
+//-----------------------------------------------------------------------------
+// Append the fewest digits which read back to value, as a float or as a double
+void AppendShortest(std::string& buffer, double value, bool isFloat)
+{
+  // the values are first tried in fixed point with an increasing number of
+  // decimals, which is exact for a double as the nearest double to r / 10^d is
+  // the quotient of these two exact doubles, and checked for a float
+  if (std::isfinite(value))
+  {
+    for (int decimals = 0; decimals <= MaximumDecimals; ++decimals)
+    {
+      const double scaledValue = value * PowersOfTen[decimals];
+      if (std::abs(scaledValue) >= MaximumScaledValue)
+      {
+        break;
+      }
+      const long long scaled = std::llround(scaledValue);
+      const double candidate = static_cast<double>(scaled) / PowersOfTen[decimals];
+      if (isFloat ? static_cast<float>(candidate) != static_cast<float>(value) : candidate != value)
+      {
+        continue;
+      }
+      // the decimal may round to another float than the candidate only when the
+      // candidate is at about a double ulp of the middle of two floats
+      const size_t start = buffer.size();
+      AppendScaled(buffer, scaled, decimals);
+      if (!isFloat || !IsCloseToFloatMiddle(candidate) ||
+          std::strtof(buffer.c_str() + start, nullptr) == static_cast<float>(value))
+      {
+        return;
+      }
+      buffer.resize(start);
+      break;
+    }
+  }
+
+  // too large or too small values, the number of significant digits is increased
+  // until the value reads back
+  const int minimumDigits = isFloat ? 6 : 15;
+  const int maximumDigits = isFloat ? 9 : 17;
+  const size_t start = buffer.size();
+  for (int digits = minimumDigits; digits <= maximumDigits; ++digits)
+  {
+    buffer.resize(start);
+    AppendPrintf(buffer, "%.*g", digits, value);
+    const char* text = buffer.c_str() + start;
+    if (isFloat ? std::strtof(text, nullptr) == static_cast<float>(value)
+                : std::strtod(text, nullptr) == value)
+    {
+      return;
+    }
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarCSVWriter::Write(vtkPolyData* frame, const std::string& fileName) const
+{
+  std::ofstream stream(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!stream.is_open() || !frame)
+  {
+    return false;
+  }
+
+  // The coordinates come first, then the arrays whose components are separate columns
+  auto isSelected = [this](const std::string& name) {
+    return this->Columns.empty() ||
+      std::find(this->Columns.begin(), this->Columns.end(), name) != this->Columns.end();
+  };
+  vtkDataArray* coordinates = frame->GetPoints() ? frame->GetPoints()->GetData() : nullptr;
+  std::vector<std::pair<std::string, vtkDataArray*> > arrays;
+  if (coordinates && isSelected("Points"))
+  {
+    arrays.push_back(std::make_pair(std::string("Points"), coordinates));
+  }
+  vtkPointData* pointData = frame->GetPointData();
+  for (int arrayIndex = 0; arrayIndex < pointData->GetNumberOfArrays(); ++arrayIndex)
+  {
+    vtkDataArray* array = pointData->GetArray(arrayIndex);
+    if (array && array->GetName() && isSelected(array->GetName()))
+    {
+      arrays.push_back(std::make_pair(std::string(array->GetName()), array));
+    }
+  }
+
+  std::string header;
+  std::vector<Column> columns;
+  for (const auto& array : arrays)
+  {
+    const int dataType = array.second->GetDataType();
+    const int numberOfComponents = array.second->GetNumberOfComponents();
+    for (int component = 0; component < numberOfComponents; ++component)
+    {
+      if (!columns.empty())
+      {
+        header.push_back(this->Delimiter);
+      }
+      header += "\"" + array.first;
+      if (numberOfComponents > 1 || array.second == coordinates)
+      {
+        header += ":" + std::to_string(component);
+      }
+      header += "\"";
+      columns.push_back({ array.second, component, dataType != VTK_FLOAT && dataType != VTK_DOUBLE,
+                          dataType == VTK_FLOAT });
+    }
+  }
+  header.push_back('\n');
+  stream.write(header.data(), header.size());
+
+  // The points are formatted by blocks, each thread formatting a range of the
+  // block in its own buffer, so that the memory used does not depend on the frame
+  const int numberOfThreads = GetNumberOfThreads(this->NumberOfThreads);
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+  const vtkIdType pointsPerBlock = numberOfThreads * MinimumPointsPerThread;
+  std::vector<std::string> buffers(numberOfThreads);
+  for (vtkIdType blockStart = 0; blockStart < numberOfPoints && stream; blockStart += pointsPerBlock)
+  {
+    const vtkIdType blockSize = std::min(pointsPerBlock, numberOfPoints - blockStart);
+    const int numberOfRanges = std::max<int>(1,
+      std::min<vtkIdType>(numberOfThreads, blockSize / MinimumPointsPerThread));
+    ParallelFor(blockSize, numberOfRanges, [&](size_t range, size_t begin, size_t end) {
+      std::string& buffer = buffers[range];
+      buffer.clear();
+      for (vtkIdType pointIndex = blockStart + begin; pointIndex < blockStart + static_cast<vtkIdType>(end); ++pointIndex)
+      {
+        for (size_t columnIndex = 0; columnIndex < columns.size(); ++columnIndex)
+        {
+          if (columnIndex > 0)
+          {
+            buffer.push_back(this->Delimiter);
+          }
+          const Column& column = columns[columnIndex];
+          const double value = column.Array->GetComponent(pointIndex, column.Component);
+          if (column.IsInteger)
+          {
+            AppendInteger(buffer, static_cast<long long>(value));
+          }
+          else if (this->Precision >= 0)
+          {
+            AppendFixed(buffer, value, this->Precision);
+          }
+          else
+          {
+            AppendShortest(buffer, value, column.IsFloat);
+          }
+        }
+        buffer.push_back('\n');
+      }
+    });
+    for (int range = 0; range < numberOfRanges; ++range)
+    {
+      stream.write(buffers[range].data(), buffers[range].size());
+    }
+  }
+  return static_cast<bool>(stream);
+}
@@ -0,0 +1,74 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VTK_LIDAR_CSV_WRITER_H
+#define VTK_LIDAR_CSV_WRITER_H
+
+// STD
+#include <string>
+#include <vector>
+
+// VTK
+#include <vtkSystemIncludes.h>
+
+class vtkPolyData;
+
+/**
+ * @brief vtkLidarCSVWriter write the points of a frame as a CSV (or TSV) file: the coordinates
+ * in the Points:0, Points:1 and Points:2 columns, then the point data arrays, a column per
+ * component. This is the layout of the CSV export of the application.
+ *
+ * The values are formatted by hand in large buffers instead of going through streams: the
+ * integer arrays as integers, the other ones either with a fixed number of decimals, or
+ * with the fewest significant digits reading back to the same float or double. The points
+ * are split in ranges formatted by several threads, the buffers being written in order.
+ */
+class VTK_EXPORT vtkLidarCSVWriter
+{
+public:
+  /// Set the character between the columns, ',' by default, '\t' gives a TSV file
+  void SetDelimiter(char delimiter) { this->Delimiter = delimiter; }
+  char GetDelimiter() const { return this->Delimiter; }
+
+  /// Set the number of decimals of the floating point values, -1 by default to write
+  /// the shortest representation which reads back to the same value
+  void SetPrecision(int precision) { this->Precision = precision; }
+  int GetPrecision() const { return this->Precision; }
+
+  /// Set the columns to write, "Points" for the coordinates or the name of a point data
+  /// array, in the order of the frame. All of them are written when this is empty
+  void SetColumns(const std::vector<std::string>& columns) { this->Columns = columns; }
+  const std::vector<std::string>& GetColumns() const { return this->Columns; }
+
+  /// Set the number of threads formatting a frame, 0 uses one thread per core
+  void SetNumberOfThreads(int numberOfThreads) { this->NumberOfThreads = numberOfThreads; }
+  int GetNumberOfThreads() const { return this->NumberOfThreads; }
+
+  /**
+   * @brief Write a frame, this may be called by several threads at the same time
+   * @return false if the file cannot be written
+   */
+  bool Write(vtkPolyData* frame, const std::string& fileName) const;
+
+private:
+  char Delimiter = ',';
+  int Precision = -1;
+  std::vector<std::string> Columns;
+  int NumberOfThreads = 0;
+};
+
+#endif // VTK_LIDAR_CSV_WRITER_H
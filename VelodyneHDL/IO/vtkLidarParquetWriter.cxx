@@ -0,0 +1,907 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "vtkLidarParquetWriter.h"
+#include "vtkLidarReader.h"
+
+// STD
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+// VTK
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+// BOOST
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace
+{
+const char Magic[4] = { 'P', 'A', 'R', '1' };
+
+//! Row groups queued or encoded and waiting to be written, per encoding thread at most
+const size_t MaximumPendingRowGroupsPerThread = 2;
+
+//! Values of parquet.thrift
+enum PhysicalType
+{
+  INT32 = 1,
+  INT64 = 2,
+  FLOAT = 4,
+  DOUBLE = 5
+};
+enum ConvertedType
+{
+  NONE = -1,
+  UINT_8 = 11,
+  UINT_16 = 12,
+  UINT_32 = 13,
+  UINT_64 = 14,
+  INT_8 = 15,
+  INT_16 = 16
+};
+enum Encoding
+{
+  PLAIN = 0,
+  PLAIN_DICTIONARY = 2,
+  RLE = 3
+};
+enum PageType
+{
+  DATA_PAGE = 0,
+  DICTIONARY_PAGE = 2
+};
+
+//-----------------------------------------------------------------------------
+void AppendVarint(std::string& buffer, boost::uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back(static_cast<char>(value));
+}
+
+//-----------------------------------------------------------------------------
+//! Writer of the Thrift compact protocol, which encodes the metadata of the Parquet files
+class CompactWriter
+{
+public:
+  enum Type
+  {
+    BOOL_TRUE = 1,
+    BOOL_FALSE = 2,
+    I32 = 5,
+    I64 = 6,
+    BINARY = 8,
+    LIST = 9,
+    STRUCT = 12
+  };
+
+  explicit CompactWriter(std::string& buffer)
+    : Buffer(buffer)
+  {
+  }
+
+  void I32Field(int id, boost::int32_t value)
+  {
+    this->FieldHeader(id, I32);
+    this->Integer(value);
+  }
+
+  void I64Field(int id, boost::int64_t value)
+  {
+    this->FieldHeader(id, I64);
+    this->Integer(value);
+  }
+
+  void StringField(int id, const std::string& value)
+  {
+    this->FieldHeader(id, BINARY);
+    this->String(value);
+  }
+
+  //! The fields of the struct follow, then EndStruct
+  void StructField(int id)
+  {
+    this->FieldHeader(id, STRUCT);
+    this->BeginStruct();
+  }
+
+  //! The elements follow, with Integer, String or BeginStruct
+  void ListField(int id, Type elementType, size_t size)
+  {
+    this->FieldHeader(id, LIST);
+    if (size < 15)
+    {
+      this->Buffer.push_back(static_cast<char>((size << 4) | elementType));
+    }
+    else
+    {
+      this->Buffer.push_back(static_cast<char>(0xF0 | elementType));
+      AppendVarint(this->Buffer, size);
+    }
+  }
+
+  void BeginStruct()
+  {
+    this->LastFieldIds.push_back(this->LastFieldId);
+    this->LastFieldId = 0;
+  }
+
+  void EndStruct()
+  {
+    this->Buffer.push_back(0);
+    this->LastFieldId = this->LastFieldIds.back();
+    this->LastFieldIds.pop_back();
+  }
+
+  void Integer(boost::int64_t value)
+  {
+    AppendVarint(this->Buffer, (static_cast<boost::uint64_t>(value) << 1) ^
+        static_cast<boost::uint64_t>(value >> 63));
+  }
+
+  void String(const std::string& value)
+  {
+    AppendVarint(this->Buffer, value.size());
+    this->Buffer += value;
+  }
+
+private:
+  void FieldHeader(int id, Type type)
+  {
+    const int delta = id - this->LastFieldId;
+    if (delta > 0 && delta <= 15)
+    {
+      this->Buffer.push_back(static_cast<char>((delta << 4) | type));
+    }
+    else
+    {
+      this->Buffer.push_back(static_cast<char>(type));
+      this->Integer(id);
+    }
+    this->LastFieldId = id;
+  }
+
+  std::string& Buffer;
+  int LastFieldId = 0;
+  std::vector<int> LastFieldIds;
+};
+
+//-----------------------------------------------------------------------------
+//! Column of the file, a component of the points or of a point data array, or the frame number
+struct Column
+{
+  std::string Name;
+  //! name of the array in the frames, empty for the points and the frame number
+  std::string ArrayName;
+  bool IsPoints;
+  int Component;
+  int Type;
+  int Converted;
+};
+
+//-----------------------------------------------------------------------------
+//! Parquet type of the values of a VTK type, false for the types which cannot be written
+bool GetParquetType(int dataType, int& type, int& converted)
+{
+  const bool isUnsigned = dataType == VTK_UNSIGNED_CHAR || dataType == VTK_UNSIGNED_SHORT ||
+    dataType == VTK_UNSIGNED_INT || dataType == VTK_UNSIGNED_LONG ||
+    dataType == VTK_UNSIGNED_LONG_LONG;
+  switch (dataType)
+  {
+    case VTK_FLOAT:
+      type = FLOAT;
+      converted = NONE;
+      return true;
+    case VTK_DOUBLE:
+      type = DOUBLE;
+      converted = NONE;
+      return true;
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR:
+    case VTK_UNSIGNED_CHAR:
+      type = INT32;
+      converted = isUnsigned ? UINT_8 : INT_8;
+      return true;
+    case VTK_SHORT:
+    case VTK_UNSIGNED_SHORT:
+      type = INT32;
+      converted = isUnsigned ? UINT_16 : INT_16;
+      return true;
+    case VTK_INT:
+    case VTK_UNSIGNED_INT:
+    case VTK_LONG:
+    case VTK_UNSIGNED_LONG:
+    case VTK_LONG_LONG:
+    case VTK_UNSIGNED_LONG_LONG:
+    case VTK_ID_TYPE:
+    {
+      const bool isLong = vtkDataArray::GetDataTypeSize(dataType) == 8;
+      type = isLong ? INT64 : INT32;
+      converted = !isUnsigned ? NONE : isLong ? UINT_64 : UINT_32;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+//-----------------------------------------------------------------------------
+int GetValueSize(int type)
+{
+  return type == INT32 || type == FLOAT ? 4 : 8;
+}
+
+//-----------------------------------------------------------------------------
+//! Convert a value given as a double, the unsigned integers keeping their bits
+template<typename TOut>
+TOut FromDouble(double value)
+{
+  return static_cast<TOut>(value);
+}
+template<>
+boost::int32_t FromDouble<boost::int32_t>(double value)
+{
+  return static_cast<boost::int32_t>(static_cast<boost::int64_t>(value));
+}
+template<>
+boost::int64_t FromDouble<boost::int64_t>(double value)
+{
+  return value >= 9223372036854775808.0
+    ? static_cast<boost::int64_t>(static_cast<boost::uint64_t>(value))
+    : static_cast<boost::int64_t>(value);
+}
+
+//-----------------------------------------------------------------------------
+template<typename TIn, typename TOut>
+void GatherTypedValues(const TIn* values, int numberOfComponents, int component,
+  vtkIdType numberOfValues, TOut* output)
+{
+  values += component;
+  for (vtkIdType i = 0; i < numberOfValues; ++i, values += numberOfComponents)
+  {
+    output[i] = static_cast<TOut>(*values);
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Copy a component of the first values of an array in the plain encoding of its column
+template<typename TOut>
+void GatherValues(vtkDataArray* array, int component, vtkIdType numberOfValues, char* output)
+{
+  TOut* values = reinterpret_cast<TOut*>(output);
+  if (!array->HasStandardMemoryLayout())
+  {
+    for (vtkIdType i = 0; i < numberOfValues; ++i)
+    {
+      values[i] = FromDouble<TOut>(array->GetComponent(i, component));
+    }
+    return;
+  }
+  switch (array->GetDataType())
+  {
+    vtkTemplateMacro(GatherTypedValues(static_cast<const VTK_TT*>(array->GetVoidPointer(0)),
+      array->GetNumberOfComponents(), component, numberOfValues, values));
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Append values with the RLE / bit-packing hybrid encoding: the runs of at least 8 equal
+//! values are run length encoded, the other values are bit packed by groups of 8
+void AppendHybrid(std::string& buffer, const std::vector<boost::uint32_t>& values, int bitWidth)
+{
+  const size_t numberOfValues = values.size();
+  std::vector<boost::uint32_t> runs(numberOfValues);
+  for (size_t i = numberOfValues; i-- > 0;)
+  {
+    const bool continues = i + 1 < numberOfValues && values[i + 1] == values[i];
+    runs[i] = continues ? runs[i + 1] + 1 : 1;
+  }
+
+  const int byteWidth = (bitWidth + 7) / 8;
+  size_t i = 0;
+  while (i < numberOfValues)
+  {
+    if (runs[i] >= 8)
+    {
+      AppendVarint(buffer, static_cast<boost::uint64_t>(runs[i]) << 1);
+      for (int b = 0; b < byteWidth; ++b)
+      {
+        buffer.push_back(static_cast<char>(values[i] >> (8 * b)));
+      }
+      i += runs[i];
+      continue;
+    }
+
+    // the groups end before the next long run, the last one is padded with zeros
+    size_t end = i;
+    do
+    {
+      end += 8;
+    } while (end < numberOfValues && runs[end] < 8);
+    const size_t numberOfGroups = (end - i) / 8;
+    AppendVarint(buffer, (static_cast<boost::uint64_t>(numberOfGroups) << 1) | 1);
+    boost::uint64_t bits = 0;
+    int numberOfBits = 0;
+    for (size_t k = i; k < end; ++k)
+    {
+      bits |= static_cast<boost::uint64_t>(k < numberOfValues ? values[k] : 0) << numberOfBits;
+      numberOfBits += bitWidth;
+      while (numberOfBits >= 8)
+      {
+        buffer.push_back(static_cast<char>(bits & 0xFF));
+        bits >>= 8;
+        numberOfBits -= 8;
+      }
+    }
+    i = std::min(end, numberOfValues);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void AppendPageHeader(std::string& buffer, int pageType, size_t pageSize, size_t numberOfValues,
+  int encoding)
+{
+  CompactWriter writer(buffer);
+  writer.BeginStruct();
+  writer.I32Field(1, pageType);
+  writer.I32Field(2, static_cast<boost::int32_t>(pageSize));
+  writer.I32Field(3, static_cast<boost::int32_t>(pageSize));
+  if (pageType == DICTIONARY_PAGE)
+  {
+    writer.StructField(7);
+    writer.I32Field(1, static_cast<boost::int32_t>(numberOfValues));
+    writer.I32Field(2, encoding);
+    writer.EndStruct();
+  }
+  else
+  {
+    // the columns are required, there are no levels
+    writer.StructField(5);
+    writer.I32Field(1, static_cast<boost::int32_t>(numberOfValues));
+    writer.I32Field(2, encoding);
+    writer.I32Field(3, RLE);
+    writer.I32Field(4, RLE);
+    writer.EndStruct();
+  }
+  writer.EndStruct();
+}
+
+//-----------------------------------------------------------------------------
+//! Dictionary of the values of a column chunk, the values being compared by their bits
+template<typename TKey>
+bool BuildDictionary(const char* values, size_t numberOfValues, size_t maximumSize,
+  std::string& dictionary, std::vector<boost::uint32_t>& indices)
+{
+  std::unordered_map<TKey, boost::uint32_t> index;
+  indices.resize(numberOfValues);
+  for (size_t i = 0; i < numberOfValues; ++i)
+  {
+    TKey key;
+    std::memcpy(&key, values + i * sizeof(TKey), sizeof(TKey));
+    auto inserted = index.insert(std::make_pair(key, static_cast<boost::uint32_t>(index.size())));
+    if (inserted.second)
+    {
+      if (index.size() > maximumSize)
+      {
+        return false;
+      }
+      dictionary.append(values + i * sizeof(TKey), sizeof(TKey));
+    }
+    indices[i] = inserted.first->second;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//! Pages of a column of a row group, the offsets being relative to the row group
+struct ColumnChunk
+{
+  size_t DictionaryPageOffset = 0;
+  size_t DataPageOffset = 0;
+  size_t Size = 0;
+  bool IsDictionaryEncoded = false;
+};
+
+//-----------------------------------------------------------------------------
+struct RowGroup
+{
+  std::string Data;
+  std::vector<ColumnChunk> Chunks;
+  boost::int64_t NumberOfRows = 0;
+  //! position of Data in the file
+  boost::int64_t Offset = 0;
+};
+
+//-----------------------------------------------------------------------------
+//! Append the pages of a column, given in the plain encoding
+void AppendColumnChunk(RowGroup& rowGroup, int type, const std::string& plain,
+  size_t numberOfValues, size_t maximumDictionarySize)
+{
+  ColumnChunk chunk;
+  const size_t start = rowGroup.Data.size();
+
+  // a dictionary is used if the pages are smaller than the plain values
+  std::string dictionary;
+  std::vector<boost::uint32_t> indices;
+  const bool hasDictionary = GetValueSize(type) == 4
+    ? BuildDictionary<boost::uint32_t>(plain.data(), numberOfValues, maximumDictionarySize, dictionary, indices)
+    : BuildDictionary<boost::uint64_t>(plain.data(), numberOfValues, maximumDictionarySize, dictionary, indices);
+  std::string data;
+  if (hasDictionary && numberOfValues > 0)
+  {
+    int bitWidth = 1;
+    while ((static_cast<boost::uint64_t>(1) << bitWidth) < dictionary.size() / GetValueSize(type))
+    {
+      bitWidth++;
+    }
+    data.push_back(static_cast<char>(bitWidth));
+    AppendHybrid(data, indices, bitWidth);
+    chunk.IsDictionaryEncoded = dictionary.size() + data.size() < plain.size();
+  }
+
+  if (chunk.IsDictionaryEncoded)
+  {
+    chunk.DictionaryPageOffset = rowGroup.Data.size();
+    AppendPageHeader(rowGroup.Data, DICTIONARY_PAGE, dictionary.size(),
+      dictionary.size() / GetValueSize(type), PLAIN_DICTIONARY);
+    rowGroup.Data += dictionary;
+    chunk.DataPageOffset = rowGroup.Data.size();
+    AppendPageHeader(rowGroup.Data, DATA_PAGE, data.size(), numberOfValues, PLAIN_DICTIONARY);
+    rowGroup.Data += data;
+  }
+  else
+  {
+    chunk.DataPageOffset = rowGroup.Data.size();
+    AppendPageHeader(rowGroup.Data, DATA_PAGE, plain.size(), numberOfValues, PLAIN);
+    rowGroup.Data += plain;
+  }
+  chunk.Size = rowGroup.Data.size() - start;
+  rowGroup.Chunks.push_back(chunk);
+}
+}
+
+//-----------------------------------------------------------------------------
+class vtkLidarParquetWriter::vtkInternal
+{
+public:
+  typedef std::vector<std::pair<int, vtkSmartPointer<vtkPolyData> > > FrameList;
+
+  void EncodeRowGroups();
+  void Encode(const FrameList& frames, RowGroup& rowGroup);
+  //! Queue the pending frames, waiting while the encoding is too late
+  bool Dispatch(boost::unique_lock<boost::mutex>& lock);
+  //! Write the row groups encoded in order, lock is released while writing
+  void WriteEncoded(boost::unique_lock<boost::mutex>& lock);
+  bool WriteFooter();
+
+  std::ofstream Stream;
+  boost::int64_t Offset = 0;
+  bool IsOpen = false;
+  std::vector<Column> Schema;
+  size_t MaximumDictionarySize = 0;
+
+  //! frames of the next row group
+  FrameList PendingFrames;
+
+  boost::thread_group Threads;
+  boost::mutex Mutex;
+  //! notified when a row group is queued, or when the file is closed
+  boost::condition_variable RowGroupQueued;
+  //! notified when a row group has been encoded
+  boost::condition_variable RowGroupEncoded;
+  std::deque<std::pair<size_t, FrameList> > Queue;
+  std::map<size_t, RowGroup> Encoded;
+  size_t MaximumPendingRowGroups = 1;
+  size_t NextRowGroup = 0;
+  size_t NextWrite = 0;
+  bool IsClosing = false;
+  bool HasFailed = false;
+
+  //! row groups written, without their data
+  std::vector<RowGroup> Written;
+};
+
+//-----------------------------------------------------------------------------
+void vtkLidarParquetWriter::vtkInternal::EncodeRowGroups()
+{
+  boost::unique_lock<boost::mutex> lock(this->Mutex);
+  while (!this->HasFailed)
+  {
+    if (this->Queue.empty())
+    {
+      if (this->IsClosing)
+      {
+        break;
+      }
+      this->RowGroupQueued.wait(lock);
+      continue;
+    }
+    std::pair<size_t, FrameList> job = std::move(this->Queue.front());
+    this->Queue.pop_front();
+    lock.unlock();
+
+    RowGroup rowGroup;
+    this->Encode(job.second, rowGroup);
+    job.second.clear();
+
+    lock.lock();
+    this->Encoded[job.first] = std::move(rowGroup);
+    this->RowGroupEncoded.notify_all();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarParquetWriter::vtkInternal::Encode(const FrameList& frames, RowGroup& rowGroup)
+{
+  for (const auto& frame : frames)
+  {
+    rowGroup.NumberOfRows += frame.second->GetNumberOfPoints();
+  }
+
+  std::string plain;
+  for (const Column& column : this->Schema)
+  {
+    const int valueSize = GetValueSize(column.Type);
+    plain.assign(rowGroup.NumberOfRows * valueSize, '\0');
+    char* values = &plain[0];
+    for (const auto& frame : frames)
+    {
+      const vtkIdType numberOfPoints = frame.second->GetNumberOfPoints();
+      vtkDataArray* array = column.IsPoints ? frame.second->GetPoints()->GetData()
+                                            : frame.second->GetPointData()->GetArray(column.ArrayName.c_str());
+      if (column.ArrayName.empty() && !column.IsPoints)
+      {
+        std::fill_n(reinterpret_cast<boost::int32_t*>(values), numberOfPoints, frame.first);
+      }
+      else if (array && array->GetNumberOfTuples() >= numberOfPoints &&
+        array->GetNumberOfComponents() > column.Component)
+      {
+        switch (column.Type)
+        {
+          case INT32:
+            GatherValues<boost::int32_t>(array, column.Component, numberOfPoints, values);
+            break;
+          case INT64:
+            GatherValues<boost::int64_t>(array, column.Component, numberOfPoints, values);
+            break;
+          case FLOAT:
+            GatherValues<float>(array, column.Component, numberOfPoints, values);
+            break;
+          default:
+            GatherValues<double>(array, column.Component, numberOfPoints, values);
+            break;
+        }
+      }
+      values += numberOfPoints * valueSize;
+    }
+    AppendColumnChunk(rowGroup, column.Type, plain, rowGroup.NumberOfRows, this->MaximumDictionarySize);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarParquetWriter::vtkInternal::Dispatch(boost::unique_lock<boost::mutex>& lock)
+{
+  if (this->PendingFrames.empty())
+  {
+    return !this->HasFailed;
+  }
+  while (!this->HasFailed)
+  {
+    this->WriteEncoded(lock);
+    if (this->NextRowGroup - this->NextWrite < this->MaximumPendingRowGroups)
+    {
+      break;
+    }
+    this->RowGroupEncoded.wait(lock);
+  }
+  if (this->HasFailed)
+  {
+    return false;
+  }
+  this->Queue.push_back(std::make_pair(this->NextRowGroup++, std::move(this->PendingFrames)));
+  this->PendingFrames.clear();
+  this->RowGroupQueued.notify_one();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+void vtkLidarParquetWriter::vtkInternal::WriteEncoded(boost::unique_lock<boost::mutex>& lock)
+{
+  auto next = this->Encoded.find(this->NextWrite);
+  while (next != this->Encoded.end() && !this->HasFailed)
+  {
+    RowGroup rowGroup = std::move(next->second);
+    this->Encoded.erase(next);
+    lock.unlock();
+
+    rowGroup.Offset = this->Offset;
+    this->Stream.write(rowGroup.Data.data(), rowGroup.Data.size());
+    this->Offset += rowGroup.Data.size();
+    rowGroup.Data.clear();
+    rowGroup.Data.shrink_to_fit();
+    const bool isWritten = static_cast<bool>(this->Stream);
+
+    lock.lock();
+    this->Written.push_back(std::move(rowGroup));
+    this->HasFailed = this->HasFailed || !isWritten;
+    this->NextWrite++;
+    next = this->Encoded.find(this->NextWrite);
+  }
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarParquetWriter::vtkInternal::WriteFooter()
+{
+  boost::int64_t numberOfRows = 0;
+  for (const RowGroup& rowGroup : this->Written)
+  {
+    numberOfRows += rowGroup.NumberOfRows;
+  }
+
+  std::string footer;
+  CompactWriter writer(footer);
+  writer.BeginStruct();
+  writer.I32Field(1, 1);
+
+  // the root of the schema, then a required column per leaf
+  writer.ListField(2, CompactWriter::STRUCT, this->Schema.size() + 1);
+  writer.BeginStruct();
+  writer.StringField(4, "schema");
+  writer.I32Field(5, static_cast<boost::int32_t>(this->Schema.size()));
+  writer.EndStruct();
+  for (const Column& column : this->Schema)
+  {
+    writer.BeginStruct();
+    writer.I32Field(1, column.Type);
+    writer.I32Field(3, 0);
+    writer.StringField(4, column.Name);
+    if (column.Converted != NONE)
+    {
+      writer.I32Field(6, column.Converted);
+    }
+    writer.EndStruct();
+  }
+  writer.I64Field(3, numberOfRows);
+
+  writer.ListField(4, CompactWriter::STRUCT, this->Written.size());
+  for (const RowGroup& rowGroup : this->Written)
+  {
+    writer.BeginStruct();
+    writer.ListField(1, CompactWriter::STRUCT, rowGroup.Chunks.size());
+    boost::int64_t totalSize = 0;
+    for (size_t i = 0; i < rowGroup.Chunks.size(); ++i)
+    {
+      const ColumnChunk& chunk = rowGroup.Chunks[i];
+      const Column& column = this->Schema[i];
+      const boost::int64_t firstPage = rowGroup.Offset +
+        (chunk.IsDictionaryEncoded ? chunk.DictionaryPageOffset : chunk.DataPageOffset);
+      writer.BeginStruct();
+      writer.I64Field(2, firstPage);
+      writer.StructField(3);
+      writer.I32Field(1, column.Type);
+      writer.ListField(2, CompactWriter::I32, 1);
+      writer.Integer(chunk.IsDictionaryEncoded ? PLAIN_DICTIONARY : PLAIN);
+      writer.ListField(3, CompactWriter::BINARY, 1);
+      writer.String(column.Name);
+      writer.I32Field(4, 0);
+      writer.I64Field(5, rowGroup.NumberOfRows);
+      writer.I64Field(6, static_cast<boost::int64_t>(chunk.Size));
+      writer.I64Field(7, static_cast<boost::int64_t>(chunk.Size));
+      writer.I64Field(9, rowGroup.Offset + static_cast<boost::int64_t>(chunk.DataPageOffset));
+      if (chunk.IsDictionaryEncoded)
+      {
+        writer.I64Field(11, firstPage);
+      }
+      writer.EndStruct();
+      writer.EndStruct();
+      totalSize += static_cast<boost::int64_t>(chunk.Size);
+    }
+    writer.I64Field(2, totalSize);
+    writer.I64Field(3, rowGroup.NumberOfRows);
+    writer.EndStruct();
+  }
+  writer.StringField(6, "VeloView");
+  writer.EndStruct();
+
+  const boost::uint32_t footerSize = static_cast<boost::uint32_t>(footer.size());
+  for (int i = 0; i < 4; ++i)
+  {
+    footer.push_back(static_cast<char>(footerSize >> (8 * i)));
+  }
+  footer.append(Magic, sizeof(Magic));
+  this->Stream.write(footer.data(), footer.size());
+  this->Stream.close();
+  return !this->Stream.fail();
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarParquetWriter::vtkLidarParquetWriter()
+  : Internal(new vtkInternal)
+{
+}
+
+//-----------------------------------------------------------------------------
+vtkLidarParquetWriter::~vtkLidarParquetWriter()
+{
+  this->Close();
+  delete this->Internal;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarParquetWriter::Open(const std::string& fileName)
+{
+  this->Close();
+  vtkInternal* internal = this->Internal;
+  internal->Stream.open(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!internal->Stream.is_open())
+  {
+    return false;
+  }
+  internal->Stream.write(Magic, sizeof(Magic));
+  internal->Offset = sizeof(Magic);
+  internal->IsOpen = true;
+  internal->Schema.clear();
+  internal->Written.clear();
+  internal->MaximumDictionarySize = std::max(this->MaximumDictionarySize, 1);
+  internal->NextRowGroup = internal->NextWrite = 0;
+  internal->IsClosing = internal->HasFailed = false;
+
+  int numberOfThreads = this->NumberOfThreads;
+  if (numberOfThreads <= 0)
+  {
+    numberOfThreads = boost::thread::hardware_concurrency();
+  }
+  numberOfThreads = std::max(1, numberOfThreads);
+  internal->MaximumPendingRowGroups = MaximumPendingRowGroupsPerThread * numberOfThreads;
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    internal->Threads.create_thread(boost::bind(&vtkInternal::EncodeRowGroups, internal));
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarParquetWriter::AddFrame(int frameNumber, vtkPolyData* frame)
+{
+  vtkInternal* internal = this->Internal;
+  if (!internal->IsOpen || !frame)
+  {
+    return false;
+  }
+
+  // the columns are the ones of the first frame
+  if (internal->Schema.empty())
+  {
+    auto isSelected = [this](const std::string& name) {
+      return this->Columns.empty() ||
+        std::find(this->Columns.begin(), this->Columns.end(), name) != this->Columns.end();
+    };
+    int type, converted;
+    vtkDataArray* coordinates = frame->GetPoints() ? frame->GetPoints()->GetData() : nullptr;
+    if (coordinates && isSelected("Points") && GetParquetType(coordinates->GetDataType(), type, converted))
+    {
+      const char* axes[3] = { "x", "y", "z" };
+      for (int i = 0; i < 3; ++i)
+      {
+        internal->Schema.push_back({ axes[i], std::string(), true, i, type, converted });
+      }
+    }
+    vtkPointData* pointData = frame->GetPointData();
+    for (int arrayIndex = 0; arrayIndex < pointData->GetNumberOfArrays(); ++arrayIndex)
+    {
+      vtkDataArray* array = pointData->GetArray(arrayIndex);
+      if (!array || !array->GetName() || !isSelected(array->GetName()) ||
+        !GetParquetType(array->GetDataType(), type, converted))
+      {
+        continue;
+      }
+      const std::string name = array->GetName();
+      const int numberOfComponents = array->GetNumberOfComponents();
+      for (int component = 0; component < numberOfComponents; ++component)
+      {
+        const std::string columnName =
+          numberOfComponents > 1 ? name + "_" + std::to_string(component) : name;
+        internal->Schema.push_back({ columnName, name, false, component, type, converted });
+      }
+    }
+    internal->Schema.push_back({ "frame", std::string(), false, 0, INT32, NONE });
+  }
+
+  internal->PendingFrames.push_back(std::make_pair(frameNumber, vtkSmartPointer<vtkPolyData>(frame)));
+  if (static_cast<int>(internal->PendingFrames.size()) < std::max(this->FramesPerRowGroup, 1))
+  {
+    return true;
+  }
+  boost::unique_lock<boost::mutex> lock(internal->Mutex);
+  return internal->Dispatch(lock);
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarParquetWriter::Close()
+{
+  vtkInternal* internal = this->Internal;
+  if (!internal->IsOpen)
+  {
+    return false;
+  }
+  internal->IsOpen = false;
+
+  // the last row groups are written once encoded
+  {
+    boost::unique_lock<boost::mutex> lock(internal->Mutex);
+    internal->Dispatch(lock);
+    internal->IsClosing = true;
+    internal->RowGroupQueued.notify_all();
+    while (!internal->HasFailed && internal->NextWrite < internal->NextRowGroup)
+    {
+      internal->WriteEncoded(lock);
+      if (internal->NextWrite < internal->NextRowGroup && !internal->HasFailed)
+      {
+        internal->RowGroupEncoded.wait(lock);
+      }
+    }
+    internal->Queue.clear();
+    internal->Encoded.clear();
+    internal->PendingFrames.clear();
+  }
+  internal->Threads.join_all();
+
+  if (internal->HasFailed)
+  {
+    internal->Stream.close();
+    return false;
+  }
+  return internal->WriteFooter();
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarParquetWriter::WriteFrames(vtkLidarReader* reader, int firstFrame, int lastFrame,
+  const std::string& fileName, const ProgressCallback& progress)
+{
+  if (!reader || !this->Open(fileName))
+  {
+    return false;
+  }
+  const double numberOfFrames = std::max(lastFrame - firstFrame + 1, 1);
+  int numberOfAddedFrames = 0;
+  const bool isComplete = reader->GetFrames(firstFrame, lastFrame, [&](int frame, vtkPolyData* data) {
+    if (!this->AddFrame(frame, data))
+    {
+      return false;
+    }
+    return !progress || progress(++numberOfAddedFrames / numberOfFrames);
+  });
+  return this->Close() && isComplete;
+}
@@ -0,0 +1,121 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef VTK_LIDAR_PARQUET_WRITER_H
+#define VTK_LIDAR_PARQUET_WRITER_H
+
+// STD
+#include <string>
+#include <vector>
+
+// VTK
+#include <vtkSystemIncludes.h>
+
+// BOOST
+#include <boost/function.hpp>
+
+class vtkLidarReader;
+class vtkPolyData;
+
+/**
+ * @brief vtkLidarParquetWriter write decoded frames in a Parquet file, a row per point, for the
+ * tools loading the points in column stores.
+ *
+ * The columns are the coordinates (x, y and z), each component of the point data arrays of the
+ * frames, such as the intensity, the laser id, the azimuth, the distance, the time and the dual
+ * return flags, and the number of the frame of each point. The schema is the one of the first
+ * frame, the columns missing in a later frame are filled with zeros.
+ *
+ * Each row group holds FramesPerRowGroup frames. The row groups are encoded in parallel by
+ * NumberOfThreads threads, then written in order. In each row group, a column whose values
+ * take few distinct values, such as the small integers, the frame number or the vertical
+ * angles, is dictionary encoded with its indices bit packed and run length encoded. The other
+ * columns are written plain, the pages are not compressed.
+ */
+class VTK_EXPORT vtkLidarParquetWriter
+{
+public:
+  /**
+   * @brief ProgressCallback receive the progress of WriteFrames, between 0 and 1
+   * @return false to abort the export
+   */
+  typedef boost::function<bool(double progress)> ProgressCallback;
+
+  vtkLidarParquetWriter();
+  ~vtkLidarParquetWriter();
+
+  /// Set the columns to write, "Points" for the coordinates or the name of a point data
+  /// array. All of them are written when this is empty, the frame number always is
+  void SetColumns(const std::vector<std::string>& columns) { this->Columns = columns; }
+  const std::vector<std::string>& GetColumns() const { return this->Columns; }
+
+  /// Set the number of encoding threads, 0 uses one thread per core
+  void SetNumberOfThreads(int numberOfThreads) { this->NumberOfThreads = numberOfThreads; }
+  int GetNumberOfThreads() const { return this->NumberOfThreads; }
+
+  /// Set the number of frames of each row group, 10 by default
+  void SetFramesPerRowGroup(int numberOfFrames) { this->FramesPerRowGroup = numberOfFrames; }
+  int GetFramesPerRowGroup() const { return this->FramesPerRowGroup; }
+
+  /// Set the largest dictionary of a column of a row group, 65536 values by default. The
+  /// columns with more distinct values are written plain
+  void SetMaximumDictionarySize(int size) { this->MaximumDictionarySize = size; }
+  int GetMaximumDictionarySize() const { return this->MaximumDictionarySize; }
+
+  /**
+   * @brief Open create the file, the frames are then given with AddFrame
+   * @return false if the file cannot be created
+   */
+  bool Open(const std::string& fileName);
+
+  /**
+   * @brief AddFrame add the points of a frame to the file, they are written when the row group
+   * is complete. The frame is kept until then and must not be modified.
+   * @return false if the file is not open or a row group could not be written
+   */
+  bool AddFrame(int frameNumber, vtkPolyData* frame);
+
+  /**
+   * @brief Close write the last row group and the footer of the file
+   * @return false if the file is not complete
+   */
+  bool Close();
+
+  /**
+   * @brief WriteFrames write a range of frames of a reader, decoded by the threads of
+   * vtkLidarReader::GetFrames, in a new file
+   * @param lastFrame last frame to write, this frame is included
+   * @return false if the export has been aborted or the file could not be written
+   */
+  bool WriteFrames(vtkLidarReader* reader, int firstFrame, int lastFrame,
+    const std::string& fileName, const ProgressCallback& progress = ProgressCallback());
+
+private:
+  vtkLidarParquetWriter(const vtkLidarParquetWriter&) = delete;
+  void operator=(const vtkLidarParquetWriter&) = delete;
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+  std::vector<std::string> Columns;
+  int NumberOfThreads = 0;
+  int FramesPerRowGroup = 10;
+  int MaximumDictionarySize = 65536;
+};
+
+#endif // VTK_LIDAR_PARQUET_WRITER_H
@@ -0,0 +1,646 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// LOCAL
+#include "vtkLidarPointCloudFile.h"
+#include "LidarDecodingKernels.h"
+
+// STD
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// VTK
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+
+// BOOST
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace
+{
+//! Points interleaved in a buffer before it is written
+const vtkIdType PointsPerBlock = 65536;
+
+//-----------------------------------------------------------------------------
+//! Field of the records of the file, some components of an array of the frame
+struct Field
+{
+  std::string Name;
+  vtkDataArray* Array;
+  int FirstComponent;
+  int Count;
+  //! type of the values in the file
+  int DataType;
+  int Size;
+  size_t Offset;
+};
+
+//-----------------------------------------------------------------------------
+bool IsLittleEndian()
+{
+  const unsigned short one = 1;
+  return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+//-----------------------------------------------------------------------------
+//! PCD type letter of a VTK type, 0 for the types which cannot be written
+char GetPCDType(int dataType)
+{
+  switch (dataType)
+  {
+    case VTK_FLOAT:
+    case VTK_DOUBLE:
+      return 'F';
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR:
+    case VTK_SHORT:
+    case VTK_INT:
+    case VTK_LONG:
+    case VTK_LONG_LONG:
+    case VTK_ID_TYPE:
+      return 'I';
+    case VTK_UNSIGNED_CHAR:
+    case VTK_UNSIGNED_SHORT:
+    case VTK_UNSIGNED_INT:
+    case VTK_UNSIGNED_LONG:
+    case VTK_UNSIGNED_LONG_LONG:
+      return 'U';
+    default:
+      return 0;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! VTK type of a PCD field, -1 if it is not supported
+int GetVTKType(char type, int size)
+{
+  switch (type)
+  {
+    case 'F':
+      return size == 4 ? VTK_FLOAT : size == 8 ? VTK_DOUBLE : -1;
+    case 'I':
+      return size == 1 ? VTK_SIGNED_CHAR : size == 2 ? VTK_SHORT : size == 4 ? VTK_INT
+        : size == 8 ? VTK_LONG_LONG : -1;
+    case 'U':
+      return size == 1 ? VTK_UNSIGNED_CHAR : size == 2 ? VTK_UNSIGNED_SHORT
+        : size == 4 ? VTK_UNSIGNED_INT : size == 8 ? VTK_UNSIGNED_LONG_LONG : -1;
+    default:
+      return -1;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! PLY name of the 4 bytes or smaller types, and of the floating point ones
+const char* GetPLYType(int dataType)
+{
+  switch (dataType)
+  {
+    case VTK_FLOAT: return "float";
+    case VTK_DOUBLE: return "double";
+    case VTK_SIGNED_CHAR: return "char";
+    case VTK_UNSIGNED_CHAR: return "uchar";
+    case VTK_SHORT: return "short";
+    case VTK_UNSIGNED_SHORT: return "ushort";
+    case VTK_INT: return "int";
+    case VTK_UNSIGNED_INT: return "uint";
+    default: return nullptr;
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! VTK type of a PLY property, -1 if it is not supported
+int GetVTKType(const std::string& type)
+{
+  static const std::pair<const char*, int> types[] = { { "char", VTK_SIGNED_CHAR },
+    { "int8", VTK_SIGNED_CHAR }, { "uchar", VTK_UNSIGNED_CHAR }, { "uint8", VTK_UNSIGNED_CHAR },
+    { "short", VTK_SHORT }, { "int16", VTK_SHORT }, { "ushort", VTK_UNSIGNED_SHORT },
+    { "uint16", VTK_UNSIGNED_SHORT }, { "int", VTK_INT }, { "int32", VTK_INT },
+    { "uint", VTK_UNSIGNED_INT }, { "uint32", VTK_UNSIGNED_INT }, { "float", VTK_FLOAT },
+    { "float32", VTK_FLOAT }, { "double", VTK_DOUBLE }, { "float64", VTK_DOUBLE } };
+  for (const auto& entry : types)
+  {
+    if (type == entry.first)
+    {
+      return entry.second;
+    }
+  }
+  return -1;
+}
+
+//-----------------------------------------------------------------------------
+//! Type of the values of a field in the file: the integers are stored with a type of the same
+//! size and signedness, the 64 bits ones as doubles in a PLY file
+int GetFileType(int dataType, bool isPLY)
+{
+  if (dataType == VTK_FLOAT || dataType == VTK_DOUBLE)
+  {
+    return dataType;
+  }
+  const bool isSigned = GetPCDType(dataType) == 'I';
+  switch (vtkDataArray::GetDataTypeSize(dataType))
+  {
+    case 1:
+      return isSigned ? VTK_SIGNED_CHAR : VTK_UNSIGNED_CHAR;
+    case 2:
+      return isSigned ? VTK_SHORT : VTK_UNSIGNED_SHORT;
+    case 4:
+      return isSigned ? VTK_INT : VTK_UNSIGNED_INT;
+    default:
+      return isPLY ? VTK_DOUBLE : isSigned ? VTK_LONG_LONG : VTK_UNSIGNED_LONG_LONG;
+  }
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+void StoreAs(double value, char* destination)
+{
+  const T converted = static_cast<T>(value);
+  std::memcpy(destination, &converted, sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+template<typename T>
+double LoadAs(const char* source)
+{
+  T value;
+  std::memcpy(&value, source, sizeof(T));
+  return static_cast<double>(value);
+}
+
+//-----------------------------------------------------------------------------
+void StoreValue(double value, int dataType, char* destination)
+{
+  switch (dataType)
+  {
+    vtkTemplateMacro(StoreAs<VTK_TT>(value, destination));
+  }
+}
+
+//-----------------------------------------------------------------------------
+double LoadValue(int dataType, const char* source)
+{
+  switch (dataType)
+  {
+    vtkTemplateMacro(return LoadAs<VTK_TT>(source));
+  }
+  return 0.;
+}
+
+//-----------------------------------------------------------------------------
+//! Name of a field without the spaces, which separate the fields in the headers
+std::string GetFieldName(const std::string& name)
+{
+  std::string fieldName = name.empty() ? "_unnamed" : name;
+  std::replace(fieldName.begin(), fieldName.end(), ' ', '_');
+  return fieldName;
+}
+
+//-----------------------------------------------------------------------------
+//! Copy the fields of the points [begin, end[ in consecutive records
+void Interleave(const std::vector<Field>& fields, size_t recordSize, vtkIdType begin,
+  vtkIdType end, char* records)
+{
+  for (const Field& field : fields)
+  {
+    const int numberOfComponents = field.Array->GetNumberOfComponents();
+    char* destination = records + field.Offset;
+    if (field.Array->HasStandardMemoryLayout() && field.DataType == field.Array->GetDataType())
+    {
+      // the values are copied as they are
+      const size_t tupleSize = numberOfComponents * field.Size;
+      const char* source = static_cast<const char*>(field.Array->GetVoidPointer(0)) +
+        begin * tupleSize + field.FirstComponent * field.Size;
+      for (vtkIdType i = begin; i < end; ++i, source += tupleSize, destination += recordSize)
+      {
+        std::memcpy(destination, source, field.Count * field.Size);
+      }
+      continue;
+    }
+    for (vtkIdType i = begin; i < end; ++i, destination += recordSize)
+    {
+      for (int c = 0; c < field.Count; ++c)
+      {
+        StoreValue(field.Array->GetComponent(i, field.FirstComponent + c), field.DataType,
+          destination + c * field.Size);
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+//! Read the next line of the header, false at the end of the file
+bool ReadLine(const char*& position, const char* end, std::string& line)
+{
+  if (position >= end)
+  {
+    return false;
+  }
+  const char* lineEnd = std::find(position, end, '\n');
+  line.assign(position, lineEnd);
+  if (!line.empty() && line.back() == '\r')
+  {
+    line.pop_back();
+  }
+  position = lineEnd == end ? end : lineEnd + 1;
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//! Parse the header of a PCD file, position is moved to the binary data
+bool ReadPCDHeader(const char*& position, const char* end, std::vector<Field>& fields,
+  vtkIdType& numberOfPoints, std::string& error)
+{
+  std::vector<std::string> names, types;
+  std::vector<int> sizes, counts;
+  numberOfPoints = -1;
+  std::string line;
+  while (ReadLine(position, end, line))
+  {
+    std::istringstream stream(line);
+    std::string key;
+    if (!(stream >> key) || key[0] == '#')
+    {
+      continue;
+    }
+    std::string value;
+    if (key == "FIELDS" || key == "TYPE")
+    {
+      std::vector<std::string>& values = key == "FIELDS" ? names : types;
+      while (stream >> value)
+      {
+        values.push_back(value);
+      }
+    }
+    else if (key == "SIZE" || key == "COUNT")
+    {
+      std::vector<int>& values = key == "SIZE" ? sizes : counts;
+      int number;
+      while (stream >> number)
+      {
+        values.push_back(number);
+      }
+    }
+    else if (key == "POINTS")
+    {
+      stream >> numberOfPoints;
+    }
+    else if (key == "DATA")
+    {
+      stream >> value;
+      if (value != "binary")
+      {
+        error = "Only the binary PCD files are read, not " + value;
+        return false;
+      }
+      break;
+    }
+  }
+  if (counts.empty())
+  {
+    counts.assign(names.size(), 1);
+  }
+  if (line.compare(0, 4, "DATA") != 0 || names.empty() || sizes.size() != names.size() ||
+    types.size() != names.size() || counts.size() != names.size() || numberOfPoints < 0)
+  {
+    error = "Invalid PCD header";
+    return false;
+  }
+
+  size_t offset = 0;
+  for (size_t i = 0; i < names.size(); ++i)
+  {
+    const int dataType = GetVTKType(types[i].empty() ? 0 : types[i][0], sizes[i]);
+    if (dataType < 0 || counts[i] <= 0)
+    {
+      error = "Unsupported PCD field " + names[i];
+      return false;
+    }
+    fields.push_back({ names[i], nullptr, 0, counts[i], dataType, sizes[i], offset });
+    offset += static_cast<size_t>(counts[i]) * sizes[i];
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+//! Parse the header of a PLY file, position is moved to the binary data of the vertices
+bool ReadPLYHeader(const char*& position, const char* end, std::vector<Field>& fields,
+  vtkIdType& numberOfPoints, std::string& error)
+{
+  numberOfPoints = -1;
+  bool isVertex = false;
+  bool isBinary = false;
+  size_t offset = 0;
+  std::string line;
+  while (ReadLine(position, end, line))
+  {
+    std::istringstream stream(line);
+    std::string key;
+    stream >> key;
+    if (key == "format")
+    {
+      std::string format;
+      stream >> format;
+      isBinary = format == (IsLittleEndian() ? "binary_little_endian" : "binary_big_endian");
+      if (!isBinary)
+      {
+        error = "Only the binary PLY files in the byte order of the machine are read, not " + format;
+        return false;
+      }
+    }
+    else if (key == "element")
+    {
+      // the vertices must come first for their data to be at the start, the other elements
+      // are ignored
+      std::string name;
+      vtkIdType count = 0;
+      stream >> name >> count;
+      isVertex = name == "vertex" && numberOfPoints < 0;
+      if (isVertex)
+      {
+        numberOfPoints = count;
+      }
+      else if (numberOfPoints < 0 && count > 0)
+      {
+        error = "The vertices are not the first element of the PLY file";
+        return false;
+      }
+    }
+    else if (key == "property" && isVertex)
+    {
+      std::string type, name;
+      stream >> type >> name;
+      const int dataType = GetVTKType(type);
+      if (dataType < 0)
+      {
+        error = "Unsupported PLY vertex property " + line;
+        return false;
+      }
+      fields.push_back({ name, nullptr, 0, 1, dataType, vtkDataArray::GetDataTypeSize(dataType), offset });
+      offset += fields.back().Size;
+    }
+    else if (key == "end_header")
+    {
+      break;
+    }
+  }
+  if (line != "end_header" || !isBinary || numberOfPoints < 0 || fields.empty())
+  {
+    error = "Invalid PLY header";
+    return false;
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+bool vtkLidarPointCloudFile::Write(vtkPolyData* frame, const std::string& fileName) const
+{
+  std::ofstream stream(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!stream.is_open() || !frame)
+  {
+    return false;
+  }
+  const bool isPLY = this->OutputFormat == PLY;
+
+  // the coordinates, then the point data arrays
+  std::vector<Field> fields;
+  vtkDataArray* coordinates = frame->GetPoints() ? frame->GetPoints()->GetData() : nullptr;
+  const vtkIdType numberOfPoints = coordinates ? frame->GetNumberOfPoints() : 0;
+  const int coordinatesType = coordinates ? GetFileType(coordinates->GetDataType(), isPLY) : VTK_FLOAT;
+  const char* axes[3] = { "x", "y", "z" };
+  for (int i = 0; i < 3; ++i)
+  {
+    fields.push_back({ axes[i], coordinates, i, 1, coordinatesType, 0, 0 });
+  }
+  vtkPointData* pointData = frame->GetPointData();
+  for (int arrayIndex = 0; arrayIndex < pointData->GetNumberOfArrays(); ++arrayIndex)
+  {
+    vtkDataArray* array = pointData->GetArray(arrayIndex);
+    if (!array || !GetPCDType(array->GetDataType()) || array->GetNumberOfTuples() < numberOfPoints)
+    {
+      continue;
+    }
+    const std::string name = array->GetName() ? array->GetName() : "";
+    if (!this->Columns.empty() &&
+      std::find(this->Columns.begin(), this->Columns.end(), name) == this->Columns.end())
+    {
+      continue;
+    }
+    const int dataType = GetFileType(array->GetDataType(), isPLY);
+    const int numberOfComponents = array->GetNumberOfComponents();
+    if (!isPLY || numberOfComponents == 1)
+    {
+      fields.push_back({ GetFieldName(name), array, 0, numberOfComponents, dataType, 0, 0 });
+      continue;
+    }
+    for (int component = 0; component < numberOfComponents; ++component)
+    {
+      fields.push_back({ GetFieldName(name) + "_" + std::to_string(component), array, component,
+        1, dataType, 0, 0 });
+    }
+  }
+  size_t recordSize = 0;
+  for (Field& field : fields)
+  {
+    field.Size = vtkDataArray::GetDataTypeSize(field.DataType);
+    field.Offset = recordSize;
+    recordSize += static_cast<size_t>(field.Count) * field.Size;
+  }
+
+  std::ostringstream header;
+  if (isPLY)
+  {
+    header << "ply\nformat " << (IsLittleEndian() ? "binary_little_endian" : "binary_big_endian")
+           << " 1.0\nelement vertex " << numberOfPoints << "\n";
+    for (const Field& field : fields)
+    {
+      header << "property " << GetPLYType(field.DataType) << " " << field.Name << "\n";
+    }
+    header << "end_header\n";
+  }
+  else
+  {
+    header << "# .PCD v0.7 - Point Cloud Data file format\nVERSION 0.7\nFIELDS";
+    for (const Field& field : fields)
+    {
+      header << " " << field.Name;
+    }
+    header << "\nSIZE";
+    for (const Field& field : fields)
+    {
+      header << " " << field.Size;
+    }
+    header << "\nTYPE";
+    for (const Field& field : fields)
+    {
+      header << " " << GetPCDType(field.DataType);
+    }
+    header << "\nCOUNT";
+    for (const Field& field : fields)
+    {
+      header << " " << field.Count;
+    }
+    header << "\nWIDTH " << numberOfPoints << "\nHEIGHT 1\nVIEWPOINT 0 0 0 1 0 0 0\nPOINTS "
+           << numberOfPoints << "\nDATA binary\n";
+  }
+  const std::string headerText = header.str();
+  stream.write(headerText.data(), headerText.size());
+
+  // the records are interleaved by blocks so that the memory used does not depend on the frame
+  std::vector<char> buffer(std::min(numberOfPoints, PointsPerBlock) * recordSize);
+  for (vtkIdType begin = 0; begin < numberOfPoints && stream; begin += PointsPerBlock)
+  {
+    const vtkIdType end = std::min(begin + PointsPerBlock, numberOfPoints);
+    Interleave(fields, recordSize, begin, end, buffer.data());
+    stream.write(buffer.data(), (end - begin) * recordSize);
+  }
+  return static_cast<bool>(stream);
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> vtkLidarPointCloudFile::Read(const std::string& fileName, std::string* error)
+{
+  std::string message;
+  auto fail = [&](const std::string& reason) {
+    if (error)
+    {
+      *error = reason;
+    }
+    return vtkSmartPointer<vtkPolyData>();
+  };
+
+  boost::iostreams::mapped_file_source file;
+  try
+  {
+    file.open(fileName);
+  }
+  catch (const std::exception& e)
+  {
+    return fail("Cannot open " + fileName + ": " + e.what());
+  }
+  if (!file.is_open())
+  {
+    return fail("Cannot open " + fileName);
+  }
+  const char* position = file.data();
+  const char* end = file.data() + file.size();
+
+  std::vector<Field> fields;
+  vtkIdType numberOfPoints = 0;
+  const bool isPLY = file.size() >= 4 && std::strncmp(position, "ply", 3) == 0 &&
+    (position[3] == '\n' || position[3] == '\r');
+  if (!(isPLY ? ReadPLYHeader : ReadPCDHeader)(position, end, fields, numberOfPoints, message))
+  {
+    return fail(message);
+  }
+  size_t recordSize = 0;
+  for (const Field& field : fields)
+  {
+    recordSize += static_cast<size_t>(field.Count) * field.Size;
+  }
+  // compared by division, a huge number of points in the header could overflow the product
+  if (recordSize > 0 &&
+    static_cast<size_t>(numberOfPoints) > static_cast<size_t>(end - position) / recordSize)
+  {
+    return fail(fileName + " is truncated");
+  }
+
+  // the coordinates keep their type when the three of them are float or double
+  const Field* axes[3] = { nullptr, nullptr, nullptr };
+  for (const Field& field : fields)
+  {
+    for (int i = 0; i < 3; ++i)
+    {
+      if (field.Name == std::string(1, static_cast<char>('x' + i)) && field.Count == 1)
+      {
+        axes[i] = &field;
+      }
+    }
+  }
+  if (!axes[0] || !axes[1] || !axes[2])
+  {
+    return fail(fileName + " has no x, y and z fields");
+  }
+  int pointsType = axes[0]->DataType;
+  if ((pointsType != VTK_FLOAT && pointsType != VTK_DOUBLE) ||
+    axes[1]->DataType != pointsType || axes[2]->DataType != pointsType)
+  {
+    pointsType = VTK_DOUBLE;
+  }
+
+  auto polyData = vtkSmartPointer<vtkPolyData>::New();
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataType(pointsType);
+  points->SetNumberOfPoints(numberOfPoints);
+  polyData->SetPoints(points);
+  polyData->SetVerts(NewVertexCells(numberOfPoints));
+
+  for (const Field& field : fields)
+  {
+    const auto axis = std::find(axes, axes + 3, &field);
+    if (axis == axes + 3 && field.Name == "_")
+    {
+      // padding of the PCL points
+      continue;
+    }
+    vtkDataArray* array = nullptr;
+    int firstComponent = 0;
+    if (axis != axes + 3)
+    {
+      array = points->GetData();
+      firstComponent = static_cast<int>(axis - axes);
+    }
+    else
+    {
+      vtkSmartPointer<vtkDataArray> newArray;
+      newArray.TakeReference(vtkDataArray::CreateDataArray(field.DataType));
+      newArray->SetName(field.Name.c_str());
+      newArray->SetNumberOfComponents(field.Count);
+      newArray->SetNumberOfTuples(numberOfPoints);
+      polyData->GetPointData()->AddArray(newArray);
+      array = newArray;
+    }
+
+    // the values are copied from the mapped records to the array
+    const int numberOfComponents = array->GetNumberOfComponents();
+    const char* source = position + field.Offset;
+    if (array->GetDataType() == field.DataType)
+    {
+      const size_t tupleSize = numberOfComponents * field.Size;
+      char* destination = static_cast<char*>(array->GetVoidPointer(0)) + firstComponent * field.Size;
+      for (vtkIdType i = 0; i < numberOfPoints; ++i, source += recordSize, destination += tupleSize)
+      {
+        std::memcpy(destination, source, field.Count * field.Size);
+      }
+      continue;
+    }
+    for (vtkIdType i = 0; i < numberOfPoints; ++i, source += recordSize)
+    {
+      for (int c = 0; c < field.Count; ++c)
+      {
+        array->SetComponent(i, firstComponent + c, LoadValue(field.DataType, source + c * field.Size));
+      }
+    }
+  }
+  return polyData;
+}
@@ -0,0 +1,83 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+#ifndef VTK_LIDAR_POINT_CLOUD_FILE_H
+#define VTK_LIDAR_POINT_CLOUD_FILE_H
+
+// STD
+#include <string>
+#include <vector>
+
+// VTK
+#include <vtkSmartPointer.h>
+#include <vtkSystemIncludes.h>
+
+class vtkPolyData;
+
+/**
+ * @brief vtkLidarPointCloudFile write the points of a frame as a binary PCD or PLY file, and
+ * read such files back, without going through a pcl::PointCloud.
+ *
+ * The coordinates are written as the x, y and z fields, with the type of the points, then each
+ * numeric point data array as a field of the same type, its components being a PCD field with
+ * a count or PLY properties suffixed by _0, _1, ... The records are interleaved from the
+ * arrays of the frame in large buffers. A PLY file has no 64 bits integers, these arrays are
+ * written as doubles.
+ *
+ * Reading maps the file in memory and de-interleaves the records directly in the VTK arrays,
+ * only the files with binary data in the byte order of the machine are read.
+ */
+class VTK_EXPORT vtkLidarPointCloudFile
+{
+public:
+  enum Format
+  {
+    PCD = 0,
+    PLY = 1
+  };
+
+  /// Set the format of the written files, PCD by default
+  void SetFormat(int format) { this->OutputFormat = format; }
+  int GetFormat() const { return this->OutputFormat; }
+
+  /// Set the point data arrays to write, all of them when this is empty. The coordinates
+  /// are always written
+  void SetColumns(const std::vector<std::string>& columns) { this->Columns = columns; }
+  const std::vector<std::string>& GetColumns() const { return this->Columns; }
+
+  /**
+   * @brief Write a frame, this may be called by several threads at the same time
+   * @return false if the file cannot be written
+   */
+  bool Write(vtkPolyData* frame, const std::string& fileName) const;
+
+  /**
+   * @brief Read a binary PCD or PLY file, the format is given by the first line of the file
+   * @param fileName the file to read
+   * @param error[out] reason of the failure, may be null
+   * @return the points and the fields other than x, y and z as point data arrays, null if
+   * the file is not a binary PCD or PLY file which can be read
+   */
+  static vtkSmartPointer<vtkPolyData> Read(const std::string& fileName, std::string* error = nullptr);
+
+private:
+  int OutputFormat = PCD;
+  std::vector<std::string> Columns;
+};
+
+#endif // VTK_LIDAR_POINT_CLOUD_FILE_H
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "vtkTemporalTransformsReader.h"
+#include "TraceEvents.h"
 
 #include <vtkAbstractArray.h>
 #include <vtkDelimitedTextReader.h>
@@ -27,8 +28,10 @@
 
 #include <Eigen/Geometry>
 
+#include <limits>
 #include <unordered_map>
 
+#include "TemporalTransformsFile.h"
 #include "vtkTemporalTransforms.h"
 
 namespace {
@@ -106,12 +109,39 @@ int vtkTemporalTransformsReader::RequestData(vtkInformation* vtkNotUsed(request)
                         vtkInformationVector** vtkNotUsed(inputVector),
                         vtkInformationVector* outputVector)
 {
+  VV_TRACE_SCOPE("vtkTemporalTransformsReader::RequestData");
   if (!this->FileName)
   {
     vtkErrorMacro(<< "Please select the file to read")
     return 1;
   }
 
+  const double tstart = this->UseTimeWindow ? this->TimeWindow[0] : -std::numeric_limits<double>::infinity();
+  const double tend = this->UseTimeWindow ? this->TimeWindow[1] : std::numeric_limits<double>::infinity();
+
+  // Binary trajectory: only the chunks of the time window are read
+  if (TemporalTransformsFile::IsTemporalTransformsFile(this->FileName))
+  {
+    TemporalTransformsFile file;
+    vtkSmartPointer<vtkTemporalTransforms> trajectory;
+    if (file.Open(this->FileName))
+    {
+      trajectory = file.Read(tstart - this->TimeOffset, tend - this->TimeOffset);
+    }
+    if (!trajectory)
+    {
+      vtkErrorMacro(<< file.GetLastError())
+      return 1;
+    }
+    vtkDataArray* time = trajectory->GetTimeArray();
+    for (vtkIdType i = 0; i < time->GetNumberOfTuples(); i++)
+    {
+      time->SetTuple1(i, time->GetTuple1(i) + this->TimeOffset);
+    }
+    vtkPolyData::GetData(outputVector)->ShallowCopy(trajectory);
+    return 1;
+  }
+
   // Read the data from the file
   vtkNew<vtkDelimitedTextReader> csvReader;
   csvReader->SetFileName(this->FileName);
@@ -151,11 +181,17 @@ int vtkTemporalTransformsReader::RequestData(vtkInformation* vtkNotUsed(request)
   // Read the data from the csv table
   for (vtkIdType i = 0; i < table->GetNumberOfRows(); i++)
   {
+    double time = array["time"]->GetTuple1(i) + this->TimeOffset;
+    if (time < tstart || time > tend)
+    {
+      continue;
+    }
+
     translation->InsertNextTuple3(array["X"]->GetTuple1(i),
                                   array["Y"]->GetTuple1(i),
                                   array["Z"]->GetTuple1(i));
 
-    timstamp->InsertNextValue(array["time"]->GetTuple1(i) + this->TimeOffset);
+    timstamp->InsertNextValue(time);
 
     // Assumption: roll, pitch and yaw are in degree
     double roll  = array["roll"]->GetTuple1(i);
@@ -195,3 +231,15 @@ vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransformsReader::OpenTemporal
   auto temporalTransform1 = reader1->GetOutput();
   return vtkTemporalTransforms::CreateFromPolyData(temporalTransform1);
 }
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkTemporalTransforms> vtkTemporalTransformsReader::OpenTemporalTransforms(const std::string& filename,
+                                                                                           double tstart, double tend)
+{
+  auto reader = vtkSmartPointer<vtkTemporalTransformsReader>::New();
+  reader->SetFileName(filename.c_str());
+  reader->SetUseTimeWindow(true);
+  reader->SetTimeWindow(tstart, tend);
+  reader->Update();
+  return vtkTemporalTransforms::CreateFromPolyData(reader->GetOutput());
+}
@@ -37,6 +37,10 @@
  * - yaw   : expresses the sensor rotation around the Z axis and is in degree
  * - the rotation matrix can be recomposed this way: R = Rz(z)*Ry(y)*Rx(x)
  *
+ * The binary trajectories written by vtkTemporalTransformsWriter in a ".tposes" file
+ * are also read, see TemporalTransformsFile. Only the chunks of the time window are
+ * then read, which is much faster than reading a whole CSV trajectory.
+ *
  * Remark: if you get from VeloView UI the error:
  * "vtkSIProxyDefinitionManager: No proxy that matches: group= and proxy= were found."
  * when you tried to open a file with a ".csv" extension and was asked to chose
@@ -53,6 +57,10 @@ public:
 
   static vtkSmartPointer<vtkTemporalTransforms> OpenTemporalTransforms(const std::string& filename);
 
+  /// Read the transforms of a file whose time is between tstart and tend, both included
+  static vtkSmartPointer<vtkTemporalTransforms> OpenTemporalTransforms(const std::string& filename,
+                                                                       double tstart, double tend);
+
   //@{
   /**
    * @copydoc vtkTemporalTransformsReader::TimeOffset
@@ -61,6 +69,22 @@ public:
   vtkSetMacro(TimeOffset, double)
   //@}
 
+  //@{
+  /**
+   * @copydoc vtkTemporalTransformsReader::UseTimeWindow
+   */
+  vtkGetMacro(UseTimeWindow, bool)
+  vtkSetMacro(UseTimeWindow, bool)
+  //@}
+
+  //@{
+  /**
+   * @copydoc vtkTemporalTransformsReader::TimeWindow
+   */
+  vtkGetVector2Macro(TimeWindow, double)
+  vtkSetVector2Macro(TimeWindow, double)
+  //@}
+
 protected:
   vtkTemporalTransformsReader();
 
@@ -76,6 +100,12 @@ private:
   //! TimeOffset in seconds relative to the system clock
   double TimeOffset = 0.0;
 
+  //! Only read the transforms of TimeWindow
+  bool UseTimeWindow = false;
+
+  //! First and last times of the transforms to read, in seconds, TimeOffset included
+  double TimeWindow[2] = {0.0, 0.0};
+
   vtkTemporalTransformsReader(const vtkTemporalTransformsReader&) = delete;
   void operator =(const vtkTemporalTransformsReader&) = delete;
 
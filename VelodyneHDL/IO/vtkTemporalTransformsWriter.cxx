@@ -1,5 +1,7 @@
+#include "TemporalTransformsFile.h"
 #include "vtkTemporalTransforms.h"
 #include "vtkTemporalTransformsWriter.h"
+#include "TraceEvents.h"
 
 #include "vtkTransform.h"
 #include "vtkNew.h"
@@ -27,6 +29,7 @@ int vtkTemporalTransformsWriter::RequestData(vtkInformation *vtkNotUsed(request)
                                              vtkInformationVector **inputVector,
                                              vtkInformationVector *vtkNotUsed(outputVector))
 {
+  VV_TRACE_SCOPE("vtkTemporalTransformsWriter::RequestData");
   vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
   vtkPolyData *polyData = vtkPolyData::SafeDownCast(
   inInfo->Get(vtkDataObject::DATA_OBJECT()));
@@ -44,6 +47,19 @@ int vtkTemporalTransformsWriter::RequestData(vtkInformation *vtkNotUsed(request)
     return 0;
   }
 
+  // Binary trajectory, the transforms are saved without conversion
+  const std::string fileName = this->FileName ? this->FileName : "";
+  if (fileName.size() >= 7 && fileName.compare(fileName.size() - 7, 7, ".tposes") == 0)
+  {
+    TemporalTransformsFileWriter writer;
+    if (!writer.Open(fileName) || !writer.Write(transforms) || !writer.Close())
+    {
+      vtkErrorMacro(<< writer.GetLastError());
+      return 0;
+    }
+    return 1;
+  }
+
   vtkDataArray* time = transforms->GetTimeArray();
 
   std::ofstream file(this->FileName);
@@ -19,6 +19,8 @@
 #include <vtkPolyDataWriter.h>
 
 // Inspired by vtkObjWriter
+// A file name ending with .tposes is written in the binary format of
+// TemporalTransformsFileWriter instead of CSV
 class VTK_EXPORT vtkTemporalTransformsWriter : public vtkPolyDataWriter
 {
 public:
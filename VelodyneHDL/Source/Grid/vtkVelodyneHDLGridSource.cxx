@@ -27,6 +27,7 @@
 =========================================================================*/
 
 #include "vtkVelodyneHDLGridSource.h"
+#include "TraceEvents.h"
 
 #include "vtkAppendPolyData.h"
 #include "vtkArcSource.h"
@@ -118,6 +119,7 @@ int vtkVelodyneHDLGridSource::RequestData(vtkInformation* vtkNotUsed(request),
                                           vtkInformationVector** vtkNotUsed(inputVector),
                                           vtkInformationVector* outputVector)
 {
+  VV_TRACE_SCOPE("vtkVelodyneHDLGridSource::RequestData");
   vtkPolyData* output = vtkPolyData::GetData(outputVector);
 
   if (this->GridNbTicks < 1)
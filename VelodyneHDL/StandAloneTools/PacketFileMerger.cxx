@@ -0,0 +1,534 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// .NAME PacketFileMerger -
+// .SECTION Description
+// This program merges the captures of several loggers into a single capture sorted by time,
+// and splits a capture by sensor or by time window:
+//
+//   PacketFileMerger a.pcap b.pcapng --output merged.pcap
+//   PacketFileMerger merged.pcap --output sensor.pcap --split-by-source --split-duration 60
+//
+// The inputs are read through their memory mapping and merged by timestamp, the packets
+// slightly out of order in an input being sorted within --sort-window seconds. Only the UDP
+// packets are kept, they can be filtered by sender (--source ip[:port]), by destination port
+// (--port) and by time (--start and --end, in seconds since the first packet). With
+// --split-by-source each sender is written to <output>_<ip>_<port>.pcap, and with
+// --split-duration the outputs are cut into numbered files of about this duration. The cuts are
+// made where a frame of the first lidar of the output starts, so that each file holds whole
+// frames, the packet where a frame starts being written at the end of the previous file too.
+// The frame index of each output is then saved next to it, so that it opens without being
+// indexed again.
+
+#include "VelodyneFrameDetector.h"
+#include "vtkLidarPacketInterpreter.h"
+#include "vtkLidarReader.h"
+#include "vtkPacketFileReader.h"
+#include "vtkPacketFileWriter.h"
+
+#include <vtkNew.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Sender or receiver of a packet, the address being an IPv4 address in host byte order
+struct Endpoint
+{
+  boost::uint32_t Address = 0;
+  // 0 matches any port in a filter
+  unsigned short Port = 0;
+
+  bool operator<(const Endpoint& other) const
+  {
+    return this->Address < other.Address ||
+      (this->Address == other.Address && this->Port < other.Port);
+  }
+
+  bool operator==(const Endpoint& other) const
+  {
+    return this->Address == other.Address && this->Port == other.Port;
+  }
+
+  bool Matches(const Endpoint& other) const
+  {
+    return this->Address == other.Address && (this->Port == 0 || this->Port == other.Port);
+  }
+
+  std::string ToString(char separator) const
+  {
+    std::stringstream text;
+    text << (this->Address >> 24) << "." << ((this->Address >> 16) & 0xff) << "."
+         << ((this->Address >> 8) & 0xff) << "." << (this->Address & 0xff) << separator
+         << this->Port;
+    return text.str();
+  }
+
+  // Read "a.b.c.d" or "a.b.c.d:port"
+  static bool Parse(const std::string& text, Endpoint& endpoint)
+  {
+    unsigned int bytes[4], port = 0;
+    char end = 0;
+    const int count =
+      std::sscanf(text.c_str(), "%u.%u.%u.%u:%u%c", bytes, bytes + 1, bytes + 2, bytes + 3, &port, &end);
+    if ((count != 4 && count != 5) || port > 65535)
+    {
+      return false;
+    }
+    endpoint.Address = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (bytes[i] > 255)
+      {
+        return false;
+      }
+      endpoint.Address = (endpoint.Address << 8) | bytes[i];
+    }
+    endpoint.Port = static_cast<unsigned short>(port);
+    return true;
+  }
+};
+
+//-----------------------------------------------------------------------------
+// Packet read from an input, its record is copied as the mapping of the input is closed once
+// all its packets are read
+struct Packet
+{
+  // seconds since the epoch
+  double Time = 0;
+  // reading order, which keeps the order of the packets which have the same time
+  size_t Sequence = 0;
+  pcap_pkthdr Header;
+  // captured record, starting with its link layer header
+  std::vector<unsigned char> Record;
+  unsigned int LinkHeaderLength = 0;
+  // UDP payload, in Record
+  unsigned int PayloadOffset = 0;
+  unsigned int PayloadLength = 0;
+  Endpoint Source;
+  Endpoint Destination;
+
+  const unsigned char* GetPayload() const { return this->Record.data() + this->PayloadOffset; }
+};
+
+//-----------------------------------------------------------------------------
+bool IsLater(const Packet& a, const Packet& b)
+{
+  return a.Time > b.Time || (a.Time == b.Time && a.Sequence > b.Sequence);
+}
+
+//-----------------------------------------------------------------------------
+// Merge of the inputs by time. The packets read are kept in a heap, and the first one is given
+// once every input has been read SortWindow seconds past it, which sorts the packets which are
+// out of order by less than SortWindow in their input. The input read next is the one which is
+// the least advanced, so that the heap only holds about SortWindow seconds of packets.
+class PacketMerger
+{
+public:
+  explicit PacketMerger(double sortWindow)
+    : SortWindow(sortWindow)
+  {
+  }
+
+  bool Open(const std::vector<std::string>& filenames)
+  {
+    for (const std::string& filename : filenames)
+    {
+      std::unique_ptr<vtkPacketFileReader> reader(new vtkPacketFileReader);
+      if (!reader->Open(filename, true))
+      {
+        std::cerr << "Failed to open " << filename << ": " << reader->GetLastError() << std::endl;
+        return false;
+      }
+      this->Readers.push_back(std::move(reader));
+      this->LastTimes.push_back(-std::numeric_limits<double>::infinity());
+    }
+    return true;
+  }
+
+  bool Next(Packet& packet)
+  {
+    while (true)
+    {
+      // least advanced input which is not finished
+      size_t input = this->Readers.size();
+      for (size_t i = 0; i < this->Readers.size(); ++i)
+      {
+        if (this->Readers[i] &&
+          (input == this->Readers.size() || this->LastTimes[i] < this->LastTimes[input]))
+        {
+          input = i;
+        }
+      }
+      const bool isSorted = input == this->Readers.size() ||
+        (!this->Heap.empty() &&
+          this->Heap.front().Time + this->SortWindow <= this->LastTimes[input]);
+      if (isSorted)
+      {
+        break;
+      }
+      this->Read(input);
+    }
+
+    if (this->Heap.empty())
+    {
+      return false;
+    }
+    std::pop_heap(this->Heap.begin(), this->Heap.end(), IsLater);
+    packet = std::move(this->Heap.back());
+    this->Heap.pop_back();
+    return true;
+  }
+
+private:
+  // Add the next packet of an input to the heap, the input is forgotten at its end
+  void Read(size_t input)
+  {
+    vtkPacketFileReader& reader = *this->Readers[input];
+    const unsigned char* data = nullptr;
+    unsigned int dataLength = 0;
+    double timeSinceStart = 0;
+    pcap_pkthdr* header = nullptr;
+    unsigned int dataHeaderLength = 0;
+    if (!reader.NextPacket(data, dataLength, timeSinceStart, &header, &dataHeaderLength))
+    {
+      this->Readers[input].reset();
+      return;
+    }
+
+    Packet packet;
+    packet.Header = *header;
+    packet.Time = header->ts.tv_sec + header->ts.tv_usec * 1e-6;
+    packet.Sequence = this->Sequence++;
+    const unsigned char* record = data - dataHeaderLength;
+    packet.Record.assign(record, record + dataHeaderLength + dataLength);
+    packet.Header.caplen = static_cast<boost::uint32_t>(packet.Record.size());
+    packet.LinkHeaderLength = static_cast<unsigned int>(reader.GetPacketIPHeader() - record);
+    packet.PayloadOffset = dataHeaderLength;
+    packet.PayloadLength = dataLength;
+    reader.GetPacketSource(packet.Source.Address, packet.Source.Port);
+    reader.GetPacketDestination(packet.Destination.Address, packet.Destination.Port);
+    this->LastTimes[input] = packet.Time;
+
+    this->Heap.push_back(std::move(packet));
+    std::push_heap(this->Heap.begin(), this->Heap.end(), IsLater);
+  }
+
+  double SortWindow;
+  std::vector<std::unique_ptr<vtkPacketFileReader> > Readers;
+  // time of the last packet read from each input
+  std::vector<double> LastTimes;
+  std::vector<Packet> Heap;
+  size_t Sequence = 0;
+};
+
+//-----------------------------------------------------------------------------
+// Capture written, cut in chunks when the captures are split by time
+struct Output
+{
+  // sender of the packets when the captures are split by sender
+  std::unique_ptr<Endpoint> Source;
+  // index of the chunk being written, -1 when the capture is not split by time
+  int Chunk = -1;
+  // time after which the chunk is cut at the next frame
+  double ChunkEnd = 0;
+  // sender of the first lidar packets written, whose frames give the cuts
+  std::unique_ptr<Endpoint> Lidar;
+  vtkPacketFileWriter Writer;
+};
+
+//-----------------------------------------------------------------------------
+std::string GetOutputFileName(const fs::path& output, const Output& chunk)
+{
+  std::string name = output.stem().string();
+  if (chunk.Source)
+  {
+    name += "_" + chunk.Source->ToString('_');
+  }
+  if (chunk.Chunk >= 0)
+  {
+    char number[16];
+    std::snprintf(number, sizeof(number), "_%04d", chunk.Chunk);
+    name += number;
+  }
+  return (output.parent_path() / (name + output.extension().string())).string();
+}
+
+//-----------------------------------------------------------------------------
+// Write a packet to an output, the records of the captures whose link layer is not Ethernet
+// are given an Ethernet header
+bool WritePacket(Output& output, Packet& packet, std::vector<unsigned char>& buffer)
+{
+  const unsigned int ethernetHeaderLength = 14;
+  if (packet.LinkHeaderLength == ethernetHeaderLength)
+  {
+    return output.Writer.WritePacket(&packet.Header, packet.Record.data());
+  }
+
+  // broadcast destination, null source, IPv4
+  static const unsigned char ethernetHeader[ethernetHeaderLength] = { 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0, 0, 0, 0, 0, 0, 0x08, 0x00 };
+  buffer.assign(ethernetHeader, ethernetHeader + ethernetHeaderLength);
+  buffer.insert(buffer.end(), packet.Record.begin() + packet.LinkHeaderLength, packet.Record.end());
+  pcap_pkthdr header = packet.Header;
+  header.caplen = static_cast<boost::uint32_t>(buffer.size());
+  header.len = header.len - packet.LinkHeaderLength + ethernetHeaderLength;
+  return output.Writer.WritePacket(&header, buffer.data());
+}
+
+//-----------------------------------------------------------------------------
+// Save the frame index of a capture next to it, the interpreter being detected from its packets
+bool SaveFrameIndex(const std::string& fileName)
+{
+  vtkNew<vtkLidarReader> reader;
+  reader->SetFileName(fileName);
+  reader->SetUseFrameIndexFile(true);
+  reader->UpdateInformation();
+  return reader->GetInterpreter() != nullptr;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  bool splitBySource = false;
+  bool noIndex = false;
+
+  // parse the command line options
+  po::options_description visible("Allowed options");
+  visible.add_options()
+      ("help", "produce help message")
+      ("output", po::value<std::string>(), "output capture, the split outputs are named after it")
+      ("source", po::value<std::vector<std::string> >(), "only keep the packets sent by ip[:port], can be repeated")
+      ("port", po::value<std::vector<unsigned int> >(), "only keep the packets sent to this port, can be repeated")
+      ("start", po::value<double>()->default_value(0), "skip the packets before this time, in seconds since the first packet")
+      ("end", po::value<double>()->default_value(-1), "skip the packets after this time, in seconds since the first packet")
+      ("split-by-source", po::bool_switch(&splitBySource), "write the packets of each sender in its own capture")
+      ("split-duration", po::value<double>()->default_value(0), "cut the outputs into captures of this many seconds, on frame boundaries")
+      ("sort-window", po::value<double>()->default_value(1), "sort the packets out of order by less than this many seconds in their input")
+      ("buffer-size", po::value<unsigned int>()->default_value(8), "size of the write buffer of each output, in MiB")
+      ("no-index", po::bool_switch(&noIndex), "do not save the frame index of the outputs")
+      ;
+
+  po::options_description hidden("Hidden options");
+  hidden.add_options()
+      ("input-file", po::value<std::vector<std::string> >(), "input files")
+      ;
+
+  po::positional_options_description p;
+  p.add("input-file", -1);
+
+  po::options_description cmdline_options;
+  cmdline_options.add(visible).add(hidden);
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).
+              options(cmdline_options).positional(p).run(), vm);
+    po::notify(vm);
+  }
+  catch (const po::error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (vm.count("help") || !vm.count("input-file") || !vm.count("output"))
+  {
+    std::cout << "Usage: PacketFileMerger <pcap_file> [<pcap_file> ...] --output <pcap_file> [options]\n";
+    std::cout << visible << "\n";
+    return 1;
+  }
+
+  // convert to the right type
+  const std::vector<std::string> filenames = vm["input-file"].as<std::vector<std::string> >();
+  const fs::path outputName = vm["output"].as<std::string>();
+  const double startTime = vm["start"].as<double>();
+  const double endTime = vm["end"].as<double>();
+  const double splitDuration = vm["split-duration"].as<double>();
+  const size_t bufferSize = static_cast<size_t>(vm["buffer-size"].as<unsigned int>()) << 20;
+  std::vector<Endpoint> sources;
+  if (vm.count("source"))
+  {
+    for (const std::string& text : vm["source"].as<std::vector<std::string> >())
+    {
+      Endpoint source;
+      if (!Endpoint::Parse(text, source))
+      {
+        std::cerr << "Invalid source " << text << ", expected ip or ip:port" << std::endl;
+        return 1;
+      }
+      sources.push_back(source);
+    }
+  }
+  const std::vector<unsigned int> ports =
+    vm.count("port") ? vm["port"].as<std::vector<unsigned int> >() : std::vector<unsigned int>();
+
+  PacketMerger merger(std::max(vm["sort-window"].as<double>(), 0.));
+  if (!merger.Open(filenames))
+  {
+    return 1;
+  }
+
+  // the outputs by sender, a single one with a null sender when they are not split by sender
+  std::map<Endpoint, std::unique_ptr<Output> > outputs;
+  std::vector<std::string> writtenFiles;
+  // the frames are detected on each sender, whatever the output it is written to
+  std::map<Endpoint, std::unique_ptr<VelodyneFrameDetector> > detectors;
+  std::vector<LidarFrameDetector::Split> splits;
+  std::vector<unsigned char> buffer;
+  // time of the first packet read, which the time filters are relative to
+  double firstTime = 0;
+  bool isFirstPacket = true;
+  size_t numberOfPackets = 0;
+
+  auto openChunk = [&](Output& output, double time) {
+    output.Writer.SetBufferSize(bufferSize);
+    const std::string fileName = GetOutputFileName(outputName, output);
+    if (!output.Writer.Open(fileName))
+    {
+      std::cerr << output.Writer.GetLastError() << std::endl;
+      return false;
+    }
+    output.ChunkEnd = time + splitDuration;
+    writtenFiles.push_back(fileName);
+    return true;
+  };
+
+  Packet packet;
+  while (merger.Next(packet))
+  {
+    if (isFirstPacket)
+    {
+      firstTime = packet.Time;
+      isFirstPacket = false;
+    }
+    const double time = packet.Time - firstTime;
+    if (time < startTime)
+    {
+      continue;
+    }
+    if (endTime >= 0 && time > endTime)
+    {
+      break;
+    }
+    const bool isSourceKept = sources.empty() ||
+      std::any_of(sources.begin(), sources.end(),
+        [&](const Endpoint& source) { return source.Matches(packet.Source); });
+    const bool isPortKept = ports.empty() ||
+      std::find(ports.begin(), ports.end(), packet.Destination.Port) != ports.end();
+    if (!isSourceKept || !isPortKept)
+    {
+      continue;
+    }
+
+    const Endpoint group = splitBySource ? packet.Source : Endpoint();
+    std::unique_ptr<Output>& slot = outputs[group];
+    if (!slot)
+    {
+      slot.reset(new Output);
+      if (splitBySource)
+      {
+        slot->Source.reset(new Endpoint(packet.Source));
+      }
+      slot->Chunk = splitDuration > 0 ? 0 : -1;
+      if (!openChunk(*slot, packet.Time))
+      {
+        return 1;
+      }
+    }
+    Output& output = *slot;
+
+    // the first frame of the lidar of the output which starts in this packet, if any
+    int framePosition = -1;
+    std::unique_ptr<VelodyneFrameDetector>& detector = detectors[packet.Source];
+    if (!detector)
+    {
+      detector.reset(new VelodyneFrameDetector(true));
+    }
+    if (splitDuration > 0 && detector->IsLidarPacket(packet.GetPayload(), packet.PayloadLength))
+    {
+      if (!output.Lidar)
+      {
+        output.Lidar.reset(new Endpoint(packet.Source));
+      }
+      splits.clear();
+      detector->DetectFrame(packet.GetPayload(), packet.PayloadLength, splits);
+      if (*output.Lidar == packet.Source && !splits.empty())
+      {
+        framePosition = splits.front().PositionInPacket;
+      }
+    }
+
+    // an output without lidar is cut on time only
+    if (splitDuration > 0 && packet.Time >= output.ChunkEnd &&
+      (!output.Lidar || framePosition >= 0))
+    {
+      // the packet also ends the last frame of the chunk
+      if (framePosition > 0 && !WritePacket(output, packet, buffer))
+      {
+        std::cerr << output.Writer.GetLastError() << std::endl;
+        return 1;
+      }
+      output.Writer.Close();
+      output.Chunk++;
+      if (!openChunk(output, packet.Time))
+      {
+        return 1;
+      }
+    }
+
+    if (!WritePacket(output, packet, buffer))
+    {
+      std::cerr << output.Writer.GetLastError() << std::endl;
+      return 1;
+    }
+    numberOfPackets++;
+  }
+
+  for (auto& output : outputs)
+  {
+    output.second->Writer.Close();
+  }
+  std::cout << numberOfPackets << " packets written to " << writtenFiles.size() << " files"
+            << std::endl;
+
+  // the index is built by the reader, so that it is the one the application expects
+  for (size_t i = 0; i < writtenFiles.size() && !noIndex; ++i)
+  {
+    if (!SaveFrameIndex(writtenFiles[i]))
+    {
+      std::cout << writtenFiles[i] << ": no lidar packet, the frames are not indexed" << std::endl;
+    }
+  }
+  return 0;
+}
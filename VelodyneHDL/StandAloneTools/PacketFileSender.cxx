@@ -29,6 +29,9 @@
 // .SECTION Description
 // This program reads a pcap file and sends the packets using UDP.
 // The default playback speed is based on the timestamps specified in the pcap file
+// Several pcap files can be given, their packets are then merged by timestamp.
+// The packets are sent by batches, with the replay clock checked against a
+// monotonic clock, so that late packets are caught up at once.
 
 #include "vtkPacketFileReader.h"
 #include "vvPacketSender.h"
@@ -38,6 +41,8 @@
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <thread>
+#include <vector>
 
 #include <boost/thread/thread.hpp>
 #include <boost/program_options.hpp>
@@ -45,9 +50,26 @@ namespace po = boost::program_options;
 
 const int OUTPUT_WIDTH = 15; // width of the column (#packet, duration, ...) in the output stream
 
+//-----------------------------------------------------------------------------
+// Sleep until shortly before the deadline then spin, as the thread often wakes up
+// too late to pace the packets with a sleep alone
+void WaitUntil(const std::chrono::steady_clock::time_point& deadline)
+{
+  const std::chrono::microseconds spinDuration(200);
+  const auto now = std::chrono::steady_clock::now();
+  if (deadline - now > spinDuration)
+  {
+    std::this_thread::sleep_for(deadline - now - spinDuration);
+  }
+  while (std::chrono::steady_clock::now() < deadline)
+  {
+  }
+}
+
 int main(int argc, char* argv[])
 {
   bool loop = false;  // run the capture 1 time or in loop
+  bool keepPorts = false; // send the packets to their captured destination ports
 
   // parse the command line options
   po::options_description visible("Allowed options");
@@ -55,6 +77,7 @@ int main(int argc, char* argv[])
       ("help", "produce help message")
       ("ip", po::value<std::string>()->default_value("127.0.0.1"), "destination ip adress")
       ("loop", po::bool_switch(&loop), "run the capture in loop")
+      ("keep-ports", po::bool_switch(&keepPorts), "send each packet to the port it was captured on, instead of lidarPort or GPSPort")
       ("lidarPort", po::value<unsigned int>()->default_value(2368), "destination port for lidar packets")
       ("GPSPort", po::value<unsigned int>()->default_value(8308), "destination port for GPS packets")
       ("speed", po::value<double>()->default_value(1), "playback speed")
@@ -63,7 +86,7 @@ int main(int argc, char* argv[])
 
   po::options_description hidden("Hidden options");
   hidden.add_options()
-      ("input-file", po::value<std::string>(), "input file")
+      ("input-file", po::value<std::vector<std::string> >(), "input files")
       ;
 
   po::positional_options_description p;
@@ -78,13 +101,13 @@ int main(int argc, char* argv[])
   po::notify(vm);
 
   if (vm.count("help") || argc < 2) {
-      cout << "Usage: PacketFileSender <pcap_file> [options]\n";
+      cout << "Usage: PacketFileSender <pcap_file> [<pcap_file> ...] [options]\n";
       cout << visible << "\n";
       return 1;
   }
 
   // convert to the right type
-  std::string filename = vm["input-file"].as<std::string>();
+  std::vector<std::string> filenames = vm["input-file"].as<std::vector<std::string> >();
   double speed = vm["speed"].as<double>();
   std::string destinationIp = vm["ip"].as<std::string>();
   unsigned int lidarPort =  vm["lidarPort"].as<unsigned int>();
@@ -99,8 +122,6 @@ int main(int argc, char* argv[])
   {
     do
     {
-      auto replayStartTime = std::chrono::steady_clock::now();
-
       // output the column header for the displayed values
       std::cout << "----------------------------------------------------------------------------" << std::endl
                 << std::right << std::setw(OUTPUT_WIDTH) << "# packets"
@@ -111,40 +132,32 @@ int main(int argc, char* argv[])
                 << "----------------------------------------------------------------------------" << std::endl;
 
       // Create a Packet Sender
-      vvPacketSender sender(filename, destinationIp, lidarPort, GPSPort);
-
-      // Case starting time
-      double pcapStartTime = sender.pumpPacket();
+      vvPacketSender sender(filenames, destinationIp, lidarPort, GPSPort);
+      sender.SetKeepDestinationPorts(keepPorts);
 
+      auto replayStartTime = std::chrono::steady_clock::now();
       while (!sender.IsDone())
       {
-        // time from the pcap file
-        double pcapCurrentTime = sender.pumpPacket();
-        double pcapmicroSecondsSinceStart = (pcapCurrentTime - pcapStartTime) * microSecondsPerSecond;
-
-        // time from the wall clock
+        // time of the next packet in the pcap files, then on the wall clock
+        double pcapNextTime = sender.GetNextPacketTime();
+        WaitUntil(replayStartTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                      std::chrono::duration<double>(pcapNextTime / speed)));
         auto replayCurrentTime = std::chrono::steady_clock::now();
-        int replaymicroSecondsSinceStart =
-            std::chrono::duration_cast<std::chrono::microseconds>(replayCurrentTime - replayStartTime).count();
+        double secondSinceStart =
+            std::chrono::duration<double>(replayCurrentTime - replayStartTime).count();
 
-        // check if the replay is to much in advance compared to the pcap time step
-        // if this is the case, we sleep the thread until the pcap catch up the replay
-        double time_delay = static_cast<double>(pcapmicroSecondsSinceStart) / speed  - replaymicroSecondsSinceStart;
-
-        if (time_delay > 0)
-        {
-        boost::this_thread::sleep(
-          boost::posix_time::microseconds(static_cast<int>(time_delay)));
-        }
+        // send the packets which are due, including the ones late if the replay lags behind
+        size_t previousPacketCount = sender.GetPacketCount();
+        sender.pumpPackets(secondSinceStart * speed);
 
         // Display the user some information
-        if ((sender.GetPacketCount() % display_frequency) == 0)
+        if (previousPacketCount / display_frequency != sender.GetPacketCount() / display_frequency)
         {
           // Compute nb of packets sended including the one from previous loops
           int nbPacketSended = sender.GetPacketCount();
 
-          // Compute time since the replay began
-          double secondSinceStart = static_cast<double>(replaymicroSecondsSinceStart) / microSecondsPerSecond;
+          // negative if the replay is late compared to the pcap time step
+          double time_delay = (pcapNextTime / speed - secondSinceStart) * microSecondsPerSecond;
 
           // Nice output
           std::cout << std::fixed
@@ -0,0 +1,572 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// .NAME veloview-batch -
+// .SECTION Description
+// This program exports the frames of pcap files without the application, for the jobs run
+// on machines without display. It is driven by a JSON job file:
+//
+// {
+//   "inputs": ["capture.pcap", "directory/of/captures"],
+//   "calibration": "HDL-32.xml",
+//   "interpreter": "Velodyne",
+//   "filters": [
+//     { "type": "VoxelGridDownsampling", "leafSize": [0.1, 0.1, 0.1], "samplingMode": 0 },
+//     { "type": "PointCloudLOD", "pointBudget": 100000 }
+//   ],
+//   "output": { "directory": "out", "format": "vtp", "firstFrame": 0, "lastFrame": -1,
+//               "framesPerRange": 0,
+//               "image": { "array": "intensity", "width": 1080, "framesPerChunk": 100 },
+//               "csv": { "delimiter": ",", "precision": 6, "columns": ["X", "Y", "Z"] } },
+//   "jobs": 2,
+//   "threads": 0,
+//   "shard": { "index": 0, "count": 1 }
+// }
+//
+// The directories given as inputs are replaced by their .pcap and .pcapng files. The
+// interpreter is detected from the packets when it is not given, and the filters are applied
+// in order to each frame. The frames of each capture are written to
+// <directory>/<capture name>/frame_<number>.<format>, the "pcd" and "ply" formats being
+// binary files with the "csv" columns as fields, "jobs" captures being exported at
+// the same time with "threads" writing threads each. The "pcap" format copies the packets of
+// the frames instead, the "las" format writes the points of the frames in one LAS file
+// per range, relative to the sensor, and the "ept" format writes them as an Entwine Point
+// Tile octree in the directory frames_<range> instead. The "parquet" format writes the frames
+// of each range in the Parquet file frames_<range>.parquet, with the "csv" columns and the
+// frame number, its row groups being encoded by "threads" threads. The "npy" format writes the
+// images of the "image.array" array made by a LidarRawSignalImage filter of "image.width"
+// columns after the filters, stacked in NumPy files of "image.framesPerChunk" frames
+// named images_<first frame>.npy, which are encoded while the next frames are decoded.
+//
+// A job shared by several machines is run with the same job file on each one, with a
+// different shard index. When "output.framesPerRange" is set, the captures are split into
+// ranges of this many frames, otherwise each capture is a range. The ranges are dealt in
+// turn to the shards, and the outputs are named after the frame numbers in the capture, so
+// that the output directories of the shards are merged by copying them together.
+
+#include "LidarInterpreterRegistry.h"
+#include "vtkFrameBatchExporter.h"
+#include "vtkImageSequenceExporter.h"
+#include "vtkLASFileWriter.h"
+#include "vtkLidarParquetWriter.h"
+#include "vtkLidarRawSignalImage.h"
+#include "vtkLidarReader.h"
+#include "vtkPointCloudLOD.h"
+#include "vtkVoxelGridDownsampling.h"
+
+#include <vtkAlgorithm.h>
+#include <vtkDataObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+namespace po = boost::program_options;
+namespace pt = boost::property_tree;
+namespace fs = boost::filesystem;
+
+namespace
+{
+boost::mutex OutputMutex;
+
+//-----------------------------------------------------------------------------
+// Values of a JSON array
+template <typename T>
+std::vector<T> GetArray(const pt::ptree& tree, const std::string& path)
+{
+  std::vector<T> values;
+  const boost::optional<const pt::ptree&> array = tree.get_child_optional(path);
+  if (array)
+  {
+    for (const pt::ptree::value_type& item : *array)
+    {
+      values.push_back(item.second.get_value<T>());
+    }
+  }
+  return values;
+}
+
+//-----------------------------------------------------------------------------
+// Capture files of the inputs, the directories being replaced by their pcap files
+std::vector<fs::path> ListCaptures(const std::vector<std::string>& inputs)
+{
+  std::vector<fs::path> captures;
+  for (const std::string& input : inputs)
+  {
+    if (!fs::is_directory(input))
+    {
+      captures.push_back(input);
+      continue;
+    }
+    std::vector<fs::path> files;
+    for (fs::directory_iterator it(input), end; it != end; ++it)
+    {
+      const std::string extension = it->path().extension().string();
+      if (fs::is_regular_file(it->status()) && (extension == ".pcap" || extension == ".pcapng"))
+      {
+        files.push_back(it->path());
+      }
+    }
+    std::sort(files.begin(), files.end());
+    captures.insert(captures.end(), files.begin(), files.end());
+  }
+  return captures;
+}
+
+//-----------------------------------------------------------------------------
+// Filter described by an item of "filters", null if its type is unknown
+vtkSmartPointer<vtkAlgorithm> CreateFilter(const pt::ptree& description)
+{
+  const std::string type = description.get<std::string>("type", "");
+  if (type == "VoxelGridDownsampling")
+  {
+    auto filter = vtkSmartPointer<vtkVoxelGridDownsampling>::New();
+    const std::vector<double> leafSize = GetArray<double>(description, "leafSize");
+    if (leafSize.size() == 3)
+    {
+      filter->SetLeafSize(leafSize[0], leafSize[1], leafSize[2]);
+    }
+    filter->SetSamplingMode(description.get<int>("samplingMode", filter->GetSamplingMode()));
+    // the frames are already processed by several threads
+    filter->SetNumberOfThreads(description.get<int>("numberOfThreads", 1));
+    return filter;
+  }
+  if (type == "PointCloudLOD")
+  {
+    auto filter = vtkSmartPointer<vtkPointCloudLOD>::New();
+    filter->SetPointBudget(description.get<vtkIdType>("pointBudget", filter->GetPointBudget()));
+    filter->SetGridResolution(
+      description.get<int>("gridResolution", filter->GetGridResolution()));
+    filter->SetNumberOfThreads(description.get<int>("numberOfThreads", 1));
+    return filter;
+  }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<vtkSmartPointer<vtkAlgorithm> > CreateFilters(const pt::ptree& job)
+{
+  std::vector<vtkSmartPointer<vtkAlgorithm> > filters;
+  const boost::optional<const pt::ptree&> descriptions = job.get_child_optional("filters");
+  if (descriptions)
+  {
+    for (const pt::ptree::value_type& item : *descriptions)
+    {
+      filters.push_back(CreateFilter(item.second));
+    }
+  }
+  return filters;
+}
+
+//-----------------------------------------------------------------------------
+// Filters of the job followed by the projection of the frames in images
+std::vector<vtkSmartPointer<vtkAlgorithm> > CreateImageFilters(
+  const pt::ptree& job, vtkTable* calibration)
+{
+  std::vector<vtkSmartPointer<vtkAlgorithm> > filters = CreateFilters(job);
+  auto image = vtkSmartPointer<vtkLidarRawSignalImage>::New();
+  image->SetWidth(job.get<int>("output.image.width", image->GetWidth()));
+  image->SetInputArrayToProcess(0, 0, 0, vtkDataObject::FIELD_ASSOCIATION_POINTS,
+    job.get<std::string>("output.image.array", "intensity").c_str());
+  image->SetInputData(1, calibration);
+  filters.push_back(image);
+  return filters;
+}
+
+//-----------------------------------------------------------------------------
+void Log(std::ostream& stream, const std::string& message)
+{
+  boost::lock_guard<boost::mutex> lock(OutputMutex);
+  stream << message << std::endl;
+}
+
+//-----------------------------------------------------------------------------
+// Reader of a capture whose frames are indexed, null on error
+vtkSmartPointer<vtkLidarReader> OpenCapture(
+  const fs::path& capture, const pt::ptree& job, int numberOfThreads)
+{
+  vtkSmartPointer<vtkLidarReader> reader = vtkSmartPointer<vtkLidarReader>::New();
+  const std::string interpreterName = job.get<std::string>("interpreter", "");
+  if (!interpreterName.empty())
+  {
+    reader->SetInterpreter(LidarInterpreterRegistry::GetInstance().Create(interpreterName));
+  }
+  reader->SetFileName(capture.string());
+  // the index saved next to the capture is shared by the workers, which seek to their frames
+  reader->SetUseFrameIndexFile(true);
+  reader->SetNumberOfIndexingThreads(numberOfThreads);
+  reader->SetNumberOfDecodingThreads(numberOfThreads);
+  // the interpreter is detected there when none is given
+  reader->UpdateInformation();
+  if (!reader->GetInterpreter())
+  {
+    Log(std::cerr, capture.string() + ": no lidar packet recognized");
+    return nullptr;
+  }
+  const std::string calibration = job.get<std::string>("calibration", "");
+  if (!calibration.empty())
+  {
+    reader->SetCalibrationFileName(calibration);
+  }
+  return reader;
+}
+
+//-----------------------------------------------------------------------------
+// Frames of a capture to process, a whole capture is described by a last frame of -1
+struct FrameRange
+{
+  size_t Capture;
+  int FirstFrame;
+  int LastFrame;
+};
+
+//-----------------------------------------------------------------------------
+// Clamp the frames of the job to the frames of a capture, return false if none remains
+bool GetOutputFrames(const pt::ptree& job, int numberOfFrames, int& firstFrame, int& lastFrame)
+{
+  firstFrame = std::max(job.get<int>("output.firstFrame", 0), 0);
+  lastFrame = job.get<int>("output.lastFrame", -1);
+  if (lastFrame < 0 || lastFrame >= numberOfFrames)
+  {
+    lastFrame = numberOfFrames - 1;
+  }
+  return firstFrame <= lastFrame;
+}
+
+//-----------------------------------------------------------------------------
+// Split the frames of a capture into ranges of framesPerRange frames
+bool SplitCapture(size_t index, const fs::path& capture, const pt::ptree& job,
+  int numberOfThreads, int framesPerRange, std::vector<FrameRange>& ranges)
+{
+  vtkSmartPointer<vtkLidarReader> reader = OpenCapture(capture, job, numberOfThreads);
+  if (!reader)
+  {
+    return false;
+  }
+  int firstFrame, lastFrame;
+  if (!GetOutputFrames(job, reader->GetNumberOfFrames(), firstFrame, lastFrame))
+  {
+    Log(std::cerr, capture.string() + ": no frame to export");
+    return false;
+  }
+  for (int frame = firstFrame; frame <= lastFrame; frame += framesPerRange)
+  {
+    ranges.push_back({ index, frame, std::min(frame + framesPerRange - 1, lastFrame) });
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Export the frames of a range, return false on error
+bool ProcessRange(const FrameRange& range, const fs::path& capture, const pt::ptree& job,
+  int numberOfThreads)
+{
+  vtkSmartPointer<vtkLidarReader> reader = OpenCapture(capture, job, numberOfThreads);
+  if (!reader)
+  {
+    return false;
+  }
+  reader->UpdateInformation();
+
+  int firstFrame = range.FirstFrame;
+  int lastFrame = range.LastFrame;
+  if (lastFrame < 0 && !GetOutputFrames(job, reader->GetNumberOfFrames(), firstFrame, lastFrame))
+  {
+    Log(std::cerr, capture.string() + ": no frame to export");
+    return false;
+  }
+
+  // the files are named after the frame numbers in the capture, so that the outputs of the
+  // workers are merged by copying them in the same directory
+  const std::string format = job.get<std::string>("output.format", "vtp");
+  const fs::path directory =
+    fs::path(job.get<std::string>("output.directory", ".")) / capture.stem();
+  boost::system::error_code error;
+  fs::create_directories(directory, error);
+  if (error)
+  {
+    Log(std::cerr, directory.string() + ": " + error.message());
+    return false;
+  }
+  const std::string frames = std::to_string(firstFrame) + "-" + std::to_string(lastFrame);
+
+  if (format == "pcap")
+  {
+    const fs::path fileName = directory / ("frames_" + frames + ".pcap");
+    reader->Open();
+    reader->SaveFrame(firstFrame, lastFrame, fileName.string());
+    reader->Close();
+    if (!fs::exists(fileName))
+    {
+      Log(std::cerr, capture.string() + ": the frames could not be written to " + fileName.string());
+      return false;
+    }
+    Log(std::cout, capture.string() + ": frames " + frames + " written to " + fileName.string());
+    return true;
+  }
+
+  if (format == "las" || format == "ept")
+  {
+    // the points are written relative to the sensor, without projection nor coordinate
+    // system, in a file per range
+    const fs::path fileName = directory / ("frames_" + frames + ".las");
+    const fs::path output = format == "ept" ? fs::path(fileName).replace_extension() : fileName;
+    {
+      vtkLASFileWriter writer(fileName.string().c_str());
+      writer.SetTiled(format == "ept");
+      writer.SetPrecision(1e-3, 1e-3);
+      if (!writer.WriteFrames(reader, firstFrame, lastFrame))
+      {
+        Log(std::cerr, capture.string() + ": the frames could not be written to " + output.string());
+        return false;
+      }
+    }
+    Log(std::cout, capture.string() + ": frames " + frames + " written to " + output.string());
+    return true;
+  }
+
+  if (format == "npy")
+  {
+    // the calibration is copied once, the images being made on the writing thread
+    auto calibration = vtkSmartPointer<vtkTable>::New();
+    calibration->DeepCopy(reader->GetOutputDataObject(1));
+    vtkImageSequenceExporter exporter((directory / "images_%04d.npy").string());
+    exporter.SetFramesPerChunk(job.get<int>("output.image.framesPerChunk", 100));
+    exporter.SetFilterFactory(boost::bind(&CreateImageFilters, boost::cref(job),
+      calibration.GetPointer()));
+    if (!exporter.ExportFrames(reader, firstFrame, lastFrame))
+    {
+      Log(std::cerr, capture.string() + ": the images could not be written to " + directory.string());
+      return false;
+    }
+    Log(std::cout, capture.string() + ": images of frames " + frames + " written to " +
+      directory.string());
+    return true;
+  }
+
+  const std::vector<std::string> columns = GetArray<std::string>(job, "output.csv.columns");
+  if (format == "parquet")
+  {
+    const fs::path fileName = directory / ("frames_" + frames + ".parquet");
+    vtkLidarParquetWriter writer;
+    writer.SetNumberOfThreads(numberOfThreads);
+    writer.SetColumns(columns);
+    if (!writer.WriteFrames(reader, firstFrame, lastFrame, fileName.string()))
+    {
+      Log(std::cerr, capture.string() + ": the frames could not be written to " + fileName.string());
+      return false;
+    }
+    Log(std::cout, capture.string() + ": frames " + frames + " written to " + fileName.string());
+    return true;
+  }
+
+  const int exporterFormat = format == "csv" ? vtkFrameBatchExporter::CSV
+    : format == "pcd" ? vtkFrameBatchExporter::PCD
+    : format == "ply" ? vtkFrameBatchExporter::PLY : vtkFrameBatchExporter::VTP;
+  vtkFrameBatchExporter exporter(exporterFormat, (directory / ("frame_%04d." + format)).string());
+  exporter.SetNumberOfThreads(numberOfThreads);
+  exporter.SetFilterFactory(boost::bind(&CreateFilters, boost::cref(job)));
+  const std::string delimiter = job.get<std::string>("output.csv.delimiter", ",");
+  exporter.GetCSVWriter().SetDelimiter(delimiter.empty() ? ',' : delimiter[0]);
+  exporter.GetCSVWriter().SetPrecision(job.get<int>("output.csv.precision", 6));
+  if (!columns.empty())
+  {
+    exporter.GetCSVWriter().SetColumns(columns);
+  }
+
+  if (!exporter.ExportFrames(reader, firstFrame, lastFrame))
+  {
+    Log(std::cerr, capture.string() + ": the frames could not be written to " + directory.string());
+    return false;
+  }
+  Log(std::cout, capture.string() + ": frames " + frames + " written to " + directory.string());
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Call function for each index below count, on numberOfJobs threads taking the next index
+template <typename Function>
+void ParallelFor(size_t count, int numberOfJobs, Function function)
+{
+  std::atomic<size_t> next(0);
+  boost::thread_group group;
+  for (int i = 0; i < numberOfJobs; ++i)
+  {
+    group.create_thread([&]() {
+      for (size_t index = next++; index < count; index = next++)
+      {
+        function(index);
+      }
+    });
+  }
+  group.join_all();
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  po::options_description visible("Allowed options");
+  visible.add_options()
+      ("help", "produce help message")
+      ("jobs", po::value<int>(), "number of captures processed at the same time, overrides the job file")
+      ("threads", po::value<int>(), "number of threads of each capture, 0 for one per core, overrides the job file")
+      ("shard-index", po::value<int>(), "index of this worker among shard-count workers, overrides the job file")
+      ("shard-count", po::value<int>(), "number of workers sharing the job, overrides the job file")
+      ;
+
+  po::options_description hidden("Hidden options");
+  hidden.add_options()
+      ("job-file", po::value<std::string>(), "job file")
+      ;
+
+  po::positional_options_description p;
+  p.add("job-file", 1);
+
+  po::options_description cmdline_options;
+  cmdline_options.add(visible).add(hidden);
+
+  po::variables_map vm;
+  try
+  {
+    po::store(po::command_line_parser(argc, argv).
+              options(cmdline_options).positional(p).run(), vm);
+    po::notify(vm);
+  }
+  catch (const po::error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  if (vm.count("help") || !vm.count("job-file"))
+  {
+    std::cout << "Usage: veloview-batch <job.json> [options]\n";
+    std::cout << visible << "\n";
+    return 1;
+  }
+
+  pt::ptree job;
+  try
+  {
+    pt::read_json(vm["job-file"].as<std::string>(), job);
+  }
+  catch (const pt::json_parser_error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  // check the filters once, instead of failing in each writing thread
+  const boost::optional<pt::ptree&> filters = job.get_child_optional("filters");
+  if (filters)
+  {
+    for (const pt::ptree::value_type& item : *filters)
+    {
+      if (!CreateFilter(item.second))
+      {
+        std::cerr << "Unknown filter type: " << item.second.get<std::string>("type", "") << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  const std::vector<fs::path> captures = ListCaptures(GetArray<std::string>(job, "inputs"));
+  if (captures.empty())
+  {
+    std::cerr << "No capture to process" << std::endl;
+    return 1;
+  }
+
+  const int shardIndex =
+    vm.count("shard-index") ? vm["shard-index"].as<int>() : job.get<int>("shard.index", 0);
+  const int shardCount =
+    vm.count("shard-count") ? vm["shard-count"].as<int>() : job.get<int>("shard.count", 1);
+  if (shardCount < 1 || shardIndex < 0 || shardIndex >= shardCount)
+  {
+    std::cerr << "Invalid shard " << shardIndex << " of " << shardCount << std::endl;
+    return 1;
+  }
+  const int framesPerRange = job.get<int>("output.framesPerRange", 0);
+
+  const int jobs = vm.count("jobs") ? vm["jobs"].as<int>() : job.get<int>("jobs", 1);
+  int threads = vm.count("threads") ? vm["threads"].as<int>() : job.get<int>("threads", 0);
+  const int numberOfJobs = std::max(1, jobs);
+  if (threads <= 0)
+  {
+    // the cores are shared between the ranges processed at the same time
+    threads = std::max(1, static_cast<int>(boost::thread::hardware_concurrency()) / numberOfJobs);
+  }
+
+  // the ranges are listed in the same order by all the workers, so that each one can keep
+  // its share without communicating with the others
+  std::atomic<int> failures(0);
+  std::vector<FrameRange> ranges;
+  if (framesPerRange <= 0)
+  {
+    for (size_t index = 0; index < captures.size(); ++index)
+    {
+      ranges.push_back({ index, 0, -1 });
+    }
+  }
+  else
+  {
+    std::vector<std::vector<FrameRange> > captureRanges(captures.size());
+    ParallelFor(captures.size(), numberOfJobs, [&](size_t index) {
+      if (!SplitCapture(index, captures[index], job, threads, framesPerRange, captureRanges[index]))
+      {
+        failures++;
+      }
+    });
+    for (const std::vector<FrameRange>& splitRanges : captureRanges)
+    {
+      ranges.insert(ranges.end(), splitRanges.begin(), splitRanges.end());
+    }
+  }
+
+  std::vector<FrameRange> shard;
+  for (size_t index = shardIndex; index < ranges.size(); index += shardCount)
+  {
+    shard.push_back(ranges[index]);
+  }
+
+  ParallelFor(shard.size(), numberOfJobs, [&](size_t index) {
+    if (!ProcessRange(shard[index], captures[shard[index].Capture], job, threads))
+    {
+      failures++;
+    }
+  });
+
+  if (failures > 0)
+  {
+    std::cerr << failures << " captures or ranges failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
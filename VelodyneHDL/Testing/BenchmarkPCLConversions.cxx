@@ -0,0 +1,186 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Measure the throughput of the conversions between vtkPolyData and
+// pcl::PointCloud, and the memory used per point, and write them as JSON:
+//
+//   BenchmarkPCLConversions <result.json> [<number of points>]
+//
+// The points given by each conversion are compared to the original ones.
+
+#include "vtkPCLConversions.h"
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+const int NumberOfRepetitions = 10;
+
+//-----------------------------------------------------------------------------
+// Median duration in seconds of the repetitions of a conversion
+double Measure(const std::function<void()>& conversion)
+{
+  std::vector<double> durations;
+  for (int repetition = 0; repetition < NumberOfRepetitions; ++repetition)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    conversion();
+    durations.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  std::sort(durations.begin(), durations.end());
+  return durations[durations.size() / 2];
+}
+
+//-----------------------------------------------------------------------------
+template <typename PointT>
+int ComparePoints(vtkPolyData* polyData, const pcl::PointCloud<PointT>& cloud, const std::string& name)
+{
+  if (polyData->GetNumberOfPoints() != static_cast<vtkIdType>(cloud.size()))
+  {
+    std::cerr << name << ": different number of points" << std::endl;
+    return 1;
+  }
+  for (vtkIdType i = 0; i < polyData->GetNumberOfPoints(); ++i)
+  {
+    double x[3];
+    polyData->GetPoint(i, x);
+    if (static_cast<float>(x[0]) != cloud.points[i].x || static_cast<float>(x[1]) != cloud.points[i].y ||
+        static_cast<float>(x[2]) != cloud.points[i].z)
+    {
+      std::cerr << name << ": different point " << i << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void WriteThroughput(std::ostream& json, const std::string& name, double duration, vtkIdType numberOfPoints, bool last)
+{
+  json << "    \"" << name << "\": { \"median_ms\": " << 1000.0 * duration
+       << ", \"points_per_second\": " << numberOfPoints / std::max(duration, 1e-9) << " }"
+       << (last ? "" : ",") << "\n";
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: BenchmarkPCLConversions <result.json> [<number of points>]" << std::endl;
+    return 1;
+  }
+  const vtkIdType numberOfPoints = argc > 2 ? std::atol(argv[2]) : 1000000;
+
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> distribution(-100.f, 100.f);
+  vtkNew<vtkFloatArray> coordinates;
+  coordinates->SetNumberOfComponents(3);
+  coordinates->SetNumberOfTuples(numberOfPoints);
+  for (vtkIdType i = 0; i < 3 * numberOfPoints; ++i)
+  {
+    coordinates->SetValue(i, distribution(generator));
+  }
+  vtkNew<vtkPoints> points;
+  points->SetData(coordinates.GetPointer());
+  vtkNew<vtkPolyData> polyData;
+  polyData->SetPoints(points.GetPointer());
+
+  int nbrErrors = 0;
+
+  // vtk to pcl, in a new cloud or reusing the memory of a cloud
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud;
+  const double toNewCloud = Measure([&] { cloud = vtkPCLConversions::PointCloudFromPolyData(polyData.GetPointer()); });
+  nbrErrors += ComparePoints(polyData.GetPointer(), *cloud, "PointCloudFromPolyData");
+  const double toReusedCloud = Measure([&] { vtkPCLConversions::PointCloudFromPolyData(polyData.GetPointer(), *cloud); });
+  nbrErrors += ComparePoints(polyData.GetPointer(), *cloud, "PointCloudFromPolyData (reused cloud)");
+
+  // pcl to vtk, copying the points or reading them in the cloud
+  vtkSmartPointer<vtkPolyData> copy;
+  const double fromCloud = Measure([&] { copy = vtkPCLConversions::PolyDataFromPointCloud(cloud); });
+  nbrErrors += ComparePoints(copy.GetPointer(), *cloud, "PolyDataFromPointCloud");
+  vtkSmartPointer<vtkPolyData> view;
+  const double viewOfCloud = Measure([&] { view = vtkPCLConversions::PolyDataViewOfPointCloud(cloud); });
+  nbrErrors += ComparePoints(view.GetPointer(), *cloud, "PolyDataViewOfPointCloud");
+
+  // the clouds used by the slam carry intensities and normals
+  pcl::PointCloud<pcl::PointXYZINormal>::Ptr normalsCloud(new pcl::PointCloud<pcl::PointXYZINormal>);
+  normalsCloud->points.resize(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    normalsCloud->points[i].x = cloud->points[i].x;
+    normalsCloud->points[i].y = cloud->points[i].y;
+    normalsCloud->points[i].z = cloud->points[i].z;
+  }
+  vtkSmartPointer<vtkPolyData> normalsView;
+  const double viewOfNormalsCloud = Measure([&] { normalsView = vtkPCLConversions::PolyDataViewOfPointCloud(normalsCloud); });
+  nbrErrors += ComparePoints(normalsView.GetPointer(), *normalsCloud, "PolyDataViewOfPointCloud (XYZINormal)");
+
+  vtkSmartPointer<vtkCellArray> cells;
+  const double vertexCells = Measure([&] { cells = vtkPCLConversions::NewVertexCells(numberOfPoints); });
+
+  // the view must not depend on the cloud once it is released
+  const pcl::PointCloud<pcl::PointXYZ> expected = *cloud;
+  cloud.reset();
+  nbrErrors += ComparePoints(view.GetPointer(), expected, "PolyDataViewOfPointCloud (released cloud)");
+
+  std::string resultFileName = argv[1];
+  std::ofstream json(resultFileName.c_str());
+  if (!json.is_open())
+  {
+    std::cerr << "Cannot create " << resultFileName << std::endl;
+    return 1;
+  }
+  const double bytesPerPoint = 1024.0 / std::max<vtkIdType>(numberOfPoints, 1);
+  json << std::setprecision(6) << std::fixed;
+  json << "{\n"
+       << "  \"points\": " << numberOfPoints << ",\n"
+       << "  \"throughput\": {\n";
+  WriteThroughput(json, "polydata_to_new_cloud", toNewCloud, numberOfPoints, false);
+  WriteThroughput(json, "polydata_to_reused_cloud", toReusedCloud, numberOfPoints, false);
+  WriteThroughput(json, "cloud_to_polydata_copy", fromCloud, numberOfPoints, false);
+  WriteThroughput(json, "cloud_to_polydata_view", viewOfCloud, numberOfPoints, false);
+  WriteThroughput(json, "normals_cloud_to_polydata_view", viewOfNormalsCloud, numberOfPoints, false);
+  WriteThroughput(json, "vertex_cells", vertexCells, numberOfPoints, true);
+  json << "  },\n"
+       << "  \"bytes_per_point\": {\n"
+       << "    \"polydata_copy\": " << copy->GetActualMemorySize() * bytesPerPoint << ",\n"
+       << "    \"polydata_copy_points\": " << copy->GetPoints()->GetActualMemorySize() * bytesPerPoint << ",\n"
+       << "    \"vertex_cells\": " << cells->GetActualMemorySize() * bytesPerPoint << "\n"
+       << "  },\n"
+       << "  \"errors\": " << nbrErrors << "\n"
+       << "}\n";
+
+  return nbrErrors;
+}
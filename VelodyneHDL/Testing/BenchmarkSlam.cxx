@@ -0,0 +1,417 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Run the slam over a recording and write its throughput, the latency of each
+// stage, the peak memory and the errors against a reference trajectory as JSON:
+//
+//   BenchmarkSlam <result.json> kitti <velodyne folder> [<poses.txt> <calib.txt>] [<frames>]
+//   BenchmarkSlam <result.json> pcap <file.pcap> <calibration.xml> [<reference.csv>] [<frames>]
+//
+// The KITTI reference are the poses of the odometry benchmark, with the lidar to
+// camera calibration of the sequence. The pcap reference is a trajectory read by
+// vtkTemporalTransformsReader, matched to the frames by their time.
+
+#include "vtkLidarKITTIDataSetReader.h"
+#include "vtkLidarReader.h"
+#include "vtkSlamManager.h"
+#include "vtkTemporalTransforms.h"
+#include "vtkTemporalTransformsReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkTable.h>
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+typedef std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d> > Poses;
+
+//! Time difference under which a reference pose is matched to a frame
+const double MaximumTimeDifference = 0.05;
+
+//! Frames between the poses compared by the relative pose error
+const std::vector<unsigned int> RelativePoseDeltas = { 1, 10 };
+
+//-----------------------------------------------------------------------------
+double GetPeakResidentSetSize()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+  {
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+  }
+  return 0.0;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+//-----------------------------------------------------------------------------
+Eigen::Isometry3d GetPose(vtkTemporalTransforms* transforms, vtkIdType index)
+{
+  double orientation[4];
+  double position[3];
+  transforms->GetOrientationArray()->GetTuple(index, orientation);
+  transforms->GetTranslationArray()->GetTuple(index, position);
+  Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+  pose.linear() = Eigen::AngleAxisd(orientation[3],
+                                    Eigen::Vector3d(orientation[0], orientation[1], orientation[2])).toRotationMatrix();
+  pose.translation() = Eigen::Vector3d(position[0], position[1], position[2]);
+  return pose;
+}
+
+//-----------------------------------------------------------------------------
+// Read the 12 values of a 3x4 row-major matrix
+bool ReadMatrix(std::istream& stream, Eigen::Isometry3d& matrix)
+{
+  matrix = Eigen::Isometry3d::Identity();
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int col = 0; col < 4; ++col)
+    {
+      if (!(stream >> matrix.matrix()(row, col)))
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// The KITTI poses are the ones of the left camera, they are expressed in the
+// lidar referential with the Tr calibration from the lidar to the camera
+bool ReadKITTIPoses(const std::string& posesFileName, const std::string& calibFileName, Poses& poses)
+{
+  std::ifstream calibFile(calibFileName.c_str());
+  Eigen::Isometry3d lidarToCamera;
+  bool hasCalibration = false;
+  std::string line;
+  while (std::getline(calibFile, line))
+  {
+    if (line.compare(0, 3, "Tr:") == 0)
+    {
+      std::istringstream stream(line.substr(3));
+      hasCalibration = ReadMatrix(stream, lidarToCamera);
+    }
+  }
+  if (!hasCalibration)
+  {
+    std::cerr << "No Tr calibration in " << calibFileName << std::endl;
+    return false;
+  }
+
+  std::ifstream posesFile(posesFileName.c_str());
+  Eigen::Isometry3d cameraPose;
+  while (std::getline(posesFile, line))
+  {
+    std::istringstream stream(line);
+    if (ReadMatrix(stream, cameraPose))
+    {
+      poses.push_back(lidarToCamera.inverse() * cameraPose * lidarToCamera);
+    }
+  }
+  if (poses.empty())
+  {
+    std::cerr << "No poses in " << posesFileName << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// The KITTI frames have no calibration, their laser ids are ordered from the
+// highest laser to the lowest one
+vtkSmartPointer<vtkTable> CreateKITTICalibration(int numberOfLasers)
+{
+  vtkSmartPointer<vtkDoubleArray> verticalCorrection = vtkSmartPointer<vtkDoubleArray>::New();
+  verticalCorrection->SetName("verticalCorrection");
+  for (int laser = 0; laser < numberOfLasers; ++laser)
+  {
+    verticalCorrection->InsertNextValue(-laser);
+  }
+  vtkSmartPointer<vtkTable> calibration = vtkSmartPointer<vtkTable>::New();
+  calibration->AddColumn(verticalCorrection);
+  return calibration;
+}
+
+//-----------------------------------------------------------------------------
+double Percentile(std::vector<double> values, double percentile)
+{
+  if (values.empty())
+  {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  const size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * values.size()));
+  return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+//-----------------------------------------------------------------------------
+void WriteLatency(std::ostream& json, const std::string& name, vtkTable* profiling, const char* column, bool last)
+{
+  std::vector<double> values;
+  vtkDataArray* array = vtkDataArray::SafeDownCast(profiling->GetColumnByName(column));
+  for (vtkIdType row = 0; array && row < array->GetNumberOfTuples(); ++row)
+  {
+    values.push_back(1000.0 * array->GetTuple1(row));
+  }
+  json << "    \"" << name << "\": { \"p50\": " << Percentile(values, 50) << ", \"p90\": " << Percentile(values, 90)
+       << ", \"p99\": " << Percentile(values, 99) << ", \"max\": " << Percentile(values, 100) << " }"
+       << (last ? "" : ",") << "\n";
+}
+
+//-----------------------------------------------------------------------------
+// Root mean square of the position errors, once the estimated trajectory is
+// rigidly aligned on the reference one
+double ComputeAbsoluteTrajectoryError(const Poses& estimated, const Poses& reference)
+{
+  Eigen::Matrix3Xd source(3, estimated.size());
+  Eigen::Matrix3Xd target(3, reference.size());
+  for (size_t index = 0; index < estimated.size(); ++index)
+  {
+    source.col(index) = estimated[index].translation();
+    target.col(index) = reference[index].translation();
+  }
+  const Eigen::Matrix4d alignment = Eigen::umeyama(source, target, false);
+  const Eigen::Matrix3Xd aligned = (alignment.topLeftCorner<3, 3>() * source).colwise() + alignment.topRightCorner<3, 1>();
+  return std::sqrt((aligned - target).colwise().squaredNorm().mean());
+}
+
+//-----------------------------------------------------------------------------
+// Root mean square of the translation (m) and rotation (deg) errors of the
+// motions between the poses delta frames apart
+void ComputeRelativePoseError(const Poses& estimated, const Poses& reference, unsigned int delta,
+                              double& translationError, double& rotationError, size_t& count)
+{
+  double translationSum = 0.0;
+  double rotationSum = 0.0;
+  count = 0;
+  for (size_t index = 0; index + delta < estimated.size(); ++index)
+  {
+    const Eigen::Isometry3d estimatedMotion = estimated[index].inverse() * estimated[index + delta];
+    const Eigen::Isometry3d referenceMotion = reference[index].inverse() * reference[index + delta];
+    const Eigen::Isometry3d error = referenceMotion.inverse() * estimatedMotion;
+    translationSum += error.translation().squaredNorm();
+    const double angle = vtkMath::DegreesFromRadians(Eigen::AngleAxisd(error.linear()).angle());
+    rotationSum += angle * angle;
+    count++;
+  }
+  translationError = count ? std::sqrt(translationSum / count) : 0.0;
+  rotationError = count ? std::sqrt(rotationSum / count) : 0.0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 4)
+  {
+    std::cerr << "Usage: BenchmarkSlam <result.json> kitti <velodyne folder> [<poses.txt> <calib.txt>] [<frames>]" << std::endl
+              << "       BenchmarkSlam <result.json> pcap <file.pcap> <calibration.xml> [<reference.csv>] [<frames>]" << std::endl;
+    return 1;
+  }
+  const std::string resultFileName = argv[1];
+  const std::string format = argv[2];
+  const std::string dataset = argv[3];
+
+  vtkNew<vtkSlamManager> slam;
+  slam->SetProfiling(true);
+
+  // reference poses of the frames, by frame index for KITTI
+  // and by time for the pcaps
+  Poses referencePoses;
+  vtkSmartPointer<vtkTemporalTransforms> referenceTrajectory;
+  int maximumNumberOfFrames = 0;
+  int numberOfFrames = 0;
+
+  if (format == "kitti")
+  {
+    auto kittiReader = vtkSmartPointer<vtkLidarKITTIDataSetReader>::New();
+    kittiReader->SetFileName(dataset);
+    numberOfFrames = kittiReader->GetNumberOfFrames();
+    slam->SetInputConnection(0, kittiReader->GetOutputPort(0));
+    slam->SetInputData(1, CreateKITTICalibration(kittiReader->GetNbrLaser()));
+    if (argc >= 6 && !ReadKITTIPoses(argv[4], argv[5], referencePoses))
+    {
+      return 1;
+    }
+    maximumNumberOfFrames = argc >= 7 ? std::atoi(argv[6]) : (argc == 5 ? std::atoi(argv[4]) : 0);
+  }
+  else if (format == "pcap" && argc >= 5)
+  {
+    auto pcapReader = vtkSmartPointer<vtkLidarReader>::New();
+    pcapReader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+    pcapReader->SetFileName(dataset);
+    pcapReader->SetCalibrationFileName(argv[4]);
+    pcapReader->Update();
+    numberOfFrames = pcapReader->GetNumberOfFrames();
+    slam->SetInputConnection(0, pcapReader->GetOutputPort(0));
+    slam->SetInputConnection(1, pcapReader->GetOutputPort(1));
+    if (argc >= 6)
+    {
+      referenceTrajectory = vtkTemporalTransformsReader::OpenTemporalTransforms(argv[5]);
+      if (!referenceTrajectory || referenceTrajectory->GetNumberOfPoints() == 0)
+      {
+        std::cerr << "Cannot read the reference trajectory " << argv[5] << std::endl;
+        return 1;
+      }
+    }
+    maximumNumberOfFrames = argc >= 7 ? std::atoi(argv[6]) : 0;
+  }
+  else
+  {
+    std::cerr << "Unknown dataset format: " << format << std::endl;
+    return 1;
+  }
+
+  if (numberOfFrames == 0)
+  {
+    std::cerr << "No frame in " << dataset << std::endl;
+    return 1;
+  }
+  if (maximumNumberOfFrames > 0 && maximumNumberOfFrames < numberOfFrames)
+  {
+    numberOfFrames = maximumNumberOfFrames;
+  }
+  slam->SetAllFrame(false);
+  slam->SetStartFrame(0);
+  slam->SetEndFrame(numberOfFrames - 1);
+
+  // the slam manager processes all the frames in a single update
+  const auto start = std::chrono::steady_clock::now();
+  slam->Update();
+  const double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const double peakMemory = GetPeakResidentSetSize();
+
+  // the first frame is the origin of the trajectory, which starts with the second one
+  vtkSmartPointer<vtkTemporalTransforms> trajectory = vtkTemporalTransforms::CreateFromPolyData(slam->GetOutput(1));
+  vtkTable* profiling = vtkTable::SafeDownCast(slam->GetOutputDataObject(5));
+
+  Poses estimated;
+  Poses reference;
+  if (!referencePoses.empty())
+  {
+    estimated.push_back(Eigen::Isometry3d::Identity());
+    reference.push_back(referencePoses[0]);
+    for (vtkIdType index = 0; index < trajectory->GetNumberOfPoints() &&
+                              static_cast<size_t>(index + 1) < referencePoses.size(); ++index)
+    {
+      estimated.push_back(GetPose(trajectory, index));
+      reference.push_back(referencePoses[index + 1]);
+    }
+  }
+  else if (referenceTrajectory)
+  {
+    vtkDataArray* times = trajectory->GetTimeArray();
+    vtkDataArray* referenceTimes = referenceTrajectory->GetTimeArray();
+    vtkIdType closest = 0;
+    for (vtkIdType index = 0; index < trajectory->GetNumberOfPoints(); ++index)
+    {
+      // the frames and the reference poses are both sorted by time
+      const double time = times->GetTuple1(index);
+      while (closest + 1 < referenceTrajectory->GetNumberOfPoints() &&
+             std::abs(referenceTimes->GetTuple1(closest + 1) - time) <= std::abs(referenceTimes->GetTuple1(closest) - time))
+      {
+        closest++;
+      }
+      if (std::abs(referenceTimes->GetTuple1(closest) - time) < MaximumTimeDifference)
+      {
+        estimated.push_back(GetPose(trajectory, index));
+        reference.push_back(GetPose(referenceTrajectory, closest));
+      }
+    }
+  }
+
+  std::ofstream json(resultFileName.c_str());
+  if (!json.is_open())
+  {
+    std::cerr << "Cannot create " << resultFileName << std::endl;
+    return 1;
+  }
+  json << std::setprecision(6) << std::fixed;
+  json << "{\n"
+       << "  \"dataset\": \"" << dataset << "\",\n"
+       << "  \"format\": \"" << format << "\",\n"
+       << "  \"frames\": " << numberOfFrames << ",\n"
+       << "  \"wall_time_s\": " << wallTime << ",\n"
+       << "  \"frames_per_second\": " << numberOfFrames / wallTime << ",\n"
+       << "  \"peak_rss_mb\": " << peakMemory << ",\n"
+       << "  \"latency_ms\": {\n";
+  WriteLatency(json, "keypoints_extraction", profiling, "Time: keypoints extraction", false);
+  WriteLatency(json, "ego_motion", profiling, "Time: ego-motion", false);
+  WriteLatency(json, "mapping", profiling, "Time: mapping", false);
+  WriteLatency(json, "frame", profiling, "Time: frame", true);
+  json << "  },\n";
+
+  if (estimated.size() < 2)
+  {
+    json << "  \"accuracy\": null\n";
+  }
+  else
+  {
+    json << "  \"accuracy\": {\n"
+         << "    \"matched_poses\": " << estimated.size() << ",\n"
+         << "    \"ate_rmse_m\": " << ComputeAbsoluteTrajectoryError(estimated, reference) << ",\n"
+         << "    \"rpe\": [\n";
+    for (size_t k = 0; k < RelativePoseDeltas.size(); ++k)
+    {
+      double translationError, rotationError;
+      size_t count;
+      ComputeRelativePoseError(estimated, reference, RelativePoseDeltas[k], translationError, rotationError, count);
+      json << "      { \"delta_frames\": " << RelativePoseDeltas[k] << ", \"pairs\": " << count
+           << ", \"translation_rmse_m\": " << translationError << ", \"rotation_rmse_deg\": " << rotationError << " }"
+           << (k + 1 < RelativePoseDeltas.size() ? "," : "") << "\n";
+    }
+    json << "    ]\n"
+         << "  }\n";
+  }
+  json << "}\n";
+
+  std::cout << "Slam processed " << numberOfFrames << " frames at " << numberOfFrames / wallTime
+            << " frames/s, results written to " << resultFileName << std::endl;
+  return 0;
+}
@@ -0,0 +1,245 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Measure the throughput of the Velodyne decoding on a recording and write it as JSON:
+//
+//   BenchmarkVelodyneDecoding <result.json> <pcapFileName> <correctionFileName>
+//
+// The lidar packets are loaded in memory, then indexed with PreProcessPacket and decoded with
+// ProcessPacket, with the default options then with cropping, a sensor transform, the
+// intensity correction and, for dual return recordings, the filtering of the returns. The
+// latency of vtkLidarReader::GetFrame is measured without the frame cache.
+
+#include "vtkLidarReader.h"
+#include "vtkPacketFileReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+const int NumberOfRepetitions = 5;
+const int NumberOfMeasuredFrames = 10;
+
+//-----------------------------------------------------------------------------
+// Median duration in seconds of the repetitions of a measure
+double Measure(const std::function<void()>& measure, int numberOfRepetitions = NumberOfRepetitions)
+{
+  std::vector<double> durations;
+  for (int repetition = 0; repetition < numberOfRepetitions; ++repetition)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    measure();
+    durations.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  std::sort(durations.begin(), durations.end());
+  return durations[durations.size() / 2];
+}
+
+//-----------------------------------------------------------------------------
+// Index the packets as vtkLidarReader does when the file is opened
+int PreProcessPackets(vtkLidarPacketInterpreter* interpreter,
+  const std::vector<std::vector<unsigned char> >& packets)
+{
+  interpreter->ResetPreProcessing();
+  int numberOfFrames = 0;
+  for (const std::vector<unsigned char>& packet : packets)
+  {
+    bool isNewFrame = false;
+    int framePositionInPacket = 0;
+    interpreter->PreProcessPacket(packet.data(), static_cast<unsigned int>(packet.size()),
+      isNewFrame, framePositionInPacket);
+    numberOfFrames += isNewFrame;
+  }
+  return numberOfFrames;
+}
+
+//-----------------------------------------------------------------------------
+// Decode all the packets, return the number of points of the frames
+vtkIdType ProcessPackets(vtkLidarPacketInterpreter* interpreter,
+  const std::vector<std::vector<unsigned char> >& packets)
+{
+  interpreter->ResetCurrentFrame();
+  interpreter->ClearAllFramesAvailable();
+  vtkIdType numberOfPoints = 0;
+  for (const std::vector<unsigned char>& packet : packets)
+  {
+    interpreter->ProcessPacket(packet.data(), static_cast<unsigned int>(packet.size()));
+    if (interpreter->IsNewFrameReady())
+    {
+      numberOfPoints += interpreter->GetLastFrameAvailable()->GetNumberOfPoints();
+      interpreter->ClearAllFramesAvailable();
+    }
+  }
+  return numberOfPoints;
+}
+
+//-----------------------------------------------------------------------------
+void WriteThroughput(std::ostream& json, const std::string& name, double duration,
+  size_t numberOfPackets, vtkIdType numberOfPoints, bool last)
+{
+  json << "    \"" << name << "\": { \"median_ms\": " << 1000.0 * duration
+       << ", \"packets_per_second\": " << numberOfPackets / std::max(duration, 1e-9)
+       << ", \"points_per_second\": " << numberOfPoints / std::max(duration, 1e-9) << " }"
+       << (last ? "" : ",") << "\n";
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 4)
+  {
+    std::cerr << "Usage: BenchmarkVelodyneDecoding <result.json> <pcapFileName> <correctionFileName>" << std::endl;
+    return 1;
+  }
+  const std::string pcapFileName = argv[2];
+  const std::string correctionFileName = argv[3];
+
+  auto interpreter = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  if (!correctionFileName.empty())
+  {
+    interpreter->LoadCalibration(correctionFileName);
+  }
+
+  // the packets are read once, so that the measures do not depend on the disk
+  vtkPacketFileReader fileReader;
+  if (!fileReader.Open(pcapFileName))
+  {
+    std::cerr << "Cannot open " << pcapFileName << ": " << fileReader.GetLastError() << std::endl;
+    return 1;
+  }
+  std::vector<std::vector<unsigned char> > packets;
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  while (fileReader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    if (interpreter->IsLidarPacket(data, dataLength))
+    {
+      packets.push_back(std::vector<unsigned char>(data, data + dataLength));
+    }
+  }
+  fileReader.Close();
+  if (packets.empty())
+  {
+    std::cerr << "No lidar packet in " << pcapFileName << std::endl;
+    return 1;
+  }
+
+  // indexing, which also calibrates the interpreter from the stream when there is no file
+  int numberOfFrames = 0;
+  const double preProcess = Measure([&] { numberOfFrames = PreProcessPackets(interpreter, packets); });
+  if (!interpreter->GetIsCalibrated())
+  {
+    std::cerr << "The interpreter is not calibrated" << std::endl;
+    return 1;
+  }
+
+  vtkIdType numberOfPoints = 0;
+  const double process = Measure([&] { numberOfPoints = ProcessPackets(interpreter, packets); });
+
+  // the crop keeps the points in a 20 m box around the sensor
+  interpreter->SetCropMode(vtkLidarPacketInterpreter::Cartesian);
+  interpreter->SetCropOutside(true);
+  interpreter->SetCropRegion(-10, 10, -10, 10, -10, 10);
+  vtkIdType numberOfCroppedPoints = 0;
+  const double processCropped = Measure([&] { numberOfCroppedPoints = ProcessPackets(interpreter, packets); });
+  interpreter->SetCropMode(vtkLidarPacketInterpreter::None);
+
+  vtkNew<vtkTransform> transform;
+  transform->Translate(1.0, 2.0, 3.0);
+  transform->RotateZ(30.0);
+  interpreter->SetSensorTransform(transform.GetPointer());
+  interpreter->SetApplyTransform(true);
+  const double processTransformed = Measure([&] { ProcessPackets(interpreter, packets); });
+  interpreter->SetApplyTransform(false);
+
+  // only the HDL-64 packets are corrected, the other sensors measure the cost of the check
+  interpreter->SetWantIntensityCorrection(true);
+  const double processIntensityCorrected = Measure([&] { ProcessPackets(interpreter, packets); });
+  interpreter->SetWantIntensityCorrection(false);
+
+  const bool hasDualReturn = interpreter->GetHasDualReturn();
+  double processDualFiltered = 0;
+  vtkIdType numberOfDualFilteredPoints = 0;
+  if (hasDualReturn)
+  {
+    interpreter->SetDualReturnFilter(vtkVelodynePacketInterpreter::DUAL_DISTANCE_NEAR);
+    processDualFiltered = Measure([&] { numberOfDualFilteredPoints = ProcessPackets(interpreter, packets); });
+    interpreter->SetDualReturnFilter(0);
+  }
+
+  // latency of a frame requested alone, as when seeking in the application
+  vtkNew<vtkLidarReader> reader;
+  reader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+  reader->SetFileName(pcapFileName);
+  reader->SetCalibrationFileName(correctionFileName);
+  reader->SetFrameCacheSize(0);
+  reader->Update();
+  const int numberOfReaderFrames = reader->GetNumberOfFrames();
+  std::vector<double> frameLatencies;
+  for (int i = 0; i < std::min(NumberOfMeasuredFrames, numberOfReaderFrames); ++i)
+  {
+    const int frame = static_cast<int>((static_cast<long long>(i) * numberOfReaderFrames) / NumberOfMeasuredFrames);
+    frameLatencies.push_back(Measure([&] { reader->GetFrame(frame); }, 3));
+  }
+  std::sort(frameLatencies.begin(), frameLatencies.end());
+  const double getFrame = frameLatencies.empty() ? 0 : frameLatencies[frameLatencies.size() / 2];
+
+  std::string resultFileName = argv[1];
+  std::ofstream json(resultFileName.c_str());
+  if (!json.is_open())
+  {
+    std::cerr << "Cannot create " << resultFileName << std::endl;
+    return 1;
+  }
+  json << std::setprecision(6) << std::fixed;
+  json << "{\n"
+       << "  \"sensor\": \"" << interpreter->GetSensorInformation() << "\",\n"
+       << "  \"packets\": " << packets.size() << ",\n"
+       << "  \"frames\": " << numberOfFrames << ",\n"
+       << "  \"points\": " << numberOfPoints << ",\n"
+       << "  \"dual_return\": " << (hasDualReturn ? "true" : "false") << ",\n"
+       << "  \"throughput\": {\n";
+  WriteThroughput(json, "preprocess_packet", preProcess, packets.size(), 0, false);
+  WriteThroughput(json, "process_packet", process, packets.size(), numberOfPoints, false);
+  WriteThroughput(json, "process_packet_cropped", processCropped, packets.size(), numberOfCroppedPoints, false);
+  WriteThroughput(json, "process_packet_transformed", processTransformed, packets.size(), numberOfPoints, false);
+  WriteThroughput(json, "process_packet_intensity_corrected", processIntensityCorrected, packets.size(), numberOfPoints, !hasDualReturn);
+  if (hasDualReturn)
+  {
+    WriteThroughput(json, "process_packet_dual_filtered", processDualFiltered, packets.size(), numberOfDualFilteredPoints, true);
+  }
+  json << "  },\n"
+       << "  \"get_frame_median_ms\": " << 1000.0 * getFrame << "\n"
+       << "}\n";
+
+  return 0;
+}
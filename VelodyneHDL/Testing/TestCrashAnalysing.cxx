@@ -0,0 +1,88 @@
+#include "CrashAnalysing.h"
+#include "vtkPacketFileReader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+// Add packets holding their index, more than the ring can store, and check that only the
+// newest ones are dumped, in order
+int TestRing()
+{
+  int nbrErrors = 0;
+  const unsigned int numberOfSlots = 16;
+  const unsigned int numberOfPackets = 2 * numberOfSlots + 3;
+  const std::string filename = "TestCrashAnalysing";
+  {
+    CrashAnalysisWriter writer;
+    writer.SetNbrPacketsToStore(numberOfSlots);
+    writer.SetFilename(filename);
+    for (unsigned int i = 0; i < numberOfPackets; ++i)
+    {
+      unsigned char data[1206] = { 0 };
+      std::memcpy(data, &i, sizeof(i));
+      writer.AddPacket(data, sizeof(data));
+    }
+    // the ring is left on the disk as after a crash
+  }
+
+  if (!CrashAnalysisWriter::DumpRing(filename + "Ring.bin", filename + ".pcap"))
+  {
+    std::cerr << "Failed to dump the ring" << std::endl;
+    return 1;
+  }
+
+  vtkPacketFileReader reader;
+  if (!reader.Open(filename + ".pcap", true))
+  {
+    std::cerr << "Failed to open the dumped ring" << std::endl;
+    return 1;
+  }
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  unsigned int expected = numberOfPackets - numberOfSlots;
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    unsigned int index = 0;
+    std::memcpy(&index, data, sizeof(index));
+    if (dataLength != 1206 || index != expected)
+    {
+      std::cerr << "Wrong packet dumped: " << index << ", expected: " << expected << std::endl;
+      nbrErrors++;
+      break;
+    }
+    expected++;
+  }
+  reader.Close();
+  if (expected != numberOfPackets)
+  {
+    std::cerr << "Wrong number of packets dumped: "
+              << expected - (numberOfPackets - numberOfSlots) << std::endl;
+    nbrErrors++;
+  }
+  std::remove((filename + ".pcap").c_str());
+
+  // the ring of a previous session is archived then deleted
+  CrashAnalysisWriter writer;
+  writer.SetFilename(filename);
+  const std::string archiveName = writer.ArchivePreviousLogIfExist();
+  if (archiveName.empty() || !std::ifstream(archiveName.c_str()).good() ||
+    std::ifstream((filename + "Ring.bin").c_str()).good())
+  {
+    std::cerr << "The previous ring has not been archived" << std::endl;
+    nbrErrors++;
+  }
+  std::remove(archiveName.c_str());
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestRing();
+  return nbrErrors;
+}
@@ -0,0 +1,205 @@
+#include "DecodedFrameFile.h"
+
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkFieldData.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+//-----------------------------------------------------------------------------
+void WriteDummyFile(const std::string& filename, int size)
+{
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+  for (int i = 0; i < size; ++i)
+  {
+    file.put(static_cast<char>(i));
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Create a frame of numberOfPoints points whose values depend on the frame index
+vtkSmartPointer<vtkPolyData> CreateFrame(int frameIndex, int numberOfPoints)
+{
+  vtkSmartPointer<vtkPolyData> frame = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToFloat();
+  vtkNew<vtkUnsignedCharArray> intensity;
+  intensity->SetName("intensity");
+  vtkNew<vtkDoubleArray> time;
+  time->SetName("adjustedtime");
+  for (int i = 0; i < numberOfPoints; ++i)
+  {
+    points->InsertNextPoint(frameIndex, i, 0.5 * i);
+    intensity->InsertNextValue(static_cast<unsigned char>(i + frameIndex));
+    time->InsertNextValue(1e9 + 100 * frameIndex + i);
+  }
+  frame->SetPoints(points.GetPointer());
+  frame->GetPointData()->AddArray(intensity.GetPointer());
+  frame->GetPointData()->AddArray(time.GetPointer());
+
+  vtkNew<vtkDoubleArray> rpm;
+  rpm->SetName("RotationPerMinute");
+  rpm->InsertNextValue(600 + frameIndex);
+  frame->GetFieldData()->AddArray(rpm.GetPointer());
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+int CheckFrame(vtkPolyData* frame, int frameIndex, int numberOfPoints)
+{
+  vtkDataArray* intensity = frame ? frame->GetPointData()->GetArray("intensity") : nullptr;
+  vtkDataArray* time = frame ? frame->GetPointData()->GetArray("adjustedtime") : nullptr;
+  vtkDataArray* rpm = frame ? frame->GetFieldData()->GetArray("RotationPerMinute") : nullptr;
+  if (!frame || frame->GetNumberOfPoints() != numberOfPoints || !intensity || !time || !rpm ||
+    frame->GetPoints()->GetDataType() != VTK_FLOAT ||
+    intensity->GetDataType() != VTK_UNSIGNED_CHAR || rpm->GetTuple1(0) != 600 + frameIndex)
+  {
+    std::cerr << "Frame " << frameIndex << " has not been restored" << std::endl;
+    return 1;
+  }
+  for (int i = 0; i < numberOfPoints; ++i)
+  {
+    double point[3];
+    frame->GetPoint(i, point);
+    if (point[0] != frameIndex || point[1] != i || point[2] != 0.5 * i ||
+      intensity->GetTuple1(i) != static_cast<unsigned char>(i + frameIndex) ||
+      time->GetTuple1(i) != 1e9 + 100 * frameIndex + i)
+    {
+      std::cerr << "Point " << i << " of frame " << frameIndex << " does not match" << std::endl;
+      return 1;
+    }
+  }
+  if (frame->GetNumberOfVerts() != numberOfPoints)
+  {
+    std::cerr << "Vertices of frame " << frameIndex << " have not been restored" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestRoundTrip(const std::string& filename)
+{
+  int nbrErrors = 0;
+  const int numberOfFrames = 4;
+
+  DecodedFrameFileWriter writer;
+  if (!writer.Open(filename, "key"))
+  {
+    std::cerr << "Failed to open the writer: " << writer.GetLastError() << std::endl;
+    return 1;
+  }
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    vtkSmartPointer<vtkPolyData> frame = CreateFrame(i, 100 * i + 1);
+    frame->SetVerts(vtkSmartPointer<vtkCellArray>::New());
+    for (vtkIdType j = 0; j < frame->GetNumberOfPoints(); ++j)
+    {
+      frame->GetVerts()->InsertNextCell(1, &j);
+    }
+    if (!writer.WriteFrame(frame))
+    {
+      std::cerr << "Failed to write frame " << i << ": " << writer.GetLastError() << std::endl;
+      return 1;
+    }
+  }
+  if (!writer.Close())
+  {
+    std::cerr << "Failed to write the frames: " << writer.GetLastError() << std::endl;
+    return 1;
+  }
+
+  DecodedFrameFile file;
+  if (!file.Open(filename, "key") || file.GetNumberOfFrames() != numberOfFrames)
+  {
+    std::cerr << "Failed to open the frames: " << file.GetLastError() << std::endl;
+    return 1;
+  }
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    nbrErrors += CheckFrame(file.GetFrame(i), i, 100 * i + 1);
+  }
+
+  // the arrays use the mapped columns, they are not copied
+  vtkSmartPointer<vtkPolyData> first = file.GetFrame(2);
+  vtkSmartPointer<vtkPolyData> second = file.GetFrame(2);
+  if (first->GetPoints()->GetVoidPointer(0) != second->GetPoints()->GetVoidPointer(0) ||
+    first->GetPointData()->GetArray("intensity")->GetVoidPointer(0) !=
+      second->GetPointData()->GetArray("intensity")->GetVoidPointer(0))
+  {
+    std::cerr << "The frame columns have been copied" << std::endl;
+    nbrErrors++;
+  }
+
+  // the frames remain valid once the file is closed
+  file.Close();
+  nbrErrors += CheckFrame(first, 2, 201);
+
+  // a file written with other settings must be rejected
+  if (file.Open(filename, "other key"))
+  {
+    std::cerr << "Frames written with another key have been accepted" << std::endl;
+    nbrErrors++;
+  }
+
+  // the file is modified below, its mapping must be released
+  first = nullptr;
+  second = nullptr;
+
+  // an incomplete file must be rejected
+  const std::string decodedFileName = DecodedFrameFile::GetDecodedFrameFileName(filename);
+  std::string content;
+  {
+    std::ifstream stream(decodedFileName.c_str(), std::ios::in | std::ios::binary);
+    content.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream stream(decodedFileName.c_str(), std::ios::out | std::ios::binary);
+    stream.write(content.data(), content.size() - 10);
+  }
+  if (file.Open(filename, "key"))
+  {
+    std::cerr << "Truncated file has been accepted" << std::endl;
+    nbrErrors++;
+  }
+
+  // a file older than the pcap must be rejected
+  {
+    std::ofstream stream(decodedFileName.c_str(), std::ios::out | std::ios::binary);
+    stream.write(content.data(), content.size());
+  }
+  if (!file.Open(filename, "key"))
+  {
+    std::cerr << "Restored file has been rejected: " << file.GetLastError() << std::endl;
+    nbrErrors++;
+  }
+  file.Close();
+  WriteDummyFile(filename, 10);
+  if (file.Open(filename, "key"))
+  {
+    std::cerr << "Stale file has been accepted" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  const std::string filename = "TestDecodedFrameFile.pcap";
+  std::remove(filename.c_str());
+  WriteDummyFile(filename, 1000);
+
+  int nbrErrors = TestRoundTrip(filename);
+
+  std::remove(filename.c_str());
+  std::remove(DecodedFrameFile::GetDecodedFrameFileName(filename).c_str());
+  return nbrErrors;
+}
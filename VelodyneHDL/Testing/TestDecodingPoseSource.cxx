@@ -0,0 +1,104 @@
+// Decode the frames of a pcap with and without a pose source moving the sensor by a constant
+// translation, the points decoded with the pose source must be the other ones translated.
+
+#include "vtkLidarReader.h"
+#include "vtkTemporalTransforms.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <cmath>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> UpdateFrame(vtkLidarReader* reader, int index)
+{
+  reader->UpdateInformation();
+  vtkInformation* outInfo = reader->GetExecutive()->GetOutputInformation(0);
+  double* timeSteps = outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(), timeSteps[index]);
+  reader->Update();
+  vtkSmartPointer<vtkPolyData> frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->DeepCopy(vtkPolyData::SafeDownCast(reader->GetOutputDataObject(0)));
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: TestDecodingPoseSource <pcapFileName> <correctionFileName>" << std::endl;
+    return 1;
+  }
+
+  vtkNew<vtkLidarReader> reader;
+  vtkNew<vtkVelodynePacketInterpreter> interpreter;
+  reader->SetInterpreter(interpreter.GetPointer());
+  reader->SetFileName(argv[1]);
+  reader->SetCalibrationFileName(argv[2]);
+  reader->Update();
+  const int numberOfFrames = reader->GetNumberOfFrames();
+  if (numberOfFrames < 1)
+  {
+    std::cerr << "The reader has no frame" << std::endl;
+    return 1;
+  }
+  const int frameIndex = numberOfFrames / 2;
+  vtkSmartPointer<vtkPolyData> reference = UpdateFrame(reader.GetPointer(), frameIndex);
+
+  // the trajectory covers any time of the pcap
+  const Eigen::Vector3d translation(1.5, -2., 0.25);
+  vtkNew<vtkTemporalTransforms> trajectory;
+  trajectory->PushBack(-1e6, Eigen::AngleAxisd::Identity(), translation);
+  trajectory->PushBack(1e6, Eigen::AngleAxisd::Identity(), translation);
+  interpreter->SetPoseSource(trajectory.GetPointer());
+  reader->Modified();
+  vtkSmartPointer<vtkPolyData> moved = UpdateFrame(reader.GetPointer(), frameIndex);
+
+  const vtkIdType numberOfPoints = reference->GetNumberOfPoints();
+  if (numberOfPoints == 0 || moved->GetNumberOfPoints() != numberOfPoints)
+  {
+    std::cerr << "Frame " << frameIndex << ": " << moved->GetNumberOfPoints()
+              << " points with the pose source instead of " << numberOfPoints << std::endl;
+    return 1;
+  }
+  int nbrErrors = 0;
+  for (vtkIdType i = 0; i < numberOfPoints && nbrErrors < 10; ++i)
+  {
+    double x[3], y[3];
+    reference->GetPoint(i, x);
+    moved->GetPoint(i, y);
+    for (int k = 0; k < 3; ++k)
+    {
+      if (std::abs(y[k] - x[k] - translation(k)) > 1e-4)
+      {
+        std::cerr << "Point " << i << ": (" << y[0] << ", " << y[1] << ", " << y[2]
+                  << ") instead of (" << x[0] + translation(0) << ", " << x[1] + translation(1)
+                  << ", " << x[2] + translation(2) << ")" << std::endl;
+        nbrErrors++;
+        break;
+      }
+    }
+  }
+
+  // without pose source the points are back in the referential of the sensor
+  interpreter->SetPoseSource(nullptr);
+  reader->Modified();
+  vtkSmartPointer<vtkPolyData> restored = UpdateFrame(reader.GetPointer(), frameIndex);
+  double x[3], y[3];
+  reference->GetPoint(0, x);
+  restored->GetPoint(0, y);
+  if (restored->GetNumberOfPoints() != numberOfPoints || x[0] != y[0] || x[1] != y[1] ||
+    x[2] != y[2])
+  {
+    std::cerr << "The points are still moved once the pose source is removed" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
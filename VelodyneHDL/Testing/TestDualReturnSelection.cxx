@@ -0,0 +1,165 @@
+// Decode the frames of a dual return pcap, select some first returns of a frame, and check that
+// the dual_return_selected array of the frames marks their dual returns only, in the frame where
+// they were selected and in the next one.
+
+#include "LidarDecodingKernels.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkDataArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedShortArray.h>
+
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> UpdateFrame(vtkLidarReader* reader, int index)
+{
+  reader->UpdateInformation();
+  vtkInformation* outInfo = reader->GetExecutive()->GetOutputInformation(0);
+  double* timeSteps = outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(), timeSteps[index]);
+  reader->Update();
+  vtkSmartPointer<vtkPolyData> frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->DeepCopy(vtkPolyData::SafeDownCast(reader->GetOutputDataObject(0)));
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+vtkIdType CountMarked(vtkPolyData* frame, vtkDataArray*& mask)
+{
+  mask = frame->GetPointData()->GetArray(DualReturnSelection::MaskName);
+  vtkIdType count = 0;
+  for (vtkIdType i = 0; mask && i < mask->GetNumberOfTuples(); ++i)
+  {
+    count += mask->GetTuple1(i) != 0;
+  }
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: TestDualReturnSelection <pcapFileName> <correctionFileName>"
+              << std::endl;
+    return 1;
+  }
+
+  vtkNew<vtkLidarReader> reader;
+  vtkNew<vtkVelodynePacketInterpreter> interpreter;
+  reader->SetInterpreter(interpreter.GetPointer());
+  reader->SetFileName(argv[1]);
+  reader->SetCalibrationFileName(argv[2]);
+  reader->Update();
+  const int numberOfFrames = reader->GetNumberOfFrames();
+  if (numberOfFrames < 2 || !interpreter->GetHasDualReturn())
+  {
+    std::cerr << "The reader has no dual return frames" << std::endl;
+    return 1;
+  }
+  const int frameIndex = numberOfFrames / 2 - 1;
+
+  // without selection, no return is marked
+  interpreter->SetShouldAddDualReturnArray(true);
+  vtkSmartPointer<vtkPolyData> frame = UpdateFrame(reader.GetPointer(), frameIndex);
+  vtkDataArray* mask = nullptr;
+  if (CountMarked(frame, mask) != 0 || !mask ||
+    mask->GetNumberOfTuples() != frame->GetNumberOfPoints())
+  {
+    std::cerr << "Wrong dual_return_selected array without selection" << std::endl;
+    return 1;
+  }
+
+  // select some first returns of a dual return, as an extracted selection gives them
+  vtkPointData* pointData = frame->GetPointData();
+  vtkDataArray* laserIds = pointData->GetArray("laser_id");
+  vtkDataArray* azimuths = pointData->GetArray("azimuth");
+  vtkDataArray* matching = pointData->GetArray("dual_return_matching");
+  if (!laserIds || !azimuths || !matching)
+  {
+    std::cerr << "Missing laser_id, azimuth or dual_return_matching array" << std::endl;
+    return 1;
+  }
+  vtkNew<vtkPolyData> selection;
+  vtkNew<vtkPoints> selectedPoints;
+  vtkNew<vtkUnsignedCharArray> selectedLaserIds;
+  selectedLaserIds->SetName("laser_id");
+  vtkNew<vtkUnsignedShortArray> selectedAzimuths;
+  selectedAzimuths->SetName("azimuth");
+  vtkNew<vtkIdTypeArray> selectedMatching;
+  selectedMatching->SetName("dual_return_matching");
+  vtkNew<vtkIdTypeArray> originalIds;
+  originalIds->SetName("vtkOriginalPointIds");
+  for (vtkIdType i = 0; i < frame->GetNumberOfPoints(); i += 97)
+  {
+    const vtkIdType dual = static_cast<vtkIdType>(matching->GetTuple1(i));
+    if (dual <= i)
+    {
+      continue;
+    }
+    selectedPoints->InsertNextPoint(frame->GetPoint(i));
+    selectedLaserIds->InsertNextValue(static_cast<unsigned char>(laserIds->GetTuple1(i)));
+    selectedAzimuths->InsertNextValue(static_cast<unsigned short>(azimuths->GetTuple1(i)));
+    selectedMatching->InsertNextValue(dual);
+    originalIds->InsertNextValue(i);
+  }
+  const vtkIdType numberOfSelected = originalIds->GetNumberOfValues();
+  if (numberOfSelected == 0)
+  {
+    std::cerr << "Frame " << frameIndex << " has no dual return" << std::endl;
+    return 1;
+  }
+  selection->SetPoints(selectedPoints.GetPointer());
+  selection->GetPointData()->AddArray(selectedLaserIds.GetPointer());
+  selection->GetPointData()->AddArray(selectedAzimuths.GetPointer());
+  selection->GetPointData()->AddArray(selectedMatching.GetPointer());
+  selection->GetPointData()->AddArray(originalIds.GetPointer());
+  interpreter->SetSelectedPointsWithDualReturn(selection.GetPointer());
+
+  // the dual returns of the selected returns are marked, not the selected returns
+  int nbrErrors = 0;
+  frame = UpdateFrame(reader.GetPointer(), frameIndex);
+  const vtkIdType numberOfMarked = CountMarked(frame, mask);
+  for (vtkIdType k = 0; mask && k < numberOfSelected; ++k)
+  {
+    const vtkIdType id = originalIds->GetValue(k);
+    if (mask->GetTuple1(id) != 0 || mask->GetTuple1(selectedMatching->GetValue(k)) != 1)
+    {
+      std::cerr << "Point " << id << ": wrong dual_return_selected values" << std::endl;
+      nbrErrors++;
+    }
+  }
+  if (numberOfMarked < numberOfSelected)
+  {
+    std::cerr << numberOfMarked << " returns marked for " << numberOfSelected
+              << " selected returns" << std::endl;
+    nbrErrors++;
+  }
+
+  // the selection holds in the next frame, where the returns have other ids
+  vtkSmartPointer<vtkPolyData> nextFrame = UpdateFrame(reader.GetPointer(), frameIndex + 1);
+  if (CountMarked(nextFrame, mask) == 0)
+  {
+    std::cerr << "No return marked in the next frame" << std::endl;
+    nbrErrors++;
+  }
+
+  interpreter->SetSelectedPointsWithDualReturn(nullptr);
+  frame = UpdateFrame(reader.GetPointer(), frameIndex);
+  if (CountMarked(frame, mask) != 0)
+  {
+    std::cerr << "Returns are still marked once the selection is cleared" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
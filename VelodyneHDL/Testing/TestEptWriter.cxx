@@ -0,0 +1,145 @@
+#include "EptWriter.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+const size_t RecordSize = 23;
+
+//-----------------------------------------------------------------------------
+//! Points of a sensor driving along x, on a ground plane and a wall
+std::vector<EptWriter::Point> CreatePoints(size_t numberOfPoints)
+{
+  std::vector<EptWriter::Point> points(numberOfPoints);
+  for (size_t n = 0; n < numberOfPoints; ++n)
+  {
+    const double t = static_cast<double>(n) / numberOfPoints;
+    EptWriter::Point& point = points[n];
+    point.Position[0] = 1000. * t + std::cos(0.37 * n) * 20.;
+    point.Position[1] = n % 3 == 0 ? 15. : std::sin(0.37 * n) * 20.;
+    point.Position[2] = n % 3 == 0 ? std::fmod(0.01 * n, 5.) : -1.8;
+    point.Time = t;
+    point.Intensity = static_cast<unsigned short>(n % 256);
+    point.UserData = static_cast<unsigned char>(n % 32);
+  }
+  return points;
+}
+
+//-----------------------------------------------------------------------------
+//! Read the counts of the nodes from the hierarchy file
+std::map<std::string, long long> ReadHierarchy(const fs::path& directory)
+{
+  std::map<std::string, long long> counts;
+  std::ifstream stream((directory / "ept-hierarchy" / "0-0-0-0.json").string().c_str());
+  std::string line;
+  while (std::getline(stream, line))
+  {
+    const size_t begin = line.find('"');
+    const size_t end = line.find('"', begin + 1);
+    const size_t colon = line.find(':', end);
+    if (begin != std::string::npos && end != std::string::npos && colon != std::string::npos)
+    {
+      counts[line.substr(begin + 1, end - begin - 1)] = std::stoll(line.substr(colon + 1));
+    }
+  }
+  return counts;
+}
+
+//-----------------------------------------------------------------------------
+int TestDataset(const fs::path& directory, size_t maximumBufferedPoints)
+{
+  int nbrErrors = 0;
+  const size_t numberOfPoints = 200000;
+  const std::vector<EptWriter::Point> points = CreatePoints(numberOfPoints);
+
+  {
+    EptWriter writer;
+    writer.SetScale(1e-3, 1e-3);
+    writer.SetSpan(16);
+    writer.SetInitialSize(10.);
+    writer.SetMaximumBufferedPoints(maximumBufferedPoints);
+    writer.SetNumberOfThreads(4);
+    if (!writer.Open(directory.string()))
+    {
+      std::cerr << writer.GetLastError() << std::endl;
+      return 1;
+    }
+    // the points arrive by frames
+    for (size_t n = 0; n < numberOfPoints; n += 1000)
+    {
+      if (!writer.Add(&points[n], 1000))
+      {
+        std::cerr << writer.GetLastError() << std::endl;
+        return 1;
+      }
+    }
+    if (!writer.Close())
+    {
+      std::cerr << writer.GetLastError() << std::endl;
+      return 1;
+    }
+  }
+
+  if (!fs::exists(directory / "ept.json") || fs::exists(directory / "ept-tmp"))
+  {
+    std::cerr << "The metadata is missing or the temporary files remain" << std::endl;
+    nbrErrors++;
+  }
+
+  // each point is in one node, whose data file holds its points
+  const std::map<std::string, long long> counts = ReadHierarchy(directory);
+  long long total = 0;
+  int maximumDepth = 0;
+  for (const auto& node : counts)
+  {
+    total += node.second;
+    maximumDepth = std::max(maximumDepth, std::stoi(node.first));
+    const fs::path data = directory / "ept-data" / (node.first + ".bin");
+    boost::system::error_code error;
+    const boost::uintmax_t size = fs::file_size(data, error);
+    if (error || size != node.second * RecordSize)
+    {
+      std::cerr << "Wrong size of the node " << node.first << std::endl;
+      nbrErrors++;
+    }
+  }
+  if (total != static_cast<long long>(numberOfPoints) || counts.count("0-0-0-0") == 0)
+  {
+    std::cerr << "The hierarchy has " << total << " points instead of " << numberOfPoints
+              << std::endl;
+    nbrErrors++;
+  }
+  // the root has been doubled to contain the kilometer of the survey
+  if (maximumDepth < 7)
+  {
+    std::cerr << "The octree is too shallow: " << maximumDepth << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  const fs::path directory = fs::temp_directory_path() / fs::unique_path("TestEptWriter-%%%%%%");
+  int nbrErrors = 0;
+
+  // everything in memory, then with spills to the temporary files
+  nbrErrors += TestDataset(directory / "memory", 1 << 24);
+  nbrErrors += TestDataset(directory / "spilled", 5000);
+
+  boost::system::error_code error;
+  fs::remove_all(directory, error);
+  return nbrErrors;
+}
@@ -0,0 +1,101 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Export the frames of a pcap to VTP and CSV files with several threads, then
+// compare the files with the frames given by the reader one at a time.
+
+#include "TestHelpers.h"
+#include "vtkFrameBatchExporter.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkXMLPolyDataReader.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 4)
+  {
+    std::cerr << "Usage: TestFrameBatchExporter <pcapFileName> <correctionFileName> <outputDirectory>" << std::endl;
+    return 1;
+  }
+
+  vtkNew<vtkLidarReader> reader;
+  auto interpreter = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  reader->SetInterpreter(interpreter);
+  reader->SetFileName(argv[1]);
+  reader->SetCalibrationFileName(argv[2]);
+  reader->Update();
+  const int numberOfFrames = reader->GetNumberOfFrames();
+  if (numberOfFrames == 0)
+  {
+    std::cerr << "The reader has no frame" << std::endl;
+    return 1;
+  }
+
+  const std::string outputDirectory = argv[3];
+  vtkFrameBatchExporter vtpExporter(vtkFrameBatchExporter::VTP, outputDirectory + "/TestFrameBatchExporter_%04d.vtp");
+  vtpExporter.SetNumberOfThreads(4);
+  vtkFrameBatchExporter csvExporter(vtkFrameBatchExporter::CSV, outputDirectory + "/TestFrameBatchExporter_%04d.csv");
+  csvExporter.SetNumberOfThreads(4);
+  if (!vtpExporter.ExportFrames(reader.GetPointer(), 0, numberOfFrames - 1) ||
+      !csvExporter.ExportFrames(reader.GetPointer(), 0, numberOfFrames - 1) ||
+      static_cast<int>(vtpExporter.GetFileNames().size()) != numberOfFrames)
+  {
+    std::cerr << "The export failed" << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = 0;
+  for (int frame = 0; frame < numberOfFrames; ++frame)
+  {
+    vtkPolyData* expected = GetCurrentFrame(reader.GetPointer(), frame);
+
+    vtkNew<vtkXMLPolyDataReader> vtpReader;
+    vtpReader->SetFileName(vtpExporter.GetFileName(frame).c_str());
+    vtpReader->Update();
+    vtkPolyData* written = vtpReader->GetOutput();
+    if (written->GetNumberOfPoints() != expected->GetNumberOfPoints() ||
+        written->GetPointData()->GetNumberOfArrays() != expected->GetPointData()->GetNumberOfArrays())
+    {
+      std::cerr << "Wrong VTP file for frame " << frame << std::endl;
+      nbrErrors++;
+    }
+
+    // a header line, then a line per point
+    std::ifstream csvFile(csvExporter.GetFileName(frame).c_str());
+    std::string line;
+    vtkIdType numberOfLines = 0;
+    while (std::getline(csvFile, line))
+    {
+      numberOfLines++;
+    }
+    if (numberOfLines != expected->GetNumberOfPoints() + 1)
+    {
+      std::cerr << "Wrong CSV file for frame " << frame << std::endl;
+      nbrErrors++;
+    }
+  }
+  return nbrErrors;
+}
@@ -0,0 +1,115 @@
+#include "FrameCache.h"
+
+#include <vtkNew.h>
+#include <vtkPoints.h>
+
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> CreateFrame(int numberOfPoints)
+{
+  vtkSmartPointer<vtkPolyData> frame = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(numberOfPoints);
+  frame->SetPoints(points.GetPointer());
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+int TestHitAndMiss()
+{
+  int nbrErrors = 0;
+  FrameCache cache;
+  cache.SetMemoryBudget(1024 * 1024);
+
+  vtkSmartPointer<vtkPolyData> frame = CreateFrame(1000);
+  cache.Add(3, 1, frame);
+  if (cache.Get(3, 1) != frame)
+  {
+    std::cerr << "Cached frame not returned" << std::endl;
+    nbrErrors++;
+  }
+  if (cache.Get(4, 1))
+  {
+    std::cerr << "Frame never added has been returned" << std::endl;
+    nbrErrors++;
+  }
+  if (cache.GetNumberOfHits() != 1 || cache.GetNumberOfMisses() != 1)
+  {
+    std::cerr << "Wrong statistics: " << cache.GetNumberOfHits() << " hits, "
+              << cache.GetNumberOfMisses() << " misses" << std::endl;
+    nbrErrors++;
+  }
+
+  // a frame produced with other settings must not be returned
+  if (cache.Get(3, 2) || cache.GetNumberOfFrames() != 0)
+  {
+    std::cerr << "Frame returned for another modification time" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestEviction()
+{
+  int nbrErrors = 0;
+  FrameCache cache;
+  const unsigned long frameSize = CreateFrame(100000)->GetActualMemorySize();
+  cache.SetMemoryBudget(3 * frameSize);
+
+  for (int i = 0; i < 3; ++i)
+  {
+    cache.Add(i, 1, CreateFrame(100000));
+  }
+  // frame 0 becomes the most recently used, so frame 1 is evicted
+  cache.Get(0, 1);
+  cache.Add(3, 1, CreateFrame(100000));
+
+  if (cache.GetNumberOfFrames() != 3 || cache.GetMemorySize() > cache.GetMemoryBudget())
+  {
+    std::cerr << "Budget not respected" << std::endl;
+    nbrErrors++;
+  }
+  if (!cache.Contains(0, 1) || cache.Contains(1, 1) || !cache.Contains(2, 1) ||
+    !cache.Contains(3, 1))
+  {
+    std::cerr << "Wrong frame evicted" << std::endl;
+    nbrErrors++;
+  }
+
+  cache.SetMemoryBudget(0);
+  if (cache.GetNumberOfFrames() != 0)
+  {
+    std::cerr << "Frames kept with an empty budget" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestMemoryAccount()
+{
+  int nbrErrors = 0;
+  const unsigned long readerFrames = MemoryAccounting::GetSize(MemoryAccounting::READER_FRAMES);
+  FrameCache cache(MemoryAccounting::TRANSFORMED_FRAMES);
+  cache.SetMemoryBudget(1024 * 1024);
+  cache.Add(0, 1, CreateFrame(1000));
+  if (MemoryAccounting::GetSize(MemoryAccounting::TRANSFORMED_FRAMES) != cache.GetMemorySize() ||
+    MemoryAccounting::GetSize(MemoryAccounting::READER_FRAMES) != readerFrames)
+  {
+    std::cerr << "Frames not accounted in the subsystem of the cache" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  nbrErrors += TestHitAndMiss();
+  nbrErrors += TestEviction();
+  nbrErrors += TestMemoryAccount();
+  return nbrErrors;
+}
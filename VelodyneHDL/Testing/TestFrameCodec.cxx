@@ -0,0 +1,306 @@
+#include "FrameCodec.h"
+#include "FrameStreamServer.h"
+
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkMath.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+const int NumberOfLasers = 16;
+const int NumberOfFirings = 1800;
+
+//-----------------------------------------------------------------------------
+//! Frame of a spinning lidar, the lasers of each firing being consecutive, with double points
+vtkSmartPointer<vtkPolyData> CreateFrame(bool withArrays)
+{
+  std::srand(42);
+  vtkNew<vtkPoints> points;
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints(NumberOfLasers * NumberOfFirings);
+  vtkNew<vtkUnsignedCharArray> intensities;
+  intensities->SetName("intensity");
+  intensities->SetNumberOfTuples(NumberOfLasers * NumberOfFirings);
+  vtkNew<vtkDoubleArray> laserIds;
+  laserIds->SetName("laser_id");
+  laserIds->SetNumberOfTuples(NumberOfLasers * NumberOfFirings);
+  for (int firing = 0; firing < NumberOfFirings; ++firing)
+  {
+    const double azimuth = vtkMath::Pi() * (2. * firing / NumberOfFirings - 1);
+    for (int laser = 0; laser < NumberOfLasers; ++laser)
+    {
+      const vtkIdType i = firing * NumberOfLasers + laser;
+      const double elevation = vtkMath::Pi() / 180. * (2. * laser - 15.);
+      const double range = 5. + 20. * (1 + std::sin(3 * azimuth)) + (std::rand() % 100) * 1e-3;
+      points->SetPoint(i, range * std::cos(elevation) * std::cos(azimuth),
+        range * std::cos(elevation) * std::sin(azimuth), range * std::sin(elevation));
+      intensities->SetValue(i, static_cast<unsigned char>(std::rand() % 256));
+      laserIds->SetValue(i, laser);
+    }
+  }
+  vtkSmartPointer<vtkPolyData> frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->SetPoints(points.GetPointer());
+  if (withArrays)
+  {
+    frame->GetPointData()->AddArray(intensities.GetPointer());
+    frame->GetPointData()->AddArray(laserIds.GetPointer());
+  }
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+//! Check that the decoded point matches the original one, given the resolutions
+bool IsClose(const double* original, const double* decoded, const FrameCodec& codec)
+{
+  const double range = std::sqrt(
+    original[0] * original[0] + original[1] * original[1] + original[2] * original[2]);
+  // half a step of range, and half a step of each angle at this range
+  const double tolerance = 0.5 * codec.GetRangeResolution() +
+    range * codec.GetAngleResolution() * vtkMath::Pi() / 180. + 1e-5 * range;
+  const double distance = std::sqrt(vtkMath::Distance2BetweenPoints(original, decoded));
+  return distance <= tolerance;
+}
+}
+
+//-----------------------------------------------------------------------------
+int TestRoundTrip()
+{
+  int nbrErrors = 0;
+  vtkSmartPointer<vtkPolyData> frame = CreateFrame(true);
+  FrameCodec codec;
+  std::vector<unsigned char> data;
+  if (!codec.Encode(frame, 12.5, data))
+  {
+    std::cerr << "The frame is not coded" << std::endl;
+    return 1;
+  }
+  // a frame of float points and the arrays above is 17 bytes per point
+  const double bytesPerPoint = static_cast<double>(data.size()) / frame->GetNumberOfPoints();
+  std::cout << "Coded frame: " << bytesPerPoint << " bytes per point" << std::endl;
+  if (bytesPerPoint > 4)
+  {
+    std::cerr << "The frame is not compressed enough" << std::endl;
+    nbrErrors++;
+  }
+
+  double time = 0;
+  vtkSmartPointer<vtkPolyData> decoded = FrameCodec::Decode(data.data(), data.size(), time);
+  if (!decoded || time != 12.5 ||
+    decoded->GetNumberOfPoints() != frame->GetNumberOfPoints())
+  {
+    std::cerr << "The frame is not decoded" << std::endl;
+    return nbrErrors + 1;
+  }
+  vtkDataArray* intensities = decoded->GetPointData()->GetArray("intensity");
+  vtkDataArray* laserIds = decoded->GetPointData()->GetArray("laser_id");
+  if (!intensities || !laserIds)
+  {
+    std::cerr << "The arrays are not decoded" << std::endl;
+    return nbrErrors + 1;
+  }
+
+  // the decoded points are grouped by laser, in the order of the firings
+  vtkDataArray* originalIntensities = frame->GetPointData()->GetArray("intensity");
+  int nbrWrongPoints = 0;
+  for (int laser = 0; laser < NumberOfLasers; ++laser)
+  {
+    for (int firing = 0; firing < NumberOfFirings; ++firing)
+    {
+      const vtkIdType i = firing * NumberOfLasers + laser;
+      const vtkIdType j = laser * NumberOfFirings + firing;
+      double original[3];
+      double point[3];
+      frame->GetPoint(i, original);
+      decoded->GetPoint(j, point);
+      if (!IsClose(original, point, codec) || laserIds->GetTuple1(j) != laser ||
+        intensities->GetTuple1(j) != originalIntensities->GetTuple1(i))
+      {
+        nbrWrongPoints++;
+      }
+    }
+  }
+  if (nbrWrongPoints > 0)
+  {
+    std::cerr << nbrWrongPoints << " points are not decoded correctly" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestWithoutArrays()
+{
+  vtkSmartPointer<vtkPolyData> frame = CreateFrame(false);
+  FrameCodec codec;
+  std::vector<unsigned char> data;
+  double time = 0;
+  vtkSmartPointer<vtkPolyData> decoded;
+  if (codec.Encode(frame, 0, data))
+  {
+    decoded = FrameCodec::Decode(data.data(), data.size(), time);
+  }
+  // a single row, in the order of the frame
+  if (!decoded || decoded->GetNumberOfPoints() != frame->GetNumberOfPoints() ||
+    decoded->GetPointData()->GetArray("intensity") ||
+    decoded->GetPointData()->GetArray("laser_id"))
+  {
+    std::cerr << "The frame without arrays is not coded" << std::endl;
+    return 1;
+  }
+  for (vtkIdType i = 0; i < frame->GetNumberOfPoints(); ++i)
+  {
+    double original[3];
+    double point[3];
+    frame->GetPoint(i, original);
+    decoded->GetPoint(i, point);
+    if (!IsClose(original, point, codec))
+    {
+      std::cerr << "Point " << i << " is not decoded correctly" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestLaserDecimation()
+{
+  vtkSmartPointer<vtkPolyData> frame = CreateFrame(true);
+  FrameCodec codec;
+  codec.SetLaserDecimation(4);
+  std::vector<unsigned char> data;
+  double time = 0;
+  vtkSmartPointer<vtkPolyData> decoded;
+  if (codec.Encode(frame, 0, data))
+  {
+    decoded = FrameCodec::Decode(data.data(), data.size(), time);
+  }
+  if (!decoded || decoded->GetNumberOfPoints() != frame->GetNumberOfPoints() / 4)
+  {
+    std::cerr << "The decimated frame is not coded" << std::endl;
+    return 1;
+  }
+  vtkDataArray* laserIds = decoded->GetPointData()->GetArray("laser_id");
+  for (vtkIdType i = 0; i < decoded->GetNumberOfPoints(); ++i)
+  {
+    if (static_cast<int>(laserIds->GetTuple1(i)) % 4 != 0)
+    {
+      std::cerr << "Laser " << laserIds->GetTuple1(i) << " should have been skipped"
+                << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestInvalidData()
+{
+  int nbrErrors = 0;
+  FrameCodec codec;
+  std::vector<unsigned char> data;
+  codec.Encode(CreateFrame(true), 0, data);
+  double time = 0;
+
+  // truncated frames and other versions are refused
+  if (FrameCodec::Decode(data.data(), data.size() / 2, time) ||
+    FrameCodec::Decode(data.data(), 10, time))
+  {
+    std::cerr << "A truncated frame is decoded" << std::endl;
+    nbrErrors++;
+  }
+  std::vector<unsigned char> otherVersion = data;
+  otherVersion[4]++;
+  if (FrameCodec::Decode(otherVersion.data(), otherVersion.size(), time))
+  {
+    std::cerr << "A frame of another version is decoded" << std::endl;
+    nbrErrors++;
+  }
+
+  // corrupted frames are either refused or decoded, never read out of bounds
+  std::srand(7);
+  for (int k = 0; k < 200; ++k)
+  {
+    std::vector<unsigned char> corrupted = data;
+    for (int n = 0; n < 8; ++n)
+    {
+      corrupted[std::rand() % corrupted.size()] = static_cast<unsigned char>(std::rand());
+    }
+    FrameCodec::Decode(corrupted.data(), corrupted.size(), time);
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestStreaming()
+{
+  FrameStreamServer server;
+  server.SetMaximumFrameRate(0);
+  const int port = 23700;
+  if (!server.Start(port))
+  {
+    std::cerr << "The server does not start on port " << port << std::endl;
+    return 1;
+  }
+  boost::asio::io_service io;
+  boost::asio::ip::tcp::socket socket(io);
+  boost::system::error_code error;
+  socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), port),
+    error);
+  // the frames are only sent once the viewer is accepted
+  for (int k = 0; k < 100 && server.GetNumberOfClients() == 0; ++k)
+  {
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+  }
+  if (error || server.GetNumberOfClients() != 1)
+  {
+    std::cerr << "The viewer cannot connect" << std::endl;
+    return 1;
+  }
+
+  vtkSmartPointer<vtkPolyData> frame = CreateFrame(true);
+  server.SendFrame(frame, 3.);
+  unsigned char header[4];
+  boost::asio::read(socket, boost::asio::buffer(header), error);
+  boost::uint32_t size = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    size |= static_cast<boost::uint32_t>(header[i]) << (8 * i);
+  }
+  std::vector<unsigned char> message(error ? 0 : size);
+  boost::asio::read(socket, boost::asio::buffer(message), error);
+  double time = 0;
+  vtkSmartPointer<vtkPolyData> decoded =
+    error ? nullptr : FrameCodec::Decode(message.data(), message.size(), time);
+  server.Stop();
+  if (!decoded || time != 3. || decoded->GetNumberOfPoints() != frame->GetNumberOfPoints())
+  {
+    std::cerr << "The streamed frame is not received" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestRoundTrip();
+  nbrErrors += TestWithoutArrays();
+  nbrErrors += TestLaserDecimation();
+  nbrErrors += TestInvalidData();
+  nbrErrors += TestStreaming();
+  return nbrErrors;
+}
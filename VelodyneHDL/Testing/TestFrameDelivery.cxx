@@ -0,0 +1,84 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Check the frames given to a slow consumer of a live stream with each delivery policy
+
+#include "FrameDelivery.h"
+
+#include <iostream>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Select a frame among the frames kept, and check its number and the skipped frames
+int CheckDelivery(FrameDelivery& delivery, unsigned long firstFrame, size_t numberOfFrames,
+  long expectedFrame, unsigned long expectedSkipped)
+{
+  const int index = delivery.SelectFrame(firstFrame, numberOfFrames);
+  const long frame = index < 0 ? -1 : static_cast<long>(firstFrame) + index;
+  if (frame != expectedFrame || delivery.GetNumberOfSkippedFrames() != expectedSkipped)
+  {
+    std::cerr << "Frames " << firstFrame << " to " << firstFrame + numberOfFrames
+              << ": frame " << frame << " delivered, " << delivery.GetNumberOfSkippedFrames()
+              << " skipped, expected frame " << expectedFrame << ", " << expectedSkipped
+              << " skipped" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+
+  // the latest frame is delivered, the frames published meanwhile are skipped
+  FrameDelivery latest;
+  nbrErrors += CheckDelivery(latest, 0, 0, -1, 0);
+  nbrErrors += CheckDelivery(latest, 0, 3, 2, 0);
+  nbrErrors += CheckDelivery(latest, 0, 4, 3, 0);
+  nbrErrors += CheckDelivery(latest, 0, 8, 7, 3);
+  if (latest.GetNumberOfPendingFrames(0, 8) != 0 || latest.GetNumberOfPendingFrames(0, 10) != 2)
+  {
+    std::cerr << "Wrong number of pending frames" << std::endl;
+    nbrErrors++;
+  }
+  // nothing new, the same frame is given again without being counted
+  nbrErrors += CheckDelivery(latest, 2, 6, 7, 3);
+  if (latest.GetNumberOfDeliveredFrames() != 3)
+  {
+    std::cerr << latest.GetNumberOfDeliveredFrames() << " frames delivered, 3 expected"
+              << std::endl;
+    nbrErrors++;
+  }
+
+  // every frame is delivered in order, with at most 3 frames waiting
+  FrameDelivery every;
+  every.SetPolicy(FrameDelivery::EVERY_FRAME);
+  every.SetMaximumQueueLength(3);
+  nbrErrors += CheckDelivery(every, 0, 1, 0, 0);
+  nbrErrors += CheckDelivery(every, 0, 3, 1, 0);
+  nbrErrors += CheckDelivery(every, 0, 3, 2, 0);
+  nbrErrors += CheckDelivery(every, 0, 10, 7, 4);
+  nbrErrors += CheckDelivery(every, 0, 10, 8, 4);
+  // the frames evicted from the cache before being delivered are skipped
+  nbrErrors += CheckDelivery(every, 12, 2, 12, 7);
+
+  // after a reset, the next delivery is the last frame
+  every.Reset();
+  nbrErrors += CheckDelivery(every, 12, 4, 15, 0);
+  return nbrErrors;
+}
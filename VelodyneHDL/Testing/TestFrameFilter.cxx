@@ -0,0 +1,135 @@
+// Decode the frames of a pcap with a crop and a laser selection, and compare them with the same
+// frames decoded without them and filtered by the interpreter. Then tune the crop on the frame
+// given by the reader and compare it with the frame decoded by another reader.
+
+#include "TestHelpers.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkVelodynePacketInterpreter> OpenReader(
+  vtkLidarReader* reader, const char* pcapFileName, const char* correctionFileName)
+{
+  auto interpreter = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  reader->SetInterpreter(interpreter);
+  reader->SetFileName(pcapFileName);
+  reader->SetCalibrationFileName(correctionFileName);
+  reader->Update();
+  return interpreter;
+}
+
+//-----------------------------------------------------------------------------
+void SetFilters(vtkVelodynePacketInterpreter* interpreter, int cropMode, bool cropOutside,
+  const double region[6], int laserStep)
+{
+  std::vector<bool> selection = interpreter->GetLaserSelection();
+  for (size_t laser = 0; laser < selection.size(); ++laser)
+  {
+    selection[laser] = laser % laserStep == 0;
+  }
+  interpreter->SetLaserSelection(selection);
+  interpreter->SetCropMode(cropMode);
+  interpreter->SetCropOutside(cropOutside);
+  interpreter->SetCropRegion(const_cast<double*>(region));
+  // the laser selection does not modify the interpreter
+  interpreter->Modified();
+}
+
+//-----------------------------------------------------------------------------
+int CompareFrames(vtkPolyData* frame, vtkPolyData* expected)
+{
+  if (!frame || !expected)
+  {
+    std::cerr << "Missing frame" << std::endl;
+    return 1;
+  }
+  if (TestPointCount(frame, expected))
+  {
+    return 1;
+  }
+  return TestPointDataStructure(frame, expected) + TestPointDataValues(frame, expected) +
+    TestPointPositions(frame, expected);
+}
+
+//-----------------------------------------------------------------------------
+vtkPolyData* UpdateFrame(vtkLidarReader* reader, int index)
+{
+  reader->UpdateInformation();
+  vtkInformation* outInfo = reader->GetExecutive()->GetOutputInformation(0);
+  double* timeSteps = outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(), timeSteps[index]);
+  reader->Update();
+  return vtkPolyData::SafeDownCast(reader->GetOutputDataObject(0));
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: TestFrameFilter <pcapFileName> <correctionFileName>" << std::endl;
+    return 1;
+  }
+
+  vtkNew<vtkLidarReader> unfilteredReader;
+  OpenReader(unfilteredReader.GetPointer(), argv[1], argv[2]);
+  vtkNew<vtkLidarReader> reader;
+  vtkSmartPointer<vtkVelodynePacketInterpreter> interpreter =
+    OpenReader(reader.GetPointer(), argv[1], argv[2]);
+  const int numberOfFrames = reader->GetNumberOfFrames();
+  if (numberOfFrames < 2)
+  {
+    std::cerr << "The reader has less than 2 frames" << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = 0;
+  const double sector[6] = { 30., 200., -90., 90., 1., 20. };
+  const double box[6] = { -5., 5., -5., 5., -1., 1. };
+  for (int filters = 0; filters < 2; ++filters)
+  {
+    if (filters == 0)
+    {
+      SetFilters(interpreter, vtkLidarPacketInterpreter::Spherical, false, sector, 3);
+    }
+    else
+    {
+      SetFilters(interpreter, vtkLidarPacketInterpreter::Cartesian, true, box, 2);
+    }
+    if (!interpreter->CreateUnfilteredDecoder())
+    {
+      std::cerr << "The interpreter cannot filter its frames" << std::endl;
+      return 1;
+    }
+    for (int frame = 0; frame < numberOfFrames; ++frame)
+    {
+      vtkSmartPointer<vtkPolyData> expected = GetCurrentFrame(reader.GetPointer(), frame);
+      vtkPolyData* unfiltered = GetCurrentFrame(unfilteredReader.GetPointer(), frame);
+      nbrErrors += CompareFrames(interpreter->FilterFrame(unfiltered), expected);
+    }
+  }
+
+  // the crop is tuned on the frame given by the reader, which is filtered again
+  vtkNew<vtkLidarReader> expectedReader;
+  vtkSmartPointer<vtkVelodynePacketInterpreter> expectedInterpreter =
+    OpenReader(expectedReader.GetPointer(), argv[1], argv[2]);
+  const int shownFrame = numberOfFrames / 2;
+  for (int step = 0; step < 3; ++step)
+  {
+    const double region[6] = { 30. * step, 200., -90., 90., 1. + step, 20. };
+    SetFilters(interpreter, vtkLidarPacketInterpreter::Spherical, false, region, step + 1);
+    SetFilters(expectedInterpreter, vtkLidarPacketInterpreter::Spherical, false, region, step + 1);
+    vtkPolyData* frame = UpdateFrame(reader.GetPointer(), shownFrame);
+    nbrErrors += CompareFrames(frame, GetCurrentFrame(expectedReader.GetPointer(), shownFrame));
+  }
+  return nbrErrors;
+}
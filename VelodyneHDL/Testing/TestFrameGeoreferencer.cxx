@@ -0,0 +1,98 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Compare the georeferenced points, with the pose grid and with the exact
+// poses, with the points moved by the interpolated vtkTransform of their time.
+
+#include "FrameGeoreferencer.h"
+#include "vtkVelodyneTransformInterpolator.h"
+
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+int TestInterpolationType(int type, double step, double tolerance, const char* name)
+{
+  std::mt19937 generator(type);
+  std::uniform_real_distribution<double> distribution(-1., 1.);
+  auto interpolator = vtkSmartPointer<vtkVelodyneTransformInterpolator>::New();
+  interpolator->SetInterpolationType(type);
+  for (int i = 0; i < 20; ++i)
+  {
+    auto transform = vtkSmartPointer<vtkTransform>::New();
+    transform->Translate(i + distribution(generator), 0.5 * i, 0.1 * distribution(generator));
+    transform->RotateZ(10. * i + 5. * distribution(generator));
+    interpolator->AddTransform(0.1 * i, transform);
+  }
+
+  // enough points to be transformed by several threads
+  const size_t numberOfPoints = 100000;
+  std::vector<float> points(3 * numberOfPoints);
+  std::vector<double> times(numberOfPoints);
+  for (size_t i = 0; i < numberOfPoints; ++i)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      points[3 * i + k] = static_cast<float>(50. * distribution(generator));
+    }
+    times[i] = 0.3 + 0.1 * i / numberOfPoints;
+  }
+
+  FrameGeoreferencer georeferencer;
+  georeferencer.SetTrajectory(interpolator);
+  georeferencer.SetOrigin(500000., 4000000., 100.);
+  georeferencer.SetPoseSamplingStep(step);
+  std::vector<double> positions(3 * numberOfPoints);
+  if (!georeferencer.Georeference(points.data(), times.data(), numberOfPoints, positions.data()))
+  {
+    std::cerr << name << ": the trajectory is ignored" << std::endl;
+    return 1;
+  }
+
+  auto transform = vtkSmartPointer<vtkTransform>::New();
+  for (size_t i = 0; i < numberOfPoints; i += 97)
+  {
+    interpolator->InterpolateTransform(times[i], transform);
+    double point[3] = { points[3 * i], points[3 * i + 1], points[3 * i + 2] };
+    transform->TransformPoint(point, point);
+    if (std::abs(point[0] + 500000. - positions[3 * i]) > tolerance ||
+        std::abs(point[1] + 4000000. - positions[3 * i + 1]) > tolerance ||
+        std::abs(point[2] + 100. - positions[3 * i + 2]) > tolerance)
+    {
+      std::cerr << name << ": wrong position at time " << times[i] << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  // the grid blends the matrices, which is exact for the linear translation only
+  return TestInterpolationType(vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_LINEAR, 1e-4, 1e-3, "Linear grid") +
+    TestInterpolationType(vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_LINEAR, 0., 1e-6, "Linear exact") +
+    TestInterpolationType(vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_NEAREST, 1e-4, 1e-6, "Nearest");
+}
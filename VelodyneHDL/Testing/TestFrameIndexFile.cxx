@@ -0,0 +1,143 @@
+#include "FrameIndexFile.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+void WriteDummyFile(const std::string& filename, int size)
+{
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+  for (int i = 0; i < size; ++i)
+  {
+    file.put(static_cast<char>(i));
+  }
+}
+
+//-----------------------------------------------------------------------------
+int TestRoundTrip(const std::string& filename)
+{
+  int nbrErrors = 0;
+
+  std::vector<FramePosition> positions;
+  for (int i = 0; i < 10; ++i)
+  {
+    positions.push_back(FramePosition(24 + i * 1264, i % 12, 0.1 * i));
+  }
+  // the GPS times are only known for some frames
+  for (int i = 2; i < 10; ++i)
+  {
+    positions[i].FirstSensorTime = 1.6e9 + 0.1 * i;
+    positions[i].LastSensorTime = positions[i].FirstSensorTime + 0.1;
+  }
+  // and the quality for the frames whose packets have been indexed
+  for (int i = 5; i < 10; ++i)
+  {
+    positions[i].NumberOfPackets = 180 + i;
+    positions[i].AzimuthCoverage = 0.9 + 0.01 * i;
+    positions[i].NumberOfMissingPackets = i - 5;
+    positions[i].NumberOfDuplicatePackets = i % 2;
+    positions[i].LargestTimeGap = 5.5e-4 * i;
+  }
+
+  std::vector<unsigned char> calibration(37);
+  for (size_t i = 0; i < calibration.size(); ++i)
+  {
+    calibration[i] = static_cast<unsigned char>(3 * i);
+  }
+
+  std::vector<unsigned char> azimuths(1000);
+  for (size_t i = 0; i < azimuths.size(); ++i)
+  {
+    azimuths[i] = static_cast<unsigned char>(7 * i);
+  }
+
+  FrameIndexFile index;
+  if (!index.Write(filename, "key", positions, calibration, azimuths))
+  {
+    std::cerr << "Failed to write the index: " << index.GetLastError() << std::endl;
+    return 1;
+  }
+
+  std::vector<FramePosition> readPositions;
+  std::vector<unsigned char> readCalibration;
+  std::vector<unsigned char> readAzimuths;
+  if (!index.Read(filename, "key", readPositions, readCalibration, readAzimuths))
+  {
+    std::cerr << "Failed to read the index: " << index.GetLastError() << std::endl;
+    return 1;
+  }
+
+  if (readPositions.size() != positions.size())
+  {
+    std::cerr << "Expected " << positions.size() << " frames, got " << readPositions.size() << std::endl;
+    return 1;
+  }
+  for (size_t i = 0; i < positions.size(); ++i)
+  {
+    if (readPositions[i].Position != positions[i].Position ||
+      readPositions[i].Skip != positions[i].Skip || readPositions[i].Time != positions[i].Time ||
+      std::isnan(readPositions[i].FirstSensorTime) != (i < 2) ||
+      (i >= 2 && (readPositions[i].FirstSensorTime != positions[i].FirstSensorTime ||
+                   readPositions[i].LastSensorTime != positions[i].LastSensorTime)))
+    {
+      std::cerr << "Frame " << i << " does not match" << std::endl;
+      nbrErrors++;
+    }
+  }
+  for (size_t i = 0; i < positions.size(); ++i)
+  {
+    if (readPositions[i].NumberOfPackets != positions[i].NumberOfPackets ||
+      readPositions[i].AzimuthCoverage != positions[i].AzimuthCoverage ||
+      readPositions[i].NumberOfMissingPackets != positions[i].NumberOfMissingPackets ||
+      readPositions[i].NumberOfDuplicatePackets != positions[i].NumberOfDuplicatePackets ||
+      std::isnan(readPositions[i].LargestTimeGap) != (i < 5) ||
+      (i >= 5 && readPositions[i].LargestTimeGap != positions[i].LargestTimeGap))
+    {
+      std::cerr << "Quality of frame " << i << " does not match" << std::endl;
+      nbrErrors++;
+    }
+  }
+  if (readCalibration != calibration)
+  {
+    std::cerr << "Calibration does not match" << std::endl;
+    nbrErrors++;
+  }
+  if (readAzimuths != azimuths)
+  {
+    std::cerr << "Packet azimuths do not match" << std::endl;
+    nbrErrors++;
+  }
+
+  // an index built with other settings must be rejected
+  if (index.Read(filename, "other key", readPositions, readCalibration, readAzimuths))
+  {
+    std::cerr << "Index built with another key has been accepted" << std::endl;
+    nbrErrors++;
+  }
+
+  // an index older than the pcap must be rejected
+  WriteDummyFile(filename, 10);
+  if (index.Read(filename, "key", readPositions, readCalibration, readAzimuths))
+  {
+    std::cerr << "Stale index has been accepted" << std::endl;
+    nbrErrors++;
+  }
+
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  const std::string filename = "TestFrameIndexFile.pcap";
+  std::remove(filename.c_str());
+  WriteDummyFile(filename, 1000);
+
+  int nbrErrors = TestRoundTrip(filename);
+
+  std::remove(filename.c_str());
+  std::remove(FrameIndexFile::GetIndexFileName(filename).c_str());
+  return nbrErrors;
+}
@@ -0,0 +1,114 @@
+#include "FrameQuality.h"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+const int PacketsPerFrame = 100;
+const int NumberOfFrames = 3;
+const double PacketWidth = 360. / PacketsPerFrame;
+const double PacketInterval = 1e-3;
+
+//-----------------------------------------------------------------------------
+//! Packets of a sensor doing a turn per frame, the frames starting at azimuth 0. The sensor
+//! times wrap at the top of the hour during the first frame.
+std::vector<PacketAzimuthIndex::Packet> CreatePackets(bool hasTimes)
+{
+  std::vector<PacketAzimuthIndex::Packet> packets;
+  for (int i = 0; i < PacketsPerFrame * NumberOfFrames; ++i)
+  {
+    const double first = PacketWidth * (i % PacketsPerFrame);
+    PacketAzimuthIndex::Packet packet = { 24 + 1264 * static_cast<boost::uint64_t>(i), first,
+      first + PacketWidth };
+    packet.HasDistances = false;
+    packet.SensorTime = hasTimes ? std::fmod(3599.95 + PacketInterval * i, 3600.)
+                                 : std::numeric_limits<double>::quiet_NaN();
+    packets.push_back(packet);
+  }
+  return packets;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<FramePosition> CreatePositions(const std::vector<PacketAzimuthIndex::Packet>& packets)
+{
+  std::vector<FramePosition> positions;
+  for (int frame = 0; frame < NumberOfFrames; ++frame)
+  {
+    positions.push_back(FramePosition(packets[frame * PacketsPerFrame].Position, 0, 0.1 * frame));
+  }
+  return positions;
+}
+
+//-----------------------------------------------------------------------------
+bool CheckFrame(const FramePosition& position, int frame, int packets, double coverage,
+  int missing, int duplicates)
+{
+  if (position.NumberOfPackets != packets ||
+    std::abs(position.AzimuthCoverage - coverage) > 1e-9 ||
+    position.NumberOfMissingPackets != missing ||
+    position.NumberOfDuplicatePackets != duplicates)
+  {
+    std::cerr << "Frame " << frame << ": " << position.NumberOfPackets << " packets, coverage "
+              << position.AzimuthCoverage << ", " << position.NumberOfMissingPackets
+              << " missing, " << position.NumberOfDuplicatePackets << " duplicates" << std::endl;
+    return false;
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+
+  // the second frame loses 10 packets, a tenth of the turn, the third one has a duplicate
+  std::vector<PacketAzimuthIndex::Packet> packets = CreatePackets(true);
+  packets.erase(packets.begin() + PacketsPerFrame + 20, packets.begin() + PacketsPerFrame + 30);
+  packets.insert(packets.begin() + 2 * PacketsPerFrame - 10 + 50,
+    packets[2 * PacketsPerFrame - 10 + 50]);
+  std::vector<FramePosition> positions = CreatePositions(CreatePackets(true));
+  ComputeFrameQualities(packets, positions);
+
+  // a frame ends with the first packet of the next frame
+  nbrErrors += !CheckFrame(positions[0], 0, PacketsPerFrame + 1, 1., 0, 0);
+  nbrErrors += !CheckFrame(positions[1], 1, PacketsPerFrame - 9, 0.9, 10, 0);
+  nbrErrors += !CheckFrame(positions[2], 2, PacketsPerFrame + 1, 1., 0, 1);
+  if (std::abs(positions[0].LargestTimeGap - PacketInterval) > 1e-6 ||
+    std::abs(positions[1].LargestTimeGap - 11 * PacketInterval) > 1e-6)
+  {
+    std::cerr << "Wrong time gaps: " << positions[0].LargestTimeGap << " and "
+              << positions[1].LargestTimeGap << std::endl;
+    nbrErrors++;
+  }
+  if (IsFrameDamaged(positions[0], 0.95) || !IsFrameDamaged(positions[1], 0.95) ||
+    !IsFrameDamaged(positions[2], 0.95))
+  {
+    std::cerr << "Wrong damaged frames" << std::endl;
+    nbrErrors++;
+  }
+
+  // without the sensor times, only the coverage and the duplicates are known
+  packets = CreatePackets(false);
+  packets.erase(packets.begin() + PacketsPerFrame + 20, packets.begin() + PacketsPerFrame + 30);
+  positions = CreatePositions(CreatePackets(false));
+  ComputeFrameQualities(packets, positions);
+  nbrErrors += !CheckFrame(positions[1], 1, PacketsPerFrame - 9, 0.9, -1, 0);
+  if (!std::isnan(positions[1].LargestTimeGap))
+  {
+    std::cerr << "Time gap without sensor times" << std::endl;
+    nbrErrors++;
+  }
+
+  // the frames whose packets are not known are not damaged
+  FramePosition unknown(0, 0, 0.);
+  if (IsFrameDamaged(unknown, 0.95))
+  {
+    std::cerr << "Frame without packets is damaged" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
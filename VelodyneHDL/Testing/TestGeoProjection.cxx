@@ -0,0 +1,105 @@
+#include "GeoProjection.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// A point on the central meridian of its UTM zone has a known easting
+int TestKnownPosition()
+{
+  int nbrErrors = 0;
+  GeoProjection projection(
+    GeoProjection::LatLongDefinition(), GeoProjection::UTMDefinition(31, false));
+  if (!projection.IsValid() || projection.IsOutputLatLong())
+  {
+    std::cerr << "Valid projection refused" << std::endl;
+    return 1;
+  }
+
+  // longitude, latitude, height
+  double position[3] = { 3.0, 45.0, 10.0 };
+  if (!projection.Transform(position, 1) || std::abs(position[0] - 500000.0) > 1e-3 ||
+    std::abs(position[1] - 4982950.4) > 1.0 || position[2] != 10.0)
+  {
+    std::cerr << "Wrong UTM position: " << position[0] << " " << position[1] << " "
+              << position[2] << std::endl;
+    nbrErrors++;
+  }
+
+  // and back
+  GeoProjection inverse(
+    GeoProjection::UTMDefinition(31, false), GeoProjection::LatLongDefinition());
+  if (!inverse.Transform(position, 1) || std::abs(position[0] - 3.0) > 1e-9 ||
+    std::abs(position[1] - 45.0) > 1e-9)
+  {
+    std::cerr << "Wrong lat/long position: " << position[0] << " " << position[1] << std::endl;
+    nbrErrors++;
+  }
+
+  GeoProjection invalid("+proj=unknown", GeoProjection::LatLongDefinition());
+  if (invalid.IsValid() || invalid.Transform(position, 1))
+  {
+    std::cerr << "Invalid projection accepted" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+// The chunks converted by several threads give the same positions as a single thread
+int TestThreadedBatch()
+{
+  int nbrErrors = 0;
+  const size_t numberOfPositions = 100000;
+  std::vector<double> single(3 * numberOfPositions);
+  for (size_t i = 0; i < numberOfPositions; ++i)
+  {
+    single[3 * i + 0] = 2.0 + 2.0 * i / numberOfPositions;
+    single[3 * i + 1] = 44.0 + 2.0 * i / numberOfPositions;
+    single[3 * i + 2] = static_cast<double>(i);
+  }
+  std::vector<double> threaded = single;
+
+  GeoProjection projection(
+    GeoProjection::LatLongDefinition(), GeoProjection::UTMDefinition(31, false));
+  projection.SetNumberOfThreads(1);
+  GeoProjection threadedProjection(
+    GeoProjection::LatLongDefinition(), GeoProjection::UTMDefinition(31, false));
+  threadedProjection.SetNumberOfThreads(4);
+  if (!projection.Transform(&single[0], numberOfPositions) ||
+    !threadedProjection.Transform(&threaded[0], numberOfPositions))
+  {
+    std::cerr << "Batch conversion failed" << std::endl;
+    return 1;
+  }
+  if (single != threaded)
+  {
+    std::cerr << "Threaded conversion differs from the single thread one" << std::endl;
+    nbrErrors++;
+  }
+
+  // the thread projections are reused by the next batches
+  std::vector<double> second(3 * numberOfPositions, 0.0);
+  for (size_t i = 0; i < numberOfPositions; ++i)
+  {
+    second[3 * i + 0] = 3.0;
+    second[3 * i + 1] = 45.0;
+  }
+  if (!threadedProjection.Transform(&second[0], numberOfPositions) ||
+    std::abs(second[3 * (numberOfPositions - 1)] - 500000.0) > 1e-3)
+  {
+    std::cerr << "Second batch conversion failed" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestKnownPosition();
+  nbrErrors += TestThreadedBatch();
+  return nbrErrors;
+}
@@ -0,0 +1,113 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Fill an ImuBuffer with position packets decoded by VelodyneImuDecoder, across a
+// top of the hour wrap, and query it by time range and by interpolation.
+
+#include "ImuBuffer.h"
+#include "VelodyneImuDecoder.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Position packet whose first gyroscope and timestamp are set
+std::vector<unsigned char> CreatePositionPacket(unsigned int tohTimestamp, short gyro1)
+{
+  std::vector<unsigned char> packet(512, 0);
+  unsigned short channel = static_cast<unsigned short>(gyro1) & 0x0fff;
+  std::memcpy(&packet[14], &channel, 2);
+  std::memcpy(&packet[14 + 3 * 8 + 160], &tohTimestamp, 4);
+  return packet;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int errors = 0;
+
+  // 1 kHz packets around the top of the hour, the gyroscope increasing with time
+  VelodyneImuDecoder decoder;
+  ImuBuffer buffer;
+  const unsigned int hour = 3600000000u;
+  for (int i = -100; i < 100; ++i)
+  {
+    const unsigned int timestamp = (hour + i * 1000) % hour;
+    std::vector<unsigned char> packet = CreatePositionPacket(timestamp, static_cast<short>(i));
+    ImuBuffer::Sample sample;
+    if (!decoder.Decode(packet.data(), static_cast<unsigned int>(packet.size()), sample))
+    {
+      std::cerr << "The position packet " << i << " is not decoded" << std::endl;
+      return 1;
+    }
+    buffer.Add(sample);
+  }
+
+  // the lidar packets are ignored
+  std::vector<unsigned char> lidarPacket(1206, 0);
+  ImuBuffer::Sample ignored;
+  if (decoder.Decode(lidarPacket.data(), static_cast<unsigned int>(lidarPacket.size()), ignored))
+  {
+    std::cerr << "A lidar packet is decoded as a position packet" << std::endl;
+    errors++;
+  }
+
+  double first, last;
+  if (buffer.GetNumberOfSamples() != 200 || !buffer.GetTimeRange(first, last) ||
+      std::abs(first - 3599.9) > 1e-9 || std::abs(last - 3600.099) > 1e-9)
+  {
+    std::cerr << "The times do not follow the wrap" << std::endl;
+    errors++;
+  }
+
+  std::vector<ImuBuffer::Sample> samples;
+  if (buffer.GetSamples(3599.99, 3600.01, samples) != 21)
+  {
+    std::cerr << "Wrong number of samples in the time range" << std::endl;
+    errors++;
+  }
+
+  // gyroscope 1 is around the first axis by default
+  ImuBuffer::Sample sample;
+  const double expected = 10.5 * VelodyneImuDecoder::GyroScale * std::acos(-1.0) / 180.0;
+  if (!buffer.Interpolate(3600.0105, sample) ||
+      std::abs(sample.AngularVelocity(0) - expected) > 1e-9 ||
+      sample.AngularVelocity(1) != 0.0 || sample.AngularVelocity(2) != 0.0)
+  {
+    std::cerr << "Wrong interpolated angular velocity" << std::endl;
+    errors++;
+  }
+  if (buffer.Interpolate(3601.0, sample))
+  {
+    std::cerr << "A time out of the samples is interpolated" << std::endl;
+    errors++;
+  }
+
+  buffer.SetMaximumDuration(0.05);
+  if (!buffer.GetTimeRange(first, last) || last - first > 0.05 + 1e-9)
+  {
+    std::cerr << "The old samples are not dropped" << std::endl;
+    errors++;
+  }
+
+  return errors;
+}
@@ -0,0 +1,74 @@
+#include "ImuPreintegration.h"
+
+#include <cmath>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+int TestRotation()
+{
+  int nbrErrors = 0;
+  ImuPreintegration imu;
+  const Eigen::Vector3d gravity(0.0, 0.0, 9.81);
+  for (int k = 0; k <= 100; ++k)
+  {
+    imu.AddMeasurement(0.01 * k, Eigen::Vector3d(0.0, 0.0, 1.0), gravity);
+  }
+
+  // the measurements do not cover the interval
+  ImuPreintegration::Delta delta;
+  if (imu.Integrate(0.5, 1.5, delta))
+  {
+    std::cerr << "Integrated outside of the measurements" << std::endl;
+    nbrErrors++;
+  }
+
+  // the interval ends between two measurements
+  if (!imu.Integrate(0.2, 0.705, delta))
+  {
+    std::cerr << "Failed to integrate the measurements" << std::endl;
+    return nbrErrors + 1;
+  }
+  const Eigen::AngleAxisd rotation(delta.Rotation);
+  if (std::abs(rotation.angle() - 0.505) > 1e-9 || std::abs(rotation.axis().z() - 1.0) > 1e-9 ||
+      delta.Position.norm() > 1e-9 || delta.Velocity.norm() > 1e-9)
+  {
+    std::cerr << "Wrong rotation: " << rotation.angle() << " position: " << delta.Position.transpose()
+              << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestAcceleration()
+{
+  int nbrErrors = 0;
+  ImuPreintegration imu;
+
+  // still before 1 s, then accelerating along x
+  for (int k = 0; k <= 200; ++k)
+  {
+    const double time = 0.01 * k;
+    imu.AddMeasurement(time, Eigen::Vector3d::Zero(), Eigen::Vector3d(time < 1.0 ? 0.0 : 2.0, 0.0, 9.81));
+  }
+
+  ImuPreintegration::Delta delta;
+  if (!imu.Integrate(1.0, 2.0, delta) ||
+      (delta.Position - Eigen::Vector3d(1.0, 0.0, 0.0)).norm() > 1e-9 ||
+      (delta.Velocity - Eigen::Vector3d(2.0, 0.0, 0.0)).norm() > 1e-9)
+  {
+    std::cerr << "Wrong position: " << delta.Position.transpose() << " velocity: "
+              << delta.Velocity.transpose() << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestRotation();
+  nbrErrors += TestAcceleration();
+  return nbrErrors;
+}
@@ -0,0 +1,84 @@
+// Compare the evaluation of a signal at sorted arrays of times, and its
+// resampling, with the evaluation time by time.
+
+#include "interpolator1D.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+//-----------------------------------------------------------------------------
+int TestSortedTimes()
+{
+  int nbrErrors = 0;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> step(0.001, 0.1);
+  std::uniform_real_distribution<double> value(-10.0, 10.0);
+  std::vector<double> t(1000), x(1000);
+  for (size_t i = 0; i < t.size(); i++)
+  {
+    t[i] = i == 0 ? 1.0 : t[i - 1] + step(generator);
+    x[i] = value(generator);
+  }
+  Interpolator1D<double> signal(t, x);
+
+  // times before, inside and after the support, some on the samples
+  std::uniform_real_distribution<double> time(0.0, t.back() + 1.0);
+  std::vector<double> times(5000);
+  for (size_t i = 0; i < times.size(); i++)
+  {
+    times[i] = i % 10 == 0 ? t[i % t.size()] : time(generator);
+  }
+  std::sort(times.begin(), times.end());
+
+  const double shift = 0.5;
+  const std::vector<double> values = signal.GetSorted(times, shift);
+  for (size_t i = 0; i < times.size(); i++)
+  {
+    const bool isInside = times[i] >= t.front() && times[i] <= t.back();
+    // Get does not handle the first time, where the value is the first sample
+    const double expected = !isInside ? 0.0
+      : times[i] == t.front() ? x.front() + shift : signal.Get(times[i]) + shift;
+    if (std::abs(values[i] - expected) > 1e-9)
+    {
+      std::cerr << "Wrong value at " << times[i] << ": " << values[i] << " instead of "
+                << expected << std::endl;
+      nbrErrors++;
+      break;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestResample()
+{
+  int nbrErrors = 0;
+  Interpolator1D<double> line({ 0.0, 1.0, 3.0 }, { 0.0, 2.0, 6.0 });
+  const std::vector<double> samples = line.Resample(-0.5, 0.5, 9);
+  const double expected[] = { 0.0, 0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 0.0 };
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    if (std::abs(samples[i] - expected[i]) > 1e-12)
+    {
+      std::cerr << "Wrong sample " << i << ": " << samples[i] << std::endl;
+      nbrErrors++;
+    }
+  }
+  if (samples.size() != 9 || !line.Resample(0.0, 1.0, -1).empty())
+  {
+    std::cerr << "Wrong number of samples" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestSortedTimes();
+  nbrErrors += TestResample();
+  return nbrErrors;
+}
@@ -0,0 +1,131 @@
+// Decode the frames of a pcap keeping the null returns, and compare the per laser statistics
+// given by the reader with the points of the frame. In single return mode every return is a
+// point, in dual return mode the second returns which differ from the first are also points.
+
+#include "LidarDecodingKernels.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkDataArray.h>
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTable.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+vtkPolyData* UpdateFrame(vtkLidarReader* reader, int index)
+{
+  reader->UpdateInformation();
+  vtkInformation* outInfo = reader->GetExecutive()->GetOutputInformation(0);
+  double* timeSteps = outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(), timeSteps[index]);
+  reader->Update();
+  return vtkPolyData::SafeDownCast(reader->GetOutputDataObject(0));
+}
+
+//-----------------------------------------------------------------------------
+int CompareStatistics(vtkPolyData* frame, vtkTable* statistics, int numberOfLasers, int frameIndex)
+{
+  vtkDataArray* laserIds = frame->GetPointData()->GetArray("laser_id");
+  vtkDataArray* distances = frame->GetPointData()->GetArray("distance_raw");
+  vtkDataArray* intensities = frame->GetPointData()->GetArray("intensity");
+  vtkDataArray* matching = frame->GetPointData()->GetArray("dual_return_matching");
+  if (!laserIds || !distances || !intensities ||
+    statistics->GetNumberOfRows() != numberOfLasers + LaserStatistics::NumberOfAzimuthBins)
+  {
+    std::cerr << "Frame " << frameIndex << ": missing arrays or statistics" << std::endl;
+    return 1;
+  }
+
+  // the points paired with a previous one are the second returns
+  std::vector<vtkIdType> points(numberOfLasers, 0), dualPoints(numberOfLasers, 0);
+  std::vector<vtkIdType> nullPoints(numberOfLasers, 0);
+  std::vector<double> maxIntensity(numberOfLasers, 0.);
+  for (vtkIdType i = 0; i < frame->GetNumberOfPoints(); ++i)
+  {
+    const int laser = static_cast<int>(laserIds->GetTuple1(i));
+    const vtkIdType pair = matching ? static_cast<vtkIdType>(matching->GetTuple1(i)) : -1;
+    if (pair >= 0 && pair < i)
+    {
+      dualPoints[laser]++;
+      continue;
+    }
+    points[laser]++;
+    if (distances->GetTuple1(i) == 0)
+    {
+      nullPoints[laser]++;
+    }
+    else
+    {
+      maxIntensity[laser] = std::max(maxIntensity[laser], intensities->GetTuple1(i));
+    }
+  }
+
+  int nbrErrors = 0;
+  for (int laser = 0; laser < numberOfLasers; ++laser)
+  {
+    const vtkIdType returns = statistics->GetValueByName(laser, "returns").ToLongLong();
+    const vtkIdType nullReturns = statistics->GetValueByName(laser, "zero_returns").ToLongLong();
+    const double maximum = statistics->GetValueByName(laser, "max_intensity").ToDouble();
+    const double dualRatio = statistics->GetValueByName(laser, "dual_return_ratio").ToDouble();
+    const double expectedDualRatio = points[laser] > 0 ?
+      static_cast<double>(dualPoints[laser]) / points[laser] : 0.;
+    if (statistics->GetValueByName(laser, "laser_id").ToInt() != laser ||
+      returns != points[laser] || nullReturns != nullPoints[laser] ||
+      maximum != maxIntensity[laser] || std::abs(dualRatio - expectedDualRatio) > 1e-9)
+    {
+      std::cerr << "Frame " << frameIndex << ", laser " << laser << ": " << returns << " returns, "
+                << nullReturns << " null, max intensity " << maximum << ", dual ratio "
+                << dualRatio << " instead of " << points[laser] << ", " << nullPoints[laser]
+                << ", " << maxIntensity[laser] << ", " << expectedDualRatio << std::endl;
+      nbrErrors++;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: TestLaserStatistics <pcapFileName> <correctionFileName>" << std::endl;
+    return 1;
+  }
+
+  vtkNew<vtkLidarReader> reader;
+  vtkNew<vtkVelodynePacketInterpreter> interpreter;
+  interpreter->SetIgnoreZeroDistances(false);
+  reader->SetInterpreter(interpreter.GetPointer());
+  reader->SetFileName(argv[1]);
+  reader->SetCalibrationFileName(argv[2]);
+  reader->Update();
+  const int numberOfFrames = reader->GetNumberOfFrames();
+  const int numberOfLasers = interpreter->GetNumberOfChannels();
+  if (numberOfFrames < 1 || numberOfLasers < 1)
+  {
+    std::cerr << "The reader has no frame" << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = 0;
+  for (int frame = 0; frame < numberOfFrames; ++frame)
+  {
+    vtkPolyData* output = UpdateFrame(reader.GetPointer(), frame);
+    vtkTable* statistics = vtkTable::SafeDownCast(reader->GetOutputDataObject(2));
+    if (!output || !statistics)
+    {
+      std::cerr << "Missing frame " << frame << std::endl;
+      return 1;
+    }
+    nbrErrors += CompareStatistics(output, statistics, numberOfLasers, frame);
+  }
+  return nbrErrors;
+}
@@ -0,0 +1,193 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Write a frame of random values, on several blocks of points, and read it back:
+// the shortest values must be exact, then a TSV with some of the columns and a
+// fixed number of decimals.
+
+#include "vtkLidarCSVWriter.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> CreateFrame(vtkIdType numberOfPoints)
+{
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(-200., 200.);
+  std::uniform_int_distribution<int> exponent(-12, 12);
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToFloat();
+  points->SetNumberOfPoints(numberOfPoints);
+  auto intensity = vtkSmartPointer<vtkIntArray>::New();
+  intensity->SetName("intensity");
+  intensity->SetNumberOfTuples(numberOfPoints);
+  auto timestamp = vtkSmartPointer<vtkDoubleArray>::New();
+  timestamp->SetName("timestamp");
+  timestamp->SetNumberOfTuples(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    points->SetPoint(i, distribution(generator), std::round(distribution(generator)) / 100.,
+                     distribution(generator) * std::pow(10., exponent(generator)));
+    intensity->SetValue(i, static_cast<int>(i % 256) - 128);
+    timestamp->SetValue(i, 1.5e9 + distribution(generator));
+  }
+  auto frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->SetPoints(points);
+  frame->GetPointData()->AddArray(intensity);
+  frame->GetPointData()->AddArray(timestamp);
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<std::string> Split(const std::string& line, char delimiter)
+{
+  std::vector<std::string> values;
+  std::stringstream stream(line);
+  std::string value;
+  while (std::getline(stream, value, delimiter))
+  {
+    values.push_back(value);
+  }
+  return values;
+}
+
+//-----------------------------------------------------------------------------
+int TestShortest(vtkPolyData* frame, const std::string& fileName)
+{
+  vtkLidarCSVWriter writer;
+  writer.SetNumberOfThreads(4);
+  if (!writer.Write(frame, fileName))
+  {
+    std::cerr << "Cannot write " << fileName << std::endl;
+    return 1;
+  }
+
+  std::ifstream file(fileName.c_str());
+  std::string line;
+  std::getline(file, line);
+  if (line != "\"Points:0\",\"Points:1\",\"Points:2\",\"intensity\",\"timestamp\"")
+  {
+    std::cerr << "Unexpected header: " << line << std::endl;
+    return 1;
+  }
+  vtkDataArray* points = frame->GetPoints()->GetData();
+  vtkDataArray* intensity = frame->GetPointData()->GetArray("intensity");
+  vtkDataArray* timestamp = frame->GetPointData()->GetArray("timestamp");
+  vtkIdType pointIndex = 0;
+  for (; std::getline(file, line); ++pointIndex)
+  {
+    const std::vector<std::string> values = Split(line, ',');
+    if (pointIndex >= frame->GetNumberOfPoints() || values.size() != 5)
+    {
+      std::cerr << "Unexpected line " << pointIndex << ": " << line << std::endl;
+      return 1;
+    }
+    for (int component = 0; component < 3; ++component)
+    {
+      if (std::strtof(values[component].c_str(), nullptr) != static_cast<float>(points->GetComponent(pointIndex, component)))
+      {
+        std::cerr << "Point " << pointIndex << " is not exact: " << line << std::endl;
+        return 1;
+      }
+    }
+    if (std::atoi(values[3].c_str()) != intensity->GetTuple1(pointIndex) ||
+        std::strtod(values[4].c_str(), nullptr) != timestamp->GetTuple1(pointIndex))
+    {
+      std::cerr << "Point " << pointIndex << " has wrong arrays: " << line << std::endl;
+      return 1;
+    }
+  }
+  if (pointIndex != frame->GetNumberOfPoints())
+  {
+    std::cerr << "Expected " << frame->GetNumberOfPoints() << " points, got " << pointIndex << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestColumnsAndPrecision(vtkPolyData* frame, const std::string& fileName)
+{
+  vtkLidarCSVWriter writer;
+  writer.SetDelimiter('\t');
+  writer.SetPrecision(3);
+  writer.SetColumns({ "timestamp", "Points" });
+  if (!writer.Write(frame, fileName))
+  {
+    std::cerr << "Cannot write " << fileName << std::endl;
+    return 1;
+  }
+
+  // the columns keep the order of the frame
+  std::ifstream file(fileName.c_str());
+  std::string line;
+  std::getline(file, line);
+  if (line != "\"Points:0\"\t\"Points:1\"\t\"Points:2\"\t\"timestamp\"")
+  {
+    std::cerr << "Unexpected header: " << line << std::endl;
+    return 1;
+  }
+  std::getline(file, line);
+  const std::vector<std::string> values = Split(line, '\t');
+  double point[3];
+  frame->GetPoint(0, point);
+  for (size_t i = 0; i < values.size(); ++i)
+  {
+    const double expected = i < 3 ? point[i] : frame->GetPointData()->GetArray("timestamp")->GetTuple1(0);
+    const size_t dot = values[i].find('.');
+    if (values.size() != 4 || dot == std::string::npos || values[i].size() - dot != 4 ||
+        std::abs(std::strtod(values[i].c_str(), nullptr) - expected) > 0.0005 + 1e-9 * std::abs(expected))
+    {
+      std::cerr << "Unexpected fixed values: " << line << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Wrong number of arguments. Usage: TestLidarCSVWriter <outputDirectory>" << std::endl;
+    return 1;
+  }
+  const std::string outputDirectory = argv[1];
+
+  // more points than a block of 4 threads
+  vtkSmartPointer<vtkPolyData> frame = CreateFrame(300000);
+  return TestShortest(frame, outputDirectory + "/TestLidarCSVWriter.csv") +
+    TestColumnsAndPrecision(frame, outputDirectory + "/TestLidarCSVWriter.tsv");
+}
@@ -0,0 +1,80 @@
+// Iterate the frames of a pcap with a frame iterator and compare them with the frames
+// given by the reader one at a time, then stop an iteration before its end and start
+// another one.
+
+#include "TestHelpers.h"
+#include "vtkLidarFrameIterator.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: TestLidarFrameIterator <pcapFileName> <correctionFileName>" << std::endl;
+    return 1;
+  }
+
+  vtkNew<vtkLidarReader> reader;
+  auto interpreter = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  reader->SetInterpreter(interpreter);
+  reader->SetFileName(argv[1]);
+  reader->SetCalibrationFileName(argv[2]);
+  reader->Update();
+  const int numberOfFrames = reader->GetNumberOfFrames();
+  if (numberOfFrames == 0)
+  {
+    std::cerr << "The reader has no frame" << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = 0;
+  vtkNew<vtkLidarFrameIterator> iterator;
+  iterator->SetReader(reader.GetPointer());
+  iterator->SetNumberOfPrefetchedFrames(2);
+  iterator->Start(0, -1);
+  int expectedFrame = 0;
+  while (vtkPolyData* frame = iterator->Next())
+  {
+    vtkPolyData* expected = GetCurrentFrame(reader.GetPointer(), expectedFrame);
+    if (iterator->GetFrameNumber() != expectedFrame ||
+        frame->GetNumberOfPoints() != expected->GetNumberOfPoints())
+    {
+      std::cerr << "Wrong frame " << iterator->GetFrameNumber() << ", expected frame "
+                << expectedFrame << std::endl;
+      nbrErrors++;
+    }
+    expectedFrame++;
+  }
+  if (expectedFrame != numberOfFrames || !iterator->GetIsComplete())
+  {
+    std::cerr << "Expected " << numberOfFrames << " frames, got " << expectedFrame << std::endl;
+    nbrErrors++;
+  }
+
+  // the iteration is stopped while the next frames are decoded
+  iterator->Start(0, numberOfFrames - 1);
+  iterator->Next();
+  iterator->Stop();
+  if (iterator->Next() || iterator->GetIsComplete())
+  {
+    std::cerr << "A frame was given after the iteration was stopped" << std::endl;
+    nbrErrors++;
+  }
+  const int lastFrame = numberOfFrames - 1;
+  iterator->Start(lastFrame, lastFrame);
+  vtkPolyData* frame = iterator->Next();
+  if (!frame || iterator->GetFrameNumber() != lastFrame || iterator->Next())
+  {
+    std::cerr << "Wrong frames after a restart" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
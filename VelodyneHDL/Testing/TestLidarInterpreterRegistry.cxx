@@ -0,0 +1,84 @@
+#include "LidarDecodingKernels.h"
+#include "LidarInterpreterRegistry.h"
+#include "vtkDataPacket.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace DataPacketFixedLength;
+
+//-----------------------------------------------------------------------------
+int TestDetection()
+{
+  int nbrErrors = 0;
+  LidarInterpreterRegistry& registry = LidarInterpreterRegistry::GetInstance();
+  std::vector<std::string> names = registry.GetNames();
+  if (std::find(names.begin(), names.end(), "Velodyne") == names.end())
+  {
+    std::cerr << "Velodyne interpreter not registered" << std::endl;
+    nbrErrors++;
+  }
+
+  std::vector<unsigned char> data(HDLDataPacket::getDataByteLength(), 0);
+  HDLDataPacket* packet = reinterpret_cast<HDLDataPacket*>(data.data());
+  packet->factoryField2 = VLP16;
+  if (!registry.Detect(data.data(), data.size()).empty())
+  {
+    std::cerr << "Packet without block identifier recognized" << std::endl;
+    nbrErrors++;
+  }
+  for (int i = 0; i < HDL_FIRING_PER_PKT; ++i)
+  {
+    packet->firingData[i].blockIdentifier = BLOCK_0_TO_31;
+  }
+  if (registry.Detect(data.data(), data.size()) != "Velodyne")
+  {
+    std::cerr << "Velodyne packet not recognized" << std::endl;
+    nbrErrors++;
+  }
+  if (!registry.Detect(data.data(), 512).empty())
+  {
+    std::cerr << "Packet of another size recognized" << std::endl;
+    nbrErrors++;
+  }
+
+  vtkSmartPointer<vtkLidarPacketInterpreter> interpreter = registry.Create("Velodyne");
+  if (!vtkVelodynePacketInterpreter::SafeDownCast(interpreter) || registry.Create("Unknown"))
+  {
+    std::cerr << "Wrong interpreter created" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestAzimuthLookupTable()
+{
+  int nbrErrors = 0;
+  const AzimuthLookupTable& table = AzimuthLookupTable::GetHundredthsOfDegree();
+  const size_t numberOfAngles = AzimuthLookupTable::NumberOfAngles;
+  if (table.Cos.size() != numberOfAngles || table.Sin.size() != numberOfAngles)
+  {
+    std::cerr << "Wrong size of the azimuth table" << std::endl;
+    return 1;
+  }
+  if (table.Cos[0] != 1.0 || table.Sin[0] != 0.0 || std::abs(table.Cos[9000]) > 1e-15 ||
+    std::abs(table.Sin[9000] - 1.0) > 1e-15)
+  {
+    std::cerr << "Wrong values in the azimuth table" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  nbrErrors += TestDetection();
+  nbrErrors += TestAzimuthLookupTable();
+  return nbrErrors;
+}
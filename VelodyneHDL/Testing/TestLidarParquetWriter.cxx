@@ -0,0 +1,459 @@
+// Write frames in a Parquet file with several encoding threads and decode it back with a
+// minimal reader of the format: the schema, the row groups and every value of the columns,
+// dictionary encoded or plain, must match the frames.
+
+#include "vtkLidarParquetWriter.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+//! Value of the Thrift compact protocol
+struct ThriftValue
+{
+  int64_t Integer = 0;
+  std::string Binary;
+  std::vector<ThriftValue> Elements;
+  std::map<int, ThriftValue> Fields;
+
+  const ThriftValue& operator[](int id) const
+  {
+    static const ThriftValue missing;
+    auto field = this->Fields.find(id);
+    return field == this->Fields.end() ? missing : field->second;
+  }
+};
+
+//-----------------------------------------------------------------------------
+//! Minimal reader of the Thrift compact protocol
+class CompactReader
+{
+public:
+  CompactReader(const char* data, size_t size)
+    : Data(data)
+    , End(data + size)
+  {
+  }
+
+  uint64_t Varint()
+  {
+    uint64_t value = 0;
+    for (int shift = 0; this->Data < this->End; shift += 7)
+    {
+      const unsigned char byte = static_cast<unsigned char>(*this->Data++);
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+      {
+        break;
+      }
+    }
+    return value;
+  }
+
+  ThriftValue Read(int type)
+  {
+    ThriftValue value;
+    switch (type)
+    {
+      case 1:
+      case 2:
+        value.Integer = type == 1;
+        break;
+      case 3:
+        value.Integer = static_cast<signed char>(*this->Data++);
+        break;
+      case 4:
+      case 5:
+      case 6:
+      {
+        const uint64_t zigzag = this->Varint();
+        value.Integer = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+        break;
+      }
+      case 7:
+        this->Data += 8;
+        break;
+      case 8:
+      {
+        const size_t size = this->Varint();
+        value.Binary.assign(this->Data, size);
+        this->Data += size;
+        break;
+      }
+      case 9:
+      case 10:
+      {
+        const unsigned char header = static_cast<unsigned char>(*this->Data++);
+        const size_t size = (header >> 4) == 15 ? this->Varint() : header >> 4;
+        for (size_t i = 0; i < size; ++i)
+        {
+          value.Elements.push_back(this->Read(header & 0x0F));
+        }
+        break;
+      }
+      case 12:
+      {
+        int id = 0;
+        while (this->Data < this->End && *this->Data != 0)
+        {
+          const unsigned char header = static_cast<unsigned char>(*this->Data++);
+          if (header >> 4)
+          {
+            id += header >> 4;
+          }
+          else
+          {
+            const uint64_t zigzag = this->Varint();
+            id = static_cast<int>(static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1));
+          }
+          value.Fields[id] = this->Read(header & 0x0F);
+        }
+        this->Data++;
+        break;
+      }
+      default:
+        std::cerr << "Unexpected Thrift type " << type << std::endl;
+        this->Data = this->End;
+    }
+    return value;
+  }
+
+  const char* Data;
+  const char* End;
+};
+
+//-----------------------------------------------------------------------------
+//! Decode the RLE / bit-packing hybrid encoding
+std::vector<uint32_t> DecodeHybrid(CompactReader& reader, int bitWidth, size_t numberOfValues)
+{
+  std::vector<uint32_t> values;
+  const int byteWidth = (bitWidth + 7) / 8;
+  while (values.size() < numberOfValues && reader.Data < reader.End)
+  {
+    const uint64_t header = reader.Varint();
+    if (header & 1)
+    {
+      const size_t numberOfBits = (header >> 1) * 8 * bitWidth;
+      for (size_t bit = 0; bit < numberOfBits; bit += bitWidth)
+      {
+        uint32_t value = 0;
+        for (int b = 0; b < bitWidth; ++b)
+        {
+          const size_t position = bit + b;
+          value |= ((reader.Data[position / 8] >> (position % 8)) & 1u) << b;
+        }
+        values.push_back(value);
+      }
+      reader.Data += numberOfBits / 8;
+    }
+    else
+    {
+      uint32_t value = 0;
+      for (int b = 0; b < byteWidth; ++b)
+      {
+        value |= static_cast<uint32_t>(static_cast<unsigned char>(*reader.Data++)) << (8 * b);
+      }
+      values.insert(values.end(), header >> 1, value);
+    }
+  }
+  values.resize(numberOfValues);
+  return values;
+}
+
+//-----------------------------------------------------------------------------
+//! Decode the values of a column chunk as doubles
+bool ReadColumnChunk(const std::string& file, const ThriftValue& metaData, std::vector<double>& values)
+{
+  const int type = static_cast<int>(metaData[1].Integer);
+  const size_t valueSize = type == 1 || type == 4 ? 4 : 8;
+  auto toDouble = [type](const char* data) {
+    int32_t i32;
+    int64_t i64;
+    float f;
+    double d;
+    switch (type)
+    {
+      case 1:
+        std::memcpy(&i32, data, 4);
+        return static_cast<double>(i32);
+      case 2:
+        std::memcpy(&i64, data, 8);
+        return static_cast<double>(i64);
+      case 4:
+        std::memcpy(&f, data, 4);
+        return static_cast<double>(f);
+      default:
+        std::memcpy(&d, data, 8);
+        return d;
+    }
+  };
+
+  const bool hasDictionary = metaData.Fields.count(11) != 0;
+  size_t offset = hasDictionary ? metaData[11].Integer : metaData[9].Integer;
+  std::vector<double> dictionary;
+  values.clear();
+  while (values.size() < static_cast<size_t>(metaData[5].Integer))
+  {
+    CompactReader reader(file.data() + offset, file.size() - offset);
+    const ThriftValue header = reader.Read(12);
+    const size_t pageSize = header[3].Integer;
+    const char* page = reader.Data;
+    if (header[1].Integer == 2)
+    {
+      for (size_t i = 0; i < pageSize / valueSize; ++i)
+      {
+        dictionary.push_back(toDouble(page + i * valueSize));
+      }
+    }
+    else if (header[1].Integer == 0)
+    {
+      const size_t numberOfValues = header[5][1].Integer;
+      if (header[5][2].Integer == 2)
+      {
+        CompactReader indices(page + 1, pageSize - 1);
+        for (uint32_t index : DecodeHybrid(indices, page[0], numberOfValues))
+        {
+          if (index >= dictionary.size())
+          {
+            std::cerr << "Wrong dictionary index" << std::endl;
+            return false;
+          }
+          values.push_back(dictionary[index]);
+        }
+      }
+      else
+      {
+        for (size_t i = 0; i < numberOfValues; ++i)
+        {
+          values.push_back(toDouble(page + i * valueSize));
+        }
+      }
+    }
+    else
+    {
+      std::cerr << "Unexpected page type" << std::endl;
+      return false;
+    }
+    offset = (page - file.data()) + pageSize;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> CreateFrame(int frameNumber, std::mt19937& generator)
+{
+  std::uniform_real_distribution<double> distribution(-200., 200.);
+  const vtkIdType numberOfPoints = 1000 + 37 * frameNumber;
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints(numberOfPoints);
+  auto intensity = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  intensity->SetName("intensity");
+  intensity->SetNumberOfTuples(numberOfPoints);
+  auto laserId = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  laserId->SetName("laser_id");
+  laserId->SetNumberOfTuples(numberOfPoints);
+  auto distance = vtkSmartPointer<vtkFloatArray>::New();
+  distance->SetName("distance_m");
+  distance->SetNumberOfTuples(numberOfPoints);
+  auto time = vtkSmartPointer<vtkDoubleArray>::New();
+  time->SetName("adjustedtime");
+  time->SetNumberOfTuples(numberOfPoints);
+  auto matching = vtkSmartPointer<vtkIdTypeArray>::New();
+  matching->SetName("dual_return_matching");
+  matching->SetNumberOfTuples(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    points->SetPoint(i, distribution(generator), distribution(generator), distribution(generator));
+    intensity->SetValue(i, static_cast<unsigned char>(generator() % 256));
+    // long runs, then short ones
+    laserId->SetValue(i, static_cast<unsigned char>(i < 500 ? i / 100 : i % 16));
+    distance->SetValue(i, static_cast<float>(distribution(generator)));
+    time->SetValue(i, 1.5e9 + 1e-6 * i);
+    matching->SetValue(i, i % 3 == 0 ? -1 : i);
+  }
+  auto frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->SetPoints(points);
+  frame->GetPointData()->AddArray(intensity);
+  frame->GetPointData()->AddArray(laserId);
+  frame->GetPointData()->AddArray(distance);
+  frame->GetPointData()->AddArray(time);
+  frame->GetPointData()->AddArray(matching);
+  return frame;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Wrong number of arguments. Usage: TestLidarParquetWriter <outputDir>" << std::endl;
+    return 1;
+  }
+  const std::string fileName = std::string(argv[1]) + "/TestLidarParquetWriter.parquet";
+
+  std::mt19937 generator(0);
+  std::vector<vtkSmartPointer<vtkPolyData> > frames;
+  const int numberOfFrames = 23;
+  const int framesPerRowGroup = 4;
+  vtkLidarParquetWriter writer;
+  writer.SetNumberOfThreads(3);
+  writer.SetFramesPerRowGroup(framesPerRowGroup);
+  if (!writer.Open(fileName))
+  {
+    std::cerr << "Cannot open " << fileName << std::endl;
+    return 1;
+  }
+  for (int i = 0; i < numberOfFrames; ++i)
+  {
+    frames.push_back(CreateFrame(i, generator));
+    if (!writer.AddFrame(100 + i, frames.back()))
+    {
+      std::cerr << "Cannot add frame " << i << std::endl;
+      return 1;
+    }
+  }
+  if (!writer.Close())
+  {
+    std::cerr << "Cannot write " << fileName << std::endl;
+    return 1;
+  }
+
+  // magic numbers and footer
+  std::ifstream stream(fileName.c_str(), std::ios::in | std::ios::binary);
+  const std::string file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+  if (file.size() < 12 || file.compare(0, 4, "PAR1") != 0 || file.compare(file.size() - 4, 4, "PAR1") != 0)
+  {
+    std::cerr << "Missing magic number" << std::endl;
+    return 1;
+  }
+  uint32_t footerSize = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    footerSize |= static_cast<uint32_t>(static_cast<unsigned char>(file[file.size() - 8 + i])) << (8 * i);
+  }
+  CompactReader reader(file.data() + file.size() - 8 - footerSize, footerSize);
+  const ThriftValue metaData = reader.Read(12);
+
+  // schema
+  const std::vector<std::string> expectedColumns = { "x", "y", "z", "intensity", "laser_id",
+    "distance_m", "adjustedtime", "dual_return_matching", "frame" };
+  const std::vector<int> expectedTypes = { 5, 5, 5, 1, 1, 4, 5, 2, 1 };
+  const std::vector<ThriftValue>& schema = metaData[2].Elements;
+  if (schema.size() != expectedColumns.size() + 1 ||
+    schema[0][5].Integer != static_cast<int64_t>(expectedColumns.size()))
+  {
+    std::cerr << "Wrong schema" << std::endl;
+    return 1;
+  }
+  for (size_t i = 0; i < expectedColumns.size(); ++i)
+  {
+    if (schema[i + 1][4].Binary != expectedColumns[i] || schema[i + 1][1].Integer != expectedTypes[i])
+    {
+      std::cerr << "Wrong column " << schema[i + 1][4].Binary << std::endl;
+      return 1;
+    }
+  }
+  if (schema[4][6].Integer != 11)
+  {
+    std::cerr << "intensity is not annotated as UINT_8" << std::endl;
+    return 1;
+  }
+
+  // row groups
+  const std::vector<ThriftValue>& rowGroups = metaData[4].Elements;
+  const size_t expectedRowGroups = (numberOfFrames + framesPerRowGroup - 1) / framesPerRowGroup;
+  if (rowGroups.size() != expectedRowGroups)
+  {
+    std::cerr << "Wrong number of row groups: " << rowGroups.size() << std::endl;
+    return 1;
+  }
+  int64_t numberOfRows = 0;
+  bool hasDictionary = false;
+  for (size_t g = 0; g < rowGroups.size(); ++g)
+  {
+    const ThriftValue& rowGroup = rowGroups[g];
+    const std::vector<ThriftValue>& chunks = rowGroup[1].Elements;
+    if (chunks.size() != expectedColumns.size())
+    {
+      std::cerr << "Wrong number of column chunks" << std::endl;
+      return 1;
+    }
+    for (size_t c = 0; c < chunks.size(); ++c)
+    {
+      const ThriftValue& chunk = chunks[c][3];
+      std::vector<double> values;
+      if (chunk[5].Integer != rowGroup[3].Integer || !ReadColumnChunk(file, chunk, values))
+      {
+        std::cerr << "Cannot read column " << expectedColumns[c] << std::endl;
+        return 1;
+      }
+      hasDictionary |= chunk.Fields.count(11) != 0;
+
+      size_t row = 0;
+      for (size_t f = g * framesPerRowGroup; f < std::min<size_t>((g + 1) * framesPerRowGroup, numberOfFrames); ++f)
+      {
+        vtkPolyData* frame = frames[f];
+        for (vtkIdType i = 0; i < frame->GetNumberOfPoints(); ++i, ++row)
+        {
+          double expected;
+          if (c < 3)
+          {
+            expected = frame->GetPoints()->GetData()->GetComponent(i, static_cast<int>(c));
+          }
+          else if (c + 1 == chunks.size())
+          {
+            expected = 100. + f;
+          }
+          else
+          {
+            expected = frame->GetPointData()->GetArray(expectedColumns[c].c_str())->GetComponent(i, 0);
+          }
+          if (row >= values.size() || values[row] != expected)
+          {
+            std::cerr << "Wrong value of " << expectedColumns[c] << " in frame " << f << " at point "
+                      << i << std::endl;
+            return 1;
+          }
+        }
+      }
+    }
+    numberOfRows += rowGroup[3].Integer;
+  }
+
+  int64_t expectedRows = 0;
+  for (const auto& frame : frames)
+  {
+    expectedRows += frame->GetNumberOfPoints();
+  }
+  if (numberOfRows != expectedRows || metaData[3].Integer != expectedRows)
+  {
+    std::cerr << "Wrong number of rows" << std::endl;
+    return 1;
+  }
+  if (!hasDictionary)
+  {
+    std::cerr << "No column is dictionary encoded" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,169 @@
+// Write a frame as binary PCD and PLY files and read them back: the points and the
+// arrays must be exact, the multi-component arrays being split in PLY files, and the
+// ASCII files must be rejected.
+
+#include "vtkLidarPointCloudFile.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkIntArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> CreateFrame(vtkIdType numberOfPoints)
+{
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(-200., 200.);
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToDouble();
+  points->SetNumberOfPoints(numberOfPoints);
+  auto intensity = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  intensity->SetName("intensity");
+  intensity->SetNumberOfTuples(numberOfPoints);
+  auto laserId = vtkSmartPointer<vtkIntArray>::New();
+  laserId->SetName("laser_id");
+  laserId->SetNumberOfTuples(numberOfPoints);
+  auto timestamp = vtkSmartPointer<vtkDoubleArray>::New();
+  timestamp->SetName("timestamp");
+  timestamp->SetNumberOfTuples(numberOfPoints);
+  auto normal = vtkSmartPointer<vtkFloatArray>::New();
+  normal->SetName("normal");
+  normal->SetNumberOfComponents(3);
+  normal->SetNumberOfTuples(numberOfPoints);
+  auto pointId = vtkSmartPointer<vtkIdTypeArray>::New();
+  pointId->SetName("point id");
+  pointId->SetNumberOfTuples(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    points->SetPoint(i, distribution(generator), distribution(generator), distribution(generator));
+    intensity->SetValue(i, static_cast<unsigned char>(i % 256));
+    laserId->SetValue(i, static_cast<int>(i % 32) - 16);
+    timestamp->SetValue(i, 1.5e9 + distribution(generator));
+    normal->SetTuple3(i, distribution(generator), distribution(generator), distribution(generator));
+    pointId->SetValue(i, i);
+  }
+  auto frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->SetPoints(points);
+  frame->GetPointData()->AddArray(intensity);
+  frame->GetPointData()->AddArray(laserId);
+  frame->GetPointData()->AddArray(timestamp);
+  frame->GetPointData()->AddArray(normal);
+  frame->GetPointData()->AddArray(pointId);
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+int CompareArray(vtkDataArray* expected, vtkDataArray* read, int component, const std::string& name)
+{
+  if (!read || read->GetNumberOfTuples() != expected->GetNumberOfTuples() ||
+      (component < 0 && read->GetNumberOfComponents() != expected->GetNumberOfComponents()))
+  {
+    std::cerr << "Wrong array " << name << std::endl;
+    return 1;
+  }
+  const int firstComponent = component < 0 ? 0 : component;
+  const int lastComponent = component < 0 ? expected->GetNumberOfComponents() - 1 : component;
+  for (vtkIdType i = 0; i < expected->GetNumberOfTuples(); ++i)
+  {
+    for (int c = firstComponent; c <= lastComponent; ++c)
+    {
+      if (read->GetComponent(i, c - firstComponent) != expected->GetComponent(i, c))
+      {
+        std::cerr << "Wrong value of " << name << " for point " << i << std::endl;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestFormat(vtkPolyData* frame, int format, const std::string& fileName)
+{
+  vtkLidarPointCloudFile writer;
+  writer.SetFormat(format);
+  if (!writer.Write(frame, fileName))
+  {
+    std::cerr << "Cannot write " << fileName << std::endl;
+    return 1;
+  }
+  std::string error;
+  vtkSmartPointer<vtkPolyData> read = vtkLidarPointCloudFile::Read(fileName, &error);
+  if (!read)
+  {
+    std::cerr << "Cannot read " << fileName << ": " << error << std::endl;
+    return 1;
+  }
+  if (read->GetPoints()->GetDataType() != VTK_DOUBLE)
+  {
+    std::cerr << "The points of " << fileName << " are not doubles" << std::endl;
+    return 1;
+  }
+
+  vtkPointData* expected = frame->GetPointData();
+  vtkPointData* pointData = read->GetPointData();
+  int nbrErrors = CompareArray(frame->GetPoints()->GetData(), read->GetPoints()->GetData(), -1, "points");
+  nbrErrors += CompareArray(expected->GetArray("intensity"), pointData->GetArray("intensity"), -1, "intensity");
+  nbrErrors += CompareArray(expected->GetArray("laser_id"), pointData->GetArray("laser_id"), -1, "laser_id");
+  nbrErrors += CompareArray(expected->GetArray("timestamp"), pointData->GetArray("timestamp"), -1, "timestamp");
+  nbrErrors += CompareArray(expected->GetArray("point id"), pointData->GetArray("point_id"), -1, "point_id");
+  if (format == vtkLidarPointCloudFile::PCD)
+  {
+    nbrErrors += CompareArray(expected->GetArray("normal"), pointData->GetArray("normal"), -1, "normal");
+  }
+  else
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      const std::string name = "normal_" + std::to_string(c);
+      nbrErrors += CompareArray(expected->GetArray("normal"), pointData->GetArray(name.c_str()), c, name);
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestASCII(const std::string& fileName)
+{
+  {
+    std::ofstream file(fileName.c_str());
+    file << "VERSION 0.7\nFIELDS x y z\nSIZE 4 4 4\nTYPE F F F\nCOUNT 1 1 1\nWIDTH 1\n"
+         << "HEIGHT 1\nVIEWPOINT 0 0 0 1 0 0 0\nPOINTS 1\nDATA ascii\n1 2 3\n";
+  }
+  if (vtkLidarPointCloudFile::Read(fileName))
+  {
+    std::cerr << "An ASCII PCD file has been read" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Wrong number of arguments. Usage: TestLidarPointCloudFile <outputDirectory>" << std::endl;
+    return 1;
+  }
+  const std::string outputDirectory = argv[1];
+
+  // more points than a block
+  vtkSmartPointer<vtkPolyData> frame = CreateFrame(100000);
+  return TestFormat(frame, vtkLidarPointCloudFile::PCD, outputDirectory + "/TestLidarPointCloudFile.pcd") +
+    TestFormat(frame, vtkLidarPointCloudFile::PLY, outputDirectory + "/TestLidarPointCloudFile.ply") +
+    TestASCII(outputDirectory + "/TestLidarPointCloudFile_ascii.pcd");
+}
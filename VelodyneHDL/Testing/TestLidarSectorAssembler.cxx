@@ -0,0 +1,124 @@
+#include "LidarSectorAssembler.h"
+
+#include <vtkFieldData.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+// Create a sector with numberOfPoints points whose x is its first point id in the frame
+vtkSmartPointer<vtkPolyData> CreateSector(
+  int frameIndex, int sectorIndex, bool isLast, int firstPointId, int numberOfPoints)
+{
+  vtkSmartPointer<vtkPolyData> sector = vtkSmartPointer<vtkPolyData>::New();
+  vtkNew<vtkPoints> points;
+  for (int i = 0; i < numberOfPoints; ++i)
+  {
+    points->InsertNextPoint(firstPointId + i, 0, 0);
+  }
+  sector->SetPoints(points.GetPointer());
+  LidarSectorAssembler::SetSectorInformation(sector, frameIndex, sectorIndex, isLast);
+  return sector;
+}
+
+//-----------------------------------------------------------------------------
+int TestSectorInformation()
+{
+  int nbrErrors = 0;
+  vtkSmartPointer<vtkPolyData> sector = CreateSector(3, 7, false, 0, 1);
+  int frameIndex = 0, sectorIndex = 0;
+  bool isLast = true;
+  if (!LidarSectorAssembler::GetSectorInformation(sector, frameIndex, sectorIndex, isLast) ||
+    frameIndex != 3 || sectorIndex != 7 || isLast)
+  {
+    std::cerr << "Wrong sector information" << std::endl;
+    nbrErrors++;
+  }
+  if (!LidarSectorAssembler::IsPartialFrame(sector))
+  {
+    std::cerr << "A sector which is not the last one is a partial frame" << std::endl;
+    nbrErrors++;
+  }
+
+  vtkNew<vtkPolyData> frame;
+  if (LidarSectorAssembler::GetSectorInformation(frame.GetPointer(), frameIndex, sectorIndex, isLast) ||
+    LidarSectorAssembler::IsPartialFrame(frame.GetPointer()))
+  {
+    std::cerr << "A frame is not a sector" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestAssembly()
+{
+  int nbrErrors = 0;
+  LidarSectorAssembler assembler;
+
+  // the stream starts in the middle of the frame 0, which cannot be assembled
+  if (assembler.AddSector(CreateSector(0, 10, false, 0, 5)) ||
+    assembler.AddSector(CreateSector(0, 11, true, 5, 5)))
+  {
+    std::cerr << "Incomplete frame assembled" << std::endl;
+    nbrErrors++;
+  }
+
+  // the frame 1 is complete
+  bool isComplete = assembler.AddSector(CreateSector(1, 0, false, 0, 4));
+  isComplete = isComplete || assembler.AddSector(CreateSector(1, 1, false, 4, 3));
+  if (isComplete || !assembler.AddSector(CreateSector(1, 2, true, 7, 2)))
+  {
+    std::cerr << "Frame not assembled on its last sector" << std::endl;
+    nbrErrors++;
+  }
+  vtkSmartPointer<vtkPolyData> frame = assembler.GetFrame();
+  if (!frame || frame->GetNumberOfPoints() != 9)
+  {
+    std::cerr << "Wrong number of points in the assembled frame" << std::endl;
+    nbrErrors++;
+  }
+  else
+  {
+    for (vtkIdType i = 0; i < frame->GetNumberOfPoints(); ++i)
+    {
+      if (frame->GetPoint(i)[0] != i)
+      {
+        std::cerr << "Point " << i << " is out of order" << std::endl;
+        nbrErrors++;
+        break;
+      }
+    }
+    if (frame->GetFieldData()->GetArray(LidarSectorAssembler::FrameIndexArrayName))
+    {
+      std::cerr << "The assembled frame still has the sector information" << std::endl;
+      nbrErrors++;
+    }
+  }
+
+  // the last sector of the frame 2 is lost, the frame 3 comes in the middle of the frame 2
+  assembler.AddSector(CreateSector(2, 0, false, 0, 4));
+  if (assembler.AddSector(CreateSector(3, 0, false, 0, 4)) ||
+    assembler.AddSector(CreateSector(3, 1, true, 4, 4)))
+  {
+    std::cerr << "Frame assembled after a lost sector" << std::endl;
+    nbrErrors++;
+  }
+  if (!assembler.AddSector(CreateSector(4, 0, true, 0, 6)) ||
+    assembler.GetFrame()->GetNumberOfPoints() != 6)
+  {
+    std::cerr << "Frame of a single sector not assembled" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  nbrErrors += TestSectorInformation();
+  nbrErrors += TestAssembly();
+  return nbrErrors;
+}
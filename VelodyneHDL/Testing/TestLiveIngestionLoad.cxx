@@ -0,0 +1,331 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Replay a recording on loopback to several vtkLidarStream at a multiple of its speed, as
+// several sensors would send it, and write the drop rate, the decoding queue depth, the age
+// of the displayed frames and the memory over time as JSON:
+//
+//   TestLiveIngestionLoad <result.json> <pcapFileName> <correctionFileName> <speed>
+//     <numberOfSensors> <firstPort> [<maximumDropRatio> <maximumFrameAge>]
+//
+// Each sensor is replayed to its own port, firstPort + i. The streams are updated like the
+// application does, at most 30 times per second. The test fails when the packets lost by
+// a stream, on the network or by its decoding queue, exceed the maximum drop ratio, or when
+// the frames given to the pipeline are older than the maximum frame age, in seconds.
+
+#include "vtkLidarStream.h"
+#include "vtkPacketFileReader.h"
+#include "vvPacketSender.h"
+#include <vtkVelodynePacketInterpreter.h>
+
+#include <vtkInformation.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+//! Time between two updates of the streams, as done by the application
+const double UpdatePeriod = 1.0 / 30.0;
+
+//! Time between two samples of the measures
+const double SamplePeriod = 0.5;
+
+//! Time given to the streams to decode the last packets once the replay is done
+const double DrainDuration = 2.0;
+
+//-----------------------------------------------------------------------------
+double GetPeakResidentSetSize()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+  {
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+  }
+  return 0.0;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  return usage.ru_maxrss / 1024.0;
+#endif
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Number of lidar packets of the recording, the number of packets each stream must receive
+vtkIdType CountLidarPackets(const std::string& pcapFileName, vtkLidarPacketInterpreter* interpreter)
+{
+  vtkPacketFileReader reader;
+  if (!reader.Open(pcapFileName))
+  {
+    return 0;
+  }
+  vtkIdType count = 0;
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    count += interpreter->IsLidarPacket(data, dataLength);
+  }
+  return count;
+}
+
+//-----------------------------------------------------------------------------
+// Give the last frame of a stream to the pipeline, as the application does when it renders
+void UpdateStream(vtkLidarStream* stream)
+{
+  stream->Poll();
+  stream->UpdateInformation();
+  vtkInformation* info = stream->GetOutputInformation(0);
+  const int numberOfTimeSteps = info->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  if (numberOfTimeSteps > 0)
+  {
+    stream->UpdateTimeStep(info->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS())[numberOfTimeSteps - 1]);
+  }
+}
+
+//-----------------------------------------------------------------------------
+struct Sample
+{
+  double Time;
+  double ReplayTime;
+  double PeakMemory;
+  std::vector<double> ReceivedPacketRates;
+  std::vector<double> DroppedPacketRates;
+  std::vector<int> QueueDepths;
+  std::vector<double> FrameAges;
+};
+
+//-----------------------------------------------------------------------------
+template <typename T>
+void WriteArray(std::ostream& json, const std::vector<T>& values)
+{
+  json << "[";
+  for (size_t i = 0; i < values.size(); ++i)
+  {
+    json << (i == 0 ? "" : ", ") << values[i];
+  }
+  json << "]";
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 7)
+  {
+    std::cerr << "Usage: TestLiveIngestionLoad <result.json> <pcapFileName> <correctionFileName> "
+                 "<speed> <numberOfSensors> <firstPort> [<maximumDropRatio> <maximumFrameAge>]"
+              << std::endl;
+    return 1;
+  }
+  const std::string resultFileName = argv[1];
+  const std::string pcapFileName = argv[2];
+  const std::string correctionFileName = argv[3];
+  const double speed = std::atof(argv[4]);
+  const int numberOfSensors = std::max(std::atoi(argv[5]), 1);
+  const int firstPort = std::atoi(argv[6]);
+  const double maximumDropRatio = argc > 7 ? std::atof(argv[7]) : 0.01;
+  const double maximumFrameAge = argc > 8 ? std::atof(argv[8]) : 0.5;
+
+  auto interpreter = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  const vtkIdType numberOfLidarPackets = CountLidarPackets(pcapFileName, interpreter);
+  if (numberOfLidarPackets == 0)
+  {
+    std::cerr << "No lidar packet in " << pcapFileName << std::endl;
+    return 1;
+  }
+
+  std::vector<vtkSmartPointer<vtkLidarStream> > streams;
+  for (int i = 0; i < numberOfSensors; ++i)
+  {
+    auto stream = vtkSmartPointer<vtkLidarStream>::New();
+    stream->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+    stream->SetCalibrationFileName(correctionFileName);
+    // a small cache, so that the memory reflects the pipeline rather than the kept frames
+    stream->SetCacheSize(10);
+    stream->SetLIDARPort(firstPort + i);
+    stream->SetIsForwarding(false);
+    stream->Start();
+    streams.push_back(stream);
+  }
+
+  std::vector<Sample> samples;
+  double maximumObservedFrameAge = 0;
+  int maximumQueueDepth = 0;
+  try
+  {
+    // the position packets are sent to a port nobody listens
+    std::vector<std::unique_ptr<vvPacketSender> > senders;
+    for (int i = 0; i < numberOfSensors; ++i)
+    {
+      senders.emplace_back(new vvPacketSender(pcapFileName, "127.0.0.1", firstPort + i,
+        firstPort + numberOfSensors + i));
+    }
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+
+    const auto start = std::chrono::steady_clock::now();
+    double lastUpdate = -UpdatePeriod;
+    double lastSample = 0;
+    double doneTime = -1;
+    while (true)
+    {
+      const double elapsed =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      bool done = true;
+      for (std::unique_ptr<vvPacketSender>& sender : senders)
+      {
+        sender->pumpPackets(elapsed * speed);
+        done &= sender->IsDone();
+      }
+      if (done && doneTime < 0)
+      {
+        doneTime = elapsed;
+      }
+      if (doneTime >= 0 && elapsed - doneTime > DrainDuration)
+      {
+        break;
+      }
+
+      if (elapsed - lastUpdate >= UpdatePeriod)
+      {
+        lastUpdate = elapsed;
+        for (vtkLidarStream* stream : streams)
+        {
+          UpdateStream(stream);
+        }
+      }
+
+      if (elapsed - lastSample >= SamplePeriod)
+      {
+        lastSample = elapsed;
+        Sample sample;
+        sample.Time = elapsed;
+        sample.ReplayTime = elapsed * speed;
+        sample.PeakMemory = GetPeakResidentSetSize();
+        for (vtkLidarStream* stream : streams)
+        {
+          sample.ReceivedPacketRates.push_back(stream->GetReceivedPacketRate());
+          sample.DroppedPacketRates.push_back(stream->GetDroppedPacketRate());
+          sample.QueueDepths.push_back(stream->GetDecodingQueueDepth());
+          sample.FrameAges.push_back(stream->GetDisplayedFrameAge());
+          maximumQueueDepth = std::max(maximumQueueDepth, sample.QueueDepths.back());
+          // the frames shown after the replay are not late
+          if (doneTime < 0)
+          {
+            maximumObservedFrameAge = std::max(maximumObservedFrameAge, sample.FrameAges.back());
+          }
+        }
+        samples.push_back(sample);
+      }
+
+      boost::this_thread::sleep(boost::posix_time::microseconds(500));
+    }
+  }
+  catch (std::exception& e)
+  {
+    std::cerr << "Caught Exception: " << e.what() << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = 0;
+  std::vector<double> dropRatios;
+  for (int i = 0; i < numberOfSensors; ++i)
+  {
+    vtkLidarStream* stream = streams[i];
+    stream->Stop();
+    // lost on the network, or dropped by the decoding queue
+    const double decoded = static_cast<double>(stream->GetNumberOfReceivedPackets() -
+      stream->GetNumberOfDroppedPackets());
+    dropRatios.push_back(std::max(0.0, 1.0 - decoded / numberOfLidarPackets));
+    if (dropRatios.back() > maximumDropRatio)
+    {
+      std::cerr << "Sensor " << i << ": " << 100 * dropRatios.back() << " % of the packets lost, "
+                << stream->GetNumberOfDroppedPackets() << " dropped by the decoding queue"
+                << std::endl;
+      nbrErrors++;
+    }
+  }
+  if (maximumObservedFrameAge > maximumFrameAge)
+  {
+    std::cerr << "The frames given to the pipeline were " << maximumObservedFrameAge
+              << " s old" << std::endl;
+    nbrErrors++;
+  }
+
+  std::ofstream json(resultFileName.c_str());
+  if (!json.is_open())
+  {
+    std::cerr << "Cannot create " << resultFileName << std::endl;
+    return 1;
+  }
+  json << std::setprecision(6) << std::fixed;
+  json << "{\n"
+       << "  \"speed\": " << speed << ",\n"
+       << "  \"sensors\": " << numberOfSensors << ",\n"
+       << "  \"lidar_packets_per_sensor\": " << numberOfLidarPackets << ",\n"
+       << "  \"drop_ratios\": ";
+  WriteArray(json, dropRatios);
+  json << ",\n"
+       << "  \"maximum_queue_depth\": " << maximumQueueDepth << ",\n"
+       << "  \"maximum_frame_age_s\": " << maximumObservedFrameAge << ",\n"
+       << "  \"peak_memory_mb\": " << GetPeakResidentSetSize() << ",\n"
+       << "  \"samples\": [\n";
+  for (size_t i = 0; i < samples.size(); ++i)
+  {
+    const Sample& sample = samples[i];
+    json << "    { \"time_s\": " << sample.Time << ", \"replay_time_s\": " << sample.ReplayTime
+         << ", \"peak_memory_mb\": " << sample.PeakMemory << ", \"received_packets_per_s\": ";
+    WriteArray(json, sample.ReceivedPacketRates);
+    json << ", \"dropped_packets_per_s\": ";
+    WriteArray(json, sample.DroppedPacketRates);
+    json << ", \"queue_depths\": ";
+    WriteArray(json, sample.QueueDepths);
+    json << ", \"frame_ages_s\": ";
+    WriteArray(json, sample.FrameAges);
+    json << " }" << (i + 1 < samples.size() ? "," : "") << "\n";
+  }
+  json << "  ],\n"
+       << "  \"errors\": " << nbrErrors << "\n"
+       << "}\n";
+
+  return nbrErrors;
+}
@@ -0,0 +1,94 @@
+#include "LiveTelemetry.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <cmath>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+bool IsClose(double value, double expected)
+{
+  return std::abs(value - expected) <= 0.2 * expected;
+}
+
+//-----------------------------------------------------------------------------
+int TestSample()
+{
+  int nbrErrors = 0;
+  LiveTelemetry telemetry;
+
+  // the first sample starts the counting
+  telemetry.AddReceivedPackets(1000);
+  LiveTelemetry::Sample sample = telemetry.GetSample();
+  if (sample.ReceivedPacketRate != 0 || sample.FrameRate != 0)
+  {
+    std::cerr << "The first sample must be empty" << std::endl;
+    nbrErrors++;
+  }
+
+  telemetry.AddReceivedPackets(100);
+  telemetry.AddQueuedPackets(90);
+  telemetry.AddDroppedPackets(10);
+  for (int i = 0; i < 20; ++i)
+  {
+    telemetry.AddDecodedPacket();
+  }
+  telemetry.AddFrame(0.002);
+  telemetry.AddFrame(0.004);
+  telemetry.AddDecodingWaitTime(0.1);
+  telemetry.AddReceiveLatency(0.001);
+  telemetry.AddReceiveLatency(0.003);
+  telemetry.AddReceiveLatency(-0.001);
+
+  // the sample is kept until the interval has elapsed
+  sample = telemetry.GetSample();
+  if (sample.ReceivedPacketRate != 0)
+  {
+    std::cerr << "The sample has been renewed too early" << std::endl;
+    nbrErrors++;
+  }
+
+  const double interval = LiveTelemetry::SampleInterval;
+  boost::this_thread::sleep(boost::posix_time::milliseconds(static_cast<int>(interval * 1000)));
+  sample = telemetry.GetSample();
+  if (!IsClose(sample.ReceivedPacketRate, 100 / interval) ||
+    !IsClose(sample.QueuedPacketRate, 90 / interval) ||
+    !IsClose(sample.DroppedPacketRate, 10 / interval) ||
+    !IsClose(sample.DecodedPacketRate, 20 / interval) || !IsClose(sample.FrameRate, 2 / interval))
+  {
+    std::cerr << "Wrong rates, received: " << sample.ReceivedPacketRate
+              << ", queued: " << sample.QueuedPacketRate
+              << ", dropped: " << sample.DroppedPacketRate
+              << ", decoded: " << sample.DecodedPacketRate << ", frames: " << sample.FrameRate
+              << std::endl;
+    nbrErrors++;
+  }
+  if (!IsClose(sample.FrameDecodeTime, 0.003) || !IsClose(sample.MaxFrameDecodeTime, 0.004))
+  {
+    std::cerr << "Wrong frame decode time: " << sample.FrameDecodeTime
+              << ", max: " << sample.MaxFrameDecodeTime << std::endl;
+    nbrErrors++;
+  }
+  // a negative latency, from a card clock ahead of the system clock, counts as 0
+  if (!IsClose(sample.ReceiveLatency, 0.004 / 3) || !IsClose(sample.MaxReceiveLatency, 0.003))
+  {
+    std::cerr << "Wrong receive latency: " << sample.ReceiveLatency
+              << ", max: " << sample.MaxReceiveLatency << std::endl;
+    nbrErrors++;
+  }
+  if (!IsClose(sample.DecodingWaitRatio, 0.1 / interval) || sample.PublishingWaitRatio != 0 ||
+    !IsClose(telemetry.GetDecodingWaitTime(), 0.1))
+  {
+    std::cerr << "Wrong wait ratio: " << sample.DecodingWaitRatio << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestSample();
+  return nbrErrors;
+}
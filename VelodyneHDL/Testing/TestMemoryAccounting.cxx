@@ -0,0 +1,176 @@
+#include "MemoryAccounting.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <iostream>
+#include <memory>
+
+//-----------------------------------------------------------------------------
+int TestAccounts()
+{
+  int nbrErrors = 0;
+  const int subsystem = MemoryAccounting::TRAILING_FRAMES;
+  {
+    MemoryAccounting::Account first(MemoryAccounting::TRAILING_FRAMES);
+    MemoryAccounting::Account second(MemoryAccounting::TRAILING_FRAMES);
+    first.Set(100);
+    second.Set(50);
+    first.Set(30);
+    if (MemoryAccounting::GetSize(subsystem) != 80 ||
+      MemoryAccounting::GetPeakSize(subsystem) != 150)
+    {
+      std::cerr << "Wrong size: " << MemoryAccounting::GetSize(subsystem)
+                << ", peak: " << MemoryAccounting::GetPeakSize(subsystem) << std::endl;
+      nbrErrors++;
+    }
+    if (MemoryAccounting::GetSize(MemoryAccounting::SLAM_MAPS) != 0)
+    {
+      std::cerr << "The size of another subsystem has changed" << std::endl;
+      nbrErrors++;
+    }
+  }
+
+  // the accounts are removed from the total when destroyed, the peak is kept until reset
+  if (MemoryAccounting::GetSize(subsystem) != 0 || MemoryAccounting::GetPeakSize(subsystem) != 150)
+  {
+    std::cerr << "Wrong size after the destruction of the accounts: "
+              << MemoryAccounting::GetSize(subsystem) << std::endl;
+    nbrErrors++;
+  }
+  MemoryAccounting::ResetPeakSizes();
+  if (MemoryAccounting::GetPeakSize(subsystem) != 0)
+  {
+    std::cerr << "The peak size has not been reset" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestConcurrentAccounts()
+{
+  int nbrErrors = 0;
+  const int subsystem = MemoryAccounting::LIVE_FRAMES;
+  const int numberOfThreads = 8;
+  std::unique_ptr<MemoryAccounting::Account> accounts[numberOfThreads];
+  boost::thread_group threads;
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    accounts[i].reset(new MemoryAccounting::Account(MemoryAccounting::LIVE_FRAMES));
+    MemoryAccounting::Account* account = accounts[i].get();
+    threads.create_thread([account]() {
+      for (unsigned long size = 0; size <= 10000; ++size)
+      {
+        account->Set(size % 2 == 0 ? size : 0);
+      }
+    });
+  }
+  threads.join_all();
+
+  if (MemoryAccounting::GetSize(subsystem) != numberOfThreads * 10000ul)
+  {
+    std::cerr << "Wrong size after concurrent updates: " << MemoryAccounting::GetSize(subsystem)
+              << std::endl;
+    nbrErrors++;
+  }
+  if (MemoryAccounting::GetPeakSize(subsystem) < MemoryAccounting::GetSize(subsystem) ||
+    MemoryAccounting::GetPeakSize(subsystem) > numberOfThreads * 10000ul)
+  {
+    std::cerr << "Wrong peak size after concurrent updates: "
+              << MemoryAccounting::GetPeakSize(subsystem) << std::endl;
+    nbrErrors++;
+  }
+  if (MemoryAccounting::GetSummary().find(MemoryAccounting::GetSubsystemName(subsystem)) ==
+    std::string::npos)
+  {
+    std::cerr << "The summary does not list the live frames: " << MemoryAccounting::GetSummary()
+              << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestBudget()
+{
+  int nbrErrors = 0;
+  // releasers freeing what they are asked for, like the caches
+  MemoryAccounting::Account frames(MemoryAccounting::READER_FRAMES);
+  MemoryAccounting::Account packets(MemoryAccounting::READER_PACKETS);
+  MemoryAccounting::Account live(MemoryAccounting::LIVE_FRAMES);
+  MemoryAccounting::Account trailing(MemoryAccounting::TRAILING_FRAMES);
+  auto makeReleaser = [](MemoryAccounting::Account& account) {
+    return [&account](unsigned long kibibytes) {
+      account.Set(account.Get() > kibibytes ? account.Get() - kibibytes : 0);
+    };
+  };
+  live.SetReleaser(MemoryAccounting::LIVE_DATA_PRIORITY, makeReleaser(live));
+  packets.SetReleaser(MemoryAccounting::FILE_DATA_PRIORITY, makeReleaser(packets));
+  frames.SetReleaser(MemoryAccounting::DECODED_DATA_PRIORITY, makeReleaser(frames));
+  frames.Set(300);
+  packets.Set(200);
+  live.Set(100);
+  trailing.Set(400);
+
+  // the trailing frames are not releasable, the decoded frames are released first
+  MemoryAccounting::SetBudget(750);
+  unsigned long released = MemoryAccounting::Enforce();
+  if (released < 250 || frames.Get() != 50 || packets.Get() != 200 || live.Get() != 100 ||
+    trailing.Get() != 400)
+  {
+    std::cerr << "Wrong release order: released " << released << ", frames " << frames.Get()
+              << ", packets " << packets.Get() << ", live " << live.Get() << std::endl;
+    nbrErrors++;
+  }
+
+  // a releaser which cannot release now is skipped
+  frames.SetReleaser(MemoryAccounting::DECODED_DATA_PRIORITY, [](unsigned long) {});
+  MemoryAccounting::SetBudget(600);
+  released = MemoryAccounting::Enforce();
+  if (released < 150 || frames.Get() != 50 || packets.Get() != 50 || live.Get() != 100)
+  {
+    std::cerr << "A busy releaser is not skipped: released " << released << ", packets "
+              << packets.Get() << ", live " << live.Get() << std::endl;
+    nbrErrors++;
+  }
+
+  // nothing is released within the budget, unless the system is short of memory
+  unsigned long total = 0;
+  unsigned long available = 0;
+  const bool pressure =
+    MemoryAccounting::GetSystemMemory(total, available) && available < total / 10;
+  MemoryAccounting::SetBudget(0);
+  if (!pressure && MemoryAccounting::Enforce() != 0)
+  {
+    std::cerr << "Memory released without budget" << std::endl;
+    nbrErrors++;
+  }
+
+  // the releasers are removed with the accounts
+  {
+    MemoryAccounting::Account temporary(MemoryAccounting::READER_FRAMES);
+    temporary.SetReleaser(MemoryAccounting::DECODED_DATA_PRIORITY, makeReleaser(temporary));
+    temporary.Set(1000);
+  }
+  frames.SetReleaser(0, nullptr);
+  MemoryAccounting::SetBudget(500);
+  MemoryAccounting::Enforce();
+  if (frames.Get() != 50 || packets.Get() != 0 || live.Get() != 50)
+  {
+    std::cerr << "Wrong release without the decoded frames: frames " << frames.Get()
+              << ", packets " << packets.Get() << ", live " << live.Get() << std::endl;
+    nbrErrors++;
+  }
+  MemoryAccounting::SetBudget(0);
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestAccounts();
+  nbrErrors += TestConcurrentAccounts();
+  nbrErrors += TestBudget();
+  return nbrErrors;
+}
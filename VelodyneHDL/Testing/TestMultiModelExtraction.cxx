@@ -0,0 +1,127 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Check that the multi model extraction finds the ground, a wall crossing several cells and
+// a pole, each one as a single model
+
+#include "MultiModelExtraction.h"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+void AddPoint(RansacPoints& points, float x, float y, float z)
+{
+  points.X.push_back(x);
+  points.Y.push_back(y);
+  points.Z.push_back(z);
+}
+
+//-----------------------------------------------------------------------------
+// Check that the points of [begin, end[ mostly have the same model, of the given type
+int CheckModel(const MultiModelExtraction::Result& result, size_t begin, size_t end,
+  MultiModelExtraction::ModelType type, const char* name)
+{
+  const int label = result.Labels[begin];
+  size_t count = 0;
+  for (size_t k = begin; k < end; ++k)
+  {
+    count += result.Labels[k] == label;
+  }
+  if (label < 0 || result.Models[label].Type != type || count < 0.95 * (end - begin))
+  {
+    std::cerr << name << ": model " << label << " for " << count << " points out of "
+              << end - begin << std::endl;
+    return 1;
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> uniform(0.f, 1.f);
+  std::normal_distribution<float> noise(0.f, 0.01f);
+  RansacPoints points;
+
+  // ground of 20 m x 20 m, 4 cells x 4 cells
+  for (int k = 0; k < 8000; ++k)
+  {
+    AddPoint(points, 20.f * uniform(generator), 20.f * uniform(generator), noise(generator));
+  }
+  // wall x = 17 from y = 1 to y = 19, 3 m high
+  const size_t wall = points.size();
+  for (int k = 0; k < 3000; ++k)
+  {
+    AddPoint(points, 17.f + noise(generator), 1.f + 18.f * uniform(generator),
+             0.3f + 2.7f * uniform(generator));
+  }
+  // pole of radius 0.1 m at (7, 7)
+  const size_t pole = points.size();
+  for (int k = 0; k < 600; ++k)
+  {
+    const float angle = 6.2831853f * uniform(generator);
+    AddPoint(points, 7.f + 0.1f * std::cos(angle) + noise(generator),
+             7.f + 0.1f * std::sin(angle) + noise(generator), 0.3f + 4.f * uniform(generator));
+  }
+
+  MultiModelExtraction extraction;
+  extraction.Threshold = 0.05;
+  extraction.NumberOfThreads = 4;
+  MultiModelExtraction::Result result;
+  extraction.Run(points, result);
+
+  int nbrErrors = 0;
+  nbrErrors += CheckModel(result, 0, wall, MultiModelExtraction::PLANE, "Ground");
+  nbrErrors += CheckModel(result, wall, pole, MultiModelExtraction::PLANE, "Wall");
+  nbrErrors += CheckModel(result, pole, points.size(), MultiModelExtraction::CYLINDER, "Pole");
+  if (result.Labels[0] != 0)
+  {
+    std::cerr << "The ground is not the largest model" << std::endl;
+    nbrErrors++;
+  }
+  const MultiModelExtraction::Model& model = result.Models[result.Labels[pole]];
+  if (std::abs(model.Parameters[0] - 7.f) > 0.05f || std::abs(model.Parameters[1] - 7.f) > 0.05f ||
+    std::abs(model.Parameters[2] - 0.1f) > 0.05f)
+  {
+    std::cerr << "Wrong pole: " << model.Parameters[0] << ", " << model.Parameters[1]
+              << ", radius " << model.Parameters[2] << std::endl;
+    nbrErrors++;
+  }
+
+  // the cells are fitted with their own seed, so that the merged models come in the same order,
+  // with the same sizes, whatever the cells fitted by each thread
+  extraction.NumberOfThreads = 1;
+  MultiModelExtraction::Result singleThreaded;
+  extraction.Run(points, singleThreaded);
+  bool sameModels = singleThreaded.Models.size() == result.Models.size();
+  for (size_t m = 0; sameModels && m < result.Models.size(); ++m)
+  {
+    sameModels = singleThreaded.Models[m].Type == result.Models[m].Type &&
+      singleThreaded.Models[m].NumberOfPoints == result.Models[m].NumberOfPoints;
+  }
+  if (!sameModels || singleThreaded.Labels != result.Labels)
+  {
+    std::cerr << "The models fitted by a single thread differ: " << singleThreaded.Models.size()
+              << " models instead of " << result.Models.size() << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
@@ -1,5 +1,6 @@
 #include "NMEAParser.h"
 
+#include <chrono>
 #include <iostream>
 #include <iomanip>
 
@@ -112,6 +113,27 @@ bool test_sentence(NMEAParser& parser,
 }
 
 
+// Parse the sentences many times and print the rate, parsing must not allocate
+bool benchmark_sentences(NMEAParser& parser, const char* const sentences[], int count)
+{
+  const int repetitions = 100000;
+  NMEALocation location;
+  int parsed = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repetitions; ++i)
+  {
+    for (int j = 0; j < count; ++j)
+    {
+      parsed += parser.ParseLocation(sentences[j], location) ? 1 : 0;
+    }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "Parsed " << repetitions * count << " sentences in " << elapsed.count()
+            << " s (" << repetitions * count / elapsed.count() << " sentences/s)" << std::endl;
+  return parsed == repetitions * count;
+}
+
+
 int main(int argc, char* argv[])
 {
   double unused_double = 42.0;
@@ -251,6 +273,12 @@ int main(int argc, char* argv[])
                            true, // no FAA
                            NMEALocation::DIFFERENTIAL_FAA);
 
+  const char* const sentences[] = {
+    "$GPGGA,123519.5,4807.038,S,01131.000,W,1,08,0.9,545.4,M,46.9,M,,*53",
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W,A,*2B",
+    "$GPGLL,4916.45,N,12311.12,W,225444,A,D,*75"
+  };
+  allgood &= benchmark_sentences(parser, sentences, 3);
 
   return allgood ? 0 : 1;
 }
@@ -0,0 +1,104 @@
+#include "NetworkIngestionEngine.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+#include <iostream>
+#include <set>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+int TestSpreading()
+{
+  int nbrErrors = 0;
+  NetworkIngestionEngine engine;
+  engine.SetNumberOfThreads(2);
+
+  // four sensors are spread over the two threads
+  std::vector<boost::asio::io_service*> services;
+  for (int i = 0; i < 4; ++i)
+  {
+    services.push_back(&engine.Attach());
+  }
+  std::set<boost::asio::io_service*> distinct(services.begin(), services.end());
+  if (engine.GetNumberOfRunningThreads() != 2 || distinct.size() != 2 ||
+    services[0] == services[1] || services[0] != services[2])
+  {
+    std::cerr << "Sources not spread over the threads" << std::endl;
+    nbrErrors++;
+  }
+
+  // the work posted on a service is run by its thread
+  std::atomic<int> numberOfCalls(0);
+  for (boost::asio::io_service* service : services)
+  {
+    service->post([&numberOfCalls]() { numberOfCalls++; });
+  }
+  for (int i = 0; i < 1000 && numberOfCalls < 4; ++i)
+  {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+  }
+  if (numberOfCalls != 4)
+  {
+    std::cerr << "Work not run by the threads" << std::endl;
+    nbrErrors++;
+  }
+
+  // a detached slot is given to the next source
+  engine.Detach(*services[1]);
+  if (&engine.Attach() != services[1])
+  {
+    std::cerr << "Least loaded thread not chosen" << std::endl;
+    nbrErrors++;
+  }
+
+  for (boost::asio::io_service* service : services)
+  {
+    engine.Detach(*service);
+  }
+  if (engine.GetNumberOfRunningThreads() != 0)
+  {
+    std::cerr << "Threads not stopped with the last source" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestRestart()
+{
+  int nbrErrors = 0;
+  NetworkIngestionEngine engine;
+  engine.SetNumberOfThreads(1);
+  boost::asio::io_service& first = engine.Attach();
+  boost::asio::io_service& second = engine.Attach();
+  if (&first != &second || engine.GetNumberOfRunningThreads() != 1)
+  {
+    std::cerr << "Number of threads not respected" << std::endl;
+    nbrErrors++;
+  }
+  engine.Detach(first);
+  engine.Detach(second);
+
+  // the new number of threads is used once the threads are restarted
+  engine.SetNumberOfThreads(3);
+  for (int i = 0; i < 3; ++i)
+  {
+    engine.Attach();
+  }
+  if (engine.GetNumberOfRunningThreads() != 3)
+  {
+    std::cerr << "Threads not restarted" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  nbrErrors += TestSpreading();
+  nbrErrors += TestRestart();
+  return nbrErrors;
+}
@@ -0,0 +1,109 @@
+#include "NpyStackWriter.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <vtkType.h>
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+//-----------------------------------------------------------------------------
+//! Check the header and the values of a file of frames of 2 x 3 unsigned shorts
+int CheckFile(const fs::path& fileName, int numberOfFrames)
+{
+  std::ifstream file(fileName.string().c_str(), std::ios::binary);
+  const std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (content.size() < 10 || content.compare(0, 6, "\x93NUMPY") != 0)
+  {
+    std::cerr << fileName << ": not a npy file" << std::endl;
+    return 1;
+  }
+
+  // the data starts at a multiple of 64 bytes, after a header ended by a new line
+  const size_t headerSize = 10 + static_cast<unsigned char>(content[8]) +
+    256 * static_cast<unsigned char>(content[9]);
+  const std::string header = content.substr(10, headerSize - 10);
+  const std::string shape = "'shape': (" + std::to_string(numberOfFrames) + ", 2, 3,)";
+  if (headerSize % 64 != 0 || header.back() != '\n' ||
+    header.find("'descr': '<u2'") == std::string::npos || header.find(shape) == std::string::npos)
+  {
+    std::cerr << fileName << ": wrong header " << header << std::endl;
+    return 1;
+  }
+
+  const size_t frameSize = 6 * sizeof(unsigned short);
+  if (content.size() != headerSize + numberOfFrames * frameSize)
+  {
+    std::cerr << fileName << ": " << content.size() << " bytes" << std::endl;
+    return 1;
+  }
+  for (int frame = 0; frame < numberOfFrames; ++frame)
+  {
+    unsigned short values[6];
+    std::memcpy(values, content.data() + headerSize + frame * frameSize, frameSize);
+    for (int i = 0; i < 6; ++i)
+    {
+      if (values[i] != 100 * frame + i)
+      {
+        std::cerr << fileName << ": wrong value of frame " << frame << std::endl;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  const fs::path directory = fs::temp_directory_path() / fs::unique_path("TestNpyStackWriter-%%%%%%");
+  fs::create_directories(directory);
+
+  int nbrErrors = 0;
+  const std::string descr = NpyStackWriter::GetDescr(VTK_UNSIGNED_SHORT);
+  for (int numberOfFrames : { 0, 1, 250 })
+  {
+    const fs::path fileName = directory / ("frames_" + std::to_string(numberOfFrames) + ".npy");
+    NpyStackWriter writer;
+    if (!writer.Open(fileName.string(), descr, sizeof(unsigned short), { 2, 3 }))
+    {
+      std::cerr << fileName << ": cannot be created" << std::endl;
+      nbrErrors++;
+      continue;
+    }
+    for (int frame = 0; frame < numberOfFrames; ++frame)
+    {
+      unsigned short values[6];
+      for (int i = 0; i < 6; ++i)
+      {
+        values[i] = static_cast<unsigned short>(100 * frame + i);
+      }
+      writer.Append(values);
+    }
+    if (!writer.Close())
+    {
+      std::cerr << fileName << ": cannot be written" << std::endl;
+      nbrErrors++;
+    }
+    nbrErrors += CheckFile(fileName, numberOfFrames);
+  }
+
+  if (NpyStackWriter::GetDescr(VTK_FLOAT) != "<f4" || !NpyStackWriter::GetDescr(VTK_STRING).empty())
+  {
+    std::cerr << "Wrong NumPy types" << std::endl;
+    nbrErrors++;
+  }
+
+  boost::system::error_code error;
+  fs::remove_all(directory, error);
+  return nbrErrors;
+}
@@ -0,0 +1,144 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Check that the occupancy grid frees the space crossed by the rays, occupies the cells of
+// the points, and forgets the cells leaving the grid as it follows the sensor
+
+#include "OccupancyGrid.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+const double Resolution = 0.5;
+
+//-----------------------------------------------------------------------------
+// Points of a wall x = 5.1 from y = -3 to 3 and from z = 0 to 2
+std::vector<float> CreateWall()
+{
+  std::vector<float> points;
+  for (int y = -60; y <= 60; ++y)
+  {
+    for (int z = 0; z <= 40; ++z)
+    {
+      points.push_back(5.1f);
+      points.push_back(0.05f * y);
+      points.push_back(0.05f * z);
+    }
+  }
+  return points;
+}
+
+//-----------------------------------------------------------------------------
+// Probability of occupancy of the voxel of a world position
+float GetOccupancy(const OccupancyGrid& grid, double x, double y, double z)
+{
+  double origin[3];
+  grid.GetOrigin(origin);
+  const int i = static_cast<int>(std::floor((x - origin[0]) / Resolution));
+  const int j = static_cast<int>(std::floor((y - origin[1]) / Resolution));
+  const int k = static_cast<int>(std::floor((z - origin[2]) / Resolution));
+  return 1.f - 1.f / (1.f + std::exp(grid.GetLogOdds(i, j, k)));
+}
+
+//-----------------------------------------------------------------------------
+int CheckOccupancy(const OccupancyGrid& grid, double x, double y, double z, int expected,
+  const char* name)
+{
+  const float occupancy = GetOccupancy(grid, x, y, z);
+  const int state = occupancy > 0.5f ? 1 : (occupancy < 0.5f ? -1 : 0);
+  if (state != expected)
+  {
+    std::cerr << name << ": occupancy " << occupancy << std::endl;
+    return 1;
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  const std::vector<float> wall = CreateWall();
+  const size_t numberOfPoints = wall.size() / 3;
+  const double sensor[3] = { 0., 0., 1. };
+
+  // 20 m x 20 m x 4 m around the sensor
+  OccupancyGrid grid;
+  grid.Resize(Resolution, 40, 8);
+  grid.NumberOfThreads = 4;
+  grid.Recenter(sensor);
+  for (int frame = 0; frame < 3; ++frame)
+  {
+    grid.Insert(sensor, wall.data(), numberOfPoints);
+  }
+  nbrErrors += CheckOccupancy(grid, 5.2, 0.2, 1.2, 1, "Wall");
+  nbrErrors += CheckOccupancy(grid, 2.7, 0.2, 1.2, -1, "Space before the wall");
+  nbrErrors += CheckOccupancy(grid, 7.2, 0.2, 1.2, 0, "Space behind the wall");
+  nbrErrors += CheckOccupancy(grid, -3.2, 0.2, 1.2, 0, "Space behind the sensor");
+
+  // the elevations of the columns of the wall
+  double origin[3];
+  grid.GetOrigin(origin);
+  const int i = static_cast<int>(std::floor((5.1 - origin[0]) / Resolution));
+  const int j = static_cast<int>(std::floor((0.2 - origin[1]) / Resolution));
+  if (std::abs(grid.GetMinimumElevation(i, j)) > 1e-3 ||
+    std::abs(grid.GetMaximumElevation(i, j) - 2.f) > 0.05f || !std::isnan(grid.GetMaximumElevation(0, 0)))
+  {
+    std::cerr << "Wrong elevations: " << grid.GetMinimumElevation(i, j) << " to "
+              << grid.GetMaximumElevation(i, j) << std::endl;
+    nbrErrors++;
+  }
+
+  // the rays of the ranges of several threads cross the same voxels, which are updated once
+  // per frame all the same: every voxel has the occupancy of a single thread grid
+  OccupancyGrid singleThreaded;
+  singleThreaded.Resize(Resolution, 40, 8);
+  singleThreaded.NumberOfThreads = 1;
+  singleThreaded.Recenter(sensor);
+  for (int frame = 0; frame < 3; ++frame)
+  {
+    singleThreaded.Insert(sensor, wall.data(), numberOfPoints);
+  }
+  std::vector<float> occupancy(40 * 40 * 8), singleThreadedOccupancy(40 * 40 * 8);
+  grid.GetOccupancy(occupancy.data());
+  singleThreaded.GetOccupancy(singleThreadedOccupancy.data());
+  if (occupancy != singleThreadedOccupancy ||
+    grid.GetNumberOfUpdatedVoxels() != singleThreaded.GetNumberOfUpdatedVoxels())
+  {
+    std::cerr << "The occupancy differs from a single thread grid, " << grid.GetNumberOfUpdatedVoxels()
+              << " voxels updated instead of " << singleThreaded.GetNumberOfUpdatedVoxels() << std::endl;
+    nbrErrors++;
+  }
+
+  // the wall stays in the grid while the sensor moves a little, and is forgotten once it
+  // has left the grid
+  const double closeSensor[3] = { 8., 0., 1. };
+  grid.Recenter(closeSensor);
+  nbrErrors += CheckOccupancy(grid, 5.2, 0.2, 1.2, 1, "Wall after a small move");
+  const double farSensor[3] = { 20., 0., 1. };
+  grid.Recenter(farSensor);
+  grid.Recenter(sensor);
+  nbrErrors += CheckOccupancy(grid, 5.2, 0.2, 1.2, 0, "Wall after it left the grid");
+  if (!std::isnan(grid.GetMaximumElevation(i, j)))
+  {
+    std::cerr << "Elevation after the column left the grid" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
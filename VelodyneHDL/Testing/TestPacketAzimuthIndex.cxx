@@ -0,0 +1,282 @@
+#include "PacketAzimuthIndex.h"
+
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace
+{
+const int PacketsPerFrame = 100;
+const int NumberOfFrames = 3;
+const double PacketWidth = 360. / PacketsPerFrame;
+
+//-----------------------------------------------------------------------------
+//! Position of the packets of a pcap, the packets being 1264 bytes apart
+boost::uint64_t GetPacketPosition(int packet)
+{
+  return 24 + 1264 * static_cast<boost::uint64_t>(packet);
+}
+
+//-----------------------------------------------------------------------------
+//! Packets of a sensor doing a turn per frame, the frames starting at azimuth 0
+std::vector<PacketAzimuthIndex::Packet> CreatePackets(bool reverse)
+{
+  std::vector<PacketAzimuthIndex::Packet> packets;
+  for (int i = 0; i < PacketsPerFrame * NumberOfFrames; ++i)
+  {
+    const double first = PacketWidth * (i % PacketsPerFrame);
+    PacketAzimuthIndex::Packet packet = { GetPacketPosition(i), first, first + PacketWidth };
+    // returns from 1 m to a wall whose distance changes with the azimuth
+    packet.HasDistances = true;
+    packet.HasZeroDistance = i % 2 == 0;
+    packet.MinDistance = 1.;
+    packet.MaxDistance = 20. + 0.123 * (i % PacketsPerFrame);
+    if (reverse)
+    {
+      std::swap(packet.FirstAzimuth, packet.LastAzimuth);
+    }
+    packets.push_back(packet);
+  }
+  return packets;
+}
+
+//-----------------------------------------------------------------------------
+std::vector<FramePosition> CreateFramePositions()
+{
+  std::vector<FramePosition> positions;
+  for (int frame = 0; frame < NumberOfFrames; ++frame)
+  {
+    positions.push_back(FramePosition(GetPacketPosition(frame * PacketsPerFrame), 0, frame));
+  }
+  return positions;
+}
+
+//-----------------------------------------------------------------------------
+//! Check the packets of frame 1 in a sector, given by their number
+int CheckSector(const PacketAzimuthIndex& index, double azimuthMin, double azimuthMax,
+  double margin, const std::vector<int>& expectedPackets)
+{
+  std::vector<boost::uint64_t> positions;
+  if (!index.GetSectorPackets(1, azimuthMin, azimuthMax, margin, positions))
+  {
+    std::cerr << "The packets of the frame are unknown" << std::endl;
+    return 1;
+  }
+  std::vector<boost::uint64_t> expectedPositions;
+  for (int packet : expectedPackets)
+  {
+    expectedPositions.push_back(GetPacketPosition(packet));
+  }
+  if (positions != expectedPositions)
+  {
+    std::cerr << "Wrong packets in the sector [" << azimuthMin << ", " << azimuthMax
+              << "] with a margin of " << margin << ": got " << positions.size()
+              << " packets, expected " << expectedPositions.size() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+//! Sectors of frame 1, which ends in the first packet of frame 2
+int CheckSectors(const PacketAzimuthIndex& index)
+{
+  int nbrErrors = 0;
+  std::vector<int> forward;
+  for (int i = 100; i <= 116; ++i)
+  {
+    forward.push_back(i);
+  }
+  forward.push_back(200);
+  nbrErrors += CheckSector(index, 1., 59., 0., forward);
+
+  // the margin adds the last packet before 0
+  std::vector<int> widened = forward;
+  widened.insert(widened.end() - 1, 199);
+  nbrErrors += CheckSector(index, 1., 59., 2., widened);
+
+  // a sector containing 0 is at both ends of the frame
+  nbrErrors += CheckSector(index, 350., 10., 0., { 100, 101, 102, 197, 198, 199, 200 });
+  nbrErrors += CheckSector(index, -10., 10., 0., { 100, 101, 102, 197, 198, 199, 200 });
+  return nbrErrors;
+}
+}
+
+//-----------------------------------------------------------------------------
+int TestSectors()
+{
+  int nbrErrors = 0;
+  PacketAzimuthIndex index;
+  index.Build(CreatePackets(false), CreateFramePositions());
+  for (int frame = 0; frame < NumberOfFrames; ++frame)
+  {
+    if (!index.HasFrame(frame))
+    {
+      std::cerr << "Frame " << frame << " is not indexed" << std::endl;
+      nbrErrors++;
+    }
+  }
+  nbrErrors += CheckSectors(index);
+
+  // the azimuths of a sensor turning the other way give the same ranges
+  PacketAzimuthIndex reverseIndex;
+  reverseIndex.Build(CreatePackets(true), CreateFramePositions());
+  nbrErrors += CheckSectors(reverseIndex);
+
+  // the packets are compressed
+  std::vector<unsigned char> data;
+  index.Serialize(data);
+  const double bytesPerPacket = static_cast<double>(data.size()) / (PacketsPerFrame * NumberOfFrames);
+  if (bytesPerPacket > 13)
+  {
+    std::cerr << "The packets take " << bytesPerPacket << " bytes each" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestDistances()
+{
+  int nbrErrors = 0;
+  std::vector<PacketAzimuthIndex::Packet> packets(4);
+  for (int i = 0; i < 4; ++i)
+  {
+    packets[i] = { GetPacketPosition(i), 10. * i, 10. * i + 3.6 };
+  }
+  packets[0].HasDistances = true;
+  packets[0].MinDistance = 1.234;
+  packets[0].MaxDistance = 56.789;
+  // all the lasers without return
+  packets[1].HasDistances = true;
+  packets[1].HasZeroDistance = true;
+  packets[1].MinDistance = 1.;
+  packets[1].MaxDistance = 0.;
+  packets[2].HasDistances = true;
+  packets[2].HasZeroDistance = true;
+  packets[2].MinDistance = 0.5;
+  packets[2].MaxDistance = 0.5;
+
+  PacketAzimuthIndex index;
+  index.SetFramePackets(0, packets);
+  std::vector<PacketAzimuthIndex::Packet> readPackets;
+  if (!index.GetFramePackets(0, readPackets) || readPackets.size() != packets.size())
+  {
+    std::cerr << "The packets of the frame are not read" << std::endl;
+    return 1;
+  }
+
+  // the ranges are rounded outwards
+  const PacketAzimuthIndex::Packet& rounded = readPackets[0];
+  if (!rounded.HasDistances || rounded.HasZeroDistance || rounded.MinDistance > 1.234 ||
+    rounded.MinDistance < 1.22 || rounded.MaxDistance < 56.789 || rounded.MaxDistance > 56.8)
+  {
+    std::cerr << "Wrong distance range " << rounded.MinDistance << ", " << rounded.MaxDistance
+              << std::endl;
+    nbrErrors++;
+  }
+  if (!readPackets[1].HasDistances || !readPackets[1].HasZeroDistance ||
+    readPackets[1].MinDistance <= readPackets[1].MaxDistance)
+  {
+    std::cerr << "A packet without return has distances" << std::endl;
+    nbrErrors++;
+  }
+  if (!readPackets[2].HasZeroDistance || readPackets[2].MinDistance != 0.5 ||
+    readPackets[2].MaxDistance != 0.5)
+  {
+    std::cerr << "Wrong distance range of a single distance" << std::endl;
+    nbrErrors++;
+  }
+  if (readPackets[3].HasDistances)
+  {
+    std::cerr << "A packet without distances has some" << std::endl;
+    nbrErrors++;
+  }
+  for (size_t i = 0; i < packets.size(); ++i)
+  {
+    if (readPackets[i].Position != packets[i].Position ||
+      readPackets[i].FirstAzimuth != packets[i].FirstAzimuth ||
+      readPackets[i].LastAzimuth < packets[i].LastAzimuth - 1e-9)
+    {
+      std::cerr << "Wrong position or azimuths of packet " << i << std::endl;
+      nbrErrors++;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestSensorTimes()
+{
+  int nbrErrors = 0;
+  std::vector<PacketAzimuthIndex::Packet> packets(5);
+  const double times[5] = { 3599.998669, std::nan(""), 3599.999999, 0.001329, 0.002658 };
+  for (int i = 0; i < 5; ++i)
+  {
+    packets[i] = { GetPacketPosition(i), 10. * i, 10. * i + 3.6 };
+    packets[i].SensorTime = times[i];
+  }
+
+  PacketAzimuthIndex index;
+  index.SetFramePackets(0, packets);
+  std::vector<PacketAzimuthIndex::Packet> readPackets;
+  if (!index.GetFramePackets(0, readPackets) || readPackets.size() != packets.size())
+  {
+    std::cerr << "The packets of the frame are not read" << std::endl;
+    return 1;
+  }
+  // the times are stored to the microsecond, through the top of the hour
+  for (size_t i = 0; i < packets.size(); ++i)
+  {
+    if (std::isnan(readPackets[i].SensorTime) != std::isnan(times[i]) ||
+      std::abs(readPackets[i].SensorTime - times[i]) > 1e-9)
+    {
+      std::cerr << "Wrong sensor time of packet " << i << ": " << readPackets[i].SensorTime
+                << " instead of " << times[i] << std::endl;
+      nbrErrors++;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestSerialization()
+{
+  int nbrErrors = 0;
+  PacketAzimuthIndex index;
+  index.Build(CreatePackets(false), CreateFramePositions());
+  // a frame recorded on its own, after unknown frames
+  index.SetFramePackets(5, std::vector<PacketAzimuthIndex::Packet>());
+
+  std::vector<unsigned char> data;
+  index.Serialize(data);
+  PacketAzimuthIndex readIndex;
+  if (!readIndex.Deserialize(data))
+  {
+    std::cerr << "The index is not read" << std::endl;
+    return 1;
+  }
+  nbrErrors += CheckSectors(readIndex);
+  if (readIndex.HasFrame(3) || readIndex.HasFrame(4) || !readIndex.HasFrame(5) ||
+    readIndex.HasFrame(6))
+  {
+    std::cerr << "The known frames do not match" << std::endl;
+    nbrErrors++;
+  }
+
+  // a truncated index is rejected
+  data.resize(data.size() / 2);
+  if (readIndex.Deserialize(data) || readIndex.HasFrame(0))
+  {
+    std::cerr << "A truncated index is read" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  return TestSectors() + TestDistances() + TestSensorTimes() + TestSerialization();
+}
@@ -0,0 +1,105 @@
+#include "PacketBuffer.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+int TestRecycling()
+{
+  int nbrErrors = 0;
+  PacketBufferPool pool(4);
+  PacketBuffer* first = nullptr;
+  {
+    PacketBufferPointer buffer = pool.Acquire();
+    first = buffer.get();
+    buffer->SetSize(1206);
+    if (!buffer->IsUnique() || pool.GetNumberOfFreeBuffers() != 3)
+    {
+      std::cerr << "Wrong state of an acquired buffer" << std::endl;
+      nbrErrors++;
+    }
+
+    // a copy of the pointer shares the buffer
+    PacketBufferPointer shared = buffer;
+    if (buffer->IsUnique() || shared->GetData() != buffer->GetData())
+    {
+      std::cerr << "Buffer not shared" << std::endl;
+      nbrErrors++;
+    }
+  }
+  if (pool.GetNumberOfFreeBuffers() != 4)
+  {
+    std::cerr << "Buffer not given back to the pool" << std::endl;
+    nbrErrors++;
+  }
+
+  // the last released buffer is the first reused, its size is reset
+  PacketBufferPointer buffer = pool.Acquire();
+  if (buffer.get() != first || buffer->GetSize() != 0)
+  {
+    std::cerr << "Buffer not reused" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestExhaustion()
+{
+  int nbrErrors = 0;
+  PacketBufferPool pool(4);
+  std::vector<PacketBufferPointer> buffers;
+  for (int i = 0; i < 6; ++i)
+  {
+    buffers.push_back(pool.Acquire());
+  }
+  if (pool.GetNumberOfHeapBuffers() != 2 || pool.GetNumberOfFreeBuffers() != 0)
+  {
+    std::cerr << "Wrong number of heap buffers: " << pool.GetNumberOfHeapBuffers() << std::endl;
+    nbrErrors++;
+  }
+  buffers.clear();
+  if (pool.GetNumberOfFreeBuffers() != 4)
+  {
+    std::cerr << "Heap buffers given to the pool" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+// Release the buffers from another thread, as the packet writer does
+int TestThreads()
+{
+  int nbrErrors = 0;
+  PacketBufferPool pool(64);
+  std::vector<PacketBufferPointer> batch;
+  for (int i = 0; i < 1000; ++i)
+  {
+    for (int j = 0; j < 32; ++j)
+    {
+      batch.push_back(pool.Acquire());
+    }
+    boost::thread writer([batch]() mutable { batch.clear(); });
+    batch.clear();
+    writer.join();
+  }
+  if (pool.GetNumberOfFreeBuffers() != 64 || pool.GetNumberOfHeapBuffers() != 0)
+  {
+    std::cerr << "Buffers lost between threads" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  nbrErrors += TestRecycling();
+  nbrErrors += TestExhaustion();
+  nbrErrors += TestThreads();
+  return nbrErrors;
+}
@@ -0,0 +1,275 @@
+#include "vtkPacketFileReader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+const unsigned short LidarPort = 2368;
+const unsigned short PositionPort = 8308;
+
+//-----------------------------------------------------------------------------
+void WriteUInt32(std::ofstream& file, boost::uint32_t value)
+{
+  file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+//-----------------------------------------------------------------------------
+//! Write a pcap file of UDP packets whose payload is their number, every fourth packet
+//! being sent to PositionPort instead of LidarPort. The packets are sent by three sensors
+//! in turn, 192.168.1.201 to 192.168.1.203.
+void WritePcap(const std::string& filename, int firstPacket, int numberOfPackets)
+{
+  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  WriteUInt32(file, 0xa1b2c3d4);
+  WriteUInt32(file, 0x00040002);
+  WriteUInt32(file, 0);
+  WriteUInt32(file, 0);
+  WriteUInt32(file, 65535);
+  WriteUInt32(file, DLT_EN10MB);
+
+  for (int i = firstPacket; i < firstPacket + numberOfPackets; ++i)
+  {
+    unsigned char packet[14 + 20 + 8 + 4] = { 0 };
+    unsigned char* ip = packet + 14;
+    ip[0] = 0x45;
+    ip[9] = 17;
+    ip[12] = 192;
+    ip[13] = 168;
+    ip[14] = 1;
+    ip[15] = static_cast<unsigned char>(201 + i % 3);
+    ip[20 + 0] = static_cast<unsigned char>(LidarPort >> 8);
+    ip[20 + 1] = static_cast<unsigned char>(LidarPort & 0xff);
+    const unsigned short port = i % 4 == 3 ? PositionPort : LidarPort;
+    ip[20 + 2] = static_cast<unsigned char>(port >> 8);
+    ip[20 + 3] = static_cast<unsigned char>(port & 0xff);
+    const boost::uint32_t number = static_cast<boost::uint32_t>(i);
+    std::memcpy(ip + 28, &number, sizeof(number));
+
+    WriteUInt32(file, 1000 + i);
+    WriteUInt32(file, 0);
+    WriteUInt32(file, sizeof(packet));
+    WriteUInt32(file, sizeof(packet));
+    file.write(reinterpret_cast<const char*>(packet), sizeof(packet));
+  }
+}
+
+//-----------------------------------------------------------------------------
+boost::uint32_t GetNumber(const unsigned char* data)
+{
+  boost::uint32_t number;
+  std::memcpy(&number, data, sizeof(number));
+  return number;
+}
+}
+
+//-----------------------------------------------------------------------------
+int TestSequence(const std::vector<std::string>& filenames, int numberOfPackets)
+{
+  int nbrErrors = 0;
+  vtkPacketFileReader reader;
+  if (!reader.Open(filenames, true))
+  {
+    std::cerr << "Cannot open the sequence: " << reader.GetLastError() << std::endl;
+    return 1;
+  }
+
+  // the packets of all the files are given in order, with offsets telling their file
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  std::vector<boost::uint64_t> offsets;
+  boost::uint32_t expected = 0;
+  offsets.push_back(reader.GetFileOffset());
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    if (dataLength != 4 || GetNumber(data) != expected || timeSinceStart != 1000 + expected)
+    {
+      std::cerr << "Packet " << expected << " is wrong" << std::endl;
+      return nbrErrors + 1;
+    }
+    expected++;
+    offsets.push_back(reader.GetFileOffset());
+  }
+  if (expected != static_cast<boost::uint32_t>(numberOfPackets))
+  {
+    std::cerr << "Expected " << numberOfPackets << " packets, got " << expected << std::endl;
+    nbrErrors++;
+  }
+  if (vtkPacketFileReader::GetFileIndex(offsets.front()) != 0 ||
+    vtkPacketFileReader::GetFileIndex(offsets[offsets.size() - 2]) != filenames.size() - 1)
+  {
+    std::cerr << "The offsets do not tell the file of the packets" << std::endl;
+    nbrErrors++;
+  }
+
+  // the reading can go back to any packet, even in another file and after the end
+  for (size_t i = offsets.size() - 1; i-- > 0;)
+  {
+    reader.SetFileOffset(offsets[i]);
+    if (!reader.NextPacket(data, dataLength, timeSinceStart) || GetNumber(data) != i)
+    {
+      std::cerr << "Cannot go back to packet " << i << std::endl;
+      nbrErrors++;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestSingleFileOffsets(const std::vector<std::string>& filenames)
+{
+  // a single file, or the first file of a sequence, keeps the offsets it had
+  vtkPacketFileReader single;
+  vtkPacketFileReader sequence;
+  if (!single.Open(filenames.front(), true) || !sequence.Open(filenames, true))
+  {
+    std::cerr << "Cannot open " << filenames.front() << std::endl;
+    return 1;
+  }
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  while (single.NextPacket(data, dataLength, timeSinceStart))
+  {
+    sequence.NextPacket(data, dataLength, timeSinceStart);
+    if (single.GetFileOffset() != sequence.GetFileOffset())
+    {
+      std::cerr << "The offsets of the first file have changed" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestDestinationPort(const std::vector<std::string>& filenames)
+{
+  int nbrErrors = 0;
+  vtkPacketFileReader reader;
+  if (!reader.Open(filenames, true, PositionPort))
+  {
+    std::cerr << "Cannot open the sequence: " << reader.GetLastError() << std::endl;
+    return 1;
+  }
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  int numberOfPackets = 0;
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    if (GetNumber(data) % 4 != 3)
+    {
+      std::cerr << "Packet " << GetNumber(data) << " is not sent to the position port"
+                << std::endl;
+      nbrErrors++;
+    }
+    numberOfPackets++;
+  }
+  if (numberOfPackets != 10)
+  {
+    std::cerr << "Expected 10 position packets, got " << numberOfPackets << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestPacketSource(const std::vector<std::string>& filenames)
+{
+  int nbrErrors = 0;
+  vtkPacketFileReader reader;
+  if (!reader.Open(filenames, true))
+  {
+    std::cerr << "Cannot open the sequence: " << reader.GetLastError() << std::endl;
+    return 1;
+  }
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  while (reader.NextPacket(data, dataLength, timeSinceStart))
+  {
+    boost::uint32_t address = 0;
+    unsigned short port = 0;
+    const boost::uint32_t expectedAddress = 0xc0a801c9 + GetNumber(data) % 3;
+    if (!reader.GetPacketSource(address, port) || address != expectedAddress ||
+      port != LidarPort)
+    {
+      std::cerr << "Wrong sender for packet " << GetNumber(data) << std::endl;
+      nbrErrors++;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestWillNeed(const std::vector<std::string>& filenames, bool useMemoryMapping)
+{
+  int nbrErrors = 0;
+  vtkPacketFileReader reader;
+  if (!reader.Open(filenames, useMemoryMapping))
+  {
+    std::cerr << "Cannot open the sequence: " << reader.GetLastError() << std::endl;
+    return 1;
+  }
+  const boost::uint64_t first = reader.GetFileOffset();
+  const boost::uint64_t nextFile = vtkPacketFileReader::MakeSequenceOffset(1, 0);
+  if (reader.WillNeed(nextFile, nextFile + 100))
+  {
+    std::cerr << "A range of another file is advised" << std::endl;
+    nbrErrors++;
+  }
+#if defined(__linux__)
+  // from the first packet to the end of the current file
+  if (!reader.WillNeed(first, nextFile))
+  {
+    std::cerr << "The system is not advised, memory mapping: " << useMemoryMapping << std::endl;
+    nbrErrors++;
+  }
+#endif
+
+  // the advice does not move the reader
+  const unsigned char* data = 0;
+  unsigned int dataLength = 0;
+  double timeSinceStart = 0;
+  if (reader.GetFileOffset() != first || !reader.NextPacket(data, dataLength, timeSinceStart) ||
+    GetNumber(data) != 0)
+  {
+    std::cerr << "The advice has moved the reader" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  // a capture of 40 packets split in 3 files
+  std::vector<std::string> filenames;
+  const int sizes[] = { 15, 1, 24 };
+  int numberOfPackets = 0;
+  for (int i = 0; i < 3; ++i)
+  {
+    filenames.push_back("TestPacketFileSequence_" + std::to_string(i) + ".pcap");
+    WritePcap(filenames.back(), numberOfPackets, sizes[i]);
+    numberOfPackets += sizes[i];
+  }
+
+  int nbrErrors = 0;
+  nbrErrors += TestSequence(filenames, numberOfPackets);
+  nbrErrors += TestSingleFileOffsets(filenames);
+  nbrErrors += TestDestinationPort(filenames);
+  nbrErrors += TestPacketSource(filenames);
+  nbrErrors += TestWillNeed(filenames, true);
+  nbrErrors += TestWillNeed(filenames, false);
+
+  for (const std::string& filename : filenames)
+  {
+    std::remove(filename.c_str());
+  }
+  return nbrErrors;
+}
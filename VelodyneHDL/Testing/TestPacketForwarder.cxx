@@ -0,0 +1,103 @@
+#include "PacketForwarder.h"
+
+#include <boost/asio.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Receive the packets sent to a local socket and check that they hold their index
+int CheckReceived(boost::asio::ip::udp::socket& socket, unsigned int numberOfPackets)
+{
+  int nbrErrors = 0;
+  unsigned char data[128];
+  for (unsigned int i = 0; i < numberOfPackets; ++i)
+  {
+    boost::system::error_code error;
+    const size_t size = socket.receive(boost::asio::buffer(data), 0, error);
+    unsigned int index = 0;
+    std::memcpy(&index, data, sizeof(index));
+    if (error || size != 64 || index != i)
+    {
+      std::cerr << "Wrong packet forwarded, expected: " << i << std::endl;
+      nbrErrors++;
+      break;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestForwarding()
+{
+  int nbrErrors = 0;
+  boost::asio::io_service io;
+  const boost::asio::ip::address localhost = boost::asio::ip::address_v4::loopback();
+  boost::asio::ip::udp::socket first(io, boost::asio::ip::udp::endpoint(localhost, 0));
+  boost::asio::ip::udp::socket second(io, boost::asio::ip::udp::endpoint(localhost, 0));
+  // the packets are all sent before being read
+  first.set_option(boost::asio::socket_base::receive_buffer_size(1 << 20));
+  second.set_option(boost::asio::socket_base::receive_buffer_size(1 << 20));
+
+  PacketForwarder forwarder;
+  if (forwarder.AddDestinations("not an ip", first.local_endpoint().port()) != 0)
+  {
+    std::cerr << "Invalid destination added" << std::endl;
+    nbrErrors++;
+  }
+  // both sockets are bound to localhost, they differ by their port
+  if (!forwarder.AddDestination("127.0.0.1", first.local_endpoint().port()) ||
+    !forwarder.AddDestination("127.0.0.1", second.local_endpoint().port()))
+  {
+    std::cerr << "Valid destination refused" << std::endl;
+    nbrErrors++;
+  }
+  forwarder.Start();
+
+  // more packets than a batch of sendmmsg
+  const unsigned int numberOfPackets = 3 * FORWARD_BATCH_SIZE / 2;
+  std::vector<PacketBufferPointer> packets;
+  for (unsigned int i = 0; i < numberOfPackets; ++i)
+  {
+    PacketBufferPointer packet = PacketBufferPool::GetInstance().Acquire();
+    std::memset(packet->GetData(), 0, 64);
+    std::memcpy(packet->GetData(), &i, sizeof(i));
+    packet->SetSize(64);
+    packets.push_back(packet);
+  }
+  forwarder.Enqueue(packets);
+  // Stop sends the queued packets
+  forwarder.Stop();
+
+  nbrErrors += CheckReceived(first, numberOfPackets);
+  nbrErrors += CheckReceived(second, numberOfPackets);
+  if (forwarder.GetNumberOfSentPackets() != 2 * numberOfPackets ||
+    forwarder.GetNumberOfDroppedPackets() != 0 || forwarder.GetNumberOfSendErrors() != 0)
+  {
+    std::cerr << "Wrong counters, sent: " << forwarder.GetNumberOfSentPackets()
+              << ", dropped: " << forwarder.GetNumberOfDroppedPackets()
+              << ", errors: " << forwarder.GetNumberOfSendErrors() << std::endl;
+    nbrErrors++;
+  }
+
+  // the buffers are shared with the forwarder, not copied, and given back once sent
+  for (unsigned int i = 0; i < numberOfPackets; ++i)
+  {
+    if (!packets[i]->IsUnique())
+    {
+      std::cerr << "Packet " << i << " still held by the forwarder" << std::endl;
+      nbrErrors++;
+      break;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestForwarding();
+  return nbrErrors;
+}
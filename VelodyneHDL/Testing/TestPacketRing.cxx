@@ -0,0 +1,134 @@
+#include "PacketRing.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Push a packet holding its index
+bool PushIndex(PacketRing& ring, unsigned int index)
+{
+  char data[64] = { 0 };
+  std::memcpy(data, &index, sizeof(index));
+  return ring.Push(data, sizeof(data));
+}
+
+//-----------------------------------------------------------------------------
+unsigned int ReadIndex(const unsigned char* data)
+{
+  unsigned int index = 0;
+  std::memcpy(&index, data, sizeof(index));
+  return index;
+}
+
+//-----------------------------------------------------------------------------
+int TestOverflow(PacketRing::OverflowPolicy policy)
+{
+  int nbrErrors = 0;
+  const int numberOfSlots = 8;
+  PacketRing ring(numberOfSlots, policy);
+  for (unsigned int i = 0; i < 2 * numberOfSlots; ++i)
+  {
+    const bool pushed = PushIndex(ring, i);
+    if (pushed != (i < numberOfSlots || policy == PacketRing::DROP_OLDEST))
+    {
+      std::cerr << "Wrong overflow of packet " << i << ", policy: " << policy << std::endl;
+      nbrErrors++;
+    }
+  }
+  if (ring.GetNumberOfDroppedPackets() != numberOfSlots)
+  {
+    std::cerr << "Wrong number of dropped packets: " << ring.GetNumberOfDroppedPackets()
+              << std::endl;
+    nbrErrors++;
+  }
+
+  // the newest packets are kept when the oldest ones are dropped
+  const unsigned int first = policy == PacketRing::DROP_OLDEST ? numberOfSlots : 0;
+  const unsigned char* data = 0;
+  unsigned int size = 0;
+  for (unsigned int i = first; i < first + numberOfSlots; ++i)
+  {
+    if (!ring.WaitFront(data, size) || size != 64 || ReadIndex(data) != i)
+    {
+      std::cerr << "Wrong packet read, expected: " << i << std::endl;
+      nbrErrors++;
+    }
+    ring.Pop();
+  }
+
+  ring.Stop();
+  if (ring.WaitFront(data, size))
+  {
+    std::cerr << "Packet read after stop" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+// Run a producer and a consumer thread, the consumer must get increasing indices and account
+// for all the packets that were not dropped
+int TestThreads(PacketRing::OverflowPolicy policy)
+{
+  int nbrErrors = 0;
+  const unsigned int numberOfPackets = 1 << 20;
+  PacketRing ring(256, policy);
+  unsigned long numberOfReadPackets = 0;
+  bool ordered = true;
+
+  boost::thread consumer([&]() {
+    const unsigned char* data = 0;
+    unsigned int size = 0;
+    unsigned int previous = 0;
+    while (ring.WaitFront(data, size))
+    {
+      const unsigned int index = ReadIndex(data);
+      ordered = ordered && (numberOfReadPackets == 0 || index > previous);
+      previous = index;
+      numberOfReadPackets++;
+      ring.Pop();
+      if (index == numberOfPackets - 1)
+      {
+        break;
+      }
+    }
+  });
+
+  for (unsigned int i = 0; i < numberOfPackets; ++i)
+  {
+    // make sure the last packet gets through so that the consumer ends
+    while (!PushIndex(ring, i) && i == numberOfPackets - 1)
+    {
+    }
+  }
+  consumer.join();
+
+  if (!ordered)
+  {
+    std::cerr << "Packets read out of order, policy: " << policy << std::endl;
+    nbrErrors++;
+  }
+  const unsigned long numberOfTries = ring.GetNumberOfPushedPackets() +
+    ring.GetNumberOfDroppedNewestPackets();
+  if (numberOfReadPackets + ring.GetNumberOfDroppedPackets() != numberOfTries)
+  {
+    std::cerr << "Packets lost, policy: " << policy << ", read: " << numberOfReadPackets
+              << ", dropped: " << ring.GetNumberOfDroppedPackets() << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  nbrErrors += TestOverflow(PacketRing::DROP_NEWEST);
+  nbrErrors += TestOverflow(PacketRing::DROP_OLDEST);
+  nbrErrors += TestThreads(PacketRing::DROP_NEWEST);
+  nbrErrors += TestThreads(PacketRing::DROP_OLDEST);
+  return nbrErrors;
+}
@@ -0,0 +1,129 @@
+#include "vtkPacketFileWriter.h"
+#include "vvPacketSender.h"
+
+#include <boost/asio.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+// Write a capture of packets holding their index, one packet every two seconds
+bool WriteCapture(const std::string& filename, unsigned int firstIndex, unsigned int count,
+  unsigned int dataLength)
+{
+  vtkPacketFileWriter writer;
+  writer.SetBufferSize(1 << 16);
+  if (!writer.Open(filename))
+  {
+    return false;
+  }
+  std::vector<unsigned char> data(dataLength, 0);
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    const unsigned int index = firstIndex + 2 * i;
+    std::memcpy(data.data(), &index, sizeof(index));
+    timeval time;
+    time.tv_sec = 1000 + index;
+    time.tv_usec = 0;
+    writer.WritePacket(data.data(), dataLength, time);
+  }
+  writer.Close();
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// Receive the packets sent to a local socket and check that they hold the expected indices
+int CheckReceived(
+  boost::asio::ip::udp::socket& socket, const std::vector<unsigned int>& expectedIndices)
+{
+  unsigned char data[2048];
+  for (size_t i = 0; i < expectedIndices.size(); ++i)
+  {
+    boost::system::error_code error;
+    socket.receive(boost::asio::buffer(data), 0, error);
+    unsigned int index = 0;
+    std::memcpy(&index, data, sizeof(index));
+    if (error || index != expectedIndices[i])
+    {
+      std::cerr << "Wrong packet sent: " << index << ", expected: " << expectedIndices[i]
+                << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Replay a lidar capture and a position capture at once, the packets must be merged by time
+int TestMerge()
+{
+  int nbrErrors = 0;
+  const std::string lidarFile = "TestPacketSenderLidar.pcap";
+  const std::string positionFile = "TestPacketSenderPosition.pcap";
+  // more lidar packets than a batch
+  const unsigned int numberOfLidarPackets = 2 * SEND_BATCH_SIZE;
+  if (!WriteCapture(lidarFile, 0, numberOfLidarPackets, 1206) ||
+    !WriteCapture(positionFile, 1, 4, 512))
+  {
+    std::cerr << "Failed to write the captures" << std::endl;
+    return 1;
+  }
+
+  boost::asio::io_service io;
+  const boost::asio::ip::address localhost = boost::asio::ip::address_v4::loopback();
+  boost::asio::ip::udp::socket lidar(io, boost::asio::ip::udp::endpoint(localhost, 0));
+  boost::asio::ip::udp::socket position(io, boost::asio::ip::udp::endpoint(localhost, 0));
+  lidar.set_option(boost::asio::socket_base::receive_buffer_size(1 << 20));
+
+  std::vector<std::string> files;
+  files.push_back(lidarFile);
+  files.push_back(positionFile);
+  vvPacketSender sender(
+    files, "127.0.0.1", lidar.local_endpoint().port(), position.local_endpoint().port());
+
+  // packets 0 to 4 are captured in the first 4 seconds
+  if (sender.pumpPackets(4.5) != 5 || sender.GetNextPacketTime() != 5)
+  {
+    std::cerr << "Wrong packets sent until 4.5 s, next time: " << sender.GetNextPacketTime()
+              << std::endl;
+    nbrErrors++;
+  }
+  if (sender.pumpPacket() != 5 || sender.GetPacketCount() != 6)
+  {
+    std::cerr << "Wrong packet pumped" << std::endl;
+    nbrErrors++;
+  }
+  sender.pumpPackets(1e9);
+  if (!sender.IsDone() || sender.GetPacketCount() != numberOfLidarPackets + 4)
+  {
+    std::cerr << "Wrong number of packets sent: " << sender.GetPacketCount() << std::endl;
+    nbrErrors++;
+  }
+
+  std::vector<unsigned int> lidarIndices;
+  for (unsigned int i = 0; i < numberOfLidarPackets; ++i)
+  {
+    lidarIndices.push_back(2 * i);
+  }
+  std::vector<unsigned int> positionIndices;
+  for (unsigned int i = 0; i < 4; ++i)
+  {
+    positionIndices.push_back(2 * i + 1);
+  }
+  nbrErrors += CheckReceived(lidar, lidarIndices);
+  nbrErrors += CheckReceived(position, positionIndices);
+
+  std::remove(lidarFile.c_str());
+  std::remove(positionFile.c_str());
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestMerge();
+  return nbrErrors;
+}
@@ -0,0 +1,125 @@
+#include "ParallelPoints.h"
+
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+int TestReduce()
+{
+  int nbrErrors = 0;
+  // the ranges are combined in order, whatever thread finishes first
+  const size_t count = 1000;
+  const std::vector<size_t> order = ParallelReduce(count, 7, std::vector<size_t>(),
+    [](std::vector<size_t>& indices, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+      {
+        indices.push_back(i);
+      }
+    },
+    [](std::vector<size_t>& result, const std::vector<size_t>& indices) {
+      result.insert(result.end(), indices.begin(), indices.end());
+    });
+  for (size_t i = 0; i < count && order.size() == count; ++i)
+  {
+    if (order[i] != i)
+    {
+      std::cerr << "The ranges are not combined in order" << std::endl;
+      return 1;
+    }
+  }
+  if (order.size() != count)
+  {
+    std::cerr << "Wrong number of indices: " << order.size() << std::endl;
+    nbrErrors++;
+  }
+
+  // more ranges than values, and no value
+  const int sum = ParallelReduce(3, 8, 0,
+    [](int& partial, size_t begin, size_t end) {
+      partial += static_cast<int>(end - begin);
+    },
+    [](int& result, const int& partial) { result += partial; });
+  const int empty = ParallelReduce(0, 4, 5, [](int&, size_t, size_t) {},
+    [](int& result, const int& partial) { result += partial; });
+  if (sum != 3 || empty != 20)
+  {
+    std::cerr << "Wrong sums: " << sum << ", " << empty << std::endl;
+    nbrErrors++;
+  }
+
+  if (GetNumberOfPointRanges(4, MinimumPointsPerRange - 1) != 1 ||
+    GetNumberOfPointRanges(4, 100 * MinimumPointsPerRange) != 4 ||
+    GetNumberOfThreads(0) < 1)
+  {
+    std::cerr << "Wrong number of ranges" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestPointCoordinates(int dataType)
+{
+  vtkNew<vtkPoints> points;
+  points->SetDataType(dataType);
+  for (int i = 0; i < 10; ++i)
+  {
+    points->InsertNextPoint(i, 2 * i, -i);
+  }
+  const PointCoordinates coordinates(points.GetPointer());
+  for (int i = 0; i < 10; ++i)
+  {
+    double point[3];
+    coordinates.Get(i, point);
+    if (point[0] != i || point[1] != 2 * i || point[2] != -i)
+    {
+      std::cerr << "Wrong coordinates of point " << i << " for type " << dataType << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestArrayComponent()
+{
+  int nbrErrors = 0;
+  vtkNew<vtkUnsignedCharArray> intensities;
+  vtkNew<vtkIntArray> pairs;
+  pairs->SetNumberOfComponents(2);
+  for (int i = 0; i < 10; ++i)
+  {
+    intensities->InsertNextValue(static_cast<unsigned char>(10 * i));
+    pairs->InsertNextTuple2(i, -i);
+  }
+  // the unsigned char values are read directly, the int values with GetComponent
+  const ArrayComponent intensity(intensities.GetPointer());
+  const ArrayComponent second(pairs.GetPointer(), 1);
+  const ArrayComponent missing(nullptr);
+  for (int i = 0; i < 10; ++i)
+  {
+    if (intensity.Get(i) != 10 * i || second.Get(i) != -i || missing.Get(i) != 0)
+    {
+      std::cerr << "Wrong component of value " << i << std::endl;
+      nbrErrors++;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestReduce();
+  nbrErrors += TestPointCoordinates(VTK_FLOAT);
+  nbrErrors += TestPointCoordinates(VTK_DOUBLE);
+  nbrErrors += TestArrayComponent();
+  return nbrErrors;
+}
@@ -0,0 +1,244 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+
+// Accumulate frames whose voxels are known, then check the eviction of the old
+// voxels, of the far voxels, and the reset when the time goes back.
+
+#include "vtkPointCloudAccumulator.h"
+
+#include <vtkDataArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkInformation.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Frame with an intensity and a timestamp array, the value of both being the
+// index of the point plus offset
+vtkSmartPointer<vtkPolyData> CreateFrame(const std::vector<double>& coordinates, int offset)
+{
+  const vtkIdType numberOfPoints = coordinates.size() / 3;
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetNumberOfPoints(numberOfPoints);
+  auto intensity = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  intensity->SetName("intensity");
+  intensity->SetNumberOfTuples(numberOfPoints);
+  auto timestamp = vtkSmartPointer<vtkDoubleArray>::New();
+  timestamp->SetName("timestamp");
+  timestamp->SetNumberOfTuples(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    points->SetPoint(i, &coordinates[3 * i]);
+    intensity->SetValue(i, static_cast<unsigned char>(i + offset));
+    timestamp->SetValue(i, static_cast<double>(i + offset));
+  }
+
+  auto frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->SetPoints(points);
+  frame->GetPointData()->AddArray(intensity);
+  frame->GetPointData()->AddArray(timestamp);
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+// A line of points along x, one per voxel of size 1
+vtkSmartPointer<vtkPolyData> CreateLine(double start, int numberOfPoints)
+{
+  std::vector<double> coordinates;
+  for (int i = 0; i < numberOfPoints; ++i)
+  {
+    coordinates.insert(coordinates.end(), { start + i + 0.5, 0.5, 0.5 });
+  }
+  return CreateFrame(coordinates, 0);
+}
+
+//-----------------------------------------------------------------------------
+vtkPolyData* Accumulate(vtkPointCloudAccumulator* filter, vtkPolyData* frame)
+{
+  filter->SetInputData(frame);
+  filter->Update();
+  return filter->GetOutput();
+}
+
+//-----------------------------------------------------------------------------
+int TestKnownVoxels()
+{
+  // two points in the voxel [0, 1[^3 and one in the voxel [1, 2[ x [0, 1[ x [0, 1[
+  auto frame = CreateFrame({ 0.1, 0.1, 0.1,
+                             1.5, 0.5, 0.5,
+                             0.3, 0.5, 0.7 }, 0);
+  auto filter = vtkSmartPointer<vtkPointCloudAccumulator>::New();
+  filter->SetLeafSize(1.);
+  vtkPolyData* output = Accumulate(filter, frame);
+  if (output->GetNumberOfPoints() != 2 || output->GetNumberOfVerts() != 2)
+  {
+    std::cerr << "Expected 2 points, got " << output->GetNumberOfPoints() << std::endl;
+    return 1;
+  }
+  vtkDataArray* counts = output->GetPointData()->GetArray("number_of_points");
+  vtkDataArray* intensity = output->GetPointData()->GetArray("intensity");
+  vtkDataArray* timestamp = output->GetPointData()->GetArray("timestamp");
+  if (!counts || !intensity || !timestamp)
+  {
+    std::cerr << "Missing point data array" << std::endl;
+    return 1;
+  }
+
+  // the voxels are in the order of their first point, with the mean of their
+  // points and timestamps and their last intensity
+  int nbrErrors = 0;
+  double point[3];
+  output->GetPoint(0, point);
+  if (std::abs(point[0] - 0.2) > 1e-9 || std::abs(point[1] - 0.3) > 1e-9 ||
+    std::abs(point[2] - 0.4) > 1e-9 || counts->GetTuple1(0) != 2 ||
+    intensity->GetTuple1(0) != 2 || timestamp->GetTuple1(0) != 1.)
+  {
+    std::cerr << "Wrong merged voxel" << std::endl;
+    nbrErrors++;
+  }
+
+  // the same points again are merged in the same voxels
+  auto nextFrame = CreateFrame({ 0.1, 0.1, 0.1,
+                                 1.5, 0.5, 0.5,
+                                 0.3, 0.5, 0.7 }, 10);
+  output = Accumulate(filter, nextFrame);
+  counts = output->GetPointData()->GetArray("number_of_points");
+  timestamp = output->GetPointData()->GetArray("timestamp");
+  if (output->GetNumberOfPoints() != 2 || counts->GetTuple1(0) != 4 || counts->GetTuple1(1) != 2 ||
+    timestamp->GetTuple1(1) != 6.)
+  {
+    std::cerr << "The second frame is not merged" << std::endl;
+    nbrErrors++;
+  }
+
+  // an input which has not changed is not accumulated again
+  filter->Modified();
+  output = Accumulate(filter, nextFrame);
+  if (output->GetPointData()->GetArray("number_of_points")->GetTuple1(0) != 4)
+  {
+    std::cerr << "The same frame is accumulated twice" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestOldVoxelsEviction()
+{
+  auto filter = vtkSmartPointer<vtkPointCloudAccumulator>::New();
+  filter->SetLeafSize(1.);
+  filter->SetMaximumNumberOfPoints(10);
+  Accumulate(filter, CreateLine(0., 4));
+  Accumulate(filter, CreateLine(10., 4));
+  // the first frame is seen again, the second one is now the oldest
+  Accumulate(filter, CreateLine(0., 4));
+  vtkPolyData* output = Accumulate(filter, CreateLine(20., 4));
+
+  // 12 points, evicted down to 9 starting with the first points of the second frame
+  if (output->GetNumberOfPoints() != 9 || output->GetNumberOfVerts() != 9)
+  {
+    std::cerr << "Expected 9 points, got " << output->GetNumberOfPoints() << std::endl;
+    return 1;
+  }
+  const double expectedX[9] = { 0.5, 1.5, 2.5, 3.5, 13.5, 20.5, 21.5, 22.5, 23.5 };
+  for (vtkIdType i = 0; i < 9; ++i)
+  {
+    if (output->GetPoint(i)[0] != expectedX[i])
+    {
+      std::cerr << "Wrong point " << i << " after the eviction" << std::endl;
+      return 1;
+    }
+  }
+
+  // the evicted voxels can be filled again
+  output = Accumulate(filter, CreateLine(10., 1));
+  if (output->GetNumberOfPoints() != 10 ||
+    output->GetPointData()->GetArray("number_of_points")->GetTuple1(9) != 1)
+  {
+    std::cerr << "An evicted voxel is not filled again" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestFarVoxelsEviction()
+{
+  auto filter = vtkSmartPointer<vtkPointCloudAccumulator>::New();
+  filter->SetLeafSize(1.);
+  filter->SetMaximumDistance(50.);
+  Accumulate(filter, CreateLine(0., 5));
+  vtkPolyData* output = Accumulate(filter, CreateLine(30., 5));
+  if (output->GetNumberOfPoints() != 10)
+  {
+    std::cerr << "Near points are evicted" << std::endl;
+    return 1;
+  }
+  output = Accumulate(filter, CreateLine(100., 5));
+  if (output->GetNumberOfPoints() != 5 || output->GetPoint(0)[0] != 100.5)
+  {
+    std::cerr << "Expected the 5 points of the last frame, got " << output->GetNumberOfPoints()
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestTimeGoingBack()
+{
+  auto filter = vtkSmartPointer<vtkPointCloudAccumulator>::New();
+  filter->SetLeafSize(1.);
+  auto frame = CreateLine(0., 3);
+  frame->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), 1.);
+  Accumulate(filter, frame);
+  frame = CreateLine(10., 3);
+  frame->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), 2.);
+  vtkPolyData* output = Accumulate(filter, frame);
+  if (output->GetNumberOfPoints() != 6)
+  {
+    std::cerr << "Expected 6 points, got " << output->GetNumberOfPoints() << std::endl;
+    return 1;
+  }
+  frame = CreateLine(20., 3);
+  frame->GetInformation()->Set(vtkDataObject::DATA_TIME_STEP(), 0.);
+  output = Accumulate(filter, frame);
+  if (output->GetNumberOfPoints() != 3 || output->GetPoint(0)[0] != 20.5)
+  {
+    std::cerr << "The accumulation does not restart when the time goes back" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  return TestKnownVoxels() + TestOldVoxelsEviction() + TestFarVoxelsEviction() +
+    TestTimeGoingBack();
+}
@@ -0,0 +1,178 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Reduce random clouds of a multiblock with and without point budget, then a
+// long cloud seen from one of its ends, which must keep more close points.
+
+#include "vtkPointCloudLOD.h"
+
+#include <vtkDataArray.h>
+#include <vtkIntArray.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <iostream>
+#include <limits>
+#include <random>
+#include <set>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Cloud of random points in a box, the point_id of each point being its index
+// plus the given offset
+vtkSmartPointer<vtkPolyData> CreateCloud(vtkIdType numberOfPoints, const double size[3], int offset, unsigned int seed)
+{
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> distribution(0., 1.);
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToFloat();
+  points->SetNumberOfPoints(numberOfPoints);
+  auto pointId = vtkSmartPointer<vtkIntArray>::New();
+  pointId->SetName("point_id");
+  pointId->SetNumberOfTuples(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    points->SetPoint(i, size[0] * distribution(generator), size[1] * distribution(generator),
+                     size[2] * distribution(generator));
+    pointId->SetValue(i, offset + static_cast<int>(i));
+  }
+  auto cloud = vtkSmartPointer<vtkPolyData>::New();
+  cloud->SetPoints(points);
+  cloud->GetPointData()->AddArray(pointId);
+  return cloud;
+}
+
+//-----------------------------------------------------------------------------
+int TestPointBudget()
+{
+  const double size[3] = { 50., 50., 5. };
+  auto frames = vtkSmartPointer<vtkMultiBlockDataSet>::New();
+  frames->SetNumberOfBlocks(3);
+  for (unsigned int block = 0; block < 3; ++block)
+  {
+    frames->SetBlock(block, CreateCloud(100000, size, 100000 * block, block));
+  }
+
+  auto filter = vtkSmartPointer<vtkPointCloudLOD>::New();
+  filter->SetInputData(frames);
+  filter->SetPointBudget(std::numeric_limits<vtkIdType>::max());
+  filter->SetNumberOfThreads(2);
+  filter->Update();
+
+  // without limit all the points are kept once
+  vtkPolyData* output = filter->GetOutput();
+  vtkDataArray* pointId = output->GetPointData()->GetArray("point_id");
+  if (output->GetNumberOfPoints() != 300000 || output->GetNumberOfVerts() != 300000 || !pointId)
+  {
+    std::cerr << "Expected all the 300000 points, got " << output->GetNumberOfPoints() << std::endl;
+    return 1;
+  }
+  std::set<int> ids;
+  for (vtkIdType i = 0; i < output->GetNumberOfPoints(); ++i)
+  {
+    ids.insert(static_cast<int>(pointId->GetTuple1(i)));
+  }
+  if (ids.size() != 300000)
+  {
+    std::cerr << "Some points are duplicated" << std::endl;
+    return 1;
+  }
+
+  // with a budget the octrees are not built again, and the points are spread
+  // on all the blocks
+  filter->SetPointBudget(30000);
+  filter->Update();
+  output = filter->GetOutput();
+  pointId = output->GetPointData()->GetArray("point_id");
+  if (output->GetNumberOfPoints() == 0 || output->GetNumberOfPoints() > 30000)
+  {
+    std::cerr << "The point budget is not respected: " << output->GetNumberOfPoints() << std::endl;
+    return 1;
+  }
+  vtkIdType pointsPerBlock[3] = { 0, 0, 0 };
+  for (vtkIdType i = 0; i < output->GetNumberOfPoints(); ++i)
+  {
+    pointsPerBlock[static_cast<int>(pointId->GetTuple1(i)) / 100000]++;
+  }
+  for (int block = 0; block < 3; ++block)
+  {
+    if (pointsPerBlock[block] < output->GetNumberOfPoints() / 6)
+    {
+      std::cerr << "Block " << block << " has only " << pointsPerBlock[block] << " points" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestScreenSpaceError()
+{
+  const double size[3] = { 200., 10., 2. };
+  auto cloud = CreateCloud(400000, size, 0, 0);
+
+  auto filter = vtkSmartPointer<vtkPointCloudLOD>::New();
+  filter->SetInputData(cloud);
+  filter->SetPointBudget(50000);
+  filter->SetUseCamera(true);
+  filter->SetCameraPosition(-5., 5., 10.);
+  filter->SetMaximumScreenSpaceError(0.);
+  filter->Update();
+
+  // the first quarter of the cloud, close to the camera, is denser than the last one
+  vtkPolyData* output = filter->GetOutput();
+  if (output->GetNumberOfPoints() == 0 || output->GetNumberOfPoints() > 50000)
+  {
+    std::cerr << "The point budget is not respected: " << output->GetNumberOfPoints() << std::endl;
+    return 1;
+  }
+  vtkIdType closePoints = 0, distantPoints = 0;
+  for (vtkIdType i = 0; i < output->GetNumberOfPoints(); ++i)
+  {
+    double point[3];
+    output->GetPoint(i, point);
+    closePoints += point[0] < 50. ? 1 : 0;
+    distantPoints += point[0] > 150. ? 1 : 0;
+  }
+  if (closePoints <= 2 * distantPoints)
+  {
+    std::cerr << "The close points are not denser: " << closePoints << " and " << distantPoints << std::endl;
+    return 1;
+  }
+
+  // with a large error threshold only the coarse nodes are kept
+  const vtkIdType numberOfPoints = output->GetNumberOfPoints();
+  filter->SetMaximumScreenSpaceError(1000.);
+  filter->Update();
+  if (filter->GetOutput()->GetNumberOfPoints() >= numberOfPoints)
+  {
+    std::cerr << "The screen space error threshold does not reduce the points" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  return TestPointBudget() + TestScreenSpaceError();
+}
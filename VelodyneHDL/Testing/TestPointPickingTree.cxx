@@ -0,0 +1,160 @@
+#include "PointPickingTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+const vtkIdType NumberOfPoints = 200000;
+
+//-----------------------------------------------------------------------------
+//! Points of an aggregated cloud: a ground plane and a wall, with noise
+std::vector<float> CreatePoints()
+{
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> uniform(-50.f, 50.f);
+  std::normal_distribution<float> noise(0.f, 0.02f);
+  std::vector<float> coordinates;
+  for (vtkIdType n = 0; n < NumberOfPoints; ++n)
+  {
+    const bool isWall = n % 4 == 0;
+    coordinates.push_back(isWall ? 20.f + noise(generator) : uniform(generator));
+    coordinates.push_back(uniform(generator));
+    coordinates.push_back(isWall ? std::abs(uniform(generator)) / 10.f : -1.8f + noise(generator));
+  }
+  return coordinates;
+}
+
+//-----------------------------------------------------------------------------
+double Distance2(const float* point, const double position[3])
+{
+  const double dx = point[0] - position[0], dy = point[1] - position[1], dz = point[2] - position[2];
+  return dx * dx + dy * dy + dz * dz;
+}
+
+//-----------------------------------------------------------------------------
+//! Pick by scanning all the points
+vtkIdType PickAll(const std::vector<float>& coordinates, const double origin[3],
+  const double direction[3], double radius, double slope)
+{
+  const double norm = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+    direction[2] * direction[2]);
+  vtkIdType picked = -1;
+  double pickedDistance = std::numeric_limits<double>::infinity();
+  for (vtkIdType n = 0; n < NumberOfPoints; ++n)
+  {
+    const float* point = &coordinates[3 * n];
+    double distance = 0.;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      distance += (point[axis] - origin[axis]) * direction[axis] / norm;
+    }
+    const double tolerance = radius + slope * distance;
+    if (distance >= 0. && distance < pickedDistance &&
+      Distance2(point, origin) - distance * distance <= tolerance * tolerance)
+    {
+      picked = n;
+      pickedDistance = distance;
+    }
+  }
+  return picked;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  const std::vector<float> coordinates = CreatePoints();
+  PointPickingTree tree;
+  tree.Build(coordinates.data(), NumberOfPoints, 4);
+  PointPickingTree singleThreadedTree;
+  singleThreadedTree.Build(coordinates.data(), NumberOfPoints, 1);
+
+  int nbrErrors = 0;
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<double> uniform(-1., 1.);
+
+  // rays from a camera above the cloud, in perspective and in parallel projection
+  for (int ray = 0; ray < 200; ++ray)
+  {
+    const double origin[3] = { -60., 0., 30. };
+    const double direction[3] = { 1., 0.6 * uniform(generator), -0.3 + 0.3 * uniform(generator) };
+    const double radius = ray % 2 ? 0.05 : 0.;
+    const double slope = ray % 2 ? 0. : 0.002;
+    const vtkIdType expected = PickAll(coordinates, origin, direction, radius, slope);
+    const vtkIdType picked = tree.Pick(origin, direction, radius, slope);
+    if (picked != expected || singleThreadedTree.Pick(origin, direction, radius, slope) != expected)
+    {
+      std::cerr << "Ray " << ray << ": picked " << picked << " instead of " << expected << std::endl;
+      nbrErrors++;
+    }
+  }
+
+  // the closest points of random positions
+  for (int query = 0; query < 200; ++query)
+  {
+    const double position[3] = { 60. * uniform(generator), 60. * uniform(generator),
+      5. * uniform(generator) };
+    vtkIdType expected = -1;
+    double expectedDistance2 = 4.;
+    for (vtkIdType n = 0; n < NumberOfPoints; ++n)
+    {
+      const double distance2 = Distance2(&coordinates[3 * n], position);
+      if (distance2 <= expectedDistance2)
+      {
+        expected = n;
+        expectedDistance2 = distance2;
+      }
+    }
+    const vtkIdType closest = tree.FindClosestPoint(position, 2.);
+    if (closest != expected &&
+      !(closest >= 0 && expected >= 0 && Distance2(&coordinates[3 * closest], position) == expectedDistance2))
+    {
+      std::cerr << "Closest point " << query << ": " << closest << " instead of " << expected << std::endl;
+      nbrErrors++;
+    }
+  }
+
+  // the points of a box and of a slanted slab
+  const double planes[6 * 4] = { 1, 0, 0, 10, -1, 0, 0, 25, 0, 1, 0, 5, 0, -1, 0, 5,
+    0.2, 0, 1, 1.85, 0, 0, -1, 3 };
+  std::vector<vtkIdType> selected;
+  tree.Select(planes, 6, selected);
+  std::sort(selected.begin(), selected.end());
+  std::vector<vtkIdType> expected;
+  for (vtkIdType n = 0; n < NumberOfPoints; ++n)
+  {
+    bool isInside = true;
+    for (int plane = 0; plane < 6; ++plane)
+    {
+      const double* equation = planes + 4 * plane;
+      const float* point = &coordinates[3 * n];
+      isInside = isInside && equation[0] * point[0] + equation[1] * point[1] +
+        equation[2] * point[2] + equation[3] >= 0.;
+    }
+    if (isInside)
+    {
+      expected.push_back(n);
+    }
+  }
+  if (selected != expected || expected.empty())
+  {
+    std::cerr << selected.size() << " points selected instead of " << expected.size() << std::endl;
+    nbrErrors++;
+  }
+
+  // an empty tree answers nothing
+  PointPickingTree empty;
+  empty.Build(nullptr, 0);
+  const double origin[3] = { 0., 0., 0. };
+  if (empty.Pick(origin, origin, 1., 0.) != -1 || empty.FindClosestPoint(origin, 1.) != -1)
+  {
+    std::cerr << "Point picked in an empty tree" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
@@ -0,0 +1,128 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Give position packets carrying GPRMC sentences to a PositionConsumer, as the live
+// receivers do, and query the trajectory it builds by time.
+
+#include "PacketBuffer.h"
+#include "PositionConsumer.h"
+#include "TrajectoryBuffer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Position packet with a timestamp and a GPRMC sentence of a fix at a time of day
+PacketBufferPointer CreatePositionPacket(
+  PacketBufferPool& pool, unsigned int tohTimestamp, int secondOfDay, double heading)
+{
+  char sentence[128];
+  std::snprintf(sentence, sizeof(sentence),
+    "$GPRMC,12%02d%02d,A,4807.038,N,01131.000,E,022.4,%05.1f,230394,003.1,W,A*6A\r\n",
+    secondOfDay / 60 % 60, secondOfDay % 60, heading);
+
+  PacketBufferPointer packet = pool.Acquire();
+  std::memset(packet->GetData(), 0, 512);
+  std::memcpy(packet->GetData() + 14 + 3 * 8 + 160, &tohTimestamp, 4);
+  std::memcpy(packet->GetData() + 206, sentence, std::strlen(sentence));
+  packet->SetSize(512);
+  return packet;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int errors = 0;
+  PacketBufferPool pool(64);
+
+  // one fix per second, repeated in the packets sent every 100 ms until the next one, the
+  // heading crossing north
+  PositionConsumer consumer;
+  consumer.Start();
+  const double headings[] = { 350.0, 356.0, 2.0, 8.0, 14.0 };
+  for (int second = 0; second < 5; ++second)
+  {
+    std::vector<PacketBufferPointer> batch;
+    for (int i = 0; i < 10; ++i)
+    {
+      const unsigned int timestamp = 1000000u + second * 1000000u + i * 100000u;
+      batch.push_back(CreatePositionPacket(pool, timestamp, second, headings[second]));
+    }
+    // the lidar packets are ignored
+    PacketBufferPointer lidarPacket = pool.Acquire();
+    lidarPacket->SetSize(1206);
+    batch.push_back(lidarPacket);
+    consumer.Enqueue(batch);
+  }
+  consumer.Stop();
+
+  std::shared_ptr<TrajectoryBuffer> trajectory = consumer.GetTrajectory();
+  double first, last;
+  if (trajectory->GetNumberOfSamples() != 5 || !trajectory->GetTimeRange(first, last) ||
+      std::abs(first - 1.0) > 1e-9 || std::abs(last - 5.0) > 1e-9)
+  {
+    std::cerr << "The fixes are not added once, at the time of their first packet" << std::endl;
+    errors++;
+  }
+  if (consumer.GetImuBuffer()->GetNumberOfSamples() != 50)
+  {
+    std::cerr << "The IMU channels of the position packets are not decoded" << std::endl;
+    errors++;
+  }
+
+  TrajectoryBuffer::Sample sample;
+  if (!trajectory->Interpolate(2.5, sample) || std::abs(sample.Heading - 359.0) > 1e-9 ||
+      std::abs(sample.GPSTime - (12 * 3600 + 1.5)) > 1e-9)
+  {
+    std::cerr << "Wrong interpolation across north" << std::endl;
+    errors++;
+  }
+  Eigen::Vector3d origin;
+  if (!consumer.GetOrigin(origin) || (sample.Position - origin).norm() > 1e-6)
+  {
+    std::cerr << "Wrong origin of a static receiver" << std::endl;
+    errors++;
+  }
+  if (trajectory->Interpolate(5.5, sample))
+  {
+    std::cerr << "A time out of the samples is interpolated" << std::endl;
+    errors++;
+  }
+
+  std::vector<TrajectoryBuffer::Sample> samples;
+  if (trajectory->GetSamples(2.0, 4.0, samples) != 3)
+  {
+    std::cerr << "Wrong number of samples in the time range" << std::endl;
+    errors++;
+  }
+
+  trajectory->SetMaximumDuration(2.0);
+  if (trajectory->GetNumberOfSamples() != 3)
+  {
+    std::cerr << "The old samples are not dropped" << std::endl;
+    errors++;
+  }
+
+  return errors;
+}
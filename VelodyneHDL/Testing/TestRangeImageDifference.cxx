@@ -0,0 +1,201 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Simulate a 16 lasers sensor in a closed room with a box moving in it, and check
+// that the returns of the box are the only ones in motion, also when the sensor moves
+// and the range image follows it. The lasers do not reach the floor, which is seen at
+// grazing angles, so that the returns moved with the sensor to the closest laser would
+// not have the ranges of this laser.
+
+#include "RangeImageDifference.h"
+
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedShortArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace
+{
+const double RoomHalfSize = 10.;
+
+//-----------------------------------------------------------------------------
+// Distance along a ray from the sensor to the walls of the room, or to the box around
+// boxCenter if it is closer. The box is 1 m wide and as high as the walls.
+double CastRay(const double origin[3], const double direction[3], const double boxCenter[2],
+  bool& hitBox)
+{
+  double t = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < 2; ++i)
+  {
+    if (direction[i] != 0.)
+    {
+      const double wall = direction[i] > 0. ? RoomHalfSize : -RoomHalfSize;
+      t = std::min(t, (wall - origin[i]) / direction[i]);
+    }
+  }
+
+  // slab intersection with the box, the rays start outside of it
+  double enter = 0., leave = std::numeric_limits<double>::infinity();
+  for (int i = 0; i < 2; ++i)
+  {
+    const double low = boxCenter[i] - 0.5 - origin[i], high = boxCenter[i] + 0.5 - origin[i];
+    if (direction[i] == 0.)
+    {
+      if (low > 0. || high < 0.)
+      {
+        leave = -1.;
+      }
+      continue;
+    }
+    const double t0 = low / direction[i], t1 = high / direction[i];
+    enter = std::max(enter, std::min(t0, t1));
+    leave = std::min(leave, std::max(t0, t1));
+  }
+  hitBox = enter <= leave && enter < t;
+  return hitBox ? enter : t;
+}
+
+//-----------------------------------------------------------------------------
+// Frame in the sensor reference frame, the sensor being at sensorPosition, with the
+// azimuths of the interpreters (clockwise from the y axis, in hundredths of degree)
+vtkSmartPointer<vtkPolyData> CreateFrame(
+  const double sensorPosition[3], const double boxCenter[2], std::vector<bool>& isBox)
+{
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  auto laserIds = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  laserIds->SetName("laser_id");
+  auto azimuths = vtkSmartPointer<vtkUnsignedShortArray>::New();
+  azimuths->SetName("azimuth");
+  isBox.clear();
+  for (int laser = 0; laser < 16; ++laser)
+  {
+    const double elevation = vtkMath::RadiansFromDegrees(-7. + 2. * laser);
+    for (int azimuth = 0; azimuth < 36000; azimuth += 100)
+    {
+      const double angle = vtkMath::RadiansFromDegrees(azimuth / 100.);
+      const double direction[3] = { std::cos(elevation) * std::sin(angle),
+        std::cos(elevation) * std::cos(angle), std::sin(elevation) };
+      bool hitBox = false;
+      const double t = CastRay(sensorPosition, direction, boxCenter, hitBox);
+      points->InsertNextPoint(t * direction[0], t * direction[1], t * direction[2]);
+      laserIds->InsertNextValue(static_cast<unsigned char>(laser));
+      azimuths->InsertNextValue(static_cast<unsigned short>(azimuth));
+      isBox.push_back(hitBox);
+    }
+  }
+  auto frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->SetPoints(points);
+  frame->GetPointData()->AddArray(laserIds);
+  frame->GetPointData()->AddArray(azimuths);
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+// Count the returns in motion which are not on the box, and the returns of the box
+// which are not in motion
+void CountErrors(const std::vector<unsigned char>& motion, const std::vector<bool>& isBox,
+  const std::vector<bool>& wasBox, vtkIdType& falseMotions, vtkIdType& missedMotions)
+{
+  falseMotions = 0;
+  missedMotions = 0;
+  for (size_t i = 0; i < motion.size(); ++i)
+  {
+    // the returns behind the previous position of the box are uncovered, so they move too
+    if (motion[i] && !isBox[i] && !wasBox[i])
+    {
+      falseMotions++;
+    }
+    if (!motion[i] && isBox[i] && !wasBox[i])
+    {
+      missedMotions++;
+    }
+  }
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  RangeImageDifference image;
+  image.SetNumberOfColumns(360);
+
+  // the first frame has nothing to be compared to
+  const double origin[3] = { 0., 0., 0. };
+  const double firstBox[2] = { 5., 0. };
+  std::vector<bool> wasBox, isBox;
+  vtkSmartPointer<vtkPolyData> frame = CreateFrame(origin, firstBox, wasBox);
+  std::vector<unsigned char> motion(frame->GetNumberOfPoints(), 1);
+  if (!image.AddFrame(frame, motion.data()) ||
+    std::count(motion.begin(), motion.end(), 1) != 0)
+  {
+    std::cerr << "The returns of the first frame must be static" << std::endl;
+    nbrErrors++;
+  }
+
+  // the box moves 3 m, the sensor stays
+  const double secondBox[2] = { 5., 3. };
+  frame = CreateFrame(origin, secondBox, isBox);
+  image.AddFrame(frame, motion.data());
+  vtkIdType falseMotions = 0, missedMotions = 0;
+  CountErrors(motion, isBox, wasBox, falseMotions, missedMotions);
+  if (falseMotions != 0 || missedMotions != 0)
+  {
+    std::cerr << "Static sensor: " << falseMotions << " static returns in motion, "
+              << missedMotions << " returns of the box static" << std::endl;
+    nbrErrors++;
+  }
+
+  // the sensor moves 2 m along x: without following it, the walls move
+  RangeImageDifference fixedImage;
+  fixedImage.SetNumberOfColumns(360);
+  fixedImage.AddFrame(frame, motion.data());
+  const double movedSensor[3] = { 2., 0., 0. };
+  wasBox = isBox;
+  frame = CreateFrame(movedSensor, secondBox, isBox);
+  fixedImage.AddFrame(frame, motion.data());
+  CountErrors(motion, isBox, wasBox, falseMotions, missedMotions);
+  if (falseMotions < frame->GetNumberOfPoints() / 10)
+  {
+    std::cerr << "The walls must move when the image does not follow the sensor, got "
+              << falseMotions << " returns in motion" << std::endl;
+    nbrErrors++;
+  }
+
+  // while they are static when the image follows the sensor, apart from a few returns
+  // whose laser changes
+  const double motionMatrix[16] = { 1., 0., 0., -2., 0., 1., 0., 0., 0., 0., 1., 0., 0., 0., 0.,
+    1. };
+  image.MoveSensor(motionMatrix);
+  image.AddFrame(frame, motion.data());
+  CountErrors(motion, isBox, wasBox, falseMotions, missedMotions);
+  if (falseMotions > frame->GetNumberOfPoints() / 100)
+  {
+    std::cerr << "Moving sensor: " << falseMotions << " static returns in motion" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
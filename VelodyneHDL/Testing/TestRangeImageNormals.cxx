@@ -0,0 +1,147 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+// Check the normals and the curvatures estimated from the range image of a sensor seeing
+// the ground and a wall, without mixing the returns of the two across the depth discontinuity
+
+#include "LidarRangeImage.h"
+#include "RangeImageNormals.h"
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+const int Width = 360;
+const int Height = 16;
+const double Pi = 3.14159265358979;
+
+//-----------------------------------------------------------------------------
+// Range image of a sensor 1.5 m above the ground, the lasers going from -15 to 0 degrees,
+// with a wall x = 4 in front of it from azimuth -30 to 30 degrees
+LidarRangeImage CreateImage()
+{
+  LidarRangeImage image;
+  image.Width = Width;
+  image.Height = Height;
+  const size_t numberOfPixels = static_cast<size_t>(Width) * Height;
+  image.Points.assign(numberOfPixels, -1);
+  image.Ranges.assign(numberOfPixels, 0.f);
+  image.X.assign(numberOfPixels, 0.f);
+  image.Y.assign(numberOfPixels, 0.f);
+  image.Z.assign(numberOfPixels, 0.f);
+  for (int row = 0; row < Height; ++row)
+  {
+    const double elevation = (-15. + row) * Pi / 180.;
+    image.RowElevations.push_back(elevation);
+    for (int col = 0; col < Width; ++col)
+    {
+      const double azimuth = (col + 0.5) * Pi / 180.;
+      const double direction[3] = { std::cos(elevation) * std::cos(azimuth),
+        std::cos(elevation) * std::sin(azimuth), std::sin(elevation) };
+      double range = direction[2] < 0. ? -1.5 / direction[2] : -1.;
+      if (direction[0] > std::cos(30. * Pi / 180.) * std::cos(elevation) && 4. / direction[0] < range)
+      {
+        range = 4. / direction[0];
+      }
+      if (range <= 0.)
+      {
+        continue;
+      }
+      const size_t pixel = static_cast<size_t>(row) * Width + col;
+      image.Points[pixel] = static_cast<vtkIdType>(pixel);
+      image.Ranges[pixel] = static_cast<float>(range);
+      image.X[pixel] = static_cast<float>(range * direction[0]);
+      image.Y[pixel] = static_cast<float>(range * direction[1]);
+      image.Z[pixel] = static_cast<float>(range * direction[2]);
+    }
+  }
+  return image;
+}
+
+//-----------------------------------------------------------------------------
+int CheckNormal(const std::vector<float>& normals, const std::vector<float>& curvatures,
+  int row, int col, double nx, double ny, double nz, const char* name)
+{
+  const size_t pixel = static_cast<size_t>(row) * Width + col;
+  const float* normal = &normals[3 * pixel];
+  if (!(std::abs(normal[0] - nx) < 1e-2 && std::abs(normal[1] - ny) < 1e-2 &&
+        std::abs(normal[2] - nz) < 1e-2 && curvatures[pixel] < 1e-3))
+  {
+    std::cerr << name << ": normal " << normal[0] << ", " << normal[1] << ", " << normal[2]
+              << ", curvature " << curvatures[pixel] << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Compare the values of [begin, end[, the pixels without normal having NaN values in both
+bool SameValues(const std::vector<float>& values, const std::vector<float>& expected,
+  size_t begin, size_t end)
+{
+  for (size_t k = begin; k < end; ++k)
+  {
+    if (values[k] != expected[k] && !(std::isnan(values[k]) && std::isnan(expected[k])))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  const LidarRangeImage image = CreateImage();
+  RangeImageNormals estimation;
+  estimation.NumberOfThreads = 4;
+  std::vector<float> normals, curvatures;
+  estimation.Compute(image, normals, curvatures);
+
+  int nbrErrors = 0;
+  // the normals face the sensor, the columns wrap around
+  nbrErrors += CheckNormal(normals, curvatures, 0, 180, 0., 0., 1., "Ground");
+  nbrErrors += CheckNormal(normals, curvatures, 12, 0, -1., 0., 0., "Wall");
+  nbrErrors += CheckNormal(normals, curvatures, 12, 359, -1., 0., 0., "Wall at the last column");
+  // the wall is above the ground at the bottom of its last column, which is not a neighbor
+  nbrErrors += CheckNormal(normals, curvatures, 0, 29, -1., 0., 0., "Wall next to the ground");
+
+  // the pixels without return have no normal
+  const size_t sky = static_cast<size_t>(Height - 1) * Width + 180;
+  if (!std::isnan(normals[3 * sky]) || !std::isnan(curvatures[sky]))
+  {
+    std::cerr << "Normal of a pixel without return" << std::endl;
+    nbrErrors++;
+  }
+
+  // the rows are split between the threads, the ones at the bounds of a split using the
+  // neighbors of the next rows all the same: no row differs from a single thread estimation
+  estimation.NumberOfThreads = 1;
+  std::vector<float> singleThreadedNormals, singleThreadedCurvatures;
+  estimation.Compute(image, singleThreadedNormals, singleThreadedCurvatures);
+  for (int row = 0; row < Height; ++row)
+  {
+    const size_t first = static_cast<size_t>(row) * Width;
+    if (!SameValues(normals, singleThreadedNormals, 3 * first, 3 * (first + Width)) ||
+      !SameValues(curvatures, singleThreadedCurvatures, first, first + Width))
+    {
+      std::cerr << "Row " << row << ": normals differ from a single thread estimation" << std::endl;
+      nbrErrors++;
+    }
+  }
+  return nbrErrors;
+}
@@ -0,0 +1,154 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Simulate a 16 lasers sensor above a flat ground with two walls, and check
+// that the ground is labelled and that each wall is a single cluster.
+
+#include "vtkRangeImageSegmentation.h"
+
+#include <vtkDataArray.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkUnsignedShortArray.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+const double SensorHeight = 1.5;
+
+enum Surfaces
+{
+  Ground = 0,
+  FrontWall = 1,
+  BackWall = 2
+};
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  auto laserIds = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  laserIds->SetName("laser_id");
+  auto azimuths = vtkSmartPointer<vtkUnsignedShortArray>::New();
+  azimuths->SetName("azimuth");
+  std::vector<int> surfaces;
+
+  // the lasers are not in the order of their elevation, as for the real sensors
+  for (int laser = 0; laser < 16; ++laser)
+  {
+    const double elevation = vtkMath::RadiansFromDegrees(laser % 2 ? 1. + laser : -15. + laser);
+    for (int step = 0; step < 360; ++step)
+    {
+      const double azimuth = vtkMath::RadiansFromDegrees(step + 0.5);
+      const double direction[3] = { std::cos(elevation) * std::cos(azimuth),
+                                    std::cos(elevation) * std::sin(azimuth), std::sin(elevation) };
+
+      // closest intersection with the ground, the front wall at x = 10 and the
+      // back wall at x = -6
+      double range = 100.;
+      int surface = -1;
+      if (direction[2] < 0. && -SensorHeight / direction[2] < range)
+      {
+        range = -SensorHeight / direction[2];
+        surface = Ground;
+      }
+      const double walls[2][3] = { { 10., 1., 0.5 }, { -6., 2., 1. } };
+      for (int wall = 0; wall < 2; ++wall)
+      {
+        const double t = walls[wall][0] / direction[0];
+        if (t > 0. && t < range && std::abs(t * direction[1]) < walls[wall][1] &&
+            t * direction[2] < walls[wall][2] && t * direction[2] > -SensorHeight)
+        {
+          range = t;
+          surface = wall == 0 ? FrontWall : BackWall;
+        }
+      }
+      if (surface < 0)
+      {
+        continue;
+      }
+      points->InsertNextPoint(range * direction[0], range * direction[1], range * direction[2]);
+      laserIds->InsertNextValue(laser);
+      azimuths->InsertNextValue(static_cast<unsigned short>(100 * step + 50));
+      surfaces.push_back(surface);
+    }
+  }
+
+  auto cloud = vtkSmartPointer<vtkPolyData>::New();
+  cloud->SetPoints(points);
+  cloud->GetPointData()->AddArray(laserIds);
+  cloud->GetPointData()->AddArray(azimuths);
+
+  auto filter = vtkSmartPointer<vtkRangeImageSegmentation>::New();
+  filter->SetInputData(cloud);
+  filter->SetWidth(360);
+  filter->SetMinimumClusterSize(5);
+  filter->Update();
+  vtkPolyData* output = filter->GetOutput();
+  vtkDataArray* ground = output->GetPointData()->GetArray("ground");
+  vtkDataArray* clusters = output->GetPointData()->GetArray("cluster_id");
+  if (!ground || !clusters)
+  {
+    std::cerr << "Missing output arrays" << std::endl;
+    return 1;
+  }
+
+  // the bottom of the walls touches the ground, so that it may be labelled ground
+  int nbrErrors = 0;
+  vtkIdType groundPoints = 0, labelledGround = 0;
+  int wallClusters[3] = { -2, -2, -2 };
+  for (vtkIdType i = 0; i < output->GetNumberOfPoints(); ++i)
+  {
+    if (surfaces[i] == Ground)
+    {
+      groundPoints++;
+      labelledGround += ground->GetTuple1(i) == 1 ? 1 : 0;
+      continue;
+    }
+    if (ground->GetTuple1(i) == 1)
+    {
+      continue;
+    }
+    const int cluster = static_cast<int>(clusters->GetTuple1(i));
+    if (cluster < 0 || (wallClusters[surfaces[i]] != -2 && wallClusters[surfaces[i]] != cluster))
+    {
+      std::cerr << "Point " << i << " of wall " << surfaces[i] << " is in cluster " << cluster << std::endl;
+      nbrErrors++;
+    }
+    wallClusters[surfaces[i]] = cluster;
+  }
+  if (labelledGround < 0.95 * groundPoints)
+  {
+    std::cerr << "Only " << labelledGround << " of the " << groundPoints << " ground points are labelled" << std::endl;
+    nbrErrors++;
+  }
+  if (wallClusters[FrontWall] == wallClusters[BackWall] || filter->GetNumberOfClusters() != 2)
+  {
+    std::cerr << "The walls must be two different clusters, got " << filter->GetNumberOfClusters()
+              << " clusters" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
@@ -72,6 +72,7 @@ int main(int argc, char* argv[])
     // apply filter ransac plane model
     auto filter = vtkSmartPointer<vtkRansacPlaneModel>::New();
     filter->SetAlignOutput(1);
+    filter->SetNumberOfThreads(4);
     filter->SetInputData(polydata);
     filter->Update();
     auto output = filter->GetOutput();
@@ -102,5 +103,33 @@ int main(int argc, char* argv[])
         }
     }
 
+    // check that the plane does not depend on the number of threads
+    auto sequentialFilter = vtkSmartPointer<vtkRansacPlaneModel>::New();
+    sequentialFilter->SetNumberOfThreads(1);
+    sequentialFilter->SetInputData(polydata);
+    sequentialFilter->Update();
+    for (int i = 0; i < 4; ++i)
+    {
+        if (sequentialFilter->GetPlaneParam()[i] != filter->GetPlaneParam()[i])
+        {
+            std::cout << "Error: the plane depends on the number of threads" << std::endl;
+            return -1;
+        }
+    }
+
+    // check that the tracked plane keeps the points aligned
+    filter->SetTrackPlane(true);
+    filter->Update();
+    output = filter->GetOutput();
+    for (int i = 0; i < N - N_OUTLIERS; ++i)
+    {
+        output->GetPoint(i, temp_d);
+        if (std::abs(temp_d[2]) > max_z_threshold)
+        {
+            std::cout << "Error: tracked plane, point " << i << " has z = " << temp_d[2] << std::endl;
+            return -1;
+        }
+    }
+
     return 0;
 }
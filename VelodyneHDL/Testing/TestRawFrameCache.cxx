@@ -0,0 +1,136 @@
+// Check the cache of the packets of the frames, then decode the frames of a pcap, change the
+// sensor transform and compare the frames decoded again from the cached packets with the ones
+// of a reader which had the transform from the start.
+
+#include "RawFrameCache.h"
+#include "TestHelpers.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkTransform.h>
+
+#include <iostream>
+#include <memory>
+
+//-----------------------------------------------------------------------------
+std::shared_ptr<const RawFrame> CreateRawFrame(int numberOfPackets)
+{
+  std::shared_ptr<RawFrame> frame = std::make_shared<RawFrame>();
+  frame->Data.assign(numberOfPackets * 1206, 0);
+  for (int i = 0; i <= numberOfPackets; ++i)
+  {
+    frame->Offsets.push_back(i * 1206);
+  }
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+int TestCache()
+{
+  int nbrErrors = 0;
+  RawFrameCache cache;
+  const unsigned long frameSize = CreateRawFrame(100)->GetMemorySize();
+  cache.SetMemoryBudget(3 * frameSize);
+
+  std::shared_ptr<const RawFrame> frame = CreateRawFrame(100);
+  cache.Add(0, "a", frame);
+  if (cache.Get(0, "a") != frame || cache.Get(1, "a"))
+  {
+    std::cerr << "Wrong frame returned" << std::endl;
+    nbrErrors++;
+  }
+  if (cache.GetNumberOfHits() != 1 || cache.GetNumberOfMisses() != 1)
+  {
+    std::cerr << "Wrong statistics: " << cache.GetNumberOfHits() << " hits, "
+              << cache.GetNumberOfMisses() << " misses" << std::endl;
+    nbrErrors++;
+  }
+
+  // frame 0 becomes the most recently used, so frame 1 is evicted
+  for (int i = 1; i < 3; ++i)
+  {
+    cache.Add(i, "a", CreateRawFrame(100));
+  }
+  cache.Get(0, "a");
+  cache.Add(3, "a", CreateRawFrame(100));
+  if (cache.GetNumberOfFrames() != 3 || cache.GetMemorySize() > cache.GetMemoryBudget() ||
+    !cache.Get(0, "a") || cache.Get(1, "a"))
+  {
+    std::cerr << "Wrong frame evicted" << std::endl;
+    nbrErrors++;
+  }
+
+  // the packets of frames split another way must not be returned
+  if (cache.Get(0, "b") || cache.GetNumberOfFrames() != 0)
+  {
+    std::cerr << "Frame returned for another key" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+void OpenReader(vtkLidarReader* reader, const char* pcapFileName, const char* correctionFileName)
+{
+  vtkNew<vtkVelodynePacketInterpreter> interpreter;
+  reader->SetInterpreter(interpreter.GetPointer());
+  reader->SetFileName(pcapFileName);
+  reader->SetCalibrationFileName(correctionFileName);
+  reader->Update();
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: TestRawFrameCache <pcapFileName> <correctionFileName>" << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = TestCache();
+
+  vtkNew<vtkLidarReader> reader;
+  OpenReader(reader.GetPointer(), argv[1], argv[2]);
+  const int numberOfFrames = reader->GetNumberOfFrames();
+  if (numberOfFrames < 3)
+  {
+    std::cerr << "The reader has less than 3 frames" << std::endl;
+    return 1;
+  }
+  for (int frame = 0; frame < numberOfFrames; ++frame)
+  {
+    GetCurrentFrame(reader.GetPointer(), frame);
+  }
+
+  vtkNew<vtkTransform> transform;
+  transform->Translate(1., -2., 0.5);
+  transform->RotateZ(30.);
+  reader->GetInterpreter()->SetSensorTransform(transform.GetPointer());
+  reader->ResetFrameCacheStatistics();
+  vtkNew<vtkLidarReader> expectedReader;
+  OpenReader(expectedReader.GetPointer(), argv[1], argv[2]);
+  expectedReader->GetInterpreter()->SetSensorTransform(transform.GetPointer());
+  for (int frame = 0; frame < numberOfFrames; ++frame)
+  {
+    vtkPolyData* output = GetCurrentFrame(reader.GetPointer(), frame);
+    vtkPolyData* expected = GetCurrentFrame(expectedReader.GetPointer(), frame);
+    if (TestPointCount(output, expected))
+    {
+      nbrErrors++;
+      continue;
+    }
+    nbrErrors += TestPointDataValues(output, expected) + TestPointPositions(output, expected);
+  }
+
+  // the last frame ends in the packets of no other frame, it is always read from the file
+  if (reader->GetRawFrameCacheHits() < numberOfFrames - 2)
+  {
+    std::cerr << "Only " << reader->GetRawFrameCacheHits() << " frames decoded from the cache"
+              << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
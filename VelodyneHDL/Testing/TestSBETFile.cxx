@@ -0,0 +1,148 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Write a synthetic SBET file and check that the time windows read through the
+// sparse index are the ones of a linear search.
+
+#include "SBETFile.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+std::vector<SBETRecord> CreateRecords(size_t count)
+{
+  std::vector<SBETRecord> records(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    SBETRecord& record = records[i];
+    // 200 Hz, with a few repeated times
+    record.Time = 345600. + 0.005 * (i - i % 7 / 6);
+    record.Latitude = 0.8 + 1e-7 * i;
+    record.Longitude = 0.04 - 1e-7 * i;
+    record.Altitude = 50. + 1e-3 * i;
+    record.VelocityX = record.VelocityY = record.VelocityZ = 0.;
+    record.Roll = record.Pitch = 0.01;
+    record.Heading = 1e-4 * i;
+    record.WanderAngle = 0.;
+    record.AccelerationX = record.AccelerationY = record.AccelerationZ = 0.;
+    record.AngularRateX = record.AngularRateY = record.AngularRateZ = 0.;
+  }
+  return records;
+}
+
+//-----------------------------------------------------------------------------
+int TestWindow(SBETFile& file, const std::vector<SBETRecord>& expected, double tstart, double tend)
+{
+  std::vector<SBETRecord> records;
+  if (!file.Read(tstart, tend, records))
+  {
+    std::cerr << "Failed to read the window: " << file.GetLastError() << std::endl;
+    return 1;
+  }
+  size_t first = 0;
+  while (first < expected.size() && expected[first].Time < tstart)
+  {
+    ++first;
+  }
+  size_t last = first;
+  while (last < expected.size() && expected[last].Time <= tend)
+  {
+    ++last;
+  }
+  if (file.FindRecord(tstart) != first || records.size() != last - first)
+  {
+    std::cerr << "Wrong window [" << tstart << ", " << tend << "]: " << records.size()
+              << " records instead of " << last - first << std::endl;
+    return 1;
+  }
+  for (size_t i = 0; i < records.size(); ++i)
+  {
+    if (records[i].Time != expected[first + i].Time ||
+      records[i].Heading != expected[first + i].Heading)
+    {
+      std::cerr << "Wrong record " << first + i << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  const std::string filename = "TestSBETFile.out";
+  const std::vector<SBETRecord> expected = CreateRecords(10 * SBETFile::IndexStride + 123);
+  {
+    std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    stream.write(reinterpret_cast<const char*>(&expected[0]), expected.size() * sizeof(SBETRecord));
+  }
+
+  int nbrErrors = 0;
+  SBETFile file;
+  if (!SBETFile::IsSBETFile(filename) || !file.Open(filename))
+  {
+    std::cerr << "Failed to open the SBET file: " << file.GetLastError() << std::endl;
+    std::remove(filename.c_str());
+    return 1;
+  }
+  double range[2];
+  if (file.GetNumberOfRecords() != expected.size() || !file.GetTimeRange(range) ||
+    range[0] != expected.front().Time || range[1] != expected.back().Time)
+  {
+    std::cerr << "Wrong number of records or time range" << std::endl;
+    ++nbrErrors;
+  }
+
+  // windows before, after, inside a block, across blocks, on block bounds and exact times
+  const double t0 = expected.front().Time;
+  const double t1 = expected.back().Time;
+  nbrErrors += TestWindow(file, expected, t0 - 10., t0 - 1.);
+  nbrErrors += TestWindow(file, expected, t1 + 1., t1 + 10.);
+  nbrErrors += TestWindow(file, expected, t0 - 1., t1 + 1.);
+  nbrErrors += TestWindow(file, expected, t0 + 0.1, t0 + 0.2);
+  nbrErrors += TestWindow(file, expected, t0 + 3.3, t0 + 31.7);
+  for (size_t i = 1; i < 10; ++i)
+  {
+    const double time = expected[i * SBETFile::IndexStride].Time;
+    nbrErrors += TestWindow(file, expected, time, time);
+    nbrErrors += TestWindow(file, expected, time - 0.0025, time + 0.0025);
+    nbrErrors += TestWindow(file, expected, expected[i * SBETFile::IndexStride - 1].Time, time);
+  }
+  file.Close();
+
+  // a text export is not taken for a SBET file, even with the size of a record
+  {
+    std::ofstream stream(filename.c_str(), std::ios::out | std::ios::trunc);
+    std::string header = "Applanix POSPac export, central meridian = 3 deg\n";
+    header.resize(sizeof(SBETRecord), ' ');
+    stream << header;
+  }
+  if (SBETFile::IsSBETFile(filename))
+  {
+    std::cerr << "A text file is detected as a SBET file" << std::endl;
+    ++nbrErrors;
+  }
+
+  std::remove(filename.c_str());
+  return nbrErrors;
+}
@@ -0,0 +1,122 @@
+// Decode the frames of a pcap, with all the lasers then with every other laser, and check that
+// the scan line index given with each frame holds every point once, grouped by laser id and in
+// firing order.
+
+#include "LidarDecodingKernels.h"
+#include "vtkLidarReader.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkDataArray.h>
+#include <vtkInformation.h>
+#include <vtkIntArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+vtkPolyData* UpdateFrame(vtkLidarReader* reader, int index)
+{
+  reader->UpdateInformation();
+  vtkInformation* outInfo = reader->GetExecutive()->GetOutputInformation(0);
+  double* timeSteps = outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(), timeSteps[index]);
+  reader->Update();
+  return vtkPolyData::SafeDownCast(reader->GetOutputDataObject(0));
+}
+
+//-----------------------------------------------------------------------------
+int CheckIndex(vtkPolyData* frame, const std::vector<bool>& selection, int frameIndex)
+{
+  vtkIntArray* offsets = nullptr;
+  vtkIntArray* points = nullptr;
+  vtkDataArray* laserIds = frame->GetPointData()->GetArray("laser_id");
+  if (!laserIds || !ScanLineIndex::Get(frame, offsets, points))
+  {
+    std::cerr << "Frame " << frameIndex << ": missing laser ids or scan line index" << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = 0;
+  const vtkIdType numberOfPoints = frame->GetNumberOfPoints();
+  std::vector<int> seen(numberOfPoints, 0);
+  const int numberOfLasers = static_cast<int>(offsets->GetNumberOfValues()) - 1;
+  for (int laser = 0; laser < numberOfLasers; ++laser)
+  {
+    const int begin = offsets->GetValue(laser);
+    const int end = offsets->GetValue(laser + 1);
+    const bool selected = laser < static_cast<int>(selection.size()) && selection[laser];
+    if (begin > end || (begin < end && !selected))
+    {
+      std::cerr << "Frame " << frameIndex << ", laser " << laser << ": wrong points range ["
+                << begin << ", " << end << ")" << std::endl;
+      nbrErrors++;
+      continue;
+    }
+    for (int k = begin; k < end; ++k)
+    {
+      const int id = points->GetValue(k);
+      if (id < 0 || id >= numberOfPoints || seen[id]++ ||
+        static_cast<int>(laserIds->GetTuple1(id)) != laser ||
+        (k > begin && id <= points->GetValue(k - 1)))
+      {
+        std::cerr << "Frame " << frameIndex << ", laser " << laser << ": wrong point " << id
+                  << " at " << k << std::endl;
+        nbrErrors++;
+        break;
+      }
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: TestScanLineIndex <pcapFileName> <correctionFileName>" << std::endl;
+    return 1;
+  }
+
+  vtkNew<vtkLidarReader> reader;
+  vtkNew<vtkVelodynePacketInterpreter> interpreter;
+  reader->SetInterpreter(interpreter.GetPointer());
+  reader->SetFileName(argv[1]);
+  reader->SetCalibrationFileName(argv[2]);
+  reader->Update();
+  const int numberOfFrames = reader->GetNumberOfFrames();
+  const int numberOfLasers = interpreter->GetNumberOfChannels();
+  if (numberOfFrames < 1 || numberOfLasers < 1)
+  {
+    std::cerr << "The reader has no frame" << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = 0;
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    // the second pass only decodes the even lasers
+    std::vector<bool> selection(numberOfLasers, true);
+    for (int laser = 1; pass == 1 && laser < numberOfLasers; laser += 2)
+    {
+      selection[laser] = false;
+    }
+    interpreter->SetLaserSelection(selection);
+    reader->Modified();
+    for (int frame = 0; frame < numberOfFrames; ++frame)
+    {
+      vtkPolyData* output = UpdateFrame(reader.GetPointer(), frame);
+      if (!output)
+      {
+        std::cerr << "Missing frame " << frame << std::endl;
+        return 1;
+      }
+      nbrErrors += CheckIndex(output, selection, frame);
+    }
+  }
+  return nbrErrors;
+}
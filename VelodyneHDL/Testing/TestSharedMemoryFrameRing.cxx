@@ -0,0 +1,160 @@
+// Publish frames in a shared memory ring while another thread reads the latest one: every
+// frame read must be a frame published, never a mix of two frames, and a frame larger than
+// a slot must be skipped.
+
+#include "SharedMemoryFrameRing.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <boost/thread/thread.hpp>
+
+#include <atomic>
+#include <iostream>
+#include <string>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+//! Frame whose values are all derived from its number, so that a torn copy is detected
+vtkSmartPointer<vtkPolyData> CreateFrame(int frameNumber, vtkIdType numberOfPoints)
+{
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetNumberOfPoints(numberOfPoints);
+  auto intensity = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  intensity->SetName("intensity");
+  intensity->SetNumberOfTuples(numberOfPoints);
+  auto time = vtkSmartPointer<vtkDoubleArray>::New();
+  time->SetName("adjustedtime");
+  time->SetNumberOfTuples(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    points->SetPoint(i, frameNumber, i, -frameNumber);
+    intensity->SetValue(i, static_cast<unsigned char>(frameNumber % 256));
+    time->SetValue(i, frameNumber * 1e6 + i);
+  }
+  auto frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->SetPoints(points);
+  frame->GetPointData()->AddArray(intensity);
+  frame->GetPointData()->AddArray(time);
+  return frame;
+}
+
+//-----------------------------------------------------------------------------
+bool CheckFrame(vtkPolyData* frame, int frameNumber, vtkIdType numberOfPoints)
+{
+  vtkDataArray* intensity = frame->GetPointData()->GetArray("intensity");
+  vtkDataArray* time = frame->GetPointData()->GetArray("adjustedtime");
+  if (frame->GetNumberOfPoints() != numberOfPoints || !intensity || !time ||
+    intensity->GetDataType() != VTK_UNSIGNED_CHAR || time->GetDataType() != VTK_DOUBLE ||
+    frame->GetPoints()->GetDataType() != VTK_FLOAT)
+  {
+    std::cerr << "Wrong layout of frame " << frameNumber << std::endl;
+    return false;
+  }
+  vtkDataArray* points = frame->GetPoints()->GetData();
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    if (points->GetComponent(i, 0) != frameNumber || points->GetComponent(i, 1) != i ||
+      points->GetComponent(i, 2) != -frameNumber ||
+      intensity->GetComponent(i, 0) != frameNumber % 256 ||
+      time->GetComponent(i, 0) != frameNumber * 1e6 + i)
+    {
+      std::cerr << "Wrong value in frame " << frameNumber << " at point " << i << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  const std::string name = "TestSharedMemoryFrameRing_" + std::to_string(std::rand());
+  const vtkIdType numberOfPoints = 20000;
+  const int numberOfFrames = 300;
+
+  SharedMemoryFrameRing publisher;
+  if (!publisher.Create(name, 3, 1 << 20))
+  {
+    std::cerr << "Cannot create the shared memory " << name << std::endl;
+    return 1;
+  }
+  SharedMemoryFrameRing reader;
+  vtkSmartPointer<vtkPolyData> frame;
+  double time = 0;
+  boost::uint64_t frameNumber = 0;
+  if (!reader.Open(name) || reader.ReadLatestFrame(frame, time, frameNumber))
+  {
+    std::cerr << "The empty ring cannot be read" << std::endl;
+    return 1;
+  }
+
+  // the frames are read as fast as possible while they are published
+  std::atomic<bool> isPublishing(true);
+  std::atomic<bool> hasFailed(false);
+  int numberOfReadFrames = 0;
+  boost::thread readingThread([&]() {
+    while (isPublishing && !hasFailed)
+    {
+      vtkSmartPointer<vtkPolyData> read;
+      double readTime = 0;
+      boost::uint64_t readNumber = 0;
+      if (reader.ReadLatestFrame(read, readTime, readNumber))
+      {
+        if (readTime != readNumber * 0.1 ||
+          !CheckFrame(read, static_cast<int>(readNumber), numberOfPoints))
+        {
+          hasFailed = true;
+        }
+        numberOfReadFrames++;
+      }
+    }
+  });
+  for (int i = 0; i < numberOfFrames && !hasFailed; ++i)
+  {
+    if (!publisher.Publish(CreateFrame(i, numberOfPoints), i * 0.1))
+    {
+      std::cerr << "Cannot publish frame " << i << std::endl;
+      hasFailed = true;
+    }
+  }
+  isPublishing = false;
+  readingThread.join();
+  if (hasFailed)
+  {
+    return 1;
+  }
+  std::cout << numberOfReadFrames << " frames read while publishing" << std::endl;
+
+  // the latest frame is the last one, a frame too large is skipped
+  if (publisher.Publish(CreateFrame(numberOfFrames, 100000), 0) ||
+    publisher.GetNumberOfSkippedFrames() != 1 ||
+    publisher.GetNumberOfPublishedFrames() != static_cast<unsigned long>(numberOfFrames))
+  {
+    std::cerr << "A frame larger than a slot has been published" << std::endl;
+    return 1;
+  }
+  if (!reader.ReadLatestFrame(frame, time, frameNumber) ||
+    frameNumber != static_cast<boost::uint64_t>(numberOfFrames - 1) ||
+    !CheckFrame(frame, numberOfFrames - 1, numberOfPoints))
+  {
+    std::cerr << "Wrong latest frame" << std::endl;
+    return 1;
+  }
+
+  // the name is freed once the publisher is closed
+  publisher.Close();
+  reader.Close();
+  if (reader.Open(name))
+  {
+    std::cerr << "The shared memory has not been removed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
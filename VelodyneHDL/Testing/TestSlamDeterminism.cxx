@@ -0,0 +1,143 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Run the slam in deterministic mode on the first frames of a pcap, once
+// sequentially and once with several threads, the pipelined mode and the
+// batched neighbors search. Both trajectories must be exactly the same.
+
+#include "vtkLidarReader.h"
+#include "vtkSlamManager.h"
+#include "vtkVelodynePacketInterpreter.h"
+
+#include <vtkDataArray.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace
+{
+const int NumberOfFrames = 10;
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> RunSlam(vtkLidarReader* reader, int numberOfThreads, bool parallel)
+{
+  vtkSmartPointer<vtkSlamManager> slam = vtkSmartPointer<vtkSlamManager>::New();
+  slam->SetInputConnection(0, reader->GetOutputPort(0));
+  slam->SetInputConnection(1, reader->GetOutputPort(1));
+  slam->SetDeterministic(true);
+  slam->SetNumberOfThreads(numberOfThreads);
+  slam->SetPipelined(parallel);
+  slam->SetNeighborSearchBackend(parallel ? 2 : 0);
+  slam->SetAllFrame(false);
+  slam->SetStartFrame(0);
+  slam->SetEndFrame(NumberOfFrames - 1);
+  slam->Update();
+
+  vtkSmartPointer<vtkPolyData> trajectory = vtkSmartPointer<vtkPolyData>::New();
+  trajectory->DeepCopy(slam->GetOutput(1));
+  return trajectory;
+}
+
+//-----------------------------------------------------------------------------
+int CompareTrajectories(vtkPolyData* sequential, vtkPolyData* parallel)
+{
+  if (sequential->GetNumberOfPoints() != parallel->GetNumberOfPoints())
+  {
+    std::cerr << "Different number of poses: " << sequential->GetNumberOfPoints()
+              << " and " << parallel->GetNumberOfPoints() << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = 0;
+  for (vtkIdType k = 0; k < sequential->GetNumberOfPoints(); ++k)
+  {
+    double x[3], y[3];
+    sequential->GetPoint(k, x);
+    parallel->GetPoint(k, y);
+    if (x[0] != y[0] || x[1] != y[1] || x[2] != y[2])
+    {
+      std::cerr << "Different position of pose " << k << std::endl;
+      nbrErrors++;
+    }
+  }
+
+  // the timings are the only arrays which depend on the run
+  vtkPointData* sequentialData = sequential->GetPointData();
+  for (int i = 0; i < sequentialData->GetNumberOfArrays(); ++i)
+  {
+    vtkDataArray* expected = sequentialData->GetArray(i);
+    if (!expected || std::strncmp(expected->GetName(), "Time:", 5) == 0)
+    {
+      continue;
+    }
+    vtkDataArray* array = parallel->GetPointData()->GetArray(expected->GetName());
+    if (!array || array->GetNumberOfTuples() != expected->GetNumberOfTuples() ||
+        array->GetNumberOfComponents() != expected->GetNumberOfComponents())
+    {
+      std::cerr << "Missing or different array " << expected->GetName() << std::endl;
+      nbrErrors++;
+      continue;
+    }
+    for (vtkIdType k = 0; k < expected->GetNumberOfTuples(); ++k)
+    {
+      for (int c = 0; c < expected->GetNumberOfComponents(); ++c)
+      {
+        if (expected->GetComponent(k, c) != array->GetComponent(k, c))
+        {
+          std::cerr << "Different " << expected->GetName() << " of pose " << k << std::endl;
+          nbrErrors++;
+        }
+      }
+    }
+  }
+  return nbrErrors;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: " << argv[0] << " <pcap> <calibration>" << std::endl;
+    return 1;
+  }
+
+  auto reader = vtkSmartPointer<vtkLidarReader>::New();
+  reader->SetInterpreter(vtkSmartPointer<vtkVelodynePacketInterpreter>::New());
+  reader->SetFileName(argv[1]);
+  reader->SetCalibrationFileName(argv[2]);
+  reader->Update();
+  if (reader->GetNumberOfFrames() < NumberOfFrames)
+  {
+    std::cerr << "Not enough frames in " << argv[1] << std::endl;
+    return 1;
+  }
+
+  vtkSmartPointer<vtkPolyData> sequential = RunSlam(reader, 1, false);
+  vtkSmartPointer<vtkPolyData> parallel = RunSlam(reader, 4, true);
+  if (sequential->GetNumberOfPoints() == 0)
+  {
+    std::cerr << "Empty trajectory" << std::endl;
+    return 1;
+  }
+  return CompareTrajectories(sequential, parallel);
+}
@@ -0,0 +1,96 @@
+#include "SlamMapFile.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+//-----------------------------------------------------------------------------
+pcl::PointCloud<SlamMapFile::Point> CreateTile(int numberOfPoints, float offset)
+{
+  pcl::PointCloud<SlamMapFile::Point> cloud;
+  for (int k = 0; k < numberOfPoints; ++k)
+  {
+    SlamMapFile::Point p;
+    p.x = offset + k;
+    p.y = offset - k;
+    p.z = 0.5f * k;
+    p.intensity = static_cast<float>(k % 255);
+    cloud.push_back(p);
+  }
+  return cloud;
+}
+
+//-----------------------------------------------------------------------------
+int CheckTile(SlamMapFile& file, int map, const int index[3], size_t expectedSize, float firstX)
+{
+  pcl::PointCloud<SlamMapFile::Point> cloud;
+  if (!file.ReadTile(map, index, cloud) || cloud.size() != expectedSize ||
+    std::abs(cloud[0].x - firstX) > 1e-6)
+  {
+    std::cerr << "Wrong tile " << map << " (" << index[0] << ", " << index[1] << ", " << index[2]
+              << ") with " << cloud.size() << " points" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestMapFile(const std::string& filename)
+{
+  int nbrErrors = 0;
+  const int first[3] = { -1, 2, 0 };
+  const int second[3] = { 4, -3, 1 };
+  {
+    SlamMapFile file;
+    if (!file.OpenForWriting(filename, 10.0))
+    {
+      std::cerr << file.GetLastError() << std::endl;
+      return 1;
+    }
+    // the first tile is written twice, as if the grid came back to it
+    file.WriteTile(0, first, CreateTile(10, 1.0f));
+    file.WriteTile(1, first, CreateTile(5, 2.0f));
+    file.WriteTile(0, second, CreateTile(3, 3.0f));
+    file.WriteTile(0, first, CreateTile(7, 4.0f));
+    // empty tiles are not written
+    file.WriteTile(2, second, pcl::PointCloud<SlamMapFile::Point>());
+    file.Close();
+  }
+
+  SlamMapFile file;
+  if (!file.OpenForReading(filename))
+  {
+    std::cerr << file.GetLastError() << std::endl;
+    return 1;
+  }
+  if (file.GetTileSize() != 10.0 || file.GetNumberOfTiles() != 3)
+  {
+    std::cerr << "Wrong map file header, " << file.GetNumberOfTiles() << " tiles" << std::endl;
+    nbrErrors++;
+  }
+  nbrErrors += CheckTile(file, 0, first, 17, 1.0f);
+  nbrErrors += CheckTile(file, 1, first, 5, 2.0f);
+  nbrErrors += CheckTile(file, 0, second, 3, 3.0f);
+
+  pcl::PointCloud<SlamMapFile::Point> cloud;
+  if (file.ReadTile(1, second, cloud))
+  {
+    std::cerr << "Missing tile has been read" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Wrong number of arguments" << std::endl;
+    return 1;
+  }
+
+  int nbrErrors = 0;
+  nbrErrors += TestMapFile(argv[1]);
+  return nbrErrors;
+}
@@ -0,0 +1,112 @@
+#include "SlamPoseGraph.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+int TestPoseConversion()
+{
+  int nbrErrors = 0;
+  SlamPoseGraph::Pose pose;
+  pose << 0.1, -0.2, 2.5, 1.0, -3.0, 0.5;
+  const SlamPoseGraph::Pose converted = SlamPoseGraph::FromIsometry(SlamPoseGraph::ToIsometry(pose));
+  if ((converted - pose).norm() > 1e-9)
+  {
+    std::cerr << "Pose conversion is not reversible" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestDescriptorRotation()
+{
+  int nbrErrors = 0;
+  const unsigned int rings = 20, sectors = 60;
+  const double sectorAngle = 2.0 * M_PI / sectors;
+
+  // a point at the center of a cell of each ring, rotated by a whole number of sectors
+  const int rotation = 7;
+  pcl::PointCloud<SlamPoseGraph::Point> cloud, rotated;
+  for (unsigned int k = 0; k < rings; ++k)
+  {
+    const double range = 1.5 + 3.0 * k;
+    const double azimuth = -M_PI + (((k * 13) % sectors) + 0.5) * sectorAngle;
+    SlamPoseGraph::Point p;
+    p.z = 0.1 * k;
+    p.x = range * std::cos(azimuth);
+    p.y = range * std::sin(azimuth);
+    cloud.push_back(p);
+    p.x = range * std::cos(azimuth + rotation * sectorAngle);
+    p.y = range * std::sin(azimuth + rotation * sectorAngle);
+    rotated.push_back(p);
+  }
+
+  const std::vector<unsigned char> first = SlamPoseGraph::ComputeDescriptor(rotated, rings, sectors, 60.0);
+  const std::vector<unsigned char> second = SlamPoseGraph::ComputeDescriptor(cloud, rings, sectors, 60.0);
+  int shift = 0;
+  const double distance = SlamPoseGraph::DescriptorDistance(first, second, sectors, &shift);
+  if (distance > 1e-6 || shift != static_cast<int>(sectors) - rotation)
+  {
+    std::cerr << "Wrong descriptor rotation: " << shift << " distance: " << distance << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestKeyframes()
+{
+  int nbrErrors = 0;
+  SlamPoseGraph graph;
+  SlamPoseGraph::Parameters parameters;
+  parameters.KeyframeDistance = 2.0;
+  graph.SetParameters(parameters);
+
+  // a keyframe every 2 meters along a straight line, which never closes a loop
+  pcl::PointCloud<SlamPoseGraph::Point> keypoints, empty;
+  for (int k = 0; k < 100; ++k)
+  {
+    SlamPoseGraph::Point p;
+    p.x = std::cos(0.1 * k) * (5.0 + k % 7);
+    p.y = std::sin(0.1 * k) * (5.0 + k % 7);
+    p.z = 0.05 * (k % 11);
+    keypoints.push_back(p);
+  }
+  int numberOfKeyframes = 0;
+  for (int frame = 0; frame < 40; ++frame)
+  {
+    SlamPoseGraph::Pose pose = SlamPoseGraph::Pose::Zero();
+    pose(3) = 0.5 * frame;
+    if (graph.AddFrame(0.1 * frame, pose, keypoints, empty))
+    {
+      numberOfKeyframes++;
+    }
+  }
+  graph.Flush();
+
+  std::vector<double> times;
+  std::vector<Eigen::Isometry3d> corrections;
+  if (numberOfKeyframes != 10 || graph.GetNumberOfKeyframes() != 10)
+  {
+    std::cerr << "Wrong number of keyframes: " << numberOfKeyframes << std::endl;
+    nbrErrors++;
+  }
+  if (graph.GetNumberOfLoopClosures() != 0 || graph.GetCorrections(times, corrections))
+  {
+    std::cerr << "Loop closed on a straight line" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestPoseConversion();
+  nbrErrors += TestDescriptorRotation();
+  nbrErrors += TestKeyframes();
+  return nbrErrors;
+}
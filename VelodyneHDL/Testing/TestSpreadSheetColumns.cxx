@@ -0,0 +1,82 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Select some arrays of a frame, which must be shared with the input, then
+// clear the selection which must give all the arrays back.
+
+#include "vtkSpreadSheetColumns.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  const char* names[3] = { "intensity", "laser_id", "timestamp" };
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetNumberOfPoints(10);
+  auto frame = vtkSmartPointer<vtkPolyData>::New();
+  frame->SetPoints(points);
+  for (const char* name : names)
+  {
+    auto array = vtkSmartPointer<vtkDoubleArray>::New();
+    array->SetName(name);
+    array->SetNumberOfTuples(10);
+    frame->GetPointData()->AddArray(array);
+  }
+
+  auto filter = vtkSmartPointer<vtkSpreadSheetColumns>::New();
+  filter->SetInputData(frame);
+  filter->AddColumn("timestamp");
+  filter->AddColumn("intensity");
+  filter->AddColumn("timestamp");
+  filter->Update();
+
+  vtkPolyData* output = vtkPolyData::SafeDownCast(filter->GetOutput());
+  if (!output || filter->GetNumberOfColumns() != 2 || output->GetNumberOfPoints() != 10 ||
+      output->GetPointData()->GetNumberOfArrays() != 2 || output->GetPointData()->GetArray("laser_id"))
+  {
+    std::cerr << "Expected the intensity and timestamp columns" << std::endl;
+    return 1;
+  }
+  if (output->GetPoints() != points || output->GetPointData()->GetArray("intensity") !=
+      frame->GetPointData()->GetArray("intensity"))
+  {
+    std::cerr << "The points and arrays are copied" << std::endl;
+    return 1;
+  }
+  if (frame->GetPointData()->GetNumberOfArrays() != 3)
+  {
+    std::cerr << "The input arrays are modified" << std::endl;
+    return 1;
+  }
+
+  filter->ClearColumns();
+  filter->Update();
+  output = vtkPolyData::SafeDownCast(filter->GetOutput());
+  if (output->GetPointData()->GetNumberOfArrays() != 3)
+  {
+    std::cerr << "Expected all the arrays without column" << std::endl;
+    return 1;
+  }
+  return 0;
+}
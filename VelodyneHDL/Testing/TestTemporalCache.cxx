@@ -0,0 +1,117 @@
+// Copyright 2019 Kitware SAS.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Check that the temporal cache gives the outputs of the time steps already visited
+// without executing the filters before it, and that it computes the next time steps in
+// advance when asked to.
+
+#include <vtkCallbackCommand.h>
+#include <vtkDoubleArray.h>
+#include <vtkGeometryFilter.h>
+#include <vtkInformation.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkStreamingDemandDrivenPipeline.h>
+#include <vtkTemporalCache.h>
+#include <vtkTimeSourceExample.h>
+
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+void CountExecution(vtkObject*, unsigned long, void* clientData, void*)
+{
+  (*static_cast<int*>(clientData))++;
+}
+
+//-----------------------------------------------------------------------------
+// Update the cache at a time step, and check its output and the number of executions of
+// the filter before it
+int CheckTimeStep(vtkTemporalCache* cache, int timeIndex, int& executions,
+  int expectedExecutions)
+{
+  vtkInformation* outInfo = cache->GetOutputInformation(0);
+  const double* timeSteps = outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  const double time = timeSteps[timeIndex];
+  outInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEP(), time);
+  executions = 0;
+  cache->Update();
+
+  int nbrErrors = 0;
+  if (executions != expectedExecutions)
+  {
+    std::cerr << "Time step " << timeIndex << ": " << executions << " executions of the input, "
+              << expectedExecutions << " expected" << std::endl;
+    nbrErrors++;
+  }
+
+  // vtkTimeSourceExample gives the value sin(2 * pi * t) to the points at time t
+  vtkPolyData* output = vtkPolyData::SafeDownCast(cache->GetOutputDataObject(0));
+  vtkDataArray* values = output ? output->GetPointData()->GetArray("Point Value") : nullptr;
+  if (!values || std::abs(values->GetTuple1(0) - std::sin(2 * vtkMath::Pi() * time)) > 1e-9)
+  {
+    std::cerr << "Time step " << timeIndex << ": wrong output" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  auto source = vtkSmartPointer<vtkTimeSourceExample>::New();
+  auto geometry = vtkSmartPointer<vtkGeometryFilter>::New();
+  auto cache = vtkSmartPointer<vtkTemporalCache>::New();
+  geometry->SetInputConnection(source->GetOutputPort());
+  cache->SetInputConnection(geometry->GetOutputPort());
+
+  int executions = 0;
+  auto counter = vtkSmartPointer<vtkCallbackCommand>::New();
+  counter->SetCallback(CountExecution);
+  counter->SetClientData(&executions);
+  geometry->AddObserver(vtkCommand::EndEvent, counter);
+  cache->UpdateInformation();
+
+  int nbrErrors = 0;
+  // the first visits execute the input, going back does not
+  nbrErrors += CheckTimeStep(cache, 0, executions, 1);
+  nbrErrors += CheckTimeStep(cache, 1, executions, 1);
+  nbrErrors += CheckTimeStep(cache, 2, executions, 1);
+  nbrErrors += CheckTimeStep(cache, 0, executions, 0);
+  nbrErrors += CheckTimeStep(cache, 1, executions, 0);
+  if (cache->GetCacheHits() != 2 || cache->GetCacheMisses() != 3)
+  {
+    std::cerr << "Wrong statistics: " << cache->GetCacheHits() << " hits, "
+              << cache->GetCacheMisses() << " misses" << std::endl;
+    nbrErrors++;
+  }
+
+  // the time moves forward, so the time steps 4 to 6 are computed with the time step 3
+  cache->SetPrecomputeFrames(3);
+  nbrErrors += CheckTimeStep(cache, 3, executions, 4);
+  cache->SetPrecomputeFrames(0);
+  nbrErrors += CheckTimeStep(cache, 4, executions, 0);
+  nbrErrors += CheckTimeStep(cache, 6, executions, 0);
+
+  // the outputs are discarded when the input is modified
+  geometry->Modified();
+  nbrErrors += CheckTimeStep(cache, 6, executions, 1);
+  nbrErrors += CheckTimeStep(cache, 4, executions, 1);
+  return nbrErrors;
+}
@@ -0,0 +1,140 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Compare the bulk operations of vtkTemporalTransforms, done on the views of
+// the arrays, with the same operations done with vtkTransform on each pose.
+
+#include "vtkTemporalTransforms.h"
+
+#include <vtkCellArray.h>
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+bool CompareTransforms(vtkTransform* a, vtkTransform* b, double epsilon)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    for (int j = 0; j < 4; ++j)
+    {
+      if (std::abs(a->GetMatrix()->GetElement(i, j) - b->GetMatrix()->GetElement(i, j)) > epsilon)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> distribution(-1., 1.);
+  auto poses = vtkSmartPointer<vtkTemporalTransforms>::New();
+  const int numberOfPoses = 100;
+  for (int i = 0; i < numberOfPoses; ++i)
+  {
+    Eigen::Vector3d axis(distribution(generator), distribution(generator), distribution(generator));
+    Eigen::Vector3d translation(distribution(generator), distribution(generator), distribution(generator));
+    poses->PushBack(0.1 * i, Eigen::AngleAxisd(3. * distribution(generator), axis.normalized()), 10. * translation);
+  }
+
+  int errors = 0;
+  if (poses->GetLines()->GetNumberOfCells() != 1 ||
+      poses->GetLines()->GetNumberOfConnectivityEntries() != numberOfPoses + 1)
+  {
+    std::cerr << "The polyline does not go through all the poses" << std::endl;
+    errors++;
+  }
+
+  auto H = vtkSmartPointer<vtkTransform>::New();
+  H->PostMultiply();
+  H->RotateX(20.);
+  H->RotateY(-35.);
+  H->RotateZ(70.);
+  H->Translate(1., -2., 3.);
+
+  auto original = poses->Subsample(1);
+  auto isometric = poses->IsometricTransform(H);
+  auto cycloidic = poses->CycloidicTransform(H);
+  auto scaled = poses->ApplyScale(2.);
+  auto shifted = poses->ApplyTimeshift(5.);
+  for (int i = 0; i < numberOfPoses; ++i)
+  {
+    auto pose = poses->GetTransform(i);
+
+    // Rout = R0 * Rin, Tout = R0 * Tin + T0
+    auto expected = vtkSmartPointer<vtkTransform>::New();
+    expected->PostMultiply();
+    expected->Concatenate(pose);
+    expected->Concatenate(H);
+    if (!CompareTransforms(isometric->GetTransform(i), expected, 1e-9))
+    {
+      std::cerr << "Wrong isometric transform of pose " << i << std::endl;
+      errors++;
+    }
+
+    // Rout = Rin * R0, Tout = Rin * T0 + Tin
+    expected->Identity();
+    expected->Concatenate(H);
+    expected->Concatenate(pose);
+    if (!CompareTransforms(cycloidic->GetTransform(i), expected, 1e-9))
+    {
+      std::cerr << "Wrong cycloidic transform of pose " << i << std::endl;
+      errors++;
+    }
+
+    if ((scaled->GetTranslations().col(i) - 2. * poses->GetTranslations().col(i)).norm() > 1e-12 ||
+        std::abs(shifted->GetTimes()(i) - 5. - 0.1 * i) > 1e-12)
+    {
+      std::cerr << "Wrong scale or time shift of pose " << i << std::endl;
+      errors++;
+    }
+  }
+
+  // the operations which return a new object must not modify the input
+  for (int i = 0; i < numberOfPoses; ++i)
+  {
+    if (poses->GetTimes()(i) != original->GetTimes()(i) ||
+        !CompareTransforms(poses->GetTransform(i), original->GetTransform(i), 0.))
+    {
+      std::cerr << "The input pose " << i << " has been modified" << std::endl;
+      errors++;
+    }
+  }
+
+  auto subsampled = poses->Subsample(3);
+  auto extracted = poses->ExtractTimes(1.05, 2.05);
+  if (subsampled->GetNumberOfPoints() != 34 || extracted->GetNumberOfPoints() != 10 ||
+      subsampled->GetTimes()(2) != poses->GetTimes()(6) ||
+      extracted->GetTranslations().col(0) != poses->GetTranslations().col(11))
+  {
+    std::cerr << "Wrong subsampled or extracted poses" << std::endl;
+    errors++;
+  }
+
+  return errors;
+}
@@ -6,6 +6,7 @@
 #include <stdio.h>
 
 #include "vtkPolyData.h"
+#include "vtkTemporalTransforms.h"
 
 #include "TestHelpers.h"
 
@@ -67,6 +68,45 @@ bool read_write_trajectory(char* to_read, char* to_write)
   return 1;
 }
 
+bool read_write_binary_trajectory(char* to_read, const std::string& to_write)
+{
+  auto reader = vtkSmartPointer<vtkTemporalTransformsReader>::New();
+  reader->SetFileName(to_read);
+  reader->Update();
+
+  auto writer = vtkSmartPointer<vtkTemporalTransformsWriter>::New();
+  writer->SetInputConnection(0, reader->GetOutputPort());
+  writer->SetFileName(to_write.c_str());
+  writer->Update();
+
+  // the binary trajectory is read as written
+  auto expected = vtkTemporalTransforms::CreateFromPolyData(reader->GetOutput());
+  auto read = vtkTemporalTransformsReader::OpenTemporalTransforms(to_write);
+  bool allgood = read && read->GetNumberOfPoints() == expected->GetNumberOfPoints()
+                      && read->GetNumberOfCells() == 1;
+  for (vtkIdType i = 0; allgood && i < read->GetNumberOfPoints(); ++i)
+  {
+    allgood &= read->GetTimeArray()->GetTuple1(i) == expected->GetTimeArray()->GetTuple1(i);
+    allgood &= compare(read->GetTranslationArray()->GetTuple3(i), expected->GetTranslationArray()->GetTuple3(i), 3, epsilon);
+    allgood &= compare(read->GetOrientationArray()->GetTuple4(i), expected->GetOrientationArray()->GetTuple4(i), 4, epsilon);
+  }
+  if (!allgood)
+  {
+    return false;
+  }
+
+  // a time window gives the same transforms as ExtractTimes
+  auto extracted = expected->ExtractTimes(50., 100.);
+  auto window = vtkTemporalTransformsReader::OpenTemporalTransforms(to_write, 50., 100.);
+  allgood &= window && extracted->GetNumberOfPoints() > 0
+                    && window->GetNumberOfPoints() == extracted->GetNumberOfPoints();
+  for (vtkIdType i = 0; allgood && i < window->GetNumberOfPoints(); ++i)
+  {
+    allgood &= window->GetTimeArray()->GetTuple1(i) == extracted->GetTimeArray()->GetTuple1(i);
+  }
+  return allgood;
+}
+
 int main(int argc, char* argv[])
 {
   if (argc != 3)
@@ -124,5 +164,15 @@ int main(int argc, char* argv[])
     return 1;
   }
 
+  // Then test the binary format
+  const std::string binaryFile = std::string(temporaryFile) + ".tposes";
+  if (! read_write_binary_trajectory(referenceTrajectory, binaryFile))
+  {
+    std::cout << "Reading binary trajectory written using vtkTemporalTransformsWriter"
+                 " does not seem to work" << std::endl;
+    return 1;
+  }
+  std::remove(binaryFile.c_str());
+
   return 0;
 }
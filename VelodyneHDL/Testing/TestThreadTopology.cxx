@@ -0,0 +1,132 @@
+// Check the parsing of the thread placement and its application to a thread
+#include "ThreadTopology.h"
+
+#include <boost/thread/thread.hpp>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <iostream>
+#include <vector>
+
+//-----------------------------------------------------------------------------
+int TestCpuList()
+{
+  int nbrErrors = 0;
+  std::vector<int> cpus;
+  if (!ThreadTopology::ParseCpuList(" 6, 0-3,2 ", cpus) || cpus.size() != 5 || cpus[0] != 0 ||
+    cpus[4] != 6 || ThreadTopology::FormatCpuList(cpus) != "0-3,6")
+  {
+    std::cerr << "Wrong list of cores: " << ThreadTopology::FormatCpuList(cpus) << std::endl;
+    nbrErrors++;
+  }
+  const char* invalidLists[] = { "3-1", "-1", "a", "1,,2", "1-" };
+  for (const char* list : invalidLists)
+  {
+    if (ThreadTopology::ParseCpuList(list, cpus))
+    {
+      std::cerr << "Invalid list of cores accepted: " << list << std::endl;
+      nbrErrors++;
+    }
+  }
+  if (!ThreadTopology::ParseCpuList("", cpus) || !cpus.empty())
+  {
+    std::cerr << "Empty list of cores not accepted" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestConfiguration()
+{
+  int nbrErrors = 0;
+  const std::string configuration =
+    "receive:cpus=0,2-3,priority=50,pool=2;decode:cpus=4-7,numa=0;render:cpus=1";
+  if (!ThreadTopology::SetConfiguration(configuration) ||
+    ThreadTopology::GetCpus(ThreadTopology::RECEIVE) != "0,2-3" ||
+    ThreadTopology::GetPriority(ThreadTopology::RECEIVE) != 50 ||
+    ThreadTopology::GetPoolSize(ThreadTopology::RECEIVE) != 2 ||
+    ThreadTopology::GetNumaNode(ThreadTopology::DECODE) != 0 ||
+    ThreadTopology::GetCpus(ThreadTopology::RECORD) != "")
+  {
+    std::cerr << "Configuration not read: " << ThreadTopology::GetConfiguration() << std::endl;
+    nbrErrors++;
+  }
+  if (ThreadTopology::GetConfiguration() != configuration)
+  {
+    std::cerr << "Configuration not written back: " << ThreadTopology::GetConfiguration()
+              << std::endl;
+    nbrErrors++;
+  }
+
+  // an invalid line leaves the placement unchanged
+  const char* invalidConfigurations[] = { "sound:cpus=1", "decode:cpus=1,speed=2",
+    "decode:priority=100", "decode:1" };
+  for (const char* invalid : invalidConfigurations)
+  {
+    if (ThreadTopology::SetConfiguration(invalid) ||
+      ThreadTopology::GetConfiguration() != configuration)
+    {
+      std::cerr << "Invalid configuration accepted: " << invalid << std::endl;
+      nbrErrors++;
+    }
+  }
+
+  if (!ThreadTopology::SetConfiguration("") || !ThreadTopology::GetConfiguration().empty())
+  {
+    std::cerr << "Placement not reset" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestApply()
+{
+  int nbrErrors = 0;
+#ifdef __linux__
+  // pin a thread on the last core the test may use, then let it run anywhere again
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  int lastCpu = 0;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+  {
+    lastCpu = CPU_ISSET(cpu, &allowed) ? cpu : lastCpu;
+  }
+  ThreadTopology::SetCpus(ThreadTopology::RECORD, std::to_string(lastCpu));
+
+  int numberOfPinnedCpus = 0;
+  int numberOfFreedCpus = 0;
+  boost::thread thread([&]() {
+    cpu_set_t cpus;
+    ThreadTopology::ApplyToCurrentThread(ThreadTopology::RECORD);
+    sched_getaffinity(0, sizeof(cpus), &cpus);
+    numberOfPinnedCpus = CPU_ISSET(lastCpu, &cpus) ? CPU_COUNT(&cpus) : 0;
+    ThreadTopology::ApplyToCurrentThread(ThreadTopology::FORWARD);
+    sched_getaffinity(0, sizeof(cpus), &cpus);
+    numberOfFreedCpus = CPU_COUNT(&cpus);
+  });
+  thread.join();
+  if (numberOfPinnedCpus != 1 || numberOfFreedCpus != CPU_COUNT(&allowed))
+  {
+    std::cerr << "Cores not applied, pinned on " << numberOfPinnedCpus << ", then on "
+              << numberOfFreedCpus << std::endl;
+    nbrErrors++;
+  }
+  ThreadTopology::SetCpus(ThreadTopology::RECORD, "");
+#endif
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main()
+{
+  int nbrErrors = 0;
+  nbrErrors += TestCpuList();
+  nbrErrors += TestConfiguration();
+  nbrErrors += TestApply();
+  return nbrErrors;
+}
@@ -0,0 +1,150 @@
+#include "LidarFrameDetector.h"
+#include "PacketBuffer.h"
+#include "TimeShiftBuffer.h"
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+const double StartTime = 1.5e9;
+const double PacketInterval = 0.1;
+const int PacketsPerFrame = 10;
+const int NumberOfPackets = 200;
+
+//-----------------------------------------------------------------------------
+//! The packets are numbered, a frame starts with each multiple of PacketsPerFrame
+class NumberedFrameDetector : public LidarFrameDetector
+{
+public:
+  bool IsLidarPacket(unsigned char const*, unsigned int dataLength) override
+  {
+    return dataLength == sizeof(boost::uint32_t);
+  }
+
+  void DetectFrame(
+    unsigned char const* data, unsigned int, std::vector<Split>& splits) override
+  {
+    splits.clear();
+    boost::uint32_t number = 0;
+    std::memcpy(&number, data, sizeof(number));
+    if (number % PacketsPerFrame == 0)
+    {
+      Split split = { 0, true };
+      splits.push_back(split);
+    }
+  }
+
+  bool HasContent() override { return true; }
+
+  void ResetContent() override {}
+};
+
+//-----------------------------------------------------------------------------
+//! Numbers of the packets of a pcap file written by vtkPacketFileWriter
+std::vector<boost::uint32_t> ReadPacketNumbers(const std::string& filename)
+{
+  std::vector<boost::uint32_t> numbers;
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  boost::uint32_t magic = 0;
+  if (!file.read(reinterpret_cast<char*>(&magic), sizeof(magic)) || magic != 0xa1b2c3d4)
+  {
+    return numbers;
+  }
+  file.seekg(24, std::ios::beg);
+  boost::uint32_t record[4];
+  while (file.read(reinterpret_cast<char*>(record), sizeof(record)))
+  {
+    std::vector<char> packet(record[2]);
+    boost::uint32_t number = 0;
+    if (!file.read(packet.data(), packet.size()) || packet.size() != 42 + sizeof(number))
+    {
+      break;
+    }
+    std::memcpy(&number, packet.data() + 42, sizeof(number));
+    numbers.push_back(number);
+  }
+  return numbers;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  const std::string directory = "TestTimeShiftBuffer";
+  boost::filesystem::remove_all(directory);
+
+  // 20 seconds of packets, in segments of 2 seconds of which 5 seconds are kept
+  TimeShiftBuffer buffer;
+  buffer.SetDuration(5.);
+  buffer.SetSegmentDuration(2.);
+  if (!buffer.Start(directory, new NumberedFrameDetector))
+  {
+    std::cerr << "Cannot start the buffer" << std::endl;
+    return 1;
+  }
+  PacketBufferPool pool(NumberOfPackets);
+  std::vector<PacketBufferPointer> packets;
+  for (int i = 0; i < NumberOfPackets; ++i)
+  {
+    PacketBufferPointer packet = pool.Acquire();
+    const boost::uint32_t number = static_cast<boost::uint32_t>(i);
+    std::memcpy(packet->GetData(), &number, sizeof(number));
+    packet->SetSize(sizeof(number));
+    packet->SetArrivalTime(static_cast<boost::int64_t>((StartTime + i * PacketInterval) * 1e9),
+      PacketBuffer::SoftwareTimestamp);
+    packets.push_back(packet);
+  }
+  buffer.Enqueue(packets);
+  packets.clear();
+  buffer.Stop();
+
+  // the segment being written and the ones starting in the last 5 seconds are kept
+  int numberOfSegments = 0;
+  for (boost::filesystem::directory_iterator it(directory), end; it != end; ++it)
+  {
+    numberOfSegments++;
+  }
+  const std::vector<double> times = buffer.GetFrameTimes();
+  const double lastTime = StartTime + (NumberOfPackets - PacketsPerFrame) * PacketInterval;
+  if (numberOfSegments != 4 || times.empty() || std::abs(times.back() - lastTime) > 1e-3 ||
+    lastTime - times.front() > 8. || lastTime - times.front() < 5.)
+  {
+    std::cerr << numberOfSegments << " segments, " << times.size() << " frames kept" << std::endl;
+    nbrErrors++;
+  }
+
+  // a window spanning two segments, from the frame of the packet 140 to the one of the
+  // packet 170, completed by the packet 180 where the next frame starts
+  const std::string windowFileName = directory + "/window.pcap";
+  std::string error;
+  if (!buffer.SaveWindow(StartTime + 13.95, StartTime + 17.05, windowFileName, error))
+  {
+    std::cerr << "Cannot save the window: " << error << std::endl;
+    nbrErrors++;
+  }
+  const std::vector<boost::uint32_t> numbers = ReadPacketNumbers(windowFileName);
+  if (numbers.size() != 41 || numbers.front() != 140 || numbers.back() != 180)
+  {
+    std::cerr << "Wrong window of " << numbers.size() << " packets" << std::endl;
+    nbrErrors++;
+  }
+
+  // the frames which have been deleted cannot be saved
+  if (buffer.SaveWindow(StartTime, StartTime + 5., windowFileName, error))
+  {
+    std::cerr << "Window of deleted frames saved" << std::endl;
+    nbrErrors++;
+  }
+
+  boost::filesystem::remove_all(directory);
+  return nbrErrors;
+}
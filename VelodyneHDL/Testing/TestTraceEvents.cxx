@@ -0,0 +1,104 @@
+// Record scopes on several threads and check the trace written, in the Chrome trace
+// event format.
+
+#include "TraceEvents.h"
+
+#include <boost/thread/thread.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+size_t CountOccurrences(const std::string& text, const std::string& pattern)
+{
+  size_t count = 0;
+  for (size_t position = text.find(pattern); position != std::string::npos;
+       position = text.find(pattern, position + pattern.size()))
+  {
+    count++;
+  }
+  return count;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: TestTraceEvents <trace.json>" << std::endl;
+    return 1;
+  }
+  int nbrErrors = 0;
+
+  // the scopes are not recorded while the tracing is disabled
+  TraceEvents::SetEnabled(false);
+  {
+    VV_TRACE_SCOPE("Disabled");
+  }
+
+  TraceEvents::SetEnabled(true);
+  boost::thread_group threads;
+  for (int i = 0; i < 4; ++i)
+  {
+    threads.create_thread([]() {
+      for (int j = 0; j < 10; ++j)
+      {
+        VV_TRACE_SCOPE("Outer");
+        {
+          VV_TRACE_SCOPE("Inner");
+        }
+      }
+    });
+  }
+  threads.join_all();
+  TraceEvents::SetEnabled(false);
+
+  if (!TraceEvents::Write(argv[1]))
+  {
+    std::cerr << "Cannot write " << argv[1] << std::endl;
+    return 1;
+  }
+  std::ifstream file(argv[1]);
+  std::stringstream content;
+  content << file.rdbuf();
+  const std::string trace = content.str();
+
+  if (CountOccurrences(trace, "\"Disabled\"") != 0)
+  {
+    std::cerr << "A scope has been recorded while the tracing was disabled" << std::endl;
+    nbrErrors++;
+  }
+  if (CountOccurrences(trace, "\"Outer\"") != 40 || CountOccurrences(trace, "\"Inner\"") != 40)
+  {
+    std::cerr << "Wrong number of scopes in the trace" << std::endl;
+    nbrErrors++;
+  }
+  for (int thread = 1; thread <= 4; ++thread)
+  {
+    std::ostringstream tid;
+    tid << "\"tid\": " << thread << ",";
+    if (CountOccurrences(trace, tid.str()) != 20)
+    {
+      std::cerr << "Wrong number of scopes for thread " << thread << std::endl;
+      nbrErrors++;
+    }
+  }
+
+  TraceEvents::Clear();
+  TraceEvents::Write(argv[1]);
+  std::ifstream clearedFile(argv[1]);
+  std::stringstream clearedContent;
+  clearedContent << clearedFile.rdbuf();
+  if (CountOccurrences(clearedContent.str(), "\"ph\"") != 0)
+  {
+    std::cerr << "The scopes are kept after Clear" << std::endl;
+    nbrErrors++;
+  }
+
+  return nbrErrors;
+}
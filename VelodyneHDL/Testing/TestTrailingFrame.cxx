@@ -1,5 +1,7 @@
+#include <vtkCellArray.h>
 #include <vtkDoubleArray.h>
 #include <vtkGeometryFilter.h>
+#include <vtkIdList.h>
 #include <vtkInformation.h>
 #include <vtkMultiBlockDataSet.h>
 #include <vtkPointData.h>
@@ -73,6 +75,50 @@ bool check_multi_block_frames(vtkMultiBlockDataSet* multiblock, std::vector<doub
 }
 
 
+bool check_merged_frames(vtkPolyData* merged, std::vector<double> const& times)
+{
+    // this functions checks that each point of the merged frames vertices has the
+    // value of one of the trailing frames, and that each trailing frame has points
+    std::vector<bool> found(times.size(), false);
+    auto array = vtkDoubleArray::SafeDownCast(merged->GetPointData()->GetArray("Point Value"));
+    auto point_ids = vtkSmartPointer<vtkIdList>::New();
+    vtkCellArray* vertices = merged->GetVerts();
+    vertices->InitTraversal();
+    while (array && vertices->GetNextCell(point_ids))
+    {
+        for (vtkIdType k = 0; k < point_ids->GetNumberOfIds(); ++k)
+        {
+            double value = array->GetValue(point_ids->GetId(k));
+            bool is_trailing_value = false;
+            for (int i = 0; i < times.size(); ++i)
+            {
+                if (times[i] != -1.0 && std::abs(value - value_fonction(times[i])) < epsilon)
+                {
+                    is_trailing_value = true;
+                    found[i] = true;
+                }
+            }
+            if (!is_trailing_value)
+            {
+                std::cerr << "Merged frames test failed: \n";
+                std::cerr << "Unexpected value " << value << "\n";
+                return false;
+            }
+        }
+    }
+    for (int i = 0; i < times.size(); ++i)
+    {
+        if (times[i] != -1.0 && !found[i])
+        {
+            std::cerr << "Merged frames test failed: \n";
+            std::cerr << "Missing frame " << i << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+
 bool check_trailing_frames(vtkTrailingFrame* tf, vtkInformation* info, double *time_steps, int time_index)
 {
     int nb_trailing_frames = tf->GetNumberOfTrailingFrames();
@@ -86,8 +132,9 @@ bool check_trailing_frames(vtkTrailingFrame* tf, vtkInformation* info, double *t
     {
         sub_time_steps[i] = time_steps[time_index - i];
     }
-    // check the constructed multiblock
-    return check_multi_block_frames(tf_out, sub_time_steps);
+    // check the constructed multiblock and the merged frames
+    return check_multi_block_frames(tf_out, sub_time_steps) &&
+           check_merged_frames(vtkPolyData::SafeDownCast(tf->GetOutputDataObject(1)), sub_time_steps);
 }
 
 
@@ -108,6 +155,7 @@ int main(int argc, char* argv[])
     int const N1 = 2;
     int const N2 = 4;
     tf->SetNumberOfTrailingFrames(N1);
+    tf->SetMergeFrames(true);
 
     // get available time steps
     tf->UpdateInformation();
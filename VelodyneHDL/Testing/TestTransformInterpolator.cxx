@@ -0,0 +1,120 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Compare the raw interpolation of the transforms, at increasing times, at
+// random times and by arrays of times, with the vtkTransform interpolation.
+
+#include "vtkVelodyneTransformInterpolator.h"
+
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+int CompareMatrix(vtkTransform* transform, const double matrix[16], double t, const char* name)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    for (int j = 0; j < 4; ++j)
+    {
+      if (std::abs(transform->GetMatrix()->GetElement(i, j) - matrix[4 * i + j]) > 1e-9)
+      {
+        std::cerr << name << ": the matrices differ at time " << t << std::endl;
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int TestInterpolationType(int type, const char* name)
+{
+  std::mt19937 generator(type);
+  std::uniform_real_distribution<double> distribution(-1., 1.);
+  auto interpolator = vtkSmartPointer<vtkVelodyneTransformInterpolator>::New();
+  interpolator->SetInterpolationType(type);
+  for (int i = 0; i < 50; ++i)
+  {
+    auto transform = vtkSmartPointer<vtkTransform>::New();
+    transform->Translate(10. * distribution(generator), 10. * distribution(generator), distribution(generator));
+    transform->RotateWXYZ(180. * distribution(generator), distribution(generator),
+                          distribution(generator), 1.);
+    interpolator->AddTransform(0.1 * i + 0.05 * distribution(generator), transform);
+  }
+
+  // increasing times, including the transform times and the bounds
+  std::vector<double> times;
+  for (int i = 0; i <= 1000; ++i)
+  {
+    times.push_back(interpolator->GetMinimumT() + i * (interpolator->GetMaximumT() - interpolator->GetMinimumT()) / 1000.);
+  }
+  for (int i = 0; i < 200; ++i)
+  {
+    times.push_back(interpolator->GetMinimumT() + (interpolator->GetMaximumT() - interpolator->GetMinimumT()) *
+                    0.5 * (distribution(generator) + 1.));
+  }
+
+  auto transform = vtkSmartPointer<vtkTransform>::New();
+  std::vector<double> matrices(16 * times.size());
+  interpolator->InterpolateTransformMatrices(times.data(), static_cast<vtkIdType>(times.size()), matrices.data());
+  for (size_t i = 0; i < times.size(); ++i)
+  {
+    interpolator->InterpolateTransform(times[i], transform);
+    double matrix[16];
+    interpolator->InterpolateTransformMatrix(times[i], matrix);
+    if (CompareMatrix(transform, matrix, times[i], name) || CompareMatrix(transform, &matrices[16 * i], times[i], name))
+    {
+      return 1;
+    }
+
+    // the quaternion is the rotation of the matrix
+    double quaternion[4], translation[3];
+    interpolator->InterpolateTransform(times[i], quaternion, translation);
+    double position[3];
+    transform->GetPosition(position);
+    const double norm = std::sqrt(quaternion[0] * quaternion[0] + quaternion[1] * quaternion[1] +
+                                  quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3]);
+    if (std::abs(norm - 1.) > 1e-9 || std::abs(translation[0] - position[0]) > 1e-9 ||
+        std::abs(translation[1] - position[1]) > 1e-9 || std::abs(translation[2] - position[2]) > 1e-9 ||
+        std::abs(1. - 2. * (quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3]) - matrix[0]) > 1e-9)
+    {
+      std::cerr << name << ": wrong quaternion or translation at time " << times[i] << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  return TestInterpolationType(vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_LINEAR, "Linear") +
+    TestInterpolationType(vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_SPLINE, "Spline") +
+    TestInterpolationType(vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_NEAREST, "Nearest") +
+    TestInterpolationType(vtkVelodyneTransformInterpolator::INTERPOLATION_TYPE_NEAREST_LOW_BOUNDED,
+                          "Nearest low bounded");
+}
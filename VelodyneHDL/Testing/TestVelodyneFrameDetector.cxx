@@ -0,0 +1,167 @@
+#include "VelodyneFrameDetector.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace DataPacketFixedLength;
+
+//-----------------------------------------------------------------------------
+// Create a VLP-16 packet whose blocks start at the given azimuth, in hundredths of degree
+std::vector<unsigned char> CreatePacket(int firstAzimuth, int azimuthStep, bool withReturns)
+{
+  std::vector<unsigned char> data(HDLDataPacket::getDataByteLength(), 0);
+  HDLDataPacket* packet = reinterpret_cast<HDLDataPacket*>(data.data());
+  for (int i = 0; i < HDL_FIRING_PER_PKT; ++i)
+  {
+    HDLFiringData& firingData = packet->firingData[i];
+    firingData.blockIdentifier = BLOCK_0_TO_31;
+    firingData.rotationalPosition = (firstAzimuth + i * azimuthStep) % 36000;
+    if (withReturns)
+    {
+      firingData.laserReturns[HDL_LASER_PER_FIRING - 1].distance = 1000;
+    }
+  }
+  packet->factoryField1 = STRONGEST_RETURN;
+  packet->factoryField2 = VLP16;
+  return data;
+}
+
+//-----------------------------------------------------------------------------
+int TestSplits()
+{
+  int nbrErrors = 0;
+  VelodyneFrameDetector detector(false);
+  std::vector<LidarFrameDetector::Split> splits;
+
+  // the azimuth wraps in the 5th block of the second packet
+  std::vector<unsigned char> first = CreatePacket(35000, 40, true);
+  std::vector<unsigned char> second = CreatePacket(35800, 40, true);
+  if (!detector.IsLidarPacket(first.data(), first.size()) ||
+    detector.IsLidarPacket(first.data(), 512))
+  {
+    std::cerr << "Wrong packet size check" << std::endl;
+    nbrErrors++;
+  }
+
+  detector.DetectFrame(first.data(), first.size(), splits);
+  if (!splits.empty())
+  {
+    std::cerr << "Split found without azimuth wrap" << std::endl;
+    nbrErrors++;
+  }
+
+  // a copy of the detector must find the same splits
+  VelodyneFrameDetector copy = detector;
+  std::vector<LidarFrameDetector::Split> copySplits;
+  detector.DetectFrame(second.data(), second.size(), splits);
+  copy.DetectFrame(second.data(), second.size(), copySplits);
+  if (splits.size() != 1 || splits[0].PositionInPacket != 5 || !splits[0].HasContent)
+  {
+    std::cerr << "Split not found at the azimuth wrap" << std::endl;
+    nbrErrors++;
+  }
+  if (copySplits.size() != splits.size() ||
+    (!splits.empty() && copySplits[0].PositionInPacket != splits[0].PositionInPacket))
+  {
+    std::cerr << "Copied detector does not give the same splits" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestContent()
+{
+  int nbrErrors = 0;
+  std::vector<LidarFrameDetector::Split> splits;
+  std::vector<unsigned char> empty = CreatePacket(35000, 50, false);
+  std::vector<unsigned char> wrap = CreatePacket(35900, 100, false);
+
+  // frames without returns are reported as empty only when the zero distances are ignored
+  for (int ignoreZeroDistances = 0; ignoreZeroDistances < 2; ++ignoreZeroDistances)
+  {
+    VelodyneFrameDetector detector(ignoreZeroDistances != 0);
+    detector.DetectFrame(empty.data(), empty.size(), splits);
+    detector.DetectFrame(wrap.data(), wrap.size(), splits);
+    if (splits.size() != 1 || splits[0].HasContent == (ignoreZeroDistances != 0))
+    {
+      std::cerr << "Wrong content of the frame, IgnoreZeroDistances: " << ignoreZeroDistances
+                << std::endl;
+      nbrErrors++;
+    }
+  }
+
+  VelodyneFrameDetector detector(true);
+  std::vector<unsigned char> full = CreatePacket(100, 100, true);
+  detector.DetectFrame(full.data(), full.size(), splits);
+  if (!detector.HasContent())
+  {
+    std::cerr << "Returns not detected" << std::endl;
+    nbrErrors++;
+  }
+  detector.ResetContent();
+  if (detector.HasContent())
+  {
+    std::cerr << "Content not reset" << std::endl;
+    nbrErrors++;
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestThroughput()
+{
+  int nbrErrors = 0;
+  // about 1400 rotations of a VLP-16 at 600 rpm
+  const int numberOfPackets = 1 << 20;
+  const int packetsPerRotation = 754;
+  std::vector<std::vector<unsigned char> > packets;
+  for (int i = 0; i < packetsPerRotation; ++i)
+  {
+    packets.push_back(CreatePacket((i * 36000) / packetsPerRotation, 4, true));
+  }
+
+  VelodyneFrameDetector detector(true);
+  std::vector<LidarFrameDetector::Split> splits;
+  int numberOfSplits = 0;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+  for (int i = 0; i < numberOfPackets; ++i)
+  {
+    const std::vector<unsigned char>& packet = packets[i % packetsPerRotation];
+    detector.DetectFrame(packet.data(), packet.size(), splits);
+    numberOfSplits += static_cast<int>(splits.size());
+  }
+  const double seconds =
+    (boost::posix_time::microsec_clock::local_time() - start).total_microseconds() * 1e-6;
+  const double packetsPerSecond = numberOfPackets / std::max(seconds, 1e-6);
+  std::cout << "Frame detection: " << packetsPerSecond << " packets/s" << std::endl;
+
+  if (numberOfSplits != numberOfPackets / packetsPerRotation)
+  {
+    std::cerr << "Wrong number of frames: " << numberOfSplits << std::endl;
+    nbrErrors++;
+  }
+#ifdef NDEBUG
+  // the timing of a debug build is meaningless
+  if (packetsPerSecond < 1e6)
+  {
+    std::cerr << "Frame detection is too slow" << std::endl;
+    nbrErrors++;
+  }
+#endif
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  int nbrErrors = 0;
+  nbrErrors += TestSplits();
+  nbrErrors += TestContent();
+  nbrErrors += TestThroughput();
+  return nbrErrors;
+}
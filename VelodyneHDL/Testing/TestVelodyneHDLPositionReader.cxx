@@ -1,5 +1,8 @@
+#include "vtkLidarReader.h"
 #include "vtkVelodyneHDLPositionReader.h"
+#include "vtkVelodynePacketInterpreter.h"
 #include "vtkVelodyneTransformInterpolator.h"
+#include "vtkNew.h"
 #include "vtkPointData.h"
 #include "vtkTransform.h"
 
@@ -211,28 +214,8 @@ bool test_point_arrays(vtkSmartPointer<vtkVelodyneHDLPositionReader> reader,
   return isvalid;
 }
 
-int main(int argc, char* argv[])
+bool test_reader(vtkSmartPointer<vtkVelodyneHDLPositionReader> reader)
 {
-  if (argc != 2)
-  {
-    std::cerr << "Wrong number of arguments. Usage: "
-              << argv[0]
-              << "<path to "
-              << "\"HDL32-V2_R into Butterfield into Digital Drive.pcap\""
-              << "(from data.kitware.com,"
-              << "sha1sum: 1edb06c8c4312cb259dd0417a226c235945ff5b6) >"
-              << std::endl;
-    return 1;
-  }
-
-  std::string pathToPcap = std::string(argv[1]);
-
-  vtkSmartPointer<vtkVelodyneHDLPositionReader> reader =
-      vtkSmartPointer<vtkVelodyneHDLPositionReader>::New();
-  reader->SetFileName(pathToPcap);
-  reader->Update();
-  // std::cout << *reader->GetOutput() << std::endl; // should you want to inspect the polydata produced
-
   double point0_arrays[17] =  { 37.139071666666, -121.657165, 78376, 2777073776, 0.9768, 0.108669, 0.970695, -0.272283, -0.068376, -0.272283, 3.12512, -7.42216, -32.52078, 40.6, 36.9146, 38.6582, 42.0001 };
   double point0_coords[3] =  { 0.0, 0.0, 0.0 };
   double point8947_arrays[17] = { 37.1387, -121.65492833333, 78421, 2822076651, 0.990231, 0.023199, 0.98901, -0.002442, 0.001221, -0.003663, -8.7894, -4.10172, -28.3214, 257.7, 36.9146, 38.8035, 42.0001 };
@@ -258,6 +241,63 @@ int main(int argc, char* argv[])
   isvalid &= test_interpolator_time_range(reader, minTime, maxTime);
   isvalid &= test_interpolator_transform(reader, minTime, transformMinTime);
   isvalid &= test_interpolator_transform(reader, maxTime - 1.0, transformMaxTimeMinus1);
+  return isvalid;
+}
+
+// The position packets are decoded while a lidar reader builds its frame index,
+// sequentially or in its background thread
+bool test_shared_scan(const std::string& pathToPcap, const std::string& pathToCalibration,
+                      bool incrementalIndexing)
+{
+  std::cout << "Testing the position packets read by a lidar reader, incremental indexing: "
+            << incrementalIndexing << std::endl;
+  vtkNew<vtkLidarReader> lidarReader;
+  auto interpreter = vtkSmartPointer<vtkVelodynePacketInterpreter>::New();
+  lidarReader->SetInterpreter(interpreter);
+  lidarReader->SetCalibrationFileName(pathToCalibration);
+  lidarReader->SetUseFrameIndexFile(false);
+  lidarReader->SetNumberOfIndexingThreads(1);
+  lidarReader->SetIncrementalIndexing(incrementalIndexing);
+
+  vtkSmartPointer<vtkVelodyneHDLPositionReader> reader =
+      vtkSmartPointer<vtkVelodyneHDLPositionReader>::New();
+  reader->SetFileName(pathToPcap);
+  reader->SetLidarReader(lidarReader.GetPointer());
+  lidarReader->SetFileName(pathToPcap);
+  lidarReader->UpdateInformation();
+  reader->Update();
+  return test_reader(reader);
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc != 2 && argc != 3)
+  {
+    std::cerr << "Wrong number of arguments. Usage: "
+              << argv[0]
+              << "<path to "
+              << "\"HDL32-V2_R into Butterfield into Digital Drive.pcap\""
+              << "(from data.kitware.com,"
+              << "sha1sum: 1edb06c8c4312cb259dd0417a226c235945ff5b6) >"
+              << " [<path to HDL-32.xml>]"
+              << std::endl;
+    return 1;
+  }
+
+  std::string pathToPcap = std::string(argv[1]);
+
+  vtkSmartPointer<vtkVelodyneHDLPositionReader> reader =
+      vtkSmartPointer<vtkVelodyneHDLPositionReader>::New();
+  reader->SetFileName(pathToPcap);
+  reader->Update();
+  // std::cout << *reader->GetOutput() << std::endl; // should you want to inspect the polydata produced
+
+  bool isvalid = test_reader(reader);
+  if (argc == 3)
+  {
+    isvalid &= test_shared_scan(pathToPcap, argv[2], false);
+    isvalid &= test_shared_scan(pathToPcap, argv[2], true);
+  }
 
   return  isvalid ? 0 : 1;
 }
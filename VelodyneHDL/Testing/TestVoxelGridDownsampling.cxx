@@ -0,0 +1,182 @@
+//=========================================================================
+//
+// Copyright 2018 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+// Downsample a few points whose voxels are known, then a large random cloud
+// with one and several threads, which must give the same points.
+
+#include "vtkVoxelGridDownsampling.h"
+
+#include <vtkDoubleArray.h>
+#include <vtkFloatArray.h>
+#include <vtkIntArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace
+{
+//-----------------------------------------------------------------------------
+// Cloud with the arrays of the lidar interpreters, the laser_id of each point
+// being its index
+vtkSmartPointer<vtkPolyData> CreateCloud(const std::vector<float>& coordinates)
+{
+  const vtkIdType numberOfPoints = coordinates.size() / 3;
+  auto points = vtkSmartPointer<vtkPoints>::New();
+  points->SetDataTypeToFloat();
+  points->SetNumberOfPoints(numberOfPoints);
+  auto intensity = vtkSmartPointer<vtkUnsignedCharArray>::New();
+  intensity->SetName("intensity");
+  intensity->SetNumberOfTuples(numberOfPoints);
+  auto laserId = vtkSmartPointer<vtkIntArray>::New();
+  laserId->SetName("laser_id");
+  laserId->SetNumberOfTuples(numberOfPoints);
+  auto timestamp = vtkSmartPointer<vtkDoubleArray>::New();
+  timestamp->SetName("timestamp");
+  timestamp->SetNumberOfTuples(numberOfPoints);
+  for (vtkIdType i = 0; i < numberOfPoints; ++i)
+  {
+    points->SetPoint(i, &coordinates[3 * i]);
+    intensity->SetValue(i, static_cast<unsigned char>(i % 256));
+    laserId->SetValue(i, static_cast<int>(i));
+    timestamp->SetValue(i, 0.5 * i);
+  }
+
+  auto cloud = vtkSmartPointer<vtkPolyData>::New();
+  cloud->SetPoints(points);
+  cloud->GetPointData()->AddArray(intensity);
+  cloud->GetPointData()->AddArray(laserId);
+  cloud->GetPointData()->AddArray(timestamp);
+  return cloud;
+}
+
+//-----------------------------------------------------------------------------
+vtkSmartPointer<vtkPolyData> Downsample(vtkPolyData* cloud, double leafSize, int samplingMode, int numberOfThreads)
+{
+  auto filter = vtkSmartPointer<vtkVoxelGridDownsampling>::New();
+  filter->SetInputData(cloud);
+  filter->SetLeafSize(leafSize, leafSize, leafSize);
+  filter->SetSamplingMode(samplingMode);
+  filter->SetNumberOfThreads(numberOfThreads);
+  filter->Update();
+  return filter->GetOutput();
+}
+
+//-----------------------------------------------------------------------------
+int TestKnownVoxels()
+{
+  // three points in the voxel [1, 2[ x [0, 1[ x [0, 1[, three in the voxel
+  // [0, 1[^3 and an invalid point
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const std::vector<float> coordinates = { 1.1f, 0.5f, 0.5f,
+                                           0.1f, 0.1f, 0.1f,
+                                           nan, 0.f, 0.f,
+                                           0.3f, 0.3f, 0.3f,
+                                           1.3f, 0.5f, 0.5f,
+                                           0.5f, 0.5f, 0.5f,
+                                           1.9f, 0.5f, 0.5f };
+  auto cloud = CreateCloud(coordinates);
+  auto output = Downsample(cloud, 1., vtkVoxelGridDownsampling::Centroid, 1);
+
+  if (output->GetNumberOfPoints() != 2 || output->GetNumberOfVerts() != 2)
+  {
+    std::cerr << "Expected 2 points, got " << output->GetNumberOfPoints() << std::endl;
+    return 1;
+  }
+  // the voxels are in the order of their first point, with the point data of
+  // the point closest to their centroid
+  const double expectedPoints[2][3] = { { 4.3 / 3., 0.5, 0.5 }, { 0.3, 0.3, 0.3 } };
+  const int expectedLaserIds[2] = { 4, 3 };
+  vtkDataArray* laserId = output->GetPointData()->GetArray("laser_id");
+  vtkDataArray* timestamp = output->GetPointData()->GetArray("timestamp");
+  vtkDataArray* intensity = output->GetPointData()->GetArray("intensity");
+  if (!laserId || !timestamp || !intensity || !vtkIntArray::SafeDownCast(laserId))
+  {
+    std::cerr << "Missing point data array" << std::endl;
+    return 1;
+  }
+  int nbrErrors = 0;
+  for (vtkIdType i = 0; i < 2; ++i)
+  {
+    double point[3];
+    output->GetPoint(i, point);
+    for (int k = 0; k < 3; ++k)
+    {
+      if (std::abs(point[k] - expectedPoints[i][k]) > 1e-6)
+      {
+        std::cerr << "Wrong centroid of voxel " << i << std::endl;
+        nbrErrors++;
+        break;
+      }
+    }
+    if (laserId->GetTuple1(i) != expectedLaserIds[i] || timestamp->GetTuple1(i) != 0.5 * expectedLaserIds[i] ||
+        intensity->GetTuple1(i) != expectedLaserIds[i])
+    {
+      std::cerr << "Wrong point data of voxel " << i << std::endl;
+      nbrErrors++;
+    }
+  }
+  return nbrErrors;
+}
+
+//-----------------------------------------------------------------------------
+int TestNumberOfThreads()
+{
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> distribution(-20.f, 20.f);
+  std::vector<float> coordinates(3 * 500000);
+  for (float& value : coordinates)
+  {
+    value = distribution(generator);
+  }
+  auto cloud = CreateCloud(coordinates);
+
+  auto sequential = Downsample(cloud, 0.5, vtkVoxelGridDownsampling::ClosestPoint, 1);
+  auto parallel = Downsample(cloud, 0.5, vtkVoxelGridDownsampling::ClosestPoint, 4);
+  if (sequential->GetNumberOfPoints() == 0 || sequential->GetNumberOfPoints() >= cloud->GetNumberOfPoints() ||
+      sequential->GetNumberOfPoints() != parallel->GetNumberOfPoints())
+  {
+    std::cerr << "Different number of points: " << sequential->GetNumberOfPoints()
+              << " and " << parallel->GetNumberOfPoints() << std::endl;
+    return 1;
+  }
+  vtkDataArray* sequentialIds = sequential->GetPointData()->GetArray("laser_id");
+  vtkDataArray* parallelIds = parallel->GetPointData()->GetArray("laser_id");
+  for (vtkIdType i = 0; i < sequential->GetNumberOfPoints(); ++i)
+  {
+    if (sequentialIds->GetTuple1(i) != parallelIds->GetTuple1(i))
+    {
+      std::cerr << "Different point " << i << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  return TestKnownVoxels() + TestNumberOfThreads();
+}
@@ -0,0 +1,147 @@
+#include "ZipArchiveWriter.h"
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+const int NumberOfThreads = 4;
+const int FilesPerThread = 50;
+
+//-----------------------------------------------------------------------------
+unsigned long long Read(const std::string& bytes, size_t offset, int size)
+{
+  unsigned long long value = 0;
+  for (int i = size - 1; i >= 0; --i)
+  {
+    value = (value << 8) | static_cast<unsigned char>(bytes[offset + i]);
+  }
+  return value;
+}
+
+//-----------------------------------------------------------------------------
+std::string GetContent(int thread, int file)
+{
+  return std::string(37 * file + thread, static_cast<char>('a' + thread)) + "\n";
+}
+
+//-----------------------------------------------------------------------------
+//! Read the files of an archive through its central directory
+bool ReadArchive(const fs::path& fileName, std::map<std::string, std::string>& files)
+{
+  std::ifstream stream(fileName.string().c_str(), std::ios::binary);
+  const std::string bytes((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+  if (bytes.size() < 22 || Read(bytes, bytes.size() - 22, 4) != 0x06054b50)
+  {
+    std::cerr << "No end of central directory" << std::endl;
+    return false;
+  }
+  const size_t numberOfEntries = Read(bytes, bytes.size() - 12, 2);
+  size_t offset = Read(bytes, bytes.size() - 6, 4);
+  for (size_t entry = 0; entry < numberOfEntries; ++entry)
+  {
+    if (Read(bytes, offset, 4) != 0x02014b50 || Read(bytes, offset + 10, 2) != 0)
+    {
+      std::cerr << "Wrong central directory header" << std::endl;
+      return false;
+    }
+    const unsigned long long crc = Read(bytes, offset + 16, 4);
+    const size_t size = Read(bytes, offset + 24, 4);
+    const size_t nameSize = Read(bytes, offset + 28, 2);
+    const size_t extraSize = Read(bytes, offset + 30, 2);
+    const size_t localOffset = Read(bytes, offset + 42, 4);
+    const std::string name = bytes.substr(offset + 46, nameSize);
+    offset += 46 + nameSize + extraSize;
+
+    if (Read(bytes, localOffset, 4) != 0x04034b50 || Read(bytes, localOffset + 14, 4) != crc ||
+      bytes.substr(localOffset + 30, nameSize) != name)
+    {
+      std::cerr << name << ": wrong local header" << std::endl;
+      return false;
+    }
+    const size_t dataOffset = localOffset + 30 + nameSize + Read(bytes, localOffset + 28, 2);
+    const std::string content = bytes.substr(dataOffset, size);
+    boost::crc_32_type checksum;
+    checksum.process_bytes(content.data(), content.size());
+    if (checksum.checksum() != crc)
+    {
+      std::cerr << name << ": wrong checksum" << std::endl;
+      return false;
+    }
+    files[name] = content;
+  }
+  return true;
+}
+}
+
+//-----------------------------------------------------------------------------
+int main(int, char*[])
+{
+  const fs::path directory = fs::temp_directory_path() / fs::unique_path("TestZipArchiveWriter-%%%%%%");
+  fs::create_directories(directory);
+  const fs::path fileName = directory / "archive.zip";
+
+  int nbrErrors = 0;
+  // the files are added by several threads at the same time
+  ZipArchiveWriter archive;
+  if (!archive.Open(fileName.string()))
+  {
+    std::cerr << "The archive cannot be created" << std::endl;
+    return 1;
+  }
+  boost::thread_group threads;
+  for (int thread = 0; thread < NumberOfThreads; ++thread)
+  {
+    threads.create_thread([&archive, thread]() {
+      for (int file = 0; file < FilesPerThread; ++file)
+      {
+        archive.AddFile("frames/frame_" + std::to_string(thread) + "_" + std::to_string(file) + ".txt",
+          GetContent(thread, file));
+      }
+    });
+  }
+  threads.join_all();
+  archive.AddFile("frames/empty", std::string());
+  if (!archive.Close())
+  {
+    std::cerr << "The archive cannot be written" << std::endl;
+    nbrErrors++;
+  }
+
+  std::map<std::string, std::string> files;
+  if (!ReadArchive(fileName, files))
+  {
+    nbrErrors++;
+  }
+  if (files.size() != NumberOfThreads * FilesPerThread + 1 || files.count("frames/empty") != 1)
+  {
+    std::cerr << files.size() << " files in the archive" << std::endl;
+    nbrErrors++;
+  }
+  for (int thread = 0; thread < NumberOfThreads; ++thread)
+  {
+    for (int file = 0; file < FilesPerThread; ++file)
+    {
+      const std::string name =
+        "frames/frame_" + std::to_string(thread) + "_" + std::to_string(file) + ".txt";
+      if (files[name] != GetContent(thread, file))
+      {
+        std::cerr << name << ": wrong content" << std::endl;
+        nbrErrors++;
+      }
+    }
+  }
+
+  boost::system::error_code error;
+  fs::remove_all(directory, error);
+  return nbrErrors;
+}
@@ -13,10 +13,13 @@
 // limitations under the License.
 #include "pqVelodyneManager.h"
 
+#include "vtkFrameBatchExporter.h"
 #include "vtkLASFileWriter.h"
+#include "vtkLidarCSVWriter.h"
 #include "vtkPVConfig.h" //  needed for PARAVIEW_VERSION
 #include "vtkLidarReader.h"
 #include "vvPythonQtDecorators.h"
+#include "ZipArchiveWriter.h"
 
 #include <pqActiveObjects.h>
 #include <pqApplicationCore.h>
@@ -43,6 +46,7 @@
 
 #include <QApplication>
 #include <QDir>
+#include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QLabel>
@@ -52,13 +56,45 @@
 #include <QProgressDialog>
 #include <QTimer>
 
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <sstream>
 
 //-----------------------------------------------------------------------------
 class pqVelodyneManager::pqInternal
 {
+public:
+  // times in seconds of the startup steps, see writeStartupBenchmark
+  double SetupTime = 0;
+  double PythonInitializedTime = 0;
+  double AppLogicStartedTime = 0;
 };
 
+//-----------------------------------------------------------------------------
+namespace
+{
+void ConfigureCSVWriter(vtkLidarCSVWriter& writer, const QString& filename,
+  const QStringList& columns, int precision)
+{
+  std::vector<std::string> columnNames;
+  foreach (const QString& column, columns)
+  {
+    columnNames.push_back(column.toStdString());
+  }
+  writer.SetColumns(columnNames);
+  writer.SetPrecision(precision);
+  writer.SetDelimiter(filename.endsWith(".tsv", Qt::CaseInsensitive) ? '\t' : ',');
+}
+}
+
+//-----------------------------------------------------------------------------
+namespace
+{
+// the libraries are loaded before main, this is the reference of the startup durations
+const double LibraryLoadTime = vtkTimerLog::GetUniversalTime();
+}
+
 //-----------------------------------------------------------------------------
 QPointer<pqVelodyneManager> pqVelodyneManagerInstance = NULL;
 
@@ -114,6 +150,7 @@ void pqVelodyneManager::pythonStartup()
   vtkPythonInterpreter::RunSimpleString("import PythonQt");
   PythonQt::self()->addDecorators(new vvPythonQtDecorators());
   vtkPythonInterpreter::RunSimpleString("import veloview");
+  this->Internal->PythonInitializedTime = vtkTimerLog::GetUniversalTime();
 
   this->runPython(QString(
       "import PythonQt\n"
@@ -121,6 +158,7 @@ void pqVelodyneManager::pythonStartup()
       "QtCore = PythonQt.QtCore\n"
       "import veloview.applogic as vv\n"
       "vv.start()\n"));
+  this->Internal->AppLogicStartedTime = vtkTimerLog::GetUniversalTime();
 
   pqSettings* const settings = pqApplicationCore::instance()->settings();
   const QVariant& gridVisible =
@@ -166,6 +204,38 @@ void pqVelodyneManager::pythonStartup()
     dialog->raise();
     dialog->activateWindow();
   }
+
+  // the main window is usable once the events queued during the startup are processed
+  const char* benchmarkFileName = std::getenv("VELOVIEW_STARTUP_BENCHMARK");
+  if (benchmarkFileName && *benchmarkFileName)
+  {
+    QTimer::singleShot(0, this, SLOT(writeStartupBenchmark()));
+  }
+}
+
+//-----------------------------------------------------------------------------
+void pqVelodyneManager::writeStartupBenchmark()
+{
+  const double readyTime = vtkTimerLog::GetUniversalTime();
+  const char* benchmarkFileName = std::getenv("VELOVIEW_STARTUP_BENCHMARK");
+  std::ofstream json(benchmarkFileName);
+  if (!json.is_open())
+  {
+    std::cerr << "Cannot create " << benchmarkFileName << std::endl;
+  }
+  else
+  {
+    json << std::setprecision(6) << std::fixed;
+    json << "{\n"
+         << "  \"main_window_created\": " << this->Internal->SetupTime - LibraryLoadTime << ",\n"
+         << "  \"python_initialized\": " << this->Internal->PythonInitializedTime - LibraryLoadTime
+         << ",\n"
+         << "  \"applogic_started\": " << this->Internal->AppLogicStartedTime - LibraryLoadTime
+         << ",\n"
+         << "  \"main_window_ready\": " << readyTime - LibraryLoadTime << "\n"
+         << "}\n";
+  }
+  QApplication::quit();
 }
 
 //-----------------------------------------------------------------------------
@@ -240,7 +310,8 @@ void pqVelodyneManager::saveFramesToPCAP(
 
 //-----------------------------------------------------------------------------
 void pqVelodyneManager::saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* position,
-  int startFrame, int endFrame, const QString& filename, int positionMode)
+  int startFrame, int endFrame, const QString& filename, int positionMode,
+  vtkVelodyneTransformInterpolator* trajectory)
 {
   if (!reader || (positionMode > 0 && !position))
   {
@@ -309,54 +380,102 @@ void pqVelodyneManager::saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* pos
     }
   }
 
-  std::cout << "origin : [" << northing << ";" << easting << ";" << height << "]" << std::endl;
+  std::cout << "origin : [" << easting << ";" << northing << ";" << height << "]" << std::endl;
   std::cout << "gcs : " << gcs << std::endl;
 
   writer.SetPrecision(neTol, hTol);
   writer.SetGeoConversion(in, out, utmZone, isLatLon);
   writer.SetOrigin(gcs, easting, northing, height);
+  if (positionMode > 0)
+  {
+    writer.SetTrajectory(trajectory);
+  }
 
-  QProgressDialog progress("Exporting LAS...", "Abort Export", startFrame,
-    startFrame + (endFrame - startFrame) * 2, getMainWindow());
+  QProgressDialog progress("Exporting LAS...", "Abort Export", 0, 100, getMainWindow());
   progress.setWindowModality(Qt::WindowModal);
 
-  reader->Open();
-  for (int frame = startFrame; frame <= endFrame; ++frame)
+  // the frames are decoded on all the threads of the reader while the points are written
+  writer.WriteFrames(reader, startFrame, endFrame, [&](double value) {
+    progress.setValue(static_cast<int>(100 * value));
+    return !progress.wasCanceled();
+  });
+}
+
+//-----------------------------------------------------------------------------
+bool pqVelodyneManager::exportFrames(vtkLidarReader* reader, int startFrame, int endFrame,
+  const QString& fileNameTemplate, int format, const QStringList& columns, int precision)
+{
+  if (!reader)
   {
-    progress.setValue(frame);
+    return false;
+  }
 
-    if (progress.wasCanceled())
-    {
-      reader->Close();
-      return;
-    }
+  QProgressDialog progress("Exporting frames...", "Abort Export", 0, 100, getMainWindow());
+  progress.setWindowModality(Qt::WindowModal);
+
+  // the frames are decoded on all the threads of the reader and written concurrently
+  vtkFrameBatchExporter exporter(format, qPrintable(fileNameTemplate));
+  ConfigureCSVWriter(exporter.GetCSVWriter(), fileNameTemplate, columns, precision);
+  return exporter.ExportFrames(reader, startFrame, endFrame, [&](double value) {
+    progress.setValue(static_cast<int>(100 * value));
+    return !progress.wasCanceled();
+  });
+}
 
-    const vtkSmartPointer<vtkPolyData>& data = reader->GetFrame(frame);
-    writer.UpdateMetaData(data.GetPointer());
+//-----------------------------------------------------------------------------
+bool pqVelodyneManager::exportFramesToKiwiViewer(vtkLidarReader* reader, int startFrame,
+  int endFrame, const QString& archiveFileName, const QString& directory, const QString& scene)
+{
+  ZipArchiveWriter archive;
+  if (!reader || !archive.Open(qPrintable(archiveFileName)))
+  {
+    return false;
   }
 
-  writer.FlushMetaData();
+  QProgressDialog progress("Exporting frames...", "Abort Export", 0, 100, getMainWindow());
+  progress.setWindowModality(Qt::WindowModal);
 
-  for (int frame = startFrame; frame <= endFrame; ++frame)
+  // the frames are decoded on all the threads of the reader, and written in memory by the
+  // writing threads which add them to the archive. The names are UTF-8 in the archive
+  vtkFrameBatchExporter exporter(vtkFrameBatchExporter::VTP,
+    (directory + "/frame_%04d.vtp").toUtf8().constData());
+  exporter.SetArchive(&archive);
+  const bool isExported = exporter.ExportFrames(reader, startFrame, endFrame, [&](double value) {
+    progress.setValue(static_cast<int>(100 * value));
+    return !progress.wasCanceled();
+  });
+  const QByteArray sceneContent = scene.toUtf8();
+  const bool isWritten = isExported &&
+    archive.AddFile((directory + "/scene.kiwi").toUtf8().constData(), sceneContent.constData(),
+      sceneContent.size());
+  const bool isClosed = archive.Close();
+  if (!isWritten || !isClosed)
   {
-    progress.setValue(endFrame + (frame - startFrame));
-
-    if (progress.wasCanceled())
-    {
-      reader->Close();
-      return;
-    }
+    // an incomplete archive is not left behind
+    QFile::remove(archiveFileName);
+    return false;
+  }
+  return true;
+}
 
-    const vtkSmartPointer<vtkPolyData>& data = reader->GetFrame(frame);
-    writer.WriteFrame(data.GetPointer());
+//-----------------------------------------------------------------------------
+bool pqVelodyneManager::saveFrameToCSV(vtkPolyData* frame, const QString& filename,
+  const QStringList& columns, int precision)
+{
+  if (!frame)
+  {
+    return false;
   }
 
-  reader->Close();
+  vtkLidarCSVWriter writer;
+  ConfigureCSVWriter(writer, filename, columns, precision);
+  return writer.Write(frame, qPrintable(filename));
 }
 
 //-----------------------------------------------------------------------------
 void pqVelodyneManager::setup()
 {
+  this->Internal->SetupTime = vtkTimerLog::GetUniversalTime();
   QTimer::singleShot(0, this, SLOT(pythonStartup()));
 }
 
@@ -367,7 +486,7 @@ void pqVelodyneManager::openData(const QString& filename, const QString& positio
   {
     this->runPython(QString("vv.openPCAP('%1', '%2')\n").arg(filename, positionFilename));
   }
-  else if (QFileInfo(filename).suffix() == "pcap")
+  else if (QFileInfo(filename).suffix() == "pcap" || QFileInfo(filename).suffix() == "pcapng")
   {
     this->runPython(QString("vv.openPCAP('%1')\n").arg(filename));
   }
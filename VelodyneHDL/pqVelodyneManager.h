@@ -16,6 +16,7 @@
 #define __pqVelodyneManager_h
 
 #include <QObject>
+#include <QStringList>
 
 #include "vvConfigure.h"
 
@@ -29,6 +30,7 @@ class pqView;
 class vtkSMSourceProxy;
 
 class vtkPolyData;
+class vtkVelodyneTransformInterpolator;
 
 class QAction;
 class QLabel;
@@ -70,8 +72,29 @@ public:
   static void saveFramesToPCAP(
     vtkSMSourceProxy* proxy, int startFrame, int endFrame, const QString& filename);
 
+  /// Write a range of frames to a LAS file. With a positionMode above 0, the points are moved
+  /// with the poses of the trajectory of the position reader, if given.
   static void saveFramesToLAS(vtkLidarReader* reader, vtkPolyData* position, int startFrame,
-    int endFrame, const QString& filename, int positionMode);
+    int endFrame, const QString& filename, int positionMode,
+    vtkVelodyneTransformInterpolator* trajectory = nullptr);
+
+  /// Write each frame of a range to its own file, see vtkFrameBatchExporter for the formats.
+  /// The frame number replaces the printf integer conversion of fileNameTemplate, columns and
+  /// precision are the ones of saveFrameToCSV
+  static bool exportFrames(vtkLidarReader* reader, int startFrame, int endFrame,
+    const QString& fileNameTemplate, int format, const QStringList& columns, int precision);
+
+  /// Write a range of frames as binary VTP files frame_<number>.vtp in the directory of a zip
+  /// archive, with the scene.kiwi description of the scene, for KiwiViewer. The frames are
+  /// written concurrently straight into the archive, without a temporary directory
+  static bool exportFramesToKiwiViewer(vtkLidarReader* reader, int startFrame, int endFrame,
+    const QString& archiveFileName, const QString& directory, const QString& scene);
+
+  /// Write a frame to a CSV file, or a TSV file if the extension is .tsv. Only the given
+  /// columns are written, all of them if empty, with a fixed number of decimals or the
+  /// shortest exact representation if precision is negative
+  static bool saveFrameToCSV(vtkPolyData* frame, const QString& filename,
+    const QStringList& columns, int precision);
 
 public slots:
 
@@ -86,6 +109,11 @@ signals:
 
   void sourceCreated();
 
+private slots:
+
+  /// Write the startup durations to the file given by VELOVIEW_STARTUP_BENCHMARK and quit
+  void writeStartupBenchmark();
+
 private:
   pqVelodyneManager(QObject* p);
 
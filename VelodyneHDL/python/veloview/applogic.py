@@ -25,15 +25,13 @@ from paraview import vtk
 import PythonQt
 from PythonQt import QtCore, QtGui
 
-from vtkIOXMLPython import vtkXMLPolyDataWriter
-import kiwiviewerExporter
-import gridAdjustmentDialog
-import aboutDialog
-import planefit
 import bisect
 
 from PythonQt.paraview import vvCalibrationDialog, vvCropReturnsDialog, vvSelectFramesDialog
 from VelodyneHDLPluginPython import vtkVelodynePacketInterpreter
+from VelodyneHDLPluginPython import vtkMemoryAccounting
+from VelodyneHDLPluginPython import vtkThreadTopology
+from VelodyneHDLPluginPython import vtkDisplayedPointsLocator
 
 _repCache = {}
 
@@ -63,6 +61,10 @@ class AppLogic(object):
 
         self.mousePressed = False
 
+        # index of the points of the active source, built again when they change, which
+        # answers the picks of the ruler without scanning all the points
+        self.pointsLocator = vtkDisplayedPointsLocator()
+
         mainView = smp.GetActiveView()
         self.mainView = mainView
 
@@ -76,6 +78,32 @@ class AppLogic(object):
 
         self.laserSelectionDialog = None
 
+        # source shown in the spreadsheet, kept to show it when the spreadsheet view is created
+        self.spreadSheetSource = None
+
+        # point data arrays shown in the spreadsheet, the other ones are not converted to columns
+        self.spreadSheetColumns = ['intensity', 'laser_id', 'azimuth', 'distance_m', 'adjustedtime', 'timestamp']
+
+        # columns of the exported CSV files, 'Points' being the coordinates, all of them if empty,
+        # and number of decimals of their values, -1 for the shortest exact representation
+        self.csvColumns = []
+        self.csvPrecision = -1
+
+        # polls the reader while the pcap is indexed in the background
+        self.indexingTimer = QtCore.QTimer()
+        self.indexingTimer.setInterval(500)
+        self.indexingTimer.connect('timeout()', onIndexingTimeout)
+
+        # polls the reader while a frame is decoded in the background, see AsynchronousUpdate
+        self.frameTimer = QtCore.QTimer()
+        self.frameTimer.setInterval(16)
+        self.frameTimer.connect('timeout()', onFrameTimeout)
+
+        # shows the telemetry of the live stream in the status bar
+        self.telemetryTimer = QtCore.QTimer()
+        self.telemetryTimer.setInterval(1000)
+        self.telemetryTimer.connect('timeout()', onTelemetryTimeout)
+
         self.gridProperties = None
 
         smp.LoadPlugin(vtkGetFileNameFromPluginName('PointCloudPlugin'))
@@ -92,6 +120,9 @@ class AppLogic(object):
         self.statusLabel = QtGui.QLabel()
         self.sensorInformationLabel = QtGui.QLabel()
         self.positionPacketInfoLabel = QtGui.QLabel()
+        self.telemetryLabel = QtGui.QLabel()
+        self.memoryLabel = QtGui.QLabel()
+        self.hoveredPointLabel = QtGui.QLabel()
 
 
 class GridProperties:
@@ -136,8 +167,7 @@ def openData(filename):
     if not reader:
         return
 
-    rep = smp.Show(reader)
-    rep.InterpolateScalarsBeforeMapping = 0
+    smp.Show(reader)
     setDefaultLookupTables(reader)
     colorByIntensity(reader)
 
@@ -163,6 +193,8 @@ def openData(filename):
 
 
 def planeFit():
+    # the modules only needed by a menu action are imported when it is first triggered
+    import planefit
     planefit.fitPlane()
 
 
@@ -179,8 +211,16 @@ def findPresetByName(name):
     return -1
 
 
+# looking for a preset goes through all of them, the DSR Colors preset is only looked for once
+_dsrColorsPresetCreated = False
+
 def createDSRColorsPreset():
 
+    global _dsrColorsPresetCreated
+    if _dsrColorsPresetCreated:
+        return
+    _dsrColorsPresetCreated = True
+
     dsrColorIndex = findPresetByName("DSR Colors")
 
     if dsrColorIndex == -1:
@@ -225,11 +265,6 @@ def createDSRColorsPreset():
 def setDefaultLookupTables(sourceProxy):
     createDSRColorsPreset()
 
-    presets = servermanager.vtkSMTransferFunctionPresets()
-
-    dsrIndex = findPresetByName("DSR Colors")
-    presetDSR = presets.GetPresetAsString(dsrIndex)
-
     # LUT for 'intensity'
     smp.GetLookupTableForArray(
       'intensity', 1,
@@ -278,6 +313,11 @@ def colorByIntensity(sourceProxy):
     rep = smp.GetDisplayProperties(sourceProxy)
     rep.ColorArrayName = 'intensity'
     rep.LookupTable = smp.GetLookupTableForArray('intensity', 1)
+    # the scalars are given to the GPU as texture coordinates and the lookup table as a
+    # texture, instead of mapping every point to a color on the CPU for each frame. They are
+    # still uploaded as one float per point, not as the uint8 arrays, and the categorical
+    # lookup tables (dual returns) are still mapped on the CPU.
+    rep.InterpolateScalarsBeforeMapping = 1
     return True
 
 
@@ -425,7 +465,6 @@ def openSensor():
     onLaserSelection(False)
 
     rep = smp.Show(sensor)
-#    rep.InterpolateScalarsBeforeMapping = 0
 #    if app.sensor.GetClientSideObject().GetNumberOfChannels() == 128:
 #        rep.Representation = 'Point Cloud'
 #        rep.ColorArrayName = 'intensity'
@@ -488,11 +527,21 @@ def openPCAP(filename, positionFilename=None, calibrationFilename=None, calibrat
     handler.SetProgressFrequency(0.05)
     tag = handler.AddObserver('ProgressEvent', onProgressEvent)
 
-    # construct the reader, this calls UpdateInformation on the
-    # reader which scans the pcap file and emits progress events
     reader = smp.LidarReader(guiName='Data',
-                             FileName = filename,
-                             CalibrationFile = calibrationFile)
+                             CalibrationFile = calibrationFile,
+                             IncrementalIndexing = 1)
+
+    # the position packets are decoded while the lidar reader scans the pcap
+    # file, so that it is read only once
+    if positionFilename is None:
+        posreader = smp.VelodyneHDLPositionReader(guiName="Position",
+                                                  FileName=filename)
+        posreader.GetClientSideObject().SetLidarReader(reader.GetClientSideObject())
+
+    # setting the file name calls UpdateInformation on the reader which
+    # scans the pcap file and emits progress events
+    reader.FileName = filename
+    reader.UpdatePipelineInformation()
 
     app.reader = reader
     app.trailingFramesSpinBox.enabled = True
@@ -525,10 +574,11 @@ def openPCAP(filename, positionFilename=None, calibrationFilename=None, calibrat
     if SAMPLE_PROCESSING_MODE:
         prep = smp.Show(processor)
     app.scene.UpdateAnimationUsingDataTimeSteps()
+    if reader.GetClientSideObject().GetIsIndexing():
+        app.indexingTimer.start()
+    app.frameTimer.start()
 
     if positionFilename is None:
-        posreader = smp.VelodyneHDLPositionReader(guiName="Position",
-                                                  FileName=filename)
         posreader.GetClientSideObject().SetShouldWarnOnWeirdGPSData(app.geolocationToolBar.visible)
     else:
         posreader = smp.ApplanixPositionReader(guiName="Position",
@@ -637,11 +687,30 @@ def showRuler():
     app.ruler.Visibility = True
     smp.Render()
 
+# Point of the active source shown within a few pixels of a position of the view,
+# the closest to the camera, None if there is none
+def pickDisplayedPoint(x, y, pixelTolerance = 4):
+    source = smp.GetActiveSource()
+    if source is None:
+        return None
+    data = source.GetClientSideObject().GetOutputDataObject(0)
+    if data is None or not data.IsA('vtkPolyData'):
+        return None
+
+    app.pointsLocator.SetInputData(data)
+    pointIndex = app.pointsLocator.PickPoint(smp.GetActiveView().GetRenderer(), x, y, pixelTolerance)
+    return list(data.GetPoint(pointIndex)) if pointIndex >= 0 else None
+
 def getPointFromCoordinate(coord, midPlaneDistance = 0.5):
     assert len(coord) == 2
 
     windowHeight = smp.GetActiveView().ViewSize[1]
 
+    # the ruler snaps to the point under the cursor when there is one
+    pickedPoint = pickDisplayedPoint(coord[0], windowHeight - coord[1])
+    if pickedPoint is not None:
+        return pickedPoint
+
     displayPoint = [coord[0], windowHeight - coord[1], midPlaneDistance]
     renderer = smp.GetActiveView().GetRenderer()
     renderer.SetDisplayPoint(displayPoint)
@@ -664,6 +733,7 @@ def toggleRulerContext():
         vtkW.disconnect('mouseEvent(QMouseEvent*)', setRulerCoordinates)
 
         app.mousePressed = False
+        app.hoveredPointLabel.setText('')
         hideRuler()
 
 
@@ -703,6 +773,15 @@ def setRulerCoordinates(mouseEvent):
             showRuler()
             smp.Render()
 
+        else: #Hovering, show the point under the cursor
+
+            windowHeight = pqView.ViewSize[1]
+            hoveredPoint = pickDisplayedPoint(mouseEvent.x(), windowHeight - mouseEvent.y())
+            if hoveredPoint is not None:
+                app.hoveredPointLabel.setText('  Point: (%.3f, %.3f, %.3f)' % tuple(hoveredPoint))
+            else:
+                app.hoveredPointLabel.setText('')
+
 
 # End Functions related to ruler
 
@@ -720,6 +799,24 @@ def rotateCSVFile(filename):
     writer.writerows(rows)
 
 
+def synchronousUpdate(function):
+    '''
+    Decorates a function which reads the frames through the pipeline, so that
+    the reader gives the requested frames even when it updates asynchronously.
+    '''
+    def wrapper(*args, **kwargs):
+        reader = getReader()
+        asynchronous = reader is not None and reader.AsynchronousUpdate
+        if asynchronous:
+            reader.AsynchronousUpdate = 0
+        try:
+            return function(*args, **kwargs)
+        finally:
+            if asynchronous:
+                reader.AsynchronousUpdate = 1
+    return wrapper
+
+
 def savePositionCSV(filename):
     w = smp.CreateWriter(filename, getPosition())
     w.Precision = 16
@@ -727,14 +824,23 @@ def savePositionCSV(filename):
     w.UpdatePipeline()
     smp.Delete(w)
 
+@synchronousUpdate
 def saveCSVCurrentFrame(filename):
-    w = smp.CreateWriter(filename, smp.GetActiveSource())
+    source = smp.GetActiveSource()
+    if source is not None and source.GetDataInformation().DataSetTypeIsA('vtkPolyData'):
+        source.UpdatePipeline(app.scene.AnimationTime)
+        frame = source.GetClientSideObject().GetOutputDataObject(0)
+        if PythonQt.paraview.pqVelodyneManager.saveFrameToCSV(frame, filename, app.csvColumns, app.csvPrecision):
+            return
+
+    w = smp.CreateWriter(filename, source)
     w.Precision = 16
     w.FieldAssociation = 'Points'
     w.UpdatePipeline()
     smp.Delete(w)
     rotateCSVFile(filename)
 
+@synchronousUpdate
 def saveCSVCurrentFrameSelection(filename):
     source = getReader()
     selection = source.GetSelectionOutput(0)
@@ -760,9 +866,10 @@ def saveLASFrames(filename, first, last, transform = 0):
     # Check that we have a position provider
     if getPosition() is not None:
         position = getPosition().GetClientSideObject().GetOutput()
+        trajectory = getPosition().GetClientSideObject().GetInterpolator()
 
         PythonQt.paraview.pqVelodyneManager.saveFramesToLAS(
-            reader, position, first, last, filename, transform)
+            reader, position, first, last, filename, transform, trajectory)
 
     else:
         PythonQt.paraview.pqVelodyneManager.saveFramesToLAS(
@@ -791,25 +898,58 @@ def saveFrameRange(filename, frameStart, frameStop, saveFunction):
     saveFunction(filename, timesteps)
 
 
+# The frames of a pcap are decoded and written concurrently in C++, without
+# setting the animation time and updating the pipeline for each frame. This
+# applies to a contiguous range of frames of the reader, the files being
+# named after the template with the frame number.
+# - format 0: CSV, the coordinates then the point data arrays
+# - format 1: VTP
+# Returns False when the frames must be exported one at a time
+def exportFramesInBatch(timesteps, filenameTemplate, format, source=None):
+    frames = getBatchFrames(timesteps, source)
+    if frames is None:
+        return False
+
+    PythonQt.paraview.pqVelodyneManager.exportFrames(getReader().GetClientSideObject(), frames[0], frames[-1],
+        filenameTemplate, format, app.csvColumns, app.csvPrecision)
+    return True
+
+
+# Sorted frames of the reader to export in batch, None when the frames must be
+# exported one at a time because they are not a contiguous range of the reader
+def getBatchFrames(timesteps, source=None):
+    reader = getReader()
+    if reader is None or (source is not None and source != reader):
+        return None
+
+    frames = sorted(int(t) for t in timesteps)
+    if not frames or frames != range(frames[0], frames[-1] + 1):
+        return None
+    return frames
+
+
+@synchronousUpdate
 def saveCSV(filename, timesteps):
 
+    import kiwiviewerExporter
     tempDir = kiwiviewerExporter.tempfile.mkdtemp()
     basenameWithoutExtension = os.path.splitext(os.path.basename(filename))[0]
     outDir = os.path.join(tempDir, basenameWithoutExtension)
     filenameTemplate = os.path.join(outDir, basenameWithoutExtension + ' (Frame %04d).csv')
     os.makedirs(outDir)
 
-    writer = smp.CreateWriter('tmp.csv', getLidar())
-    writer.FieldAssociation = 'Points'
-    writer.Precision = 16
+    if not exportFramesInBatch(timesteps, filenameTemplate, 0):
+        writer = smp.CreateWriter('tmp.csv', getLidar())
+        writer.FieldAssociation = 'Points'
+        writer.Precision = 16
 
-    for t in timesteps:
-        app.scene.AnimationTime = t
-        writer.FileName = filenameTemplate % t
-        writer.UpdatePipeline()
-        rotateCSVFile(writer.FileName)
+        for t in timesteps:
+            app.scene.AnimationTime = t
+            writer.FileName = filenameTemplate % t
+            writer.UpdatePipeline()
+            rotateCSVFile(writer.FileName)
 
-    smp.Delete(writer)
+        smp.Delete(writer)
 
     kiwiviewerExporter.zipDir(outDir, filename)
     kiwiviewerExporter.shutil.rmtree(tempDir)
@@ -824,6 +964,7 @@ def saveCSV(filename, timesteps):
 # - 3: Absolute Geoposition Lat/Lon: Lat / Lon coordinate system
 def saveLAS(filename, timesteps, transform = 0):
 
+    import kiwiviewerExporter
     tempDir = kiwiviewerExporter.tempfile.mkdtemp()
     basenameWithoutExtension = os.path.splitext(os.path.basename(filename))[0]
     outDir = os.path.join(tempDir, basenameWithoutExtension)
@@ -1048,8 +1189,20 @@ def onKiwiViewerExport():
 
 def saveToKiwiViewer(filename, timesteps):
 
+    import kiwiviewerExporter
+    directory = os.path.splitext(os.path.basename(filename))[0]
+
+    # the frames of the reader are written in parallel straight into the archive
+    frames = getBatchFrames(timesteps, smp.GetActiveSource())
+    if frames is not None:
+        filenames = ['frame_%04d.vtp' % t for t in frames]
+        scene = kiwiviewerExporter.getJsonData(smp.GetActiveView(), smp.GetDisplayProperties(), filenames)
+        PythonQt.paraview.pqVelodyneManager.exportFramesToKiwiViewer(getReader().GetClientSideObject(),
+            frames[0], frames[-1], filename, directory, scene)
+        return
+
     tempDir = kiwiviewerExporter.tempfile.mkdtemp()
-    outDir = os.path.join(tempDir, os.path.splitext(os.path.basename(filename))[0])
+    outDir = os.path.join(tempDir, directory)
 
     os.makedirs(outDir)
 
@@ -1061,12 +1214,17 @@ def saveToKiwiViewer(filename, timesteps):
     kiwiviewerExporter.shutil.rmtree(tempDir)
 
 
+@synchronousUpdate
 def exportToDirectory(outDir, timesteps):
 
-    filenames = []
+    filenames = ['frame_%04d.vtp' % t for t in timesteps]
+
+    if exportFramesInBatch(timesteps, os.path.join(outDir, 'frame_%04d.vtp'), 1, smp.GetActiveSource()):
+        return filenames
 
     alg = smp.GetActiveSource().GetClientSideObject()
 
+    from vtkIOXMLPython import vtkXMLPolyDataWriter
     writer = vtkXMLPolyDataWriter()
     writer.SetDataModeToAppended()
     writer.EncodeAppendedDataOff()
@@ -1075,7 +1233,6 @@ def exportToDirectory(outDir, timesteps):
     for t in timesteps:
 
         filename = 'frame_%04d.vtp' % t
-        filenames.append(filename)
 
         app.scene.AnimationTime = t
         polyData = vtk.vtkPolyData()
@@ -1113,6 +1270,7 @@ def onUserGuide():
             QtGui.QDesktopServices.openUrl(QtCore.QUrl('file:///%s' % filename, QtCore.QUrl.TolerantMode))
 
 def onAbout():
+    import aboutDialog
     aboutDialog.showDialog(getMainWindow())
 
 
@@ -1126,6 +1284,8 @@ def close():
     app.gridProperties.Color = app.grid.Color
 
     smp.GetAnimationScene().Stop()
+    app.indexingTimer.stop()
+    app.frameTimer.stop()
     hideRuler()
     unloadData()
     app.scene.AnimationTime = 0
@@ -1235,6 +1395,151 @@ def pollSource():
     return source or reader
 
 
+def getLiveTelemetry():
+    '''
+    Returns the telemetry of the live stream as a dictionary, the rates and
+    times are over the last second. Returns None if there is no stream.
+    '''
+    sensor = getSensor()
+    if sensor is None:
+        return None
+
+    stream = sensor.GetClientSideObject()
+    names = ['ReceivedPacketRate', 'QueuedPacketRate', 'DecodedPacketRate',
+             'DroppedPacketRate', 'FrameRate', 'FrameDecodeTime', 'MaxFrameDecodeTime',
+             'ReceiveLatency', 'MaxReceiveLatency', 'DecodingWaitRatio',
+             'PublishingWaitRatio', 'DecodingQueueDepth', 'RecordingQueueDepth',
+             'DisplayedFrameAge', 'NumberOfSkippedFrames', 'NumberOfPendingFrames']
+    return dict((name, getattr(stream, 'Get' + name)()) for name in names)
+
+
+def getMemoryAccounting():
+    '''
+    Returns the memory held by the live frames, the trailing frames, the slam
+    cache and the slam maps, as a dictionary of (size, peak size) in kibibytes.
+    The peak sizes are the highest sizes since resetMemoryPeaks.
+    '''
+    return dict((vtkMemoryAccounting.GetSubsystemName(i),
+                 (vtkMemoryAccounting.GetSize(i), vtkMemoryAccounting.GetPeakSize(i)))
+                for i in range(vtkMemoryAccounting.GetNumberOfSubsystems()))
+
+
+def resetMemoryPeaks():
+    vtkMemoryAccounting.ResetPeakSizes()
+
+
+def setMemoryBudget(mebibytes):
+    '''
+    Sets the memory the frame caches may hold together, in mebibytes, and saves
+    it in the settings. The caches of the readers are released first, then the
+    live frames. 0 only keeps a tenth of the memory of the system available.
+    '''
+    mebibytes = max(int(mebibytes), 0)
+    vtkMemoryAccounting.SetBudget(mebibytes * 1024)
+    getPVSettings().setValue('VelodyneHDLPlugin/MemoryBudget', mebibytes)
+    vtkMemoryAccounting.Enforce()
+
+
+def restoreMemoryBudget():
+    vtkMemoryAccounting.SetBudget(int(getPVSettings().value('VelodyneHDLPlugin/MemoryBudget', 0)) * 1024)
+
+
+def getThreadTopology():
+    '''
+    Returns the placement of the threads of the live pipeline as a dictionary
+    giving for each subsystem its cores, real-time priority, NUMA node and
+    pool size.
+    '''
+    return dict((vtkThreadTopology.GetSubsystemName(i),
+                 {'cpus': vtkThreadTopology.GetCpus(i),
+                  'priority': vtkThreadTopology.GetPriority(i),
+                  'numa': vtkThreadTopology.GetNumaNode(i),
+                  'pool': vtkThreadTopology.GetPoolSize(i)})
+                for i in range(vtkThreadTopology.GetNumberOfSubsystems()))
+
+
+def setThreadTopology(configuration):
+    '''
+    Sets the placement of the threads of the live pipeline from a line such as
+    'receive:cpus=2-3,priority=50;decode:cpus=4-7,numa=0;render:cpus=0-1' and
+    saves it in the settings. It is used by the streams started afterwards.
+    Returns False if the line is not valid.
+    '''
+    if not vtkThreadTopology.SetConfiguration(configuration):
+        return False
+    getPVSettings().setValue('VelodyneHDLPlugin/ThreadTopology', vtkThreadTopology.GetConfiguration())
+    vtkThreadTopology.ApplyToRenderThread()
+    return True
+
+
+def restoreThreadTopology():
+    configuration = getPVSettings().value('VelodyneHDLPlugin/ThreadTopology', '')
+    if configuration and vtkThreadTopology.SetConfiguration(configuration):
+        vtkThreadTopology.ApplyToRenderThread()
+
+
+def onThreadTopology():
+    dialog = QtGui.QDialog(getMainWindow())
+    dialog.setWindowTitle('Thread Topology')
+    layout = QtGui.QVBoxLayout(dialog)
+    layout.addWidget(QtGui.QLabel('Placement of the threads, taken into account by the next '
+                                  'stream, for example\nreceive:cpus=2-3,priority=50;'
+                                  'decode:cpus=4-7,numa=0;render:cpus=0-1'))
+    edit = QtGui.QLineEdit(vtkThreadTopology.GetConfiguration())
+    layout.addWidget(edit)
+    buttons = QtGui.QDialogButtonBox(QtGui.QDialogButtonBox.Ok | QtGui.QDialogButtonBox.Cancel)
+    buttons.connect('accepted()', dialog.accept)
+    buttons.connect('rejected()', dialog.reject)
+    layout.addWidget(buttons)
+
+    while dialog.exec_():
+        if setThreadTopology(edit.text):
+            return
+        QtGui.QMessageBox.warning(getMainWindow(), 'Thread Topology', 'The placement is not valid.')
+
+
+def onTelemetryTimeout():
+
+    vtkMemoryAccounting.Enforce()
+    summary = vtkMemoryAccounting.GetSummary()
+    app.memoryLabel.setText('  ' + summary if summary else '')
+
+    sensor = getSensor()
+    if sensor is None:
+        app.telemetryLabel.setText('')
+        return
+
+    app.telemetryLabel.setText('  ' + sensor.GetClientSideObject().GetTelemetrySummary())
+
+
+def onIndexingTimeout():
+
+    reader = getReader()
+    if reader is None:
+        app.indexingTimer.stop()
+        return
+
+    reader.Poll()
+    reader.UpdatePipelineInformation()
+    app.scene.UpdateAnimationUsingDataTimeSteps()
+    if not reader.GetClientSideObject().GetIsIndexing():
+        app.indexingTimer.stop()
+
+
+def onFrameTimeout():
+
+    reader = getReader()
+    if reader is None:
+        app.frameTimer.stop()
+        return
+
+    # the frame decoded in the background is shown as soon as it is ready
+    if reader.GetClientSideObject().GetIsFramePending():
+        reader.Poll()
+        if not reader.GetClientSideObject().GetIsFramePending():
+            smp.Render()
+
+
 def getPointCloudData(attribute=None):
 
     if attribute is not None:
@@ -1262,6 +1567,11 @@ def getNumberOfTimesteps():
 def unloadData():
     _repCache.clear()
 
+    # the columns chosen by the user are kept for the next data
+    columns = smp.FindSource('SpreadSheetColumns')
+    if columns:
+        app.spreadSheetColumns = list(columns.Columns)
+
     for k, src in smp.GetSources().iteritems():
         if src != app.grid and src != smp.FindSource("RPM"):
             smp.Delete(src)
@@ -1397,16 +1707,42 @@ def saveScreenshot(filename):
 
 
 def getSpreadSheetViewProxy():
+    # None until the spreadsheet dock is first shown, see vvToggleSpreadSheetReaction
     return smp.servermanager.ProxyManager().GetProxy("views", "main spreadsheet view")
 
+def renderSpreadSheetView():
+    view = getSpreadSheetViewProxy()
+    if view:
+        smp.Render(view)
+
 def clearSpreadSheetView():
+    app.spreadSheetSource = None
     view = getSpreadSheetViewProxy()
-    view.Representations = []
+    if view:
+        view.Representations = []
+
+
+def onSpreadSheetDockVisibilityChanged(visible):
+    # show the source opened before the spreadsheet view was created
+    view = getSpreadSheetViewProxy()
+    if visible and view and app.spreadSheetSource and not view.Representations:
+        showSourceInSpreadSheet(app.spreadSheetSource)
 
 
 def showSourceInSpreadSheet(source):
 
+    app.spreadSheetSource = source
     spreadSheetView = getSpreadSheetViewProxy()
+    if not spreadSheetView:
+        return
+
+    # The spreadsheet shows a filter keeping only the selected arrays of the
+    # data sets, so that the other ones are not converted at each frame
+    if source.GetDataInformation().DataInformation.DataSetTypeIsA('vtkDataSet'):
+        activeSource = smp.GetActiveSource()
+        source = smp.SpreadSheetColumns(guiName='SpreadSheetColumns', Input=source, Columns=app.spreadSheetColumns)
+        smp.SetActiveSource(activeSource)
+
     smp.Show(source, spreadSheetView)
 
     # Work around a bug where the 'Showing' combobox doesn't update.
@@ -1482,9 +1818,14 @@ def start():
     setupStatusBar()
     hideColorByComponent()
     restoreNativeFileDialogsAction()
+    restoreThreadTopology()
+    restoreMemoryBudget()
     updateRecentFiles()
     createRPMBehaviour()
 
+    spreadSheetDock = getMainWindow().findChild('QDockWidget', 'spreadSheetDock')
+    spreadSheetDock.connect('visibilityChanged(bool)', onSpreadSheetDockVisibilityChanged)
+
 
 def findQObjectByName(widgets, name):
     for w in widgets:
@@ -1530,7 +1871,7 @@ def onFiringsSkipChanged(pr):
     if lidarPacketInterpreter:
         lidarPacketInterpreter.FiringsSkip = pr
         smp.Render()
-        smp.Render(getSpreadSheetViewProxy())
+        renderSpreadSheetView()
 
 
 def setupStatusBar():
@@ -1541,9 +1882,14 @@ def setupStatusBar():
     statusBar.addWidget(app.statusLabel)
     statusBar.addWidget(app.sensorInformationLabel)
     statusBar.addWidget(app.positionPacketInfoLabel)
+    statusBar.addWidget(app.telemetryLabel)
+    statusBar.addWidget(app.memoryLabel)
+    statusBar.addWidget(app.hoveredPointLabel)
+    app.telemetryTimer.start()
 
 
 def onGridProperties():
+    import gridAdjustmentDialog
     if gridAdjustmentDialog.showDialog(getMainWindow(), app.grid, app.gridProperties):
         rep = smp.Show(app.grid, None)
         rep.LineWidth = app.grid.LineWidth
@@ -1668,7 +2014,7 @@ def openRecentFile(filename):
         QtGui.QMessageBox.warning(getMainWindow(), 'File not found', 'File not found: %s' % filename)
         return
 
-    if os.path.splitext(filename)[1].lower() == '.pcap':
+    if os.path.splitext(filename)[1].lower() in ('.pcap', '.pcapng'):
         openPCAP(filename)
     else:
         openData(filename)
@@ -1755,16 +2101,16 @@ def toggleSelectDualReturn():
     polyData = selectedPoints.GetClientSideObject().GetOutput()
     nSelectedPoints = polyData.GetNumberOfPoints()
 
+    # the interpreter marks the dual returns of the selected returns in each frame, the returns
+    # being identified by their laser and azimuth, the selection follows the frames shown
+    interpreter = lidarPacketInterpreter.GetClientSideObject()
     if nSelectedPoints > 0:
-        idArray = polyData.GetPointData().GetArray('dual_return_matching')
-        idArray = polyData.GetBlock(0).GetPointData().GetArray('dual_return_matching')
-        # It should be possible to filter -1 from the idArray and then just use
-        # np.in1d below, but doing so generates errors (either an invalid
-        # expression, even when handling the case of an empty array, or an
-        # invalid non-mask return value.
-        selectedDualIds = set(str(int(idArray.GetValue(i))) for i in range(nSelectedPoints))
-        query = 'np.logical_and(dual_return_matching > -1, np.in1d(id, [{}]))'.format(','.join(selectedDualIds))
+        interpreter.SetSelectedPointsWithDualReturn(polyData.GetBlock(0))
+        interpreter.SetShouldAddDualReturnArray(True)
+        query = 'dual_return_selected > 0'
     else:
+        interpreter.SetSelectedPointsWithDualReturn(None)
+        interpreter.SetShouldAddDualReturnArray(False)
         query = 'dual_return_matching > -1'
     smp.SelectPoints(query)
     smp.Render()
@@ -1795,7 +2141,7 @@ def setFilterTo(mask):
         if interp.GetClientSideObject().GetHasDualReturn():
             interp.GetClientSideObject().SetDualReturnFilter(mask)
             smp.Render()
-            smp.Render(getSpreadSheetViewProxy())
+            renderSpreadSheetView()
         else:
             app.actions['actionDualReturnModeDual'].setChecked(True)
             QtGui.QMessageBox.warning(getMainWindow(), 'Dual returns not found',
@@ -1904,6 +2250,7 @@ def setupActions():
     app.actions['actionIgnoreZeroDistances'].connect('triggered()', onIgnoreZeroDistances)
     app.actions['actionIntraFiringAdjust'].connect('triggered()', onIntraFiringAdjust)
     app.actions['actionIgnoreEmptyFrames'].connect('triggered()', onIgnoreEmptyFrames)
+    app.actions['actionThreadTopology'].connect('triggered()', onThreadTopology)
 
     app.actions['actionPlaneFit'].connect('triggered()', planeFit)
 
@@ -0,0 +1,64 @@
+# Copyright 2019 Kitware, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from paraview.vtk.util import numpy_support
+from VelodyneHDLPluginPython import vtkLidarFrameIterator
+
+
+# The frames of a reader are decoded in C++ by the threads of the reader, on a
+# background thread which stays prefetch frames ahead, instead of setting the
+# animation time, updating the pipeline and fetching each frame. The points and
+# the point data arrays are NumPy views of the buffers of the frame, without
+# copy, which stay valid as long as they are referenced.
+# - reader: a lidar reader, its proxy or its client side object
+# - arrays: names of the point data arrays to give, all of them when None
+# Yields (frameNumber, points, arrays), points being a N x 3 array and arrays a
+# dictionary of the point data arrays by name
+def iterFrames(reader, firstFrame=0, lastFrame=-1, prefetch=2, arrays=None):
+    if hasattr(reader, 'GetClientSideObject'):
+        reader.UpdatePipelineInformation()
+        reader = reader.GetClientSideObject()
+
+    iterator = vtkLidarFrameIterator()
+    iterator.SetReader(reader)
+    iterator.SetNumberOfPrefetchedFrames(prefetch)
+    if not iterator.Start(firstFrame, lastFrame):
+        return
+
+    try:
+        while True:
+            frame = iterator.Next()
+            if frame is None:
+                break
+            points, pointArrays = frameArrays(frame, arrays)
+            yield iterator.GetFrameNumber(), points, pointArrays
+    finally:
+        iterator.Stop()
+
+
+# NumPy views of the points and of the point data arrays of a frame
+def frameArrays(frame, arrays=None):
+    points = frame.GetPoints()
+    pointsArray = numpy_support.vtk_to_numpy(points.GetData()) if points else None
+
+    pointData = frame.GetPointData()
+    namedArrays = {}
+    for i in range(pointData.GetNumberOfArrays()):
+        array = pointData.GetArray(i)
+        if array is None or array.GetName() is None:
+            continue
+        if arrays is not None and array.GetName() not in arrays:
+            continue
+        namedArrays[array.GetName()] = numpy_support.vtk_to_numpy(array)
+    return pointsArray, namedArrays
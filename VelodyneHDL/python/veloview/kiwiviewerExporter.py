@@ -75,6 +75,12 @@ def getSceneMetaData(view):
 
 def writeJsonData(outDir, view, rep, dataFilenames):
 
+    sceneFile = os.path.join(outDir, 'scene.kiwi')
+    open(sceneFile, 'w').write(getJsonData(view, rep, dataFilenames))
+
+
+def getJsonData(view, rep, dataFilenames):
+
     scene = getSceneMetaData(view)
 
     objectMetaData = getObjectMetaData(rep)
@@ -88,10 +94,7 @@ def writeJsonData(outDir, view, rep, dataFilenames):
 
     scene['objects'] = [objectMetaData]
 
-    jsonStr = json.dumps(scene, indent=4)
-
-    sceneFile = os.path.join(outDir, 'scene.kiwi')
-    open(sceneFile, 'w').write(jsonStr)
+    return json.dumps(scene, indent=4)
 
 
 def zipDir(inputDirectory, zipName):
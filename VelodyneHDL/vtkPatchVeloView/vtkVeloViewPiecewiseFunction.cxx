@@ -88,11 +88,43 @@ public:
 class vtkPiecewiseFunctionInternals
 {
 public:
+  vtkPiecewiseFunctionInternals() : LastInterval(0) {}
+
+  // Return the first node located after x, as std::upper_bound does. The
+  // function is usually evaluated at increasing locations, so the interval
+  // of the previous lookup and the next one are tried before searching
+  std::vector<vtkPiecewiseFunctionNode*>::iterator UpperBound(double x)
+    {
+    const size_t size = this->Nodes.size();
+    for (size_t i = this->LastInterval; i < this->LastInterval + 2 && i + 1 < size; ++i)
+      {
+      if (this->Nodes[i]->X <= x && x < this->Nodes[i + 1]->X)
+        {
+        this->LastInterval = i;
+        return this->Nodes.begin() + i + 1;
+        }
+      }
+
+    vtkPiecewiseFunctionNode node;
+    node.X = x;
+    std::vector<vtkPiecewiseFunctionNode*>::iterator upBound =
+      std::upper_bound(this->Nodes.begin(), this->Nodes.end(), &node, this->CompareNodes);
+    const size_t index = static_cast<size_t>(upBound - this->Nodes.begin());
+    if (index > 0 && index < size)
+      {
+      this->LastInterval = index - 1;
+      }
+    return upBound;
+    }
+
   std::vector<vtkPiecewiseFunctionNode*> Nodes;
   vtkPiecewiseFunctionCompareNodes        CompareNodes;
   vtkPiecewiseFunctionFindNodeEqual       FindNodeEqual;
   vtkPiecewiseFunctionFindNodeInRange     FindNodeInRange;
   vtkPiecewiseFunctionFindNodeOutOfRange  FindNodeOutOfRange;
+
+  // Index of the first node of the interval found by the last lookup
+  size_t LastInterval;
 };
 
 // Construct a new vtkPiecewiseFunction with default values
@@ -217,12 +249,9 @@ void vtkVeloViewPiecewiseFunction::GetTableDichotomic( double xStart, double xEn
       x = 0.5*(xStart+xEnd);
     }
 
-    vtkPiecewiseFunctionCompareNodes comparator;
-    vtkPiecewiseFunctionNode node;
-    node.X = x;
     std::vector<vtkPiecewiseFunctionNode*>::iterator lowBound;
     std::vector<vtkPiecewiseFunctionNode*>::iterator upBound;
-    upBound = std::upper_bound(this->Internal->Nodes.begin(), this->Internal->Nodes.end(), &node, comparator);
+    upBound = this->Internal->UpperBound(x);
 
     // Are we at the end? If so, just use the last value
     if (upBound == this->Internal->Nodes.end())
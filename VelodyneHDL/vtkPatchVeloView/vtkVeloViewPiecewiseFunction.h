@@ -78,7 +78,9 @@ public:
 
   // Description:
   // Returns the value of the function at the specified location using
-  // the specified interpolation.
+  // the specified interpolation. GetValueDichotomic() tries the interval of
+  // the previous call and the next one before a bisection, so evaluating the
+  // function at increasing locations takes a constant time.
   double GetValue( double x );
   double GetValueDichotomic( double x );
 
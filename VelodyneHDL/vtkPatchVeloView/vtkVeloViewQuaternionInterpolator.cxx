@@ -16,6 +16,7 @@
 #include "vtkObjectFactory.h"
 #include "vtkVeloViewQuaternion.h"
 #include "vtkVeloViewQuaternionInterpolator.h"
+#include <algorithm>
 #include <vector>
 
 vtkStandardNewMacro(vtkVeloViewQuaternionInterpolator);
@@ -42,8 +43,51 @@ struct TimedQuaternion
     }
 };
 
-// The list is arranged in increasing order in T
-class vtkVeloViewQuaternionList : public std::vector<TimedQuaternion> {};
+// The list is arranged in increasing order in T. It also caches the interval
+// found by the last interpolation, with the inner points of its spline, since
+// the quaternions are usually interpolated at increasing times.
+class vtkVeloViewQuaternionList : public std::vector<TimedQuaternion>
+{
+public:
+  vtkVeloViewQuaternionList()
+    {
+    this->Invalidate();
+    }
+
+  // Must be called each time the list is modified
+  void Invalidate()
+    {
+    this->LastInterval = 0;
+    this->InnerPointsInterval = -1;
+    }
+
+  // Return the index i of the first interval such that T_i <= t <= T_i+1,
+  // t being strictly inside the range of the list
+  int FindInterval(double t)
+    {
+    const int size = static_cast<int>(this->size());
+    for (int i = this->LastInterval; i < this->LastInterval + 2 && i + 1 < size; ++i)
+      {
+      if ((i == 0 || (*this)[i].Time < t) && t <= (*this)[i + 1].Time)
+        {
+        this->LastInterval = i;
+        return i;
+        }
+      }
+    TimedQuaternion timed;
+    timed.Time = t;
+    iterator lowBound = std::lower_bound(this->begin(), this->end(), timed,
+      [](const TimedQuaternion& a, const TimedQuaternion& b) { return a.Time < b.Time; });
+    this->LastInterval = std::max(static_cast<int>(lowBound - this->begin()) - 1, 0);
+    return this->LastInterval;
+    }
+
+  int LastInterval;
+
+  // Interval whose inner points ai and bi are cached, -1 if none is
+  int InnerPointsInterval;
+  vtkVeloViewQuaterniond InnerPoints[2];
+};
 typedef vtkVeloViewQuaternionList::iterator QuaternionListIterator;
 
 //----------------------------------------------------------------------------
@@ -101,6 +145,7 @@ void vtkVeloViewQuaternionInterpolator::Initialize()
 {
   // Wipe out old data
   this->QuaternionList->clear();
+  this->QuaternionList->Invalidate();
 }
 
 //----------------------------------------------------------------------------
@@ -114,6 +159,7 @@ void vtkVeloViewQuaternionInterpolator::AddQuaternion(double t, double q[4])
 void vtkVeloViewQuaternionInterpolator::AddQuaternion(double t,
                                               const vtkVeloViewQuaterniond& q)
 {
+  this->QuaternionList->Invalidate();
   int size = static_cast<int>(this->QuaternionList->size());
 
   // Check special cases: t at beginning or end of list
@@ -169,6 +215,7 @@ void vtkVeloViewQuaternionInterpolator::RemoveQuaternion(double t)
   if ( iter != this->QuaternionList->end() )
     {
     this->QuaternionList->erase(iter);
+    this->QuaternionList->Invalidate();
     }
 
   this->Modified();
@@ -199,7 +246,7 @@ void vtkVeloViewQuaternionInterpolator::InterpolateQuaternion(double t,
 
   else if ( t >= this->QuaternionList->back().Time )
     {
-    TimedQuaternion &Q = this->QuaternionList->front();
+    TimedQuaternion &Q = this->QuaternionList->back();
     q = Q.Q;
     return;
     }
@@ -207,79 +254,49 @@ void vtkVeloViewQuaternionInterpolator::InterpolateQuaternion(double t,
   // Depending on the interpolation type we do the right thing.
   // The code above guarantees that there are at least two quaternions defined.
   int numQuats = this->GetNumberOfQuaternions();
+  const int i = this->QuaternionList->FindInterval(t);
+  QuaternionListIterator iter = this->QuaternionList->begin() + i;
+  QuaternionListIterator nextIter = iter + 1;
+  const double T = (t - iter->Time) / (nextIter->Time - iter->Time);
   if ( this->InterpolationType == INTERPOLATION_TYPE_LINEAR || numQuats < 3 )
     {
-    QuaternionListIterator iter = this->QuaternionList->begin();
-    QuaternionListIterator nextIter = iter + 1;
-    for ( ; nextIter != this->QuaternionList->end(); ++iter, ++nextIter)
-      {
-      if ( iter->Time <= t && t <= nextIter->Time )
-        {
-        double T = (t - iter->Time) / (nextIter->Time - iter->Time);
-        q = iter->Q.Slerp(T,nextIter->Q);
-        break;
-        }
-      }
+    q = iter->Q.Slerp(T,nextIter->Q);
     }//if linear quaternion interpolation
 
   else // this->InterpolationType == INTERPOLATION_TYPE_SPLINE
     {
-    QuaternionListIterator iter = this->QuaternionList->begin();
-    QuaternionListIterator nextIter = iter + 1;
-    QuaternionListIterator iter0, iter1, iter2, iter3;
-
-    //find the interval
-    double T=0.0;
-    int i;
-    for (i=0; nextIter != this->QuaternionList->end(); ++iter, ++nextIter, ++i)
+    vtkVeloViewQuaterniond& ai = this->QuaternionList->InnerPoints[0];
+    vtkVeloViewQuaterniond& bi = this->QuaternionList->InnerPoints[1];
+    if ( this->QuaternionList->InnerPointsInterval != i )
       {
-      if ( iter->Time <= t && t <= nextIter->Time )
+      if ( i == 0 ) //initial interval
         {
-        T = (t - iter->Time) / (nextIter->Time - iter->Time);
-        break;
+        ai = iter->Q.Normalized(); //just duplicate first quaternion
+        vtkVeloViewQuaterniond q1 = iter->Q.Normalized();
+        bi = q1.InnerPoint(nextIter->Q.Normalized(), (nextIter + 1)->Q.Normalized());
         }
-      }
-
-    vtkVeloViewQuaterniond ai, bi, qc, qd;
-    if ( i == 0 ) //initial interval
-      {
-      iter1 = iter;
-      iter2 = nextIter;
-      iter3 = nextIter + 1;
-
-      ai = iter1->Q.Normalized(); //just duplicate first quaternion
-      vtkVeloViewQuaterniond q1 = iter1->Q.Normalized();
-      bi = q1.InnerPoint(iter2->Q.Normalized(), iter3->Q.Normalized());
-      }
-    else if ( i == (numQuats-2) ) //final interval
-      {
-      iter0 = iter - 1;
-      iter1 = iter;
-      iter2 = nextIter;
-
-      vtkVeloViewQuaterniond q0 = iter0->Q.Normalized();
-      ai = q0.InnerPoint(iter1->Q.Normalized(), iter2->Q.Normalized());
-
-      bi = iter2->Q.Normalized(); //just duplicate last quaternion
-      }
-    else //in a middle interval somewhere
-      {
-      iter0 = iter - 1;
-      iter1 = iter;
-      iter2 = nextIter;
-      iter3 = nextIter + 1;
+      else if ( i == (numQuats-2) ) //final interval
+        {
+        vtkVeloViewQuaterniond q0 = (iter - 1)->Q.Normalized();
+        ai = q0.InnerPoint(iter->Q.Normalized(), nextIter->Q.Normalized());
 
-      vtkVeloViewQuaterniond q0 = iter0->Q.Normalized();
-      ai = q0.InnerPoint(iter1->Q.Normalized(), iter2->Q.Normalized());
+        bi = nextIter->Q.Normalized(); //just duplicate last quaternion
+        }
+      else //in a middle interval somewhere
+        {
+        vtkVeloViewQuaterniond q0 = (iter - 1)->Q.Normalized();
+        ai = q0.InnerPoint(iter->Q.Normalized(), nextIter->Q.Normalized());
 
-      vtkVeloViewQuaterniond q1 = iter1->Q.Normalized();
-      bi = q1.InnerPoint(iter2->Q.Normalized(), iter3->Q.Normalized());
+        vtkVeloViewQuaterniond q1 = iter->Q.Normalized();
+        bi = q1.InnerPoint(nextIter->Q.Normalized(), (nextIter + 1)->Q.Normalized());
+        }
+      this->QuaternionList->InnerPointsInterval = i;
       }
 
     // These three Slerp operations implement a Squad interpolation
-    vtkVeloViewQuaterniond q1 = iter1->Q.Normalized();
-    qc = q1.Slerp(T,iter2->Q.Normalized());
-    qd = ai.Slerp(T,bi);
+    vtkVeloViewQuaterniond q1 = iter->Q.Normalized();
+    vtkVeloViewQuaterniond qc = q1.Slerp(T,nextIter->Q.Normalized());
+    vtkVeloViewQuaterniond qd = ai.Slerp(T,bi);
     q = qc.Slerp(2.0*T*(1.0-T),qd);
     q.NormalizeWithAngleInDegrees();
     }
@@ -111,7 +111,9 @@ public:
    * fill in the tuple provided). If t is outside the range of
    * (min,max) values, then t is clamped. Note that each component
    * of tuple[] is interpolated independently. This method perform
-   * a dichotomic search if the interpolator is linear.
+   * a dichotomic search if the interpolator is linear, after trying the
+   * interval of the previous call, so that increasing times are
+   * interpolated in constant time.
    */
   void InterpolateTupleDichotomic(double t, double tuple[]);
 
@@ -0,0 +1,174 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vvLiveSourceBehavior.h"
+
+#include "vtkLidarFrameStreamSource.h"
+#include "vtkLidarStream.h"
+
+#include <pqApplicationCore.h>
+#include <pqPipelineSource.h>
+#include <pqServerManagerModel.h>
+#include <pqSettings.h>
+
+#include <vtkSMSourceProxy.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+const double DefaultMaximumRenderRate = 30.0;
+
+//-----------------------------------------------------------------------------
+/// Set the callback of the sources notifying their frames, return false for the other objects
+bool SetNewFrameCallback(vtkObjectBase* object, const boost::function<void()>& callback)
+{
+  if (vtkLidarStream* stream = vtkLidarStream::SafeDownCast(object))
+  {
+    stream->SetNewFrameCallback(callback);
+    return true;
+  }
+  if (vtkLidarFrameStreamSource* source = vtkLidarFrameStreamSource::SafeDownCast(object))
+  {
+    source->SetNewFrameCallback(callback);
+    return true;
+  }
+  return false;
+}
+}
+
+//-----------------------------------------------------------------------------
+vvLiveSourceBehavior::vvLiveSourceBehavior(QObject* parentObject)
+  : Superclass(parentObject)
+  , MaximumRenderRate(DefaultMaximumRenderRate)
+  , NotificationPosted(0)
+{
+  this->Throttle.setSingleShot(true);
+  this->connect(&this->Throttle, SIGNAL(timeout()), SLOT(update()));
+  this->Clock.start();
+
+  pqApplicationCore* core = pqApplicationCore::instance();
+  this->setMaximumRenderRate(
+    core->settings()
+      ->value("VelodyneHDLPlugin/LiveSource/MaximumRenderRate", DefaultMaximumRenderRate)
+      .toDouble());
+
+  pqServerManagerModel* model = core->getServerManagerModel();
+  this->connect(model, SIGNAL(sourceAdded(pqPipelineSource*)),
+    SLOT(onSourceAdded(pqPipelineSource*)));
+  this->connect(model, SIGNAL(preSourceRemoved(pqPipelineSource*)),
+    SLOT(onSourceRemoved(pqPipelineSource*)));
+  foreach (pqPipelineSource* source, model->findItems<pqPipelineSource*>())
+  {
+    this->onSourceAdded(source);
+  }
+}
+
+//-----------------------------------------------------------------------------
+vvLiveSourceBehavior::~vvLiveSourceBehavior()
+{
+  // the streams may outlive the behavior, they must not notify it anymore
+  foreach (const vtkWeakPointer<vtkObjectBase>& stream, this->Streams)
+  {
+    SetNewFrameCallback(stream, boost::function<void()>());
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvLiveSourceBehavior::setMaximumRenderRate(double rate)
+{
+  this->MaximumRenderRate = std::max(rate, 0.0);
+}
+
+//-----------------------------------------------------------------------------
+void vvLiveSourceBehavior::onSourceAdded(pqPipelineSource* source)
+{
+  vtkObjectBase* stream = source->getProxy()->GetClientSideObject();
+  if (SetNewFrameCallback(stream, boost::bind(&vvLiveSourceBehavior::notify, this)))
+  {
+    this->Streams.insert(source, stream);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvLiveSourceBehavior::onSourceRemoved(pqPipelineSource* source)
+{
+  SetNewFrameCallback(this->Streams.take(source), boost::function<void()>());
+}
+
+//-----------------------------------------------------------------------------
+void vvLiveSourceBehavior::notify()
+{
+  // the frames received before the update are shown together, so a single event is posted
+  if (this->NotificationPosted.testAndSetOrdered(0, 1))
+  {
+    QMetaObject::invokeMethod(this, "onNewFrame", Qt::QueuedConnection);
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvLiveSourceBehavior::onNewFrame()
+{
+  // the update waiting for the render rate will show this frame too
+  if (!this->Throttle.isActive())
+  {
+    this->update();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvLiveSourceBehavior::update()
+{
+  if (this->MaximumRenderRate > 0)
+  {
+    const qint64 period = static_cast<qint64>(std::ceil(1e3 / this->MaximumRenderRate));
+    const qint64 wait = period - this->Clock.elapsed();
+    if (wait > 0)
+    {
+      this->Throttle.start(static_cast<int>(wait));
+      return;
+    }
+  }
+  this->Clock.restart();
+
+  // a frame received from now on posts another notification
+  this->NotificationPosted.storeRelease(0);
+
+  for (auto it = this->Streams.begin(); it != this->Streams.end(); ++it)
+  {
+    vtkSMSourceProxy* proxy = vtkSMSourceProxy::SafeDownCast(it.key()->getProxy());
+    if (!it.value() || !proxy)
+    {
+      continue;
+    }
+    // Poll modifies the stream when it has new frames, and the proxy is marked modified so
+    // that the views update it
+    proxy->InvokeCommand("Poll");
+    proxy->UpdatePipelineInformation();
+    it.key()->renderAllViews();
+
+    // the frames waiting for slow filters are given by the next updates
+    vtkLidarStream* stream = vtkLidarStream::SafeDownCast(it.value());
+    if (stream && stream->GetNumberOfPendingFrames() > 0)
+    {
+      this->notify();
+    }
+  }
+}
@@ -0,0 +1,81 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef __vvLiveSourceBehavior_h
+#define __vvLiveSourceBehavior_h
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QObject>
+#include <QTimer>
+
+#include <vtkWeakPointer.h>
+
+#include "vvConfigure.h"
+
+class pqPipelineSource;
+class vtkObjectBase;
+
+/// vvLiveSourceBehavior updates the live streams when they receive a frame, instead of polling
+/// them on a timer like pqLiveSourceBehavior. The decoding thread of each vtkLidarStream, or
+/// the receiving thread of each vtkLidarFrameStreamSource, posts a notification to the GUI
+/// thread, which polls the stream, updates its time steps and renders
+/// its views, at most MaximumRenderRate times per second. The frames received meanwhile are
+/// shown by the next update.
+class VelodyneHDLPythonQT_EXPORT vvLiveSourceBehavior : public QObject
+{
+  Q_OBJECT
+  typedef QObject Superclass;
+
+public:
+  /// The maximum render rate is read from the setting
+  /// VelodyneHDLPlugin/LiveSource/MaximumRenderRate, 30 by default
+  vvLiveSourceBehavior(QObject* parent = 0);
+  virtual ~vvLiveSourceBehavior();
+
+  /// Highest number of updates per second, 0 updates for each frame
+  void setMaximumRenderRate(double rate);
+  double maximumRenderRate() const { return this->MaximumRenderRate; }
+
+private slots:
+  void onSourceAdded(pqPipelineSource* source);
+  void onSourceRemoved(pqPipelineSource* source);
+
+  /// Called through the event loop when a stream has a new frame
+  void onNewFrame();
+
+  /// Poll the streams and render them, or wait until the render rate allows it
+  void update();
+
+private:
+  Q_DISABLE_COPY(vvLiveSourceBehavior)
+
+  /// Called on the decoding threads, posts a single onNewFrame until it is handled
+  void notify();
+
+  /// vtkLidarStream or vtkLidarFrameStreamSource
+  QMap<pqPipelineSource*, vtkWeakPointer<vtkObjectBase> > Streams;
+  double MaximumRenderRate;
+  QAtomicInt NotificationPosted;
+  /// Fires when the render rate allows the next update
+  QTimer Throttle;
+  /// Time since the last update
+  QElapsedTimer Clock;
+};
+
+#endif
@@ -94,6 +94,30 @@ public slots:
   {
     pqVelodyneManager::saveFramesToLAS(arg0, arg1, arg2, arg3, arg4, arg5);
   }
+
+  void static_pqVelodyneManager_saveFramesToLAS(vtkLidarReader* arg0, vtkPolyData* arg1,
+    int arg2, int arg3, const QString& arg4, int arg5, vtkVelodyneTransformInterpolator* arg6)
+  {
+    pqVelodyneManager::saveFramesToLAS(arg0, arg1, arg2, arg3, arg4, arg5, arg6);
+  }
+
+  bool static_pqVelodyneManager_exportFrames(vtkLidarReader* arg0, int arg1, int arg2,
+    const QString& arg3, int arg4, const QStringList& arg5, int arg6)
+  {
+    return pqVelodyneManager::exportFrames(arg0, arg1, arg2, arg3, arg4, arg5, arg6);
+  }
+
+  bool static_pqVelodyneManager_exportFramesToKiwiViewer(vtkLidarReader* arg0, int arg1,
+    int arg2, const QString& arg3, const QString& arg4, const QString& arg5)
+  {
+    return pqVelodyneManager::exportFramesToKiwiViewer(arg0, arg1, arg2, arg3, arg4, arg5);
+  }
+
+  bool static_pqVelodyneManager_saveFrameToCSV(
+    vtkPolyData* arg0, const QString& arg1, const QStringList& arg2, int arg3)
+  {
+    return pqVelodyneManager::saveFrameToCSV(arg0, arg1, arg2, arg3);
+  }
 };
 
 #endif
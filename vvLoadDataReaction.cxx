@@ -116,7 +116,7 @@ pqPipelineSource* vvLoadDataReaction::loadData()
   if (this->SeparatePositionFile)
   {
     fileName = QFileDialog::getOpenFileName(pqCoreUtilities::mainWidget(), tr("Open LiDAR File"),
-      defaultDir, "Wireshark Capture (*.pcap);;All files(*)");
+      defaultDir, "Wireshark Capture (*.pcap *.pcapng);;All files(*)");
 
     if (fileName.isEmpty())
     {
@@ -53,8 +53,6 @@
 #include <pqHelpReaction.h>
 #include <pqServer.h>
 #include <pqSettings.h>
-#include <pqSpreadSheetView.h>
-#include <pqSpreadSheetViewDecorator.h>
 #include <pqSpreadSheetVisibilityBehavior.h>
 #include <pqStandardPropertyWidgetInterface.h>
 #include <pqStandardViewFrameActionsImplementation.h>
@@ -66,7 +64,6 @@
 #include <vtkSMPropertyHelper.h>
 #include "pqAxesToolbar.h"
 #include "pqCameraToolbar.h"
-#include <pqLiveSourceBehavior.h>
 
 #include <QToolBar>
 #include <QShortcut>
@@ -78,6 +75,7 @@
 #include <iostream>
 #include <sstream>
 
+#include "vvLiveSourceBehavior.h"
 #include "vvPlayerControlsToolbar.h"
 
 // Declare the plugin to load.
@@ -143,7 +141,7 @@ private:
     new pqAutoLoadPluginXMLBehavior(window);
     new pqDataTimeStepBehavior(window);
     new pqCommandLineOptionsBehavior(window);
-    new pqLiveSourceBehavior(window);
+    new vvLiveSourceBehavior(window);
 
     pqApplyBehavior* applyBehaviors = new pqApplyBehavior(window);
 
@@ -212,17 +210,8 @@ private:
     mv->setTabVisibility(false);
     window->setCentralWidget(mv);
 
-    // create SpreadSheet
-    pqSpreadSheetView* spreadsheetView = qobject_cast<pqSpreadSheetView*>
-        (builder->createView(pqSpreadSheetView::spreadsheetViewType(), server, true));
-    spreadsheetView->rename("main spreadsheet view");
-    assert(spreadsheetView);
-    this->Ui.spreadSheetDock->setWidget(spreadsheetView->widget());
-    spreadsheetView->getProxy()->UpdateVTKObjects();
-    new vvToggleSpreadSheetReaction(this->Ui.actionSpreadsheet, spreadsheetView);
-    pqSpreadSheetViewDecorator* dec = new pqSpreadSheetViewDecorator(spreadsheetView);
-    dec->setPrecision(3);
-    dec->setFixedRepresentation(true);
+    // the SpreadSheet is created when its dock is first shown
+    new vvToggleSpreadSheetReaction(this->Ui.actionSpreadsheet, this->Ui.spreadSheetDock);
 
     pqRenderView* view =
       qobject_cast<pqRenderView*>(builder->createView(pqRenderView::renderViewType(), server));
@@ -432,7 +421,7 @@ void vvMainWindow::dropEvent(QDropEvent* evt)
     return;
   }
 
-  if (files[0].endsWith(".pcap"))
+  if (files[0].endsWith(".pcap") || files[0].endsWith(".pcapng"))
   {
     pqVelodyneManager::instance()->runPython(QString("vv.openPCAP('" + files[0] + "')"));
   }
@@ -0,0 +1,96 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#include "vvPlaybackScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+//! Weight of the last frame in the averages, about the last ten frames count
+const double AverageWeight = 0.2;
+//! Prefetched frames when the frames are shown as fast as possible
+const int AsFastAsPossiblePrefetchFrames = 8;
+//! Ratio of the target below which the playback is lagging
+const double LaggingRatio = 0.9;
+}
+
+const int vvPlaybackScheduler::MinPrefetchFrames;
+const int vvPlaybackScheduler::MaxPrefetchFrames;
+
+//-----------------------------------------------------------------------------
+void vvPlaybackScheduler::Start(Policy policy, double targetFrameRate, double now)
+{
+  this->PlaybackPolicy = policy;
+  this->TargetFrameRate = std::max(targetFrameRate, 0.0);
+  this->AchievedFrameRate = 0.0;
+  this->FrameCost = 0.0;
+  this->LastFrameTime = now;
+  this->NumberOfFrames = 0;
+}
+
+//-----------------------------------------------------------------------------
+void vvPlaybackScheduler::FrameShown(double begin, double end)
+{
+  const double cost = std::max(end - begin, 0.0);
+  const double interval = end - this->LastFrameTime;
+  this->LastFrameTime = end;
+  if (this->NumberOfFrames == 0)
+  {
+    this->FrameCost = cost;
+    this->AchievedFrameRate = interval > 0.0 ? 1.0 / interval : 0.0;
+  }
+  else
+  {
+    this->FrameCost += AverageWeight * (cost - this->FrameCost);
+    if (interval > 0.0)
+    {
+      this->AchievedFrameRate += AverageWeight * (1.0 / interval - this->AchievedFrameRate);
+    }
+  }
+  ++this->NumberOfFrames;
+}
+
+//-----------------------------------------------------------------------------
+double vvPlaybackScheduler::GetNextFrameTime() const
+{
+  if (this->PlaybackPolicy != EVERY_FRAME || this->TargetFrameRate <= 0.0)
+  {
+    return this->LastFrameTime;
+  }
+  // the request and the processing of the next frame take about FrameCost
+  return this->LastFrameTime + 1.0 / this->TargetFrameRate - this->FrameCost;
+}
+
+//-----------------------------------------------------------------------------
+int vvPlaybackScheduler::GetPrefetchFrames() const
+{
+  if (this->TargetFrameRate <= 0.0)
+  {
+    return AsFastAsPossiblePrefetchFrames;
+  }
+  const int framesPerCost = static_cast<int>(std::ceil(this->FrameCost * this->TargetFrameRate));
+  return std::min(MaxPrefetchFrames, std::max(MinPrefetchFrames, framesPerCost + MinPrefetchFrames));
+}
+
+//-----------------------------------------------------------------------------
+bool vvPlaybackScheduler::IsLagging() const
+{
+  return this->TargetFrameRate > 0.0 && this->NumberOfFrames > 1 &&
+    this->AchievedFrameRate < LaggingRatio * this->TargetFrameRate;
+}
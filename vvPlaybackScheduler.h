@@ -0,0 +1,85 @@
+//=========================================================================
+//
+// Copyright 2019 Kitware, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//=========================================================================
+
+#ifndef VVPLAYBACKSCHEDULER_H
+#define VVPLAYBACKSCHEDULER_H
+
+/**
+ * @brief vvPlaybackScheduler measures what a frame costs during a playback (decoding,
+ * filters and rendering) and decides how the playback keeps up with its target rate:
+ * - REAL_TIME follows the clock, the frames which are not ready in time are skipped
+ * - EVERY_FRAME shows all the frames, at most at the target rate, the playback slows
+ *   down when a frame costs more than its period
+ * It also gives how many frames the readers should decode in advance so that the cost of
+ * the decoding is hidden, and the achieved rate to compare with the target.
+ * The times are in seconds, given by the caller.
+ */
+class vvPlaybackScheduler
+{
+public:
+  enum Policy { REAL_TIME = 0, EVERY_FRAME };
+
+  /**
+   * @brief Start a playback
+   * @param targetFrameRate frames shown per second, 0 to show them as fast as possible
+   * @param now current time
+   */
+  void Start(Policy policy, double targetFrameRate, double now);
+
+  /**
+   * @brief FrameShown record a frame, requested at begin and shown at end
+   */
+  void FrameShown(double begin, double end);
+
+  /**
+   * @brief GetNextFrameTime time before which the next frame must not be requested, so that
+   * EVERY_FRAME does not exceed the target rate
+   */
+  double GetNextFrameTime() const;
+
+  /**
+   * @brief GetPrefetchFrames number of frames to decode in advance: the frames that go by
+   * while a frame is processed, with a margin
+   */
+  int GetPrefetchFrames() const;
+
+  //! Frames shown per second, averaged over the last frames
+  double GetAchievedFrameRate() const { return this->AchievedFrameRate; }
+  double GetTargetFrameRate() const { return this->TargetFrameRate; }
+
+  //! Average time in seconds from the request of a frame until it is shown
+  double GetFrameCost() const { return this->FrameCost; }
+
+  Policy GetPolicy() const { return this->PlaybackPolicy; }
+
+  //! True if the achieved rate is clearly below the target
+  bool IsLagging() const;
+
+  //! Bounds of GetPrefetchFrames
+  static const int MinPrefetchFrames = 2;
+  static const int MaxPrefetchFrames = 32;
+
+private:
+  Policy PlaybackPolicy = REAL_TIME;
+  double TargetFrameRate = 0.0;
+  double AchievedFrameRate = 0.0;
+  double FrameCost = 0.0;
+  double LastFrameTime = 0.0;
+  int NumberOfFrames = 0;
+};
+
+#endif // VVPLAYBACKSCHEDULER_H
@@ -34,6 +34,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // ParaView Server Manager includes.
 #include "vtkSMIntRangeDomain.h"
 #include "vtkSMIntVectorProperty.h"
+#include "vtkSMPropertyHelper.h"
 #include "vtkSMProxy.h"
 #include "vtkSMTrace.h"
 
@@ -41,6 +42,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QPointer>
 #include <QtDebug>
 #include <QApplication>
+#include <QThread>
+
+#include <algorithm>
+#include <cmath>
 
 // ParaView includes.
 #include "pqAnimationScene.h"
@@ -48,6 +53,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "pqEventDispatcher.h"
 #include "pqPipelineSource.h"
 #include "pqSMAdaptor.h"
+#include "pqServerManagerModel.h"
 #include "pqUndoStack.h"
 #include "vtkAnimationScene.h"
 
@@ -58,14 +64,64 @@ void SetProperty(QPointer<pqAnimationScene> scene, const char* property, int val
       (scene->getProxy()->GetProperty(property))->SetElements1(value);
   scene->getProxy()->UpdateProperty(property);
 }
+
+// Number of frames the lidar readers decode in advance when stepping frame by frame, and
+// per unit of speed when playing
+const int SteppingPrefetchFrames = 1;
+const int PlayingPrefetchFramesPerSpeed = 4;
+const int MaxPrefetchFrames = vvPlaybackScheduler::MaxPrefetchFrames;
+
+// Period of the frame rate reports, in seconds
+const double FrameRateReportPeriod = 0.5;
+// Longest sleep while waiting for the next frame, so that the events are processed
+const int MaxWaitMilliseconds = 5;
+
+// Tell the lidar readers which frames will be requested next, so that they are decoded in
+// background (see vtkLidarReader::SetPrefetchFrames)
+void SetPrefetch(int numberOfFrames, int direction)
+{
+  pqServerManagerModel* model = pqApplicationCore::instance()->getServerManagerModel();
+  foreach (pqPipelineSource* source, model->findItems<pqPipelineSource*>())
+  {
+    vtkSMProxy* proxy = source->getProxy();
+    if (proxy->GetProperty("PrefetchFrames") && proxy->GetProperty("PrefetchDirection"))
+    {
+      vtkSMPropertyHelper(proxy, "PrefetchFrames").Set(numberOfFrames);
+      vtkSMPropertyHelper(proxy, "PrefetchDirection").Set(direction);
+      proxy->UpdateVTKObjects();
+    }
+  }
+}
+
+// Tell the lidar readers that the time slider is dragged, so that they show a preview of the
+// frames which are not decoded yet (see vtkLidarReader::SetScrubbing)
+void SetScrubbing(bool scrubbing)
+{
+  pqServerManagerModel* model = pqApplicationCore::instance()->getServerManagerModel();
+  foreach (pqPipelineSource* source, model->findItems<pqPipelineSource*>())
+  {
+    vtkSMProxy* proxy = source->getProxy();
+    if (proxy->GetProperty("Scrubbing"))
+    {
+      vtkSMPropertyHelper(proxy, "Scrubbing").Set(scrubbing ? 1 : 0);
+      proxy->UpdateVTKObjects();
+    }
+  }
+}
 }
 
 //-----------------------------------------------------------------------------
 vvPlayerControlsController::vvPlayerControlsController(QObject* _parent/*=null*/)
   : QObject(_parent),
     speed(1),
-    duration(0)
+    duration(0),
+    everyFrame(false),
+    isPlaying(false),
+    lastTickEnd(0),
+    lastReportTime(0),
+    prefetchFrames(SteppingPrefetchFrames)
 {
+  this->clock.start();
 }
 
 //-----------------------------------------------------------------------------
@@ -136,16 +192,31 @@ void vvPlayerControlsController::onPlay()
     .arg(this->Scene->getProxy())
     .arg("Play");
 
-  if (speed != 0)
+  // frames shown per second at this speed, the clock range holding all the timesteps
+  const int numberOfTimesteps = this->Scene->getTimeSteps().size();
+  const double targetFrameRate = (this->speed != 0 && this->duration > 0)
+    ? (numberOfTimesteps - 1) / this->duration * this->speed : 0;
+
+  if (speed != 0 && !this->everyFrame)
   {
     SetProperty(this->Scene, "Duration", this->duration / this->speed);
     SetProperty(this->Scene, "PlayMode", vtkAnimationScene::PLAYMODE_REALTIME);
+    // the faster we play, the more frames must be ready in advance, until their cost is known
+    this->prefetchFrames = std::min(MaxPrefetchFrames,
+      std::max(2, static_cast<int>(std::ceil(PlayingPrefetchFramesPerSpeed * speed))));
+    this->scheduler.Start(vvPlaybackScheduler::REAL_TIME, targetFrameRate, this->now());
   }
   else
   {
     // there is no enum for mode 2...
     SetProperty(this->Scene, "PlayMode", 2);
+    // every frame is played, as fast as possible for "All frames", else throttled in onTick
+    this->prefetchFrames = MaxPrefetchFrames / 4;
+    this->scheduler.Start(vvPlaybackScheduler::EVERY_FRAME, targetFrameRate, this->now());
   }
+  SetPrefetch(this->prefetchFrames, 1);
+  this->lastTickEnd = this->now();
+  this->lastReportTime = this->lastTickEnd;
 
   this->Scene->getProxy()->InvokeCommand("Play");
 
@@ -161,15 +232,58 @@ void vvPlayerControlsController::onTick()
 {
   // No need to explicitly update all views,
   // the animation scene proxy does it.
+  if (this->isPlaying)
+  {
+    const double shown = this->now();
+    this->scheduler.FrameShown(this->lastTickEnd, shown);
+    this->updatePlayback(shown);
+  }
 
   // process the events so that the GUI remains responsive.
   QApplication::processEvents();
   emit this->timestepChanged();
+
+  // under the "every frame" policy, wait until the next frame is due, the events are still
+  // processed so that the playback can be paused
+  double wait;
+  while (this->isPlaying && (wait = this->scheduler.GetNextFrameTime() - this->now()) > 0)
+  {
+    QThread::msleep(std::min(MaxWaitMilliseconds, static_cast<int>(std::ceil(wait * 1e3))));
+    QApplication::processEvents();
+  }
+  this->lastTickEnd = this->now();
+}
+
+//-----------------------------------------------------------------------------
+double vvPlayerControlsController::now() const
+{
+  return this->clock.nsecsElapsed() * 1e-9;
+}
+
+//-----------------------------------------------------------------------------
+void vvPlayerControlsController::updatePlayback(double now)
+{
+  // the prefetch depth follows the measured cost of the frames, the readers are only updated
+  // when it changes
+  const int prefetch = this->scheduler.GetPrefetchFrames();
+  if (prefetch != this->prefetchFrames)
+  {
+    this->prefetchFrames = prefetch;
+    SetPrefetch(prefetch, 1);
+  }
+
+  if (now - this->lastReportTime >= FrameRateReportPeriod)
+  {
+    this->lastReportTime = now;
+    emit this->frameRate(this->scheduler.GetAchievedFrameRate(),
+      this->scheduler.GetTargetFrameRate(), this->scheduler.IsLagging());
+  }
 }
 
 //-----------------------------------------------------------------------------
 void vvPlayerControlsController::onBeginPlay()
 {
+  this->isPlaying = true;
   emit this->playing(true);
   emit this->beginNonUndoableChanges();
 }
@@ -177,6 +291,9 @@ void vvPlayerControlsController::onBeginPlay()
 //-----------------------------------------------------------------------------
 void vvPlayerControlsController::onEndPlay()
 {
+  this->isPlaying = false;
+  this->prefetchFrames = SteppingPrefetchFrames;
+  SetPrefetch(SteppingPrefetchFrames, 1);
   emit this->playing(false);
   emit this->endNonUndoableChanges();
 }
@@ -214,6 +331,7 @@ void vvPlayerControlsController::onPause()
 void vvPlayerControlsController::onFirstFrame()
 {
   emit this->beginNonUndoableChanges();
+  SetPrefetch(SteppingPrefetchFrames, 1);
   this->Scene->getProxy()->InvokeCommand("GoToFirst");
   SM_SCOPED_TRACE(CallMethod)
     .arg(this->Scene->getProxy())
@@ -226,6 +344,7 @@ void vvPlayerControlsController::onPreviousFrame()
 {
   emit this->beginNonUndoableChanges();
   SetProperty(this->Scene, "PlayMode", 2);
+  SetPrefetch(SteppingPrefetchFrames, -1);
   this->Scene->getProxy()->InvokeCommand("GoToPrevious");
   SM_SCOPED_TRACE(CallMethod)
     .arg(this->Scene->getProxy())
@@ -238,6 +357,7 @@ void vvPlayerControlsController::onNextFrame()
 {
   emit this->beginNonUndoableChanges();
   SetProperty(this->Scene, "PlayMode", 2);
+  SetPrefetch(SteppingPrefetchFrames, 1);
   this->Scene->getProxy()->InvokeCommand("GoToNext");
   SM_SCOPED_TRACE(CallMethod)
     .arg(this->Scene->getProxy())
@@ -249,6 +369,7 @@ void vvPlayerControlsController::onNextFrame()
 void vvPlayerControlsController::onLastFrame()
 {
   emit this->beginNonUndoableChanges();
+  SetPrefetch(SteppingPrefetchFrames, -1);
   this->Scene->getProxy()->InvokeCommand("GoToLast");
   SM_SCOPED_TRACE(CallMethod)
     .arg(this->Scene->getProxy())
@@ -263,3 +384,21 @@ void vvPlayerControlsController::onSpeedChange(double speed)
   this->onPause();
 }
 
+//-----------------------------------------------------------------------------
+void vvPlayerControlsController::onScrubbing(bool scrubbing)
+{
+  SetScrubbing(scrubbing);
+  if (!scrubbing)
+  {
+    // the previews shown while scrubbing are replaced by the full frames
+    pqApplicationCore::instance()->render();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvPlayerControlsController::onPolicyChange(bool everyFrame)
+{
+  this->everyFrame = everyFrame;
+  this->onPause();
+}
+
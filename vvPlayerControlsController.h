@@ -34,6 +34,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #include "pqComponentsModule.h"
+#include "vvPlaybackScheduler.h"
+#include <QElapsedTimer>
 #include <QPointer>
 #include <QObject>
 
@@ -74,6 +76,10 @@ signals:
 
   void timeRanges(double, double);
 
+  /// emitted about twice a second while playing, with the frames shown per second, the
+  /// target and whether the playback cannot keep up with it
+  void frameRate(double achieved, double target, bool lagging);
+
   /// emitted when the animation begins playing.
   /// For now, playing of animation is non-undoable.
   void beginNonUndoableChanges();
@@ -99,6 +105,13 @@ public slots:
   void onLoop(bool checked);
   void onSpeedChange(double speed);
 
+  // true to show every frame and slow down when they cannot be decoded in time, false to
+  // follow the clock and skip them
+  void onPolicyChange(bool everyFrame);
+
+  // true while the time slider is dragged, the readers then show previews of the frames
+  void onScrubbing(bool scrubbing);
+
 protected slots:
   void onTick();
   void onLoopPropertyChanged();
@@ -109,9 +122,24 @@ private:
   vvPlayerControlsController(const vvPlayerControlsController&); // Not implemented.
   void operator=(const vvPlayerControlsController&); // Not implemented.
 
+  /// seconds since the controller was created
+  double now() const;
+
+  /// adapt the prefetch of the readers to the cost of the frames and report the frame rate
+  void updatePlayback(double now);
+
   QPointer<pqAnimationScene> Scene;
   double speed;
   double duration;
+  bool everyFrame;
+  bool isPlaying;
+
+  vvPlaybackScheduler scheduler;
+  QElapsedTimer clock;
+  /// time when the last tick returned to the scene, which then requests the next frame
+  double lastTickEnd;
+  double lastReportTime;
+  int prefetchFrames;
 };
 
 #endif // VVPLAYERCONTROLSCONTROLLER_H
@@ -36,6 +36,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <limits>
 
 #include <QLabel>
+#include <QCheckBox>
 #include <QComboBox>
 #include <QSlider>
 #include <QSpinBox>
@@ -64,10 +65,12 @@ public:
   pqPropertyLinks Links;
   QList<QPair<double, QString> > speedFactor;
   QComboBox* speedComboBox;
+  QCheckBox* everyFrameCheckBox;
   QSlider* frameSlider;
   QDoubleSpinBox* timeSpinBox;
   QSpinBox* frameQSpinBox;
   QLabel* frameLabel;
+  QLabel* frameRateLabel;
   bool isPlaying;
   bool ContinuePlaying;
 };
@@ -163,6 +166,15 @@ vvPlayerControlsToolbar::vvPlayerControlsToolbar(QWidget* parentObject)
   QObject::connect(this, SIGNAL(speedChange(double)),
     controller, SLOT(onSpeedChange(double)));
 
+  // what to do when the frames cannot be decoded in time
+  this->UI->everyFrameCheckBox = new QCheckBox("Every frame", this);
+  this->UI->everyFrameCheckBox->setToolTip(
+    "Show every frame and slow down when they cannot be decoded in time, "
+    "instead of skipping frames to keep up with the speed");
+  this->addWidget(this->UI->everyFrameCheckBox);
+  QObject::connect(this->UI->everyFrameCheckBox, SIGNAL(toggled(bool)),
+    controller, SLOT(onPolicyChange(bool)));
+
   // add a separator to visualy group the element together
   this->addSeparator();
 
@@ -200,6 +212,13 @@ vvPlayerControlsToolbar::vvPlayerControlsToolbar(QWidget* parentObject)
   this->UI->frameLabel = new QLabel();
   this->addWidget(this->UI->frameLabel);
 
+  //------------------------//
+  // Add the frame rate, shown while playing
+  //------------------------//
+  this->UI->frameRateLabel = new QLabel();
+  this->UI->frameRateLabel->setToolTip("Frames shown per second / target of the speed");
+  this->addWidget(this->UI->frameRateLabel);
+
   // create connection
   this->connect(this->UI->frameQSpinBox, SIGNAL(valueChanged(int)),
     this, SLOT(setTimeStep(int)));
@@ -236,6 +255,8 @@ vvPlayerControlsToolbar::vvPlayerControlsToolbar(QWidget* parentObject)
     ui.actionLoop, SLOT(setChecked(bool)));
   QObject::connect(controller, SIGNAL(playing(bool)),
     this, SLOT(onPlaying(bool)));
+  QObject::connect(controller, SIGNAL(frameRate(double, double, bool)),
+    this, SLOT(onFrameRate(double, double, bool)));
 }
 
 //-----------------------------------------------------------------------------
@@ -268,6 +289,7 @@ void vvPlayerControlsToolbar::onPlaying(bool playing)
     this->UI->actionPlay->setIcon(
       QIcon(":/vvResources/Icons/media-playback-start.png"));
     this->UI->actionPlay->setText("&Play");
+    this->UI->frameRateLabel->clear();
     }
 
   // this becomes a behavior.
@@ -287,6 +309,20 @@ void vvPlayerControlsToolbar::onSpeedChanged()
   }
 }
 
+//-----------------------------------------------------------------------------
+void vvPlayerControlsToolbar::onFrameRate(double achieved, double target, bool lagging)
+{
+  QString text = QString("%1").arg(achieved, 0, 'f', 1);
+  if (target > 0)
+  {
+    text += QString(" / %1").arg(target, 0, 'f', 1);
+  }
+  text += " fps";
+  // red when the frames are skipped or the playback slowed down
+  this->UI->frameRateLabel->setText(
+    lagging ? QString("<font color=\"red\">%1</font>").arg(text) : text);
+}
+
 //-----------------------------------------------------------------------------
 void vvPlayerControlsToolbar::setAnimationScene(pqAnimationScene* scene)
 {
@@ -352,6 +388,7 @@ int vvPlayerControlsToolbar::timeStepCount() const
 //-----------------------------------------------------------------------------
 void vvPlayerControlsToolbar::PressSlider()
 {
+  this->Controller->onScrubbing(true);
   if (this->UI->isPlaying)
   {
     this->UI->ContinuePlaying = true;
@@ -366,6 +403,7 @@ void vvPlayerControlsToolbar::PressSlider()
 //-----------------------------------------------------------------------------
 void vvPlayerControlsToolbar::ReleaseSlider()
 {
+  this->Controller->onScrubbing(false);
   if (this->UI->ContinuePlaying)
   {
     this->Controller->getAnimationScene()->play();
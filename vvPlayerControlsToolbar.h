@@ -61,6 +61,7 @@ public slots:
 protected slots:
   void onPlaying(bool);
   void onSpeedChanged();
+  void onFrameRate(double achieved, double target, bool lagging);
   void setAnimationScene(pqAnimationScene*);
   void PressSlider();
   void ReleaseSlider();
@@ -13,27 +13,28 @@
 // limitations under the License.
 #include "vvToggleSpreadSheetReaction.h"
 
+#include <pqActiveObjects.h>
+#include <pqApplicationCore.h>
+#include <pqObjectBuilder.h>
 #include <pqSpreadSheetView.h>
+#include <pqSpreadSheetViewDecorator.h>
 #include <pqSpreadSheetViewModel.h>
 #include <pqView.h>
 
-#include <iostream>
+#include <QDockWidget>
+
+#include <cassert>
 
 //-----------------------------------------------------------------------------
-vvToggleSpreadSheetReaction::vvToggleSpreadSheetReaction(QAction* action, pqView* view)
+vvToggleSpreadSheetReaction::vvToggleSpreadSheetReaction(QAction* action, QDockWidget* dock)
   : Superclass(action)
   , Action(action)
-  , View(view)
+  , Dock(dock)
+  , View(nullptr)
 {
-  // Hidding the XYZ grouped coordinates column by default
-  if (this->View->inherits("pqSpreadSheetView"))
-  {
-    pqSpreadSheetView* ssview = qobject_cast<pqSpreadSheetView*>(this->View);
-
-    // XYZ column
-    ssview->getViewModel()->setVisible(1, false);
-  }
-
+  // the dock can also be shown by the View menu or by the restored window state
+  QObject::connect(
+    this->Dock, SIGNAL(visibilityChanged(bool)), this, SLOT(onDockVisibilityChanged(bool)));
   QObject::connect(this->Action, SIGNAL(triggered()), this, SLOT(onToggleSpreadsheet()));
 
   this->onToggleSpreadsheet();
@@ -47,5 +48,38 @@ vvToggleSpreadSheetReaction::~vvToggleSpreadSheetReaction()
 //-----------------------------------------------------------------------------
 void vvToggleSpreadSheetReaction::onToggleSpreadsheet()
 {
-  this->View->widget()->parentWidget()->setVisible(this->Action->isChecked());
+  this->Dock->setVisible(this->Action->isChecked());
+}
+
+//-----------------------------------------------------------------------------
+void vvToggleSpreadSheetReaction::onDockVisibilityChanged(bool visible)
+{
+  if (visible && !this->View)
+  {
+    this->createView();
+  }
+}
+
+//-----------------------------------------------------------------------------
+void vvToggleSpreadSheetReaction::createView()
+{
+  pqObjectBuilder* builder = pqApplicationCore::instance()->getObjectBuilder();
+  pqView* activeView = pqActiveObjects::instance().activeView();
+  pqSpreadSheetView* spreadsheetView = qobject_cast<pqSpreadSheetView*>(builder->createView(
+    pqSpreadSheetView::spreadsheetViewType(), pqActiveObjects::instance().activeServer(), true));
+  assert(spreadsheetView);
+  // the python application logic finds the view by this name
+  spreadsheetView->rename("main spreadsheet view");
+  this->Dock->setWidget(spreadsheetView->widget());
+  spreadsheetView->getProxy()->UpdateVTKObjects();
+
+  // Hidding the XYZ grouped coordinates column by default
+  spreadsheetView->getViewModel()->setVisible(1, false);
+
+  pqSpreadSheetViewDecorator* dec = new pqSpreadSheetViewDecorator(spreadsheetView);
+  dec->setPrecision(3);
+  dec->setFixedRepresentation(true);
+
+  this->View = spreadsheetView;
+  pqActiveObjects::instance().setActiveView(activeView);
 }
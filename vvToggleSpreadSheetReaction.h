@@ -17,23 +17,30 @@
 #include "pqReaction.h"
 
 class pqView;
+class QDockWidget;
 
+/// Show or hide the spreadsheet dock. The spreadsheet view is only created the
+/// first time the dock is shown, so that it does not slow down the startup.
 class vvToggleSpreadSheetReaction : public pqReaction
 {
   Q_OBJECT
   typedef pqReaction Superclass;
 
 public:
-  vvToggleSpreadSheetReaction(QAction* action, pqView* view);
+  vvToggleSpreadSheetReaction(QAction* action, QDockWidget* dock);
   virtual ~vvToggleSpreadSheetReaction();
 
 private slots:
   void onToggleSpreadsheet();
+  void onDockVisibilityChanged(bool visible);
 
 private:
   Q_DISABLE_COPY(vvToggleSpreadSheetReaction);
 
+  void createView();
+
   QAction* Action;
+  QDockWidget* Dock;
   pqView* View;
 };
 